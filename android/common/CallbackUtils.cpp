@@ -17,17 +17,22 @@
 #include "CallbackUtils.h"
 
 void acquireCallbackJni(JNIEnv* env, CallbackJni& callbackUtils) {
+    // Looked up once, a callback is created for every upload. The class references are never
+    // released, these are system classes.
+    static const CallbackJni sCallbackJni = [env]() {
+        CallbackJni jni;
 #ifdef ANDROID
-    callbackUtils.handlerClass = env->FindClass("android/os/Handler");
-    callbackUtils.handlerClass = (jclass) env->NewGlobalRef(callbackUtils.handlerClass);
-    callbackUtils.post = env->GetMethodID(callbackUtils.handlerClass,
-            "post", "(Ljava/lang/Runnable;)Z");
+        jni.handlerClass = env->FindClass("android/os/Handler");
+        jni.handlerClass = (jclass) env->NewGlobalRef(jni.handlerClass);
+        jni.post = env->GetMethodID(jni.handlerClass, "post", "(Ljava/lang/Runnable;)Z");
 #endif
-
-    callbackUtils.executorClass = env->FindClass("java/util/concurrent/Executor");
-    callbackUtils.executorClass = (jclass) env->NewGlobalRef(callbackUtils.executorClass);
-    callbackUtils.execute = env->GetMethodID(callbackUtils.executorClass,
-                                              "execute", "(Ljava/lang/Runnable;)V");
+        jni.executorClass = env->FindClass("java/util/concurrent/Executor");
+        jni.executorClass = (jclass) env->NewGlobalRef(jni.executorClass);
+        jni.execute = env->GetMethodID(jni.executorClass,
+                "execute", "(Ljava/lang/Runnable;)V");
+        return jni;
+    }();
+    callbackUtils = sCallbackJni;
 }
 
 void releaseCallbackJni(JNIEnv* env, CallbackJni callbackUtils, jobject handler, jobject callback) {
@@ -43,10 +48,6 @@ void releaseCallbackJni(JNIEnv* env, CallbackJni callbackUtils, jobject handler,
     }
     env->DeleteGlobalRef(handler);
     env->DeleteGlobalRef(callback);
-#ifdef ANDROID
-    env->DeleteGlobalRef(callbackUtils.handlerClass);
-#endif
-    env->DeleteGlobalRef(callbackUtils.executorClass);
 }
 
 JniBufferCallback* JniBufferCallback::make(filament::Engine* engine,
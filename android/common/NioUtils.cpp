@@ -20,26 +20,36 @@
 
 #include <utils/Log.h>
 
+AutoBuffer::NioUtilsJni const& AutoBuffer::getNioUtils(JNIEnv* env) noexcept {
+    // The class reference is never released, the class can't be unloaded while the library
+    // that uses it is loaded.
+    static const NioUtilsJni nioUtils = [env]() {
+        NioUtilsJni jni{};
+        jni.jniClass = env->FindClass("com/google/android/filament/NioUtils");
+        jni.jniClass = (jclass) env->NewGlobalRef(jni.jniClass);
+        jni.getBasePointer = env->GetStaticMethodID(jni.jniClass,
+                "getBasePointer", "(Ljava/nio/Buffer;JI)J");
+        jni.getBaseArray = env->GetStaticMethodID(jni.jniClass,
+                "getBaseArray", "(Ljava/nio/Buffer;)Ljava/lang/Object;");
+        jni.getBaseArrayOffset = env->GetStaticMethodID(jni.jniClass,
+                "getBaseArrayOffset", "(Ljava/nio/Buffer;I)I");
+        jni.getBufferType = env->GetStaticMethodID(jni.jniClass,
+                "getBufferType", "(Ljava/nio/Buffer;)I");
+        return jni;
+    }();
+    return nioUtils;
+}
+
 AutoBuffer::AutoBuffer(JNIEnv *env, jobject buffer, jint size, bool commit) noexcept :
         mEnv(env),
         mDoCommit(commit) {
 
-    mNioUtils.jniClass = env->FindClass("com/google/android/filament/NioUtils");
-    mNioUtils.jniClass = (jclass) env->NewGlobalRef(mNioUtils.jniClass);
-
-    mNioUtils.getBasePointer = env->GetStaticMethodID(mNioUtils.jniClass,
-            "getBasePointer", "(Ljava/nio/Buffer;JI)J");
-    mNioUtils.getBaseArray = env->GetStaticMethodID(mNioUtils.jniClass,
-            "getBaseArray", "(Ljava/nio/Buffer;)Ljava/lang/Object;");
-    mNioUtils.getBaseArrayOffset = env->GetStaticMethodID(mNioUtils.jniClass,
-            "getBaseArrayOffset", "(Ljava/nio/Buffer;I)I");
-    mNioUtils.getBufferType = env->GetStaticMethodID(mNioUtils.jniClass,
-            "getBufferType", "(Ljava/nio/Buffer;)I");
+    NioUtilsJni const& nioUtils = getNioUtils(env);
 
     mBuffer = env->NewGlobalRef(buffer);
 
     mType = (BufferType) env->CallStaticIntMethod(
-                mNioUtils.jniClass, mNioUtils.getBufferType, mBuffer);
+                nioUtils.jniClass, nioUtils.getBufferType, mBuffer);
 
     switch (mType) {
         case BufferType::BYTE:
@@ -63,17 +73,18 @@ AutoBuffer::AutoBuffer(JNIEnv *env, jobject buffer, jint size, bool commit) noex
 
     jlong address = (jlong) env->GetDirectBufferAddress(mBuffer);
     if (address) {
-        // Direct buffer case
-        mData = reinterpret_cast<void *>(env->CallStaticLongMethod(mNioUtils.jniClass,
-                mNioUtils.getBasePointer, mBuffer, address, mShift));
+        // Direct buffer case, the memory is handed to the engine as is. The global reference
+        // to the buffer keeps it alive until the BufferDescriptor's callback releases us.
+        mData = reinterpret_cast<void *>(env->CallStaticLongMethod(nioUtils.jniClass,
+                nioUtils.getBasePointer, mBuffer, address, mShift));
         mUserData = mData;
     } else {
-        // wrapped array case
-        jarray array = (jarray) env->CallStaticObjectMethod(mNioUtils.jniClass,
-                mNioUtils.getBaseArray, mBuffer);
+        // wrapped array case, the array is pinned, or copied if the VM can't pin it
+        jarray array = (jarray) env->CallStaticObjectMethod(nioUtils.jniClass,
+                nioUtils.getBaseArray, mBuffer);
 
-        jint offset = env->CallStaticIntMethod(mNioUtils.jniClass,
-                mNioUtils.getBaseArrayOffset, mBuffer, mShift);
+        jint offset = env->CallStaticIntMethod(nioUtils.jniClass,
+                nioUtils.getBaseArrayOffset, mBuffer, mShift);
 
         mBaseArray = (jarray) env->NewGlobalRef(array);
         switch (mType) {
@@ -112,7 +123,7 @@ AutoBuffer::AutoBuffer(AutoBuffer &&rhs) noexcept {
     std::swap(mShift, rhs.mShift);
     std::swap(mBuffer, rhs.mBuffer);
     std::swap(mBaseArray, rhs.mBaseArray);
-    std::swap(mNioUtils, rhs.mNioUtils);
+    std::swap(mDoCommit, rhs.mDoCommit);
 }
 
 AutoBuffer::~AutoBuffer() noexcept {
@@ -147,5 +158,4 @@ AutoBuffer::~AutoBuffer() noexcept {
     if (mBuffer) {
         env->DeleteGlobalRef(mBuffer);
     }
-    mEnv->DeleteGlobalRef(mNioUtils.jniClass);
 }
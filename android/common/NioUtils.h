@@ -66,11 +66,13 @@ private:
     jarray mBaseArray = nullptr;
     bool mDoCommit = false;
 
-    struct {
+    // looked up once, AutoBuffer is created for every upload
+    struct NioUtilsJni {
         jclass jniClass;
         jmethodID getBasePointer;
         jmethodID getBaseArray;
         jmethodID getBaseArrayOffset;
         jmethodID getBufferType;
-    } mNioUtils{};
+    };
+    static NioUtilsJni const& getNioUtils(JNIEnv* env) noexcept;
 };
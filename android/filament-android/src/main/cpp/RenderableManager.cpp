@@ -339,6 +339,31 @@ Java_com_google_android_filament_RenderableManager_nSetMaterialInstanceAt(JNIEnv
             materialInstance);
 }
 
+extern "C" JNIEXPORT jint JNICALL
+Java_com_google_android_filament_RenderableManager_nSetMaterialInstancesAt(JNIEnv* env, jclass,
+        jlong nativeRenderableManager, jobject instances_, jint instancesRemaining,
+        jobject primitiveIndices_, jint primitiveIndicesRemaining,
+        jobject materialInstances_, jint materialInstancesRemaining, jint count) {
+    RenderableManager *rm = (RenderableManager *) nativeRenderableManager;
+    AutoBuffer instances(env, instances_, count);
+    AutoBuffer primitiveIndices(env, primitiveIndices_, count);
+    AutoBuffer materialInstances(env, materialInstances_, count);
+    if (instances.getSize() > (instancesRemaining << instances.getShift()) ||
+            primitiveIndices.getSize() > (primitiveIndicesRemaining << primitiveIndices.getShift()) ||
+            materialInstances.getSize() > (materialInstancesRemaining << materialInstances.getShift())) {
+        // BufferOverflowException
+        return -1;
+    }
+    jint const* i = static_cast<jint const*>(instances.getData());
+    jint const* primitiveIndex = static_cast<jint const*>(primitiveIndices.getData());
+    jlong const* materialInstance = static_cast<jlong const*>(materialInstances.getData());
+    for (jint k = 0; k < count; k++) {
+        rm->setMaterialInstanceAt((RenderableManager::Instance) i[k], (size_t) primitiveIndex[k],
+                (const MaterialInstance *) materialInstance[k]);
+    }
+    return 0;
+}
+
 extern "C" JNIEXPORT long JNICALL
 Java_com_google_android_filament_RenderableManager_nGetMaterialInstanceAt(JNIEnv*, jclass,
         jlong nativeRenderableManager, jint i, jint primitiveIndex) {
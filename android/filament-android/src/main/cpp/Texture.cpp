@@ -21,6 +21,14 @@
 
 #ifdef ANDROID
 #include <android/bitmap.h>
+#include <android/log.h>
+
+#if __has_include(<android/hardware_buffer_jni.h>)
+#include <android/hardware_buffer_jni.h>
+#define FILAMENT_JNI_HAS_HARDWARE_BUFFER 1
+#endif
+
+#include <dlfcn.h>
 #endif
 
 #include <backend/BufferDescriptor.h>
@@ -606,4 +614,141 @@ Java_com_google_android_filament_android_TextureHelper_nSetBitmapWithCallback(JN
             std::move(desc));
 }
 
+#if FILAMENT_JNI_HAS_HARDWARE_BUFFER
+
+// The AHardwareBuffer functions are not available before Android 8, they're looked up at runtime.
+struct HardwareBufferFunctions {
+    decltype(&AHardwareBuffer_fromHardwareBuffer) fromHardwareBuffer = nullptr;
+    decltype(&AHardwareBuffer_acquire) acquire = nullptr;
+    decltype(&AHardwareBuffer_release) release = nullptr;
+    decltype(&AHardwareBuffer_describe) describe = nullptr;
+    decltype(&AHardwareBuffer_lock) lock = nullptr;
+    decltype(&AHardwareBuffer_unlock) unlock = nullptr;
+
+    bool isSupported() const noexcept {
+        return fromHardwareBuffer && acquire && release && describe && lock && unlock;
+    }
+
+    static HardwareBufferFunctions const& get() noexcept {
+        static const HardwareBufferFunctions functions = []() {
+            HardwareBufferFunctions f;
+            f.fromHardwareBuffer = (decltype(f.fromHardwareBuffer))
+                    dlsym(RTLD_DEFAULT, "AHardwareBuffer_fromHardwareBuffer");
+            f.acquire = (decltype(f.acquire)) dlsym(RTLD_DEFAULT, "AHardwareBuffer_acquire");
+            f.release = (decltype(f.release)) dlsym(RTLD_DEFAULT, "AHardwareBuffer_release");
+            f.describe = (decltype(f.describe)) dlsym(RTLD_DEFAULT, "AHardwareBuffer_describe");
+            f.lock = (decltype(f.lock)) dlsym(RTLD_DEFAULT, "AHardwareBuffer_lock");
+            f.unlock = (decltype(f.unlock)) dlsym(RTLD_DEFAULT, "AHardwareBuffer_unlock");
+            if (!f.isSupported()) {
+                __android_log_print(ANDROID_LOG_WARN, "Filament",
+                        "AHardwareBuffer is not available.");
+            }
+            return f;
+        }();
+        return functions;
+    }
+};
+
+// Keeps a HardwareBuffer locked for CPU reads until the engine is done with its pixels, which
+// are handed to the engine without being copied.
+class AutoHardwareBuffer {
+public:
+    static AutoHardwareBuffer* make(JNIEnv* env, jobject hwbuffer,
+            jobject handler, jobject runnable) {
+        HardwareBufferFunctions const& hb = HardwareBufferFunctions::get();
+        if (!hb.isSupported()) {
+            return nullptr;
+        }
+        AHardwareBuffer* buffer = hb.fromHardwareBuffer(env, hwbuffer);
+        if (!buffer) {
+            return nullptr;
+        }
+        AHardwareBuffer_Desc desc{};
+        hb.describe(buffer, &desc);
+        void* data = nullptr;
+        if (hb.lock(buffer, AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN, -1, nullptr, &data) != 0) {
+            __android_log_print(ANDROID_LOG_WARN, "Filament",
+                    "Unable to lock the HardwareBuffer for CPU reads.");
+            return nullptr;
+        }
+        hb.acquire(buffer);
+        return new AutoHardwareBuffer(env, buffer, desc, data, handler, runnable);
+    }
+
+    ~AutoHardwareBuffer() noexcept {
+        HardwareBufferFunctions const& hb = HardwareBufferFunctions::get();
+        hb.unlock(mBuffer, nullptr);
+        hb.release(mBuffer);
+        releaseCallbackJni(mEnv, mCallbackUtils, mHandler, mCallback);
+    }
+
+    void* getData() const noexcept { return mData; }
+
+    AHardwareBuffer_Desc const& getDesc() const noexcept { return mDesc; }
+
+    static void invoke(void*, size_t, void* user) {
+        delete reinterpret_cast<AutoHardwareBuffer*>(user);
+    }
+
+private:
+    AutoHardwareBuffer(JNIEnv* env, AHardwareBuffer* buffer, AHardwareBuffer_Desc const& desc,
+            void* data, jobject handler, jobject runnable) noexcept
+            : mEnv(env)
+            , mBuffer(buffer)
+            , mDesc(desc)
+            , mData(data)
+            , mHandler(env->NewGlobalRef(handler))
+            , mCallback(env->NewGlobalRef(runnable)) {
+        acquireCallbackJni(env, mCallbackUtils);
+    }
+
+    JNIEnv* mEnv;
+    AHardwareBuffer* mBuffer;
+    AHardwareBuffer_Desc mDesc;
+    void* mData;
+    jobject mHandler;
+    jobject mCallback;
+    CallbackJni mCallbackUtils;
+};
+
+#endif
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_google_android_filament_android_TextureHelper_nSetHardwareBuffer(JNIEnv* env, jclass,
+        jlong nativeTexture, jlong nativeEngine, jint level, jint xoffset, jint yoffset,
+        jint width, jint height, jobject hwbuffer, jint format, jint type,
+        jobject handler, jobject runnable) {
+#if FILAMENT_JNI_HAS_HARDWARE_BUFFER
+    Texture* texture = (Texture*) nativeTexture;
+    Engine *engine = (Engine *) nativeEngine;
+
+    auto* autoBuffer = AutoHardwareBuffer::make(env, hwbuffer, handler, runnable);
+    if (!autoBuffer) {
+        return -1;
+    }
+
+    // the stride of a HardwareBuffer is in pixels, like the one of PixelBufferDescriptor
+    AHardwareBuffer_Desc const& desc = autoBuffer->getDesc();
+    if (desc.width < uint32_t(width) || desc.height < uint32_t(height)) {
+        AutoHardwareBuffer::invoke(nullptr, 0, autoBuffer);
+        return -1;
+    }
+    const size_t sizeInBytes = Texture::computeTextureDataSize((Texture::Format) format,
+            (Texture::Type) type, desc.stride, desc.height, 1);
+
+    Texture::PixelBufferDescriptor pbd(autoBuffer->getData(), sizeInBytes,
+            (backend::PixelDataFormat) format, (backend::PixelDataType) type,
+            1, 0, 0, desc.stride, &AutoHardwareBuffer::invoke, autoBuffer);
+
+    texture->setImage(*engine, (size_t) level,
+            (uint32_t) xoffset, (uint32_t) yoffset,
+            (uint32_t) width, (uint32_t) height,
+            std::move(pbd));
+    return 0;
+#else
+    return -1;
+#endif
+}
+
 #endif
@@ -23,10 +23,14 @@
 
 #include <math/mat4.h>
 
+#include "common/NioUtils.h"
+
 using namespace utils;
 using namespace filament;
 
 static_assert(sizeof(jint) == sizeof(Entity), "jint and Entity are not compatible!!");
+static_assert(sizeof(jint) == sizeof(TransformManager::Instance),
+        "jint and TransformManager::Instance are not compatible!!");
 
 extern "C" JNIEXPORT jboolean JNICALL
 Java_com_google_android_filament_TransformManager_nHasComponent(JNIEnv*, jclass,
@@ -104,6 +108,23 @@ Java_com_google_android_filament_TransformManager_nSetTransform(JNIEnv* env,
     env->ReleaseFloatArrayElements(localTransform_, localTransform, JNI_ABORT);
 }
 
+extern "C" JNIEXPORT jint JNICALL
+Java_com_google_android_filament_TransformManager_nSetTransforms(JNIEnv* env,
+        jclass, jlong nativeTransformManager, jobject instances_, jint instancesRemaining,
+        jobject localTransforms_, jint localTransformsRemaining, jint count) {
+    TransformManager* tm = (TransformManager*) nativeTransformManager;
+    AutoBuffer instances(env, instances_, count);
+    AutoBuffer localTransforms(env, localTransforms_, count * 16);
+    if (instances.getSize() > (instancesRemaining << instances.getShift()) ||
+            localTransforms.getSize() > (localTransformsRemaining << localTransforms.getShift())) {
+        // BufferOverflowException
+        return -1;
+    }
+    tm->setTransforms(static_cast<TransformManager::Instance const*>(instances.getData()),
+            static_cast<const filament::math::mat4f*>(localTransforms.getData()), (size_t) count);
+    return 0;
+}
+
 extern "C" JNIEXPORT void JNICALL
 Java_com_google_android_filament_TransformManager_nGetTransform(JNIEnv* env,
         jclass, jlong nativeTransformManager, jint i,
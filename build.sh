@@ -232,9 +232,44 @@ function build_desktop {
     fi
 }
 
+# Builds the multithreaded variant of filament-js (pthreads and SIMD128) and copies it next to
+# the single-threaded module, which remains the fallback when cross-origin isolation is unavailable.
+function build_webgl_threads_with_target {
+    local lc_target=$(echo "$1" | tr '[:upper:]' '[:lower:]')
+
+    echo "Building WebGL ${lc_target} with threads..."
+    mkdir -p "out/cmake-webgl-threads-${lc_target}"
+    cd "out/cmake-webgl-threads-${lc_target}"
+
+    (
+    # shellcheck disable=SC1090
+    source "${EMSDK}/emsdk_env.sh"
+    if [[ ! -d "CMakeFiles" ]] || [[ "${ISSUE_CMAKE_ALWAYS}" == "true" ]]; then
+        cmake \
+            -G "${BUILD_GENERATOR}" \
+            -DIMPORT_EXECUTABLES_DIR=out \
+            -DCMAKE_TOOLCHAIN_FILE="${EMSDK}/upstream/emscripten/cmake/Modules/Platform/Emscripten.cmake" \
+            -DCMAKE_BUILD_TYPE="$1" \
+            -DWEBGL=1 \
+            -DFILAMENT_WEBGL_THREADS=ON \
+            ../..
+    fi
+    ${BUILD_COMMAND} filament-js
+    )
+
+    local output="../cmake-webgl-${lc_target}/web/filament-js"
+    mkdir -p "${output}"
+    cp web/filament-js/filament-mt.js web/filament-js/filament-mt.wasm \
+        web/filament-js/filament-mt.worker.js "${output}"
+
+    cd ../..
+}
+
 function build_webgl_with_target {
     local lc_target=$(echo "$1" | tr '[:upper:]' '[:lower:]')
 
+    build_webgl_threads_with_target "$1"
+
     echo "Building WebGL ${lc_target}..."
     mkdir -p "out/cmake-webgl-${lc_target}"
     cd "out/cmake-webgl-${lc_target}"
@@ -277,6 +312,9 @@ function build_webgl_with_target {
             cd web/filament-js
             tar -cvf "../../../filament-${lc_target}-web.tar" filament.js
             tar -rvf "../../../filament-${lc_target}-web.tar" filament.wasm
+            tar -rvf "../../../filament-${lc_target}-web.tar" filament-mt.js
+            tar -rvf "../../../filament-${lc_target}-web.tar" filament-mt.wasm
+            tar -rvf "../../../filament-${lc_target}-web.tar" filament-mt.worker.js
             tar -rvf "../../../filament-${lc_target}-web.tar" filament.d.ts
             cd -
             gzip -c "../filament-${lc_target}-web.tar" > "../filament-${lc_target}-web.tgz"
@@ -49,6 +49,7 @@ static constexpr uint64_t SWAP_CHAIN_CONFIG_APPLE_CVPIXELBUFFER = 0x8;
 static constexpr size_t MAX_VERTEX_ATTRIBUTE_COUNT = 16; // This is guaranteed by OpenGL ES.
 static constexpr size_t MAX_SAMPLER_COUNT = 16;          // Matches the Adreno Vulkan driver.
 static constexpr size_t MAX_VERTEX_BUFFER_COUNT = 16;    // Max number of bound buffer objects.
+static constexpr size_t MAX_STORAGE_BUFFER_COUNT = 4;    // Guaranteed by Vulkan and GL ES 3.1.
 
 static_assert(MAX_VERTEX_BUFFER_COUNT <= MAX_VERTEX_ATTRIBUTE_COUNT,
         "The number of buffer objects that can be attached to a VertexBuffer must be "
@@ -271,6 +272,8 @@ enum class ElementType : uint8_t {
 //! Buffer object binding type
 enum class BufferObjectBinding : uint8_t {
     VERTEX,
+    SHADER_STORAGE,     //!< requires compute support, see Driver::isComputeSupported()
+    DRAW_INDIRECT,      //!< requires Driver::isDrawIndirectSupported()
 };
 
 //! Face culling Mode
@@ -519,6 +522,7 @@ enum class TextureUsage : uint8_t {
     UPLOADABLE          = 0x8,                      //!< Data can be uploaded into this texture (default)
     SAMPLEABLE          = 0x10,                     //!< Texture can be sampled (default)
     SUBPASS_INPUT       = 0x20,                     //!< Texture can be used as a subpass input
+    SPARSE              = 0x40,                     //!< Texture memory is committed page by page
     DEFAULT             = UPLOADABLE | SAMPLEABLE   //!< Default texture usage
 };
 
@@ -863,6 +867,16 @@ struct RenderPassFlags {
     TargetBufferFlags discardEnd;
 };
 
+/**
+ * Size of the block of pixels shaded by a single fragment shader invocation.
+ */
+enum class ShadingRate : uint8_t {
+    RATE_1X1,   //!< one invocation per pixel (default)
+    RATE_1X2,   //!< one invocation per 1x2 pixels block
+    RATE_2X1,   //!< one invocation per 2x1 pixels block
+    RATE_2X2,   //!< one invocation per 2x2 pixels block
+};
+
 /**
  * Parameters of a render pass.
  */
@@ -890,6 +904,9 @@ struct RenderPassParams {
      * attachment (see MRT::TARGET_COUNT).
      */
     uint32_t subpassMask = 0;
+
+    //! Shading rate for the draws of this pass. Ignored if isShadingRateSupported() is false.
+    ShadingRate shadingRate = ShadingRate::RATE_1X1;
 };
 
 struct PolygonOffset {
@@ -23,6 +23,9 @@
 
 #include <utils/compiler.h>
 
+#include <stddef.h>
+#include <stdint.h>
+
 namespace filament {
 namespace backend {
 
@@ -37,6 +40,31 @@ public:
         uintptr_t image = 0;
     };
 
+    /**
+     * Stores a blob in the application's persistent cache.
+     *
+     * @param key       pointer to the key identifying the blob
+     * @param keySize   size of the key in bytes
+     * @param value     pointer to the blob
+     * @param valueSize size of the blob in bytes
+     * @param user      the user pointer passed to setBlobFunc()
+     */
+    using InsertBlobFunc = void(*)(const void* key, size_t keySize,
+            const void* value, size_t valueSize, void* user);
+
+    /**
+     * Retrieves a blob from the application's persistent cache.
+     *
+     * @param key       pointer to the key identifying the blob
+     * @param keySize   size of the key in bytes
+     * @param value     destination buffer, only written to if \p valueSize is large enough
+     * @param valueSize size of the destination buffer in bytes
+     * @param user      the user pointer passed to setBlobFunc()
+     * @return the size of the stored blob in bytes, or 0 if the key wasn't found.
+     */
+    using RetrieveBlobFunc = size_t(*)(const void* key, size_t keySize,
+            void* value, size_t valueSize, void* user);
+
     virtual ~Platform() noexcept;
 
     /**
@@ -66,6 +94,44 @@ public:
      * thread, or if the platform does not need to perform any special processing.
      */
     virtual bool pumpEvents() noexcept { return false; }
+
+    /**
+     * Sets the callbacks used by the backend to store and retrieve compiled programs and
+     * pipeline caches across runs (e.g. GL program binaries or VkPipelineCache data).
+     *
+     * This must be called before the Engine is created with this Platform. Both callbacks
+     * are invoked from the backend thread and must be thread-safe with respect to the
+     * application. Passing nullptr for either callback disables the blob cache.
+     *
+     * @param insertBlob    callback storing a blob
+     * @param retrieveBlob  callback retrieving a blob
+     * @param user          opaque pointer passed back to both callbacks
+     */
+    void setBlobFunc(InsertBlobFunc insertBlob, RetrieveBlobFunc retrieveBlob,
+            void* user = nullptr) noexcept;
+
+    /**
+     * @return true if both blob cache callbacks are set.
+     */
+    bool hasBlobFunc() const noexcept {
+        return mInsertBlob && mRetrieveBlob;
+    }
+
+    /**
+     * Stores a blob using the InsertBlobFunc callback, if set.
+     */
+    void insertBlob(const void* key, size_t keySize, const void* value, size_t valueSize) noexcept;
+
+    /**
+     * Retrieves a blob using the RetrieveBlobFunc callback, if set.
+     * @return the size of the stored blob, or 0 if it is not cached.
+     */
+    size_t retrieveBlob(const void* key, size_t keySize, void* value, size_t valueSize) noexcept;
+
+private:
+    InsertBlobFunc mInsertBlob = nullptr;
+    RetrieveBlobFunc mRetrieveBlob = nullptr;
+    void* mBlobUser = nullptr;
 };
 
 
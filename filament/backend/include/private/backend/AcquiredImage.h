@@ -30,6 +30,9 @@ struct AcquiredImage {
     void* image = nullptr;
     backend::StreamCallback callback = nullptr;
     void* userData = nullptr;
+    // native fence (e.g. an Android sync file descriptor) signaled when the producer has finished
+    // writing the image, or -1 if the image is ready. Whoever holds the image owns the fence.
+    int fence = -1;
 };
 
 } // namespace backend
@@ -60,6 +60,9 @@ public:
     // returns true if the buffer is empty (e.g. after calling flush)
     bool empty() const noexcept { return mTail == mHead; }
 
+    // number of bytes allocated since the last call to circularize()
+    size_t getUsed() const noexcept { return size_t(intptr_t(mHead) - intptr_t(mTail)); }
+
     void* getHead() const noexcept { return mHead; }
 
     void* getTail() const noexcept { return mTail; }
@@ -23,6 +23,7 @@
 #include <utils/Condition.h>
 #include <utils/Mutex.h>
 
+#include <atomic>
 #include <vector>
 
 namespace filament {
@@ -41,14 +42,17 @@ class CommandBufferQueue {
 
     CircularBuffer mCircularBuffer;
 
-    // space available in the circular buffer
-
     mutable utils::Mutex mLock;
     mutable utils::Condition mCondition;
     mutable std::vector<Slice> mCommandBuffersToExecute;
-    size_t mFreeSpace = 0;
+
+    // space available in the circular buffer, it's returned by the consumer without taking
+    // the lock, unless the producer is waiting for it.
+    std::atomic<size_t> mFreeSpace = 0;
+    std::atomic<bool> mProducerWaiting = false;
     size_t mHighWatermark = 0;
-    uint32_t mExitRequested = 0;
+    size_t mFlushedSize = 0;
+    std::atomic<uint32_t> mExitRequested = 0;
 
     static constexpr uint32_t EXIT_REQUESTED = 0x31415926;
 
@@ -59,8 +63,15 @@ public:
 
     CircularBuffer& getCircularBuffer() { return mCircularBuffer; }
 
+    // maximum number of bytes that were in use in the circular buffer
     size_t getHighWatermark() const noexcept { return mHighWatermark; }
 
+    // number of bytes that can be recorded between two flush() without corrupting the stream
+    size_t getCapacity() const noexcept { return mRequiredSize; }
+
+    // total number of bytes flushed so far
+    size_t getFlushedSize() const noexcept { return mFlushedSize; }
+
     // wait for commands to be available and returns an array containing these commands
     std::vector<Slice> waitForCommands() const;
 
@@ -57,6 +57,7 @@ namespace backend {
 
 class Driver;
 class CommandBase;
+class CommandStreamWriter;
 
 /*
  * Dispatcher is a data structure containing only function pointers.
@@ -76,6 +77,9 @@ public:
 #define DECL_DRIVER_API(methodName, paramsDecl, params)                     Execute methodName##_;
 #define DECL_DRIVER_API_RETURN(RetType, methodName, paramsDecl, params)     Execute methodName##_;
 #include "DriverAPI.inc"
+
+    // the same commands, writing themselves to the driver's CommandStreamWriter before executing
+    Dispatcher* capture = nullptr;
 };
 
 // ------------------------------------------------------------------------------------------------
@@ -169,6 +173,11 @@ struct CommandType<void (Driver::*)(ARGS...)> {
             self->~Command();
         }
 
+        // the arguments of the command, valid until it executes
+        static inline SavedParameters const& getArguments(CommandBase const* base) noexcept {
+            return static_cast<Command const*>(base)->mArgs;
+        }
+
         // A command can be moved
         inline Command(Command&& rhs) noexcept = default;
 
@@ -291,12 +300,22 @@ public:
 
     void execute(void* buffer);
 
+    // the buffer commands are currently recorded into
+    CircularBuffer const& getCircularBuffer() const noexcept { return *mCurrentBuffer; }
+
     /*
      * queueCommand() allows to queue a lambda function as a command.
      * This is much less efficient than using the Driver* API.
      */
     void queueCommand(std::function<void()> command);
 
+    /*
+     * Starts writing all the commands recorded from now on to writer, in the order the driver
+     * executes them. nullptr stops the capture. writer is used on the driver thread, it must
+     * outlive the commands recorded until the capture is stopped.
+     */
+    void setCommandStreamWriter(CommandStreamWriter* writer);
+
     /*
      * Allocates memory associated to the current CommandStreamBuffer.
      * This memory will be automatically freed after this command buffer is processed.
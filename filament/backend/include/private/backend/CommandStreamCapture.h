@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DRIVER_COMMANDSTREAMCAPTURE_H
+#define TNT_FILAMENT_DRIVER_COMMANDSTREAMCAPTURE_H
+
+#include "private/backend/CommandBufferQueue.h"
+#include "private/backend/CommandStream.h"
+#include "private/backend/Program.h"
+#include "private/backend/SamplerGroup.h"
+
+#include <backend/BufferDescriptor.h>
+#include <backend/DriverEnums.h>
+#include <backend/Handle.h>
+#include <backend/PipelineState.h>
+#include <backend/PixelBufferDescriptor.h>
+#include <backend/TargetBufferInfo.h>
+
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * A capture file holds every asynchronous command of the DriverAPI executed by a driver, with
+ * their arguments and the content of the buffers they upload, in execution order. It can be
+ * replayed into any driver without a Filament Engine, to benchmark a backend in isolation.
+ *
+ * Synchronous commands, custom commands (CommandStream::queueCommand) and external resources
+ * (native streams and images, callbacks) aren't captured. Captures aren't portable between
+ * architectures with a different pointer size.
+ *
+ * Layout of a capture file:
+ *      uint32_t    MAGIC
+ *      uint32_t    VERSION
+ *      uint32_t    CommandId::COUNT
+ *      for each command:
+ *          uint16_t    CommandId
+ *          uint32_t    size of the arguments in bytes
+ *          uint8_t[]   arguments
+ */
+
+namespace filament {
+namespace backend {
+
+class Driver;
+
+// Identifies each asynchronous command of the DriverAPI in a capture file
+enum class CommandId : uint16_t {
+#define DECL_DRIVER_API_SYNCHRONOUS(RetType, methodName, paramsDecl, params)
+#define DECL_DRIVER_API(methodName, paramsDecl, params)                 methodName,
+#define DECL_DRIVER_API_RETURN(RetType, methodName, paramsDecl, params) methodName,
+#include "private/backend/DriverAPI.inc"
+    COUNT
+};
+
+/*
+ * Writes the commands executed by a driver to a capture file.
+ * See CommandStream::setCommandStreamWriter().
+ */
+class CommandStreamWriter {
+public:
+    static constexpr uint32_t MAGIC = 0x43534346;   // 'FCSC'
+    static constexpr uint32_t VERSION = 2;
+
+    // captures to memory, see getData()
+    CommandStreamWriter() noexcept;
+
+    // creates the capture file, check isOpen() for success
+    explicit CommandStreamWriter(const char* path) noexcept;
+    ~CommandStreamWriter() noexcept;
+
+    CommandStreamWriter(CommandStreamWriter const&) = delete;
+    CommandStreamWriter& operator=(CommandStreamWriter const&) = delete;
+
+    bool isOpen() const noexcept { return mFile != nullptr || mInMemory; }
+
+    // number of commands written so far
+    size_t getCommandCount() const noexcept { return mCommandCount; }
+
+    // content of a capture to memory, laid out like a capture file
+    std::vector<uint8_t> const& getData() const noexcept { return mData; }
+
+    // appends a command and its arguments, called on the driver thread before it executes
+    template<typename ... ARGS>
+    void write(CommandId id, std::tuple<ARGS...> const& args) noexcept {
+        // the buffers given to readPixels are written by the driver, their content is useless
+        mWritePayloads = id != CommandId::readPixels && id != CommandId::readStreamPixels;
+        mBuffer.clear();
+        std::apply([this](auto const& ... arg) { (writeValue(arg), ...); }, args);
+        commit(id);
+    }
+
+private:
+    template<typename T>
+    void writeValue(T const& value) noexcept {
+        static_assert(std::is_trivially_copyable<T>::value, "missing serializer for this type");
+        writeBytes(&value, sizeof(T));
+    }
+
+    template<typename T>
+    void writeValue(Handle<T> const& handle) noexcept {
+        writeValue(handle.getId());
+    }
+
+    void writeValue(void* pointer) noexcept;
+    void writeValue(const char* string) noexcept;
+    void writeValue(FrameScheduledCallback callback) noexcept;
+    void writeValue(FrameCompletedCallback callback) noexcept;
+    void writeValue(BufferDescriptor const& buffer) noexcept;
+    void writeValue(PixelBufferDescriptor const& buffer) noexcept;
+    void writeValue(Program const& program) noexcept;
+    void writeValue(SamplerGroup const& samplerGroup) noexcept;
+    void writeValue(TargetBufferInfo const& info) noexcept;
+    void writeValue(MRT const& mrt) noexcept;
+    void writeValue(PipelineState const& state) noexcept;
+    void writeValue(FaceOffsets const& offsets) noexcept;
+
+    void writeString(const char* string, size_t length) noexcept;
+    void writeBytes(void const* data, size_t size) noexcept;
+    void commit(CommandId id) noexcept;
+
+    FILE* mFile = nullptr;
+    std::vector<uint8_t> mBuffer;
+    std::vector<uint8_t> mData;
+    size_t mCommandCount = 0;
+    bool mWritePayloads = true;
+    bool mInMemory = false;
+};
+
+/*
+ * Replays a capture file into a driver, on the calling thread.
+ *
+ * The handles created by the capture are created again and remapped, buffers are uploaded from
+ * the capture. Swap chains are created for the native window given to the constructor, or as
+ * headless swap chains if it's null.
+ */
+class CommandStreamReplayer {
+public:
+    CommandStreamReplayer(Driver& driver, void* nativeWindow,
+            uint32_t headlessWidth, uint32_t headlessHeight) noexcept;
+    ~CommandStreamReplayer() noexcept;
+
+    CommandStreamReplayer(CommandStreamReplayer const&) = delete;
+    CommandStreamReplayer& operator=(CommandStreamReplayer const&) = delete;
+
+    // loads a capture file, returns false if it can't be read
+    bool load(const char* path) noexcept;
+
+    // loads a capture from memory, e.g. from CommandStreamWriter::getData()
+    bool load(void const* data, size_t size) noexcept;
+
+    // Number of complete frames in the capture. A frame ends with an endFrame command and holds
+    // all the commands recorded since the end of the previous frame. The commands following the
+    // last endFrame, usually the shutdown of the engine, aren't replayed.
+    size_t getFrameCount() const noexcept { return mFrames.size(); }
+
+    // the commands of a frame, in execution order
+    std::vector<CommandId> getCommands(size_t frame) const noexcept;
+
+    // Replays one frame, and returns once the driver executed all its commands. A frame can be
+    // replayed again, the resources it destroys are ignored by the next replays.
+    void replay(size_t frame) noexcept;
+
+    // waits until the GPU completed all the commands replayed so far
+    void finish() noexcept;
+
+private:
+    // reads the arguments of a CommandStream method
+    template<typename R, typename ... ARGS>
+    std::tuple<std::decay_t<ARGS>...> readArguments(R (CommandStream::*)(ARGS...)) noexcept {
+        std::tuple<std::decay_t<ARGS>...> args;
+        std::apply([this](auto& ... arg) { (readValue(arg), ...); }, args);
+        return args;
+    }
+
+    template<typename T>
+    void readValue(T& value) noexcept {
+        static_assert(std::is_trivially_copyable<T>::value, "missing deserializer for this type");
+        readBytes(&value, sizeof(T));
+    }
+
+    template<typename T>
+    void readValue(Handle<T>& handle) noexcept {
+        const HandleBase::HandleId id = remap(readHandleId());
+        handle = id == HandleBase::nullid ? Handle<T>{} : Handle<T>{ id };
+    }
+
+    void readValue(void*& pointer) noexcept;
+    void readValue(const char*& string) noexcept;
+    void readValue(FrameScheduledCallback& callback) noexcept;
+    void readValue(FrameCompletedCallback& callback) noexcept;
+    void readValue(BufferDescriptor& buffer) noexcept;
+    void readValue(PixelBufferDescriptor& buffer) noexcept;
+    void readValue(Program& program) noexcept;
+    void readValue(SamplerGroup& samplerGroup) noexcept;
+    void readValue(TargetBufferInfo& info) noexcept;
+    void readValue(MRT& mrt) noexcept;
+    void readValue(PipelineState& state) noexcept;
+    void readValue(FaceOffsets& offsets) noexcept;
+
+    HandleBase::HandleId readHandleId() noexcept;
+    HandleBase::HandleId peekHandleId() const noexcept;
+    HandleBase::HandleId remap(HandleBase::HandleId id) const noexcept;
+    utils::CString readString() noexcept;
+    void readBytes(void* data, size_t size) noexcept;
+    void* readPayload(size_t size) noexcept;
+
+    bool parse(const char* name) noexcept;
+    void replayCommand(CommandId id) noexcept;
+    void execute() noexcept;
+
+    Driver& mDriver;
+    void* const mNativeWindow;
+    const uint32_t mHeadlessWidth;
+    const uint32_t mHeadlessHeight;
+    CommandBufferQueue mQueue;
+    CommandStream mStream;
+    std::vector<uint8_t> mData;
+    struct Frame {
+        size_t begin;   // offset of the first command of the frame in mData
+        size_t end;     // offset following its endFrame command
+    };
+    std::vector<Frame> mFrames;
+    std::unordered_map<HandleBase::HandleId, HandleBase::HandleId> mHandles;
+    uint8_t const* mCurrent = nullptr;
+    uint8_t const* mEnd = nullptr;
+};
+
+} // namespace backend
+} // namespace filament
+
+#endif // TNT_FILAMENT_DRIVER_COMMANDSTREAMCAPTURE_H
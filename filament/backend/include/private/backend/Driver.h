@@ -56,6 +56,16 @@ template<typename T>
 class ConcreteDispatcher;
 class Dispatcher;
 class CommandStream;
+class CommandStreamWriter;
+
+// Bytes of GPU memory allocated by a driver, by category, see Driver::getMemoryStats()
+struct MemoryStats {
+    size_t textures = 0;        // textures that can't be rendered into
+    size_t renderTargets = 0;   // textures and renderbuffers that can be rendered into
+    size_t buffers = 0;         // vertex, index and uniform buffers, buffer objects
+    size_t staging = 0;         // buffers used to upload data, only pooled by some backends.
+                                // Metal allocates all its buffers from this pool.
+};
 
 class Driver {
 public:
@@ -71,6 +81,14 @@ public:
 
     virtual Dispatcher& getDispatcher() noexcept = 0;
 
+    // sets the writer used by the capture dispatcher, called on the driver thread
+    // see CommandStream::setCommandStreamWriter()
+    virtual void setCommandStreamWriter(CommandStreamWriter* writer) noexcept = 0;
+
+    // GPU memory allocated by the driver so far, can be called from any thread. The sizes are
+    // computed from the resources' descriptions, they don't account for alignment or padding.
+    virtual MemoryStats getMemoryStats() const noexcept = 0;
+
     // called from CommandStream::execute on the render-thread
     // the fn function will execute a batch of driver commands
     // this gives the driver a chance to wrap their execution in a meaningful manner
@@ -63,6 +63,11 @@ public:
     // swap draw buffers (i.e. for double-buffered rendering).
     virtual void commit(SwapChain* swapChain) noexcept = 0;
 
+    // Called before rendering into the swap chain, with the region (in window coordinates) that
+    // the next commit() updates. The rest of the swap chain is unchanged since the last commit().
+    // This is only a hint, platforms can ignore it and present the whole swap chain.
+    virtual void setDamageRegion(SwapChain* swapChain, backend::Viewport const& region) noexcept {}
+
     virtual void setPresentationTime(int64_t presentationTimeInNanosecond) noexcept = 0;
 
     virtual bool canCreateFence() noexcept { return false; }
@@ -95,6 +100,14 @@ public:
     // (e.g. HardwareBuffer => EGLImage). It makes sense for the default implementation to do nothing.
     virtual AcquiredImage transformAcquiredImage(AcquiredImage source) noexcept { return source; }
 
+    // called on the driver thread before an acquired image is bound, to make the GPU wait until
+    // the image's native fence is signaled. This takes ownership of the fence.
+    virtual void waitAcquiredImageFence(int fence) noexcept {}
+
+    // called on the application thread to destroy the native fence of an acquired image that
+    // won't be used.
+    virtual void destroyAcquiredImageFence(int fence) noexcept {}
+
     // called to bind the platform-specific externalImage to a texture
     // texture points to a OpenGLDriver::GLTexture
     virtual bool setExternalImage(void* externalImage, void* texture) noexcept {
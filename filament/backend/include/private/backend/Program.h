@@ -32,13 +32,14 @@ namespace backend {
 class Program {
 public:
 
-    static constexpr size_t SHADER_TYPE_COUNT = 2;
+    static constexpr size_t SHADER_TYPE_COUNT = 3;
     static constexpr size_t UNIFORM_BINDING_COUNT = CONFIG_UNIFORM_BINDING_COUNT;
     static constexpr size_t SAMPLER_BINDING_COUNT = CONFIG_SAMPLER_BINDING_COUNT;
 
     enum class Shader : uint8_t {
         VERTEX = 0,
-        FRAGMENT = 1
+        FRAGMENT = 1,
+        COMPUTE = 2     // a compute program has no vertex or fragment shader
     };
 
     struct Sampler {
@@ -61,6 +62,10 @@ public:
     Program& diagnostics(utils::CString const& name, uint8_t variantKey = 0);
     Program& diagnostics(utils::CString&& name, uint8_t variantKey = 0) noexcept;
 
+    // sets a key uniquely identifying this program's sources, used by the backend to look up
+    // compiled programs in the Platform's blob cache. 0 (the default) disables caching.
+    Program& cacheId(uint64_t cacheId) noexcept;
+
     // sets one of the program's shader (e.g. vertex, fragment)
     Program& shader(Shader shader, void const* data, size_t size) noexcept;
 
@@ -86,6 +91,14 @@ public:
         return shader(Shader::FRAGMENT, data, size);
     }
 
+    Program& withComputeShader(void const* data, size_t size) {
+        return shader(Shader::COMPUTE, data, size);
+    }
+
+    bool isCompute() const noexcept {
+        return !mShadersSource[size_t(Shader::COMPUTE)].empty();
+    }
+
     std::array<std::vector<uint8_t>, SHADER_TYPE_COUNT> const& getShadersSource() const noexcept {
         return mShadersSource;
     }
@@ -98,6 +111,8 @@ public:
 
     uint8_t getVariant() const noexcept { return mVariant; }
 
+    uint64_t getCacheId() const noexcept { return mCacheId; }
+
     bool hasSamplers() const noexcept { return mHasSamplers; }
 
 private:
@@ -110,6 +125,7 @@ private:
     SamplerGroupInfo mSamplerGroups = {};
     std::array<std::vector<uint8_t>, SHADER_TYPE_COUNT> mShadersSource;
     utils::CString mName;
+    uint64_t mCacheId = 0;
     bool mHasSamplers = false;
     uint8_t mVariant;
 };
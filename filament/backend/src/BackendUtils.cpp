@@ -335,7 +335,7 @@ namespace utils {
 template<>
 CString to_string<filament::backend::TextureUsage>(filament::backend::TextureUsage usage) noexcept {
     using namespace filament::backend;
-    char string[7] = {'-', '-', '-', '-', '-', '-', 0};
+    char string[8] = {'-', '-', '-', '-', '-', '-', '-', 0};
     if (any(usage & TextureUsage::UPLOADABLE)) {
         string[0]='U';
     }
@@ -354,7 +354,10 @@ CString to_string<filament::backend::TextureUsage>(filament::backend::TextureUsa
     if (any(usage & TextureUsage::SUBPASS_INPUT)) {
         string[5]='f';
     }
-    return CString(string, 6);
+    if (any(usage & TextureUsage::SPARSE)) {
+        string[6]='p';
+    }
+    return CString(string, 7);
 }
 
 template<>
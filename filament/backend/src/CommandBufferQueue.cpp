@@ -46,10 +46,10 @@ void CommandBufferQueue::requestExit() {
 }
 
 bool CommandBufferQueue::isExitRequested() const {
-    std::unique_lock<utils::Mutex> lock(mLock);
-    ASSERT_PRECONDITION( mExitRequested == 0 || mExitRequested == EXIT_REQUESTED,
-            "mExitRequested is corrupted (value = 0x%08x)!", mExitRequested);
-    return (bool)mExitRequested;
+    const uint32_t exitRequested = mExitRequested.load(std::memory_order_relaxed);
+    ASSERT_PRECONDITION( exitRequested == 0 || exitRequested == EXIT_REQUESTED,
+            "mExitRequested is corrupted (value = 0x%08x)!", exitRequested);
+    return (bool)exitRequested;
 }
 
 
@@ -83,19 +83,21 @@ void CommandBufferQueue::flush() noexcept {
     assert_invariant(used <= mFreeSpace);
 
     // wait until there is enough space in the buffer
-    mFreeSpace -= used;
+    const size_t freeSpace = mFreeSpace.fetch_sub(used) - used;
     const size_t requiredSize = mRequiredSize;
 
-#ifndef NDEBUG
-    size_t totalUsed = circularBuffer.size() - mFreeSpace;
+    size_t totalUsed = circularBuffer.size() - freeSpace;
     mHighWatermark = std::max(mHighWatermark, totalUsed);
+    mFlushedSize += used;
+
+#ifndef NDEBUG
     if (UTILS_UNLIKELY(totalUsed > requiredSize)) {
         slog.d << "CommandStream used too much space: " << totalUsed
             << ", out of " << requiredSize << " (will block)" << io::endl;
     }
 #endif
 
-    if (UTILS_LIKELY(mFreeSpace >= requiredSize)) {
+    if (UTILS_LIKELY(freeSpace >= requiredSize)) {
         // ideally (and usually) we don't have to wait, this is the common case, so special case
         // the unlock-before-notify, optimization.
         lock.unlock();
@@ -104,9 +106,13 @@ void CommandBufferQueue::flush() noexcept {
         // unfortunately, there is not enough space left, we'll have to wait.
         mCondition.notify_one(); // too bad there isn't a notify-and-wait
         SYSTRACE_NAME("waiting: CircularBuffer::flush()");
+        // This must be visible before we check mFreeSpace (both are sequentially consistent),
+        // so that releaseBuffer() either sees that we're waiting, or we see the space it returned.
+        mProducerWaiting.store(true);
         mCondition.wait(lock, [this, requiredSize]() -> bool {
-            return mFreeSpace >= requiredSize;
+            return mFreeSpace.load() >= requiredSize;
         });
+        mProducerWaiting.store(false, std::memory_order_relaxed);
     }
 }
 
@@ -119,17 +125,22 @@ std::vector<CommandBufferQueue::Slice> CommandBufferQueue::waitForCommands() con
         mCondition.wait(lock);
     }
 
-    ASSERT_PRECONDITION( mExitRequested == 0 || mExitRequested == EXIT_REQUESTED,
-            "mExitRequested is corrupted (value = 0x%08x)!", mExitRequested);
+    const uint32_t exitRequested = mExitRequested.load(std::memory_order_relaxed);
+    ASSERT_PRECONDITION( exitRequested == 0 || exitRequested == EXIT_REQUESTED,
+            "mExitRequested is corrupted (value = 0x%08x)!", exitRequested);
 
     return std::move(mCommandBuffersToExecute);
 }
 
 void CommandBufferQueue::releaseBuffer(CommandBufferQueue::Slice const& buffer) {
-    std::unique_lock<utils::Mutex> lock(mLock);
-    mFreeSpace += uintptr_t(buffer.end) - uintptr_t(buffer.begin);
-    lock.unlock();
-    mCondition.notify_one();
+    mFreeSpace.fetch_add(uintptr_t(buffer.end) - uintptr_t(buffer.begin));
+    if (UTILS_UNLIKELY(mProducerWaiting.load())) {
+        // Taking the lock guarantees that the producer is either before its predicate check,
+        // in which case it'll see the new free space, or waiting on the condition.
+        std::unique_lock<utils::Mutex> lock(mLock);
+        lock.unlock();
+        mCondition.notify_one();
+    }
 }
 
 } // namespace backend
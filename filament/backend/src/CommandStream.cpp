@@ -111,6 +111,20 @@ void CommandStream::queueCommand(std::function<void()> command) {
     new(allocateCommand(CustomCommand::align(sizeof(CustomCommand)))) CustomCommand(std::move(command));
 }
 
+void CommandStream::setCommandStreamWriter(CommandStreamWriter* writer) {
+    Driver* const driver = mDriver;
+    Dispatcher& dispatcher = driver->getDispatcher();
+    // the driver must have the writer before the first captured command executes, and keep it
+    // until the last one did.
+    if (writer) {
+        queueCommand([driver, writer]() { driver->setCommandStreamWriter(writer); });
+        mDispatcher = dispatcher.capture;
+    } else {
+        mDispatcher = &dispatcher;
+        queueCommand([driver]() { driver->setCommandStreamWriter(nullptr); });
+    }
+}
+
 template<typename... ARGS>
 template<void (Driver::*METHOD)(ARGS...)>
 template<std::size_t... I>
@@ -609,6 +623,8 @@ io::ostream& operator<<(io::ostream& out, RenderPassParams const& params) {
 io::ostream& operator<<(io::ostream& out, BufferObjectBinding wrap) {
     switch (wrap) {
         CASE(BufferObjectBinding, VERTEX)
+        CASE(BufferObjectBinding, SHADER_STORAGE)
+        CASE(BufferObjectBinding, DRAW_INDIRECT)
     }
     return out;
 }
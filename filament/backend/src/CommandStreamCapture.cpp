@@ -0,0 +1,553 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "private/backend/CommandStreamCapture.h"
+
+#include "private/backend/Driver.h"
+
+#include <utils/Log.h>
+#include <utils/Systrace.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <stdlib.h>
+#include <string.h>
+
+using namespace utils;
+
+namespace filament {
+namespace backend {
+
+// bytes of commands recorded before they're handed to the driver, when replaying
+static constexpr size_t REPLAY_FLUSH_SIZE = 1u * 1024u * 1024u;
+
+// ------------------------------------------------------------------------------------------------
+// CommandStreamWriter
+// ------------------------------------------------------------------------------------------------
+
+CommandStreamWriter::CommandStreamWriter() noexcept
+        : mInMemory(true) {
+    const uint32_t header[] = { MAGIC, VERSION, uint32_t(CommandId::COUNT) };
+    uint8_t const* const p = reinterpret_cast<uint8_t const*>(header);
+    mData.assign(p, p + sizeof(header));
+}
+
+CommandStreamWriter::CommandStreamWriter(const char* path) noexcept
+        : mFile(fopen(path, "wb")) {
+    if (!mFile) {
+        slog.e << "Couldn't create command stream capture " << path << io::endl;
+        return;
+    }
+    const uint32_t header[] = { MAGIC, VERSION, uint32_t(CommandId::COUNT) };
+    fwrite(header, sizeof(header), 1, mFile);
+}
+
+CommandStreamWriter::~CommandStreamWriter() noexcept {
+    if (mFile) {
+        fclose(mFile);
+    }
+}
+
+void CommandStreamWriter::writeValue(void*) noexcept {
+    // native objects can't be captured
+}
+
+void CommandStreamWriter::writeValue(const char* string) noexcept {
+    writeString(string, string ? strlen(string) : 0);
+}
+
+void CommandStreamWriter::writeValue(FrameScheduledCallback) noexcept {
+    // the callbacks belong to the application, they're not replayed
+}
+
+void CommandStreamWriter::writeValue(FrameCompletedCallback) noexcept {
+}
+
+void CommandStreamWriter::writeValue(BufferDescriptor const& buffer) noexcept {
+    writeValue(uint64_t(buffer.size));
+    if (mWritePayloads) {
+        writeBytes(buffer.buffer, buffer.size);
+    }
+}
+
+void CommandStreamWriter::writeValue(PixelBufferDescriptor const& buffer) noexcept {
+    writeValue(static_cast<BufferDescriptor const&>(buffer));
+    writeValue(buffer.left);
+    writeValue(buffer.top);
+    if (buffer.type == PixelDataType::COMPRESSED) {
+        writeValue(buffer.imageSize);
+        writeValue(uint16_t(buffer.compressedFormat));
+    } else {
+        writeValue(buffer.stride);
+        writeValue(uint16_t(buffer.format));
+    }
+    writeValue(uint8_t(buffer.type));
+    writeValue(uint8_t(buffer.alignment));
+}
+
+void CommandStreamWriter::writeValue(Program const& program) noexcept {
+    writeString(program.getName().c_str_safe(), program.getName().size());
+    writeValue(program.getVariant());
+    writeValue(program.getCacheId());
+    for (auto const& source : program.getShadersSource()) {
+        writeValue(uint64_t(source.size()));
+        writeBytes(source.data(), source.size());
+    }
+    for (auto const& name : program.getUniformBlockInfo()) {
+        writeString(name.c_str_safe(), name.size());
+    }
+    writeValue(program.hasSamplers());
+    if (program.hasSamplers()) {
+        for (auto const& samplers : program.getSamplerGroupInfo()) {
+            writeValue(uint32_t(samplers.size()));
+            for (auto const& sampler : samplers) {
+                writeString(sampler.name.c_str_safe(), sampler.name.size());
+                writeValue(sampler.binding);
+                writeValue(sampler.strict);
+            }
+        }
+    }
+}
+
+void CommandStreamWriter::writeValue(SamplerGroup const& samplerGroup) noexcept {
+    writeValue(uint32_t(samplerGroup.getSize()));
+    for (size_t i = 0, c = samplerGroup.getSize(); i < c; i++) {
+        SamplerGroup::Sampler const& sampler = samplerGroup.getSamplers()[i];
+        writeValue(sampler.t);
+        writeValue(sampler.s);
+    }
+}
+
+void CommandStreamWriter::writeValue(TargetBufferInfo const& info) noexcept {
+    writeValue(info.handle);
+    writeValue(info.level);
+    writeValue(info.layer);
+}
+
+void CommandStreamWriter::writeValue(MRT const& mrt) noexcept {
+    for (size_t i = 0; i < MRT::TARGET_COUNT; i++) {
+        writeValue(mrt[i]);
+    }
+}
+
+void CommandStreamWriter::writeValue(PipelineState const& state) noexcept {
+    writeValue(state.program);
+    writeValue(state.rasterState);
+    writeValue(state.polygonOffset);
+    writeValue(state.scissor);
+}
+
+void CommandStreamWriter::writeValue(FaceOffsets const& offsets) noexcept {
+    writeValue(offsets.offsets);
+}
+
+void CommandStreamWriter::writeString(const char* string, size_t length) noexcept {
+    writeValue(uint32_t(length));
+    writeBytes(string, length);
+}
+
+void CommandStreamWriter::writeBytes(void const* data, size_t size) noexcept {
+    uint8_t const* const p = static_cast<uint8_t const*>(data);
+    mBuffer.insert(mBuffer.end(), p, p + size);
+}
+
+void CommandStreamWriter::commit(CommandId id) noexcept {
+    if (UTILS_UNLIKELY(!isOpen())) {
+        return;
+    }
+    SYSTRACE_CALL();
+    const uint16_t command = uint16_t(id);
+    const uint32_t size = uint32_t(mBuffer.size());
+    if (mInMemory) {
+        uint8_t const* const c = reinterpret_cast<uint8_t const*>(&command);
+        uint8_t const* const s = reinterpret_cast<uint8_t const*>(&size);
+        mData.insert(mData.end(), c, c + sizeof(command));
+        mData.insert(mData.end(), s, s + sizeof(size));
+        mData.insert(mData.end(), mBuffer.begin(), mBuffer.end());
+    } else {
+        fwrite(&command, sizeof(command), 1, mFile);
+        fwrite(&size, sizeof(size), 1, mFile);
+        fwrite(mBuffer.data(), 1, mBuffer.size(), mFile);
+    }
+    mCommandCount++;
+}
+
+// ------------------------------------------------------------------------------------------------
+// CommandStreamReplayer
+// ------------------------------------------------------------------------------------------------
+
+// true for the commands destroying the handle given as their first argument
+static constexpr bool isDestroyCommand(const char* name) noexcept {
+    const char* prefix = "destroy";
+    while (*prefix && *name == *prefix) {
+        name++;
+        prefix++;
+    }
+    return !*prefix;
+}
+
+CommandStreamReplayer::CommandStreamReplayer(Driver& driver, void* nativeWindow,
+        uint32_t headlessWidth, uint32_t headlessHeight) noexcept
+        : mDriver(driver),
+          mNativeWindow(nativeWindow),
+          mHeadlessWidth(headlessWidth),
+          mHeadlessHeight(headlessHeight),
+          mQueue(REPLAY_FLUSH_SIZE * 2, REPLAY_FLUSH_SIZE * 6),
+          mStream(driver, mQueue.getCircularBuffer()) {
+}
+
+CommandStreamReplayer::~CommandStreamReplayer() noexcept = default;
+
+bool CommandStreamReplayer::load(const char* path) noexcept {
+    FILE* const file = fopen(path, "rb");
+    if (!file) {
+        slog.e << "Couldn't open command stream capture " << path << io::endl;
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    mData.resize(size_t(ftell(file)));
+    fseek(file, 0, SEEK_SET);
+    const size_t size = fread(mData.data(), 1, mData.size(), file);
+    fclose(file);
+    if (size != mData.size()) {
+        slog.e << "Couldn't read command stream capture " << path << io::endl;
+        return false;
+    }
+    return parse(path);
+}
+
+bool CommandStreamReplayer::load(void const* data, size_t size) noexcept {
+    uint8_t const* const p = static_cast<uint8_t const*>(data);
+    mData.assign(p, p + size);
+    return parse("in-memory capture");
+}
+
+std::vector<CommandId> CommandStreamReplayer::getCommands(size_t frame) const noexcept {
+    assert_invariant(frame < mFrames.size());
+    std::vector<CommandId> commands;
+    uint8_t const* const end = mData.data() + mFrames[frame].end;
+    uint8_t const* p = mData.data() + mFrames[frame].begin;
+    while (p < end) {
+        uint16_t command;
+        uint32_t commandSize;
+        memcpy(&command, p, sizeof(command));
+        memcpy(&commandSize, p + sizeof(command), sizeof(commandSize));
+        commands.push_back(CommandId(command));
+        p += sizeof(command) + sizeof(commandSize) + commandSize;
+    }
+    return commands;
+}
+
+bool CommandStreamReplayer::parse(const char* name) noexcept {
+    uint32_t header[3] = {};
+    if (mData.size() < sizeof(header)) {
+        slog.e << "Couldn't read command stream capture " << name << io::endl;
+        return false;
+    }
+    memcpy(header, mData.data(), sizeof(header));
+    if (header[0] != CommandStreamWriter::MAGIC ||
+            header[1] != CommandStreamWriter::VERSION ||
+            header[2] != uint32_t(CommandId::COUNT)) {
+        slog.e << name << " was captured by an incompatible version of the backend" << io::endl;
+        return false;
+    }
+
+    // find where each frame starts
+    mFrames.clear();
+    size_t offset = sizeof(header);
+    while (offset + sizeof(uint16_t) + sizeof(uint32_t) <= mData.size()) {
+        uint16_t command;
+        uint32_t commandSize;
+        memcpy(&command, mData.data() + offset, sizeof(command));
+        memcpy(&commandSize, mData.data() + offset + sizeof(command), sizeof(commandSize));
+        const size_t next = offset + sizeof(command) + sizeof(commandSize) + commandSize;
+        if (next > mData.size()) {
+            break;
+        }
+        if (command == uint16_t(CommandId::endFrame)) {
+            mFrames.push_back({ mFrames.empty() ? sizeof(header) : mFrames.back().end, next });
+        }
+        offset = next;
+    }
+    if (offset != mData.size()) {
+        // the application probably didn't terminate
+        slog.w << name << " is truncated, its last command is ignored" << io::endl;
+    }
+    return true;
+}
+
+void CommandStreamReplayer::replay(size_t frame) noexcept {
+    assert_invariant(frame < mFrames.size());
+    SYSTRACE_CALL();
+    uint8_t const* const end = mData.data() + mFrames[frame].end;
+    uint8_t const* p = mData.data() + mFrames[frame].begin;
+    while (p < end) {
+        uint16_t command;
+        uint32_t commandSize;
+        memcpy(&command, p, sizeof(command));
+        memcpy(&commandSize, p + sizeof(command), sizeof(commandSize));
+        mCurrent = p + sizeof(command) + sizeof(commandSize);
+        mEnd = mCurrent + commandSize;
+        replayCommand(CommandId(command));
+        p = mEnd;
+        if (mQueue.getCircularBuffer().getUsed() >= REPLAY_FLUSH_SIZE) {
+            execute();
+        }
+    }
+    execute();
+}
+
+void CommandStreamReplayer::finish() noexcept {
+    mStream.finish();
+    execute();
+}
+
+void CommandStreamReplayer::replayCommand(CommandId id) noexcept {
+    if (id == CommandId::createSwapChain) {
+        // the capture doesn't have the native window
+        const HandleBase::HandleId handle = readHandleId();
+        auto args = readArguments(&CommandStream::createSwapChain);
+        const uint64_t flags = std::get<1>(args);
+        mHandles[handle] = (mNativeWindow ?
+                mStream.createSwapChain(mNativeWindow, flags) :
+                mStream.createSwapChainHeadless(mHeadlessWidth, mHeadlessHeight, flags)).getId();
+        return;
+    }
+    switch (id) {
+#define DECL_DRIVER_API_SYNCHRONOUS(RetType, methodName, paramsDecl, params)
+#define DECL_DRIVER_API(methodName, paramsDecl, params)                                         \
+        case CommandId::methodName: {                                                           \
+            constexpr bool destroy = isDestroyCommand(#methodName);                             \
+            const HandleBase::HandleId handle = destroy ? peekHandleId() : HandleBase::nullid;  \
+            auto args = readArguments(&CommandStream::methodName);                              \
+            std::apply([this](auto&& ... arg) {                                                 \
+                mStream.methodName(std::move(arg)...);                                          \
+            }, std::move(args));                                                                \
+            if (destroy) {                                                                      \
+                mHandles.erase(handle);                                                         \
+            }                                                                                   \
+            break;                                                                              \
+        }
+#define DECL_DRIVER_API_RETURN(RetType, methodName, paramsDecl, params)                         \
+        case CommandId::methodName: {                                                           \
+            const HandleBase::HandleId handle = readHandleId();                                 \
+            auto args = readArguments(&CommandStream::methodName);                              \
+            mHandles[handle] = std::apply([this](auto&& ... arg) {                              \
+                return mStream.methodName(std::move(arg)...);                                   \
+            }, std::move(args)).getId();                                                        \
+            break;                                                                              \
+        }
+#include "private/backend/DriverAPI.inc"
+        case CommandId::COUNT:
+            break;
+    }
+    assert_invariant(mCurrent == mEnd);
+}
+
+void CommandStreamReplayer::execute() noexcept {
+    CircularBuffer const& circularBuffer = mQueue.getCircularBuffer();
+    if (circularBuffer.empty()) {
+        return;
+    }
+    mQueue.flush();
+    for (auto& item : mQueue.waitForCommands()) {
+        if (UTILS_LIKELY(item.begin)) {
+            mStream.execute(item.begin);
+            mQueue.releaseBuffer(item);
+        }
+    }
+    // calls the callbacks of the buffers the driver is done with, which frees them
+    mDriver.purge();
+}
+
+void CommandStreamReplayer::readValue(void*& pointer) noexcept {
+    pointer = nullptr;
+}
+
+void CommandStreamReplayer::readValue(const char*& string) noexcept {
+    uint32_t length;
+    readValue(length);
+    // the string must live until the command executes
+    char* const p = static_cast<char*>(mStream.allocate(length + 1, 1));
+    readBytes(p, length);
+    p[length] = 0;
+    string = p;
+}
+
+void CommandStreamReplayer::readValue(FrameScheduledCallback& callback) noexcept {
+    callback = nullptr;
+}
+
+void CommandStreamReplayer::readValue(FrameCompletedCallback& callback) noexcept {
+    callback = nullptr;
+}
+
+void CommandStreamReplayer::readValue(BufferDescriptor& buffer) noexcept {
+    uint64_t size;
+    readValue(size);
+    buffer = BufferDescriptor(readPayload(size), size_t(size),
+            [](void* buffer, size_t, void*) { free(buffer); });
+}
+
+void CommandStreamReplayer::readValue(PixelBufferDescriptor& buffer) noexcept {
+    BufferDescriptor data;
+    readValue(data);
+    uint32_t left, top, strideOrImageSize;
+    uint16_t format;
+    uint8_t type, alignment;
+    readValue(left);
+    readValue(top);
+    readValue(strideOrImageSize);
+    readValue(format);
+    readValue(type);
+    readValue(alignment);
+    if (PixelDataType(type) == PixelDataType::COMPRESSED) {
+        buffer = PixelBufferDescriptor(data.buffer, data.size,
+                CompressedPixelDataType(format), strideOrImageSize,
+                data.getCallback(), data.getUser());
+        buffer.left = left;
+        buffer.top = top;
+    } else {
+        buffer = PixelBufferDescriptor(data.buffer, data.size,
+                PixelDataFormat(format), PixelDataType(type), alignment,
+                left, top, strideOrImageSize, data.getCallback(), data.getUser());
+    }
+    // buffer owns the payload now
+    data.setCallback(nullptr);
+}
+
+void CommandStreamReplayer::readValue(Program& program) noexcept {
+    utils::CString name = readString();
+    uint8_t variant;
+    uint64_t cacheId;
+    readValue(variant);
+    readValue(cacheId);
+    program.diagnostics(std::move(name), variant);
+    program.cacheId(cacheId);
+    for (size_t i = 0; i < Program::SHADER_TYPE_COUNT; i++) {
+        uint64_t size;
+        readValue(size);
+        if (size) {
+            std::vector<uint8_t> source(size);
+            readBytes(source.data(), source.size());
+            program.shader(Program::Shader(i), source.data(), source.size());
+        }
+    }
+    for (size_t i = 0; i < Program::UNIFORM_BINDING_COUNT; i++) {
+        program.setUniformBlock(i, readString());
+    }
+    bool hasSamplers;
+    readValue(hasSamplers);
+    if (hasSamplers) {
+        std::vector<Program::Sampler> samplers;
+        for (size_t i = 0; i < Program::SAMPLER_BINDING_COUNT; i++) {
+            uint32_t count;
+            readValue(count);
+            samplers.resize(count);
+            for (Program::Sampler& sampler : samplers) {
+                sampler.name = readString();
+                readValue(sampler.binding);
+                readValue(sampler.strict);
+            }
+            program.setSamplerGroup(i, samplers.data(), samplers.size());
+        }
+    }
+}
+
+void CommandStreamReplayer::readValue(SamplerGroup& samplerGroup) noexcept {
+    uint32_t count;
+    readValue(count);
+    samplerGroup = SamplerGroup(count);
+    for (size_t i = 0; i < count; i++) {
+        SamplerGroup::Sampler sampler;
+        readValue(sampler.t);
+        readValue(sampler.s);
+        samplerGroup.setSampler(i, sampler);
+    }
+}
+
+void CommandStreamReplayer::readValue(TargetBufferInfo& info) noexcept {
+    readValue(info.handle);
+    readValue(info.level);
+    readValue(info.layer);
+}
+
+void CommandStreamReplayer::readValue(MRT& mrt) noexcept {
+    TargetBufferInfo infos[MRT::TARGET_COUNT];
+    for (TargetBufferInfo& info : infos) {
+        readValue(info);
+    }
+    mrt = MRT(infos[0], infos[1], infos[2], infos[3]);
+}
+
+void CommandStreamReplayer::readValue(PipelineState& state) noexcept {
+    readValue(state.program);
+    readValue(state.rasterState);
+    readValue(state.polygonOffset);
+    readValue(state.scissor);
+}
+
+void CommandStreamReplayer::readValue(FaceOffsets& offsets) noexcept {
+    readValue(offsets.offsets);
+}
+
+HandleBase::HandleId CommandStreamReplayer::readHandleId() noexcept {
+    HandleBase::HandleId id;
+    readValue(id);
+    return id;
+}
+
+HandleBase::HandleId CommandStreamReplayer::peekHandleId() const noexcept {
+    HandleBase::HandleId id = HandleBase::nullid;
+    if (size_t(mEnd - mCurrent) >= sizeof(id)) {
+        memcpy(&id, mCurrent, sizeof(id));
+    }
+    return id;
+}
+
+HandleBase::HandleId CommandStreamReplayer::remap(HandleBase::HandleId id) const noexcept {
+    // handles created by synchronous commands, or before the capture started, are unknown
+    auto pos = mHandles.find(id);
+    return pos != mHandles.end() ? pos->second : HandleBase::nullid;
+}
+
+utils::CString CommandStreamReplayer::readString() noexcept {
+    uint32_t length;
+    readValue(length);
+    utils::CString string(reinterpret_cast<const char*>(mCurrent), length);
+    readBytes(nullptr, length);
+    return string;
+}
+
+void CommandStreamReplayer::readBytes(void* data, size_t size) noexcept {
+    // a corrupted capture reads zeros instead of running past the command
+    const size_t available = std::min(size, size_t(mEnd - mCurrent));
+    if (data) {
+        memcpy(data, mCurrent, available);
+        memset(static_cast<uint8_t*>(data) + available, 0, size - available);
+    }
+    mCurrent += available;
+}
+
+void* CommandStreamReplayer::readPayload(size_t size) noexcept {
+    void* const payload = malloc(size);
+    readBytes(payload, size);
+    return payload;
+}
+
+} // namespace backend
+} // namespace filament
@@ -19,6 +19,7 @@
 
 #include "private/backend/Driver.h"
 #include "private/backend/CommandStream.h"
+#include "private/backend/CommandStreamCapture.h"
 
 #include <utils/compiler.h>
 #include <utils/Systrace.h>
@@ -55,8 +56,16 @@ public:
 #define DECL_DRIVER_API(methodName, paramsDecl, params)                 methodName##_ = &ConcreteDispatcher::methodName;
 #define DECL_DRIVER_API_RETURN(RetType, methodName, paramsDecl, params) methodName##_ = &ConcreteDispatcher::methodName;
 #include "private/backend/DriverAPI.inc"
+
+#define DECL_DRIVER_API_SYNCHRONOUS(RetType, methodName, paramsDecl, params)
+#define DECL_DRIVER_API(methodName, paramsDecl, params)                 mCapture.methodName##_ = &ConcreteDispatcher::methodName##Capture;
+#define DECL_DRIVER_API_RETURN(RetType, methodName, paramsDecl, params) mCapture.methodName##_ = &ConcreteDispatcher::methodName##Capture;
+#include "private/backend/DriverAPI.inc"
+        capture = &mCapture;
     }
 private:
+    Dispatcher mCapture;
+
 #define DECL_DRIVER_API_SYNCHRONOUS(RetType, methodName, paramsDecl, params)
 #define DECL_DRIVER_API(methodName, paramsDecl, params)                                         \
     static void methodName(Driver& driver, CommandBase* base, intptr_t* next) {                 \
@@ -73,6 +82,24 @@ private:
         Cmd::execute(&ConcreteDriver::methodName##R, concreteDriver, base, next);               \
      }
 #include "private/backend/DriverAPI.inc"
+
+    // the capture dispatch table writes each command before executing it
+#define DECL_DRIVER_API_SYNCHRONOUS(RetType, methodName, paramsDecl, params)
+#define DECL_DRIVER_API(methodName, paramsDecl, params)                                         \
+    static void methodName##Capture(Driver& driver, CommandBase* base, intptr_t* next) {        \
+        using Cmd = COMMAND_TYPE(methodName);                                                   \
+        static_cast<ConcreteDriver&>(driver).getCommandStreamWriter()->write(                   \
+                CommandId::methodName, Cmd::getArguments(base));                                \
+        methodName(driver, base, next);                                                         \
+     }
+#define DECL_DRIVER_API_RETURN(RetType, methodName, paramsDecl, params)                         \
+    static void methodName##Capture(Driver& driver, CommandBase* base, intptr_t* next) {        \
+        using Cmd = COMMAND_TYPE(methodName##R);                                                \
+        static_cast<ConcreteDriver&>(driver).getCommandStreamWriter()->write(                   \
+                CommandId::methodName, Cmd::getArguments(base));                                \
+        methodName(driver, base, next);                                                         \
+     }
+#include "private/backend/DriverAPI.inc"
 };
 
 } // namespace backend
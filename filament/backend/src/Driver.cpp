@@ -28,13 +28,66 @@
 #include <backend/BufferDescriptor.h>
 #include <backend/PixelBufferDescriptor.h>
 
+#include "private/backend/BackendUtils.h"
+
 #include <utils/Systrace.h>
 
+#include <algorithm>
+
 using namespace utils;
 
 namespace filament {
 namespace backend {
 
+MemoryStats MemoryTracker::getStats() const noexcept {
+    auto bytes = [this](Category category) {
+        return mBytes[size_t(category)].load(std::memory_order_relaxed);
+    };
+    return {
+        .textures = bytes(Category::TEXTURE),
+        .renderTargets = bytes(Category::RENDER_TARGET),
+        .buffers = bytes(Category::BUFFER),
+        .staging = bytes(Category::STAGING),
+    };
+}
+
+size_t MemoryTracker::getSize(HwTexture const& texture) noexcept {
+    const size_t blockWidth = getBlockWidth(texture.format);
+    const size_t blockHeight = getBlockHeight(texture.format);
+    const size_t blockSize = getFormatSize(texture.format);
+    const size_t layers = texture.target == SamplerType::SAMPLER_CUBEMAP ? 6 :
+            texture.target == SamplerType::SAMPLER_2D_ARRAY ? texture.depth : 1;
+    size_t size = 0;
+    for (size_t level = 0; level < std::max(uint8_t(1), uint8_t(texture.levels)); level++) {
+        const size_t width = std::max(1u, texture.width >> level);
+        const size_t height = std::max(1u, texture.height >> level);
+        const size_t depth = texture.target == SamplerType::SAMPLER_3D ?
+                std::max(1u, texture.depth >> level) : 1;
+        if (blockWidth && blockHeight) {
+            size += ((width + blockWidth - 1) / blockWidth) *
+                    ((height + blockHeight - 1) / blockHeight) * depth * blockSize;
+        } else {
+            size += width * height * depth * blockSize;
+        }
+    }
+    return size * layers * std::max(uint8_t(1), uint8_t(texture.samples));
+}
+
+size_t MemoryTracker::getSize(HwVertexBuffer const& vertexBuffer) noexcept {
+    size_t size = 0;
+    for (size_t i = 0; i < vertexBuffer.bufferCount; i++) {
+        size_t bufferSize = 0;
+        for (auto const& attribute : vertexBuffer.attributes) {
+            if (attribute.buffer == i) {
+                bufferSize = std::max(bufferSize,
+                        size_t(attribute.offset) + size_t(vertexBuffer.vertexCount) * attribute.stride);
+            }
+        }
+        size += bufferSize;
+    }
+    return size;
+}
+
 DriverBase::DriverBase(Dispatcher* dispatcher) noexcept
         : mDispatcher(dispatcher) {
 }
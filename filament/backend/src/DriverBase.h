@@ -29,6 +29,7 @@
 #include "private/backend/SamplerGroup.h"
 
 #include <array>
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <utility>
@@ -165,6 +166,54 @@ struct HwStream : public HwBase {
 struct HwTimerQuery : public HwBase {
 };
 
+/*
+ * Counts the GPU memory allocated by a driver, see Driver::getMemoryStats().
+ * The counters are updated on the driver thread and can be read from any thread.
+ */
+
+class MemoryTracker {
+public:
+    enum class Category : uint8_t {
+        TEXTURE,
+        RENDER_TARGET,
+        BUFFER,
+        STAGING
+    };
+
+    void allocate(Category category, size_t size) noexcept {
+        mBytes[size_t(category)].fetch_add(size, std::memory_order_relaxed);
+    }
+
+    void free(Category category, size_t size) noexcept {
+        mBytes[size_t(category)].fetch_sub(size, std::memory_order_relaxed);
+    }
+
+    void allocate(HwTexture const& texture) noexcept {
+        allocate(getCategory(texture), getSize(texture));
+    }
+
+    void free(HwTexture const& texture) noexcept {
+        free(getCategory(texture), getSize(texture));
+    }
+
+    MemoryStats getStats() const noexcept;
+
+    // size of a texture with all its levels, layers and samples
+    static size_t getSize(HwTexture const& texture) noexcept;
+
+    // size of all the buffers of a vertex buffer
+    static size_t getSize(HwVertexBuffer const& vertexBuffer) noexcept;
+
+    static Category getCategory(HwTexture const& texture) noexcept {
+        return any(texture.usage & (TextureUsage::COLOR_ATTACHMENT |
+                TextureUsage::DEPTH_ATTACHMENT | TextureUsage::STENCIL_ATTACHMENT)) ?
+                Category::RENDER_TARGET : Category::TEXTURE;
+    }
+
+private:
+    std::atomic<size_t> mBytes[4] = {};
+};
+
 /*
  * Base class of all Driver implementations
  */
@@ -179,12 +228,22 @@ public:
 
     Dispatcher& getDispatcher() noexcept final { return *mDispatcher; }
 
+    void setCommandStreamWriter(CommandStreamWriter* writer) noexcept final {
+        mCommandStreamWriter = writer;
+    }
+
+    CommandStreamWriter* getCommandStreamWriter() const noexcept { return mCommandStreamWriter; }
+
+    MemoryStats getMemoryStats() const noexcept final { return mMemoryTracker.getStats(); }
+
     // --------------------------------------------------------------------------------------------
     // Privates
     // --------------------------------------------------------------------------------------------
 
 protected:
     Dispatcher* mDispatcher;
+    CommandStreamWriter* mCommandStreamWriter = nullptr;
+    MemoryTracker mMemoryTracker;
 
     inline void scheduleDestroy(BufferDescriptor&& buffer) noexcept {
         if (buffer.hasCallback()) {
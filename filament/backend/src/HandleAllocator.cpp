@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HandleAllocator.h"
+
+#include <utils/Log.h>
+#include <utils/Panic.h>
+
+namespace filament {
+namespace backend {
+
+using namespace utils;
+
+// The heap area is split in 1/16, 5/16 and 10/16 between the three pools, which matches the
+// typical distribution of handle sizes (many small ones, fewer large ones).
+
+template <size_t P0, size_t P1, size_t P2>
+HandleAllocator<P0, P1, P2>::Allocator::Allocator(const utils::HeapArea& area)
+        : mPool0(area.begin(),
+                 pointermath::add(area.begin(), (1 * area.getSize()) / 16)),
+          mPool1(pointermath::add(area.begin(), (1 * area.getSize()) / 16),
+                 pointermath::add(area.begin(), (6 * area.getSize()) / 16)),
+          mPool2(pointermath::add(area.begin(), (6 * area.getSize()) / 16),
+                 area.end()) {
+    // slots are rounded up to the alignment of their pool
+    mCapacities[0] = ((1 * area.getSize()) / 16) / ((P0 + 15u) & ~size_t(15u));
+    mCapacities[1] = ((5 * area.getSize()) / 16) / ((P1 + 31u) & ~size_t(31u));
+    mCapacities[2] = ((10 * area.getSize()) / 16) / ((P2 + 31u) & ~size_t(31u));
+}
+
+template <size_t P0, size_t P1, size_t P2>
+void* HandleAllocator<P0, P1, P2>::Allocator::alloc(size_t size, size_t, size_t extra) noexcept {
+    assert_invariant(size <= mPool2.getSize());
+    void* p = nullptr;
+    size_t pool = 0;
+    if (size <= mPool0.getSize()) {
+        p = mPool0.alloc(size, 16, extra);
+    } else if (size <= mPool1.getSize()) {
+        p = mPool1.alloc(size, 32, extra);
+        pool = 1;
+    } else if (size <= mPool2.getSize()) {
+        p = mPool2.alloc(size, 32, extra);
+        pool = 2;
+    }
+    if (p) {
+        mCounters[pool].increment();
+        mAllocationCount.store(mAllocationCount.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+    }
+    return p;
+}
+
+template <size_t P0, size_t P1, size_t P2>
+void HandleAllocator<P0, P1, P2>::Allocator::free(void* p, size_t size) noexcept {
+    if (size <= mPool0.getSize()) { mPool0.free(p); mCounters[0].decrement(); return; }
+    if (size <= mPool1.getSize()) { mPool1.free(p); mCounters[1].decrement(); return; }
+    if (size <= mPool2.getSize()) { mPool2.free(p); mCounters[2].decrement(); return; }
+}
+
+// ------------------------------------------------------------------------------------------------
+
+template <size_t P0, size_t P1, size_t P2>
+HandleAllocator<P0, P1, P2>::HandleAllocator(const char* name, size_t size) noexcept
+        : mHandleArena(name, size) {
+#ifndef NDEBUG
+    assert_invariant((size >> MIN_ALIGNMENT_SHIFT) <= HANDLE_INDEX_MASK);
+    mAges.resize(size >> MIN_ALIGNMENT_SHIFT);
+#endif
+}
+
+// This is "NOINLINE" because it ends-up generating more code than we'd like because of
+// the locking (unfortunately, mHandleArena is accessed from 2 threads)
+template <size_t P0, size_t P1, size_t P2>
+UTILS_NOINLINE
+HandleBase::HandleId HandleAllocator<P0, P1, P2>::allocateHandleSlow(size_t size) noexcept {
+    void* addr = mHandleArena.alloc(size);
+    ASSERT_POSTCONDITION(addr,
+            "Out of memory in the \"%s\" handle arena, size=%u bytes. "
+            "Increase the size of the arena.", mHandleArena.getName(), unsigned(size));
+    char* const base = (char*)mHandleArena.getArea().begin();
+    size_t const offset = (char*)addr - base;
+    HandleBase::HandleId id = HandleBase::HandleId(offset >> MIN_ALIGNMENT_SHIFT);
+#ifndef NDEBUG
+    // the arena's lock orders this read after the write done when the slot was last freed
+    id |= HandleBase::HandleId(mAges[id]) << HANDLE_AGE_SHIFT;
+#endif
+    return id;
+}
+
+template <size_t P0, size_t P1, size_t P2>
+void HandleAllocator<P0, P1, P2>::deallocateHandle(HandleBase::HandleId id,
+        void* p, size_t size) noexcept {
+#ifndef NDEBUG
+    // bump the age of this slot, so that handles still referring to it are detected
+    uint8_t& age = mAges[id & HANDLE_INDEX_MASK];
+    age = (age + 1u) & 0xFu;
+#else
+    (void)id;
+#endif
+    mHandleArena.free(p, size);
+}
+
+template <size_t P0, size_t P1, size_t P2>
+typename HandleAllocator<P0, P1, P2>::Statistics
+HandleAllocator<P0, P1, P2>::getStatistics() const noexcept {
+    Allocator const& allocator = mHandleArena.getAllocator();
+    Statistics stats{};
+    size_t const sizes[3] = { P0, P1, P2 };
+    for (size_t i = 0; i < 3; i++) {
+        stats.pools[i].size = sizes[i];
+        stats.pools[i].capacity = allocator.mCapacities[i];
+        stats.pools[i].count = allocator.mCounters[i].count.load(std::memory_order_relaxed);
+        stats.pools[i].peakCount = allocator.mCounters[i].peak.load(std::memory_order_relaxed);
+    }
+    stats.allocationCount = allocator.mAllocationCount.load(std::memory_order_relaxed);
+    return stats;
+}
+
+template <size_t P0, size_t P1, size_t P2>
+void HandleAllocator<P0, P1, P2>::logStatistics() const noexcept {
+    Statistics const stats = getStatistics();
+    slog.d << "\"" << mHandleArena.getName() << "\" allocations: "
+           << stats.allocationCount << io::endl;
+    for (auto const& pool : stats.pools) {
+        slog.d << "    " << pool.size << " bytes pool: "
+               << pool.count << " in use, "
+               << pool.peakCount << " peak, "
+               << pool.capacity << " capacity" << io::endl;
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// explicit instantiations for the pool sizes used by the backends
+
+// see OpenGLDriver.cpp and VulkanDriver.cpp for the sizes of their handles
+template class HandleAllocator<16, 64, 208>;
+
+template class HandleAllocator<64, 176, 512>;
+
+} // namespace backend
+} // namespace filament
@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DRIVER_HANDLEALLOCATOR_H
+#define TNT_FILAMENT_DRIVER_HANDLEALLOCATOR_H
+
+#include <backend/Handle.h>
+
+#include <utils/Allocator.h>
+#include <utils/compiler.h>
+#include <utils/debug.h>
+#include <utils/Log.h>
+
+#include <atomic>
+#include <exception>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if !defined(NDEBUG) && UTILS_HAS_RTTI
+#   include <typeinfo>
+#endif
+
+namespace filament {
+namespace backend {
+
+/*
+ * A thread-safe handle allocator shared by the backends.
+ *
+ * Handles are allocated from three pools of fixed-size slots (P0 <= P1 <= P2 bytes), carved out
+ * of a single heap area. Each pool keeps its own LIFO free list, so a freed slot is the first
+ * one handed out again while it is still warm in the cache. A HandleId is simply the offset of
+ * its slot in the heap area divided by 16, so handle_cast<> is a shift and an add.
+ *
+ * In debug builds, the upper bits of a HandleId also store the "age" of its slot, which is
+ * bumped every time the slot is freed. handle_cast<> checks it and aborts on use-after-free.
+ */
+template <size_t P0, size_t P1, size_t P2>
+class HandleAllocator {
+public:
+
+    struct Statistics {
+        struct Pool {
+            size_t size;            // size in bytes of a slot
+            size_t capacity;        // number of slots in this pool
+            size_t count;           // number of slots currently in use
+            size_t peakCount;       // highest number of slots in use at the same time
+        };
+        Pool pools[3];
+        size_t allocationCount;     // total number of allocations so far
+    };
+
+    HandleAllocator(const char* name, size_t size) noexcept;
+
+    HandleAllocator(HandleAllocator const& rhs) = delete;
+    HandleAllocator& operator=(HandleAllocator const& rhs) = delete;
+
+    /*
+     * Allocates a handle for type D and default-constructs (or constructs with the given
+     * arguments) its object.
+     */
+    template<typename D, typename ... ARGS>
+    Handle<D> allocateAndConstruct(ARGS&& ... args) noexcept {
+        Handle<D> h{ allocateHandle<D>() };
+        D* addr = handle_cast<D*>(h);
+        new(addr) D(std::forward<ARGS>(args)...);
+#if !defined(NDEBUG) && UTILS_HAS_RTTI
+        addr->typeId = typeid(D).name();
+#endif
+        return h;
+    }
+
+    /*
+     * Allocates a handle for type D. Its object is not constructed, construct() must be called
+     * before the handle is used.
+     */
+    template<typename D>
+    Handle<D> allocate() noexcept {
+        Handle<D> h{ allocateHandle<D>() };
+        return h;
+    }
+
+    /*
+     * Constructs the object of a handle returned by allocate().
+     */
+    template<typename D, typename B, typename ... ARGS>
+    typename std::enable_if<std::is_base_of<B, D>::value, D>::type*
+    construct(Handle<B> const& handle, ARGS&& ... args) noexcept {
+        assert_invariant(handle);
+        D* addr = handle_cast<D*>(const_cast<Handle<B>&>(handle));
+        new(addr) D(std::forward<ARGS>(args)...);
+#if !defined(NDEBUG) && UTILS_HAS_RTTI
+        addr->typeId = typeid(D).name();
+#endif
+        return addr;
+    }
+
+    /*
+     * Destroys the object of a handle returned by allocateAndConstruct() and constructs a new
+     * one in its place.
+     */
+    template<typename D, typename B, typename ... ARGS>
+    typename std::enable_if<std::is_base_of<B, D>::value, D>::type*
+    destroyAndConstruct(Handle<B> const& handle, ARGS&& ... args) noexcept {
+        assert_invariant(handle);
+        D* addr = handle_cast<D*>(const_cast<Handle<B>&>(handle));
+        // currently we implement this with dtor+ctor, we could use operator= also
+        // but all our dtors are trivial, ~D() is actually a noop.
+        addr->~D();
+        new(addr) D(std::forward<ARGS>(args)...);
+#if !defined(NDEBUG) && UTILS_HAS_RTTI
+        addr->typeId = typeid(D).name();
+#endif
+        return addr;
+    }
+
+    /*
+     * Destroys the object p of the given handle and returns its slot to its pool.
+     */
+    template<typename B, typename D,
+            typename = typename std::enable_if<std::is_base_of<B, D>::value, D>::type>
+    void deallocate(Handle<B>& handle, D const* p) noexcept {
+        // allow to destroy the nullptr, similarly to operator delete
+        if (p) {
+#if !defined(NDEBUG) && UTILS_HAS_RTTI
+            if (UTILS_UNLIKELY(p->typeId != typeid(D).name())) {
+                utils::slog.e << "Destroying handle " << handle.getId() << ", type "
+                        << typeid(D).name() << ", but handle's actual type is " << p->typeId
+                        << utils::io::endl;
+                std::terminate();
+            }
+            const_cast<D*>(p)->typeId = "(deleted)";
+#endif
+            p->~D();
+            deallocateHandle(handle.getId(), const_cast<D*>(p), sizeof(D));
+        }
+    }
+
+    template<typename D, typename B>
+    void deallocate(Handle<B>& handle) noexcept {
+        D const* p = handle_cast<D const*>(handle);
+        deallocate(handle, p);
+    }
+
+    /*
+     * handle_cast
+     *
+     * casts a Handle<> to a pointer to the data it refers to.
+     */
+    template<typename Dp, typename B>
+    inline typename std::enable_if<
+            std::is_pointer<Dp>::value &&
+            std::is_base_of<B, typename std::remove_cv<
+                    typename std::remove_pointer<Dp>::type>::type>::value, Dp>::type
+    handle_cast(Handle<B>& handle) noexcept {
+        assert_invariant(handle);
+        if (!handle) return nullptr; // better to get a NPE than random behavior/corruption
+        HandleBase::HandleId const id = handle.getId();
+        char* const base = (char*)mHandleArena.getArea().begin();
+        size_t const offset = size_t(id & HANDLE_INDEX_MASK) << MIN_ALIGNMENT_SHIFT;
+        // assert that this handle is even a valid one
+        assert_invariant(base + offset + sizeof(typename std::remove_pointer<Dp>::type)
+                <= (char*)mHandleArena.getArea().end());
+#ifndef NDEBUG
+        checkAge(id);
+#endif
+        return static_cast<Dp>(static_cast<void*>(base + offset));
+    }
+
+    template<typename Dp, typename B>
+    inline typename std::enable_if<
+            std::is_pointer<Dp>::value &&
+            std::is_base_of<B, typename std::remove_cv<
+                    typename std::remove_pointer<Dp>::type>::type>::value, Dp>::type
+    handle_cast(Handle<B> const& handle) noexcept {
+        return handle_cast<Dp>(const_cast<Handle<B>&>(handle));
+    }
+
+    Statistics getStatistics() const noexcept;
+
+    // logs the statistics above, useful to tune the size of the pools
+    void logStatistics() const noexcept;
+
+private:
+    static constexpr size_t MIN_ALIGNMENT_SHIFT = 4;
+
+    // In debug builds the 4 upper bits of a HandleId hold the age of its slot. This limits the
+    // heap area to 4 GiB, which is far more than what we ever need for handles.
+#ifndef NDEBUG
+    static constexpr uint32_t HANDLE_AGE_SHIFT = 28;
+    static constexpr uint32_t HANDLE_INDEX_MASK = (1u << HANDLE_AGE_SHIFT) - 1u;
+#else
+    static constexpr uint32_t HANDLE_INDEX_MASK = 0xFFFFFFFFu;
+#endif
+
+    static_assert(P0 % (1u << MIN_ALIGNMENT_SHIFT) == 0 &&
+                  P1 % (1u << MIN_ALIGNMENT_SHIFT) == 0 &&
+                  P2 % (1u << MIN_ALIGNMENT_SHIFT) == 0,
+            "pool sizes must be a multiple of 16 bytes");
+    static_assert(P0 < P1 && P1 < P2, "pool sizes must be increasing");
+
+    class Allocator {
+        friend class HandleAllocator;
+        utils::PoolAllocator<P0, 16> mPool0;
+        utils::PoolAllocator<P1, 32> mPool1;
+        utils::PoolAllocator<P2, 32> mPool2;
+
+        // Counters are only written with the arena lock held, but can be read at any time.
+        struct Counter {
+            std::atomic<uint32_t> count{};
+            std::atomic<uint32_t> peak{};
+            void increment() noexcept {
+                uint32_t const c = count.load(std::memory_order_relaxed) + 1;
+                count.store(c, std::memory_order_relaxed);
+                if (c > peak.load(std::memory_order_relaxed)) {
+                    peak.store(c, std::memory_order_relaxed);
+                }
+            }
+            void decrement() noexcept {
+                count.store(count.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+            }
+        };
+        Counter mCounters[3];
+        std::atomic<uint32_t> mAllocationCount{};
+        size_t mCapacities[3] = {};
+
+    public:
+        explicit Allocator(const utils::HeapArea& area);
+        void* alloc(size_t size, size_t alignment, size_t extra = 0) noexcept;
+        void free(void* p, size_t size) noexcept;
+    };
+
+    // the arenas for handle allocation needs to be thread-safe
+#ifndef NDEBUG
+    using HandleArena = utils::Arena<Allocator,
+            utils::LockingPolicy::SpinLock,
+            utils::TrackingPolicy::Debug>;
+#else
+    using HandleArena = utils::Arena<Allocator,
+            utils::LockingPolicy::SpinLock>;
+#endif
+
+    template<typename D>
+    HandleBase::HandleId allocateHandle() noexcept {
+        static_assert(sizeof(D) <= P2, "Handle<> too large");
+        return allocateHandleSlow(sizeof(D));
+    }
+
+    HandleBase::HandleId allocateHandleSlow(size_t size) noexcept;
+    void deallocateHandle(HandleBase::HandleId id, void* p, size_t size) noexcept;
+
+#ifndef NDEBUG
+    void checkAge(HandleBase::HandleId id) const noexcept {
+        uint8_t const expected = uint8_t(id >> HANDLE_AGE_SHIFT);
+        uint8_t const actual = mAges[id & HANDLE_INDEX_MASK];
+        if (UTILS_UNLIKELY(expected != actual)) {
+            utils::slog.e << "Use after free of handle with id " << (id & HANDLE_INDEX_MASK)
+                    << " (age " << unsigned(expected) << ", expected " << unsigned(actual) << ")"
+                    << utils::io::endl;
+            std::terminate();
+        }
+    }
+
+    // one entry per 16-bytes of the heap area, only valid at a slot's start
+    std::vector<uint8_t> mAges;
+#endif
+
+    HandleArena mHandleArena;
+};
+
+} // namespace backend
+} // namespace filament
+
+#endif // TNT_FILAMENT_DRIVER_HANDLEALLOCATOR_H
@@ -74,6 +74,28 @@ namespace backend {
 // this generates the vtable in this translation unit
 Platform::~Platform() noexcept = default;
 
+void Platform::setBlobFunc(InsertBlobFunc insertBlob, RetrieveBlobFunc retrieveBlob,
+        void* user) noexcept {
+    mInsertBlob = insertBlob;
+    mRetrieveBlob = retrieveBlob;
+    mBlobUser = user;
+}
+
+void Platform::insertBlob(const void* key, size_t keySize,
+        const void* value, size_t valueSize) noexcept {
+    if (mInsertBlob && keySize && valueSize) {
+        mInsertBlob(key, keySize, value, valueSize, mBlobUser);
+    }
+}
+
+size_t Platform::retrieveBlob(const void* key, size_t keySize,
+        void* value, size_t valueSize) noexcept {
+    if (mRetrieveBlob && keySize) {
+        return mRetrieveBlob(key, keySize, value, valueSize, mBlobUser);
+    }
+    return 0;
+}
+
 // Creates the platform-specific Platform object. The caller takes ownership and is
 // responsible for destroying it. Initialization of the backend API is deferred until
 // createDriver(). The passed-in backend hint is replaced with the resolved backend.
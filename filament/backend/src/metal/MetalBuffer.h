@@ -43,6 +43,11 @@ public:
      */
     void copyIntoBuffer(void* src, size_t size);
 
+    /**
+     * Update size bytes of the buffer at byteOffset, the rest of the buffer keeps its content.
+     */
+    void copyIntoBuffer(void* src, size_t size, size_t byteOffset);
+
     /**
      * Denotes that this buffer is used for a draw call ensuring that its allocation remains valid
      * until the end of the current frame.
@@ -67,6 +67,31 @@ void MetalBuffer::copyIntoBuffer(void* src, size_t size) {
     memcpy(static_cast<uint8_t*>(mBufferPoolEntry->buffer.contents), src, size);
 }
 
+void MetalBuffer::copyIntoBuffer(void* src, size_t size, size_t byteOffset) {
+    if (size <= 0) {
+        return;
+    }
+    ASSERT_PRECONDITION(byteOffset + size <= mBufferSize,
+            "Attempting to copy %d bytes at offset %d into a buffer of size %d",
+            size, byteOffset, mBufferSize);
+
+    if (mCpuBuffer) {
+        memcpy(static_cast<uint8_t*>(mCpuBuffer) + byteOffset, src, size);
+        return;
+    }
+
+    // The previous allocation may still be in use by the GPU, so the new contents go to a new
+    // allocation, starting with a copy of the previous contents.
+    MetalBufferPoolEntry const* previous = mBufferPoolEntry;
+    mBufferPoolEntry = mContext.bufferPool->acquireBuffer(mBufferSize);
+    uint8_t* const contents = static_cast<uint8_t*>(mBufferPoolEntry->buffer.contents);
+    if (previous) {
+        memcpy(contents, previous->buffer.contents, mBufferSize);
+        mContext.bufferPool->releaseBuffer(previous);
+    }
+    memcpy(contents + byteOffset, src, size);
+}
+
 id<MTLBuffer> MetalBuffer::getGpuBufferForDraw(id<MTLCommandBuffer> cmdBuffer) noexcept {
     if (!mBufferPoolEntry) {
         // If there's a CPU buffer, then we return nil here, as the CPU-side buffer will be bound
@@ -85,7 +110,7 @@ id<MTLBuffer> MetalBuffer::getGpuBufferForDraw(id<MTLCommandBuffer> cmdBuffer) n
     auto uniformDeleter = [bufferPool = mContext.bufferPool] (const void* resource) {
         bufferPool->releaseBuffer((const MetalBufferPoolEntry*) resource);
     };
-    if (mContext.resourceTracker.trackResource((__bridge void*) cmdBuffer, mBufferPoolEntry,
+    if (mContext.resourceTracker.trackResource(mBufferPoolEntry->lastSubmission, mBufferPoolEntry,
             uniformDeleter)) {
         // We only want to retain the buffer once per command buffer- trackResource will return
         // true if this is the first time tracking this uniform for this command buffer.
@@ -19,6 +19,8 @@
 
 #include <Metal/Metal.h>
 
+#include "DriverBase.h"
+
 #include <map>
 #include <mutex>
 #include <unordered_set>
@@ -35,12 +37,25 @@ struct MetalBufferPoolEntry {
     size_t capacity;
     mutable uint64_t lastAccessed;
     mutable uint32_t referenceCount;
+    mutable uint64_t lastSubmission; // see MetalResourceTracker
 };
 
 // Manages a pool of Metal buffers, periodically releasing ones that have been unused for awhile.
+//
+// Buffer sizes are rounded up to a power of two (up to MAX_SIZE_CLASS), so that uploads of slightly
+// different sizes can recycle each other's buffers. The pool is also trimmed when the system
+// reports memory pressure.
 class MetalBufferPool {
 public:
-    explicit MetalBufferPool(MetalContext& context) noexcept : mContext(context) {}
+    struct Statistics {
+        size_t residentBytes;   // total size of the buffers owned by the pool
+        size_t freeBytes;       // part of residentBytes that is currently unused
+        size_t bufferCount;     // number of buffers owned by the pool
+    };
+
+    // The resident buffers are reported to the memory tracker as staging memory.
+    MetalBufferPool(MetalContext& context, MemoryTracker& memoryTracker) noexcept;
+    ~MetalBufferPool();
 
     // Finds or creates a buffer whose capacity is at least the given number of bytes.
     MetalBufferPoolEntry const* acquireBuffer(size_t numBytes);
@@ -58,8 +73,17 @@ public:
     // Destroys all unused buffers.
     void reset() noexcept;
 
+    // Destroys all unused buffers, regardless of their age. Called on memory pressure.
+    void trim() noexcept;
+
+    Statistics getStatistics() noexcept;
+
 private:
+    static size_t getSizeClass(size_t numBytes) noexcept;
+    void destroyBuffer(MetalBufferPoolEntry const* stage) noexcept;
+
     MetalContext& mContext;
+    MemoryTracker& mMemoryTracker;
 
     // Synchronizes access to mFreeStages, mUsedStages, and mutable data inside MetalBufferPoolEntrys.
     // acquireBuffer and releaseBuffer may be called on separate threads (the engine thread and a
@@ -73,6 +97,16 @@ private:
     // In theory this need not exist, but is useful for validation and ensuring no leaks.
     std::unordered_set<MetalBufferPoolEntry const*> mUsedStages;
 
+    size_t mResidentBytes = 0;
+    size_t mFreeBytes = 0;
+
+    // Notifies us of memory pressure, on iOS it fires along with memory warnings.
+    dispatch_source_t mMemoryPressureSource = nil;
+
+    // Sizes up to this are rounded up to a power of two, larger ones are allocated as requested.
+    static constexpr size_t MIN_SIZE_CLASS = 256;
+    static constexpr size_t MAX_SIZE_CLASS = 16 * 1024 * 1024;
+
     // Store the current "time" (really just a frame count) and LRU eviction parameters.
     uint64_t mCurrentFrame = 0;
     static constexpr uint32_t TIME_BEFORE_EVICTION = 10;
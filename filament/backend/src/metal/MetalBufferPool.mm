@@ -28,29 +28,63 @@ namespace filament {
 namespace backend {
 namespace metal {
 
+MetalBufferPool::MetalBufferPool(MetalContext& context, MemoryTracker& memoryTracker) noexcept
+        : mContext(context), mMemoryTracker(memoryTracker) {
+    mMemoryPressureSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+            DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL,
+            dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+    // The source is cancelled in the destructor, so capturing "this" is safe.
+    dispatch_source_set_event_handler(mMemoryPressureSource, ^{
+        trim();
+    });
+    dispatch_resume(mMemoryPressureSource);
+}
+
+MetalBufferPool::~MetalBufferPool() {
+    dispatch_source_cancel(mMemoryPressureSource);
+    mMemoryPressureSource = nil;
+}
+
+size_t MetalBufferPool::getSizeClass(size_t numBytes) noexcept {
+    if (numBytes > MAX_SIZE_CLASS) {
+        return numBytes;
+    }
+    size_t sizeClass = MIN_SIZE_CLASS;
+    while (sizeClass < numBytes) {
+        sizeClass *= 2;
+    }
+    return sizeClass;
+}
+
 MetalBufferPoolEntry const* MetalBufferPool::acquireBuffer(size_t numBytes) {
     std::lock_guard<std::mutex> lock(mMutex);
 
     // First check if a stage exists whose capacity is greater than or equal to the requested size.
-    auto iter = mFreeStages.lower_bound(numBytes);
-    if (iter != mFreeStages.end()) {
+    // Don't hand out buffers more than twice as large as needed, they would just waste memory.
+    const size_t capacity = getSizeClass(numBytes);
+    auto iter = mFreeStages.lower_bound(capacity);
+    if (iter != mFreeStages.end() && iter->first <= capacity * 2) {
         auto stage = iter->second;
         mFreeStages.erase(iter);
         mUsedStages.insert(stage);
+        mFreeBytes -= stage->capacity;
         stage->referenceCount = 1;
         return stage;
     }
 
     // We were not able to find a sufficiently large stage, so create a new one.
-    id<MTLBuffer> buffer = [mContext.device newBufferWithLength:numBytes
+    id<MTLBuffer> buffer = [mContext.device newBufferWithLength:capacity
                                                         options:MTLResourceStorageModeShared];
     MetalBufferPoolEntry* stage = new MetalBufferPoolEntry({
         .buffer = buffer,
-        .capacity = numBytes,
+        .capacity = capacity,
         .lastAccessed = mCurrentFrame,
-        .referenceCount = 1
+        .referenceCount = 1,
+        .lastSubmission = 0
     });
     mUsedStages.insert(stage);
+    mResidentBytes += capacity;
+    mMemoryTracker.allocate(MemoryTracker::Category::STAGING, capacity);
 
     return stage;
 }
@@ -78,6 +112,7 @@ void MetalBufferPool::releaseBuffer(MetalBufferPoolEntry const *stage) noexcept
     stage->lastAccessed = mCurrentFrame;
     mUsedStages.erase(iter);
     mFreeStages.insert(std::make_pair(stage->capacity, stage));
+    mFreeBytes += stage->capacity;
 }
 
 void MetalBufferPool::gc() noexcept {
@@ -93,7 +128,7 @@ void MetalBufferPool::gc() noexcept {
     stages.swap(mFreeStages);
     for (auto pair : stages) {
         if (pair.second->lastAccessed < evictionTime) {
-            delete pair.second;
+            destroyBuffer(pair.second);
         } else {
             mFreeStages.insert(pair);
         }
@@ -105,9 +140,39 @@ void MetalBufferPool::reset() noexcept {
 
     assert_invariant(mUsedStages.empty());
     for (auto pair : mFreeStages) {
-        delete pair.second;
+        destroyBuffer(pair.second);
+    }
+    mFreeStages.clear();
+}
+
+void MetalBufferPool::trim() noexcept {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    const size_t freeBytes = mFreeBytes;
+    for (auto pair : mFreeStages) {
+        destroyBuffer(pair.second);
     }
     mFreeStages.clear();
+
+    utils::slog.i << "Memory pressure, released " << freeBytes << " bytes of Metal buffers, "
+            << mResidentBytes << " bytes still in use." << utils::io::endl;
+}
+
+MetalBufferPool::Statistics MetalBufferPool::getStatistics() noexcept {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return {
+        .residentBytes = mResidentBytes,
+        .freeBytes = mFreeBytes,
+        .bufferCount = mFreeStages.size() + mUsedStages.size()
+    };
+}
+
+// The caller must hold mMutex and remove the entry from mFreeStages.
+void MetalBufferPool::destroyBuffer(MetalBufferPoolEntry const* stage) noexcept {
+    mResidentBytes -= stage->capacity;
+    mFreeBytes -= stage->capacity;
+    mMemoryTracker.free(MemoryTracker::Category::STAGING, stage->capacity);
+    delete stage;
 }
 
 } // namespace metal
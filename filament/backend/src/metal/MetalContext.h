@@ -66,6 +66,8 @@ struct MetalContext {
     UniformBufferState uniformState[VERTEX_BUFFER_START];
     CullModeStateTracker cullModeState;
     WindingStateTracker windingState;
+    TextureBindingsTracker textureBindings;
+    SamplerBindingsTracker samplerStateBindings;
 
     // State caches.
     DepthStencilStateCache depthStencilStateCache;
@@ -82,6 +84,9 @@ struct MetalContext {
     MetalSwapChain* currentDrawSwapChain = nil;
     MetalSwapChain* currentReadSwapChain = nil;
 
+    // host time in seconds at which the next drawable should be presented, 0 when unset
+    CFTimeInterval presentationTime = 0.0;
+
     // External textures.
     CVMetalTextureCacheRef textureCache = nullptr;
     id<MTLComputePipelineState> externalImageComputePipelineState = nil;
@@ -94,7 +99,13 @@ struct MetalContext {
     // Fences, only supported on macOS 10.14 and iOS 12 and above.
     API_AVAILABLE(macos(10.14), ios(12.0))
     MTLSharedEventListener* eventListener = nil;
-    uint64_t signalId = 1;
+
+    // GPU progress counter shared by all the fences, which each signal the next value of the
+    // timeline from within the command stream. Values are only handed out on the driver thread,
+    // so that they increase in submission order.
+    API_AVAILABLE(macos(10.14), ios(12.0))
+    id<MTLSharedEvent> timelineEvent = nil;
+    uint64_t timelineValue = 0;
 
     TimerQueryInterface* timerQueryImpl;
 
@@ -109,6 +120,10 @@ id<MTLTexture> getOrCreateEmptyTexture(MetalContext* context);
 
 bool isInRenderPass(MetalContext* context);
 
+// Encodes a signal of the next timeline value into the pending command buffer and returns it.
+API_AVAILABLE(macos(10.14), ios(12.0))
+uint64_t signalTimeline(MetalContext* context);
+
 } // namespace metal
 } // namespace backend
 } // namespace filament
@@ -29,10 +29,11 @@ id<MTLCommandBuffer> getPendingCommandBuffer(MetalContext* context) {
         return context->pendingCommandBuffer;
     }
     context->pendingCommandBuffer = [context->commandQueue commandBuffer];
+    const auto submission = context->resourceTracker.beginSubmission();
     // It's safe for this block to capture the context variable. MetalDriver::terminate will ensure
     // all frames and their completion handlers finish before context is deallocated.
     [context->pendingCommandBuffer addCompletedHandler:^(id <MTLCommandBuffer> buffer) {
-        context->resourceTracker.clearResources((__bridge void*) buffer);
+        context->resourceTracker.retireSubmission(submission);
     }];
     ASSERT_POSTCONDITION(context->pendingCommandBuffer, "Could not obtain command buffer.");
     return context->pendingCommandBuffer;
@@ -74,6 +75,12 @@ bool isInRenderPass(MetalContext* context) {
     return context->currentRenderPassEncoder != nil;
 }
 
+uint64_t signalTimeline(MetalContext* context) {
+    const uint64_t value = ++context->timelineValue;
+    [getPendingCommandBuffer(context) encodeSignalEvent:context->timelineEvent value:value];
+    return value;
+}
+
 } // namespace metal
 } // namespace backend
 } // namespace filament
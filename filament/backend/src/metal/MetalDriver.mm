@@ -96,7 +96,7 @@ MetalDriver::MetalDriver(backend::MetalPlatform* platform) noexcept
     mContext->pipelineStateCache.setDevice(mContext->device);
     mContext->depthStencilStateCache.setDevice(mContext->device);
     mContext->samplerStateCache.setDevice(mContext->device);
-    mContext->bufferPool = new MetalBufferPool(*mContext);
+    mContext->bufferPool = new MetalBufferPool(*mContext, mMemoryTracker);
     mContext->blitter = new MetalBlitter(*mContext);
 
     if (@available(macOS 10.14, iOS 12, *)) {
@@ -112,6 +112,7 @@ MetalDriver::MetalDriver(backend::MetalPlatform* platform) noexcept
     if (@available(macOS 10.14, iOS 12, *)) {
         dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0);
         mContext->eventListener = [[MTLSharedEventListener alloc] initWithDispatchQueue:queue];
+        mContext->timelineEvent = [mContext->device newSharedEvent];
     }
 }
 
@@ -150,6 +151,9 @@ void MetalDriver::execute(std::function<void(void)> fn) noexcept {
 }
 
 void MetalDriver::setPresentationTime(int64_t monotonic_clock_ns) {
+    // On Apple platforms, std::chrono::steady_clock and CACurrentMediaTime() both count
+    // mach_absolute_time(), so only the unit differs.
+    mContext->presentationTime = CFTimeInterval(monotonic_clock_ns) * 1e-9;
 }
 
 void MetalDriver::endFrame(uint32_t frameId) {
@@ -198,24 +202,30 @@ void MetalDriver::createIndexBufferR(Handle<HwIndexBuffer> ibh, ElementType elem
 }
 
 void MetalDriver::createBufferObjectR(Handle<HwBufferObject> boh, uint32_t byteCount,
-        BufferObjectBinding bindingType) {
+        BufferObjectBinding bindingType, BufferUsage usage) {
     construct_handle<MetalBufferObject>(mHandleMap, boh, *mContext, byteCount);
 }
 
 void MetalDriver::createTextureR(Handle<HwTexture> th, SamplerType target, uint8_t levels,
         TextureFormat format, uint8_t samples, uint32_t width, uint32_t height,
         uint32_t depth, TextureUsage usage) {
-    construct_handle<MetalTexture>(mHandleMap, th, *mContext, target, levels, format, samples,
-            width, height, depth, usage, TextureSwizzle::CHANNEL_0, TextureSwizzle::CHANNEL_1,
-            TextureSwizzle::CHANNEL_2, TextureSwizzle::CHANNEL_3);
+    auto* texture = construct_handle<MetalTexture>(mHandleMap, th, *mContext, target, levels,
+            format, samples, width, height, depth, usage, TextureSwizzle::CHANNEL_0,
+            TextureSwizzle::CHANNEL_1, TextureSwizzle::CHANNEL_2, TextureSwizzle::CHANNEL_3);
+    if (target != SamplerType::SAMPLER_EXTERNAL) {
+        mMemoryTracker.allocate(*texture);
+    }
 }
 
 void MetalDriver::createTextureSwizzledR(Handle<HwTexture> th, SamplerType target, uint8_t levels,
         TextureFormat format, uint8_t samples, uint32_t width, uint32_t height,
         uint32_t depth, TextureUsage usage,
         TextureSwizzle r, TextureSwizzle g, TextureSwizzle b, TextureSwizzle a) {
-    construct_handle<MetalTexture>(mHandleMap, th, *mContext, target, levels, format, samples,
-            width, height, depth, usage, r, g, b, a);
+    auto* texture = construct_handle<MetalTexture>(mHandleMap, th, *mContext, target, levels,
+            format, samples, width, height, depth, usage, r, g, b, a);
+    if (target != SamplerType::SAMPLER_EXTERNAL) {
+        mMemoryTracker.allocate(*texture);
+    }
 }
 
 void MetalDriver::importTextureR(Handle<HwTexture> th, intptr_t i,
@@ -494,6 +504,10 @@ void MetalDriver::destroyTexture(Handle<HwTexture> th) {
         }
     }
 
+    auto* texture = handle_cast<MetalTexture>(mHandleMap, th);
+    if (!texture->imported && texture->target != SamplerType::SAMPLER_EXTERNAL) {
+        mMemoryTracker.free(*texture);
+    }
     destruct_handle<MetalTexture>(mHandleMap, th);
 }
 
@@ -531,6 +545,13 @@ void MetalDriver::terminate() {
     // This must be done before calling bufferPool->reset() to ensure no buffers are in flight.
     finish();
 
+#ifndef NDEBUG
+    const MetalBufferPool::Statistics stats = mContext->bufferPool->getStatistics();
+    utils::slog.d << "Metal buffer pool: " << stats.bufferCount << " buffers, "
+            << stats.residentBytes << " bytes resident, " << stats.freeBytes << " bytes free."
+            << utils::io::endl;
+#endif
+
     mContext->bufferPool->reset();
     mContext->commandQueue = nil;
 
@@ -554,7 +575,8 @@ Handle<HwStream> MetalDriver::createStreamAcquired() {
     return {};
 }
 
-void MetalDriver::setAcquiredImage(Handle<HwStream> sh, void* image, backend::StreamCallback cb,
+void MetalDriver::setAcquiredImage(Handle<HwStream> sh, void* image, int fence,
+        backend::StreamCallback cb,
         void* userData) {
 }
 
@@ -704,6 +726,16 @@ void MetalDriver::update2DImage(Handle<HwTexture> th, uint32_t level, uint32_t x
 }
 
 void MetalDriver::setMinMaxLevels(Handle<HwTexture> th, uint32_t minLevel, uint32_t maxLevel) {
+    // The levels are clamped by the sampler states, like the range of the loaded levels.
+    auto tex = handle_cast<MetalTexture>(mHandleMap, th);
+    tex->minLod = minLevel;
+    tex->maxLod = maxLevel;
+}
+
+void MetalDriver::commitTexturePages(Handle<HwTexture> th, uint32_t level,
+        uint32_t xoffset, uint32_t yoffset, uint32_t zoffset,
+        uint32_t width, uint32_t height, uint32_t depth, bool commit) {
+    // sparse textures are fully resident, see getSparseTexturePageSize()
 }
 
 void MetalDriver::update3DImage(Handle<HwTexture> th, uint32_t level,
@@ -769,6 +801,11 @@ SyncStatus MetalDriver::getSyncStatus(Handle<HwSync> sh) {
     return SyncStatus::ERROR;
 }
 
+bool MetalDriver::isProgramReady(Handle<HwProgram> ph) {
+    // Metal functions are created synchronously in createProgramR.
+    return true;
+}
+
 void MetalDriver::generateMipmaps(Handle<HwTexture> th) {
     ASSERT_PRECONDITION(!isInRenderPass(mContext),
                         "generateMipmaps must be called outside of a render pass.");
@@ -784,6 +821,29 @@ bool MetalDriver::canGenerateMipmaps() {
     return true;
 }
 
+bool MetalDriver::isComputeSupported() {
+    return false;
+}
+
+bool MetalDriver::isDrawIndirectSupported() {
+    return false;
+}
+
+bool MetalDriver::isDepthReadbackSupported() {
+    return false;
+}
+
+bool MetalDriver::isShadingRateSupported() {
+    // rasterization rate maps are not supported yet
+    return false;
+}
+
+math::uint3 MetalDriver::getSparseTexturePageSize(SamplerType target, TextureFormat format) {
+    // sparse textures must be allocated from a sparse MTLHeap, which we don't manage yet.
+    // Sparse textures are fully resident.
+    return {};
+}
+
 void MetalDriver::loadUniformBuffer(Handle<HwUniformBuffer> ubh,
         BufferDescriptor&& data) {
     if (data.size <= 0) {
@@ -796,6 +856,18 @@ void MetalDriver::loadUniformBuffer(Handle<HwUniformBuffer> ubh,
     scheduleDestroy(std::move(data));
 }
 
+void MetalDriver::updateUniformBuffer(Handle<HwUniformBuffer> ubh,
+        BufferDescriptor&& data, uint32_t byteOffset) {
+    if (data.size <= 0) {
+       return;
+    }
+
+    auto uniform = handle_cast<MetalUniformBuffer>(mHandleMap, ubh);
+
+    uniform->buffer.copyIntoBuffer(data.buffer, data.size, byteOffset);
+    scheduleDestroy(std::move(data));
+}
+
 void MetalDriver::updateSamplerGroup(Handle<HwSamplerGroup> sbh,
         SamplerGroup&& samplerGroup) {
     auto sb = handle_cast<MetalSamplerGroup>(mHandleMap, sbh);
@@ -841,6 +913,8 @@ void MetalDriver::beginRenderPass(Handle<HwRenderTarget> rth,
     mContext->depthStencilState.invalidate();
     mContext->cullModeState.invalidate();
     mContext->windingState.invalidate();
+    mContext->textureBindings.invalidate();
+    mContext->samplerStateBindings.invalidate();
 }
 
 void MetalDriver::nextSubpass(int dummy) {}
@@ -883,6 +957,10 @@ void MetalDriver::makeCurrent(Handle<HwSwapChain> schDraw, Handle<HwSwapChain> s
     }
 }
 
+void MetalDriver::setDamageRegion(Handle<HwSwapChain> sch, Viewport region) {
+    // CAMetalLayer always presents whole drawables
+}
+
 void MetalDriver::commit(Handle<HwSwapChain> sch) {
     auto* swapChain = handle_cast<MetalSwapChain>(mHandleMap, sch);
     swapChain->present();
@@ -912,6 +990,19 @@ void MetalDriver::bindSamplers(size_t index, Handle<HwSamplerGroup> sbh) {
     mContext->samplerBindings[index] = sb;
 }
 
+void MetalDriver::bindStorageBuffer(size_t index, Handle<HwBufferObject> boh) {
+    // compute is not supported, see isComputeSupported()
+}
+
+void MetalDriver::dispatchCompute(Handle<HwProgram> ph, math::uint3 workGroupCount) {
+    // compute is not supported, see isComputeSupported()
+}
+
+void MetalDriver::drawIndirect(PipelineState ps, Handle<HwRenderPrimitive> rph,
+        Handle<HwBufferObject> boh, uint32_t offset) {
+    // indirect draws are not supported, see isDrawIndirectSupported()
+}
+
 void MetalDriver::insertEventMarker(const char* string, size_t len) {
 
 }
@@ -1138,7 +1229,8 @@ void MetalDriver::blit(TargetBufferFlags buffers,
     mContext->blitter->blit(getPendingCommandBuffer(mContext), args);
 }
 
-void MetalDriver::draw(backend::PipelineState ps, Handle<HwRenderPrimitive> rph) {
+void MetalDriver::draw(backend::PipelineState ps, Handle<HwRenderPrimitive> rph,
+        uint32_t instanceCount) {
     ASSERT_PRECONDITION(mContext->currentRenderPassEncoder != nullptr,
             "Attempted to draw without a valid command encoder.");
     auto primitive = handle_cast<MetalRenderPrimitive>(mHandleMap, rph);
@@ -1251,10 +1343,12 @@ void MetalDriver::draw(backend::PipelineState ps, Handle<HwRenderPrimitive> rph)
     // Enumerate all the sampler buffers for the program and check which textures and samplers need
     // to be bound.
 
-    id<MTLTexture> texturesToBind[SAMPLER_BINDING_COUNT] = {};
-    id<MTLSamplerState> samplersToBind[SAMPLER_BINDING_COUNT] = {};
+    BindingArray<id<MTLTexture>> textureBindings;
+    BindingArray<id<MTLSamplerState>> samplerBindings;
+    __strong id<MTLTexture>* texturesToBind = textureBindings.objects;
+    __strong id<MTLSamplerState>* samplersToBind = samplerBindings.objects;
 
-    enumerateSamplerGroups(program, [this, &texturesToBind, &samplersToBind](
+    enumerateSamplerGroups(program, [this, texturesToBind, samplersToBind](
             const SamplerGroup::Sampler* sampler,
             uint8_t binding) {
         // We currently only support a max of SAMPLER_BINDING_COUNT samplers. Ignore any additional
@@ -1287,24 +1381,31 @@ void MetalDriver::draw(backend::PipelineState ps, Handle<HwRenderPrimitive> rph)
 
     // Assign a default sampler to empty slots, in case Filament hasn't bound all samplers.
     // Metal requires all samplers referenced in shaders to be bound.
-    for (auto& sampler : samplersToBind) {
+    for (auto& sampler : samplerBindings.objects) {
         if (!sampler) {
             sampler = mContext->samplerStateCache.getOrCreateState({});
         }
     }
 
     // Similar to uniforms, we can't tell which stage will use the textures / samplers, so bind
-    // to both the vertex and fragment stages.
+    // to both the vertex and fragment stages. Consecutive draws often use the same textures and
+    // samplers, in which case the encoder already has them.
 
     NSRange samplerRange = NSMakeRange(0, SAMPLER_BINDING_COUNT);
-    [mContext->currentRenderPassEncoder setFragmentTextures:texturesToBind
-                                                  withRange:samplerRange];
-    [mContext->currentRenderPassEncoder setVertexTextures:texturesToBind
-                                                withRange:samplerRange];
-    [mContext->currentRenderPassEncoder setFragmentSamplerStates:samplersToBind
-                                                       withRange:samplerRange];
-    [mContext->currentRenderPassEncoder setVertexSamplerStates:samplersToBind
-                                                     withRange:samplerRange];
+    mContext->textureBindings.updateState(textureBindings);
+    if (mContext->textureBindings.stateChanged()) {
+        [mContext->currentRenderPassEncoder setFragmentTextures:texturesToBind
+                                                      withRange:samplerRange];
+        [mContext->currentRenderPassEncoder setVertexTextures:texturesToBind
+                                                    withRange:samplerRange];
+    }
+    mContext->samplerStateBindings.updateState(samplerBindings);
+    if (mContext->samplerStateBindings.stateChanged()) {
+        [mContext->currentRenderPassEncoder setFragmentSamplerStates:samplersToBind
+                                                           withRange:samplerRange];
+        [mContext->currentRenderPassEncoder setVertexSamplerStates:samplersToBind
+                                                         withRange:samplerRange];
+    }
 
     // Bind the vertex buffers.
 
@@ -1344,7 +1445,8 @@ void MetalDriver::draw(backend::PipelineState ps, Handle<HwRenderPrimitive> rph)
                                                    indexCount:primitive->count
                                                     indexType:getIndexType(indexBuffer->elementSize)
                                                   indexBuffer:metalIndexBuffer
-                                            indexBufferOffset:primitive->offset];
+                                            indexBufferOffset:primitive->offset
+                                                instanceCount:instanceCount];
 }
 
 void MetalDriver::beginTimerQuery(Handle<HwTimerQuery> tqh) {
@@ -107,6 +107,11 @@ private:
     // and created Metal texture, respectively.
     CVPixelBufferRef mImage = nullptr;
     CVMetalTextureRef mTexture = nullptr;
+
+    // Last submissions that used mImage and mTexture, see MetalResourceTracker.
+    mutable uint64_t mImageSubmission = 0;
+    mutable uint64_t mTextureSubmission = 0;
+
     size_t mWidth = 0;
     size_t mHeight = 0;
 
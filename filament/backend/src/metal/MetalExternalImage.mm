@@ -165,11 +165,12 @@ id<MTLTexture> MetalExternalImage::getMetalTextureForDraw() const noexcept {
     // not need to be done for the RGB texture, because it is an Objective-C object whose
     // lifetime is automatically managed by Metal.
     auto& tracker = mContext.resourceTracker;
-    auto commandBuffer = getPendingCommandBuffer(&mContext);
-    if (tracker.trackResource((__bridge void*) commandBuffer, mImage, cvBufferDeleter)) {
+    // The resources are associated with the pending command buffer, create it if needed.
+    getPendingCommandBuffer(&mContext);
+    if (tracker.trackResource(mImageSubmission, mImage, cvBufferDeleter)) {
         CVPixelBufferRetain(mImage);
     }
-    if (tracker.trackResource((__bridge void*) commandBuffer, mTexture, cvBufferDeleter)) {
+    if (tracker.trackResource(mTextureSubmission, mTexture, cvBufferDeleter)) {
         CVBufferRetain(mTexture);
     }
 
@@ -206,6 +207,8 @@ void MetalExternalImage::unset() {
 
     mImage = nullptr;
     mTexture = nullptr;
+    mImageSubmission = 0;
+    mTextureSubmission = 0;
     mRgbTexture = nil;
     mWidth = 0;
     mHeight = 0;
@@ -204,6 +204,7 @@ struct MetalTexture : public HwTexture {
     MTLPixelFormat metalPixelFormat;
     uint32_t minLod = UINT_MAX;
     uint32_t maxLod = 0;
+    bool imported = false; // the id<MTLTexture> is owned by the client
 };
 
 struct MetalSamplerGroup : public HwSamplerGroup {
@@ -290,7 +291,8 @@ private:
     API_AVAILABLE(macos(10.14), ios(12.0))
     id<MTLSharedEvent> event = nil;
 
-    uint64_t value;
+    // the timeline value signaled by this fence, assigned by encode()
+    uint64_t value = 0;
 };
 
 struct MetalTimerQuery : public HwTimerQuery {
@@ -201,9 +201,14 @@ void MetalSwapChain::present() {
     if (drawable) {
         if (frameScheduledCallback) {
             scheduleFrameScheduledCallback();
+        } else if (context.presentationTime > 0.0) {
+            [getPendingCommandBuffer(&context) presentDrawable:drawable
+                                                        atTime:context.presentationTime];
         } else  {
             [getPendingCommandBuffer(&context) presentDrawable:drawable];
         }
+        // the presentation time only applies to the next present
+        context.presentationTime = 0.0;
     }
 }
 
@@ -340,11 +345,11 @@ MetalProgram::MetalProgram(id<MTLDevice> device, const Program& program) noexcep
 
     using MetalFunctionPtr = __strong id<MTLFunction>*;
 
-    static_assert(Program::SHADER_TYPE_COUNT == 2, "Only vertex and fragment shaders expected.");
+    // compute programs are not supported by the Metal backend
     MetalFunctionPtr shaderFunctions[2] = { &vertexFunction, &fragmentFunction };
 
     const auto& sources = program.getShadersSource();
-    for (size_t i = 0; i < Program::SHADER_TYPE_COUNT; i++) {
+    for (size_t i = 0; i < 2; i++) {
         const auto& source = sources[i];
         // It's okay for some shaders to be empty, they shouldn't be used in any draw calls.
         if (source.empty()) {
@@ -531,6 +536,7 @@ MetalTexture::MetalTexture(MetalContext& context, SamplerType target, uint8_t le
     texture = metalTexture;
     minLod = 0;
     maxLod = levels - 1;
+    imported = true;
 }
 
 MetalTexture::~MetalTexture() {
@@ -721,7 +727,7 @@ MetalRenderTarget::MetalRenderTarget(MetalContext* context, uint32_t width, uint
 
         if (msaaResolve && textureSampleCount == 1) {
             multisampledColor[i] =
-                    createMultisampledTexture(context->device, color[0].texture.pixelFormat,
+                    createMultisampledTexture(context->device, color[i].texture.pixelFormat,
                             width, height, samples);
         }
     }
@@ -865,21 +871,29 @@ id<MTLTexture> MetalRenderTarget::createMultisampledTexture(id<MTLDevice> device
     descriptor.textureType = MTLTextureType2DMultisample;
     descriptor.sampleCount = samples;
     descriptor.usage = MTLTextureUsageRenderTarget;
+    // The sidecars are resolved within the render pass, they never need to be backed by memory
+    // on Apple GPUs, including on Macs with Apple silicon.
 #if defined(IOS)
     descriptor.resourceOptions = MTLResourceStorageModeMemoryless;
 #else
     descriptor.resourceOptions = MTLResourceStorageModePrivate;
+    if (@available(macOS 11.0, *)) {
+        if ([device supportsFamily:MTLGPUFamilyApple1]) {
+            descriptor.resourceOptions = MTLResourceStorageModeMemoryless;
+        }
+    }
 #endif
 
     return [device newTextureWithDescriptor:descriptor];
 }
 
-MetalFence::MetalFence(MetalContext& context) : context(context), value(context.signalId++) { }
+MetalFence::MetalFence(MetalContext& context) : context(context) { }
 
 void MetalFence::encode() {
     if (@available(macOS 10.14, iOS 12, *)) {
-        event = [context.device newSharedEvent];
-        [getPendingCommandBuffer(&context) encodeSignalEvent:event value:value];
+        // All the fences share the context's timeline, so no event is created per fence.
+        event = context.timelineEvent;
+        value = signalTimeline(&context);
 
         // Using a weak_ptr here because the Fence could be deleted before the block executes.
         std::weak_ptr<State> weakState = state;
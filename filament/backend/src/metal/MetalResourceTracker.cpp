@@ -22,35 +22,26 @@ namespace filament {
 namespace backend {
 namespace metal {
 
-bool MetalResourceTracker::trackResource(CommandBuffer buffer, Resource resource,
+bool MetalResourceTracker::trackResource(SubmissionId& lastSubmission, Resource resource,
         ResourceDeleter deleter) {
-    std::lock_guard<std::mutex> lock(mMutex);
-
-    auto found = mResources.find(buffer);
-    if (found == mResources.end()) {
-        Resources& resourcesForBuffer = mResources[buffer] = {};
-        resourcesForBuffer.insert({resource, deleter});
-        return true;
+    assert_invariant(lastSubmission <= mCurrentSubmission);
+    if (lastSubmission == mCurrentSubmission) {
+        return false;
     }
+    lastSubmission = mCurrentSubmission;
 
-    assert_invariant(found != mResources.end());
-    Resources& resources = found.value();
-    auto inserted = resources.insert({resource, deleter});
-    return inserted.second;
+    std::lock_guard<std::mutex> lock(mMutex);
+    mResources.push_back({ mCurrentSubmission, resource, std::move(deleter) });
+    return true;
 }
 
-void MetalResourceTracker::clearResources(CommandBuffer buffer) {
+void MetalResourceTracker::retireSubmission(SubmissionId completed) {
     std::lock_guard<std::mutex> lock(mMutex);
-
-    auto found = mResources.find(buffer);
-    if (found == mResources.end()) {
-        return;
-    }
-
-    for (const auto& resource : found.value()) {
-        resource.deleter(resource.resource);
+    while (!mResources.empty() && mResources.front().submission <= completed) {
+        ResourceEntry const& entry = mResources.front();
+        entry.deleter(entry.resource);
+        mResources.pop_front();
     }
-    mResources.erase(found);
 }
 
 } // namespace metal
@@ -17,62 +17,69 @@
 #ifndef TNT_METALRESOURCETRACKER_H
 #define TNT_METALRESOURCETRACKER_H
 
-#include <tsl/robin_map.h>
-#include <tsl/robin_set.h>
-
+#include <deque>
 #include <functional>
 #include <mutex>
 
+#include <stdint.h>
+
 namespace filament {
 namespace backend {
 namespace metal {
 
 /**
- * MetalResourceTracker is a simple utility that maps individual command buffers to a set of
- * associated resources.
+ * MetalResourceTracker keeps the resources used by command buffers alive until they complete.
+ *
+ * Each command buffer is a submission, identified by an increasing counter. Resources are stamped
+ * with the last submission that used them, so tracking a resource again within the same
+ * submission is a single comparison. Resources are queued in submission order, and retired when
+ * the submission that last queued them completes. This relies on the command buffers of a queue
+ * completing in the order they were committed.
  */
 class MetalResourceTracker {
 public:
-    using CommandBuffer = void*;
+    using SubmissionId = uint64_t;
     using Resource = const void*;
     using ResourceDeleter = std::function<void(Resource)>;
 
     /**
-     * Associate the given resource with a command buffer. When clearResources is called, the given
-     * deleter will be called for each resource.
-     * @return true, if this is the first time tracking the resource.
+     * Starts a new submission, to which resources are then associated. Called on the driver
+     * thread when a command buffer is created.
+     * @return the id of the new submission.
+     */
+    SubmissionId beginSubmission() noexcept { return ++mCurrentSubmission; }
+
+    /**
+     * Associates the given resource with the current submission. When the submission has
+     * completed, the given deleter will be called for the resource.
+     * @param lastSubmission the stamp of the resource, stored alongside of it and initialized to
+     *                       0. It must be reset to 0 when the resource is replaced.
+     * @return true, if this is the first time tracking the resource for the current submission.
      */
-    bool trackResource(CommandBuffer buffer, Resource resource, ResourceDeleter deleter);
+    bool trackResource(SubmissionId& lastSubmission, Resource resource, ResourceDeleter deleter);
 
     /**
-     * Calls the deleter for each resource associated with the command buffer, and removes them from
-     * tracking.
+     * Calls the deleter for each resource associated with the given submission or an earlier one,
+     * and removes them from tracking. Called when a command buffer has completed.
      */
-    void clearResources(CommandBuffer buffer);
+    void retireSubmission(SubmissionId completed);
 
 private:
     struct ResourceEntry {
+        SubmissionId submission;
         Resource resource;
         ResourceDeleter deleter;
-
-        bool operator==(const ResourceEntry& rhs) const noexcept {
-            return resource == rhs.resource;
-        }
     };
 
-    struct ResourceEntryHash {
-        size_t operator()(const ResourceEntry& entry) const noexcept {
-            return std::hash<Resource>{}(entry.resource);
-        }
-    };
+    // Only accessed by the driver thread.
+    SubmissionId mCurrentSubmission = 0;
 
-    using ResourcesKey = CommandBuffer;
-    using Resources = tsl::robin_set<ResourceEntry, ResourceEntryHash>;
-    tsl::robin_map<ResourcesKey, Resources> mResources;
+    // Tracked resources, in submission order.
+    std::deque<ResourceEntry> mResources;
 
-    // Synchronizes access to the map.
-    // trackResource and clearResources may be called on separate threads (the engine thread and a
-    // Metal callback thread, for example).
+    // Synchronizes access to the queue.
+    // trackResource and retireSubmission may be called on separate threads (the engine thread and
+    // a Metal callback thread, for example).
     std::mutex mMutex;
 };
 
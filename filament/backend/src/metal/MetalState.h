@@ -336,6 +336,30 @@ struct SamplerStateCreator {
 
 using SamplerStateCache = StateCache<SamplerState, id<MTLSamplerState>, SamplerStateCreator>;
 
+// Textures and sampler states bound to both the vertex and fragment stages. These are tracked as a
+// whole, so that draws using the same materials don't re-issue four encoder calls each.
+
+template<typename T>
+struct BindingArray {
+    T objects[SAMPLER_BINDING_COUNT] = {};
+
+    bool operator==(const BindingArray& rhs) const noexcept {
+        for (size_t i = 0; i < SAMPLER_BINDING_COUNT; i++) {
+            if (this->objects[i] != rhs.objects[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(const BindingArray& rhs) const noexcept {
+        return !operator==(rhs);
+    }
+};
+
+using TextureBindingsTracker = StateTracker<BindingArray<id<MTLTexture>>>;
+using SamplerBindingsTracker = StateTracker<BindingArray<id<MTLSamplerState>>>;
+
 // Raster-related state
 
 using CullModeStateTracker = StateTracker<MTLCullMode>;
@@ -120,7 +120,8 @@ Handle<HwStream> NoopDriver::createStreamAcquired() {
     return {};
 }
 
-void NoopDriver::setAcquiredImage(Handle<HwStream> sh, void* image, backend::StreamCallback cb,
+void NoopDriver::setAcquiredImage(Handle<HwStream> sh, void* image, int fence,
+        backend::StreamCallback cb,
         void* userData) {
 }
 
@@ -198,6 +199,11 @@ void NoopDriver::update2DImage(Handle<HwTexture> th,
 void NoopDriver::setMinMaxLevels(Handle<HwTexture> th, uint32_t minLevel, uint32_t maxLevel) {
 }
 
+void NoopDriver::commitTexturePages(Handle<HwTexture> th, uint32_t level,
+        uint32_t xoffset, uint32_t yoffset, uint32_t zoffset,
+        uint32_t width, uint32_t height, uint32_t depth, bool commit) {
+}
+
 void NoopDriver::update3DImage(Handle<HwTexture> th,
         uint32_t level, uint32_t xoffset, uint32_t yoffset, uint32_t zoffset,
         uint32_t width, uint32_t height, uint32_t depth,
@@ -224,6 +230,10 @@ SyncStatus NoopDriver::getSyncStatus(Handle<HwSync> sh) {
     return SyncStatus::SIGNALED;
 }
 
+bool NoopDriver::isProgramReady(Handle<HwProgram> ph) {
+    return true;
+}
+
 void NoopDriver::setExternalImage(Handle<HwTexture> th, void* image) {
 }
 
@@ -239,10 +249,35 @@ bool NoopDriver::canGenerateMipmaps() {
     return true;
 }
 
+bool NoopDriver::isComputeSupported() {
+    return false;
+}
+
+bool NoopDriver::isDrawIndirectSupported() {
+    return false;
+}
+
+bool NoopDriver::isDepthReadbackSupported() {
+    return false;
+}
+
+bool NoopDriver::isShadingRateSupported() {
+    return false;
+}
+
+math::uint3 NoopDriver::getSparseTexturePageSize(SamplerType target, TextureFormat format) {
+    return {};
+}
+
 void NoopDriver::loadUniformBuffer(Handle<HwUniformBuffer> ubh, BufferDescriptor&& data) {
     scheduleDestroy(std::move(data));
 }
 
+void NoopDriver::updateUniformBuffer(Handle<HwUniformBuffer> ubh, BufferDescriptor&& data,
+        uint32_t byteOffset) {
+    scheduleDestroy(std::move(data));
+}
+
 void NoopDriver::updateSamplerGroup(Handle<HwSamplerGroup> sbh,
         SamplerGroup&& samplerGroup) {
 }
@@ -268,6 +303,9 @@ void NoopDriver::setRenderPrimitiveRange(Handle<HwRenderPrimitive> rph,
 void NoopDriver::makeCurrent(Handle<HwSwapChain> drawSch, Handle<HwSwapChain> readSch) {
 }
 
+void NoopDriver::setDamageRegion(Handle<HwSwapChain> sch, Viewport region) {
+}
+
 void NoopDriver::commit(Handle<HwSwapChain> sch) {
 }
 
@@ -281,6 +319,9 @@ void NoopDriver::bindUniformBufferRange(size_t index, Handle<HwUniformBuffer> ub
 void NoopDriver::bindSamplers(size_t index, Handle<HwSamplerGroup> sbh) {
 }
 
+void NoopDriver::bindStorageBuffer(size_t index, Handle<HwBufferObject> boh) {
+}
+
 void NoopDriver::insertEventMarker(char const* string, size_t len) {
 }
 
@@ -313,7 +354,15 @@ void NoopDriver::blit(TargetBufferFlags buffers,
         SamplerMagFilter filter) {
 }
 
-void NoopDriver::draw(PipelineState pipelineState, Handle<HwRenderPrimitive> rph) {
+void NoopDriver::draw(PipelineState pipelineState, Handle<HwRenderPrimitive> rph,
+        uint32_t instanceCount) {
+}
+
+void NoopDriver::drawIndirect(PipelineState pipelineState, Handle<HwRenderPrimitive> rph,
+        Handle<HwBufferObject> boh, uint32_t offset) {
+}
+
+void NoopDriver::dispatchCompute(Handle<HwProgram> ph, math::uint3 workGroupCount) {
 }
 
 void NoopDriver::beginTimerQuery(Handle<HwTimerQuery> tqh) {
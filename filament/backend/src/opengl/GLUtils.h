@@ -115,6 +115,17 @@ constexpr inline GLenum getBufferUsage(backend::BufferUsage usage) noexcept {
     }
 }
 
+constexpr inline GLenum getBufferBindingTarget(backend::BufferObjectBinding bindingType) noexcept {
+    switch (bindingType) {
+        case backend::BufferObjectBinding::VERTEX:
+            return GL_ARRAY_BUFFER;
+        case backend::BufferObjectBinding::SHADER_STORAGE:
+            return GL_SHADER_STORAGE_BUFFER;
+        case backend::BufferObjectBinding::DRAW_INDIRECT:
+            return GL_DRAW_INDIRECT_BUFFER;
+    }
+}
+
 constexpr inline GLboolean getNormalization(bool normalized) noexcept {
     return GLboolean(normalized ? GL_TRUE : GL_FALSE);
 }
@@ -70,6 +70,17 @@ public:
 
     backend::ShaderModel getShaderModel() const noexcept { return mShaderModel; }
 
+    // Number of GL state changes issued and elided by the state cache, only counted in debug
+    // builds. OpenGLDriver resets them every frame.
+    struct StateCacheStatistics {
+        uint32_t issued = 0;
+        uint32_t elided = 0;
+    };
+    StateCacheStatistics const& getStateCacheStatistics() const noexcept {
+        return mStateCacheStats;
+    }
+    void resetStateCacheStatistics() noexcept { mStateCacheStats = {}; }
+
 
     inline void useProgram(GLuint program) noexcept;
 
@@ -123,6 +134,7 @@ public:
     // features supported by this version of GL or GLES
     struct {
         bool multisample_texture = false;
+        bool compute_shaders = false;
     } features;
 
     // supported extensions detected at runtime
@@ -139,11 +151,13 @@ public:
         bool EXT_multisampled_render_to_texture = false;
         bool EXT_multisampled_render_to_texture2 = false;
         bool KHR_debug = false;
+        bool KHR_parallel_shader_compile = false;
         bool EXT_texture_sRGB = false;
         bool EXT_texture_compression_s3tc_srgb = false;
         bool EXT_disjoint_timer_query = false;
         bool EXT_shader_framebuffer_fetch = false;
         bool EXT_clip_control = false;
+        bool EXT_sparse_texture = false;
         bool GOOGLE_cpp_style_line_directive = false;
     } ext;
 
@@ -240,8 +254,8 @@ private:
                     GLintptr offset = 0;
                     GLsizeiptr size = 0;
                 } buffers[MAX_BUFFER_BINDINGS];
-            } targets[2];   // there are only 2 indexed buffer target (uniform and transform feedback)
-            GLuint genericBinding[8] = { 0 };
+            } targets[3];   // indexed buffer targets (uniform, transform feedback, shader storage)
+            GLuint genericBinding[10] = { 0 };
         } buffers;
 
         struct {
@@ -281,9 +295,23 @@ private:
 
     RenderPrimitive mDefaultVAO;
 
+    StateCacheStatistics mStateCacheStats;
+
+    // returns 'issued', so it can wrap the condition of a state change
+    inline bool count_state(bool issued) noexcept {
+#ifndef NDEBUG
+        if (issued) {
+            mStateCacheStats.issued++;
+        } else {
+            mStateCacheStats.elided++;
+        }
+#endif
+        return issued;
+    }
+
     template <typename T, typename F>
-    static inline void update_state(T& state, T const& expected, F functor, bool force = false) noexcept {
-        if (UTILS_UNLIKELY(force || state != expected)) {
+    inline void update_state(T& state, T const& expected, F functor, bool force = false) noexcept {
+        if (UTILS_UNLIKELY(count_state(force || state != expected))) {
             state = expected;
             functor();
         }
@@ -341,14 +369,16 @@ constexpr size_t OpenGLContext::getIndexForBufferTarget(GLenum target) noexcept
         // The indexed buffers MUST be first in this list
         case GL_UNIFORM_BUFFER:             index = 0; break;
         case GL_TRANSFORM_FEEDBACK_BUFFER:  index = 1; break;
-
-        case GL_ARRAY_BUFFER:               index = 2; break;
-        case GL_COPY_READ_BUFFER:           index = 3; break;
-        case GL_COPY_WRITE_BUFFER:          index = 4; break;
-        case GL_ELEMENT_ARRAY_BUFFER:       index = 5; break;
-        case GL_PIXEL_PACK_BUFFER:          index = 6; break;
-        case GL_PIXEL_UNPACK_BUFFER:        index = 7; break;
-        default: index = 8; break; // should never happen
+        case GL_SHADER_STORAGE_BUFFER:      index = 2; break;
+
+        case GL_ARRAY_BUFFER:               index = 3; break;
+        case GL_COPY_READ_BUFFER:           index = 4; break;
+        case GL_COPY_WRITE_BUFFER:          index = 5; break;
+        case GL_ELEMENT_ARRAY_BUFFER:       index = 6; break;
+        case GL_PIXEL_PACK_BUFFER:          index = 7; break;
+        case GL_PIXEL_UNPACK_BUFFER:        index = 8; break;
+        case GL_DRAW_INDIRECT_BUFFER:       index = 9; break;
+        default: index = 10; break; // should never happen
     }
     assert_invariant(index < sizeof(state.buffers.genericBinding)/sizeof(state.buffers.genericBinding[0])); // NOLINT(misc-redundant-expression)
     return index;
@@ -409,12 +439,12 @@ void OpenGLContext::bindVertexArray(RenderPrimitive const* p) noexcept {
 void OpenGLContext::bindBufferRange(GLenum target, GLuint index, GLuint buffer,
         GLintptr offset, GLsizeiptr size) noexcept {
     size_t targetIndex = getIndexForBufferTarget(target);
-    assert_invariant(targetIndex <= 1); // validity check
+    assert_invariant(targetIndex <= 2); // validity check
 
     // this ALSO sets the generic binding
-    if (   state.buffers.targets[targetIndex].buffers[index].name != buffer
+    if (count_state(state.buffers.targets[targetIndex].buffers[index].name != buffer
            || state.buffers.targets[targetIndex].buffers[index].offset != offset
-           || state.buffers.targets[targetIndex].buffers[index].size != size) {
+           || state.buffers.targets[targetIndex].buffers[index].size != size)) {
         state.buffers.targets[targetIndex].buffers[index].name = buffer;
         state.buffers.targets[targetIndex].buffers[index].offset = offset;
         state.buffers.targets[targetIndex].buffers[index].size = size;
@@ -426,19 +456,19 @@ void OpenGLContext::bindBufferRange(GLenum target, GLuint index, GLuint buffer,
 void OpenGLContext::bindFramebuffer(GLenum target, GLuint buffer) noexcept {
     switch (target) {
         case GL_FRAMEBUFFER:
-            if (state.draw_fbo != buffer || state.read_fbo != buffer) {
+            if (count_state(state.draw_fbo != buffer || state.read_fbo != buffer)) {
                 state.draw_fbo = state.read_fbo = buffer;
                 glBindFramebuffer(target, buffer);
             }
             break;
         case GL_DRAW_FRAMEBUFFER:
-            if (state.draw_fbo != buffer) {
+            if (count_state(state.draw_fbo != buffer)) {
                 state.draw_fbo = buffer;
                 glBindFramebuffer(target, buffer);
             }
             break;
         case GL_READ_FRAMEBUFFER:
-            if (state.read_fbo != buffer) {
+            if (count_state(state.read_fbo != buffer)) {
                 state.read_fbo = buffer;
                 glBindFramebuffer(target, buffer);
             }
@@ -470,7 +500,7 @@ void OpenGLContext::useProgram(GLuint program) noexcept {
 void OpenGLContext::enableVertexAttribArray(GLuint index) noexcept {
     assert_invariant(state.vao.p);
     assert_invariant(index < state.vao.p->vertexAttribArray.size());
-    if (UTILS_UNLIKELY(!state.vao.p->vertexAttribArray[index])) {
+    if (UTILS_UNLIKELY(count_state(!state.vao.p->vertexAttribArray[index]))) {
         state.vao.p->vertexAttribArray.set(index);
         glEnableVertexAttribArray(index);
     }
@@ -479,7 +509,7 @@ void OpenGLContext::enableVertexAttribArray(GLuint index) noexcept {
 void OpenGLContext::disableVertexAttribArray(GLuint index) noexcept {
     assert_invariant(state.vao.p);
     assert_invariant(index < state.vao.p->vertexAttribArray.size());
-    if (UTILS_UNLIKELY(state.vao.p->vertexAttribArray[index])) {
+    if (UTILS_UNLIKELY(count_state(state.vao.p->vertexAttribArray[index]))) {
         state.vao.p->vertexAttribArray.unset(index);
         glDisableVertexAttribArray(index);
     }
@@ -487,7 +517,7 @@ void OpenGLContext::disableVertexAttribArray(GLuint index) noexcept {
 
 void OpenGLContext::enable(GLenum cap) noexcept {
     size_t index = getIndexForCap(cap);
-    if (UTILS_UNLIKELY(!state.enables.caps[index])) {
+    if (UTILS_UNLIKELY(count_state(!state.enables.caps[index]))) {
         state.enables.caps.set(index);
         glEnable(cap);
     }
@@ -495,7 +525,7 @@ void OpenGLContext::enable(GLenum cap) noexcept {
 
 void OpenGLContext::disable(GLenum cap) noexcept {
     size_t index = getIndexForCap(cap);
-    if (UTILS_UNLIKELY(state.enables.caps[index])) {
+    if (UTILS_UNLIKELY(count_state(state.enables.caps[index]))) {
         state.enables.caps.unset(index);
         glDisable(cap);
     }
@@ -517,8 +547,8 @@ void OpenGLContext::cullFace(GLenum mode) noexcept {
 
 void OpenGLContext::blendEquation(GLenum modeRGB, GLenum modeA) noexcept {
     // WARNING: don't call this without updating mRasterState
-    if (UTILS_UNLIKELY(
-            state.raster.blendEquationRGB != modeRGB || state.raster.blendEquationA != modeA)) {
+    if (UTILS_UNLIKELY(count_state(
+            state.raster.blendEquationRGB != modeRGB || state.raster.blendEquationA != modeA))) {
         state.raster.blendEquationRGB = modeRGB;
         state.raster.blendEquationA   = modeA;
         glBlendEquationSeparate(modeRGB, modeA);
@@ -527,11 +557,11 @@ void OpenGLContext::blendEquation(GLenum modeRGB, GLenum modeA) noexcept {
 
 void OpenGLContext::blendFunction(GLenum srcRGB, GLenum srcA, GLenum dstRGB, GLenum dstA) noexcept {
     // WARNING: don't call this without updating mRasterState
-    if (UTILS_UNLIKELY(
+    if (UTILS_UNLIKELY(count_state(
             state.raster.blendFunctionSrcRGB != srcRGB ||
             state.raster.blendFunctionSrcA != srcA ||
             state.raster.blendFunctionDstRGB != dstRGB ||
-            state.raster.blendFunctionDstA != dstA)) {
+            state.raster.blendFunctionDstA != dstA))) {
         state.raster.blendFunctionSrcRGB = srcRGB;
         state.raster.blendFunctionSrcA = srcA;
         state.raster.blendFunctionDstRGB = dstRGB;
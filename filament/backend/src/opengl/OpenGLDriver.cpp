@@ -131,7 +131,7 @@ OpenGLDriver::DebugMarker::~DebugMarker() noexcept {
 
 OpenGLDriver::OpenGLDriver(OpenGLPlatform* platform) noexcept
         : DriverBase(new ConcreteDispatcher<OpenGLDriver>()),
-          mHandleArena("Handles", FILAMENT_OPENGL_HANDLE_ARENA_SIZE_IN_MB * 1024U * 1024U), // TODO: set the amount in configuration
+          mHandleAllocator("Handles", FILAMENT_OPENGL_HANDLE_ARENA_SIZE_IN_MB * 1024U * 1024U), // TODO: set the amount in configuration
           mSamplerMap(32),
           mPlatform(*platform) {
   
@@ -189,6 +189,12 @@ void OpenGLDriver::terminate() {
     // because we called glFinish(), all callbacks should have been executed
     assert_invariant(mGpuCommandCompleteOps.empty());
 
+    for (auto const& item : mReadPixelsBuffers) {
+        glDeleteBuffers(1, &item.first);
+        mMemoryTracker.free(MemoryTracker::Category::STAGING, size_t(item.second));
+    }
+    mReadPixelsBuffers.clear();
+
     for (auto& item : mSamplerMap) {
         mContext.unbindSampler(item.second);
         glDeleteSamplers(1, &item.second);
@@ -200,6 +206,10 @@ void OpenGLDriver::terminate() {
 
     delete mTimerQueryImpl;
 
+#ifndef NDEBUG
+    mHandleAllocator.logStatistics();
+#endif
+
     mPlatform.terminate();
 }
 
@@ -211,10 +221,6 @@ ShaderModel OpenGLDriver::getShaderModel() const noexcept {
 // Change and track GL state
 // ------------------------------------------------------------------------------------------------
 
-void OpenGLDriver::bindSampler(GLuint unit, backend::SamplerParams params) noexcept {
-    mContext.bindSampler(unit, getSampler(params));
-}
-
 void OpenGLDriver::bindTexture(GLuint unit, GLTexture const* t) noexcept {
     assert_invariant(t != nullptr);
     mContext.bindTexture(unit, t->gl.target, t->gl.id, t->gl.targetIndex);
@@ -296,9 +302,9 @@ void OpenGLDriver::setRasterStateSlow(RasterState rs) noexcept {
 // For reference on a 64-bits machine:
 //    GLFence                   :  8
 //    GLIndexBuffer             : 12        moderate
-//    GLSamplerGroup            : 16        moderate
 // -- less than 16 bytes
 
+//    GLSamplerGroup            : 24        moderate
 //    GLRenderPrimitive         : 40        many
 //    GLTexture                 : 44        moderate
 //    OpenGLProgram             : 40        moderate
@@ -311,103 +317,6 @@ void OpenGLDriver::setRasterStateSlow(RasterState rs) noexcept {
 // -- less than or equal to 208 bytes
 
 
-OpenGLDriver::HandleAllocator::HandleAllocator(const utils::HeapArea& area)
-        : mPool0(area.begin(),
-                  pointermath::add(area.begin(), (1 * area.getSize()) / 16)),
-          mPool1( pointermath::add(area.begin(), (1 * area.getSize()) / 16),
-                  pointermath::add(area.begin(), (6 * area.getSize()) / 16)),
-          mPool2( pointermath::add(area.begin(), (6 * area.getSize()) / 16),
-                  area.end()) {
-
-#if 0
-    // this is useful for development, but too verbose even for debug builds
-    slog.d << "HwFence: " << sizeof(HwFence) << io::endl;
-    slog.d << "HwSync: " << sizeof(HwSync) << io::endl;
-    slog.d << "GLIndexBuffer: " << sizeof(GLIndexBuffer) << io::endl;
-    slog.d << "GLSamplerGroup: " << sizeof(GLSamplerGroup) << io::endl;
-    slog.d << "GLRenderPrimitive: " << sizeof(GLRenderPrimitive) << io::endl;
-    slog.d << "GLTexture: " << sizeof(GLTexture) << io::endl;
-    slog.d << "OpenGLProgram: " << sizeof(OpenGLProgram) << io::endl;
-    slog.d << "GLRenderTarget: " << sizeof(GLRenderTarget) << io::endl;
-    slog.d << "GLVertexBuffer: " << sizeof(GLVertexBuffer) << io::endl;
-    slog.d << "GLUniformBuffer: " << sizeof(GLUniformBuffer) << io::endl;
-    slog.d << "GLStream: " << sizeof(GLStream) << io::endl;
-#endif
-}
-
-void* OpenGLDriver::HandleAllocator::alloc(size_t size, size_t alignment, size_t extra) noexcept {
-    assert_invariant(size <= mPool2.getSize());
-    if (size <= mPool0.getSize()) return mPool0.alloc(size, 16, extra);
-    if (size <= mPool1.getSize()) return mPool1.alloc(size, 32, extra);
-    if (size <= mPool2.getSize()) return mPool2.alloc(size, 32, extra);
-    return nullptr;
-}
-
-void OpenGLDriver::HandleAllocator::free(void* p, size_t size) noexcept {
-    if (size <= mPool0.getSize()) { mPool0.free(p); return; }
-    if (size <= mPool1.getSize()) { mPool1.free(p); return; }
-    if (size <= mPool2.getSize()) { mPool2.free(p); return; }
-}
-
-
-// This is "NOINLINE" because it ends-up generating more code than we'd like because of
-// the locking (unfortunately, mHandleArena is accessed from 2 threads)
-UTILS_NOINLINE
-HandleBase::HandleId OpenGLDriver::allocateHandle(size_t size) noexcept {
-    void* addr = mHandleArena.alloc(size);
-    assert_invariant(addr);
-    char* const base = (char *)mHandleArena.getArea().begin();
-    size_t offset = (char*)addr - base;
-    return HandleBase::HandleId(offset >> HandleAllocator::MIN_ALIGNMENT_SHIFT);
-}
-
-template<typename D, typename ... ARGS>
-backend::Handle<D> OpenGLDriver::initHandle(ARGS&& ... args) noexcept {
-    static_assert(sizeof(D) <= 208, "Handle<> too large");
-    backend::Handle<D> h{ allocateHandle(sizeof(D)) };
-    D* addr = handle_cast<D *>(h);
-    new(addr) D(std::forward<ARGS>(args)...);
-#if !defined(NDEBUG) && UTILS_HAS_RTTI
-    addr->typeId = typeid(D).name();
-#endif
-    return h;
-}
-
-
-template<typename D, typename B, typename ... ARGS>
-typename std::enable_if<std::is_base_of<B, D>::value, D>::type*
-OpenGLDriver::construct(Handle<B> const& handle, ARGS&& ... args) noexcept {
-    assert_invariant(handle);
-    D* addr = handle_cast<D *>(const_cast<Handle<B>&>(handle));
-
-    // currently we implement construct<> with dtor+ctor, we could use operator= also
-    // but all our dtors are trivial, ~D() is actually a noop.
-    addr->~D();
-    new(addr) D(std::forward<ARGS>(args)...);
-
-#if !defined(NDEBUG) && UTILS_HAS_RTTI
-    addr->typeId = typeid(D).name();
-#endif
-    return addr;
-}
-
-template <typename B, typename D, typename>
-void OpenGLDriver::destruct(Handle<B>& handle, D const* p) noexcept {
-    // allow to destroy the nullptr, similarly to operator delete
-    if (p) {
-#if !defined(NDEBUG) && UTILS_HAS_RTTI
-        if (UTILS_UNLIKELY(p->typeId != typeid(D).name())) {
-            slog.e << "Destroying handle " << handle.getId() << ", type " << typeid(D).name()
-                   << ", but handle's actual type is " << p->typeId << io::endl;
-            std::terminate();
-        }
-        const_cast<D *>(p)->typeId = "(deleted)";
-#endif
-        p->~D();
-        mHandleArena.free(const_cast<D*>(p), sizeof(D));
-    }
-}
-
 Handle<HwVertexBuffer> OpenGLDriver::createVertexBufferS() noexcept {
     return initHandle<GLVertexBuffer>();
 }
@@ -510,6 +419,7 @@ void OpenGLDriver::createVertexBufferR(
         gl.bindBuffer(GL_ARRAY_BUFFER, vb->gl.buffers[i]);
         glBufferData(GL_ARRAY_BUFFER, size, nullptr, getBufferUsage(usage));
     }
+    mMemoryTracker.allocate(MemoryTracker::Category::BUFFER, MemoryTracker::getSize(*vb));
 
     CHECK_GL_ERROR(utils::slog.e)
 }
@@ -529,25 +439,30 @@ void OpenGLDriver::createIndexBufferR(
     gl.bindVertexArray(nullptr);
     gl.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib->gl.buffer);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, nullptr, getBufferUsage(usage));
+    mMemoryTracker.allocate(MemoryTracker::Category::BUFFER, size);
     CHECK_GL_ERROR(utils::slog.e)
 }
 
 void OpenGLDriver::createBufferObjectR(
         Handle<HwBufferObject> boh,
         uint32_t byteCount,
-        BufferObjectBinding bindingType) {
+        BufferObjectBinding bindingType,
+        BufferUsage usage) {
     DEBUG_MARKER()
 
     auto& gl = mContext;
-    GLBufferObject* bo = construct<GLBufferObject>(boh, byteCount);
+    GLBufferObject* bo = construct<GLBufferObject>(boh, byteCount, usage);
     glGenBuffers(1, &bo->gl.id);
     gl.bindVertexArray(nullptr);
 
     assert_invariant(byteCount > 0);
-    assert_invariant(bindingType == BufferObjectBinding::VERTEX);
+    assert_invariant(bindingType == BufferObjectBinding::VERTEX || gl.features.compute_shaders);
 
-    gl.bindBuffer(GL_ARRAY_BUFFER, bo->gl.id);
-    glBufferData(GL_ARRAY_BUFFER, byteCount, nullptr, GL_STATIC_DRAW);
+    bo->gl.binding = getBufferBindingTarget(bindingType);
+    gl.bindBuffer(bo->gl.binding, bo->gl.id);
+    glBufferData(bo->gl.binding, byteCount, nullptr,
+            bindingType == BufferObjectBinding::VERTEX ? getBufferUsage(usage) : GL_DYNAMIC_COPY);
+    mMemoryTracker.allocate(MemoryTracker::Category::BUFFER, byteCount);
     CHECK_GL_ERROR(utils::slog.e)
 }
 
@@ -562,7 +477,9 @@ void OpenGLDriver::createRenderPrimitiveR(Handle<HwRenderPrimitive> rph, int) {
 void OpenGLDriver::createProgramR(Handle<HwProgram> ph, Program&& program) {
     DEBUG_MARKER()
 
-    construct<OpenGLProgram>(ph, this, program);
+    // The program was default-constructed by createProgramS(), we initialize it in place rather
+    // than constructing it again, because isProgramReady() can read it from another thread.
+    handle_cast<OpenGLProgram*>(ph)->initialize(this, std::move(program));
     CHECK_GL_ERROR(utils::slog.e)
 }
 
@@ -583,6 +500,7 @@ void OpenGLDriver::createUniformBufferR(
     glGenBuffers(1, &ub->gl.ubo.id);
     gl.bindBuffer(GL_UNIFORM_BUFFER, ub->gl.ubo.id);
     glBufferData(GL_UNIFORM_BUFFER, size, nullptr, getBufferUsage(usage));
+    mMemoryTracker.allocate(MemoryTracker::Category::BUFFER, size);
     CHECK_GL_ERROR(utils::slog.e)
 }
 
@@ -596,6 +514,14 @@ void OpenGLDriver::textureStorage(OpenGLDriver::GLTexture* t,
     bindTexture(OpenGLContext::MAX_TEXTURE_UNIT_COUNT - 1, t);
     gl.activeTexture(OpenGLContext::MAX_TEXTURE_UNIT_COUNT - 1);
 
+#if SPARSE_TEXTURE_HEADERS
+    if (UTILS_UNLIKELY(any(t->usage & TextureUsage::SPARSE)) && gl.ext.EXT_sparse_texture) {
+        // this must be set before the storage is allocated, which then only reserves the
+        // address space. Without the extension, the texture is simply fully resident.
+        glTexParameteri(t->gl.target, GL_TEXTURE_SPARSE, GL_TRUE);
+    }
+#endif
+
     switch (t->gl.target) {
         case GL_TEXTURE_2D:
         case GL_TEXTURE_CUBE_MAP:
@@ -687,6 +613,7 @@ void OpenGLDriver::createTextureR(Handle<HwTexture> th, SamplerType target, uint
                 }
             }
             textureStorage(t, w, h, depth);
+            mMemoryTracker.allocate(*t);
         }
     } else {
         assert_invariant(any(usage & (
@@ -699,6 +626,7 @@ void OpenGLDriver::createTextureR(Handle<HwTexture> th, SamplerType target, uint
         t->gl.target = GL_RENDERBUFFER;
         glGenRenderbuffers(1, &t->gl.id);
         renderBufferStorage(t->gl.id, t->gl.internalFormat, w, h, samples);
+        mMemoryTracker.allocate(*t);
     }
 
     CHECK_GL_ERROR(utils::slog.e)
@@ -1020,6 +948,10 @@ void OpenGLDriver::framebufferTexture(backend::TargetBufferInfo const& binfo,
         glGenRenderbuffers(1, &pRenderBuffer->rb);
         renderBufferStorage(pRenderBuffer->rb,
                 t->gl.internalFormat, rt->width, rt->height, rt->gl.samples);
+        const HwTexture sidecar(SamplerType::SAMPLER_2D, 1, rt->gl.samples,
+                rt->width, rt->height, 1, t->format, TextureUsage::COLOR_ATTACHMENT);
+        rt->gl.sidecarSize += MemoryTracker::getSize(sidecar);
+        mMemoryTracker.allocate(sidecar);
 
         glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, pRenderBuffer->rb);
 
@@ -1292,6 +1224,7 @@ void OpenGLDriver::destroyVertexBuffer(Handle<HwVertexBuffer> vbh) {
         GLsizei n = GLsizei(eb->bufferCount);
         const auto& buffers = eb->gl.buffers;
         gl.deleteBuffers(n, buffers.data(), GL_ARRAY_BUFFER);
+        mMemoryTracker.free(MemoryTracker::Category::BUFFER, MemoryTracker::getSize(*eb));
         destruct(vbh, eb);
     }
 }
@@ -1303,6 +1236,7 @@ void OpenGLDriver::destroyIndexBuffer(Handle<HwIndexBuffer> ibh) {
         auto& gl = mContext;
         GLIndexBuffer const* ib = handle_cast<const GLIndexBuffer*>(ibh);
         gl.deleteBuffers(1, &ib->gl.buffer, GL_ELEMENT_ARRAY_BUFFER);
+        mMemoryTracker.free(MemoryTracker::Category::BUFFER, ib->elementSize * ib->count);
         destruct(ibh, ib);
     }
 }
@@ -1313,7 +1247,8 @@ void OpenGLDriver::destroyBufferObject(Handle<HwBufferObject> boh) {
     if (boh) {
         auto& gl = mContext;
         GLBufferObject const* bo = handle_cast<const GLBufferObject*>(boh);
-        gl.deleteBuffers(1, &bo->gl.id, GL_ARRAY_BUFFER);
+        gl.deleteBuffers(1, &bo->gl.id, bo->gl.binding);
+        mMemoryTracker.free(MemoryTracker::Category::BUFFER, bo->byteCount);
         destruct(boh, bo);
     }
 }
@@ -1351,6 +1286,7 @@ void OpenGLDriver::destroyUniformBuffer(Handle<HwUniformBuffer> ubh) {
         auto& gl = mContext;
         GLUniformBuffer* ub = handle_cast<GLUniformBuffer*>(ubh);
         gl.deleteBuffers(1, &ub->gl.ubo.id, GL_UNIFORM_BUFFER);
+        mMemoryTracker.free(MemoryTracker::Category::BUFFER, ub->gl.ubo.capacity);
         destruct(ubh, ub);
     }
 }
@@ -1371,10 +1307,12 @@ void OpenGLDriver::destroyTexture(Handle<HwTexture> th) {
                     mPlatform.destroyExternalImage(t);
                 } else {
                     glDeleteTextures(1, &t->gl.id);
+                    mMemoryTracker.free(*t);
                 }
             } else {
                 assert_invariant(t->gl.target == GL_RENDERBUFFER);
                 glDeleteRenderbuffers(1, &t->gl.id);
+                mMemoryTracker.free(*t);
             }
             if (t->gl.fence) {
                 glDeleteSync(t->gl.fence);
@@ -1413,6 +1351,7 @@ void OpenGLDriver::destroyRenderTarget(Handle<HwRenderTarget> rth) {
         if (rt->gl.stencil.rb) {
             glDeleteRenderbuffers(1, &rt->gl.stencil.rb);
         }
+        mMemoryTracker.free(MemoryTracker::Category::RENDER_TARGET, rt->gl.sidecarSize);
         destruct(rth, rt);
     }
 }
@@ -1496,14 +1435,16 @@ Handle<HwStream> OpenGLDriver::createStreamAcquired() {
 // setAcquiredImage should be called by the user outside of beginFrame / endFrame, and should be
 // called only once per frame. If the user pushes images to the same stream multiple times in a
 // single frame, we emit a warning and honor only the final image, but still invoke all callbacks.
-void OpenGLDriver::setAcquiredImage(Handle<HwStream> sh, void* hwbuffer,
+void OpenGLDriver::setAcquiredImage(Handle<HwStream> sh, void* hwbuffer, int fence,
         backend::StreamCallback cb, void* userData) {
     GLStream* glstream = handle_cast<GLStream*>(sh);
     if (glstream->user_thread.pending.image) {
+        mPlatform.destroyAcquiredImageFence(glstream->user_thread.pending.fence);
         scheduleRelease(std::move(glstream->user_thread.pending));
         slog.w << "Acquired image is set more than once per frame." << io::endl;
     }
-    glstream->user_thread.pending = mPlatform.transformAcquiredImage({hwbuffer, cb, userData});
+    glstream->user_thread.pending = mPlatform.transformAcquiredImage(
+            { hwbuffer, cb, userData, fence });
 }
 
 void OpenGLDriver::updateStreams(DriverApi* driver) {
@@ -1703,6 +1644,13 @@ math::float2 OpenGLDriver::getClipSpaceParams() {
 // ------------------------------------------------------------------------------------------------
 
 
+void OpenGLDriver::setDamageRegion(Handle<HwSwapChain> sch, Viewport region) {
+    DEBUG_MARKER()
+
+    HwSwapChain* sc = handle_cast<HwSwapChain*>(sch);
+    mPlatform.setDamageRegion(sc->swapChain, region);
+}
+
 void OpenGLDriver::commit(Handle<HwSwapChain> sch) {
     DEBUG_MARKER()
 
@@ -1770,8 +1718,13 @@ void OpenGLDriver::updateBufferObject(
     assert_invariant(bd.size + byteOffset <= bo->byteCount);
 
     gl.bindVertexArray(nullptr);
-    gl.bindBuffer(GL_ARRAY_BUFFER, bo->gl.id);
-    glBufferSubData(GL_ARRAY_BUFFER, byteOffset, bd.size, bd.buffer);
+    gl.bindBuffer(bo->gl.binding, bo->gl.id);
+    if (bo->usage != BufferUsage::STATIC && byteOffset == 0 && bd.size == bo->byteCount) {
+        // The whole buffer is rewritten, orphan it so the GPU can keep reading the previous
+        // storage while we upload, instead of stalling until the draws using it are done.
+        glBufferData(bo->gl.binding, bo->byteCount, nullptr, getBufferUsage(bo->usage));
+    }
+    glBufferSubData(bo->gl.binding, byteOffset, bd.size, bd.buffer);
 
     scheduleDestroy(std::move(bd));
 
@@ -1791,6 +1744,24 @@ void OpenGLDriver::loadUniformBuffer(Handle<HwUniformBuffer> ubh, BufferDescript
     scheduleDestroy(std::move(p));
 }
 
+void OpenGLDriver::updateUniformBuffer(Handle<HwUniformBuffer> ubh, BufferDescriptor&& p,
+        uint32_t byteOffset) {
+    DEBUG_MARKER()
+
+    GLUniformBuffer* ub = handle_cast<GLUniformBuffer *>(ubh);
+    GLBuffer* const buffer = &ub->gl.ubo;
+    assert_invariant(byteOffset + p.size <= buffer->capacity);
+
+    if (p.size > 0) {
+        auto& gl = mContext;
+        gl.bindBuffer(GL_UNIFORM_BUFFER, buffer->id);
+        // STREAM buffers rotate inside their storage, the current data starts at base
+        glBufferSubData(GL_UNIFORM_BUFFER, buffer->base + byteOffset, p.size, p.buffer);
+        CHECK_GL_ERROR(utils::slog.e)
+    }
+    scheduleDestroy(std::move(p));
+}
+
 void OpenGLDriver::updateBuffer(GLenum target,
         GLBuffer* buffer, BufferDescriptor const& p, uint32_t alignment) noexcept {
     assert_invariant(buffer->capacity >= p.size);
@@ -1860,6 +1831,17 @@ void OpenGLDriver::updateSamplerGroup(Handle<HwSamplerGroup> sbh,
     DEBUG_MARKER()
 
     GLSamplerGroup* sb = handle_cast<GLSamplerGroup *>(sbh);
+
+    // only the slots whose parameters change need their sampler object to be looked up again
+    SamplerGroup::Sampler const* const curr = sb->sb->getSamplers();
+    SamplerGroup::Sampler const* const next = samplerGroup.getSamplers();
+    assert_invariant(sb->sb->getSize() == samplerGroup.getSize());
+    for (size_t i = 0, c = std::min(sb->sb->getSize(), samplerGroup.getSize()); i < c; i++) {
+        if (curr[i].s.u != next[i].s.u) {
+            sb->samplers[i] = 0;
+        }
+    }
+
     *sb->sb = std::move(samplerGroup); // NOLINT(performance-move-const-arg)
 }
 
@@ -1896,6 +1878,28 @@ void OpenGLDriver::setMinMaxLevels(Handle<HwTexture> th, uint32_t minLevel, uint
     glTexParameteri(t->gl.target, GL_TEXTURE_MAX_LEVEL, t->gl.maxLevel);
 }
 
+void OpenGLDriver::commitTexturePages(Handle<HwTexture> th, uint32_t level,
+        uint32_t xoffset, uint32_t yoffset, uint32_t zoffset,
+        uint32_t width, uint32_t height, uint32_t depth, bool commit) {
+    DEBUG_MARKER()
+    auto& gl = mContext;
+
+    GLTexture* t = handle_cast<GLTexture *>(th);
+    assert_invariant(any(t->usage & TextureUsage::SPARSE));
+
+#if SPARSE_TEXTURE_HEADERS
+    if (gl.ext.EXT_sparse_texture) {
+        bindTexture(OpenGLContext::MAX_TEXTURE_UNIT_COUNT - 1, t);
+        gl.activeTexture(OpenGLContext::MAX_TEXTURE_UNIT_COUNT - 1);
+        // the region must be a multiple of the page size, or reach the edge of the level
+        glTexPageCommitment(t->gl.target, GLint(level),
+                GLint(xoffset), GLint(yoffset), GLint(zoffset),
+                GLsizei(width), GLsizei(height), GLsizei(depth), commit ? GL_TRUE : GL_FALSE);
+        CHECK_GL_ERROR(utils::slog.e)
+    }
+#endif
+}
+
 void OpenGLDriver::update3DImage(Handle<HwTexture> th,
         uint32_t level, uint32_t xoffset, uint32_t yoffset, uint32_t zoffset,
         uint32_t width, uint32_t height, uint32_t depth,
@@ -1950,6 +1954,53 @@ bool OpenGLDriver::canGenerateMipmaps() {
     return true;
 }
 
+bool OpenGLDriver::isComputeSupported() {
+    return mContext.features.compute_shaders;
+}
+
+bool OpenGLDriver::isDrawIndirectSupported() {
+    // glDrawElementsIndirect is core in GL ES 3.1 and GL 4.3, like compute shaders
+    return mContext.features.compute_shaders;
+}
+
+bool OpenGLDriver::isDepthReadbackSupported() {
+    // glReadPixels() only accepts GL_DEPTH_COMPONENT on desktop GL
+    return mContext.getShaderModel() == ShaderModel::GL_CORE_41;
+}
+
+bool OpenGLDriver::isShadingRateSupported() {
+    return false;
+}
+
+math::uint3 OpenGLDriver::getSparseTexturePageSize(SamplerType target, TextureFormat format) {
+    math::uint3 size{};
+#if SPARSE_TEXTURE_HEADERS
+    if (mContext.ext.EXT_sparse_texture) {
+        GLenum glTarget = GL_TEXTURE_2D;
+        switch (target) {
+            case SamplerType::SAMPLER_2D:       glTarget = GL_TEXTURE_2D;           break;
+            case SamplerType::SAMPLER_2D_ARRAY: glTarget = GL_TEXTURE_2D_ARRAY;     break;
+            case SamplerType::SAMPLER_CUBEMAP:  glTarget = GL_TEXTURE_CUBE_MAP;     break;
+            case SamplerType::SAMPLER_3D:       glTarget = GL_TEXTURE_3D;           break;
+            case SamplerType::SAMPLER_EXTERNAL: return size;
+        }
+        GLenum const internalFormat = getInternalFormat(format);
+        GLint count = 0;
+        glGetInternalformativ(glTarget, internalFormat, GL_NUM_VIRTUAL_PAGE_SIZES, 1, &count);
+        if (count > 0) {
+            // we always use the first page size, which is the default GL_VIRTUAL_PAGE_SIZE_INDEX
+            GLint x = 0, y = 0, z = 0;
+            glGetInternalformativ(glTarget, internalFormat, GL_VIRTUAL_PAGE_SIZE_X, 1, &x);
+            glGetInternalformativ(glTarget, internalFormat, GL_VIRTUAL_PAGE_SIZE_Y, 1, &y);
+            glGetInternalformativ(glTarget, internalFormat, GL_VIRTUAL_PAGE_SIZE_Z, 1, &z);
+            size = { uint32_t(x), uint32_t(y), uint32_t(z) };
+        }
+        CHECK_GL_ERROR(utils::slog.e)
+    }
+#endif
+    return size;
+}
+
 void OpenGLDriver::setTextureData(GLTexture* t,
         uint32_t level,
         uint32_t xoffset, uint32_t yoffset, uint32_t zoffset,
@@ -2322,6 +2373,11 @@ SyncStatus OpenGLDriver::getSyncStatus(Handle<HwSync> sh) {
     }
 }
 
+bool OpenGLDriver::isProgramReady(Handle<HwProgram> ph) {
+    OpenGLProgram const* const p = handle_cast<OpenGLProgram const*>(ph);
+    return p->isReady();
+}
+
 void OpenGLDriver::beginRenderPass(Handle<HwRenderTarget> rth,
         const RenderPassParams& params) {
     DEBUG_MARKER()
@@ -2364,7 +2420,7 @@ void OpenGLDriver::beginRenderPass(Handle<HwRenderTarget> rth,
 
     if (any(clearFlags)) {
         gl.disable(GL_SCISSOR_TEST);
-        clearWithRasterPipe(clearFlags,
+        clearWithRasterPipe(rt, clearFlags,
                 params.clearColor, params.clearDepth, params.clearStencil);
     }
 
@@ -2381,7 +2437,7 @@ void OpenGLDriver::beginRenderPass(Handle<HwRenderTarget> rth,
     // clear the discarded (but not the cleared ones) buffers in debug builds
     mContext.bindFramebuffer(GL_FRAMEBUFFER, rt->gl.fbo);
     mContext.disable(GL_SCISSOR_TEST);
-    clearWithRasterPipe(discardFlags & ~clearFlags,
+    clearWithRasterPipe(rt, discardFlags & ~clearFlags,
             { 1, 0, 0, 1 }, 1.0, 0);
 #endif
 }
@@ -2425,7 +2481,7 @@ void OpenGLDriver::endRenderPass(int) {
     // clear the discarded buffers in debug builds
     mContext.bindFramebuffer(GL_FRAMEBUFFER, rt->gl.fbo);
     mContext.disable(GL_SCISSOR_TEST);
-    clearWithRasterPipe(discardFlags,
+    clearWithRasterPipe(rt, discardFlags,
             { 0, 1, 0, 1 }, 1.0, 0);
 #endif
 
@@ -2584,13 +2640,22 @@ void OpenGLDriver::updateStreamAcquired(GLTexture* gltexture, DriverApi* driver)
     glstream->user_thread.acquired = glstream->user_thread.pending;
     glstream->user_thread.pending = {0};
 
+    // The fence is consumed by the driver thread, below.
+    const int fence = glstream->user_thread.acquired.fence;
+    glstream->user_thread.acquired.fence = -1;
+
     // Bind the stashed EGLImage to its corresponding GL texture as soon as we start making the GL
-    // calls for the upcoming frame.
+    // calls for the upcoming frame. The GPU waits for the producer's fence, not the CPU.
     void* image = glstream->user_thread.acquired.image;
-    driver->queueCommand([this, gltexture, image, previousImage]() {
+    driver->queueCommand([this, gltexture, image, fence, previousImage]() {
+        mPlatform.waitAcquiredImageFence(fence);
         setExternalTexture(gltexture, image);
         if (previousImage.image) {
-            scheduleRelease(AcquiredImage(previousImage));
+            // the previous image can still be read by the GPU, the producer gets it back
+            // only once the commands issued so far have completed.
+            whenGpuCommandsComplete([this, previousImage]() {
+                scheduleRelease(AcquiredImage(previousImage));
+            });
         }
     });
 }
@@ -2803,6 +2868,21 @@ void OpenGLDriver::bindSamplers(size_t index, Handle<HwSamplerGroup> sbh) {
     CHECK_GL_ERROR(utils::slog.e)
 }
 
+void OpenGLDriver::bindStorageBuffer(size_t index, Handle<HwBufferObject> boh) {
+    DEBUG_MARKER()
+    auto& gl = mContext;
+
+    if (UTILS_UNLIKELY(!gl.features.compute_shaders)) {
+        return;
+    }
+
+    GLBufferObject* bo = handle_cast<GLBufferObject*>(boh);
+    assert_invariant(index < MAX_STORAGE_BUFFER_COUNT);
+    assert_invariant(bo->gl.binding == GL_SHADER_STORAGE_BUFFER);
+    gl.bindBufferRange(GL_SHADER_STORAGE_BUFFER, GLuint(index), bo->gl.id, 0, bo->byteCount);
+    CHECK_GL_ERROR(utils::slog.e)
+}
+
 
 GLuint OpenGLDriver::getSamplerSlow(SamplerParams params) const noexcept {
     assert_invariant(mSamplerMap.find(params.u) == mSamplerMap.end());
@@ -2918,17 +2998,17 @@ void OpenGLDriver::readPixels(Handle<HwRenderTarget> src,
     GLRenderTarget const* s = handle_cast<GLRenderTarget const*>(src);
     gl.bindFramebuffer(GL_READ_FRAMEBUFFER, s->gl.fbo);
 
-    GLuint pbo;
-    glGenBuffers(1, &pbo);
-    gl.bindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
-    glBufferData(GL_PIXEL_PACK_BUFFER, p.size, nullptr, GL_STATIC_DRAW);
+    // the pixels are copied into a pack buffer and only mapped once the fence below signaled,
+    // so consecutive readbacks are pipelined with the rendering of the next frames.
+    GLsizeiptr capacity = GLsizeiptr(p.size);
+    GLuint const pbo = acquireReadPixelsBuffer(&capacity);
     glReadPixels(GLint(x), GLint(y), GLint(width), GLint(height), glFormat, glType, nullptr);
     gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 
     // we're forced to make a copy on the heap because otherwise it deletes std::function<> copy
     // constructor.
     auto* pUserBuffer = new PixelBufferDescriptor(std::move(p));
-    whenGpuCommandsComplete([this, width, height, pbo, pUserBuffer]() mutable {
+    whenGpuCommandsComplete([this, width, height, pbo, capacity, pUserBuffer]() mutable {
         PixelBufferDescriptor& p = *pUserBuffer;
         auto& gl = mContext;
         gl.bindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
@@ -2950,7 +3030,7 @@ void OpenGLDriver::readPixels(Handle<HwRenderTarget> src,
             glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
         }
         gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
-        glDeleteBuffers(1, &pbo);
+        releaseReadPixelsBuffer(pbo, capacity);
         scheduleDestroy(std::move(p));
         delete pUserBuffer;
         CHECK_GL_ERROR(utils::slog.e)
@@ -2959,6 +3039,43 @@ void OpenGLDriver::readPixels(Handle<HwRenderTarget> src,
     CHECK_GL_ERROR(utils::slog.e)
 }
 
+GLuint OpenGLDriver::acquireReadPixelsBuffer(GLsizeiptr* capacity) noexcept {
+    auto& gl = mContext;
+    auto& v = mReadPixelsBuffers;
+    GLsizeiptr const size = *capacity;
+    // the smallest free buffer that's large enough
+    auto best = v.end();
+    for (auto it = v.begin(); it != v.end(); ++it) {
+        if (it->second >= size && (best == v.end() || it->second < best->second)) {
+            best = it;
+        }
+    }
+    GLuint pbo;
+    if (best != v.end()) {
+        pbo = best->first;
+        *capacity = best->second;
+        v.erase(best);
+        gl.bindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+    } else {
+        glGenBuffers(1, &pbo);
+        gl.bindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        mMemoryTracker.allocate(MemoryTracker::Category::STAGING, size_t(size));
+    }
+    return pbo;
+}
+
+void OpenGLDriver::releaseReadPixelsBuffer(GLuint pbo, GLsizeiptr capacity) noexcept {
+    auto& v = mReadPixelsBuffers;
+    if (v.size() == MAX_READ_PIXELS_BUFFERS) {
+        // evict the oldest buffer
+        glDeleteBuffers(1, &v.front().first);
+        mMemoryTracker.free(MemoryTracker::Category::STAGING, size_t(v.front().second));
+        v.erase(v.begin());
+    }
+    v.emplace_back(pbo, capacity);
+}
+
 void OpenGLDriver::whenGpuCommandsComplete(std::function<void()> fn) noexcept {
     GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
     mGpuCommandCompleteOps.emplace_back(sync, std::move(fn));
@@ -3013,6 +3130,7 @@ void OpenGLDriver::tick(int) {
 void OpenGLDriver::beginFrame(int64_t monotonic_clock_ns, uint32_t frameId) {
     auto& gl = mContext;
     insertEventMarker("beginFrame");
+    gl.resetStateCacheStatistics();
     if (UTILS_UNLIKELY(!mExternalStreams.empty())) {
         OpenGLPlatform& platform = mPlatform;
         for (GLTexture const* t : mExternalStreams) {
@@ -3046,6 +3164,12 @@ void OpenGLDriver::endFrame(uint32_t frameId) {
     //SYSTRACE_NAME("glFinish");
     //glFinish();
     insertEventMarker("endFrame");
+#ifndef NDEBUG
+    SYSTRACE_CONTEXT();
+    auto const& stats = mContext.getStateCacheStatistics();
+    SYSTRACE_VALUE32("GL state changes (issued)", stats.issued);
+    SYSTRACE_VALUE32("GL state changes (elided)", stats.elided);
+#endif
 }
 
 void OpenGLDriver::flush(int) {
@@ -3072,8 +3196,51 @@ void OpenGLDriver::finish(int) {
     // The fallout of this is that we can't assert that mEveryNowAndThenOps is empty.
 }
 
+// glClearBufferfv() is undefined with integer attachments, which need the variant of their type
+static void clearColorBuffer(OpenGLDriver::GLRenderTarget const* rt, GLint index,
+        math::float4 const& linearColor) noexcept {
+    OpenGLDriver::GLTexture const* t = rt->gl.color[index].texture;
+    switch (t ? t->format : TextureFormat::RGBA8) {
+        case TextureFormat::R8UI:
+        case TextureFormat::R16UI:
+        case TextureFormat::R32UI:
+        case TextureFormat::RG8UI:
+        case TextureFormat::RG16UI:
+        case TextureFormat::RG32UI:
+        case TextureFormat::RGB8UI:
+        case TextureFormat::RGB16UI:
+        case TextureFormat::RGB32UI:
+        case TextureFormat::RGBA8UI:
+        case TextureFormat::RGBA16UI:
+        case TextureFormat::RGBA32UI: {
+            const math::uint4 color(linearColor);
+            glClearBufferuiv(GL_COLOR, index, color.v);
+            break;
+        }
+        case TextureFormat::R8I:
+        case TextureFormat::R16I:
+        case TextureFormat::R32I:
+        case TextureFormat::RG8I:
+        case TextureFormat::RG16I:
+        case TextureFormat::RG32I:
+        case TextureFormat::RGB8I:
+        case TextureFormat::RGB16I:
+        case TextureFormat::RGB32I:
+        case TextureFormat::RGBA8I:
+        case TextureFormat::RGBA16I:
+        case TextureFormat::RGBA32I: {
+            const math::int4 color(linearColor);
+            glClearBufferiv(GL_COLOR, index, color.v);
+            break;
+        }
+        default:
+            glClearBufferfv(GL_COLOR, index, linearColor.v);
+            break;
+    }
+}
+
 UTILS_NOINLINE
-void OpenGLDriver::clearWithRasterPipe(TargetBufferFlags clearFlags,
+void OpenGLDriver::clearWithRasterPipe(GLRenderTarget const* rt, TargetBufferFlags clearFlags,
         math::float4 const& linearColor, GLfloat depth, GLint stencil) noexcept {
     DEBUG_MARKER()
     RasterState rs(mRasterState);
@@ -3090,16 +3257,16 @@ void OpenGLDriver::clearWithRasterPipe(TargetBufferFlags clearFlags,
     }
 
     if (any(clearFlags & TargetBufferFlags::COLOR0)) {
-        glClearBufferfv(GL_COLOR, 0, linearColor.v);
+        clearColorBuffer(rt, 0, linearColor);
     }
     if (any(clearFlags & TargetBufferFlags::COLOR1)) {
-        glClearBufferfv(GL_COLOR, 1, linearColor.v);
+        clearColorBuffer(rt, 1, linearColor);
     }
     if (any(clearFlags & TargetBufferFlags::COLOR2)) {
-        glClearBufferfv(GL_COLOR, 2, linearColor.v);
+        clearColorBuffer(rt, 2, linearColor);
     }
     if (any(clearFlags & TargetBufferFlags::COLOR3)) {
-        glClearBufferfv(GL_COLOR, 3, linearColor.v);
+        clearColorBuffer(rt, 3, linearColor);
     }
 
     if ((clearFlags & TargetBufferFlags::DEPTH_AND_STENCIL) == TargetBufferFlags::DEPTH_AND_STENCIL) {
@@ -3195,12 +3362,16 @@ void OpenGLDriver::updateTextureLodRange(GLTexture* texture, int8_t targetLevel)
     }
 }
 
-void OpenGLDriver::draw(PipelineState state, Handle<HwRenderPrimitive> rph) {
+void OpenGLDriver::draw(PipelineState state, Handle<HwRenderPrimitive> rph,
+        uint32_t instanceCount) {
     DEBUG_MARKER()
     auto& gl = mContext;
 
     OpenGLProgram* p = handle_cast<OpenGLProgram*>(state.program);
 
+    // if the program is still compiling in parallel, we have no choice but to wait for it
+    p->wait(this);
+
     // If the material debugger is enabled, avoid fatal (or cascading) errors and that can occur
     // during the draw call when the program is invalid. The shader compile error has already been
     // dumped to the console at this point, so it's fine to simply return early.
@@ -3232,8 +3403,92 @@ void OpenGLDriver::draw(PipelineState state, Handle<HwRenderPrimitive> rph) {
 
     setViewportScissor(state.scissor);
 
-    glDrawRangeElements(GLenum(rp->type), rp->minIndex, rp->maxIndex, rp->count,
-            rp->gl.indicesType, reinterpret_cast<const void*>(rp->offset));
+    if (UTILS_LIKELY(instanceCount <= 1)) {
+        glDrawRangeElements(GLenum(rp->type), rp->minIndex, rp->maxIndex, rp->count,
+                rp->gl.indicesType, reinterpret_cast<const void*>(rp->offset));
+    } else {
+        glDrawElementsInstanced(GLenum(rp->type), rp->count,
+                rp->gl.indicesType, reinterpret_cast<const void*>(rp->offset),
+                GLsizei(instanceCount));
+    }
+
+    CHECK_GL_ERROR(utils::slog.e)
+}
+
+void OpenGLDriver::drawIndirect(PipelineState state, Handle<HwRenderPrimitive> rph,
+        Handle<HwBufferObject> boh, uint32_t offset) {
+    DEBUG_MARKER()
+    auto& gl = mContext;
+
+    if (UTILS_UNLIKELY(!isDrawIndirectSupported())) {
+        return;
+    }
+
+    OpenGLProgram* p = handle_cast<OpenGLProgram*>(state.program);
+    p->wait(this);
+    if (UTILS_UNLIKELY(!p->isValid())) {
+        return;
+    }
+
+    useProgram(p);
+
+    GLRenderPrimitive* rp = handle_cast<GLRenderPrimitive *>(rph);
+    VertexBufferHandle vb = rp->gl.vertexBufferWithObjects;
+    if (UTILS_UNLIKELY(!vb)) {
+        return;
+    }
+
+    gl.bindVertexArray(&rp->gl);
+
+    const GLVertexBuffer* glvb = handle_cast<GLVertexBuffer*>(vb);
+    if (UTILS_UNLIKELY(rp->gl.vertexBufferVersion != glvb->bufferObjectsVersion)) {
+        updateVertexArrayObject(rp, glvb);
+    }
+
+    setRasterState(state.rasterState);
+
+    gl.polygonOffset(state.polygonOffset.slope, state.polygonOffset.constant);
+
+    setViewportScissor(state.scissor);
+
+    GLBufferObject const* bo = handle_cast<GLBufferObject const*>(boh);
+    assert_invariant(bo->gl.binding == GL_DRAW_INDIRECT_BUFFER ||
+            bo->gl.binding == GL_SHADER_STORAGE_BUFFER);
+    assert_invariant(offset % 4 == 0 && offset + 20 <= bo->byteCount);
+    gl.bindBuffer(GL_DRAW_INDIRECT_BUFFER, bo->gl.id);
+
+#if COMPUTE_HEADERS
+    // the command's firstIndex is relative to the start of the index buffer
+    glDrawElementsIndirect(GLenum(rp->type), rp->gl.indicesType,
+            reinterpret_cast<const void*>(uintptr_t(offset)));
+#endif
+
+    CHECK_GL_ERROR(utils::slog.e)
+}
+
+void OpenGLDriver::dispatchCompute(Handle<HwProgram> ph, math::uint3 workGroupCount) {
+    DEBUG_MARKER()
+
+    if (UTILS_UNLIKELY(!mContext.features.compute_shaders)) {
+        return;
+    }
+
+    OpenGLProgram* p = handle_cast<OpenGLProgram*>(ph);
+    p->wait(this);
+    if (UTILS_UNLIKELY(!p->isValid())) {
+        return;
+    }
+
+    useProgram(p);
+
+#if COMPUTE_HEADERS
+    glDispatchCompute(workGroupCount.x, workGroupCount.y, workGroupCount.z);
+
+    // make the results visible to the commands that can consume them
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_UNIFORM_BARRIER_BIT |
+            GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT |
+            GL_COMMAND_BARRIER_BIT);
+#endif
 
     CHECK_GL_ERROR(utils::slog.e)
 }
@@ -19,6 +19,7 @@
 
 #include "private/backend/Driver.h"
 #include "DriverBase.h"
+#include "HandleAllocator.h"
 #include "OpenGLContext.h"
 
 #include <utils/compiler.h>
@@ -71,10 +72,13 @@ public:
 
     struct GLBufferObject : public backend::HwBufferObject {
         using HwBufferObject::HwBufferObject;
-        GLBufferObject(uint32_t size) noexcept : HwBufferObject(size) {}
+        GLBufferObject(uint32_t size, backend::BufferUsage usage) noexcept
+                : HwBufferObject(size), usage(usage) {}
         struct {
             GLuint id = 0;
+            GLenum binding = 0;
         } gl;
+        backend::BufferUsage usage = backend::BufferUsage::STATIC;
     };
 
     struct GLVertexBuffer : public backend::HwVertexBuffer {
@@ -104,7 +108,12 @@ public:
     };
 
     struct GLSamplerGroup : public backend::HwSamplerGroup {
-        using HwSamplerGroup::HwSamplerGroup;
+        GLSamplerGroup() noexcept = default;
+        explicit GLSamplerGroup(size_t size) noexcept
+                : HwSamplerGroup(size), samplers(new GLuint[size]()) { }
+        // the sampler object of each slot, looked up when first used after the slot's
+        // parameters changed, 0 until then. This avoids a lookup in mSamplerMap per draw call.
+        std::unique_ptr<GLuint[]> samplers;
     };
 
     struct GLRenderPrimitive : public backend::HwRenderPrimitive {
@@ -197,6 +206,7 @@ public:
             RenderBuffer stencil;
             GLuint fbo = 0;
             mutable GLuint fbo_read = 0;
+            mutable uint32_t sidecarSize = 0; // bytes allocated for the sidecar renderbuffers
             mutable backend::TargetBufferFlags resolve = backend::TargetBufferFlags::NONE; // attachments in fbo_draw to resolve
             uint8_t samples : 4;
         } gl;
@@ -217,6 +227,11 @@ public:
     OpenGLDriver(OpenGLDriver const&) = delete;
     OpenGLDriver& operator=(OpenGLDriver const&) = delete;
 
+    // State changes issued and elided by the GL state cache since beginFrame(), debug builds only.
+    OpenGLContext::StateCacheStatistics const& getStateCacheStatistics() const noexcept {
+        return mContext.getStateCacheStatistics();
+    }
+
 private:
     OpenGLContext mContext;
 
@@ -245,42 +260,25 @@ private:
 
     // Memory management...
 
-    class HandleAllocator {
-        utils::PoolAllocator< 16, 16>   mPool0;
-        utils::PoolAllocator< 64, 32>   mPool1;
-        utils::PoolAllocator<208, 32>   mPool2;
-    public:
-        static constexpr size_t MIN_ALIGNMENT_SHIFT = 4;
-        explicit HandleAllocator(const utils::HeapArea& area);
-        void* alloc(size_t size, size_t alignment, size_t extra = 0) noexcept;
-        void free(void* p, size_t size) noexcept;
-    };
-
-    // the arenas for handle allocation needs to be thread-safe
-#ifndef NDEBUG
-    using HandleArena = utils::Arena<HandleAllocator,
-            utils::LockingPolicy::SpinLock,
-            utils::TrackingPolicy::Debug>;
-#else
-    using HandleArena = utils::Arena<HandleAllocator,
-            utils::LockingPolicy::SpinLock>;
-#endif
-
-    HandleArena mHandleArena;
-
-    backend::HandleBase::HandleId allocateHandle(size_t size) noexcept;
+    using HandleAllocatorGL = backend::HandleAllocator<16, 64, 208>;
+    HandleAllocatorGL mHandleAllocator;
 
     template<typename D, typename ... ARGS>
-    backend::Handle<D> initHandle(ARGS&& ... args) noexcept;
+    backend::Handle<D> initHandle(ARGS&& ... args) noexcept {
+        return mHandleAllocator.allocateAndConstruct<D>(std::forward<ARGS>(args) ...);
+    }
 
     template<typename D, typename B, typename ... ARGS>
     typename std::enable_if<std::is_base_of<B, D>::value, D>::type*
-            construct(backend::Handle<B> const& handle, ARGS&& ... args) noexcept;
+    construct(backend::Handle<B> const& handle, ARGS&& ... args) noexcept {
+        return mHandleAllocator.destroyAndConstruct<D, B>(handle, std::forward<ARGS>(args) ...);
+    }
 
     template<typename B, typename D,
             typename = typename std::enable_if<std::is_base_of<B, D>::value, D>::type>
-    void destruct(backend::Handle<B>& handle, D const* p) noexcept;
-
+    void destruct(backend::Handle<B>& handle, D const* p) noexcept {
+        mHandleAllocator.deallocate(handle, p);
+    }
 
     /*
      * handle_cast
@@ -294,13 +292,7 @@ private:
             std::is_pointer<Dp>::value &&
             std::is_base_of<B, typename std::remove_pointer<Dp>::type>::value, Dp>::type
     handle_cast(backend::Handle<B>& handle) noexcept {
-        assert_invariant(handle);
-        if (!handle) return nullptr; // better to get a NPE than random behavior/corruption
-        char* const base = (char *)mHandleArena.getArea().begin();
-        size_t offset = handle.getId() << HandleAllocator::MIN_ALIGNMENT_SHIFT;
-        // assert that this handle is even a valid one
-        assert_invariant(base + offset + sizeof(typename std::remove_pointer<Dp>::type) <= (char *)mHandleArena.getArea().end());
-        return static_cast<Dp>(static_cast<void *>(base + offset));
+        return mHandleAllocator.handle_cast<Dp, B>(handle);
     }
 
     template<typename Dp, typename B>
@@ -309,7 +301,7 @@ private:
             std::is_pointer<Dp>::value &&
             std::is_base_of<B, typename std::remove_pointer<Dp>::type>::value, Dp>::type
     handle_cast(backend::Handle<B> const& handle) noexcept {
-        return handle_cast<Dp>(const_cast<backend::Handle<B>&>(handle));
+        return mHandleAllocator.handle_cast<Dp, B>(handle);
     }
 
     friend class OpenGLProgram;
@@ -357,7 +349,6 @@ private:
     /* State tracking GL wrappers... */
 
            void bindTexture(GLuint unit, GLTexture const* t) noexcept;
-           void bindSampler(GLuint unit, backend::SamplerParams params) noexcept;
     inline void useProgram(OpenGLProgram* p) noexcept;
 
     enum class ResolveAction { LOAD, STORE };
@@ -393,7 +384,7 @@ private:
     GLboolean mRenderPassColorWrite{};
     GLboolean mRenderPassDepthWrite{};
 
-    void clearWithRasterPipe(backend::TargetBufferFlags clearFlags,
+    void clearWithRasterPipe(GLRenderTarget const* rt, backend::TargetBufferFlags clearFlags,
             math::float4 const& linearColor, GLfloat depth, GLint stencil) noexcept;
 
     void setViewportScissor(backend::Viewport const& viewportScissor) noexcept;
@@ -428,6 +419,14 @@ private:
     void executeEveryNowAndThenOps() noexcept;
     std::vector<std::function<bool()>> mEveryNowAndThenOps;
 
+    // pixel pack buffers of readPixels(), recycled after their pixels have been copied so a
+    // readback every frame doesn't reallocate a buffer every frame.
+    static constexpr size_t MAX_READ_PIXELS_BUFFERS = 4;
+    // on return, capacity holds the size of the buffer, which is at least the requested size
+    GLuint acquireReadPixelsBuffer(GLsizeiptr* capacity) noexcept;
+    void releaseReadPixelsBuffer(GLuint pbo, GLsizeiptr capacity) noexcept;
+    std::vector<std::pair<GLuint, GLsizeiptr>> mReadPixelsBuffers;
+
     // timer query implementation
     TimerQueryInterface* mTimerQueryImpl = nullptr;
     bool mFrameTimeSupported = false;
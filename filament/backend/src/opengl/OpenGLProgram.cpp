@@ -24,8 +24,12 @@
 #include <utils/debug.h>
 
 #include <private/backend/BackendUtils.h>
+#include <private/backend/OpenGLPlatform.h>
 
 #include <cctype>
+#include <memory>
+
+#include <string.h>
 
 namespace filament {
 
@@ -33,9 +37,47 @@ using namespace filament::math;
 using namespace utils;
 using namespace backend;
 
-OpenGLProgram::OpenGLProgram(OpenGLDriver* gl, const Program& programBuilder) noexcept
-        :  HwProgram(programBuilder.getName()), mIsValid(false) {
+void OpenGLProgram::initialize(OpenGLDriver* gld, Program&& programBuilder) noexcept {
+#ifndef NDEBUG
+    name = programBuilder.getName();
+#endif
+
+    // if this program was already linked in a previous run, skip compilation altogether
+    GLuint const program = retrieveProgramBinary(gld, programBuilder);
+    if (program) {
+        gl.program = program;
+        setup(gld, programBuilder);
+        mReady.store(true, std::memory_order_release);
+        return;
+    }
+
+    compileAndLink(gld, programBuilder);
+
+    if (gl.program && gld->getContext().ext.KHR_parallel_shader_compile) {
+        // The driver compiles and links on its own threads, we check the results once it
+        // reports completion, or when the program is used for the first time (see wait()).
+        mPending = std::make_shared<Program>(std::move(programBuilder));
+        std::weak_ptr<Program> pending = mPending;
+        gld->runEveryNowAndThen([this, gld, pending]() -> bool {
+            if (pending.expired()) {
+                // the program was finalized by wait(), or destroyed
+                return true;
+            }
+            GLint status = GL_FALSE;
+            glGetProgramiv(gl.program, GL_COMPLETION_STATUS_KHR, &status);
+            if (status != GL_TRUE) {
+                return false;
+            }
+            wait(gld);
+            return true;
+        });
+        return;
+    }
+
+    finalize(gld, programBuilder);
+}
 
+void OpenGLProgram::compileAndLink(OpenGLDriver* gld, const Program& programBuilder) noexcept {
     using Shader = Program::Shader;
 
     const auto& shadersSource = programBuilder.getShadersSource();
@@ -52,14 +94,22 @@ OpenGLProgram::OpenGLProgram(OpenGLDriver* gl, const Program& programBuilder) no
             case Shader::FRAGMENT:
                 glShaderType = GL_FRAGMENT_SHADER;
                 break;
+            case Shader::COMPUTE:
+                glShaderType = GL_COMPUTE_SHADER;
+                break;
+        }
+
+        // without compute support the program stays unlinked, dispatchCompute() ignores it
+        if (type == Shader::COMPUTE
+                && UTILS_UNLIKELY(!gld->getContext().features.compute_shaders)) {
+            continue;
         }
 
         if (!shadersSource[i].empty()) {
-            GLint status;
             auto shader = shadersSource[i];
             GLint const length = (GLint)shader.size();
 
-            if (!gl->getContext().ext.GOOGLE_cpp_style_line_directive) {
+            if (!gld->getContext().ext.GOOGLE_cpp_style_line_directive) {
                 // If usages of the Google-style line directive are present, remove them, as some
                 // drivers don't allow the quotation marks.
                 if (requestsGoogleLineDirectivesExtension((const char*)shader.data(), length)) {
@@ -71,132 +121,271 @@ OpenGLProgram::OpenGLProgram(OpenGLDriver* gl, const Program& programBuilder) no
 
             const char * const source = (const char*)shader.data();
 
+            // the compile status is checked in finalize(), querying it here would block
             GLuint shaderId = glCreateShader(glShaderType);
             glShaderSource(shaderId, 1, &source, &length);
             glCompileShader(shaderId);
 
-            glGetShaderiv(shaderId, GL_COMPILE_STATUS, &status);
-            if (UTILS_UNLIKELY(status != GL_TRUE)) {
-                logCompilationError(slog.e, shaderId, source);
-                glDeleteShader(shaderId);
-                return;
-            }
-            this->gl.shaders[i] = shaderId;
+            gl.shaders[i] = shaderId;
             mValidShaderSet |= 1U << i;
         }
     }
 
-    // we need at least a vertex and fragment program
+    // we need at least a vertex and fragment program, or a compute program alone
     const uint8_t validShaderSet = mValidShaderSet;
     const uint8_t mask = VERTEX_SHADER_BIT | FRAGMENT_SHADER_BIT;
-    if (UTILS_LIKELY((mValidShaderSet & mask) == mask)) {
-        GLint status;
-        GLuint program = glCreateProgram();
+    if (UTILS_LIKELY((validShaderSet & mask) == mask || validShaderSet == COMPUTE_SHADER_BIT)) {
+        GLuint const program = glCreateProgram();
         for (size_t i = 0; i < Program::SHADER_TYPE_COUNT; i++) {
             if (validShaderSet & (1U << i)) {
-                glAttachShader(program, this->gl.shaders[i]);
+                glAttachShader(program, gl.shaders[i]);
             }
         }
+#if !defined(__EMSCRIPTEN__)
+        if (programBuilder.getCacheId() && gld->mPlatform.hasBlobFunc()) {
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+#endif
         glLinkProgram(program);
+        gl.program = program;
+    }
+}
 
-        glGetProgramiv(program, GL_LINK_STATUS, &status);
-        if (UTILS_UNLIKELY(status != GL_TRUE)) {
-            char error[512];
-            glGetProgramInfoLog(program, sizeof(error), nullptr, error);
-
-            slog.e << "LINKING: " << error << io::endl;
-            glDeleteProgram(program);
-            return;
-        }
-        this->gl.program = program;
+void OpenGLProgram::finalize(OpenGLDriver* gld, const Program& programBuilder) noexcept {
+    GLuint program = gl.program;
 
-        // Associate each UniformBlock in the program to a known binding.
-        auto const& uniformBlockInfo = programBuilder.getUniformBlockInfo();
+    if (program) {
+        GLint status;
+        const auto& shadersSource = programBuilder.getShadersSource();
         #pragma nounroll
-        for (GLuint binding = 0, n = uniformBlockInfo.size(); binding < n; binding++) {
-            auto const& name = uniformBlockInfo[binding];
-            if (!name.empty()) {
-                GLint index = glGetUniformBlockIndex(program, name.c_str());
-                if (index >= 0) {
-                    glUniformBlockBinding(program, GLuint(index), binding);
+        for (size_t i = 0; i < Program::SHADER_TYPE_COUNT; i++) {
+            if (mValidShaderSet & (1U << i)) {
+                glGetShaderiv(gl.shaders[i], GL_COMPILE_STATUS, &status);
+                if (UTILS_UNLIKELY(status != GL_TRUE)) {
+                    logCompilationError(slog.e, gl.shaders[i],
+                            (const char*)shadersSource[i].data());
+                    program = 0;
                 }
-                CHECK_GL_ERROR(utils::slog.e)
             }
         }
 
-        if (programBuilder.hasSamplers()) {
-            // if we have samplers, we need to do a bit of extra work
-            // activate this program so we can set all its samplers once and for all (glUniform1i)
-            gl->getContext().useProgram(program);
+        if (program) {
+            glGetProgramiv(program, GL_LINK_STATUS, &status);
+            if (UTILS_UNLIKELY(status != GL_TRUE)) {
+                char error[512];
+                glGetProgramInfoLog(program, sizeof(error), nullptr, error);
+                slog.e << "LINKING: " << error << io::endl;
+                program = 0;
+            }
+        }
 
-            auto const& samplerGroupInfo = programBuilder.getSamplerGroupInfo();
-            auto& indicesRun = mIndicesRuns;
-            uint8_t numUsedBindings = 0;
-            uint8_t tmu = 0;
+        if (program) {
+            insertProgramBinary(gld, programBuilder, program);
+            setup(gld, programBuilder);
 
+            // The linked program doesn't need its shaders anymore, deleting them lets the GL
+            // driver free their sources and intermediate representations.
             #pragma nounroll
-            for (size_t i = 0, c = samplerGroupInfo.size(); i < c; i++) {
-                auto const& groupInfo = samplerGroupInfo[i];
-                if (!groupInfo.empty()) {
-                    // Cache the sampler uniform locations for each interface block
-                    BlockInfo& info = mBlockInfos[numUsedBindings];
-                    info.binding = uint8_t(i);
-                    uint8_t count = 0;
-                    for (uint8_t j = 0, m = uint8_t(groupInfo.size()); j < m; ++j) {
-                        // find its location and associate a TMU to it
-                        GLint loc = glGetUniformLocation(program, groupInfo[j].name.c_str());
-                        if (loc >= 0) {
-                            glUniform1i(loc, tmu);
-                            indicesRun[tmu] = j;
-                            count++;
-                            tmu++;
-                        } else {
-                            // glGetUniformLocation could fail if the uniform is not used
-                            // in the program. We should just ignore the error in that case.
-                        }
-                    }
-                    if (count > 0) {
-                        numUsedBindings++;
-                        info.count = uint8_t(count - 1);
-                    }
+            for (size_t i = 0; i < Program::SHADER_TYPE_COUNT; i++) {
+                if (mValidShaderSet & (1U << i)) {
+                    glDetachShader(program, gl.shaders[i]);
+                    glDeleteShader(gl.shaders[i]);
+                    gl.shaders[i] = 0;
                 }
             }
-            mUsedBindingsCount = numUsedBindings;
+            mValidShaderSet = 0;
         }
-        mIsValid = true;
     }
 
     // Failing to compile a program can't be fatal, because this will happen a lot in
     // the material tools. We need to have a better way to handle these errors and
-    // return to the editor. Also note the early "return" statements in this function.
+    // return to the editor.
     if (UTILS_UNLIKELY(!isValid())) {
         PANIC_LOG("Failed to compile GLSL program.");
     }
+
+    // an invalid program is "ready" too, it's never going to become valid
+    mReady.store(true, std::memory_order_release);
+}
+
+void OpenGLProgram::setup(OpenGLDriver* gld, const Program& programBuilder) noexcept {
+    GLuint const program = gl.program;
+
+    // Associate each UniformBlock in the program to a known binding.
+    auto const& uniformBlockInfo = programBuilder.getUniformBlockInfo();
+    #pragma nounroll
+    for (GLuint binding = 0, n = uniformBlockInfo.size(); binding < n; binding++) {
+        auto const& name = uniformBlockInfo[binding];
+        if (!name.empty()) {
+            GLint index = glGetUniformBlockIndex(program, name.c_str());
+            if (index >= 0) {
+                glUniformBlockBinding(program, GLuint(index), binding);
+            }
+            CHECK_GL_ERROR(utils::slog.e)
+        }
+    }
+
+    if (programBuilder.hasSamplers()) {
+        // if we have samplers, we need to do a bit of extra work
+        // activate this program so we can set all its samplers once and for all (glUniform1i)
+        gld->getContext().useProgram(program);
+
+        auto const& samplerGroupInfo = programBuilder.getSamplerGroupInfo();
+        auto& indicesRun = mIndicesRuns;
+        uint8_t numUsedBindings = 0;
+        uint8_t tmu = 0;
+
+        #pragma nounroll
+        for (size_t i = 0, c = samplerGroupInfo.size(); i < c; i++) {
+            auto const& groupInfo = samplerGroupInfo[i];
+            if (!groupInfo.empty()) {
+                // Cache the sampler uniform locations for each interface block
+                BlockInfo& info = mBlockInfos[numUsedBindings];
+                info.binding = uint8_t(i);
+                uint8_t count = 0;
+                for (uint8_t j = 0, m = uint8_t(groupInfo.size()); j < m; ++j) {
+                    // find its location and associate a TMU to it
+                    GLint loc = glGetUniformLocation(program, groupInfo[j].name.c_str());
+                    if (loc >= 0) {
+                        glUniform1i(loc, tmu);
+                        indicesRun[tmu] = j;
+                        count++;
+                        tmu++;
+                    } else {
+                        // glGetUniformLocation could fail if the uniform is not used
+                        // in the program. We should just ignore the error in that case.
+                    }
+                }
+                if (count > 0) {
+                    numUsedBindings++;
+                    info.count = uint8_t(count - 1);
+                }
+            }
+        }
+        mUsedBindingsCount = numUsedBindings;
+    }
+    mIsValid = true;
+}
+
+namespace {
+// key used to store program binaries in the Platform's blob cache
+struct ProgramBinaryKey {
+    uint64_t cacheId;
+    uint32_t variant;
+    uint32_t driver;    // hash of GL_VENDOR, GL_RENDERER and GL_VERSION
+};
+static_assert(sizeof(ProgramBinaryKey) == 16, "ProgramBinaryKey must not have padding");
+
+UTILS_UNUSED
+ProgramBinaryKey getProgramBinaryKey(const Program& builder) noexcept {
+    // the driver identity can't change during the lifetime of the process
+    static const uint32_t driver = []() {
+        uint32_t h = 0x811c9dc5u;   // FNV-1a
+        for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+            const char* str = (const char*)glGetString(name);
+            while (str && *str) {
+                h = (h ^ uint8_t(*str++)) * 0x01000193u;
+            }
+        }
+        return h;
+    }();
+    return { builder.getCacheId(), builder.getVariant(), driver };
+}
+} // anonymous namespace
+
+GLuint OpenGLProgram::retrieveProgramBinary(OpenGLDriver* gld, const Program& builder) noexcept {
+#if !defined(__EMSCRIPTEN__)
+    Platform& platform = gld->mPlatform;
+    if (!builder.getCacheId() || !platform.hasBlobFunc()) {
+        return 0;
+    }
+
+    const ProgramBinaryKey key = getProgramBinaryKey(builder);
+    const size_t size = platform.retrieveBlob(&key, sizeof(key), nullptr, 0);
+    if (size <= sizeof(GLenum)) {
+        return 0;
+    }
+
+    // the blob is the binary format followed by the binary itself
+    std::unique_ptr<uint8_t[]> blob(new uint8_t[size]);
+    if (platform.retrieveBlob(&key, sizeof(key), blob.get(), size) != size) {
+        return 0;
+    }
+
+    GLenum format;
+    memcpy(&format, blob.get(), sizeof(format));
+
+    GLint status;
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, format, blob.get() + sizeof(format), GLsizei(size - sizeof(format)));
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (UTILS_UNLIKELY(status != GL_TRUE)) {
+        // this is expected after a driver update, we just recompile the program
+        glDeleteProgram(program);
+        // glProgramBinary can leave an error behind
+        while (glGetError() != GL_NO_ERROR) {}
+        return 0;
+    }
+    return program;
+#else
+    return 0;
+#endif
+}
+
+void OpenGLProgram::insertProgramBinary(OpenGLDriver* gld, const Program& builder,
+        UTILS_UNUSED GLuint program) noexcept {
+#if !defined(__EMSCRIPTEN__)
+    Platform& platform = gld->mPlatform;
+    if (!builder.getCacheId() || !platform.hasBlobFunc()) {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    const size_t size = sizeof(GLenum) + size_t(length);
+    std::unique_ptr<uint8_t[]> blob(new uint8_t[size]);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, blob.get() + sizeof(format));
+    CHECK_GL_ERROR(utils::slog.e)
+    if (written <= 0) {
+        return;
+    }
+    memcpy(blob.get(), &format, sizeof(format));
+
+    const ProgramBinaryKey key = getProgramBinaryKey(builder);
+    platform.insertBlob(&key, sizeof(key), blob.get(), sizeof(format) + size_t(written));
+#endif
 }
 
 OpenGLProgram::~OpenGLProgram() noexcept {
+    // a program is deleted even if it's still compiling or failed to link
     const size_t validShaderSet = mValidShaderSet;
-    const bool isValid = mIsValid;
     GLuint program = gl.program;
     if (validShaderSet) {
         #pragma nounroll
         for (size_t i = 0; i < Program::SHADER_TYPE_COUNT; i++) {
             if (validShaderSet & (1U << i)) {
                 const GLuint shader = gl.shaders[i];
-                if (isValid) {
+                if (program) {
                     glDetachShader(program, shader);
                 }
                 glDeleteShader(shader);
             }
         }
     }
-    if (isValid) {
+    if (program) {
         glDeleteProgram(program);
     }
 }
 
 void OpenGLProgram::updateSamplers(OpenGLDriver* gld) noexcept {
     using GLTexture = OpenGLDriver::GLTexture;
+    using GLSamplerGroup = OpenGLDriver::GLSamplerGroup;
 
     // cache a few member variable locally, outside of the loop
     OpenGLContext& glc = gld->getContext();
@@ -209,7 +398,8 @@ void OpenGLProgram::updateSamplers(OpenGLDriver* gld) noexcept {
     UTILS_ASSUME(mUsedBindingsCount > 0);
     for (uint8_t i = 0, tmu = 0, n = mUsedBindingsCount; i < n; i++) {
         BlockInfo blockInfo = blockInfos[i];
-        HwSamplerGroup const * const UTILS_RESTRICT hwsb = samplerBindings[blockInfo.binding];
+        GLSamplerGroup const * const UTILS_RESTRICT hwsb =
+                static_cast<GLSamplerGroup const*>(samplerBindings[blockInfo.binding]);
         SamplerGroup const& UTILS_RESTRICT sb = *(hwsb->sb);
         SamplerGroup::Sampler const* const UTILS_RESTRICT samplers = sb.getSamplers();
         for (uint8_t j = 0, m = blockInfo.count ; j <= m; ++j, ++tmu) { // "<=" on purpose here
@@ -232,8 +422,13 @@ void OpenGLProgram::updateSamplers(OpenGLDriver* gld) noexcept {
                 t->gl.fence = nullptr;
             }
 
+            GLuint& sampler = hwsb->samplers[index];
+            if (UTILS_UNLIKELY(!sampler)) {
+                sampler = gld->getSampler(samplers[index].s);
+            }
+
             gld->bindTexture(tmu, t);
-            gld->bindSampler(tmu, samplers[index].s);
+            glc.bindSampler(tmu, sampler);
 
 #if defined(GL_EXT_texture_filter_anisotropic)
             if (UTILS_UNLIKELY(anisotropyWorkaround)) {
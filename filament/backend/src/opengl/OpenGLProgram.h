@@ -26,6 +26,8 @@
 #include <utils/compiler.h>
 #include <utils/Log.h>
 
+#include <atomic>
+#include <memory>
 #include <vector>
 
 #include <stddef.h>
@@ -38,11 +40,28 @@ class OpenGLProgram : public backend::HwProgram {
 public:
 
     OpenGLProgram() noexcept = default;
-    OpenGLProgram(OpenGLDriver* gl, const backend::Program& builder) noexcept;
     ~OpenGLProgram() noexcept;
 
+    // Compiles and links the program. When KHR_parallel_shader_compile is available, this
+    // returns before the compilation is complete and the program stays "pending" until the
+    // driver reports completion, or until wait() is called.
+    void initialize(OpenGLDriver* gl, backend::Program&& builder) noexcept;
+
     bool isValid() const noexcept { return mIsValid; }
 
+    // true when the program can be used without stalling, this can be called from any thread.
+    bool isReady() const noexcept { return mReady.load(std::memory_order_acquire); }
+
+    bool isPending() const noexcept { return mPending != nullptr; }
+
+    // blocks until a pending program is compiled and linked
+    void wait(OpenGLDriver* gl) noexcept {
+        if (UTILS_UNLIKELY(mPending)) {
+            std::shared_ptr<backend::Program> const builder = std::move(mPending);
+            finalize(gl, *builder);
+        }
+    }
+
     void use(OpenGLDriver* const gl) noexcept {
         if (UTILS_UNLIKELY(mUsedBindingsCount)) {
             // We rely on GL state tracking to avoid unnecessary glBindTexture / glBindSampler
@@ -64,7 +83,7 @@ public:
     struct {
         GLuint shaders[backend::Program::SHADER_TYPE_COUNT];
         GLuint program;
-    } gl; // 12 bytes
+    } gl{}; // 16 bytes
 
     static void logCompilationError(utils::io::ostream& out, GLuint shaderId, char const* source) noexcept;
 
@@ -72,6 +91,7 @@ private:
     static constexpr uint8_t TEXTURE_UNIT_COUNT = OpenGLContext::MAX_TEXTURE_UNIT_COUNT;
     static constexpr uint8_t VERTEX_SHADER_BIT   = uint8_t(1) << size_t(backend::Program::Shader::VERTEX);
     static constexpr uint8_t FRAGMENT_SHADER_BIT = uint8_t(1) << size_t(backend::Program::Shader::FRAGMENT);
+    static constexpr uint8_t COMPUTE_SHADER_BIT  = uint8_t(1) << size_t(backend::Program::Shader::COMPUTE);
 
     struct BlockInfo {
         uint8_t binding : 3;    // binding (i.e.: index in mSamplerBindings)
@@ -88,6 +108,10 @@ private:
     uint8_t mUsedBindingsCount = 0;
     uint8_t mValidShaderSet = 0;
     bool mIsValid = false;
+    std::atomic<bool> mReady{ false };
+
+    // the program's description, kept until a parallel compilation completes
+    std::shared_ptr<backend::Program> mPending;
 
     // information about each USED sampler buffer (no gaps)
     std::array<BlockInfo, backend::Program::SAMPLER_BINDING_COUNT> mBlockInfos;   // 8 bytes
@@ -96,6 +120,20 @@ private:
     std::array<uint8_t, TEXTURE_UNIT_COUNT> mIndicesRuns;    // 16 bytes
 
     void updateSamplers(OpenGLDriver* gld) noexcept;
+
+    // issues the compilation of all shaders and the link of the program, doesn't wait
+    void compileAndLink(OpenGLDriver* gld, const backend::Program& builder) noexcept;
+
+    // checks the compilation results and sets up the program's bindings, this can block
+    void finalize(OpenGLDriver* gld, const backend::Program& builder) noexcept;
+
+    // binds uniform blocks and samplers of a successfully linked program
+    void setup(OpenGLDriver* gld, const backend::Program& builder) noexcept;
+
+    // program binary cache, backed by the Platform's blob cache callbacks
+    static GLuint retrieveProgramBinary(OpenGLDriver* gld, const backend::Program& builder) noexcept;
+    static void insertProgramBinary(OpenGLDriver* gld, const backend::Program& builder,
+            GLuint program) noexcept;
 };
 
 
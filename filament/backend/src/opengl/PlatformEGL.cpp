@@ -38,6 +38,12 @@ UTILS_PRIVATE PFNEGLDESTROYSYNCKHRPROC eglDestroySyncKHR = {};
 UTILS_PRIVATE PFNEGLCLIENTWAITSYNCKHRPROC eglClientWaitSyncKHR = {};
 UTILS_PRIVATE PFNEGLCREATEIMAGEKHRPROC eglCreateImageKHR = {};
 UTILS_PRIVATE PFNEGLDESTROYIMAGEKHRPROC eglDestroyImageKHR = {};
+#ifdef EGL_KHR_swap_buffers_with_damage
+UTILS_PRIVATE PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC eglSwapBuffersWithDamageKHR = {};
+#endif
+#ifdef EGL_KHR_partial_update
+UTILS_PRIVATE PFNEGLSETDAMAGEREGIONKHRPROC eglSetDamageRegionKHR = {};
+#endif
 }
 using namespace glext;
 
@@ -102,6 +108,23 @@ Driver* PlatformEGL::createDriver(void* sharedContext) noexcept {
     eglCreateImageKHR = (PFNEGLCREATEIMAGEKHRPROC) eglGetProcAddress("eglCreateImageKHR");
     eglDestroyImageKHR = (PFNEGLDESTROYIMAGEKHRPROC) eglGetProcAddress("eglDestroyImageKHR");
 
+#ifdef EGL_KHR_swap_buffers_with_damage
+    // the EXT version of the extension has the same entry point, under a different name
+    if (extensions.has("EGL_KHR_swap_buffers_with_damage")) {
+        eglSwapBuffersWithDamageKHR = (PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC)
+                eglGetProcAddress("eglSwapBuffersWithDamageKHR");
+    } else if (extensions.has("EGL_EXT_swap_buffers_with_damage")) {
+        eglSwapBuffersWithDamageKHR = (PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC)
+                eglGetProcAddress("eglSwapBuffersWithDamageEXT");
+    }
+#endif
+#ifdef EGL_KHR_partial_update
+    if (extensions.has("EGL_KHR_partial_update")) {
+        eglSetDamageRegionKHR = (PFNEGLSETDAMAGEREGIONKHRPROC)
+                eglGetProcAddress("eglSetDamageRegionKHR");
+    }
+#endif
+
     EGLint configsCount;
     EGLint configAttribs[] = {
             EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT_KHR,        //  0
@@ -311,11 +334,49 @@ void PlatformEGL::makeCurrent(Platform::SwapChain* drawSwapChain,
     }
 }
 
+void PlatformEGL::setDamageRegion(Platform::SwapChain* swapChain,
+        backend::Viewport const& region) noexcept {
+    EGLSurface sur = (EGLSurface) swapChain;
+    if (sur == EGL_NO_SURFACE || !region.width || !region.height) {
+        // the whole surface is damaged
+        mDamageSurface = EGL_NO_SURFACE;
+        return;
+    }
+    // EGL rectangles have their origin at the bottom-left too
+    mDamageSurface = sur;
+    mDamageRegion[0] = region.left;
+    mDamageRegion[1] = region.bottom;
+    mDamageRegion[2] = EGLint(region.width);
+    mDamageRegion[3] = EGLint(region.height);
+
+#ifdef EGL_KHR_partial_update
+    // With partial updates, tilers only need to load and store the tiles of the damage region.
+    // Pixels outside of it keep the content of the back buffer, which must therefore be the
+    // previous frame. Querying the buffer age is also required before setting the region.
+    if (eglSetDamageRegionKHR) {
+        EGLint age = 0;
+        if (eglQuerySurface(mEGLDisplay, sur, EGL_BUFFER_AGE_KHR, &age) && age == 1) {
+            eglSetDamageRegionKHR(mEGLDisplay, sur, mDamageRegion, 1);
+        }
+    }
+#endif
+}
+
 void PlatformEGL::commit(Platform::SwapChain* swapChain) noexcept {
     EGLSurface sur = (EGLSurface) swapChain;
     if (sur != EGL_NO_SURFACE) {
-        eglSwapBuffers(mEGLDisplay, sur);
+#ifdef EGL_KHR_swap_buffers_with_damage
+        if (eglSwapBuffersWithDamageKHR && sur == mDamageSurface) {
+            // lets the compositor only recompose the damage region
+            eglSwapBuffersWithDamageKHR(mEGLDisplay, sur, mDamageRegion, 1);
+        } else
+#endif
+        {
+            eglSwapBuffers(mEGLDisplay, sur);
+        }
     }
+    // the damage region only applies to the frame it was set for
+    mDamageSurface = EGL_NO_SURFACE;
 }
 
 Platform::Fence* PlatformEGL::createFence() noexcept {
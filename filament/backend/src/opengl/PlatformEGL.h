@@ -41,6 +41,7 @@ public:
     void destroySwapChain(SwapChain* swapChain) noexcept override;
     void makeCurrent(SwapChain* drawSwapChain, SwapChain* readSwapChain) noexcept override;
     void commit(SwapChain* swapChain) noexcept override;
+    void setDamageRegion(SwapChain* swapChain, backend::Viewport const& region) noexcept override;
 
     bool canCreateFence() noexcept override { return true; }
     Fence* createFence() noexcept override;
@@ -81,6 +82,10 @@ protected:
     EGLConfig mEGLConfig = EGL_NO_CONFIG_KHR;
     EGLConfig mEGLTransparentConfig = EGL_NO_CONFIG_KHR;
 
+    // damage region of the next commit() of mDamageSurface, as x, y, width, height
+    EGLSurface mDamageSurface = EGL_NO_SURFACE;
+    EGLint mDamageRegion[4] = {};
+
     // supported extensions detected at runtime
     struct {
         bool OES_EGL_image_external_essl3 = false;
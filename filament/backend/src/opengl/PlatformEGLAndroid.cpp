@@ -33,6 +33,10 @@
 
 #include <sys/system_properties.h>
 
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
 #include <jni.h>
 
 
@@ -58,6 +62,7 @@ extern PFNEGLCREATEIMAGEKHRPROC eglCreateImageKHR;
 extern PFNEGLDESTROYIMAGEKHRPROC eglDestroyImageKHR;
 
 UTILS_PRIVATE PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC eglGetNativeClientBufferANDROID = {};
+UTILS_PRIVATE PFNEGLWAITSYNCKHRPROC eglWaitSyncKHR = {};
 UTILS_PRIVATE PFNEGLPRESENTATIONTIMEANDROIDPROC eglPresentationTimeANDROID = {};
 UTILS_PRIVATE PFNEGLGETCOMPOSITORTIMINGSUPPORTEDANDROIDPROC eglGetCompositorTimingSupportedANDROID = {};
 UTILS_PRIVATE PFNEGLGETCOMPOSITORTIMINGANDROIDPROC eglGetCompositorTimingANDROID = {};
@@ -93,6 +98,11 @@ backend::Driver* PlatformEGLAndroid::createDriver(void* sharedContext) noexcept
 
     eglGetNativeClientBufferANDROID = (PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC) eglGetProcAddress("eglGetNativeClientBufferANDROID");
 
+    if (extensions.has("EGL_ANDROID_native_fence_sync") && extensions.has("EGL_KHR_wait_sync")) {
+        eglWaitSyncKHR = (PFNEGLWAITSYNCKHRPROC)eglGetProcAddress("eglWaitSyncKHR");
+        mHasNativeFenceSync = eglWaitSyncKHR != nullptr;
+    }
+
     if (extensions.has("EGL_ANDROID_presentation_time")) {
         eglPresentationTimeANDROID = (PFNEGLPRESENTATIONTIMEANDROIDPROC)eglGetProcAddress(
                 "eglPresentationTimeANDROID");
@@ -210,6 +220,7 @@ backend::AcquiredImage PlatformEGLAndroid::transformAcquiredImage(backend::Acqui
     EGLClientBuffer clientBuffer = eglGetNativeClientBufferANDROID((const AHardwareBuffer*) hwbuffer);
     if (!clientBuffer) {
         slog.e << "Unable to get EGLClientBuffer from AHardwareBuffer." << io::endl;
+        destroyAcquiredImageFence(source.fence);
         return {};
     }
     // Note that this cannot be used to stream protected video (for now) because we do not set EGL_PROTECTED_CONTENT_EXT.
@@ -217,6 +228,7 @@ backend::AcquiredImage PlatformEGLAndroid::transformAcquiredImage(backend::Acqui
     EGLImageKHR eglImage = eglCreateImageKHR(mEGLDisplay, EGL_NO_CONTEXT, EGL_NATIVE_BUFFER_ANDROID, clientBuffer, attrs);
     if (eglImage == EGL_NO_IMAGE_KHR) {
         slog.e << "eglCreateImageKHR returned no image." << io::endl;
+        destroyAcquiredImageFence(source.fence);
         return {};
     }
 
@@ -241,7 +253,36 @@ backend::AcquiredImage PlatformEGLAndroid::transformAcquiredImage(backend::Acqui
         delete closure;
     };
 
-    return {eglImage, patchedCallback, closure};
+    return {eglImage, patchedCallback, closure, source.fence};
+}
+
+void PlatformEGLAndroid::waitAcquiredImageFence(int fence) noexcept {
+    if (fence < 0) {
+        return;
+    }
+    if (mHasNativeFenceSync) {
+        // on success, the sync object owns the file descriptor
+        const EGLint attribs[] = { EGL_SYNC_NATIVE_FENCE_FD_ANDROID, fence, EGL_NONE };
+        EGLSyncKHR sync = eglCreateSyncKHR(mEGLDisplay, EGL_SYNC_NATIVE_FENCE_ANDROID, attribs);
+        if (sync != EGL_NO_SYNC_KHR) {
+            // the wait happens on the GPU, this doesn't block
+            eglWaitSyncKHR(mEGLDisplay, sync, 0);
+            eglDestroySyncKHR(mEGLDisplay, sync);
+            return;
+        }
+        logEglError("eglCreateSyncKHR");
+    }
+    // fallback: wait on the CPU
+    pollfd pfd{ fence, POLLIN, 0 };
+    while (poll(&pfd, 1, -1) < 0 && (errno == EINTR || errno == EAGAIN)) {
+    }
+    close(fence);
+}
+
+void PlatformEGLAndroid::destroyAcquiredImageFence(int fence) noexcept {
+    if (fence >= 0) {
+        close(fence);
+    }
 }
 
 // This must called when the library is loaded. We need this to get a reference to the global VM
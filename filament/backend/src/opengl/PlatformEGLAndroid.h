@@ -47,9 +47,12 @@ public:
     void destroyExternalTextureStorage(ExternalTexture* ets) noexcept final;
 
     backend::AcquiredImage transformAcquiredImage(backend::AcquiredImage source) noexcept final;
+    void waitAcquiredImageFence(int fence) noexcept final;
+    void destroyAcquiredImageFence(int fence) noexcept final;
 
 private:
     int mOSVersion;
+    bool mHasNativeFenceSync = false;
     ExternalStreamManagerAndroid& mExternalStreamManager;
     ExternalTextureManagerAndroid& mExternalTextureManager;
 };
@@ -48,6 +48,14 @@ PFNGLGETQUERYOBJECTUI64VEXTPROC glGetQueryObjectui64v;
 #ifdef GL_EXT_clip_control
 PFNGLCLIPCONTROLEXTPROC glClipControl;
 #endif
+#ifdef GL_EXT_sparse_texture
+PFNGLTEXPAGECOMMITMENTEXTPROC glTexPageCommitment;
+#endif
+#ifndef GL_ES_VERSION_3_1
+PFNGLDISPATCHCOMPUTEPROC glDispatchCompute;
+PFNGLMEMORYBARRIERPROC glMemoryBarrier;
+PFNGLDRAWELEMENTSINDIRECTPROC glDrawElementsIndirect;
+#endif
 
 static std::once_flag sGlExtInitialized;
 
@@ -102,6 +110,22 @@ void importGLESExtensionsEntryPoints() {
         glGetQueryObjectui64v =
                 (PFNGLGETQUERYOBJECTUI64VEXTPROC)eglGetProcAddress(
                         "glGetQueryObjectui64vEXT");
+#endif
+#ifdef GL_EXT_sparse_texture
+        glTexPageCommitment =
+                (PFNGLTEXPAGECOMMITMENTEXTPROC)eglGetProcAddress(
+                        "glTexPageCommitmentEXT");
+#endif
+#ifndef GL_ES_VERSION_3_1
+        glDispatchCompute =
+                (PFNGLDISPATCHCOMPUTEPROC)eglGetProcAddress(
+                        "glDispatchCompute");
+        glMemoryBarrier =
+                (PFNGLMEMORYBARRIERPROC)eglGetProcAddress(
+                        "glMemoryBarrier");
+        glDrawElementsIndirect =
+                (PFNGLDRAWELEMENTSINDIRECTPROC)eglGetProcAddress(
+                        "glDrawElementsIndirect");
 #endif
     });
 #ifdef GL_EXT_clip_control
@@ -60,9 +60,31 @@
         #ifndef GL_ZERO_TO_ONE
         #define GL_ZERO_TO_ONE GL_ZERO_TO_ONE_EXT
         #endif
+#endif
+#ifdef GL_EXT_sparse_texture
+        extern PFNGLTEXPAGECOMMITMENTEXTPROC glTexPageCommitment;
+#endif
+#ifndef GL_ES_VERSION_3_1
+        // OpenGL ES 3.1 entry points used for compute, they're null if the context
+        // doesn't support ES 3.1.
+        typedef void (GL_APIENTRYP PFNGLDISPATCHCOMPUTEPROC) (GLuint x, GLuint y, GLuint z);
+        typedef void (GL_APIENTRYP PFNGLMEMORYBARRIERPROC) (GLbitfield barriers);
+        typedef void (GL_APIENTRYP PFNGLDRAWELEMENTSINDIRECTPROC) (GLenum mode, GLenum type,
+                const void *indirect);
+        extern PFNGLDISPATCHCOMPUTEPROC glDispatchCompute;
+        extern PFNGLMEMORYBARRIERPROC glMemoryBarrier;
+        extern PFNGLDRAWELEMENTSINDIRECTPROC glDrawElementsIndirect;
 #endif
     }
 
+    #define COMPUTE_HEADERS true
+
+    #ifdef GL_EXT_sparse_texture
+    #define SPARSE_TEXTURE_HEADERS true
+    #else
+    #define SPARSE_TEXTURE_HEADERS false
+    #endif
+
     // Prevent lots of #ifdef's between desktop and mobile by providing some suffix-free constants:
     #define GL_DEBUG_OUTPUT                   0x92E0
     #define GL_DEBUG_OUTPUT_SYNCHRONOUS       0x8242
@@ -97,6 +119,9 @@
     #define GL_TEXTURE_2D_MULTISAMPLE         0x9100
     #define GL_TIME_ELAPSED                   0x88BF
 
+    #define COMPUTE_HEADERS false
+    #define SPARSE_TEXTURE_HEADERS false
+
 #ifdef GL_EXT_multisampled_render_to_texture
     extern PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC glRenderbufferStorageMultisampleEXT;
     extern PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC glFramebufferTexture2DMultisampleEXT;
@@ -104,6 +129,51 @@
 
 #else
     #include <bluegl/BlueGL.h>
+
+    #if defined(GL_VERSION_4_3)
+    #define COMPUTE_HEADERS true
+    #else
+    #define COMPUTE_HEADERS false
+    #endif
+
+    #ifdef GL_ARB_sparse_texture
+    #define SPARSE_TEXTURE_HEADERS true
+    #define glTexPageCommitment glTexPageCommitmentARB
+    #else
+    #define SPARSE_TEXTURE_HEADERS false
+    #endif
+#endif
+
+// KHR_parallel_shader_compile is an extension everywhere, the headers don't always have it
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR            0x91B1
+#endif
+
+// These are only used when COMPUTE_HEADERS is true, but are needed to compile with GLES 3.0 headers
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER                   0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER            0x90D2
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER             0x8F3F
+#endif
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT  0x00000001
+#define GL_UNIFORM_BARRIER_BIT              0x00000004
+#define GL_COMMAND_BARRIER_BIT              0x00000040
+#define GL_BUFFER_UPDATE_BARRIER_BIT        0x00000200
+#define GL_SHADER_STORAGE_BARRIER_BIT       0x00002000
+#endif
+
+// ARB_sparse_texture and EXT_sparse_texture use the same tokens
+#ifndef GL_TEXTURE_SPARSE
+#define GL_TEXTURE_SPARSE                   0x91A6
+#define GL_NUM_VIRTUAL_PAGE_SIZES           0x91A8
+#define GL_VIRTUAL_PAGE_SIZE_X              0x9195
+#define GL_VIRTUAL_PAGE_SIZE_Y              0x9196
+#define GL_VIRTUAL_PAGE_SIZE_Z              0x9197
 #endif
 
 // This is just to simplify the implementation (i.e. so we don't have to have #ifdefs everywhere)
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "VulkanBarrierBatch.h"
+
+#include <utils/debug.h>
+#include <utils/Panic.h>
+
+#include <algorithm>
+
+using namespace bluevk;
+
+namespace filament {
+namespace backend {
+
+namespace {
+
+// Accesses that must complete before leaving a layout. Reads only need an execution dependency.
+void getSourceScope(VkImageLayout layout, VkAccessFlags* access, VkPipelineStageFlags* stage) {
+    switch (layout) {
+        case VK_IMAGE_LAYOUT_UNDEFINED:
+            *access = 0;
+            *stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+            *access = VK_ACCESS_TRANSFER_WRITE_BIT;
+            *stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+            *access = 0;
+            *stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            break;
+        default:
+            *access = VK_ACCESS_MEMORY_WRITE_BIT;
+            *stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            break;
+    }
+}
+
+// Accesses that must wait for the transition to a layout.
+void getDestinationScope(VkImageLayout layout, VkAccessFlags* access, VkPipelineStageFlags* stage) {
+    switch (layout) {
+        case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+            *access = VK_ACCESS_TRANSFER_WRITE_BIT;
+            *stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+            *access = VK_ACCESS_TRANSFER_READ_BIT;
+            *stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+        case VK_IMAGE_LAYOUT_GENERAL:
+            *access = VK_ACCESS_SHADER_READ_BIT;
+            *stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+            *access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            *stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            break;
+
+        // We support PRESENT as a target layout to allow blitting from the swap chain, the
+        // presentation itself is synchronized by a semaphore. See also makeSwapChainPresentable().
+        case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+            *access = 0;
+            *stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+            break;
+
+        default:
+            PANIC_POSTCONDITION("Unsupported layout transition.");
+    }
+}
+
+bool overlaps(uint32_t base0, uint32_t count0, uint32_t base1, uint32_t count1) noexcept {
+    return base0 < base1 + count1 && base1 < base0 + count0;
+}
+
+bool overlaps(VkImageSubresourceRange const& a, VkImageSubresourceRange const& b) noexcept {
+    return (a.aspectMask & b.aspectMask) &&
+            overlaps(a.baseMipLevel, a.levelCount, b.baseMipLevel, b.levelCount) &&
+            overlaps(a.baseArrayLayer, a.layerCount, b.baseArrayLayer, b.layerCount);
+}
+
+bool operator==(VkImageSubresourceRange const& a, VkImageSubresourceRange const& b) noexcept {
+    return a.aspectMask == b.aspectMask &&
+            a.baseMipLevel == b.baseMipLevel && a.levelCount == b.levelCount &&
+            a.baseArrayLayer == b.baseArrayLayer && a.layerCount == b.layerCount;
+}
+
+} // anonymous namespace
+
+void VulkanBarrierBatch::transition(VkCommandBuffer cmdbuffer, VkImage image,
+        VkImageLayout oldLayout, VkImageLayout newLayout, VkImageSubresourceRange const& range) {
+    if (cmdbuffer != mCmdBuffer) {
+        flush();
+        mCmdBuffer = cmdbuffer;
+    }
+
+    Transition transition = {
+        .barrier = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .oldLayout = oldLayout,
+            .newLayout = newLayout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = range,
+        },
+    };
+    getSourceScope(oldLayout, &transition.barrier.srcAccessMask, &transition.srcStage);
+    getDestinationScope(newLayout, &transition.barrier.dstAccessMask, &transition.dstStage);
+
+    auto pending = std::find_if(mPending.begin(), mPending.end(), [&](Transition const& t) {
+        return t.barrier.image == image && overlaps(t.barrier.subresourceRange, range);
+    });
+    if (pending != mPending.end()) {
+        if (pending->barrier.subresourceRange == range) {
+            // The subresources never reach the intermediate layout, so the transition starts where
+            // the pending one does and waits on what it was waiting on.
+            assert_invariant(oldLayout == VK_IMAGE_LAYOUT_UNDEFINED ||
+                    oldLayout == pending->barrier.newLayout);
+            transition.barrier.oldLayout = pending->barrier.oldLayout;
+            transition.barrier.srcAccessMask = pending->barrier.srcAccessMask;
+            transition.srcStage = pending->srcStage;
+            *pending = transition;
+            return;
+        }
+        // Partially overlapping transitions must stay ordered.
+        flush();
+        mCmdBuffer = cmdbuffer;
+    }
+    mPending.push_back(transition);
+}
+
+void VulkanBarrierBatch::flush() {
+    if (mPending.empty()) {
+        return;
+    }
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    mBarriers.clear();
+    for (Transition const& transition : mPending) {
+        srcStages |= transition.srcStage;
+        dstStages |= transition.dstStage;
+        mBarriers.push_back(transition.barrier);
+    }
+    vkCmdPipelineBarrier(mCmdBuffer, srcStages, dstStages, 0, 0, nullptr, 0, nullptr,
+            uint32_t(mBarriers.size()), mBarriers.data());
+    mPending.clear();
+}
+
+void VulkanBarrierBatch::forget(VkImage image) noexcept {
+    mPending.erase(std::remove_if(mPending.begin(), mPending.end(), [image](Transition const& t) {
+        return t.barrier.image == image;
+    }), mPending.end());
+}
+
+} // namespace backend
+} // namespace filament
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DRIVER_VULKANBARRIERBATCH_H
+#define TNT_FILAMENT_DRIVER_VULKANBARRIERBATCH_H
+
+#include <bluevk/BlueVK.h>
+
+#include <vector>
+
+namespace filament {
+namespace backend {
+
+// Accumulates image layout transitions and records them with a single vkCmdPipelineBarrier, which
+// waits on the union of their source stages only.
+//
+// Transitions are deferred until the next flush(), which must happen before the next command that
+// uses the images, i.e. before the next render pass, transfer, or the end of the command buffer.
+// A transition of subresources that still have a pending transition replaces it, such that e.g.
+// going back to the sampling layout after a blit and out of it again for the next blit (as in mip
+// generation) costs a single TRANSFER_DST to TRANSFER_SRC transition.
+class VulkanBarrierBatch {
+public:
+    // Adds a transition of the given subresources to 'newLayout', recorded into 'cmdbuffer' by the
+    // next flush. Transitions pending for another command buffer are recorded first.
+    //
+    // 'oldLayout' is the current layout of the subresources, or UNDEFINED if their content can be
+    // discarded. Access masks and stages are derived from both layouts.
+    void transition(VkCommandBuffer cmdbuffer, VkImage image, VkImageLayout oldLayout,
+            VkImageLayout newLayout, VkImageSubresourceRange const& range);
+
+    // Records the pending transitions, if any.
+    void flush();
+
+    // Drops the pending transitions of an image that is about to be destroyed.
+    void forget(VkImage image) noexcept;
+
+    bool empty() const noexcept { return mPending.empty(); }
+
+private:
+    struct Transition {
+        VkImageMemoryBarrier barrier;
+        VkPipelineStageFlags srcStage;
+        VkPipelineStageFlags dstStage;
+    };
+
+    VkCommandBuffer mCmdBuffer = VK_NULL_HANDLE;
+    std::vector<Transition> mPending;
+    std::vector<VkImageMemoryBarrier> mBarriers; // scratch storage for flush()
+};
+
+} // namespace backend
+} // namespace filament
+
+#endif // TNT_FILAMENT_DRIVER_VULKANBARRIERBATCH_H
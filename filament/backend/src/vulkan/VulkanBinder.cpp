@@ -59,8 +59,6 @@ VulkanBinder::VulkanBinder() : mDefaultRasterState(createDefaultRasterState()) {
     mShaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     mShaderStages[1].pName = "main";
     resetBindings();
-
-    mDescriptorKey = {};
 }
 
 VulkanBinder::~VulkanBinder() {
@@ -68,127 +66,208 @@ VulkanBinder::~VulkanBinder() {
 }
 
 bool VulkanBinder::getOrCreateDescriptors(VkDescriptorSet descriptorSets[3],
-        VkPipelineLayout* pipelineLayout) noexcept {
+        VkPipelineLayout* pipelineLayout, uint32_t dynamicOffsets[UBUFFER_BINDING_COUNT]) noexcept {
     // If this method has never been called before, we need to create a new layout object.
     if (!mPipelineLayout) {
         createLayoutsAndDescriptors();
     }
 
+    bool rebind = mDirtyOffsets;
+    mDirtyOffsets = false;
+
+    rebind |= getOrCreateDescriptorSet(mUniformDescriptors, 0,
+            [this](VkDescriptorSet set, VkWriteDescriptorSet* writes) {
+        const UniformBufferKey& key = mUniformDescriptors.key;
+        uint32_t nwrites = 0;
+        for (uint32_t binding = 0; binding < UBUFFER_BINDING_COUNT; binding++) {
+            if (key.uniformBuffers[binding]) {
+                VkDescriptorBufferInfo& bufferInfo = mDescriptorBuffers[binding];
+                bufferInfo.buffer = key.uniformBuffers[binding];
+                bufferInfo.offset = 0;
+                bufferInfo.range = key.uniformBufferSizes[binding];
+                VkWriteDescriptorSet& writeInfo = writes[nwrites++];
+                writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                writeInfo.pNext = nullptr;
+                writeInfo.dstSet = set;
+                writeInfo.dstBinding = binding;
+                writeInfo.dstArrayElement = 0;
+                writeInfo.descriptorCount = 1;
+                writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+                writeInfo.pImageInfo = nullptr;
+                writeInfo.pBufferInfo = &bufferInfo;
+                writeInfo.pTexelBufferView = nullptr;
+            }
+        }
+        return nwrites;
+    });
+
+    rebind |= getOrCreateDescriptorSet(mSamplerDescriptors, 1,
+            [this](VkDescriptorSet set, VkWriteDescriptorSet* writes) {
+        const SamplerKey& key = mSamplerDescriptors.key;
+        uint32_t nwrites = 0;
+        for (uint32_t binding = 0; binding < SAMPLER_BINDING_COUNT; binding++) {
+            if (key.samplers[binding].sampler) {
+                VkDescriptorImageInfo& imageInfo = mDescriptorSamplers[binding];
+                imageInfo = key.samplers[binding];
+                VkWriteDescriptorSet& writeInfo = writes[nwrites++];
+                writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                writeInfo.pNext = nullptr;
+                writeInfo.dstSet = set;
+                writeInfo.dstBinding = binding;
+                writeInfo.dstArrayElement = 0;
+                writeInfo.descriptorCount = 1;
+                writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                writeInfo.pImageInfo = &imageInfo;
+                writeInfo.pBufferInfo = nullptr;
+                writeInfo.pTexelBufferView = nullptr;
+            }
+        }
+        return nwrites;
+    });
+
+    rebind |= getOrCreateDescriptorSet(mInputAttachmentDescriptors, 2,
+            [this](VkDescriptorSet set, VkWriteDescriptorSet* writes) {
+        const InputAttachmentKey& key = mInputAttachmentDescriptors.key;
+        uint32_t nwrites = 0;
+        for (uint32_t binding = 0; binding < TARGET_BINDING_COUNT; binding++) {
+            if (key.inputAttachments[binding].imageView) {
+                VkDescriptorImageInfo& imageInfo = mDescriptorInputAttachments[binding];
+                imageInfo = key.inputAttachments[binding];
+                VkWriteDescriptorSet& writeInfo = writes[nwrites++];
+                writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                writeInfo.pNext = nullptr;
+                writeInfo.dstSet = set;
+                writeInfo.dstBinding = binding;
+                writeInfo.dstArrayElement = 0;
+                writeInfo.descriptorCount = 1;
+                writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+                writeInfo.pImageInfo = &imageInfo;
+                writeInfo.pBufferInfo = nullptr;
+                writeInfo.pTexelBufferView = nullptr;
+            }
+        }
+        return nwrites;
+    });
+
+    descriptorSets[0] = mUniformDescriptors.current->handle;
+    descriptorSets[1] = mSamplerDescriptors.current->handle;
+    descriptorSets[2] = mInputAttachmentDescriptors.current->handle;
+    for (uint32_t binding = 0; binding < UBUFFER_BINDING_COUNT; binding++) {
+        dynamicOffsets[binding] = mUniformBufferOffsets[binding];
+    }
+    *pipelineLayout = mPipelineLayout;
+    return rebind;
+}
+
+void VulkanBinder::getOrCreateComputeDescriptors(VkDescriptorSet* descriptors,
+        VkPipelineLayout* pipelineLayout) noexcept {
+    if (!mPipelineLayout) {
+        createLayoutsAndDescriptors();
+    }
+
+    getOrCreateDescriptorSet(mStorageDescriptors, 3,
+            [this](VkDescriptorSet set, VkWriteDescriptorSet* writes) {
+        const StorageBufferKey& key = mStorageDescriptors.key;
+        uint32_t nwrites = 0;
+        for (uint32_t binding = 0; binding < STORAGE_BINDING_COUNT; binding++) {
+            if (key.storageBuffers[binding]) {
+                VkDescriptorBufferInfo& bufferInfo = mDescriptorStorageBuffers[binding];
+                bufferInfo.buffer = key.storageBuffers[binding];
+                bufferInfo.offset = 0;
+                bufferInfo.range = VK_WHOLE_SIZE;
+                VkWriteDescriptorSet& writeInfo = writes[nwrites++];
+                writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                writeInfo.pNext = nullptr;
+                writeInfo.dstSet = set;
+                writeInfo.dstBinding = binding;
+                writeInfo.dstArrayElement = 0;
+                writeInfo.descriptorCount = 1;
+                writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                writeInfo.pImageInfo = nullptr;
+                writeInfo.pBufferInfo = &bufferInfo;
+                writeInfo.pTexelBufferView = nullptr;
+            }
+        }
+        return nwrites;
+    });
+
+    *descriptors = mStorageDescriptors.current->handle;
+    *pipelineLayout = mComputePipelineLayout;
+}
+
+VkPipeline VulkanBinder::createComputePipeline(VkShaderModule compute) noexcept {
+    ASSERT_POSTCONDITION(mComputePipelineLayout,
+            "Must call getOrCreateComputeDescriptors before createComputePipeline.");
+    VkComputePipelineCreateInfo pipelineCreateInfo = {};
+    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineCreateInfo.stage.module = compute;
+    pipelineCreateInfo.stage.pName = "main";
+    pipelineCreateInfo.layout = mComputePipelineLayout;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult err = vkCreateComputePipelines(mDevice, mPipelineCache, 1, &pipelineCreateInfo,
+            VKALLOC, &pipeline);
+    if (err) {
+        utils::slog.e << "vkCreateComputePipelines error " << err << utils::io::endl;
+        utils::debug_trap();
+    }
+    return pipeline;
+}
+
+// Returns true if the descriptor set of the given cache has changed since the last call.
+template<typename Key, typename WriteFn>
+bool VulkanBinder::getOrCreateDescriptorSet(DescriptorCache<Key>& cache, uint32_t setIndex,
+        WriteFn&& write) noexcept {
     // If no bindings have been dirtied, update the timestamp (most recent access) and return false
     // to indicate there's no need to re-bind.
-    if (!mDirtyDescriptor) {
-        assert_invariant(mCurrentDescriptorBundle && mCurrentDescriptorBundle->bound);
-        descriptorSets[0] = mCurrentDescriptorBundle->handles[0];
-        descriptorSets[1] = mCurrentDescriptorBundle->handles[1];
-        descriptorSets[2] = mCurrentDescriptorBundle->handles[2];
-        mCurrentDescriptorBundle->timestamp = mCurrentTime;
+    if (!cache.dirty) {
+        assert_invariant(cache.current && cache.current->bound);
+        cache.current->timestamp = mCurrentTime;
         return false;
     }
 
     // Release the previously bound descriptor and update its time stamp.
-    if (mCurrentDescriptorBundle) {
-        mCurrentDescriptorBundle->timestamp = mCurrentTime;
-        mCurrentDescriptorBundle->bound = false;
+    if (cache.current) {
+        cache.current->timestamp = mCurrentTime;
+        cache.current->bound = false;
     }
+    cache.dirty = false;
 
     // If a cached object exists, update the timestamp (most recent access) and return true to
-    // indicate that the caller should call vmCmdBind. Note that robin_map iterators proffer a
+    // indicate that the caller should call vkCmdBind. Note that robin_map iterators proffer a
     // value method for obtaining a stable reference.
-    auto iter = mDescriptorBundles.find(mDescriptorKey);
-    if (UTILS_LIKELY(iter != mDescriptorBundles.end())) {
-        mCurrentDescriptorBundle = &iter.value();
-        descriptorSets[0] = mCurrentDescriptorBundle->handles[0];
-        descriptorSets[1] = mCurrentDescriptorBundle->handles[1];
-        descriptorSets[2] = mCurrentDescriptorBundle->handles[2];
-        mCurrentDescriptorBundle->timestamp = mCurrentTime;
-        mCurrentDescriptorBundle->bound = true;
-        mDirtyDescriptor = false;
-        *pipelineLayout = mPipelineLayout;
+    auto iter = cache.sets.find(cache.key);
+    if (UTILS_LIKELY(iter != cache.sets.end())) {
+        cache.current = &iter.value();
+        cache.current->timestamp = mCurrentTime;
+        cache.current->bound = true;
         return true;
     }
 
-    // Allocate one descriptor set for each type: uniforms, combined image samplers, and input attachments.
+    VkDescriptorSet set;
     VkDescriptorSetAllocateInfo allocInfo = {};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.descriptorPool = mDescriptorPool;
-    allocInfo.descriptorSetCount = 3;
-    allocInfo.pSetLayouts = mDescriptorSetLayouts;
-    VkResult err = vkAllocateDescriptorSets(mDevice, &allocInfo, descriptorSets);
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &mDescriptorSetLayouts[setIndex];
+    VkResult err = vkAllocateDescriptorSets(mDevice, &allocInfo, &set);
     ASSERT_POSTCONDITION(err != VK_ERROR_FRAGMENTED_POOL,
             "Descriptor set allocation has failed due to fragmentation of pool memory.");
     ASSERT_POSTCONDITION(err == VK_SUCCESS, "Unable to allocate descriptor set.");
-    *pipelineLayout = mPipelineLayout;
 
-    // Here we construct a DescriptorBundle in place, then stash its pointer to allow fast
-    // subsequent calls to getOrCreateDescriptor when nothing has been dirtied. Note that the
-    // robin_map iterator type proffers a "value" method, which returns a stable reference.
-    auto& bundle = mDescriptorBundles.emplace(std::make_pair(mDescriptorKey, DescriptorBundle {
-        .handles = { descriptorSets[0], descriptorSets[1], descriptorSets[2] },
+    // Here we construct a DescriptorVal in place, then stash its pointer to allow fast
+    // subsequent calls to getOrCreateDescriptorSet when nothing has been dirtied.
+    cache.current = &cache.sets.emplace(std::make_pair(cache.key, DescriptorVal {
+        .handle = set,
         .timestamp = mCurrentTime,
         .bound = true
     })).first.value();
 
-    mCurrentDescriptorBundle = &bundle;
-    mDirtyDescriptor = false;
-
     // Mutate the descriptor by setting all non-null bindings.
-    uint32_t nwrites = 0;
-    VkWriteDescriptorSet* writes = mDescriptorWrites;
-    nwrites = 0;
-    for (uint32_t binding = 0; binding < UBUFFER_BINDING_COUNT; binding++) {
-        if (mDescriptorKey.uniformBuffers[binding]) {
-            VkDescriptorBufferInfo& bufferInfo = mDescriptorBuffers[binding];
-            bufferInfo.buffer = mDescriptorKey.uniformBuffers[binding];
-            bufferInfo.offset = mDescriptorKey.uniformBufferOffsets[binding];
-            bufferInfo.range = mDescriptorKey.uniformBufferSizes[binding];
-            VkWriteDescriptorSet& writeInfo = writes[nwrites++];
-            writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            writeInfo.pNext = nullptr;
-            writeInfo.dstSet = mCurrentDescriptorBundle->handles[0];
-            writeInfo.dstBinding = binding;
-            writeInfo.dstArrayElement = 0;
-            writeInfo.descriptorCount = 1;
-            writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            writeInfo.pImageInfo = nullptr;
-            writeInfo.pBufferInfo = &bufferInfo;
-            writeInfo.pTexelBufferView = nullptr;
-        }
-    }
-    for (uint32_t binding = 0; binding < SAMPLER_BINDING_COUNT; binding++) {
-        if (mDescriptorKey.samplers[binding].sampler) {
-            VkDescriptorImageInfo& imageInfo = mDescriptorSamplers[binding];
-            imageInfo = mDescriptorKey.samplers[binding];
-            VkWriteDescriptorSet& writeInfo = writes[nwrites++];
-            writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            writeInfo.pNext = nullptr;
-            writeInfo.dstSet = mCurrentDescriptorBundle->handles[1];
-            writeInfo.dstBinding = binding;
-            writeInfo.dstArrayElement = 0;
-            writeInfo.descriptorCount = 1;
-            writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            writeInfo.pImageInfo = &imageInfo;
-            writeInfo.pBufferInfo = nullptr;
-            writeInfo.pTexelBufferView = nullptr;
-        }
-    }
-    for (uint32_t binding = 0; binding < TARGET_BINDING_COUNT; binding++) {
-        if (mDescriptorKey.inputAttachments[binding].imageView) {
-            VkDescriptorImageInfo& imageInfo = mDescriptorInputAttachments[binding];
-            imageInfo = mDescriptorKey.inputAttachments[binding];
-            VkWriteDescriptorSet& writeInfo = writes[nwrites++];
-            writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            writeInfo.pNext = nullptr;
-            writeInfo.dstSet = mCurrentDescriptorBundle->handles[2];
-            writeInfo.dstBinding = binding;
-            writeInfo.dstArrayElement = 0;
-            writeInfo.descriptorCount = 1;
-            writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-            writeInfo.pImageInfo = &imageInfo;
-            writeInfo.pBufferInfo = nullptr;
-            writeInfo.pTexelBufferView = nullptr;
-        }
-    }
-    vkUpdateDescriptorSets(mDevice, nwrites, writes, 0, nullptr);
+    const uint32_t nwrites = write(set, mDescriptorWrites);
+    vkUpdateDescriptorSets(mDevice, nwrites, mDescriptorWrites, 0, nullptr);
     return true;
 }
 
@@ -260,11 +339,12 @@ bool VulkanBinder::getOrCreatePipeline(VkPipeline* pipeline) noexcept {
     VkDynamicState dynamicStateEnables[] = {
         VK_DYNAMIC_STATE_VIEWPORT,
         VK_DYNAMIC_STATE_SCISSOR,
+        VK_DYNAMIC_STATE_FRAGMENT_SHADING_RATE_KHR,
     };
     VkPipelineDynamicStateCreateInfo dynamicState = {};
     dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
     dynamicState.pDynamicStates = dynamicStateEnables;
-    dynamicState.dynamicStateCount = 2;
+    dynamicState.dynamicStateCount = mFragmentShadingRateEnabled ? 3 : 2;
 
     const bool hasFragmentShader = mShaderStages[1].module != VK_NULL_HANDLE;
 
@@ -301,7 +381,7 @@ bool VulkanBinder::getOrCreatePipeline(VkPipeline* pipeline) noexcept {
             << mShaderStages[0].module << ", " << mShaderStages[1].module << ")" << utils::io::endl;
     #endif
 
-    VkResult err = vkCreateGraphicsPipelines(mDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo,
+    VkResult err = vkCreateGraphicsPipelines(mDevice, mPipelineCache, 1, &pipelineCreateInfo,
             VKALLOC, pipeline);
     if (err) {
         utils::slog.e << "vkCreateGraphicsPipelines error " << err << utils::io::endl;
@@ -398,18 +478,19 @@ void VulkanBinder::bindVertexArray(const VertexArray& varray) noexcept {
 }
 
 void VulkanBinder::unbindUniformBuffer(VkBuffer uniformBuffer) noexcept {
-    auto& key = mDescriptorKey;
+    auto& key = mUniformDescriptors.key;
     for (uint32_t bindingIndex = 0u; bindingIndex < UBUFFER_BINDING_COUNT; ++bindingIndex) {
         if (key.uniformBuffers[bindingIndex] == uniformBuffer) {
             key.uniformBuffers[bindingIndex] = {};
             key.uniformBufferSizes[bindingIndex] = {};
-            key.uniformBufferOffsets[bindingIndex] = {};
-            mDirtyDescriptor = true;
+            mUniformBufferOffsets[bindingIndex] = {};
+            mUniformDescriptors.dirty = true;
+            mDirtyOffsets = true;
         }
     }
     // This function is often called before deleting a uniform buffer. For safety, we need to evict
-    // all descriptors that refer to the extinct uniform buffer, regardless of the binding offsets.
-    evictDescriptors([uniformBuffer] (const DescriptorKey& key) {
+    // all descriptors that refer to the extinct uniform buffer, regardless of the binding sizes.
+    evictDescriptors(mUniformDescriptors, [uniformBuffer] (const UniformBufferKey& key) {
         for (VkBuffer buf : key.uniformBuffers) {
             if (buf == uniformBuffer) {
                 return true;
@@ -419,23 +500,43 @@ void VulkanBinder::unbindUniformBuffer(VkBuffer uniformBuffer) noexcept {
     });
 }
 
+void VulkanBinder::unbindStorageBuffer(VkBuffer storageBuffer) noexcept {
+    for (VkBuffer& buf : mStorageDescriptors.key.storageBuffers) {
+        if (buf == storageBuffer) {
+            buf = {};
+            mStorageDescriptors.dirty = true;
+        }
+    }
+    evictDescriptors(mStorageDescriptors, [storageBuffer] (const StorageBufferKey& key) {
+        for (VkBuffer buf : key.storageBuffers) {
+            if (buf == storageBuffer) {
+                return true;
+            }
+        }
+        return false;
+    });
+}
+
 void VulkanBinder::unbindImageView(VkImageView imageView) noexcept {
-    for (auto& sampler : mDescriptorKey.samplers) {
+    for (auto& sampler : mSamplerDescriptors.key.samplers) {
         if (sampler.imageView == imageView) {
-            mDirtyDescriptor = true;
+            mSamplerDescriptors.dirty = true;
         }
     }
-    for (auto& target : mDescriptorKey.inputAttachments) {
+    for (auto& target : mInputAttachmentDescriptors.key.inputAttachments) {
         if (target.imageView == imageView) {
-            mDirtyDescriptor = true;
+            mInputAttachmentDescriptors.dirty = true;
         }
     }
-    evictDescriptors([imageView] (const DescriptorKey& key) {
+    evictDescriptors(mSamplerDescriptors, [imageView] (const SamplerKey& key) {
         for (const auto& binding : key.samplers) {
             if (binding.imageView == imageView) {
                 return true;
             }
         }
+        return false;
+    });
+    evictDescriptors(mInputAttachmentDescriptors, [imageView] (const InputAttachmentKey& key) {
         for (const auto& binding : key.inputAttachments) {
             if (binding.imageView == imageView) {
                 return true;
@@ -447,23 +548,31 @@ void VulkanBinder::unbindImageView(VkImageView imageView) noexcept {
 
 // Discards all descriptor sets that pass the given filter. Immediately removes the cache entries,
 // but defers calling vkFreeDescriptorSets until the next eviction cycle.
-void VulkanBinder::evictDescriptors(std::function<bool(const DescriptorKey&)> filter) noexcept {
+template<typename Key, typename FilterFn>
+void VulkanBinder::evictDescriptors(DescriptorCache<Key>& cache, FilterFn&& filter) noexcept {
+    bool evicted = false;
     // Due to robin_map restrictions, we cannot use auto or a range-based loop.
-    decltype(mDescriptorBundles)::const_iterator iter;
-    for (iter = mDescriptorBundles.begin(); iter != mDescriptorBundles.end();) {
+    typename decltype(cache.sets)::const_iterator iter;
+    for (iter = cache.sets.begin(); iter != cache.sets.end();) {
         auto& pair = *iter;
         if (filter(pair.first)) {
             auto& cacheEntry = iter->second;
             mDescriptorGraveyard.push_back({
-                .handles = { cacheEntry.handles[0], cacheEntry.handles[1], cacheEntry.handles[2] },
+                .handle = cacheEntry.handle,
                 .timestamp = cacheEntry.timestamp,
                 .bound = false
             });
-            iter = mDescriptorBundles.erase(iter);
+            iter = cache.sets.erase(iter);
+            evicted = true;
         } else {
             ++iter;
         }
     }
+    // Erasing entries can move the remaining ones, so we can't keep a pointer to any of them.
+    if (evicted) {
+        cache.current = nullptr;
+        cache.dirty = true;
+    }
 }
 
 void VulkanBinder::bindUniformBuffer(uint32_t bindingIndex, VkBuffer uniformBuffer,
@@ -471,26 +580,39 @@ void VulkanBinder::bindUniformBuffer(uint32_t bindingIndex, VkBuffer uniformBuff
     ASSERT_POSTCONDITION(bindingIndex < UBUFFER_BINDING_COUNT,
             "Uniform bindings overflow: index = %d, capacity = %d.",
             bindingIndex, UBUFFER_BINDING_COUNT);
-    auto& key = mDescriptorKey;
+    auto& key = mUniformDescriptors.key;
     if (key.uniformBuffers[bindingIndex] != uniformBuffer ||
-        key.uniformBufferOffsets[bindingIndex] != offset ||
         key.uniformBufferSizes[bindingIndex] != size) {
         key.uniformBuffers[bindingIndex] = uniformBuffer;
-        key.uniformBufferOffsets[bindingIndex] = offset;
         key.uniformBufferSizes[bindingIndex] = size;
-        mDirtyDescriptor = true;
+        mUniformDescriptors.dirty = true;
+    }
+    if (mUniformBufferOffsets[bindingIndex] != offset) {
+        mUniformBufferOffsets[bindingIndex] = uint32_t(offset);
+        mDirtyOffsets = true;
+    }
+}
+
+void VulkanBinder::bindStorageBuffer(uint32_t bindingIndex, VkBuffer storageBuffer) noexcept {
+    ASSERT_POSTCONDITION(bindingIndex < STORAGE_BINDING_COUNT,
+            "Storage bindings overflow: index = %d, capacity = %d.",
+            bindingIndex, STORAGE_BINDING_COUNT);
+    VkBuffer& buf = mStorageDescriptors.key.storageBuffers[bindingIndex];
+    if (buf != storageBuffer) {
+        buf = storageBuffer;
+        mStorageDescriptors.dirty = true;
     }
 }
 
 void VulkanBinder::bindSamplers(VkDescriptorImageInfo samplers[SAMPLER_BINDING_COUNT]) noexcept {
     for (uint32_t bindingIndex = 0; bindingIndex < SAMPLER_BINDING_COUNT; bindingIndex++) {
         const VkDescriptorImageInfo& requested = samplers[bindingIndex];
-        VkDescriptorImageInfo& existing = mDescriptorKey.samplers[bindingIndex];
+        VkDescriptorImageInfo& existing = mSamplerDescriptors.key.samplers[bindingIndex];
         if (existing.sampler != requested.sampler ||
             existing.imageView != requested.imageView ||
             existing.imageLayout != requested.imageLayout) {
             existing = requested;
-            mDirtyDescriptor = true;
+            mSamplerDescriptors.dirty = true;
         }
     }
 }
@@ -500,11 +622,12 @@ void VulkanBinder::bindInputAttachment(uint32_t bindingIndex,
     ASSERT_POSTCONDITION(bindingIndex < TARGET_BINDING_COUNT,
             "Input attachment bindings overflow: index = %d, capacity = %d.",
             bindingIndex, TARGET_BINDING_COUNT);
-    VkDescriptorImageInfo& imageInfo = mDescriptorKey.inputAttachments[bindingIndex];
+    VkDescriptorImageInfo& imageInfo =
+            mInputAttachmentDescriptors.key.inputAttachments[bindingIndex];
     if (imageInfo.imageView != targetInfo.imageView ||
             imageInfo.imageLayout != targetInfo.imageLayout) {
         imageInfo = targetInfo;
-        mDirtyDescriptor = true;
+        mInputAttachmentDescriptors.dirty = true;
     }
 }
 
@@ -521,7 +644,11 @@ void VulkanBinder::destroyCache() noexcept {
 
 void VulkanBinder::resetBindings() noexcept {
     mDirtyPipeline = true;
-    mDirtyDescriptor = true;
+    mDirtyOffsets = true;
+    mUniformDescriptors.dirty = true;
+    mSamplerDescriptors.dirty = true;
+    mInputAttachmentDescriptors.dirty = true;
+    mStorageDescriptors.dirty = true;
 }
 
 // Frees up old descriptor sets and pipelines, then nulls out their key.
@@ -536,17 +663,12 @@ void VulkanBinder::gc() noexcept {
     }
     const uint32_t evictTime = mCurrentTime - TIME_BEFORE_EVICTION;
 
+    gcDescriptors(mUniformDescriptors, evictTime);
+    gcDescriptors(mSamplerDescriptors, evictTime);
+    gcDescriptors(mInputAttachmentDescriptors, evictTime);
+    gcDescriptors(mStorageDescriptors, evictTime);
+
     // Due to robin_map restrictions, we cannot use auto or a range-based loop.
-    for (decltype(mDescriptorBundles)::const_iterator iter = mDescriptorBundles.begin();
-            iter != mDescriptorBundles.end();) {
-        auto& cacheEntry = iter->second;
-        if (cacheEntry.timestamp < evictTime && !cacheEntry.bound) {
-            vkFreeDescriptorSets(mDevice, mDescriptorPool, 3, cacheEntry.handles);
-            iter = mDescriptorBundles.erase(iter);
-        } else {
-            ++iter;
-        }
-    }
     for (decltype(mPipelines)::const_iterator iter = mPipelines.begin();
             iter != mPipelines.end();) {
         auto& cacheEntry = iter->second;
@@ -564,16 +686,47 @@ void VulkanBinder::gc() noexcept {
     graveyard.swap(mDescriptorGraveyard);
     for (auto& val : graveyard) {
         if (val.timestamp < evictTime) {
-           vkFreeDescriptorSets(mDevice, mDescriptorPool, 3, val.handles);
+           vkFreeDescriptorSets(mDevice, mDescriptorPool, 1, &val.handle);
         } else {
-            mDescriptorGraveyard.emplace_back(DescriptorBundle {
-                .handles = { val.handles[0], val.handles[1], val.handles[2] },
-                .timestamp = val.timestamp
-            });
+            mDescriptorGraveyard.push_back(val);
         }
     }
 }
 
+template<typename Key>
+void VulkanBinder::gcDescriptors(DescriptorCache<Key>& cache, uint32_t evictTime) noexcept {
+    bool evicted = false;
+    // Due to robin_map restrictions, we cannot use auto or a range-based loop.
+    for (typename decltype(cache.sets)::const_iterator iter = cache.sets.begin();
+            iter != cache.sets.end();) {
+        auto& cacheEntry = iter->second;
+        if (cacheEntry.timestamp < evictTime && !cacheEntry.bound) {
+            vkFreeDescriptorSets(mDevice, mDescriptorPool, 1, &cacheEntry.handle);
+            iter = cache.sets.erase(iter);
+            evicted = true;
+        } else {
+            ++iter;
+        }
+    }
+    // Erasing entries can move the remaining ones, look up the bound one again.
+    if (evicted && cache.current) {
+        auto iter = cache.sets.find(cache.key);
+        if (iter != cache.sets.end() && iter->second.bound) {
+            cache.current = &iter.value();
+        } else {
+            cache.current = nullptr;
+            cache.dirty = true;
+        }
+    }
+}
+
+template<typename Key>
+void VulkanBinder::clearDescriptors(DescriptorCache<Key>& cache) noexcept {
+    cache.sets.clear();
+    cache.current = nullptr;
+    cache.dirty = true;
+}
+
 void VulkanBinder::createLayoutsAndDescriptors() noexcept {
     VkDescriptorSetLayoutBinding binding = {};
     binding.descriptorCount = 1; // NOTE: We never use arrays-of-blocks.
@@ -581,7 +734,7 @@ void VulkanBinder::createLayoutsAndDescriptors() noexcept {
 
     // First create the descriptor set layout for UBO's.
     VkDescriptorSetLayoutBinding ubindings[UBUFFER_BINDING_COUNT];
-    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     for (uint32_t i = 0; i < UBUFFER_BINDING_COUNT; i++) {
         binding.binding = i;
         ubindings[i] = binding;
@@ -624,22 +777,42 @@ void VulkanBinder::createLayoutsAndDescriptors() noexcept {
             &mPipelineLayout);
     ASSERT_POSTCONDITION(!err, "Unable to create pipeline layout.");
 
+    // Compute pipelines have a layout of their own, made of the storage buffers alone.
+    VkDescriptorSetLayoutBinding bbindings[STORAGE_BINDING_COUNT];
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    for (uint32_t i = 0; i < STORAGE_BINDING_COUNT; i++) {
+        binding.binding = i;
+        bbindings[i] = binding;
+    }
+    dlinfo.bindingCount = STORAGE_BINDING_COUNT;
+    dlinfo.pBindings = bbindings;
+    vkCreateDescriptorSetLayout(mDevice, &dlinfo, VKALLOC, &mDescriptorSetLayouts[3]);
+
+    pPipelineLayoutCreateInfo.setLayoutCount = 1;
+    pPipelineLayoutCreateInfo.pSetLayouts = &mDescriptorSetLayouts[3];
+    err = vkCreatePipelineLayout(mDevice, &pPipelineLayoutCreateInfo, VKALLOC,
+            &mComputePipelineLayout);
+    ASSERT_POSTCONDITION(!err, "Unable to create compute pipeline layout.");
+
     // Create the VkDescriptorPool.
-    VkDescriptorPoolSize poolSizes[3] = {};
+    VkDescriptorPoolSize poolSizes[4] = {};
     VkDescriptorPoolCreateInfo poolInfo {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
         .pNext = nullptr,
         .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
-        .maxSets = MAX_DESCRIPTOR_SET_COUNT,
-        .poolSizeCount = 3,
+        .maxSets = MAX_DESCRIPTOR_SET_COUNT * 4,
+        .poolSizeCount = 4,
         .pPoolSizes = poolSizes
     };
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = poolInfo.maxSets * UBUFFER_BINDING_COUNT;
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[0].descriptorCount = MAX_DESCRIPTOR_SET_COUNT * UBUFFER_BINDING_COUNT;
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = poolInfo.maxSets * SAMPLER_BINDING_COUNT;
+    poolSizes[1].descriptorCount = MAX_DESCRIPTOR_SET_COUNT * SAMPLER_BINDING_COUNT;
     poolSizes[2].type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-    poolSizes[2].descriptorCount = poolInfo.maxSets * TARGET_BINDING_COUNT;
+    poolSizes[2].descriptorCount = MAX_DESCRIPTOR_SET_COUNT * TARGET_BINDING_COUNT;
+    poolSizes[3].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[3].descriptorCount = MAX_DESCRIPTOR_SET_COUNT * STORAGE_BINDING_COUNT;
 
     err = vkCreateDescriptorPool(mDevice, &poolInfo, VKALLOC, &mDescriptorPool);
     ASSERT_POSTCONDITION(!err, "Unable to create descriptor pool.");
@@ -653,21 +826,29 @@ void VulkanBinder::destroyLayoutsAndDescriptors() noexcept {
     // Our current descriptor set strategy can cause the # of descriptor sets to explode in certain
     // situations, so it's interesting to report the number that get stuffed into the cache.
     #ifndef NDEBUG
-    utils::slog.d << "Destroying " << mDescriptorBundles.size() << " bundles of descriptor sets."
+    utils::slog.d << "Destroying "
+            << mUniformDescriptors.sets.size() << " uniform, "
+            << mSamplerDescriptors.sets.size() << " sampler, "
+            << mInputAttachmentDescriptors.sets.size() << " input attachment and "
+            << mStorageDescriptors.sets.size() << " storage descriptor sets."
             << utils::io::endl;
     #endif
 
-    mDescriptorBundles.clear();
+    clearDescriptors(mUniformDescriptors);
+    clearDescriptors(mSamplerDescriptors);
+    clearDescriptors(mInputAttachmentDescriptors);
+    clearDescriptors(mStorageDescriptors);
+    mDescriptorGraveyard.clear();
     vkDestroyPipelineLayout(mDevice, mPipelineLayout, VKALLOC);
     mPipelineLayout = VK_NULL_HANDLE;
-    for (int i = 0; i < 3; i++) {
+    vkDestroyPipelineLayout(mDevice, mComputePipelineLayout, VKALLOC);
+    mComputePipelineLayout = VK_NULL_HANDLE;
+    for (int i = 0; i < 4; i++) {
         vkDestroyDescriptorSetLayout(mDevice, mDescriptorSetLayouts[i], VKALLOC);
         mDescriptorSetLayouts[i] = {};
     }
     vkDestroyDescriptorPool(mDevice, mDescriptorPool, VKALLOC);
     mDescriptorPool = VK_NULL_HANDLE;
-    mCurrentDescriptorBundle = nullptr;
-    mDirtyDescriptor = true;
 }
 
 bool VulkanBinder::PipelineEqual::operator()(const VulkanBinder::PipelineKey& k1,
@@ -675,15 +856,19 @@ bool VulkanBinder::PipelineEqual::operator()(const VulkanBinder::PipelineKey& k1
     return 0 == memcmp((const void*) &k1, (const void*) &k2, sizeof(k1));
 }
 
-bool VulkanBinder::DescEqual::operator()(const VulkanBinder::DescriptorKey& k1,
-        const VulkanBinder::DescriptorKey& k2) const {
+bool VulkanBinder::DescEqual::operator()(const VulkanBinder::UniformBufferKey& k1,
+        const VulkanBinder::UniformBufferKey& k2) const {
     for (uint32_t i = 0; i < UBUFFER_BINDING_COUNT; i++) {
         if (k1.uniformBuffers[i] != k2.uniformBuffers[i] ||
-            k1.uniformBufferOffsets[i] != k2.uniformBufferOffsets[i] ||
             k1.uniformBufferSizes[i] != k2.uniformBufferSizes[i]) {
             return false;
         }
     }
+    return true;
+}
+
+bool VulkanBinder::DescEqual::operator()(const VulkanBinder::SamplerKey& k1,
+        const VulkanBinder::SamplerKey& k2) const {
     for (uint32_t i = 0; i < SAMPLER_BINDING_COUNT; i++) {
         if (k1.samplers[i].sampler != k2.samplers[i].sampler ||
             k1.samplers[i].imageView != k2.samplers[i].imageView ||
@@ -691,6 +876,11 @@ bool VulkanBinder::DescEqual::operator()(const VulkanBinder::DescriptorKey& k1,
             return false;
         }
     }
+    return true;
+}
+
+bool VulkanBinder::DescEqual::operator()(const VulkanBinder::InputAttachmentKey& k1,
+        const VulkanBinder::InputAttachmentKey& k2) const {
     for (uint32_t i = 0; i < TARGET_BINDING_COUNT; i++) {
         if (k1.inputAttachments[i].imageView != k2.inputAttachments[i].imageView ||
             k1.inputAttachments[i].imageLayout != k2.inputAttachments[i].imageLayout) {
@@ -700,6 +890,16 @@ bool VulkanBinder::DescEqual::operator()(const VulkanBinder::DescriptorKey& k1,
     return true;
 }
 
+bool VulkanBinder::DescEqual::operator()(const VulkanBinder::StorageBufferKey& k1,
+        const VulkanBinder::StorageBufferKey& k2) const {
+    for (uint32_t i = 0; i < STORAGE_BINDING_COUNT; i++) {
+        if (k1.storageBuffers[i] != k2.storageBuffers[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
 static VulkanBinder::RasterState createDefaultRasterState() {
     VkPipelineRasterizationStateCreateInfo rasterization = {};
     rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -50,8 +50,9 @@ namespace backend {
 //        mBinder.bindPrimitiveTopology(geo.topology);
 //        mBinder.bindVertexArray(geo.varray);
 //        VkDescriptorSet descriptors[3];
-//        if (mBinder.getOrCreateDescriptors(descriptors, ...)) {
-//            vkCmdBindDescriptorSets(... descriptors ...);
+//        uint32_t offsets[UBUFFER_BINDING_COUNT];
+//        if (mBinder.getOrCreateDescriptors(descriptors, &layout, offsets)) {
+//            vkCmdBindDescriptorSets(... descriptors ..., offsets);
 //        }
 //        VkPipeline pipeline;
 //        if (mBinder.getOrCreatePipeline(&pipeline)) {
@@ -67,16 +68,22 @@ namespace backend {
 //
 // In the name of simplicity, VulkanBinder has the following limitations:
 // - Push constants are not supported. (if adding support, see VkPipelineLayoutCreateInfo)
-// - Only three descriptor sets are bound at a time (one for each type of descriptor).
+// - Only three descriptor sets are bound at a time (one for each type of descriptor). Each of them
+//   is cached on its own, so that e.g. changing materials does not re-create uniform descriptors.
+// - Uniform buffers are dynamic uniform buffers, so binding a different range of the same buffer
+//   only changes the dynamic offsets and does not require a new descriptor set.
 // - Descriptor sets are never mutated using vkUpdateDescriptorSets, except upon creation.
 // - Assumes that viewport and scissor should be dynamic. (not baked into VkPipeline)
 // - Assumes that uniform buffers should be visible across all shader stages.
+// - Compute pipelines only see storage buffers, through a fourth descriptor set that is the only
+//   set of their own pipeline layout. They are owned by the client, see createComputePipeline().
 //
 class VulkanBinder {
 public:
     static constexpr uint32_t UBUFFER_BINDING_COUNT = Program::UNIFORM_BINDING_COUNT;
     static constexpr uint32_t SAMPLER_BINDING_COUNT = backend::MAX_SAMPLER_COUNT;
     static constexpr uint32_t TARGET_BINDING_COUNT = MRT::TARGET_COUNT;
+    static constexpr uint32_t STORAGE_BINDING_COUNT = backend::MAX_STORAGE_BUFFER_COUNT;
     static constexpr uint32_t SHADER_MODULE_COUNT = 2;
     static constexpr uint32_t VERTEX_ATTRIBUTE_COUNT = backend::MAX_VERTEX_ATTRIBUTE_COUNT;
 
@@ -89,10 +96,12 @@ public:
         VkVertexInputBindingDescription buffers[VERTEX_ATTRIBUTE_COUNT];
     };
 
-    // The ProgramBundle contains weak references to the compiled vertex and fragment shaders.
+    // The ProgramBundle contains weak references to the compiled vertex and fragment shaders, or
+    // to the compiled compute shader.
     struct ProgramBundle {
         VkShaderModule vertex;
         VkShaderModule fragment;
+        VkShaderModule compute;
     };
 
     // The RasterState POD contains standard graphics-related state like blending, culling, etc.
@@ -114,18 +123,35 @@ public:
     VulkanBinder();
     ~VulkanBinder();
     void setDevice(VkDevice device) { mDevice = device; }
+    void setPipelineCache(VkPipelineCache cache) { mPipelineCache = cache; }
+
+    // When enabled, the fragment shading rate is a dynamic state of all pipelines. This must be
+    // set before the first pipeline is created.
+    void setFragmentShadingRateEnabled(bool enabled) { mFragmentShadingRateEnabled = enabled; }
 
     // Clients should initialize their copy of the raster state using this method. They can then
     // mutate their copy and pass it back through bindRasterState().
     const RasterState& getDefaultRasterState() const { return mDefaultRasterState; }
 
-    // Returns true if vkCmdBindDescriptorSets is required.
-    bool getOrCreateDescriptors(VkDescriptorSet descriptors[3], VkPipelineLayout* pipelineLayout)
-            noexcept;
+    // Returns true if vkCmdBindDescriptorSets is required. The dynamic offsets of the uniform
+    // buffers are returned in dynamicOffsets.
+    bool getOrCreateDescriptors(VkDescriptorSet descriptors[3], VkPipelineLayout* pipelineLayout,
+            uint32_t dynamicOffsets[UBUFFER_BINDING_COUNT]) noexcept;
 
     // Returns true if any pipeline bindings have changed. (i.e., vkCmdBindPipeline is required)
     bool getOrCreatePipeline(VkPipeline* pipeline) noexcept;
 
+    // Returns the storage buffer descriptor set, which is the only set of the compute pipeline
+    // layout. Dispatches can be recorded outside of the frame's command buffer, so the client
+    // should bind it before every dispatch.
+    void getOrCreateComputeDescriptors(VkDescriptorSet* descriptors,
+            VkPipelineLayout* pipelineLayout) noexcept;
+
+    // Creates a compute pipeline for the given shader module. Unlike graphics pipelines, compute
+    // pipelines depend on nothing else, so they are not cached here and the caller must destroy
+    // them. Must be called after getOrCreateComputeDescriptors.
+    VkPipeline createComputePipeline(VkShaderModule compute) noexcept;
+
     // Each bind method is fast and does not make Vulkan calls.
     void bindProgramBundle(const ProgramBundle& bundle) noexcept;
     void bindRasterState(const RasterState& rasterState) noexcept;
@@ -136,12 +162,16 @@ public:
     void bindSamplers(VkDescriptorImageInfo samplers[SAMPLER_BINDING_COUNT]) noexcept;
     void bindInputAttachment(uint32_t bindingIndex, VkDescriptorImageInfo imageInfo) noexcept;
     void bindVertexArray(const VertexArray& varray) noexcept;
+    void bindStorageBuffer(uint32_t bindingIndex, VkBuffer storageBuffer) noexcept;
 
     // Checks if the given uniform is bound to any slot, and if so binds "null" to that slot.
     // Also invalidates all cached descriptors that refer to the given buffer.
     // This is only necessary when the client knows that the UBO is about to be destroyed.
     void unbindUniformBuffer(VkBuffer uniformBuffer) noexcept;
 
+    // Same as unbindUniformBuffer, for storage buffers.
+    void unbindStorageBuffer(VkBuffer storageBuffer) noexcept;
+
     // Checks if an image view is bound to any sampler, and if so resets that particular slot.
     // Also invalidates all cached descriptors that refer to the given image view.
     // This is only necessary when the client knows that a texture is about to be destroyed.
@@ -179,7 +209,7 @@ private:
 
     static_assert(std::is_pod<PipelineKey>::value, "PipelineKey must be a POD for fast hashing.");
 
-    using PipelineHashFn = utils::hash::MurmurHashFn<PipelineKey>;
+    using PipelineHashFn = utils::hash::WyHashFn<PipelineKey>;
 
     struct PipelineEqual {
         bool operator()(const PipelineKey& k1, const PipelineKey& k2) const;
@@ -191,39 +221,72 @@ private:
         bool bound;
     };
 
-    // The descriptor key is a POD that represents all currently bound states that go into the
-    // descriptor set. We apply a hash function to its contents only if has been mutated since
-    // the previous call to getOrCreateDescriptors.
+    // The descriptor keys are PODs that represent all currently bound states that go into each of
+    // the four descriptor sets. We apply a hash function to their contents only if they have been
+    // mutated since the previous call to getOrCreateDescriptors. Note that the uniform buffer
+    // offsets are not part of the key, since they are dynamic.
     #pragma pack(push, 1)
-    struct UTILS_PACKED DescriptorKey {
+    struct UTILS_PACKED UniformBufferKey {
         VkBuffer uniformBuffers[UBUFFER_BINDING_COUNT];
+        VkDeviceSize uniformBufferSizes[UBUFFER_BINDING_COUNT];
+    };
+    struct UTILS_PACKED SamplerKey {
         VkDescriptorImageInfo samplers[SAMPLER_BINDING_COUNT];
+    };
+    struct UTILS_PACKED InputAttachmentKey {
         VkDescriptorImageInfo inputAttachments[TARGET_BINDING_COUNT];
-        VkDeviceSize uniformBufferOffsets[UBUFFER_BINDING_COUNT];
-        VkDeviceSize uniformBufferSizes[UBUFFER_BINDING_COUNT];
+    };
+    struct UTILS_PACKED StorageBufferKey {
+        VkBuffer storageBuffers[STORAGE_BINDING_COUNT];
     };
     #pragma pack(pop)
 
-    static_assert(std::is_pod<DescriptorKey>::value, "DescriptorKey must be a POD.");
-
-    using DescHashFn = utils::hash::MurmurHashFn<DescriptorKey>;
+    static_assert(std::is_pod<UniformBufferKey>::value, "UniformBufferKey must be a POD.");
+    static_assert(std::is_pod<SamplerKey>::value, "SamplerKey must be a POD.");
+    static_assert(std::is_pod<InputAttachmentKey>::value, "InputAttachmentKey must be a POD.");
+    static_assert(std::is_pod<StorageBufferKey>::value, "StorageBufferKey must be a POD.");
 
     struct DescEqual {
-        bool operator()(const DescriptorKey& k1, const DescriptorKey& k2) const;
+        bool operator()(const UniformBufferKey& k1, const UniformBufferKey& k2) const;
+        bool operator()(const SamplerKey& k1, const SamplerKey& k2) const;
+        bool operator()(const InputAttachmentKey& k1, const InputAttachmentKey& k2) const;
+        bool operator()(const StorageBufferKey& k1, const StorageBufferKey& k2) const;
     };
 
-    // Represents a set of descriptor sets that are bound simultanously.
-    struct DescriptorBundle {
-        VkDescriptorSet handles[3];
+    struct DescriptorVal {
+        VkDescriptorSet handle;
         uint32_t timestamp;
         bool bound;
     };
 
+    // A cache of descriptor sets, along with the key that is currently bound.
+    template<typename Key>
+    struct DescriptorCache {
+        tsl::robin_map<Key, DescriptorVal, utils::hash::WyHashFn<Key>, DescEqual> sets;
+        Key key = {};
+        DescriptorVal* current = nullptr;
+        bool dirty = true;
+    };
+
+    template<typename Key, typename WriteFn>
+    bool getOrCreateDescriptorSet(DescriptorCache<Key>& cache, uint32_t setIndex,
+            WriteFn&& write) noexcept;
+
+    template<typename Key, typename FilterFn>
+    void evictDescriptors(DescriptorCache<Key>& cache, FilterFn&& filter) noexcept;
+
+    template<typename Key>
+    void gcDescriptors(DescriptorCache<Key>& cache, uint32_t evictTime) noexcept;
+
+    template<typename Key>
+    void clearDescriptors(DescriptorCache<Key>& cache) noexcept;
+
     void createLayoutsAndDescriptors() noexcept;
     void destroyLayoutsAndDescriptors() noexcept;
-    void evictDescriptors(std::function<bool(const DescriptorKey&)> filter) noexcept;
 
     VkDevice mDevice = nullptr;
+    bool mFragmentShadingRateEnabled = false;
+    VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
     const RasterState mDefaultRasterState;
 
     // These structs are used only in a transient way but are stored for convenience.
@@ -232,6 +295,7 @@ private:
     VkDescriptorBufferInfo mDescriptorBuffers[UBUFFER_BINDING_COUNT];
     VkDescriptorImageInfo mDescriptorSamplers[SAMPLER_BINDING_COUNT];
     VkDescriptorImageInfo mDescriptorInputAttachments[TARGET_BINDING_COUNT];
+    VkDescriptorBufferInfo mDescriptorStorageBuffers[STORAGE_BINDING_COUNT];
     VkWriteDescriptorSet mDescriptorWrites[
             UBUFFER_BINDING_COUNT + SAMPLER_BINDING_COUNT + TARGET_BINDING_COUNT];
     VkPipelineColorBlendAttachmentState mColorBlendAttachments[MRT::TARGET_COUNT];
@@ -240,24 +304,28 @@ private:
     // (e.g., blending is OFF) and weak references to Vulkan objects (e.g., shader programs and
     // uniform buffers).
     PipelineKey mPipelineKey;
-    DescriptorKey mDescriptorKey;
 
-    // Weak references to the currently bound pipeline and descriptor sets.
+    // Weak references to the currently bound pipeline.
     PipelineVal* mCurrentPipeline = nullptr;
-    DescriptorBundle* mCurrentDescriptorBundle = nullptr;
 
     // If one of these dirty flags is set, then one or more its constituent bindings have changed, so
-    // a new pipeline or descriptor set needs to be retrieved from the cache or created.
+    // a new pipeline or descriptor set needs to be retrieved from the cache or created, or the
+    // descriptor sets need to be bound again with new dynamic offsets.
     bool mDirtyPipeline = true;
-    bool mDirtyDescriptor = true;
+    bool mDirtyOffsets = true;
+    uint32_t mUniformBufferOffsets[UBUFFER_BINDING_COUNT] = {};
 
     // Cached Vulkan objects. These objects are owned by the Binder.
-    VkDescriptorSetLayout mDescriptorSetLayouts[3] = {};
+    VkDescriptorSetLayout mDescriptorSetLayouts[4] = {};
     VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
+    VkPipelineLayout mComputePipelineLayout = VK_NULL_HANDLE;
     tsl::robin_map<PipelineKey, PipelineVal, PipelineHashFn, PipelineEqual> mPipelines;
-    tsl::robin_map<DescriptorKey, DescriptorBundle, DescHashFn, DescEqual> mDescriptorBundles;
+    DescriptorCache<UniformBufferKey> mUniformDescriptors;
+    DescriptorCache<SamplerKey> mSamplerDescriptors;
+    DescriptorCache<InputAttachmentKey> mInputAttachmentDescriptors;
+    DescriptorCache<StorageBufferKey> mStorageDescriptors;
     VkDescriptorPool mDescriptorPool;
-    std::vector<DescriptorBundle> mDescriptorGraveyard;
+    std::vector<DescriptorVal> mDescriptorGraveyard;
 
     // Store the current "time" (really just a frame count) and LRU eviction parameters.
     uint32_t mCurrentTime = 0;
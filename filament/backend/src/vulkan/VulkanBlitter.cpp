@@ -99,11 +99,16 @@ void VulkanBlitter::blitFast(VkImageAspectFlags aspect, VkFilter filter,
         .extent = { srcExtent.width, srcExtent.height, 1 }
     }};
 
-    VulkanTexture::transitionImageLayout(cmdbuffer, src.image, VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, src.level, 1, 1, aspect);
-
-    VulkanTexture::transitionImageLayout(cmdbuffer, dst.image, VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, dst.level, 1, 1, aspect);
+    // The images may still have their transitions from a previous blit pending, e.g. when
+    // generating mipmaps, in which case these replace them.
+    VulkanBarrierBatch& barriers = mContext.barriers;
+    const VkImageSubresourceRange srcRange = { aspect, src.level, 1, src.layer, 1 };
+    const VkImageSubresourceRange dstRange = { aspect, dst.level, 1, dst.layer, 1 };
+    barriers.transition(cmdbuffer, src.image, VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, srcRange);
+    barriers.transition(cmdbuffer, dst.image, VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, dstRange);
+    barriers.flush();
 
     if (src.texture && src.texture->samples > 1 && dst.texture && dst.texture->samples == 1) {
         assert_invariant(aspect != VK_IMAGE_ASPECT_DEPTH_BIT && "Resolve with depth is not yet supported.");
@@ -114,12 +119,14 @@ void VulkanBlitter::blitFast(VkImageAspectFlags aspect, VkFilter filter,
                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, blitRegions, filter);
     }
 
+    // Restoring the layouts is deferred until the images are used again.
+
     if (src.texture) {
-        VulkanTexture::transitionImageLayout(cmdbuffer, src.image, VK_IMAGE_LAYOUT_UNDEFINED,
-                getTextureLayout(src.texture->usage), src.level, 1, 1, aspect);
+        barriers.transition(cmdbuffer, src.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                getTextureLayout(src.texture->usage), srcRange);
     } else if  (!mContext.currentSurface->headlessQueue) {
-        VulkanTexture::transitionImageLayout(cmdbuffer, src.image, VK_IMAGE_LAYOUT_UNDEFINED,
-                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, src.level, 1, 1, aspect);
+        barriers.transition(cmdbuffer, src.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, srcRange);
     }
 
     // Determine the desired texture layout for the destination while ensuring that the default
@@ -127,8 +134,8 @@ void VulkanBlitter::blitFast(VkImageAspectFlags aspect, VkFilter filter,
     const VkImageLayout desiredLayout = dst.texture ? getTextureLayout(dst.texture->usage) :
             getSwapContext(mContext).attachment.layout;
 
-    VulkanTexture::transitionImageLayout(cmdbuffer, dst.image, VK_IMAGE_LAYOUT_UNDEFINED,
-            desiredLayout, dst.level, 1, 1, aspect);
+    barriers.transition(cmdbuffer, dst.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            desiredLayout, dstRange);
 }
 
 void VulkanBlitter::shutdown() noexcept {
@@ -26,7 +26,7 @@ namespace backend {
 VulkanBuffer::VulkanBuffer(VulkanContext& context, VulkanStagePool& stagePool,
         VulkanDisposer& disposer, VulkanDisposer::Key key, VkBufferUsageFlags usage,
         uint32_t numBytes) : mContext(context), mStagePool(stagePool), mDisposer(disposer),
-        mDisposerKey(key) {
+        mDisposerKey(key), mUsage(usage) {
     // Create the VkBuffer.
     VkBufferCreateInfo bufferInfo {
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -44,33 +44,43 @@ VulkanBuffer::~VulkanBuffer() {
 }
 
 void VulkanBuffer::loadFromCpu(const void* cpuData, uint32_t byteOffset, uint32_t numBytes) {
-    assert_invariant(byteOffset == 0);
-    VulkanStage const* stage = mStagePool.acquireStage(numBytes);
-    void* mapped;
-    vmaMapMemory(mContext.allocator, stage->memory, &mapped);
-    memcpy(mapped, cpuData, numBytes);
-    vmaUnmapMemory(mContext.allocator, stage->memory);
-    vmaFlushAllocation(mContext.allocator, stage->memory, byteOffset, numBytes);
+    auto copyToDevice = [this, cpuData, byteOffset, numBytes] (VulkanCommandBuffer& commands) {
+        VulkanStageRange const stage = mStagePool.acquireRange(numBytes, commands);
+        memcpy(stage.mapped, cpuData, numBytes);
+        vmaFlushAllocation(mContext.allocator, stage.memory, stage.offset, numBytes);
 
-    auto copyToDevice = [this, numBytes, stage] (VulkanCommandBuffer& commands) {
-        VkBufferCopy region { .size = numBytes };
-        vkCmdCopyBuffer(commands.cmdbuffer, stage->buffer, mGpuBuffer, 1, &region);
+        VkBufferCopy region {
+            .srcOffset = stage.offset,
+            .dstOffset = byteOffset,
+            .size = numBytes
+        };
+        vkCmdCopyBuffer(commands.cmdbuffer, stage.buffer, mGpuBuffer, 1, &region);
         mDisposer.acquire(mDisposerKey, commands.resources);
 
-        // Ensure that the copy finishes before the next draw call.
+        // Ensure that the copy finishes before the next draw call, or the next dispatch when
+        // this is a storage buffer.
+        VkAccessFlags dstAccessMask =
+                VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+        VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        if (mUsage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
+            dstAccessMask |= VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            dstStageMask |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        }
+        if (mUsage & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT) {
+            dstAccessMask |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+            dstStageMask |= VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+        }
         VkBufferMemoryBarrier barrier {
             .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
             .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-            .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT,
+            .dstAccessMask = dstAccessMask,
             .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
             .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
             .buffer = mGpuBuffer,
             .size = VK_WHOLE_SIZE
         };
-        vkCmdPipelineBarrier(commands.cmdbuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
-
-        mStagePool.releaseStage(stage, commands);
+        vkCmdPipelineBarrier(commands.cmdbuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStageMask, 0,
+                0, nullptr, 1, &barrier, 0, nullptr);
     };
 
     // If inside beginFrame / endFrame, use the swap context, otherwise use the work cmdbuffer.
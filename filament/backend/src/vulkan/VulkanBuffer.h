@@ -36,6 +36,7 @@ private:
     VulkanStagePool& mStagePool;
     VulkanDisposer& mDisposer;
     VulkanDisposer::Key mDisposerKey;
+    VkBufferUsageFlags mUsage;
     VmaAllocation mGpuMemory = VK_NULL_HANDLE;
     VkBuffer mGpuBuffer = VK_NULL_HANDLE;
 };
@@ -26,8 +26,12 @@
 #include "VulkanHandles.h"
 #include "VulkanUtility.h"
 
+#include <backend/Platform.h>
+
 #include <utils/Panic.h>
 
+#include <algorithm>
+
 #ifndef VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME
 #define VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME "VK_KHR_portability_subset"
 #endif
@@ -93,6 +97,8 @@ void selectPhysicalDevice(VulkanContext& context) {
             }
             if (props.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
                 context.graphicsQueueFamilyIndex = j;
+                // compute work is recorded into the graphics command buffers
+                context.computeSupported = props.queueFlags & VK_QUEUE_COMPUTE_BIT;
             }
         }
         if (context.graphicsQueueFamilyIndex == 0xffff) continue;
@@ -108,7 +114,19 @@ void selectPhysicalDevice(VulkanContext& context) {
                 &extensionCount, extensions.data());
         ASSERT_POSTCONDITION(result == VK_SUCCESS, "vkEnumerateDeviceExtensionProperties error.");
         bool supportsSwapchain = false;
+        bool supportsRenderPass2 = false;
+        bool supportsMultiview = false;
+        bool supportsMaintenance2 = false;
+        bool supportsFragmentShadingRate = false;
+        bool supportsTimelineSemaphore = false;
+        bool supportsDepthStencilResolve = false;
         context.debugMarkersSupported = false;
+        context.memoryBudgetSupported = false;
+        context.fragmentShadingRateSupported = false;
+        context.displayTimingSupported = false;
+        context.timelineSemaphoreSupported = false;
+        context.incrementalPresentSupported = false;
+        context.depthResolveSupported = false;
         for (uint32_t k = 0; k < extensionCount; ++k) {
             if (!strcmp(extensions[k].extensionName, VK_KHR_SWAPCHAIN_EXTENSION_NAME)) {
                 supportsSwapchain = true;
@@ -119,9 +137,75 @@ void selectPhysicalDevice(VulkanContext& context) {
             if (!strcmp(extensions[k].extensionName, VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME)) {
                 context.portabilitySubsetSupported = true;
             }
+            // VMA needs vkGetPhysicalDeviceMemoryProperties2KHR to query the memory budget.
+            if (!strcmp(extensions[k].extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+                context.memoryBudgetSupported = vkGetPhysicalDeviceMemoryProperties2KHR != nullptr;
+            }
+            if (!strcmp(extensions[k].extensionName, VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME)) {
+                supportsRenderPass2 = true;
+            }
+            if (!strcmp(extensions[k].extensionName, VK_KHR_MULTIVIEW_EXTENSION_NAME)) {
+                supportsMultiview = true;
+            }
+            if (!strcmp(extensions[k].extensionName, VK_KHR_MAINTENANCE2_EXTENSION_NAME)) {
+                supportsMaintenance2 = true;
+            }
+            if (!strcmp(extensions[k].extensionName, VK_KHR_FRAGMENT_SHADING_RATE_EXTENSION_NAME)) {
+                supportsFragmentShadingRate = true;
+            }
+            if (!strcmp(extensions[k].extensionName, VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME)) {
+                context.displayTimingSupported = true;
+            }
+            if (!strcmp(extensions[k].extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)) {
+                supportsTimelineSemaphore = true;
+            }
+            if (!strcmp(extensions[k].extensionName, VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME)) {
+                context.incrementalPresentSupported = true;
+            }
+            if (!strcmp(extensions[k].extensionName, VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME)) {
+                supportsDepthStencilResolve = true;
+            }
         }
         if (!supportsSwapchain) continue;
 
+        // The instance is created for Vulkan 1.0, so the dependencies of
+        // VK_KHR_create_renderpass2, which are core in Vulkan 1.1, must be enabled as extensions.
+        const bool renderPass2Usable = supportsRenderPass2 && supportsMultiview &&
+                supportsMaintenance2;
+
+        // We only use the per-pipeline (i.e. per-draw) shading rate.
+        if (renderPass2Usable && supportsFragmentShadingRate &&
+                vkGetPhysicalDeviceFeatures2KHR && vkCmdSetFragmentShadingRateKHR) {
+            VkPhysicalDeviceFragmentShadingRateFeaturesKHR shadingRateFeatures = {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_SHADING_RATE_FEATURES_KHR,
+            };
+            VkPhysicalDeviceFeatures2 features2 = {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                .pNext = &shadingRateFeatures,
+            };
+            vkGetPhysicalDeviceFeatures2KHR(physicalDevice, &features2);
+            context.fragmentShadingRateSupported = shadingRateFeatures.pipelineFragmentShadingRate;
+        }
+
+        // VK_KHR_depth_stencil_resolve also requires VK_KHR_create_renderpass2, and every
+        // implementation of it supports the SAMPLE_ZERO resolve mode.
+        context.depthResolveSupported = renderPass2Usable &&
+                supportsDepthStencilResolve && vkCreateRenderPass2KHR;
+
+        // The extension can be exposed without the feature, e.g. by layered implementations.
+        if (supportsTimelineSemaphore && vkGetPhysicalDeviceFeatures2KHR &&
+                vkGetSemaphoreCounterValueKHR) {
+            VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR,
+            };
+            VkPhysicalDeviceFeatures2 features2 = {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                .pNext = &timelineFeatures,
+            };
+            vkGetPhysicalDeviceFeatures2KHR(physicalDevice, &features2);
+            context.timelineSemaphoreSupported = timelineFeatures.timelineSemaphore;
+        }
+
         // Bingo, we finally found a physical device that supports everything we need.
         context.physicalDevice = physicalDevice;
         vkGetPhysicalDeviceFeatures(physicalDevice, &context.physicalDeviceFeatures);
@@ -187,6 +271,29 @@ void createLogicalDevice(VulkanContext& context) {
     if (context.portabilitySubsetSupported) {
         deviceExtensionNames.push_back(VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME);
     }
+    if (context.memoryBudgetSupported) {
+        deviceExtensionNames.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+    if (context.fragmentShadingRateSupported || context.depthResolveSupported) {
+        deviceExtensionNames.push_back(VK_KHR_MULTIVIEW_EXTENSION_NAME);
+        deviceExtensionNames.push_back(VK_KHR_MAINTENANCE2_EXTENSION_NAME);
+        deviceExtensionNames.push_back(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME);
+    }
+    if (context.fragmentShadingRateSupported) {
+        deviceExtensionNames.push_back(VK_KHR_FRAGMENT_SHADING_RATE_EXTENSION_NAME);
+    }
+    if (context.depthResolveSupported) {
+        deviceExtensionNames.push_back(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME);
+    }
+    if (context.displayTimingSupported) {
+        deviceExtensionNames.push_back(VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME);
+    }
+    if (context.timelineSemaphoreSupported) {
+        deviceExtensionNames.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+    }
+    if (context.incrementalPresentSupported) {
+        deviceExtensionNames.push_back(VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+    }
     deviceQueueCreateInfo->sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
     deviceQueueCreateInfo->queueFamilyIndex = context.graphicsQueueFamilyIndex;
     deviceQueueCreateInfo->queueCount = 1;
@@ -204,6 +311,23 @@ void createLogicalDevice(VulkanContext& context) {
     };
 
     deviceCreateInfo.pEnabledFeatures = &enabledFeatures;
+
+    VkPhysicalDeviceFragmentShadingRateFeaturesKHR shadingRateFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_SHADING_RATE_FEATURES_KHR,
+        .pipelineFragmentShadingRate = VK_TRUE,
+    };
+    if (context.fragmentShadingRateSupported) {
+        deviceCreateInfo.pNext = &shadingRateFeatures;
+    }
+
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR,
+        .pNext = const_cast<void*>(deviceCreateInfo.pNext),
+        .timelineSemaphore = VK_TRUE,
+    };
+    if (context.timelineSemaphoreSupported) {
+        deviceCreateInfo.pNext = &timelineFeatures;
+    }
     deviceCreateInfo.enabledExtensionCount = (uint32_t)deviceExtensionNames.size();
     deviceCreateInfo.ppEnabledExtensionNames = deviceExtensionNames.data();
     VkResult result = vkCreateDevice(context.physicalDevice, &deviceCreateInfo, VKALLOC,
@@ -212,6 +336,21 @@ void createLogicalDevice(VulkanContext& context) {
     vkGetDeviceQueue(context.device, context.graphicsQueueFamilyIndex, 0,
             &context.graphicsQueue);
 
+    if (context.timelineSemaphoreSupported) {
+        const VkSemaphoreTypeCreateInfoKHR typeInfo = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR,
+            .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR,
+            .initialValue = 0,
+        };
+        const VkSemaphoreCreateInfo semaphoreInfo = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            .pNext = &typeInfo,
+        };
+        result = vkCreateSemaphore(context.device, &semaphoreInfo, VKALLOC,
+                &context.timeline.semaphore);
+        ASSERT_POSTCONDITION(result == VK_SUCCESS, "vkCreateSemaphore error.");
+    }
+
     VkCommandPoolCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     createInfo.flags =
@@ -251,9 +390,14 @@ void createLogicalDevice(VulkanContext& context) {
         .vkDestroyImage = vkDestroyImage,
         .vkCmdCopyBuffer = vkCmdCopyBuffer,
         .vkGetBufferMemoryRequirements2KHR = vkGetBufferMemoryRequirements2KHR,
-        .vkGetImageMemoryRequirements2KHR = vkGetImageMemoryRequirements2KHR
+        .vkGetImageMemoryRequirements2KHR = vkGetImageMemoryRequirements2KHR,
+        .vkGetPhysicalDeviceMemoryProperties2KHR = vkGetPhysicalDeviceMemoryProperties2KHR
     };
+    // With VK_EXT_memory_budget, VMA tracks the budget given by the driver rather than
+    // estimating it from the heap sizes; it is refreshed every frame in beginFrame().
     const VmaAllocatorCreateInfo allocatorInfo {
+        .flags = context.memoryBudgetSupported ?
+                VmaAllocatorCreateFlags(VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT) : 0u,
         .physicalDevice = context.physicalDevice,
         .device = context.device,
         .pVulkanFunctions = &funcs,
@@ -576,6 +720,20 @@ uint32_t selectMemoryType(VulkanContext& context, uint32_t flags, VkFlags reqs)
     return (uint32_t) ~0ul;
 }
 
+void logMemoryBudget(VulkanContext& context) {
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetBudget(context.allocator, budgets);
+    for (uint32_t i = 0; i < context.memoryProperties.memoryHeapCount; i++) {
+        utils::slog.i << "Vulkan heap " << i << ": "
+                << budgets[i].allocationBytes / 1024 << " KiB allocated in "
+                << budgets[i].blockBytes / 1024 << " KiB of blocks, "
+                << budgets[i].usage / 1024 << " KiB used of "
+                << budgets[i].budget / 1024 << " KiB budget"
+                << (context.memoryBudgetSupported ? "" : " (estimated)")
+                << utils::io::endl;
+    }
+}
+
 SwapContext& getSwapContext(VulkanContext& context) {
     VulkanSurfaceContext& surface = *context.currentSurface;
     return surface.swapContexts[surface.currentSwapIndex];
@@ -651,6 +809,7 @@ bool acquireSwapCommandBuffer(VulkanContext& context) {
     if (cmdfence) {
         VkResult result = vkWaitForFences(context.device, 1, &cmdfence->fence, VK_TRUE, UINT64_MAX);
         ASSERT_POSTCONDITION(result == VK_SUCCESS, "vkWaitForFences error.");
+        markCompleted(context, *cmdfence);
     }
 
      cmdfence.reset(new VulkanCmdFence(context.device));
@@ -689,7 +848,7 @@ void flushCommandBuffer(VulkanContext& context) {
 
     auto& cmdfence = swapContext.commands.fence;
     std::unique_lock<utils::Mutex> lock(cmdfence->mutex);
-    error = vkQueueSubmit(context.graphicsQueue, 1, &submitInfo, cmdfence->fence);
+    error = submitCommands(context, submitInfo, *cmdfence);
     lock.unlock();
     ASSERT_POSTCONDITION(!error, "vkQueueSubmit error.");
     swapContext.invalid = true;
@@ -698,6 +857,7 @@ void flushCommandBuffer(VulkanContext& context) {
     // Restart the command buffer.
     error = vkWaitForFences(context.device, 1, &cmdfence->fence, VK_TRUE, UINT64_MAX);
     ASSERT_POSTCONDITION(!error, "vkWaitForFences error.");
+    markCompleted(context, *cmdfence);
     error = vkResetFences(context.device, 1, &cmdfence->fence);
     ASSERT_POSTCONDITION(!error, "vkResetFences error.");
     error = vkResetCommandBuffer(context.currentCommands->cmdbuffer, 0);
@@ -732,6 +892,7 @@ VkCommandBuffer acquireWorkCommandBuffer(VulkanContext& context) {
     if (work.fence && work.fence->submitted) {
         work.fence->submitted = false;
         vkWaitForFences(context.device, 1, &work.fence->fence, VK_TRUE, UINT64_MAX);
+        markCompleted(context, *work.fence);
         vkResetCommandBuffer(work.cmdbuffer, 0);
         vkBeginCommandBuffer(work.cmdbuffer, &binfo);
     }
@@ -749,11 +910,87 @@ void flushWorkCommandBuffer(VulkanContext& context) {
         .commandBufferCount = 1,
         .pCommandBuffers = &work.cmdbuffer,
     };
+    context.barriers.flush();
     vkEndCommandBuffer(work.cmdbuffer);
-    vkQueueSubmit(context.graphicsQueue, 1, &submitInfo, work.fence->fence);
+    submitCommands(context, submitInfo, *work.fence);
     work.fence->submitted = true;
 }
 
+VkResult submitCommands(VulkanContext& context, VkSubmitInfo submitInfo, VulkanCmdFence& fence) {
+    VulkanTimeline& timeline = context.timeline;
+    fence.timelineValue = ++timeline.submitted;
+    if (!context.timelineSemaphoreSupported) {
+        return vkQueueSubmit(context.graphicsQueue, 1, &submitInfo, fence.fence);
+    }
+
+    // Append the timeline semaphore to the semaphores signaled by the batch. The values of
+    // binary semaphores are ignored, but there must be one for each of them.
+    constexpr uint32_t MAX_SIGNAL_SEMAPHORES = 4;
+    assert_invariant(submitInfo.signalSemaphoreCount < MAX_SIGNAL_SEMAPHORES);
+    VkSemaphore semaphores[MAX_SIGNAL_SEMAPHORES];
+    uint64_t values[MAX_SIGNAL_SEMAPHORES] = {};
+    const uint32_t count = submitInfo.signalSemaphoreCount;
+    std::copy_n(submitInfo.pSignalSemaphores, count, semaphores);
+    semaphores[count] = timeline.semaphore;
+    values[count] = timeline.submitted;
+
+    const VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR,
+        .pNext = submitInfo.pNext,
+        .signalSemaphoreValueCount = count + 1,
+        .pSignalSemaphoreValues = values,
+    };
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.signalSemaphoreCount = count + 1;
+    submitInfo.pSignalSemaphores = semaphores;
+    return vkQueueSubmit(context.graphicsQueue, 1, &submitInfo, fence.fence);
+}
+
+bool isCompleted(VulkanContext& context, uint64_t timelineValue) {
+    VulkanTimeline& timeline = context.timeline;
+    if (timeline.completed >= timelineValue) {
+        return true;
+    }
+    if (context.timelineSemaphoreSupported) {
+        uint64_t value = 0;
+        if (vkGetSemaphoreCounterValueKHR(context.device, timeline.semaphore, &value) ==
+                VK_SUCCESS) {
+            timeline.completed = std::max(timeline.completed, value);
+        }
+    }
+    return timeline.completed >= timelineValue;
+}
+
+bool isCompleted(VulkanContext& context, VulkanCmdFence const& fence) {
+    if (!fence.timelineValue) {
+        return false;
+    }
+    if (isCompleted(context, fence.timelineValue)) {
+        return true;
+    }
+    // Without timeline semaphores, fall back to polling the fence itself.
+    if (!context.timelineSemaphoreSupported &&
+            vkGetFenceStatus(context.device, fence.fence) == VK_SUCCESS) {
+        markCompleted(context, fence);
+        return true;
+    }
+    return false;
+}
+
+void markCompleted(VulkanContext& context, VulkanCmdFence const& fence) {
+    // Batches complete in submission order as far as fences are concerned, so every submission
+    // up to the fence's own has completed too.
+    VulkanTimeline& timeline = context.timeline;
+    timeline.completed = std::max(timeline.completed, fence.timelineValue);
+}
+
+void destroyTimeline(VulkanContext& context) {
+    if (context.timeline.semaphore != VK_NULL_HANDLE) {
+        vkDestroySemaphore(context.device, context.timeline.semaphore, VKALLOC);
+        context.timeline.semaphore = VK_NULL_HANDLE;
+    }
+}
+
 void createFinalDepthBuffer(VulkanContext& context, VulkanSurfaceContext& surfaceContext,
         VkFormat depthFormat) {
     // Create an appropriately-sized device-only VkImage.
@@ -861,5 +1098,77 @@ void createEmptyTexture(VulkanContext& context, VulkanStagePool& stagePool) {
     context.emptyTexture->update2DImage(pbd, 1, 1, 0);
 }
 
+namespace {
+// Key used to store the pipeline cache in the platform's blob cache. The cache data has its own
+// header which the driver validates, this only avoids handing a different device's data to it.
+struct PipelineCacheKey {
+    char tag[4];
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+};
+static_assert(sizeof(PipelineCacheKey) == 32, "PipelineCacheKey must not have padding");
+
+PipelineCacheKey getPipelineCacheKey(VulkanContext& context) {
+    const VkPhysicalDeviceProperties& props = context.physicalDeviceProperties;
+    PipelineCacheKey key = { { 'V', 'K', 'P', 'C' },
+            props.vendorID, props.deviceID, props.driverVersion, {} };
+    memcpy(key.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE);
+    return key;
+}
+} // anonymous namespace
+
+void createPipelineCache(VulkanContext& context, Platform& platform) {
+    std::vector<uint8_t> data;
+    if (platform.hasBlobFunc()) {
+        const PipelineCacheKey key = getPipelineCacheKey(context);
+        const size_t size = platform.retrieveBlob(&key, sizeof(key), nullptr, 0);
+        if (size) {
+            data.resize(size);
+            if (platform.retrieveBlob(&key, sizeof(key), data.data(), size) != size) {
+                data.clear();
+            }
+        }
+    }
+    VkPipelineCacheCreateInfo createInfo {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = data.size(),
+        .pInitialData = data.data()
+    };
+    VkResult result = vkCreatePipelineCache(context.device, &createInfo, VKALLOC,
+            &context.pipelineCache);
+    if (result != VK_SUCCESS && !data.empty()) {
+        // the driver is allowed to reject stale data, start with an empty cache instead
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData = nullptr;
+        result = vkCreatePipelineCache(context.device, &createInfo, VKALLOC,
+                &context.pipelineCache);
+    }
+    if (result != VK_SUCCESS) {
+        context.pipelineCache = VK_NULL_HANDLE;
+    }
+}
+
+void destroyPipelineCache(VulkanContext& context, Platform& platform) {
+    if (context.pipelineCache == VK_NULL_HANDLE) {
+        return;
+    }
+    if (platform.hasBlobFunc()) {
+        size_t size = 0;
+        vkGetPipelineCacheData(context.device, context.pipelineCache, &size, nullptr);
+        if (size) {
+            std::vector<uint8_t> data(size);
+            if (vkGetPipelineCacheData(context.device, context.pipelineCache, &size,
+                    data.data()) == VK_SUCCESS) {
+                const PipelineCacheKey key = getPipelineCacheKey(context);
+                platform.insertBlob(&key, sizeof(key), data.data(), size);
+            }
+        }
+    }
+    vkDestroyPipelineCache(context.device, context.pipelineCache, VKALLOC);
+    context.pipelineCache = VK_NULL_HANDLE;
+}
+
 } // namespace filament
 } // namespace backend
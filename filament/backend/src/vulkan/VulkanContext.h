@@ -17,6 +17,7 @@
 #ifndef TNT_FILAMENT_DRIVER_VULKANCONTEXT_H
 #define TNT_FILAMENT_DRIVER_VULKANCONTEXT_H
 
+#include "VulkanBarrierBatch.h"
 #include "VulkanBinder.h"
 #include "VulkanDisposer.h"
 
@@ -47,6 +48,7 @@ constexpr VkAllocationCallbacks* VKALLOC = nullptr;
 constexpr static const int VK_REQUIRED_VERSION_MAJOR = 1;
 constexpr static const int VK_REQUIRED_VERSION_MINOR = 0;
 
+class Platform;
 struct VulkanRenderTarget;
 struct VulkanSurfaceContext;
 struct VulkanTexture;
@@ -64,6 +66,9 @@ struct VulkanCmdFence {
     std::atomic<VkResult> status;
     bool swapChainDestroyed = false;
 
+    // Timeline value of the most recent submission that signals this fence, 0 if never submitted.
+    uint64_t timelineValue = 0;
+
     // TODO: for non-work buffers the following field indicates if the fence has EVER been
     // submitted, which is a bit misleading or un-useful. This needs to be refactored.
     bool submitted = false;
@@ -80,10 +85,20 @@ struct VulkanCommandBuffer {
 
 struct VulkanTimestamps {
     VkQueryPool pool;
-    utils::bitset32 used;
+    utils::bitset256 used;
     utils::Mutex mutex;
 };
 
+// Tracks the progress of the GPU through the batches submitted to the graphics queue. Each
+// submission is given the next value of the timeline; when VK_KHR_timeline_semaphore is available
+// the submission also signals that value on a timeline semaphore, so that the completion of any
+// submission can be queried without waiting on (or even knowing) its fence.
+struct VulkanTimeline {
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    uint64_t submitted = 0;     // value of the most recent submission
+    uint64_t completed = 0;     // last value known to be reached by the GPU
+};
+
 struct VulkanRenderPass {
     VkRenderPass renderPass;
     uint32_t subpassMask;
@@ -100,12 +115,21 @@ struct VulkanContext {
     VkPhysicalDeviceMemoryProperties memoryProperties;
     VkDevice device;
     VkCommandPool commandPool;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
     VulkanTimestamps timestamps;
     uint32_t graphicsQueueFamilyIndex;
     VkQueue graphicsQueue;
     bool debugMarkersSupported;
     bool debugUtilsSupported;
     bool portabilitySubsetSupported;
+    bool memoryBudgetSupported;
+    bool fragmentShadingRateSupported;
+    bool displayTimingSupported;
+    bool timelineSemaphoreSupported;
+    bool incrementalPresentSupported;
+    bool depthResolveSupported;
+    bool computeSupported;
+    VulkanTimeline timeline;
     VulkanBinder::RasterState rasterState;
     VulkanCommandBuffer* currentCommands;
     VulkanSurfaceContext* currentSurface;
@@ -115,6 +139,9 @@ struct VulkanContext {
     VmaAllocator allocator;
     VulkanTexture* emptyTexture = nullptr;
 
+    // Layout transitions waiting to be recorded into the current or work command buffer.
+    VulkanBarrierBatch barriers;
+
     // The work context is used for activities unrelated to the swap chain or draw calls, such as
     // uploads, blits, and transitions.
     VulkanCommandBuffer work;
@@ -168,6 +195,7 @@ void destroySwapChain(VulkanContext& context, VulkanSurfaceContext& sc, VulkanDi
 void makeSwapChainPresentable(VulkanContext& context);
 
 uint32_t selectMemoryType(VulkanContext& context, uint32_t flags, VkFlags reqs);
+void logMemoryBudget(VulkanContext& context);
 SwapContext& getSwapContext(VulkanContext& context);
 void waitForIdle(VulkanContext& context);
 bool acquireSwapCommandBuffer(VulkanContext& context);
@@ -177,10 +205,32 @@ VkFormat findSupportedFormat(VulkanContext& context, const std::vector<VkFormat>
         VkImageTiling tiling, VkFormatFeatureFlags features);
 VkCommandBuffer acquireWorkCommandBuffer(VulkanContext& context);
 void flushWorkCommandBuffer(VulkanContext& context);
+
+// Submits a batch to the graphics queue, signaling the given fence and the next timeline value.
+VkResult submitCommands(VulkanContext& context, VkSubmitInfo submitInfo, VulkanCmdFence& fence);
+
+// Returns true if the GPU has completed the submission with the given timeline value. This never
+// blocks; without timeline semaphores it only knows about the fences that have been waited on.
+bool isCompleted(VulkanContext& context, uint64_t timelineValue);
+
+// Returns true if the last submission that signals the given fence has completed.
+bool isCompleted(VulkanContext& context, VulkanCmdFence const& fence);
+
+// Records that the given fence has been waited on, and thus all submissions up to its own.
+void markCompleted(VulkanContext& context, VulkanCmdFence const& fence);
+
+void destroyTimeline(VulkanContext& context);
+
 void createFinalDepthBuffer(VulkanContext& context, VulkanSurfaceContext& sc, VkFormat depthFormat);
 VkImageLayout getTextureLayout(TextureUsage usage);
 void createEmptyTexture(VulkanContext& context, VulkanStagePool& stagePool);
 
+// Creates the pipeline cache, seeded from the platform's blob cache if available.
+void createPipelineCache(VulkanContext& context, Platform& platform);
+
+// Writes back the pipeline cache to the platform's blob cache and destroys it.
+void destroyPipelineCache(VulkanContext& context, Platform& platform);
+
 } // namespace filament
 } // namespace backend
 
@@ -27,6 +27,8 @@
 #include <utils/CString.h>
 #include <utils/trap.h>
 
+#include <algorithm>
+
 #ifndef NDEBUG
 #include <set>
 #endif
@@ -102,8 +104,9 @@ VulkanDriver::VulkanDriver(VulkanPlatform* platform,
         const char* const* ppEnabledExtensions, uint32_t enabledExtensionCount) noexcept :
         DriverBase(new ConcreteDispatcher<VulkanDriver>()),
         mContextManager(*platform),
+        mHandleAllocator("Handles", FILAMENT_VULKAN_HANDLE_ARENA_SIZE_IN_MB * 1024U * 1024U),
         mBlitter(mContext),
-        mStagePool(mContext, mDisposer),
+        mStagePool(mContext, mDisposer, mMemoryTracker),
         mFramebufferCache(mContext),
         mSamplerCache(mContext) {
     mContext.rasterState = mBinder.getDefaultRasterState();
@@ -210,6 +213,9 @@ VulkanDriver::VulkanDriver(VulkanPlatform* platform,
     // Initialize device and graphicsQueue.
     createLogicalDevice(mContext);
     mBinder.setDevice(mContext.device);
+    mBinder.setFragmentShadingRateEnabled(mContext.fragmentShadingRateSupported);
+    createPipelineCache(mContext, mContextManager);
+    mBinder.setPipelineCache(mContext.pipelineCache);
     createEmptyTexture(mContext, mStagePool);
 
     // Choose a depth format that meets our requirements. Take care not to include stencil formats
@@ -264,6 +270,15 @@ void VulkanDriver::terminate() {
     // Flush the work command buffer.
     acquireWorkCommandBuffer(mContext);
 
+    // Deliver the pending readbacks whose commands completed, and drop the others.
+    waitForIdle(mContext);
+    collectReadPixels(false);
+    collectReadPixels(true);
+    for (ReadPixelsImage const& image : mReadPixelsImages) {
+        destroyReadPixelsImage(image);
+    }
+    mReadPixelsImages.clear();
+
     delete mContext.emptyTexture;
 
     mBlitter.shutdown();
@@ -280,11 +295,19 @@ void VulkanDriver::terminate() {
     vkFreeCommandBuffers(device, mContext.commandPool, 1, &work.cmdbuffer);
     work.fence.reset();
 
+    destroyTimeline(mContext);
     mStagePool.reset();
     mBinder.destroyCache();
+    mBinder.setPipelineCache(VK_NULL_HANDLE);
+    destroyPipelineCache(mContext, mContextManager);
     mFramebufferCache.reset();
     mSamplerCache.reset();
 
+#ifndef NDEBUG
+    mHandleAllocator.logStatistics();
+    mFramebufferCache.logStatistics();
+#endif
+
     vmaDestroyAllocator(mContext.allocator);
     vkDestroyQueryPool(mContext.device, mContext.timestamps.pool, VKALLOC);
     vkDestroyCommandPool(mContext.device, mContext.commandPool, VKALLOC);
@@ -301,13 +324,15 @@ void VulkanDriver::terminate() {
 }
 
 void VulkanDriver::tick(int) {
+    collectReadPixels(false);
     if (!mContext.currentSurface) {
         return;
     }
     for (SwapContext& sc : mContext.currentSurface->swapContexts) {
         VulkanCmdFence* fence = sc.commands.fence.get();
         if (fence) {
-            VkResult status = vkGetFenceStatus(mContext.device, fence->fence);
+            // With timeline semaphores, a single counter query answers for all the fences.
+            const VkResult status = isCompleted(mContext, *fence) ? VK_SUCCESS : VK_NOT_READY;
             fence->status.store(status, std::memory_order_relaxed);
         }
     }
@@ -327,6 +352,9 @@ void VulkanDriver::beginFrame(int64_t monotonic_clock_ns, uint32_t frameId) {
     acquireWorkCommandBuffer(mContext);
     mDisposer.release(mContext.work.resources);
 
+    // This lets VMA refresh its memory budget.
+    vmaSetCurrentFrameIndex(mContext.allocator, frameId);
+
     // With MoltenVK, it might take several attempts to acquire a swap chain that is not marked as
     // "out of date" after a resize event.
     int attempts = 0;
@@ -390,6 +418,8 @@ void VulkanDriver::setFrameCompletedCallback(Handle<HwSwapChain> sch,
 }
 
 void VulkanDriver::setPresentationTime(int64_t monotonic_clock_ns) {
+    // VK_GOOGLE_display_timing uses the same time base as std::chrono::steady_clock
+    mPresentationTime = mContext.displayTimingSupported ? uint64_t(monotonic_clock_ns) : 0;
 }
 
 void VulkanDriver::endFrame(uint32_t frameId) {
@@ -405,21 +435,23 @@ void VulkanDriver::finish(int) {
 }
 
 void VulkanDriver::createSamplerGroupR(Handle<HwSamplerGroup> sbh, size_t count) {
-    construct_handle<VulkanSamplerGroup>(mHandleMap, sbh, mContext, count);
+    construct_handle<VulkanSamplerGroup>(sbh, mContext, count);
 }
 
 void VulkanDriver::createUniformBufferR(Handle<HwUniformBuffer> ubh, size_t size,
         BufferUsage usage) {
-    auto uniformBuffer = construct_handle<VulkanUniformBuffer>(mHandleMap, ubh, mContext,
+    auto uniformBuffer = construct_handle<VulkanUniformBuffer>(ubh, mContext,
             mStagePool, mDisposer, size, usage);
-    mDisposer.createDisposable(uniformBuffer, [this, ubh] () {
-        destruct_handle<VulkanUniformBuffer>(mHandleMap, ubh);
+    mMemoryTracker.allocate(MemoryTracker::Category::BUFFER, size);
+    mDisposer.createDisposable(uniformBuffer, [this, ubh, size] () {
+        mMemoryTracker.free(MemoryTracker::Category::BUFFER, size);
+        destruct_handle<VulkanUniformBuffer>(ubh);
     });
 }
 
 void VulkanDriver::destroyUniformBuffer(Handle<HwUniformBuffer> ubh) {
     if (ubh) {
-        auto buffer = handle_cast<VulkanUniformBuffer>(mHandleMap, ubh);
+        auto buffer = handle_cast<VulkanUniformBuffer>(ubh);
         mBinder.unbindUniformBuffer(buffer->getGpuBuffer());
 
         // We do not know if any pending draw calls are making use of this uniform buffer,
@@ -435,28 +467,28 @@ void VulkanDriver::destroyUniformBuffer(Handle<HwUniformBuffer> ubh) {
 }
 
 void VulkanDriver::createRenderPrimitiveR(Handle<HwRenderPrimitive> rph, int) {
-    construct_handle<VulkanRenderPrimitive>(mHandleMap, rph, mContext);
+    construct_handle<VulkanRenderPrimitive>(rph, mContext);
 }
 
 void VulkanDriver::destroyRenderPrimitive(Handle<HwRenderPrimitive> rph) {
     if (rph) {
-        destruct_handle<VulkanRenderPrimitive>(mHandleMap, rph);
+        destruct_handle<VulkanRenderPrimitive>(rph);
     }
 }
 
 void VulkanDriver::createVertexBufferR(Handle<HwVertexBuffer> vbh, uint8_t bufferCount,
         uint8_t attributeCount, uint32_t elementCount, AttributeArray attributes,
         BufferUsage usage) {
-    auto vertexBuffer = construct_handle<VulkanVertexBuffer>(mHandleMap, vbh, mContext, mStagePool,
+    auto vertexBuffer = construct_handle<VulkanVertexBuffer>(vbh, mContext, mStagePool,
             mDisposer, bufferCount, attributeCount, elementCount, attributes);
     mDisposer.createDisposable(vertexBuffer, [this, vbh] () {
-        destruct_handle<VulkanVertexBuffer>(mHandleMap, vbh);
+        destruct_handle<VulkanVertexBuffer>(vbh);
     });
 }
 
 void VulkanDriver::destroyVertexBuffer(Handle<HwVertexBuffer> vbh) {
     if (vbh) {
-        auto vertexBuffer = handle_cast<VulkanVertexBuffer>(mHandleMap, vbh);
+        auto vertexBuffer = handle_cast<VulkanVertexBuffer>(vbh);
         mDisposer.removeReference(vertexBuffer);
     }
 }
@@ -464,32 +496,43 @@ void VulkanDriver::destroyVertexBuffer(Handle<HwVertexBuffer> vbh) {
 void VulkanDriver::createIndexBufferR(Handle<HwIndexBuffer> ibh,
         ElementType elementType, uint32_t indexCount, BufferUsage usage) {
     auto elementSize = (uint8_t) getElementTypeSize(elementType);
-    auto indexBuffer = construct_handle<VulkanIndexBuffer>(mHandleMap, ibh, mContext, mStagePool,
+    auto indexBuffer = construct_handle<VulkanIndexBuffer>(ibh, mContext, mStagePool,
             mDisposer, elementSize, indexCount);
-    mDisposer.createDisposable(indexBuffer, [this, ibh] () {
-        destruct_handle<VulkanIndexBuffer>(mHandleMap, ibh);
+    const size_t size = elementSize * indexCount;
+    mMemoryTracker.allocate(MemoryTracker::Category::BUFFER, size);
+    mDisposer.createDisposable(indexBuffer, [this, ibh, size] () {
+        mMemoryTracker.free(MemoryTracker::Category::BUFFER, size);
+        destruct_handle<VulkanIndexBuffer>(ibh);
     });
 }
 
 void VulkanDriver::destroyIndexBuffer(Handle<HwIndexBuffer> ibh) {
     if (ibh) {
-        auto indexBuffer = handle_cast<VulkanIndexBuffer>(mHandleMap, ibh);
+        auto indexBuffer = handle_cast<VulkanIndexBuffer>(ibh);
         mDisposer.removeReference(indexBuffer);
     }
 }
 
 void VulkanDriver::createBufferObjectR(Handle<HwBufferObject> boh,
-        uint32_t byteCount, BufferObjectBinding bindingType) {
-    auto bufferObject = construct_handle<VulkanBufferObject>(mHandleMap, boh, mContext, mStagePool,
-            mDisposer, byteCount);
-    mDisposer.createDisposable(bufferObject, [this, boh] () {
-       destruct_handle<VulkanBufferObject>(mHandleMap, boh);
+        uint32_t byteCount, BufferObjectBinding bindingType, BufferUsage usage) {
+    auto bufferObject = construct_handle<VulkanBufferObject>(boh, mContext, mStagePool,
+            mDisposer, byteCount, bindingType);
+    mMemoryTracker.allocate(MemoryTracker::Category::BUFFER, byteCount);
+    mDisposer.createDisposable(bufferObject, [this, boh, byteCount] () {
+       mMemoryTracker.free(MemoryTracker::Category::BUFFER, byteCount);
+       destruct_handle<VulkanBufferObject>(boh);
     });
 }
 
 void VulkanDriver::destroyBufferObject(Handle<HwBufferObject> boh) {
     if (boh) {
-       auto bufferObject = handle_cast<VulkanBufferObject>(mHandleMap, boh);
+       auto bufferObject = handle_cast<VulkanBufferObject>(boh);
+       for (auto& binding : mStorageBindings) {
+           if (binding == bufferObject) {
+               binding = nullptr;
+           }
+       }
+       mBinder.unbindStorageBuffer(bufferObject->buffer->getGpuBuffer());
        mDisposer.removeReference(bufferObject);
     }
 }
@@ -497,10 +540,12 @@ void VulkanDriver::destroyBufferObject(Handle<HwBufferObject> boh) {
 void VulkanDriver::createTextureR(Handle<HwTexture> th, SamplerType target, uint8_t levels,
         TextureFormat format, uint8_t samples, uint32_t w, uint32_t h, uint32_t depth,
         TextureUsage usage) {
-    auto vktexture = construct_handle<VulkanTexture>(mHandleMap, th, mContext, target, levels,
+    auto vktexture = construct_handle<VulkanTexture>(th, mContext, target, levels,
             format, samples, w, h, depth, usage, mStagePool);
+    mMemoryTracker.allocate(*vktexture);
     mDisposer.createDisposable(vktexture, [this, th] () {
-        destruct_handle<VulkanTexture>(mHandleMap, th);
+        mMemoryTracker.free(*handle_cast<VulkanTexture>(th));
+        destruct_handle<VulkanTexture>(th);
     });
 }
 
@@ -510,10 +555,12 @@ void VulkanDriver::createTextureSwizzledR(Handle<HwTexture> th, SamplerType targ
         TextureSwizzle r, TextureSwizzle g, TextureSwizzle b, TextureSwizzle a) {
     TextureSwizzle swizzleArray[] = {r, g, b, a};
     const VkComponentMapping swizzleMap = getSwizzleMap(swizzleArray);
-    auto vktexture = construct_handle<VulkanTexture>(mHandleMap, th, mContext, target, levels,
+    auto vktexture = construct_handle<VulkanTexture>(th, mContext, target, levels,
             format, samples, w, h, depth, usage, mStagePool, swizzleMap);
+    mMemoryTracker.allocate(*vktexture);
     mDisposer.createDisposable(vktexture, [this, th] () {
-        destruct_handle<VulkanTexture>(mHandleMap, th);
+        mMemoryTracker.free(*handle_cast<VulkanTexture>(th));
+        destruct_handle<VulkanTexture>(th);
     });
 }
 
@@ -526,29 +573,29 @@ void VulkanDriver::importTextureR(Handle<HwTexture> th, intptr_t id,
 
 void VulkanDriver::destroyTexture(Handle<HwTexture> th) {
     if (th) {
-        auto texture = handle_cast<VulkanTexture>(mHandleMap, th);
+        auto texture = handle_cast<VulkanTexture>(th);
         mBinder.unbindImageView(texture->getPrimaryImageView());
         mDisposer.removeReference(texture);
     }
 }
 
 void VulkanDriver::createProgramR(Handle<HwProgram> ph, Program&& program) {
-    auto vkprogram = construct_handle<VulkanProgram>(mHandleMap, ph, mContext, program);
+    auto vkprogram = construct_handle<VulkanProgram>(ph, mContext, program);
     mDisposer.createDisposable(vkprogram, [this, ph] () {
-        destruct_handle<VulkanProgram>(mHandleMap, ph);
+        destruct_handle<VulkanProgram>(ph);
     });
 }
 
 void VulkanDriver::destroyProgram(Handle<HwProgram> ph) {
     if (ph) {
-        mDisposer.removeReference(handle_cast<VulkanProgram>(mHandleMap, ph));
+        mDisposer.removeReference(handle_cast<VulkanProgram>(ph));
     }
 }
 
 void VulkanDriver::createDefaultRenderTargetR(Handle<HwRenderTarget> rth, int) {
-    auto renderTarget = construct_handle<VulkanRenderTarget>(mHandleMap, rth, mContext);
+    auto renderTarget = construct_handle<VulkanRenderTarget>(rth, mContext);
     mDisposer.createDisposable(renderTarget, [this, rth] () {
-        destruct_handle<VulkanRenderTarget>(mHandleMap, rth);
+        destruct_handle<VulkanRenderTarget>(rth);
     });
 }
 
@@ -558,7 +605,7 @@ void VulkanDriver::createRenderTargetR(Handle<HwRenderTarget> rth,
     VulkanAttachment colorTargets[MRT::TARGET_COUNT] = {};
     for (int i = 0; i < MRT::TARGET_COUNT; i++) {
         if (color[i].handle) {
-            colorTargets[i].texture = handle_cast<VulkanTexture>(mHandleMap, color[i].handle);
+            colorTargets[i].texture = handle_cast<VulkanTexture>(color[i].handle);
         }
         colorTargets[i].level = color[i].level;
         colorTargets[i].layer = color[i].layer;
@@ -566,25 +613,25 @@ void VulkanDriver::createRenderTargetR(Handle<HwRenderTarget> rth,
 
     VulkanAttachment depthStencil[2] = {};
     TextureHandle handle = depth.handle;
-    depthStencil[0].texture = handle ? handle_cast<VulkanTexture>(mHandleMap, handle) : nullptr;
+    depthStencil[0].texture = handle ? handle_cast<VulkanTexture>(handle) : nullptr;
     depthStencil[0].level = depth.level;
     depthStencil[0].layer = depth.layer;
 
     handle = stencil.handle;
-    depthStencil[1].texture = handle ? handle_cast<VulkanTexture>(mHandleMap, handle) : nullptr;
+    depthStencil[1].texture = handle ? handle_cast<VulkanTexture>(handle) : nullptr;
     depthStencil[1].level = stencil.level;
     depthStencil[1].layer = stencil.layer;
 
-    auto renderTarget = construct_handle<VulkanRenderTarget>(mHandleMap, rth, mContext,
+    auto renderTarget = construct_handle<VulkanRenderTarget>(rth, mContext,
             width, height, samples, colorTargets, depthStencil, mStagePool);
     mDisposer.createDisposable(renderTarget, [this, rth] () {
-        destruct_handle<VulkanRenderTarget>(mHandleMap, rth);
+        destruct_handle<VulkanRenderTarget>(rth);
     });
 }
 
 void VulkanDriver::destroyRenderTarget(Handle<HwRenderTarget> rth) {
     if (rth) {
-        mDisposer.removeReference(handle_cast<VulkanRenderTarget>(mHandleMap, rth));
+        mDisposer.removeReference(handle_cast<VulkanRenderTarget>(rth));
     }
 }
 
@@ -594,23 +641,23 @@ void VulkanDriver::createFenceR(Handle<HwFence> fh, int) {
 
      // As a fallback in release builds, trigger the fence based on the work command buffer.
     if (mContext.currentCommands == nullptr) {
-        construct_handle<VulkanFence>(mHandleMap, fh, mContext.work);
+        construct_handle<VulkanFence>(fh, mContext.work);
         return;
     }
 
-     construct_handle<VulkanFence>(mHandleMap, fh, *mContext.currentCommands);
+     construct_handle<VulkanFence>(fh, *mContext.currentCommands);
 }
 
 void VulkanDriver::createSyncR(Handle<HwSync> sh, int) {
     ASSERT_PRECONDITION(mContext.currentCommands, "Syncs must be created within a frame.");
-    construct_handle<VulkanSync>(mHandleMap, sh, *mContext.currentCommands);
+    construct_handle<VulkanSync>(sh, *mContext.currentCommands);
 }
 
 void VulkanDriver::createSwapChainR(Handle<HwSwapChain> sch, void* nativeWindow, uint64_t flags) {
     const VkInstance instance = mContext.instance;
     auto vksurface = (VkSurfaceKHR) mContextManager.createVkSurfaceKHR(nativeWindow, instance,
             flags);
-    auto* swapChain = construct_handle<VulkanSwapChain>(mHandleMap, sch, mContext, vksurface);
+    auto* swapChain = construct_handle<VulkanSwapChain>(sch, mContext, vksurface);
 
     // TODO: move the following line into makeCurrent.
     mContext.currentSurface = &swapChain->surfaceContext;
@@ -619,7 +666,7 @@ void VulkanDriver::createSwapChainR(Handle<HwSwapChain> sch, void* nativeWindow,
 void VulkanDriver::createSwapChainHeadlessR(Handle<HwSwapChain> sch,
         uint32_t width, uint32_t height, uint64_t flags) {
     assert_invariant(width > 0 && height > 0 && "Vulkan requires non-zero swap chain dimensions.");
-    auto* swapChain = construct_handle<VulkanSwapChain>(mHandleMap, sch, mContext, width, height);
+    auto* swapChain = construct_handle<VulkanSwapChain>(sch, mContext, width, height);
     mContext.currentSurface = &swapChain->surfaceContext;
 }
 
@@ -703,9 +750,9 @@ Handle<HwTimerQuery> VulkanDriver::createTimerQueryS() noexcept {
     // The handle must be constructed here, as a synchronous call to getTimerQueryValue might happen
     // before createTimerQueryR is executed.
     Handle<HwTimerQuery> tqh = alloc_handle<VulkanTimerQuery, HwTimerQuery>();
-    auto query = construct_handle<VulkanTimerQuery>(mHandleMap, tqh, mContext);
+    auto query = construct_handle<VulkanTimerQuery>(tqh, mContext);
     mDisposer.createDisposable(query, [this, tqh] () {
-        destruct_handle<VulkanTimerQuery>(mHandleMap, tqh);
+        destruct_handle<VulkanTimerQuery>(tqh);
     });
     return tqh;
 }
@@ -716,19 +763,19 @@ void VulkanDriver::destroySamplerGroup(Handle<HwSamplerGroup> sbh) {
         // not map to any Vulkan objects. To handle destruction, the only thing we need to do is
         // ensure that the next draw call doesn't try to access a zombie sampler buffer. Therefore,
         // simply replace all weak references with null.
-        auto* hwsb = handle_cast<VulkanSamplerGroup>(mHandleMap, sbh);
+        auto* hwsb = handle_cast<VulkanSamplerGroup>(sbh);
         for (auto& binding : mSamplerBindings) {
             if (binding == hwsb) {
                 binding = nullptr;
             }
         }
-        destruct_handle<VulkanSamplerGroup>(mHandleMap, sbh);
+        destruct_handle<VulkanSamplerGroup>(sbh);
     }
 }
 
 void VulkanDriver::destroySwapChain(Handle<HwSwapChain> sch) {
     if (sch) {
-        VulkanSurfaceContext& surfaceContext = handle_cast<VulkanSwapChain>(mHandleMap, sch)->surfaceContext;
+        VulkanSurfaceContext& surfaceContext = handle_cast<VulkanSwapChain>(sch)->surfaceContext;
         backend::destroySwapChain(mContext, surfaceContext, mDisposer);
 
         vkDestroySurfaceKHR(mContext.instance, surfaceContext.surface, VKALLOC);
@@ -736,7 +783,7 @@ void VulkanDriver::destroySwapChain(Handle<HwSwapChain> sch) {
             mContext.currentSurface = nullptr;
         }
 
-        destruct_handle<VulkanSwapChain>(mHandleMap, sch);
+        destruct_handle<VulkanSwapChain>(sch);
     }
 }
 
@@ -745,12 +792,12 @@ void VulkanDriver::destroyStream(Handle<HwStream> sh) {
 
 void VulkanDriver::destroyTimerQuery(Handle<HwTimerQuery> tqh) {
     if (tqh) {
-        mDisposer.removeReference(handle_cast<VulkanTimerQuery>(mHandleMap, tqh));
+        mDisposer.removeReference(handle_cast<VulkanTimerQuery>(tqh));
     }
 }
 
 void VulkanDriver::destroySync(Handle<HwSync> sh) {
-    destruct_handle<VulkanSync>(mHandleMap, sh);
+    destruct_handle<VulkanSync>(sh);
 }
 
 
@@ -762,7 +809,8 @@ Handle<HwStream> VulkanDriver::createStreamAcquired() {
     return {};
 }
 
-void VulkanDriver::setAcquiredImage(Handle<HwStream> sh, void* image, backend::StreamCallback cb,
+void VulkanDriver::setAcquiredImage(Handle<HwStream> sh, void* image, int fence,
+        backend::StreamCallback cb,
         void* userData) {
 }
 
@@ -777,11 +825,11 @@ void VulkanDriver::updateStreams(CommandStream* driver) {
 }
 
 void VulkanDriver::destroyFence(Handle<HwFence> fh) {
-    destruct_handle<VulkanFence>(mHandleMap, fh);
+    destruct_handle<VulkanFence>(fh);
 }
 
 FenceStatus VulkanDriver::wait(Handle<HwFence> fh, uint64_t timeout) {
-    auto& cmdfence = handle_cast<VulkanFence>(mHandleMap, fh)->fence;
+    auto& cmdfence = handle_cast<VulkanFence>(fh)->fence;
 
     // The condition variable is used only to guarantee that we're calling vkWaitForFences *after*
     // calling vkQueueSubmit.
@@ -867,21 +915,21 @@ math::float2 VulkanDriver::getClipSpaceParams() {
 
 void VulkanDriver::setVertexBufferObject(Handle<HwVertexBuffer> vbh, size_t index,
         Handle<HwBufferObject> boh) {
-    auto& vb = *handle_cast<VulkanVertexBuffer>(mHandleMap, vbh);
-    auto& bo = *handle_cast<VulkanBufferObject>(mHandleMap, boh);
+    auto& vb = *handle_cast<VulkanVertexBuffer>(vbh);
+    auto& bo = *handle_cast<VulkanBufferObject>(boh);
     vb.buffers[index] = bo.buffer.get();
 }
 
 void VulkanDriver::updateIndexBuffer(Handle<HwIndexBuffer> ibh, BufferDescriptor&& p,
         uint32_t byteOffset) {
-    auto& ib = *handle_cast<VulkanIndexBuffer>(mHandleMap, ibh);
+    auto& ib = *handle_cast<VulkanIndexBuffer>(ibh);
     ib.buffer->loadFromCpu(p.buffer, byteOffset, p.size);
     scheduleDestroy(std::move(p));
 }
 
 void VulkanDriver::updateBufferObject(Handle<HwBufferObject> boh, BufferDescriptor&& bd,
         uint32_t byteOffset) {
-    auto& bo = *handle_cast<VulkanBufferObject>(mHandleMap, boh);
+    auto& bo = *handle_cast<VulkanBufferObject>(boh);
     bo.buffer->loadFromCpu(bd.buffer, byteOffset, bd.size);
     scheduleDestroy(std::move(bd));
 }
@@ -890,12 +938,18 @@ void VulkanDriver::update2DImage(Handle<HwTexture> th,
         uint32_t level, uint32_t xoffset, uint32_t yoffset, uint32_t width, uint32_t height,
         PixelBufferDescriptor&& data) {
     assert_invariant(xoffset == 0 && yoffset == 0 && "Offsets not yet supported.");
-    handle_cast<VulkanTexture>(mHandleMap, th)->update2DImage(data, width, height, level);
+    handle_cast<VulkanTexture>(th)->update2DImage(data, width, height, level);
     scheduleDestroy(std::move(data));
 }
 
 void VulkanDriver::setMinMaxLevels(Handle<HwTexture> th, uint32_t minLevel, uint32_t maxLevel) {
-    handle_cast<VulkanTexture>(mHandleMap, th)->setPrimaryRange(minLevel, maxLevel);
+    handle_cast<VulkanTexture>(th)->setPrimaryRange(minLevel, maxLevel);
+}
+
+void VulkanDriver::commitTexturePages(Handle<HwTexture> th, uint32_t level,
+        uint32_t xoffset, uint32_t yoffset, uint32_t zoffset,
+        uint32_t width, uint32_t height, uint32_t depth, bool commit) {
+    // sparse textures are fully resident, see getSparseTexturePageSize()
 }
 
 void VulkanDriver::update3DImage(
@@ -904,13 +958,13 @@ void VulkanDriver::update3DImage(
         uint32_t width, uint32_t height, uint32_t depth,
         PixelBufferDescriptor&& data) {
     assert_invariant(xoffset == 0 && yoffset == 0 && zoffset == 0 && "Offsets not yet supported.");
-    handle_cast<VulkanTexture>(mHandleMap, th)->update3DImage(data, width, height, depth, level);
+    handle_cast<VulkanTexture>(th)->update3DImage(data, width, height, depth, level);
     scheduleDestroy(std::move(data));
 }
 
 void VulkanDriver::updateCubeImage(Handle<HwTexture> th, uint32_t level,
         PixelBufferDescriptor&& data, FaceOffsets faceOffsets) {
-    handle_cast<VulkanTexture>(mHandleMap, th)->updateCubeImage(data, faceOffsets, level);
+    handle_cast<VulkanTexture>(th)->updateCubeImage(data, faceOffsets, level);
     scheduleDestroy(std::move(data));
 }
 
@@ -921,7 +975,7 @@ void VulkanDriver::cancelExternalImage(void* image) {
 }
 
 bool VulkanDriver::getTimerQueryValue(Handle<HwTimerQuery> tqh, uint64_t* elapsedTime) {
-    VulkanTimerQuery* vtq = handle_cast<VulkanTimerQuery>(mHandleMap, tqh);
+    VulkanTimerQuery* vtq = handle_cast<VulkanTimerQuery>(tqh);
 
     // This is a synchronous call and might occur before beginTimerQuery has written anything into
     // the command buffer, which is an error according to the validation layer that ships in the
@@ -966,7 +1020,7 @@ bool VulkanDriver::getTimerQueryValue(Handle<HwTimerQuery> tqh, uint64_t* elapse
 }
 
 SyncStatus VulkanDriver::getSyncStatus(Handle<HwSync> sh) {
-    VulkanSync* sync = handle_cast<VulkanSync>(mHandleMap, sh);
+    VulkanSync* sync = handle_cast<VulkanSync>(sh);
     if (sync->fence == nullptr) {
         return SyncStatus::NOT_SIGNALED;
     }
@@ -981,6 +1035,11 @@ SyncStatus VulkanDriver::getSyncStatus(Handle<HwSync> sh) {
     }
 }
 
+bool VulkanDriver::isProgramReady(Handle<HwProgram> ph) {
+    // Shader modules are created in createProgramR, pipelines are created when first used.
+    return true;
+}
+
 void VulkanDriver::setExternalImage(Handle<HwTexture> th, void* image) {
 }
 
@@ -996,25 +1055,67 @@ bool VulkanDriver::canGenerateMipmaps() {
     return false;
 }
 
+bool VulkanDriver::isComputeSupported() {
+    return mContext.computeSupported;
+}
+
+bool VulkanDriver::isDrawIndirectSupported() {
+    return true;
+}
+
+bool VulkanDriver::isDepthReadbackSupported() {
+    // readPixels() only copies the color attachment
+    return false;
+}
+
+bool VulkanDriver::isShadingRateSupported() {
+    return mContext.fragmentShadingRateSupported;
+}
+
+math::uint3 VulkanDriver::getSparseTexturePageSize(SamplerType target, TextureFormat format) {
+    // Sparse residency needs a queue with sparse binding support, which we don't create yet.
+    // Sparse textures are fully resident.
+    return {};
+}
+
 void VulkanDriver::loadUniformBuffer(Handle<HwUniformBuffer> ubh, BufferDescriptor&& data) {
     if (data.size > 0) {
-        auto* buffer = handle_cast<VulkanUniformBuffer>(mHandleMap, ubh);
+        auto* buffer = handle_cast<VulkanUniformBuffer>(ubh);
         buffer->loadFromCpu(data.buffer, (uint32_t) data.size);
         scheduleDestroy(std::move(data));
     }
 }
 
+void VulkanDriver::updateUniformBuffer(Handle<HwUniformBuffer> ubh, BufferDescriptor&& data,
+        uint32_t byteOffset) {
+    if (data.size > 0) {
+        auto* buffer = handle_cast<VulkanUniformBuffer>(ubh);
+        buffer->loadFromCpu(data.buffer, (uint32_t) data.size, byteOffset);
+        scheduleDestroy(std::move(data));
+    }
+}
+
 void VulkanDriver::updateSamplerGroup(Handle<HwSamplerGroup> sbh,
         SamplerGroup&& samplerGroup) {
-    auto* sb = handle_cast<VulkanSamplerGroup>(mHandleMap, sbh);
+    auto* sb = handle_cast<VulkanSamplerGroup>(sbh);
+
+    // only the slots whose parameters change need their sampler to be looked up again
+    SamplerGroup::Sampler const* const curr = sb->sb->getSamplers();
+    SamplerGroup::Sampler const* const next = samplerGroup.getSamplers();
+    assert_invariant(sb->sb->getSize() == samplerGroup.getSize());
+    for (size_t i = 0, c = std::min(sb->sb->getSize(), samplerGroup.getSize()); i < c; i++) {
+        if (curr[i].s.u != next[i].s.u) {
+            sb->samplers[i] = VK_NULL_HANDLE;
+        }
+    }
+
     *sb->sb = samplerGroup;
 }
 
 void VulkanDriver::beginRenderPass(Handle<HwRenderTarget> rth, const RenderPassParams& params) {
     assert_invariant(mContext.currentCommands);
     assert_invariant(mContext.currentSurface);
-    VulkanSurfaceContext& surface = *mContext.currentSurface;
-    mCurrentRenderTarget = handle_cast<VulkanRenderTarget>(mHandleMap, rth);
+    mCurrentRenderTarget = handle_cast<VulkanRenderTarget>(rth);
     VulkanRenderTarget* rt = mCurrentRenderTarget;
 
     const VkExtent2D extent = rt->getExtent();
@@ -1049,6 +1150,13 @@ void VulkanDriver::beginRenderPass(Handle<HwRenderTarget> rth, const RenderPassP
         }
     }
 
+    // A single-sample depth texture rendered with MSAA is resolved by the render pass as well,
+    // unless its content is discarded anyway.
+    if (rpkey.samples > 1 && depth.texture && depth.texture->samples == 1 &&
+            !any(params.flags.discardEnd & TargetBufferFlags::DEPTH)) {
+        rpkey.needsDepthResolve = mContext.depthResolveSupported;
+    }
+
     VkRenderPass renderPass = mFramebufferCache.getRenderPass(rpkey);
     mBinder.bindRenderPass(renderPass, 0);
 
@@ -1080,6 +1188,7 @@ void VulkanDriver::beginRenderPass(Handle<HwRenderTarget> rth, const RenderPassP
     }
     if (depth.format != VK_FORMAT_UNDEFINED) {
         fbkey.depth = rpkey.samples == 1 ? depth.view : rt->getMsaaDepth().view;
+        fbkey.depthResolve = rpkey.needsDepthResolve ? depth.view : VK_NULL_HANDLE;
         assert_invariant(fbkey.depth);
     }
     VkFramebuffer vkfb = mFramebufferCache.getFramebuffer(fbkey);
@@ -1130,9 +1239,10 @@ void VulkanDriver::beginRenderPass(Handle<HwRenderTarget> rth, const RenderPassP
     }
     renderPassInfo.pClearValues = &clearValues[0];
 
-    const SwapContext& swapContext = surface.swapContexts[surface.currentSwapIndex];
+    // Layout transitions cannot be recorded within the render pass.
+    mContext.barriers.flush();
 
-    vkCmdBeginRenderPass(swapContext.commands.cmdbuffer, &renderPassInfo,
+    vkCmdBeginRenderPass(mContext.currentCommands->cmdbuffer, &renderPassInfo,
             VK_SUBPASS_CONTENTS_INLINE);
 
     VkViewport viewport = mContext.viewport = {
@@ -1145,7 +1255,18 @@ void VulkanDriver::beginRenderPass(Handle<HwRenderTarget> rth, const RenderPassP
     };
 
     mCurrentRenderTarget->transformClientRectToPlatform(&viewport);
-    vkCmdSetViewport(swapContext.commands.cmdbuffer, 0, 1, &viewport);
+    vkCmdSetViewport(mContext.currentCommands->cmdbuffer, 0, 1, &viewport);
+
+    // The shading rate is a dynamic state of all our pipelines, so it must always be set.
+    if (mContext.fragmentShadingRateSupported) {
+        const VkExtent2D fragmentSize = getFragmentSize(params.shadingRate);
+        const VkFragmentShadingRateCombinerOpKHR combinerOps[2] = {
+            VK_FRAGMENT_SHADING_RATE_COMBINER_OP_KEEP_KHR,
+            VK_FRAGMENT_SHADING_RATE_COMBINER_OP_KEEP_KHR
+        };
+        vkCmdSetFragmentShadingRateKHR(mContext.currentCommands->cmdbuffer,
+                &fragmentSize, combinerOps);
+    }
 
     mContext.currentRenderPass = {
         .renderPass = renderPassInfo.renderPass,
@@ -1197,15 +1318,15 @@ void VulkanDriver::nextSubpass(int) {
 
 void VulkanDriver::setRenderPrimitiveBuffer(Handle<HwRenderPrimitive> rph,
         Handle<HwVertexBuffer> vbh, Handle<HwIndexBuffer> ibh) {
-    auto primitive = handle_cast<VulkanRenderPrimitive>(mHandleMap, rph);
-    primitive->setBuffers(handle_cast<VulkanVertexBuffer>(mHandleMap, vbh),
-            handle_cast<VulkanIndexBuffer>(mHandleMap, ibh));
+    auto primitive = handle_cast<VulkanRenderPrimitive>(rph);
+    primitive->setBuffers(handle_cast<VulkanVertexBuffer>(vbh),
+            handle_cast<VulkanIndexBuffer>(ibh));
 }
 
 void VulkanDriver::setRenderPrimitiveRange(Handle<HwRenderPrimitive> rph,
         PrimitiveType pt, uint32_t offset,
         uint32_t minIndex, uint32_t maxIndex, uint32_t count) {
-    auto& primitive = *handle_cast<VulkanRenderPrimitive>(mHandleMap, rph);
+    auto& primitive = *handle_cast<VulkanRenderPrimitive>(rph);
     primitive.setPrimitiveType(pt);
     primitive.offset = offset * primitive.indexBuffer->elementSize;
     primitive.count = count;
@@ -1216,15 +1337,21 @@ void VulkanDriver::setRenderPrimitiveRange(Handle<HwRenderPrimitive> rph,
 void VulkanDriver::makeCurrent(Handle<HwSwapChain> drawSch, Handle<HwSwapChain> readSch) {
     ASSERT_PRECONDITION_NON_FATAL(drawSch == readSch,
                                   "Vulkan driver does not support distinct draw/read swap chains.");
-    VulkanSurfaceContext& sContext = handle_cast<VulkanSwapChain>(mHandleMap, drawSch)->surfaceContext;
+    VulkanSurfaceContext& sContext = handle_cast<VulkanSwapChain>(drawSch)->surfaceContext;
     mContext.currentSurface = &sContext;
 }
 
+void VulkanDriver::setDamageRegion(Handle<HwSwapChain> sch, Viewport region) {
+    mDamageRegion = mContext.incrementalPresentSupported ? region : Viewport{};
+}
+
 void VulkanDriver::commit(Handle<HwSwapChain> sch) {
     // Tell Vulkan we're done appending to the command buffer.
     ASSERT_POSTCONDITION(mContext.currentCommands,
             "Vulkan driver requires at least one frame before a commit.");
 
+    mContext.barriers.flush();
+
     // Before swapping, transition the current swap chain image to the PRESENT layout. This cannot
     // be done as part of the render pass because it does not know if it is last pass in the frame.
     makeSwapChainPresentable(mContext);
@@ -1257,7 +1384,7 @@ void VulkanDriver::commit(Handle<HwSwapChain> sch) {
 
     auto& cmdfence = swapContext.commands.fence;
     std::unique_lock<utils::Mutex> lock(cmdfence->mutex);
-    result = vkQueueSubmit(mContext.graphicsQueue, 1, &submitInfo, cmdfence->fence);
+    result = submitCommands(mContext, submitInfo, *cmdfence);
     cmdfence->submitted = true;
     lock.unlock();
     ASSERT_POSTCONDITION(result == VK_SUCCESS, "vkQueueSubmit error.");
@@ -1269,7 +1396,7 @@ void VulkanDriver::commit(Handle<HwSwapChain> sch) {
     }
 
     // Present the backbuffer.
-    VulkanSurfaceContext& surface = handle_cast<VulkanSwapChain>(mHandleMap, sch)->surfaceContext;
+    VulkanSurfaceContext& surface = handle_cast<VulkanSwapChain>(sch)->surfaceContext;
     VkPresentInfoKHR presentInfo {
         .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
         .waitSemaphoreCount = 1,
@@ -1278,6 +1405,47 @@ void VulkanDriver::commit(Handle<HwSwapChain> sch) {
         .pSwapchains = &surface.swapchain,
         .pImageIndices = &surface.currentSwapIndex,
     };
+
+    // the presentation time only applies to the next present
+    const VkPresentTimeGOOGLE presentTime = { .desiredPresentTime = mPresentationTime };
+    VkPresentTimesInfoGOOGLE presentTimesInfo = {
+        .sType = VK_STRUCTURE_TYPE_PRESENT_TIMES_INFO_GOOGLE,
+        .swapchainCount = 1,
+        .pTimes = &presentTime,
+    };
+    if (mPresentationTime) {
+        presentTimesInfo.pNext = presentInfo.pNext;
+        presentInfo.pNext = &presentTimesInfo;
+        mPresentationTime = 0;
+    }
+
+    // so does the damage region, which lets the compositor only recompose that part of the
+    // surface. It must be within the surface, and Vulkan rectangles have a top-left origin.
+    const int32_t width = int32_t(surface.clientSize.width);
+    const int32_t height = int32_t(surface.clientSize.height);
+    const int32_t left = std::clamp(mDamageRegion.left, 0, width);
+    const int32_t right = std::clamp(mDamageRegion.right(), 0, width);
+    const int32_t bottom = std::clamp(mDamageRegion.bottom, 0, height);
+    const int32_t top = std::clamp(mDamageRegion.top(), 0, height);
+    const VkRectLayerKHR damage = {
+        .offset = { left, height - top },
+        .extent = { uint32_t(right - left), uint32_t(top - bottom) },
+    };
+    const VkPresentRegionKHR presentRegion = {
+        .rectangleCount = 1,
+        .pRectangles = &damage,
+    };
+    VkPresentRegionsKHR presentRegions = {
+        .sType = VK_STRUCTURE_TYPE_PRESENT_REGIONS_KHR,
+        .swapchainCount = 1,
+        .pRegions = &presentRegion,
+    };
+    if (mDamageRegion.width && mDamageRegion.height) {
+        presentRegions.pNext = presentInfo.pNext;
+        presentInfo.pNext = &presentRegions;
+        mDamageRegion = {};
+    }
+
     result = vkQueuePresentKHR(surface.presentQueue, &presentInfo);
 
     // On Android Q and above, a suboptimal surface is always reported after screen rotation:
@@ -1293,24 +1461,41 @@ void VulkanDriver::commit(Handle<HwSwapChain> sch) {
 }
 
 void VulkanDriver::bindUniformBuffer(size_t index, Handle<HwUniformBuffer> ubh) {
-    auto* buffer = handle_cast<VulkanUniformBuffer>(mHandleMap, ubh);
+    auto* buffer = handle_cast<VulkanUniformBuffer>(ubh);
     // The driver API does not currently expose offset / range, but it will do so in the future.
-    const VkDeviceSize offset = 0;
-    const VkDeviceSize size = VK_WHOLE_SIZE;
+    // Streamed buffers are bound to the slot that was loaded last.
+    const VkDeviceSize offset = buffer->getOffset();
+    const VkDeviceSize size = buffer->getSize();
+    if (mContext.currentCommands) {
+        buffer->markUsed(*mContext.currentCommands);
+    }
     mBinder.bindUniformBuffer((uint32_t) index, buffer->getGpuBuffer(), offset, size);
 }
 
 void VulkanDriver::bindUniformBufferRange(size_t index, Handle<HwUniformBuffer> ubh,
         size_t offset, size_t size) {
-    auto* buffer = handle_cast<VulkanUniformBuffer>(mHandleMap, ubh);
-    mBinder.bindUniformBuffer((uint32_t)index, buffer->getGpuBuffer(), offset, size);
+    auto* buffer = handle_cast<VulkanUniformBuffer>(ubh);
+    if (mContext.currentCommands) {
+        buffer->markUsed(*mContext.currentCommands);
+    }
+    mBinder.bindUniformBuffer((uint32_t)index, buffer->getGpuBuffer(),
+            buffer->getOffset() + offset, size);
 }
 
 void VulkanDriver::bindSamplers(size_t index, Handle<HwSamplerGroup> sbh) {
-    auto* hwsb = handle_cast<VulkanSamplerGroup>(mHandleMap, sbh);
+    auto* hwsb = handle_cast<VulkanSamplerGroup>(sbh);
     mSamplerBindings[index] = hwsb;
 }
 
+void VulkanDriver::bindStorageBuffer(size_t index, Handle<HwBufferObject> boh) {
+    if (UTILS_UNLIKELY(!mContext.computeSupported)) {
+        return;
+    }
+    auto* bufferObject = handle_cast<VulkanBufferObject>(boh);
+    mBinder.bindStorageBuffer((uint32_t)index, bufferObject->buffer->getGpuBuffer());
+    mStorageBindings[index] = bufferObject;
+}
+
 void VulkanDriver::insertEventMarker(char const* string, size_t len) {
     constexpr float MARKER_COLOR[] = { 0.0f, 1.0f, 0.0f, 1.0f };
     ASSERT_POSTCONDITION(mContext.currentCommands,
@@ -1372,52 +1557,30 @@ void VulkanDriver::stopCapture(int) {
 
 void VulkanDriver::readPixels(Handle<HwRenderTarget> src, uint32_t x, uint32_t y,
         uint32_t width, uint32_t height, PixelBufferDescriptor&& pbd) {
-    const VkDevice device = mContext.device;
-    const VulkanRenderTarget* srcTarget = handle_cast<VulkanRenderTarget>(mHandleMap, src);
+    const VulkanRenderTarget* srcTarget = handle_cast<VulkanRenderTarget>(src);
     const VulkanTexture* srcTexture = srcTarget->getColor(0).texture;
     const VkFormat swapChainFormat = mContext.currentSurface->surfaceFormat.format;
     const VkFormat srcFormat = srcTexture ? srcTexture->getVkFormat() : swapChainFormat;
-    const bool swizzle = srcFormat == VK_FORMAT_B8G8R8A8_UNORM;
 
-    // Create a host visible, linearly tiled image as a staging area.
-
-    VkImageCreateInfo imageInfo {
-        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-        .imageType = VK_IMAGE_TYPE_2D,
-        .format = srcFormat,
-        .extent = { width, height, 1 },
-        .mipLevels = 1,
-        .arrayLayers = 1,
-        .samples = VK_SAMPLE_COUNT_1_BIT,
-        .tiling = VK_IMAGE_TILING_LINEAR,
-        .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT,
-        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-    };
-
-    VkImage stagingImage;
-    vkCreateImage(device, &imageInfo, VKALLOC, &stagingImage);
-
-    VkMemoryRequirements memReqs;
-    VkDeviceMemory stagingMemory;
-    vkGetImageMemoryRequirements(device, stagingImage, &memReqs);
-    VkMemoryAllocateInfo allocInfo = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = memReqs.size,
-        .memoryTypeIndex = selectMemoryType(mContext, memReqs.memoryTypeBits,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
-    };
-
-    vkAllocateMemory(device, &allocInfo, nullptr, &stagingMemory);
-    vkBindImageMemory(device, stagingImage, stagingMemory, 0);
+    // Within a frame, the copy is recorded in the frame's command buffer, after the passes that
+    // rendered the source, and the pixels are delivered once that command buffer has completed,
+    // typically a few frames later. Otherwise, the copy goes through the work command buffer
+    // and we wait for it.
+    const bool inFrame = mContext.currentCommands != nullptr;
+    if (!inFrame) {
+        waitForIdle(mContext);
+    }
+    VulkanCommandBuffer& commands = inFrame ? *mContext.currentCommands : mContext.work;
+    const VkCommandBuffer cmdbuffer = commands.cmdbuffer;
 
-    // TODO: replace waitForIdle with an image barrier coupled with acquireWorkCommandBuffer.
-    waitForIdle(mContext);
+    ReadPixelsImage staging = acquireReadPixelsImage(srcFormat, width, height);
 
-    // Transition the staging image layout.
+    // Transition the staging image layout, its previous content is irrelevant.
 
-    VulkanTexture::transitionImageLayout(mContext.work.cmdbuffer, stagingImage,
-            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, 1, 1,
-            VK_IMAGE_ASPECT_COLOR_BIT);
+    mContext.barriers.transition(cmdbuffer, staging.image,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 });
+    mContext.barriers.flush();
 
     const uint8_t srcMipLevel = srcTarget->getColor(0).level;
 
@@ -1442,43 +1605,59 @@ void VulkanDriver::readPixels(Handle<HwRenderTarget> src, uint32_t x, uint32_t y
         },
     };
 
-    // Transition the source image layout (which might be the swap chain)
+    // Transition the source image layout (which might be the swap chain). The copy must wait
+    // for the color attachment writes of the passes recorded before it.
 
     VkImage srcImage = srcTarget->getColor(0).image;
-    VulkanTexture::transitionImageLayout(mContext.work.cmdbuffer, srcImage,
-            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, srcMipLevel, 1, 1,
-            VK_IMAGE_ASPECT_COLOR_BIT);
+    VkImageMemoryBarrier srcBarrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = srcImage,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = srcMipLevel,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        }
+    };
+    vkCmdPipelineBarrier(cmdbuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &srcBarrier);
 
     // Perform the blit.
 
-    vkCmdCopyImage(mContext.work.cmdbuffer, srcTarget->getColor(0).image,
-            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, stagingImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+    vkCmdCopyImage(cmdbuffer, srcImage,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, staging.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
             1, &imageCopyRegion);
 
     // Restore the source image layout.
 
+    const VkImageSubresourceRange srcRange = { VK_IMAGE_ASPECT_COLOR_BIT, srcMipLevel, 1, 0, 1 };
     if (srcTexture || mContext.currentSurface->presentQueue) {
         const VkImageLayout present = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-        VulkanTexture::transitionImageLayout(mContext.work.cmdbuffer, srcImage,
-                VK_IMAGE_LAYOUT_UNDEFINED, srcTexture ? getTextureLayout(srcTexture->usage) : present,
-                srcMipLevel, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT);
+        mContext.barriers.transition(cmdbuffer, srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                srcTexture ? getTextureLayout(srcTexture->usage) : present, srcRange);
     } else {
-        VulkanTexture::transitionImageLayout(mContext.work.cmdbuffer, srcImage,
-                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
-                srcMipLevel, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT);
+        mContext.barriers.transition(cmdbuffer, srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_IMAGE_LAYOUT_GENERAL, srcRange);
     }
 
-    // Transition the staging image layout to GENERAL.
+    // Transition the staging image layout to GENERAL, and make the copy visible to the host.
 
     VkImageMemoryBarrier barrier = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
         .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-        .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT,
+        .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
         .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
         .newLayout = VK_IMAGE_LAYOUT_GENERAL,
         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image = stagingImage,
+        .image = staging.image,
         .subresourceRange = {
             .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
             .baseMipLevel = 0,
@@ -1488,39 +1667,119 @@ void VulkanDriver::readPixels(Handle<HwRenderTarget> src, uint32_t x, uint32_t y
         }
     };
 
-    vkCmdPipelineBarrier(mContext.work.cmdbuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
-            VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    vkCmdPipelineBarrier(cmdbuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 
-    // Flush and wait.
+    // TODO: investigate why this Y-flip exists. This conditional seems to work with both
+    // test_ReadPixels.cpp (readpixels from a normal render target with texture attachment) and
+    // viewer_basic_test.cc (readpixels from an offscreen swap chain)
+    mPendingReadPixels.push_back({
+        .fence = commands.fence,
+        .staging = staging,
+        .pbd = std::move(pbd),
+        .swizzle = srcFormat == VK_FORMAT_B8G8R8A8_UNORM,
+        .flipY = srcTexture != nullptr,
+    });
 
-    flushWorkCommandBuffer(mContext);
-    acquireWorkCommandBuffer(mContext);
+    if (!inFrame) {
+        // Flush and wait.
+        flushWorkCommandBuffer(mContext);
+        acquireWorkCommandBuffer(mContext);
+        collectReadPixels(false);
+    }
+}
 
-    VkImageSubresource subResource { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT };
-    VkSubresourceLayout subResourceLayout;
-    vkGetImageSubresourceLayout(device, stagingImage, &subResource, &subResourceLayout);
+VulkanDriver::ReadPixelsImage VulkanDriver::acquireReadPixelsImage(VkFormat format,
+        uint32_t width, uint32_t height) {
+    auto& v = mReadPixelsImages;
+    auto it = std::find_if(v.begin(), v.end(), [=](ReadPixelsImage const& image) {
+        return image.format == format && image.width == width && image.height == height;
+    });
+    if (it != v.end()) {
+        ReadPixelsImage const image = *it;
+        v.erase(it);
+        return image;
+    }
 
-    // Map image memory so we can start copying from it.
+    // Create a host visible, linearly tiled image as a staging area. It stays mapped for as long
+    // as it's recycled.
 
-    const uint8_t* srcPixels;
-    vkMapMemory(device, stagingMemory, 0, VK_WHOLE_SIZE, 0, (void**) &srcPixels);
-    srcPixels += subResourceLayout.offset;
+    const VkDevice device = mContext.device;
+    ReadPixelsImage image = { .format = format, .width = width, .height = height };
 
-    // TODO: investigate why this Y-flip exists. This conditional seems to work with both
-    // test_ReadPixels.cpp (readpixels from a normal render target with texture attachment) and
-    // viewer_basic_test.cc (readpixels from an offscreen swap chain)
-    const bool flipY = srcTexture ? true : false;
+    VkImageCreateInfo imageInfo {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = format,
+        .extent = { width, height, 1 },
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_LINEAR,
+        .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+    vkCreateImage(device, &imageInfo, VKALLOC, &image.image);
 
-    if (!DataReshaper::reshapeImage(&pbd, getComponentType(srcFormat), srcPixels,
-            subResourceLayout.rowPitch, width, height, swizzle, flipY)) {
-        utils::slog.e << "Unsupported PixelDataFormat or PixelDataType" << utils::io::endl;
-    }
+    VkMemoryRequirements memReqs;
+    vkGetImageMemoryRequirements(device, image.image, &memReqs);
+    VkMemoryAllocateInfo allocInfo = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = memReqs.size,
+        .memoryTypeIndex = selectMemoryType(mContext, memReqs.memoryTypeBits,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+    };
+    vkAllocateMemory(device, &allocInfo, nullptr, &image.memory);
+    vkBindImageMemory(device, image.image, image.memory, 0);
 
-    vkUnmapMemory(device, stagingMemory);
-    vkFreeMemory(device, stagingMemory, nullptr);
-    vkDestroyImage(device, stagingImage, nullptr);
+    VkImageSubresource subResource { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT };
+    VkSubresourceLayout subResourceLayout;
+    vkGetImageSubresourceLayout(device, image.image, &subResource, &subResourceLayout);
+    void* pixels;
+    vkMapMemory(device, image.memory, 0, VK_WHOLE_SIZE, 0, &pixels);
+    image.pixels = (const uint8_t*) pixels + subResourceLayout.offset;
+    image.rowPitch = subResourceLayout.rowPitch;
+    return image;
+}
 
-    scheduleDestroy(std::move(pbd));
+void VulkanDriver::destroyReadPixelsImage(ReadPixelsImage const& image) {
+    const VkDevice device = mContext.device;
+    vkUnmapMemory(device, image.memory);
+    vkFreeMemory(device, image.memory, nullptr);
+    vkDestroyImage(device, image.image, VKALLOC);
+}
+
+void VulkanDriver::collectReadPixels(bool discard) {
+    auto& v = mPendingReadPixels;
+    auto it = v.begin();
+    while (it != v.end()) {
+        // the fence is kept alive by the request, even if its command buffer was recycled, and
+        // knows the timeline value of its submission
+        const bool completed = isCompleted(mContext, *it->fence);
+        if (!completed && !discard) {
+            ++it;
+            continue;
+        }
+        ReadPixelsImage const& staging = it->staging;
+        if (completed && !DataReshaper::reshapeImage(&it->pbd, getComponentType(staging.format),
+                staging.pixels, staging.rowPitch, staging.width, staging.height,
+                it->swizzle, it->flipY)) {
+            utils::slog.e << "Unsupported PixelDataFormat or PixelDataType" << utils::io::endl;
+        }
+        if (discard) {
+            destroyReadPixelsImage(staging);
+        } else {
+            auto& images = mReadPixelsImages;
+            if (images.size() == MAX_READ_PIXELS_IMAGES) {
+                // evict the oldest image
+                destroyReadPixelsImage(images.front());
+                images.erase(images.begin());
+            }
+            images.push_back(staging);
+        }
+        scheduleDestroy(std::move(it->pbd));
+        it = v.erase(it);
+    }
 }
 
 void VulkanDriver::readStreamPixels(Handle<HwStream> sh, uint32_t x, uint32_t y, uint32_t width,
@@ -1530,8 +1789,8 @@ void VulkanDriver::readStreamPixels(Handle<HwStream> sh, uint32_t x, uint32_t y,
 
 void VulkanDriver::blit(TargetBufferFlags buffers, Handle<HwRenderTarget> dst, Viewport dstRect,
         Handle<HwRenderTarget> src, Viewport srcRect, SamplerMagFilter filter) {
-    VulkanRenderTarget* dstTarget = handle_cast<VulkanRenderTarget>(mHandleMap, dst);
-    VulkanRenderTarget* srcTarget = handle_cast<VulkanRenderTarget>(mHandleMap, src);
+    VulkanRenderTarget* dstTarget = handle_cast<VulkanRenderTarget>(dst);
+    VulkanRenderTarget* srcTarget = handle_cast<VulkanRenderTarget>(src);
 
     VkFilter vkfilter = filter == SamplerMagFilter::NEAREST ? VK_FILTER_NEAREST : VK_FILTER_LINEAR;
 
@@ -1581,18 +1840,116 @@ void VulkanDriver::blit(TargetBufferFlags buffers, Handle<HwRenderTarget> dst, V
     }
 }
 
-void VulkanDriver::draw(PipelineState pipelineState, Handle<HwRenderPrimitive> rph) {
+void VulkanDriver::dispatchCompute(Handle<HwProgram> ph, math::uint3 workGroupCount) {
+    if (UTILS_UNLIKELY(!mContext.computeSupported)) {
+        return;
+    }
+    ASSERT_PRECONDITION(mContext.currentRenderPass.renderPass == VK_NULL_HANDLE,
+            "dispatchCompute must be called outside of a render pass.");
+
+    auto* program = handle_cast<VulkanProgram>(ph);
+    if (UTILS_UNLIKELY(program->bundle.compute == VK_NULL_HANDLE)) {
+        utils::slog.e << "Dispatching a program without compute shader: "
+                << program->name.c_str() << utils::io::endl;
+        return;
+    }
+
+    auto dispatch = [this, program, workGroupCount](VulkanCommandBuffer& commands) {
+        VkCommandBuffer cmdbuffer = commands.cmdbuffer;
+        mDisposer.acquire(program, commands.resources);
+        for (VulkanBufferObject* bufferObject : mStorageBindings) {
+            if (bufferObject) {
+                mDisposer.acquire(bufferObject, commands.resources);
+            }
+        }
+
+        VkDescriptorSet descriptor;
+        VkPipelineLayout pipelineLayout;
+        mBinder.getOrCreateComputeDescriptors(&descriptor, &pipelineLayout);
+        vkCmdBindDescriptorSets(cmdbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1,
+                &descriptor, 0, nullptr);
+        if (program->computePipeline == VK_NULL_HANDLE) {
+            program->computePipeline = mBinder.createComputePipeline(program->bundle.compute);
+        }
+        vkCmdBindPipeline(cmdbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, program->computePipeline);
+
+        // Previous draws and dispatches may still be reading the buffers that this dispatch
+        // overwrites.
+        constexpr VkPipelineStageFlags consumerStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        vkCmdPipelineBarrier(cmdbuffer, consumerStages, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                0, nullptr, 0, nullptr, 0, nullptr);
+
+        vkCmdDispatch(cmdbuffer, workGroupCount.x, workGroupCount.y, workGroupCount.z);
+
+        // Make the results visible to the commands that can consume them.
+        VkMemoryBarrier barrier {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT |
+                    VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                    VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT |
+                    VK_ACCESS_SHADER_WRITE_BIT
+        };
+        vkCmdPipelineBarrier(cmdbuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, consumerStages, 0,
+                1, &barrier, 0, nullptr, 0, nullptr);
+    };
+
+    // If inside beginFrame / endFrame, use the swap context, otherwise use the work cmdbuffer.
+    if (mContext.currentCommands) {
+        dispatch(*mContext.currentCommands);
+    } else {
+        acquireWorkCommandBuffer(mContext);
+        dispatch(mContext.work);
+        flushWorkCommandBuffer(mContext);
+    }
+}
+
+void VulkanDriver::drawIndirect(PipelineState pipelineState, Handle<HwRenderPrimitive> rph,
+        Handle<HwBufferObject> boh, uint32_t offset) {
     VulkanCommandBuffer* commands = mContext.currentCommands;
     ASSERT_POSTCONDITION(commands, "Draw calls can occur only within a beginFrame / endFrame.");
+    const VulkanRenderPrimitive& prim = *handle_cast<VulkanRenderPrimitive>(rph);
+    auto* arguments = handle_cast<VulkanBufferObject>(boh);
+    mDisposer.acquire(arguments, commands->resources);
+
+    bindPipelineAndPrimitive(pipelineState, prim);
+
+    // Like in GL, the command's firstIndex is relative to the start of the index buffer.
+    vkCmdDrawIndexedIndirect(commands->cmdbuffer, arguments->buffer->getGpuBuffer(), offset, 1,
+            sizeof(uint32_t) * 5);
+}
+
+void VulkanDriver::draw(PipelineState pipelineState, Handle<HwRenderPrimitive> rph,
+        uint32_t instanceCount) {
+    VulkanCommandBuffer* commands = mContext.currentCommands;
+    ASSERT_POSTCONDITION(commands, "Draw calls can occur only within a beginFrame / endFrame.");
+    const VulkanRenderPrimitive& prim = *handle_cast<VulkanRenderPrimitive>(rph);
+
+    bindPipelineAndPrimitive(pipelineState, prim);
+
+    // Finally, make the actual draw call. TODO: support subranges
+    const uint32_t indexCount = prim.count;
+    const uint32_t firstIndex = prim.offset / prim.indexBuffer->elementSize;
+    const int32_t vertexOffset = 0;
+    const uint32_t firstInstId = 0;
+    vkCmdDrawIndexed(commands->cmdbuffer, indexCount, instanceCount, firstIndex, vertexOffset,
+            firstInstId);
+}
+
+// Binds everything that draw() and drawIndirect() need, except for the draw arguments.
+void VulkanDriver::bindPipelineAndPrimitive(const PipelineState& pipelineState,
+        const VulkanRenderPrimitive& prim) {
+    VulkanCommandBuffer* commands = mContext.currentCommands;
     VkCommandBuffer cmdbuffer = commands->cmdbuffer;
-    const VulkanRenderPrimitive& prim = *handle_cast<VulkanRenderPrimitive>(mHandleMap, rph);
 
     Handle<HwProgram> programHandle = pipelineState.program;
     RasterState rasterState = pipelineState.rasterState;
     PolygonOffset depthOffset = pipelineState.polygonOffset;
     const Viewport& viewportScissor = pipelineState.scissor;
 
-    auto* program = handle_cast<VulkanProgram>(mHandleMap, programHandle);
+    auto* program = handle_cast<VulkanProgram>(programHandle);
     mDisposer.acquire(program, commands->resources);
     mDisposer.acquire(prim.indexBuffer, commands->resources);
     mDisposer.acquire(prim.vertexBuffer, commands->resources);
@@ -1704,8 +2061,8 @@ void VulkanDriver::draw(PipelineState pipelineState, Handle<HwRenderPrimitive> r
         size_t samplerIdx = 0;
         for (const auto& sampler : samplerGroup) {
             size_t bindingPoint = sampler.binding;
-            const SamplerGroup::Sampler* boundSampler = sb->getSamplers() + samplerIdx;
-            samplerIdx++;
+            const size_t slot = samplerIdx++;
+            const SamplerGroup::Sampler* boundSampler = sb->getSamplers() + slot;
 
             // Note that we always use a 2D texture for the fallback texture, which might not be
             // appropriate. The fallback improves robustness but does not guarantee 100% success.
@@ -1723,12 +2080,14 @@ void VulkanDriver::draw(PipelineState pipelineState, Handle<HwRenderPrimitive> r
                 utils::slog.w << " at binding point " << +bindingPoint << utils::io::endl;
                 texture = mContext.emptyTexture;
             } else {
-                texture = handle_const_cast<VulkanTexture>(mHandleMap, boundSampler->t);
+                texture = handle_const_cast<VulkanTexture>(boundSampler->t);
                 mDisposer.acquire(texture, commands->resources);
             }
 
-            const SamplerParams& samplerParams = boundSampler->s;
-            VkSampler vksampler = mSamplerCache.getSampler(samplerParams);
+            VkSampler& vksampler = vksb->samplers[slot];
+            if (UTILS_UNLIKELY(vksampler == VK_NULL_HANDLE)) {
+                vksampler = mSamplerCache.getSampler(boundSampler->s);
+            }
 
             samplers[bindingPoint] = {
                 .sampler = vksampler,
@@ -1758,9 +2117,10 @@ void VulkanDriver::draw(PipelineState pipelineState, Handle<HwRenderPrimitive> r
     // Bind new descriptor sets if they need to change.
     VkDescriptorSet descriptors[3];
     VkPipelineLayout pipelineLayout;
-    if (mBinder.getOrCreateDescriptors(descriptors, &pipelineLayout)) {
+    uint32_t dynamicOffsets[VulkanBinder::UBUFFER_BINDING_COUNT];
+    if (mBinder.getOrCreateDescriptors(descriptors, &pipelineLayout, dynamicOffsets)) {
         vkCmdBindDescriptorSets(cmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 3,
-                descriptors, 0, nullptr);
+                descriptors, VulkanBinder::UBUFFER_BINDING_COUNT, dynamicOffsets);
     }
 
     // Bind the pipeline if it changed. This can happen, for example, if the raster state changed.
@@ -1776,21 +2136,13 @@ void VulkanDriver::draw(PipelineState pipelineState, Handle<HwRenderPrimitive> r
     vkCmdBindVertexBuffers(cmdbuffer, 0, bufferCount, buffers, offsets);
     vkCmdBindIndexBuffer(cmdbuffer, prim.indexBuffer->buffer->getGpuBuffer(), 0,
             prim.indexBuffer->indexType);
-
-    // Finally, make the actual draw call. TODO: support subranges
-    const uint32_t indexCount = prim.count;
-    const uint32_t instanceCount = 1;
-    const uint32_t firstIndex = prim.offset / prim.indexBuffer->elementSize;
-    const int32_t vertexOffset = 0;
-    const uint32_t firstInstId = 1;
-    vkCmdDrawIndexed(cmdbuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstId);
 }
 
 void VulkanDriver::beginTimerQuery(Handle<HwTimerQuery> tqh) {
     VulkanCommandBuffer* commands = mContext.currentCommands;
     ASSERT_POSTCONDITION(commands, "Timer queries can occur only within a beginFrame / endFrame.");
 
-    VulkanTimerQuery* vtq = handle_cast<VulkanTimerQuery>(mHandleMap, tqh);
+    VulkanTimerQuery* vtq = handle_cast<VulkanTimerQuery>(tqh);
     const uint32_t index = vtq->startingQueryIndex;
     const VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
 
@@ -1803,7 +2155,7 @@ void VulkanDriver::endTimerQuery(Handle<HwTimerQuery> tqh) {
     VulkanCommandBuffer* commands = mContext.currentCommands;
     ASSERT_POSTCONDITION(commands, "Timer queries can occur only within a beginFrame / endFrame.");
 
-    VulkanTimerQuery* vtq = handle_cast<VulkanTimerQuery>(mHandleMap, tqh);
+    VulkanTimerQuery* vtq = handle_cast<VulkanTimerQuery>(tqh);
     const uint32_t index = vtq->stoppingQueryIndex;
     const VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
     vkCmdWriteTimestamp(commands->cmdbuffer, stage, mContext.timestamps.pool, index);
@@ -28,17 +28,23 @@
 
 #include "private/backend/Driver.h"
 #include "DriverBase.h"
+#include "HandleAllocator.h"
 
 #include <utils/compiler.h>
 #include <utils/Allocator.h>
 
-#include <unordered_map>
 #include <vector>
 
+#ifndef FILAMENT_VULKAN_HANDLE_ARENA_SIZE_IN_MB
+#    define FILAMENT_VULKAN_HANDLE_ARENA_SIZE_IN_MB 4
+#endif
+
 namespace filament {
 namespace backend {
 
 class VulkanPlatform;
+struct VulkanBufferObject;
+struct VulkanRenderPrimitive;
 struct VulkanRenderTarget;
 struct VulkanSamplerGroup;
 
@@ -79,73 +85,66 @@ private:
 private:
     backend::VulkanPlatform& mContextManager;
 
-    // For now we're not bothering to store handles in pools, just simple on-demand allocation.
-    // We have a little map from integer handles to "blobs" which get replaced with the Hw objects.
-    using Blob = std::vector<uint8_t>;
-    using HandleMap = std::unordered_map<HandleBase::HandleId, Blob>;
-    HandleMap mHandleMap;
-    std::mutex mHandleMapMutex;
-    HandleBase::HandleId mNextId = 1;
+    using HandleAllocatorVK = HandleAllocator<64, 176, 512>;
+    HandleAllocatorVK mHandleAllocator;
 
     template<typename Dp, typename B>
     Handle<B> alloc_handle() {
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        mHandleMap[mNextId] = Blob(sizeof(Dp));
-        return Handle<B>(mNextId++);
+        return mHandleAllocator.allocate<Dp>();
     }
 
     template<typename Dp, typename B>
-    Dp* handle_cast(HandleMap& handleMap, Handle<B> handle) noexcept {
-        assert_invariant(handle);
-        if (!handle) return nullptr; // better to get a NPE than random behavior/corruption
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        auto iter = handleMap.find(handle.getId());
-        assert_invariant(iter != handleMap.end());
-        Blob& blob = iter->second;
-        assert_invariant(blob.size() == sizeof(Dp));
-        return reinterpret_cast<Dp*>(blob.data());
+    Dp* handle_cast(Handle<B> handle) noexcept {
+        return mHandleAllocator.handle_cast<Dp*>(handle);
     }
 
     template<typename Dp, typename B>
-    const Dp* handle_const_cast(HandleMap& handleMap, const Handle<B>& handle) noexcept {
-        assert_invariant(handle);
-        if (!handle) return nullptr; // better to get a NPE than random behavior/corruption
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        auto iter = handleMap.find(handle.getId());
-        assert_invariant(iter != handleMap.end());
-        Blob& blob = iter->second;
-        assert_invariant(blob.size() == sizeof(Dp));
-        return reinterpret_cast<const Dp*>(blob.data());
+    const Dp* handle_const_cast(const Handle<B>& handle) noexcept {
+        return mHandleAllocator.handle_cast<const Dp*>(handle);
     }
 
     template<typename Dp, typename B, typename ... ARGS>
-    Dp* construct_handle(HandleMap& handleMap, Handle<B>& handle, ARGS&& ... args) noexcept {
-        assert_invariant(handle);
-        if (!handle) return nullptr; // better to get a NPE than random behavior/corruption
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        auto iter = handleMap.find(handle.getId());
-        assert_invariant(iter != handleMap.end());
-        Blob& blob = iter->second;
-        assert_invariant(blob.size() == sizeof(Dp));
-        Dp* addr = reinterpret_cast<Dp*>(blob.data());
-        new(addr) Dp(std::forward<ARGS>(args)...);
-        return addr;
+    Dp* construct_handle(Handle<B>& handle, ARGS&& ... args) noexcept {
+        return mHandleAllocator.construct<Dp>(handle, std::forward<ARGS>(args)...);
     }
 
     template<typename Dp, typename B>
-    void destruct_handle(HandleMap& handleMap, const Handle<B>& handle) noexcept {
-        std::lock_guard<std::mutex> lock(mHandleMapMutex);
-        // Call the destructor, remove the blob, don't bother reclaiming the integer id.
-        auto iter = handleMap.find(handle.getId());
-        assert_invariant(iter != handleMap.end());
-        Blob& blob = iter->second;
-        assert_invariant(blob.size() == sizeof(Dp));
-        reinterpret_cast<Dp*>(blob.data())->~Dp();
-        handleMap.erase(handle.getId());
+    void destruct_handle(const Handle<B>& handle) noexcept {
+        mHandleAllocator.deallocate<Dp>(const_cast<Handle<B>&>(handle));
     }
 
     void refreshSwapChain();
 
+    // Host visible images receiving the pixels of readPixels(). They are recycled when the
+    // pixels have been delivered, so that a readback every frame doesn't allocate.
+    struct ReadPixelsImage {
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        const uint8_t* pixels = nullptr;    // persistently mapped
+        VkDeviceSize rowPitch = 0;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    // A readback waiting for the command buffer that copies its pixels.
+    struct PendingReadPixels {
+        std::shared_ptr<VulkanCmdFence> fence;
+        ReadPixelsImage staging;
+        PixelBufferDescriptor pbd;
+        bool swizzle;
+        bool flipY;
+    };
+
+    static constexpr size_t MAX_READ_PIXELS_IMAGES = 4;
+    ReadPixelsImage acquireReadPixelsImage(VkFormat format, uint32_t width, uint32_t height);
+    void destroyReadPixelsImage(ReadPixelsImage const& image);
+    // delivers the completed readbacks, or discards all of them
+    void collectReadPixels(bool discard);
+
+    void bindPipelineAndPrimitive(const PipelineState& pipelineState,
+            const VulkanRenderPrimitive& prim);
+
     VulkanContext mContext = {};
     VulkanBinder mBinder;
     VulkanBlitter mBlitter;
@@ -155,8 +154,18 @@ private:
     VulkanSamplerCache mSamplerCache;
     VulkanRenderTarget* mCurrentRenderTarget = nullptr;
     VulkanSamplerGroup* mSamplerBindings[VulkanBinder::SAMPLER_BINDING_COUNT] = {};
+    VulkanBufferObject* mStorageBindings[VulkanBinder::STORAGE_BINDING_COUNT] = {};
     VkDebugReportCallbackEXT mDebugCallback = VK_NULL_HANDLE;
     VkDebugUtilsMessengerEXT mDebugMessenger = VK_NULL_HANDLE;
+
+    // desired presentation time of the next present in ns, 0 when unset
+    uint64_t mPresentationTime = 0;
+
+    // region updated by the next present, empty when unset
+    Viewport mDamageRegion{};
+
+    std::vector<ReadPixelsImage> mReadPixelsImages;
+    std::vector<PendingReadPixels> mPendingReadPixels;
 };
 
 } // namespace backend
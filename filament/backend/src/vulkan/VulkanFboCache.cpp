@@ -16,6 +16,7 @@
 
 #include "vulkan/VulkanFboCache.h"
 
+#include <utils/Log.h>
 #include <utils/Panic.h>
 
 #define FILAMENT_VULKAN_VERBOSE 0
@@ -25,6 +26,120 @@ using namespace bluevk;
 namespace filament {
 namespace backend {
 
+namespace {
+
+constexpr size_t MAX_ATTACHMENTS = MRT::TARGET_COUNT + MRT::TARGET_COUNT + 2;
+
+VkAttachmentReference2 toReference2(VkAttachmentReference const& ref, VkImageAspectFlags aspect) {
+    return {
+        .sType = VK_STRUCTURE_TYPE_ATTACHMENT_REFERENCE_2,
+        .attachment = ref.attachment,
+        .layout = ref.layout,
+        .aspectMask = aspect,
+    };
+}
+
+// The depth resolve attachment of a subpass can only be specified through the structures of
+// VK_KHR_create_renderpass2, so this translates a render pass description to them.
+VkResult createRenderPassWithDepthResolve(VkDevice device, VkRenderPassCreateInfo const& info,
+        uint32_t depthResolveIndex, VkRenderPass* renderPass) {
+    assert_invariant(info.attachmentCount <= MAX_ATTACHMENTS && info.subpassCount <= 2);
+
+    VkAttachmentDescription2 attachments[MAX_ATTACHMENTS];
+    for (uint32_t i = 0; i < info.attachmentCount; i++) {
+        VkAttachmentDescription const& attachment = info.pAttachments[i];
+        attachments[i] = {
+            .sType = VK_STRUCTURE_TYPE_ATTACHMENT_DESCRIPTION_2,
+            .flags = attachment.flags,
+            .format = attachment.format,
+            .samples = attachment.samples,
+            .loadOp = attachment.loadOp,
+            .storeOp = attachment.storeOp,
+            .stencilLoadOp = attachment.stencilLoadOp,
+            .stencilStoreOp = attachment.stencilStoreOp,
+            .initialLayout = attachment.initialLayout,
+            .finalLayout = attachment.finalLayout,
+        };
+    }
+
+    const VkAttachmentReference2 depthResolveRef = {
+        .sType = VK_STRUCTURE_TYPE_ATTACHMENT_REFERENCE_2,
+        .attachment = depthResolveIndex,
+        .layout = info.pAttachments[depthResolveIndex].finalLayout,
+    };
+
+    // SAMPLE_ZERO is the only mode that every implementation of the extension supports.
+    const VkSubpassDescriptionDepthStencilResolve depthResolve = {
+        .sType = VK_STRUCTURE_TYPE_SUBPASS_DESCRIPTION_DEPTH_STENCIL_RESOLVE,
+        .depthResolveMode = VK_RESOLVE_MODE_SAMPLE_ZERO_BIT,
+        .stencilResolveMode = VK_RESOLVE_MODE_NONE,
+        .pDepthStencilResolveAttachment = &depthResolveRef,
+    };
+
+    struct {
+        VkAttachmentReference2 input[MRT::TARGET_COUNT];
+        VkAttachmentReference2 color[MRT::TARGET_COUNT];
+        VkAttachmentReference2 resolve[MRT::TARGET_COUNT];
+        VkAttachmentReference2 depth;
+    } refs[2] = {};
+    VkSubpassDescription2 subpasses[2];
+    for (uint32_t s = 0; s < info.subpassCount; s++) {
+        VkSubpassDescription const& subpass = info.pSubpasses[s];
+        for (uint32_t i = 0; i < subpass.inputAttachmentCount; i++) {
+            refs[s].input[i] = toReference2(subpass.pInputAttachments[i], VK_IMAGE_ASPECT_COLOR_BIT);
+        }
+        for (uint32_t i = 0; i < subpass.colorAttachmentCount; i++) {
+            refs[s].color[i] = toReference2(subpass.pColorAttachments[i], 0);
+            if (subpass.pResolveAttachments) {
+                refs[s].resolve[i] = toReference2(subpass.pResolveAttachments[i], 0);
+            }
+        }
+        if (subpass.pDepthStencilAttachment) {
+            refs[s].depth = toReference2(*subpass.pDepthStencilAttachment, 0);
+        }
+        subpasses[s] = {
+            .sType = VK_STRUCTURE_TYPE_SUBPASS_DESCRIPTION_2,
+            .pNext = s + 1 == info.subpassCount ? &depthResolve : nullptr,
+            .pipelineBindPoint = subpass.pipelineBindPoint,
+            .inputAttachmentCount = subpass.inputAttachmentCount,
+            .pInputAttachments = subpass.pInputAttachments ? refs[s].input : nullptr,
+            .colorAttachmentCount = subpass.colorAttachmentCount,
+            .pColorAttachments = subpass.pColorAttachments ? refs[s].color : nullptr,
+            .pResolveAttachments = subpass.pResolveAttachments ? refs[s].resolve : nullptr,
+            .pDepthStencilAttachment = subpass.pDepthStencilAttachment ? &refs[s].depth : nullptr,
+        };
+    }
+
+    VkSubpassDependency2 dependencies[1];
+    assert_invariant(info.dependencyCount <= 1);
+    for (uint32_t i = 0; i < info.dependencyCount; i++) {
+        VkSubpassDependency const& dependency = info.pDependencies[i];
+        dependencies[i] = {
+            .sType = VK_STRUCTURE_TYPE_SUBPASS_DEPENDENCY_2,
+            .srcSubpass = dependency.srcSubpass,
+            .dstSubpass = dependency.dstSubpass,
+            .srcStageMask = dependency.srcStageMask,
+            .dstStageMask = dependency.dstStageMask,
+            .srcAccessMask = dependency.srcAccessMask,
+            .dstAccessMask = dependency.dstAccessMask,
+            .dependencyFlags = dependency.dependencyFlags,
+        };
+    }
+
+    const VkRenderPassCreateInfo2 renderPassInfo = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO_2,
+        .attachmentCount = info.attachmentCount,
+        .pAttachments = attachments,
+        .subpassCount = info.subpassCount,
+        .pSubpasses = subpasses,
+        .dependencyCount = info.dependencyCount,
+        .pDependencies = dependencies,
+    };
+    return vkCreateRenderPass2KHR(device, &renderPassInfo, VKALLOC, renderPass);
+}
+
+} // anonymous namespace
+
 bool VulkanFboCache::RenderPassEq::operator()(const RenderPassKey& k1,
         const RenderPassKey& k2) const {
     if (k1.clear != k2.clear) return false;
@@ -33,6 +148,7 @@ bool VulkanFboCache::RenderPassEq::operator()(const RenderPassKey& k1,
     if (k1.samples != k2.samples) return false;
     if (k1.needsResolveMask != k2.needsResolveMask) return false;
     if (k1.subpassMask != k2.subpassMask) return false;
+    if (k1.needsDepthResolve != k2.needsDepthResolve) return false;
     if (k1.depthLayout != k2.depthLayout) return false;
     if (k1.depthFormat != k2.depthFormat) return false;
     for (int i = 0; i < MRT::TARGET_COUNT; i++) {
@@ -49,6 +165,7 @@ bool VulkanFboCache::FboKeyEqualFn::operator()(const FboKey& k1, const FboKey& k
     if (k1.layers != k2.layers) return false;
     if (k1.samples != k2.samples) return false;
     if (k1.depth != k2.depth) return false;
+    if (k1.depthResolve != k2.depthResolve) return false;
     for (int i = 0; i < MRT::TARGET_COUNT; i++) {
         if (k1.color[i] != k2.color[i]) return false;
         if (k1.resolve[i] != k2.resolve[i]) return false;
@@ -65,15 +182,18 @@ VulkanFboCache::~VulkanFboCache() {
 
 VkFramebuffer VulkanFboCache::getFramebuffer(FboKey config) noexcept {
     auto iter = mFramebufferCache.find(config);
-    if (UTILS_LIKELY(iter != mFramebufferCache.end() && iter->second.handle != VK_NULL_HANDLE)) {
+    if (UTILS_LIKELY(iter != mFramebufferCache.end())) {
         iter.value().timestamp = mCurrentTime;
+        mStatistics.framebufferHits++;
         return iter->second.handle;
     }
+    mStatistics.framebufferMisses++;
 
-    // The attachment list contains: Color Attachments, Resolve Attachments, and Depth Attachment.
-    // For simplicity, create an array that can hold the maximum possible number of attachments.
-    // Note that this needs to have the same ordering as the corollary array in getRenderPass.
-    VkImageView attachments[MRT::TARGET_COUNT + MRT::TARGET_COUNT + 1];
+    // The attachment list contains: Color Attachments, Resolve Attachments, Depth Attachment, and
+    // Depth Resolve Attachment. For simplicity, create an array that can hold the maximum possible
+    // number of attachments. Note that this needs to have the same ordering as the corollary array
+    // in getRenderPass.
+    VkImageView attachments[MAX_ATTACHMENTS];
     uint32_t attachmentCount = 0;
     for (VkImageView attachment : config.color) {
         if (attachment) {
@@ -88,6 +208,9 @@ VkFramebuffer VulkanFboCache::getFramebuffer(FboKey config) noexcept {
     if (config.depth) {
         attachments[attachmentCount++] = config.depth;
     }
+    if (config.depthResolve) {
+        attachments[attachmentCount++] = config.depthResolve;
+    }
 
     #if FILAMENT_VULKAN_VERBOSE
     utils::slog.d << "Creating framebuffer " << config.width << "x" << config.height << " "
@@ -117,10 +240,12 @@ VkFramebuffer VulkanFboCache::getFramebuffer(FboKey config) noexcept {
 
 VkRenderPass VulkanFboCache::getRenderPass(RenderPassKey config) noexcept {
     auto iter = mRenderPassCache.find(config);
-    if (UTILS_LIKELY(iter != mRenderPassCache.end() && iter->second.handle != VK_NULL_HANDLE)) {
+    if (UTILS_LIKELY(iter != mRenderPassCache.end())) {
         iter.value().timestamp = mCurrentTime;
+        mStatistics.renderPassHits++;
         return iter->second.handle;
     }
+    mStatistics.renderPassMisses++;
     const bool isSwapChain = config.colorLayout[0] == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
     const bool hasSubpasses = config.subpassMask != 0;
 
@@ -178,10 +303,11 @@ VkRenderPass VulkanFboCache::getRenderPass(RenderPassKey config) noexcept {
         .pDepthStencilAttachment = hasDepth ? &depthAttachmentRef : nullptr
     }};
 
-    // The attachment list contains: Color Attachments, Resolve Attachments, and Depth Attachment.
-    // For simplicity, create an array that can hold the maximum possible number of attachments.
-    // Note that this needs to have the same ordering as the corollary array in getFramebuffer.
-    VkAttachmentDescription attachments[MRT::TARGET_COUNT + MRT::TARGET_COUNT + 1] = {};
+    // The attachment list contains: Color Attachments, Resolve Attachments, Depth Attachment, and
+    // Depth Resolve Attachment. For simplicity, create an array that can hold the maximum possible
+    // number of attachments. Note that this needs to have the same ordering as the corollary array
+    // in getFramebuffer.
+    VkAttachmentDescription attachments[MAX_ATTACHMENTS] = {};
 
     // We support 2 subpasses, which means we need to supply 1 dependency struct.
     VkSubpassDependency dependencies[1] = {{
@@ -302,24 +428,46 @@ VkRenderPass VulkanFboCache::getRenderPass(RenderPassKey config) noexcept {
     if (hasDepth) {
         bool clear = any(config.clear & TargetBufferFlags::DEPTH);
         bool discard = any(config.discardStart & TargetBufferFlags::DEPTH);
+        bool discardEnd = any(config.discardEnd & TargetBufferFlags::DEPTH);
         depthAttachmentRef.layout = config.depthLayout;
         depthAttachmentRef.attachment = attachmentIndex;
         attachments[attachmentIndex++] = {
             .format = config.depthFormat,
             .samples = (VkSampleCountFlagBits) config.samples,
             .loadOp = clear ? kClear : (discard ? kDontCare : kKeep),
-            .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+            .storeOp = discardEnd ? kDisableStore : kEnableStore,
             .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
             .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
             .initialLayout = config.depthLayout,
             .finalLayout = config.depthLayout
         };
     }
+
+    // Populate the Depth Resolve Attachment. The depth is resolved on tile at the end of the last
+    // subpass, rather than by a vkCmdResolveImage reading the MSAA depth back from memory.
+    uint32_t depthResolveIndex = VK_ATTACHMENT_UNUSED;
+    if (hasDepth && config.needsDepthResolve) {
+        assert_invariant(mContext.depthResolveSupported && config.samples > 1);
+        depthResolveIndex = attachmentIndex;
+        attachments[attachmentIndex++] = {
+            .format = config.depthFormat,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp = kDontCare,
+            .storeOp = kEnableStore,
+            .stencilLoadOp = kDontCare,
+            .stencilStoreOp = kDisableStore,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout = config.depthLayout
+        };
+    }
     renderPassInfo.attachmentCount = attachmentIndex;
 
     // Finally, create the VkRenderPass.
     VkRenderPass renderPass;
-    VkResult error = vkCreateRenderPass(mContext.device, &renderPassInfo, VKALLOC, &renderPass);
+    VkResult error = depthResolveIndex == VK_ATTACHMENT_UNUSED ?
+            vkCreateRenderPass(mContext.device, &renderPassInfo, VKALLOC, &renderPass) :
+            createRenderPassWithDepthResolve(mContext.device, renderPassInfo, depthResolveIndex,
+                    &renderPass);
     ASSERT_POSTCONDITION(!error, "Unable to create render pass.");
     mRenderPassCache[config] = {renderPass, mCurrentTime};
 
@@ -344,10 +492,31 @@ void VulkanFboCache::reset() noexcept {
         vkDestroyRenderPass(mContext.device, pair.second.handle, VKALLOC);
     }
     mRenderPassCache.clear();
+    mRenderPassRefCount.clear();
+}
+
+VulkanFboCache::Statistics VulkanFboCache::getStatistics() const noexcept {
+    Statistics stats = mStatistics;
+    stats.framebufferCount = uint32_t(mFramebufferCache.size());
+    stats.renderPassCount = uint32_t(mRenderPassCache.size());
+    return stats;
+}
+
+void VulkanFboCache::logStatistics() const noexcept {
+    const Statistics stats = getStatistics();
+    utils::slog.d << "Framebuffers: "
+            << stats.framebufferHits << " hits, "
+            << stats.framebufferMisses << " misses, "
+            << stats.framebufferCount << " alive. Render passes: "
+            << stats.renderPassHits << " hits, "
+            << stats.renderPassMisses << " misses, "
+            << stats.renderPassCount << " alive."
+            << utils::io::endl;
 }
 
-// Frees up old framebuffers and render passes, then nulls out their key.  Doesn't bother removing
-// the actual map entry since it is fairly small.
+// Frees up old framebuffers and render passes and removes them from the cache. Framebuffers are
+// collected first, so that render passes which are no longer referenced can go in the same frame.
+// Removing the entries matters with dynamic resolution, where each new size creates new keys.
 void VulkanFboCache::gc() noexcept {
     // If this is one of the first few frames, return early to avoid wrapping unsigned integers.
     if (++mCurrentTime <= TIME_BEFORE_EVICTION) {
@@ -355,19 +524,31 @@ void VulkanFboCache::gc() noexcept {
     }
     const uint32_t evictTime = mCurrentTime - TIME_BEFORE_EVICTION;
 
-    for (auto iter = mFramebufferCache.begin(); iter != mFramebufferCache.end(); ++iter) {
+    // Due to robin_map restrictions, we cannot use auto or a range-based loop.
+    for (decltype(mFramebufferCache)::const_iterator iter = mFramebufferCache.begin();
+            iter != mFramebufferCache.end();) {
         const FboVal fbo = iter->second;
-        if (fbo.timestamp < evictTime && fbo.handle) {
+        if (fbo.timestamp < evictTime) {
             mRenderPassRefCount[iter->first.renderPass]--;
             vkDestroyFramebuffer(mContext.device, fbo.handle, VKALLOC);
-            iter.value().handle = VK_NULL_HANDLE;
+            iter = mFramebufferCache.erase(iter);
+        } else {
+            ++iter;
         }
     }
-    for (auto iter = mRenderPassCache.begin(); iter != mRenderPassCache.end(); ++iter) {
+    for (decltype(mRenderPassCache)::const_iterator iter = mRenderPassCache.begin();
+            iter != mRenderPassCache.end();) {
         const VkRenderPass handle = iter->second.handle;
-        if (iter->second.timestamp < evictTime && handle && mRenderPassRefCount[handle] == 0) {
+        auto refCount = mRenderPassRefCount.find(handle);
+        const bool unused = refCount == mRenderPassRefCount.end() || refCount->second == 0;
+        if (iter->second.timestamp < evictTime && unused) {
             vkDestroyRenderPass(mContext.device, handle, VKALLOC);
-            iter.value().handle = VK_NULL_HANDLE;
+            if (refCount != mRenderPassRefCount.end()) {
+                mRenderPassRefCount.erase(refCount);
+            }
+            iter = mRenderPassCache.erase(iter);
+        } else {
+            ++iter;
         }
     }
 }
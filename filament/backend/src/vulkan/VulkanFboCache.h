@@ -34,6 +34,10 @@ namespace backend {
 // this is NOT a cache of actual offscreen rendering surfaces. The Vulkan objects that it manages
 // do not consume any GPU memory.
 //
+// Render passes are keyed only on formats, layouts and load / store behavior, never on the size
+// of the attachments. Therefore a single VkRenderPass is shared by all the framebuffers that only
+// differ in size, e.g. when dynamic resolution changes the size of the render targets.
+//
 class VulkanFboCache {
 public:
     // RenderPassKey is a small POD representing the immutable state that is used to construct
@@ -49,7 +53,8 @@ public:
         uint8_t samples; // 1 byte
         uint8_t needsResolveMask; // 1 byte
         uint8_t subpassMask; // 1 bytes
-        uint16_t padding; // 2 bytes
+        uint8_t needsDepthResolve; // 1 byte, requires VK_KHR_depth_stencil_resolve
+        uint8_t padding; // 1 byte
     };
     struct RenderPassVal {
         VkRenderPass handle;
@@ -58,7 +63,7 @@ public:
     static_assert(sizeof(TargetBufferFlags) == 1, "TargetBufferFlags has unexpected size.");
     static_assert(sizeof(VkFormat) == 4, "VkFormat has unexpected size.");
     static_assert(sizeof(RenderPassKey) == 48, "RenderPassKey has unexpected size.");
-    using RenderPassHash = utils::hash::MurmurHashFn<RenderPassKey>;
+    using RenderPassHash = utils::hash::WyHashFn<RenderPassKey>;
     struct RenderPassEq {
         bool operator()(const RenderPassKey& k1, const RenderPassKey& k2) const;
     };
@@ -75,6 +80,7 @@ public:
         VkImageView color[MRT::TARGET_COUNT]; // 32 bytes
         VkImageView resolve[MRT::TARGET_COUNT]; // 32 bytes
         VkImageView depth; // 8 bytes
+        VkImageView depthResolve; // 8 bytes
     };
     struct FboVal {
         VkFramebuffer handle;
@@ -82,12 +88,22 @@ public:
     };
     static_assert(sizeof(VkRenderPass) == 8, "VkRenderPass has unexpected size.");
     static_assert(sizeof(VkImageView) == 8, "VkImageView has unexpected size.");
-    static_assert(sizeof(FboKey) == 88, "FboKey has unexpected size.");
-    using FboKeyHashFn = utils::hash::MurmurHashFn<FboKey>;
+    static_assert(sizeof(FboKey) == 96, "FboKey has unexpected size.");
+    using FboKeyHashFn = utils::hash::WyHashFn<FboKey>;
     struct FboKeyEqualFn {
         bool operator()(const FboKey& k1, const FboKey& k2) const;
     };
 
+    // Hit / miss counters, useful to check how often render passes and framebuffers are created.
+    struct Statistics {
+        uint32_t framebufferHits;
+        uint32_t framebufferMisses;
+        uint32_t renderPassHits;
+        uint32_t renderPassMisses;
+        uint32_t framebufferCount;  // number of live VkFramebuffer
+        uint32_t renderPassCount;   // number of live VkRenderPass
+    };
+
     explicit VulkanFboCache(VulkanContext&);
     ~VulkanFboCache();
 
@@ -103,12 +119,19 @@ public:
     // Frees all Vulkan objects. Call this during shutdown before the device is destroyed.
     void reset() noexcept;
 
+    // Returns the hit / miss counters accumulated since the cache was created.
+    Statistics getStatistics() const noexcept;
+
+    // Logs the statistics above.
+    void logStatistics() const noexcept;
+
 private:
     VulkanContext& mContext;
     tsl::robin_map<FboKey, FboVal, FboKeyHashFn, FboKeyEqualFn> mFramebufferCache;
     tsl::robin_map<RenderPassKey, RenderPassVal, RenderPassHash, RenderPassEq> mRenderPassCache;
     tsl::robin_map<VkRenderPass, uint32_t> mRenderPassRefCount;
     uint32_t mCurrentTime = 0;
+    Statistics mStatistics = {};
 
     // If any VkRenderPass or VkFramebuffer is unused for more than TIME_BEFORE_EVICTION frames, it
     // is evicted from the cache. Ideally this constant is greater than or equal to the number of
@@ -50,13 +50,12 @@ static void clampToFramebuffer(VkRect2D* rect, uint32_t fbWidth, uint32_t fbHeig
 VulkanProgram::VulkanProgram(VulkanContext& context, const Program& builder) noexcept :
         HwProgram(builder.getName()), context(context) {
     auto const& blobs = builder.getShadersSource();
-    VkShaderModule* modules[2] = { &bundle.vertex, &bundle.fragment };
-    bool missing = false;
+    VkShaderModule* modules[Program::SHADER_TYPE_COUNT] = {
+            &bundle.vertex, &bundle.fragment, &bundle.compute };
     for (size_t i = 0; i < Program::SHADER_TYPE_COUNT; i++) {
         const auto& blob = blobs[i];
         VkShaderModule* module = modules[i];
         if (blob.empty()) {
-            missing = true;
             continue;
         }
         VkShaderModuleCreateInfo moduleInfo = {};
@@ -68,8 +67,9 @@ VulkanProgram::VulkanProgram(VulkanContext& context, const Program& builder) noe
     }
 
     // Output a warning because it's okay to encounter empty blobs, but it's not okay to use
-    // this program handle in a draw call.
-    if (missing) {
+    // this program handle in a draw call. Compute programs have no vertex or fragment shader.
+    const bool missing = !bundle.vertex || !bundle.fragment;
+    if (missing && !bundle.compute) {
         utils::slog.w << "Missing SPIR-V shader: " << builder.getName().c_str() << utils::io::endl;
         return;
     }
@@ -80,7 +80,8 @@ VulkanProgram::VulkanProgram(VulkanContext& context, const Program& builder) noe
     utils::slog.d << "Created VulkanProgram " << builder.getName().c_str()
                 << ", variant = (" << utils::io::hex
                 << (int) builder.getVariant() << utils::io::dec << "), "
-                << "shaders = (" << bundle.vertex << ", " << bundle.fragment << ")"
+                << "shaders = (" << bundle.vertex << ", " << bundle.fragment << ", "
+                << bundle.compute << ")"
                 << utils::io::endl;
 #endif
 }
@@ -88,6 +89,8 @@ VulkanProgram::VulkanProgram(VulkanContext& context, const Program& builder) noe
 VulkanProgram::~VulkanProgram() {
     vkDestroyShaderModule(context.device, bundle.vertex, VKALLOC);
     vkDestroyShaderModule(context.device, bundle.fragment, VKALLOC);
+    vkDestroyShaderModule(context.device, bundle.compute, VKALLOC);
+    vkDestroyPipeline(context.device, computePipeline, VKALLOC);
 }
 
 static VulkanAttachment createAttachment(VulkanAttachment spec) {
@@ -151,7 +154,9 @@ VulkanRenderTarget::VulkanRenderTarget(VulkanContext& context, uint32_t width, u
         VulkanTexture* texture = spec.texture;
         if (texture && texture->samples == 1) {
             VulkanTexture* msTexture = new VulkanTexture(context, texture->target, level,
-                    texture->format, samples, width, height, depth, texture->usage, stagePool);
+                    texture->format, samples, width, height, depth,
+                    texture->usage & TextureUsage::COLOR_ATTACHMENT, stagePool, {},
+                    /* transient = */ true);
             mMsaaAttachments[index] = createAttachment({ .texture = msTexture });
             mMsaaAttachments[index].view = msTexture->getImageView(0, 0, VK_IMAGE_ASPECT_COLOR_BIT);
         }
@@ -172,7 +177,9 @@ VulkanRenderTarget::VulkanRenderTarget(VulkanContext& context, uint32_t width, u
 
     // Create sidecar MSAA texture for the depth attachment.
     VulkanTexture* msTexture = new VulkanTexture(context, depthTexture->target, level,
-            depthTexture->format, samples, width, height, depth, depthTexture->usage, stagePool);
+            depthTexture->format, samples, width, height, depth,
+            depthTexture->usage & TextureUsage::DEPTH_ATTACHMENT, stagePool, {},
+            /* transient = */ true);
     mMsaaDepthAttachment = createAttachment({
         .texture = msTexture,
         .level = depthSpec.level,
@@ -409,7 +416,33 @@ VulkanVertexBuffer::VulkanVertexBuffer(VulkanContext& context, VulkanStagePool&
 
 VulkanUniformBuffer::VulkanUniformBuffer(VulkanContext& context, VulkanStagePool& stagePool,
         VulkanDisposer& disposer, uint32_t numBytes, backend::BufferUsage usage)
-        : mContext(context), mStagePool(stagePool), mDisposer(disposer) {
+        : mContext(context), mStagePool(stagePool), mDisposer(disposer), mSize(numBytes) {
+    if (usage == BufferUsage::STREAM) {
+        // Create a ring of slots in host-visible memory that stays mapped for its whole lifetime.
+        const VkDeviceSize alignment =
+                mContext.physicalDeviceProperties.limits.minUniformBufferOffsetAlignment;
+        mSlotStride = uint32_t((numBytes + alignment - 1) & ~(alignment - 1));
+        VkBufferCreateInfo bufferInfo {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size = VkDeviceSize(mSlotStride) * RING_SIZE,
+            .usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        };
+        VmaAllocationCreateInfo allocInfo {
+            .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            .usage = VMA_MEMORY_USAGE_CPU_TO_GPU
+        };
+        VmaAllocationInfo info;
+        vmaCreateBuffer(mContext.allocator, &bufferInfo, &allocInfo, &mGpuBuffer, &mGpuMemory,
+                &info);
+        mMappedData = info.pMappedData;
+        if (mMappedData) {
+            return;
+        }
+        // This should never happen, but handle it by falling back to the staging path.
+        vmaDestroyBuffer(mContext.allocator, mGpuBuffer, mGpuMemory);
+        mSlotStride = 0;
+    }
+
     // Create the VkBuffer.
     VkBufferCreateInfo bufferInfo {
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -422,17 +455,63 @@ VulkanUniformBuffer::VulkanUniformBuffer(VulkanContext& context, VulkanStagePool
     vmaCreateBuffer(mContext.allocator, &bufferInfo, &allocInfo, &mGpuBuffer, &mGpuMemory, nullptr);
 }
 
-void VulkanUniformBuffer::loadFromCpu(const void* cpuData, uint32_t numBytes) {
-    VulkanStage const* stage = mStagePool.acquireStage(numBytes);
-    void* mapped;
-    vmaMapMemory(mContext.allocator, stage->memory, &mapped);
-    memcpy(mapped, cpuData, numBytes);
-    vmaUnmapMemory(mContext.allocator, stage->memory);
-    vmaFlushAllocation(mContext.allocator, stage->memory, 0, numBytes);
+void VulkanUniformBuffer::markUsed(VulkanCommandBuffer const& commands) {
+    if (mMappedData) {
+        mSlotFences[mCurrentSlot] = commands.fence;
+    }
+}
+
+void VulkanUniformBuffer::loadFromCpu(const void* cpuData, uint32_t numBytes,
+        uint32_t byteOffset) {
+    assert_invariant(byteOffset + numBytes <= mSize);
+    if (!mMappedData) {
+        copyFromStage(cpuData, numBytes, byteOffset);
+        return;
+    }
+
+    // A partial load must carry over the rest of the buffer from the previous slot.
+    const bool partial = byteOffset > 0 || numBytes < mSize;
+    const uint32_t previousSlot = mCurrentSlot;
+    mCurrentSlot = (mCurrentSlot + 1) % RING_SIZE;
+    std::shared_ptr<VulkanCmdFence> fence = std::move(mSlotFences[mCurrentSlot]);
+    VulkanCommandBuffer const* commands = mContext.currentCommands;
+    if (fence && commands && fence == commands->fence) {
+        // The slot is read by the commands being recorded, i.e. the buffer was loaded more than
+        // RING_SIZE times in this frame. The copy must be ordered with those commands.
+        if (partial) {
+            // only the previous slot has the rest of the content, update it instead
+            mSlotFences[mCurrentSlot] = std::move(fence);
+            mCurrentSlot = previousSlot;
+        }
+        copyFromStage(cpuData, numBytes, byteOffset);
+        return;
+    }
+    if (fence && vkGetFenceStatus(mContext.device, fence->fence) != VK_SUCCESS) {
+        // The slot was read by a previous frame, which is normally finished by now.
+        vkWaitForFences(mContext.device, 1, &fence->fence, VK_TRUE, UINT64_MAX);
+    }
+    uint8_t* const slot = static_cast<uint8_t*>(mMappedData) + getOffset();
+    if (partial) {
+        memcpy(slot, static_cast<uint8_t*>(mMappedData) + previousSlot * mSlotStride, mSize);
+    }
+    memcpy(slot + byteOffset, cpuData, numBytes);
+    vmaFlushAllocation(mContext.allocator, mGpuMemory, getOffset(), partial ? mSize : numBytes);
+}
 
-    auto copyToDevice = [this, numBytes, stage] (VulkanCommandBuffer& commands) {
-        VkBufferCopy region { .size = numBytes };
-        vkCmdCopyBuffer(commands.cmdbuffer, stage->buffer, mGpuBuffer, 1, &region);
+void VulkanUniformBuffer::copyFromStage(const void* cpuData, uint32_t numBytes,
+        uint32_t byteOffset) {
+    const VkDeviceSize dstOffset = getOffset() + byteOffset;
+    auto copyToDevice = [this, cpuData, numBytes, dstOffset] (VulkanCommandBuffer& commands) {
+        VulkanStageRange const stage = mStagePool.acquireRange(numBytes, commands);
+        memcpy(stage.mapped, cpuData, numBytes);
+        vmaFlushAllocation(mContext.allocator, stage.memory, stage.offset, numBytes);
+
+        VkBufferCopy region {
+            .srcOffset = stage.offset,
+            .dstOffset = dstOffset,
+            .size = numBytes
+        };
+        vkCmdCopyBuffer(commands.cmdbuffer, stage.buffer, mGpuBuffer, 1, &region);
         mDisposer.acquire(this, commands.resources);
 
         // Ensure that the copy finishes before the next draw call.
@@ -447,8 +526,6 @@ void VulkanUniformBuffer::loadFromCpu(const void* cpuData, uint32_t numBytes) {
         };
         vkCmdPipelineBarrier(commands.cmdbuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
                 VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
-
-        mStagePool.releaseStage(stage, commands);
     };
 
     // If inside beginFrame / endFrame, use the swap context, otherwise use the work cmdbuffer.
@@ -467,7 +544,8 @@ VulkanUniformBuffer::~VulkanUniformBuffer() {
 
 VulkanTexture::VulkanTexture(VulkanContext& context, SamplerType target, uint8_t levels,
         TextureFormat tformat, uint8_t samples, uint32_t w, uint32_t h, uint32_t depth,
-        TextureUsage usage, VulkanStagePool& stagePool, VkComponentMapping swizzle) :
+        TextureUsage usage, VulkanStagePool& stagePool, VkComponentMapping swizzle,
+        bool transient) :
         HwTexture(target, levels, samples, w, h, depth, tformat, usage),
 
         // Vulkan does not support 24-bit depth, use the official fallback format.
@@ -506,8 +584,12 @@ VulkanTexture::VulkanTexture(VulkanContext& context, SamplerType target, uint8_t
 
     // Filament expects blit() to work with any texture, so we almost always set these usage flags.
     // TODO: investigate performance implications of setting these flags.
-    const VkImageUsageFlags blittable = VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+    // Transient attachments can't have any other usage.
+    const VkImageUsageFlags blittable = transient ? 0 : VK_IMAGE_USAGE_TRANSFER_DST_BIT |
             VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    if (transient) {
+        imageInfo.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    }
 
     if (any(usage & TextureUsage::SAMPLEABLE)) {
 
@@ -553,18 +635,23 @@ VulkanTexture::VulkanTexture(VulkanContext& context, SamplerType target, uint8_t
     }
     ASSERT_POSTCONDITION(!error, "Unable to create image.");
 
-    // Allocate memory for the VkImage and bind it.
-    VkMemoryRequirements memReqs = {};
-    vkGetImageMemoryRequirements(context.device, mTextureImage, &memReqs);
-    VkMemoryAllocateInfo allocInfo = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = memReqs.size,
-        .memoryTypeIndex = selectMemoryType(context, memReqs.memoryTypeBits,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
-    };
-    error = vkAllocateMemory(context.device, &allocInfo, nullptr, &mTextureImageMemory);
+    // Sub-allocate memory for the VkImage from VMA's device-local blocks and bind it. This keeps
+    // the number of VkDeviceMemory objects low, some drivers have a small maxMemoryAllocationCount.
+    VmaAllocationCreateInfo allocInfo { .usage = transient ?
+            VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED : VMA_MEMORY_USAGE_GPU_ONLY };
+    error = vmaAllocateMemoryForImage(context.allocator, mTextureImage, &allocInfo,
+            &mTextureImageMemory, nullptr);
+    if (error && transient) {
+        // desktop GPUs usually don't have lazily allocated memory
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+        error = vmaAllocateMemoryForImage(context.allocator, mTextureImage, &allocInfo,
+                &mTextureImageMemory, nullptr);
+    }
+    if (error) {
+        logMemoryBudget(context);
+    }
     ASSERT_POSTCONDITION(!error, "Unable to allocate image memory.");
-    error = vkBindImageMemory(context.device, mTextureImage, mTextureImageMemory, 0);
+    error = vmaBindImageMemory(context.allocator, mTextureImageMemory, mTextureImage);
     ASSERT_POSTCONDITION(!error, "Unable to bind image.");
 
     mAspect = any(usage & TextureUsage::DEPTH_ATTACHMENT) ? VK_IMAGE_ASPECT_DEPTH_BIT :
@@ -598,8 +685,9 @@ VulkanTexture::VulkanTexture(VulkanContext& context, SamplerType target, uint8_t
             // If this is a SAMPLER_2D_ARRAY texture, then the depth argument stores the number of
             // texture layers.
             const uint32_t layers = target == SamplerType::SAMPLER_2D_ARRAY ? depth : 1;
-            VulkanTexture::transitionImageLayout(commands.cmdbuffer, mTextureImage,
-                    VK_IMAGE_LAYOUT_UNDEFINED, getTextureLayout(usage), 0, layers, levels, mAspect);
+            mContext.barriers.transition(commands.cmdbuffer, mTextureImage,
+                    VK_IMAGE_LAYOUT_UNDEFINED, getTextureLayout(usage),
+                    { mAspect, 0, levels, 0, layers });
         };
         if (mContext.currentCommands) {
             transition(*mContext.currentCommands);
@@ -612,8 +700,9 @@ VulkanTexture::VulkanTexture(VulkanContext& context, SamplerType target, uint8_t
 }
 
 VulkanTexture::~VulkanTexture() {
+    mContext.barriers.forget(mTextureImage);
     vkDestroyImage(mContext.device, mTextureImage, VKALLOC);
-    vkFreeMemory(mContext.device, mTextureImageMemory, VKALLOC);
+    vmaFreeMemory(mContext.allocator, mTextureImageMemory);
     for (auto entry : mCachedImageViews) {
         vkDestroyImageView(mContext.device, entry.second, VKALLOC);
     }
@@ -656,12 +745,17 @@ void VulkanTexture::update3DImage(const PixelBufferDescriptor& data, uint32_t wi
 
     // Create a copy-to-device functor.
     auto copyToDevice = [this, stage, width, height, depth, miplevel] (VulkanCommandBuffer& commands) {
-        transitionImageLayout(commands.cmdbuffer, mTextureImage, VK_IMAGE_LAYOUT_UNDEFINED,
-                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, miplevel, 1, 1, mAspect);
+        const VkImageSubresourceRange range = { mAspect, uint32_t(miplevel), 1, 0, 1 };
+        mContext.barriers.transition(commands.cmdbuffer, mTextureImage, VK_IMAGE_LAYOUT_UNDEFINED,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, range);
+        mContext.barriers.flush();
         copyBufferToImage(commands.cmdbuffer, stage->buffer, mTextureImage, width, height, depth,
                 nullptr, miplevel);
-        transitionImageLayout(commands.cmdbuffer, mTextureImage,VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                getTextureLayout(usage), miplevel, 1, 1, mAspect);
+
+        // The transition to the final layout is deferred, so that it shares its barrier with the
+        // next upload.
+        mContext.barriers.transition(commands.cmdbuffer, mTextureImage,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, getTextureLayout(usage), range);
 
         mStagePool.releaseStage(stage, commands);
     };
@@ -700,13 +794,14 @@ void VulkanTexture::updateCubeImage(const PixelBufferDescriptor& data,
     auto copyToDevice = [this, faceOffsets, stage, miplevel] (VulkanCommandBuffer& commands) {
         uint32_t width = std::max(1u, this->width >> miplevel);
         uint32_t height = std::max(1u, this->height >> miplevel);
-        transitionImageLayout(commands.cmdbuffer, mTextureImage, VK_IMAGE_LAYOUT_UNDEFINED,
-                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, miplevel, 6, 1, mAspect);
+        const VkImageSubresourceRange range = { mAspect, uint32_t(miplevel), 1, 0, 6 };
+        mContext.barriers.transition(commands.cmdbuffer, mTextureImage, VK_IMAGE_LAYOUT_UNDEFINED,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, range);
+        mContext.barriers.flush();
         copyBufferToImage(commands.cmdbuffer, stage->buffer, mTextureImage, width, height, 1,
                 &faceOffsets, miplevel);
-        transitionImageLayout(commands.cmdbuffer, mTextureImage,
-                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, getTextureLayout(usage), miplevel, 6,
-                1, mAspect);
+        mContext.barriers.transition(commands.cmdbuffer, mTextureImage,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, getTextureLayout(usage), range);
 
         mStagePool.releaseStage(stage, commands);
     };
@@ -749,66 +844,6 @@ VkImageView VulkanTexture::getImageView(VkImageSubresourceRange range) {
     return imageView;
 }
 
-// TODO: replace the last 4 args with VkImageSubresourceRange
-// TODO: replace this function with a flexible thin wrapper over image barrier creation
-void VulkanTexture::transitionImageLayout(VkCommandBuffer cmd, VkImage image,
-        VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t miplevel,
-        uint32_t layerCount, uint32_t levelCount, VkImageAspectFlags aspect) {
-    if (oldLayout == newLayout) {
-        return;
-    }
-    VkImageMemoryBarrier barrier = {};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = oldLayout;
-    barrier.newLayout = newLayout;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = image;
-    barrier.subresourceRange.aspectMask = aspect;
-    barrier.subresourceRange.baseMipLevel = miplevel;
-    barrier.subresourceRange.levelCount = levelCount;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = layerCount;
-    VkPipelineStageFlags sourceStage;
-    VkPipelineStageFlags destinationStage;
-    switch (newLayout) {
-        case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            break;
-        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            break;
-        case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
-        case VK_IMAGE_LAYOUT_GENERAL:
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-            sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-            break;
-
-        // We support PRESENT as a target layout to allow blitting from the swap chain.
-        // See also makeSwapChainPresentable().
-        case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
-        case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            barrier.dstAccessMask = 0;
-            sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            destinationStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            break;
-
-        default:
-           PANIC_POSTCONDITION("Unsupported layout transition.");
-    }
-    vkCmdPipelineBarrier(cmd, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1,
-            &barrier);
-}
-
 void VulkanTexture::copyBufferToImage(VkCommandBuffer cmd, VkBuffer buffer, VkImage image,
         uint32_t width, uint32_t height, uint32_t depth, FaceOffsets const* faceOffsets, uint32_t miplevel) {
     VkExtent3D extent { width, height, depth };
@@ -860,7 +895,7 @@ void VulkanRenderPrimitive::setBuffers(VulkanVertexBuffer* vertexBuffer,
 
 VulkanTimerQuery::VulkanTimerQuery(VulkanContext& context) : mContext(context) {
     std::unique_lock<utils::Mutex> lock(context.timestamps.mutex);
-    utils::bitset32& bitset = context.timestamps.used;
+    utils::bitset256& bitset = context.timestamps.used;
     const size_t maxTimers = bitset.size();
     assert_invariant(bitset.count() < maxTimers);
     for (size_t timerIndex = 0; timerIndex < maxTimers; ++timerIndex) {
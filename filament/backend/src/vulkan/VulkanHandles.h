@@ -29,8 +29,10 @@ struct VulkanProgram : public HwProgram {
     VulkanProgram(VulkanContext& context, const Program& builder) noexcept;
     ~VulkanProgram();
     VulkanContext& context;
-    VulkanBinder::ProgramBundle bundle;
+    VulkanBinder::ProgramBundle bundle = {};
     Program::SamplerGroupInfo samplerGroupInfo;
+    // Compute programs own their pipeline, which is created upon the first dispatch.
+    VkPipeline computePipeline = VK_NULL_HANDLE;
 };
 
 // The render target bundles together a set of attachments, each of which can have one of the
@@ -64,6 +66,11 @@ struct VulkanRenderTarget : private HwRenderTarget {
     uint8_t getSamples() const { return mSamples; }
     bool hasDepth() const { return mDepth.format != VK_FORMAT_UNDEFINED; }
 
+#if !defined(NDEBUG) && UTILS_HAS_RTTI
+    // the handle allocator tags every handle with its type in debug builds
+    using HwRenderTarget::typeId;
+#endif
+
 private:
     VulkanAttachment mColor[MRT::TARGET_COUNT] = {};
     VulkanAttachment mDepth = {};
@@ -99,35 +106,62 @@ struct VulkanIndexBuffer : public HwIndexBuffer {
 
 struct VulkanBufferObject : public HwBufferObject {
     VulkanBufferObject(VulkanContext& context, VulkanStagePool& stagePool, VulkanDisposer& disposer,
-            uint32_t byteCount) : HwBufferObject(byteCount),
+            uint32_t byteCount, BufferObjectBinding bindingType) : HwBufferObject(byteCount),
             buffer(new VulkanBuffer(context, stagePool, disposer, this,
-                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, byteCount)) {}
+                    getBufferUsage(bindingType), byteCount)) {}
     const std::unique_ptr<VulkanBuffer> buffer;
 };
 
+// STREAM uniform buffers are a persistently mapped ring of RING_SIZE slots in host-visible memory.
+// Each load writes directly into the next slot, instead of going through a staging buffer and a
+// GPU copy. Other uniform buffers live in device-local memory.
 struct VulkanUniformBuffer : public HwUniformBuffer {
+    static constexpr uint32_t RING_SIZE = 3;
+
     VulkanUniformBuffer(VulkanContext& context, VulkanStagePool& stagePool,
             VulkanDisposer& disposer, uint32_t numBytes, backend::BufferUsage usage);
     ~VulkanUniformBuffer();
-    void loadFromCpu(const void* cpuData, uint32_t numBytes);
+    // Loads numBytes at byteOffset, the rest of the buffer keeps its content.
+    void loadFromCpu(const void* cpuData, uint32_t numBytes, uint32_t byteOffset = 0);
     VkBuffer getGpuBuffer() const { return mGpuBuffer; }
 
+    // Offset and size of the region of the buffer that draw calls should currently read from.
+    VkDeviceSize getOffset() const { return mCurrentSlot * mSlotStride; }
+    VkDeviceSize getSize() const { return mMappedData ? mSize : VK_WHOLE_SIZE; }
+
+    // Records that the given command buffer reads from the current slot.
+    void markUsed(VulkanCommandBuffer const& commands);
+
 private:
+    void copyFromStage(const void* cpuData, uint32_t numBytes, uint32_t byteOffset);
+
     VulkanContext& mContext;
     VulkanStagePool& mStagePool;
     VulkanDisposer& mDisposer;
     VkBuffer mGpuBuffer;
     VmaAllocation mGpuMemory;
+    const uint32_t mSize;
+    uint32_t mSlotStride = 0;
+    uint32_t mCurrentSlot = 0;
+    void* mMappedData = nullptr;
+    std::shared_ptr<VulkanCmdFence> mSlotFences[RING_SIZE];
 };
 
 struct VulkanSamplerGroup : public HwSamplerGroup {
     VulkanSamplerGroup(VulkanContext& context, uint32_t count) : HwSamplerGroup(count) {}
+    // The sampler of each slot, looked up when first used after the slot's parameters changed,
+    // VK_NULL_HANDLE until then. This avoids a lookup in the sampler cache per draw call.
+    VkSampler samplers[MAX_SAMPLER_COUNT] = {};
 };
 
 struct VulkanTexture : public HwTexture {
+    // A transient texture can only be used as an attachment whose content doesn't outlive the
+    // render pass, like the MSAA sidecars of a render target. It's backed by lazily allocated
+    // memory if the device has some, which tile-based GPUs never need to commit.
     VulkanTexture(VulkanContext& context, SamplerType target, uint8_t levels,
             TextureFormat format, uint8_t samples, uint32_t w, uint32_t h, uint32_t depth,
-            TextureUsage usage, VulkanStagePool& stagePool, VkComponentMapping swizzle = {});
+            TextureUsage usage, VulkanStagePool& stagePool, VkComponentMapping swizzle = {},
+            bool transient = false);
     ~VulkanTexture();
     void update2DImage(const PixelBufferDescriptor& data, uint32_t width, uint32_t height,
             int miplevel);
@@ -159,12 +193,6 @@ struct VulkanTexture : public HwTexture {
     VkFormat getVkFormat() const { return mVkFormat; }
     VkImage getVkImage() const { return mTextureImage; }
 
-    // Issues a barrier that transforms the layout of the image, e.g. from a CPU-writeable
-    // layout to a GPU-readable layout.
-    static void transitionImageLayout(VkCommandBuffer cmdbuffer, VkImage image,
-            VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t miplevel,
-            uint32_t layers, uint32_t levels, VkImageAspectFlags aspect);
-
 private:
     // Issues a copy from a VkBuffer to a specified miplevel in a VkImage. The given width and
     // height define a subregion within the miplevel.
@@ -176,7 +204,7 @@ private:
     const VkComponentMapping mSwizzle;
     VkImageViewType mViewType;
     VkImage mTextureImage = VK_NULL_HANDLE;
-    VkDeviceMemory mTextureImageMemory = VK_NULL_HANDLE;
+    VmaAllocation mTextureImageMemory = VK_NULL_HANDLE;
     VkImageSubresourceRange mPrimaryViewRange;
     std::map<VkImageSubresourceRange, VkImageView> mCachedImageViews;
     VkImageAspectFlags mAspect;
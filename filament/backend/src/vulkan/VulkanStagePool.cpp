@@ -35,6 +35,7 @@ VulkanStage const* VulkanStagePool::acquireStage(uint32_t numBytes) {
         .memory = VK_NULL_HANDLE,
         .buffer = VK_NULL_HANDLE,
         .capacity = numBytes,
+        .mapped = nullptr,
         .lastAccessed = mCurrentFrame,
     });
 
@@ -46,14 +47,56 @@ VulkanStage const* VulkanStagePool::acquireStage(uint32_t numBytes) {
         .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
     };
     VmaAllocationCreateInfo allocInfo {
+        .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
         .usage = VMA_MEMORY_USAGE_CPU_ONLY
     };
+    VmaAllocationInfo allocationInfo;
     vmaCreateBuffer(mContext.allocator, &bufferInfo, &allocInfo, &stage->buffer, &stage->memory,
-            nullptr);
+            &allocationInfo);
+    stage->mapped = allocationInfo.pMappedData;
+    mMemoryTracker.allocate(MemoryTracker::Category::STAGING, numBytes);
 
     return stage;
 }
 
+VulkanStageRange VulkanStagePool::acquireRange(uint32_t numBytes, VulkanCommandBuffer& cmd) {
+    // Large uploads would waste most of a block, so they get a stage of their own.
+    if (numBytes > BLOCK_SIZE / 4) {
+        VulkanStage const* stage = acquireStage(numBytes);
+        releaseStage(stage, cmd);
+        return { stage->memory, stage->buffer, 0, stage->mapped };
+    }
+
+    uint32_t offset = (mBlockOffset + RANGE_ALIGNMENT - 1) & ~(RANGE_ALIGNMENT - 1);
+    if (!mCurrentBlock || offset + numBytes > mCurrentBlock->capacity) {
+        retireBlock();
+        VulkanStage const* block = acquireStage(BLOCK_SIZE);
+        mDisposer.createDisposable(block, [block, this]() { this->releaseStage(block); });
+        mCurrentBlock = block;
+        offset = 0;
+    }
+    mBlockOffset = offset + numBytes;
+
+    // Every command buffer that copies from the block holds a reference on it.
+    mDisposer.acquire(mCurrentBlock, cmd.resources);
+    return {
+        mCurrentBlock->memory,
+        mCurrentBlock->buffer,
+        offset,
+        static_cast<uint8_t*>(mCurrentBlock->mapped) + offset
+    };
+}
+
+// Stops sub-allocating from the current block. It goes back to the pool when the last command
+// buffer that refers to it has finished executing.
+void VulkanStagePool::retireBlock() noexcept {
+    if (mCurrentBlock) {
+        mDisposer.removeReference(mCurrentBlock);
+        mCurrentBlock = nullptr;
+        mBlockOffset = 0;
+    }
+}
+
 void VulkanStagePool::releaseStage(VulkanStage const* stage) noexcept {
     auto iter = mUsedStages.find(stage);
     if (iter == mUsedStages.end()) {
@@ -74,6 +117,9 @@ void VulkanStagePool::releaseStage(VulkanStage const* stage, VulkanCommandBuffer
 }
 
 void VulkanStagePool::gc() noexcept {
+    // Start each frame with a fresh block, so that blocks cycle through the pool.
+    retireBlock();
+
     // If this is one of the first few frames, return early to avoid wrapping unsigned integers.
     if (++mCurrentFrame <= TIME_BEFORE_EVICTION) {
         return;
@@ -85,6 +131,7 @@ void VulkanStagePool::gc() noexcept {
     for (auto pair : stages) {
         if (pair.second->lastAccessed < evictionTime) {
             vmaDestroyBuffer(mContext.allocator, pair.second->buffer, pair.second->memory);
+            mMemoryTracker.free(MemoryTracker::Category::STAGING, pair.second->capacity);
             delete pair.second;
         } else {
             mFreeStages.insert(pair);
@@ -96,6 +143,7 @@ void VulkanStagePool::reset() noexcept {
     assert_invariant(mUsedStages.empty());
     for (auto pair : mFreeStages) {
         vmaDestroyBuffer(mContext.allocator, pair.second->buffer, pair.second->memory);
+        mMemoryTracker.free(MemoryTracker::Category::STAGING, pair.second->capacity);
         delete pair.second;
     }
     mFreeStages.clear();
@@ -21,25 +21,42 @@
 
 #include "VulkanDisposer.h"
 
+#include "DriverBase.h"
+
 #include <map>
 #include <unordered_set>
 
 namespace filament {
 namespace backend {
 
-// Immutable POD representing a shared CPU-GPU staging area.
+// Immutable POD representing a shared CPU-GPU staging area. Stages are persistently mapped.
 struct VulkanStage {
     VmaAllocation memory;
     VkBuffer buffer;
     uint32_t capacity;
+    void* mapped;
     mutable uint64_t lastAccessed;
 };
 
+// A sub-range of a staging block, see VulkanStagePool::acquireRange().
+struct VulkanStageRange {
+    VmaAllocation memory;
+    VkBuffer buffer;
+    uint32_t offset;
+    void* mapped;   // points to the start of the range
+};
+
 // Manages a pool of stages, periodically releasing stages that have been unused for a while.
+//
+// Small uploads are sub-allocated linearly from a block, so that streaming many small buffer
+// updates doesn't create one stage per update. A block is returned to the pool once all the
+// command buffers that copy from it have finished executing, so over a few frames the blocks
+// behave like a ring.
 class VulkanStagePool {
 public:
-    explicit VulkanStagePool(VulkanContext& context, VulkanDisposer& disposer) noexcept :
-            mContext(context), mDisposer(disposer) {}
+    VulkanStagePool(VulkanContext& context, VulkanDisposer& disposer,
+            MemoryTracker& memoryTracker) noexcept :
+            mContext(context), mDisposer(disposer), mMemoryTracker(memoryTracker) {}
 
     // Finds or creates a stage whose capacity is at least the given number of bytes.
     VulkanStage const* acquireStage(uint32_t numBytes);
@@ -48,7 +65,11 @@ public:
     void releaseStage(VulkanStage const* stage) noexcept;
     void releaseStage(VulkanStage const* stage, VulkanCommandBuffer& cmd) noexcept;
 
-    // Evicts old unused stages and bumps the current frame number.
+    // Returns a range of at least the given number of bytes, for a copy recorded into the given
+    // command buffer. The range must not be used after that command buffer has been submitted.
+    VulkanStageRange acquireRange(uint32_t numBytes, VulkanCommandBuffer& cmd);
+
+    // Evicts old unused stages, retires the current block and bumps the current frame number.
     void gc() noexcept;
 
     // Destroys all unused stages and asserts that there are no stages currently in use.
@@ -56,8 +77,17 @@ public:
     void reset() noexcept;
 
 private:
+    void retireBlock() noexcept;
+
     VulkanContext& mContext;
     VulkanDisposer& mDisposer;
+    MemoryTracker& mMemoryTracker;
+
+    // The block that small ranges are currently sub-allocated from, and its first free byte.
+    VulkanStage const* mCurrentBlock = nullptr;
+    uint32_t mBlockOffset = 0;
+    static constexpr uint32_t BLOCK_SIZE = 256 * 1024;
+    static constexpr uint32_t RANGE_ALIGNMENT = 16;
 
     // Use an ordered multimap for quick (capacity => stage) lookups using lower_bound().
     std::multimap<uint32_t, VulkanStage const*> mFreeStages;
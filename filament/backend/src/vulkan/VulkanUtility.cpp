@@ -252,6 +252,29 @@ VkCompareOp getCompareOp(SamplerCompareFunc func) {
     }
 }
 
+VkExtent2D getFragmentSize(ShadingRate rate) {
+    switch (rate) {
+        case ShadingRate::RATE_1X1: return { 1, 1 };
+        case ShadingRate::RATE_1X2: return { 1, 2 };
+        case ShadingRate::RATE_2X1: return { 2, 1 };
+        case ShadingRate::RATE_2X2: return { 2, 2 };
+    }
+}
+
+VkBufferUsageFlags getBufferUsage(BufferObjectBinding bindingType) {
+    switch (bindingType) {
+        case BufferObjectBinding::VERTEX:
+            return VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+        // storage buffers written by compute programs can also be consumed as vertex buffers or
+        // draw arguments
+        case BufferObjectBinding::SHADER_STORAGE:
+            return VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                    VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+        case BufferObjectBinding::DRAW_INDIRECT:
+            return VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    }
+}
+
 VkBlendFactor getBlendFactor(BlendFunction mode) {
     using BlendFunction = filament::backend::BlendFunction;
     switch (mode) {
@@ -34,6 +34,8 @@ VkCullModeFlags getCullMode(CullingMode mode);
 VkFrontFace getFrontFace(bool inverseFrontFaces);
 PixelDataType getComponentType(VkFormat format);
 VkComponentMapping getSwizzleMap(TextureSwizzle swizzle[4]);
+VkExtent2D getFragmentSize(ShadingRate rate);
+VkBufferUsageFlags getBufferUsage(BufferObjectBinding bindingType);
 
 } // namespace filament
 } // namespace backend
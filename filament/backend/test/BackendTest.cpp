@@ -71,6 +71,10 @@ void BackendTest::executeCommands() {
 
 Handle<HwSwapChain> BackendTest::createSwapChain() {
     const NativeView& view = getNativeView();
+    if (!view.ptr) {
+        // runners without a window, e.g. on Linux, render offscreen
+        return commandStream.createSwapChainHeadless(view.width, view.height, 0);
+    }
     return commandStream.createSwapChain(view.ptr, 0);
 }
 
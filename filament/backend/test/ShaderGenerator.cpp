@@ -39,20 +39,20 @@ using SpirvBlob = std::vector<unsigned int>;
 
 namespace {
 
-void SpvToEs(const SpirvBlob* spirv, std::string* outEs) {
+void SpvToEs(const SpirvBlob* spirv, std::string* outEs, uint32_t version = 300) {
     CompilerGLSL glslCompiler(*spirv);
     glslCompiler.set_common_options(CompilerGLSL::Options {
-        .version = 300,
+        .version = version,
         .es = true,
         .enable_420pack_extension = false
     });
     *outEs = glslCompiler.compile();
 }
 
-void SpvToGlsl(const SpirvBlob* spirv, std::string* outGlsl) {
+void SpvToGlsl(const SpirvBlob* spirv, std::string* outGlsl, uint32_t version = 410) {
     CompilerGLSL glslCompiler(*spirv);
     glslCompiler.set_common_options(CompilerGLSL::Options {
-        .version = 410,
+        .version = version,
         .es = false,
         .enable_420pack_extension = false
     });
@@ -107,10 +107,16 @@ ShaderGenerator::ShaderGenerator(std::string vertex, std::string fragment, Backe
     mFragmentBlob = transpileShader(backend, isMobile, fragment, ShaderStage::FRAGMENT);
 }
 
+ShaderGenerator::ShaderGenerator(std::string compute, Backend backend, bool isMobile) noexcept
+        : mBackend(backend), mIsMobile(isMobile) {
+    mComputeBlob = transpileShader(backend, isMobile, compute, ShaderStage::COMPUTE);
+}
+
 ShaderGenerator::Blob ShaderGenerator::transpileShader(Backend backend, bool isMobile, std::string shader,
             ShaderStage stage) noexcept {
     TProgram program;
-    const EShLanguage language = stage == ShaderStage::VERTEX ? EShLangVertex : EShLangFragment;
+    const EShLanguage language = stage == ShaderStage::VERTEX ? EShLangVertex :
+            stage == ShaderStage::FRAGMENT ? EShLangFragment : EShLangCompute;
     TShader tShader(language);
 
     const char* shaderCString = shader.c_str();
@@ -126,7 +132,8 @@ ShaderGenerator::Blob ShaderGenerator::transpileShader(Backend backend, bool isM
 
     if (!ok) {
         std::cerr << "ERROR: Unable to parse " <<
-            (stage == ShaderStage::VERTEX ? "vertex" : "fragment") << " shader:" << std::endl;
+            (stage == ShaderStage::VERTEX ? "vertex" :
+             stage == ShaderStage::FRAGMENT ? "fragment" : "compute") << " shader:" << std::endl;
         std::cerr << tShader.getInfoLog() << std::endl;
         assert_invariant(false);
     }
@@ -149,10 +156,12 @@ ShaderGenerator::Blob ShaderGenerator::transpileShader(Backend backend, bool isM
            backend == Backend::VULKAN);
 
     if (backend == Backend::OPENGL) {
+        // compute shaders need GLSL ES 3.10 or GLSL 4.30
+        const bool compute = stage == ShaderStage::COMPUTE;
         if (isMobile) {
-            SpvToEs(&spirv, &result);
+            SpvToEs(&spirv, &result, compute ? 310 : 300);
         } else {
-            SpvToGlsl(&spirv, &result);
+            SpvToGlsl(&spirv, &result, compute ? 430 : 410);
         }
         return Blob(result.c_str(), result.c_str() + result.length() + 1);
     } else if (backend == Backend::METAL) {
@@ -167,6 +176,10 @@ ShaderGenerator::Blob ShaderGenerator::transpileShader(Backend backend, bool isM
 
 Program ShaderGenerator::getProgram() noexcept {
     Program program;
+    if (!mComputeBlob.empty()) {
+        program.shader(Program::Shader::COMPUTE, mComputeBlob.data(), mComputeBlob.size());
+        return program;
+    }
     program.shader(Program::Shader::VERTEX, mVertexBlob.data(), mVertexBlob.size());
     program.shader(Program::Shader::FRAGMENT, mFragmentBlob.data(), mFragmentBlob.size());
     return program;
@@ -39,6 +39,12 @@ public:
      */
     ShaderGenerator(std::string vertex, std::string fragment, Backend backend, bool isMobile) noexcept;
 
+    /**
+     * Generates a compute shader transpiled for the given backend / mobile combination.
+     * @param compute The compute shader, written in GLSL 450 core.
+     */
+    ShaderGenerator(std::string compute, Backend backend, bool isMobile) noexcept;
+
     ShaderGenerator(const ShaderGenerator& rhs) = delete;
     ShaderGenerator& operator=(const ShaderGenerator& rhs) = delete;
 
@@ -48,7 +54,8 @@ private:
 
     enum class ShaderStage {
         VERTEX,
-        FRAGMENT
+        FRAGMENT,
+        COMPUTE
     };
 
     using Blob = std::vector<char>;
@@ -60,6 +67,7 @@ private:
 
     Blob mVertexBlob;
     Blob mFragmentBlob;
+    Blob mComputeBlob;
     std::string mCompiledVertexShader;
     std::string mCompiledFragmentShader;
 
@@ -32,7 +32,7 @@ static constexpr filament::math::float2 gVertices[3] = {
 static constexpr short gIndices[3] = { 0, 1, 2 };
 
 TrianglePrimitive::TrianglePrimitive(filament::backend::DriverApi& driverApi,
-        bool allocateLargeBuffers) : mDriverApi(driverApi) {
+        bool allocateLargeBuffers, BufferObjectBinding vertexBinding) : mDriverApi(driverApi) {
     mVertexCount = allocateLargeBuffers ? 2048 : 3;
     mIndexCount = allocateLargeBuffers ? 4096 : 3;
     AttributeArray attributes = {
@@ -48,7 +48,7 @@ TrianglePrimitive::TrianglePrimitive(filament::backend::DriverApi& driverApi,
     enabledAttributes.set(VertexAttribute::POSITION);
 
     const size_t size = sizeof(math::float2) * 3;
-    mBufferObject = mDriverApi.createBufferObject(size, BufferObjectBinding::VERTEX);
+    mBufferObject = mDriverApi.createBufferObject(size, vertexBinding, BufferUsage::STATIC);
     mVertexBuffer = mDriverApi.createVertexBuffer(1, 1, mVertexCount, attributes,
             BufferUsage::STATIC);
     mDriverApi.setVertexBufferObject(mVertexBuffer, 0, mBufferObject);
@@ -101,4 +101,8 @@ TrianglePrimitive::PrimitiveHandle TrianglePrimitive::getRenderPrimitive() const
     return mRenderPrimitive;
 }
 
+TrianglePrimitive::BufferObjectHandle TrianglePrimitive::getVertexBufferObject() const noexcept {
+    return mBufferObject;
+}
+
 } // namespae test
@@ -35,10 +35,14 @@ public:
     using VertexHandle = filament::backend::Handle<filament::backend::HwVertexBuffer>;
     using IndexHandle = filament::backend::Handle<filament::backend::HwIndexBuffer>;
 
-    TrianglePrimitive(filament::backend::DriverApi& driverApi, bool allocateLargeBuffers = false);
+    // vertexBinding can be SHADER_STORAGE to let compute programs write the vertices.
+    TrianglePrimitive(filament::backend::DriverApi& driverApi, bool allocateLargeBuffers = false,
+            filament::backend::BufferObjectBinding vertexBinding =
+                    filament::backend::BufferObjectBinding::VERTEX);
     ~TrianglePrimitive();
 
     PrimitiveHandle getRenderPrimitive() const noexcept;
+    BufferObjectHandle getVertexBufferObject() const noexcept;
 
     void updateVertices(const filament::math::float2 vertices[3]) noexcept;
     void updateIndices(const short indices[3]) noexcept;
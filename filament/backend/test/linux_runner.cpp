@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PlatformRunner.h"
+
+namespace test {
+
+// There is no window on Linux, BackendTest renders into a headless swap chain of this size.
+test::NativeView getNativeView() {
+    return { .ptr = nullptr, .width = 512, .height = 512 };
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    auto backend = test::parseArgumentsForBackend(argc, argv);
+    test::initTests(backend, false, argc, argv);
+    return test::runTests();
+}
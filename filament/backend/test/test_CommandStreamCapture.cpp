@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <backend/Platform.h>
+
+#include "private/backend/CommandBufferQueue.h"
+#include "private/backend/CommandStream.h"
+#include "private/backend/CommandStreamCapture.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace filament;
+using namespace filament::backend;
+
+namespace {
+
+// These tests don't need a GPU, they always run on the Noop backend.
+static constexpr size_t MIN_COMMAND_BUFFERS_SIZE = 1 * 1024 * 1024;
+static constexpr size_t COMMAND_BUFFERS_SIZE     = 3 * MIN_COMMAND_BUFFERS_SIZE;
+
+Driver* createNoopDriver(DefaultPlatform** platform) {
+    Backend backend = Backend::NOOP;
+    *platform = DefaultPlatform::create(&backend);
+    return (*platform)->createDriver(nullptr);
+}
+
+// Executes the commands recorded so far, the calling thread acts as the driver thread.
+void executeCommands(CommandBufferQueue& queue, CommandStream& stream) {
+    queue.flush();
+    for (auto& item : queue.waitForCommands()) {
+        if (UTILS_LIKELY(item.begin)) {
+            stream.execute(item.begin);
+            queue.releaseBuffer(item);
+        }
+    }
+}
+
+} // anonymous namespace
+
+TEST(CommandStreamCapture, RoundTrip) {
+    DefaultPlatform* platform;
+    Driver* driver = createNoopDriver(&platform);
+    CommandBufferQueue queue(MIN_COMMAND_BUFFERS_SIZE, COMMAND_BUFFERS_SIZE);
+    CommandStream stream(*driver, queue.getCircularBuffer());
+
+    CommandStreamWriter writer;
+    ASSERT_TRUE(writer.isOpen());
+    stream.setCommandStreamWriter(&writer);
+
+    const uint8_t payload[] = { 0xF1, 0x1A, 0x4E, 0x47, 0xCA, 0x97, 0x0E, 0x5D };
+
+    // one frame uploading a buffer, followed by its destruction
+    auto swapChain = stream.createSwapChainHeadless(64, 64, 0);
+    auto bo = stream.createBufferObject(sizeof(payload), BufferObjectBinding::VERTEX,
+            BufferUsage::STATIC);
+    stream.beginFrame(0, 0);
+    stream.makeCurrent(swapChain, swapChain);
+    stream.updateBufferObject(bo, { payload, sizeof(payload) }, 0);
+    stream.commit(swapChain);
+    stream.endFrame(0);
+    stream.destroyBufferObject(bo);
+    stream.destroySwapChain(swapChain);
+
+    stream.setCommandStreamWriter(nullptr);
+    executeCommands(queue, stream);
+
+    EXPECT_EQ(writer.getCommandCount(), 9u);
+
+    // the buffer is captured with its content
+    std::vector<uint8_t> const& data = writer.getData();
+    EXPECT_NE(std::search(data.begin(), data.end(), std::begin(payload), std::end(payload)),
+            data.end());
+
+    // decode the capture and replay it on another driver
+    DefaultPlatform* replayPlatform;
+    Driver* replayDriver = createNoopDriver(&replayPlatform);
+    {
+        CommandStreamReplayer replayer(*replayDriver, nullptr, 64, 64);
+        ASSERT_TRUE(replayer.load(data.data(), data.size()));
+
+        // the commands after the last endFrame aren't part of a frame
+        ASSERT_EQ(replayer.getFrameCount(), 1u);
+        const std::vector<CommandId> expected = {
+                CommandId::createSwapChainHeadless,
+                CommandId::createBufferObject,
+                CommandId::beginFrame,
+                CommandId::makeCurrent,
+                CommandId::updateBufferObject,
+                CommandId::commit,
+                CommandId::endFrame,
+        };
+        EXPECT_EQ(replayer.getCommands(0), expected);
+
+        replayer.replay(0);
+        replayer.finish();
+    }
+
+    // a capture from another version of the backend is rejected
+    {
+        std::vector<uint8_t> corrupted(data);
+        corrupted[sizeof(uint32_t)] ^= 0xFF;
+        CommandStreamReplayer replayer(*replayDriver, nullptr, 64, 64);
+        EXPECT_FALSE(replayer.load(corrupted.data(), corrupted.size()));
+    }
+
+    replayDriver->terminate();
+    delete replayDriver;
+    DefaultPlatform::destroy(&replayPlatform);
+    driver->terminate();
+    delete driver;
+    DefaultPlatform::destroy(&platform);
+}
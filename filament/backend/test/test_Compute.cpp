@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BackendTest.h"
+
+#include "ShaderGenerator.h"
+#include "TrianglePrimitive.h"
+
+#include <math/vec4.h>
+
+#include <string>
+
+using namespace filament;
+using namespace filament::backend;
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Shaders
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string vertex (R"(#version 450 core
+
+layout(location = 0) in vec4 mesh_position;
+
+void main() {
+    gl_Position = vec4(mesh_position.xy, 0.0, 1.0);
+}
+)");
+
+std::string fragment (R"(#version 450 core
+
+layout(location = 0) out vec4 fragColor;
+
+void main() {
+    fragColor = vec4(1.0);
+}
+
+)");
+
+// Replaces the triangle of TrianglePrimitive, which covers the lower-left half of the viewport,
+// with one that covers the upper-right half.
+std::string compute (R"(#version 450 core
+
+layout(local_size_x = 3) in;
+
+layout(std430, binding = 0) buffer Vertices {
+    vec2 positions[];
+};
+
+void main() {
+    const vec2 triangle[3] = vec2[3](vec2(1.0, 1.0), vec2(-1.0, 1.0), vec2(1.0, -1.0));
+    positions[gl_LocalInvocationIndex] = triangle[gl_LocalInvocationIndex];
+}
+)");
+
+// Writes the DrawElementsIndirectCommand of the triangle of TrianglePrimitive.
+std::string computeArguments (R"(#version 450 core
+
+layout(local_size_x = 1) in;
+
+layout(std430, binding = 0) buffer DrawArguments {
+    uint arguments[5];
+};
+
+void main() {
+    arguments[0] = 3u;  // count
+    arguments[1] = 1u;  // instanceCount
+    arguments[2] = 0u;  // firstIndex
+    arguments[3] = 0u;  // baseVertex
+    arguments[4] = 0u;  // baseInstance
+}
+)");
+
+constexpr uint32_t kRenderTargetSize = 512;
+
+math::ubyte4 getPixel(const math::ubyte4* pixels, uint32_t x, uint32_t y) {
+    return pixels[y * kRenderTargetSize + x];
+}
+
+}
+
+namespace test {
+
+TEST_F(BackendTest, ComputeWritesVertices) {
+    if (!getDriverApi().isComputeSupported()) {
+        GTEST_SKIP() << "compute is not supported";
+    }
+
+    {
+        auto swapChain = getDriverApi().createSwapChainHeadless(kRenderTargetSize,
+                kRenderTargetSize, 0);
+        getDriverApi().makeCurrent(swapChain, swapChain);
+
+        ShaderGenerator shaderGen(vertex, fragment, sBackend, sIsMobilePlatform);
+        Program p = shaderGen.getProgram();
+        auto program = getDriverApi().createProgram(std::move(p));
+
+        ShaderGenerator computeGen(compute, sBackend, sIsMobilePlatform);
+        auto computeProgram = getDriverApi().createProgram(computeGen.getProgram());
+
+        Handle<HwTexture> texture = getDriverApi().createTexture(SamplerType::SAMPLER_2D, 1,
+                TextureFormat::RGBA8, 1, kRenderTargetSize, kRenderTargetSize, 1,
+                TextureUsage::COLOR_ATTACHMENT | TextureUsage::SAMPLEABLE);
+
+        Handle<HwRenderTarget> renderTarget = getDriverApi().createRenderTarget(
+                TargetBufferFlags::COLOR, kRenderTargetSize, kRenderTargetSize, 1,
+                TargetBufferInfo(texture, 0), {}, {});
+
+        // The vertices are written by the compute program, so they live in a storage buffer.
+        TrianglePrimitive triangle(getDriverApi(), false, BufferObjectBinding::SHADER_STORAGE);
+
+        getDriverApi().makeCurrent(swapChain, swapChain);
+        getDriverApi().beginFrame(0, 0);
+
+        // Overwrite the vertices of the triangle on the GPU, outside of the render pass.
+        getDriverApi().bindStorageBuffer(0, triangle.getVertexBufferObject());
+        getDriverApi().dispatchCompute(computeProgram, { 1, 1, 1 });
+
+        RenderPassParams params = {};
+        params.viewport = { 0, 0, kRenderTargetSize, kRenderTargetSize };
+        params.flags.clear = TargetBufferFlags::COLOR;
+        params.clearColor = { 0.f, 0.f, 1.f, 1.f };
+        params.flags.discardStart = TargetBufferFlags::ALL;
+        params.flags.discardEnd = TargetBufferFlags::NONE;
+
+        PipelineState state;
+        state.program = program;
+        state.rasterState.colorWrite = true;
+        state.rasterState.depthWrite = false;
+        state.rasterState.depthFunc = RasterState::DepthFunc::A;
+        state.rasterState.culling = CullingMode::NONE;
+
+        getDriverApi().beginRenderPass(renderTarget, params);
+        getDriverApi().draw(state, triangle.getRenderPrimitive());
+        getDriverApi().endRenderPass();
+
+        const size_t size = kRenderTargetSize * kRenderTargetSize * sizeof(math::ubyte4);
+        PixelBufferDescriptor descriptor(calloc(1, size), size,
+                PixelDataFormat::RGBA, PixelDataType::UBYTE,
+                [](void* buffer, size_t size, void* user) {
+                    auto const* pixels = (math::ubyte4 const*)buffer;
+                    // right half: drawn with the vertices written by the compute program
+                    EXPECT_EQ(getPixel(pixels, 448, 256), math::ubyte4(255, 255, 255, 255));
+                    // left half: where the original vertices would have drawn
+                    EXPECT_EQ(getPixel(pixels, 64, 256), math::ubyte4(0, 0, 255, 255));
+                    free(buffer);
+                });
+
+        getDriverApi().readPixels(renderTarget, 0, 0, kRenderTargetSize, kRenderTargetSize,
+                std::move(descriptor));
+
+        getDriverApi().flush();
+        getDriverApi().commit(swapChain);
+        getDriverApi().endFrame(0);
+
+        getDriverApi().destroyProgram(program);
+        getDriverApi().destroyProgram(computeProgram);
+        getDriverApi().destroySwapChain(swapChain);
+        getDriverApi().destroyRenderTarget(renderTarget);
+        getDriverApi().destroyTexture(texture);
+    }
+
+    getDriverApi().finish();
+
+    executeCommands();
+
+    getDriver().purge();
+}
+
+TEST_F(BackendTest, ComputeWritesDrawArguments) {
+    if (!getDriverApi().isComputeSupported() || !getDriverApi().isDrawIndirectSupported()) {
+        GTEST_SKIP() << "compute or indirect draws are not supported";
+    }
+
+    {
+        auto swapChain = getDriverApi().createSwapChainHeadless(kRenderTargetSize,
+                kRenderTargetSize, 0);
+        getDriverApi().makeCurrent(swapChain, swapChain);
+
+        ShaderGenerator shaderGen(vertex, fragment, sBackend, sIsMobilePlatform);
+        Program p = shaderGen.getProgram();
+        auto program = getDriverApi().createProgram(std::move(p));
+
+        ShaderGenerator computeGen(computeArguments, sBackend, sIsMobilePlatform);
+        auto computeProgram = getDriverApi().createProgram(computeGen.getProgram());
+
+        Handle<HwTexture> texture = getDriverApi().createTexture(SamplerType::SAMPLER_2D, 1,
+                TextureFormat::RGBA8, 1, kRenderTargetSize, kRenderTargetSize, 1,
+                TextureUsage::COLOR_ATTACHMENT | TextureUsage::SAMPLEABLE);
+
+        Handle<HwRenderTarget> renderTarget = getDriverApi().createRenderTarget(
+                TargetBufferFlags::COLOR, kRenderTargetSize, kRenderTargetSize, 1,
+                TargetBufferInfo(texture, 0), {}, {});
+
+        TrianglePrimitive triangle(getDriverApi());
+
+        // The arguments start zeroed, so nothing is drawn unless the compute program runs.
+        static constexpr uint32_t zeroes[5] = {};
+        auto arguments = getDriverApi().createBufferObject(sizeof(zeroes),
+                BufferObjectBinding::SHADER_STORAGE, BufferUsage::STATIC);
+        getDriverApi().updateBufferObject(arguments, { zeroes, sizeof(zeroes) }, 0);
+
+        getDriverApi().makeCurrent(swapChain, swapChain);
+        getDriverApi().beginFrame(0, 0);
+
+        getDriverApi().bindStorageBuffer(0, arguments);
+        getDriverApi().dispatchCompute(computeProgram, { 1, 1, 1 });
+
+        RenderPassParams params = {};
+        params.viewport = { 0, 0, kRenderTargetSize, kRenderTargetSize };
+        params.flags.clear = TargetBufferFlags::COLOR;
+        params.clearColor = { 0.f, 0.f, 1.f, 1.f };
+        params.flags.discardStart = TargetBufferFlags::ALL;
+        params.flags.discardEnd = TargetBufferFlags::NONE;
+
+        PipelineState state;
+        state.program = program;
+        state.rasterState.colorWrite = true;
+        state.rasterState.depthWrite = false;
+        state.rasterState.depthFunc = RasterState::DepthFunc::A;
+        state.rasterState.culling = CullingMode::NONE;
+
+        getDriverApi().beginRenderPass(renderTarget, params);
+        getDriverApi().drawIndirect(state, triangle.getRenderPrimitive(), arguments, 0);
+        getDriverApi().endRenderPass();
+
+        const size_t size = kRenderTargetSize * kRenderTargetSize * sizeof(math::ubyte4);
+        PixelBufferDescriptor descriptor(calloc(1, size), size,
+                PixelDataFormat::RGBA, PixelDataType::UBYTE,
+                [](void* buffer, size_t size, void* user) {
+                    auto const* pixels = (math::ubyte4 const*)buffer;
+                    // left half: covered by the triangle
+                    EXPECT_EQ(getPixel(pixels, 64, 256), math::ubyte4(255, 255, 255, 255));
+                    // right half: only cleared
+                    EXPECT_EQ(getPixel(pixels, 448, 256), math::ubyte4(0, 0, 255, 255));
+                    free(buffer);
+                });
+
+        getDriverApi().readPixels(renderTarget, 0, 0, kRenderTargetSize, kRenderTargetSize,
+                std::move(descriptor));
+
+        getDriverApi().flush();
+        getDriverApi().commit(swapChain);
+        getDriverApi().endFrame(0);
+
+        getDriverApi().destroyBufferObject(arguments);
+        getDriverApi().destroyProgram(program);
+        getDriverApi().destroyProgram(computeProgram);
+        getDriverApi().destroySwapChain(swapChain);
+        getDriverApi().destroyRenderTarget(renderTarget);
+        getDriverApi().destroyTexture(texture);
+    }
+
+    getDriverApi().finish();
+
+    executeCommands();
+
+    getDriver().purge();
+}
+
+} // namespace test
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "DriverBase.h"
+#include "HandleAllocator.h"
+
+#include <vector>
+
+using namespace filament;
+using namespace filament::backend;
+
+namespace {
+
+// the pool sizes of the OpenGL backend
+using TestHandleAllocator = HandleAllocator<16, 64, 208>;
+
+// 256 bytes for the first pool, i.e. 16 slots of 16 bytes
+static constexpr size_t ARENA_SIZE = 4096;
+
+struct HwSmall : public HwBase {
+};
+
+struct HwLarge : public HwBase {
+    uint8_t data[128];
+};
+
+} // anonymous namespace
+
+TEST(HandleAllocator, FreedSlotIsReused) {
+    TestHandleAllocator allocator("test", ARENA_SIZE);
+
+    Handle<HwSmall> h0 = allocator.allocateAndConstruct<HwSmall>();
+    Handle<HwSmall> h1 = allocator.allocateAndConstruct<HwSmall>();
+    EXPECT_NE(h0, h1);
+    HwSmall* const p1 = allocator.handle_cast<HwSmall*>(h1);
+    HandleBase::HandleId const id1 = h1.getId();
+
+    // the slot freed last is handed out first
+    allocator.deallocate(h1, p1);
+    Handle<HwSmall> h2 = allocator.allocateAndConstruct<HwSmall>();
+    EXPECT_EQ(allocator.handle_cast<HwSmall*>(h2), p1);
+#ifndef NDEBUG
+    // ...but with a new age, so the stale handle can't alias the new one
+    EXPECT_NE(h2.getId(), id1);
+#else
+    EXPECT_EQ(h2.getId(), id1);
+#endif
+
+    TestHandleAllocator::Statistics stats = allocator.getStatistics();
+    EXPECT_EQ(stats.allocationCount, 3u);
+    EXPECT_EQ(stats.pools[0].count, 2u);
+    EXPECT_EQ(stats.pools[0].peakCount, 2u);
+    EXPECT_EQ(stats.pools[1].count, 0u);
+    EXPECT_EQ(stats.pools[2].count, 0u);
+
+    allocator.deallocate<HwSmall>(h0);
+    allocator.deallocate<HwSmall>(h2);
+    stats = allocator.getStatistics();
+    EXPECT_EQ(stats.pools[0].count, 0u);
+    EXPECT_EQ(stats.pools[0].peakCount, 2u);
+}
+
+TEST(HandleAllocator, HandlesArePooledBySize) {
+    TestHandleAllocator allocator("test", ARENA_SIZE);
+
+    Handle<HwSmall> small = allocator.allocateAndConstruct<HwSmall>();
+    Handle<HwLarge> large = allocator.allocateAndConstruct<HwLarge>();
+
+    TestHandleAllocator::Statistics const stats = allocator.getStatistics();
+    EXPECT_EQ(stats.pools[0].count, 1u);
+    EXPECT_EQ(stats.pools[1].count, 0u);
+    EXPECT_EQ(stats.pools[2].count, 1u);
+
+    allocator.deallocate<HwSmall>(small);
+    allocator.deallocate<HwLarge>(large);
+}
+
+TEST(HandleAllocator, ArenaExhaustion) {
+    TestHandleAllocator allocator("test", ARENA_SIZE);
+
+    size_t const capacity = allocator.getStatistics().pools[0].capacity;
+    ASSERT_EQ(capacity, ARENA_SIZE / 16 / 16);
+
+    // the whole pool can be used...
+    std::vector<Handle<HwSmall>> handles;
+    for (size_t i = 0; i < capacity; i++) {
+        handles.push_back(allocator.allocateAndConstruct<HwSmall>());
+    }
+    EXPECT_EQ(allocator.getStatistics().pools[0].count, capacity);
+
+    // ...but not one more slot, and the other pools don't take over
+    EXPECT_DEATH(allocator.allocateAndConstruct<HwSmall>(), "Out of memory");
+
+    // freeing any slot makes room again
+    Handle<HwSmall> h = handles.back();
+    handles.pop_back();
+    allocator.deallocate<HwSmall>(h);
+    handles.push_back(allocator.allocateAndConstruct<HwSmall>());
+    EXPECT_EQ(allocator.getStatistics().pools[0].count, capacity);
+
+    for (auto& handle : handles) {
+        allocator.deallocate<HwSmall>(handle);
+    }
+}
+
+#ifndef NDEBUG
+TEST(HandleAllocator, UseAfterFree) {
+    TestHandleAllocator allocator("test", ARENA_SIZE);
+
+    Handle<HwSmall> h = allocator.allocateAndConstruct<HwSmall>();
+    Handle<HwSmall> const stale = h;
+    allocator.deallocate<HwSmall>(h);
+    EXPECT_DEATH(allocator.handle_cast<HwSmall*>(stale), "Use after free");
+}
+#endif
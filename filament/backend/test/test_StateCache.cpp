@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BackendTest.h"
+
+#include "ShaderGenerator.h"
+#include "TrianglePrimitive.h"
+
+#include "opengl/OpenGLDriver.h"
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Shaders
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string vertex (R"(#version 450 core
+
+layout(location = 0) in vec4 mesh_position;
+
+void main() {
+    gl_Position = vec4(mesh_position.xy, 0.0, 1.0);
+}
+)");
+
+std::string fragment (R"(#version 450 core
+
+layout(location = 0) out vec4 fragColor;
+
+void main() {
+    fragColor = vec4(1.0);
+}
+
+)");
+
+}
+
+namespace test {
+
+using namespace filament;
+using namespace filament::backend;
+
+/**
+ * This test case checks that drawing twice with the same pipeline state and primitive doesn't
+ * issue any GL state change the second time, i.e. the state cache elides every redundant bind.
+ */
+TEST_F(BackendTest, RedundantStateChangesAreElided) {
+    if (sBackend != Backend::OPENGL) {
+        GTEST_SKIP() << "The state cache statistics are specific to the OpenGL backend";
+    }
+#ifdef NDEBUG
+    GTEST_SKIP() << "The state cache statistics are only counted in debug builds";
+#endif
+
+    OpenGLDriver const& gl = static_cast<OpenGLDriver const&>(getDriver());
+
+    // The test is executed within this block scope to force destructors to run before
+    // executeCommands().
+    {
+        auto swapChain = createSwapChain();
+        getDriverApi().makeCurrent(swapChain, swapChain);
+
+        ShaderGenerator shaderGen(vertex, fragment, sBackend, sIsMobilePlatform);
+        Program p = shaderGen.getProgram();
+        auto program = getDriverApi().createProgram(std::move(p));
+
+        auto defaultRenderTarget = getDriverApi().createDefaultRenderTarget(0);
+
+        TrianglePrimitive triangle(getDriverApi());
+
+        RenderPassParams params = {};
+        fullViewport(params);
+        params.flags.clear = TargetBufferFlags::COLOR;
+        params.clearColor = {0.f, 1.f, 0.f, 1.f};
+        params.flags.discardStart = TargetBufferFlags::ALL;
+        params.flags.discardEnd = TargetBufferFlags::NONE;
+
+        PipelineState state;
+        state.program = program;
+        state.rasterState.colorWrite = true;
+        state.rasterState.depthWrite = false;
+        state.rasterState.depthFunc = RasterState::DepthFunc::A;
+        state.rasterState.culling = CullingMode::NONE;
+
+        getDriverApi().makeCurrent(swapChain, swapChain);
+        getDriverApi().beginFrame(0, 0);
+
+        getDriverApi().beginRenderPass(defaultRenderTarget, params);
+        getDriverApi().draw(state, triangle.getRenderPrimitive());
+        executeCommands();
+
+        // the first draw sets the state up, the second one must find everything in place
+        const auto before = gl.getStateCacheStatistics();
+        EXPECT_GT(before.issued, 0u);
+
+        getDriverApi().draw(state, triangle.getRenderPrimitive());
+        executeCommands();
+
+        const auto after = gl.getStateCacheStatistics();
+        EXPECT_EQ(after.issued, before.issued);
+        EXPECT_GT(after.elided, before.elided);
+
+        getDriverApi().endRenderPass();
+
+        getDriverApi().flush();
+        getDriverApi().commit(swapChain);
+        getDriverApi().endFrame(0);
+
+        getDriverApi().destroyProgram(program);
+        getDriverApi().destroySwapChain(swapChain);
+        getDriverApi().destroyRenderTarget(defaultRenderTarget);
+    }
+
+    executeCommands();
+}
+
+} // namespace test
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BackendTest.h"
+
+#include "ShaderGenerator.h"
+#include "TrianglePrimitive.h"
+
+#include <math/vec4.h>
+
+#include <string>
+
+using namespace filament;
+using namespace filament::backend;
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Shaders
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string vertex (R"(#version 450 core
+
+layout(location = 0) in vec4 mesh_position;
+
+void main() {
+    // move and scale the triangle so that it covers the entire viewport
+    gl_Position = vec4((mesh_position.xy + 0.5) * 5.0, 0.0, 1.0);
+}
+)");
+
+// Each draw only fills the column of pixels selected by the uniform buffer.
+std::string fragment (R"(#version 450 core
+
+layout(location = 0) out vec4 fragColor;
+
+uniform Params {
+    highp vec4 color;
+    highp float column;
+} params;
+
+void main() {
+    if (floor(gl_FragCoord.x / 8.0) != params.column) {
+        discard;
+    }
+    fragColor = params.color;
+}
+)");
+
+struct Params {
+    math::float4 color;
+    float column;
+    float padding[3];
+};
+
+// More columns than the Vulkan backend has slots in the ring of a STREAM uniform buffer, so that
+// the slots are reused within a frame as well.
+constexpr uint32_t kColumnCount = 8;
+constexpr uint32_t kColumnWidth = 8;
+constexpr uint32_t kRenderTargetSize = kColumnCount * kColumnWidth;
+constexpr uint32_t kFrameCount = 2;
+
+// The color of a column changes every frame, so that stale uniforms can't go unnoticed.
+math::ubyte4 getColor(uint32_t column, uint32_t frame) {
+    const uint32_t k = (column + frame) % kColumnCount;
+    return { uint8_t(k * 32), uint8_t(255 - k * 32), uint8_t(128), uint8_t(255) };
+}
+
+void uploadUniforms(DriverApi& dapi, Handle<HwUniformBuffer> ubh, Params params) {
+    Params* tmp = new Params(params);
+    auto cb = [](void* buffer, size_t size, void* user) {
+        Params* sp = (Params*) buffer;
+        delete sp;
+    };
+    BufferDescriptor bd(tmp, sizeof(Params), cb);
+    dapi.loadUniformBuffer(ubh, std::move(bd));
+}
+
+}
+
+namespace test {
+
+TEST_F(BackendTest, StreamUniformBufferUpdates) {
+    auto& api = getDriverApi();
+
+    // The test is executed within this block scope to force destructors to run before
+    // executeCommands().
+    {
+        auto swapChain = api.createSwapChainHeadless(kRenderTargetSize, kRenderTargetSize, 0);
+        api.makeCurrent(swapChain, swapChain);
+
+        ShaderGenerator shaderGen(vertex, fragment, sBackend, sIsMobilePlatform);
+        Program prog = shaderGen.getProgram();
+        prog.setUniformBlock(0, utils::CString("params"));
+        auto program = api.createProgram(std::move(prog));
+
+        Handle<HwTexture> texture = api.createTexture(SamplerType::SAMPLER_2D, 1,
+                TextureFormat::RGBA8, 1, kRenderTargetSize, kRenderTargetSize, 1,
+                TextureUsage::COLOR_ATTACHMENT | TextureUsage::SAMPLEABLE);
+
+        Handle<HwRenderTarget> renderTarget = api.createRenderTarget(
+                TargetBufferFlags::COLOR, kRenderTargetSize, kRenderTargetSize, 1,
+                TargetBufferInfo(texture, 0), {}, {});
+
+        TrianglePrimitive triangle(api);
+
+        auto ubuffer = api.createUniformBuffer(sizeof(Params), BufferUsage::STREAM);
+
+        RenderPassParams params = {};
+        params.viewport = { 0, 0, kRenderTargetSize, kRenderTargetSize };
+        params.flags.clear = TargetBufferFlags::COLOR;
+        params.clearColor = { 0.f, 0.f, 0.f, 1.f };
+        params.flags.discardStart = TargetBufferFlags::ALL;
+        params.flags.discardEnd = TargetBufferFlags::NONE;
+
+        PipelineState state;
+        state.program = program;
+        state.rasterState.colorWrite = true;
+        state.rasterState.depthWrite = false;
+        state.rasterState.depthFunc = RasterState::DepthFunc::A;
+        state.rasterState.culling = CullingMode::NONE;
+
+        // The second frame loads the slots the first frame has read from.
+        for (uint32_t frame = 0; frame < kFrameCount; frame++) {
+            api.makeCurrent(swapChain, swapChain);
+            api.beginFrame(0, 0);
+
+            // One load and one draw per column, all in the same render pass.
+            api.beginRenderPass(renderTarget, params);
+            for (uint32_t column = 0; column < kColumnCount; column++) {
+                uploadUniforms(api, ubuffer, {
+                    .color = math::float4(getColor(column, frame)) / 255.0f,
+                    .column = float(column),
+                });
+                api.bindUniformBuffer(0, ubuffer);
+                api.draw(state, triangle.getRenderPrimitive());
+            }
+            api.endRenderPass();
+
+            if (frame == kFrameCount - 1) {
+                const size_t size = kRenderTargetSize * kRenderTargetSize * sizeof(math::ubyte4);
+                PixelBufferDescriptor descriptor(calloc(1, size), size,
+                        PixelDataFormat::RGBA, PixelDataType::UBYTE,
+                        [](void* buffer, size_t size, void* user) {
+                            auto const* pixels = (math::ubyte4 const*)buffer;
+                            for (uint32_t column = 0; column < kColumnCount; column++) {
+                                const uint32_t x = column * kColumnWidth + kColumnWidth / 2;
+                                const uint32_t y = kRenderTargetSize / 2;
+                                EXPECT_EQ(pixels[y * kRenderTargetSize + x],
+                                        getColor(column, kFrameCount - 1))
+                                        << "column " << column;
+                            }
+                            free(buffer);
+                        });
+                api.readPixels(renderTarget, 0, 0, kRenderTargetSize, kRenderTargetSize,
+                        std::move(descriptor));
+            }
+
+            api.flush();
+            api.commit(swapChain);
+            api.endFrame(0);
+            api.finish();
+            executeCommands();
+            getDriver().purge();
+        }
+
+        api.destroyUniformBuffer(ubuffer);
+        api.destroyProgram(program);
+        api.destroySwapChain(swapChain);
+        api.destroyRenderTarget(renderTarget);
+        api.destroyTexture(texture);
+    }
+
+    api.finish();
+
+    executeCommands();
+
+    getDriver().purge();
+}
+
+} // namespace test
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "vulkan/VulkanBarrierBatch.h"
+
+#include <vector>
+
+using namespace bluevk;
+using namespace filament::backend;
+
+namespace {
+
+// These tests don't need a GPU, the barriers are recorded instead of being sent to a device.
+struct PipelineBarrier {
+    VkCommandBuffer cmdbuffer;
+    VkPipelineStageFlags srcStages;
+    VkPipelineStageFlags dstStages;
+    std::vector<VkImageMemoryBarrier> barriers;
+};
+
+std::vector<PipelineBarrier> sPipelineBarriers;
+
+VKAPI_ATTR void VKAPI_CALL recordPipelineBarrier(VkCommandBuffer cmdbuffer,
+        VkPipelineStageFlags srcStages, VkPipelineStageFlags dstStages, VkDependencyFlags,
+        uint32_t, const VkMemoryBarrier*, uint32_t, const VkBufferMemoryBarrier*,
+        uint32_t barrierCount, const VkImageMemoryBarrier* barriers) {
+    sPipelineBarriers.push_back({ cmdbuffer, srcStages, dstStages,
+            { barriers, barriers + barrierCount } });
+}
+
+class VulkanBarrierBatchTest : public testing::Test {
+protected:
+    void SetUp() override {
+        sPipelineBarriers.clear();
+        mPipelineBarrier = vkCmdPipelineBarrier;
+        vkCmdPipelineBarrier = recordPipelineBarrier;
+    }
+
+    void TearDown() override {
+        vkCmdPipelineBarrier = mPipelineBarrier;
+    }
+
+    PFN_vkCmdPipelineBarrier mPipelineBarrier = nullptr;
+};
+
+// Handles are never dereferenced, they only need to be distinct.
+const VkCommandBuffer kCommands = (VkCommandBuffer) 0x10;
+const VkCommandBuffer kOtherCommands = (VkCommandBuffer) 0x20;
+const VkImage kImage = (VkImage) 0x100;
+const VkImage kOtherImage = (VkImage) 0x200;
+
+VkImageSubresourceRange levels(uint32_t baseLevel, uint32_t levelCount = 1) {
+    return { VK_IMAGE_ASPECT_COLOR_BIT, baseLevel, levelCount, 0, 1 };
+}
+
+} // anonymous namespace
+
+TEST_F(VulkanBarrierBatchTest, TransitionsAreBatched) {
+    VulkanBarrierBatch batch;
+    batch.transition(kCommands, kImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, levels(0));
+    batch.transition(kCommands, kOtherImage, VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, levels(0));
+
+    // nothing is recorded until the batch is flushed
+    EXPECT_FALSE(batch.empty());
+    EXPECT_TRUE(sPipelineBarriers.empty());
+
+    batch.flush();
+    EXPECT_TRUE(batch.empty());
+    ASSERT_EQ(sPipelineBarriers.size(), 1u);
+
+    // a single barrier waits on the union of the stages of both transitions
+    PipelineBarrier const& barrier = sPipelineBarriers[0];
+    EXPECT_EQ(barrier.cmdbuffer, kCommands);
+    EXPECT_EQ(barrier.srcStages,
+            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+    EXPECT_EQ(barrier.dstStages,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    ASSERT_EQ(barrier.barriers.size(), 2u);
+    EXPECT_EQ(barrier.barriers[0].image, kImage);
+    EXPECT_EQ(barrier.barriers[0].srcAccessMask, VK_ACCESS_TRANSFER_WRITE_BIT);
+    EXPECT_EQ(barrier.barriers[0].dstAccessMask, VK_ACCESS_SHADER_READ_BIT);
+    EXPECT_EQ(barrier.barriers[1].image, kOtherImage);
+    EXPECT_EQ(barrier.barriers[1].srcAccessMask, 0u);
+
+    // flushing an empty batch records nothing
+    batch.flush();
+    EXPECT_EQ(sPipelineBarriers.size(), 1u);
+}
+
+TEST_F(VulkanBarrierBatchTest, PendingTransitionIsReplaced) {
+    // As when generating mipmaps: level 0 goes back to the sampling layout after being written,
+    // then is read by the blit into the next level.
+    VulkanBarrierBatch batch;
+    batch.transition(kCommands, kImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, levels(0));
+    batch.transition(kCommands, kImage, VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, levels(0));
+    batch.flush();
+
+    // the intermediate layout is skipped, and the write is still waited on
+    ASSERT_EQ(sPipelineBarriers.size(), 1u);
+    PipelineBarrier const& barrier = sPipelineBarriers[0];
+    ASSERT_EQ(barrier.barriers.size(), 1u);
+    EXPECT_EQ(barrier.barriers[0].oldLayout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    EXPECT_EQ(barrier.barriers[0].newLayout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    EXPECT_EQ(barrier.barriers[0].srcAccessMask, VK_ACCESS_TRANSFER_WRITE_BIT);
+    EXPECT_EQ(barrier.barriers[0].dstAccessMask, VK_ACCESS_TRANSFER_READ_BIT);
+    EXPECT_EQ(barrier.srcStages, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    EXPECT_EQ(barrier.dstStages, VK_PIPELINE_STAGE_TRANSFER_BIT);
+}
+
+TEST_F(VulkanBarrierBatchTest, PartiallyOverlappingTransitionsStayOrdered) {
+    VulkanBarrierBatch batch;
+    batch.transition(kCommands, kImage, VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levels(0, 2));
+    batch.transition(kCommands, kImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, levels(1));
+
+    // the first transition is recorded before the second one is added
+    ASSERT_EQ(sPipelineBarriers.size(), 1u);
+    EXPECT_EQ(sPipelineBarriers[0].barriers[0].subresourceRange.levelCount, 2u);
+
+    batch.flush();
+    ASSERT_EQ(sPipelineBarriers.size(), 2u);
+    ASSERT_EQ(sPipelineBarriers[1].barriers.size(), 1u);
+    EXPECT_EQ(sPipelineBarriers[1].barriers[0].subresourceRange.baseMipLevel, 1u);
+    EXPECT_EQ(sPipelineBarriers[1].barriers[0].oldLayout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+}
+
+TEST_F(VulkanBarrierBatchTest, TransitionsFollowTheirCommandBuffer) {
+    VulkanBarrierBatch batch;
+    batch.transition(kCommands, kImage, VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levels(0));
+    batch.transition(kOtherCommands, kOtherImage, VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levels(0));
+    batch.flush();
+
+    ASSERT_EQ(sPipelineBarriers.size(), 2u);
+    EXPECT_EQ(sPipelineBarriers[0].cmdbuffer, kCommands);
+    EXPECT_EQ(sPipelineBarriers[0].barriers[0].image, kImage);
+    EXPECT_EQ(sPipelineBarriers[1].cmdbuffer, kOtherCommands);
+    EXPECT_EQ(sPipelineBarriers[1].barriers[0].image, kOtherImage);
+}
+
+TEST_F(VulkanBarrierBatchTest, ForgottenImageIsNotTransitioned) {
+    VulkanBarrierBatch batch;
+    batch.transition(kCommands, kImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, levels(0));
+    batch.transition(kCommands, kOtherImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, levels(0));
+    batch.forget(kImage);
+    batch.flush();
+
+    ASSERT_EQ(sPipelineBarriers.size(), 1u);
+    ASSERT_EQ(sPipelineBarriers[0].barriers.size(), 1u);
+    EXPECT_EQ(sPipelineBarriers[0].barriers[0].image, kOtherImage);
+}
@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <filament/Box.h>
+#include <filament/Camera.h>
+#include <filament/Engine.h>
+#include <filament/IndexBuffer.h>
+#include <filament/LightManager.h>
+#include <filament/Material.h>
+#include <filament/RenderableManager.h>
+#include <filament/Renderer.h>
+#include <filament/Scene.h>
+#include <filament/TransformManager.h>
+#include <filament/VertexBuffer.h>
+#include <filament/View.h>
+#include <filament/Viewport.h>
+
+#include "RenderPass.h"
+#include "details/Camera.h"
+#include "details/Engine.h"
+#include "details/Scene.h"
+#include "details/View.h"
+
+#include <utils/architecture.h>
+#include <utils/Entity.h>
+#include <utils/EntityManager.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace filament;
+using namespace filament::math;
+
+/*
+ * End-to-end benchmarks of the CPU side of a frame, on synthetic scenes rendered with the Noop
+ * backend. Each phase of the frame is timed separately. The arguments of each benchmark are the
+ * number of renderables, of point lights, of shadow cascades of the sun (no sun if 0) and of
+ * skinned renderables (among the renderables).
+ *
+ * Use --benchmark_format=json or --benchmark_out=<file> to record the results.
+ */
+class SceneFixture : public benchmark::Fixture {
+protected:
+    static constexpr size_t BONE_COUNT = 64;
+
+    Engine* engine = nullptr;
+    Scene* scene = nullptr;
+    View* view = nullptr;
+    Camera* camera = nullptr;
+    Renderer* renderer = nullptr;
+    SwapChain* swapChain = nullptr;
+    VertexBuffer* vertexBuffer = nullptr;
+    IndexBuffer* indexBuffer = nullptr;
+    utils::Entity cameraEntity;
+    std::vector<utils::Entity> entities;
+    std::vector<mat4f> bones;
+    size_t renderableCount = 0;
+    size_t skinnedCount = 0;
+    uint32_t frameId = 0;
+    const Viewport viewport{ 0, 0, 1920, 1080 };
+
+public:
+    void SetUp(benchmark::State& state) override {
+        renderableCount = size_t(state.range(0));
+        const size_t lightCount = size_t(state.range(1));
+        const uint8_t cascadeCount = uint8_t(state.range(2));
+        skinnedCount = std::min(size_t(state.range(3)), renderableCount);
+
+        engine = Engine::create(Engine::Backend::NOOP);
+        scene = engine->createScene();
+        view = engine->createView();
+        renderer = engine->createRenderer();
+        swapChain = engine->createSwapChain(viewport.width, viewport.height);
+        cameraEntity = utils::EntityManager::get().create();
+        camera = engine->createCamera(cameraEntity);
+        camera->setProjection(60.0, double(viewport.width) / viewport.height, 0.1, 1000.0);
+        view->setScene(scene);
+        view->setCamera(camera);
+        view->setViewport(viewport);
+
+        // a single triangle is enough, the Noop backend doesn't draw anything
+        vertexBuffer = VertexBuffer::Builder()
+                .vertexCount(3)
+                .bufferCount(1)
+                .attribute(VertexAttribute::POSITION, 0, VertexBuffer::AttributeType::FLOAT3)
+                .build(*engine);
+        indexBuffer = IndexBuffer::Builder()
+                .indexCount(3)
+                .bufferType(IndexBuffer::IndexType::USHORT)
+                .build(*engine);
+        MaterialInstance const* const mi = engine->getDefaultMaterial()->getDefaultInstance();
+
+        // objects are spread uniformly on a disk around the camera, about a quarter of them
+        // are in the frustum.
+        std::default_random_engine gen; // NOLINT
+        std::uniform_real_distribution<float> rand(0.0f, 1.0f);
+        auto randomPosition = [&](float radius, float y) {
+            const float a = rand(gen) * 2.0f * float(F_PI);
+            const float r = radius * std::sqrt(rand(gen));
+            return float3{ r * std::cos(a), y, r * std::sin(a) };
+        };
+
+        entities.resize(renderableCount + lightCount + (cascadeCount ? 1 : 0));
+        utils::EntityManager::get().create(entities.size(), entities.data());
+
+        TransformManager& tcm = engine->getTransformManager();
+        for (size_t i = 0; i < renderableCount; i++) {
+            RenderableManager::Builder builder(1);
+            builder.boundingBox({{ 0, 0, 0 }, { 1, 1, 1 }})
+                    .geometry(0, RenderableManager::PrimitiveType::TRIANGLES,
+                            vertexBuffer, indexBuffer)
+                    .material(0, mi)
+                    .castShadows(cascadeCount > 0)
+                    .receiveShadows(cascadeCount > 0);
+            if (i < skinnedCount) {
+                builder.skinning(BONE_COUNT);
+            }
+            builder.build(*engine, entities[i]);
+            tcm.create(entities[i], {}, mat4f::translation(randomPosition(1000.0f, 0.0f)));
+        }
+
+        for (size_t i = 0; i < lightCount; i++) {
+            LightManager::Builder(LightManager::Type::POINT)
+                    .position(randomPosition(200.0f, 2.0f))
+                    .falloff(10.0f)
+                    .intensity(100000.0f)
+                    .build(*engine, entities[renderableCount + i]);
+        }
+
+        if (cascadeCount) {
+            LightManager::ShadowOptions options;
+            options.shadowCascades = cascadeCount;
+            LightManager::Builder(LightManager::Type::SUN)
+                    .direction({ 0.3f, -1.0f, -0.2f })
+                    .castShadows(true)
+                    .shadowOptions(options)
+                    .build(*engine, entities.back());
+        }
+
+        scene->addEntities(entities.data(), entities.size());
+        bones.resize(BONE_COUNT);
+    }
+
+    void TearDown(benchmark::State&) override {
+        for (utils::Entity e : entities) {
+            engine->destroy(e);
+        }
+        utils::EntityManager::get().destroy(entities.size(), entities.data());
+        engine->destroyCameraComponent(cameraEntity);
+        utils::EntityManager::get().destroy(cameraEntity);
+        engine->destroy(vertexBuffer);
+        engine->destroy(indexBuffer);
+        engine->destroy(swapChain);
+        engine->destroy(renderer);
+        engine->destroy(view);
+        engine->destroy(scene);
+        Engine::destroy(&engine);
+        entities.clear();
+    }
+
+protected:
+    // updates the bones of all the skinned renderables
+    void animate() noexcept {
+        RenderableManager& rcm = engine->getRenderableManager();
+        const float t = float(frameId) * 0.01f;
+        for (size_t i = 0; i < BONE_COUNT; i++) {
+            bones[i] = mat4f::rotation(t + float(i), float3{ 0, 1, 0 });
+        }
+        for (size_t i = 0; i < skinnedCount; i++) {
+            rcm.setBones(rcm.getInstance(entities[i]), bones.data(), BONE_COUNT);
+        }
+    }
+
+    // prepares the view for a new frame, as the Renderer would
+    void prepare(ArenaScope& arena) noexcept {
+        FEngine& e = upcast(*engine);
+        if (skinnedCount) {
+            animate();
+        }
+        upcast(view)->prepare(e, e.getDriverApi(), arena, viewport, {}, ++frameId);
+    }
+};
+
+// The whole frame, from Renderer::beginFrame() to Renderer::endFrame()
+BENCHMARK_DEFINE_F(SceneFixture, frame)(benchmark::State& state) {
+    for (auto _ : state) {
+        if (skinnedCount) {
+            animate();
+        }
+        if (renderer->beginFrame(swapChain)) {
+            renderer->render(view);
+            renderer->endFrame();
+        }
+        frameId++;
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * renderableCount));
+}
+
+// FView::prepare(), which includes FScene::prepare(), culling and shadow map setup
+BENCHMARK_DEFINE_F(SceneFixture, viewPrepare)(benchmark::State& state) {
+    FEngine& e = upcast(*engine);
+    for (auto _ : state) {
+        ArenaScope arena(e.getPerRenderPassAllocator());
+        prepare(arena);
+        state.PauseTiming();
+        e.flush();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * renderableCount));
+}
+
+// FScene::prepare() when all renderables must be rebuilt, here because the world origin moves
+BENCHMARK_DEFINE_F(SceneFixture, scenePrepare)(benchmark::State& state) {
+    FScene& s = upcast(*scene);
+    for (auto _ : state) {
+        ++frameId;
+        s.prepare(mat4::translation(double3{ 0, 0, frameId & 1u }), frameId);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * renderableCount));
+}
+
+// Frustum culling of all the renderables
+BENCHMARK_DEFINE_F(SceneFixture, culling)(benchmark::State& state) {
+    FEngine& e = upcast(*engine);
+    FScene& s = upcast(*scene);
+    s.prepare({}, ++frameId);
+    const Frustum frustum = upcast(camera)->getFrustum();
+    for (auto _ : state) {
+        FView::cullRenderables(e.getJobSystem(), s, frustum, VISIBLE_RENDERABLE_BIT);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * renderableCount));
+}
+
+// Assignment of the visible lights to froxels
+BENCHMARK_DEFINE_F(SceneFixture, froxelization)(benchmark::State& state) {
+    FEngine& e = upcast(*engine);
+    ArenaScope arena(e.getPerRenderPassAllocator());
+    prepare(arena);
+    for (auto _ : state) {
+        upcast(view)->froxelize(e);
+    }
+    e.flush();
+}
+
+// Generation of the color pass commands of the visible renderables, and their sort
+static void commandsBenchmark(benchmark::State& state, FEngine& e, FView& v, bool sort) {
+    FScene& s = *v.getScene();
+    const size_t count = FEngine::CONFIG_PER_FRAME_COMMANDS_SIZE /
+            (sizeof(RenderPass::Command) + sizeof(RenderPass::PrimitiveInfo));
+    for (auto _ : state) {
+        ArenaScope arena(e.getPerRenderPassAllocator());
+        utils::GrowingSlice<RenderPass::Command> commands(
+                arena.allocate<RenderPass::Command>(count, utils::CACHELINE_SIZE), count);
+        utils::GrowingSlice<RenderPass::PrimitiveInfo> primitiveInfos(
+                arena.allocate<RenderPass::PrimitiveInfo>(count, utils::CACHELINE_SIZE), count);
+        RenderPass pass(e, commands, primitiveInfos);
+        pass.setCamera(v.getCameraInfo());
+        pass.setGeometry(s.getRenderableData(), v.getVisibleRenderables(), s.getRenderableUBO());
+        if (sort) {
+            state.PauseTiming();
+            pass.appendCommands(RenderPass::COLOR);
+            state.ResumeTiming();
+            pass.sortCommands();
+        } else {
+            pass.appendCommands(RenderPass::COLOR);
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * v.getVisibleRenderables().size()));
+}
+
+BENCHMARK_DEFINE_F(SceneFixture, commandGeneration)(benchmark::State& state) {
+    FEngine& e = upcast(*engine);
+    ArenaScope arena(e.getPerRenderPassAllocator());
+    prepare(arena);
+    commandsBenchmark(state, e, upcast(*view), false);
+    e.flush();
+}
+
+BENCHMARK_DEFINE_F(SceneFixture, commandSort)(benchmark::State& state) {
+    FEngine& e = upcast(*engine);
+    ArenaScope arena(e.getPerRenderPassAllocator());
+    prepare(arena);
+    commandsBenchmark(state, e, upcast(*view), true);
+    e.flush();
+}
+
+// renderables, point lights, sun cascades, skinned renderables
+static void sceneArguments(benchmark::internal::Benchmark* b) {
+    b->ArgNames({ "renderables", "lights", "cascades", "skinned" });
+    b->Args({  10000,   0, 0,   0 });
+    b->Args({ 100000,   0, 0,   0 });
+    b->Args({  10000, 256, 0,   0 });
+    b->Args({  10000,   0, 4,   0 });
+    b->Args({   2000,   0, 0, 128 });
+    b->Unit(benchmark::kMicrosecond);
+}
+
+BENCHMARK_REGISTER_F(SceneFixture, frame)->Apply(sceneArguments);
+BENCHMARK_REGISTER_F(SceneFixture, viewPrepare)->Apply(sceneArguments);
+BENCHMARK_REGISTER_F(SceneFixture, scenePrepare)->Apply(sceneArguments);
+BENCHMARK_REGISTER_F(SceneFixture, culling)->Apply(sceneArguments);
+BENCHMARK_REGISTER_F(SceneFixture, froxelization)->Apply(sceneArguments);
+BENCHMARK_REGISTER_F(SceneFixture, commandGeneration)->Apply(sceneArguments);
+BENCHMARK_REGISTER_F(SceneFixture, commandSort)->Apply(sceneArguments);
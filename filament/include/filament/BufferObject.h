@@ -51,6 +51,7 @@ class UTILS_PUBLIC BufferObject : public FilamentAPI {
 public:
     using BufferDescriptor = backend::BufferDescriptor;
     using BindingType = backend::BufferObjectBinding;
+    using BufferUsage = backend::BufferUsage;
 
     class Builder : public BuilderBase<BuilderDetails> {
         friend struct BuilderDetails;
@@ -76,6 +77,18 @@ public:
          */
         Builder& bindingType(BindingType bindingType) noexcept;
 
+        /**
+         * How often the content of this buffer object is modified. (defaults to STATIC)
+         *
+         * DYNAMIC and STREAM buffer objects are meant to be rewritten every frame, e.g. for
+         * particles, cloth or text. They can be updated with map() and unmap(), which avoids
+         * allocating and copying a BufferDescriptor for each update.
+         *
+         * @param usage STATIC, DYNAMIC or STREAM.
+         * @return A reference to this Builder for chaining calls.
+         */
+        Builder& usage(BufferUsage usage) noexcept;
+
         /**
          * Creates the BufferObject and returns a pointer to it. After creation, the buffer
          * object is uninitialized. Use BufferObject::setBuffer() to initialize it.
@@ -105,6 +118,37 @@ public:
      */
     void setBuffer(Engine& engine, BufferDescriptor&& buffer, uint32_t byteOffset = 0);
 
+    /**
+     * Returns byteCount bytes of memory to write the new content of this BufferObject into.
+     *
+     * The memory is taken from a ring of storage owned by the BufferObject, with one region per
+     * frame in flight. unmap() hands the region to the backend without copying it, and the
+     * region is reused only after the backend uploaded it, so the application can write into
+     * the returned memory directly every frame. If the backend is more than a few frames
+     * behind, map() waits for it.
+     *
+     * The content of the returned memory is undefined, only the range given to unmap() is
+     * uploaded. map() and unmap() must be called on the thread that created the Engine, and
+     * the BufferObject must have been built with a DYNAMIC or STREAM usage.
+     *
+     * @param engine Reference to the filament::Engine associated with this BufferObject.
+     * @return A pointer to byteCount bytes of memory, valid until unmap() is called.
+     *
+     * @see unmap
+     */
+    void* map(Engine& engine);
+
+    /**
+     * Uploads the range of the memory returned by map() written by the application.
+     *
+     * @param engine Reference to the filament::Engine associated with this BufferObject.
+     * @param byteOffset Offset in bytes of the range written, in the BufferObject.
+     * @param byteCount Size in bytes of the range written.
+     *
+     * @see map
+     */
+    void unmap(Engine& engine, uint32_t byteOffset, uint32_t byteCount);
+
     /**
      * Returns the size of this BufferObject in elements.
      * @return The maximum capacity of the BufferObject.
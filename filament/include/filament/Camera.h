@@ -328,6 +328,16 @@ public:
      */
     void setModelMatrix(const math::mat4f& view) noexcept;
 
+    /**
+     * Same as above, with a double precision translation, which is kept when the
+     * TransformManager's accurate translation mode is enabled.
+     *
+     * @param view The camera position and orientation provided as a rigid transform matrix.
+     *
+     * @see TransformManager::setAccurateTranslationsEnabled()
+     */
+    void setModelMatrix(const math::mat4& view) noexcept;
+
     /** Sets the camera's view matrix
      *
      * @param eye       The position of the camera in world space.
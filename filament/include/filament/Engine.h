@@ -418,6 +418,33 @@ public:
     bool destroy(const View* p);                //!< Destroys a View object.
     void destroy(utils::Entity e);              //!< Destroys all filament-known components from this entity
 
+    /**
+     * Queues objects for destruction at the beginning of the next frames, within the budget set
+     * by setDestructionBudget(). Objects are destroyed in the order they are queued, so a
+     * MaterialInstance queued before its Material is destroyed first. Queued objects must not be
+     * used anymore, and objects they depend on must not be destroyed before them.
+     *
+     * This is intended for tearing down large numbers of objects, for instance when unloading
+     * a level, without stalling a single frame.
+     *
+     * @param p Object to destroy, nullptr is ignored.
+     */
+    void destroyDeferred(const BufferObject* p);
+    void destroyDeferred(const VertexBuffer* p);    //!< \see destroyDeferred(const BufferObject*)
+    void destroyDeferred(const IndexBuffer* p);     //!< \see destroyDeferred(const BufferObject*)
+    void destroyDeferred(const Texture* p);         //!< \see destroyDeferred(const BufferObject*)
+    void destroyDeferred(const MaterialInstance* p); //!< \see destroyDeferred(const BufferObject*)
+    void destroyDeferred(const Material* p);        //!< \see destroyDeferred(const BufferObject*)
+
+    /**
+     * Queues the destruction of all filament-known components of the given entities, like
+     * destroy(utils::Entity), see destroyDeferred(const BufferObject*).
+     *
+     * @param entities Entities whose components to destroy.
+     * @param count Number of entities.
+     */
+    void destroyDeferred(utils::Entity const* entities, size_t count);
+
     /**
      * Kicks the hardware thread (e.g. the OpenGL, Vulkan or Metal thread) and blocks until
      * all commands to this point are executed. Note that this doesn't guarantee that the
@@ -491,6 +518,175 @@ public:
 
     DebugRegistry& getDebugRegistry() noexcept;
 
+    /**
+     * Sets the budget of the cache of transient textures, such as the render targets of the
+     * post-processing passes. Textures that are no longer used by a frame are kept in this cache
+     * so they can be reused by the next frames without being allocated again.
+     *
+     * When the cache exceeds its capacity, the least recently used textures are released, and
+     * textures left unused for more than maxAge frames are released regardless.
+     *
+     * Lower the capacity on low-memory devices; raise it when rendering at high resolutions.
+     *
+     * @param capacity  Capacity of the cache in bytes, 64 MiB by default.
+     * @param maxAge    Number of frames after which an unused texture is released, 30 by default.
+     */
+    void setTransientTextureCacheBudget(size_t capacity, uint32_t maxAge = 30) noexcept;
+
+    /**
+     * Sets how many bytes of uploads issued from other threads are processed per frame.
+     *
+     * BufferObject::setBuffer(), VertexBuffer::setBufferAt(), IndexBuffer::setBuffer() and
+     * Texture::setImage() can be called from any thread. Calls made from the thread that created
+     * the Engine are processed immediately. Calls made from other threads are queued, then
+     * processed in order at the beginning of the next frames, at the rate set here. At least one
+     * queued upload is processed per frame. Destroying any object, flushAndWait() and shutdown()
+     * process all pending uploads first.
+     *
+     * Spreading large uploads over several frames, for instance when streaming assets, avoids
+     * stalling the frames they are issued in.
+     *
+     * @param bytesPerFrame Maximum number of bytes to upload per frame, unlimited by default.
+     */
+    void setUploadBudget(size_t bytesPerFrame) noexcept;
+
+    /**
+     * Sets how much time is spent per frame destroying the objects queued with
+     * destroyDeferred(), and separately collecting the components of entities that were
+     * destroyed by their utils::EntityManager. At least one queued object is destroyed per frame,
+     * components left over are collected by the following frames. shutdown() destroys all
+     * queued objects first.
+     *
+     * @param nanosecondsPerFrame Maximum time spent on each per frame, unlimited by default.
+     */
+    void setDestructionBudget(uint64_t nanosecondsPerFrame) noexcept;
+
+    /**
+     * Enables or disables asynchronous compilation of shader programs.
+     *
+     * When enabled, renderables are not drawn while the program needed by their material is
+     * still being compiled, instead of stalling the frame until it is ready. They appear in
+     * the first frame after their program is ready, Material::isReady() can be used to find out
+     * when that is. Only backends able to compile programs in the background take advantage of
+     * this, currently OpenGL with KHR_parallel_shader_compile.
+     *
+     * Asynchronous compilation is disabled by default.
+     *
+     * @param enabled true to skip drawing renderables whose program is not ready.
+     */
+    void setAsynchronousProgramCompilation(bool enabled) noexcept;
+
+    /**
+     * Enables or disables releasing the shader sources of materials once their programs are
+     * created.
+     *
+     * Materials decode the shader sources stored in their package (compressed text, or smol-v
+     * encoded SPIR-V) the first time a program needs them, and keep them to create the
+     * following programs. When enabled, the decoded sources are freed as soon as the programs
+     * are created, and decoded again from the package if a new variant is needed later. This
+     * saves memory when many materials are loaded, at the cost of decoding the sources again.
+     *
+     * Releasing is disabled by default.
+     *
+     * @param enabled true to release the decoded shader sources after creating programs.
+     */
+    void setShaderSourceRelease(bool enabled) noexcept;
+
+    //! Statistics of the command buffer, see getCommandBufferStatistics()
+    struct CommandBufferStatistics {
+        size_t capacity;        //!< bytes of commands that can be recorded between two flushes
+        size_t highWatermark;   //!< most bytes of commands waiting for the driver thread so far
+        size_t lastFrameSize;   //!< bytes of commands recorded by the last frame
+        size_t peakFrameSize;   //!< most bytes of commands recorded by a single frame so far
+    };
+
+    /**
+     * Returns statistics about the buffer holding the commands sent to the driver thread, which
+     * can be used to choose its size (see FILAMENT_MIN_COMMAND_BUFFERS_SIZE_IN_MB).
+     *
+     * Frames that record more than the capacity are split into several flushes, which can
+     * stall until the driver thread catches up.
+     */
+    CommandBufferStatistics getCommandBufferStatistics() const noexcept;
+
+    //! Statistics of the transient texture cache, see getTransientTextureCacheStatistics()
+    struct TransientTextureCacheStatistics {
+        size_t hitCount;    //!< number of textures reused from the cache
+        size_t missCount;   //!< number of textures that had to be allocated
+        size_t cacheSize;   //!< size in bytes of the unused textures kept in the cache
+        size_t inUseSize;   //!< size in bytes of the transient textures currently in use
+        size_t peakSize;    //!< highest total size in bytes of the transient textures so far
+    };
+
+    /**
+     * Returns statistics about the transient texture cache, which can be used to choose its
+     * budget.
+     *
+     * @see setTransientTextureCacheBudget()
+     */
+    TransientTextureCacheStatistics getTransientTextureCacheStatistics() const noexcept;
+
+    //! GPU memory allocated by the backend, see getMemoryStats()
+    struct MemoryStats {
+        size_t textures;        //!< bytes of the textures that can't be rendered into
+        size_t renderTargets;   //!< bytes of the textures rendered into, e.g. shadow maps
+        size_t buffers;         //!< bytes of the vertex, index and uniform buffers
+        size_t staging;         //!< bytes of the buffers pooled by the backend for uploads
+        size_t transientCache;  //!< bytes of renderTargets kept by the transient texture cache
+        size_t total;           //!< sum of textures, renderTargets, buffers and staging
+    };
+
+    /**
+     * Returns the GPU memory currently allocated by the backend, by category.
+     *
+     * The sizes are counted by the backend when it creates and destroys resources, from their
+     * dimensions and formats. They don't include the alignment and padding added by the GPU
+     * driver, nor the swap chains. On Metal, buffers are allocated from the staging pool and
+     * are counted in MemoryStats::staging.
+     */
+    MemoryStats getMemoryStats() const noexcept;
+
+    /**
+     * Callback used with setMemoryBudget().
+     *
+     * @param engine    The Engine whose budget is exceeded.
+     * @param stats     The memory statistics that exceeded the budget.
+     * @param user      User provided parameter given in setMemoryBudget().
+     */
+    using MemoryBudgetCallback = void(*)(Engine* engine, MemoryStats const& stats, void* user);
+
+    /**
+     * Sets a budget for the GPU memory allocated by the backend.
+     *
+     * Once per frame, in Renderer::beginFrame(), MemoryStats::total is compared to the budget
+     * and the callback is called if it exceeds it, which gives the application a chance to
+     * lower its quality settings (e.g. shadow map resolution, texture sizes) before the system
+     * runs out of memory. The callback is called again only after the total went back under
+     * the budget. It is called on the thread calling Renderer::beginFrame().
+     *
+     * @param bytes     Budget in bytes, 0 to disable the budget (the default).
+     * @param callback  Called when the budget is exceeded.
+     * @param user      User provided parameter given back to the callback unmodified.
+     */
+    void setMemoryBudget(size_t bytes, MemoryBudgetCallback callback,
+            void* user = nullptr) noexcept;
+
+    //! Time spent creating the engine, see getStartupTimings()
+    struct StartupTimings {
+        uint64_t driverInit;        //!< nanoseconds spent creating the platform and the driver
+        uint64_t engineInit;        //!< nanoseconds spent creating the engine's default resources
+        uint64_t defaultMaterial;   //!< nanoseconds of engineInit spent on the default material
+    };
+
+    /**
+     * Returns the breakdown of the time it took to create this Engine.
+     *
+     * Resources that are rarely needed at startup, like the post-processing materials and the
+     * DFG lookup table, are created the first time they're used instead, so their cost is
+     * accounted to the first frame or View using them.
+     */
+    StartupTimings getStartupTimings() const noexcept;
+
 protected:
     //! \privatesection
     Engine() noexcept = default;
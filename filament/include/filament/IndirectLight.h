@@ -281,6 +281,31 @@ public:
      */
     const math::mat3f& getRotation() const noexcept;
 
+    /**
+     * Replaces the reflections cubemap, for instance with an environment captured at runtime.
+     * The previous texture is not destroyed, and the new one is used from the next frame.
+     *
+     * The environment can be captured by rendering a View into each face of a cubemap with
+     * RenderTarget::Builder::face(), one face per frame to spread the cost. The mip levels can
+     * then be prefiltered over several frames, see Texture::PrefilterOptions.
+     *
+     * @param cubemap A cubemap texture with a prefiltered mip chain, see Builder::reflections().
+     */
+    void setReflections(Texture const* cubemap) noexcept;
+
+    /**
+     * Updates the spherical harmonics of the irradiance in place, they take effect from the
+     * next frame. This has no effect if an irradiance cubemap was set with the Builder.
+     *
+     * The coefficients of a captured environment can be obtained with ibl::CubemapSH, face by
+     * face to spread the cost, and pre-scaled with CubemapSH::preprocessSHForShader().
+     *
+     * @param bands Number of spherical harmonics bands. Must be 1, 2 or 3.
+     * @param sh    Array containing the pre-scaled spherical harmonics coefficients, see
+     *              Builder::irradiance(uint8_t bands, math::float3 const* sh).
+     */
+    void setIrradiance(uint8_t bands, math::float3 const* sh) noexcept;
+
     /**
      * Returns the associated reflection map, or null if it does not exist.
      */
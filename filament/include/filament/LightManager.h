@@ -267,6 +267,16 @@ public:
          */
         bool stable = false;
 
+        /**
+         * Only used with stable shadows, for the directional light. Each cascade is divided in
+         * 16x16 pages, and only moves by whole pages as the camera moves. Its shadow map then
+         * stays the same while the camera remains within a page, so when shadow map caching is
+         * enabled (see View::setShadowMapCachingEnabled()), it is only rendered again when the
+         * camera crosses a page or its shadow casters change. This is most useful for the far
+         * cascades of very large scenes, at the cost of about 11% of their resolution.
+         */
+        bool cascadePaging = false;
+
         /**
          * Constant bias in depth-resolution units by which shadows are moved away from the
          * light. The default value of 0.5 is used to round depth values up.
@@ -666,6 +676,17 @@ public:
     //! returns the light's position in world space
     const math::float3& getPosition(Instance i) const noexcept;
 
+    /**
+     * Updates the positions of several lights at once, this is equivalent to, but faster than
+     * calling setPosition() for each of them.
+     *
+     * @param instances Array of \p count instances obtained from getInstance().
+     * @param positions Array of \p count positions in world space.
+     * @param count     Number of lights to update.
+     */
+    void setPositions(Instance const* instances, const math::float3* positions,
+            size_t count) noexcept;
+
     /**
      * Dynamically updates the light's direction
      *
@@ -748,6 +769,18 @@ public:
      */
     void setIntensityCandela(Instance i, float intensity) noexcept;
 
+    /**
+     * Updates the intensities of several lights at once, this is equivalent to calling
+     * setIntensity(Instance, float) for each of them.
+     *
+     * @param instances     Array of \p count instances obtained from getInstance().
+     * @param intensities   Array of \p count intensities, in *lux* for directional lights and
+     *                      in *lumen* for point lights and spot lights.
+     * @param count         Number of lights to update.
+     */
+    void setIntensities(Instance const* instances, const float* intensities,
+            size_t count) noexcept;
+
     /**
      * returns the light's luminous intensity in lumen.
      *
@@ -105,6 +105,26 @@ public:
          */
         Builder& package(const void* payload, size_t size);
 
+        //! Called when a Material no longer references a package passed in place.
+        using PackageReleaseCallback = void(*)(void* payload, size_t size, void* user);
+
+        /**
+         * Specifies the material data without copying it. The package is referenced in place
+         * (for instance in a memory-mapped .filamat file) for the whole lifetime of the Material,
+         * and its shaders are only decoded when their variants are first used. This reduces the
+         * time spent in build() and the memory used by large material libraries.
+         * The callback is called once per Material built, so a package passed this way should
+         * only be used to build a single Material.
+         *
+         * @param payload Pointer to the material data, must stay valid until "callback" is called.
+         * @param size Size of the material data pointed to by "payload" in bytes.
+         * @param callback Called when the package is no longer referenced, typically when the
+         *                 Material is destroyed. Must not be null.
+         * @param user Opaque pointer passed to the callback.
+         */
+        Builder& package(const void* payload, size_t size,
+                PackageReleaseCallback callback, void* user = nullptr);
+
         /**
          * Creates the Material object and returns a pointer to it.
          *
@@ -118,6 +138,29 @@ public:
          * @exception utils::PreConditionPanic if a parameter to a builder function was invalid.
          */
         Material* build(Engine& engine);
+
+        //! Called by buildAsync() once the Material is created, or with nullptr on failure.
+        using BuildCallback = void(*)(Material* material, void* user);
+
+        /**
+         * Creates the Material object without blocking the calling thread.
+         *
+         * The package is parsed on one of the engine's worker threads. The Material itself is
+         * then created on the thread the Engine was created on, in the next
+         * Renderer::beginFrame(), and handed to the callback from that thread. Its shader
+         * programs are created as with build(), asynchronously if
+         * Engine::setAsynchronousProgramCompilation() is enabled.
+         *
+         * This must be called from the thread the Engine was created on. The Builder can be
+         * destroyed right away, but the package must stay valid until the callback is called.
+         * The callback isn't called if the Engine is destroyed first.
+         *
+         * @param engine Reference to the filament::Engine to associate this Material with.
+         * @param callback Called with the new Material, or nullptr if it couldn't be built.
+         *                 Must not be null.
+         * @param user Opaque pointer passed to the callback.
+         */
+        void buildAsync(Engine& engine, BuildCallback callback, void* user = nullptr);
     private:
         friend class FMaterial;
     };
@@ -277,6 +320,45 @@ public:
 
     //! Returns this material's default instance.
     MaterialInstance const* getDefaultInstance() const noexcept;
+
+    /**
+     * Indicates whether all the shader programs this material has needed so far are compiled.
+     *
+     * Programs are created the first time a variant of the material is drawn. When asynchronous
+     * program compilation is enabled (see Engine::setAsynchronousProgramCompilation()),
+     * renderables using a program that is still compiling are not drawn. This can be used, for
+     * instance, to keep a loading screen up until the materials of a scene are ready.
+     *
+     * @return true if no program of this material is still compiling.
+     */
+    bool isReady() const noexcept;
+
+    /**
+     * Callback used with compile(), called once all the programs it requested are ready.
+     *
+     * @param material  The material compile() was called on.
+     * @param user      User provided parameter given in compile().
+     */
+    using CompilationCallback = void(*)(Material* material, void* user);
+
+    /**
+     * Creates the programs of this material's variants ahead of time, instead of the first time
+     * each one is drawn. This can be used to keep all shader compilation within a loading phase.
+     *
+     * The programs are created by the backend, off the calling thread. The depth variants are
+     * always included, and variants the material package doesn't contain are ignored.
+     *
+     * This must be called from the thread the Engine was created on. The callback, if any, is
+     * called from that thread too, in the first Renderer::beginFrame() after all the programs
+     * of the material are ready (see isReady()). It isn't called if the material is destroyed
+     * before then.
+     *
+     * @param variants  Which variants to create, all of them by default.
+     * @param callback  Called once the programs are ready, can be nullptr.
+     * @param user      User provided parameter given back to the callback unmodified.
+     */
+    void compile(UserVariantFilterMask variants = UserVariantFilterMask(UserVariantFilterBit::ALL),
+            CompilationCallback callback = nullptr, void* user = nullptr) noexcept;
 };
 
 } // namespace filament
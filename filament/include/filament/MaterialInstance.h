@@ -92,6 +92,20 @@ public:
     template<typename T, typename = is_supported_parameter_t<T>>
     void setParameter(const char* name, const T* values, size_t count) noexcept;
 
+    /**
+     * Set the same uniform on several instances, which is faster than calling setParameter()
+     * on each of them, in particular when they share the same Material.
+     *
+     * @param name      Name of the parameter as defined by the instances' Material.
+     *                  Cannot be nullptr.
+     * @param instances Array of count MaterialInstance. Cannot be nullptr.
+     * @param values    Array of count values, values[i] is set on instances[i].
+     * @param count     Number of instances.
+     */
+    template<typename T, typename = is_supported_parameter_t<T>>
+    static void setParameterBatch(const char* name,
+            MaterialInstance* const* instances, const T* values, size_t count) noexcept;
+
     /**
      * Set a texture as the named parameter
      *
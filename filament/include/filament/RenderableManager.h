@@ -239,6 +239,20 @@ public:
          */
         Builder& screenSpaceContactShadows(bool enable) noexcept;
 
+        /**
+         * Marks the blended primitives of this renderable as order-independent, false by default.
+         *
+         * Order-independent primitives are not sorted by distance to the camera. They are drawn
+         * after the sorted blended primitives of the same priority, grouped by material and then
+         * by blend order, and always in a single pass (their material's TransparencyMode is
+         * ignored). This saves sorting and draw calls for content whose blending is commutative,
+         * such as additive or multiplicative particles, where the order of the draws doesn't
+         * change the result.
+         *
+         * This has no effect on opaque and masked primitives.
+         */
+        Builder& orderIndependentBlending(bool enable) noexcept;
+
         /**
          * Enables GPU vertex skinning for up to 255 bones, 0 by default.
          *
@@ -275,6 +289,73 @@ public:
          */
         Builder& blendOrder(size_t primitiveIndex, uint16_t order) noexcept;
 
+        /**
+         * Specifies the number of draw instances of this renderable. The default is 1 instance and
+         * the maximum number of instances allowed is 65535. 0 is invalid.
+         *
+         * All instances are drawn with a single draw call per primitive and share the same
+         * transform, bounding box and material instance. Care must be taken to make sure all
+         * instances render inside the specified bounding box, since culling is performed once for
+         * the whole renderable.
+         *
+         * The material's vertex shader can use gl_InstanceID (or getInstanceIndex() when
+         * available) to fetch per-instance data, e.g. from a material parameter array, and
+         * adjust the position or transform accordingly.
+         *
+         * @param instanceCount the number of instances, silently clamped between 1 and 65535.
+         */
+        Builder& instances(size_t instanceCount) noexcept;
+
+        /**
+         * Sets the number of levels of detail of this renderable, 1 by default, up to 4.
+         *
+         * Level 0 is the geometry given with geometry(), each following level uses the
+         * geometry of the previous level unless it is given with geometryLod(). The level
+         * used for rendering is selected every frame from the screen size of the renderable,
+         * see lodScreenSizes().
+         *
+         * @param count number of levels of detail, silently clamped between 1 and 4.
+         */
+        Builder& levelsOfDetail(size_t count) noexcept;
+
+        /**
+         * Specifies the indices of a coarser level of detail of a primitive. The vertex buffer
+         * and primitive type are the ones of level 0. This implicitly increases the number of
+         * levels of detail to at least level + 1.
+         *
+         * @param index zero-based index of the primitive, must be less than the count given to
+         *              Builder constructor
+         * @param level level of detail, between 1 and 3
+         * @param indices the index buffer of this level, possibly shared with other levels
+         * @param offset specifies where in the index buffer to start reading
+         * @param count number of indices to read
+         */
+        Builder& geometryLod(size_t index, size_t level,
+                IndexBuffer* indices, size_t offset, size_t count) noexcept;
+
+        /**
+         * Sets the screen sizes below which the coarser levels of detail are used. The screen
+         * size of a renderable is the diameter of its bounding sphere divided by the height
+         * of the viewport. Level i is used below screenSizes[i - 1], with some hysteresis
+         * to avoid switching back and forth between two levels. The defaults are
+         * { 0.5, 0.25, 0.125 }.
+         *
+         * @param screenSizes decreasing screen sizes, one per level of detail after level 0
+         * @param count number of screen sizes, at most 3
+         */
+        Builder& lodScreenSizes(float const* screenSizes, size_t count) noexcept;
+
+        /**
+         * Sets the screen size below which the renderable is shaded with fewer lights: it
+         * ignores the point and spot lights and does not receive shadows. This is meant for
+         * small or distant objects, where these contributions cover a handful of pixels but
+         * still cost the full lighting loop. The screen size is the one of lodScreenSizes(),
+         * and the same hysteresis applies. Disabled by default.
+         *
+         * @param screenSize screen size below which shading is reduced, 0 to disable
+         */
+        Builder& shadingLodScreenSize(float screenSize) noexcept;
+
         /**
          * Adds the Renderable component to an entity.
          *
@@ -317,6 +398,14 @@ public:
      */
     void destroy(utils::Entity e) noexcept;
 
+    /**
+     * Destroys the renderable components of a batch of entities. Entities without a
+     * renderable component are ignored.
+     * @param count     Number of entities in the array.
+     * @param entities  Array of entities.
+     */
+    void destroy(size_t count, utils::Entity const* entities) noexcept;
+
     /**
      * Changes the bounding box used for frustum culling.
      *
@@ -369,6 +458,13 @@ public:
      */
     void setScreenSpaceContactShadows(Instance instance, bool enable) noexcept;
 
+    /**
+     * Changes whether the blended primitives of the renderable are order-independent.
+     *
+     * \see Builder::orderIndependentBlending()
+     */
+    void setOrderIndependentBlending(Instance instance, bool enable) noexcept;
+
     /**
      * Checks if the renderable can cast shadows.
      *
@@ -423,7 +519,14 @@ public:
     size_t getPrimitiveCount(Instance instance) const noexcept;
 
     /**
-     * Changes the material instance binding for the given primitive.
+     * Gets the immutable number of levels of detail in the given renderable.
+     *
+     * \see Builder::levelsOfDetail()
+     */
+    size_t getLevelOfDetailCount(Instance instance) const noexcept;
+
+    /**
+     * Changes the material instance binding for the given primitive, in all levels of detail.
      *
      * \see Builder::material()
      */
@@ -436,7 +539,7 @@ public:
     MaterialInstance* getMaterialInstanceAt(Instance instance, size_t primitiveIndex) const noexcept;
 
     /**
-     * Changes the geometry for the given primitive.
+     * Changes the geometry for the given primitive, in all levels of detail.
      *
      * \see Builder::geometry()
      */
@@ -445,7 +548,8 @@ public:
             size_t offset, size_t count) noexcept;
 
     /**
-     * Changes the active range of indices or topology for the given primitive.
+     * Changes the active range of indices or topology for the given primitive, in all levels
+     * of detail.
      *
      * \see Builder::geometry()
      */
@@ -453,7 +557,25 @@ public:
             PrimitiveType type, size_t offset, size_t count) noexcept;
 
     /**
-     * Changes the ordering index for blended primitives that all live at the same Z value.
+     * Changes the geometry for the given primitive, in a single level of detail.
+     * The level must be less than getLevelOfDetailCount().
+     *
+     * \see Builder::geometryLod()
+     */
+    void setLodGeometryAt(Instance instance, size_t primitiveIndex, size_t level,
+            PrimitiveType type, VertexBuffer* vertices, IndexBuffer* indices,
+            size_t offset, size_t count) noexcept;
+
+    /**
+     * Changes the screen size below which the renderable is shaded with fewer lights.
+     *
+     * \see Builder::shadingLodScreenSize()
+     */
+    void setShadingLodScreenSize(Instance instance, float screenSize) noexcept;
+
+    /**
+     * Changes the ordering index for blended primitives that all live at the same Z value,
+     * in all levels of detail.
      *
      * \see Builder::blendOrder()
      *
@@ -135,6 +135,99 @@ public:
         bool discard = true;
     };
 
+    /**
+     * A View rendered by renderBatch().
+     */
+    struct BatchJob {
+        /** View to render */
+        View* view = nullptr;
+        /** RenderTarget to render into, or nullptr to use the View's own RenderTarget */
+        RenderTarget* renderTarget = nullptr;
+        /**
+         * Called after the view is rendered and before its frame ends, typically to call
+         * readPixels(). The pixels are delivered once the GPU has completed the job.
+         */
+        void (*rendered)(Renderer* renderer, BatchJob const& job, void* user) = nullptr;
+        /** user data passed to the callback above */
+        void* user = nullptr;
+    };
+
+    /**
+     * Options of renderBatch().
+     */
+    struct BatchOptions {
+        /**
+         * Number of jobs the GPU can be behind the CPU, at least 1. Higher values overlap more
+         * CPU and GPU work, at the cost of the memory used by the jobs in flight.
+         */
+        uint8_t inFlightBudget = 2;
+    };
+
+    /**
+     * FrameTimings are the CPU and GPU timings of a frame, see getFrameTimings().
+     *
+     * The CPU times are summed over all the views rendered in the frame. The GPU times of the
+     * passes are only measured when enabled with setPassTimingsEnabled(). At most
+     * MAX_PASS_COUNT passes are timed in a frame, the time of passes that don't fit is
+     * included in the pass before them.
+     *
+     * The hardware counters of the CPU phases are only sampled when the debug property
+     * "d.renderer.performance_counters" is set, and only on Linux with access to perf events.
+     * They only count the thread running each phase, not the jobs it hands off to other threads.
+     */
+    struct FrameTimings {
+        static constexpr size_t MAX_PASS_COUNT = 48;
+        struct Pass {
+            const char* name = nullptr;     //!< name of the pass, valid for as long as the Engine
+            float gpuTime = 0.0f;           //!< GPU time of the pass in seconds
+        };
+        struct Counters {
+            uint64_t instructions = 0;      //!< instructions retired
+            uint64_t cpuCycles = 0;         //!< CPU cycles
+            uint64_t cacheMisses = 0;       //!< cache misses, usually of the last-level cache
+            uint64_t branchMisses = 0;      //!< mispredicted branches
+        };
+        uint32_t frameId = 0;               //!< frame these timings belong to, 0 if none yet
+        float gpuFrameTime = 0.0f;          //!< GPU time of the whole frame in seconds
+        float cullingTime = 0.0f;           //!< CPU time of the culling in seconds
+        float froxelizationTime = 0.0f;     //!< CPU time of the froxelization in seconds
+        float commandGenerationTime = 0.0f; //!< CPU time of generating draw commands in seconds
+        Counters cullingCounters;           //!< hardware counters of the culling
+        Counters froxelizationCounters;     //!< hardware counters of the froxelization
+        Counters commandGenerationCounters; //!< hardware counters of generating draw commands
+        uint32_t passCount = 0;             //!< number of valid entries in passes
+        Pass passes[MAX_PASS_COUNT];        //!< GPU time of each pass, in execution order
+    };
+
+    /**
+     * RenderStats counts the work recorded by the passes drawing renderables in a frame (color,
+     * depth and shadow passes), see getRenderStats(). The draws of post-processing passes are
+     * not counted.
+     *
+     * These are the commands Filament records, the backends may elide some redundant state
+     * changes on their own. At most MAX_PASS_COUNT passes are listed in a frame, the counts of
+     * passes that don't fit are included in the last pass; totals always include all passes.
+     */
+    struct RenderStats {
+        static constexpr size_t MAX_PASS_COUNT = 48;
+        struct Counts {
+            uint32_t drawCalls = 0;             //!< draw calls
+            uint32_t primitives = 0;            //!< triangles, lines or points drawn, all instances
+            uint32_t programChanges = 0;        //!< draws using another program than the previous
+            uint32_t pipelineChanges = 0;       //!< draws using another program or raster state
+            uint32_t uniformBufferBinds = 0;    //!< uniform buffers bound
+            uint32_t samplerBinds = 0;          //!< sampler groups bound
+        };
+        struct Pass {
+            const char* name = nullptr;     //!< name of the pass, valid for as long as the Engine
+            Counts counts;                  //!< work recorded by this pass
+        };
+        uint32_t frameId = 0;               //!< frame these counts belong to, 0 if none yet
+        Counts total;                       //!< work recorded by all the passes of the frame
+        uint32_t passCount = 0;             //!< number of valid entries in passes
+        Pass passes[MAX_PASS_COUNT];        //!< counts of each pass, in execution order
+    };
+
     /**
      * Information about the display this Renderer is associated to. This information is needed
      * to accurately compute dynamic-resolution scaling and for frame-pacing.
@@ -146,12 +239,55 @@ public:
      */
     void setFrameRateOptions(FrameRateOptions const& options) noexcept;
 
+    /**
+     * Enables or disables the GPU timing of each pass of the frames, reported by
+     * getFrameTimings(). Disabled by default, because it adds timer queries to every pass.
+     */
+    void setPassTimingsEnabled(bool enabled) noexcept;
+
+    /**
+     * Returns the timings of the most recent frame whose GPU timings are all known. Because the
+     * GPU runs behind the CPU, this is usually a frame from a few frames ago, identified by
+     * FrameTimings::frameId.
+     */
+    FrameTimings getFrameTimings() const noexcept;
+
+    /**
+     * Enables or disables the counting of the work recorded by each pass, reported by
+     * getRenderStats(). Disabled by default.
+     */
+    void setRenderStatsEnabled(bool enabled) noexcept;
+
+    /**
+     * Returns the counts of the most recent frame rendered while render stats were enabled.
+     * Unlike getFrameTimings(), these are known as soon as endFrame() returns.
+     */
+    RenderStats getRenderStats() const noexcept;
+
     /**
      * Set ClearOptions which are used at the beginning of a frame to clear or retain the
      * SwapChain content.
      */
     void setClearOptions(const ClearOptions& options);
 
+    /**
+     * Declares the parts of the SwapChain that change in the current frame, as rectangles in
+     * window coordinates. Where supported, only their bounding rectangle is presented (e.g.
+     * with EGL_KHR_swap_buffers_with_damage or VK_KHR_incremental_present), which lets the
+     * compositor skip the rest of the window.
+     *
+     * If the ClearOptions retain the SwapChain content (clear and discard are both false),
+     * Views rendering directly into the SwapChain without post-processing, and which are
+     * opaque, are only redrawn within the damage region, and not at all outside of it.
+     *
+     * This must be called after beginFrame() and before the first render() of the frame. It
+     * only applies to the current frame, which is entirely damaged by default.
+     *
+     * @param regions   Rectangles that changed since the previous frame.
+     * @param count     Number of rectangles in regions, 0 damages the whole frame.
+     */
+    void setDamageRegions(Viewport const* regions, size_t count);
+
     /**
      * Get the Engine that created this Renderer.
      *
@@ -326,7 +462,9 @@ public:
      * It is also possible to use a Fence to wait for the read-back.
      *
      * @remark
-     * readPixels() is intended for debugging and testing. It will impact performance significantly.
+     * readPixels() is intended for debugging, testing and offline rendering. When it's called
+     * before endFrame(), the read-back doesn't stall the GPU, but each read-back still costs a
+     * copy of the pixels.
      *
      */
     void readPixels(uint32_t xoffset, uint32_t yoffset, uint32_t width, uint32_t height,
@@ -386,7 +524,9 @@ public:
      * It is also possible to use a Fence to wait for the read-back.
      *
      * @remark
-     * readPixels() is intended for debugging and testing. It will impact performance significantly.
+     * readPixels() is intended for debugging, testing and offline rendering. When it's called
+     * before endFrame(), the read-back doesn't stall the GPU, but each read-back still costs a
+     * copy of the pixels.
      *
      */
     void readPixels(RenderTarget* renderTarget,
@@ -411,6 +551,11 @@ public:
      * However, when beginFrame() returns false, the caller has the choice to either skip the
      * frame and not call endFrame(), or proceed as though true was returned.
      *
+     * When vsyncSteadyClockTimeNano is known, beginFrame() also schedules the presentation of
+     * the frame on the earliest vsync it is expected to make, based on the measured CPU and GPU
+     * times and on DisplayInfo. This keeps the latency low and the frame delivery even, on
+     * backends and platforms that support presentation times.
+     *
      * @param vsyncSteadyClockTimeNano The time in nanosecond of when the current frame started,
      *                                 or 0 if unknown. This value should be the timestamp of
      *                                 the last h/w vsync. It is expressed in the
@@ -501,6 +646,29 @@ public:
      */
     void endFrame();
 
+    /**
+     * Renders a list of views, each in its own frame, for offscreen rendering at a high rate.
+     *
+     * Each job is rendered like with beginFrame(), render(), endFrame(), except that the frames
+     * are never skipped and that no frame pacing happens. Instead, renderBatch() only waits when
+     * the GPU is more than BatchOptions::inFlightBudget jobs behind, so the CPU work of a job
+     * overlaps the GPU work of the previous ones. The budget also applies across calls.
+     *
+     * @param swapChain     SwapChain made current for the jobs, typically created with
+     *                      Engine::createSwapChain(width, height, flags).
+     * @param jobs          Jobs to render, in order.
+     * @param count         Number of jobs.
+     * @param options       Options of the batch.
+     *
+     * @attention
+     * renderBatch() must not be called between beginFrame() and endFrame().
+     */
+    void renderBatch(SwapChain* swapChain, BatchJob const* jobs, size_t count,
+            BatchOptions const& options);
+
+    /** Same as above, with the default BatchOptions. */
+    void renderBatch(SwapChain* swapChain, BatchJob const* jobs, size_t count);
+
     /**
      * Returns the time in second of the last call to beginFrame(). This value is constant for all
      * views rendered during a frame. The epoch is set with resetUserTime().
@@ -156,6 +156,29 @@ public:
      * @return Whether the given entity is in the Scene.
      */
     bool hasEntity(utils::Entity entity) const noexcept;
+
+    /**
+     * Enables or disables the bounding volume hierarchy of the Scene's renderables.
+     *
+     * When enabled, the renderables are culled hierarchically against the camera and the shadow
+     * maps: groups of renderables entirely outside (or inside) of a frustum are culled (or
+     * accepted) at once, instead of testing every renderable. This pays off for scenes with a
+     * large number of renderables, of which only a fraction is visible at a time.
+     *
+     * The hierarchy is rebuilt when renderables are added or removed, and refit when they move.
+     * Disabled by default.
+     *
+     * @param enabled true to enable the hierarchy, false to disable it.
+     */
+    void setBoundingVolumeHierarchyEnabled(bool enabled) noexcept;
+
+    /**
+     * Returns whether the bounding volume hierarchy is enabled.
+     *
+     * @return true if the hierarchy is enabled, false otherwise.
+     * @see setBoundingVolumeHierarchyEnabled()
+     */
+    bool isBoundingVolumeHierarchyEnabled() const noexcept;
 };
 
 } // namespace filament
@@ -188,13 +188,34 @@ public:
      * @see Stream for more information about NATIVE, TEXTURE_ID, and ACQUIRED configurations.
      *
      * @param image      Pointer to AHardwareBuffer, casted to void* since this is a public header.
-     * @param callback   This is triggered by Filament when it wishes to release the image.
+     * @param callback   This is triggered by Filament when it wishes to release the image, once the
+     *                   GPU has finished reading it.
      *                   It callback tales two arguments: the AHardwareBuffer and the userdata.
      * @param userdata   Optional closure data. Filament will pass this into the callback when it
      *                   releases the image.
      */
     void setAcquiredImage(void* image, Callback callback, void* userdata) noexcept;
 
+    /**
+     * Same as setAcquiredImage(void*, Callback, void*), for an image that is still being written
+     * by its producer, e.g. the camera.
+     *
+     * The GPU waits for \p fence before sampling the image, this doesn't block the CPU when the
+     * EGL_ANDROID_native_fence_sync and EGL_KHR_wait_sync extensions are available. This avoids
+     * waiting on the CPU before handing the image to Filament, which saves up to a frame of
+     * latency.
+     *
+     * @param image      Pointer to AHardwareBuffer, casted to void* since this is a public header.
+     * @param fence      Sync file descriptor signaled when the image is ready to be read, e.g.
+     *                   returned by AImageReader_acquireNextImageAsync(), or -1 if the image is
+     *                   ready. Filament takes ownership of the file descriptor.
+     * @param callback   This is triggered by Filament when it wishes to release the image, once the
+     *                   GPU has finished reading it.
+     * @param userdata   Optional closure data. Filament will pass this into the callback when it
+     *                   releases the image.
+     */
+    void setAcquiredImage(void* image, int fence, Callback callback, void* userdata) noexcept;
+
     /**
      * Updates the size of the incoming stream. Whether this value is used is
      *              stream dependent. On Android, it must be set when using
@@ -85,6 +85,14 @@ public:
     /** @return whether a backend supports texture swizzling. */
     static bool isTextureSwizzleSupported(Engine& engine) noexcept;
 
+    /**
+     * Returns the size in texels of the pages of a sparse texture (i.e. created with
+     * Usage::SPARSE) of the given sampler type and format, or {0, 0, 0} if such textures are
+     * not supported. In that case, a sparse texture is fully resident.
+     */
+    static math::uint3 getSparsePageSize(Engine& engine, Sampler sampler,
+            InternalFormat format) noexcept;
+
     static size_t computeTextureDataSize(Texture::Format format, Texture::Type type,
             size_t stride, size_t height, size_t alignment) noexcept;
 
@@ -97,6 +105,8 @@ public:
     struct UTILS_PUBLIC PrefilterOptions {
         uint16_t sampleCount = 8;   //!< sample count used for filtering
         bool mirror = true;         //!< whether the environment must be mirrored
+        uint8_t firstLevel = 0;     //!< first mip level to filter and upload
+        uint8_t levelCount = 0xff;  //!< number of mip levels to filter and upload, all by default
     private:
         UTILS_UNUSED uintptr_t reserved[3] = {};
     };
@@ -192,6 +202,18 @@ public:
          */
         Builder& swizzle(Swizzle r, Swizzle g, Swizzle b, Swizzle a) noexcept;
 
+        /**
+         * Enables mip residency feedback for this texture, see Texture::getRequiredLevel().
+         *
+         * A streamed texture is typically built with all its levels, but only its coarsest levels
+         * are uploaded at first. The finer levels are uploaded when they are required, and
+         * setMinMaxLevels() keeps the missing levels from being sampled.
+         *
+         * @param enable Whether to track the level required by the views. Defaults to false.
+         * @return This Builder, for chaining calls.
+         */
+        Builder& streaming(bool enable) noexcept;
+
         /**
          * Creates the Texture object and returns a pointer to it.
          *
@@ -471,6 +493,61 @@ public:
      */
     void generateMipmaps(Engine& engine) const noexcept;
 
+    /**
+     * Restricts sampling to the levels [minLevel, maxLevel], e.g. to the levels that are resident.
+     *
+     * @param engine        Engine this texture is associated to.
+     * @param minLevel      Finest level that can be sampled.
+     * @param maxLevel      Coarsest level that can be sampled, must be less than getLevels().
+     *
+     * @attention \p engine must be the instance passed to Builder::build()
+     */
+    void setMinMaxLevels(Engine& engine, size_t minLevel, size_t maxLevel) const;
+
+    /**
+     * Commits or decommits the memory of a region of a sparse texture, i.e. created with
+     * Usage::SPARSE. Sampling a decommitted page returns undefined values, and uploads to it
+     * are ignored.
+     *
+     * The region must be aligned to the page size returned by getSparsePageSize(), except where
+     * it reaches the edge of the level. For cubemaps and arrays, zoffset and depth select faces
+     * or layers. This has no effect if sparse textures aren't supported.
+     *
+     * @param engine        Engine this texture is associated to.
+     * @param level         Level of the region.
+     * @param xoffset       Left offset of the region in texels.
+     * @param yoffset       Bottom offset of the region in texels.
+     * @param zoffset       Depth offset, face or layer of the region.
+     * @param width         Width of the region in texels.
+     * @param height        Height of the region in texels.
+     * @param depth         Depth of the region, or number of faces or layers.
+     * @param commit        true to allocate the memory of the region, false to release it.
+     *
+     * @attention \p engine must be the instance passed to Builder::build()
+     */
+    void commitPages(Engine& engine, size_t level,
+            uint32_t xoffset, uint32_t yoffset, uint32_t zoffset,
+            uint32_t width, uint32_t height, uint32_t depth, bool commit) const;
+
+    /**
+     * Returns the finest level needed to render this texture in the views rendered since the
+     * last call to resetRequiredLevel(), or getLevels() if it wasn't rendered.
+     *
+     * The level is estimated from the screen size of the renderables whose materials use the
+     * texture, assuming the texture is mapped once across each renderable. Tiled textures need
+     * log2(tiling) finer levels. The estimate is only made if Builder::streaming() was set.
+     *
+     * A streaming loop typically calls this once per frame, after Renderer::render(), uploads the
+     * missing levels and, when over its memory budget, replaces the textures that need fewer
+     * levels than they have with smaller ones.
+     */
+    size_t getRequiredLevel() const noexcept;
+
+    /**
+     * Restarts the tracking of getRequiredLevel().
+     */
+    void resetRequiredLevel() noexcept;
+
     /**
      * Creates a reflection map from an environment map.
      *
@@ -496,6 +573,11 @@ public:
      * @warning This operation is computationally intensive, especially with large environments and
      *          is currently synchronous. Expect about 1ms for a 16x16 cubemap.
      *
+     * The cost can be spread over several calls with PrefilterOptions::firstLevel and
+     * PrefilterOptions::levelCount, which only filter and upload some of the mip levels, e.g.
+     * one level per frame. The mipmap chain of the source is still computed by every call,
+     * but this is cheap compared to the filtering. The other levels keep their content.
+     *
      * @param engine        Reference to the filament::Engine to associate this IndirectLight with.
      * @param buffer        Client-side buffer containing the images to set.
      * @param faceOffsets   Offsets in bytes into \p buffer for all six images. The offsets
@@ -125,8 +125,19 @@ public:
      * @see destroy()
      */
     void create(utils::Entity entity, Instance parent, const math::mat4f& localTransform);
+    void create(utils::Entity entity, Instance parent, const math::mat4& localTransform);
     void create(utils::Entity entity, Instance parent = {});
 
+    /**
+     * Creates transform components for a batch of entities, all with the same parent and
+     * an identity local transform. This is equivalent to calling create() for each entity,
+     * but makes room for the whole batch at once.
+     * @param count     Number of entities in the array.
+     * @param entities  Array of entities to associate a transform component to.
+     * @param parent    The Instance of the parent transform, or Instance{} if no parent.
+     */
+    void create(size_t count, utils::Entity const* entities, Instance parent = {});
+
     /**
      * Destroys this component from the given entity, children are orphaned.
      * @param e An entity.
@@ -139,6 +150,13 @@ public:
      */
     void destroy(utils::Entity e) noexcept;
 
+    /**
+     * Destroys the transform components of a batch of entities.
+     * @param count     Number of entities in the array.
+     * @param entities  Array of entities, entities without a transform component are ignored.
+     */
+    void destroy(size_t count, utils::Entity const* entities) noexcept;
+
     /**
      * Re-parents an entity to a new one.
      * @param i             The instance of the transform component to re-parent
@@ -202,6 +220,49 @@ public:
      */
     void setTransform(Instance ci, const math::mat4f& localTransform) noexcept;
 
+    /**
+     * Sets a local transform of a transform component and keeps double precision translations.
+     * If accurate translations are not enabled, the translation is truncated to float.
+     * This function is slightly slower than the float version.
+     * @param ci              The instance of the transform component to set the local transform to.
+     * @param localTransform  The local transform (i.e. relative to the parent).
+     * @see setAccurateTranslationsEnabled()
+     */
+    void setTransform(Instance ci, const math::mat4& localTransform) noexcept;
+
+    /**
+     * Sets the local transforms of several transform components at once.
+     *
+     * When many transforms are set and no local transform transaction is open, they are set
+     * within a transaction that is committed before returning. This is faster than calling
+     * setTransform() for each component, and saves the language bindings a call per component.
+     *
+     * @param instances       The instances of the transform components, count elements.
+     * @param localTransforms The local transforms (i.e. relative to the parents), count elements.
+     * @param count           The number of transforms to set.
+     * @see setTransform(), openLocalTransformTransaction()
+     */
+    void setTransforms(Instance const* instances, const math::mat4f* localTransforms,
+            size_t count) noexcept;
+
+    /**
+     * Enables or disables the accurate translation mode. In this mode, the world translations
+     * are computed in double precision, and the translation set with the double precision
+     * version of setTransform() is kept in full. Filament then renders the scene relative to
+     * the camera, so that objects far from the origin stay accurate. Enabling or disabling this
+     * mode recomputes all the world transforms.
+     * @param enable true to enable the accurate translation mode, false to disable.
+     * @see isAccurateTranslationsEnabled(), getWorldTransformAccurate()
+     */
+    void setAccurateTranslationsEnabled(bool enable) noexcept;
+
+    /**
+     * Returns whether the accurate translation mode is enabled.
+     * @return true if accurate translations are enabled
+     * @see setAccurateTranslationsEnabled()
+     */
+    bool isAccurateTranslationsEnabled() const noexcept;
+
     /**
      * Returns the local transform of a transform component.
      * @param ci The instance of the transform component to query the local transform from.
@@ -220,6 +281,26 @@ public:
      */
     const math::mat4f& getWorldTransform(Instance ci) const noexcept;
 
+    /**
+     * Returns the local transform of a transform component, with a double precision
+     * translation.
+     * @param ci The instance of the transform component to query the local transform from.
+     * @return The local transform of the component (i.e. relative to the parent). This always
+     *         returns the value set by setTransform().
+     * @see setTransform()
+     */
+    math::mat4 getTransformAccurate(Instance ci) const noexcept;
+
+    /**
+     * Return the world transform of a transform component, with a double precision translation
+     * if the accurate translation mode is enabled.
+     * @param ci The instance of the transform component to query the world transform from.
+     * @return The world transform of the component (i.e. relative to the root). This is the
+     *         composition of this component's local transform with its parent's world transform.
+     * @see setTransform(), setAccurateTranslationsEnabled()
+     */
+    math::mat4 getWorldTransformAccurate(Instance ci) const noexcept;
+
     /**
      * Opens a local transform transaction. During a transaction, getWorldTransform() can
      * return an invalid transform until commitLocalTransformTransaction() is called. However,
@@ -25,8 +25,10 @@
 #include <backend/DriverEnums.h>
 
 #include <utils/compiler.h>
+#include <utils/Entity.h>
 
 #include <math/mathfwd.h>
+#include <math/vec3.h>
 
 namespace filament {
 
@@ -110,6 +112,7 @@ public:
         bool enabled = false;                           //!< enable or disable dynamic resolution
         bool homogeneousScaling = false;                //!< set to true to force homogeneous scaling
         QualityLevel quality = QualityLevel::LOW;       //!< Upscaling quality
+        bool temporalUpscaling = false;                 //!< upscale with TAA when it's enabled, instead of with quality
     };
 
     /**
@@ -295,6 +298,15 @@ public:
             uint8_t rayCount = 1;           //!< # of rays to trace, between 1 and 255
             bool enabled = false;           //!< enables or disables SSCT
         } ssct;
+        /**
+         * Temporal accumulation options. When enabled, a quarter of the samples are taken each
+         * frame and the result is blended with the reprojected ambient occlusion of the
+         * previous frame.
+         */
+        struct Temporal {
+            float feedback = 0.1f;  //!< history feedback, between 0 (maximum accumulation) and 1 (no accumulation)
+            bool enabled = false;   //!< enables or disables temporal accumulation
+        } temporal;
     };
 
     /**
@@ -307,6 +319,40 @@ public:
         bool enabled = false;       //!< enables or disables temporal anti-aliasing
     };
 
+    /**
+     * Options for variable rate shading (VRS) of the color pass
+     * @see setVariableRateShadingOptions()
+     */
+    struct VariableRateShadingOptions {
+        float motionThreshold = 8.0f;  //!< camera rotation, in pixels per frame, above which the color pass is shaded at a coarser rate
+        bool enabled = false;          //!< enables or disables variable rate shading
+    };
+
+    /**
+     * Options for the depth prepass of the color pass
+     * @see setDepthPrepassOptions()
+     */
+    struct DepthPrepassOptions {
+        enum class Mode : uint8_t {
+            DISABLED,   //!< opaque objects are shaded as they are drawn
+            ENABLED,    //!< opaque objects are always drawn depth-only first
+            AUTOMATIC   //!< the prepass is used when the overdraw of the previous frame is high
+        };
+        float overdrawThreshold = 2.5f; //!< AUTOMATIC: estimated shading overdraw above which the prepass is used
+        Mode mode = Mode::DISABLED;     //!< when the depth prepass is used
+    };
+
+    /**
+     * Options for the budget of dynamic lights of the view
+     * @see setLightBudgetOptions()
+     */
+    struct LightBudgetOptions {
+        uint16_t maxLights = 256;           //!< max number of visible point and spot lights, at most 256
+        uint8_t maxShadowCastingSpots = 2;  //!< max number of shadow casting spot lights, at most 2
+        float fadeRange = 0.5f;             //!< relative importance above the cutoff at which a light is at full intensity
+        bool enabled = false;               //!< enables or disables the light budget
+    };
+
     /**
      * List of available post-processing anti-aliasing techniques.
      * @see setAntiAliasing, getAntiAliasing, setSampleCount
@@ -340,7 +386,8 @@ public:
     struct VsmShadowOptions {
         /**
          * Sets the number of anisotropic samples to use when sampling a VSM shadow map. If greater
-         * than 0, mipmaps will automatically be generated each frame for all lights.
+         * than 0, mipmaps will automatically be generated for the shadow maps rendered during
+         * the frame (shadow maps retained by the shadow map cache keep their mipmaps).
          *
          * The number of anisotropic samples = 2 ^ vsmAnisotropy.
          *
@@ -349,6 +396,24 @@ public:
         uint8_t anisotropy = 0;
     };
 
+    /**
+     * Result of a picking query.
+     * @see pick()
+     */
+    struct PickingQueryResult {
+        //! The renderable at the queried location, or a null entity if there is none.
+        utils::Entity renderable{};
+        //! Coordinates of the queried location, in viewport pixels, and the depth of the
+        //! renderable there, in window space (reversed-Z).
+        math::float3 fragCoords{};
+    };
+
+    /**
+     * Callback invoked with the result of a picking query.
+     * @see pick()
+     */
+    using PickingQueryResultCallback = void(*)(PickingQueryResult const& result, void* user);
+
     /**
      * Sets the View's name. Only useful for debugging.
      * @param name Pointer to the View's name. The string is copied.
@@ -463,6 +528,37 @@ public:
         return const_cast<View*>(this)->getCamera();
     }
 
+    //! Maximum number of eye cameras, see setEyeCameras()
+    static constexpr size_t MAX_EYE_COUNT = 4;
+
+    /**
+     * Sets the eye cameras of this View, for stereoscopic or multi-view rendering.
+     *
+     * When eye cameras are set, the viewport is split horizontally into \p count slices of equal
+     * width and eye i is rendered into slice i. The scene is prepared, culled and its commands
+     * are generated only once per frame for all the eyes: renderables and lights are culled
+     * against a frustum enclosing the View's camera and all the eyes, then the same commands
+     * are executed once per eye with that eye's camera.
+     *
+     * The View's camera (see setCamera()) is still used for everything that is computed once
+     * per frame: shadows, the assignment of lights to froxels, the level of detail and the
+     * sorting of the commands. It should be placed between the eyes and, like them, use the
+     * aspect ratio of a slice.
+     *
+     * @param eyes      array of \p count cameras, which must outlive their association with
+     *                  this View. The View doesn't take ownership of the cameras.
+     * @param count     number of eyes, at most MAX_EYE_COUNT. 0 removes the eye cameras.
+     *
+     * @note While eye cameras are set, the effects relying on a single projection are disabled:
+     *       ambient occlusion, temporal anti-aliasing and depth of field.
+     */
+    void setEyeCameras(Camera* const* eyes, size_t count) noexcept;
+
+    /**
+     * Returns the number of eye cameras set with setEyeCameras(), 0 if none.
+     */
+    size_t getEyeCount() const noexcept;
+
     /**
      * Sets the blending mode used to draw the view into the SwapChain.
      *
@@ -600,6 +696,76 @@ public:
      */
     TemporalAntiAliasingOptions const& getTemporalAntiAliasingOptions() const noexcept;
 
+    /**
+     * Enables or disables variable rate shading (VRS). Disabled by default.
+     *
+     * When enabled, the color pass is shaded at a coarser rate while the camera rotates quickly,
+     * when the loss of detail is hidden by motion. This has no effect if the backend doesn't
+     * support variable rate shading (currently only Vulkan does).
+     *
+     * @param options variable rate shading options
+     */
+    void setVariableRateShadingOptions(VariableRateShadingOptions options) noexcept;
+
+    /**
+     * Returns variable rate shading options.
+     *
+     * @return variable rate shading options
+     */
+    VariableRateShadingOptions const& getVariableRateShadingOptions() const noexcept;
+
+    /**
+     * Sets the depth prepass options. The prepass is disabled by default.
+     *
+     * With the depth prepass, opaque objects are first drawn depth-only, then the color pass
+     * draws them again with an EQUAL depth test, so that each pixel is shaded only once. This
+     * trades vertex work for fragment work, and helps scenes with heavy materials and a lot of
+     * overlapping opaque geometry.
+     *
+     * In AUTOMATIC mode, the overdraw of the lit opaque objects is estimated every frame from
+     * their screen-space bounds, and the prepass is used in the next frame when it exceeds
+     * overdrawThreshold. Lit objects are weighted by the average number of dynamic lights per
+     * froxel, so that scenes with many lights use the prepass sooner: each light counts for a
+     * quarter of the light-less cost. Unlit objects count for a quarter of their coverage.
+     *
+     * Objects using a non-default depth function, no depth writes or alpha to coverage are not
+     * part of the prepass.
+     *
+     * @param options depth prepass options
+     */
+    void setDepthPrepassOptions(DepthPrepassOptions options) noexcept;
+
+    /**
+     * Returns the depth prepass options.
+     *
+     * @return depth prepass options
+     */
+    DepthPrepassOptions const& getDepthPrepassOptions() const noexcept;
+
+    /**
+     * Sets the budget of dynamic lights of this View.
+     *
+     * By default, when there are more visible lights than the engine supports, the lights
+     * farthest from the camera are dropped, and only the first shadow casting spot lights
+     * found in the scene cast shadows.
+     *
+     * When the budget is enabled, each visible light is scored by its importance: its intensity
+     * weighted by the screen area of its sphere of influence. Only the maxLights most important
+     * lights are kept, and the maxShadowCastingSpots most important shadow casting spot lights
+     * cast shadows. Kept lights whose importance is within fadeRange of the first culled light
+     * are dimmed, so that lights fade out rather than pop when they fall out of the budget.
+     *
+     * @param options light budget options
+     */
+    void setLightBudgetOptions(LightBudgetOptions options) noexcept;
+
+    /**
+     * Returns the light budget options.
+     *
+     * @return light budget options
+     */
+    LightBudgetOptions const& getLightBudgetOptions() const noexcept;
+
     /**
      * Sets this View's color grading transforms.
      *
@@ -721,6 +887,15 @@ public:
      */
     DynamicResolutionOptions getDynamicResolutionOptions() const noexcept;
 
+    /**
+     * Returns the GPU time spent rendering this view in the most recent frame whose timing is
+     * known, which is usually a few frames old. Only views with dynamic resolution enabled
+     * are timed, the dynamic resolution controller uses this value to pick their resolution.
+     *
+     * @return GPU time of this view in seconds, or 0 if it is not known.
+     */
+    float getGpuTime() const noexcept;
+
     /**
      * Sets the rendering quality for this view. Refer to RenderQuality for more
      * information about the different settings available.
@@ -757,6 +932,31 @@ public:
      */
     void setDynamicLightingOptions(float zLightNear, float zLightFar) noexcept;
 
+    /**
+     * Sets options relative to dynamic lighting for this view, including the number of
+     * froxel slices along the view direction.
+     *
+     * The number of froxels is fixed, so fewer slices give finer froxels in screen-space.
+     * They also need fewer light records, which are shared by all froxels: when the records
+     * run out, lights are dropped from the remaining froxels (a warning is logged).
+     *
+     * @param zLightNear        see setDynamicLightingOptions(float, float).
+     * @param zLightFar         see setDynamicLightingOptions(float, float).
+     * @param froxelSliceCount  number of froxel slices between zLightNear and zLightFar,
+     *                          clamped to [2, 64]. (Default 16).
+     */
+    void setDynamicLightingOptions(float zLightNear, float zLightFar,
+            uint8_t froxelSliceCount) noexcept;
+
+    /**
+     * Allows the froxels (the screen-space cells lights are assigned to) to be rectangular.
+     * Square froxels often leave part of the froxel grid unused, rectangular froxels use all
+     * of it, which results in shorter light lists per fragment. Disabled by default.
+     *
+     * @param enabled true to allow rectangular froxels.
+     */
+    void setNonSquareFroxelsEnabled(bool enabled) noexcept;
+
     /*
      * Set the shadow mapping technique this View uses.
      *
@@ -838,6 +1038,107 @@ public:
      */
     bool isFrontFaceWindingInverted() const noexcept;
 
+    /**
+     * Enables or disables occlusion culling. Disabled by default.
+     *
+     * When enabled, the depth buffer of a previous frame is read back and used to build a
+     * hierarchical depth buffer against which renderables are tested after frustum culling.
+     * Renderables fully hidden behind closer geometry are not rendered.
+     *
+     * The skybox is skipped too when no pixel of the depth buffer was at the far plane, e.g.
+     * indoors, in which case the color buffer is cleared instead.
+     *
+     * Because the depth buffer is from the previous frame, a renderable that becomes visible
+     * suddenly (e.g. from behind a fast moving occluder) can be missing for one frame. A depth
+     * buffer that is not available in time is not used, leaving all renderables visible.
+     *
+     * Occlusion culling requires a backend able to read back depth buffers, currently only
+     * desktop OpenGL; it is ignored otherwise.
+     *
+     * @param enabled true to enable occlusion culling, false to disable it.
+     */
+    void setOcclusionCullingEnabled(bool enabled) noexcept;
+
+    //! Returns true if occlusion culling is enabled.
+    bool isOcclusionCullingEnabled() const noexcept;
+
+    /**
+     * Enables or disables the retention of rendering commands across frames. Disabled by
+     * default.
+     *
+     * When enabled, the sorted rendering commands of the color and depth passes are kept from
+     * one frame to the next. Renderables whose state didn't change reuse their commands, and
+     * only the ones that changed are regenerated. This mostly benefits scenes that are static,
+     * such as architectural visualization; any camera movement causes all commands to be
+     * regenerated.
+     *
+     * This uses additional memory proportional to the number of visible primitives.
+     *
+     * @param enabled true to retain commands across frames, false otherwise.
+     */
+    void setCommandCachingEnabled(bool enabled) noexcept;
+
+    //! Returns true if rendering commands are retained across frames.
+    bool isCommandCachingEnabled() const noexcept;
+
+    /**
+     * Enables or disables the retention of shadow maps across frames. Disabled by default.
+     *
+     * When enabled, the shadow texture is kept from one frame to the next, and a shadow map is
+     * only rendered again when its light, its projection or its shadow casters changed. In
+     * addition, only the first cascade of the directional light is updated every frame, the
+     * farther cascades are updated in turn, one per frame.
+     *
+     * Shadow maps of skinned casters are always rendered, and changes to material parameters
+     * of the casters are not detected.
+     *
+     * @param enabled true to retain shadow maps across frames, false otherwise.
+     */
+    void setShadowMapCachingEnabled(bool enabled) noexcept;
+
+    //! Returns true if shadow maps are retained across frames.
+    bool isShadowMapCachingEnabled() const noexcept;
+
+    /**
+     * Sets the number of texels available to the shadow maps of the spot lights, 0 (the default)
+     * sizes every shadow map from LightManager::ShadowOptions::mapSize.
+     *
+     * When a budget is set, the resolution of each spot light's shadow map is chosen every frame
+     * from the size the light's range covers on screen, rounded up to a power of two and limited
+     * to mapSize. A shadow map only shrinks once its light covers clearly less than half its
+     * size, so that it doesn't change from one frame to the next. If the shadow maps of all the
+     * spot lights need more texels than the budget, the largest ones are halved until they fit,
+     * down to 32x32. The cascades of the directional light always use mapSize.
+     *
+     * @param texels maximum sum of the areas of the spot light shadow maps, or 0.
+     */
+    void setShadowMapBudget(uint32_t texels) noexcept;
+
+    //! Returns the number of texels available to the spot light shadow maps, 0 if unlimited.
+    uint32_t getShadowMapBudget() const noexcept;
+
+    /**
+     * Queries which renderable is visible at a location of the viewport.
+     *
+     * The query is answered by the GPU: the renderables' entities are written to a picking
+     * buffer by the structure pass of the next rendered frame, and the texel at the queried
+     * location is read back. The callback is invoked on the main thread once the read back
+     * completes, typically a frame or two later, from within Engine::execute() or
+     * Renderer::beginFrame().
+     *
+     * The picking buffer has the resolution of the structure pass, which is reduced by
+     * AmbientOcclusionOptions::resolution, so the location is rounded accordingly. Translucent
+     * renderables are not pickable, nor are the renderables whose material was built without the
+     * picking variant, i.e. by an older matc; they report a null entity.
+     *
+     * @param x         horizontal coordinate in pixels, relative to the viewport's left edge.
+     * @param y         vertical coordinate in pixels, relative to the viewport's bottom edge.
+     * @param callback  function invoked with the result of the query.
+     * @param user      opaque pointer passed to the callback.
+     */
+    void pick(uint32_t x, uint32_t y, PickingQueryResultCallback callback,
+            void* user = nullptr) noexcept;
+
     // for debugging...
 
     //! debugging: allows to entirely disable frustum culling. (culling enabled by default).
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BonePalette.h"
+
+#include "private/backend/DriverApi.h"
+
+#include <utils/debug.h>
+#include <utils/Panic.h>
+
+#include <algorithm>
+
+#include <string.h>
+
+namespace filament {
+
+using namespace backend;
+
+// capacity of the first buffer, in bones
+static constexpr size_t INITIAL_CAPACITY = 4 * CONFIG_MAX_BONE_COUNT;
+
+void BonePalette::terminate(DriverApi& driver) noexcept {
+    if (mHandle) {
+        driver.destroyUniformBuffer(mHandle);
+        mHandle.clear();
+    }
+    mBones.clear();
+    mFreeRanges.clear();
+    mUsed = 0;
+}
+
+BonePalette::Range BonePalette::allocate(DriverApi& driver, size_t count) {
+    if (UTILS_UNLIKELY(!mHandle)) {
+        grow(driver, INITIAL_CAPACITY);
+    }
+    if (count == 0) {
+        return {};
+    }
+
+    const uint32_t size = uint32_t((count + BONES_PER_UNIT - 1) & ~(BONES_PER_UNIT - 1));
+
+    // first fit in the free ranges
+    auto pos = std::find_if(mFreeRanges.begin(), mFreeRanges.end(),
+            [size](Range const& range) { return range.count >= size; });
+    if (pos != mFreeRanges.end()) {
+        Range const range{ pos->offset, uint32_t(count) };
+        pos->offset += size;
+        pos->count -= size;
+        if (pos->count == 0) {
+            mFreeRanges.erase(pos);
+        }
+        return range;
+    }
+
+    ASSERT_POSTCONDITION(mUsed + size <= MAX_BONE_COUNT,
+            "Too many bones, at most %u can be allocated.", unsigned(MAX_BONE_COUNT));
+    if (mUsed + size > mBones.size()) {
+        grow(driver, std::min(std::max(mBones.size() * 2, size_t(mUsed + size)), MAX_BONE_COUNT));
+    }
+    Range const range{ mUsed, uint32_t(count) };
+    mUsed += size;
+    return range;
+}
+
+void BonePalette::free(Range range) noexcept {
+    if (range.count == 0) {
+        return;
+    }
+    const uint32_t size = uint32_t((range.count + BONES_PER_UNIT - 1) & ~(BONES_PER_UNIT - 1));
+    Range freed{ range.offset, size };
+
+    // insert the range in order, merged with its neighbors
+    auto pos = std::lower_bound(mFreeRanges.begin(), mFreeRanges.end(), freed,
+            [](Range const& lhs, Range const& rhs) { return lhs.offset < rhs.offset; });
+    if (pos != mFreeRanges.end() && freed.offset + freed.count == pos->offset) {
+        freed.count += pos->count;
+        pos = mFreeRanges.erase(pos);
+    }
+    if (pos != mFreeRanges.begin() && std::prev(pos)->offset + std::prev(pos)->count == freed.offset) {
+        --pos;
+        pos->count += freed.count;
+        freed = *pos;
+        pos = mFreeRanges.erase(pos);
+    }
+
+    // a range at the end gives its bones back to the unallocated part of the buffer
+    if (freed.offset + freed.count == mUsed) {
+        mUsed = freed.offset;
+    } else {
+        mFreeRanges.insert(pos, freed);
+    }
+    assert_invariant(mFreeRanges.empty() ||
+            mFreeRanges.back().offset + mFreeRanges.back().count < mUsed);
+}
+
+PerRenderableUibBone* BonePalette::invalidate(Range range, size_t offset, size_t count) noexcept {
+    assert_invariant(offset + count <= range.count);
+    const uint32_t begin = uint32_t(range.offset + offset);
+    mDirtyBegin = std::min(mDirtyBegin, begin);
+    mDirtyEnd = std::max(mDirtyEnd, uint32_t(begin + count));
+    return mBones.data() + begin;
+}
+
+void BonePalette::commit(DriverApi& driver) noexcept {
+    if (mDirtyBegin >= mDirtyEnd) {
+        return;
+    }
+    const size_t offset = mDirtyBegin * sizeof(PerRenderableUibBone);
+    const size_t size = (mDirtyEnd - mDirtyBegin) * sizeof(PerRenderableUibBone);
+    void* const buffer = driver.allocate(size);
+    memcpy(buffer, mBones.data() + mDirtyBegin, size);
+    driver.updateUniformBuffer(mHandle, { buffer, size }, uint32_t(offset));
+    mDirtyBegin = std::numeric_limits<uint32_t>::max();
+    mDirtyEnd = 0;
+}
+
+void BonePalette::grow(DriverApi& driver, size_t capacity) noexcept {
+    if (mHandle) {
+        driver.destroyUniformBuffer(mHandle);
+    }
+    mHandle = driver.createUniformBuffer(
+            (capacity + CONFIG_MAX_BONE_COUNT) * sizeof(PerRenderableUibBone),
+            BufferUsage::DYNAMIC);
+    mBones.resize(capacity);
+
+    // the new buffer needs all the bones that are in use
+    if (mUsed) {
+        mDirtyBegin = 0;
+        mDirtyEnd = std::max(mDirtyEnd, mUsed);
+    }
+}
+
+} // namespace filament
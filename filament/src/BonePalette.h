@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_BONEPALETTE_H
+#define TNT_FILAMENT_BONEPALETTE_H
+
+#include <backend/Handle.h>
+
+#include "private/backend/DriverApiForward.h"
+
+#include <private/filament/EngineEnums.h>
+#include <private/filament/UibGenerator.h>
+
+#include <limits>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+
+/*
+ * Packs the bones of all the skinned renderables into a single uniform buffer, so that they're
+ * uploaded with a single updateUniformBuffer() per frame. Each renderable gets a range of bones,
+ * and binds the buffer at the start of it with bindUniformBufferRange().
+ *
+ * The bones uniform block always has CONFIG_MAX_BONE_COUNT bones, and GLES requires bound ranges
+ * to cover the whole block, so a binding overlaps the ranges that follow it (which the shader
+ * never reads) and the buffer is padded past the last range.
+ *
+ * Not thread-safe, this is only used from the engine's main thread.
+ */
+class BonePalette {
+public:
+    // ranges are aligned to 256 bytes to be compatible with all versions of GLES
+    static constexpr size_t RANGE_ALIGNMENT = 256;
+    static constexpr size_t BONES_PER_UNIT = RANGE_ALIGNMENT / sizeof(PerRenderableUibBone);
+
+    // size of the bones uniform block, which every binding covers
+    static constexpr size_t BINDING_SIZE = CONFIG_MAX_BONE_COUNT * sizeof(PerRenderableUibBone);
+
+    // range offsets are stored in 16 bits, in units of RANGE_ALIGNMENT
+    static constexpr size_t MAX_BONE_COUNT = 65536 * BONES_PER_UNIT - CONFIG_MAX_BONE_COUNT;
+
+    struct Range {
+        uint32_t offset = 0;    // in bones, a multiple of BONES_PER_UNIT
+        uint32_t count = 0;     // in bones
+    };
+
+    BonePalette() noexcept = default;
+
+    BonePalette(BonePalette const& rhs) = delete;
+    BonePalette& operator=(BonePalette const& rhs) = delete;
+
+    void terminate(backend::DriverApi& driver) noexcept;
+
+    // A range of zero bones is valid and can be bound, e.g. by renderables that only morph. This
+    // can grow the buffer, which changes its handle.
+    Range allocate(backend::DriverApi& driver, size_t count);
+
+    // the range can be reused immediately, its previous content is never read again
+    void free(Range range) noexcept;
+
+    // returns a pointer to 'count' bones at 'offset' in the range, which are uploaded by commit()
+    PerRenderableUibBone* invalidate(Range range, size_t offset, size_t count) noexcept;
+
+    // uploads the bones that changed since the last commit
+    void commit(backend::DriverApi& driver) noexcept;
+
+    backend::Handle<backend::HwUniformBuffer> getHandle() const noexcept { return mHandle; }
+
+    // offset of a range in units of RANGE_ALIGNMENT, as bound by the render passes
+    static uint16_t getBindingOffset(Range range) noexcept {
+        return uint16_t(range.offset / BONES_PER_UNIT);
+    }
+
+private:
+    void grow(backend::DriverApi& driver, size_t capacity) noexcept;
+
+    backend::Handle<backend::HwUniformBuffer> mHandle;
+    std::vector<PerRenderableUibBone> mBones;   // CPU copy of the buffer, without the padding
+    std::vector<Range> mFreeRanges;             // sorted by offset, never adjacent
+    uint32_t mUsed = 0;                         // end of the last allocated range
+    uint32_t mDirtyBegin = std::numeric_limits<uint32_t>::max();
+    uint32_t mDirtyEnd = 0;
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_BONEPALETTE_H
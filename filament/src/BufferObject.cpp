@@ -20,10 +20,17 @@
 
 #include "FilamentAPI-impl.h"
 
+#include <utils/Panic.h>
+
+#include <algorithm>
+
+#include <stdlib.h>
+
 namespace filament {
 
 struct BufferObject::BuilderDetails {
     BindingType mBindingType = BindingType::VERTEX;
+    BufferUsage mUsage = BufferUsage::STATIC;
     uint32_t mByteCount = 0;
 };
 
@@ -45,6 +52,11 @@ BufferObject::Builder& BufferObject::Builder::bindingType(BindingType bindingTyp
     return *this;
 }
 
+BufferObject::Builder& BufferObject::Builder::usage(BufferUsage usage) noexcept {
+    mImpl->mUsage = usage;
+    return *this;
+}
+
 BufferObject* BufferObject::Builder::build(Engine& engine) {
     return upcast(engine).createBufferObject(*this);
 }
@@ -52,18 +64,88 @@ BufferObject* BufferObject::Builder::build(Engine& engine) {
 // ------------------------------------------------------------------------------------------------
 
 FBufferObject::FBufferObject(FEngine& engine, const BufferObject::Builder& builder)
-        : mByteCount(builder->mByteCount), mBindingType(builder->mBindingType) {
+        : mByteCount(builder->mByteCount), mBindingType(builder->mBindingType),
+          mUsage(builder->mUsage) {
     FEngine::DriverApi& driver = engine.getDriverApi();
-    mHandle = driver.createBufferObject(builder->mByteCount, builder->mBindingType);
+    mHandle = driver.createBufferObject(builder->mByteCount, builder->mBindingType,
+            builder->mUsage);
 }
 
 void FBufferObject::terminate(FEngine& engine) {
     FEngine::DriverApi& driver = engine.getDriverApi();
     driver.destroyBufferObject(mHandle);
+    if (mStorage) {
+        mStorage->terminated = true;
+        releaseIfDone(mStorage);
+        mStorage = nullptr;
+    }
+}
+
+void* FBufferObject::map(FEngine& engine) {
+    ASSERT_PRECONDITION(mUsage != BufferUsage::STATIC,
+            "map() requires a BufferObject built with a DYNAMIC or STREAM usage");
+    ASSERT_PRECONDITION(!mMapped, "BufferObject is already mapped");
+
+    if (UTILS_UNLIKELY(!mStorage)) {
+        mStorage = new Storage();
+        mStorage->regionSize = mByteCount;
+        mStorage->data = (uint8_t*)malloc(REGION_COUNT * mByteCount);
+    }
+
+    mCurrentRegion = uint8_t((mCurrentRegion + 1) % REGION_COUNT);
+    if (UTILS_UNLIKELY(mStorage->busy[mCurrentRegion])) {
+        // the backend hasn't uploaded this region yet, the upload callbacks are called by
+        // flushAndWait() once it has.
+        engine.flushAndWait();
+        assert_invariant(!mStorage->busy[mCurrentRegion]);
+    }
+
+    mMapped = true;
+    return mStorage->data + mCurrentRegion * mStorage->regionSize;
+}
+
+void FBufferObject::unmap(FEngine& engine, uint32_t byteOffset, uint32_t byteCount) {
+    ASSERT_PRECONDITION(mMapped, "BufferObject is not mapped");
+    ASSERT_PRECONDITION(byteOffset + byteCount <= mByteCount,
+            "range [%u, %u) is out of the BufferObject (%u bytes)",
+            byteOffset, byteOffset + byteCount, mByteCount);
+
+    mMapped = false;
+    if (byteCount == 0) {
+        return;
+    }
+
+    mStorage->busy[mCurrentRegion] = true;
+    uint8_t* const region = mStorage->data + mCurrentRegion * mStorage->regionSize;
+    engine.getDriverApi().updateBufferObject(mHandle,
+            { region + byteOffset, byteCount, &FBufferObject::onRegionUploaded, mStorage },
+            byteOffset);
+}
+
+void FBufferObject::onRegionUploaded(void* buffer, size_t, void* user) {
+    // called on the engine's thread, when the backend is done with the region
+    Storage* const storage = static_cast<Storage*>(user);
+    const size_t region = size_t(static_cast<uint8_t*>(buffer) - storage->data)
+            / storage->regionSize;
+    storage->busy[region] = false;
+    releaseIfDone(storage);
+}
+
+void FBufferObject::releaseIfDone(Storage* storage) noexcept {
+    if (storage->terminated &&
+            std::none_of(std::begin(storage->busy), std::end(storage->busy),
+                    [](bool busy) { return busy; })) {
+        free(storage->data);
+        delete storage;
+    }
 }
 
 void FBufferObject::setBuffer(FEngine& engine, BufferDescriptor&& buffer, uint32_t byteOffset) {
-    engine.getDriverApi().updateBufferObject(mHandle, std::move(buffer), byteOffset);
+    const size_t size = buffer.size;
+    engine.upload(size, [handle = mHandle, buffer = std::move(buffer), byteOffset](
+            FEngine::DriverApi& driver) mutable {
+        driver.updateBufferObject(handle, std::move(buffer), byteOffset);
+    });
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -75,6 +157,14 @@ void BufferObject::setBuffer(Engine& engine,
     upcast(this)->setBuffer(upcast(engine), std::move(buffer), byteOffset);
 }
 
+void* BufferObject::map(Engine& engine) {
+    return upcast(this)->map(upcast(engine));
+}
+
+void BufferObject::unmap(Engine& engine, uint32_t byteOffset, uint32_t byteCount) {
+    upcast(this)->unmap(upcast(engine), byteOffset, byteCount);
+}
+
 size_t BufferObject::getByteCount() const noexcept {
     return upcast(this)->getByteCount();
 }
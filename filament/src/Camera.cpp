@@ -192,6 +192,11 @@ void UTILS_NOINLINE FCamera::setModelMatrix(const mat4f& modelMatrix) noexcept {
     transformManager.setTransform(transformManager.getInstance(mEntity), modelMatrix);
 }
 
+void UTILS_NOINLINE FCamera::setModelMatrix(const mat4& modelMatrix) noexcept {
+    FTransformManager& transformManager = mEngine.getTransformManager();
+    transformManager.setTransform(transformManager.getInstance(mEntity), modelMatrix);
+}
+
 void FCamera::lookAt(const float3& eye, const float3& center, const float3& up) noexcept {
     setModelMatrix(mat4f::lookAt(eye, center, up));
 }
@@ -201,6 +206,11 @@ mat4f const& FCamera::getModelMatrix() const noexcept {
     return transformManager.getWorldTransform(transformManager.getInstance(mEntity));
 }
 
+mat4 FCamera::getModelMatrixAccurate() const noexcept {
+    FTransformManager const& transformManager = mEngine.getTransformManager();
+    return transformManager.getWorldTransformAccurate(transformManager.getInstance(mEntity));
+}
+
 mat4f UTILS_NOINLINE FCamera::getViewMatrix() const noexcept {
     return FCamera::getViewMatrix(getModelMatrix());
 }
@@ -296,11 +306,13 @@ CameraInfo::CameraInfo(FCamera const& camera) noexcept {
     d                  = std::max(zn, camera.getFocusDistance());
 }
 
-CameraInfo::CameraInfo(FCamera const& camera, const math::mat4f& worldOriginCamera,
+CameraInfo::CameraInfo(FCamera const& camera, const math::mat4& worldOriginCamera,
         float focusDistance) noexcept {
     // note: DepthOfFieldOptions is deprecated, but we continue to support it by passing it here
     // and we're using it if the camera focus distance hasn't been set.
-    const mat4f modelMatrix{ worldOriginCamera * camera.getModelMatrix() };
+    // The world origin is applied in double precision, so that a camera far from the origin
+    // ends up accurately close to it.
+    const mat4f modelMatrix{ worldOriginCamera * camera.getModelMatrixAccurate() };
     projection         = mat4f{ camera.getProjectionMatrix() };
     cullingProjection  = mat4f{ camera.getCullingProjectionMatrix() };
     model              = modelMatrix;
@@ -312,7 +324,7 @@ CameraInfo::CameraInfo(FCamera const& camera, const math::mat4f& worldOriginCame
     A                  = f / camera.getAperture();
     d                  = std::max(zn, camera.getFocusDistance() > 0.0f ? camera.getFocusDistance() : focusDistance);
     worldOffset        = camera.getPosition();
-    worldOrigin        = worldOriginCamera;
+    worldOrigin        = mat4f{ worldOriginCamera };
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -390,6 +402,10 @@ void Camera::setModelMatrix(const mat4f& modelMatrix) noexcept {
     upcast(this)->setModelMatrix(modelMatrix);
 }
 
+void Camera::setModelMatrix(const mat4& modelMatrix) noexcept {
+    upcast(this)->setModelMatrix(modelMatrix);
+}
+
 void Camera::lookAt(const float3& eye, const float3& center, float3 const& up) noexcept {
     upcast(this)->lookAt(eye, center, up);
 }
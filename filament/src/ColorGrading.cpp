@@ -25,6 +25,7 @@
 
 #include "ToneMapping.h"
 
+#include <math/half.h>
 #include <math/vec2.h>
 #include <math/vec3.h>
 #include <math/vec4.h>
@@ -218,12 +219,8 @@ inline float3 adaptationTransform(float2 whiteBalance) {
     return ILLUMINANT_D65_LMS / lms;
 }
 
-UTILS_ALWAYS_INLINE
-inline float3 chromaticAdaptation(float3 v, float2 whiteBalance) {
-    v = sRGB_to_LMS * v;
-    v = adaptationTransform(whiteBalance) * v;
-    v = LMS_to_sRGB * v;
-    return v;
+inline mat3f chromaticAdaptation(float2 whiteBalance) {
+    return LMS_to_sRGB * mat3f(adaptationTransform(whiteBalance)) * sRGB_to_LMS;
 }
 
 //------------------------------------------------------------------------------
@@ -436,6 +433,10 @@ struct Config {
     ColorTransform logToLinearTransform;
     ColorTransform toneMapper;
     size_t lutDimension;
+    // white balance followed by colorGradingTransformIn, the per-texel work is a single mat3
+    mat3f inputTransform;
+    // LogC decoding of each LUT coordinate, it is the same for all three channels
+    float linearFromLogC[64];
 };
 
 // Inside the FColorGrading constructor, TSAN sporadically detects a data race on the config struct;
@@ -460,6 +461,16 @@ FColorGrading::FColorGrading(FEngine& engine, const Builder& builder) {
         c.logToLinearTransform     = selectLogToLinearTransform(builder->toneMapping);
         c.toneMapper               = selectToneMapping(builder->toneMapping);
         c.lutDimension             = selectLutDimension(builder->quality);
+
+        // TODO: White balance is performed in sRGB, should be in Rec.2020 or AP1
+        c.inputTransform = builder->hasAdjustments ?
+                c.colorGradingTransformIn * chromaticAdaptation(builder->whiteBalance) :
+                c.colorGradingTransformIn;
+
+        assert_invariant(c.lutDimension <= 64);
+        for (size_t i = 0; i < c.lutDimension; i++) {
+            c.linearFromLogC[i] = LogC_to_linear(float3{ i / float(c.lutDimension - 1u) }).x;
+        }
     }
 
     size_t lutElementCount = c.lutDimension * c.lutDimension * c.lutDimension;
@@ -494,21 +505,19 @@ FColorGrading::FColorGrading(FEngine& engine, const Builder& builder) {
                 config = c;
             }
             half4* UTILS_RESTRICT p = (half4*) data + b * config.lutDimension * config.lutDimension;
+            // each row is converted to half-floats in one go
+            float4 row[64];
+            assert_invariant(config.lutDimension <= 64);
             for (size_t g = 0; g < config.lutDimension; g++) {
                 for (size_t r = 0; r < config.lutDimension; r++) {
-                    float3 v = float3{ r, g, b } * (1.0f / float(config.lutDimension - 1u));
-
                     // LogC encoding
-                    v = LogC_to_linear(v);
-
-                    // TODO: Performed in sRGB, should be in Rec.2020 or AP1
-                    if (builder->hasAdjustments) {
-                        // White balance
-                        v = chromaticAdaptation(v, builder->whiteBalance);
-                    }
+                    float3 v = {
+                            config.linearFromLogC[r],
+                            config.linearFromLogC[g],
+                            config.linearFromLogC[b] };
 
-                    // Convert to color grading color space
-                    v = config.colorGradingTransformIn * v;
+                    // White balance and conversion to color grading color space
+                    v = config.inputTransform * v;
 
                     if (builder->hasAdjustments) {
                         // Kill negative values before the next transforms
@@ -561,8 +570,10 @@ FColorGrading::FColorGrading(FEngine& engine, const Builder& builder) {
                     // Apply OECF
                     v = OECF_sRGB(v);
 
-                    *p++ = half4{v, 0.0f};
+                    row[r] = float4{ v, 0.0f };
                 }
+                convertToHalf(&p->x, &row[0].x, config.lutDimension * 4);
+                p += config.lutDimension;
             }
 
             if (converted) {
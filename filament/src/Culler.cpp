@@ -20,22 +20,40 @@
 
 #include <math/fast.h>
 
+#include <algorithm>
+
+#include <string.h>
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#   include <arm_neon.h>
+#   define FILAMENT_CULLER_USE_NEON 1
+#elif defined(__AVX2__)
+#   include <immintrin.h>
+#   define FILAMENT_CULLER_USE_AVX2 1
+#endif
+
 using namespace filament::math;
 
 namespace filament {
 
-void Culler::intersects(
-        result_type* UTILS_RESTRICT results,
+namespace {
+
+/*
+ * Portable implementations, these rely on auto-vectorization.
+ */
+
+void intersectsGeneric(
+        Culler::result_type* UTILS_RESTRICT results,
         Frustum const& UTILS_RESTRICT frustum,
         float4 const* UTILS_RESTRICT b,
         size_t count) noexcept {
 
-    float4 const * const UTILS_RESTRICT planes = frustum.mPlanes;
+    float4 const * const UTILS_RESTRICT planes = frustum.getNormalizedPlanes();
 
     // we use a vectorize width of 8 because, on ARMv8 it allow the compiler to write 8
     // 8-bits results in one go. Without this it has to do 4 separate byte writes, which
     // ends-up being slower.
-    count = round(count); // capacity guaranteed to be multiple of 8
+    count = Culler::round(count); // capacity guaranteed to be multiple of 8
     #pragma clang loop vectorize_width(8)
     for (size_t i = 0; i < count; i++) {
         int visible = ~0;
@@ -51,23 +69,23 @@ void Culler::intersects(
                               planes[j].w - sphere.w;
             visible &= fast::signbit(dot);
         }
-        results[i] = result_type(visible);
+        results[i] = Culler::result_type(visible);
     }
 }
 
-void Culler::intersects(
-        result_type* UTILS_RESTRICT results,
+void intersectsGeneric(
+        Culler::result_type* UTILS_RESTRICT results,
         Frustum const& UTILS_RESTRICT frustum,
         float3 const* UTILS_RESTRICT center,
         float3 const* UTILS_RESTRICT extent,
         size_t count, size_t bit) noexcept {
 
-    float4 const * UTILS_RESTRICT const planes = frustum.mPlanes;
+    float4 const * UTILS_RESTRICT const planes = frustum.getNormalizedPlanes();
 
     // we use a vectorize width of 8 because, on ARMv8 it allows the compiler to write eight
     // 8-bits results in one go. Without this it has to do 4 separate byte writes, which
     // ends-up being slower.
-    count = round(count); // capacity guaranteed to be multiple of 8
+    count = Culler::round(count); // capacity guaranteed to be multiple of 8
     #pragma clang loop vectorize_width(8)
     for (size_t i = 0; i < count; i++) {
         int visible = ~0;
@@ -85,10 +103,266 @@ void Culler::intersects(
             visible &= fast::signbit(dot) << bit;
         }
 
-        results[i] |= result_type(visible);
+        results[i] |= Culler::result_type(visible);
+    }
+}
+
+#if defined(FILAMENT_CULLER_USE_NEON)
+
+/*
+ * NEON implementations, these process 8 items per iteration. vld3q/vld4q de-interleave the
+ * float3/float4 arrays for free, so the SoA columns are consumed directly.
+ */
+
+// narrows two vectors of 0/1 words into eight bytes
+inline uint8x8_t narrow(uint32x4_t lo, uint32x4_t hi) noexcept {
+    return vmovn_u16(vcombine_u16(vmovn_u32(lo), vmovn_u32(hi)));
+}
+
+void intersectsSimd(
+        Culler::result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float4 const* UTILS_RESTRICT b,
+        size_t count) noexcept {
+
+    float4 const * const UTILS_RESTRICT planes = frustum.getNormalizedPlanes();
+
+    count = Culler::round(count); // capacity guaranteed to be multiple of 8
+    for (size_t i = 0; i < count; i += 8) {
+        const float32x4x4_t s0 = vld4q_f32(&b[i + 0].x);
+        const float32x4x4_t s1 = vld4q_f32(&b[i + 4].x);
+        uint32x4_t v0 = vdupq_n_u32(1);
+        uint32x4_t v1 = vdupq_n_u32(1);
+        #pragma clang loop unroll(full)
+        for (size_t j = 0; j < 6; j++) {
+            const float32x4_t w = vdupq_n_f32(planes[j].w);
+            float32x4_t d0 = vsubq_f32(w, s0.val[3]);
+            float32x4_t d1 = vsubq_f32(w, s1.val[3]);
+            d0 = vfmaq_n_f32(d0, s0.val[0], planes[j].x);
+            d1 = vfmaq_n_f32(d1, s1.val[0], planes[j].x);
+            d0 = vfmaq_n_f32(d0, s0.val[1], planes[j].y);
+            d1 = vfmaq_n_f32(d1, s1.val[1], planes[j].y);
+            d0 = vfmaq_n_f32(d0, s0.val[2], planes[j].z);
+            d1 = vfmaq_n_f32(d1, s1.val[2], planes[j].z);
+            // keep the sign bit, i.e. fast::signbit()
+            v0 = vandq_u32(v0, vshrq_n_u32(vreinterpretq_u32_f32(d0), 31));
+            v1 = vandq_u32(v1, vshrq_n_u32(vreinterpretq_u32_f32(d1), 31));
+        }
+        vst1_u8(results + i, narrow(v0, v1));
+    }
+}
+
+void intersectsSimd(
+        Culler::result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float3 const* UTILS_RESTRICT center,
+        float3 const* UTILS_RESTRICT extent,
+        size_t count, size_t bit) noexcept {
+
+    float4 const * UTILS_RESTRICT const planes = frustum.getNormalizedPlanes();
+    const int8x8_t shift = vdup_n_s8(int8_t(bit));
+
+    count = Culler::round(count); // capacity guaranteed to be multiple of 8
+    for (size_t i = 0; i < count; i += 8) {
+        const float32x4x3_t c0 = vld3q_f32(&center[i + 0].x);
+        const float32x4x3_t c1 = vld3q_f32(&center[i + 4].x);
+        const float32x4x3_t e0 = vld3q_f32(&extent[i + 0].x);
+        const float32x4x3_t e1 = vld3q_f32(&extent[i + 4].x);
+        uint32x4_t v0 = vdupq_n_u32(1);
+        uint32x4_t v1 = vdupq_n_u32(1);
+        #pragma clang loop unroll(full)
+        for (size_t j = 0; j < 6; j++) {
+            const float4 p = planes[j];
+            const float3 a = abs(p.xyz);
+            float32x4_t d0 = vdupq_n_f32(p.w);
+            float32x4_t d1 = d0;
+            d0 = vfmaq_n_f32(d0, c0.val[0], p.x);
+            d1 = vfmaq_n_f32(d1, c1.val[0], p.x);
+            d0 = vfmsq_n_f32(d0, e0.val[0], a.x);
+            d1 = vfmsq_n_f32(d1, e1.val[0], a.x);
+            d0 = vfmaq_n_f32(d0, c0.val[1], p.y);
+            d1 = vfmaq_n_f32(d1, c1.val[1], p.y);
+            d0 = vfmsq_n_f32(d0, e0.val[1], a.y);
+            d1 = vfmsq_n_f32(d1, e1.val[1], a.y);
+            d0 = vfmaq_n_f32(d0, c0.val[2], p.z);
+            d1 = vfmaq_n_f32(d1, c1.val[2], p.z);
+            d0 = vfmsq_n_f32(d0, e0.val[2], a.z);
+            d1 = vfmsq_n_f32(d1, e1.val[2], a.z);
+            // keep the sign bit, i.e. fast::signbit()
+            v0 = vandq_u32(v0, vshrq_n_u32(vreinterpretq_u32_f32(d0), 31));
+            v1 = vandq_u32(v1, vshrq_n_u32(vreinterpretq_u32_f32(d1), 31));
+        }
+        const uint8x8_t visible = vshl_u8(narrow(v0, v1), shift);
+        vst1_u8(results + i, vorr_u8(vld1_u8(results + i), visible));
     }
 }
 
+#elif defined(FILAMENT_CULLER_USE_AVX2)
+
+/*
+ * AVX2 implementations, these process 8 items per iteration. The float3/float4 arrays are
+ * de-interleaved with shuffles, so the SoA columns are consumed directly.
+ */
+
+// loads 8 float3 and de-interleaves them into x, y and z
+inline void load(float3 const* UTILS_RESTRICT p, __m256& x, __m256& y, __m256& z) noexcept {
+    float const* const UTILS_RESTRICT f = &p->x;
+    const __m256 m03 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(f +  0)), _mm_loadu_ps(f + 12), 1);
+    const __m256 m14 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(f +  4)), _mm_loadu_ps(f + 16), 1);
+    const __m256 m25 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(f +  8)), _mm_loadu_ps(f + 20), 1);
+    const __m256 xy = _mm256_shuffle_ps(m14, m25, _MM_SHUFFLE(2, 1, 3, 2));
+    const __m256 yz = _mm256_shuffle_ps(m03, m14, _MM_SHUFFLE(1, 0, 2, 1));
+    x = _mm256_shuffle_ps(m03, xy,  _MM_SHUFFLE(2, 0, 3, 0));
+    y = _mm256_shuffle_ps(yz,  xy,  _MM_SHUFFLE(3, 1, 2, 0));
+    z = _mm256_shuffle_ps(yz,  m25, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+// loads 8 float4 and de-interleaves them into x, y, z and w
+inline void load(float4 const* UTILS_RESTRICT p,
+        __m256& x, __m256& y, __m256& z, __m256& w) noexcept {
+    float const* const UTILS_RESTRICT f = &p->x;
+    const __m256 r0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(f +  0)), _mm_loadu_ps(f + 16), 1);
+    const __m256 r1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(f +  4)), _mm_loadu_ps(f + 20), 1);
+    const __m256 r2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(f +  8)), _mm_loadu_ps(f + 24), 1);
+    const __m256 r3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(f + 12)), _mm_loadu_ps(f + 28), 1);
+    const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    const __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+    const __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+    const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    x = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    y = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    z = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    w = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+// expands the sign bits of 'acc' into eight bytes of 0 or 1
+inline uint64_t visibility(__m256 acc) noexcept {
+    const uint64_t mask = uint32_t(_mm256_movemask_ps(acc));
+    // the multiply moves bit k to bit 8k, bit 7 is handled separately to avoid carries
+    return (((mask & 0x7fu) * 0x0002040810204081llu) & 0x0101010101010101llu) |
+            ((mask >> 7u) << 56u);
+}
+
+void intersectsSimd(
+        Culler::result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float4 const* UTILS_RESTRICT b,
+        size_t count) noexcept {
+
+    float4 const * const UTILS_RESTRICT planes = frustum.getNormalizedPlanes();
+
+    count = Culler::round(count); // capacity guaranteed to be multiple of 8
+    for (size_t i = 0; i < count; i += 8) {
+        __m256 x, y, z, r;
+        load(b + i, x, y, z, r);
+        __m256 acc = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        #pragma clang loop unroll(full)
+        for (size_t j = 0; j < 6; j++) {
+            __m256 d = _mm256_sub_ps(_mm256_set1_ps(planes[j].w), r);
+            d = _mm256_add_ps(d, _mm256_mul_ps(x, _mm256_set1_ps(planes[j].x)));
+            d = _mm256_add_ps(d, _mm256_mul_ps(y, _mm256_set1_ps(planes[j].y)));
+            d = _mm256_add_ps(d, _mm256_mul_ps(z, _mm256_set1_ps(planes[j].z)));
+            acc = _mm256_and_ps(acc, d);
+        }
+        const uint64_t visible = visibility(acc);
+        memcpy(results + i, &visible, sizeof(visible));
+    }
+}
+
+void intersectsSimd(
+        Culler::result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float3 const* UTILS_RESTRICT center,
+        float3 const* UTILS_RESTRICT extent,
+        size_t count, size_t bit) noexcept {
+
+    float4 const * UTILS_RESTRICT const planes = frustum.getNormalizedPlanes();
+
+    count = Culler::round(count); // capacity guaranteed to be multiple of 8
+    for (size_t i = 0; i < count; i += 8) {
+        __m256 cx, cy, cz, ex, ey, ez;
+        load(center + i, cx, cy, cz);
+        load(extent + i, ex, ey, ez);
+        __m256 acc = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        #pragma clang loop unroll(full)
+        for (size_t j = 0; j < 6; j++) {
+            const float4 p = planes[j];
+            const float3 a = abs(p.xyz);
+            __m256 d = _mm256_set1_ps(p.w);
+            d = _mm256_add_ps(d, _mm256_mul_ps(cx, _mm256_set1_ps(p.x)));
+            d = _mm256_sub_ps(d, _mm256_mul_ps(ex, _mm256_set1_ps(a.x)));
+            d = _mm256_add_ps(d, _mm256_mul_ps(cy, _mm256_set1_ps(p.y)));
+            d = _mm256_sub_ps(d, _mm256_mul_ps(ey, _mm256_set1_ps(a.y)));
+            d = _mm256_add_ps(d, _mm256_mul_ps(cz, _mm256_set1_ps(p.z)));
+            d = _mm256_sub_ps(d, _mm256_mul_ps(ez, _mm256_set1_ps(a.z)));
+            acc = _mm256_and_ps(acc, d);
+        }
+        uint64_t visible;
+        memcpy(&visible, results + i, sizeof(visible));
+        visible |= visibility(acc) << bit;
+        memcpy(results + i, &visible, sizeof(visible));
+    }
+}
+
+#else
+
+// no explicit SIMD implementation for this architecture
+inline void intersectsSimd(
+        Culler::result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float4 const* UTILS_RESTRICT b,
+        size_t count) noexcept {
+    intersectsGeneric(results, frustum, b, count);
+}
+
+inline void intersectsSimd(
+        Culler::result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float3 const* UTILS_RESTRICT center,
+        float3 const* UTILS_RESTRICT extent,
+        size_t count, size_t bit) noexcept {
+    intersectsGeneric(results, frustum, center, extent, count, bit);
+}
+
+#endif
+
+} // anonymous namespace
+
+void Culler::intersects(
+        result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float4 const* UTILS_RESTRICT b,
+        size_t count) noexcept {
+    intersectsSimd(results, frustum, b, count);
+}
+
+void Culler::intersects(
+        result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float3 const* UTILS_RESTRICT center,
+        float3 const* UTILS_RESTRICT extent,
+        size_t count, size_t bit) noexcept {
+    intersectsSimd(results, frustum, center, extent, count, bit);
+}
+
+Frustum Culler::enclose(Frustum const& frustum,
+        mat4 const* clipFromWorld, size_t count) noexcept {
+    Frustum result(frustum);
+    for (size_t i = 0; i < count; i++) {
+        mat4 const worldFromClip = inverse(clipFromWorld[i]);
+        for (size_t c = 0; c < 8; c++) {
+            double4 const p = worldFromClip * double4{
+                    (c & 1u) ? 1 : -1, (c & 2u) ? 1 : -1, (c & 4u) ? 1 : -1, 1 };
+            float3 const corner{ p.xyz / p.w };
+            for (float4& plane : result.mPlanes) {
+                // a point is inside when dot(plane.xyz, p) + plane.w <= 0
+                plane.w = std::min(plane.w, -dot(plane.xyz, corner));
+            }
+        }
+    }
+    return result;
+}
+
 /*
  * returns whether a box intersects with the frustum
  */
@@ -136,4 +410,20 @@ void Culler::Test::intersects(
     Culler::intersects(results, frustum, b, count);
 }
 
+void Culler::Test::intersectsGeneric(
+        result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float3 const* UTILS_RESTRICT c,
+        float3 const* UTILS_RESTRICT e,
+        size_t count) noexcept {
+    filament::intersectsGeneric(results, frustum, c, e, count, 0);
+}
+
+void Culler::Test::intersectsGeneric(
+        result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float4 const* UTILS_RESTRICT b, size_t count) noexcept {
+    filament::intersectsGeneric(results, frustum, b, count);
+}
+
 } // namespace filament
@@ -26,6 +26,9 @@ const uint16_t DFG::DFG_LUT[] = {
 };
 
 DFG::DFG(FEngine& engine) noexcept : mEngine(engine) {
+}
+
+FTexture* DFG::createLut() const noexcept {
     constexpr size_t fp16Count = DFG_LUT_SIZE * DFG_LUT_SIZE * 3;
     constexpr size_t byteCount = fp16Count * sizeof(uint16_t);
 
@@ -42,7 +45,7 @@ DFG::DFG(FEngine& engine) noexcept : mEngine(engine) {
 
     lut->setImage(mEngine, 0, std::move(buffer));
 
-    mLUT = upcast(lut);
+    return upcast(lut);
 }
 
 void DFG::terminate() {
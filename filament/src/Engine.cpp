@@ -17,6 +17,7 @@
 #include "details/Engine.h"
 
 #include "MaterialParser.h"
+#include "RenderPass.h"
 #include "ResourceAllocator.h"
 
 #include "backend/DriverEnums.h"
@@ -47,7 +48,10 @@
 #include <utils/Systrace.h>
 #include <utils/debug.h>
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
+#include <tuple>
 
 #include "generated/resources/materials.h"
 
@@ -59,6 +63,11 @@ namespace filament {
 using namespace backend;
 using namespace filaflat;
 
+static uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start) noexcept {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+}
+
 FEngine* FEngine::create(Backend backend, Platform* platform, void* sharedGLContext) {
     SYSTRACE_ENABLE();
     SYSTRACE_CALL();
@@ -71,6 +80,7 @@ FEngine* FEngine::create(Backend backend, Platform* platform, void* sharedGLCont
     // Normally we launch a thread and create the context and Driver from there (see FEngine::loop).
     // In the single-threaded case, we do so in the here and now.
     if (!UTILS_HAS_THREADING) {
+        const auto start = std::chrono::steady_clock::now();
         if (platform == nullptr) {
             platform = DefaultPlatform::create(&instance->mBackend);
             instance->mPlatform = platform;
@@ -81,6 +91,7 @@ FEngine* FEngine::create(Backend backend, Platform* platform, void* sharedGLCont
             return nullptr;
         }
         instance->mDriver = platform->createDriver(sharedGLContext);
+        instance->mStartupTimings.driverInit = nanosecondsSince(start);
     } else {
         // start the driver thread
         instance->mDriverThread = std::thread(&FEngine::loop, instance);
@@ -181,6 +192,7 @@ FEngine::FEngine(Backend backend, Platform* platform, void* sharedGLContext) :
     // we're assuming we're on the main thread here.
     // (it may not be the case)
     mJobSystem.adopt();
+    mTransformManager.setJobSystem(&mJobSystem);
 
     slog.i << "FEngine (" << sizeof(void*) * 8 << " bits) created at " << this << " "
            << "(threading is " << (UTILS_HAS_THREADING ? "enabled)" : "disabled)") << io::endl;
@@ -193,11 +205,27 @@ FEngine::FEngine(Backend backend, Platform* platform, void* sharedGLContext) :
 
 void FEngine::init() {
     SYSTRACE_CALL();
+    const auto start = std::chrono::steady_clock::now();
 
     // this must be first.
     mCommandStream = CommandStream(*mDriver, mCommandBufferQueue.getCircularBuffer());
     DriverApi& driverApi = getDriverApi();
 
+#if FILAMENT_ENABLE_COMMAND_CAPTURE
+    // Capture all the driver commands to a file, they can be replayed without the engine by
+    // tools/cmdreplay. This must happen before the first command is recorded.
+    const char* const capturePath = getenv("FILAMENT_COMMAND_STREAM_CAPTURE");
+    if (UTILS_UNLIKELY(capturePath)) {
+        mCommandStreamWriter = std::make_unique<CommandStreamWriter>(capturePath);
+        if (mCommandStreamWriter->isOpen()) {
+            slog.i << "Capturing driver commands to " << capturePath << io::endl;
+            driverApi.setCommandStreamWriter(mCommandStreamWriter.get());
+        } else {
+            mCommandStreamWriter.reset();
+        }
+    }
+#endif
+
     mResourceAllocator = new ResourceAllocator(driverApi);
 
     mFullScreenTriangleVb = upcast(VertexBuffer::Builder()
@@ -244,14 +272,19 @@ void FEngine::init() {
     mDefaultColorGrading = upcast(ColorGrading::Builder().build(*this));
 
     // Always initialize the default material, most materials' depth shaders fallback on it.
+    const auto defaultMaterialStart = std::chrono::steady_clock::now();
     mDefaultMaterial = upcast(
             FMaterial::DefaultMaterialBuilder()
                     .package(MATERIALS_DEFAULTMATERIAL_DATA, MATERIALS_DEFAULTMATERIAL_SIZE)
                     .build(*const_cast<FEngine*>(this)));
+    mStartupTimings.defaultMaterial = nanosecondsSince(defaultMaterialStart);
 
+    // the post-process materials and the DFG LUT are created on first use
     mPostProcessManager.init();
     mLightManager.init(*this);
     mDFG = std::make_unique<DFG>(*this);
+
+    mStartupTimings.engineInit = nanosecondsSince(start);
 }
 
 FEngine::~FEngine() noexcept {
@@ -271,6 +304,19 @@ void FEngine::shutdown() {
     ASSERT_PRECONDITION(std::this_thread::get_id() == mMainThreadId,
             "Engine::shutdown() called from the wrong thread!");
 
+    // uploads queued by other threads must not outlive the engine
+    processUploads(std::numeric_limits<size_t>::max());
+
+    // deferred destructions run before the leaked objects are cleaned up, in their own order
+    processDestructions(std::numeric_limits<uint64_t>::max());
+
+    // the materials still being parsed are dropped, which releases their package
+    for (auto& build : mPendingMaterialBuilds) {
+        mJobSystem.waitAndRelease(build->job);
+        delete build->parser;
+    }
+    mPendingMaterialBuilds.clear();
+
 #ifndef NDEBUG
     // print out some statistics about this run
     size_t wm = mCommandBufferQueue.getHighWatermark();
@@ -324,10 +370,11 @@ void FEngine::shutdown() {
     cleanupResourceList(mVertexBuffers);
     cleanupResourceList(mTextures);
     cleanupResourceList(mRenderTargets);
-    cleanupResourceList(mMaterials);
+    // material instances return their uniforms to their material, so they must go first
     for (auto& item : mMaterialInstances) {
         cleanupResourceList(item.second);
     }
+    cleanupResourceList(mMaterials);
     cleanupResourceList(mFences);
 
     /*
@@ -369,6 +416,11 @@ void FEngine::prepare() {
     // UBOs that are visible only. It's not such a big issue because the actual upload() is
     // skipped is the UBO hasn't changed. Still we could have a lot of these.
     FEngine::DriverApi& driver = getDriverApi();
+
+    if (UTILS_UNLIKELY(mMaterialSortingKeysDirty)) {
+        updateMaterialSortingKeys();
+    }
+
     for (auto& materialInstanceList : mMaterialInstances) {
         for (const auto& item : materialInstanceList.second) {
             item->commit(driver);
@@ -381,6 +433,44 @@ void FEngine::prepare() {
     }
 }
 
+void FEngine::updateMaterialSortingKeys() noexcept {
+    SYSTRACE_CALL();
+
+    // Material and instance IDs only grow, so they can't be used directly in the 32-bit
+    // material sorting key without truncation (and collisions). Instead, each live instance
+    // gets its rank in (material, pipeline state, instance) order, which is dense.
+    std::vector<FMaterialInstance*> instances;
+    instances.reserve(mMaterials.size());
+    for (FMaterial* material : mMaterials) {
+        instances.push_back(material->getDefaultInstance());
+    }
+    for (auto& materialInstanceList : mMaterialInstances) {
+        for (FMaterialInstance* instance : materialInstanceList.second) {
+            instances.push_back(instance);
+        }
+    }
+
+    // the default instance of a material is created first, so it has the lowest instance ID
+    auto order = [](FMaterialInstance const* mi) {
+        return std::make_tuple(mi->getMaterial()->getId(), mi->getPipelineStateKey(),
+                mi->getInstanceId());
+    };
+    std::sort(instances.begin(), instances.end(),
+            [&order](FMaterialInstance const* lhs, FMaterialInstance const* rhs) {
+                return order(lhs) < order(rhs);
+            });
+
+    // past this count, ranks wrap around and sorting is only approximate
+    ASSERT_POSTCONDITION_NON_FATAL(instances.size() <= RenderPass::MATERIAL_RANK_COUNT,
+            "%u material instances, only %u can be sorted without collisions",
+            unsigned(instances.size()), unsigned(RenderPass::MATERIAL_RANK_COUNT));
+
+    for (size_t i = 0, c = instances.size(); i < c; i++) {
+        instances[i]->setSortingRank(uint32_t(i % RenderPass::MATERIAL_RANK_COUNT));
+    }
+    mMaterialSortingKeysDirty = false;
+}
+
 void FEngine::gc() {
     // Note: this runs in a Job
 
@@ -388,14 +478,21 @@ void FEngine::gc() {
     auto *parent = js.createJob();
     auto em = std::ref(mEntityManager);
 
-    js.run(jobs::createJob(js, parent, &FRenderableManager::gc, &mRenderableManager, em),
-            JobSystem::DONT_SIGNAL);
-    js.run(jobs::createJob(js, parent, &FLightManager::gc, &mLightManager, em),
-            JobSystem::DONT_SIGNAL);
-    js.run(jobs::createJob(js, parent, &FTransformManager::gc, &mTransformManager, em),
-            JobSystem::DONT_SIGNAL);
-    js.run(jobs::createJob(js, parent, &FCameraManager::gc, &mCameraManager, em),
-            JobSystem::DONT_SIGNAL);
+    // each manager stops collecting at the deadline, the remaining components are collected by
+    // the next frames
+    using clock = std::chrono::steady_clock;
+    const clock::time_point deadline =
+            mDestructionBudget == std::numeric_limits<uint64_t>::max() ? clock::time_point::max() :
+            clock::now() + std::chrono::nanoseconds(mDestructionBudget);
+
+    js.run(jobs::createJob(js, parent, &FRenderableManager::gc, &mRenderableManager, em,
+            deadline), JobSystem::DONT_SIGNAL);
+    js.run(jobs::createJob(js, parent, &FLightManager::gc, &mLightManager, em,
+            deadline), JobSystem::DONT_SIGNAL);
+    js.run(jobs::createJob(js, parent, &FTransformManager::gc, &mTransformManager, em,
+            deadline), JobSystem::DONT_SIGNAL);
+    js.run(jobs::createJob(js, parent, &FCameraManager::gc, &mCameraManager, em,
+            deadline), JobSystem::DONT_SIGNAL);
 
     js.runAndWait(parent);
 }
@@ -405,8 +502,149 @@ void FEngine::flush() {
     flushCommandBuffer(mCommandBufferQueue);
 }
 
+void FEngine::queueUpload(size_t size, UploadCommand command) {
+    std::lock_guard<utils::Mutex> lock(mUploadLock);
+    mPendingUploads.push_back({ size, std::move(command) });
+    mPendingUploadCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FEngine::processUploads(size_t budget) {
+    assert_invariant(std::this_thread::get_id() == mMainThreadId);
+    if (UTILS_LIKELY(!mPendingUploadCount.load(std::memory_order_relaxed))) {
+        return;
+    }
+    SYSTRACE_CALL();
+    DriverApi& driver = getDriverApi();
+    // at least one upload is recorded, even if it's larger than the budget
+    size_t recorded = 0;
+    do {
+        PendingUpload upload;
+        {
+            std::lock_guard<utils::Mutex> lock(mUploadLock);
+            if (mPendingUploads.empty()) {
+                break;
+            }
+            upload = std::move(mPendingUploads.front());
+            mPendingUploads.pop_front();
+            mPendingUploadCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+        upload.command(driver);
+        recorded += upload.size;
+    } while (recorded < budget);
+}
+
+void FEngine::destroyDeferred(Entity const* entities, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        mPendingDestructions.push_back([this, e = entities[i]]() { destroy(e); });
+    }
+}
+
+void FEngine::processDestructions(uint64_t budget) {
+    if (UTILS_LIKELY(mPendingDestructions.empty())) {
+        return;
+    }
+    SYSTRACE_CALL();
+    // at least one object is destroyed, even if it takes longer than the budget
+    const auto start = std::chrono::steady_clock::now();
+    do {
+        // destroying an object can queue more destructions, so the command is moved out first
+        DestroyCommand command = std::move(mPendingDestructions.front());
+        mPendingDestructions.pop_front();
+        command();
+    } while (!mPendingDestructions.empty() && nanosecondsSince(start) < budget);
+}
+
+void FEngine::buildMaterialAsync(Material::Builder const& builder,
+        Material::Builder::BuildCallback callback, void* user) {
+    PendingMaterialBuild* build = new PendingMaterialBuild{ builder, callback, user };
+    mPendingMaterialBuilds.emplace_back(build);
+    JobSystem& js = mJobSystem;
+    build->job = js.runAndRetain(js.createJob(nullptr,
+            [build, backend = mBackend](JobSystem&, JobSystem::Job*) {
+                SYSTRACE_NAME("Material::parse");
+                build->parser = FMaterial::parse(backend, build->builder);
+                build->parsed.store(true, std::memory_order_release);
+            }));
+}
+
+void FEngine::processMaterialBuilds() {
+    if (UTILS_LIKELY(mPendingMaterialBuilds.empty())) {
+        return;
+    }
+    // the callbacks can call buildAsync() again, which appends to mPendingMaterialBuilds
+    std::vector<std::unique_ptr<PendingMaterialBuild>> pending;
+    std::swap(pending, mPendingMaterialBuilds);
+    for (auto& build : pending) {
+        if (!build->parsed.load(std::memory_order_acquire)) {
+            mPendingMaterialBuilds.push_back(std::move(build));
+            continue;
+        }
+        // the job has run, this returns right away
+        mJobSystem.waitAndRelease(build->job);
+        FMaterial* material = build->parser ?
+                FMaterial::create(*this, build->builder, build->parser) : nullptr;
+        build->callback(material, build->user);
+    }
+}
+
+void FEngine::addCompilationCallback(FMaterial const* material,
+        Material::CompilationCallback callback, void* user) {
+    mPendingCompilations.push_back({ material, callback, user });
+}
+
+void FEngine::processCompilations() {
+    if (UTILS_LIKELY(mPendingCompilations.empty())) {
+        return;
+    }
+    // the callbacks can call compile() again, which appends to mPendingCompilations
+    std::vector<PendingCompilation> pending;
+    std::swap(pending, mPendingCompilations);
+    for (PendingCompilation const& compilation : pending) {
+        if (compilation.material->isReady()) {
+            compilation.callback(const_cast<FMaterial*>(compilation.material), compilation.user);
+        } else {
+            mPendingCompilations.push_back(compilation);
+        }
+    }
+}
+
+Engine::MemoryStats FEngine::getMemoryStats() const noexcept {
+    backend::MemoryStats const stats = getDriver().getMemoryStats();
+    return {
+            .textures = stats.textures,
+            .renderTargets = stats.renderTargets,
+            .buffers = stats.buffers,
+            .staging = stats.staging,
+            .transientCache = mResourceAllocator->getStatistics().cacheSize,
+            .total = stats.textures + stats.renderTargets + stats.buffers + stats.staging
+    };
+}
+
+void FEngine::checkMemoryBudget() {
+    if (UTILS_LIKELY(!mMemoryBudget)) {
+        return;
+    }
+    Engine::MemoryStats const stats = getMemoryStats();
+    const bool exceeded = stats.total > mMemoryBudget;
+    if (exceeded && !mMemoryBudgetExceeded && mMemoryBudgetCallback) {
+        mMemoryBudgetCallback(this, stats, mMemoryBudgetUser);
+    }
+    mMemoryBudgetExceeded = exceeded;
+}
+
+void FEngine::updateCommandBufferStatistics() noexcept {
+    const size_t flushedSize = mCommandBufferQueue.getFlushedSize();
+    mCommandBufferLastFrameSize = flushedSize - mCommandBufferFlushedSize;
+    mCommandBufferPeakFrameSize = std::max(mCommandBufferPeakFrameSize,
+            mCommandBufferLastFrameSize);
+    mCommandBufferFlushedSize = flushedSize;
+}
+
 void FEngine::flushAndWait() {
 
+    // record the uploads queued by other threads, so they're complete when we return
+    processUploads(std::numeric_limits<size_t>::max());
+
 #if defined(ANDROID)
 
     // first make sure we've not terminated filament
@@ -455,6 +693,7 @@ void FEngine::flushAndWait() {
 // -----------------------------------------------------------------------------------------------
 
 int FEngine::loop() {
+    const auto start = std::chrono::steady_clock::now();
     if (mPlatform == nullptr) {
         mPlatform = DefaultPlatform::create(&mBackend);
         mOwnPlatform = true;
@@ -493,6 +732,7 @@ int FEngine::loop() {
     JobSystem::setThreadPriority(JobSystem::Priority::DISPLAY);
 
     mDriver = mPlatform->createDriver(mSharedGLContext);
+    mStartupTimings.driverInit = nanosecondsSince(start);
     mDriverBarrier.latch();
     if (UTILS_UNLIKELY(!mDriver)) {
         // if we get here, it's because the driver couldn't be initialized and the problem has
@@ -718,6 +958,8 @@ void FEngine::cleanupResourceList(ResourceList<T, L>& list) {
 template<typename T, typename L>
 bool FEngine::terminateAndDestroy(const T* ptr, ResourceList<T, L>& list) {
     if (ptr == nullptr) return true;
+    // queued uploads could target the object being destroyed
+    processUploads(std::numeric_limits<size_t>::max());
     bool success = list.remove(ptr);
     if (ASSERT_PRECONDITION_NON_FATAL(success,
             "Object %s at %p doesn't exist (double free?)",
@@ -800,6 +1042,11 @@ bool FEngine::destroy(const FMaterial* ptr) {
             return false;
         }
     }
+    // the callbacks of compile() are dropped along with the material
+    mPendingCompilations.erase(std::remove_if(mPendingCompilations.begin(),
+            mPendingCompilations.end(), [ptr](PendingCompilation const& compilation) {
+                return compilation.material == ptr;
+            }), mPendingCompilations.end());
     return terminateAndDestroy(ptr, mMaterials);
 }
 
@@ -1003,6 +1250,34 @@ void Engine::destroy(Entity e) {
     upcast(this)->destroy(e);
 }
 
+void Engine::destroyDeferred(const BufferObject* p) {
+    upcast(this)->destroyDeferred(upcast(p));
+}
+
+void Engine::destroyDeferred(const VertexBuffer* p) {
+    upcast(this)->destroyDeferred(upcast(p));
+}
+
+void Engine::destroyDeferred(const IndexBuffer* p) {
+    upcast(this)->destroyDeferred(upcast(p));
+}
+
+void Engine::destroyDeferred(const Texture* p) {
+    upcast(this)->destroyDeferred(upcast(p));
+}
+
+void Engine::destroyDeferred(const MaterialInstance* p) {
+    upcast(this)->destroyDeferred(upcast(p));
+}
+
+void Engine::destroyDeferred(const Material* p) {
+    upcast(this)->destroyDeferred(upcast(p));
+}
+
+void Engine::destroyDeferred(Entity const* entities, size_t count) {
+    upcast(this)->destroyDeferred(entities, count);
+}
+
 void Engine::flushAndWait() {
     upcast(this)->flushAndWait();
 }
@@ -1039,6 +1314,54 @@ DebugRegistry& Engine::getDebugRegistry() noexcept {
     return upcast(this)->getDebugRegistry();
 }
 
+void Engine::setTransientTextureCacheBudget(size_t capacity, uint32_t maxAge) noexcept {
+    upcast(this)->getResourceAllocator().setCacheBudget(capacity, maxAge);
+}
+
+void Engine::setUploadBudget(size_t bytesPerFrame) noexcept {
+    upcast(this)->setUploadBudget(bytesPerFrame);
+}
+
+void Engine::setDestructionBudget(uint64_t nanosecondsPerFrame) noexcept {
+    upcast(this)->setDestructionBudget(nanosecondsPerFrame);
+}
+
+void Engine::setAsynchronousProgramCompilation(bool enabled) noexcept {
+    upcast(this)->setAsynchronousProgramCompilation(enabled);
+}
+
+void Engine::setShaderSourceRelease(bool enabled) noexcept {
+    upcast(this)->setShaderSourceRelease(enabled);
+}
+
+Engine::CommandBufferStatistics Engine::getCommandBufferStatistics() const noexcept {
+    return upcast(this)->getCommandBufferStatistics();
+}
+
+Engine::TransientTextureCacheStatistics Engine::getTransientTextureCacheStatistics() const noexcept {
+    ResourceAllocator::Statistics const stats =
+            const_cast<FEngine*>(upcast(this))->getResourceAllocator().getStatistics();
+    return {
+            .hitCount = stats.hitCount,
+            .missCount = stats.missCount,
+            .cacheSize = stats.cacheSize,
+            .inUseSize = stats.inUseSize,
+            .peakSize = stats.peakSize
+    };
+}
+
+Engine::MemoryStats Engine::getMemoryStats() const noexcept {
+    return upcast(this)->getMemoryStats();
+}
+
+void Engine::setMemoryBudget(size_t bytes, MemoryBudgetCallback callback, void* user) noexcept {
+    upcast(this)->setMemoryBudget(bytes, callback, user);
+}
+
+Engine::StartupTimings Engine::getStartupTimings() const noexcept {
+    return upcast(this)->getStartupTimings();
+}
+
 Camera* Engine::createCamera() noexcept {
     return createCamera(upcast(this)->getEntityManager().create());
 }
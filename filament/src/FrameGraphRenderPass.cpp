@@ -16,6 +16,8 @@
 
 #include "RenderPass.h"
 
+#include "BonePalette.h"
+
 #include "details/Material.h"
 #include "details/MaterialInstance.h"
 #include "details/RenderPrimitive.h"
@@ -30,6 +32,8 @@
 #include <utils/JobSystem.h>
 #include <utils/Systrace.h>
 
+#include <algorithm>
+#include <limits>
 #include <utility>
 
 using namespace utils;
@@ -39,9 +43,22 @@ namespace filament {
 
 using namespace backend;
 
+// The default scissor of a MaterialInstance spans INT32_MAX pixels, so compute this on 64 bits.
+static backend::Viewport intersectScissor(
+        backend::Viewport const& a, backend::Viewport const& b) noexcept {
+    const int64_t left = std::max(a.left, b.left);
+    const int64_t bottom = std::max(a.bottom, b.bottom);
+    const int64_t right = std::min(int64_t(a.left) + a.width, int64_t(b.left) + b.width);
+    const int64_t top = std::min(int64_t(a.bottom) + a.height, int64_t(b.bottom) + b.height);
+    return { int32_t(left), int32_t(bottom),
+            uint32_t(std::max(right - left, int64_t(0))),
+            uint32_t(std::max(top - bottom, int64_t(0))) };
+}
+
 RenderPass::RenderPass(FEngine& engine,
-        GrowingSlice<RenderPass::Command> commands) noexcept
-        : mEngine(engine), mCommands(commands),
+        GrowingSlice<RenderPass::Command> commands,
+        GrowingSlice<RenderPass::PrimitiveInfo> primitiveInfos) noexcept
+        : mEngine(engine), mCommands(commands), mPrimitiveInfos(primitiveInfos),
           mCustomCommands(engine.getPerRenderPassAllocator()) {
     mCustomCommands.reserve(8); // preallocate allocate a reasonable number of custom commands
 }
@@ -74,10 +91,15 @@ void RenderPass::overridePolygonOffset(backend::PolygonOffset* polygonOffset) no
 RenderPass::Command* RenderPass::newCommandBuffer() noexcept {
     GrowingSlice<Command>& commands = mCommands;
     commands = GrowingSlice<Command>(commands.end(), commands.capacity() - commands.size());
+    // the previous passes keep referring to their PrimitiveInfos
+    GrowingSlice<PrimitiveInfo>& infos = mPrimitiveInfos;
+    infos = GrowingSlice<PrimitiveInfo>(infos.end(), infos.capacity() - infos.size());
+    mSortedCount = 0;
     return commands.begin();
 }
 
-RenderPass::Command* RenderPass::appendCommands(CommandTypeFlags const commandTypeFlags) noexcept {
+RenderPass::Command* RenderPass::appendCommands(CommandTypeFlags const commandTypeFlags,
+        CommandCache* cache) noexcept {
     SYSTRACE_CONTEXT();
 
     FEngine& engine = mEngine;
@@ -88,6 +110,9 @@ RenderPass::Command* RenderPass::appendCommands(CommandTypeFlags const commandTy
     CameraInfo const& camera = mCamera;
     utils::Range<uint32_t> vr = mVisibleRenderables;
     if (UTILS_UNLIKELY(vr.empty())) {
+        if (cache) {
+            cache->invalidate();
+        }
         return commands.end();
     }
     assert_invariant(mRenderableSoa);
@@ -99,6 +124,20 @@ RenderPass::Command* RenderPass::appendCommands(CommandTypeFlags const commandTy
     FScene::RenderableSoa const& soa = *mRenderableSoa;
     updateSummedPrimitiveCounts(const_cast<FScene::RenderableSoa&>(soa), vr);
 
+    // we extract camera position/forward outside of the loop, because these are not cheap.
+    const float3 cameraPosition(camera.getPosition());
+    const float3 cameraForwardVector(camera.getForwardVector());
+
+    // the cache can only be used when its commands are the only ones in the buffer
+    cache = commands.empty() ? cache : nullptr;
+    if (cache && patchCachedCommands(*cache, commandTypeFlags,
+            cameraPosition, cameraForwardVector)) {
+        updateCommandCache(*cache, commandTypeFlags, cameraPosition, cameraForwardVector);
+        commands.grow(1)->key = uint64_t(Pass::SENTINEL);
+        mCommandsHighWatermark = std::max(mCommandsHighWatermark, size_t(commands.size()));
+        return commands.end();
+    }
+
     // compute how much maximum storage we need for this pass
     uint32_t growBy = FScene::getPrimitiveCount(soa, vr.last);
     // double the color pass for transparent objects that need to render twice
@@ -106,14 +145,14 @@ RenderPass::Command* RenderPass::appendCommands(CommandTypeFlags const commandTy
     const bool depthPass  = bool(commandTypeFlags & CommandTypeFlags::DEPTH);
     growBy *= uint32_t(colorPass * 2 + depthPass);
     Command* const curr = commands.grow(growBy);
+    const uint32_t infoIndex = mPrimitiveInfos.size();
+    PrimitiveInfo* const infos = mPrimitiveInfos.begin();
+    mPrimitiveInfos.grow(growBy);
 
-    // we extract camera position/forward outside of the loop, because these are not cheap.
-    const float3 cameraPosition(camera.getPosition());
-    const float3 cameraForwardVector(camera.getForwardVector());
-    auto work = [commandTypeFlags, curr, &soa, renderFlags, visibilityMask, cameraPosition,
-                 cameraForwardVector]
+    auto work = [commandTypeFlags, curr, infos, infoIndex, &soa, renderFlags, visibilityMask,
+                 cameraPosition, cameraForwardVector]
             (uint32_t startIndex, uint32_t indexCount) {
-        RenderPass::generateCommands(commandTypeFlags, curr,
+        RenderPass::generateCommands(commandTypeFlags, curr, infos, infoIndex,
                 soa, { startIndex, startIndex + indexCount }, renderFlags, visibilityMask,
                 cameraPosition, cameraForwardVector);
     };
@@ -126,6 +165,11 @@ RenderPass::Command* RenderPass::appendCommands(CommandTypeFlags const commandTy
         js.runAndWait(jobCommandsParallel);
     }
 
+    if (cache) {
+        sortCommandRange(commands.begin());
+        updateCommandCache(*cache, commandTypeFlags, cameraPosition, cameraForwardVector);
+    }
+
     // always add an "eof" command
     // "eof" command. these commands are guaranteed to be sorted last in the
     // command buffer.
@@ -137,7 +181,7 @@ RenderPass::Command* RenderPass::appendCommands(CommandTypeFlags const commandTy
 }
 
 RenderPass::Command* RenderPass::appendCustomCommand(Pass pass, CustomCommand custom, uint32_t order,
-        std::function<void()> command) {
+        CustomCommandFn command) {
 
     assert((uint64_t(order) << CUSTOM_ORDER_SHIFT) <=  CUSTOM_ORDER_MASK);
 
@@ -159,7 +203,13 @@ RenderPass::Command* RenderPass::sortCommands() noexcept {
 
     GrowingSlice<Command>& commands = mCommands;
 
-    std::sort(commands.begin(), commands.end());
+    // commands coming from a CommandCache are already sorted, only what was added after them
+    // (e.g. custom commands) needs sorting and merging.
+    Command* const middle = commands.begin() + mSortedCount;
+    sortCommandRange(middle);
+    if (mSortedCount) {
+        std::inplace_merge(commands.begin(), middle, commands.end());
+    }
 
     // find the last command
     Command const* const last = std::partition_point(commands.begin(), commands.end(),
@@ -172,6 +222,338 @@ RenderPass::Command* RenderPass::sortCommands() noexcept {
     return commands.end();
 }
 
+namespace {
+struct SortChunk {
+    uint32_t begin;
+    uint32_t end;
+};
+
+inline SortChunk getSortChunk(uint32_t chunk, uint32_t chunkSize, uint32_t count) noexcept {
+    return { std::min(chunk * chunkSize, count), std::min((chunk + 1) * chunkSize, count) };
+}
+} // anonymous namespace
+
+size_t RenderPass::getRadixSortScratchSize(uint32_t count) noexcept {
+    // a ping-pong command array and a 256-entries histogram per chunk
+    return count * sizeof(Command) + RADIX_SORT_MAX_CHUNKS * 256 * sizeof(uint32_t);
+}
+
+bool RenderPass::radixSortCommands(JobSystem& js, Command* const commands, uint32_t const count,
+        void* scratch, size_t scratchSize) noexcept {
+    SYSTRACE_CALL();
+
+    if (scratchSize < getRadixSortScratchSize(count)) {
+        return false;
+    }
+
+    // Commands are only 16 bytes, as small as a (key, index) pair would be, so they're
+    // scattered directly and no final permutation is needed.
+    Command* src = commands;
+    Command* dst = static_cast<Command*>(scratch);
+    uint32_t* const histograms = reinterpret_cast<uint32_t*>(dst + count);
+
+    auto getChunkCount = [](uint32_t n) -> uint32_t {
+        return std::max(1u, std::min(n / RADIX_SORT_CHUNK_MIN_SIZE, RADIX_SORT_MAX_CHUNKS));
+    };
+
+    auto runChunks = [&js](uint32_t chunkCount, auto const& work) {
+        auto* job = jobs::parallel_for(js, nullptr, 0, chunkCount,
+                [&work](uint32_t start, uint32_t c) {
+                    for (uint32_t i = start, e = start + c; i < e; i++) {
+                        work(i);
+                    }
+                }, jobs::CountSplitter<1, RADIX_SORT_MAX_CHUNKS>());
+        js.runAndWait(job);
+    };
+
+    // Sentinels don't need sorting (they're trimmed), so each chunk packs its keys at the
+    // front of its range in dst and its sentinels at the back. At the same time we accumulate
+    // which key bits vary, so that constant digits can be skipped; this is common because most
+    // passes leave entire fields of the key to zero.
+    uint32_t keyCount[RADIX_SORT_MAX_CHUNKS];
+    CommandKey keyOr[RADIX_SORT_MAX_CHUNKS];
+    CommandKey keyAnd[RADIX_SORT_MAX_CHUNKS];
+    uint32_t chunkCount = getChunkCount(count);
+    uint32_t chunkSize = (count + chunkCount - 1) / chunkCount;
+    runChunks(chunkCount, [=, &keyCount, &keyOr, &keyAnd](uint32_t chunk) {
+        const SortChunk range = getSortChunk(chunk, chunkSize, count);
+        uint32_t front = range.begin;
+        uint32_t back = range.end;
+        CommandKey o = 0;
+        CommandKey a = ~CommandKey(0);
+        for (uint32_t i = range.begin; i < range.end; i++) {
+            Command const& command = src[i];
+            if (UTILS_LIKELY(command.key != CommandKey(Pass::SENTINEL))) {
+                o |= command.key;
+                a &= command.key;
+                dst[front++] = command;
+            } else {
+                dst[--back] = command;
+            }
+        }
+        keyCount[chunk] = front - range.begin;
+        keyOr[chunk] = o;
+        keyAnd[chunk] = a;
+    });
+
+    // gather all keys at the front of src and all sentinels at the back
+    uint32_t sortCount = 0;
+    CommandKey varyingBits = 0;
+    { // scope for systrace
+        SYSTRACE_NAME("compact keys");
+        CommandKey o = 0;
+        CommandKey a = ~CommandKey(0);
+        uint32_t sentinelCount = 0;
+        for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+            const SortChunk range = getSortChunk(chunk, chunkSize, count);
+            const uint32_t n = keyCount[chunk];
+            std::copy_n(dst + range.begin, n, src + sortCount);
+            std::copy_n(dst + range.begin + n, range.end - range.begin - n,
+                    src + count - sentinelCount - (range.end - range.begin - n));
+            sortCount += n;
+            sentinelCount += range.end - range.begin - n;
+            if (n) {
+                o |= keyOr[chunk];
+                a &= keyAnd[chunk];
+            }
+        }
+        varyingBits = o ^ a;
+    }
+
+    // LSD radix sort of src[0, sortCount), 8 bits at a time
+    chunkCount = getChunkCount(sortCount);
+    chunkSize = (sortCount + chunkCount - 1) / chunkCount;
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+        if (((varyingBits >> shift) & 0xFF) == 0) {
+            // all keys have the same digit, this pass wouldn't move anything
+            continue;
+        }
+
+        SYSTRACE_NAME("radix pass");
+
+        // per-chunk histograms
+        runChunks(chunkCount, [=](uint32_t chunk) {
+            const SortChunk range = getSortChunk(chunk, chunkSize, sortCount);
+            uint32_t* const UTILS_RESTRICT histogram = histograms + chunk * 256;
+            std::fill_n(histogram, 256, 0);
+            for (uint32_t i = range.begin; i < range.end; i++) {
+                histogram[(src[i].key >> shift) & 0xFF]++;
+            }
+        });
+
+        // turn the histograms into each chunk's starting offset for each bucket, buckets
+        // must be laid out in order, and chunks within a bucket too, to keep the sort stable.
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < 256; bucket++) {
+            for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+                uint32_t& h = histograms[chunk * 256 + bucket];
+                const uint32_t n = h;
+                h = offset;
+                offset += n;
+            }
+        }
+
+        // scatter
+        runChunks(chunkCount, [=](uint32_t chunk) {
+            const SortChunk range = getSortChunk(chunk, chunkSize, sortCount);
+            uint32_t* const UTILS_RESTRICT offsets = histograms + chunk * 256;
+            for (uint32_t i = range.begin; i < range.end; i++) {
+                Command const& command = src[i];
+                dst[offsets[(command.key >> shift) & 0xFF]++] = command;
+            }
+        });
+
+        std::swap(src, dst);
+    }
+
+    // The sentinels are always at the back of commands, but the last pass may have left the
+    // sorted keys in the scratch buffer.
+    if (src != commands) {
+        SYSTRACE_NAME("copy commands");
+        std::copy_n(src, sortCount, commands);
+    }
+
+    return true;
+}
+
+void RenderPass::sortCommandRange(Command* const first) noexcept {
+    GrowingSlice<Command>& commands = mCommands;
+    const uint32_t count = uint32_t(commands.end() - first);
+
+    // the unused tail of the command buffer serves as scratch memory for the radix sort, it's
+    // not in use until the next newCommandBuffer().
+    Command* const tail = commands.end();
+    const size_t tailSize = (commands.capacity() - commands.size()) * sizeof(Command);
+    if (count < RADIX_SORT_MIN_COUNT ||
+            !radixSortCommands(mEngine.getJobSystem(), first, count, tail, tailSize)) {
+        std::sort(first, commands.end());
+    }
+}
+
+uint64_t RenderPass::hashRenderableInputs(FScene::RenderableSoa const& soa, uint32_t i) noexcept {
+    // this must cover everything generateCommandsImpl() reads, except the per-pass state
+    uint64_t h = 0xcbf29ce484222325llu;
+    auto mix = [&h](uint64_t v) {
+        h = (h ^ v) * 0x100000001b3llu;
+        h ^= h >> 29u;
+    };
+
+    auto const& visibility = soa.elementAt<FScene::VISIBILITY_STATE>(i);
+    float3 const& center = soa.elementAt<FScene::WORLD_AABB_CENTER>(i);
+    Slice<FRenderPrimitive> const& primitives = soa.elementAt<FScene::PRIMITIVES>(i);
+
+    mix(soa.elementAt<FScene::RENDERABLE_INSTANCE>(i).asValue());
+    mix(uint64_t(reinterpret_cast<uint32_t const&>(center.x)) << 32u |
+                 reinterpret_cast<uint32_t const&>(center.y));
+    mix(uint64_t(reinterpret_cast<uint32_t const&>(center.z)) << 32u |
+                 soa.elementAt<FScene::BONES_UBH>(i).getId());
+    mix(soa.elementAt<FScene::BONES_OFFSET>(i));
+    mix(uint64_t(reinterpret_cast<uint16_t const&>(visibility)) << 32u |
+            uint64_t(soa.elementAt<FScene::REVERSED_WINDING_ORDER>(i)) << 24u |
+            uint64_t(soa.elementAt<FScene::VISIBLE_MASK>(i)) << 16u |
+            soa.elementAt<FScene::INSTANCES>(i));
+    mix(uintptr_t(primitives.data()) ^ primitives.size());
+
+    for (FRenderPrimitive const& primitive : primitives) {
+        FMaterialInstance const* const mi = primitive.getMaterialInstance();
+        mix(uintptr_t(mi));
+        mix(uint64_t(primitive.getHwHandle().getId()) << 32u |
+                uint64_t(primitive.getBlendOrder()) << 16u |
+                uint64_t(primitive.getPrimitiveType()));
+        mix(primitive.getPrimitiveCount());
+        if (mi) {
+            mix(mi->getSortingKey());
+            mix(uint64_t(mi->getCullingMode()) << 24u |
+                    uint64_t(mi->getColorWrite()) << 16u |
+                    uint64_t(mi->getDepthWrite()) << 8u |
+                    uint64_t(mi->getDepthFunc()));
+        }
+    }
+    return h;
+}
+
+bool RenderPass::patchCachedCommands(CommandCache& cache, CommandTypeFlags const commandTypeFlags,
+        float3 const cameraPosition, float3 const cameraForward) noexcept {
+    SYSTRACE_CALL();
+
+    JobSystem& js = mEngine.getJobSystem();
+    GrowingSlice<Command>& commands = mCommands;
+    FScene::RenderableSoa const& soa = *mRenderableSoa;
+    const RenderFlags renderFlags = mFlags;
+    const FScene::VisibleMaskType visibilityMask = mVisibilityMask;
+    const Range<uint32_t> vr = mVisibleRenderables;
+
+    // hash the inputs of all visible renderables, this is the only work done when nothing
+    // changed since the last frame.
+    std::vector<uint64_t>& hashes = cache.mNextHashes;
+    hashes.resize(vr.size());
+    auto work = [&hashes, &soa, first = vr.first](uint32_t startIndex, uint32_t indexCount) {
+        for (uint32_t i = startIndex, e = startIndex + indexCount; i < e; i++) {
+            hashes[i - first] = hashRenderableInputs(soa, i);
+        }
+    };
+    auto* jobHashParallel = jobs::parallel_for(js, nullptr, vr.first, (uint32_t)vr.size(),
+            std::cref(work), jobs::CountSplitter<JOBS_PARALLEL_FOR_COMMANDS_COUNT, 8>());
+    js.runAndWait(jobHashParallel);
+
+    // the camera and the pass settings affect all commands
+    cache.mDirtyCount = vr.size();
+    if (!cache.mValid ||
+            cache.mCommandTypeFlags != commandTypeFlags ||
+            cache.mRenderFlags != renderFlags ||
+            cache.mVisibilityMask != visibilityMask ||
+            cache.mFirst != vr.first ||
+            cache.mCameraPosition != cameraPosition ||
+            cache.mCameraForward != cameraForward) {
+        return false;
+    }
+
+    // renderables are identified by their position in the SoA, which is what commands refer to
+    std::vector<uint64_t> const& previous = cache.mHashes;
+    auto isDirty = [&previous, &hashes, first = vr.first](uint32_t i) {
+        i -= first;
+        return i >= previous.size() || previous[i] != hashes[i];
+    };
+
+    uint32_t dirtyCount = 0;
+    for (uint32_t i = vr.first; i < vr.last; i++) {
+        dirtyCount += isDirty(i);
+    }
+    cache.mDirtyCount = dirtyCount;
+
+    // past a certain point, patching is more expensive than starting over
+    if (dirtyCount > vr.size() / 4) {
+        return false;
+    }
+
+    // keep the commands of clean renderables, they're still sorted
+    GrowingSlice<PrimitiveInfo>& infos = mPrimitiveInfos;
+    std::vector<PrimitiveInfo> const& cachedInfos = cache.mPrimitiveInfos;
+    Command* curr = commands.grow(cache.mCommands.size());
+    for (Command const& command : cache.mCommands) {
+        PrimitiveInfo const& info = cachedInfos[command.info];
+        const uint32_t i = info.index;
+        if (i < vr.last && !isDirty(i)) {
+            *curr++ = { command.key, infos.size() };
+            infos.push_back(info);
+        }
+    }
+    commands.resize(uint32_t(curr - commands.begin()));
+    Command* const middle = commands.end();
+
+    // regenerate the commands of dirty renderables
+    const bool colorPass  = bool(commandTypeFlags & CommandTypeFlags::COLOR);
+    const bool depthPass  = bool(commandTypeFlags & CommandTypeFlags::DEPTH);
+    const uint32_t commandsPerPrimitive = uint32_t(colorPass * 2 + depthPass);
+    for (uint32_t i = vr.first; i < vr.last; i++) {
+        if (isDirty(i)) {
+            const uint32_t count = uint32_t(soa.elementAt<FScene::PRIMITIVES>(i).size());
+            const uint32_t infoIndex = infos.size();
+            infos.grow(count * commandsPerPrimitive);
+            generateCommandsAt(commandTypeFlags, commands.grow(count * commandsPerPrimitive),
+                    infos.begin(), infoIndex,
+                    soa, { i, i + 1 }, renderFlags, visibilityMask, cameraPosition, cameraForward);
+        }
+    }
+
+    // and merge them in
+    const uint32_t sortedCount = uint32_t(middle - commands.begin());
+    sortCommandRange(middle);
+    std::inplace_merge(commands.begin(), commands.begin() + sortedCount, commands.end());
+    return true;
+}
+
+void RenderPass::updateCommandCache(CommandCache& cache, CommandTypeFlags const commandTypeFlags,
+        float3 const cameraPosition, float3 const cameraForward) noexcept {
+    SYSTRACE_CALL();
+
+    // commands are sorted at this point, trim the sentinels
+    GrowingSlice<Command>& commands = mCommands;
+    Command const* const last = std::partition_point(commands.begin(), commands.end(),
+            [](Command const& c) {
+                return c.key != uint64_t(Pass::SENTINEL);
+            });
+    commands.resize(uint32_t(last - commands.begin()));
+    mSortedCount = commands.size();
+
+    // the cache keeps its own copy of the PrimitiveInfos, without those of the sentinels
+    const uint32_t count = commands.size();
+    cache.mCommands.resize(count);
+    cache.mPrimitiveInfos.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        cache.mPrimitiveInfos[i] = mPrimitiveInfos[commands[i].info];
+        cache.mCommands[i] = { commands[i].key, i };
+    }
+    std::swap(cache.mHashes, cache.mNextHashes);
+    cache.mCameraPosition = cameraPosition;
+    cache.mCameraForward = cameraForward;
+    cache.mFirst = mVisibleRenderables.first;
+    cache.mVisibilityMask = mVisibilityMask;
+    cache.mRenderFlags = mFlags;
+    cache.mCommandTypeFlags = commandTypeFlags;
+    cache.mValid = true;
+}
+
 void RenderPass::execute(const char* name,
         backend::Handle<backend::HwRenderTarget> renderTarget,
         backend::RenderPassParams params) const noexcept {
@@ -184,12 +566,35 @@ void RenderPass::execute(const char* name,
 
 void RenderPass::executeCommands(const char* name) const noexcept {
     DriverApi& driver = mEngine.getDriverApi();
-    RenderPass::recordDriverCommands(driver, mCommands.begin(), mCommands.end());
+    Renderer::RenderStats::Counts counts;
+    RenderPass::recordDriverCommands(driver, mCommands.begin(), mCommands.end(), counts);
+    if (UTILS_UNLIKELY(mRenderStats)) {
+        addRenderStats(*mRenderStats, name, counts);
+    }
+}
+
+void RenderPass::addRenderStats(Renderer::RenderStats& stats, const char* name,
+        Renderer::RenderStats::Counts const& counts) noexcept {
+    auto add = [](Renderer::RenderStats::Counts& lhs, Renderer::RenderStats::Counts const& rhs) {
+        lhs.drawCalls += rhs.drawCalls;
+        lhs.primitives += rhs.primitives;
+        lhs.programChanges += rhs.programChanges;
+        lhs.pipelineChanges += rhs.pipelineChanges;
+        lhs.uniformBufferBinds += rhs.uniformBufferBinds;
+        lhs.samplerBinds += rhs.samplerBinds;
+    };
+    add(stats.total, counts);
+    if (stats.passCount < Renderer::RenderStats::MAX_PASS_COUNT) {
+        stats.passes[stats.passCount++] = { name, counts };
+    } else {
+        // passes that don't fit are included in the last one
+        add(stats.passes[stats.passCount - 1].counts, counts);
+    }
 }
 
 UTILS_NOINLINE // no need to be inlined
 void RenderPass::recordDriverCommands(FEngine::DriverApi& driver, const Command* first,
-        const Command* last) const noexcept {
+        const Command* last, Renderer::RenderStats::Counts& counts) const noexcept {
     SYSTRACE_CALL();
 
     if (first != last) {
@@ -201,43 +606,127 @@ void RenderPass::recordDriverCommands(FEngine::DriverApi& driver, const Command*
                 mPolygonOffsetOverride ? &dummyPolyOffset : &pipeline.polygonOffset;
 
         Handle<HwUniformBuffer> uboHandle = mUboHandle;
+        PrimitiveInfo const* const UTILS_RESTRICT infos = mPrimitiveInfos.data();
         FMaterialInstance const* UTILS_RESTRICT mi = nullptr;
         FMaterial const* UTILS_RESTRICT ma = nullptr;
         auto const& customCommands = mCustomCommands;
 
-        first--;
-        while (++first != last) {
-            /*
-             * Be careful when changing code below, this is the hot inner-loop
-             */
-
-            if (UTILS_UNLIKELY((first->key & CUSTOM_MASK) != uint64_t(CustomCommand::PASS))) {
-                uint32_t index = (first->key & CUSTOM_INDEX_MASK) >> CUSTOM_INDEX_SHIFT;
-                customCommands[index]();
+        // Consecutive commands often come from the same renderable (one per primitive), their
+        // per-renderable bindings are only needed once. UINT32_MAX never matches an index.
+        uint32_t currentIndex = std::numeric_limits<uint32_t>::max();
+
+        // the state of the previous draw, to count the state changes
+        Handle<HwProgram> currentProgram;
+        RasterState currentRasterState;
+        bool firstDraw = true;
+
+        // The driver commands recorded for a single draw can't be larger than this. There is one
+        // term per driver call of the loop below, keep them in sync when changing it.
+        constexpr size_t maxCommandSizeInBytes =
+                // ma->getProgram(), the first time a program is used
+                CommandBase::align(sizeof(COMMAND_TYPE(createProgramR))) +
+                // mi->use()
+                CommandBase::align(sizeof(COMMAND_TYPE(bindUniformBufferRange))) +
+                CommandBase::align(sizeof(COMMAND_TYPE(bindSamplers))) +
+                // PER_RENDERABLE
+                CommandBase::align(sizeof(COMMAND_TYPE(bindUniformBufferRange))) +
+                // PER_RENDERABLE_BONES
+                CommandBase::align(sizeof(COMMAND_TYPE(bindUniformBufferRange))) +
+                CommandBase::align(sizeof(COMMAND_TYPE(draw)));
+
+        FEngine& engine = mEngine;
+        const size_t capacity = engine.getCommandBufferCapacity();
+        const bool skipPendingPrograms = engine.isAsynchronousProgramCompilationEnabled();
+        CircularBuffer const& circularBuffer = driver.getCircularBuffer();
+
+        while (first != last) {
+            // Large passes could overflow the command buffer, so we only record as many draws
+            // as fit in what's left of it, and flush it before recording the next ones.
+            const size_t used = std::min(capacity, circularBuffer.getUsed());
+            const size_t count = std::min(size_t(last - first),
+                    (capacity - used) / maxCommandSizeInBytes);
+            if (UTILS_UNLIKELY(count == 0)) {
+                engine.flush();
                 continue;
             }
+            Command const* const batchLast = first + count;
+
+            first--;
+            while (++first != batchLast) {
+                /*
+                 * Be careful when changing code below, this is the hot inner-loop
+                 */
+
+                if (UTILS_UNLIKELY((first->key & CUSTOM_MASK) != uint64_t(CustomCommand::PASS))) {
+                    uint32_t index = (first->key & CUSTOM_INDEX_MASK) >> CUSTOM_INDEX_SHIFT;
+                    customCommands[index]();
+                    // custom commands can change any binding
+                    currentIndex = std::numeric_limits<uint32_t>::max();
+                    continue;
+                }
+
+                // Sorting scattered the PrimitiveInfos, fetch the one of a following command
+                // while we record this one. The index of a custom command is meaningless, but
+                // prefetching a bad address is harmless.
+                constexpr size_t PREFETCH_DISTANCE = 4;
+                if (UTILS_LIKELY(last - first > PREFETCH_DISTANCE)) {
+                    UTILS_PREFETCH(infos + first[PREFETCH_DISTANCE].info);
+                }
 
-            // per-renderable uniform
-            const PrimitiveInfo info = first->primitive;
-            pipeline.rasterState = info.rasterState;
-            if (UTILS_UNLIKELY(mi != info.mi)) {
-                // this is always taken the first time
-                mi = info.mi;
-                ma = mi->getMaterial();
-                pipeline.scissor = mi->getScissor();
-                *pPipelinePolygonOffset = mi->getPolygonOffset();
-                mi->use(driver);
+                // per-renderable uniform
+                const PrimitiveInfo info = infos[first->info];
+                pipeline.rasterState = info.rasterState;
+                if (UTILS_UNLIKELY(mi != info.mi)) {
+                    // this is always taken the first time
+                    mi = info.mi;
+                    ma = mi->getMaterial();
+                    pipeline.scissor = mi->getScissor();
+                    if (UTILS_UNLIKELY(mScissor.width && mScissor.height)) {
+                        pipeline.scissor = intersectScissor(pipeline.scissor, mScissor);
+                    }
+                    *pPipelinePolygonOffset = mi->getPolygonOffset();
+                    mi->use(driver);
+                    counts.uniformBufferBinds += mi->hasUniformBuffer();
+                    counts.samplerBinds += mi->hasSamplers();
+                }
+
+                pipeline.program = ma->getProgram(info.materialVariant.key);
+                if (UTILS_UNLIKELY(skipPendingPrograms &&
+                        !ma->isProgramReady(info.materialVariant.key))) {
+                    // don't stall on a program that is still compiling, draw it next frame
+                    continue;
+                }
+                if (UTILS_LIKELY(currentIndex != info.index)) {
+                    currentIndex = info.index;
+                    size_t offset = info.index * sizeof(PerRenderableUib);
+                    driver.bindUniformBufferRange(BindingPoints::PER_RENDERABLE,
+                            uboHandle, offset, sizeof(PerRenderableUib));
+                    counts.uniformBufferBinds++;
+                    if (UTILS_UNLIKELY(info.perRenderableBones)) {
+                        driver.bindUniformBufferRange(BindingPoints::PER_RENDERABLE_BONES,
+                                info.perRenderableBones,
+                                info.perRenderableBonesOffset * BonePalette::RANGE_ALIGNMENT,
+                                BonePalette::BINDING_SIZE);
+                        counts.uniformBufferBinds++;
+                    }
+                }
+                driver.draw(pipeline, info.primitiveHandle, info.instanceCount);
+
+                const bool programChanged = firstDraw || currentProgram != pipeline.program;
+                const bool rasterChanged = firstDraw ||
+                        currentRasterState.u != pipeline.rasterState.u;
+                counts.drawCalls++;
+                counts.primitives += info.primitiveCount * info.instanceCount;
+                counts.programChanges += programChanged;
+                counts.pipelineChanges += programChanged || rasterChanged;
+                currentProgram = pipeline.program;
+                currentRasterState = pipeline.rasterState;
+                firstDraw = false;
             }
 
-            pipeline.program = ma->getProgram(info.materialVariant.key);
-            size_t offset = info.index * sizeof(PerRenderableUib);
-            driver.bindUniformBufferRange(BindingPoints::PER_RENDERABLE,
-                    uboHandle, offset, sizeof(PerRenderableUib));
-            if (UTILS_UNLIKELY(info.perRenderableBones)) {
-                driver.bindUniformBuffer(BindingPoints::PER_RENDERABLE_BONES,
-                        info.perRenderableBones);
+            if (first != last) {
+                engine.flush();
             }
-            driver.draw(pipeline, info.primitiveHandle);
         }
         mCustomCommands.clear();
     }
@@ -246,17 +735,19 @@ void RenderPass::recordDriverCommands(FEngine::DriverApi& driver, const Command*
 /* static */
 UTILS_ALWAYS_INLINE // this function exists only to make the code more readable. we want it inlined.
 inline              // and we don't need it in the compilation unit
-void RenderPass::setupColorCommand(Command& cmdDraw,
+void RenderPass::setupColorCommand(CommandKey& key, PrimitiveInfo& info,
         FMaterialInstance const* const UTILS_RESTRICT mi, bool inverseFrontFaces) noexcept {
 
     FMaterial const * const UTILS_RESTRICT ma = mi->getMaterial();
+    // folded variants only exist with their bit set, their feature is disabled by uniforms
     uint8_t variant =
-            Variant::filterVariant(cmdDraw.primitive.materialVariant.key, ma->isVariantLit());
+            Variant::filterVariant(info.materialVariant.key, ma->isVariantLit()) |
+            ma->getFoldedVariants();
 
     // Below, we evaluate both commands to avoid a branch
 
-    uint64_t keyBlending = cmdDraw.key;
-    keyBlending &= ~(PASS_MASK | BLENDING_MASK);
+    uint64_t keyBlending = key;
+    keyBlending &= ~(PASS_MASK | BLENDING_MASK | BLEND_UNSORTED_MASK);
     keyBlending |= uint64_t(Pass::BLENDED);
     keyBlending |= uint64_t(CustomCommand::PASS);
 
@@ -265,31 +756,33 @@ void RenderPass::setupColorCommand(Command& cmdDraw,
     bool isBlendingCommand = !hasScreenSpaceRefraction &&
             (blendingMode != BlendingMode::OPAQUE && blendingMode != BlendingMode::MASKED);
 
-    uint64_t keyDraw = cmdDraw.key;
-    keyDraw &= ~(PASS_MASK | BLENDING_MASK | MATERIAL_MASK);
+    uint64_t keyDraw = key;
+    keyDraw &= ~(PASS_MASK | BLENDING_MASK | MATERIAL_MASK | BLEND_UNSORTED_MASK);
     keyDraw |= uint64_t(hasScreenSpaceRefraction ? Pass::REFRACT : Pass::COLOR);
     keyDraw |= uint64_t(CustomCommand::PASS);
     keyDraw |= mi->getSortingKey(); // already all set-up for direct or'ing
     keyDraw |= makeField(variant, MATERIAL_VARIANT_KEY_MASK, MATERIAL_VARIANT_KEY_SHIFT);
     keyDraw |= makeField(ma->getRasterState().alphaToCoverage, BLENDING_MASK, BLENDING_SHIFT);
 
-    cmdDraw.key = isBlendingCommand ? keyBlending : keyDraw;
-    cmdDraw.primitive.rasterState = ma->getRasterState();
-    cmdDraw.primitive.rasterState.inverseFrontFaces = inverseFrontFaces;
-    cmdDraw.primitive.rasterState.culling = mi->getCullingMode();
-    cmdDraw.primitive.rasterState.colorWrite = mi->getColorWrite();
-    cmdDraw.primitive.rasterState.depthWrite = mi->getDepthWrite();
-    cmdDraw.primitive.rasterState.depthFunc = mi->getDepthFunc();
-    cmdDraw.primitive.mi = mi;
-    cmdDraw.primitive.materialVariant.key = variant;
+    key = isBlendingCommand ? keyBlending : keyDraw;
+    info.rasterState = ma->getRasterState();
+    info.rasterState.inverseFrontFaces = inverseFrontFaces;
+    info.rasterState.culling = mi->getCullingMode();
+    info.rasterState.colorWrite = mi->getColorWrite();
+    info.rasterState.depthWrite = mi->getDepthWrite();
+    info.rasterState.depthFunc = mi->getDepthFunc();
+    info.mi = mi;
+    info.materialVariant.key = variant;
     // we keep "RasterState::colorWrite" to the value set by material (could be disabled)
 }
 
 /* static */
 UTILS_NOINLINE
 void RenderPass::generateCommands(uint32_t commandTypeFlags, Command* const commands,
-        FScene::RenderableSoa const& soa, Range<uint32_t> range, RenderFlags renderFlags,
-        FScene::VisibleMaskType visibilityMask, float3 cameraPosition, float3 cameraForward) noexcept {
+        PrimitiveInfo* const infos, uint32_t const infoIndex,
+        FScene::RenderableSoa const& soa, Range<uint32_t> range,
+        RenderFlags renderFlags, FScene::VisibleMaskType visibilityMask,
+        float3 cameraPosition, float3 cameraForward) noexcept {
 
     // generateCommands() writes both the draw and depth commands simultaneously such that
     // we go throw the list of renderables just once.
@@ -304,6 +797,17 @@ void RenderPass::generateCommands(uint32_t commandTypeFlags, Command* const comm
     offset *= uint32_t(colorPass * 2 + depthPass);
     Command* const curr = commands + offset;
 
+    generateCommandsAt(commandTypeFlags, curr, infos, infoIndex + offset, soa, range,
+            renderFlags, visibilityMask, cameraPosition, cameraForward);
+}
+
+/* static */
+void RenderPass::generateCommandsAt(uint32_t commandTypeFlags, Command* const curr,
+        PrimitiveInfo* const infos, uint32_t const infoIndex,
+        FScene::RenderableSoa const& soa, Range<uint32_t> range,
+        RenderFlags renderFlags, FScene::VisibleMaskType visibilityMask,
+        float3 cameraPosition, float3 cameraForward) noexcept {
+
     /*
      * The switch {} below is to coerce the compiler into generating different versions of
      * "generateCommandsImpl" based on which pass we're processing.
@@ -316,11 +820,13 @@ void RenderPass::generateCommands(uint32_t commandTypeFlags, Command* const comm
     switch (commandTypeFlags & (CommandTypeFlags::COLOR | CommandTypeFlags::DEPTH)) {
         case CommandTypeFlags::COLOR:
             generateCommandsImpl<CommandTypeFlags::COLOR>(commandTypeFlags, curr,
-                    soa, range, renderFlags, visibilityMask, cameraPosition, cameraForward);
+                    infos, infoIndex, soa, range, renderFlags, visibilityMask,
+                    cameraPosition, cameraForward);
             break;
         case CommandTypeFlags::DEPTH:
             generateCommandsImpl<CommandTypeFlags::DEPTH>(commandTypeFlags, curr,
-                    soa, range, renderFlags, visibilityMask, cameraPosition, cameraForward);
+                    infos, infoIndex, soa, range, renderFlags, visibilityMask,
+                    cameraPosition, cameraForward);
             break;
         default:
             // we should never end-up here
@@ -333,6 +839,7 @@ template<uint32_t commandTypeFlags>
 UTILS_NOINLINE
 void RenderPass::generateCommandsImpl(uint32_t extraFlags,
         Command* UTILS_RESTRICT curr,
+        PrimitiveInfo* UTILS_RESTRICT infos, uint32_t infoIndex,
         FScene::RenderableSoa const& UTILS_RESTRICT soa, Range<uint32_t> range,
         RenderFlags renderFlags, FScene::VisibleMaskType visibilityMask,
         float3 cameraPosition, float3 cameraForward) noexcept {
@@ -350,13 +857,16 @@ void RenderPass::generateCommandsImpl(uint32_t extraFlags,
     const bool depthContainsShadowCasters = bool(extraFlags & CommandTypeFlags::DEPTH_CONTAINS_SHADOW_CASTERS);
     const bool depthFilterTranslucentObjects = bool(extraFlags & CommandTypeFlags::DEPTH_FILTER_TRANSLUCENT_OBJECTS);
     const bool depthFilterAlphaMaskedObjects = bool(extraFlags & CommandTypeFlags::DEPTH_FILTER_ALPHA_MASKED_OBJECTS);
+    const bool depthPrepass = bool(extraFlags & CommandTypeFlags::DEPTH_PREPASS);
 
     auto const* const UTILS_RESTRICT soaWorldAABBCenter = soa.data<FScene::WORLD_AABB_CENTER>();
     auto const* const UTILS_RESTRICT soaReversedWinding = soa.data<FScene::REVERSED_WINDING_ORDER>();
     auto const* const UTILS_RESTRICT soaVisibility      = soa.data<FScene::VISIBILITY_STATE>();
     auto const* const UTILS_RESTRICT soaPrimitives      = soa.data<FScene::PRIMITIVES>();
     auto const* const UTILS_RESTRICT soaBonesUbh        = soa.data<FScene::BONES_UBH>();
+    auto const* const UTILS_RESTRICT soaBonesOffset     = soa.data<FScene::BONES_OFFSET>();
     auto const* const UTILS_RESTRICT soaVisibilityMask  = soa.data<FScene::VISIBLE_MASK>();
+    auto const* const UTILS_RESTRICT soaInstanceCount   = soa.data<FScene::INSTANCES>();
 
     const bool hasShadowing = renderFlags & HAS_SHADOWING;
     const bool viewInverseFrontFaces = renderFlags & HAS_INVERSE_FRONT_FACES;
@@ -368,18 +878,39 @@ void RenderPass::generateCommandsImpl(uint32_t extraFlags,
     materialVariant.setVsm((renderFlags & HAS_VSM) && hasShadowing);
     materialVariant.setShadowReceiver(false); // this is set per Renderable
 
-    Command cmdColor;
+    // each command written at curr gets the PrimitiveInfo at infos[infoIndex]
+    auto emit = [&curr, infos, &infoIndex](CommandKey key, PrimitiveInfo const& info) {
+        infos[infoIndex] = info;
+        *curr = { key, infoIndex };
+        ++curr;
+        ++infoIndex;
+    };
 
-    Command cmdDepth;
-    cmdDepth.primitive.materialVariant = Variant{ Variant::DEPTH_VARIANT };
-    cmdDepth.primitive.materialVariant.setVsm(renderFlags & HAS_VSM);
-    cmdDepth.primitive.rasterState = {};
-    cmdDepth.primitive.rasterState.colorWrite = renderFlags & HAS_VSM;
-    cmdDepth.primitive.rasterState.depthWrite = true;
-    cmdDepth.primitive.rasterState.depthFunc = RasterState::DepthFunc::GE;
-    cmdDepth.primitive.rasterState.alphaToCoverage = false;
+    CommandKey colorKey = 0;
+    PrimitiveInfo colorInfo;
+
+    CommandKey depthKey = 0;
+    PrimitiveInfo depthInfo;
+    depthInfo.materialVariant = Variant{ Variant::DEPTH_VARIANT };
+    // in the color pass, depth commands are only used by the depth prepass and never write color
+    const bool depthVsm = isDepthPass && (renderFlags & HAS_VSM);
+    depthInfo.materialVariant.setVsm(depthVsm);
+    depthInfo.rasterState = {};
+    depthInfo.rasterState.colorWrite = depthVsm;
+    depthInfo.rasterState.depthWrite = true;
+    depthInfo.rasterState.depthFunc = RasterState::DepthFunc::GE;
+    depthInfo.rasterState.alphaToCoverage = false;
+    // the structure pass also writes the picking buffer when View::pick() has pending queries
+    const bool depthPicking = isDepthPass && (renderFlags & HAS_PICKING) && !depthVsm;
 
     for (uint32_t i = range.first; i < range.last; ++i) {
+        // The primitives live outside of the SoA, the hardware prefetcher can't anticipate
+        // these loads. Fetch the ones of a following renderable while we process this one.
+        constexpr uint32_t PREFETCH_DISTANCE = 4;
+        if (i + PREFETCH_DISTANCE < range.last) {
+            UTILS_PREFETCH(soaPrimitives[i + PREFETCH_DISTANCE].data());
+        }
+
         // Check if this renderable passes the visibilityMask. If it doesn't, encode SENTINEL
         // commands (no-op).
         if (UTILS_UNLIKELY(!(soaVisibilityMask[i] & visibilityMask))) {
@@ -388,8 +919,9 @@ void RenderPass::generateCommandsImpl(uint32_t extraFlags,
             const Slice<FRenderPrimitive>& primitives = soaPrimitives[i];
             const size_t commandsToEncode = (isColorPass * 2 + isDepthPass) * primitives.size();
             for (size_t j = 0; j < commandsToEncode; j++) {
-                curr->key = uint64_t(Pass::SENTINEL);
+                *curr = { uint64_t(Pass::SENTINEL), infoIndex };
                 ++curr;
+                ++infoIndex;
             }
             continue;
         }
@@ -427,23 +959,32 @@ void RenderPass::generateCommandsImpl(uint32_t extraFlags,
         // calculate the per-primitive face winding order inversion
         const bool inverseFrontFaces = viewInverseFrontFaces ^ soaReversedWinding[i];
 
-        cmdColor.key = makeField(soaVisibility[i].priority, PRIORITY_MASK, PRIORITY_SHIFT);
-        cmdColor.primitive.index = (uint16_t)i;
-        cmdColor.primitive.perRenderableBones = soaBonesUbh[i];
-        materialVariant.setShadowReceiver(soaVisibility[i].receiveShadows & hasShadowing);
+        colorKey = makeField(soaVisibility[i].priority, PRIORITY_MASK, PRIORITY_SHIFT);
+        colorInfo.index = (uint16_t)i;
+        colorInfo.perRenderableBones = soaBonesUbh[i];
+        colorInfo.perRenderableBonesOffset = soaBonesOffset[i];
+        colorInfo.instanceCount = soaInstanceCount[i];
+        // small renderables can be shaded without the point/spot lights and shadows
+        const bool reducedShading = soaVisibility[i].reducedShading;
+        materialVariant.setDynamicLighting((renderFlags & HAS_DYNAMIC_LIGHTING) && !reducedShading);
+        materialVariant.setShadowReceiver(soaVisibility[i].receiveShadows & hasShadowing &
+                !reducedShading);
         materialVariant.setSkinning(soaVisibility[i].skinning || soaVisibility[i].morphing);
 
         // we're assuming we're always doing the depth (either way, it's correct)
         // this will generate front to back rendering
-        cmdDepth.key = uint64_t(Pass::DEPTH);
-        cmdDepth.key |= uint64_t(CustomCommand::PASS);
-        cmdDepth.key |= makeField(soaVisibility[i].priority, PRIORITY_MASK, PRIORITY_SHIFT);
-        cmdDepth.key |= makeField(distanceBits, DISTANCE_BITS_MASK, DISTANCE_BITS_SHIFT);
-        cmdDepth.primitive.index = (uint16_t)i;
-        cmdDepth.primitive.perRenderableBones = soaBonesUbh[i];
-        cmdDepth.primitive.materialVariant.setSkinning(soaVisibility[i].skinning || soaVisibility[i].morphing);
-        cmdDepth.primitive.rasterState.inverseFrontFaces = inverseFrontFaces;
-
+        depthKey = uint64_t(Pass::DEPTH);
+        depthKey |= uint64_t(CustomCommand::PASS);
+        depthKey |= makeField(soaVisibility[i].priority, PRIORITY_MASK, PRIORITY_SHIFT);
+        depthKey |= makeField(distanceBits, DISTANCE_BITS_MASK, DISTANCE_BITS_SHIFT);
+        depthInfo.index = (uint16_t)i;
+        depthInfo.perRenderableBones = soaBonesUbh[i];
+        depthInfo.perRenderableBonesOffset = soaBonesOffset[i];
+        depthInfo.instanceCount = soaInstanceCount[i];
+        depthInfo.materialVariant.setSkinning(soaVisibility[i].skinning || soaVisibility[i].morphing);
+        depthInfo.rasterState.inverseFrontFaces = inverseFrontFaces;
+
+        const bool orderIndependent = soaVisibility[i].orderIndependentBlending;
         const bool shadowCaster = soaVisibility[i].castShadows & hasShadowing;
         const bool writeDepthForShadowCasters = depthContainsShadowCasters & shadowCaster;
 
@@ -456,24 +997,31 @@ void RenderPass::generateCommandsImpl(uint32_t extraFlags,
         for (auto const& primitive : primitives) {
             FMaterialInstance const* const mi = primitive.getMaterialInstance();
             if (isColorPass) {
-                cmdColor.primitive.primitiveHandle = primitive.getHwHandle();
-                cmdColor.primitive.materialVariant = materialVariant;
-                RenderPass::setupColorCommand(cmdColor, mi, inverseFrontFaces);
+                colorInfo.primitiveHandle = primitive.getHwHandle();
+                colorInfo.primitiveCount = primitive.getPrimitiveCount();
+                colorInfo.materialVariant = materialVariant;
+                RenderPass::setupColorCommand(colorKey, colorInfo, mi, inverseFrontFaces);
 
-                const bool blendPass = Pass(cmdColor.key & PASS_MASK) == Pass::BLENDED;
+                const bool blendPass = Pass(colorKey & PASS_MASK) == Pass::BLENDED;
                 if (blendPass) {
                     // TODO: at least for transparent objects, AABB should be per primitive
                     // blend pass:
                     // this will sort back-to-front for blended, and honor explicit ordering
-                    // for a given Z value
-                    cmdColor.key &= ~BLEND_ORDER_MASK;
-                    cmdColor.key &= ~BLEND_DISTANCE_MASK;
-                    cmdColor.key |= makeField(~distanceBits,
+                    // for a given Z value.
+                    // Order-independent renderables are not sorted by distance, they're drawn
+                    // after the sorted ones, grouped by material, and in a single pass.
+                    colorKey &= ~BLEND_ORDER_MASK;
+                    colorKey &= ~BLEND_DISTANCE_MASK;
+                    colorKey |= makeField(orderIndependent ?
+                            uint32_t(mi->getSortingKey()) : ~distanceBits,
                             BLEND_DISTANCE_MASK, BLEND_DISTANCE_SHIFT);
-                    cmdColor.key |= makeField(primitive.getBlendOrder(),
+                    colorKey |= makeField(orderIndependent,
+                            BLEND_UNSORTED_MASK, BLEND_UNSORTED_SHIFT);
+                    colorKey |= makeField(primitive.getBlendOrder(),
                             BLEND_ORDER_MASK, BLEND_ORDER_SHIFT);
 
-                    const TransparencyMode mode = mi->getMaterial()->getTransparencyMode();
+                    const TransparencyMode mode = orderIndependent ? TransparencyMode::DEFAULT :
+                            mi->getMaterial()->getTransparencyMode();
 
                     // handle transparent objects, two techniques:
                     //
@@ -486,11 +1034,11 @@ void RenderPass::generateCommandsImpl(uint32_t extraFlags,
                     //     In this mode, we override the user's culling mode.
 
                     // TWO_PASSES_TWO_SIDES: this command will be issued 2nd, draw front faces
-                    cmdColor.primitive.rasterState.culling =
+                    colorInfo.rasterState.culling =
                             (mode == TransparencyMode::TWO_PASSES_TWO_SIDES) ?
-                            CullingMode::BACK : cmdColor.primitive.rasterState.culling;
+                            CullingMode::BACK : colorInfo.rasterState.culling;
 
-                    uint64_t key = cmdColor.key;
+                    uint64_t key = colorKey;
 
                     // draw this command AFTER THE NEXT ONE
                     key |= makeField(1, BLEND_TWO_PASS_MASK, BLEND_TWO_PASS_SHIFT);
@@ -501,49 +1049,68 @@ void RenderPass::generateCommandsImpl(uint32_t extraFlags,
                     // correct for TransparencyMode::DEFAULT -- i.e. cancel the command
                     key |= select(mode == TransparencyMode::DEFAULT);
 
-                    *curr = cmdColor;
-                    curr->key = key;
-                    ++curr;
+                    emit(key, colorInfo);
 
                     // TWO_PASSES_TWO_SIDES: this command will be issued first, draw back sides (i.e. cull front)
-                    cmdColor.primitive.rasterState.culling =
+                    colorInfo.rasterState.culling =
                             (mode == TransparencyMode::TWO_PASSES_TWO_SIDES) ?
-                            CullingMode::FRONT : cmdColor.primitive.rasterState.culling;
+                            CullingMode::FRONT : colorInfo.rasterState.culling;
 
                     // TWO_PASSES_ONE_SIDE: this command will be issued first, draw (back side) in depth buffer only
-                    cmdColor.primitive.rasterState.depthWrite |=  select(mode == TransparencyMode::TWO_PASSES_ONE_SIDE);
-                    cmdColor.primitive.rasterState.colorWrite &= ~select(mode == TransparencyMode::TWO_PASSES_ONE_SIDE);
-                    cmdColor.primitive.rasterState.depthFunc =
+                    colorInfo.rasterState.depthWrite |=  select(mode == TransparencyMode::TWO_PASSES_ONE_SIDE);
+                    colorInfo.rasterState.colorWrite &= ~select(mode == TransparencyMode::TWO_PASSES_ONE_SIDE);
+                    colorInfo.rasterState.depthFunc =
                             (mode == TransparencyMode::TWO_PASSES_ONE_SIDE) ?
-                            SamplerCompareFunc::GE : cmdColor.primitive.rasterState.depthFunc;
+                            SamplerCompareFunc::GE : colorInfo.rasterState.depthFunc;
                 } else {
                     // color pass:
                     // This will bucket objects by Z, front-to-back and then sort by material
                     // in each buckets. We use the top 10 bits of the distance, which
                     // bucketizes the depth by its log2 and in 4 linear chunks in each bucket.
-                    cmdColor.key &= ~Z_BUCKET_MASK;
-                    cmdColor.key |= makeField(distanceBits >> 22u, Z_BUCKET_MASK,
+                    colorKey &= ~Z_BUCKET_MASK;
+                    colorKey |= makeField(distanceBits >> 22u, Z_BUCKET_MASK,
                             Z_BUCKET_SHIFT);
 
-                    curr->key = uint64_t(Pass::SENTINEL);
-                    ++curr;
+                    // depth prepass: the otherwise unused command renders this primitive
+                    // depth-only first, the color command then only shades visible fragments.
+                    // Objects that don't use the default depth state are left alone.
+                    RasterState const& rs = colorInfo.rasterState;
+                    const bool prepass = depthPrepass &&
+                            Pass(colorKey & PASS_MASK) == Pass::COLOR &&
+                            rs.depthWrite && !rs.alphaToCoverage &&
+                            rs.depthFunc == RasterState::DepthFunc::GE;
+
+                    PrimitiveInfo info = depthInfo;
+                    info.primitiveHandle = primitive.getHwHandle();
+                    info.primitiveCount = primitive.getPrimitiveCount();
+                    info.mi = mi;
+                    info.rasterState.culling = rs.culling;
+                    emit(depthKey | select(!prepass) |
+                            select(primitive.getPrimitiveType() == PrimitiveType::NONE), info);
+
+                    colorInfo.rasterState.depthWrite = rs.depthWrite && !prepass;
+                    colorInfo.rasterState.depthFunc = prepass ?
+                            RasterState::DepthFunc::E : rs.depthFunc;
                 }
 
-                *curr = cmdColor;
                 // handle the case where this primitive is empty / no-op
-                curr->key |= select(primitive.getPrimitiveType() == PrimitiveType::NONE);
-                ++curr;
+                emit(colorKey | select(primitive.getPrimitiveType() == PrimitiveType::NONE),
+                        colorInfo);
             }
 
             if (isDepthPass) {
                 FMaterial const* const ma = mi->getMaterial();
                 RasterState rs = ma->getRasterState();
 
-                // unconditionally write the command
-                cmdDepth.primitive.primitiveHandle = primitive.getHwHandle();
-                cmdDepth.primitive.mi = mi;
-                cmdDepth.primitive.rasterState.culling = mi->getCullingMode();
-                *curr = cmdDepth;
+                depthInfo.primitiveHandle = primitive.getHwHandle();
+                depthInfo.primitiveCount = primitive.getPrimitiveCount();
+                depthInfo.mi = mi;
+                depthInfo.rasterState.culling = mi->getCullingMode();
+
+                // materials built without the picking variant can't be picked
+                const bool picking = depthPicking && ma->hasPickingVariant();
+                depthInfo.materialVariant.setPicking(picking);
+                depthInfo.rasterState.colorWrite = depthVsm || picking;
 
                 BlendingMode blendingMode = ma->getBlendingMode();
                 bool translucent = (blendingMode != BlendingMode::OPAQUE && blendingMode != BlendingMode::MASKED);
@@ -554,11 +1121,10 @@ void RenderPass::generateCommandsImpl(uint32_t extraFlags,
                         & !(depthFilterAlphaMaskedObjects & rs.alphaToCoverage))
                                 | writeDepthForShadowCasters;
 
-                curr->key |= select(!issueDepth);
-
+                // unconditionally write the command, and
                 // handle the case where this primitive is empty / no-op
-                curr->key |= select(primitive.getPrimitiveType() == PrimitiveType::NONE);
-                ++curr;
+                emit(depthKey | select(!issueDepth) |
+                        select(primitive.getPrimitiveType() == PrimitiveType::NONE), depthInfo);
             }
         }
     }
@@ -31,7 +31,16 @@ struct FrameHistoryEntry {
     math::mat4f projection;
     math::float2 jitter{};
     uint32_t frameId = 0;
-
+    // temporal ambient occlusion history
+    FrameGraphTexture ssao;
+    FrameGraphTexture::Descriptor ssaoDesc;
+    math::mat4f ssaoProjection;
+    uint32_t ssaoFrameId = 0;
+    // camera direction, used to estimate the motion for variable rate shading
+    math::float3 cameraForward{};
+    // unjittered camera, used to compute motion vectors
+    math::mat4f clipFromWorld;
+    bool hasClipFromWorld = false;
 };
 
 /*
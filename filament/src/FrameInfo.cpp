@@ -16,6 +16,9 @@
 
 #include "FrameInfo.h"
 
+#include "HardwareCounters.h"
+
+#include <utils/debug.h>
 #include <utils/Log.h>
 #include <utils/Systrace.h>
 
@@ -36,46 +39,172 @@ void move_backward(InputIterator first, InputIterator last, OutputIterator resul
 }
 
 FrameInfoManager::FrameInfoManager(FEngine& engine) : mEngine(engine) {
-    backend::DriverApi& driver = mEngine.getDriverApi();
-    for (auto& query : mQueries) {
-        query = driver.createTimerQuery();
-    }
 }
 
 FrameInfoManager::~FrameInfoManager() noexcept = default;
 
 void FrameInfoManager::terminate() {
     backend::DriverApi& driver = mEngine.getDriverApi();
-    for (auto& query : mQueries) {
-        driver.destroyTimerQuery(query);
+    for (auto& slot : mSlots) {
+        for (auto& segment : slot.segments) {
+            if (segment.query) {
+                driver.destroyTimerQuery(segment.query);
+            }
+        }
     }
 }
 
 void FrameInfoManager::beginFrame(Config const& config, uint32_t frameId) {
-    backend::DriverApi& driver = mEngine.getDriverApi();
-    driver.beginTimerQuery(mQueries[mIndex]);
-    uint64_t elapsed = 0;
-    if (driver.getTimerQueryValue(mQueries[mLast], &elapsed)) {
+    // read back the frames whose timer queries have all completed, keep the most recent
+    while (mPending && readSlot(mSlots[mLast], mMeasured)) {
+        mFrameTimings = mSlots[mLast].timings;
         mLast = (mLast + 1) % POOL_COUNT;
-        // conversion to our duration happens here
-        mFrameTime = std::chrono::duration<uint64_t, std::nano>(elapsed);
+        mPending--;
     }
-    update(config,mFrameTime);
+
+    // if the GPU is too far behind, the queries of the oldest frame are reused for this one
+    if (mPending == POOL_COUNT) {
+        mLast = (mLast + 1) % POOL_COUNT;
+        mPending--;
+    }
+
+    Slot& slot = mSlots[mIndex];
+    slot.count = 0;
+    slot.timings = {};
+    slot.timings.frameId = frameId;
+    mTimedView = nullptr;
+    beginSegment(nullptr, nullptr);
+    mPending++;
+
+    update(config, mMeasured);
 }
 
 void FrameInfoManager::endFrame() {
     backend::DriverApi& driver = mEngine.getDriverApi();
-    driver.endTimerQuery(mQueries[mIndex]);
+    Slot& slot = mSlots[mIndex];
+    driver.endTimerQuery(slot.segments[slot.count - 1].query);
     mIndex = (mIndex + 1) % POOL_COUNT;
 }
 
-void FrameInfoManager::update(Config const& config, FrameInfoManager::duration lastFrameTime) {
+// Splitting a segment always leaves room for the one that ends the view being timed. Passes that
+// don't fit are simply included in the current segment.
+
+bool FrameInfoManager::beginView(FView const* view) noexcept {
+    Slot& slot = mSlots[mIndex];
+    if (slot.count + 2 > SEGMENT_COUNT) {
+        return false;
+    }
+    slot.viewStart = slot.count;
+    mTimedView = view;
+    beginSegment(view, nullptr);
+    return true;
+}
+
+void FrameInfoManager::endView(float area) noexcept {
+    Slot& slot = mSlots[mIndex];
+    assert_invariant(mTimedView && slot.count < SEGMENT_COUNT);
+    for (size_t i = slot.viewStart; i < slot.count; i++) {
+        slot.segments[i].area = area;
+    }
+    mTimedView = nullptr;
+    beginSegment(nullptr, nullptr);
+}
+
+void FrameInfoManager::beginPass(const char* name) noexcept {
+    Slot const& slot = mSlots[mIndex];
+    if (mPassTimingsEnabled && slot.count + 2 <= SEGMENT_COUNT) {
+        beginSegment(mTimedView, name);
+    }
+}
+
+void FrameInfoManager::endPasses() noexcept {
+    Slot const& slot = mSlots[mIndex];
+    if (slot.segments[slot.count - 1].pass && slot.count + 2 <= SEGMENT_COUNT) {
+        beginSegment(mTimedView, nullptr);
+    }
+}
+
+void FrameInfoManager::addCpuTimings(
+        duration culling, duration froxelization, duration commands) noexcept {
+    FrameTimings& timings = mSlots[mIndex].timings;
+    timings.cullingTime += culling.count();
+    timings.froxelizationTime += froxelization.count();
+    timings.commandGenerationTime += commands.count();
+}
+
+void FrameInfoManager::addCpuCounters(FrameTimings::Counters const& culling,
+        FrameTimings::Counters const& froxelization,
+        FrameTimings::Counters const& commands) noexcept {
+    FrameTimings& timings = mSlots[mIndex].timings;
+    timings.cullingCounters += culling;
+    timings.froxelizationCounters += froxelization;
+    timings.commandGenerationCounters += commands;
+}
+
+void FrameInfoManager::beginSegment(FView const* view, const char* pass) noexcept {
+    backend::DriverApi& driver = mEngine.getDriverApi();
+    Slot& slot = mSlots[mIndex];
+    if (slot.count) {
+        driver.endTimerQuery(slot.segments[slot.count - 1].query);
+    }
+    Segment& segment = slot.segments[slot.count++];
+    if (UTILS_UNLIKELY(!segment.query)) {
+        // queries are only created when needed, most frames use a few segments
+        segment.query = driver.createTimerQuery();
+    }
+    segment.view = view;
+    segment.pass = pass;
+    segment.area = 1.0f;
+    driver.beginTimerQuery(segment.query);
+}
+
+bool FrameInfoManager::readSlot(Slot& slot, FrameInfo& info) noexcept {
+    backend::DriverApi& driver = mEngine.getDriverApi();
+    std::array<uint64_t, SEGMENT_COUNT> elapsed{};
+    for (size_t i = 0; i < slot.count; i++) {
+        if (!driver.getTimerQueryValue(slot.segments[i].query, &elapsed[i])) {
+            return false;
+        }
+    }
+
+    FrameTimings& timings = slot.timings;
+    info.frameTime = {};
+    info.viewCount = 0;
+    for (size_t i = 0; i < slot.count; i++) {
+        // conversion to our duration happens here
+        const duration time = std::chrono::duration<uint64_t, std::nano>(elapsed[i]);
+        info.frameTime += time;
+
+        Segment const& segment = slot.segments[i];
+        if (segment.view) {
+            size_t v = 0;
+            while (v < info.viewCount && info.views[v].view != segment.view) {
+                v++;
+            }
+            if (v < info.views.size()) {
+                if (v == info.viewCount) {
+                    info.views[info.viewCount++] = { segment.view, segment.area, {} };
+                }
+                info.views[v].gpuTime += time;
+            }
+        }
+        if (segment.pass && timings.passCount < FrameTimings::MAX_PASS_COUNT) {
+            timings.passes[timings.passCount++] = { segment.pass, time.count() };
+        }
+    }
+    timings.gpuFrameTime = info.frameTime.count();
+    return true;
+}
+
+void FrameInfoManager::update(Config const& config, FrameInfo const& lastFrame) {
     // keep an history of frame times
     auto& history = mFrameTimeHistory;
 
     // this is like doing { pop_back(); push_front(); }
     filament::move_backward(history.begin(), history.end() - 1, history.end());
-    history[0].frameTime = lastFrameTime;
+    history[0].frameTime = lastFrame.frameTime;
+    history[0].views = lastFrame.views;
+    history[0].viewCount = lastFrame.viewCount;
 
     mFrameTimeHistorySize = std::min(++mFrameTimeHistorySize, uint32_t(MAX_FRAMETIME_HISTORY));
     if (UTILS_UNLIKELY(mFrameTimeHistorySize < 3)) {
@@ -98,6 +227,7 @@ void FrameInfoManager::update(Config const& config, FrameInfoManager::duration l
 
     // how much we need to scale the current workload to fit in our target, at this instant
     const duration targetWithHeadroom = config.targetFrameTime * (1.0f - config.headRoomRatio);
+    history[0].targetFrameTime = targetWithHeadroom;
     const duration measured = denoisedFrameTime;
 
     // We use a P.I.D. controller below to figure out the scaling factor to apply. In practice we
@@ -21,6 +21,8 @@
 
 #include "backend/Handle.h"
 
+#include <filament/Renderer.h>
+
 #include <array>
 #include <chrono>
 
@@ -29,24 +31,53 @@
 namespace filament {
 class FEngine;
 
+class FView;
+
 struct FrameInfo {
     using duration = std::chrono::duration<float>;
+    static constexpr size_t MAX_TIMED_VIEWS = 2;
+
+    // GPU time of a view, see FrameInfoManager::beginView()
+    struct ViewTime {
+        FView const* view = nullptr;    // identifies the view, never dereferenced
+        float area = 1.0f;              // area scale factor the view was rendered at
+        duration gpuTime{};
+    };
+
     duration frameTime{};            // frame period
     duration denoisedFrameTime{};    // frame period (median filter)
+    duration targetFrameTime{};      // target frame period, including the headroom
     bool valid = false;
     float scale = 1.0f;
     struct {
         float integral{};
         float error{};
     } pid;
+    std::array<ViewTime, MAX_TIMED_VIEWS> views{};
+    uint8_t viewCount = 0;
+
+    ViewTime const* getViewTime(FView const* view) const noexcept {
+        for (size_t i = 0; i < viewCount; i++) {
+            if (views[i].view == view) {
+                return &views[i];
+            }
+        }
+        return nullptr;
+    }
 };
 
 class FrameInfoManager {
-    static constexpr size_t POOL_COUNT = 8;
+    static constexpr size_t POOL_COUNT = 4;
     static constexpr size_t MAX_FRAMETIME_HISTORY = 32u;
 
+    // GL timer queries can't be nested, so timing a view or a pass splits the frame's timer
+    // query in sequential segments; the frame time is their sum. With all passes timed, this
+    // leaves room for the segments around a few views.
+    static constexpr size_t SEGMENT_COUNT = Renderer::FrameTimings::MAX_PASS_COUNT + 12;
+
 public:
     using duration = FrameInfo::duration;
+    using FrameTimings = Renderer::FrameTimings;
 
     struct Config {
         duration targetFrameTime;
@@ -61,6 +92,29 @@ public:
     void beginFrame(Config const& config, uint32_t frameId);  // call this immediately after "make current"
     void endFrame(); // call this immediately before "swap buffers"
 
+    // Times the GPU work issued until endView() separately, returns false if too many views
+    // are timed in this frame already.
+    bool beginView(FView const* view) noexcept;
+    void endView(float area) noexcept;
+
+    // Times the GPU work issued until the next beginPass() or endPasses() separately, if pass
+    // timings are enabled. name must outlive the engine.
+    void beginPass(const char* name) noexcept;
+    void endPasses() noexcept;
+
+    // CPU timings of the current frame, they're accumulated over its views
+    void addCpuTimings(duration culling, duration froxelization, duration commands) noexcept;
+
+    // hardware counters of the current frame, they're accumulated over its views
+    void addCpuCounters(FrameTimings::Counters const& culling,
+            FrameTimings::Counters const& froxelization,
+            FrameTimings::Counters const& commands) noexcept;
+
+    void setPassTimingsEnabled(bool enabled) noexcept { mPassTimingsEnabled = enabled; }
+    bool isPassTimingsEnabled() const noexcept { return mPassTimingsEnabled; }
+
+    FrameTimings const& getFrameTimings() const noexcept { return mFrameTimings; }
+
     FrameInfo const& getLastFrameInfo() const {
         return mFrameTimeHistory[0];
     }
@@ -71,12 +125,31 @@ public:
 
 
 private:
-    void update(Config const& config, duration lastFrameTime);
+    struct Segment {
+        backend::Handle<backend::HwTimerQuery> query;
+        FView const* view = nullptr;
+        const char* pass = nullptr;
+        float area = 1.0f;
+    };
+    struct Slot {
+        std::array<Segment, SEGMENT_COUNT> segments;
+        uint32_t count = 0;
+        uint32_t viewStart = 0;     // first segment of the view being timed
+        FrameTimings timings;       // CPU timings, GPU timings are filled when known
+    };
+
+    void beginSegment(FView const* view, const char* pass) noexcept;
+    bool readSlot(Slot& slot, FrameInfo& info) noexcept;
+    void update(Config const& config, FrameInfo const& lastFrame);
     FEngine& mEngine;
-    backend::Handle<backend::HwTimerQuery> mQueries[POOL_COUNT];
-    duration mFrameTime{};
+    std::array<Slot, POOL_COUNT> mSlots;
+    FrameInfo mMeasured{};
+    FrameTimings mFrameTimings{};
+    FView const* mTimedView = nullptr;
     uint32_t mIndex = 0;
     uint32_t mLast = 0;
+    uint32_t mPending = 0;
+    bool mPassTimingsEnabled = false;
 
     std::array<FrameInfo, MAX_FRAMETIME_HISTORY> mFrameTimeHistory;
     uint32_t mFrameTimeHistorySize = 0;
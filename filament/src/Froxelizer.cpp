@@ -42,13 +42,6 @@ namespace filament {
 
 using namespace backend;
 
-/*
- * This enables froxels to be rectangular which allows us to use a bit more froxel
- * with the same amount of memory in the GPU.
- * Currently not enabled because not enough tested.
- */
-static constexpr bool USE_NON_SQUARE_FROXELS = false;
-
 // The Froxel buffer is set to FROXEL_BUFFER_WIDTH x n
 // With n limited by the supported texture dimension, which is guaranteed to be at least 2048
 // in all version of GLES.
@@ -69,7 +62,7 @@ constexpr size_t RECORD_BUFFER_ENTRY_COUNT  = RECORD_BUFFER_WIDTH * RECORD_BUFFE
 constexpr size_t PER_FROXELDATA_ARENA_SIZE = sizeof(float4) *
                                                  (FROXEL_BUFFER_ENTRY_COUNT_MAX +
                                                   FROXEL_BUFFER_ENTRY_COUNT_MAX + 3 +
-                                                  FEngine::CONFIG_FROXEL_SLICE_COUNT / 4 + 1);
+                                                  Froxelizer::FROXEL_SLICE_COUNT_MAX / 4 + 1);
 
 
 // number of lights processed by one group (e.g. 32)
@@ -115,15 +108,26 @@ void Froxelizer::terminate(DriverApi& driverApi) noexcept {
     mFroxelBuffer.terminate(driverApi);
 }
 
-void Froxelizer::setOptions(float zLightNear, float zLightFar) noexcept {
-    if (UTILS_UNLIKELY(mZLightNear != zLightNear || mZLightFar != zLightFar)) {
+void Froxelizer::setOptions(float zLightNear, float zLightFar, size_t froxelSliceCount) noexcept {
+    const uint16_t sliceCount = uint16_t(
+            std::min(std::max(froxelSliceCount, size_t(2)), FROXEL_SLICE_COUNT_MAX));
+    if (UTILS_UNLIKELY(mZLightNear != zLightNear || mZLightFar != zLightFar ||
+            mFroxelSliceCount != sliceCount)) {
         mZLightNear = zLightNear;
         mZLightFar = zLightFar;
+        mFroxelSliceCount = sliceCount;
         mDirtyFlags |= VIEWPORT_CHANGED;
     }
 }
 
 
+void Froxelizer::setNonSquareFroxels(bool enabled) noexcept {
+    if (UTILS_UNLIKELY(mNonSquareFroxels != enabled)) {
+        mNonSquareFroxels = enabled;
+        mDirtyFlags |= VIEWPORT_CHANGED;
+    }
+}
+
 void Froxelizer::setViewport(filament::Viewport const& viewport) noexcept {
     if (UTILS_UNLIKELY(mViewport != viewport)) {
         mViewport = viewport;
@@ -174,6 +178,12 @@ bool Froxelizer::prepare(
             arena.allocate<LightRecord>(FROXEL_BUFFER_ENTRY_COUNT_MAX, CACHELINE_SIZE),
             FROXEL_BUFFER_ENTRY_COUNT_MAX };
 
+    // record offset of each row of froxels
+    const uint32_t rowCount = uint32_t(mFroxelCountY * mFroxelCountZ);
+    mRowRecordOffsets = {
+            arena.allocate<uint32_t>(rowCount, CACHELINE_SIZE),
+            rowCount };
+
     // froxel thread data (~256 KiB)
     mFroxelShardedData = {
             arena.allocate<FroxelThreadData>(GROUP_COUNT, CACHELINE_SIZE),
@@ -183,6 +193,7 @@ bool Froxelizer::prepare(
     assert_invariant(mFroxelBufferUser.begin());
     assert_invariant(mRecordBufferUser.begin());
     assert_invariant(mLightRecords.begin());
+    assert_invariant(mRowRecordOffsets.begin());
     assert_invariant(mFroxelShardedData.begin());
 
     // initialize buffers that need to be
@@ -193,16 +204,17 @@ bool Froxelizer::prepare(
 
 void Froxelizer::computeFroxelLayout(
         uint2* dim, uint16_t* countX, uint16_t* countY, uint16_t* countZ,
-        filament::Viewport const& viewport) noexcept {
+        filament::Viewport const& viewport, size_t froxelSliceCount,
+        bool nonSquareFroxels) noexcept {
 
-    if (USE_NON_SQUARE_FROXELS == false) {
-        const uint32_t width  = std::max(16u, viewport.width);
-        const uint32_t height = std::max(16u, viewport.height);
+    const uint32_t width  = std::max(16u, viewport.width);
+    const uint32_t height = std::max(16u, viewport.height);
 
-        // calculate froxel dimension from FROXEL_BUFFER_ENTRY_COUNT_MAX and viewport
-        // - Start from the maximum number of froxels we can use in the x-y plane
-        size_t froxelSliceCount = FEngine::CONFIG_FROXEL_SLICE_COUNT;
-        size_t froxelPlaneCount = FROXEL_BUFFER_ENTRY_COUNT_MAX / froxelSliceCount;
+    // calculate froxel dimension from FROXEL_BUFFER_ENTRY_COUNT_MAX and viewport
+    // - Start from the maximum number of froxels we can use in the x-y plane
+    size_t froxelPlaneCount = FROXEL_BUFFER_ENTRY_COUNT_MAX / froxelSliceCount;
+
+    if (!nonSquareFroxels) {
         // - compute the number of square froxels we need in width and height, rounded down
         //   solving: |  froxelCountX * froxelCountY == froxelPlaneCount
         //            |  froxelCountX / froxelCountY == width / height
@@ -226,18 +238,29 @@ void Froxelizer::computeFroxelLayout(
         *dim = froxelDimension;
         *countX = uint16_t(froxelCountX);
         *countY = uint16_t(froxelCountY);
-        *countZ = uint16_t(froxelSliceCount);
     } else {
-        // TODO: don't hardcode this
-        *countX = uint16_t(32);
-        *countY = uint16_t(16);
-        *countZ = uint16_t(FEngine::CONFIG_FROXEL_SLICE_COUNT);
-        if (viewport.height > viewport.width) {
-            std::swap(*countX, *countY);
-        }
-         dim->x = (viewport.width  + *countX - 1) / *countX;
-         dim->y = (viewport.height + *countY - 1) / *countY;
+        // Rectangular froxels don't lose the froxels that square ones leave unused because of
+        // rounding, so we get the finest grid that fits in the froxel buffer.
+        // - the number of columns follows the aspect ratio, the rows get what's left
+        size_t froxelCountX = size_t(std::sqrt(froxelPlaneCount * width / height));
+        froxelCountX = std::min(std::max(froxelCountX, size_t(1)), froxelPlaneCount);
+        size_t froxelCountY = froxelPlaneCount / froxelCountX;
+        // - compute the froxels dimensions, rounded up
+        const size_t froxelSizeX = (width  + froxelCountX - 1) / froxelCountX;
+        const size_t froxelSizeY = (height + froxelCountY - 1) / froxelCountY;
+        // - the rounding may leave some rows or columns empty, drop them
+        froxelCountX = (width  + froxelSizeX - 1) / froxelSizeX;
+        froxelCountY = (height + froxelSizeY - 1) / froxelSizeY;
+
+        assert_invariant(froxelCountX);
+        assert_invariant(froxelCountY);
+        assert_invariant(froxelCountX * froxelCountY <= froxelPlaneCount);
+
+        *dim = uint2{ froxelSizeX, froxelSizeY };
+        *countX = uint16_t(froxelCountX);
+        *countY = uint16_t(froxelCountY);
     }
+    *countZ = uint16_t(froxelSliceCount);
 }
 
 UTILS_NOINLINE
@@ -248,7 +271,8 @@ bool Froxelizer::update() noexcept {
 
         uint2 froxelDimension;
         uint16_t froxelCountX, froxelCountY, froxelCountZ;
-        computeFroxelLayout(&froxelDimension, &froxelCountX, &froxelCountY, &froxelCountZ, viewport);
+        computeFroxelLayout(&froxelDimension, &froxelCountX, &froxelCountY, &froxelCountZ,
+                viewport, mFroxelSliceCount, mNonSquareFroxels);
 
         mFroxelDimension = froxelDimension;
         mClipToFroxelX = (0.5f * viewport.width)  / froxelDimension.x;
@@ -512,9 +536,24 @@ std::pair<size_t, size_t> Froxelizer::clipToIndices(float2 const& clip) const no
 
 
 void Froxelizer::commit(backend::DriverApi& driverApi) {
-    // send data to GPU
-    mFroxelBuffer.commit(driverApi, mFroxelBufferUser);
-    mRecordsBuffer.commit(driverApi, mRecordBufferUser);
+    // Send data to the GPU, unless it's what we sent last time, which is the common case
+    // with static lights and a static camera. Only the entries the shaders can read are
+    // compared, the rest of the buffers is left uninitialized.
+    FroxelEntry const* const froxels = mFroxelBufferUser.data();
+    const size_t froxelCount = getFroxelCount();
+    if (mCommittedFroxels.size() != froxelCount ||
+            !std::equal(froxels, froxels + froxelCount, mCommittedFroxels.begin(),
+                    [](FroxelEntry lhs, FroxelEntry rhs) { return lhs.u32 == rhs.u32; })) {
+        mFroxelBuffer.commit(driverApi, mFroxelBufferUser);
+        mCommittedFroxels.assign(froxels, froxels + froxelCount);
+    }
+
+    RecordBufferType const* const records = mRecordBufferUser.data();
+    if (mCommittedRecords.size() != mRecordCount ||
+            !std::equal(records, records + mRecordCount, mCommittedRecords.begin())) {
+        mRecordsBuffer.commit(driverApi, mRecordBufferUser);
+        mCommittedRecords.assign(records, records + mRecordCount);
+    }
 #ifndef NDEBUG
     mFroxelBufferUser.clear();
     mRecordBufferUser.clear();
@@ -526,8 +565,8 @@ void Froxelizer::froxelizeLights(FEngine& engine,
         CameraInfo const& UTILS_RESTRICT camera,
         const FScene::LightSoa& UTILS_RESTRICT lightData) noexcept {
     // note: this is called asynchronously
+    // froxelizeLoop() also compresses the records, as soon as all lights are froxelized
     froxelizeLoop(engine, camera, lightData);
-    froxelizeAssignRecordsCompress();
 
 #ifndef NDEBUG
     if (lightData.size()) {
@@ -598,115 +637,175 @@ void Froxelizer::froxelizeLoop(FEngine& engine,
 
     constexpr bool SINGLE_THREADED = false;
     if (!SINGLE_THREADED) {
-        auto *parent = js.createJob();
+        // compressing the records is a continuation of the froxelization jobs, so it starts on
+        // the thread that finishes the last of them, rather than after waking-up this one.
+        auto *compress = js.makeContinuation(jobs::createJob(js, nullptr,
+                &Froxelizer::froxelizeAssignRecordsCompress, this, std::ref(js)));
         for (size_t i = 0; i < GROUP_COUNT; i++) {
-            js.run(jobs::createJob(js, parent, std::cref(process),
+            js.run(jobs::createJob(js, compress, std::cref(process),
                     lightData.size() - FScene::DIRECTIONAL_LIGHTS_COUNT, i, GROUP_COUNT), JobSystem::DONT_SIGNAL);
         }
-        js.runAndWait(parent);
+        js.runAndWait(compress);
     } else {
         js.runAndWait(jobs::createJob(js, nullptr, std::cref(process),
                 lightData.size() - FScene::DIRECTIONAL_LIGHTS_COUNT, 0, 1)
         );
+        froxelizeAssignRecordsCompress(js);
     }
 }
 
-void Froxelizer::froxelizeAssignRecordsCompress() noexcept {
+void Froxelizer::froxelizeAssignRecordsCompress(JobSystem& js) noexcept {
 
     SYSTRACE_CALL();
 
     Slice<FroxelThreadData> froxelThreadData = mFroxelShardedData;
+    utils::Slice<LightRecord> records(mLightRecords);
+    FroxelEntry* const UTILS_RESTRICT froxels = mFroxelBufferUser.data();
+    RecordBufferType* const UTILS_RESTRICT froxelRecords = mRecordBufferUser.data();
+    uint32_t* const UTILS_RESTRICT rowOffsets = mRowRecordOffsets.data();
+
+    const size_t froxelCountX = mFroxelCountX;
+    const size_t froxelCount = getFroxelCount();
+    const uint32_t rowCount = uint32_t(mRowRecordOffsets.size());
+    assert_invariant(rowCount * froxelCountX == froxelCount);
+
+    // Tags stored in FroxelEntry::reserved until the entries are resolved. An entry reusing
+    // the records of the froxel on its left or above it can only be resolved once that froxel
+    // is, which is the only part of the compaction that runs sequentially.
+    enum : uint8_t { NEW = 0, REUSE_LEFT, REUSE_ABOVE, OUT_OF_RECORDS };
+
+    auto runOnRows = [&js, rowCount](auto&& functor) {
+        auto rows = [&functor](uint32_t first, uint32_t count) {
+            for (uint32_t row = first; row < first + count; row++) {
+                functor(row);
+            }
+        };
+        js.runAndWait(jobs::parallel_for(js, nullptr, 0, rowCount,
+                std::cref(rows), jobs::CountSplitter<32>()));
+    };
 
     // convert froxel data from N groups of M bits to LightRecord::bitset, so we can
     // easily compare adjacent froxels, for compaction. The conversion loops below get
     // inlined and vectorized in release builds.
-
-    // this gets very well vectorized...
-    utils::Slice<LightRecord> records(mLightRecords);
-    for (size_t j = 0, jc = FROXEL_BUFFER_ENTRY_COUNT_MAX; j < jc; j++) {
-        for (size_t i = 0; i < LightRecord::bitset::WORLD_COUNT; i++) {
-            using container_type = LightRecord::bitset::container_type;
-            constexpr size_t r = sizeof(container_type) / sizeof(LightGroupType);
-            container_type b = froxelThreadData[i * r][j];
-            for (size_t k = 0; k < r; k++) {
-                b |= (container_type(froxelThreadData[i * r + k][j]) << (LIGHT_PER_GROUP * k));
+    runOnRows([&](uint32_t row) {
+        for (size_t j = row * froxelCountX, jc = j + froxelCountX; j < jc; j++) {
+            for (size_t i = 0; i < LightRecord::bitset::WORLD_COUNT; i++) {
+                using container_type = LightRecord::bitset::container_type;
+                constexpr size_t r = sizeof(container_type) / sizeof(LightGroupType);
+                container_type b = froxelThreadData[i * r][j];
+                for (size_t k = 0; k < r; k++) {
+                    b |= (container_type(froxelThreadData[i * r + k][j]) << (LIGHT_PER_GROUP * k));
+                }
+                records[j].lights.getBitsAt(i) = b;
             }
-            records[j].lights.getBitsAt(i) = b;
         }
+    });
+
+    // Find the froxels that need records of their own, and how many records each row needs.
+    // If a froxel's record doesn't match the one on its left, we re-try with the one above it,
+    // which saves many froxel records (north of 10% in practice).
+    runOnRows([&](uint32_t row) {
+        uint32_t rowRecordCount = 0;
+        for (size_t i = row * froxelCountX, c = i + froxelCountX; i < c; i++) {
+            LightRecord::bitset const& b = records[i].lights;
+            FroxelEntry entry;
+            if (b.any()) {
+                // froxels following an empty froxel always have records of their own
+                const bool hasLeft = i > 0 && records[i - 1].lights.any();
+                if (hasLeft && records[i - 1].lights == b) {
+                    entry.reserved = REUSE_LEFT;
+                } else if (hasLeft && i >= froxelCountX && records[i - froxelCountX].lights == b) {
+                    entry.reserved = REUSE_ABOVE;
+                } else {
+                    // We have a limitation of 255 spot + 255 point lights per froxel.
+                    entry.count = (uint8_t)std::min(size_t(255), b.count());
+                    entry.reserved = NEW;
+                    rowRecordCount += entry.count;
+                }
+            }
+            froxels[i].u32 = entry.u32;
+        }
+        rowOffsets[row] = rowRecordCount;
+    });
+
+    // offset of the first record of each row
+    uint32_t recordCount = 0;
+    for (uint32_t row = 0; row < rowCount; row++) {
+        const uint32_t rowRecordCount = rowOffsets[row];
+        rowOffsets[row] = recordCount;
+        recordCount += rowRecordCount;
     }
 
-    uint16_t offset = 0;
-    FroxelEntry* const UTILS_RESTRICT froxels = mFroxelBufferUser.data();
+    // write the records of the froxels which have their own
+    runOnRows([&](uint32_t row) {
+        uint32_t offset = rowOffsets[row];
+        for (size_t i = row * froxelCountX, c = i + froxelCountX; i < c; i++) {
+            FroxelEntry& entry = froxels[i];
+            if (entry.reserved != NEW || !entry.count) {
+                continue;
+            }
 
-    const size_t froxelCountX = mFroxelCountX;
-    RecordBufferType* const UTILS_RESTRICT froxelRecords = mRecordBufferUser.data();
+            const size_t lightCount = entry.count;
+            if (UTILS_UNLIKELY(offset + lightCount >= RECORD_BUFFER_ENTRY_COUNT)) {
+                // offsets only grow, so this froxel and all the following are out of records
+                entry.reserved = OUT_OF_RECORDS;
+                continue;
+            }
 
-    // how many froxel record entries were reused (for debugging)
-    UTILS_UNUSED size_t reused = 0;
+            // iterate the bitfield
+            auto * const beginPoint = froxelRecords + offset;
+            records[i].lights.forEachSetBit([point = beginPoint, beginPoint](size_t l) mutable {
+                // make sure to keep this code branch-less
+                const size_t word = l / LIGHT_PER_GROUP;
+                const size_t bit  = l % LIGHT_PER_GROUP;
+                l = (bit * GROUP_COUNT) | (word % GROUP_COUNT);
+                *point = (RecordBufferType)l;
+                // we need to "cancel" the write if we have more than 255 spot or point lights
+                // (this is a limitation of the data type used to store the light counts per froxel)
+                point += (point - beginPoint < 255) ? 1 : 0;
+            });
 
-    for (size_t i = 0, c = getFroxelCount(); i < c;) {
-        LightRecord b = records[i];
-        if (b.lights.none()) {
-            froxels[i++].u32 = 0;
-            continue;
+            entry.offset = uint16_t(offset);
+            offset += lightCount;
         }
-
-        // We have a limitation of 255 spot + 255 point lights per froxel.
-        // note: initializer list for union cannot have more than one element
-        FroxelEntry entry; 
-        entry.offset = offset;
-        entry.count = (uint8_t)std::min(size_t(255), b.lights.count());
-
-        const size_t lightCount = entry.count;
-
-        if (UTILS_UNLIKELY(offset + lightCount >= RECORD_BUFFER_ENTRY_COUNT)) {
-#ifndef NDEBUG
-            slog.d << "out of space: " << i << ", at " << offset << io::endl;
-#endif
-            // note: instead of dropping froxels we could look for similar records we've already
-            // filed up.
-            do { // this compiles to memset()
-                froxels[i++].u32 = 0;
-            } while(i < c);
-            goto out_of_memory;
+    });
+
+    // resolve the reused entries, in order since they can depend on each other across rows
+
+    // sum of the light counts of all froxels
+    size_t lightCountSum = 0;
+    uint32_t usedRecordCount = 0;
+    for (size_t i = 0; i < froxelCount; i++) {
+        FroxelEntry& entry = froxels[i];
+        switch (entry.reserved) {
+            case NEW:
+                usedRecordCount += entry.count;
+                break;
+            case REUSE_LEFT:
+                entry = froxels[i - 1];
+                break;
+            case REUSE_ABOVE:
+                entry = froxels[i - froxelCountX];
+                break;
+            case OUT_OF_RECORDS:
+                if (UTILS_UNLIKELY(!mOutOfRecordsReported)) {
+                    // lights are dropped from the remaining froxels, warn once so it's not silent
+                    mOutOfRecordsReported = true;
+                    slog.w << "Froxelizer: out of light records at froxel " << i << " of "
+                           << froxelCount << ", use fewer froxel slices or fewer lights"
+                           << io::endl;
+                }
+                // note: instead of dropping froxels we could look for similar records we've
+                // already filed up.
+                std::fill(froxels + i, froxels + froxelCount, FroxelEntry{});
+                i = froxelCount;
+                continue;
         }
-
-        // iterate the bitfield
-        auto * const beginPoint = froxelRecords + offset;
-        b.lights.forEachSetBit([point = beginPoint, beginPoint](size_t l) mutable {
-            // make sure to keep this code branch-less
-            const size_t word = l / LIGHT_PER_GROUP;
-            const size_t bit  = l % LIGHT_PER_GROUP;
-            l = (bit * GROUP_COUNT) | (word % GROUP_COUNT);
-            *point = (RecordBufferType)l;
-            // we need to "cancel" the write if we have more than 255 spot or point lights
-            // (this is a limitation of the data type used to store the light counts per froxel)
-            point += (point - beginPoint < 255) ? 1 : 0;
-        });
-
-        offset += lightCount;
-
-#ifndef NDEBUG
-        if (lightCount) { reused--; }
-#endif
-        do {
-#ifndef NDEBUG
-            if (lightCount) { reused++; }
-#endif
-            froxels[i++].u32 = entry.u32;
-            if (i >= c) break;
-
-            if (records[i].lights != b.lights && i >= froxelCountX) {
-                // if this froxel record doesn't match the previous one on its left,
-                // we re-try with the record above it, which saves many froxel records
-                // (north of 10% in practice).
-                b = records[i - froxelCountX];
-                entry.u32 = froxels[i - froxelCountX].u32;
-            }
-        } while(records[i].lights == b.lights);
+        lightCountSum += entry.count;
     }
-out_of_memory:
-    ;
+
+    mRecordCount = usedRecordCount;
+    mAverageLightCount = float(lightCountSum) / float(std::max(size_t(1), froxelCount));
 }
 
 static inline float2 project(mat4f const& p, float3 const& v) noexcept {
@@ -736,7 +835,17 @@ void Froxelizer::froxelizePointAndSpotLight(
         mat4f const& UTILS_RESTRICT p,
         const Froxelizer::LightParams& UTILS_RESTRICT light) const noexcept {
 
-    if (UTILS_UNLIKELY(light.position.z + light.radius < -mZLightFar)) { // z values are negative
+    const bool isSpot = light.invSin != std::numeric_limits<float>::infinity();
+
+    // A narrow spot light only covers a small part of the sphere of its radius, so we rasterize
+    // the tightest sphere around its cone instead. Froxels are then tested against the cone.
+    float4 bounds = { light.position, light.radius };
+    if (isSpot) {
+        bounds = spotLightBoundingSphere(light.position, light.axis,
+                std::sqrt(light.cosSqr), 1.0f / light.invSin, light.radius);
+    }
+
+    if (UTILS_UNLIKELY(bounds.z + bounds.w < -mZLightFar)) { // z values are negative
         // This light is fully behind LightFar, it doesn't light anything
         // (we could avoid this check if we culled lights using LightFar instead of the
         // culling camera's far plane)
@@ -744,7 +853,7 @@ void Froxelizer::froxelizePointAndSpotLight(
     }
 
     // the code below works with radius^2
-    const float4 s = { light.position, light.radius * light.radius };
+    const float4 s = { bounds.xyz, bounds.w * bounds.w };
 
 #ifdef DEBUG_FROXEL
     const size_t x0 = 0;
@@ -756,7 +865,7 @@ void Froxelizer::froxelizePointAndSpotLight(
 #else
     // find a reasonable bounding-box in froxel space for the sphere by projecting
     // it's (clipped) bounding-box to clip-space and converting to froxel indices.
-    Box aabb = { light.position, light.radius };
+    Box aabb = { bounds.xyz, bounds.w };
     const float znear = std::min(-mNear, aabb.center.z + aabb.halfExtent.z); // z values are negative
     const float zfar  =                  aabb.center.z - aabb.halfExtent.z;
 
@@ -852,7 +961,7 @@ void Froxelizer::froxelizePointAndSpotLight(
                     assert_invariant(bx <= mFroxelCountX && ex <= mFroxelCountX);
 
                     size_t fi = getFroxelIndex(bx, iy, iz);
-                    if (light.invSin != std::numeric_limits<float>::infinity()) {
+                    if (isSpot) {
                         // This is a spotlight (common case)
                         // this loops gets vectorized (on arm64) w/ clang
                         while (bx++ != ex) {
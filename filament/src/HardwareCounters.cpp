@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HardwareCounters.h"
+
+namespace filament {
+
+using namespace utils;
+
+namespace {
+
+struct ThreadProfiler {
+    ThreadProfiler() noexcept
+            : profiler(Profiler::EV_CPU_CYCLES | Profiler::EV_L1D_MISSES |
+                       Profiler::EV_BPU_MISSES) {
+        if (profiler.isValid()) {
+            profiler.reset();
+            profiler.start();
+        }
+    }
+    Profiler profiler;
+};
+
+} // anonymous namespace
+
+HardwareCounters::HardwareCounters(bool enabled) noexcept {
+    if (UTILS_UNLIKELY(enabled)) {
+        static thread_local ThreadProfiler threadProfiler;
+        if (threadProfiler.profiler.isValid()) {
+            mProfiler = &threadProfiler.profiler;
+            mStart = mProfiler->readCounters();
+        }
+    }
+}
+
+HardwareCounters::Counters HardwareCounters::elapsed() noexcept {
+    Counters result;
+    if (UTILS_UNLIKELY(mProfiler)) {
+        Profiler::Counters const delta = mProfiler->readCounters() - mStart;
+        // events that couldn't be opened alias the instruction counter, skip them
+        uint32_t const events = mProfiler->getEnabledEvents();
+        result.instructions = delta.getInstructions();
+        if (events & Profiler::EV_CPU_CYCLES) {
+            result.cpuCycles = delta.getCpuCycles();
+        }
+        if (events & Profiler::EV_L1D_MISSES) {
+            result.cacheMisses = delta.getL1DMisses();
+        }
+        if (events & Profiler::EV_BPU_MISSES) {
+            result.branchMisses = delta.getBranchMisses();
+        }
+    }
+    return result;
+}
+
+} // namespace filament
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_HARDWARECOUNTERS_H
+#define TNT_FILAMENT_HARDWARECOUNTERS_H
+
+#include <filament/Renderer.h>
+
+#include <utils/Profiler.h>
+
+namespace filament {
+
+/*
+ * Samples the hardware performance counters of the calling thread (see utils::Profiler) between
+ * its construction and elapsed(). Work done by jobs running on other threads is not counted.
+ *
+ * The counters of a thread are opened the first time it's sampled and are never stopped, so
+ * samples can nest. When disabled, or when the counters are not available, elapsed() is zero.
+ */
+class HardwareCounters {
+public:
+    using Counters = Renderer::FrameTimings::Counters;
+
+    explicit HardwareCounters(bool enabled) noexcept;
+
+    Counters elapsed() noexcept;
+
+private:
+    utils::Profiler* mProfiler = nullptr;
+    utils::Profiler::Counters mStart{};
+};
+
+inline HardwareCounters::Counters& operator+=(HardwareCounters::Counters& lhs,
+        HardwareCounters::Counters const& rhs) noexcept {
+    lhs.instructions += rhs.instructions;
+    lhs.cpuCycles += rhs.cpuCycles;
+    lhs.cacheMisses += rhs.cacheMisses;
+    lhs.branchMisses += rhs.branchMisses;
+    return lhs;
+}
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_HARDWARECOUNTERS_H
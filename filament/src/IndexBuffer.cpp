@@ -66,7 +66,11 @@ void FIndexBuffer::terminate(FEngine& engine) {
 }
 
 void FIndexBuffer::setBuffer(FEngine& engine, BufferDescriptor&& buffer, uint32_t byteOffset) {
-    engine.getDriverApi().updateIndexBuffer(mHandle, std::move(buffer), byteOffset);
+    const size_t size = buffer.size;
+    engine.upload(size, [handle = mHandle, buffer = std::move(buffer), byteOffset](
+            FEngine::DriverApi& driver) mutable {
+        driver.updateIndexBuffer(handle, std::move(buffer), byteOffset);
+    });
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -200,6 +200,23 @@ void FIndirectLight::terminate(FEngine& engine) {
     }
 }
 
+void FIndirectLight::setReflections(FTexture const* cubemap) noexcept {
+    if (!ASSERT_PRECONDITION_NON_FATAL(!cubemap ||
+            cubemap->getTarget() == Texture::Sampler::SAMPLER_CUBEMAP,
+            "reflection map must a cubemap")) {
+        return;
+    }
+    mReflectionsTexture = cubemap;
+    mLevelCount = cubemap ? cubemap->getLevels() : 0;
+}
+
+void FIndirectLight::setIrradiance(uint8_t bands, float3 const* sh) noexcept {
+    // clamp to 3 bands for now
+    bands = std::min(bands, uint8_t(3));
+    std::fill(mIrradianceCoefs.begin(), mIrradianceCoefs.end(), 0.0f);
+    std::copy_n(sh, bands * bands, mIrradianceCoefs.begin());
+}
+
 backend::Handle<backend::HwTexture> FIndirectLight::getReflectionHwHandle() const noexcept {
     return mReflectionsTexture ? mReflectionsTexture->getHwHandle() : backend::Handle<backend::HwTexture> {};
 }
@@ -288,6 +305,14 @@ const math::mat3f& IndirectLight::getRotation() const noexcept {
     return upcast(this)->getRotation();
 }
 
+void IndirectLight::setReflections(Texture const* cubemap) noexcept {
+    upcast(this)->setReflections(upcast(cubemap));
+}
+
+void IndirectLight::setIrradiance(uint8_t bands, float3 const* sh) noexcept {
+    upcast(this)->setIrradiance(bands, sh);
+}
+
 Texture const* IndirectLight::getReflectionsTexture() const noexcept {
     return upcast(this)->getReflectionsTexture();
 }
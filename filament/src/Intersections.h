@@ -75,6 +75,22 @@ inline bool sphereConeIntersectionFast(
     return (e * e >= dd * coneCosSquared && e > 0);
 }
 
+// Returns the smallest sphere containing a spot light, i.e. a cone capped by a sphere of the
+// given radius. Unlike the functions above, the returned sphere radius is NOT squared.
+// cosOuter and sinOuter are the cosine and sine of the cone's half-angle, in [0, pi/2].
+inline math::float4 spotLightBoundingSphere(
+        math::float3 const& position,
+        math::float3 const& axis,
+        float cosOuter, float sinOuter, float radius) noexcept {
+    if (cosOuter * cosOuter >= 0.5f) {
+        // narrow cone (half-angle <= 45 degrees): the sphere goes through the apex and the rim
+        const float r = radius / (2.0f * cosOuter);
+        return { position + axis * r, r };
+    }
+    // wide cone: the rim is the sphere's great circle
+    return { position + axis * (radius * cosOuter), radius * sinOuter };
+}
+
 inline bool sphereConeIntersection(
         math::float4 const& sphere,
         math::float3 const& conePosition,
@@ -36,6 +36,10 @@
 
 #include <utils/CString.h>
 #include <utils/Panic.h>
+#include <utils/Systrace.h>
+
+#include <algorithm>
+#include <mutex>
 
 using namespace utils;
 using namespace filaflat;
@@ -44,8 +48,11 @@ namespace filament {
 
 using namespace backend;
 
-static MaterialParser* createParser(Backend backend, const void* data, size_t size) {
-    MaterialParser* materialParser = new MaterialParser(backend, data, size);
+static MaterialParser* createParser(Backend backend, const void* data, size_t size,
+        MaterialParser::ReleaseCallback callback = nullptr, void* user = nullptr) {
+    MaterialParser* materialParser = callback ?
+            new MaterialParser(backend, data, size, callback, user) :
+            new MaterialParser(backend, data, size);
 
     MaterialParser::ParseResult materialResult = materialParser->parse();
 
@@ -55,11 +62,14 @@ static MaterialParser* createParser(Backend backend, const void* data, size_t si
 
     if (!ASSERT_POSTCONDITION_NON_FATAL(materialResult != MaterialParser::ParseResult::ERROR_MISSING_BACKEND,
                 "the material was not built for the %s backend\n", backendToString(backend))) {
+        // this releases the package if it was passed in place
+        delete materialParser;
         return nullptr;
     }
 
     if (!ASSERT_POSTCONDITION_NON_FATAL(materialResult == MaterialParser::ParseResult::SUCCESS,
                 "could not parse the material package")) {
+        delete materialParser;
         return nullptr;
     }
 
@@ -76,6 +86,8 @@ static MaterialParser* createParser(Backend backend, const void* data, size_t si
 struct Material::BuilderDetails {
     const void* mPayload = nullptr;
     size_t mSize = 0;
+    Material::Builder::PackageReleaseCallback mReleaseCallback = nullptr;
+    void* mReleaseUser = nullptr;
     MaterialParser* mMaterialParser = nullptr;
     bool mDefaultMaterial = false;
 };
@@ -95,19 +107,47 @@ BuilderType::Builder& BuilderType::Builder::operator=(BuilderType::Builder&& rhs
 Material::Builder& Material::Builder::package(const void* payload, size_t size) {
     mImpl->mPayload = payload;
     mImpl->mSize = size;
+    mImpl->mReleaseCallback = nullptr;
+    mImpl->mReleaseUser = nullptr;
+    return *this;
+}
+
+Material::Builder& Material::Builder::package(const void* payload, size_t size,
+        PackageReleaseCallback callback, void* user) {
+    ASSERT_PRECONDITION(callback, "a release callback is required for in-place packages");
+    mImpl->mPayload = payload;
+    mImpl->mSize = size;
+    mImpl->mReleaseCallback = callback;
+    mImpl->mReleaseUser = user;
     return *this;
 }
 
 Material* Material::Builder::build(Engine& engine) {
-    MaterialParser* materialParser = createParser(
-            upcast(engine).getBackend(), mImpl->mPayload, mImpl->mSize);
+    MaterialParser* materialParser = FMaterial::parse(upcast(engine).getBackend(), *this);
+    if (!materialParser) {
+        return nullptr;
+    }
+    return FMaterial::create(upcast(engine), *this, materialParser);
+}
 
+void Material::Builder::buildAsync(Engine& engine, BuildCallback callback, void* user) {
+    ASSERT_PRECONDITION(callback, "buildAsync() requires a callback");
+    upcast(engine).buildMaterialAsync(*this, callback, user);
+}
+
+MaterialParser* FMaterial::parse(Backend backend, Material::Builder const& builder) {
+    return createParser(backend, builder->mPayload, builder->mSize,
+            builder->mReleaseCallback, builder->mReleaseUser);
+}
+
+FMaterial* FMaterial::create(FEngine& engine, Material::Builder& builder,
+        MaterialParser* materialParser) {
     uint32_t v = 0;
     materialParser->getShaderModels(&v);
     utils::bitset32 shaderModels;
     shaderModels.setValue(v);
 
-    ShaderModel shaderModel = upcast(engine).getDriver().getShaderModel();
+    ShaderModel shaderModel = engine.getDriver().getShaderModel();
     if (!shaderModels.test(static_cast<uint32_t>(shaderModel))) {
         CString name;
         materialParser->getName(&name);
@@ -119,19 +159,20 @@ Material* Material::Builder::build(Engine& engine) {
         }
         slog.e << "Compiled material contains shader models 0x"
                 << io::hex << shaderModels.getValue() << io::dec << "." << io::endl;
+        delete materialParser;
         return nullptr;
     }
 
-    mImpl->mMaterialParser = materialParser;
+    builder->mMaterialParser = materialParser;
 
-    Material* result = upcast(engine).createMaterial(*this);
+    FMaterial* result = engine.createMaterial(builder);
 
 #if FILAMENT_ENABLE_MATDBG
-    matdbg::DebugServer* server = upcast(engine).debug.server;
+    matdbg::DebugServer* server = engine.debug.server;
     if (server) {
         CString name;
         materialParser->getName(&name);
-        server->addMaterial(name, mImpl->mPayload, mImpl->mSize, result);
+        server->addMaterial(name, builder->mPayload, builder->mSize, result);
     }
 #endif
 
@@ -164,6 +205,7 @@ FMaterial::FMaterial(FEngine& engine, const Material::Builder& builder)
 {
     MaterialParser* parser = builder->mMaterialParser;
     mMaterialParser = parser;
+    mCacheId = parser->getCacheId();
 
     UTILS_UNUSED_IN_RELEASE bool nameOk = parser->getName(&mName);
     assert_invariant(nameOk);
@@ -284,13 +326,20 @@ FMaterial::FMaterial(FEngine& engine, const Material::Builder& builder)
 
     parser->getTransparencyMode(&mTransparencyMode);
     parser->hasCustomDepthShader(&mHasCustomDepthShader);
+    parser->getFoldedVariants(&mFoldedVariants);
     mIsDefaultMaterial = builder->mDefaultMaterial;
 
+    // the depth variants, picking included, come from the default material unless this material
+    // has its own
+    mHasPickingVariant = (mIsDefaultMaterial || mHasCustomDepthShader) ?
+            hasVariant(Variant::DEPTH | Variant::PICKING) :
+            engine.getDefaultMaterial()->hasPickingVariant();
+
     // pre-cache the shared variants -- these variants are shared with the default material.
     if (UTILS_UNLIKELY(!mIsDefaultMaterial && !mHasCustomDepthShader)) {
         auto& cachedPrograms = mCachedPrograms;
         for (uint8_t i = 0, n = cachedPrograms.size(); i < n; ++i) {
-            if (Variant(i).isDepthPass()) {
+            if (Variant(i).isDepthPass() && (mHasPickingVariant || !Variant(i).hasPicking())) {
                 cachedPrograms[i] = engine.getDefaultMaterial()->getProgram(i);
             }
         }
@@ -308,17 +357,21 @@ FMaterial::FMaterial(FEngine& engine, const Material::Builder& builder)
         parser->getSpecularAntiAliasingThreshold(&mSpecularAntiAliasingThreshold);
     }
 
+    mInstanceUniforms.init(mUniformInterfaceBlock.getSize());
+
     // we can only initialize the default instance once we're initialized ourselves
     mDefaultInstance.initDefaultInstance(engine, this);
 }
 
 FMaterial::~FMaterial() noexcept {
     delete mMaterialParser;
+    delete mPendingEdits.load();
 }
 
 void FMaterial::terminate(FEngine& engine) {
     destroyPrograms(engine);
     mDefaultInstance.terminate(engine);
+    mInstanceUniforms.terminate(engine.getDriverApi());
 }
 
 FMaterialInstance* FMaterial::createInstance(const char* name) const noexcept {
@@ -345,16 +398,29 @@ UniformInterfaceBlock::UniformInfo const* FMaterial::reflect(
 }
 
 Handle<HwProgram> FMaterial::getProgramSlow(uint8_t variantKey) const noexcept {
+    auto program = createAndCacheProgram(getProgramBuilder(variantKey), variantKey);
+    releaseShaderSources();
+    return program;
+}
+
+void FMaterial::releaseShaderSources() const noexcept {
+    // the programs own a copy of their sources, the decoded ones can be freed right away
+    if (UTILS_UNLIKELY(mEngine.isShaderSourceReleaseEnabled())) {
+        mMaterialParser->releaseDecodedShaders();
+    }
+}
+
+Program FMaterial::getProgramBuilder(uint8_t variantKey) const noexcept {
     switch (getMaterialDomain()) {
         case MaterialDomain::SURFACE:
-            return getSurfaceProgramSlow(variantKey);
+            return getSurfaceProgramBuilder(variantKey);
 
         case MaterialDomain::POST_PROCESS:
-            return getPostProcessProgramSlow(variantKey);
+            return getPostProcessProgramBuilder(variantKey);
     }
 }
 
-Handle<HwProgram> FMaterial::getSurfaceProgramSlow(uint8_t variantKey)
+Program FMaterial::getSurfaceProgramBuilder(uint8_t variantKey)
     const noexcept {
     // filterVariant() has already been applied in generateCommands(), shouldn't be needed here
     // if we're unlit, we don't have any bits that correspond to lit materials
@@ -381,10 +447,10 @@ Handle<HwProgram> FMaterial::getSurfaceProgramSlow(uint8_t variantKey)
     addSamplerGroup(pb, BindingPoints::PER_VIEW, SibGenerator::getPerViewSib(variantKey), mSamplerBindings);
     addSamplerGroup(pb, BindingPoints::PER_MATERIAL_INSTANCE, mSamplerInterfaceBlock, mSamplerBindings);
 
-    return createAndCacheProgram(std::move(pb), variantKey);
+    return pb;
 }
 
-Handle<HwProgram> FMaterial::getPostProcessProgramSlow(uint8_t variantKey)
+Program FMaterial::getPostProcessProgramBuilder(uint8_t variantKey)
     const noexcept {
 
     Program pb = getProgramBuilderWithVariants(variantKey, variantKey, variantKey);
@@ -394,7 +460,7 @@ Handle<HwProgram> FMaterial::getPostProcessProgramSlow(uint8_t variantKey)
 
     addSamplerGroup(pb, BindingPoints::PER_MATERIAL_INSTANCE, mSamplerInterfaceBlock, mSamplerBindings);
 
-    return createAndCacheProgram(std::move(pb), variantKey);
+    return pb;
 }
 
 Program FMaterial::getProgramBuilderWithVariants(
@@ -434,6 +500,7 @@ Program FMaterial::getProgramBuilderWithVariants(
 
     Program pb;
     pb      .diagnostics(mName, variantKey)
+            .cacheId(mCacheId)
             .withVertexShader(vsBuilder.data(), vsBuilder.size())
             .withFragmentShader(fsBuilder.data(), fsBuilder.size());
     return pb;
@@ -445,9 +512,81 @@ Handle<HwProgram> FMaterial::createAndCacheProgram(Program&& p,
     assert_invariant(program);
 
     mCachedPrograms[variantKey] = program;
+    mReadyPrograms.set(variantKey, false);
     return program;
 }
 
+bool FMaterial::isProgramReadySlow(uint8_t variantKey) const noexcept {
+    backend::Handle<backend::HwProgram> const program = mCachedPrograms[variantKey];
+    if (UTILS_UNLIKELY(!program)) {
+        return false;
+    }
+    // once a program is ready it stays ready, so we only ask the backend until it is
+    bool const ready = mEngine.getDriverApi().isProgramReady(program);
+    mReadyPrograms.set(variantKey, ready);
+    return ready;
+}
+
+// the public filter bits are the variant bits
+static_assert(uint32_t(UserVariantFilterBit::DIRECTIONAL_LIGHTING) == Variant::DIRECTIONAL_LIGHTING);
+static_assert(uint32_t(UserVariantFilterBit::DYNAMIC_LIGHTING) == Variant::DYNAMIC_LIGHTING);
+static_assert(uint32_t(UserVariantFilterBit::SHADOW_RECEIVER) == Variant::SHADOW_RECEIVER);
+static_assert(uint32_t(UserVariantFilterBit::SKINNING) == Variant::SKINNING_OR_MORPHING);
+static_assert(uint32_t(UserVariantFilterBit::FOG) == Variant::FOG);
+static_assert(uint32_t(UserVariantFilterBit::VSM) == Variant::VSM);
+
+bool FMaterial::hasVariant(uint8_t variantKey) const noexcept {
+    const ShaderModel sm = mEngine.getDriver().getShaderModel();
+    const uint8_t vertexVariantKey = mMaterialDomain == MaterialDomain::SURFACE ?
+            Variant::filterVariantVertex(variantKey) : variantKey;
+    const uint8_t fragmentVariantKey = mMaterialDomain == MaterialDomain::SURFACE ?
+            Variant::filterVariantFragment(variantKey) : variantKey;
+    return mMaterialParser->hasShader(sm, vertexVariantKey, ShaderType::VERTEX) &&
+           mMaterialParser->hasShader(sm, fragmentVariantKey, ShaderType::FRAGMENT);
+}
+
+void FMaterial::compile(UserVariantFilterMask variants,
+        Material::CompilationCallback callback, void* user) noexcept {
+    SYSTRACE_CALL();
+    if (mMaterialDomain == MaterialDomain::SURFACE) {
+        // the depth variants are needed by every view, they're always included
+        const uint8_t filter = uint8_t(variants & uint32_t(UserVariantFilterBit::ALL)) |
+                Variant::DEPTH;
+        for (size_t i = 0; i < VARIANT_COUNT; i++) {
+            const uint8_t variantKey = uint8_t(i);
+            if ((variantKey & ~filter) || Variant::isReserved(variantKey) ||
+                    Variant::filterVariant(variantKey, mIsVariantLit) != variantKey) {
+                continue;
+            }
+            // the shared depth variants are already in the cache
+            if (!mCachedPrograms[variantKey] && hasVariant(variantKey)) {
+                createAndCacheProgram(getProgramBuilder(variantKey), variantKey);
+            }
+        }
+    } else {
+        for (size_t i = 0; i < POST_PROCESS_VARIANT_COUNT; i++) {
+            const uint8_t variantKey = uint8_t(i);
+            if (!mCachedPrograms[variantKey] && hasVariant(variantKey)) {
+                createAndCacheProgram(getProgramBuilder(variantKey), variantKey);
+            }
+        }
+    }
+    // the variants share most of their sources, so they're only released once all are created
+    releaseShaderSources();
+    if (callback) {
+        mEngine.addCompilationCallback(this, callback, user);
+    }
+}
+
+bool FMaterial::isReady() const noexcept {
+    for (size_t i = 0, n = mCachedPrograms.size(); i < n; i++) {
+        if (mCachedPrograms[i] && !isProgramReady(uint8_t(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
 size_t FMaterial::getParameters(ParameterInfo* parameters, size_t count) const noexcept {
     count = std::min(count, getParameterCount());
 
@@ -495,17 +634,67 @@ size_t FMaterial::getParameters(ParameterInfo* parameters, size_t count) const n
 // Swaps in an edited version of the original package that was used to create the material. The
 // edited package was stashed in response to a debugger event. This is invoked only when the
 // Material Debugger is attached. The only editable features of a material package are the shader
-// source strings, so here we trigger a rebuild of the HwProgram objects.
+// source strings, so here we rebuild the HwProgram objects of the variants that use the edited
+// shaders. The old programs stay in use until the new ones are ready, so that an edit doesn't
+// stall rendering while its variants compile.
 void FMaterial::applyPendingEdits() noexcept {
-    const char* name = mName.c_str();
-    slog.d << "Applying edits to " << (name ? name : "(untitled)") << io::endl;
-    destroyPrograms(mEngine);
-    for (auto& program : mCachedPrograms) {
-        program.clear();
+    DriverApi& driverApi = mEngine.getDriverApi();
+
+    MaterialParser* parser;
+    utils::bitset<uint64_t, VARIANT_COUNT / 64> vertexEdits;
+    utils::bitset<uint64_t, VARIANT_COUNT / 64> fragmentEdits;
+    {
+        std::lock_guard<utils::Mutex> guard(mPendingEditsLock);
+        parser = mPendingEdits.exchange(nullptr);
+        std::swap(vertexEdits, mEditedVertexShaders);
+        std::swap(fragmentEdits, mEditedFragmentShaders);
     }
-    delete mMaterialParser;
-    mMaterialParser = mPendingEdits;
-    mPendingEdits = nullptr;
+
+    if (parser) {
+        const char* name = mName.c_str();
+        slog.d << "Applying edits to " << (name ? name : "(untitled)") << io::endl;
+        delete mMaterialParser;
+        mMaterialParser = parser;
+        mCacheId = mMaterialParser->getCacheId();
+
+        const bool isSurface = mMaterialDomain == MaterialDomain::SURFACE;
+        for (size_t i = 0, n = mCachedPrograms.size(); i < n; ++i) {
+            const uint8_t variantKey = uint8_t(i);
+            if (!mCachedPrograms[i] || !ownsProgram(variantKey)) {
+                continue;
+            }
+            const uint8_t vertexVariantKey = isSurface ?
+                    Variant::filterVariantVertex(variantKey) : variantKey;
+            const uint8_t fragmentVariantKey = isSurface ?
+                    Variant::filterVariantFragment(variantKey) : variantKey;
+            if (!vertexEdits[vertexVariantKey] && !fragmentEdits[fragmentVariantKey]) {
+                continue;
+            }
+            auto program = driverApi.createProgram(getProgramBuilder(variantKey));
+            auto pos = std::find_if(mEditedPrograms.begin(), mEditedPrograms.end(),
+                    [variantKey](auto const& edited) { return edited.first == variantKey; });
+            if (pos != mEditedPrograms.end()) {
+                // a previous edit of this variant is still compiling, it's obsolete
+                driverApi.destroyProgram(pos->second);
+                pos->second = program;
+            } else {
+                mEditedPrograms.emplace_back(variantKey, program);
+            }
+        }
+        releaseShaderSources();
+    }
+
+    auto ready = std::remove_if(mEditedPrograms.begin(), mEditedPrograms.end(),
+            [this, &driverApi](auto const& edited) {
+                if (!driverApi.isProgramReady(edited.second)) {
+                    return false;
+                }
+                driverApi.destroyProgram(mCachedPrograms[edited.first]);
+                mCachedPrograms[edited.first] = edited.second;
+                mReadyPrograms.set(edited.first, true);
+                return true;
+            });
+    mEditedPrograms.erase(ready, mEditedPrograms.end());
 }
 
 /**
@@ -516,13 +705,24 @@ void FMaterial::applyPendingEdits() noexcept {
  */
 
 void FMaterial::onEditCallback(void* userdata, const utils::CString& name, const void* packageData,
-        size_t packageSize) {
+        size_t packageSize, ShaderModel shaderModel, uint8_t variant, ShaderType stage) {
     FMaterial* material = upcast((Material*) userdata);
     FEngine& engine = material->mEngine;
 
-    // This is called on a web server thread so we defer clearing the program cache
-    // and swapping out the MaterialParser until the next getProgram call.
-    material->mPendingEdits = createParser(engine.getBackend(), packageData, packageSize);
+    // This is called on a web server thread so we defer rebuilding the programs and swapping
+    // out the MaterialParser until the next getProgram call.
+    MaterialParser* parser = createParser(engine.getBackend(), packageData, packageSize);
+
+    std::lock_guard<utils::Mutex> guard(material->mPendingEditsLock);
+    if (shaderModel == engine.getDriver().getShaderModel()) {
+        if (stage == ShaderType::VERTEX) {
+            material->mEditedVertexShaders.set(variant);
+        } else {
+            material->mEditedFragmentShaders.set(variant);
+        }
+    }
+    // the new package includes the edits of the one it replaces
+    delete material->mPendingEdits.exchange(parser);
 }
 
 void FMaterial::onQueryCallback(void* userdata, uint64_t* pVariants) {
@@ -539,21 +739,26 @@ void FMaterial::onQueryCallback(void* userdata, uint64_t* pVariants) {
 
  /** @}*/
 
+bool FMaterial::ownsProgram(uint8_t variantKey) const noexcept {
+    // The depth variants may be shared with the default material, in which case
+    // we should not free them.
+    return mIsDefaultMaterial || mHasCustomDepthShader || !Variant(variantKey).isDepthPass();
+}
+
 void FMaterial::destroyPrograms(FEngine& engine) {
     DriverApi& driverApi = engine.getDriverApi();
     auto& cachedPrograms = mCachedPrograms;
     for (size_t i = 0, n = cachedPrograms.size(); i < n; ++i) {
-        if (!mIsDefaultMaterial) {
-            // The depth variants may be shared with the default material, in which case
-            // we should not free it now.
-            bool isSharedVariant = Variant(i).isDepthPass() && !mHasCustomDepthShader;
-            if (isSharedVariant) {
-                // we don't own this variant, skip.
-                continue;
-            }
+        if (!ownsProgram(uint8_t(i))) {
+            // we don't own this variant, skip.
+            continue;
         }
         driverApi.destroyProgram(cachedPrograms[i]);
     }
+    for (auto const& edited : mEditedPrograms) {
+        driverApi.destroyProgram(edited.second);
+    }
+    mEditedPrograms.clear();
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -652,6 +857,15 @@ RefractionType Material::getRefractionType() const noexcept {
     return upcast(this)->getRefractionType();
 }
 
+bool Material::isReady() const noexcept {
+    return upcast(this)->isReady();
+}
+
+void Material::compile(UserVariantFilterMask variants,
+        CompilationCallback callback, void* user) noexcept {
+    upcast(this)->compile(variants, callback, user);
+}
+
 bool Material::hasParameter(const char* name) const noexcept {
     return upcast(this)->hasParameter(name);
 }
@@ -175,6 +175,108 @@ template UTILS_PUBLIC void MaterialInstance::setParameter<mat4f>   (const char*
 
 // ------------------------------------------------------------------------------------------------
 
+template<size_t Size>
+UTILS_NOINLINE
+void FMaterialInstance::setParameterBatchUntypedImpl(const char* name,
+        MaterialInstance* const* instances, const void* values, size_t count) noexcept {
+    // instances usually share their material, so the offset is only looked-up when it changes
+    FMaterial const* material = nullptr;
+    ssize_t offset = -1;
+    for (size_t i = 0; i < count; i++) {
+        FMaterialInstance* const mi = upcast(instances[i]);
+        if (UTILS_UNLIKELY(mi->mMaterial != material)) {
+            material = mi->mMaterial;
+            offset = material->getUniformInterfaceBlock().getUniformOffset(name, 0);
+        }
+        if (UTILS_LIKELY(offset >= 0)) {
+            mi->mUniforms.setUniformUntyped<Size>(size_t(offset),
+                    static_cast<const char*>(values) + i * Size);
+        }
+    }
+}
+
+template<typename T>
+UTILS_ALWAYS_INLINE
+inline void FMaterialInstance::setParameterBatchImpl(const char* name,
+        MaterialInstance* const* instances, const T* values, size_t count) noexcept {
+    static_assert(!std::is_same_v<T, math::mat3f>);
+    setParameterBatchUntypedImpl<sizeof(T)>(name, instances, values, count);
+}
+
+// specialization for mat3f
+template<>
+inline void FMaterialInstance::setParameterBatchImpl(const char* name,
+        MaterialInstance* const* instances, const mat3f* values, size_t count) noexcept {
+    FMaterial const* material = nullptr;
+    ssize_t offset = -1;
+    for (size_t i = 0; i < count; i++) {
+        FMaterialInstance* const mi = upcast(instances[i]);
+        if (UTILS_UNLIKELY(mi->mMaterial != material)) {
+            material = mi->mMaterial;
+            offset = material->getUniformInterfaceBlock().getUniformOffset(name, 0);
+        }
+        if (UTILS_LIKELY(offset >= 0)) {
+            mi->mUniforms.setUniform(size_t(offset), values[i]);
+        }
+    }
+}
+
+template <typename T, typename>
+void MaterialInstance::setParameterBatch(const char* name,
+        MaterialInstance* const* instances, const T* values, size_t count) noexcept {
+    FMaterialInstance::setParameterBatchImpl(name, instances, values, count);
+}
+
+template<typename B, typename U>
+static void setParameterBatchBool(const char* name,
+        MaterialInstance* const* instances, const B* v, size_t c) noexcept {
+    auto* p = new U[c];
+    std::copy_n(v, c, p);
+    MaterialInstance::setParameterBatch(name, instances, p, c);
+    delete [] p;
+}
+
+template<>
+UTILS_PUBLIC void MaterialInstance::setParameterBatch(const char* name,
+        MaterialInstance* const* instances, const bool* v, size_t c) noexcept {
+    setParameterBatchBool<bool, uint32_t>(name, instances, v, c);
+}
+
+template<>
+UTILS_PUBLIC void MaterialInstance::setParameterBatch(const char* name,
+        MaterialInstance* const* instances, const bool2* v, size_t c) noexcept {
+    setParameterBatchBool<bool2, uint2>(name, instances, v, c);
+}
+
+template<>
+UTILS_PUBLIC void MaterialInstance::setParameterBatch(const char* name,
+        MaterialInstance* const* instances, const bool3* v, size_t c) noexcept {
+    setParameterBatchBool<bool3, uint3>(name, instances, v, c);
+}
+
+template<>
+UTILS_PUBLIC void MaterialInstance::setParameterBatch(const char* name,
+        MaterialInstance* const* instances, const bool4* v, size_t c) noexcept {
+    setParameterBatchBool<bool4, uint4>(name, instances, v, c);
+}
+
+template UTILS_PUBLIC void MaterialInstance::setParameterBatch<float>   (const char* name, MaterialInstance* const* i, const float    *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameterBatch<int32_t> (const char* name, MaterialInstance* const* i, const int32_t  *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameterBatch<uint32_t>(const char* name, MaterialInstance* const* i, const uint32_t *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameterBatch<int2>    (const char* name, MaterialInstance* const* i, const int2     *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameterBatch<int3>    (const char* name, MaterialInstance* const* i, const int3     *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameterBatch<int4>    (const char* name, MaterialInstance* const* i, const int4     *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameterBatch<uint2>   (const char* name, MaterialInstance* const* i, const uint2    *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameterBatch<uint3>   (const char* name, MaterialInstance* const* i, const uint3    *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameterBatch<uint4>   (const char* name, MaterialInstance* const* i, const uint4    *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameterBatch<float2>  (const char* name, MaterialInstance* const* i, const float2   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameterBatch<float3>  (const char* name, MaterialInstance* const* i, const float3   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameterBatch<float4>  (const char* name, MaterialInstance* const* i, const float4   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameterBatch<mat3f>   (const char* name, MaterialInstance* const* i, const mat3f    *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameterBatch<mat4f>   (const char* name, MaterialInstance* const* i, const mat4f    *v, size_t c) noexcept;
+
+// ------------------------------------------------------------------------------------------------
+
 FMaterialInstance::FMaterialInstance() noexcept = default;
 
 FMaterialInstance::FMaterialInstance(FEngine& engine, FMaterial const* material, const char* name) :
@@ -183,7 +285,7 @@ FMaterialInstance::FMaterialInstance(FEngine& engine, FMaterial const* material,
 
     if (!material->getUniformInterfaceBlock().isEmpty()) {
         mUniforms.setUniforms(material->getDefaultInstance()->getUniformBuffer());
-        mUbHandle = driver.createUniformBuffer(mUniforms.getSize(), backend::BufferUsage::DYNAMIC);
+        mUbSlot = material->getInstanceUniformArena().allocate(driver);
     }
 
     if (!material->getSamplerInterfaceBlock().isEmpty()) {
@@ -200,7 +302,7 @@ void FMaterialInstance::initDefaultInstance(FEngine& engine, FMaterial const* ma
 
     if (!material->getUniformInterfaceBlock().isEmpty()) {
         mUniforms = UniformBuffer(material->getUniformInterfaceBlock().getSize());
-        mUbHandle = driver.createUniformBuffer(mUniforms.getSize(), backend::BufferUsage::STATIC);
+        mUbSlot = material->getInstanceUniformArena().allocate(driver);
     }
 
     if (!material->getSamplerInterfaceBlock().isEmpty()) {
@@ -215,7 +317,10 @@ FMaterialInstance::~FMaterialInstance() noexcept = default;
 
 void FMaterialInstance::terminate(FEngine& engine) {
     FEngine::DriverApi& driver = engine.getDriverApi();
-    driver.destroyUniformBuffer(mUbHandle);
+    engine.invalidateMaterialSortingKeys();
+    if (mUbSlot.buffer) {
+        mMaterial->getInstanceUniformArena().free(mUbSlot);
+    }
     driver.destroySamplerGroup(mSbHandle);
 }
 
@@ -233,8 +338,10 @@ void FMaterialInstance::initialize(FMaterial const* material) {
     mDepthWrite = rasterState.depthWrite;
     mDepthFunc = rasterState.depthFunc;
 
-    mMaterialSortingKey = RenderPass::makeMaterialSortingKey(
-            material->getId(), material->generateMaterialInstanceId());
+    // until the engine ranks this instance, sort it after all the others
+    mInstanceId = material->generateMaterialInstanceId();
+    setSortingRank(RenderPass::MATERIAL_RANK_COUNT - 1);
+    material->getEngine().invalidateMaterialSortingKeys();
 
     if (material->getBlendingMode() == BlendingMode::MASKED) {
         setMaskThreshold(material->getMaskThreshold());
@@ -253,7 +360,13 @@ void FMaterialInstance::initialize(FMaterial const* material) {
 void FMaterialInstance::commitSlow(DriverApi& driver) const {
     // update uniforms if needed
     if (mUniforms.isDirty()) {
-        driver.loadUniformBuffer(mUbHandle, mUniforms.toBufferDescriptor(driver));
+        // only upload the range that changed, typically a few animated parameters. The buffer
+        // is shared with the other instances of our material, so we must never replace all
+        // of it with loadUniformBuffer().
+        uint32_t const offset = mUniforms.getDirtyOffset();
+        uint32_t const size = mUniforms.getDirtySize();
+        driver.updateUniformBuffer(mUbSlot.buffer,
+                mUniforms.toBufferDescriptor(driver, offset, size), mUbSlot.offset + offset);
     }
     if (mSamplers.isDirty()) {
         driver.updateSamplerGroup(mSbHandle, std::move(mSamplers.toCommandStream()));
@@ -314,8 +427,29 @@ void FMaterialInstance::setDoubleSided(bool doubleSided) noexcept {
     }
 }
 
+void FMaterialInstance::setSortingRank(uint32_t rank) noexcept {
+    mMaterialSortingKey = RenderPass::makeMaterialSortingKey(rank);
+}
+
+void FMaterialInstance::setCullingMode(CullingMode culling) noexcept {
+    mCulling = culling;
+    // the instance's pipeline state changed, so does its rank
+    mMaterial->getEngine().invalidateMaterialSortingKeys();
+}
+
+void FMaterialInstance::setColorWrite(bool enable) noexcept {
+    mColorWrite = enable;
+    mMaterial->getEngine().invalidateMaterialSortingKeys();
+}
+
+void FMaterialInstance::setDepthWrite(bool enable) noexcept {
+    mDepthWrite = enable;
+    mMaterial->getEngine().invalidateMaterialSortingKeys();
+}
+
 void FMaterialInstance::setDepthCulling(bool enable) noexcept {
     mDepthFunc = enable ? RasterState::DepthFunc::GE : RasterState::DepthFunc::A;
+    mMaterial->getEngine().invalidateMaterialSortingKeys();
 }
 
 const char* FMaterialInstance::getName() const noexcept {
@@ -31,6 +31,7 @@
 #include <private/filament/SubpassInfo.h>
 
 #include <utils/CString.h>
+#include <utils/Hash.h>
 
 #include <stdlib.h>
 
@@ -43,8 +44,9 @@ namespace filament {
 
 // ------------------------------------------------------------------------------------------------
 
-MaterialParser::MaterialParserDetails::MaterialParserDetails(Backend backend, const void* data, size_t size)
-        : mManagedBuffer(data, size),
+MaterialParser::MaterialParserDetails::MaterialParserDetails(Backend backend,
+        const void* data, size_t size, ReleaseCallback callback, void* user)
+        : mManagedBuffer(data, size, callback, user),
           mChunkContainer(mManagedBuffer.data(), mManagedBuffer.size()),
           mMaterialChunk(mChunkContainer) {
     switch (backend) {
@@ -84,7 +86,12 @@ bool MaterialParser::MaterialParserDetails::getFromSimpleChunk(
 // ------------------------------------------------------------------------------------------------
 
 MaterialParser::MaterialParser(Backend backend, const void* data, size_t size)
-        : mImpl(backend, data, size) {
+        : mImpl(backend, data, size, nullptr, nullptr) {
+}
+
+MaterialParser::MaterialParser(Backend backend, const void* data, size_t size,
+        ReleaseCallback callback, void* user)
+        : mImpl(backend, data, size, callback, user) {
 }
 
 ChunkContainer& MaterialParser::getChunkContainer() noexcept {
@@ -98,6 +105,11 @@ ChunkContainer const& MaterialParser::getChunkContainer() const noexcept {
 MaterialParser::ParseResult MaterialParser::parse() noexcept {
     ChunkContainer& cc = getChunkContainer();
     if (cc.parse()) {
+        // text shaders may be stored in a compressed dictionary instead
+        if (mImpl.mDictionaryTag == ChunkType::DictionaryText &&
+                cc.hasChunk(ChunkType::DictionaryTextCompressed)) {
+            mImpl.mDictionaryTag = ChunkType::DictionaryTextCompressed;
+        }
         if (!cc.hasChunk(mImpl.mMaterialTag) || !cc.hasChunk(mImpl.mDictionaryTag)) {
             return ParseResult::ERROR_MISSING_BACKEND;
         }
@@ -111,6 +123,27 @@ MaterialParser::ParseResult MaterialParser::parse() noexcept {
     return ParseResult::SUCCESS;
 }
 
+uint64_t MaterialParser::getCacheId() const noexcept {
+    const uint8_t* data = (const uint8_t*)mImpl.mManagedBuffer.data();
+    const size_t size = mImpl.mManagedBuffer.size();
+    const size_t wordCount = size / 4;
+
+    // murmur3 only hashes whole words, the trailing bytes (if any) are folded into the seed
+    uint32_t tail = uint32_t(size);
+    for (size_t i = wordCount * 4; i < size; i++) {
+        tail = (tail << 8u) | data[i];
+    }
+
+    uint32_t lo = tail, hi = ~tail;
+    if (wordCount) {
+        // the package is malloc()'d so it is suitably aligned for uint32_t reads
+        lo = utils::hash::murmur3((const uint32_t*)data, wordCount, tail);
+        hi = utils::hash::murmur3((const uint32_t*)data, wordCount, lo ^ 0x9e3779b9u);
+    }
+    const uint64_t id = (uint64_t(hi) << 32u) | lo;
+    return id ? id : 1;
+}
+
 // Accessors
 bool MaterialParser::getMaterialVersion(uint32_t* value) const noexcept {
     return mImpl.getFromSimpleChunk(ChunkType::MaterialVersion, value);
@@ -235,6 +268,10 @@ bool MaterialParser::hasCustomDepthShader(bool* value) const noexcept {
     return mImpl.getFromSimpleChunk(ChunkType::MaterialHasCustomDepthShader, value);
 }
 
+bool MaterialParser::getFoldedVariants(uint8_t* value) const noexcept {
+    return mImpl.getFromSimpleChunk(ChunkType::MaterialFoldedVariants, value);
+}
+
 bool MaterialParser::hasSpecularAntiAliasing(bool* value) const noexcept {
     return mImpl.getFromSimpleChunk(ChunkType::MaterialSpecularAntiAliasing, value);
 }
@@ -275,6 +312,15 @@ bool MaterialParser::getShader(ShaderBuilder& shader,
             mImpl.mBlobDictionary, (uint8_t)shaderModel, variant, stage);
 }
 
+void MaterialParser::releaseDecodedShaders() noexcept {
+    mImpl.mBlobDictionary.releaseDecoded();
+}
+
+bool MaterialParser::hasShader(ShaderModel shaderModel,
+        uint8_t variant, ShaderType stage) const noexcept {
+    return mImpl.mMaterialChunk.hasShader((uint8_t)shaderModel, variant, stage);
+}
+
 // ------------------------------------------------------------------------------------------------
 
 
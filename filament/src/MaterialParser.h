@@ -44,8 +44,16 @@ struct SubpassInfo;
 
 class MaterialParser {
 public:
+    // Called when the parser no longer references a package it doesn't own.
+    using ReleaseCallback = void(*)(void* data, size_t size, void* user);
+
+    // Copies the package.
     MaterialParser(backend::Backend backend, const void* data, size_t size);
 
+    // References the package in place, it must stay valid until callback is called.
+    MaterialParser(backend::Backend backend, const void* data, size_t size,
+            ReleaseCallback callback, void* user);
+
     MaterialParser(MaterialParser const& rhs) noexcept = delete;
     MaterialParser& operator=(MaterialParser const& rhs) noexcept = delete;
 
@@ -86,6 +94,7 @@ public:
     bool getRefractionMode(RefractionMode* value) const noexcept;
     bool getRefractionType(RefractionType* value) const noexcept;
     bool hasCustomDepthShader(bool* value) const noexcept;
+    bool getFoldedVariants(uint8_t* value) const noexcept;
     bool hasSpecularAntiAliasing(bool* value) const noexcept;
     bool getSpecularAntiAliasingVariance(float* value) const noexcept;
     bool getSpecularAntiAliasingThreshold(float* value) const noexcept;
@@ -93,9 +102,21 @@ public:
     bool getShader(filaflat::ShaderBuilder& shader, backend::ShaderModel shaderModel,
             uint8_t variant, backend::ShaderType stage) noexcept;
 
+    bool hasShader(backend::ShaderModel shaderModel,
+            uint8_t variant, backend::ShaderType stage) const noexcept;
+
+    // Frees the shader text and SPIR-V decoded by getShader(), the following calls decode it
+    // again from the package.
+    void releaseDecodedShaders() noexcept;
+
+    // Returns a 64-bit hash of the whole material package, suitable as a persistent key for
+    // caching compiled programs. Never returns 0.
+    uint64_t getCacheId() const noexcept;
+
 private:
     struct MaterialParserDetails {
-        MaterialParserDetails(backend::Backend backend, const void* data, size_t size);
+        MaterialParserDetails(backend::Backend backend, const void* data, size_t size,
+                ReleaseCallback callback, void* user);
 
         template<typename T>
         bool getFromSimpleChunk(filamat::ChunkType type, T* value) const noexcept;
@@ -103,15 +124,29 @@ private:
     private:
         friend class MaterialParser;
 
+        // Either a copy of the package, or a reference to it when a callback is provided.
         class ManagedBuffer {
             void* mStart = nullptr;
             size_t mSize = 0;
+            ReleaseCallback mCallback = nullptr;
+            void* mUser = nullptr;
         public:
-            explicit ManagedBuffer(const void* start, size_t size)
-                    : mStart(malloc(size)), mSize(size) {
-                memcpy(mStart, start, size);
+            ManagedBuffer(const void* start, size_t size, ReleaseCallback callback, void* user)
+                    : mSize(size), mCallback(callback), mUser(user) {
+                if (callback) {
+                    mStart = const_cast<void*>(start);
+                } else {
+                    mStart = malloc(size);
+                    memcpy(mStart, start, size);
+                }
+            }
+            ~ManagedBuffer() noexcept {
+                if (mCallback) {
+                    mCallback(mStart, mSize, mUser);
+                } else {
+                    free(mStart);
+                }
             }
-            ~ManagedBuffer() noexcept { free(mStart); }
             ManagedBuffer(ManagedBuffer const& rhs) = delete;
             ManagedBuffer& operator=(ManagedBuffer const& rhs) = delete;
             void* data() const noexcept { return mStart; }
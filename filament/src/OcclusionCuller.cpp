@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "details/OcclusionCuller.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace filament::math;
+
+namespace filament {
+
+void OcclusionCuller::setDepth(float const* depth, uint32_t width, uint32_t height,
+        mat4f const& worldToClip, float2 ndcToDepth, uint32_t frame) noexcept {
+    invalidate();
+    if (!depth || !width || !height) {
+        return;
+    }
+
+    // with a standard depth buffer, values are negated so the pyramid is always built and
+    // tested as if it were reversed-z.
+    mReversedZ = ndcToDepth.x < 0.0f;
+    mNdcToDepth = ndcToDepth;
+    mFarDepth = toPyramid(ndcToDepth.x + ndcToDepth.y);
+
+    // compute the size of the whole pyramid
+    size_t total = 0;
+    uint32_t levelCount = 0;
+    for (uint32_t w = width, h = height; levelCount < MAX_LEVEL_COUNT; levelCount++) {
+        mLevels[levelCount] = { uint32_t(total), w, h };
+        total += size_t(w) * h;
+        if (w == 1 && h == 1) {
+            levelCount++;
+            break;
+        }
+        w = std::max(1u, (w + 1u) / 2u);
+        h = std::max(1u, (h + 1u) / 2u);
+    }
+
+    mDepth.resize(total);
+    std::transform(depth, depth + size_t(width) * height, mDepth.data(),
+            [this](float d) { return toPyramid(d); });
+
+    // each texel keeps the farthest (i.e. smallest, see toPyramid()) of its 2x2 children.
+    // with odd dimensions, the last row/column also covers the extra source texel.
+    for (uint32_t l = 1; l < levelCount; l++) {
+        Level const& src = mLevels[l - 1];
+        Level const& dst = mLevels[l];
+        float* const UTILS_RESTRICT out = mDepth.data() + dst.offset;
+        for (uint32_t y = 0; y < dst.height; y++) {
+            const uint32_t y0 = std::min(2u * y, src.height - 1u);
+            const uint32_t y1 = (y == dst.height - 1u) ? src.height - 1u : std::min(2u * y + 1u, src.height - 1u);
+            for (uint32_t x = 0; x < dst.width; x++) {
+                const uint32_t x0 = std::min(2u * x, src.width - 1u);
+                const uint32_t x1 = (x == dst.width - 1u) ? src.width - 1u : std::min(2u * x + 1u, src.width - 1u);
+                float d = fetch(src, x0, y0);
+                for (uint32_t j = y0; j <= y1; j++) {
+                    for (uint32_t i = x0; i <= x1; i++) {
+                        d = std::min(d, fetch(src, i, j));
+                    }
+                }
+                out[y * dst.width + x] = d;
+            }
+        }
+    }
+
+    mWorldToClip = worldToClip;
+    mLevelCount = levelCount;
+    mDepthFrame = frame;
+}
+
+void OcclusionCuller::invalidate() noexcept {
+    mLevelCount = 0;
+}
+
+bool OcclusionCuller::isOccluded(float3 const& center, float3 const& extent) const noexcept {
+    float2 lo{ std::numeric_limits<float>::max() };
+    float2 hi{ std::numeric_limits<float>::lowest() };
+    float nearest = std::numeric_limits<float>::lowest();
+
+    #pragma nounroll
+    for (size_t i = 0; i < 8; i++) {
+        const float3 p = center + extent * float3{
+                (i & 1u) ? 1.0f : -1.0f,
+                (i & 2u) ? 1.0f : -1.0f,
+                (i & 4u) ? 1.0f : -1.0f };
+        const float4 c = mWorldToClip * float4{ p, 1.0f };
+        if (c.w <= std::numeric_limits<float>::epsilon()) {
+            // the box straddles the camera plane, assume it's visible
+            return false;
+        }
+        const float3 ndc = c.xyz / c.w;
+        lo = min(lo, ndc.xy);
+        hi = max(hi, ndc.xy);
+        nearest = std::max(nearest, toPyramid(ndc.z * mNdcToDepth.x + mNdcToDepth.y));
+    }
+
+    // outside of the screen: leave it to frustum culling
+    if (any(greaterThan(lo, float2{ 1.0f })) || any(lessThan(hi, float2{ -1.0f }))) {
+        return false;
+    }
+
+    // screen-space footprint, in texels of the first level
+    Level const& base = mLevels[0];
+    const float2 size{ base.width, base.height };
+    const float2 tlo = clamp((lo * 0.5f + 0.5f) * size, float2{ 0.0f }, size - 1.0f);
+    const float2 thi = clamp((hi * 0.5f + 0.5f) * size, float2{ 0.0f }, size - 1.0f);
+    uint32_t x0 = uint32_t(tlo.x), y0 = uint32_t(tlo.y);
+    uint32_t x1 = uint32_t(thi.x), y1 = uint32_t(thi.y);
+
+    // pick the finest level where the footprint covers at most 2x2 texels
+    uint32_t l = 0;
+    while (l + 1 < mLevelCount && ((x1 - x0) > 1u || (y1 - y0) > 1u)) {
+        x0 >>= 1u; y0 >>= 1u;
+        // clamp to the level: the last row/column covers the extra texel of odd dimensions
+        x1 = std::min(x1 >> 1u, mLevels[l + 1].width - 1u);
+        y1 = std::min(y1 >> 1u, mLevels[l + 1].height - 1u);
+        x0 = std::min(x0, x1);
+        y0 = std::min(y0, y1);
+        l++;
+    }
+
+    Level const& level = mLevels[l];
+    for (uint32_t y = y0; y <= y1; y++) {
+        for (uint32_t x = x0; x <= x1; x++) {
+            if (nearest >= fetch(level, x, y)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void OcclusionCuller::cull(Culler::result_type* UTILS_RESTRICT results,
+        float3 const* UTILS_RESTRICT center,
+        float3 const* UTILS_RESTRICT extent,
+        size_t count, size_t bit) const noexcept {
+    if (!hasDepth()) {
+        return;
+    }
+    const Culler::result_type mask = Culler::result_type(1u << bit);
+    for (size_t i = 0; i < count; i++) {
+        if ((results[i] & mask) && isOccluded(center[i], extent[i])) {
+            results[i] &= ~mask;
+        }
+    }
+}
+
+} // namespace filament
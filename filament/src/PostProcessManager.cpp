@@ -203,6 +203,7 @@ struct MaterialInfo {
 
 static const MaterialInfo sMaterialList[] = {
         { "sao",                   MATERIAL(SAO) },
+        { "saoTemporal",           MATERIAL(SAOTEMPORAL) },
         { "mipmapDepth",           MATERIAL(MIPMAPDEPTH) },
         { "vsmMipmap",             MATERIAL(VSMMIPMAP) },
         { "bilateralBlur",         MATERIAL(BILATERALBLUR) },
@@ -237,14 +238,8 @@ void PostProcessManager::init() noexcept {
         registerPostProcessMaterial(info.name, info.data, info.size);
     }
 
-    // UBO storage size.
-    // The effective kernel size is (kMaxPositiveKernelSize - 1) * 4 + 1.
-    // e.g.: 5 positive-side samples, give 4+1+4=9 samples both sides
-    // taking advantage of linear filtering produces an effective kernel of 8+1+8=17 samples
-    // and because it's a separable filter, the effective 2D filter kernel size is 17*17
-    // The total number of samples needed over the two passes is 18.
-    auto& separableGaussianBlur = getPostProcessMaterial("separableGaussianBlur");
-    mSeparableGaussianBlurKernelStorageSize = separableGaussianBlur.getMaterial()->reflect("kernel")->size;
+    // Note: the materials are only parsed the first time they're used, which keeps them out of
+    // the engine's startup time.
 
     mDummyOneTexture = driver.createTexture(SamplerType::SAMPLER_2D, 1,
             TextureFormat::RGBA8, 1, 1, 1, 1, TextureUsage::DEFAULT);
@@ -299,14 +294,17 @@ void PostProcessManager::commitAndRender(FrameGraphResources::RenderPassInfo con
 // ------------------------------------------------------------------------------------------------
 
 FrameGraphId<FrameGraphTexture> PostProcessManager::structure(FrameGraph& fg,
-        const RenderPass& pass, uint32_t width, uint32_t height, float scale) noexcept {
+        const RenderPass& pass, uint32_t width, uint32_t height, float scale,
+        bool picking) noexcept {
 
     // structure pass -- automatically culled if not used, currently used by:
     //    - ssao
     //    - contact shadows
+    //    - picking
     // It consists of a mipmapped depth pass, tuned for SSAO
     struct StructurePassData {
         FrameGraphId<FrameGraphTexture> depth;
+        FrameGraphId<FrameGraphTexture> picking;
     };
 
     // sanitize a bit the user provided scaling factor
@@ -327,9 +325,23 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::structure(FrameGraph& fg,
 
                 data.depth = builder.write(data.depth, FrameGraphTexture::Usage::DEPTH_ATTACHMENT);
 
+                if (picking) {
+                    // the renderable's entity and the bits of its depth, written by the picking
+                    // variant. An integer format keeps them intact, floats could be flushed or
+                    // canonicalized by the GPU.
+                    data.picking = builder.createTexture("Picking Buffer", {
+                            .width = width, .height = height,
+                            .format = TextureFormat::RG32UI });
+
+                    data.picking = builder.write(data.picking,
+                            FrameGraphTexture::Usage::COLOR_ATTACHMENT);
+                }
+
                 builder.declareRenderPass("Structure Target", {
-                        .attachments = { .depth = data.depth },
-                        .clearFlags = TargetBufferFlags::DEPTH
+                        .attachments = { .color = { data.picking }, .depth = data.depth },
+                        .clearFlags = picking ?
+                                TargetBufferFlags::COLOR0 | TargetBufferFlags::DEPTH :
+                                TargetBufferFlags::DEPTH
                 });
             },
             [=](FrameGraphResources const& resources, auto const& data, DriverApi& driver) {
@@ -338,6 +350,9 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::structure(FrameGraph& fg,
             });
 
     auto depth = structurePass->depth;
+    if (picking) {
+        fg.getBlackboard().put("picking", structurePass->picking);
+    }
 
     /*
      * create depth mipmap chain
@@ -383,7 +398,7 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::structure(FrameGraph& fg,
 FrameGraphId<FrameGraphTexture> PostProcessManager::screenSpaceAmbientOcclusion(
         FrameGraph& fg, RenderPass& pass,
         filament::Viewport const& svp, const CameraInfo& cameraInfo,
-        View::AmbientOcclusionOptions options) noexcept {
+        FrameHistory& frameHistory, View::AmbientOcclusionOptions options) noexcept {
 
     FEngine& engine = mEngine;
     Handle<HwRenderPrimitive> fullScreenRenderPrimitive = engine.getFullScreenRenderPrimitive();
@@ -425,6 +440,18 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::screenSpaceAmbientOcclusion(
             break;
     }
 
+    if (options.temporal.enabled) {
+        // Take a quarter of the samples, and rotate the spiral every frame so that the
+        // accumulated history covers the full kernel.
+        auto const& previous = frameHistory[0];
+        auto& current = frameHistory.getCurrent();
+        current.ssaoFrameId = previous.ssaoFrameId + 1;
+        current.ssaoProjection = cameraInfo.projection * (cameraInfo.view * cameraInfo.worldOrigin);
+        sampleCount = std::max(3.0f, std::round(sampleCount * 0.25f));
+        // golden ratio sequence, low discrepancy in [0, 1)
+        spiralTurns += std::fmod(float(current.ssaoFrameId) * 0.618034f, 1.0f);
+    }
+
     switch (options.lowPassFilter) {
         default:
         case View::QualityLevel::LOW:
@@ -585,10 +612,101 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::screenSpaceAmbientOcclusion(
                 config);
     }
 
+    /*
+     * Temporal accumulation pass
+     */
+
+    if (options.temporal.enabled) {
+        ssao = temporalAmbientOcclusionPass(fg, ssao, frameHistory, options.temporal.feedback);
+    }
+
     fg.getBlackboard().put("ssao", ssao);
     return ssao;
 }
 
+FrameGraphId<FrameGraphTexture> PostProcessManager::temporalAmbientOcclusionPass(FrameGraph& fg,
+        FrameGraphId<FrameGraphTexture> input, FrameHistory& frameHistory,
+        float feedback) noexcept {
+
+    FrameHistoryEntry const& entry = frameHistory[0];
+    FrameGraphId<FrameGraphTexture> ssaoHistory;
+    mat4f const* historyProjection = nullptr;
+    auto const& inputDesc = fg.getDescriptor(input);
+    if (UTILS_UNLIKELY(!entry.ssao.handle ||
+            entry.ssaoDesc.width != inputDesc.width ||
+            entry.ssaoDesc.height != inputDesc.height ||
+            entry.ssaoDesc.format != inputDesc.format)) {
+        // if we don't have a usable history yet, just use the current AO buffer as history
+        ssaoHistory = input;
+        historyProjection = &frameHistory.getCurrent().ssaoProjection;
+    } else {
+        ssaoHistory = fg.import("SSAO history", entry.ssaoDesc,
+                FrameGraphTexture::Usage::SAMPLEABLE, entry.ssao);
+        historyProjection = &entry.ssaoProjection;
+    }
+
+    auto depth = fg.getBlackboard().get<FrameGraphTexture>("structure");
+    assert_invariant(depth);
+
+    struct TemporalAOData {
+        FrameGraphId<FrameGraphTexture> ssao;
+        FrameGraphId<FrameGraphTexture> depth;
+        FrameGraphId<FrameGraphTexture> history;
+        FrameGraphId<FrameGraphTexture> output;
+    };
+
+    // Only the AO is accumulated, the depth packed in the other channels is passed through from
+    // the current frame because the bilateral upsampling relies on it.
+    auto& temporalPass = fg.addPass<TemporalAOData>("SSAO Temporal",
+            [&](FrameGraph::Builder& builder, auto& data) {
+                data.ssao = builder.sample(input);
+                data.depth = builder.sample(depth);
+                data.history = builder.sample(ssaoHistory);
+                data.output = builder.createTexture("SSAO Temporal output", inputDesc);
+                data.output = builder.declareRenderPass(data.output);
+            },
+            [=, &frameHistory](FrameGraphResources const& resources,
+                    auto const& data, DriverApi& driver) {
+
+                constexpr mat4f normalizedToClip = {
+                        float4{  2,  0,  0, 0 },
+                        float4{  0,  2,  0, 0 },
+                        float4{  0,  0,  -2, 0 },
+                        float4{ -1, -1, 1, 1 },
+                };
+
+                FrameHistoryEntry& current = frameHistory.getCurrent();
+
+                auto out = resources.getRenderPassInfo();
+                auto ssao = resources.getTexture(data.ssao);
+                auto depth = resources.getTexture(data.depth);
+                auto history = resources.getTexture(data.history);
+
+                auto const& material = getPostProcessMaterial("saoTemporal");
+                FMaterialInstance* mi = material.getMaterialInstance();
+                mi->setParameter("ssao",  ssao, {});    // nearest
+                mi->setParameter("depth",  depth, {});  // nearest
+                mi->setParameter("alpha", feedback);
+                // nearest, so that the packed depth of the history isn't filtered
+                mi->setParameter("history", history, {});
+                mi->setParameter("reprojection",
+                        *historyProjection *
+                        inverse(current.ssaoProjection) *
+                        normalizedToClip);
+
+                mi->commit(driver);
+                mi->use(driver);
+
+                driver.beginRenderPass(out.target, out.params);
+                driver.draw(material.getPipelineState(), mEngine.getFullScreenRenderPrimitive());
+                driver.endRenderPass();
+
+                resources.detach(data.output, &current.ssao, &current.ssaoDesc);
+            });
+
+    return temporalPass->output;
+}
+
 FrameGraphId<FrameGraphTexture> PostProcessManager::bilateralBlurPass(
         FrameGraph& fg, FrameGraphId<FrameGraphTexture> input, math::int2 axis, float zf,
         TextureFormat format, BilateralPassConfig config) noexcept {
@@ -728,6 +846,17 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::gaussianBlurPass(FrameGraph&
         FrameGraphId<FrameGraphTexture> temp;
     };
 
+    if (UTILS_UNLIKELY(!mSeparableGaussianBlurKernelStorageSize)) {
+        // UBO storage size.
+        // The effective kernel size is (kMaxPositiveKernelSize - 1) * 4 + 1.
+        // e.g.: 5 positive-side samples, give 4+1+4=9 samples both sides
+        // taking advantage of linear filtering produces an effective kernel of 8+1+8=17 samples
+        // and because it's a separable filter, the effective 2D filter kernel size is 17*17
+        // The total number of samples needed over the two passes is 18.
+        auto& separableGaussianBlur = getPostProcessMaterial("separableGaussianBlur");
+        mSeparableGaussianBlurKernelStorageSize =
+                separableGaussianBlur.getMaterial()->reflect("kernel")->size;
+    }
     const size_t kernelStorageSize = mSeparableGaussianBlurKernelStorageSize;
     fg.addPass<BlurPassData>("Gaussian Blur Passes",
             [&](FrameGraph::Builder& builder, auto& data) {
@@ -786,9 +915,6 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::gaussianBlurPass(FrameGraph&
                 mi->setParameter("count", (int32_t)m);
                 mi->setParameter("kernel", kernel, m);
 
-                // The framegraph only computes discard flags at FrameGraphPass boundaries
-                hwTempRT.params.flags.discardEnd = TargetBufferFlags::NONE;
-
                 commitAndRender(hwTempRT, separableGaussianBlur, driver);
 
                 // vertical pass
@@ -818,7 +944,8 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::gaussianBlurPass(FrameGraph&
 
 FrameGraphId<FrameGraphTexture> PostProcessManager::dof(FrameGraph& fg,
         FrameGraphId<FrameGraphTexture> input, const View::DepthOfFieldOptions& dofOptions,
-        bool translucent, const CameraInfo& cameraInfo, float2 scale) noexcept {
+        bool translucent, const CameraInfo& cameraInfo, float2 scale,
+        float visibleNearDistance) noexcept {
 
     FEngine& engine = mEngine;
     Handle<HwRenderPrimitive> const& fullScreenRenderPrimitive = engine.getFullScreenRenderPrimitive();
@@ -919,6 +1046,24 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::dof(FrameGraph& fg,
                K * (1.0 - focusDistance * (p[2][3] - p[2][2]) / p[3][2])
     };
 
+    /*
+     * coc(d) increases monotonically with the distance d, from -inf to K at infinity. Because
+     * the background can always be visible, the largest CoC on screen is bounded by K and by
+     * the CoC of the closest visible renderable. When both are below half a pixel the whole
+     * frame is in focus, and we skip all the DoF passes.
+     */
+    const float maxForegroundCoc =
+            dofOptions.maxForegroundCOC ? dofOptions.maxForegroundCOC : DOF_DEFAULT_MAX_COC;
+    const float maxBackgroundCoc =
+            dofOptions.maxBackgroundCOC ? dofOptions.maxBackgroundCOC : DOF_DEFAULT_MAX_COC;
+    const float nearCoc = K * (1.0f - focusDistance / visibleNearDistance);
+    const float maxCoc = std::max(
+            std::min(std::abs(nearCoc), nearCoc < 0.0f ? maxForegroundCoc : maxBackgroundCoc),
+            std::min(std::abs(K), K < 0.0f ? maxForegroundCoc : maxBackgroundCoc));
+    if (maxCoc < 0.5f) {
+        return input;
+    }
+
     Blackboard& blackboard = fg.getBlackboard();
     auto depth = blackboard.get<FrameGraphTexture>("depth");
     assert_invariant(depth);
@@ -1428,8 +1573,6 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::bloomPass(FrameGraph& fg,
                     mi->setParameter("resolution", float4{ w, h, 1.0f / w, 1.0f / h });
                     mi->commit(driver);
 
-                    hwOutRT.params.flags.discardStart = TargetBufferFlags::COLOR;
-                    hwOutRT.params.flags.discardEnd = TargetBufferFlags::NONE;
                     driver.beginRenderPass(hwOutRT.target, hwOutRT.params);
                     driver.draw(pipeline, fullScreenRenderPrimitive);
                     driver.endRenderPass();
@@ -1473,7 +1616,6 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::bloomPass(FrameGraph& fg,
                 for (size_t i = bloomOptions.levels - 1; i >= 1; i--) {
                     auto hwDstRT = resources.getRenderPassInfo(i - 1);
                     hwDstRT.params.flags.discardStart = TargetBufferFlags::NONE; // because we'll blend
-                    hwDstRT.params.flags.discardEnd = TargetBufferFlags::NONE;
 
                     auto w = FTexture::valueForLevel(i - 1, outDesc.width);
                     auto h = FTexture::valueForLevel(i - 1, outDesc.height);
@@ -1601,8 +1743,6 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::bloomPassPingPong(FrameGraph
                     mi->setParameter("resolution", float4{ w, h, 1.0f / w, 1.0f / h });
                     mi->commit(driver);
 
-                    hwDstRT.params.flags.discardStart = TargetBufferFlags::COLOR;
-                    hwDstRT.params.flags.discardEnd = TargetBufferFlags::NONE;
                     driver.beginRenderPass(hwDstRT.target, hwDstRT.params);
                     driver.draw(pipeline, fullScreenRenderPrimitive);
                     driver.endRenderPass();
@@ -1650,7 +1790,6 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::bloomPassPingPong(FrameGraph
 
                     auto hwDstRT = resources.getRenderPassInfo(parity ? data.outRT[i - 1] : data.stageRT[i - 1]);
                     hwDstRT.params.flags.discardStart = TargetBufferFlags::NONE; // because we'll blend
-                    hwDstRT.params.flags.discardEnd = TargetBufferFlags::NONE;
 
                     auto w = FTexture::valueForLevel(i - 1, outDesc.width);
                     auto h = FTexture::valueForLevel(i - 1, outDesc.height);
@@ -1860,7 +1999,7 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::colorGrading(FrameGraph& fg,
 
 FrameGraphId<FrameGraphTexture> PostProcessManager::fxaa(FrameGraph& fg,
         FrameGraphId<FrameGraphTexture> input,
-        TextureFormat outFormat, bool translucent) noexcept {
+        TextureFormat outFormat, bool translucent, uint2 outputSize) noexcept {
 
     struct PostProcessFXAA {
         FrameGraphId<FrameGraphTexture> input;
@@ -1871,9 +2010,11 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::fxaa(FrameGraph& fg,
             [&](FrameGraph::Builder& builder, auto& data) {
                 auto const& inputDesc = fg.getDescriptor(input);
                 data.input = builder.sample(input);
+                // The input is sampled with bilinear filtering, so rendering at a different
+                // size performs the upscaling in the same pass.
                 data.output = builder.createTexture("fxaa output", {
-                        .width = inputDesc.width,
-                        .height = inputDesc.height,
+                        .width = outputSize.x ? outputSize.x : inputDesc.width,
+                        .height = outputSize.y ? outputSize.y : inputDesc.height,
                         .format = outFormat
                 });
                 data.output = builder.declareRenderPass(data.output);
@@ -1917,7 +2058,7 @@ void PostProcessManager::prepareTaa(FrameHistory& frameHistory,
 FrameGraphId<FrameGraphTexture> PostProcessManager::taa(FrameGraph& fg,
         FrameGraphId<FrameGraphTexture> input, FrameHistory& frameHistory,
         View::TemporalAntiAliasingOptions taaOptions,
-        ColorGradingConfig colorGradingConfig) noexcept {
+        ColorGradingConfig colorGradingConfig, uint2 outputSize) noexcept {
 
     FrameHistoryEntry const& entry = frameHistory[0];
     FrameGraphId<FrameGraphTexture> colorHistory;
@@ -1946,6 +2087,12 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::taa(FrameGraph& fg,
     auto& taa = fg.addPass<TAAData>("TAA",
             [&](FrameGraph::Builder& builder, auto& data) {
                 auto desc = fg.getDescriptor(input);
+                if (outputSize.x && outputSize.y) {
+                    // The history is kept at the output resolution and is sampled with bilinear
+                    // filtering, so it accumulates the jittered low-resolution frames.
+                    desc.width = outputSize.x;
+                    desc.height = outputSize.y;
+                }
                 data.color = builder.sample(input);
                 data.depth = builder.sample(depth);
                 data.history = builder.sample(colorHistory);
@@ -2214,59 +2361,65 @@ FrameGraphId<FrameGraphTexture> PostProcessManager::resolve(FrameGraph& fg,
 }
 
 FrameGraphId<FrameGraphTexture> PostProcessManager::vsmMipmapPass(FrameGraph& fg,
-        FrameGraphId<FrameGraphTexture> input, uint8_t layer, size_t level, bool finalize) noexcept {
+        FrameGraphId<FrameGraphTexture> input, uint8_t layer, size_t levelCount) noexcept {
 
     struct VsmMipData {
         FrameGraphId<FrameGraphTexture> in;
     };
 
+    // All the levels of a layer are generated by a single FrameGraph pass, one render target
+    // per level, which avoids resolving the discard flags and the render targets per level.
     auto& depthMipmapPass = fg.addPass<VsmMipData>("VSM Generate Mipmap Pass",
             [&](FrameGraph::Builder& builder, auto& data) {
                 const char* name = builder.getName(input);
                 data.in = builder.sample(input);
 
-                auto out = builder.createSubresource(data.in, "Mip level", {
-                        .level = uint8_t(level + 1), .layer = layer });
+                for (size_t level = 1; level < levelCount; level++) {
+                    auto out = builder.createSubresource(data.in, "Mip level", {
+                            .level = uint8_t(level), .layer = layer });
 
-                out = builder.write(out, FrameGraphTexture::Usage::COLOR_ATTACHMENT);
-                builder.declareRenderPass(name, {
-                    .attachments = { .color = { out }},
-                    .clearColor = { 1.0f, 1.0f, 1.0f, 1.0f },
-                    .clearFlags = TargetBufferFlags::COLOR
-                });
+                    out = builder.write(out, FrameGraphTexture::Usage::COLOR_ATTACHMENT);
+                    builder.declareRenderPass(name, {
+                        .attachments = { .color = { out }},
+                        .clearColor = { 1.0f, 1.0f, 1.0f, 1.0f },
+                        .clearFlags = TargetBufferFlags::COLOR
+                    });
+                }
             },
             [=](FrameGraphResources const& resources,
                     auto const& data, DriverApi& driver) {
 
                 auto in = resources.getTexture(data.in);
-                auto out = resources.getRenderPassInfo();
 
                 auto const& inDesc = resources.getDescriptor(data.in);
                 auto width = inDesc.width;
                 assert_invariant(width == inDesc.height);
-                int dim = width >> (level + 1);
-
-                driver.setMinMaxLevels(in, level, level);
 
                 auto& material = getPostProcessMaterial("vsmMipmap");
                 FMaterialInstance* const mi = material.getMaterialInstance();
-                mi->setParameter("color", in, {
-                        .filterMag = SamplerMagFilter::LINEAR,
-                        .filterMin = SamplerMinFilter::LINEAR_MIPMAP_NEAREST
-                });
-                mi->setParameter("level", uint32_t(level));
                 mi->setParameter("layer", uint32_t(layer));
-                mi->setParameter("uvscale", 1.0f / dim);
 
-                // When generating shadow map mip levels, we want to preserve the 1 texel border.
-                auto vpWidth = (uint32_t) std::max(0, dim - 2);
-                out.params.viewport = { 1, 1, vpWidth, vpWidth };
+                for (size_t level = 0; level < levelCount - 1; level++) {
+                    auto out = resources.getRenderPassInfo(level);
+                    int dim = width >> (level + 1);
 
-                commitAndRender(out, material, driver);
+                    driver.setMinMaxLevels(in, level, level);
 
-                if (finalize) {
-                   driver.setMinMaxLevels(in, 0, level);
+                    mi->setParameter("color", in, {
+                            .filterMag = SamplerMagFilter::LINEAR,
+                            .filterMin = SamplerMinFilter::LINEAR_MIPMAP_NEAREST
+                    });
+                    mi->setParameter("level", uint32_t(level));
+                    mi->setParameter("uvscale", 1.0f / dim);
+
+                    // When generating shadow map mip levels, we want to preserve the 1 texel border.
+                    auto vpWidth = (uint32_t) std::max(0, dim - 2);
+                    out.params.viewport = { 1, 1, vpWidth, vpWidth };
+
+                    commitAndRender(out, material, driver);
                 }
+
+                driver.setMinMaxLevels(in, 0, levelCount - 1);
             });
 
     return depthMipmapPass->in;
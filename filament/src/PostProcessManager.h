@@ -63,14 +63,14 @@ public:
 
     // methods below are ordered relative to their position in the pipeline (as much as possible)
 
-    // structure (depth) pass
+    // structure (depth) pass, also writes the "picking" buffer when 'picking' is set
     FrameGraphId<FrameGraphTexture> structure(FrameGraph& fg, RenderPass const& pass,
-            uint32_t width, uint32_t height, float scale) noexcept;
+            uint32_t width, uint32_t height, float scale, bool picking = false) noexcept;
 
     // SSAO
     FrameGraphId<FrameGraphTexture> screenSpaceAmbientOcclusion(FrameGraph& fg,
             RenderPass& pass, filament::Viewport const& svp,
-            CameraInfo const& cameraInfo,
+            CameraInfo const& cameraInfo, FrameHistory& frameHistory,
             View::AmbientOcclusionOptions options) noexcept;
 
     // Used in refraction pass
@@ -81,7 +81,8 @@ public:
     // Depth-of-field
     FrameGraphId<FrameGraphTexture> dof(FrameGraph& fg, FrameGraphId<FrameGraphTexture> input,
             const View::DepthOfFieldOptions& dofOptions, bool translucent,
-            const CameraInfo& cameraInfo, math::float2 scale) noexcept;
+            const CameraInfo& cameraInfo, math::float2 scale,
+            float visibleNearDistance) noexcept;
 
     // Color grading, tone mapping, etc.
     void colorGradingPrepareSubpass(backend::DriverApi& driver, const FColorGrading* colorGrading,
@@ -95,20 +96,21 @@ public:
             backend::TextureFormat outFormat, bool translucent, bool fxaa, math::float2 scale,
             View::BloomOptions bloomOptions, View::VignetteOptions vignetteOptions, bool dithering) noexcept;
 
-    // Anti-aliasing
+    // Anti-aliasing. FXAA renders at outputSize if set, which lets it replace an upscaling blit.
     FrameGraphId<FrameGraphTexture> fxaa(FrameGraph& fg,
             FrameGraphId<FrameGraphTexture> input, backend::TextureFormat outFormat,
-            bool translucent) noexcept;
+            bool translucent, math::uint2 outputSize = {}) noexcept;
 
     // Temporal Anti-aliasing
     void prepareTaa(FrameHistory& frameHistory,
             CameraInfo const& cameraInfo,
             View::TemporalAntiAliasingOptions const& taaOptions) const noexcept;
 
+    // TAA renders at outputSize if set, which upscales the input temporally.
     FrameGraphId<FrameGraphTexture> taa(FrameGraph& fg,
             FrameGraphId<FrameGraphTexture> input, FrameHistory& frameHistory,
             View::TemporalAntiAliasingOptions taaOptions,
-            ColorGradingConfig colorGradingConfig) noexcept;
+            ColorGradingConfig colorGradingConfig, math::uint2 outputSize = {}) noexcept;
 
     // Blit/rescaling/resolves
     FrameGraphId<FrameGraphTexture> opaqueBlit(FrameGraph& fg,
@@ -122,9 +124,9 @@ public:
     FrameGraphId<FrameGraphTexture> resolve(FrameGraph& fg,
             const char* outputBufferName, FrameGraphId<FrameGraphTexture> input) noexcept;
 
-    // VSM shadow mipmap pass
+    // VSM shadow mipmap pass, generates levels 1 to levelCount - 1 of the given layer
     FrameGraphId<FrameGraphTexture> vsmMipmapPass(FrameGraph& fg,
-            FrameGraphId<FrameGraphTexture> input, uint8_t layer, size_t level, bool finalize) noexcept;
+            FrameGraphId<FrameGraphTexture> input, uint8_t layer, size_t levelCount) noexcept;
 
     backend::Handle<backend::HwTexture> getOneTexture() const { return mDummyOneTexture; }
     backend::Handle<backend::HwTexture> getZeroTexture() const { return mDummyZeroTexture; }
@@ -149,6 +151,11 @@ private:
             FrameGraph& fg, FrameGraphId<FrameGraphTexture> input, math::int2 axis, float zf,
             backend::TextureFormat format, BilateralPassConfig config) noexcept;
 
+    // blends the ambient occlusion buffer with its reprojected history
+    FrameGraphId<FrameGraphTexture> temporalAmbientOcclusionPass(FrameGraph& fg,
+            FrameGraphId<FrameGraphTexture> input, FrameHistory& frameHistory,
+            float feedback) noexcept;
+
     FrameGraphId<FrameGraphTexture> gaussianBlurPass(FrameGraph& fg,
             FrameGraphId<FrameGraphTexture> input, uint8_t srcLevel,
             FrameGraphId<FrameGraphTexture> output, uint8_t dstLevel,
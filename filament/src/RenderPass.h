@@ -17,6 +17,7 @@
 #ifndef TNT_UTILS_RENDERPASS_H
 #define TNT_UTILS_RENDERPASS_H
 
+#include <filament/Renderer.h>
 #include <filament/Viewport.h>
 
 #include "details/Camera.h"
@@ -28,10 +29,12 @@
 #include <private/filament/Variant.h>
 
 #include <utils/compiler.h>
+#include <utils/InplaceFunction.h>
 #include <utils/Slice.h>
 #include <utils/debug.h>
 
 #include <limits>
+#include <vector>
 
 namespace utils {
 class JobSystem;
@@ -50,18 +53,21 @@ public:
     static constexpr uint64_t BLEND_TWO_PASS_MASK           = 0x1llu;
     static constexpr unsigned BLEND_TWO_PASS_SHIFT          = 0;
 
-    static constexpr uint64_t MATERIAL_INSTANCE_ID_MASK     = 0x00000FFFllu;
-    static constexpr unsigned MATERIAL_INSTANCE_ID_SHIFT    = 0;
+    static constexpr uint64_t MATERIAL_RANK_MASK            = 0x00FFFFFFllu;
+    static constexpr unsigned MATERIAL_RANK_SHIFT           = 0;
 
-    static constexpr uint64_t MATERIAL_VARIANT_KEY_MASK     = 0x000FF000llu;
-    static constexpr unsigned MATERIAL_VARIANT_KEY_SHIFT    = 12;
+    static constexpr uint64_t MATERIAL_VARIANT_KEY_MASK     = 0xFF000000llu;
+    static constexpr unsigned MATERIAL_VARIANT_KEY_SHIFT    = 24;
 
-    static constexpr uint64_t MATERIAL_ID_MASK              = 0xFFF00000llu;
-    static constexpr unsigned MATERIAL_ID_SHIFT             = 20;
+    // number of material instances that can be ranked without collisions
+    static constexpr uint32_t MATERIAL_RANK_COUNT           = 0x01000000u;
 
     static constexpr uint64_t BLEND_DISTANCE_MASK           = 0xFFFFFFFF0000llu;
     static constexpr unsigned BLEND_DISTANCE_SHIFT          = 16;
 
+    static constexpr uint64_t BLEND_UNSORTED_MASK           = 0x0002000000000000llu;
+    static constexpr unsigned BLEND_UNSORTED_SHIFT          = 49;
+
     static constexpr uint64_t MATERIAL_MASK                 = 0xFFFFFFFFllu;
     static constexpr unsigned MATERIAL_SHIFT                = 0;
 
@@ -111,6 +117,9 @@ public:
         DEPTH_FILTER_TRANSLUCENT_OBJECTS = 0x8,
         // alpha-tested objects are not rendered in the depth buffer
         DEPTH_FILTER_ALPHA_MASKED_OBJECTS = 0x10,
+        // color pass only: opaque objects are rendered depth-only first, then shaded with an
+        // EQUAL depth test and without depth writes
+        DEPTH_PREPASS = 0x20,
 
         // generate commands for shadow map
         SHADOW = DEPTH | DEPTH_CONTAINS_SHADOW_CASTERS,
@@ -149,6 +158,7 @@ public:
     // |   6  | 2| 2|1| 3 | 2|              32                |         15    |1|
     // +------+--+--+-+---+--+--------------------------------+---------------+-+
     // |000011|01|00|0|ppp|00|         ~distanceBits          |   blendOrder  |t|
+    // |000011|01|00|0|ppp|10|          material-id           |   blendOrder  |0| order-independent
     // +------+--+--+-+---+--+--------------------------------+---------------+-+
     // | correctness                                                            |
     //
@@ -180,16 +190,21 @@ public:
 
     // The sorting material key is 32 bits and encoded as:
     //
-    // |     12     |   8    |     12     |
-    // +------------+--------+------------+
-    // |  material  |variant |  instance  |
-    // +------------+--------+------------+
+    // |   8    |             24              |
+    // +--------+-----------------------------+
+    // |variant |        instance rank        |
+    // +--------+-----------------------------+
+    //
+    // The rank is dense and assigned by FEngine to all live material instances, ordered by
+    // material, then by pipeline state (the raster state the instance overrides), so that
+    // commands using the same program and raster state are contiguous (see
+    // FEngine::updateMaterialSortingKeys()). Grouping by variant first doesn't change the number
+    // of program changes, since a program is a (material, variant) pair.
     //
     // The variant is inserted while building the commands, because we don't know it before that
     //
-    static CommandKey makeMaterialSortingKey(uint32_t materialId, uint32_t instanceId) noexcept {
-        CommandKey key = ((materialId << MATERIAL_ID_SHIFT) & MATERIAL_ID_MASK) |
-                         ((instanceId << MATERIAL_INSTANCE_ID_SHIFT) & MATERIAL_INSTANCE_ID_MASK);
+    static CommandKey makeMaterialSortingKey(uint32_t rank) noexcept {
+        CommandKey key = (uint64_t(rank) << MATERIAL_RANK_SHIFT) & MATERIAL_RANK_MASK;
         return (key << MATERIAL_SHIFT) & MATERIAL_MASK;
     }
 
@@ -210,19 +225,27 @@ public:
         return boolish ? -1llu : 0llu;
     }
 
-    struct PrimitiveInfo { // 24 bytes
+    struct PrimitiveInfo { // 32 bytes
         FMaterialInstance const* mi = nullptr;                          // 8 bytes (4)
         backend::Handle<backend::HwRenderPrimitive> primitiveHandle;    // 4 bytes
         backend::Handle<backend::HwUniformBuffer> perRenderableBones;   // 4 bytes
         backend::RasterState rasterState;                               // 4 bytes
         uint16_t index = 0;                                             // 2 bytes
+        uint16_t instanceCount = 1;                                     // 2 bytes
         Variant materialVariant;                                        // 1 byte
-        uint8_t reserved = {};                                          // 1 byte
+        uint8_t reserved = 0;                                           // 1 byte
+        uint16_t perRenderableBonesOffset = 0;                          // 2 bytes
+        uint32_t primitiveCount = 0;                                    // 4 bytes
     };
+    static_assert(sizeof(PrimitiveInfo) == 32, "PrimitiveInfo must be 32 bytes");
 
-    struct alignas(8) Command {     // 32 bytes
+    // Commands only hold their sorting key and the index of their PrimitiveInfo, which is
+    // stored separately by the pass. This halves the memory moved by sortCommands() and keeps
+    // four commands per cache-line when they're walked by recordDriverCommands().
+    struct alignas(8) Command {     // 16 bytes
         CommandKey key = 0;         //  8 bytes
-        PrimitiveInfo primitive;    // 24 bytes
+        uint32_t info = 0;          //  4 bytes, index of this command's PrimitiveInfo
+        uint32_t reserved = 0;      //  4 bytes
         bool operator < (Command const& rhs) const noexcept { return key < rhs.key; }
         // placement new declared as "throw" to avoid the compiler's null-check
         inline void* operator new (std::size_t size, void* ptr) {
@@ -230,6 +253,7 @@ public:
             return ptr;
         }
     };
+    static_assert(sizeof(Command) == 16, "Command must be 16 bytes");
     static_assert(std::is_trivially_destructible<Command>::value,
             "Command isn't trivially destructible");
 
@@ -240,9 +264,41 @@ public:
     static constexpr RenderFlags HAS_INVERSE_FRONT_FACES = 0x08;
     static constexpr RenderFlags HAS_FOG                 = 0x10;
     static constexpr RenderFlags HAS_VSM                 = 0x20;
+    static constexpr RenderFlags HAS_PICKING             = 0x40;
+
+    // Retains the sorted commands produced by appendCommands() across frames. Each visible
+    // renderable's inputs are hashed every frame; commands of renderables whose hash didn't
+    // change are reused as-is, and only the others are regenerated and merged into the sorted
+    // list. Everything is regenerated when the camera or the pass settings change.
+    class CommandCache {
+    public:
+        // forces the next appendCommands() to regenerate all commands
+        void invalidate() noexcept { mValid = false; }
+
+        // number of renderables whose commands were (re)generated by the last appendCommands()
+        uint32_t getDirtyCount() const noexcept { return mDirtyCount; }
+
+    private:
+        friend class RenderPass;
+        std::vector<Command> mCommands;         // sorted, without sentinels
+        std::vector<PrimitiveInfo> mPrimitiveInfos; // indexed by mCommands[i].info
+        std::vector<uint64_t> mHashes;          // inputs hash of each visible renderable
+        std::vector<uint64_t> mNextHashes;      // same for the frame being processed
+        math::float3 mCameraPosition{};
+        math::float3 mCameraForward{};
+        uint32_t mFirst = 0;
+        uint32_t mDirtyCount = 0;
+        FScene::VisibleMaskType mVisibilityMask = 0;
+        RenderFlags mRenderFlags = 0;
+        uint8_t mCommandTypeFlags = 0;
+        bool mValid = false;
+    };
 
 
-    RenderPass(FEngine& engine, utils::GrowingSlice<Command> commands) noexcept;
+    // A PrimitiveInfo is allocated for each command generated by appendCommands(), so
+    // 'primitiveInfos' should have the same capacity as 'commands'.
+    RenderPass(FEngine& engine, utils::GrowingSlice<Command> commands,
+            utils::GrowingSlice<PrimitiveInfo> primitiveInfos) noexcept;
     RenderPass(RenderPass const& rhs);
     ~RenderPass() noexcept;
 
@@ -252,6 +308,10 @@ public:
     void setCamera(const CameraInfo& camera) noexcept;
     void setRenderFlags(RenderFlags flags) noexcept;
 
+    // Counts the work recorded by execute() and executeCommands() into 'stats', if not null.
+    // The stats must outlive the execution of the pass and its copies.
+    void setRenderStats(Renderer::RenderStats* stats) noexcept { mRenderStats = stats; }
+
     // Sets the visibility mask, which is AND-ed against each Renderable's VISIBLE_MASK to determine
     // if the renderable is visible for this pass.
     // Defaults to all 1's, which means all renderables in this render pass will be rendered.
@@ -262,6 +322,10 @@ public:
         mVisibilityMask = std::numeric_limits<FScene::VisibleMaskType>::max();
     }
 
+    // Restricts rendering to 'scissor' (in render target coordinates), in addition to the
+    // scissor of each MaterialInstance. An empty scissor doesn't restrict anything.
+    void setScissor(backend::Viewport const& scissor) noexcept { mScissor = scissor; }
+
     Command* begin() noexcept { return mCommands.begin(); }
     Command* end() noexcept { return mCommands.end(); }
 
@@ -271,16 +335,32 @@ public:
     Command* newCommandBuffer() noexcept;
 
     // returns mCommands.end()
-    Command* appendCommands(CommandTypeFlags commandTypeFlags) noexcept;
+    // If a cache is provided and the command buffer is empty, unchanged commands are taken
+    // from the cache, which is then updated; the commands are already sorted on return.
+    Command* appendCommands(CommandTypeFlags commandTypeFlags,
+            CommandCache* cache = nullptr) noexcept;
+
+    // custom commands are stored inline, their captures must fit in CustomCommandFn
+    using CustomCommandFn = utils::InplaceFunction<void()>;
 
     // returns mCommands.end()
     Command* appendCustomCommand(Pass pass, CustomCommand custom, uint32_t order,
-            std::function<void()> command);
+            CustomCommandFn command);
 
     // sorts commands, then trims sentinels and returns
     // the new mCommands.end()
     Command* sortCommands() noexcept;
 
+    // Sorts commands[0, count) by key using a parallel LSD radix sort, the commands themselves
+    // are scattered. SENTINEL commands are moved to the end, but their relative order is not
+    // preserved.
+    // Returns false (and leaves commands untouched) if scratch is too small, in which case
+    // the caller must fall back to a comparison sort. Exposed publicly for testing.
+    static bool radixSortCommands(utils::JobSystem& js, Command* commands, uint32_t count,
+            void* scratch, size_t scratchSize) noexcept;
+
+    static size_t getRadixSortScratchSize(uint32_t count) noexcept;
+
     void execute(const char* name,
             backend::Handle<backend::HwRenderTarget> renderTarget,
             backend::RenderPassParams params) const noexcept;
@@ -290,15 +370,18 @@ public:
     utils::GrowingSlice<Command>& getCommands() { return mCommands; }
     utils::Slice<Command> const& getCommands() const { return mCommands; }
 
+    PrimitiveInfo const& getPrimitiveInfo(Command const& command) const noexcept {
+        return mPrimitiveInfos[command.info];
+    }
+
     size_t getCommandsHighWatermark() const noexcept {
-        return mCommandsHighWatermark * sizeof(Command);
+        return mCommandsHighWatermark * (sizeof(Command) + sizeof(PrimitiveInfo));
     }
 
 private:
     friend class FRenderer;
 
-    // on 64-bits systems, we process batches of 4 (64 bytes) cache-lines, or 8 (32 bytes) commands
-    // on 32-bits systems, we process batches of 8 (32 bytes) cache-lines, or 8 (32 bytes) commands
+    // we process batches of 4 (64 bytes) cache-lines, or 16 (16 bytes) commands
     static constexpr size_t JOBS_PARALLEL_FOR_COMMANDS_COUNT = 16;
     static constexpr size_t JOBS_PARALLEL_FOR_COMMANDS_SIZE  =
             sizeof(Command) * JOBS_PARALLEL_FOR_COMMANDS_COUNT;
@@ -306,26 +389,58 @@ private:
     static_assert(JOBS_PARALLEL_FOR_COMMANDS_SIZE % utils::CACHELINE_SIZE == 0,
             "Size of Commands jobs must be multiple of a cache-line size");
 
+    // below this many commands, std::sort beats the radix sort's fixed overhead
+    static constexpr uint32_t RADIX_SORT_MIN_COUNT      = 1024;
+    // a radix sort chunk is the unit of work of a job, it must be large enough to amortize
+    // clearing and scanning its 256-entries histogram
+    static constexpr uint32_t RADIX_SORT_CHUNK_MIN_SIZE = 2048;
+    static constexpr uint32_t RADIX_SORT_MAX_CHUNKS     = 16;
+
     static inline void generateCommands(uint32_t commandTypeFlags, Command* commands,
-            FScene::RenderableSoa const& soa, utils::Range<uint32_t> range, RenderFlags renderFlags,
-            FScene::VisibleMaskType visibilityMask, math::float3 cameraPosition, math::float3 cameraForward) noexcept;
+            PrimitiveInfo* infos, uint32_t infoIndex,
+            FScene::RenderableSoa const& soa, utils::Range<uint32_t> range,
+            RenderFlags renderFlags, FScene::VisibleMaskType visibilityMask,
+            math::float3 cameraPosition, math::float3 cameraForward) noexcept;
 
     template<uint32_t commandTypeFlags>
     static inline void generateCommandsImpl(uint32_t, Command* commands,
+            PrimitiveInfo* infos, uint32_t infoIndex,
             FScene::RenderableSoa const& soa, utils::Range<uint32_t> range,
             RenderFlags renderFlags, FScene::VisibleMaskType visibilityMask,
             math::float3 cameraPosition, math::float3 cameraForward) noexcept;
 
-    static void setupColorCommand(Command& cmdDraw,
+    // commands written at 'curr' use the PrimitiveInfos at infos[infoIndex] onwards
+    static inline void generateCommandsAt(uint32_t commandTypeFlags, Command* curr,
+            PrimitiveInfo* infos, uint32_t infoIndex,
+            FScene::RenderableSoa const& soa, utils::Range<uint32_t> range,
+            RenderFlags renderFlags, FScene::VisibleMaskType visibilityMask,
+            math::float3 cameraPosition, math::float3 cameraForward) noexcept;
+
+    static uint64_t hashRenderableInputs(FScene::RenderableSoa const& soa, uint32_t i) noexcept;
+
+    // Reuses the cached commands of the renderables that didn't change and regenerates the
+    // others. Returns false if all commands need to be regenerated instead.
+    bool patchCachedCommands(CommandCache& cache, CommandTypeFlags commandTypeFlags,
+            math::float3 cameraPosition, math::float3 cameraForward) noexcept;
+
+    void updateCommandCache(CommandCache& cache, CommandTypeFlags commandTypeFlags,
+            math::float3 cameraPosition, math::float3 cameraForward) noexcept;
+
+    // sorts [first, mCommands.end()), using the unused tail of mCommands as scratch memory
+    void sortCommandRange(Command* first) noexcept;
+
+    static void setupColorCommand(CommandKey& key, PrimitiveInfo& info,
             FMaterialInstance const* mi, bool inverseFrontFaces) noexcept;
 
     void recordDriverCommands(FEngine::DriverApi& driver, const Command* first,
-            const Command* last) const noexcept;
+            const Command* last, Renderer::RenderStats::Counts& counts) const noexcept;
+
+    static void addRenderStats(Renderer::RenderStats& stats, const char* name,
+            Renderer::RenderStats::Counts const& counts) noexcept;
 
     static void updateSummedPrimitiveCounts(
             FScene::RenderableSoa& renderableData, utils::Range<uint32_t> vr) noexcept;
 
-    using CustomCommandFn = std::function<void()>;
     using CustomCommandVector = std::vector<CustomCommandFn,
             utils::STLAllocator<CustomCommandFn, LinearAllocatorArena>>;
 
@@ -333,6 +448,7 @@ private:
     FEngine& mEngine;
 
     utils::GrowingSlice<Command> mCommands;
+    utils::GrowingSlice<PrimitiveInfo> mPrimitiveInfos;
 
     // the SOA containing the renderables we're interested in
     FScene::RenderableSoa const* mRenderableSoa = nullptr;
@@ -350,10 +466,17 @@ private:
     bool mPolygonOffsetOverride = false;
     // value of the override
     backend::PolygonOffset mPolygonOffset{};
+    // additional scissor, unused when empty
+    backend::Viewport mScissor{};
+    // where to count the work recorded by this pass, if anywhere
+    Renderer::RenderStats* mRenderStats = nullptr;
 
     // a vector for our custom commands
     mutable CustomCommandVector mCustomCommands;
 
+    // number of commands at the start of the command buffer that are already sorted
+    uint32_t mSortedCount = 0;
+
     // high watermark for debugging
     size_t mCommandsHighWatermark = 0;
 };
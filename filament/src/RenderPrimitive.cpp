@@ -50,6 +50,7 @@ void FRenderPrimitive::init(backend::DriverApi& driver,
 
         mPrimitiveType = entry.type;
         mEnabledAttributes = enabledAttributes;
+        mPrimitiveCount = getPrimitiveCount(entry.type, entry.count);
     }
 }
 
@@ -73,6 +74,7 @@ void FRenderPrimitive::set(FEngine& engine, RenderableManager::PrimitiveType typ
 
     mPrimitiveType = type;
     mEnabledAttributes = enabledAttributes;
+    mPrimitiveCount = getPrimitiveCount(type, count);
 }
 
 void FRenderPrimitive::set(FEngine& engine, RenderableManager::PrimitiveType type, size_t offset,
@@ -81,6 +83,17 @@ void FRenderPrimitive::set(FEngine& engine, RenderableManager::PrimitiveType typ
     driver.setRenderPrimitiveRange(mHandle, type,
             (uint32_t)offset, (uint32_t)minIndex, (uint32_t)maxIndex, (uint32_t)count);
     mPrimitiveType = type;
+    mPrimitiveCount = getPrimitiveCount(type, count);
+}
+
+uint32_t FRenderPrimitive::getPrimitiveCount(backend::PrimitiveType type, size_t count) noexcept {
+    switch (type) {
+        case backend::PrimitiveType::POINTS:    return uint32_t(count);
+        case backend::PrimitiveType::LINES:     return uint32_t(count / 2);
+        case backend::PrimitiveType::TRIANGLES: return uint32_t(count / 3);
+        case backend::PrimitiveType::NONE:      return 0;
+    }
+    return 0;
 }
 
 } // namespace filament
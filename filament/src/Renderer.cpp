@@ -16,11 +16,13 @@
 
 #include "details/Renderer.h"
 
+#include "HardwareCounters.h"
 #include "RenderPass.h"
 #include "ResourceAllocator.h"
 
 #include "details/Engine.h"
 #include "details/Fence.h"
+#include "details/RenderTarget.h"
 #include "details/Scene.h"
 #include "details/SwapChain.h"
 #include "details/Texture.h"
@@ -56,13 +58,16 @@ FRenderer::FRenderer(FEngine& engine) :
         mFrameSkipper(engine, 1u),
         mFrameInfoManager(engine),
         mIsRGB8Supported(false),
-        mPerRenderPassArena(engine.getPerRenderPassAllocator())
+        mPerRenderPassArena(engine.getPerRenderPassAllocator()),
+        mFrameGraphArena("FrameGraph Arena", CONFIG_FRAME_GRAPH_ARENA_SIZE)
 {
     FDebugRegistry& debugRegistry = engine.getDebugRegistry();
     debugRegistry.registerProperty("d.ssao.enabled", &engine.debug.ssao.enabled);
 
     debugRegistry.registerProperty("d.renderer.doFrameCapture",
             &engine.debug.renderer.doFrameCapture);
+    debugRegistry.registerProperty("d.renderer.performance_counters",
+            &engine.debug.renderer.performance_counters);
 }
 
 void FRenderer::init() noexcept {
@@ -108,7 +113,8 @@ FRenderer::~FRenderer() noexcept {
     size_t wmpct = wm / (CONFIG_PER_FRAME_COMMANDS_SIZE / 100);
     slog.d << "Renderer: Commands High watermark "
     << wm / 1024 << " KiB (" << wmpct << "%), "
-    << wm / sizeof(Command) << " commands, " << sizeof(Command) << " bytes/command"
+    << wm / (sizeof(Command) + sizeof(PrimitiveInfo)) << " commands, "
+    << sizeof(Command) + sizeof(PrimitiveInfo) << " bytes/command"
     << io::endl;
 #endif
 }
@@ -119,6 +125,11 @@ void FRenderer::terminate(FEngine& engine) {
     DriverApi& driver = engine.getDriverApi();
     driver.destroyRenderTarget(mRenderTarget);
 
+    for (FFence* fence : mBatchFences) {
+        engine.destroy(fence);
+    }
+    mBatchFences.clear();
+
     // before we can destroy this Renderer's resources, we must make sure
     // that all pending commands have been executed (as they could reference data in this
     // instance, e.g. Fences, Callbacks, etc...)
@@ -175,9 +186,19 @@ void FRenderer::render(FView const* view) {
         // create a root job so no other job can escape
         auto *rootJob = js.setRootJob(js.createJob());
 
+        // the GPU time of views using dynamic resolution is measured separately, it drives
+        // their resolution
+        const bool timed = view->getDynamicResolutionOptions().enabled &&
+                mFrameInfoManager.beginView(view);
+
         // execute the render pass
         renderJob(rootArena, const_cast<FView&>(*view));
 
+        if (timed) {
+            const float2 scale = view->getScale();
+            mFrameInfoManager.endView(scale.x * scale.y);
+        }
+
         // make sure to flush the command buffer
         engine.flush();
 
@@ -221,6 +242,13 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
         scale = 1.0f;
     }
 
+    if (view.hasEyeCameras()) {
+        // these effects need a single projection for the whole viewport
+        aoOptions.enabled = false;
+        dofOptions.enabled = false;
+        taaOptions.enabled = false;
+    }
+
     const bool scaled = any(notEqual(scale, float2(1.0f)));
     filament::Viewport svp = vp.scale(scale);
     if (svp.empty()) {
@@ -233,11 +261,39 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
         initializeClearFlags();
     }
 
-    view.prepare(engine, driver, arena, svp, getShaderUserTime());
+    // With a damage region, a View rendering straight into a SwapChain which retains its
+    // content only needs to be redrawn within the damage, and not at all if it's undamaged.
+    filament::Viewport scissor{};
+    if (UTILS_UNLIKELY(!mDamageRegion.empty()) &&
+            !mClearOptions.clear && !mClearOptions.discard &&
+            !hasPostProcess && !view.getRenderTarget() && !view.hasEyeCameras() &&
+            view.getBlendMode() == View::BlendMode::OPAQUE) {
+        const int32_t left = std::max(vp.left, mDamageRegion.left);
+        const int32_t bottom = std::max(vp.bottom, mDamageRegion.bottom);
+        const int32_t right = std::min(vp.right(), mDamageRegion.right());
+        const int32_t top = std::min(vp.top(), mDamageRegion.top());
+        if (right <= left || top <= bottom) {
+            return;
+        }
+        scissor = { left, bottom, uint32_t(right - left), uint32_t(top - bottom) };
+    }
+
+    view.prepare(engine, driver, arena, svp, getShaderUserTime(), mFrameId);
 
     // start froxelization immediately, it has no dependencies
+    // (its time is read once the framegraph has executed, which waits for it)
+    FrameInfo::duration froxelizationTime{};
+    HardwareCounters::Counters froxelizationCounters{};
+    const bool countersEnabled = engine.debug.renderer.performance_counters;
     JobSystem::Job* jobFroxelize = js.runAndRetain(js.createJob(nullptr,
-            [&engine, &view](JobSystem&, JobSystem::Job*) { view.froxelize(engine); }));
+            [&engine, &view, &froxelizationTime, &froxelizationCounters, countersEnabled](
+                    JobSystem&, JobSystem::Job*) {
+                HardwareCounters counters(countersEnabled);
+                const clock::time_point start = clock::now();
+                view.froxelize(engine);
+                froxelizationTime = clock::now() - start;
+                froxelizationCounters = counters.elapsed();
+            }));
 
     /*
      * Allocate command buffer
@@ -245,12 +301,16 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
 
     FScene& scene = *view.getScene();
 
+    // each command has its PrimitiveInfo, stored separately so that sorting moves less memory
     const size_t commandsSize = FEngine::CONFIG_PER_FRAME_COMMANDS_SIZE;
-    const size_t commandsCount = commandsSize / sizeof(Command);
+    const size_t commandsCount = commandsSize / (sizeof(Command) + sizeof(PrimitiveInfo));
     GrowingSlice<Command> commands(
             arena.allocate<Command>(commandsCount, CACHELINE_SIZE), commandsCount);
+    GrowingSlice<PrimitiveInfo> primitiveInfos(
+            arena.allocate<PrimitiveInfo>(commandsCount, CACHELINE_SIZE), commandsCount);
 
-    RenderPass pass(engine, commands);
+    RenderPass pass(engine, commands, primitiveInfos);
+    pass.setRenderStats(mRenderStatsEnabled ? &mCurrentRenderStats : nullptr);
     RenderPass::RenderFlags renderFlags = 0;
     if (view.hasShadowing())               renderFlags |= RenderPass::HAS_SHADOWING;
     if (view.hasDirectionalLight())        renderFlags |= RenderPass::HAS_DIRECTIONAL_LIGHT;
@@ -264,7 +324,8 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
      * Frame graph
      */
 
-    FrameGraph fg(engine.getResourceAllocator());
+    FrameGraph fg(engine.getResourceAllocator(), &view.getFrameGraphCompileCache(),
+            &mFrameGraphArena);
 
     /*
      * Shadow pass
@@ -308,6 +369,25 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
     const bool needsAlphaChannel = mSwapChain->isTransparent() || blendModeTranslucent;
     const TextureFormat hdrFormat = getHdrFormat(view, needsAlphaChannel);
 
+    // Variable rate shading: the color pass is shaded at a coarser rate while the camera rotates
+    // quickly. The rotation is measured in pixels at the center of the screen.
+    ShadingRate shadingRate = ShadingRate::RATE_1X1;
+    auto const& vrsOptions = view.getVariableRateShadingOptions();
+    if (vrsOptions.enabled && driver.isShadingRateSupported()) {
+        CameraInfo const& camera = view.getCameraInfo();
+        FrameHistory& history = view.getFrameHistory();
+        const float3 forward = camera.getForwardVector();
+        const float3 previousForward = history[0].cameraForward;
+        history.getCurrent().cameraForward = forward;
+        if (dot(previousForward, previousForward) > 0.0f) {
+            const float angle = std::acos(clamp(dot(forward, previousForward), -1.0f, 1.0f));
+            const float pixelsPerRadian = 0.5f * camera.projection[1][1] * float(svp.height);
+            if (angle * pixelsPerRadian > vrsOptions.motionThreshold) {
+                shadingRate = ShadingRate::RATE_2X2;
+            }
+        }
+    }
+
     const ColorPassConfig config{
             .vp = vp,
             .svp = svp,
@@ -316,7 +396,8 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
             .msaa = msaa,
             .clearFlags = clearFlags,
             .clearColor = clearColor,
-            .hasContactShadows = scene.hasContactShadows()
+            .hasContactShadows = scene.hasContactShadows() && !view.hasEyeCameras(),
+            .shadingRate = shadingRate
     };
 
     // asSubpass is disabled with TAA (although it's supported) because performance was degraded
@@ -325,7 +406,7 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
             .asSubpass =
                     colorGrading &&
                     msaa <= 1 && !bloomOptions.enabled && !dofOptions.enabled && !taaOptions.enabled &&
-                    driver.isFrameBufferFetchSupported(),
+                    !view.hasEyeCameras() && driver.isFrameBufferFetchSupported(),
             .translucent = needsAlphaChannel,
             .fxaa = fxaa,
             .dithering = dithering,
@@ -341,10 +422,23 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
     pass.setCamera(cameraInfo);
     pass.setGeometry(scene.getRenderableData(), view.getVisibleRenderables(), scene.getRenderableUBO());
     view.updatePrimitivesLod(engine, cameraInfo, scene.getRenderableData(), view.getVisibleRenderables());
-
-    fg.addTrivialSideEffectPass("Prepare View Uniforms", [svp, &view] (DriverApi& driver) {
+    FView::updateTextureStreaming(engine, cameraInfo, scene.getRenderableData(),
+            view.getVisibleRenderables(), float(svp.height));
+
+    // Motion vectors reproject with the previous frame's unjittered camera. Both are expressed
+    // relative to their own frame's world origin, like the renderables' previous transforms.
+    FrameHistory& frameHistory = view.getFrameHistory();
+    FrameHistoryEntry& currentHistory = frameHistory.getCurrent();
+    currentHistory.clipFromWorld = cameraInfo.projection * cameraInfo.view;
+    currentHistory.hasClipFromWorld = true;
+    const mat4f previousClipFromWorld = frameHistory[0].hasClipFromWorld ?
+            frameHistory[0].clipFromWorld : currentHistory.clipFromWorld;
+
+    fg.addTrivialSideEffectPass("Prepare View Uniforms",
+            [svp, previousClipFromWorld, &view] (DriverApi& driver) {
         CameraInfo cameraInfo = view.getCameraInfo();
         view.prepareCamera(cameraInfo);
+        view.preparePreviousCamera(previousClipFromWorld);
         view.prepareViewport(svp);
         view.commitUniforms(driver);
     });
@@ -355,12 +449,70 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
     // This is normally used by SSAO and contact-shadows
 
     // TODO: this should be a FrameGraph pass to participate to automatic culling
+    HardwareCounters commandCounters(countersEnabled);
+    clock::time_point commandsStart = clock::now();
     pass.newCommandBuffer();
-    pass.appendCommands(RenderPass::CommandTypeFlags::SSAO);
+    // pending View::pick() queries are answered by the structure pass, which then also writes
+    // the picking buffer. It has no VSM target.
+    const bool picking = view.hasPickingQueries();
+    if (picking) {
+        pass.setRenderFlags((renderFlags & ~RenderPass::HAS_VSM) | RenderPass::HAS_PICKING);
+    }
+    pass.appendCommands(RenderPass::CommandTypeFlags::SSAO, view.getDepthCommandCache());
+    pass.setRenderFlags(renderFlags);
     pass.sortCommands();
+    FrameInfo::duration commandGenerationTime = clock::now() - commandsStart;
+    HardwareCounters::Counters commandGenerationCounters = commandCounters.elapsed();
 
     // TODO: the scaling should depends on all passes that need the structure pass
-    ppm.structure(fg, pass, svp.width, svp.height, aoOptions.resolution);
+    ppm.structure(fg, pass, svp.width, svp.height, aoOptions.resolution, picking);
+
+    // picking reads back the picking buffer, which keeps the structure pass alive
+    if (picking) {
+        struct PickingReadbackData {
+            FrameGraphId<FrameGraphTexture> picking;
+            uint32_t rt;
+        };
+        fg.addPass<PickingReadbackData>("Picking Readback",
+                [&](FrameGraph::Builder& builder, auto& data) {
+                    data.picking = fg.getBlackboard().get<FrameGraphTexture>("picking");
+                    data.picking = builder.read(data.picking,
+                            FrameGraphTexture::Usage::COLOR_ATTACHMENT);
+                    data.rt = builder.declareRenderPass("Picking Readback Target", {
+                            .attachments = { .color = { data.picking }}
+                    });
+                    builder.sideEffect();
+                },
+                [&view](FrameGraphResources const& resources, auto const& data, DriverApi& driver) {
+                    auto const& desc = resources.getDescriptor(data.picking);
+                    auto out = resources.getRenderPassInfo(data.rt);
+                    view.readPickingQueries(driver, out.target, desc.width, desc.height);
+                });
+    }
+
+    // occlusion culling reads back the structure buffer, which keeps the structure pass alive.
+    if (view.isOcclusionCullingEnabled() && !view.hasEyeCameras() &&
+            driver.isDepthReadbackSupported()) {
+        struct OcclusionReadbackData {
+            FrameGraphId<FrameGraphTexture> depth;
+            uint32_t rt;
+        };
+        const mat4f worldToClip = cameraInfo.projection * cameraInfo.view;
+        fg.addPass<OcclusionReadbackData>("Occlusion Depth Readback",
+                [&](FrameGraph::Builder& builder, auto& data) {
+                    data.depth = fg.getBlackboard().get<FrameGraphTexture>("structure");
+                    data.depth = builder.read(data.depth, FrameGraphTexture::Usage::DEPTH_ATTACHMENT);
+                    data.rt = builder.declareRenderPass("Occlusion Readback Target", {
+                            .attachments = { .depth = data.depth }
+                    });
+                    builder.sideEffect();
+                },
+                [=, &view](FrameGraphResources const& resources, auto const& data, DriverApi& driver) {
+                    auto const& desc = resources.getDescriptor(data.depth);
+                    auto out = resources.getRenderPassInfo(data.rt);
+                    view.readOcclusionDepth(driver, out.target, desc.width, desc.height, worldToClip);
+                });
+    }
 
     // Apply the TAA jitter to everything after the structure pass, starting with the color pass.
     if (taaOptions.enabled) {
@@ -383,16 +535,23 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
 
     if (aoOptions.enabled) {
         // we could rely on FrameGraph culling, but this creates unnecessary CPU work
-        ppm.screenSpaceAmbientOcclusion(fg, pass, svp, cameraInfo, aoOptions);
+        ppm.screenSpaceAmbientOcclusion(fg, pass, svp, cameraInfo, view.getFrameHistory(),
+                aoOptions);
     }
 
     // --------------------------------------------------------------------------------------------
     // Color passes
 
     // TODO: ideally this should be a FrameGraph pass to participate to automatic culling
+    commandCounters = HardwareCounters(countersEnabled);
+    commandsStart = clock::now();
     pass.newCommandBuffer();
-    pass.appendCommands(RenderPass::COLOR);
+    pass.appendCommands(view.hasDepthPrepass() ?
+            RenderPass::CommandTypeFlags(RenderPass::COLOR | RenderPass::DEPTH_PREPASS) :
+            RenderPass::COLOR, view.getColorCommandCache());
     pass.sortCommands();
+    commandGenerationTime += clock::now() - commandsStart;
+    commandGenerationCounters += commandCounters.elapsed();
 
     FrameGraphTexture::Descriptor desc = {
             .width = config.svp.width,
@@ -427,6 +586,9 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
     auto colorGradingConfigForColor = colorGradingConfig;
     colorGradingConfigForColor.asSubpass = colorGradingConfigForColor.asSubpass && !taaOptions.enabled;
 
+    // only redraw the damaged part of the View, see above
+    pass.setScissor(scissor);
+
     // the color pass itself + color-grading as subpass if needed
     FrameGraphId<FrameGraphTexture> colorPassOutput = colorPass(fg, "Color Pass",
             desc, config, colorGradingConfigForColor, pass, view);
@@ -456,9 +618,15 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
     //       dedicated TAA pass for the DoF, as explained in
     //       "Life of a Bokeh" by Guillaume Abadie, SIGGRAPH 2018
 
-    // TAA for color pass
+    // TAA for color pass. With temporal upscaling, TAA outputs the native resolution and the
+    // rest of the post-processing chain runs unscaled.
+    const bool taaUpscaling = taaOptions.enabled && scaled &&
+            view.getDynamicResolutionOptions().temporalUpscaling;
+    const float2 postProcessScale = taaUpscaling ? float2(1.0f) : scale;
+    const bool postProcessScaled = scaled && !taaUpscaling;
     if (taaOptions.enabled) {
-        input = ppm.taa(fg, input, view.getFrameHistory(), taaOptions, colorGradingConfig);
+        input = ppm.taa(fg, input, view.getFrameHistory(), taaOptions, colorGradingConfig,
+                taaUpscaling ? uint2{ vp.width, vp.height } : uint2{});
     }
 
     // --------------------------------------------------------------------------------------------
@@ -466,7 +634,8 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
 
     if (hasPostProcess) {
         if (dofOptions.enabled) {
-            input = ppm.dof(fg, input, dofOptions, needsAlphaChannel, cameraInfo, scale);
+            input = ppm.dof(fg, input, dofOptions, needsAlphaChannel, cameraInfo, postProcessScale,
+                    view.getVisibleNearDistance());
         }
         if (colorGrading) {
             if (!colorGradingConfig.asSubpass) {
@@ -475,14 +644,18 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
                         colorGradingConfig.ldrFormat,
                         colorGradingConfig.translucent,
                         colorGradingConfig.fxaa,
-                        scale, bloomOptions, vignetteOptions,
+                        postProcessScale, bloomOptions, vignetteOptions,
                         colorGradingConfig.dithering);
             }
         }
+        // FXAA can do the simple upscaling itself, which saves a full-screen pass
+        const bool fxaaScaling = fxaa && postProcessScaled &&
+                !blending && upscalingQuality == View::QualityLevel::LOW;
         if (fxaa) {
-            input = ppm.fxaa(fg, input, colorGradingConfig.ldrFormat, !colorGrading || needsAlphaChannel);
+            input = ppm.fxaa(fg, input, colorGradingConfig.ldrFormat, !colorGrading || needsAlphaChannel,
+                    fxaaScaling ? uint2{ vp.width, vp.height } : uint2{});
         }
-        if (scaled) {
+        if (postProcessScaled && !fxaaScaling) {
             if (UTILS_LIKELY(!blending && upscalingQuality == View::QualityLevel::LOW)) {
                 input = ppm.opaqueBlit(fg, input, { .format = colorGradingConfig.ldrFormat });
             } else {
@@ -526,7 +699,19 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
 
     //fg.export_graphviz(slog.d, view.getName());
 
-    fg.execute(driver);
+    if (mFrameInfoManager.isPassTimingsEnabled()) {
+        fg.execute(driver, [this](const char* name) { mFrameInfoManager.beginPass(name); });
+        mFrameInfoManager.endPasses();
+    } else {
+        fg.execute(driver);
+    }
+
+    mFrameInfoManager.addCpuTimings(view.getCullingTime(), froxelizationTime,
+            commandGenerationTime);
+    if (UTILS_UNLIKELY(countersEnabled)) {
+        mFrameInfoManager.addCpuCounters(view.getCullingCounters(), froxelizationCounters,
+                commandGenerationCounters);
+    }
 
     // save the current history entry and destroy the oldest entry
     view.commitFrameHistory(engine);
@@ -577,9 +762,13 @@ FrameGraphId<FrameGraphTexture> FRenderer::refractionPass(FrameGraph& fg,
 
         // vvv the actual refraction pass starts below vvv
 
+        // The mip chain starts at half resolution, which divides the cost of the copy and of the
+        // blur passes by four. Only the refractions of the smoothest surfaces lose some detail.
+        constexpr float baseScale = 0.5f;
+
         // scale factor for the gaussian so it matches our resolution / FOV
         const float verticalFieldOfView = view.getCameraUser().getFieldOfView(Camera::Fov::VERTICAL);
-        const float s = verticalFieldOfView / desc.height;
+        const float s = verticalFieldOfView / (float(desc.height) * baseScale);
 
         // The kernel-size was determined empirically so that we don't get too many artifacts
         // due to the down-sampling with a box filter (which happens implicitly).
@@ -605,8 +794,8 @@ FrameGraphId<FrameGraphTexture> FRenderer::refractionPass(FrameGraph& fg,
         // Number of roughness levels we want.
         // TODO: If we want to limit the number of mip levels, we must reduce the initial
         //       resolution (if we want to keep the same filter, and still match the IBL somewhat).
-        const uint8_t roughnessLodCount =
-                std::min(maxLod, FTexture::maxLevelCount(desc.width, desc.height));
+        const uint8_t roughnessLodCount = std::min(maxLod, FTexture::maxLevelCount(
+                uint32_t(float(desc.width) * baseScale), uint32_t(float(desc.height) * baseScale)));
 
         // First we need to resolve the MSAA buffer if enabled
         input = ppm.resolve(fg, "Resolved Color Buffer", input);
@@ -621,6 +810,8 @@ FrameGraphId<FrameGraphTexture> FRenderer::refractionPass(FrameGraph& fg,
             // we're downscaling more vertically
             h = config.vp.height * config.scale.x;
         }
+        w = std::max(1u, uint32_t(float(w) * baseScale));
+        h = std::max(1u, uint32_t(float(h) * baseScale));
 
         input = ppm.opaqueBlit(fg, input, {
                 .width = w,
@@ -790,6 +981,35 @@ FrameGraphId<FrameGraphTexture> FRenderer::colorPass(FrameGraph& fg, const char*
                 view.commitUniforms(driver);
 
                 out.params.clearColor = data.clearColor;
+                out.params.shadingRate = config.shadingRate;
+
+                if (view.hasEyeCameras()) {
+                    // the commands are recorded once and executed for each eye, in its own
+                    // slice of the viewport. Only the first eye clears the color attachments
+                    // and only the last one can discard the attachments.
+                    const filament::Viewport viewport =
+                            static_cast<filament::Viewport const&>(out.params.viewport);
+                    const TargetBufferFlags discardEnd = out.params.flags.discardEnd;
+                    for (size_t i = 0, c = view.getEyeCount(); i < c; i++) {
+                        out.params.viewport = view.getEyeViewport(viewport, i);
+                        out.params.flags.discardEnd = (i == c - 1) ?
+                                discardEnd : TargetBufferFlags::NONE;
+                        view.prepareCamera(view.getEyeCameraInfo(i));
+                        view.prepareViewport(static_cast<filament::Viewport&>(out.params.viewport));
+                        view.commitUniforms(driver);
+                        driver.beginRenderPass(out.target, out.params);
+                        pass.executeCommands(resources.getPassName());
+                        driver.endRenderPass();
+                        out.params.flags.clear &= ~TargetBufferFlags::COLOR_ALL;
+                        out.params.flags.discardStart &= ~TargetBufferFlags::COLOR_ALL;
+                    }
+                    // the passes that follow use the View's camera
+                    view.prepareCamera(view.getCameraInfo());
+                    view.prepareViewport(viewport);
+                    view.commitUniforms(driver);
+                    driver.flush();
+                    return;
+                }
 
                 if (colorGradingConfig.asSubpass) {
                     out.params.subpassMask = 1;
@@ -876,8 +1096,11 @@ bool FRenderer::beginFrame(FSwapChain* swapChain, uint64_t vsyncSteadyClockTimeN
     const steady_clock::time_point now{ steady_clock::now() };
     const steady_clock::time_point userVsync{ steady_clock::duration(vsyncSteadyClockTimeNano) };
     const time_point<steady_clock> appVsync(vsyncSteadyClockTimeNano ? userVsync : now);
+    mBeginFrameTime = now;
 
     mFrameId++;
+    mCurrentRenderStats = { .frameId = mFrameId };
+    mDamageRegion = {};
 
     { // scope for frame id trace
         char buf[64];
@@ -893,6 +1116,21 @@ bool FRenderer::beginFrame(FSwapChain* swapChain, uint64_t vsyncSteadyClockTimeN
         driver.startCapture();
     }
 
+    // record the uploads other threads have queued since the last frame
+    engine.processUploads(engine.getUploadBudget());
+
+    // destroy the objects queued with destroyDeferred() since the last frame
+    engine.processDestructions(engine.getDestructionBudget());
+
+    // create the materials whose buildAsync() package has been parsed
+    engine.processMaterialBuilds();
+
+    // notify the materials whose compile() has completed
+    engine.processCompilations();
+
+    // let the application react to the GPU memory going over its budget
+    engine.checkMemoryBudget();
+
     // latch the frame time
     std::chrono::duration<double> time(appVsync - mUserEpoch);
     float h = float(time.count());
@@ -938,33 +1176,36 @@ bool FRenderer::beginFrame(FSwapChain* swapChain, uint64_t vsyncSteadyClockTimeN
                 .historySize = mFrameRateOptions.history
         }, mFrameId);
 
-        if (false && vsyncSteadyClockTimeNano) { // work in progress
+        if (vsyncSteadyClockTimeNano && mDisplayInfo.refreshRate > 0.0f) {
             const size_t interval = mFrameRateOptions.interval; // user requested swap-interval;
             const steady_clock::duration refreshPeriod(uint64_t(1e9 / mDisplayInfo.refreshRate));
             const steady_clock::duration presentationDeadline(mDisplayInfo.presentationDeadlineNanos);
             const steady_clock::duration vsyncOffset(mDisplayInfo.vsyncOffsetNanos);
+            const steady_clock::duration framePeriod = interval * refreshPeriod;
 
             // hardware vsync timestamp
             steady_clock::time_point hwVsync = appVsync - vsyncOffset;
 
-            // compute our desired presentation time. We can't pick a desired presentation time
-            // that's too far, or we won't be able to dequeue buffers.
-            steady_clock::time_point desiredPresentationTime = hwVsync + 2 * interval * refreshPeriod;
-
-            // Compute the deadline. This deadline is when the GPU must be finished.
-            // The deadline has 1ms backed in it on Android.
-            UTILS_UNUSED_IN_RELEASE
-            steady_clock::time_point deadline = desiredPresentationTime - presentationDeadline;
-
-            // one important thing is to make sure that the deadline is comfortably later than
-            // when the gpu will finish, otherwise we'll have inconsistent latency/frames.
-
-            // TODO: evaluate if we can make it in time, and if not why.
-            // If the problem is cpu+gpu latency we can try to push the desired presentation time
-            // further away, but this has limits, as only 2 buffers are dequeuable.
-            // If the problem is the gpu is overwhelmed, then we need to
-            //  - see if there is more headroom in dynamic resolution
-            //  - or start skipping frames. Ideally lower the framerate too.
+            // Estimate when the GPU will be done with this frame, from the CPU time of the
+            // previous frame and the last known GPU time. The presentation deadline has to be
+            // met on top of that.
+            const steady_clock::duration gpuFrameTime =
+                    duration_cast<steady_clock::duration>(mFrameInfoManager.getLastFrameTime());
+            const steady_clock::duration done =
+                    (now - hwVsync) + mCpuFrameTime + gpuFrameTime + presentationDeadline;
+
+            // Present on the earliest vsync we can make, which minimizes the latency. We can't
+            // pick a presentation time that's too far, or we won't be able to dequeue buffers,
+            // so this is at most 2 frames away. The latency is only lowered when the estimate
+            // fits comfortably, otherwise it would alternate between 1 and 2 frames, which is
+            // the uneven delivery we're trying to avoid.
+            if (done > framePeriod) {
+                mPresentationLatency = 2;
+            } else if (done < framePeriod * 3 / 4) {
+                mPresentationLatency = 1;
+            }
+            steady_clock::time_point desiredPresentationTime =
+                    hwVsync + mPresentationLatency * framePeriod;
 
             // presentation time is set to the middle of the period we're interested in
             steady_clock::time_point presentationTime = desiredPresentationTime - refreshPeriod / 2;
@@ -992,6 +1233,31 @@ bool FRenderer::beginFrame(FSwapChain* swapChain, uint64_t vsyncSteadyClockTimeN
     return false;
 }
 
+void FRenderer::setDamageRegions(filament::Viewport const* regions, size_t count) {
+    assert_invariant(mSwapChain);
+
+    // we only keep the bounding rectangle, which is what gets redrawn and presented
+    int32_t left = std::numeric_limits<int32_t>::max();
+    int32_t bottom = std::numeric_limits<int32_t>::max();
+    int32_t right = std::numeric_limits<int32_t>::min();
+    int32_t top = std::numeric_limits<int32_t>::min();
+    for (size_t i = 0; i < count; i++) {
+        if (!regions[i].empty()) {
+            left = std::min(left, regions[i].left);
+            bottom = std::min(bottom, regions[i].bottom);
+            right = std::max(right, regions[i].right());
+            top = std::max(top, regions[i].top());
+        }
+    }
+    mDamageRegion = (right > left && top > bottom) ?
+            filament::Viewport{ left, bottom, uint32_t(right - left), uint32_t(top - bottom) } :
+            filament::Viewport{};
+
+    // an empty region resets the one we may have set earlier in this frame
+    FEngine::DriverApi& driver = getEngine().getDriverApi();
+    driver.setDamageRegion(mSwapChain->getHwHandle(), mDamageRegion);
+}
+
 void FRenderer::endFrame() {
     SYSTRACE_CALL();
 
@@ -1012,6 +1278,13 @@ void FRenderer::endFrame() {
     mFrameInfoManager.endFrame();
     mFrameSkipper.endFrame();
 
+    if (mRenderStatsEnabled) {
+        mRenderStats = mCurrentRenderStats;
+    }
+
+    // the CPU time of the frame is used to pace the next one
+    mCpuFrameTime = std::chrono::steady_clock::now() - mBeginFrameTime;
+
     if (mSwapChain) {
         mSwapChain->commit(driver);
         mSwapChain = nullptr;
@@ -1038,11 +1311,51 @@ void FRenderer::endFrame() {
     auto *job = js.runAndRetain(jobs::createJob(js, nullptr, &FEngine::gc, &engine)); // gc all managers
 
     engine.flush();     // flush command stream
+    engine.updateCommandBufferStatistics();
 
     // make sure we're done with the gcs
     js.waitAndRelease(job);
 }
 
+void FRenderer::renderBatch(FSwapChain* swapChain, BatchJob const* jobs, size_t count,
+        BatchOptions const& options) {
+    SYSTRACE_CALL();
+
+    assert_invariant(!mSwapChain);
+
+    const size_t budget = std::max(uint8_t(1), options.inFlightBudget);
+    for (size_t i = 0; i < count; i++) {
+        BatchJob const& job = jobs[i];
+
+        // this is where the GPU throttles us, rather than the FrameSkipper
+        while (mBatchFences.size() >= budget) {
+            FFence::waitAndDestroy(mBatchFences.front(), FFence::Mode::FLUSH);
+            mBatchFences.erase(mBatchFences.begin());
+        }
+
+        FView* const view = upcast(job.view);
+        FRenderTarget* const viewRenderTarget = view->getRenderTarget();
+        if (job.renderTarget) {
+            view->setRenderTarget(upcast(job.renderTarget));
+        }
+
+        // the frame is rendered whether beginFrame() wants to skip it or not
+        beginFrame(swapChain, 0, nullptr, nullptr);
+        render(view);
+        if (job.rendered) {
+            job.rendered(this, job, job.user);
+        }
+        endFrame();
+
+        view->setRenderTarget(viewRenderTarget);
+
+        if (UTILS_HAS_THREADING) {
+            // without threads the commands have already executed, there is nothing to wait for
+            mBatchFences.push_back(mEngine.createFence(FFence::Type::HARD));
+        }
+    }
+}
+
 void FRenderer::readPixels(uint32_t xoffset, uint32_t yoffset, uint32_t width, uint32_t height,
         PixelBufferDescriptor&& buffer) {
     readPixels(mRenderTarget, xoffset, yoffset, width, height, std::move(buffer));
@@ -1154,6 +1467,15 @@ void Renderer::endFrame() {
     upcast(this)->endFrame();
 }
 
+void Renderer::renderBatch(SwapChain* swapChain, BatchJob const* jobs, size_t count,
+        BatchOptions const& options) {
+    upcast(this)->renderBatch(upcast(swapChain), jobs, count, options);
+}
+
+void Renderer::renderBatch(SwapChain* swapChain, BatchJob const* jobs, size_t count) {
+    upcast(this)->renderBatch(upcast(swapChain), jobs, count, BatchOptions{});
+}
+
 double Renderer::getUserTime() const {
     return upcast(this)->getUserTime().count();
 }
@@ -1170,8 +1492,28 @@ void Renderer::setFrameRateOptions(FrameRateOptions const& options) noexcept {
     upcast(this)->setFrameRateOptions(options);
 }
 
+void Renderer::setPassTimingsEnabled(bool enabled) noexcept {
+    upcast(this)->setPassTimingsEnabled(enabled);
+}
+
+Renderer::FrameTimings Renderer::getFrameTimings() const noexcept {
+    return upcast(this)->getFrameTimings();
+}
+
+void Renderer::setRenderStatsEnabled(bool enabled) noexcept {
+    upcast(this)->setRenderStatsEnabled(enabled);
+}
+
+Renderer::RenderStats Renderer::getRenderStats() const noexcept {
+    return upcast(this)->getRenderStats();
+}
+
 void Renderer::setClearOptions(const ClearOptions& options) {
     upcast(this)->setClearOptions(options);
 }
 
+void Renderer::setDamageRegions(filament::Viewport const* regions, size_t count) {
+    upcast(this)->setDamageRegions(regions, count);
+}
+
 } // namespace filament
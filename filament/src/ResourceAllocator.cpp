@@ -20,9 +20,12 @@
 
 #include "details/Texture.h"
 
+#include <utils/algorithm.h>
 #include <utils/Log.h>
 #include <utils/debug.h>
 
+#include <limits>
+
 using namespace utils;
 
 namespace filament {
@@ -136,10 +139,19 @@ backend::TextureHandle ResourceAllocator::createTexture(const char* name,
         auto& textureCache = mTextureCache;
         const TextureKey key{ name, target, levels, format, samples, width, height, depth, usage, swizzle };
         auto it = textureCache.find(key);
+        if (UTILS_UNLIKELY(it == textureCache.end())) {
+            // A transient texture that is no longer in use could have been created with more
+            // usages than needed here, it can still be reused instead of allocating new memory.
+            it = findCompatible(key);
+        }
         if (UTILS_LIKELY(it != textureCache.end())) {
             // we do, move the entry to the in-use list, and remove from the cache
             handle = it->second.handle;
             mCacheSize -= it->second.size;
+            mInUseSize += it->second.size;
+            mHitCount++;
+            // the texture goes back to the cache with the usages it was created with
+            mInUseTextures.emplace(handle, it->first);
             textureCache.erase(it);
         } else {
             // we don't, allocate a new texture and populate the in-use list
@@ -154,8 +166,11 @@ backend::TextureHandle ResourceAllocator::createTexture(const char* name,
                         target, levels, format, samples, width, height, depth, usage,
                         swizzle[0], swizzle[1], swizzle[2], swizzle[3]);
             }
+            mInUseTextures.emplace(handle, key);
+            mInUseSize += key.getSize();
+            mPeakSize = std::max(mPeakSize, mCacheSize + mInUseSize);
+            mMissCount++;
         }
-        mInUseTextures.emplace(handle, key);
     } else {
         handle = mBackend.createTexture(
                 target, levels, format, samples, width, height, depth, usage);
@@ -171,10 +186,11 @@ void ResourceAllocator::destroyTexture(TextureHandle h) noexcept {
 
         // move it to the cache
         const TextureKey key = it->second;
-        uint32_t size = key.getSize();
+        const size_t size = key.getSize();
 
         mTextureCache.emplace(key, TextureCachePayload{ h, mAge, size });
         mCacheSize += size;
+        mInUseSize -= size;
 
         // remove it from the in-use list
         mInUseTextures.erase(it);
@@ -183,6 +199,22 @@ void ResourceAllocator::destroyTexture(TextureHandle h) noexcept {
     }
 }
 
+void ResourceAllocator::setCacheBudget(size_t capacity, size_t maxAge) noexcept {
+    // the new budget is enforced by the next gc()
+    mCacheCapacity = capacity;
+    mCacheMaxAge = std::max(size_t(1), maxAge);
+}
+
+ResourceAllocator::Statistics ResourceAllocator::getStatistics() const noexcept {
+    return {
+            .hitCount = mHitCount,
+            .missCount = mMissCount,
+            .cacheSize = mCacheSize,
+            .inUseSize = mInUseSize,
+            .peakSize = mPeakSize
+    };
+}
+
 void ResourceAllocator::gc() noexcept {
     // this is called regularly -- usually once per frame of each Renderer
 
@@ -198,10 +230,10 @@ void ResourceAllocator::gc() noexcept {
     auto& textureCache = mTextureCache;
     for (auto it = textureCache.begin(); it != textureCache.end();) {
         const size_t ageDiff = age - it->second.age;
-        if (ageDiff >= CACHE_MAX_AGE) {
+        if (ageDiff >= mCacheMaxAge) {
             it = purge(it);
-            if (mCacheSize < CACHE_CAPACITY) {
-                // if we're not at capacity, only purge a single entry per gc, trying to
+            if (mCacheSize <= mCacheCapacity) {
+                // if we're not over capacity, only purge a single entry per gc, trying to
                 // avoid a burst of work.
                 break;
             }
@@ -210,7 +242,7 @@ void ResourceAllocator::gc() noexcept {
         }
     }
 
-    if (UTILS_UNLIKELY(mCacheSize >= CACHE_CAPACITY)) {
+    if (UTILS_UNLIKELY(mCacheSize > mCacheCapacity)) {
         // make a copy of our cache to a vector
         std::vector<std::pair<TextureKey, TextureCachePayload>> cache;
         cache.reserve(textureCache.size());
@@ -223,11 +255,15 @@ void ResourceAllocator::gc() noexcept {
             return lhs.second.age < rhs.second.age;
         });
 
-        // now remove entries until we're at capacity
+        // now remove entries until we're within capacity
         auto curr = cache.begin();
-        while (mCacheSize >= CACHE_CAPACITY) {
-            // by construction this entry must exist
-            purge(textureCache.find(curr->first));
+        while (mCacheSize > mCacheCapacity) {
+            // by construction this entry must exist, we look it up by handle because several
+            // entries can have the same key.
+            TextureHandle const handle = curr->second.handle;
+            purge(std::find_if(textureCache.begin(), textureCache.end(), [handle](auto const& v) {
+                return v.second.handle == handle;
+            }));
             ++curr;
         }
 
@@ -256,6 +292,24 @@ void ResourceAllocator::dump(bool brief) const noexcept {
     }
 }
 
+ResourceAllocator::CacheContainer::iterator ResourceAllocator::findCompatible(
+        TextureKey const& key) noexcept {
+    // pick the compatible texture with the fewest extra usages
+    auto& textureCache = mTextureCache;
+    auto best = textureCache.end();
+    size_t bestExtraUsages = std::numeric_limits<size_t>::max();
+    for (auto it = textureCache.begin(); it != textureCache.end(); ++it) {
+        if (it->first.isCompatibleWith(key)) {
+            const size_t extraUsages = utils::popcount(unsigned(it->first.usage & ~key.usage));
+            if (extraUsages < bestExtraUsages) {
+                bestExtraUsages = extraUsages;
+                best = it;
+            }
+        }
+    }
+    return best;
+}
+
 ResourceAllocator::CacheContainer::iterator ResourceAllocator::purge(
         ResourceAllocator::CacheContainer::iterator const& pos) {
     //slog.d << "purging " << pos->second.handle.getId() << ", age=" << pos->second.age << io::endl;
@@ -88,11 +88,24 @@ public:
 
     void gc() noexcept;
 
-private:
-    // TODO: these should be settings of the engine
-    static constexpr size_t CACHE_CAPACITY = 64u << 20u;   // 64 MiB
-    static constexpr size_t CACHE_MAX_AGE  = 30u;
+    static constexpr size_t DEFAULT_CACHE_CAPACITY = 64u << 20u;   // 64 MiB
+    static constexpr size_t DEFAULT_CACHE_MAX_AGE  = 30u;
+
+    // capacity in bytes of the textures kept for reuse, and number of gc() calls after which
+    // an unused texture is released.
+    void setCacheBudget(size_t capacity, size_t maxAge) noexcept;
+
+    struct Statistics {
+        size_t hitCount = 0;        // textures created from the cache
+        size_t missCount = 0;       // textures allocated from the backend
+        size_t cacheSize = 0;       // bytes of the textures kept for reuse
+        size_t inUseSize = 0;       // bytes of the textures currently in use
+        size_t peakSize = 0;        // highest cacheSize + inUseSize so far
+    };
+
+    Statistics getStatistics() const noexcept;
 
+private:
     struct TextureKey {
         const char* name; // doesn't participate in the hash
         backend::SamplerType target;
@@ -107,6 +120,20 @@ private:
 
         size_t getSize() const noexcept;
 
+        // whether a texture with this key can be used where a texture with the key
+        // \p request is needed, i.e. it's identical except for having more usages.
+        bool isCompatibleWith(const TextureKey& request) const noexcept {
+            return target == request.target &&
+                   levels == request.levels &&
+                   format == request.format &&
+                   samples == request.samples &&
+                   width == request.width &&
+                   height == request.height &&
+                   depth == request.depth &&
+                   (usage & request.usage) == request.usage &&
+                   swizzle == request.swizzle;
+        }
+
         bool operator==(const TextureKey& other) const noexcept {
             return target == other.target &&
                    levels == other.levels &&
@@ -120,27 +147,24 @@ private:
         }
 
         friend size_t hash_value(TextureKey const& k) {
-            size_t seed = 0;
-            utils::hash::combine_fast(seed, k.target);
-            utils::hash::combine_fast(seed, k.levels);
-            utils::hash::combine_fast(seed, k.format);
-            utils::hash::combine_fast(seed, k.samples);
-            utils::hash::combine_fast(seed, k.width);
-            utils::hash::combine_fast(seed, k.height);
-            utils::hash::combine_fast(seed, k.depth);
-            utils::hash::combine_fast(seed, k.usage);
-            utils::hash::combine_fast(seed, k.swizzle[0]);
-            utils::hash::combine_fast(seed, k.swizzle[1]);
-            utils::hash::combine_fast(seed, k.swizzle[2]);
-            utils::hash::combine_fast(seed, k.swizzle[3]);
-            return seed;
+            // the fields are packed into words, so that the padding isn't hashed
+            const uint32_t words[] = {
+                    uint32_t(k.target) | uint32_t(k.levels) << 8u | uint32_t(k.format) << 16u,
+                    uint32_t(k.samples) | uint32_t(k.usage) << 8u,
+                    k.width,
+                    k.height,
+                    k.depth,
+                    uint32_t(k.swizzle[0]) | uint32_t(k.swizzle[1]) << 8u |
+                            uint32_t(k.swizzle[2]) << 16u | uint32_t(k.swizzle[3]) << 24u
+            };
+            return size_t(utils::hash::wyhash<sizeof(words)>(words));
         }
     };
 
     struct TextureCachePayload {
         backend::TextureHandle handle;
         size_t age = 0;
-        uint32_t size = 0;
+        size_t size = 0;
     };
 
     template<typename T>
@@ -188,12 +212,19 @@ private:
     using CacheContainer = AssociativeContainer<TextureKey, TextureCachePayload>;
 
     CacheContainer::iterator purge(CacheContainer::iterator const& pos);
+    CacheContainer::iterator findCompatible(TextureKey const& key) noexcept;
 
     backend::DriverApi& mBackend;
     CacheContainer mTextureCache;
     AssociativeContainer<backend::TextureHandle, TextureKey> mInUseTextures;
     size_t mAge = 0;
-    uint32_t mCacheSize = 0;
+    size_t mCacheSize = 0;
+    size_t mInUseSize = 0;
+    size_t mPeakSize = 0;
+    size_t mHitCount = 0;
+    size_t mMissCount = 0;
+    size_t mCacheCapacity = DEFAULT_CACHE_CAPACITY;
+    size_t mCacheMaxAge = DEFAULT_CACHE_MAX_AGE;
     const bool mEnabled = true;
 };
 
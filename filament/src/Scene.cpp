@@ -25,12 +25,16 @@
 #include "details/IndirectLight.h"
 #include "details/Skybox.h"
 
+#include <math/batch.h>
+
 #include <utils/compiler.h>
 #include <utils/EntityManager.h>
 #include <utils/Range.h>
+#include <utils/Systrace.h>
 #include <utils/Zip2Iterator.h>
 
 #include <algorithm>
+#include <limits>
 
 using namespace filament::math;
 using namespace utils;
@@ -46,9 +50,77 @@ FScene::FScene(FEngine& engine) :
 FScene::~FScene() noexcept = default;
 
 
-void FScene::prepare(const mat4f& worldOriginTransform) {
-    // TODO: can we skip this in most cases? Since we rely on indices staying the same,
-    //       we could only skip, if nothing changed in the RCM.
+void FScene::prepare(const mat4& worldOriginTransform, uint32_t frameId) {
+    FEngine& engine = mEngine;
+    FRenderableManager& rcm = engine.getRenderableManager();
+    FTransformManager& tcm = engine.getTransformManager();
+    FLightManager& lcm = engine.getLightManager();
+
+    // The renderables data persists across frames. As long as the set of renderables can't
+    // have changed, only the rows of renderables whose transform changed need updating.
+    Slice<const FTransformManager::Instance> changes;
+    const bool changesKnown = tcm.getChangedInstances(mTransformChangeCursor, changes);
+
+    // Likewise, the world space data of the lights only needs updating for the lights that
+    // moved, or whose own state changed.
+    Slice<const FLightManager::Instance> lightChanges;
+    const bool lightChangesKnown = lcm.getChangedInstances(mLightChangeCursor, lightChanges);
+
+    // The previous transforms only move forward once per frame, even if several views render
+    // this scene.
+    const bool newFrame = frameId != mFrameId;
+    mFrameId = frameId;
+
+    auto const& wo = worldOriginTransform;
+    auto const& pwo = mWorldOriginTransform;
+    const bool incremental = changesKnown && mRenderableDataValid &&
+            mRenderableGeneration == rcm.getGeneration() &&
+            mLightGeneration == lcm.getGeneration() &&
+            wo[0] == pwo[0] && wo[1] == pwo[1] && wo[2] == pwo[2] && wo[3] == pwo[3];
+
+    if (!incremental || !updateRenderableData(worldOriginTransform, changes, newFrame)) {
+        rebuildRenderableData(worldOriginTransform, newFrame);
+        mRenderableGeneration = rcm.getGeneration();
+        mLightGeneration = lcm.getGeneration();
+        mWorldOriginTransform = worldOriginTransform;
+        mRenderableDataValid = true;
+        mLightWorldDataValid = false;
+        mBvhValid = false;
+    }
+    if (!changesKnown || !lightChangesKnown) {
+        mLightWorldDataValid = false;
+    }
+
+    if (mBvhEnabled) {
+        prepareBvh();
+    }
+
+    prepareLights(worldOriginTransform, changes, lightChanges);
+
+    // Purely for the benefit of MSAN, we can avoid uninitialized reads by zeroing out the
+    // unused scene elements between the end of the array and the rounded-up count.
+    if (UTILS_HAS_SANITIZE_MEMORY) {
+        auto& sceneData = mRenderableData;
+        for (size_t i = sceneData.size(), e = (sceneData.size() + 0xFu) & ~0xFu; i < e; i++) {
+            sceneData.data<LAYERS>()[i] = 0;
+            sceneData.data<VISIBLE_MASK>()[i] = 0;
+            sceneData.data<VISIBILITY_STATE>()[i] = {};
+        }
+    }
+}
+
+mat4f FScene::getWorldTransform(FTransformManager const& tcm, FTransformManager::Instance ti,
+        mat4 const& worldOriginTransform) noexcept {
+    if (UTILS_UNLIKELY(tcm.isAccurateTranslationsEnabled())) {
+        // the world origin cancels out the large translations, so this needs to be done in
+        // double precision before going back to float
+        return mat4f{ worldOriginTransform * tcm.getWorldTransformAccurate(ti) };
+    }
+    return mat4f{ worldOriginTransform } * tcm.getWorldTransform(ti);
+}
+
+void FScene::rebuildRenderableData(const mat4& worldOriginTransform, bool newFrame) {
+    SYSTRACE_CALL();
 
     FEngine& engine = mEngine;
     EntityManager& em = engine.getEntityManager();
@@ -57,10 +129,8 @@ void FScene::prepare(const mat4f& worldOriginTransform) {
     FLightManager& lcm = engine.getLightManager();
     // go through the list of entities, and gather the data of those that are renderables
     auto& sceneData = mRenderableData;
-    auto& lightData = mLightData;
     auto const& entities = mEntities;
 
-
     // NOTE: we can't know in advance how many entities are renderable or lights because the corresponding
     // component can be added after the entity is added to the scene.
 
@@ -70,27 +140,28 @@ void FScene::prepare(const mat4f& worldOriginTransform) {
     // we need 1 extra entry at the end for the summed primitive count
     renderableDataCapacity = renderableDataCapacity + 1;
 
+    // Keep the previous transform of the renderables that were already there, so their motion
+    // vectors survive the rebuild. Renderables new to the scene start without motion.
+    const size_t previousCount = sceneData.size();
+    auto const* const UTILS_RESTRICT previousInstances = sceneData.data<RENDERABLE_INSTANCE>();
+    mat4f const* const UTILS_RESTRICT previousTransforms = newFrame ?
+            sceneData.data<WORLD_TRANSFORM>() : sceneData.data<PREVIOUS_WORLD_TRANSFORM>();
+    mRenderableRows.assign(rcm.getComponentCount() + 1, std::numeric_limits<uint32_t>::max());
+    mPreviousTransforms.resize(previousCount);
+    for (size_t i = 0; i < previousCount; i++) {
+        const size_t index = previousInstances[i].asValue();
+        if (index < mRenderableRows.size()) {
+            mRenderableRows[index] = uint32_t(i);
+        }
+        mPreviousTransforms[i] = previousTransforms[i];
+    }
+
     sceneData.clear();
     if (sceneData.capacity() < renderableDataCapacity) {
         sceneData.setCapacity(renderableDataCapacity);
     }
 
-    // The light data list will always contain at least one entry for the
-    // dominating directional light, even if there are no entities.
-    size_t lightDataCapacity = std::max<size_t>(1, entities.size());
-    // we need the capacity to be multiple of 16 for SIMD loops
-    lightDataCapacity = (lightDataCapacity + 0xFu) & ~0xFu;
-
-    lightData.clear();
-    if (lightData.capacity() < lightDataCapacity) {
-        lightData.setCapacity(lightDataCapacity);
-    }
-    // the first entries are reserved for the directional lights (currently only one)
-    lightData.resize(DIRECTIONAL_LIGHTS_COUNT);
-
-
-    // find the max intensity directional light index in our local array
-    float maxIntensity = 0.0f;
+    mLightEntities.clear();
 
     for (Entity e : entities) {
         if (!em.isAlive(e)) {
@@ -105,59 +176,263 @@ void FScene::prepare(const mat4f& worldOriginTransform) {
             continue;
         }
 
+        if (li) {
+            // lights are processed in prepareLights()
+            mLightEntities.push_back(e);
+        }
+
         // get the world transform
         auto ti = tcm.getInstance(e);
-        const mat4f worldTransform = worldOriginTransform * tcm.getWorldTransform(ti);
-        const bool reversedWindingOrder = det(worldTransform.upperLeft()) < 0;
 
         // don't even draw this object if it doesn't have a transform (which shouldn't happen
         // because one is always created when creating a Renderable component).
         if (ri && ti) {
-            // compute the world AABB so we can perform culling
-            const Box worldAABB = rigidTransform(rcm.getAABB(ri), worldTransform);
+            const mat4f worldTransform = getWorldTransform(tcm, ti, worldOriginTransform);
+            const bool reversedWindingOrder = det(worldTransform.upperLeft()) < 0;
+            const uint32_t row = mRenderableRows[ri.asValue()];
+            const mat4f previousTransform = row < previousCount ?
+                    mPreviousTransforms[row] : worldTransform;
+
+            // the AABB is transformed to world space for the whole array below
+            const Box& aabb = rcm.getAABB(ri);
 
             // we know there is enough space in the array
             sceneData.push_back_unsafe(
                     ri,                       // RENDERABLE_INSTANCE
                     worldTransform,           // WORLD_TRANSFORM
+                    previousTransform,        // PREVIOUS_WORLD_TRANSFORM
+                    getNormalTransform(worldTransform, reversedWindingOrder), // NORMAL_TRANSFORM
                     reversedWindingOrder,     // REVERSED_WINDING_ORDER
                     rcm.getVisibility(ri),    // VISIBILITY_STATE
                     rcm.getBonesUbh(ri),      // BONES_UBH
-                    worldAABB.center,         // WORLD_AABB_CENTER
+                    rcm.getBonesOffset(ri),   // BONES_OFFSET
+                    aabb.center,              // WORLD_AABB_CENTER
                     0,                        // VISIBLE_MASK
                     rcm.getMorphWeights(ri),  // MORPH_WEIGHTS
+                    rcm.getInstanceCount(ri), // INSTANCES
                     rcm.getLayerMask(ri),     // LAYERS
-                    worldAABB.halfExtent,     // WORLD_AABB_EXTENT
+                    aabb.halfExtent,          // WORLD_AABB_EXTENT
                     {},                       // PRIMITIVES
                     0                         // SUMMED_PRIMITIVE_COUNT
             );
         }
+    }
 
-        if (li) {
-            // find the dominant directional light
-            if (UTILS_UNLIKELY(lcm.isDirectionalLight(li))) {
-                // we don't store the directional lights, because we only have a single one
-                if (lcm.getIntensity(li) >= maxIntensity) {
-                    maxIntensity = lcm.getIntensity(li);
-                    float3 d = lcm.getLocalDirection(li);
-                    // using mat3f::getTransformForNormals handles non-uniform scaling
-                    d = normalize(mat3f::getTransformForNormals(worldTransform.upperLeft()) * d);
-                    lightData.elementAt<FScene::POSITION_RADIUS>(0) =
-                            float4{ 0, 0, 0, std::numeric_limits<float>::infinity() };
-                    lightData.elementAt<FScene::DIRECTION>(0)       = d;
-                    lightData.elementAt<FScene::LIGHT_INSTANCE>(0)  = li;
-                }
-            } else {
-                const float4 p = worldTransform * float4{ lcm.getLocalPosition(li), 1 };
-                float3 d = 0;
-                if (!lcm.isPointLight(li) || lcm.isIESLight(li)) {
-                    d = lcm.getLocalDirection(li);
-                    // using mat3f::getTransformForNormals handles non-uniform scaling
-                    d = normalize(mat3f::getTransformForNormals(worldTransform.upperLeft()) * d);
+    // compute the world AABBs so we can perform culling
+    transformBoxes(sceneData.data<WORLD_AABB_CENTER>(), sceneData.data<WORLD_AABB_EXTENT>(),
+            sceneData.data<WORLD_AABB_CENTER>(), sceneData.data<WORLD_AABB_EXTENT>(),
+            sceneData.data<WORLD_TRANSFORM>(), sceneData.size());
+}
+
+bool FScene::updateRenderableData(const mat4& worldOriginTransform,
+        Slice<const FTransformManager::Instance> changes, bool newFrame) noexcept {
+    SYSTRACE_CALL();
+
+    FEngine& engine = mEngine;
+    EntityManager& em = engine.getEntityManager();
+    FRenderableManager& rcm = engine.getRenderableManager();
+    FTransformManager& tcm = engine.getTransformManager();
+    auto& sceneData = mRenderableData;
+    const size_t count = sceneData.size();
+    auto const* const UTILS_RESTRICT instances = sceneData.data<RENDERABLE_INSTANCE>();
+
+    // The state of the renderable components isn't tracked, but it's cheap to refresh since
+    // we already know the instances. The renderables' rows may have been reordered by a View,
+    // which doesn't matter.
+    for (size_t i = 0; i < count; i++) {
+        auto const ri = instances[i];
+        if (UTILS_UNLIKELY(!em.isAlive(rcm.getEntity(ri)))) {
+            // a renderable was destroyed without being removed from the scene
+            return false;
+        }
+        sceneData.elementAt<VISIBILITY_STATE>(i) = rcm.getVisibility(ri);
+        sceneData.elementAt<BONES_UBH>(i)        = rcm.getBonesUbh(ri);
+        sceneData.elementAt<BONES_OFFSET>(i)     = rcm.getBonesOffset(ri);
+        sceneData.elementAt<MORPH_WEIGHTS>(i)    = rcm.getMorphWeights(ri);
+        sceneData.elementAt<INSTANCES>(i)        = rcm.getInstanceCount(ri);
+        sceneData.elementAt<LAYERS>(i)           = rcm.getLayerMask(ri);
+    }
+
+    if (newFrame) {
+        std::copy_n(sceneData.data<WORLD_TRANSFORM>(), count,
+                sceneData.data<PREVIOUS_WORLD_TRANSFORM>());
+    }
+
+    if (changes.empty()) {
+        return true;
+    }
+
+    // map renderable instances to their row. Entries of renderables not in this scene may be
+    // stale, so they're validated against RENDERABLE_INSTANCE below.
+    mRenderableRows.resize(rcm.getComponentCount() + 1);
+    for (size_t i = 0; i < count; i++) {
+        mRenderableRows[instances[i].asValue()] = uint32_t(i);
+    }
+
+    for (FTransformManager::Instance const ti : changes) {
+        auto const ri = rcm.getInstance(tcm.getEntity(ti));
+        if (!ri) {
+            continue;
+        }
+        const uint32_t i = mRenderableRows[ri.asValue()];
+        if (i >= count || instances[i] != ri) {
+            // not part of this scene
+            continue;
+        }
+
+        const mat4f worldTransform = getWorldTransform(tcm, ti, worldOriginTransform);
+        const bool reversedWindingOrder = det(worldTransform.upperLeft()) < 0;
+        const Box worldAABB = rigidTransform(rcm.getAABB(ri), worldTransform);
+        sceneData.elementAt<WORLD_TRANSFORM>(i)        = worldTransform;
+        sceneData.elementAt<NORMAL_TRANSFORM>(i)       =
+                getNormalTransform(worldTransform, reversedWindingOrder);
+        sceneData.elementAt<REVERSED_WINDING_ORDER>(i) = reversedWindingOrder;
+        sceneData.elementAt<WORLD_AABB_CENTER>(i)      = worldAABB.center;
+        sceneData.elementAt<WORLD_AABB_EXTENT>(i)      = worldAABB.halfExtent;
+        if (mBvhValid) {
+            mBvh.update(ri.asValue(), worldAABB.center, worldAABB.halfExtent);
+        }
+    }
+    return true;
+}
+
+void FScene::prepareBvh() {
+    SYSTRACE_CALL();
+
+    FRenderableManager const& rcm = mEngine.getRenderableManager();
+    auto& sceneData = mRenderableData;
+    const size_t count = sceneData.size();
+    auto const* const UTILS_RESTRICT instances = sceneData.data<RENDERABLE_INSTANCE>();
+
+    // The rows are reordered every time a View partitions the renderables, so they're mapped
+    // again for each prepare().
+    mRenderableRows.resize(rcm.getComponentCount() + 1);
+    for (size_t i = 0; i < count; i++) {
+        mRenderableRows[instances[i].asValue()] = uint32_t(i);
+    }
+
+    if (mBvhValid && !mBvh.needsRebuild()) {
+        mBvh.refit();
+        return;
+    }
+
+    std::vector<uint32_t> keys(count);
+    for (size_t i = 0; i < count; i++) {
+        keys[i] = instances[i].asValue();
+    }
+    mBvh.build(keys.data(), sceneData.data<WORLD_AABB_CENTER>(),
+            sceneData.data<WORLD_AABB_EXTENT>(), count);
+    mBvhValid = true;
+}
+
+void FScene::updateLightWorldData(size_t row, const mat4& worldOriginTransform) noexcept {
+    FTransformManager const& tcm = mEngine.getTransformManager();
+    FLightManager const& lcm = mEngine.getLightManager();
+    auto const li = mLightInstances[row];
+    if (UTILS_UNLIKELY(!li)) {
+        return;
+    }
+
+    // get the world transform
+    auto ti = tcm.getInstance(mLightEntities[row]);
+    const mat4f worldTransform = getWorldTransform(tcm, ti, worldOriginTransform);
+
+    if (UTILS_UNLIKELY(lcm.isDirectionalLight(li))) {
+        float3 d = lcm.getLocalDirection(li);
+        // using mat3f::getTransformForNormals handles non-uniform scaling
+        d = normalize(mat3f::getTransformForNormals(worldTransform.upperLeft()) * d);
+        mLightSpheres[row] = float4{ 0, 0, 0, std::numeric_limits<float>::infinity() };
+        mLightDirections[row] = d;
+    } else {
+        const float4 p = worldTransform * float4{ lcm.getLocalPosition(li), 1 };
+        float3 d = 0;
+        if (!lcm.isPointLight(li) || lcm.isIESLight(li)) {
+            d = lcm.getLocalDirection(li);
+            // using mat3f::getTransformForNormals handles non-uniform scaling
+            d = normalize(mat3f::getTransformForNormals(worldTransform.upperLeft()) * d);
+        }
+        mLightSpheres[row] = float4{ p.xyz, lcm.getRadius(li) };
+        mLightDirections[row] = d;
+    }
+}
+
+void FScene::prepareLights(const mat4& worldOriginTransform,
+        Slice<const FTransformManager::Instance> transformChanges,
+        Slice<const FLightManager::Instance> lightChanges) {
+    FEngine& engine = mEngine;
+    EntityManager& em = engine.getEntityManager();
+    FTransformManager& tcm = engine.getTransformManager();
+    FLightManager& lcm = engine.getLightManager();
+    auto& lightData = mLightData;
+    const size_t count = mLightEntities.size();
+
+    // The world space positions and directions persist across frames, only the lights whose
+    // transform or light component changed are transformed again.
+    if (!mLightWorldDataValid) {
+        mLightInstances.resize(count);
+        mLightSpheres.resize(count);
+        mLightDirections.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            mLightInstances[i] = lcm.getInstance(mLightEntities[i]);
+            updateLightWorldData(i, worldOriginTransform);
+        }
+        mLightWorldDataValid = true;
+    } else if (!transformChanges.empty() || !lightChanges.empty()) {
+        // map light instances to their row. Entries of lights not in this scene may be
+        // stale, so they're validated against mLightInstances below.
+        mLightRows.resize(lcm.getComponentCount() + 1);
+        for (size_t i = 0; i < count; i++) {
+            mLightRows[mLightInstances[i].asValue()] = uint32_t(i);
+        }
+        auto update = [&](FLightManager::Instance li) {
+            if (li) {
+                const uint32_t i = mLightRows[li.asValue()];
+                if (i < count && mLightInstances[i] == li) {
+                    updateLightWorldData(i, worldOriginTransform);
                 }
-                lightData.push_back_unsafe(
-                        float4{ p.xyz, lcm.getRadius(li) }, d, li, {}, {}, {});
             }
+        };
+        for (FTransformManager::Instance const ti : transformChanges) {
+            update(lcm.getInstance(tcm.getEntity(ti)));
+        }
+        for (FLightManager::Instance const li : lightChanges) {
+            update(li);
+        }
+    }
+
+    // The light data list will always contain at least one entry for the
+    // dominating directional light, even if there are no entities.
+    size_t lightDataCapacity = count + DIRECTIONAL_LIGHTS_COUNT;
+    // we need the capacity to be multiple of 16 for SIMD loops
+    lightDataCapacity = (lightDataCapacity + 0xFu) & ~0xFu;
+
+    lightData.clear();
+    if (lightData.capacity() < lightDataCapacity) {
+        lightData.setCapacity(lightDataCapacity);
+    }
+    // the first entries are reserved for the directional lights (currently only one)
+    lightData.resize(DIRECTIONAL_LIGHTS_COUNT);
+
+    // find the max intensity directional light index in our local array
+    float maxIntensity = 0.0f;
+
+    for (size_t i = 0; i < count; i++) {
+        auto const li = mLightInstances[i];
+        if (!li || !em.isAlive(mLightEntities[i])) {
+            continue;
+        }
+
+        // find the dominant directional light
+        if (UTILS_UNLIKELY(lcm.isDirectionalLight(li))) {
+            // we don't store the directional lights, because we only have a single one
+            if (lcm.getIntensity(li) >= maxIntensity) {
+                maxIntensity = lcm.getIntensity(li);
+                lightData.elementAt<FScene::POSITION_RADIUS>(0) = mLightSpheres[i];
+                lightData.elementAt<FScene::DIRECTION>(0)       = mLightDirections[i];
+                lightData.elementAt<FScene::LIGHT_INSTANCE>(0)  = li;
+            }
+        } else {
+            lightData.push_back_unsafe(mLightSpheres[i], mLightDirections[i], li, {}, {}, {}, 1.0f);
         }
     }
 
@@ -167,16 +442,27 @@ void FScene::prepare(const mat4f& worldOriginTransform) {
     for (size_t i = lightData.size(), e = (lightData.size() + 3u) & ~3u; i < e; i++) {
         new(lightData.data<POSITION_RADIUS>() + i) float4{ 0, 0, 0, 1 };
     }
+}
 
-    // Purely for the benefit of MSAN, we can avoid uninitialized reads by zeroing out the
-    // unused scene elements between the end of the array and the rounded-up count.
-    if (UTILS_HAS_SANITIZE_MEMORY) {
-        for (size_t i = sceneData.size(), e = (sceneData.size() + 0xFu) & ~0xFu; i < e; i++) {
-            sceneData.data<LAYERS>()[i] = 0;
-            sceneData.data<VISIBLE_MASK>()[i] = 0;
-            sceneData.data<VISIBILITY_STATE>()[i] = {};
-        }
-    }
+mat3f FScene::getNormalTransform(mat4f const& model, bool reversedWindingOrder) noexcept {
+    // Using mat3f::getTransformForNormals handles non-uniform scaling, but DOESN'T guarantee that
+    // the transformed normals will have unit-length, therefore they need to be normalized
+    // in the shader (that's already the case anyways, since normalization is needed after
+    // interpolation).
+    //
+    // We pre-scale normals by the inverse of the largest scale factor to avoid
+    // large post-transform magnitudes in the shader, especially in the fragment shader, where
+    // we use medium precision.
+    //
+    // Note: if the model matrix is known to be a rigid-transform, we could just use it directly.
+
+    mat3f m = mat3f::getTransformForNormals(model.upperLeft());
+    m *= mat3f(1.0f / std::sqrt(max(float3{length2(m[0]), length2(m[1]), length2(m[2])})));
+
+    // The shading normal must be flipped for mirror transformations.
+    // Basically we're shading the other side of the polygon and therefore need to negate the
+    // normal, similar to what we already do to support double-sided lighting.
+    return reversedWindingOrder ? -m : m;
 }
 
 void FScene::updateUBOs(utils::Range<uint32_t> visibleRenderables, backend::Handle<backend::HwUniformBuffer> renderableUbh) noexcept {
@@ -186,38 +472,31 @@ void FScene::updateUBOs(utils::Range<uint32_t> visibleRenderables, backend::Hand
     // allocate space into the command stream directly
     void* const buffer = driver.allocate(size);
 
+    FRenderableManager const& rcm = mEngine.getRenderableManager();
     bool hasContactShadows = false;
     auto& sceneData = mRenderableData;
     for (uint32_t i : visibleRenderables) {
+        // each matrix is a cache line, fetch the ones of the following renderables while we copy
+        // these. Prefetching past the end of the arrays is harmless.
+        constexpr uint32_t PREFETCH_DISTANCE = 4;
+        sceneData.prefetch<WORLD_TRANSFORM>(i + PREFETCH_DISTANCE);
+        sceneData.prefetch<PREVIOUS_WORLD_TRANSFORM>(i + PREFETCH_DISTANCE);
+        sceneData.prefetch<NORMAL_TRANSFORM>(i + PREFETCH_DISTANCE);
+
         mat4f const& model = sceneData.elementAt<WORLD_TRANSFORM>(i);
         const size_t offset = i * sizeof(PerRenderableUib);
 
         UniformBuffer::setUniform(buffer,
                 offset + offsetof(PerRenderableUib, worldFromModelMatrix), model);
 
-        // Using mat3f::getTransformForNormals handles non-uniform scaling, but DOESN'T guarantee that
-        // the transformed normals will have unit-length, therefore they need to be normalized
-        // in the shader (that's already the case anyways, since normalization is needed after
-        // interpolation).
-        //
-        // We pre-scale normals by the inverse of the largest scale factor to avoid
-        // large post-transform magnitudes in the shader, especially in the fragment shader, where
-        // we use medium precision.
-        //
-        // Note: if the model matrix is known to be a rigid-transform, we could just use it directly.
-
-        mat3f m = mat3f::getTransformForNormals(model.upperLeft());
-        m *= mat3f(1.0f / std::sqrt(max(float3{length2(m[0]), length2(m[1]), length2(m[2])})));
-
-        // The shading normal must be flipped for mirror transformations.
-        // Basically we're shading the other side of the polygon and therefore need to negate the
-        // normal, similar to what we already do to support double-sided lighting.
-        if (sceneData.elementAt<REVERSED_WINDING_ORDER>(i)) {
-            m = -m;
-        }
+        UniformBuffer::setUniform(buffer,
+                offset + offsetof(PerRenderableUib, previousWorldFromModelMatrix),
+                sceneData.elementAt<PREVIOUS_WORLD_TRANSFORM>(i));
 
+        // the normal matrix is only computed when the transform changes
         UniformBuffer::setUniform(buffer,
-                offset + offsetof(PerRenderableUib, worldFromModelNormalMatrix), m);
+                offset + offsetof(PerRenderableUib, worldFromModelNormalMatrix),
+                sceneData.elementAt<NORMAL_TRANSFORM>(i));
 
         // Note that we cast bool to uint32_t. Booleans are byte-sized in C++, but we need to
         // initialize all 32 bits in the UBO field.
@@ -239,6 +518,11 @@ void FScene::updateUBOs(utils::Range<uint32_t> visibleRenderables, backend::Hand
         UniformBuffer::setUniform(buffer,
                 offset + offsetof(PerRenderableUib, morphWeights),
                 sceneData.elementAt<MORPH_WEIGHTS>(i));
+
+        // read back by View::pick() from the picking variant's output
+        UniformBuffer::setUniform(buffer,
+                offset + offsetof(PerRenderableUib, objectId),
+                uint32_t(Entity::smuggle(rcm.getEntity(sceneData.elementAt<RENDERABLE_INSTANCE>(i)))));
     }
 
     // TODO: handle static objects separately
@@ -302,11 +586,13 @@ void FScene::prepareDynamicLights(const CameraInfo& camera, ArenaScope& rootAren
     auto const* UTILS_RESTRICT directions       = lightData.data<FScene::DIRECTION>();
     auto const* UTILS_RESTRICT instances        = lightData.data<FScene::LIGHT_INSTANCE>();
     auto const* UTILS_RESTRICT shadowInfo       = lightData.data<FScene::SHADOW_INFO>();
+    auto const* UTILS_RESTRICT intensityScales  = lightData.data<FScene::INTENSITY_SCALE>();
     for (size_t i = DIRECTIONAL_LIGHTS_COUNT, c = size; i < c; ++i) {
         const size_t gpuIndex = i - DIRECTIONAL_LIGHTS_COUNT;
         auto li = instances[i];
         lp[gpuIndex].positionFalloff      = { spheres[i].xyz, lcm.getSquaredFalloffInv(li) };
-        lp[gpuIndex].colorIntensity       = { lcm.getColor(li), lcm.getIntensity(li) };
+        lp[gpuIndex].colorIntensity       = { lcm.getColor(li),
+                                              lcm.getIntensity(li) * intensityScales[i] };
         lp[gpuIndex].directionIES         = { directions[i], 0.0f };
         lp[gpuIndex].spotScaleOffset      = lcm.getSpotParams(li).scaleOffset;
         lp[gpuIndex].shadow               = { shadowInfo[i].pack() };
@@ -370,14 +656,17 @@ inline void FScene::computeLightRanges(
 
 void FScene::addEntity(Entity entity) {
     mEntities.insert(entity);
+    mRenderableDataValid = false;
 }
 
 void FScene::addEntities(const Entity* entities, size_t count) {
     mEntities.insert(entities, entities + count);
+    mRenderableDataValid = false;
 }
 
 void FScene::remove(Entity entity) {
     mEntities.erase(entity);
+    mRenderableDataValid = false;
 }
 
 void FScene::removeEntities(const Entity* entities, size_t count) {
@@ -414,6 +703,14 @@ bool FScene::hasEntity(Entity entity) const noexcept {
     return mEntities.find(entity) != mEntities.end();
 }
 
+void FScene::setBoundingVolumeHierarchyEnabled(bool enabled) noexcept {
+    mBvhEnabled = enabled;
+    mBvhValid = false;
+    if (!enabled) {
+        mBvh.clear();
+    }
+}
+
 void FScene::setSkybox(FSkybox* skybox) noexcept {
     std::swap(mSkybox, skybox);
     if (skybox) {
@@ -492,4 +789,12 @@ bool Scene::hasEntity(Entity entity) const noexcept {
     return upcast(this)->hasEntity(entity);
 }
 
+void Scene::setBoundingVolumeHierarchyEnabled(bool enabled) noexcept {
+    upcast(this)->setBoundingVolumeHierarchyEnabled(enabled);
+}
+
+bool Scene::isBoundingVolumeHierarchyEnabled() const noexcept {
+    return upcast(this)->isBoundingVolumeHierarchyEnabled();
+}
+
 } // namespace filament
@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "details/SceneBvh.h"
+
+#include <utils/debug.h>
+#include <utils/JobSystem.h>
+
+#include <math/vec4.h>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+using namespace filament::math;
+using namespace utils;
+
+namespace filament {
+
+namespace {
+
+constexpr uint32_t ALL_PLANES = 0x3Fu;
+
+// the hierarchy is balanced, so this allows for far more items than we can store
+constexpr size_t MAX_DEPTH = 64;
+
+/*
+ * Tests an AABB against the frustum planes selected by 'planeMask', and clears the bits of the
+ * planes it's entirely inside of, which don't need to be tested again for its children.
+ * Returns false if the AABB is entirely outside of one of the planes.
+ */
+inline bool classify(float4 const* UTILS_RESTRICT planes,
+        float3 const& center, float3 const& extent, uint32_t& planeMask) noexcept {
+    for (size_t j = 0; j < 6; j++) {
+        if (planeMask & (1u << j)) {
+            const float d = dot(planes[j].xyz, center) + planes[j].w;
+            const float r = dot(abs(planes[j].xyz), extent);
+            if (d - r > 0.0f) {
+                return false;
+            }
+            if (d + r < 0.0f) {
+                planeMask &= ~(1u << j);
+            }
+        }
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+void SceneBvh::clear() noexcept {
+    mNodes.clear();
+    mKeys.clear();
+    mCenters.clear();
+    mExtents.clear();
+    mLeaves.clear();
+    mSlots.clear();
+    mDirtyLeaves.clear();
+    mUpdateCount = 0;
+}
+
+void SceneBvh::build(uint32_t const* keys,
+        float3 const* center, float3 const* extent, size_t count) {
+    clear();
+    if (!count) {
+        return;
+    }
+
+    std::vector<uint32_t> order(count);
+    std::iota(order.begin(), order.end(), 0u);
+    mNodes.reserve(2 * (count + LEAF_SIZE - 1) / LEAF_SIZE);
+    mLeaves.resize(count);
+    buildNode(order.data(), 0, uint32_t(count), INVALID, center, extent);
+
+    // store the items in the order of the hierarchy, so that each subtree is a range
+    const uint32_t maxKey = *std::max_element(keys, keys + count);
+    mSlots.assign(maxKey + 1, INVALID);
+    mKeys.resize(count);
+    mCenters.resize(count + LEAF_SIZE, float3(0));
+    mExtents.resize(count + LEAF_SIZE, float3(0));
+    for (size_t i = 0; i < count; i++) {
+        const uint32_t item = order[i];
+        mKeys[i] = keys[item];
+        mCenters[i] = center[item];
+        mExtents[i] = extent[item];
+        mSlots[keys[item]] = uint32_t(i);
+    }
+}
+
+uint32_t SceneBvh::buildNode(uint32_t* order, uint32_t first, uint32_t last, uint32_t parent,
+        float3 const* center, float3 const* extent) {
+    const uint32_t index = uint32_t(mNodes.size());
+
+    // bounds of the items, and of their centers to choose the axis to split
+    constexpr float inf = std::numeric_limits<float>::infinity();
+    float3 lo(inf), hi(-inf), centerLo(inf), centerHi(-inf);
+    for (uint32_t i = first; i < last; i++) {
+        float3 const& c = center[order[i]];
+        float3 const& e = extent[order[i]];
+        lo = min(lo, c - e);
+        hi = max(hi, c + e);
+        centerLo = min(centerLo, c);
+        centerHi = max(centerHi, c);
+    }
+    mNodes.push_back({ (lo + hi) * 0.5f, (hi - lo) * 0.5f, first, last - first, 0, parent });
+
+    if (last - first <= LEAF_SIZE) {
+        std::fill(mLeaves.begin() + first, mLeaves.begin() + last, index);
+        return index;
+    }
+
+    // Split at the median along the longest axis, rounded so that the leaves are full.
+    const float3 size = centerHi - centerLo;
+    const size_t axis = size.x >= size.y ? (size.x >= size.z ? 0 : 2) : (size.y >= size.z ? 1 : 2);
+    const uint32_t half = ((last - first) / 2 + LEAF_SIZE - 1) / LEAF_SIZE * LEAF_SIZE;
+    const uint32_t mid = first + half;
+    std::nth_element(order + first, order + mid, order + last,
+            [center, axis](uint32_t a, uint32_t b) {
+                return center[a][axis] < center[b][axis];
+            });
+
+    // the left child immediately follows its parent
+    buildNode(order, first, mid, index, center, extent);
+    const uint32_t right = buildNode(order, mid, last, index, center, extent);
+    mNodes[index].right = right;
+    return index;
+}
+
+void SceneBvh::update(uint32_t key, float3 const& center, float3 const& extent) noexcept {
+    const uint32_t item = key < mSlots.size() ? mSlots[key] : INVALID;
+    if (item == INVALID) {
+        return;
+    }
+    mCenters[item] = center;
+    mExtents[item] = extent;
+    mDirtyLeaves.push_back(mLeaves[item]);
+    mUpdateCount++;
+}
+
+bool SceneBvh::refitNode(uint32_t index) noexcept {
+    Node& node = mNodes[index];
+    constexpr float inf = std::numeric_limits<float>::infinity();
+    float3 lo(inf), hi(-inf);
+    if (!node.right) {
+        for (uint32_t i = node.first, e = node.first + node.count; i < e; i++) {
+            lo = min(lo, mCenters[i] - mExtents[i]);
+            hi = max(hi, mCenters[i] + mExtents[i]);
+        }
+    } else {
+        for (uint32_t child : { index + 1, node.right }) {
+            Node const& n = mNodes[child];
+            lo = min(lo, n.center - n.extent);
+            hi = max(hi, n.center + n.extent);
+        }
+    }
+    const float3 center = (lo + hi) * 0.5f;
+    const float3 extent = (hi - lo) * 0.5f;
+    if (center == node.center && extent == node.extent) {
+        return false;
+    }
+    node.center = center;
+    node.extent = extent;
+    return true;
+}
+
+void SceneBvh::refit() noexcept {
+    if (mDirtyLeaves.empty()) {
+        return;
+    }
+    if (mDirtyLeaves.size() * 8 > mNodes.size()) {
+        // many items moved, refit the whole hierarchy bottom-up
+        for (size_t i = mNodes.size(); i-- > 0;) {
+            refitNode(uint32_t(i));
+        }
+    } else {
+        // Walk up from each leaf, until a node's AABB doesn't change. If another leaf below
+        // that node changed too, its own walk takes care of the ancestors.
+        for (uint32_t leaf : mDirtyLeaves) {
+            for (uint32_t i = leaf; i != INVALID && refitNode(i); i = mNodes[i].parent) {
+            }
+        }
+    }
+    mDirtyLeaves.clear();
+}
+
+void SceneBvh::accept(Node const& node, Culler::result_type* UTILS_RESTRICT results,
+        uint32_t const* UTILS_RESTRICT rows, Culler::result_type value) const noexcept {
+    uint32_t const* UTILS_RESTRICT const keys = mKeys.data();
+    for (uint32_t i = node.first, e = node.first + node.count; i < e; i++) {
+        results[rows[keys[i]]] |= value;
+    }
+}
+
+void SceneBvh::cullSubtree(uint32_t root, uint32_t planeMask,
+        Culler::result_type* results, uint32_t const* rows,
+        Frustum const& frustum, Culler::result_type value) const noexcept {
+    float4 const* const planes = frustum.getNormalizedPlanes();
+
+    struct Entry {
+        uint32_t node;
+        uint32_t planeMask;
+    };
+    Entry stack[MAX_DEPTH];
+    size_t size = 0;
+    stack[size++] = { root, planeMask };
+
+    while (size) {
+        Entry entry = stack[--size];
+        Node const& node = mNodes[entry.node];
+        if (entry.planeMask && !classify(planes, node.center, node.extent, entry.planeMask)) {
+            continue;
+        }
+        if (!entry.planeMask) {
+            // entirely inside the frustum
+            accept(node, results, rows, value);
+            continue;
+        }
+        if (!node.right) {
+            // the AABBs are padded, so a whole leaf can always be tested
+            Culler::result_type visible[LEAF_SIZE] = {};
+            Culler::intersects(visible, frustum,
+                    mCenters.data() + node.first, mExtents.data() + node.first, LEAF_SIZE, 0);
+            for (uint32_t i = 0; i < node.count; i++) {
+                if (visible[i]) {
+                    results[rows[mKeys[node.first + i]]] |= value;
+                }
+            }
+            continue;
+        }
+        assert_invariant(size + 2 <= MAX_DEPTH);
+        stack[size++] = { node.right, entry.planeMask };
+        stack[size++] = { entry.node + 1, entry.planeMask };
+    }
+}
+
+void SceneBvh::cull(JobSystem& js, Culler::result_type* results, uint32_t const* rows,
+        Frustum const& frustum, size_t bit) const noexcept {
+    if (mNodes.empty()) {
+        return;
+    }
+
+    const Culler::result_type value = Culler::result_type(1u << bit);
+    if (mNodes[0].count <= JOB_SIZE) {
+        cullSubtree(0, ALL_PLANES, results, rows, frustum, value);
+        return;
+    }
+
+    // Gather the subtrees small enough to be traversed by a single job, rejecting (or accepting)
+    // the larger ones on the way.
+    struct Task {
+        uint32_t node;
+        uint32_t planeMask;
+    };
+    std::vector<Task> tasks;
+    float4 const* const planes = frustum.getNormalizedPlanes();
+    Task stack[MAX_DEPTH];
+    size_t size = 0;
+    stack[size++] = { 0, ALL_PLANES };
+    while (size) {
+        Task task = stack[--size];
+        Node const& node = mNodes[task.node];
+        if (node.count <= JOB_SIZE) {
+            tasks.push_back(task);
+            continue;
+        }
+        if (!classify(planes, node.center, node.extent, task.planeMask)) {
+            continue;
+        }
+        if (!task.planeMask) {
+            tasks.push_back(task);
+            continue;
+        }
+        assert_invariant(size + 2 <= MAX_DEPTH);
+        stack[size++] = { node.right, task.planeMask };
+        stack[size++] = { task.node + 1, task.planeMask };
+    }
+
+    // The subtrees have disjoint items, and thus write disjoint results.
+    Task const* const data = tasks.data();
+    auto functor = [this, data, results, rows, &frustum, value](uint32_t index, uint32_t c) {
+        for (uint32_t i = index; i < index + c; i++) {
+            cullSubtree(data[i].node, data[i].planeMask, results, rows, frustum, value);
+        }
+    };
+    auto* job = jobs::parallel_for(js, nullptr, 0, uint32_t(tasks.size()),
+            std::ref(functor), jobs::CountSplitter<1, 8>());
+    js.runAndWait(job);
+}
+
+} // namespace filament
@@ -41,6 +41,9 @@ static constexpr bool USE_DEPTH_CLAMP = false;
 
 static constexpr bool ENABLE_LISPSM = true;
 
+// number of pages along each side of a cascade, see ShadowOptions::cascadePaging
+static constexpr size_t CASCADE_PAGE_COUNT = 16;
+
 ShadowMap::ShadowMap(FEngine& engine) noexcept :
         mEngine(engine),
         mClipSpaceFlipped(engine.getBackend() == Backend::VULKAN),
@@ -81,8 +84,9 @@ void ShadowMap::render(DriverApi& driver, FView::Range const& range, RenderPass&
     pass.setCamera(cameraInfo);
     pass.setGeometry(scene.getRenderableData(), range, scene.getRenderableUBO());
 
-    // updatePrimitivesLod must be run before appendCommands.
-    view.updatePrimitivesLod(engine, cameraInfo, scene.getRenderableData(), range);
+    // updatePrimitivesLod must be run before appendCommands. The levels of detail are selected
+    // with the view's camera, so that a renderable casts the shadow of the geometry it renders.
+    view.updatePrimitivesLod(engine, view.getCameraInfo(), scene.getRenderableData(), range);
 
     pass.newCommandBuffer();
     pass.appendCommands(RenderPass::SHADOW);
@@ -131,6 +135,26 @@ void ShadowMap::computeSceneCascadeParams(const FScene::LightSoa& lightData, siz
     );
 }
 
+void ShadowMap::initDebugHints(FEngine& engine, FLightManager::ShadowParams const& params,
+        filament::CameraInfo const& camera) noexcept {
+    // the debug properties are initialized from the first shadow map's hints, then they
+    // override the hints of all the shadow maps
+    const float dz = camera.zf - camera.zn;
+    float& dzn = engine.debug.shadowmap.dzn;
+    float& dzf = engine.debug.shadowmap.dzf;
+    if (dzn < 0)    dzn = std::max(0.0f, params.options.shadowNearHint - camera.zn) / dz;
+    if (dzf > 0)    dzf =-std::max(0.0f, camera.zf - params.options.shadowFarHint) / dz;
+}
+
+Frustum ShadowMap::getCullingFrustum() const noexcept {
+    return FCamera::getFrustum(mCamera->getCullingProjectionMatrix(),
+            FCamera::getViewMatrix(mCameraModel));
+}
+
+void ShadowMap::commitCamera() noexcept {
+    mCamera->setModelMatrix(mCameraModel);
+}
+
 void ShadowMap::update(const FScene::LightSoa& lightData, size_t index, FScene const* scene,
         filament::CameraInfo const& camera, uint8_t visibleLayers, ShadowMapLayout layout,
         const CascadeParameters& cascadeParams) noexcept {
@@ -172,14 +196,12 @@ void ShadowMap::update(const FScene::LightSoa& lightData, size_t index, FScene c
             .frustum = Frustum(projection * camera.view)
     };
 
-    // debugging...
+    // debugging... (see initDebugHints(), we only read the debug properties here)
     const float dz = cameraInfo.zf - cameraInfo.zn;
-    float& dzn = mEngine.debug.shadowmap.dzn;
-    float& dzf = mEngine.debug.shadowmap.dzf;
-    if (dzn < 0)    dzn = std::max(0.0f, params.options.shadowNearHint - camera.zn) / dz;
-    else            params.options.shadowNearHint = dzn * dz - camera.zn;
-    if (dzf > 0)    dzf =-std::max(0.0f, camera.zf - params.options.shadowFarHint) / dz;
-    else            params.options.shadowFarHint = dzf * dz + camera.zf;
+    const float dzn = mEngine.debug.shadowmap.dzn;
+    const float dzf = mEngine.debug.shadowmap.dzf;
+    if (dzn >= 0)   params.options.shadowNearHint = dzn * dz - camera.zn;
+    if (dzf <= 0)   params.options.shadowFarHint = dzf * dz + camera.zf;
     using Type = FLightManager::Type;
     switch (lcm.getType(li)) {
         case Type::SUN:
@@ -212,9 +234,12 @@ void ShadowMap::computeShadowCameraDirectional(
      *
      * The directional light position is chosen inside computeSceneCascadeParams.
      */
-    const float3 lightPosition = cascadeParams.wsLightPosition;
-    const mat4f M = mat4f::lookAt(lightPosition, lightPosition + dir, float3{ 0, 1, 0 });
-    const mat4f Mv = FCamera::rigidTransformInverse(M);
+    float3 lightPosition = cascadeParams.wsLightPosition;
+    mat4f M = mat4f::lookAt(lightPosition, lightPosition + dir, float3{ 0, 1, 0 });
+    mat4f Mv = FCamera::rigidTransformInverse(M);
+
+    // light-space near/far planes of the scene, relative to lightPosition
+    float2 lsNearFar = cascadeParams.lsNearFar;
 
     const Aabb& wsShadowCastersVolume = cascadeParams.wsShadowCastersVolume;
     const Aabb& wsShadowReceiversVolume = cascadeParams.wsShadowReceiversVolume;
@@ -235,6 +260,42 @@ void ShadowMap::computeShadowCameraDirectional(
     size_t vertexCount = intersectFrustumWithBox(mWsClippedShadowReceiverVolume,
             wsViewFrustumVertices, wsShadowReceiversVolume);
 
+    // With paging, the light frustum only moves by whole pages, so that its transform stays
+    // exactly the same for as long as the camera stays within a page.
+    const bool paged = params.options.stable && params.options.cascadePaging;
+    float pageSize = 0.0f;
+    float pagedRadius = 0.0f;
+    if (paged) {
+        // same volume as the stable mode below: the smaller of the view volume and the receivers
+        const float4 receiversSphere = computeBoundingSphere(
+                wsShadowReceiversVolume.getCorners().data(), 8);
+        const float4 viewSphere = computeBoundingSphere(wsViewFrustumVertices, 8);
+        const float4 sphere = receiversSphere.w < viewSphere.w ? receiversSphere : viewSphere;
+        if (UTILS_UNLIKELY(!(sphere.w > 0.0f))) {
+            mHasVisibleShadows = false;
+            return;
+        }
+
+        // quantize the radius, so it doesn't change with the camera's orientation
+        const float q = std::exp2(std::floor(std::log2(sphere.w))) / 16.0f;
+        const float radius = std::ceil(sphere.w / q) * q;
+        pageSize = 2.0f * radius / float(CASCADE_PAGE_COUNT);
+
+        // snap the center of the volume to the page grid, which is fixed in light-space
+        const mat4f R = mat4f::lookAt(float3{}, dir, float3{ 0, 1, 0 });
+        const float3 lsCenter = mat4f::project(FCamera::rigidTransformInverse(R), sphere.xyz);
+        const float3 lsSnapped = floor(lsCenter / pageSize + 0.5f) * pageSize;
+        const float3 wsSnapped = mat4f::project(R, lsSnapped);
+
+        M = mat4f::lookAt(wsSnapped, wsSnapped + dir, float3{ 0, 1, 0 });
+        Mv = FCamera::rigidTransformInverse(M);
+        lsNearFar += mat4f::project(Mv, lightPosition).z;
+        lightPosition = wsSnapped;
+
+        // the snapped center is at most half a page away
+        pagedRadius = radius + pageSize;
+    }
+
     /*
      *  compute scene zmax (i.e. Near plane) and zmin (i.e. Far plane) in light space.
      *  (near/far correspond to max/min because the light looks down the -z axis).
@@ -252,7 +313,7 @@ void ShadowMap::computeShadowCameraDirectional(
     Aabb lsLightFrustumBounds;
     if (!USE_DEPTH_CLAMP) {
         // near plane from shadow caster volume
-        lsLightFrustumBounds.max.z = cascadeParams.lsNearFar[0];
+        lsLightFrustumBounds.max.z = lsNearFar[0];
     }
     for (size_t i = 0; i < vertexCount; ++i) {
         // far: figure out farthest shadow receivers
@@ -265,13 +326,18 @@ void ShadowMap::computeShadowCameraDirectional(
     }
     if (mEngine.debug.shadowmap.far_uses_shadowcasters) {
         // far: closest of the farthest shadow casters and receivers
-        lsLightFrustumBounds.min.z = std::max(lsLightFrustumBounds.min.z, cascadeParams.lsNearFar[1]);
+        lsLightFrustumBounds.min.z = std::max(lsLightFrustumBounds.min.z, lsNearFar[1]);
     }
 
     // near / far planes are specified relative to the direction the eye is looking at
     // i.e. the -z axis (see: ortho)
-    const float znear = -lsLightFrustumBounds.max.z;
-    const float zfar = -lsLightFrustumBounds.min.z;
+    float znear = -lsLightFrustumBounds.max.z;
+    float zfar = -lsLightFrustumBounds.min.z;
+    if (paged) {
+        // the receivers move with the camera, keep the depth range on the page grid as well
+        znear = std::floor(znear / pageSize) * pageSize;
+        zfar = std::ceil(zfar / pageSize) * pageSize;
+    }
 
     // if znear >= zfar, it means we don't have any shadow caster in front of a shadow receiver
     if (UTILS_UNLIKELY(znear >= zfar)) {
@@ -280,7 +346,7 @@ void ShadowMap::computeShadowCameraDirectional(
     }
 
     float4 viewVolumeBoundingSphere = {};
-    if (params.options.stable) {
+    if (params.options.stable && !paged) {
         // In stable mode, the light frustum size must be fixed, so we can choose either the
         // whole view frustum, or the whole scene bounding volume. We simply pick whichever is
         // is smaller.
@@ -360,7 +426,11 @@ void ShadowMap::computeShadowCameraDirectional(
         //   In LiPSM mode, we're using the warped space here.
 
         Aabb bounds;
-        if (params.options.stable && viewVolumeBoundingSphere.w > 0) {
+        if (paged) {
+            // the light is at the center of the paged volume
+            bounds.min.xy = -pagedRadius;
+            bounds.max.xy =  pagedRadius;
+        } else if (params.options.stable && viewVolumeBoundingSphere.w > 0) {
             bounds = compute2DBounds(Mv, viewVolumeBoundingSphere);
         } else {
             bounds = compute2DBounds(WLMpMv, mWsClippedShadowReceiverVolume.data(), vertexCount);
@@ -394,7 +464,7 @@ void ShadowMap::computeShadowCameraDirectional(
         float2 s = 2.0f / float2(lsLightFrustumBounds.max.xy - lsLightFrustumBounds.min.xy);
         float2 o =   -s * float2(lsLightFrustumBounds.max.xy + lsLightFrustumBounds.min.xy) * 0.5f;
 
-        if (params.options.stable) {
+        if (params.options.stable && !paged) {
             // Use the world origin as reference point, fixed w.r.t. the camera
             snapLightFrustum(s, o, Mv, camera.worldOrigin[3].xyz, 1.0f / mShadowMapLayout.shadowDimension);
         }
@@ -443,7 +513,7 @@ void ShadowMap::computeShadowCameraDirectional(
         // mLightSpace is used in the shader to access the shadow map texture, and has the model
         // matrix baked in.
 
-        mCamera->setModelMatrix(FCamera::rigidTransformInverse(b) * M);
+        mCameraModel = FCamera::rigidTransformInverse(b) * M;
         mCamera->setCustomProjection(mat4(F * W * L * Mp), znear, zfar);
 
         // for the debug camera, we need to undo the world origin
@@ -493,7 +563,7 @@ void ShadowMap::computeShadowCameraSpot(math::float3 const& position, math::floa
     // mLightSpace is used in the shader to access the shadow map texture, and has the model matrix
     // baked in.
 
-    mCamera->setModelMatrix(FCamera::rigidTransformInverse(b) * M);
+    mCameraModel = FCamera::rigidTransformInverse(b) * M;
     mCamera->setCustomProjection(mat4(Mp), nearPlane, farPlane);
 
     // for the debug camera, we need to undo the world origin
@@ -14,16 +14,19 @@
  * limitations under the License.
  */
 
+#include "details/RenderPrimitive.h"
 #include "details/ShadowMap.h"
 #include "details/ShadowMapManager.h"
 #include "details/Texture.h"
 #include "details/View.h"
 
 #include "RenderPass.h"
+#include "ResourceAllocator.h"
 
 #include <private/filament/SibGenerator.h>
 
 #include <utils/debug.h>
+#include <utils/JobSystem.h>
 
 namespace filament {
 
@@ -46,13 +49,44 @@ ShadowMapManager::ShadowMapManager(FEngine& engine) {
 
 ShadowMapManager::~ShadowMapManager() = default;
 
+void ShadowMapManager::terminate(FEngine& engine) noexcept {
+    mShadowTexture.destroy(engine.getResourceAllocator());
+}
+
 ShadowMapManager::ShadowTechnique ShadowMapManager::update(
         FEngine& engine, FView& view, UniformBuffer& perViewUb,
         UniformBuffer& shadowUb, FScene::RenderableSoa& renderableData,
         FScene::LightSoa& lightData) noexcept {
     calculateTextureRequirements(engine, view, lightData);
+
+    // The debug pattern overwrites the first layer every frame, so it can't be retained.
+    mShadowMapCaching = view.isShadowMapCachingEnabled() &&
+            !(engine.debug.shadowmap.checkerboard && !view.hasVsm());
+
+    // The retained shadow texture is only usable if it has the layout needed for this frame.
+    const FrameGraphTexture::Descriptor desc = getShadowTextureDescriptor(view);
+    const FrameGraphTexture::Descriptor& cachedDesc = mShadowTextureDesc;
+    if (!mShadowMapCaching || desc.width != cachedDesc.width || desc.height != cachedDesc.height ||
+            desc.depth != cachedDesc.depth || desc.levels != cachedDesc.levels ||
+            desc.format != cachedDesc.format) {
+        mShadowTexture.destroy(engine.getResourceAllocator());
+        mCachedShadowMaps = {};
+    }
+
+    // The debug properties are initialized from the first shadow map before the shadow maps
+    // are updated in parallel.
+    if (!mCascadeShadowMaps.empty() || !mSpotShadowMaps.empty()) {
+        const size_t l = mCascadeShadowMaps.empty() ? mSpotShadowMaps[0].getLightIndex() : 0;
+        ShadowMap::initDebugHints(engine, engine.getLightManager().getShadowParams(
+                lightData.elementAt<FScene::LIGHT_INSTANCE>(l)), view.getCameraInfo());
+    }
+
+    CascadeSetup cascadeSetup;
+    prepareCascadeShadowMaps(engine, view, perViewUb, renderableData, lightData, cascadeSetup);
+    updateShadowMaps(engine, view, lightData, cascadeSetup);
+
     ShadowTechnique shadowTechnique = {};
-    shadowTechnique |= updateCascadeShadowMaps(engine, view, perViewUb, renderableData, lightData);
+    shadowTechnique |= updateCascadeShadowMaps(engine, view, perViewUb, lightData);
     shadowTechnique |= updateSpotShadowMaps(engine, view, shadowUb, renderableData, lightData);
     return shadowTechnique;
 }
@@ -77,8 +111,6 @@ void ShadowMapManager::addSpotShadowMap(size_t lightIndex) noexcept {
 
 void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
         backend::DriverApi& driver, RenderPass& pass) noexcept {
-    constexpr size_t MAX_SHADOW_LAYERS =
-        CONFIG_MAX_SHADOW_CASCADES + CONFIG_MAX_SHADOW_CASTING_SPOTS;
     struct ShadowPassData {
         FrameGraphId<FrameGraphTexture> shadows;
         FrameGraphId<FrameGraphTexture> tempDepth;
@@ -88,10 +120,37 @@ void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
     using ShadowPass = std::pair<const ShadowMapEntry*, RenderPass>;
     std::vector<ShadowPass> passes;
     passes.reserve(MAX_SHADOW_LAYERS);
+    // the sample count of each layer rendered this frame, 0 for the layers that are not
     uint8_t layerSampleCount[MAX_SHADOW_LAYERS] = {};
 
     assert_invariant(mTextureRequirements.layers <= MAX_SHADOW_LAYERS);
 
+    FScene::RenderableSoa const& renderableData = view.getScene()->getRenderableData();
+    FScene::LightSoa const& lightData = view.getScene()->getLightData();
+    const bool hasVsm = view.hasVsm();
+
+    // Returns true if the shadow map retained from the previous frames can be used.
+    auto isCached = [&](ShadowMapEntry const& map, FView::Range range,
+            FScene::VisibleMaskType mask) -> bool {
+        if (!mShadowMapCaching) {
+            return false;
+        }
+        if (map.isStale()) {
+            return true;
+        }
+        ShadowMap const& shadowMap = *map.getShadowMap();
+        uint64_t castersHash = 0;
+        const bool cacheable = hashShadowCasters(renderableData, range, mask, &castersHash);
+        const bool cached = updateCachedShadowMap(map, lightData,
+                hasVsm ? shadowMap.getLightSpaceMatrixVsm() : shadowMap.getLightSpaceMatrix(),
+                castersHash);
+        if (!cacheable) {
+            mCachedShadowMaps[map.getLayout().layer].valid = false;
+            return false;
+        }
+        return cached;
+    };
+
     // These loops fill render passes with appropriate rendering commands for each shadow map.
     // The actual render pass execution is deferred to the frame graph.
     for (const auto& map : mCascadeShadowMaps) {
@@ -99,6 +158,11 @@ void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
             continue;
         }
 
+        if (isCached(map, view.getVisibleDirectionalShadowCasters(),
+                VISIBLE_DIR_SHADOW_RENDERABLE)) {
+            continue;
+        }
+
         map.getShadowMap()->render(driver, view.getVisibleDirectionalShadowCasters(), pass, view);
 
         assert_invariant(map.getLayout().layer < mTextureRequirements.layers);
@@ -114,6 +178,11 @@ void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
             continue;
         }
 
+        if (isCached(map, view.getVisibleSpotShadowCasters(),
+                VISIBLE_SPOT_SHADOW_RENDERABLE_N(i))) {
+            continue;
+        }
+
         pass.setVisibilityMask(VISIBLE_SPOT_SHADOW_RENDERABLE_N(i));
         map.getShadowMap()->render(driver, view.getVisibleSpotShadowCasters(), pass, view);
         pass.clearVisibilityMask();
@@ -126,26 +195,27 @@ void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
         layerSampleCount[layer] = map.getLayout().vsmSamples;
     }
     assert_invariant(passes.size() <= mTextureRequirements.layers);
+    mRenderedShadowMapCount = passes.size();
 
     const bool fillWithCheckerboard = engine.debug.shadowmap.checkerboard && !view.hasVsm();
 
+    // With caching, the shadow texture is kept from one frame to the next, so that the layers
+    // that are still valid don't need to be rendered again.
+    FrameGraphId<FrameGraphTexture> cachedShadows;
+    if (mShadowMapCaching && mShadowTexture.handle) {
+        cachedShadows = fg.import("Shadow Texture", mShadowTextureDesc, mShadowTextureUsage,
+                mShadowTexture);
+    }
+
     auto& shadowPass = fg.addPass<ShadowPassData>("Shadow Pass",
             [&](FrameGraph::Builder& builder, auto& data) {
-                FrameGraphTexture::Descriptor shadowTextureDesc {
-                    .width = mTextureRequirements.size, .height = mTextureRequirements.size,
-                    .depth = mTextureRequirements.layers,
-                    .levels = mTextureRequirements.levels,
-                    .type = SamplerType::SAMPLER_2D_ARRAY,
-                    .format = mTextureFormat
-                };
-
-                if (view.hasVsm()) {
-                    // TODO: support 16-bit VSM depth textures.
-                    shadowTextureDesc.format = TextureFormat::RG32F;
+                if (cachedShadows) {
+                    data.shadows = cachedShadows;
+                } else {
+                    data.shadows = builder.createTexture("Shadow Texture",
+                            getShadowTextureDescriptor(view));
                 }
 
-                data.shadows = builder.createTexture("Shadow Texture", shadowTextureDesc);
-
                 if (view.hasVsm()) {
                     // When rendering VSM shadow maps, we still need a depth texture for correct
                     // sorting. The texture is cleared before each pass and discarded afterwards.
@@ -187,6 +257,11 @@ void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
             },
             [=, passes = std::move(passes), &view, &engine](FrameGraphResources const& resources,
                     auto const& data, DriverApi& driver) mutable {
+                if (mShadowMapCaching && !cachedShadows) {
+                    // keep the shadow texture for the next frames
+                    resources.detach(data.shadows, &mShadowTexture, &mShadowTextureDesc);
+                    mShadowTextureUsage = resources.getUsage(data.shadows);
+                }
                 for (auto& [map, pass] : passes) {
                     FCamera const& camera = map->getShadowMap()->getCamera();
                     filament::CameraInfo cameraInfo(camera);
@@ -243,20 +318,123 @@ void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
     }
 
     // If the shadow texture has more than one level, then anisotropy was specified and we should
-    // generate VSM mipmaps.
+    // generate VSM mipmaps. Only the layers rendered this frame need new mipmaps: the layers
+    // retained by the cache kept theirs, and the others aren't sampled.
     if (mTextureRequirements.levels > 1) {
         auto& ppm = engine.getPostProcessManager();
         for (uint8_t layer = 0; layer < mTextureRequirements.layers; layer++) {
-            for (size_t level = 0; level < mTextureRequirements.levels - 1; level++) {
-                const bool finalize = mTextureRequirements.levels - 2;
-                shadows = ppm.vsmMipmapPass(fg, shadows, layer, level, finalize);
+            if (!layerSampleCount[layer]) {
+                continue;
             }
+            shadows = ppm.vsmMipmapPass(fg, shadows, layer, mTextureRequirements.levels);
         }
     }
 
     fg.getBlackboard().put("shadows", shadows);
 }
 
+FrameGraphTexture::Descriptor ShadowMapManager::getShadowTextureDescriptor(
+        FView const& view) const noexcept {
+    FrameGraphTexture::Descriptor desc {
+        .width = mTextureRequirements.size, .height = mTextureRequirements.size,
+        .depth = mTextureRequirements.layers,
+        .levels = mTextureRequirements.levels,
+        .type = SamplerType::SAMPLER_2D_ARRAY,
+        .format = mTextureFormat
+    };
+    if (view.hasVsm()) {
+        // TODO: support 16-bit VSM depth textures.
+        desc.format = TextureFormat::RG32F;
+    }
+    return desc;
+}
+
+bool ShadowMapManager::updateCachedShadowMap(ShadowMapEntry const& entry,
+        FScene::LightSoa const& lightData, mat4f const& lightFromWorld,
+        uint64_t castersHash) noexcept {
+    const ShadowLayout& layout = entry.getLayout();
+    const FLightManager::Instance light =
+            lightData.elementAt<FScene::LIGHT_INSTANCE>(entry.getLightIndex());
+    const PolygonOffset polygonOffset = entry.getShadowMap()->getPolygonOffset();
+
+    CachedShadowMap& cached = mCachedShadowMaps[layout.layer];
+    const bool unchanged = cached.valid &&
+            cached.light == light &&
+            cached.layout.size == layout.size &&
+            cached.layout.vsmSamples == layout.vsmSamples &&
+            cached.castersHash == castersHash &&
+            cached.polygonOffset.slope == polygonOffset.slope &&
+            cached.polygonOffset.constant == polygonOffset.constant &&
+            cached.lightFromWorld == lightFromWorld;
+    if (!unchanged) {
+        cached = {
+                .lightFromWorld = lightFromWorld,
+                .polygonOffset = polygonOffset,
+                .castersHash = castersHash,
+                .light = light,
+                .layout = layout,
+                .valid = true
+        };
+    }
+    return unchanged;
+}
+
+bool ShadowMapManager::hashShadowCasters(FScene::RenderableSoa const& soa,
+        utils::Range<uint32_t> range, FScene::VisibleMaskType mask, uint64_t* outHash) noexcept {
+    auto mix = [](uint64_t h, uint64_t v) {
+        h = (h ^ v) * 0x100000001b3llu;
+        return h ^ (h >> 29u);
+    };
+
+    auto const* UTILS_RESTRICT instances = soa.data<FScene::RENDERABLE_INSTANCE>();
+    auto const* UTILS_RESTRICT worldTransforms = soa.data<FScene::WORLD_TRANSFORM>();
+    auto const* UTILS_RESTRICT visibility = soa.data<FScene::VISIBILITY_STATE>();
+    auto const* UTILS_RESTRICT bones = soa.data<FScene::BONES_UBH>();
+    auto const* UTILS_RESTRICT morphWeights = soa.data<FScene::MORPH_WEIGHTS>();
+    auto const* UTILS_RESTRICT instanceCounts = soa.data<FScene::INSTANCES>();
+    auto const* UTILS_RESTRICT visibleMask = soa.data<FScene::VISIBLE_MASK>();
+    auto const* UTILS_RESTRICT primitives = soa.data<FScene::PRIMITIVES>();
+
+    // the renderables are reordered from frame to frame, so the hashes of the casters are summed
+    uint64_t sum = 0;
+    for (uint32_t i : range) {
+        if (!(visibleMask[i] & mask)) {
+            continue;
+        }
+        if (visibility[i].skinning) {
+            // we don't know when the bones change
+            return false;
+        }
+        uint64_t h = 0xcbf29ce484222325llu;
+        h = mix(h, instances[i].asValue());
+        float const* const m = &worldTransforms[i][0][0];
+        for (size_t j = 0; j < 16; j += 2) {
+            h = mix(h, uint64_t(reinterpret_cast<uint32_t const&>(m[j])) << 32u |
+                    reinterpret_cast<uint32_t const&>(m[j + 1]));
+        }
+        float4 const& w = morphWeights[i];
+        h = mix(h, uint64_t(reinterpret_cast<uint32_t const&>(w.x)) << 32u |
+                reinterpret_cast<uint32_t const&>(w.y));
+        h = mix(h, uint64_t(reinterpret_cast<uint32_t const&>(w.z)) << 32u |
+                reinterpret_cast<uint32_t const&>(w.w));
+        h = mix(h, uint64_t(reinterpret_cast<uint16_t const&>(visibility[i])) << 32u |
+                uint64_t(instanceCounts[i]) << 16u | bones[i].getId());
+        for (FRenderPrimitive const& primitive : primitives[i]) {
+            FMaterialInstance const* const mi = primitive.getMaterialInstance();
+            h = mix(h, uintptr_t(mi));
+            h = mix(h, uint64_t(primitive.getHwHandle().getId()) << 32u |
+                    uint64_t(primitive.getPrimitiveType()));
+            if (mi) {
+                h = mix(h, uint64_t(mi->getCullingMode()) << 8u |
+                        uint64_t(mi->getDepthWrite()));
+            }
+        }
+        sum += h;
+    }
+    *outHash = mix(sum, range.size());
+    return true;
+}
+
 void ShadowMapManager::prepareShadow(backend::Handle<backend::HwTexture> texture,
         FView const& view) const noexcept {
     uint8_t anisotropy = 0;
@@ -277,10 +455,9 @@ void ShadowMapManager::prepareShadow(backend::Handle<backend::HwTexture> texture
             }});
 }
 
-ShadowMapManager::ShadowTechnique ShadowMapManager::updateCascadeShadowMaps(
-        FEngine& engine, FView& view,
+void ShadowMapManager::prepareCascadeShadowMaps(FEngine& engine, FView& view,
         UniformBuffer& perViewUb, FScene::RenderableSoa& renderableData,
-        FScene::LightSoa& lightData) noexcept {
+        FScene::LightSoa& lightData, CascadeSetup& setup) noexcept {
     FScene* scene = view.getScene();
     const CameraInfo& viewingCameraInfo = view.getCameraInfo();
     uint8_t visibleLayers = view.getVisibleLayers();
@@ -290,7 +467,7 @@ ShadowMapManager::ShadowTechnique ShadowMapManager::updateCascadeShadowMaps(
     FLightManager::Instance directionalLight = lightData.elementAt<FScene::LIGHT_INSTANCE>(0);
     LightManager::ShadowOptions const& options = lcm.getShadowOptions(directionalLight);
 
-    ShadowMap::CascadeParameters cascadeParams;
+    ShadowMap::CascadeParameters& cascadeParams = setup.params;
 
     if (!mCascadeShadowMaps.empty()) {
         // Compute scene-dependent values shared across all cascades.
@@ -309,8 +486,8 @@ ShadowMapManager::ShadowTechnique ShadowMapManager::updateCascadeShadowMaps(
         };
         map.update(lightData, 0, scene, viewingCameraInfo, visibleLayers,
                 layout, cascadeParams);
-        Frustum const& frustum = map.getCamera().getFrustum();
-        FView::cullRenderables(engine.getJobSystem(), renderableData, frustum,
+        Frustum const frustum = map.getCullingFrustum();
+        FView::cullRenderables(engine.getJobSystem(), *scene, frustum,
                 VISIBLE_DIR_SHADOW_RENDERABLE_BIT);
 
         // Set shadowBias, using the first directional cascade.
@@ -365,11 +542,75 @@ ShadowMapManager::ShadowTechnique ShadowMapManager::updateCascadeShadowMaps(
     std::fill_n(&wsSplitPositionUniform[0], 4, -std::numeric_limits<float>::infinity());
     std::copy(splits.beginWs() + 1, splits.endWs(), &wsSplitPositionUniform[0]);
 
-    float csSplitPosition[CONFIG_MAX_SHADOW_CASCADES + 1];
-    std::copy(splits.beginCs(), splits.endCs(), csSplitPosition);
+    std::copy(splits.beginCs(), splits.endCs(), setup.csSplitPosition);
 
     // Update cascade split uniform.
     perViewUb.setUniform(offsetof(PerViewUib, cascadeSplits), wsSplitPositionUniform);
+}
+
+void ShadowMapManager::updateShadowMaps(FEngine& engine, FView& view,
+        FScene::LightSoa const& lightData, CascadeSetup const& setup) noexcept {
+    FScene const* scene = view.getScene();
+    const CameraInfo& viewingCameraInfo = view.getCameraInfo();
+    const uint8_t visibleLayers = view.getVisibleLayers();
+    const uint16_t textureSize = mTextureRequirements.size;
+    const size_t cascadeCount = mCascadeShadowMaps.size();
+
+    // Each map only modifies its own ShadowMap, so they can all be computed in parallel.
+    // Maps [0, cascadeCount) are the cascades, the following ones are the spot lights.
+    auto process = [&](size_t i) {
+        const bool isCascade = i < cascadeCount;
+        auto& entry = isCascade ? mCascadeShadowMaps[i] : mSpotShadowMaps[i - cascadeCount];
+        const size_t textureDimension = entry.getLayout().size;
+        const ShadowMap::ShadowMapLayout layout{
+                .zResolution = mTextureZResolution,
+                .atlasDimension = textureSize,
+                .textureDimension = textureDimension,
+                .shadowDimension = textureDimension - 2
+        };
+        if (isCascade) {
+            ShadowMap::CascadeParameters cascadeParams = setup.params;
+            cascadeParams.csNearFar = { setup.csSplitPosition[i], setup.csSplitPosition[i + 1] };
+            entry.getShadowMap()->update(lightData, 0, scene, viewingCameraInfo, visibleLayers,
+                    layout, cascadeParams);
+        } else {
+            entry.getShadowMap()->update(lightData, entry.getLightIndex(), scene,
+                    viewingCameraInfo, visibleLayers, layout, {});
+        }
+    };
+
+    const size_t count = cascadeCount + mSpotShadowMaps.size();
+    if (count <= 1) {
+        // not worth a job
+        if (count) {
+            process(0);
+        }
+        return;
+    }
+
+    utils::JobSystem& js = engine.getJobSystem();
+    auto* parent = js.createJob();
+    for (size_t i = 0; i < count; i++) {
+        js.run(utils::jobs::createJob(js, parent, std::cref(process), i),
+                utils::JobSystem::DONT_SIGNAL);
+    }
+    js.runAndWait(parent);
+}
+
+ShadowMapManager::ShadowTechnique ShadowMapManager::updateCascadeShadowMaps(
+        FEngine& engine, FView& view, UniformBuffer& perViewUb,
+        FScene::LightSoa& lightData) noexcept {
+    auto& lcm = engine.getLightManager();
+
+    FLightManager::Instance directionalLight = lightData.elementAt<FScene::LIGHT_INSTANCE>(0);
+    LightManager::ShadowOptions const& options = lcm.getShadowOptions(directionalLight);
+
+    const size_t cascadeCount = mCascadeShadowMaps.size();
+
+    // With caching, the first cascade is updated every frame, but the farther ones take
+    // turns: only one of them is updated each frame, the others reuse their previous shadow map.
+    const size_t refreshedCascade = cascadeCount > 1 ?
+            1 + mCascadeRefreshCount++ % (cascadeCount - 1) : 0;
 
     ShadowTechnique shadowTechnique{};
     uint32_t directionalShadowsMask = 0;
@@ -378,25 +619,27 @@ ShadowMapManager::ShadowTechnique ShadowMapManager::updateCascadeShadowMaps(
     for (size_t i = 0; i < mCascadeShadowMaps.size(); i++) {
         auto& entry = mCascadeShadowMaps[i];
 
-        // Compute the frustum for the directional light.
+        // The frustum for the directional light was computed by updateShadowMaps().
         ShadowMap& shadowMap = *entry.getShadowMap();
         UTILS_UNUSED_IN_RELEASE size_t l = entry.getLightIndex();
         assert_invariant(l == 0);
 
-        const size_t textureDimension = entry.getLayout().size;
-        const ShadowMap::ShadowMapLayout layout{
-                .zResolution = mTextureZResolution,
-                .atlasDimension = textureSize,
-                .textureDimension = textureDimension,
-                .shadowDimension = textureDimension - 2
-        };
-        cascadeParams.csNearFar = { csSplitPosition[i], csSplitPosition[i + 1] };
-        shadowMap.update(lightData, 0, scene, viewingCameraInfo, visibleLayers, layout, cascadeParams);
+        shadowMap.commitCamera();
         if (shadowMap.hasVisibleShadows()) {
             entry.setHasVisibleShadows(true);
 
-            mat4f const& lightFromWorldMatrix =
+            mat4f lightFromWorldMatrix =
                 view.hasVsm() ? shadowMap.getLightSpaceMatrixVsm() : shadowMap.getLightSpaceMatrix();
+
+            CachedShadowMap const& cached = mCachedShadowMaps[entry.getLayout().layer];
+            if (mShadowMapCaching && i != 0 && i != refreshedCascade && cached.valid &&
+                    cached.light == directionalLight &&
+                    cached.layout.size == entry.getLayout().size) {
+                // keep using the shadow map rendered in a previous frame, with its light matrix
+                entry.setStale(true);
+                lightFromWorldMatrix = cached.lightFromWorld;
+            }
+
             perViewUb.setUniform(offsetof(PerViewUib, lightFromWorldMatrix) +
                     sizeof(mat4f) * i, lightFromWorldMatrix);
 
@@ -438,10 +681,6 @@ ShadowMapManager::ShadowTechnique ShadowMapManager::updateSpotShadowMaps(
         FScene::RenderableSoa& renderableData, FScene::LightSoa& lightData) noexcept {
 
     ShadowTechnique shadowTechnique{};
-    FScene* scene = view.getScene();
-    const CameraInfo& viewingCameraInfo = view.getCameraInfo();
-    uint8_t visibleLayers = view.getVisibleLayers();
-    const uint16_t textureSize = mTextureRequirements.size;
 
     // shadow-map shadows for point/spot lights
     auto& lcm = engine.getLightManager();
@@ -449,18 +688,10 @@ ShadowMapManager::ShadowTechnique ShadowMapManager::updateSpotShadowMaps(
     for (size_t i = 0, c = mSpotShadowMaps.size(); i < c; i++) {
         auto& entry = mSpotShadowMaps[i];
 
-        // compute the frustum for this light
+        // the frustum for this light was computed by updateShadowMaps()
         ShadowMap& shadowMap = *entry.getShadowMap();
         size_t l = entry.getLightIndex();
-
-        const size_t textureDimension = entry.getLayout().size;
-        const ShadowMap::ShadowMapLayout layout{
-                .zResolution = mTextureZResolution,
-                .atlasDimension = textureSize,
-                .textureDimension = textureDimension,
-                .shadowDimension = textureDimension - 2
-        };
-        shadowMap.update(lightData, l, scene, viewingCameraInfo, visibleLayers, layout, {});
+        shadowMap.commitCamera();
 
         FLightManager::Instance light = lightData.elementAt<FScene::LIGHT_INSTANCE>(l);
         if (shadowMap.hasVisibleShadows()) {
@@ -468,8 +699,8 @@ ShadowMapManager::ShadowTechnique ShadowMapManager::updateSpotShadowMaps(
 
             // Cull shadow casters
             UniformBuffer& u = shadowUb;
-            Frustum const& frustum = shadowMap.getCamera().getFrustum();
-            FView::cullRenderables(engine.getJobSystem(), renderableData, frustum,
+            Frustum const frustum = shadowMap.getCullingFrustum();
+            FView::cullRenderables(engine.getJobSystem(), *view.getScene(), frustum,
                     VISIBLE_SPOT_SHADOW_RENDERABLE_N_BIT(i));
 
             mat4f const& lightFromWorldMatrix =
@@ -556,9 +787,34 @@ void ShadowMapManager::calculateTextureRequirements(FEngine& engine, FView& view
             .vsmSamples = vsmSamples
         });
     }
-    for (auto& spotShadowMap : mSpotShadowMaps) {
+
+    // With a shadow map budget, the spot lights get the resolution they cover on screen.
+    const uint32_t budget = view.getShadowMapBudget();
+    const size_t spotCount = mSpotShadowMaps.size();
+    uint16_t spotDimensions[CONFIG_MAX_SHADOW_CASTING_SPOTS];
+    for (size_t i = 0; i < spotCount; i++) {
+        const size_t lightIndex = mSpotShadowMaps[i].getLightIndex();
+        spotDimensions[i] = getShadowMapSize(lightIndex);
+    }
+    if (budget) {
+        decltype(mAdaptiveSizes) adaptiveSizes{};
+        for (size_t i = 0; i < spotCount; i++) {
+            const size_t lightIndex = mSpotShadowMaps[i].getLightIndex();
+            spotDimensions[i] = getAdaptiveShadowMapSize(view, lightData, lightIndex,
+                    spotDimensions[i]);
+            adaptiveSizes[i] = {
+                    lightData.elementAt<FScene::LIGHT_INSTANCE>(lightIndex), spotDimensions[i] };
+        }
+        mAdaptiveSizes = adaptiveSizes;
+        fitShadowMapBudget(spotDimensions, spotCount, budget);
+    } else {
+        mAdaptiveSizes = {};
+    }
+
+    for (size_t i = 0; i < spotCount; i++) {
+        auto& spotShadowMap = mSpotShadowMaps[i];
         const size_t lightIndex = spotShadowMap.getLightIndex();
-        const uint16_t dim = getShadowMapSize(lightIndex);
+        const uint16_t dim = spotDimensions[i];
         const uint8_t vsmSamples = getShadowMapVsmSamples(lightIndex);
         maxDimension = std::max(maxDimension, dim);
         spotShadowMap.setLayout({
@@ -588,6 +844,57 @@ void ShadowMapManager::calculateTextureRequirements(FEngine& engine, FView& view
     };
 }
 
+uint16_t ShadowMapManager::getAdaptiveShadowMapSize(FView const& view,
+        FScene::LightSoa const& lightData, size_t lightIndex,
+        uint16_t maxDimension) const noexcept {
+    // The receivers are bounded by the sphere of the light's range; we estimate the number of
+    // pixels its diameter covers the same way as the importance of the light in FView.
+    const CameraInfo& camera = view.getCameraInfo();
+    const filament::Viewport& viewport = view.getViewport();
+    const float4 sphere = lightData.elementAt<FScene::POSITION_RADIUS>(lightIndex);
+    float size = sphere.w * camera.projection[1][1];
+    if (camera.projection[2][3] != 0.0f) {
+        size /= std::max(distance(sphere.xyz, camera.getPosition()), camera.zn);
+    }
+    const float pixels = std::min(size * float(viewport.height),
+            float(std::max(viewport.width, viewport.height)));
+
+    uint32_t dim = MIN_ADAPTIVE_SHADOW_MAP_SIZE;
+    while (float(dim) < pixels && dim < maxDimension) {
+        dim *= 2;
+    }
+    dim = std::min(dim, uint32_t(maxDimension));
+
+    // Don't shrink the shadow map as soon as the light covers less than half of it, so that
+    // the size doesn't oscillate between two values (which would also defeat caching).
+    const FLightManager::Instance light = lightData.elementAt<FScene::LIGHT_INSTANCE>(lightIndex);
+    for (AdaptiveShadowMapSize const& previous : mAdaptiveSizes) {
+        if (previous.size && previous.light == light) {
+            if (dim < previous.size && pixels > 0.4f * float(previous.size)) {
+                dim = std::min(previous.size, maxDimension);
+            }
+            break;
+        }
+    }
+    return uint16_t(dim);
+}
+
+void ShadowMapManager::fitShadowMapBudget(uint16_t* sizes, size_t count,
+        uint32_t budget) noexcept {
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += uint64_t(sizes[i]) * sizes[i];
+    }
+    while (total > budget) {
+        uint16_t* largest = std::max_element(sizes, sizes + count);
+        if (largest == sizes + count || *largest / 2 < MIN_ADAPTIVE_SHADOW_MAP_SIZE) {
+            break;
+        }
+        const uint16_t half = *largest / 2;
+        total -= uint64_t(*largest) * *largest - uint64_t(half) * half;
+        *largest = half;
+    }
+}
 
 ShadowMapManager::CascadeSplits::CascadeSplits(Params p) : mSplitCount(p.cascadeCount + 1) {
     for (size_t s = 0; s < mSplitCount; s++) {
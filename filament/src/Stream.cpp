@@ -104,8 +104,9 @@ void FStream::terminate(FEngine& engine) noexcept {
     engine.getDriverApi().destroyStream(mStreamHandle);
 }
 
-void FStream::setAcquiredImage(void* image, Callback callback, void* userdata) noexcept {
-    mEngine.getDriverApi().setAcquiredImage(mStreamHandle, image, callback, userdata);
+void FStream::setAcquiredImage(void* image, int fence, Callback callback,
+        void* userdata) noexcept {
+    mEngine.getDriverApi().setAcquiredImage(mStreamHandle, image, fence, callback, userdata);
 }
 
 void FStream::setDimensions(uint32_t width, uint32_t height) noexcept {
@@ -156,7 +157,11 @@ StreamType Stream::getStreamType() const noexcept {
 }
 
 void Stream::setAcquiredImage(void* image, Callback callback, void* userdata) noexcept {
-    upcast(this)->setAcquiredImage(image, callback, userdata);
+    upcast(this)->setAcquiredImage(image, -1, callback, userdata);
+}
+
+void Stream::setAcquiredImage(void* image, int fence, Callback callback, void* userdata) noexcept {
+    upcast(this)->setAcquiredImage(image, fence, callback, userdata);
 }
 
 void Stream::setDimensions(uint32_t width, uint32_t height) noexcept {
@@ -31,6 +31,9 @@
 #include <utils/Panic.h>
 #include <filament/Texture.h>
 
+#include <algorithm>
+#include <cmath>
+
 using namespace utils;
 
 namespace filament {
@@ -47,6 +50,7 @@ struct Texture::BuilderDetails {
     InternalFormat mFormat = InternalFormat::RGBA8;
     Usage mUsage = Usage::DEFAULT;
     bool mTextureIsSwizzled = false;
+    bool mStreaming = false;
     std::array<Swizzle, 4> mSwizzle = {
            Swizzle::CHANNEL_0, Swizzle::CHANNEL_1,
            Swizzle::CHANNEL_2, Swizzle::CHANNEL_3 };
@@ -108,6 +112,11 @@ Texture::Builder& Texture::Builder::swizzle(Swizzle r, Swizzle g, Swizzle b, Swi
     return *this;
 }
 
+Texture::Builder& Texture::Builder::streaming(bool enable) noexcept {
+    mImpl->mStreaming = enable;
+    return *this;
+}
+
 Texture* Texture::Builder::build(Engine& engine) {
     if (!ASSERT_POSTCONDITION_NON_FATAL(Texture::isTextureFormatSupported(engine, mImpl->mFormat),
             "Texture format %u not supported on this platform", mImpl->mFormat)) {
@@ -141,6 +150,8 @@ FTexture::FTexture(FEngine& engine, const Builder& builder) {
     mTarget = builder->mTarget;
     mDepth  = static_cast<uint32_t>(builder->mDepth);
     mLevelCount = std::min(builder->mLevels, FTexture::maxLevelCount(mWidth, mHeight));
+    mStreaming = builder->mStreaming && mTarget != Sampler::SAMPLER_EXTERNAL;
+    mRequiredLevel = mLevelCount;
 
     FEngine::DriverApi& driver = engine.getDriverApi();
     if (UTILS_LIKELY(builder->mImportedId == 0)) {
@@ -157,14 +168,50 @@ FTexture::FTexture(FEngine& engine, const Builder& builder) {
         mHandle = driver.importTexture(builder->mImportedId,
                 mTarget, mLevelCount, mFormat, mSampleCount, mWidth, mHeight, mDepth, mUsage);
     }
+
+    if (mStreaming) {
+        engine.getStreamedTextures()[mHandle.getId()] = this;
+    }
 }
 
 // frees driver resources, object becomes invalid
 void FTexture::terminate(FEngine& engine) {
+    if (mStreaming) {
+        engine.getStreamedTextures().erase(mHandle.getId());
+    }
     FEngine::DriverApi& driver = engine.getDriverApi();
     driver.destroyTexture(mHandle);
 }
 
+uint8_t FTexture::requiredLevel(uint32_t maxDimension, float pixels, uint8_t levelCount) noexcept {
+    // One texel per pixel is enough. The level is rounded down, so that it's never magnified.
+    // std::max() also replaces a NaN with 1 pixel, and ilogbf(0) is negative.
+    int const level = std::ilogbf(float(maxDimension) / std::max(1.0f, pixels));
+    return uint8_t(std::clamp(level, 0, levelCount - 1));
+}
+
+void FTexture::setMinMaxLevels(FEngine& engine, size_t minLevel, size_t maxLevel) const {
+    ASSERT_PRECONDITION(minLevel <= maxLevel && maxLevel < mLevelCount,
+            "invalid level range [%u, %u] for a texture of %u levels",
+            unsigned(minLevel), unsigned(maxLevel), unsigned(mLevelCount));
+    engine.getDriverApi().setMinMaxLevels(mHandle, uint32_t(minLevel), uint32_t(maxLevel));
+}
+
+void FTexture::commitPages(FEngine& engine, size_t level,
+        uint32_t xoffset, uint32_t yoffset, uint32_t zoffset,
+        uint32_t width, uint32_t height, uint32_t depth, bool commit) const {
+    ASSERT_PRECONDITION(any(mUsage & Texture::Usage::SPARSE),
+            "Texture wasn't created with Usage::SPARSE");
+    ASSERT_PRECONDITION(level < mLevelCount, "level=%u is >= to levelCount=%u",
+            unsigned(level), unsigned(mLevelCount));
+    ASSERT_PRECONDITION(xoffset + width <= valueForLevel(level, mWidth)
+            && yoffset + height <= valueForLevel(level, mHeight),
+            "region (%u, %u, %u, %u) is outside of level %u",
+            xoffset, yoffset, width, height, unsigned(level));
+    engine.getDriverApi().commitTexturePages(mHandle, uint32_t(level),
+            xoffset, yoffset, zoffset, width, height, depth, commit);
+}
+
 size_t FTexture::getWidth(size_t level) const noexcept {
     return valueForLevel(level, mWidth);
 }
@@ -235,8 +282,12 @@ void FTexture::setImage(FEngine& engine,
         return;
     }
 
-    engine.getDriverApi().update2DImage(mHandle,
-            uint8_t(level), xoffset, yoffset, width, height, std::move(buffer));
+    const size_t size = buffer.size;
+    engine.upload(size, [handle = mHandle, level, xoffset, yoffset, width, height,
+            buffer = std::move(buffer)](FEngine::DriverApi& driver) mutable {
+        driver.update2DImage(handle,
+                uint8_t(level), xoffset, yoffset, width, height, std::move(buffer));
+    });
 }
 
 void FTexture::setImage(FEngine& engine,
@@ -306,8 +357,13 @@ void FTexture::setImage(FEngine& engine,
         return;
     }
 
-    engine.getDriverApi().update3DImage(mHandle,
-            uint8_t(level), xoffset, yoffset, zoffset, width, height, depth, std::move(buffer));
+    const size_t size = buffer.size;
+    engine.upload(size, [handle = mHandle, level, xoffset, yoffset, zoffset, width, height, depth,
+            buffer = std::move(buffer)](FEngine::DriverApi& driver) mutable {
+        driver.update3DImage(handle,
+                uint8_t(level), xoffset, yoffset, zoffset, width, height, depth,
+                std::move(buffer));
+    });
 }
 
 void FTexture::setImage(FEngine& engine, size_t level,
@@ -350,8 +406,11 @@ void FTexture::setImage(FEngine& engine, size_t level,
         return;
     }
 
-    engine.getDriverApi().updateCubeImage(mHandle, uint8_t(level),
-            std::move(buffer), faceOffsets);
+    const size_t size = buffer.size;
+    engine.upload(size, [handle = mHandle, level, buffer = std::move(buffer), faceOffsets](
+            FEngine::DriverApi& driver) mutable {
+        driver.updateCubeImage(handle, uint8_t(level), std::move(buffer), faceOffsets);
+    });
 }
 
 void FTexture::setExternalImage(FEngine& engine, void* image) noexcept {
@@ -447,6 +506,11 @@ bool FTexture::isTextureSwizzleSupported(FEngine& engine) noexcept {
     return engine.getDriverApi().isTextureSwizzleSupported();
 }
 
+math::uint3 FTexture::getSparsePageSize(FEngine& engine, Sampler sampler,
+        InternalFormat format) noexcept {
+    return engine.getDriverApi().getSparseTexturePageSize(sampler, format);
+}
+
 size_t FTexture::computeTextureDataSize(Texture::Format format, Texture::Type type,
         size_t stride, size_t height, size_t alignment) noexcept {
     return PixelBufferDescriptor::computeDataSize(format, type, stride, height, alignment);
@@ -509,6 +573,12 @@ void FTexture::generatePrefilterMipmap(FEngine& engine,
     PrefilterOptions defaultOptions;
     options = options ? options : &defaultOptions;
 
+    if (!ASSERT_PRECONDITION_NON_FATAL(options->firstLevel <= ctz(size),
+            "firstLevel (%u) must be less than the number of levels (%u)",
+            options->firstLevel, unsigned(ctz(size) + 1))) {
+        return;
+    }
+
     JobSystem& js = engine.getJobSystem();
     FEngine::DriverApi& driver = engine.getDriverApi();
 
@@ -620,13 +690,18 @@ void FTexture::generatePrefilterMipmap(FEngine& engine,
     // Now generate all the mipmap levels
     generateMipmaps(js, levels, images);
 
-    // Finally generate each pre-filtered mipmap level
+    // Finally generate each pre-filtered mipmap level, or only the requested ones
     const size_t baseExp = ctz(size);
     size_t numSamples = options->sampleCount;
     const size_t numLevels = baseExp + 1;
+    const size_t firstLevel = options->firstLevel;
+    const size_t lastLevel = std::min(numLevels, firstLevel + options->levelCount);
     for (ssize_t i = baseExp; i >= 0; --i) {
         const size_t dim = 1U << i;
         const size_t level = baseExp - i;
+        if (level < firstLevel || level >= lastLevel) {
+            continue;
+        }
         const float lod = saturate(level / (numLevels - 1.0f));
         const float linearRoughness = lod * lod;
 
@@ -1090,6 +1165,25 @@ void Texture::generateMipmaps(Engine& engine) const noexcept {
     upcast(this)->generateMipmaps(upcast(engine));
 }
 
+void Texture::setMinMaxLevels(Engine& engine, size_t minLevel, size_t maxLevel) const {
+    upcast(this)->setMinMaxLevels(upcast(engine), minLevel, maxLevel);
+}
+
+size_t Texture::getRequiredLevel() const noexcept {
+    return upcast(this)->getRequiredLevel();
+}
+
+void Texture::resetRequiredLevel() noexcept {
+    upcast(this)->resetRequiredLevel();
+}
+
+void Texture::commitPages(Engine& engine, size_t level,
+        uint32_t xoffset, uint32_t yoffset, uint32_t zoffset,
+        uint32_t width, uint32_t height, uint32_t depth, bool commit) const {
+    upcast(this)->commitPages(upcast(engine), level,
+            xoffset, yoffset, zoffset, width, height, depth, commit);
+}
+
 bool Texture::isTextureFormatSupported(Engine& engine, InternalFormat format) noexcept {
     return FTexture::isTextureFormatSupported(upcast(engine), format);
 }
@@ -1098,6 +1192,11 @@ bool Texture::isTextureSwizzleSupported(Engine& engine) noexcept {
     return FTexture::isTextureSwizzleSupported(upcast(engine));
 }
 
+math::uint3 Texture::getSparsePageSize(Engine& engine, Sampler sampler,
+        InternalFormat format) noexcept {
+    return FTexture::getSparsePageSize(upcast(engine), sampler, format);
+}
+
 size_t Texture::computeTextureDataSize(Texture::Format format, Texture::Type type, size_t stride,
         size_t height, size_t alignment) noexcept {
     return FTexture::computeTextureDataSize(format, type, stride, height, alignment);
@@ -18,6 +18,7 @@
 #define TNT_FILAMENT_DRIVER_UNIFORMBUFFER_H
 
 #include <algorithm>
+#include <limits>
 
 #include "private/backend/DriverApi.h"
 
@@ -69,7 +70,8 @@ public:
     // invalidate a range of uniforms and return a pointer to it. offset and size given in bytes
     void* invalidateUniforms(size_t offset, size_t size) {
         assert_invariant(offset + size <= mSize);
-        mSomethingDirty = true;
+        mDirtyBegin = std::min(mDirtyBegin, uint32_t(offset));
+        mDirtyEnd = std::max(mDirtyEnd, uint32_t(offset + size));
         return static_cast<char*>(mBuffer) + offset;
     }
 
@@ -84,10 +86,18 @@ public:
     size_t getSize() const noexcept { return mSize; }
 
     // return if any uniform has been changed
-    bool isDirty() const noexcept { return mSomethingDirty; }
+    bool isDirty() const noexcept { return mDirtyBegin < mDirtyEnd; }
 
     // mark the whole buffer as clean (no modified uniforms)
-    void clean() const noexcept { mSomethingDirty = false; }
+    void clean() const noexcept {
+        mDirtyBegin = std::numeric_limits<uint32_t>::max();
+        mDirtyEnd = 0;
+    }
+
+    // smallest range of bytes covering all the uniforms changed since the last clean(), only
+    // valid if isDirty() is true
+    uint32_t getDirtyOffset() const noexcept { return mDirtyBegin; }
+    uint32_t getDirtySize() const noexcept { return mDirtyEnd - mDirtyBegin; }
 
     /*
      * -----------------------------------------------
@@ -206,7 +216,9 @@ private:
     char mStorage[96];
     void *mBuffer = nullptr;
     uint32_t mSize = 0;
-    mutable bool mSomethingDirty = false;
+    // dirty range, empty when mDirtyBegin >= mDirtyEnd
+    mutable uint32_t mDirtyBegin = std::numeric_limits<uint32_t>::max();
+    mutable uint32_t mDirtyEnd = 0;
 };
 
 // specialization for mat3f (which has a different alignment, see std140 layout rules)
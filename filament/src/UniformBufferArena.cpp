@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "UniformBufferArena.h"
+
+#include "private/backend/DriverApi.h"
+
+#include <utils/debug.h>
+
+namespace filament {
+
+using namespace backend;
+
+void UniformBufferArena::init(size_t blockSize) noexcept {
+    assert_invariant(mBuffers.empty());
+    mBlockSize = uint32_t(blockSize);
+    mSlotSize = uint32_t((blockSize + SLOT_ALIGNMENT - 1) & ~(SLOT_ALIGNMENT - 1));
+}
+
+void UniformBufferArena::terminate(DriverApi& driver) noexcept {
+    // all the slots must have been freed by now
+    assert_invariant(mFreeSlots.size() == mBuffers.size() * SLOTS_PER_BUFFER);
+    for (auto& buffer : mBuffers) {
+        driver.destroyUniformBuffer(buffer);
+    }
+    mBuffers.clear();
+    mFreeSlots.clear();
+}
+
+UniformBufferArena::Slot UniformBufferArena::allocate(DriverApi& driver) noexcept {
+    assert_invariant(mBlockSize);
+    if (UTILS_UNLIKELY(mFreeSlots.empty())) {
+        Handle<HwUniformBuffer> buffer = driver.createUniformBuffer(
+                mSlotSize * SLOTS_PER_BUFFER, BufferUsage::DYNAMIC);
+        mBuffers.push_back(buffer);
+        // push the slots backward, so they're handed out in increasing offsets
+        for (size_t i = SLOTS_PER_BUFFER; i-- > 0;) {
+            mFreeSlots.push_back({ buffer, uint32_t(i * mSlotSize) });
+        }
+    }
+    Slot const slot = mFreeSlots.back();
+    mFreeSlots.pop_back();
+    return slot;
+}
+
+void UniformBufferArena::free(Slot slot) noexcept {
+    if (slot.buffer) {
+        mFreeSlots.push_back(slot);
+    }
+}
+
+} // namespace filament
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_UNIFORMBUFFERARENA_H
+#define TNT_FILAMENT_UNIFORMBUFFERARENA_H
+
+#include <backend/Handle.h>
+
+#include "private/backend/DriverApiForward.h"
+
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+
+/*
+ * Packs many small uniform blocks of the same size (e.g. the uniforms of all the instances of a
+ * material) into a few large uniform buffers. Each block gets a slot, which must be bound with
+ * bindUniformBufferRange() and updated with updateUniformBuffer().
+ *
+ * Not thread-safe, this is only used from the engine's main thread.
+ */
+class UniformBufferArena {
+public:
+    // slots are aligned to 256 bytes to be compatible with all versions of GLES
+    static constexpr size_t SLOT_ALIGNMENT = 256;
+
+    // number of slots in each uniform buffer
+    static constexpr size_t SLOTS_PER_BUFFER = 32;
+
+    struct Slot {
+        backend::Handle<backend::HwUniformBuffer> buffer;
+        uint32_t offset = 0;
+    };
+
+    UniformBufferArena() noexcept = default;
+
+    UniformBufferArena(UniformBufferArena const& rhs) = delete;
+    UniformBufferArena& operator=(UniformBufferArena const& rhs) = delete;
+
+    // must be called before the first allocate()
+    void init(size_t blockSize) noexcept;
+
+    void terminate(backend::DriverApi& driver) noexcept;
+
+    Slot allocate(backend::DriverApi& driver) noexcept;
+
+    // the slot can be reused immediately, its previous content is never read again
+    void free(Slot slot) noexcept;
+
+    size_t getBlockSize() const noexcept { return mBlockSize; }
+
+    size_t getBufferCount() const noexcept { return mBuffers.size(); }
+
+private:
+    std::vector<backend::Handle<backend::HwUniformBuffer>> mBuffers;
+    std::vector<Slot> mFreeSlots;
+    uint32_t mBlockSize = 0;
+    uint32_t mSlotSize = 0;
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_UNIFORMBUFFERARENA_H
@@ -201,7 +201,7 @@ FVertexBuffer::FVertexBuffer(FEngine& engine, const VertexBuffer::Builder& build
         for (size_t i = 0; i < MAX_VERTEX_BUFFER_COUNT; ++i) {
             if (bufferSizes[i] > 0) {
                 BufferObjectHandle bo = driver.createBufferObject(bufferSizes[i],
-                        backend::BufferObjectBinding::VERTEX);
+                        backend::BufferObjectBinding::VERTEX, backend::BufferUsage::STATIC);
                 driver.setVertexBufferObject(mHandle, i, bo);
                 mBufferObjects[i] = bo;
             }
@@ -228,8 +228,11 @@ void FVertexBuffer::setBufferAt(FEngine& engine, uint8_t bufferIndex,
     ASSERT_PRECONDITION(!mBufferObjectsEnabled, "Please use setBufferObjectAt()");
     if (bufferIndex < mBufferCount) {
         assert_invariant(mBufferObjects[bufferIndex]);
-        engine.getDriverApi().updateBufferObject(mBufferObjects[bufferIndex],
-               std::move(buffer), byteOffset);
+        const size_t size = buffer.size;
+        engine.upload(size, [handle = mBufferObjects[bufferIndex], buffer = std::move(buffer),
+                byteOffset](FEngine::DriverApi& driver) mutable {
+            driver.updateBufferObject(handle, std::move(buffer), byteOffset);
+        });
     } else {
         ASSERT_PRECONDITION(bufferIndex < mBufferCount, "bufferIndex must be < bufferCount");
     }
@@ -23,10 +23,13 @@
 #include "details/DFG.h"
 #include "details/Froxelizer.h"
 #include "details/IndirectLight.h"
+#include "details/MaterialInstance.h"
+#include "details/RenderPrimitive.h"
 #include "details/Renderer.h"
 #include "details/RenderTarget.h"
 #include "details/Scene.h"
 #include "details/Skybox.h"
+#include "details/Texture.h"
 
 #include <filament/Exposure.h>
 #include <filament/TextureSampler.h>
@@ -43,8 +46,11 @@
 #include <math/scalar.h>
 #include <math/fast.h>
 
+#include <algorithm>
 #include <memory>
 
+#include <string.h>
+
 using namespace utils;
 
 namespace filament {
@@ -67,11 +73,9 @@ FView::FView(FEngine& engine)
     // set-up samplers
     mFroxelizer.getRecordBuffer().setSampler(PerViewSib::RECORDS, mPerViewSb);
     mFroxelizer.getFroxelBuffer().setSampler(PerViewSib::FROXELS, mPerViewSb);
-    if (engine.getDFG()->isValid()) {
-        TextureSampler sampler(TextureSampler::MagFilter::LINEAR);
-        mPerViewSb.setSampler(PerViewSib::IBL_DFG_LUT,
-                engine.getDFG()->getTexture(), sampler.getSamplerParams());
-    }
+    TextureSampler const sampler(TextureSampler::MagFilter::LINEAR);
+    mPerViewSb.setSampler(PerViewSib::IBL_DFG_LUT,
+            engine.getDFG()->getTexture(), sampler.getSamplerParams());
     mPerViewSbh = driver.createSamplerGroup(mPerViewSb.getSize());
 
     // allocate ubos
@@ -91,7 +95,9 @@ FView::FView(FEngine& engine)
 FView::~FView() noexcept = default;
 
 void FView::terminate(FEngine& engine) {
-    // Here we would cleanly free resources we've allocated or we own (currently none).
+    // Here we would cleanly free resources we've allocated or we own.
+    mShadowMapManager.terminate(engine);
+
     DriverApi& driver = engine.getDriverApi();
     driver.destroyUniformBuffer(mPerViewUbh);
     driver.destroyUniformBuffer(mLightUbh);
@@ -130,8 +136,13 @@ void FView::setDynamicResolutionOptions(DynamicResolutionOptions const& options)
     }
 }
 
-void FView::setDynamicLightingOptions(float zLightNear, float zLightFar) noexcept {
-    mFroxelizer.setOptions(zLightNear, zLightFar);
+void FView::setDynamicLightingOptions(float zLightNear, float zLightFar,
+        size_t froxelSliceCount) noexcept {
+    mFroxelizer.setOptions(zLightNear, zLightFar, froxelSliceCount);
+}
+
+void FView::setNonSquareFroxelsEnabled(bool enabled) noexcept {
+    mFroxelizer.setNonSquareFroxels(enabled);
 }
 
 float2 FView::updateScale(FrameInfo const& info) noexcept {
@@ -143,7 +154,26 @@ float2 FView::updateScale(FrameInfo const& info) noexcept {
         }
 
         // scaling factor we need to apply on the whole surface
-        const float scale = info.scale;
+        float scale = info.scale;
+
+        // When this view's own GPU time is known, predict the area that fits in what is left of
+        // the frame budget, assuming its cost is proportional to its area. Using the area it was
+        // measured at compensates for the latency of the timer queries.
+        FrameInfo::ViewTime const* const viewTime = info.getViewTime(this);
+        if (viewTime && viewTime->gpuTime.count() > 0.0f) {
+            mGpuTime = viewTime->gpuTime.count();
+            const float others = (info.frameTime - viewTime->gpuTime).count();
+            const float budget = std::max(0.0f, info.targetFrameTime.count() - others);
+            const float predicted = viewTime->area * budget / mGpuTime;
+
+            // Small corrections are ignored so the resolution is stable under a steady load,
+            // larger ones are applied half-way so the noise of a single frame can't overshoot.
+            constexpr float HYSTERESIS = 0.05f;
+            const float current = mScale.x * mScale.y;
+            scale = std::abs(predicted - current) < HYSTERESIS * current ?
+                    current : current + (predicted - current) * 0.5f;
+        }
+
         const float w = mViewport.width;
         const float h = mViewport.height;
         if (scale < 1.0f && !options.homogeneousScaling) {
@@ -194,6 +224,7 @@ float2 FView::updateScale(FrameInfo const& info) noexcept {
 #endif
     } else {
         mScale = 1.0f;
+        mGpuTime = 0.0f;
     }
 
     return mScale;
@@ -205,7 +236,21 @@ void FView::setVisibleLayers(uint8_t select, uint8_t values) noexcept {
 
 bool FView::isSkyboxVisible() const noexcept {
     FSkybox const* skybox = mScene ? mScene->getSkybox() : nullptr;
-    return skybox != nullptr && (skybox->getLayerMask() & mVisibleLayers);
+    return skybox != nullptr && (skybox->getLayerMask() & mVisibleLayers) && !mSkyboxOccluded;
+}
+
+// The importance of a light is its intensity, weighted by the screen area covered by its sphere
+// of influence. The screen size is the same as in updatePrimitivesLod().
+static float computeLightImportance(FLightManager const& lcm, CameraInfo const& camera,
+        FLightManager::Instance li, float4 const& sphere) noexcept {
+    float size = sphere.w * camera.projection[1][1];
+    if (camera.projection[2][3] != 0.0f) {
+        size /= std::max(distance(sphere.xyz, camera.getPosition()), camera.zn);
+    }
+    // the sphere can't cover more than the whole screen
+    size = std::min(size, 2.0f);
+    const float luminance = dot(lcm.getColor(li), float3{ 0.2126f, 0.7152f, 0.0722f });
+    return lcm.getIntensity(li) * luminance * size * size;
 }
 
 void FView::prepareShadowing(FEngine& engine, backend::DriverApi& driver,
@@ -237,8 +282,13 @@ void FView::prepareShadowing(FEngine& engine, backend::DriverApi& driver,
     size_t shadowCastingSpotCount = 0;
 
     // We allow a max of CONFIG_MAX_SHADOW_CASTING_SPOTS spot light shadows. Any additional
-    // shadow-casting spot lights are ignored.
-    for (size_t l = 1; l < lightData.size(); l++) {
+    // shadow-casting spot lights are ignored. With a light budget, the most important ones
+    // are kept, otherwise the first ones.
+    const bool budget = mLightBudgetOptions.enabled;
+    const size_t maxShadowCastingSpots = budget ?
+            mLightBudgetOptions.maxShadowCastingSpots : CONFIG_MAX_SHADOW_CASTING_SPOTS;
+    std::pair<float, size_t> spots[CONFIG_MAX_SHADOW_CASTING_SPOTS];
+    for (size_t l = 1; l < lightData.size() && maxShadowCastingSpots; l++) {
         FLightManager::Instance light = lightData.elementAt<FScene::LIGHT_INSTANCE>(l);
 
         // Invisible lights get culled and should not count towards the spot limit.
@@ -249,12 +299,29 @@ void FView::prepareShadowing(FEngine& engine, backend::DriverApi& driver,
             continue;
         }
 
-        mShadowMapManager.addSpotShadowMap(l);
+        if (!budget) {
+            spots[shadowCastingSpotCount++] = { 0.0f, l };
+            if (shadowCastingSpotCount == maxShadowCastingSpots) {
+                break;
+            }
+            continue;
+        }
 
-        shadowCastingSpotCount++;
-        if (shadowCastingSpotCount > CONFIG_MAX_SHADOW_CASTING_SPOTS - 1) {
-            break;
+        // keep the most important spots, sorted by decreasing importance
+        const float importance = computeLightImportance(lcm, mViewingCameraInfo, light,
+                lightData.elementAt<FScene::POSITION_RADIUS>(l));
+        size_t i = std::min(shadowCastingSpotCount, maxShadowCastingSpots - 1);
+        if (shadowCastingSpotCount == maxShadowCastingSpots && spots[i].first >= importance) {
+            continue;
+        }
+        for (; i > 0 && spots[i - 1].first < importance; i--) {
+            spots[i] = spots[i - 1];
         }
+        spots[i] = { importance, l };
+        shadowCastingSpotCount = std::min(shadowCastingSpotCount + 1, maxShadowCastingSpots);
+    }
+    for (size_t i = 0; i < shadowCastingSpotCount; i++) {
+        mShadowMapManager.addSpotShadowMap(spots[i].second);
     }
 
     auto shadowTechnique = mShadowMapManager.update(engine, *this,
@@ -357,7 +424,7 @@ void FView::prepareLighting(FEngine& engine, FEngine::DriverApi& driver, ArenaSc
 }
 
 void FView::prepare(FEngine& engine, backend::DriverApi& driver, ArenaScope& arena,
-        filament::Viewport const& viewport, float4 const& userTime) noexcept {
+        filament::Viewport const& viewport, float4 const& userTime, uint32_t frameId) noexcept {
     JobSystem& js = engine.getJobSystem();
 
     /*
@@ -371,14 +438,16 @@ void FView::prepare(FEngine& engine, backend::DriverApi& driver, ArenaScope& are
      * We apply a "world origin" to "everything" in order to implement the IBL rotation.
      * The "world origin" could also be useful for other things, like keeping the origin
      * close to the camera position to improve fp precision in the shader for large scenes.
+     * It is kept in double precision, so that it can cancel out a large camera translation
+     * when the TransformManager's accurate translations are enabled.
      */
-    mat4f worldOriginScene;
+    mat4 worldOriginScene;
     FIndirectLight const* const ibl = scene->getIndirectLight();
     if (ibl) {
         // the IBL transformation must be a rigid transform
         mat3f rotation{ scene->getIndirectLight()->getRotation() };
         // for a rigid-body transform, the inverse is the transpose
-        worldOriginScene = mat4f{ transpose(rotation) };
+        worldOriginScene = mat4{ transpose(rotation) };
     }
 
     /*
@@ -391,38 +460,75 @@ void FView::prepare(FEngine& engine, backend::DriverApi& driver, ArenaScope& are
         // view-space, which improves floating point precision in the shader by staying around
         // zero, where fp precision is highest. This also ensures that when the camera is placed
         // very far from the origin, objects are still rendered and lit properly.
-        worldOriginScene[3].xyz -= camera->getPosition();
+        worldOriginScene[3].xyz -= camera->getModelMatrixAccurate()[3].xyz;
+
+        // If another View already prepared this scene during this frame, reuse its origin as
+        // long as it's close enough to this camera for precision: the scene then doesn't need
+        // to be prepared again, only culled.
+        constexpr double SHARED_WORLD_ORIGIN_MAX_DISTANCE = 1024.0; // [m]
+        if (scene->isPrepared(frameId)) {
+            mat4 const& origin = scene->getWorldOriginTransform();
+            if (origin[0] == worldOriginScene[0] && origin[1] == worldOriginScene[1] &&
+                origin[2] == worldOriginScene[2] &&
+                distance(origin[3].xyz, worldOriginScene[3].xyz) < SHARED_WORLD_ORIGIN_MAX_DISTANCE) {
+                worldOriginScene = origin;
+            }
+        }
     }
 
     // Note: for debugging (i.e. visualize what the camera / objects are doing, using
     // the viewing camera), we can set worldOriginScene to identity when mViewingCamera
     // is set
     mViewingCameraInfo = CameraInfo(*camera, worldOriginScene, mDepthOfFieldOptions.focusDistance);
+    if (engine.debug.view.camera_at_origin) {
+        // the camera isn't exactly at the origin when the world origin is shared
+        mViewingCameraInfo.worldOffset = float3{ -worldOriginScene[3].xyz };
+    }
 
     mCullingFrustum = FCamera::getFrustum(
             mCullingCamera->getCullingProjectionMatrix(),
-            FCamera::getViewMatrix(worldOriginScene * mCullingCamera->getModelMatrix()));
+            FCamera::getViewMatrix(
+                    mat4f{ worldOriginScene * mCullingCamera->getModelMatrixAccurate() }));
+
+    // With eye cameras, everything is culled once against a frustum enclosing all the eyes.
+    if (mEyeCount) {
+        mat4 clipFromWorld[MAX_EYE_COUNT];
+        for (size_t i = 0; i < mEyeCount; i++) {
+            FCamera const* const eye = mEyeCameras[i];
+            mEyeCameraInfos[i] = CameraInfo(*eye, worldOriginScene,
+                    mDepthOfFieldOptions.focusDistance);
+            mEyeCameraInfos[i].worldOffset = mViewingCameraInfo.worldOffset;
+            clipFromWorld[i] = eye->getCullingProjectionMatrix() *
+                    mat4{ FCamera::getViewMatrix(
+                            mat4f{ worldOriginScene * eye->getModelMatrixAccurate() }) };
+        }
+        mCullingFrustum = Culler::enclose(mCullingFrustum, clipFromWorld, mEyeCount);
+    }
 
     /*
      * Gather all information needed to render this scene. Apply the world origin to all
      * objects in the scene.
      */
-    scene->prepare(worldOriginScene);
+    scene->prepare(worldOriginScene, frameId);
 
     /*
      * Light culling: runs in parallel with Renderable culling (below)
      */
 
     auto *prepareVisibleLightsJob = js.runAndRetain(js.createJob(nullptr,
-            [&frustum = mCullingFrustum, &engine, scene](JobSystem& js, JobSystem::Job*) {
-                FView::prepareVisibleLights(
-                        engine.getLightManager(), js, frustum, scene->getLightData());
+            [&frustum = mCullingFrustum, &camera = mViewingCameraInfo,
+                    &budget = mLightBudgetOptions, &engine, scene]
+                    (JobSystem& js, JobSystem::Job*) {
+                FView::prepareVisibleLights(engine.getLightManager(), js, frustum,
+                        camera, budget, scene->getLightData());
             }));
 
     Range merged;
     FScene::RenderableSoa& renderableData = scene->getRenderableData();
 
     { // all the operations in this scope must happen sequentially
+        HardwareCounters cullingCounters(engine.debug.renderer.performance_counters);
+        const auto cullingStart = std::chrono::steady_clock::now();
 
         Slice<Culler::result_type> cullingMask = renderableData.slice<FScene::VISIBLE_MASK>();
         std::uninitialized_fill(cullingMask.begin(), cullingMask.end(), 0);
@@ -434,6 +540,18 @@ void FView::prepare(FEngine& engine, backend::DriverApi& driver, ArenaScope& are
 
         prepareVisibleRenderables(js, mCullingFrustum, renderableData);
 
+        /*
+         * Occlusion culling: clears the VISIBLE_RENDERABLE bit of renderables hidden in the
+         * depth buffer of a previous frame.
+         */
+
+        // the depth buffer is seen from the View's camera, it can't occlude what the eyes see
+        mSkyboxOccluded = false;
+        if (mOcclusionCulling && !mEyeCount) {
+            // the skybox is drawn at the far plane, if no pixel was left there it's hidden
+            mSkyboxOccluded = scene->getSkybox() && !mOcclusionCuller->isFarPlaneVisible();
+            prepareOccludedRenderables(js, renderableData);
+        }
 
         /*
          * Shadowing: compute the shadow camera and cull shadow casters
@@ -469,6 +587,20 @@ void FView::prepare(FEngine& engine, backend::DriverApi& driver, ArenaScope& are
         computeVisibilityMasks(getVisibleLayers(), layers, visibility, cullingMask.begin(),
                 renderableData.size(), hasVsm());
 
+        // the skybox isn't culled like other renderables, its full-screen primitive is drawn
+        // unless it's hidden by the depth buffer of a previous frame
+        if (UTILS_UNLIKELY(mSkyboxOccluded)) {
+            FRenderableManager const& rcm = engine.getRenderableManager();
+            auto const ri = rcm.getInstance(scene->getSkybox()->getEntity());
+            auto const* instances = renderableData.data<FScene::RENDERABLE_INSTANCE>();
+            for (size_t i = 0, c = renderableData.size(); i < c; i++) {
+                if (instances[i] == ri) {
+                    cullingMask[i] = 0;
+                    break;
+                }
+            }
+        }
+
         auto const beginRenderables = renderableData.begin();
         auto beginCasters = partition(beginRenderables, renderableData.end(), VISIBLE_RENDERABLE);
         auto beginCastersOnly = partition(beginCasters, renderableData.end(),
@@ -488,6 +620,31 @@ void FView::prepare(FEngine& engine, backend::DriverApi& driver, ArenaScope& are
         mSpotLightShadowCasters = Range{ 0, iSpotLightCastersEnd };
         merged = Range{ 0, iSpotLightCastersEnd };
 
+        // the closest visible renderable bounds the circle-of-confusion of the foreground
+        mVisibleNearDistance = mDepthOfFieldOptions.enabled ?
+                computeVisibleNearDistance(mViewingCameraInfo, renderableData, mVisibleRenderables) :
+                mViewingCameraInfo.zn;
+
+        // the depth prepass of this frame is decided from the overdraw of the previous frame,
+        // with some hysteresis so that it doesn't toggle every frame
+        switch (mDepthPrepassOptions.mode) {
+            case DepthPrepassOptions::Mode::DISABLED:
+                mDepthPrepass = false;
+                break;
+            case DepthPrepassOptions::Mode::ENABLED:
+                mDepthPrepass = true;
+                break;
+            case DepthPrepassOptions::Mode::AUTOMATIC: {
+                const float threshold = mDepthPrepassOptions.overdrawThreshold;
+                mDepthPrepass = mOpaqueOverdraw > (mDepthPrepass ? 0.8f * threshold : threshold);
+                // the lights of the previous frame, froxelization of this one hasn't run yet
+                mOpaqueOverdraw = computeOpaqueOverdraw(
+                        mViewingCameraInfo, renderableData, mVisibleRenderables,
+                        mHasDynamicLighting ? mFroxelizer.getAverageLightCount() : 0.0f);
+                break;
+            }
+        }
+
         // update those UBOs
         const size_t size = merged.size() * sizeof(PerRenderableUib);
         if (size) {
@@ -504,6 +661,9 @@ void FView::prepare(FEngine& engine, backend::DriverApi& driver, ArenaScope& are
             assert_invariant(mRenderableUbh);
             scene->updateUBOs(merged, mRenderableUbh);
         }
+
+        mCullingTime = std::chrono::steady_clock::now() - cullingStart;
+        mCullingCounters = cullingCounters.elapsed();
     }
 
     /*
@@ -512,7 +672,8 @@ void FView::prepare(FEngine& engine, backend::DriverApi& driver, ArenaScope& are
      * Relies on FScene::prepare() and prepareVisibleLights()
      */
 
-    prepareLighting(engine, driver, arena, viewport);
+    // the froxels are shared by all the eyes, so they cover a single slice of the viewport
+    prepareLighting(engine, driver, arena, mEyeCount ? getEyeViewport(viewport, 0) : viewport);
 
     /*
      * Update driver state
@@ -537,24 +698,107 @@ void FView::prepare(FEngine& engine, backend::DriverApi& driver, ArenaScope& are
             std::exp(-heightFalloff * (camera->getPosition().y - fogOptions.height)))
                     * float(1.0f / F_LN2);
 
+    // materials that fold the fog variant always apply fog, it must be a no-op when disabled
+    const bool fog = hasFog();
+
     u.setUniform(offsetof(PerViewUib, fogStart),             fogOptions.distance);
-    u.setUniform(offsetof(PerViewUib, fogMaxOpacity),        fogOptions.maximumOpacity);
+    u.setUniform(offsetof(PerViewUib, fogMaxOpacity),        fog ? fogOptions.maximumOpacity : 0.0f);
     u.setUniform(offsetof(PerViewUib, fogHeight),            fogOptions.height);
     u.setUniform(offsetof(PerViewUib, fogHeightFalloff),     heightFalloff);
     u.setUniform(offsetof(PerViewUib, fogColor),             fogOptions.color);
-    u.setUniform(offsetof(PerViewUib, fogDensity),           density);
+    u.setUniform(offsetof(PerViewUib, fogDensity),           fog ? density : 0.0f);
     u.setUniform(offsetof(PerViewUib, fogInscatteringStart), fogOptions.inScatteringStart);
-    u.setUniform(offsetof(PerViewUib, fogInscatteringSize),  fogOptions.inScatteringSize);
+    u.setUniform(offsetof(PerViewUib, fogInscatteringSize),  fog ? fogOptions.inScatteringSize : -1.0f);
     u.setUniform(offsetof(PerViewUib, fogColorFromIbl),      fogOptions.fogColorFromIbl ? 1.0f : 0.0f);
 
-    // upload the renderables's dirty UBOs
-    engine.getRenderableManager().prepare(driver,
-            renderableData.data<FScene::RENDERABLE_INSTANCE>(), merged);
+    // upload the bones that changed, for all the renderables
+    engine.getRenderableManager().prepare(driver);
 
     // set uniforms and samplers
     bindPerViewUniformsAndSamplers(driver);
 }
 
+float FView::computeVisibleNearDistance(CameraInfo const& camera,
+        FScene::RenderableSoa const& renderableData, Range visible) noexcept {
+    float3 const* const UTILS_RESTRICT worldAABBCenter = renderableData.data<FScene::WORLD_AABB_CENTER>();
+    float3 const* const UTILS_RESTRICT worldAABBExtent = renderableData.data<FScene::WORLD_AABB_EXTENT>();
+    auto const* const UTILS_RESTRICT visibility = renderableData.data<FScene::VISIBILITY_STATE>();
+
+    // view-space z axis, as a row of the view matrix
+    mat4f const& V = camera.view;
+    const float4 vz = { V[0].z, V[1].z, V[2].z, V[3].z };
+    const float3 avz = abs(vz.xyz);
+
+    float nearest = std::numeric_limits<float>::infinity();
+    for (uint32_t i = visible.first; i < visible.last; i++) {
+        if (UTILS_UNLIKELY(!visibility[i].culling)) {
+            // the bounding box of these renderables can't be trusted
+            return camera.zn;
+        }
+        const float z = dot(vz.xyz, worldAABBCenter[i]) + vz.w;
+        const float halfExtent = dot(avz, worldAABBExtent[i]);
+        nearest = std::min(nearest, -z - halfExtent);
+    }
+    return std::max(camera.zn, nearest);
+}
+
+float FView::computeScreenCoverage(mat4f const& view, mat4f const& projection,
+        float3 center, float3 halfExtent) noexcept {
+    const float radius = length(halfExtent);
+    const float distance = -(view * float4{ center, 1.0f }).z;
+    float scale = 1.0f;
+    if (projection[3][3] == 0.0f) {
+        // perspective: the camera is inside or very close to the sphere
+        if (distance <= radius) {
+            return 1.0f;
+        }
+        scale = 1.0f / distance;
+    } else if (distance < -radius) {
+        // orthographic: the sphere is entirely behind the camera
+        return 0.0f;
+    }
+    // area of the projected ellipse over the area of the clip-space square, which is 4
+    const float rx = radius * scale * std::abs(projection[0][0]);
+    const float ry = radius * scale * std::abs(projection[1][1]);
+    return std::min(1.0f, float(F_PI) * rx * ry * 0.25f);
+}
+
+// cost of shading one dynamic light, relative to the cost of a lit material without lights
+static constexpr float DEPTH_PREPASS_LIGHT_COST = 0.25f;
+
+float FView::computeOpaqueOverdraw(CameraInfo const& camera,
+        FScene::RenderableSoa const& renderableData, Range visible,
+        float averageLightCount) noexcept {
+    float3 const* const UTILS_RESTRICT worldAABBCenter = renderableData.data<FScene::WORLD_AABB_CENTER>();
+    float3 const* const UTILS_RESTRICT worldAABBExtent = renderableData.data<FScene::WORLD_AABB_EXTENT>();
+    auto const* const UTILS_RESTRICT primitives = renderableData.data<FScene::PRIMITIVES>();
+
+    // lit materials evaluate every light of their froxel
+    const float litCost = 1.0f + DEPTH_PREPASS_LIGHT_COST * averageLightCount;
+
+    float overdraw = 0.0f;
+    for (uint32_t i = visible.first; i < visible.last; i++) {
+        // the most expensive material of the renderable that the prepass would draw
+        float cost = 0.0f;
+        for (auto const& primitive : primitives[i]) {
+            FMaterialInstance const* const mi = primitive.getMaterialInstance();
+            FMaterial const* const ma = mi->getMaterial();
+            const BlendingMode blendingMode = ma->getBlendingMode();
+            if ((blendingMode != BlendingMode::OPAQUE && blendingMode != BlendingMode::MASKED) ||
+                    ma->getRefractionMode() == RefractionMode::SCREEN_SPACE ||
+                    !mi->getDepthWrite() || ma->getRasterState().alphaToCoverage) {
+                continue;
+            }
+            cost = std::max(cost, ma->getShading() == Shading::UNLIT ? 0.25f : litCost);
+        }
+        if (cost > 0.0f) {
+            overdraw += cost * computeScreenCoverage(camera.view, camera.projection,
+                    worldAABBCenter[i], worldAABBExtent[i]);
+        }
+    }
+    return overdraw;
+}
+
 void FView::computeVisibilityMasks(
         uint8_t visibleLayers,
         uint8_t const* UTILS_RESTRICT layers,
@@ -615,6 +859,20 @@ UTILS_NOINLINE
     });
 }
 
+void FView::setEyeCameras(FCamera* const* eyes, size_t count) noexcept {
+    assert_invariant(count <= MAX_EYE_COUNT);
+    std::copy_n(eyes, count, mEyeCameras);
+    std::fill(mEyeCameras + count, mEyeCameras + MAX_EYE_COUNT, nullptr);
+    mEyeCount = uint8_t(count);
+}
+
+filament::Viewport FView::getEyeViewport(filament::Viewport const& viewport,
+        size_t eye) const noexcept {
+    assert_invariant(eye < mEyeCount);
+    const uint32_t width = viewport.width / mEyeCount;
+    return { int32_t(viewport.left + eye * width), viewport.bottom, width, viewport.height };
+}
+
 void FView::prepareCamera(const CameraInfo& camera) const noexcept {
     SYSTRACE_CALL();
 
@@ -641,6 +899,11 @@ void FView::prepareCamera(const CameraInfo& camera) const noexcept {
 
 }
 
+void FView::preparePreviousCamera(const mat4f& clipFromWorld) const noexcept {
+    UniformBuffer& u = mPerViewUb;
+    u.setUniform(offsetof(PerViewUib, previousClipFromWorldMatrix), clipFromWorld);
+}
+
 void FView::prepareViewport(const filament::Viewport &viewport) const noexcept {
     SYSTRACE_CALL();
     UniformBuffer& u = mPerViewUb;
@@ -725,15 +988,131 @@ void FView::prepareVisibleRenderables(JobSystem& js,
         Frustum const& frustum, FScene::RenderableSoa& renderableData) const noexcept {
     SYSTRACE_CALL();
     if (UTILS_LIKELY(isFrustumCullingEnabled())) {
-        FView::cullRenderables(js, renderableData, frustum, VISIBLE_RENDERABLE_BIT);
+        FView::cullRenderables(js, *mScene, frustum, VISIBLE_RENDERABLE_BIT);
     } else {
         std::uninitialized_fill(renderableData.begin<FScene::VISIBLE_MASK>(),
                   renderableData.end<FScene::VISIBLE_MASK>(), VISIBLE_RENDERABLE);
     }
 }
 
+UTILS_NOINLINE
+void FView::prepareOccludedRenderables(JobSystem& js,
+        FScene::RenderableSoa& renderableData) const noexcept {
+    SYSTRACE_CALL();
+    OcclusionCuller& culler = *mOcclusionCuller;
+    culler.advance();
+    if (culler.hasDepth()) {
+        float3 const* worldAABBCenter = renderableData.data<FScene::WORLD_AABB_CENTER>();
+        float3 const* worldAABBExtent = renderableData.data<FScene::WORLD_AABB_EXTENT>();
+        FScene::VisibleMaskType* visibleArray = renderableData.data<FScene::VISIBLE_MASK>();
+
+        // culling job (this runs on multiple threads)
+        auto functor = [&culler, worldAABBCenter, worldAABBExtent, visibleArray]
+                (uint32_t index, uint32_t c) {
+            culler.cull(visibleArray + index,
+                    worldAABBCenter + index, worldAABBExtent + index, c, VISIBLE_RENDERABLE_BIT);
+        };
+
+        auto *job = jobs::parallel_for(js, nullptr, 0, (uint32_t)renderableData.size(),
+                std::ref(functor), jobs::CountSplitter<64, 8>());
+        js.runAndWait(job);
+    }
+}
+
+void FView::setOcclusionCullingEnabled(bool enabled) noexcept {
+    mOcclusionCulling = enabled;
+    if (!enabled) {
+        // the depth buffer would be stale by the time occlusion culling is enabled again
+        mOcclusionCuller->invalidate();
+    }
+}
+
+void FView::setCommandCachingEnabled(bool enabled) noexcept {
+    mCommandCaching = enabled;
+    if (!enabled) {
+        // release the retained commands
+        mColorCommandCache = {};
+        mDepthCommandCache = {};
+    }
+}
+
+void FView::readOcclusionDepth(DriverApi& driver, Handle<HwRenderTarget> rt,
+        uint32_t width, uint32_t height, mat4f const& worldToClip) const noexcept {
+    // The shaders write z' = z * clipControl.x + w * clipControl.y, which the backend expects in
+    // [0, w], except for GL without clip control (clipControl.y == 0) where it's in [-w, w].
+    const float2 ndcToDepth = mClipControl.y != 0.0f ?
+            mClipControl : float2{ 0.5f * mClipControl.x, 0.5f };
+
+    // the callback can be called after this view is destroyed, so it keeps the culler alive
+    struct Readback {
+        std::shared_ptr<OcclusionCuller> culler;
+        mat4f worldToClip;
+        float2 ndcToDepth;
+        uint32_t width;
+        uint32_t height;
+        uint32_t frame;
+    };
+
+    // a depth buffer is only used for MAX_LATENCY frames, so it's read back every frame
+    const size_t size = size_t(width) * height * sizeof(float);
+    void* buffer = malloc(size);
+    Readback* user = new Readback{ mOcclusionCuller, worldToClip, ndcToDepth,
+            width, height, mOcclusionCuller->getFrame() };
+
+    driver.readPixels(rt, 0, 0, width, height, {
+            buffer, size, PixelDataFormat::DEPTH_COMPONENT, PixelDataType::FLOAT,
+            [](void* buffer, size_t, void* user) {
+                Readback* readback = static_cast<Readback*>(user);
+                readback->culler->setDepth(static_cast<float const*>(buffer),
+                        readback->width, readback->height, readback->worldToClip,
+                        readback->ndcToDepth, readback->frame);
+                free(buffer);
+                delete readback;
+            }, user });
+}
+
+void FView::readPickingQueries(DriverApi& driver, Handle<HwRenderTarget> rt,
+        uint32_t width, uint32_t height) noexcept {
+    struct Readback {
+        uint32_t data[2];  // the picking buffer is RG32UI
+        PickingQuery query;
+        float3 fragCoords;
+    };
+
+    const float2 scale{ float(width) / float(mViewport.width),
+                        float(height) / float(mViewport.height) };
+    for (PickingQuery const& query : mPickingQueries) {
+        const uint32_t x = std::min(uint32_t(float(query.x) * scale.x), width - 1);
+        const uint32_t y = std::min(uint32_t(float(query.y) * scale.y), height - 1);
+        Readback* user = new Readback{ {}, query, { float(query.x), float(query.y), 0.0f }};
+        driver.readPixels(rt, x, y, 1, 1, {
+                user->data, sizeof(user->data),
+                PixelDataFormat::RG_INTEGER, PixelDataType::UINT,
+                [](void*, size_t, void* user) {
+                    Readback* readback = static_cast<Readback*>(user);
+                    PickingQueryResult result;
+                    // the picking variant writes the renderable's entity and the bits of its depth
+                    float depth;
+                    memcpy(&depth, &readback->data[1], sizeof(depth));
+                    result.renderable = Entity::import(int32_t(readback->data[0]));
+                    result.fragCoords = { readback->fragCoords.xy, depth };
+                    readback->query.callback(result, readback->query.user);
+                    delete readback;
+                }, user });
+    }
+    mPickingQueries.clear();
+}
+
 void FView::cullRenderables(JobSystem& js,
-        FScene::RenderableSoa& renderableData, Frustum const& frustum, size_t bit) noexcept {
+        FScene& scene, Frustum const& frustum, size_t bit) noexcept {
+
+    FScene::RenderableSoa& renderableData = scene.getRenderableData();
+    SceneBvh const* const bvh = scene.getBvh();
+    if (bvh) {
+        bvh->cull(js, renderableData.data<FScene::VISIBLE_MASK>(), scene.getRenderableRows(),
+                frustum, bit);
+        return;
+    }
 
     float3 const* worldAABBCenter = renderableData.data<FScene::WORLD_AABB_CENTER>();
     float3 const* worldAABBExtent = renderableData.data<FScene::WORLD_AABB_EXTENT>();
@@ -756,7 +1135,8 @@ void FView::cullRenderables(JobSystem& js,
 }
 
 void FView::prepareVisibleLights(FLightManager const& lcm, utils::JobSystem&,
-        Frustum const& frustum, FScene::LightSoa& lightData) noexcept {
+        Frustum const& frustum, CameraInfo const& camera, LightBudgetOptions const& budget,
+        FScene::LightSoa& lightData) noexcept {
     SYSTRACE_CALL();
 
     auto const* UTILS_RESTRICT sphereArray     = lightData.data<FScene::POSITION_RADIUS>();
@@ -810,15 +1190,111 @@ void FView::prepareVisibleLights(FLightManager const& lcm, utils::JobSystem&,
     assert_invariant(visibleLightCount == size_t(last - lightData.begin()));
 
     lightData.resize(visibleLightCount);
+
+    if (budget.enabled) {
+        applyLightBudget(lcm, camera, budget, lightData);
+    }
 }
 
-void FView::updatePrimitivesLod(FEngine& engine, const CameraInfo&,
+void FView::applyLightBudget(FLightManager const& lcm, CameraInfo const& camera,
+        LightBudgetOptions const& budget, FScene::LightSoa& lightData) noexcept {
+    SYSTRACE_CALL();
+
+    const size_t maxCount = budget.maxLights + FScene::DIRECTIONAL_LIGHTS_COUNT;
+    if (lightData.size() <= maxCount) {
+        return;
+    }
+
+    // the importance is stored in place of the intensity scale until the cutoff is known
+    auto const* UTILS_RESTRICT spheres   = lightData.data<FScene::POSITION_RADIUS>();
+    auto const* UTILS_RESTRICT instances = lightData.data<FScene::LIGHT_INSTANCE>();
+    auto      * UTILS_RESTRICT scales    = lightData.data<FScene::INTENSITY_SCALE>();
+    for (size_t i = FScene::DIRECTIONAL_LIGHTS_COUNT; i < lightData.size(); i++) {
+        scales[i] = computeLightImportance(lcm, camera, instances[i], spheres[i]);
+    }
+
+    // move the most important lights first, the light at maxCount is the first one culled
+    std::nth_element(lightData.begin() + FScene::DIRECTIONAL_LIGHTS_COUNT,
+            lightData.begin() + maxCount, lightData.end(),
+            [](auto const& lhs, auto const& rhs) {
+                return lhs.template get<FScene::INTENSITY_SCALE>() >
+                       rhs.template get<FScene::INTENSITY_SCALE>();
+            });
+    const float cutoff = scales[maxCount];
+    lightData.resize(maxCount);
+
+    // lights fade in as their importance grows past the cutoff, so they don't pop in and out
+    // of the budget
+    const float fadeRange = budget.fadeRange * cutoff;
+    for (size_t i = FScene::DIRECTIONAL_LIGHTS_COUNT; i < maxCount; i++) {
+        scales[i] = fadeRange > 0.0f ? saturate((scales[i] - cutoff) / fadeRange) : 1.0f;
+    }
+}
+
+void FView::updatePrimitivesLod(FEngine& engine, const CameraInfo& camera,
         FScene::RenderableSoa& renderableData, Range visible) noexcept {
-    FRenderableManager const& rcm = engine.getRenderableManager();
+    FRenderableManager& rcm = engine.getRenderableManager();
+
+    // The screen size of a renderable is the diameter of its bounding sphere divided by the
+    // viewport height, i.e. radius * p[1][1] / distance with a perspective projection.
+    const float scale = camera.projection[1][1];
+    const bool perspective = camera.projection[2][3] != 0.0f;
+    const float3 eye = camera.getPosition();
+
+    float3 const* const UTILS_RESTRICT centers = renderableData.data<FScene::WORLD_AABB_CENTER>();
+    float3 const* const UTILS_RESTRICT extents = renderableData.data<FScene::WORLD_AABB_EXTENT>();
     for (uint32_t index : visible) {
-        uint8_t level = 0; // TODO: pick the proper level of detail
         auto ri = renderableData.elementAt<FScene::RENDERABLE_INSTANCE>(index);
+        uint8_t level = 0;
+        bool reducedShading = false;
+        if (UTILS_UNLIKELY(rcm.hasScreenSizeLod(ri))) {
+            float screenSize = length(extents[index]) * scale;
+            if (perspective) {
+                screenSize /= std::max(distance(centers[index], eye), camera.zn);
+            }
+            level = rcm.selectLod(ri, screenSize);
+            reducedShading = rcm.selectReducedShading(ri, screenSize);
+        }
         renderableData.elementAt<FScene::PRIMITIVES>(index) = rcm.getRenderPrimitives(ri, level);
+        renderableData.elementAt<FScene::VISIBILITY_STATE>(index).reducedShading = reducedShading;
+    }
+}
+
+void FView::updateTextureStreaming(FEngine const& engine, const CameraInfo& camera,
+        FScene::RenderableSoa const& renderableData, Range visible,
+        float viewportHeight) noexcept {
+    FEngine::StreamedTextures const& streamedTextures = engine.getStreamedTextures();
+    if (UTILS_LIKELY(streamedTextures.empty())) {
+        return;
+    }
+
+    // Same screen size as updatePrimitivesLod(), in pixels.
+    const float scale = camera.projection[1][1] * viewportHeight;
+    const bool perspective = camera.projection[2][3] != 0.0f;
+    const float3 eye = camera.getPosition();
+
+    float3 const* const UTILS_RESTRICT centers = renderableData.data<FScene::WORLD_AABB_CENTER>();
+    float3 const* const UTILS_RESTRICT extents = renderableData.data<FScene::WORLD_AABB_EXTENT>();
+    auto const* const UTILS_RESTRICT primitives = renderableData.data<FScene::PRIMITIVES>();
+    for (uint32_t index : visible) {
+        float pixels = length(extents[index]) * scale;
+        if (perspective) {
+            pixels /= std::max(distance(centers[index], eye), camera.zn);
+        }
+        for (FRenderPrimitive const& primitive : primitives[index]) {
+            FMaterialInstance const* const mi = primitive.getMaterialInstance();
+            if (UTILS_UNLIKELY(!mi)) {
+                continue;
+            }
+            backend::SamplerGroup const& samplerGroup = mi->getSamplerGroup();
+            backend::SamplerGroup::Sampler const* const samplers = samplerGroup.getSamplers();
+            for (size_t i = 0, c = samplerGroup.getSize(); i < c; i++) {
+                auto const pos = streamedTextures.find(samplers[i].t.getId());
+                if (pos != streamedTextures.end()) {
+                    pos->second->updateRequiredLevel(pixels);
+                }
+            }
+        }
     }
 }
 
@@ -832,6 +1308,7 @@ void FView::commitFrameHistory(FEngine& engine) noexcept {
     auto& frameHistory = mFrameHistory;
     FrameHistoryEntry& last = frameHistory.back();
     last.color.destroy(engine.getResourceAllocator());
+    last.ssao.destroy(engine.getResourceAllocator());
 
     // and then push the new history entry to the history stack
     frameHistory.commit();
@@ -865,6 +1342,19 @@ Camera& View::getCamera() noexcept {
     return upcast(this)->getCameraUser();
 }
 
+void View::setEyeCameras(Camera* const* eyes, size_t count) noexcept {
+    FCamera* cameras[MAX_EYE_COUNT] = {};
+    count = std::min(count, MAX_EYE_COUNT);
+    for (size_t i = 0; i < count; i++) {
+        cameras[i] = upcast(eyes[i]);
+    }
+    upcast(this)->setEyeCameras(cameras, count);
+}
+
+size_t View::getEyeCount() const noexcept {
+    return upcast(this)->getEyeCount();
+}
+
 void View::setViewport(filament::Viewport const& viewport) noexcept {
     upcast(this)->setViewport(viewport);
 }
@@ -937,6 +1427,30 @@ const View::TemporalAntiAliasingOptions& View::getTemporalAntiAliasingOptions()
     return upcast(this)->getTemporalAntiAliasingOptions();
 }
 
+void View::setVariableRateShadingOptions(VariableRateShadingOptions options) noexcept {
+    upcast(this)->setVariableRateShadingOptions(options);
+}
+
+const View::VariableRateShadingOptions& View::getVariableRateShadingOptions() const noexcept {
+    return upcast(this)->getVariableRateShadingOptions();
+}
+
+void View::setLightBudgetOptions(LightBudgetOptions options) noexcept {
+    upcast(this)->setLightBudgetOptions(options);
+}
+
+const View::LightBudgetOptions& View::getLightBudgetOptions() const noexcept {
+    return upcast(this)->getLightBudgetOptions();
+}
+
+void View::setDepthPrepassOptions(DepthPrepassOptions options) noexcept {
+    upcast(this)->setDepthPrepassOptions(options);
+}
+
+const View::DepthPrepassOptions& View::getDepthPrepassOptions() const noexcept {
+    return upcast(this)->getDepthPrepassOptions();
+}
+
 void View::setToneMapping(ToneMapping type) noexcept {
     upcast(this)->setToneMapping(type);
 }
@@ -969,6 +1483,10 @@ View::DynamicResolutionOptions View::getDynamicResolutionOptions() const noexcep
     return upcast(this)->getDynamicResolutionOptions();
 }
 
+float View::getGpuTime() const noexcept {
+    return upcast(this)->getGpuTime();
+}
+
 void View::setRenderQuality(const RenderQuality& renderQuality) noexcept {
     upcast(this)->setRenderQuality(renderQuality);
 }
@@ -993,10 +1511,55 @@ bool View::isFrontFaceWindingInverted() const noexcept {
     return upcast(this)->isFrontFaceWindingInverted();
 }
 
+void View::setOcclusionCullingEnabled(bool enabled) noexcept {
+    upcast(this)->setOcclusionCullingEnabled(enabled);
+}
+
+bool View::isOcclusionCullingEnabled() const noexcept {
+    return upcast(this)->isOcclusionCullingEnabled();
+}
+
+void View::setCommandCachingEnabled(bool enabled) noexcept {
+    upcast(this)->setCommandCachingEnabled(enabled);
+}
+
+bool View::isCommandCachingEnabled() const noexcept {
+    return upcast(this)->isCommandCachingEnabled();
+}
+
+void View::setShadowMapCachingEnabled(bool enabled) noexcept {
+    upcast(this)->setShadowMapCachingEnabled(enabled);
+}
+
+bool View::isShadowMapCachingEnabled() const noexcept {
+    return upcast(this)->isShadowMapCachingEnabled();
+}
+
+void View::setShadowMapBudget(uint32_t texels) noexcept {
+    upcast(this)->setShadowMapBudget(texels);
+}
+
+uint32_t View::getShadowMapBudget() const noexcept {
+    return upcast(this)->getShadowMapBudget();
+}
+
+void View::pick(uint32_t x, uint32_t y, PickingQueryResultCallback callback, void* user) noexcept {
+    upcast(this)->pick(x, y, callback, user);
+}
+
 void View::setDynamicLightingOptions(float zLightNear, float zLightFar) noexcept {
     upcast(this)->setDynamicLightingOptions(zLightNear, zLightFar);
 }
 
+void View::setDynamicLightingOptions(float zLightNear, float zLightFar,
+        uint8_t froxelSliceCount) noexcept {
+    upcast(this)->setDynamicLightingOptions(zLightNear, zLightFar, froxelSliceCount);
+}
+
+void View::setNonSquareFroxelsEnabled(bool enabled) noexcept {
+    upcast(this)->setNonSquareFroxelsEnabled(enabled);
+}
+
 void View::setShadowType(View::ShadowType shadow) noexcept {
     upcast(this)->setShadowType(shadow);
 }
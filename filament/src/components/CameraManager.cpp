@@ -51,11 +51,12 @@ void FCameraManager::terminate() noexcept {
     }
 }
 
-void FCameraManager::gc(utils::EntityManager& em) noexcept {
+void FCameraManager::gc(utils::EntityManager& em,
+        std::chrono::steady_clock::time_point deadline) noexcept {
     auto& manager = mManager;
     manager.gc(em, 4, [this](Entity e) {
         destroy(e);
-    });
+    }, deadline);
 }
 
 FCamera* FCameraManager::create(Entity entity) {
@@ -25,6 +25,8 @@
 #include <utils/SingleInstanceComponentManager.h>
 #include <utils/Entity.h>
 
+#include <chrono>
+
 namespace filament {
 
 class CameraManager : public FilamentAPI {
@@ -46,7 +48,7 @@ public:
     // free-up all resources
     void terminate() noexcept;
 
-    void gc(utils::EntityManager& em) noexcept;
+    void gc(utils::EntityManager& em, std::chrono::steady_clock::time_point deadline) noexcept;
 
     /*
     * Component Manager APIs
@@ -162,6 +162,8 @@ void FLightManager::create(const FLightManager::Builder& builder, utils::Entity
     }
     Instance i = manager.addComponent(entity);
     assert_invariant(i);
+    mGeneration++;
+    invalidateChanges();
 
     if (i) {
         // This needs to happen before we call the set() methods below
@@ -210,6 +212,8 @@ void FLightManager::destroy(utils::Entity e) noexcept {
     if (i) {
         auto& manager = mManager;
         manager.removeComponent(e);
+        mGeneration++;
+        invalidateChanges();
     }
 }
 
@@ -227,16 +231,61 @@ void FLightManager::terminate() noexcept {
     }
 }
 
+void FLightManager::recordChange(Instance i) noexcept {
+    // past a certain point, it's cheaper for consumers to consider everything changed
+    if (UTILS_UNLIKELY(mChangedInstances.size() >=
+            std::max(size_t(1024), mManager.getComponentCount()))) {
+        invalidateChanges();
+    }
+    mChangedInstances.push_back(i);
+}
+
+void FLightManager::invalidateChanges() noexcept {
+    mChangedInstances.clear();
+    mChangeEpoch++;
+}
+
+bool FLightManager::getChangedInstances(ChangeCursor& cursor,
+        Slice<const Instance>& changes) const noexcept {
+    const uint32_t size = uint32_t(mChangedInstances.size());
+    const bool valid = cursor.epoch == mChangeEpoch;
+    if (valid) {
+        changes = { mChangedInstances.data() + cursor.offset, size - cursor.offset };
+    } else {
+        changes = {};
+    }
+    cursor = { mChangeEpoch, size };
+    return valid;
+}
+
 void FLightManager::setLocalPosition(Instance i, const float3& position) noexcept {
     assert_invariant(i);
     auto& manager = mManager;
     manager[i].position = position;
+    recordChange(i);
+}
+
+void FLightManager::setLocalPositions(Instance const* instances, const float3* positions,
+        size_t count) noexcept {
+    auto& manager = mManager;
+    for (size_t k = 0; k < count; k++) {
+        Instance const i = instances[k];
+        assert_invariant(i);
+        manager[i].position = positions[k];
+    }
+    if (UTILS_UNLIKELY(mChangedInstances.size() + count >
+            std::max(size_t(1024), manager.getComponentCount()))) {
+        invalidateChanges();
+    } else {
+        mChangedInstances.insert(mChangedInstances.end(), instances, instances + count);
+    }
 }
 
 void FLightManager::setLocalDirection(Instance i, float3 direction) noexcept {
     assert_invariant(i);
     auto& manager = mManager;
     manager[i].direction = direction;
+    recordChange(i);
 }
 
 void FLightManager::setColor(Instance i, const LinearColor& color) noexcept {
@@ -298,6 +347,17 @@ void FLightManager::setIntensity(Instance i, float intensity, IntensityUnit unit
                 break;
         }
         manager[i].intensity = luminousIntensity;
+        if (isDirectionalLight(i)) {
+            // the scene picks its dominant directional light by intensity
+            recordChange(i);
+        }
+    }
+}
+
+void FLightManager::setIntensities(Instance const* instances, const float* intensities,
+        size_t count, IntensityUnit unit) noexcept {
+    for (size_t k = 0; k < count; k++) {
+        setIntensity(instances[k], intensities[k], unit);
     }
 }
 
@@ -308,6 +368,7 @@ void FLightManager::setFalloff(Instance i, float falloff) noexcept {
         SpotParams& spotParams = manager[i].spotParams;
         manager[i].squaredFallOffInv = sqFalloff > 0.0f ? (1 / sqFalloff) : 0;
         spotParams.radius = falloff;
+        recordChange(i);
     }
 }
 
@@ -438,6 +499,11 @@ const float3& LightManager::getPosition(Instance i) const noexcept {
     return upcast(this)->getLocalPosition(i);
 }
 
+void LightManager::setPositions(Instance const* instances, const float3* positions,
+        size_t count) noexcept {
+    upcast(this)->setLocalPositions(instances, positions, count);
+}
+
 void LightManager::setDirection(Instance i, const float3& direction) noexcept {
     upcast(this)->setLocalDirection(i, direction);
 }
@@ -458,6 +524,12 @@ void LightManager::setIntensity(Instance i, float intensity) noexcept {
     upcast(this)->setIntensity(i, intensity, FLightManager::IntensityUnit::LUMEN_LUX);
 }
 
+void LightManager::setIntensities(Instance const* instances, const float* intensities,
+        size_t count) noexcept {
+    upcast(this)->setIntensities(instances, intensities, count,
+            FLightManager::IntensityUnit::LUMEN_LUX);
+}
+
 void LightManager::setIntensityCandela(Instance i, float intensity) noexcept {
     upcast(this)->setIntensity(i, intensity, FLightManager::IntensityUnit::CANDELA);
 }
@@ -25,9 +25,13 @@
 
 #include <utils/Entity.h>
 #include <utils/SingleInstanceComponentManager.h>
+#include <utils/Slice.h>
 
 #include <math/mat4.h>
 
+#include <chrono>
+#include <vector>
+
 namespace filament {
 
 class FEngine;
@@ -60,16 +64,38 @@ public:
         return mManager.getInstance(e);
     }
 
+    // Changes whenever instances are created or destroyed
+    uint32_t getGeneration() const noexcept { return mGeneration; }
+
     void create(const FLightManager::Builder& builder, utils::Entity entity);
 
     void destroy(utils::Entity e) noexcept;
 
     void prepare(backend::DriverApi& driver) const noexcept;
 
-    void gc(utils::EntityManager& em) noexcept {
-        mManager.gc(em);
+    void gc(utils::EntityManager& em, std::chrono::steady_clock::time_point deadline) noexcept {
+        const size_t count = mManager.getComponentCount();
+        mManager.gc(em, 4, deadline);
+        if (count != mManager.getComponentCount()) {
+            mGeneration++;
+            invalidateChanges();
+        }
     }
 
+    // Position of a consumer in the list of changed lights
+    struct ChangeCursor {
+        uint32_t epoch = 0;
+        uint32_t offset = 0;
+    };
+
+    // Returns the instances whose world space data (position, direction, falloff, or intensity
+    // of directional lights) changed since the last call with this cursor and advances it.
+    // An instance can appear more than once. Returns false if this information isn't available,
+    // because instances were created or destroyed in the meantime (or too many changes
+    // accumulated), in which case all instances must be considered changed.
+    bool getChangedInstances(ChangeCursor& cursor,
+            utils::Slice<const Instance>& changes) const noexcept;
+
     struct LightType {
         Type type : 3;
         bool shadowCaster : 1;
@@ -105,6 +131,11 @@ public:
     UTILS_NOINLINE void setSunHaloSize(Instance i, float haloSize) noexcept;
     UTILS_NOINLINE void setSunHaloFalloff(Instance i, float haloFalloff) noexcept;
 
+    void setLocalPositions(Instance const* instances, const math::float3* positions,
+            size_t count) noexcept;
+    void setIntensities(Instance const* instances, const float* intensities,
+            size_t count, IntensityUnit unit) noexcept;
+
     LightType const& getLightType(Instance i) const noexcept {
         return mManager[i].lightType;
     }
@@ -284,7 +315,13 @@ private:
         }
     };
 
+    void recordChange(Instance i) noexcept;
+    void invalidateChanges() noexcept;
+
     Sim mManager;
+    uint32_t mGeneration = 0;
+    std::vector<Instance> mChangedInstances;
+    uint32_t mChangeEpoch = 1;
     FEngine& mEngine;
 };
 
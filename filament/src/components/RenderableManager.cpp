@@ -30,6 +30,8 @@
 #include <utils/Panic.h>
 #include <utils/debug.h>
 
+#include <algorithm>
+
 using namespace filament::math;
 using namespace utils;
 
@@ -41,18 +43,32 @@ struct RenderableManager::BuilderDetails {
     Box mAABB;
     uint8_t mLayerMask = 0x1;
     uint8_t mPriority = 0x4;
+    uint16_t mInstanceCount = 1;
     bool mCulling : 1;
     bool mCastShadows : 1;
     bool mReceiveShadows : 1;
     bool mScreenSpaceContactShadows : 1;
+    bool mOrderIndependentBlending : 1;
     bool mMorphingEnabled : 1;
     size_t mSkinningBoneCount = 0;
     Bone const* mUserBones = nullptr;
     mat4f const* mUserBoneMatrices = nullptr;
+    struct LodEntry {
+        size_t index;
+        size_t level;
+        IndexBuffer* indices;
+        size_t offset;
+        size_t count;
+    };
+    std::vector<LodEntry> mLodEntries;
+    float mLodScreenSizes[CONFIG_MAX_LOD_COUNT - 1] = { 0.5f, 0.25f, 0.125f };
+    float mShadingLodScreenSize = 0.0f;
+    uint8_t mLodCount = 1;
 
     explicit BuilderDetails(size_t count)
             : mEntries(count), mCulling(true), mCastShadows(false), mReceiveShadows(true),
-              mScreenSpaceContactShadows(false), mMorphingEnabled(false) {
+              mScreenSpaceContactShadows(false), mOrderIndependentBlending(false),
+              mMorphingEnabled(false) {
     }
     // this is only needed for the explicit instantiation below
     BuilderDetails() = default;
@@ -140,6 +156,11 @@ RenderableManager::Builder& RenderableManager::Builder::screenSpaceContactShadow
     return *this;
 }
 
+RenderableManager::Builder& RenderableManager::Builder::orderIndependentBlending(bool enable) noexcept {
+    mImpl->mOrderIndependentBlending = enable;
+    return *this;
+}
+
 RenderableManager::Builder& RenderableManager::Builder::skinning(size_t boneCount) noexcept {
     mImpl->mSkinningBoneCount = boneCount;
     return *this;
@@ -171,6 +192,38 @@ RenderableManager::Builder& RenderableManager::Builder::blendOrder(size_t index,
     return *this;
 }
 
+RenderableManager::Builder& RenderableManager::Builder::instances(size_t instanceCount) noexcept {
+    mImpl->mInstanceCount = uint16_t(std::clamp(instanceCount, size_t(1), size_t(65535)));
+    return *this;
+}
+
+RenderableManager::Builder& RenderableManager::Builder::levelsOfDetail(size_t count) noexcept {
+    mImpl->mLodCount = uint8_t(std::clamp(count, size_t(1), CONFIG_MAX_LOD_COUNT));
+    return *this;
+}
+
+RenderableManager::Builder& RenderableManager::Builder::geometryLod(size_t index, size_t level,
+        IndexBuffer* indices, size_t offset, size_t count) noexcept {
+    if (index < mImpl->mEntries.size() && level > 0 && level < CONFIG_MAX_LOD_COUNT) {
+        mImpl->mLodEntries.push_back({ index, level, indices, offset, count });
+        mImpl->mLodCount = std::max(mImpl->mLodCount, uint8_t(level + 1));
+    }
+    return *this;
+}
+
+RenderableManager::Builder& RenderableManager::Builder::lodScreenSizes(
+        float const* screenSizes, size_t count) noexcept {
+    count = std::min(count, CONFIG_MAX_LOD_COUNT - 1);
+    std::copy_n(screenSizes, count, mImpl->mLodScreenSizes);
+    return *this;
+}
+
+RenderableManager::Builder& RenderableManager::Builder::shadingLodScreenSize(
+        float screenSize) noexcept {
+    mImpl->mShadingLodScreenSize = std::max(screenSize, 0.0f);
+    return *this;
+}
+
 RenderableManager::Builder::Result RenderableManager::Builder::build(Engine& engine, Entity entity) {
     bool isEmpty = true;
 
@@ -179,6 +232,15 @@ RenderableManager::Builder::Result RenderableManager::Builder::build(Engine& eng
         return Error;
     }
 
+    for (auto const& lod : mImpl->mLodEntries) {
+        if (!ASSERT_PRECONDITION_NON_FATAL(lod.indices &&
+                lod.offset + lod.count <= lod.indices->getIndexCount(),
+                "[entity=%u, primitive @ %u, level %u] invalid index buffer range",
+                entity.getId(), lod.index, lod.level)) {
+            return Error;
+        }
+    }
+
     for (size_t i = 0, c = mImpl->mEntries.size(); i < c; i++) {
         auto& entry = mImpl->mEntries[i];
 
@@ -265,16 +327,36 @@ void FRenderableManager::create(
     }
     Instance ci = manager.addComponent(entity);
     assert_invariant(ci);
+    mGeneration++;
 
     if (ci) {
-        // create and initialize all needed RenderPrimitives
+        // create and initialize all needed RenderPrimitives, level by level. A level inherits
+        // the geometry of the previous one, unless it is specified with geometryLod().
         using size_type = Slice<FRenderPrimitive>::size_type;
-        Builder::Entry const * const entries = builder->mEntries.data();
-        FRenderPrimitive* rp = new FRenderPrimitive[builder->mEntries.size()];
-        for (size_t i = 0, c = builder->mEntries.size(); i < c; ++i) {
-            rp[i].init(driver, entries[i]);
+        const size_t primitiveCount = builder->mEntries.size();
+        const size_t levels = builder->mLodCount;
+        std::vector<Builder::Entry> entries(builder->mEntries);
+        FRenderPrimitive* rp = new FRenderPrimitive[primitiveCount * levels];
+        for (size_t level = 0; level < levels; ++level) {
+            for (auto const& lod : builder->mLodEntries) {
+                if (lod.level == level) {
+                    entries[lod.index].indices = lod.indices;
+                    entries[lod.index].offset = lod.offset;
+                    entries[lod.index].count = lod.count;
+                }
+            }
+            for (size_t i = 0; i < primitiveCount; ++i) {
+                rp[level * primitiveCount + i].init(driver, entries[i]);
+            }
         }
-        setPrimitives(ci, { rp, size_type(builder->mEntries.size()) });
+        setPrimitives(ci, { rp, size_type(primitiveCount * levels) });
+
+        LevelsOfDetail lod;
+        lod.count = uint8_t(levels);
+        std::copy(std::begin(builder->mLodScreenSizes), std::end(builder->mLodScreenSizes),
+                lod.screenSizes);
+        lod.shadingScreenSize = builder->mShadingLodScreenSize;
+        setLevelsOfDetail(ci, lod);
 
         setAxisAlignedBoundingBox(ci, builder->mAABB);
         setLayerMask(ci, builder->mLayerMask);
@@ -282,44 +364,29 @@ void FRenderableManager::create(
         setCastShadows(ci, builder->mCastShadows);
         setReceiveShadows(ci, builder->mReceiveShadows);
         setScreenSpaceContactShadows(ci, builder->mScreenSpaceContactShadows);
+        setOrderIndependentBlending(ci, builder->mOrderIndependentBlending);
         setCulling(ci, builder->mCulling);
         setSkinning(ci, false);
         setMorphing(ci, builder->mMorphingEnabled);
         setMorphWeights(ci, {0, 0, 0, 0});
+        setInstanceCount(ci, builder->mInstanceCount);
 
         const size_t count = builder->mSkinningBoneCount;
         if (UTILS_UNLIKELY(count > 0 || builder->mMorphingEnabled)) {
-            std::unique_ptr<Bones>& bones = manager[ci].bones;
-            // Note that we are sizing the bones UBO according to CONFIG_MAX_BONE_COUNT rather than
-            // mSkinningBoneCount. According to the OpenGL ES 3.2 specification in 7.6.3 Uniform
-            // Buffer Object Bindings:
-            //
-            //     the uniform block must be populated with a buffer object with a size no smaller
-            //     than the minimum required size of the uniform block (the value of
-            //     UNIFORM_BLOCK_DATA_SIZE).
-            //
-            // This unfortunately means that we are using a large memory footprint for skinned
-            // renderables. In the future we could try addressing this by implementing a paging
-            // system such that multiple skinned renderables will share regions within a single
-            // large block of bones.
-            bones = std::unique_ptr<Bones>(new Bones{
-                    driver.createUniformBuffer(CONFIG_MAX_BONE_COUNT * sizeof(PerRenderableUibBone),
-                            backend::BufferUsage::DYNAMIC),
-                    UniformBuffer{ count * sizeof(PerRenderableUibBone) },
-                    count
-            });
-            assert_invariant(bones);
-            if (bones) {
-                setSkinning(ci, count > 0);
-                if (builder->mUserBones) {
-                    setBones(ci, builder->mUserBones, count);
-                } else if (builder->mUserBoneMatrices) {
-                    setBones(ci, builder->mUserBoneMatrices, count);
-                } else {
-                    // initialize the bones to identity
-                    PerRenderableUibBone* out = (PerRenderableUibBone*)bones->bones.invalidate();
-                    std::uninitialized_fill_n(out, count, PerRenderableUibBone{});
-                }
+            // The bones are packed with those of the other renderables in the bone palette, which
+            // is uploaded once per frame, rather than in a uniform buffer of their own.
+            Bones& bones = manager[ci].bones;
+            bones.range = mBonePalette.allocate(driver, count);
+            bones.enabled = true;
+            setSkinning(ci, count > 0);
+            if (builder->mUserBones) {
+                setBones(ci, builder->mUserBones, count);
+            } else if (builder->mUserBoneMatrices) {
+                setBones(ci, builder->mUserBoneMatrices, count);
+            } else {
+                // initialize the bones to identity
+                PerRenderableUibBone* out = mBonePalette.invalidate(bones.range, 0, count);
+                std::uninitialized_fill_n(out, count, PerRenderableUibBone{});
             }
         }
     }
@@ -331,6 +398,23 @@ void FRenderableManager::destroy(utils::Entity e) noexcept {
     if (ci) {
         destroyComponent(ci);
         mManager.removeComponent(e);
+        mGeneration++;
+    }
+}
+
+void FRenderableManager::destroy(size_t count, utils::Entity const* entities) noexcept {
+    bool destroyed = false;
+    for (size_t i = 0; i < count; i++) {
+        Instance ci = getInstance(entities[i]);
+        if (ci) {
+            destroyComponent(ci);
+            mManager.removeComponent(entities[i]);
+            destroyed = true;
+        }
+    }
+    // the generation only needs to change once for the whole batch
+    if (destroyed) {
+        mGeneration++;
     }
 }
 
@@ -348,6 +432,7 @@ void FRenderableManager::terminate() noexcept {
             manager.removeComponent(manager.getEntity(ci));
         }
     }
+    mBonePalette.terminate(mEngine.getDriverApi());
 }
 
 // This is basically a Renderable's destructor.
@@ -355,15 +440,14 @@ void FRenderableManager::destroyComponent(Instance ci) noexcept {
     auto& manager = mManager;
     FEngine& engine = mEngine;
 
-    FEngine::DriverApi& driver = engine.getDriverApi();
-
     // See create(RenderableManager::Builder&, Entity)
     destroyComponentPrimitives(engine, manager[ci].primitives);
 
-    // destroy the bones structures if any
-    std::unique_ptr<Bones> const& bones = manager[ci].bones;
-    if (bones) {
-        driver.destroyUniformBuffer(bones->handle);
+    // give the bones back to the palette, if any
+    Bones& bones = manager[ci].bones;
+    if (bones.enabled) {
+        mBonePalette.free(bones.range);
+        bones = {};
     }
 }
 
@@ -376,28 +460,14 @@ void FRenderableManager::destroyComponentPrimitives(
 }
 
 
-void FRenderableManager::prepare(
-        backend::DriverApi& UTILS_RESTRICT driver,
-        Instance const* UTILS_RESTRICT instances,
-        utils::Range<uint32_t> list) const noexcept {
-    const auto& manager = mManager;
-
-    std::unique_ptr<Bones>  const * const UTILS_RESTRICT bones = manager.raw_array<BONES>();
-    for (uint32_t index : list) {
-        size_t i = instances[index].asValue();
-        assert_invariant(i);  // we should never get the null instance here
-        if (UTILS_UNLIKELY(bones[i])) {
-            if (bones[i]->bones.isDirty()) {
-                driver.loadUniformBuffer(bones[i]->handle, bones[i]->bones.toBufferDescriptor(driver));
-            }
-        }
-    }
+void FRenderableManager::prepare(backend::DriverApi& UTILS_RESTRICT driver) noexcept {
+    mBonePalette.commit(driver);
 }
 
 void FRenderableManager::setMaterialInstanceAt(Instance instance, uint8_t level,
         size_t primitiveIndex, FMaterialInstance const* mi) noexcept {
-    if (instance) {
-        Slice<FRenderPrimitive>& primitives = getRenderPrimitives(instance, level);
+    if (instance && level < getLevelCount(instance)) {
+        Slice<FRenderPrimitive> primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             primitives[primitiveIndex].setMaterialInstance(upcast(mi));
             AttributeBitset required = mi->getMaterial()->getRequiredAttributes();
@@ -413,8 +483,8 @@ void FRenderableManager::setMaterialInstanceAt(Instance instance, uint8_t level,
 
 MaterialInstance* FRenderableManager::getMaterialInstanceAt(
         Instance instance, uint8_t level, size_t primitiveIndex) const noexcept {
-    if (instance) {
-        const Slice<FRenderPrimitive>& primitives = getRenderPrimitives(instance, level);
+    if (instance && level < getLevelCount(instance)) {
+        Slice<FRenderPrimitive> primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             // We store the material instance as const because we don't want to change it internally
             // but when the user queries it, we want to allow them to call setParameter()
@@ -426,8 +496,8 @@ MaterialInstance* FRenderableManager::getMaterialInstanceAt(
 
 void FRenderableManager::setBlendOrderAt(Instance instance, uint8_t level,
         size_t primitiveIndex, uint16_t order) noexcept {
-    if (instance) {
-        Slice<FRenderPrimitive>& primitives = getRenderPrimitives(instance, level);
+    if (instance && level < getLevelCount(instance)) {
+        Slice<FRenderPrimitive> primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             primitives[primitiveIndex].setBlendOrder(order);
         }
@@ -436,8 +506,8 @@ void FRenderableManager::setBlendOrderAt(Instance instance, uint8_t level,
 
 AttributeBitset FRenderableManager::getEnabledAttributesAt(
         Instance instance, uint8_t level, size_t primitiveIndex) const noexcept {
-    if (instance) {
-        Slice<FRenderPrimitive> const& primitives = getRenderPrimitives(instance, level);
+    if (instance && level < getLevelCount(instance)) {
+        Slice<FRenderPrimitive> primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             return primitives[primitiveIndex].getEnabledAttributes();
         }
@@ -448,8 +518,8 @@ AttributeBitset FRenderableManager::getEnabledAttributesAt(
 void FRenderableManager::setGeometryAt(Instance instance, uint8_t level, size_t primitiveIndex,
         PrimitiveType type, FVertexBuffer* vertices, FIndexBuffer* indices,
         size_t offset, size_t count) noexcept {
-    if (instance) {
-        Slice<FRenderPrimitive>& primitives = getRenderPrimitives(instance, level);
+    if (instance && level < getLevelCount(instance)) {
+        Slice<FRenderPrimitive> primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             primitives[primitiveIndex].set(mEngine, type, vertices, indices, offset,
                     0, vertices->getVertexCount() - 1, count);
@@ -459,24 +529,54 @@ void FRenderableManager::setGeometryAt(Instance instance, uint8_t level, size_t
 
 void FRenderableManager::setGeometryAt(Instance instance, uint8_t level, size_t primitiveIndex,
         PrimitiveType type, size_t offset, size_t count) noexcept {
-    if (instance) {
-        Slice<FRenderPrimitive>& primitives = getRenderPrimitives(instance, level);
+    if (instance && level < getLevelCount(instance)) {
+        Slice<FRenderPrimitive> primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             primitives[primitiveIndex].set(mEngine, type, offset, 0, 0, count);
         }
     }
 }
 
+Slice<FRenderPrimitive> FRenderableManager::getRenderPrimitives(
+        Instance instance, uint8_t level) const noexcept {
+    Slice<FRenderPrimitive> const& primitives = mManager[instance].primitives;
+    LevelsOfDetail const& lod = mManager[instance].lods;
+    assert_invariant(level < lod.count);
+    const uint32_t count = primitives.size() / lod.count;
+    return { const_cast<FRenderPrimitive*>(primitives.data()) + level * count, count };
+}
+
+uint8_t FRenderableManager::selectLod(LevelsOfDetail const& lod, float screenSize) noexcept {
+    auto levelOf = [&lod](float size) {
+        uint8_t level = 0;
+        while (level + 1 < lod.count && size < lod.screenSizes[level]) {
+            level++;
+        }
+        return level;
+    };
+    // move to a coarser level only once the screen size is clearly below its threshold, and
+    // back to a finer level only once it is clearly above it.
+    const uint8_t finest = levelOf(screenSize * (1.0f + LOD_HYSTERESIS));
+    const uint8_t coarsest = levelOf(screenSize * (1.0f - LOD_HYSTERESIS));
+    return std::clamp(std::min(lod.current, uint8_t(lod.count - 1)), finest, coarsest);
+}
+
+bool FRenderableManager::selectReducedShading(LevelsOfDetail const& lod,
+        float screenSize) noexcept {
+    const float threshold = lod.shadingScreenSize *
+            (lod.reducedShading ? 1.0f + LOD_HYSTERESIS : 1.0f - LOD_HYSTERESIS);
+    return screenSize < threshold;
+}
+
 void FRenderableManager::setBones(Instance ci,
         Bone const* UTILS_RESTRICT transforms, size_t boneCount, size_t offset) noexcept {
     if (ci) {
-        std::unique_ptr<Bones> const& bones = mManager[ci].bones;
-        assert_invariant(bones && offset + boneCount <= bones->count);
-        if (bones) {
-            boneCount = std::min(boneCount, bones->count - offset);
-            PerRenderableUibBone* UTILS_RESTRICT out = (PerRenderableUibBone*)bones->bones.invalidateUniforms(
-                    offset * sizeof(PerRenderableUibBone),
-                    boneCount * sizeof(PerRenderableUibBone));
+        Bones const& bones = mManager[ci].bones;
+        assert_invariant(bones.enabled && offset + boneCount <= bones.range.count);
+        if (bones.enabled && offset < bones.range.count) {
+            boneCount = std::min(boneCount, bones.range.count - offset);
+            PerRenderableUibBone* UTILS_RESTRICT out =
+                    mBonePalette.invalidate(bones.range, offset, boneCount);
             for (size_t i = 0, c = boneCount; i < c; ++i) {
                 out[i].q = transforms[i].unitQuaternion;
                 out[i].t.xyz = transforms[i].translation;
@@ -489,13 +589,12 @@ void FRenderableManager::setBones(Instance ci,
 void FRenderableManager::setBones(Instance ci,
         mat4f const* UTILS_RESTRICT transforms, size_t boneCount, size_t offset) noexcept {
     if (ci) {
-        std::unique_ptr<Bones> const& bones = mManager[ci].bones;
-        assert_invariant(bones && offset + boneCount <= bones->count);
-        if (bones) {
-            boneCount = std::min(boneCount, bones->count - offset);
-            PerRenderableUibBone* UTILS_RESTRICT out = (PerRenderableUibBone*)bones->bones.invalidateUniforms(
-                    offset * sizeof(PerRenderableUibBone),
-                    boneCount * sizeof(PerRenderableUibBone));
+        Bones const& bones = mManager[ci].bones;
+        assert_invariant(bones.enabled && offset + boneCount <= bones.range.count);
+        if (bones.enabled && offset < bones.range.count) {
+            boneCount = std::min(boneCount, bones.range.count - offset);
+            PerRenderableUibBone* UTILS_RESTRICT out =
+                    mBonePalette.invalidate(bones.range, offset, boneCount);
             for (size_t i = 0, c = boneCount; i < c; ++i) {
                 makeBone(&out[i], transforms[i]);
             }
@@ -549,6 +648,10 @@ void RenderableManager::destroy(utils::Entity e) noexcept {
     return upcast(this)->destroy(e);
 }
 
+void RenderableManager::destroy(size_t count, utils::Entity const* entities) noexcept {
+    upcast(this)->destroy(count, entities);
+}
+
 void RenderableManager::setAxisAlignedBoundingBox(Instance instance, const Box& aabb) noexcept {
     upcast(this)->setAxisAlignedBoundingBox(instance, aabb);
 }
@@ -577,6 +680,10 @@ void RenderableManager::setScreenSpaceContactShadows(Instance instance, bool ena
     upcast(this)->setScreenSpaceContactShadows(instance, enable);
 }
 
+void RenderableManager::setOrderIndependentBlending(Instance instance, bool enable) noexcept {
+    upcast(this)->setOrderIndependentBlending(instance, enable);
+}
+
 bool RenderableManager::isShadowCaster(Instance instance) const noexcept {
     return upcast(this)->isShadowCaster(instance);
 }
@@ -599,7 +706,10 @@ size_t RenderableManager::getPrimitiveCount(Instance instance) const noexcept {
 
 void RenderableManager::setMaterialInstanceAt(Instance instance,
         size_t primitiveIndex, MaterialInstance const* materialInstance) noexcept {
-    upcast(this)->setMaterialInstanceAt(instance, 0, primitiveIndex, upcast(materialInstance));
+    for (size_t level = 0, c = upcast(this)->getLevelCount(instance); level < c; level++) {
+        upcast(this)->setMaterialInstanceAt(instance, level, primitiveIndex,
+                upcast(materialInstance));
+    }
 }
 
 MaterialInstance* RenderableManager::getMaterialInstanceAt(
@@ -608,7 +718,9 @@ MaterialInstance* RenderableManager::getMaterialInstanceAt(
 }
 
 void RenderableManager::setBlendOrderAt(Instance instance, size_t primitiveIndex, uint16_t order) noexcept {
-    upcast(this)->setBlendOrderAt(instance, 0, primitiveIndex, order);
+    for (size_t level = 0, c = upcast(this)->getLevelCount(instance); level < c; level++) {
+        upcast(this)->setBlendOrderAt(instance, level, primitiveIndex, order);
+    }
 }
 
 AttributeBitset RenderableManager::getEnabledAttributesAt(Instance instance, size_t primitiveIndex) const noexcept {
@@ -618,13 +730,33 @@ AttributeBitset RenderableManager::getEnabledAttributesAt(Instance instance, siz
 void RenderableManager::setGeometryAt(Instance instance, size_t primitiveIndex,
         PrimitiveType type, VertexBuffer* vertices, IndexBuffer* indices,
         size_t offset, size_t count) noexcept {
-    upcast(this)->setGeometryAt(instance, 0, primitiveIndex,
-            type, upcast(vertices), upcast(indices), offset, count);
+    for (size_t level = 0, c = upcast(this)->getLevelCount(instance); level < c; level++) {
+        upcast(this)->setGeometryAt(instance, level, primitiveIndex,
+                type, upcast(vertices), upcast(indices), offset, count);
+    }
 }
 
 void RenderableManager::setGeometryAt(RenderableManager::Instance instance, size_t primitiveIndex,
         RenderableManager::PrimitiveType type, size_t offset, size_t count) noexcept {
-    upcast(this)->setGeometryAt(instance, 0, primitiveIndex, type, offset, count);
+    for (size_t level = 0, c = upcast(this)->getLevelCount(instance); level < c; level++) {
+        upcast(this)->setGeometryAt(instance, level, primitiveIndex, type, offset, count);
+    }
+}
+
+size_t RenderableManager::getLevelOfDetailCount(Instance instance) const noexcept {
+    return upcast(this)->getLevelCount(instance);
+}
+
+void RenderableManager::setLodGeometryAt(Instance instance, size_t primitiveIndex, size_t level,
+        PrimitiveType type, VertexBuffer* vertices, IndexBuffer* indices,
+        size_t offset, size_t count) noexcept {
+    upcast(this)->setGeometryAt(instance, uint8_t(std::min(level, CONFIG_MAX_LOD_COUNT)),
+            primitiveIndex,
+            type, upcast(vertices), upcast(indices), offset, count);
+}
+
+void RenderableManager::setShadingLodScreenSize(Instance instance, float screenSize) noexcept {
+    upcast(this)->setShadingLodScreenSize(instance, screenSize);
 }
 
 void RenderableManager::setBones(Instance instance,
@@ -19,7 +19,7 @@
 
 #include "upcast.h"
 
-#include "UniformBuffer.h"
+#include "BonePalette.h"
 
 #include "private/backend/DriverApiForward.h"
 
@@ -28,6 +28,7 @@
 #include <filament/Box.h>
 #include <filament/RenderableManager.h>
 
+#include <private/filament/EngineEnums.h>
 #include <private/filament/UibGenerator.h>
 
 #include <utils/Entity.h>
@@ -35,6 +36,8 @@
 #include <utils/Slice.h>
 #include <utils/Range.h>
 
+#include <chrono>
+
 // for gtest
 class FilamentTest_Bones_Test;
 
@@ -58,10 +61,25 @@ public:
         bool skinning                   : 1;
         bool morphing                   : 1;
         bool screenSpaceContactShadows  : 1;
+        bool orderIndependentBlending   : 1;
+        bool reducedShading             : 1;    // set per frame, see FView::updatePrimitivesLod()
     };
 
     static_assert(sizeof(Visibility) == sizeof(uint16_t), "Visibility should be 16 bits");
 
+    // Level 0 is the most detailed level. Level i > 0 is used when the screen size of the
+    // renderable is below screenSizes[i - 1], see selectLod().
+    struct LevelsOfDetail {
+        float screenSizes[CONFIG_MAX_LOD_COUNT - 1] = {};
+        uint8_t count = 1;
+        uint8_t current = 0;        // last selected level, for hysteresis
+        float shadingScreenSize = 0.0f; // below it, lighting is reduced; 0 when disabled
+        bool reducedShading = false;    // last selection, for hysteresis
+    };
+
+    // Relative margin around the screen size thresholds, to avoid popping between two levels.
+    static constexpr float LOD_HYSTERESIS = 0.1f;
+
     explicit FRenderableManager(FEngine& engine) noexcept;
     ~FRenderableManager();
 
@@ -80,18 +98,31 @@ public:
         return mManager.getInstance(e);
     }
 
+    utils::Entity getEntity(Instance i) const noexcept {
+        return mManager.getEntity(i);
+    }
+
+    size_t getComponentCount() const noexcept {
+        return mManager.getComponentCount();
+    }
+
+    // Changes whenever instances are created, destroyed (which can renumber instances) or
+    // their bounding box changes. Used by FScene to know when its data must be rebuilt.
+    uint32_t getGeneration() const noexcept { return mGeneration; }
+
     void create(const RenderableManager::Builder& builder, utils::Entity entity);
 
     void destroy(utils::Entity e) noexcept;
 
-    // - instances is a list of Instance (typically the list from a given scene)
-    // - list is a list of index in 'instances' (typically the visible ones)
-    void prepare(backend::DriverApi& driver,
-            RenderableManager::Instance const* instances,
-            utils::Range<uint32_t> list) const noexcept;
+    void destroy(size_t count, utils::Entity const* entities) noexcept;
+
+    // uploads the bones that changed, for all the renderables at once
+    void prepare(backend::DriverApi& driver) noexcept;
 
-    void gc(utils::EntityManager& em) noexcept {
-        mManager.gc(em);
+    void gc(utils::EntityManager& em, std::chrono::steady_clock::time_point deadline) noexcept {
+        const size_t count = mManager.getComponentCount();
+        mManager.gc(em, 4, deadline);
+        mGeneration += uint32_t(count != mManager.getComponentCount());
     }
 
     inline void setAxisAlignedBoundingBox(Instance instance, const Box& aabb) noexcept;
@@ -106,13 +137,17 @@ public:
     inline void setLayerMask(Instance instance, uint8_t layerMask) noexcept;
     inline void setReceiveShadows(Instance instance, bool enable) noexcept;
     inline void setScreenSpaceContactShadows(Instance instance, bool enable) noexcept;
+    inline void setOrderIndependentBlending(Instance instance, bool enable) noexcept;
     inline void setCulling(Instance instance, bool enable) noexcept;
     inline void setSkinning(Instance instance, bool enable) noexcept;
     inline void setMorphing(Instance instance, bool enable) noexcept;
     inline void setPrimitives(Instance instance, utils::Slice<FRenderPrimitive> const& primitives) noexcept;
+    inline void setLevelsOfDetail(Instance instance, LevelsOfDetail const& lod) noexcept;
+    inline void setShadingLodScreenSize(Instance instance, float screenSize) noexcept;
     inline void setBones(Instance instance, Bone const* transforms, size_t boneCount, size_t offset = 0) noexcept;
     inline void setBones(Instance instance, math::mat4f const* transforms, size_t boneCount, size_t offset = 0) noexcept;
     inline void setMorphWeights(Instance instance, const math::float4& weights) noexcept;
+    inline void setInstanceCount(Instance instance, uint16_t instanceCount) noexcept;
 
 
     inline bool isShadowCaster(Instance instance) const noexcept;
@@ -126,12 +161,15 @@ public:
     inline uint8_t getLayerMask(Instance instance) const noexcept;
     inline uint8_t getPriority(Instance instance) const noexcept;
     inline filament::math::float4 getMorphWeights(Instance instance) const noexcept;
+    inline uint16_t getInstanceCount(Instance instance) const noexcept;
 
     inline backend::Handle<backend::HwUniformBuffer> getBonesUbh(Instance instance) const noexcept;
+    // offset of the bones in getBonesUbh(), in units of BonePalette::RANGE_ALIGNMENT
+    inline uint16_t getBonesOffset(Instance instance) const noexcept;
     inline uint32_t getBoneCount(Instance instance) const noexcept;
 
 
-    inline size_t getLevelCount(Instance instance) const noexcept { return 1; }
+    inline size_t getLevelCount(Instance instance) const noexcept;
     inline size_t getPrimitiveCount(Instance instance, uint8_t level) const noexcept;
     void setMaterialInstanceAt(Instance instance, uint8_t level,
             size_t primitiveIndex, FMaterialInstance const* materialInstance) noexcept;
@@ -143,18 +181,36 @@ public:
             PrimitiveType type, size_t offset, size_t count) noexcept;
     void setBlendOrderAt(Instance instance, uint8_t level, size_t primitiveIndex, uint16_t blendOrder) noexcept;
     AttributeBitset getEnabledAttributesAt(Instance instance, uint8_t level, size_t primitiveIndex) const noexcept;
-    inline utils::Slice<FRenderPrimitive> const& getRenderPrimitives(Instance instance, uint8_t level) const noexcept;
-    inline utils::Slice<FRenderPrimitive>& getRenderPrimitives(Instance instance, uint8_t level) noexcept;
+    utils::Slice<FRenderPrimitive> getRenderPrimitives(Instance instance, uint8_t level) const noexcept;
+
+    // Returns the level of detail to use for the given screen size, which is the ratio of the
+    // diameter of the renderable's bounding sphere to the height of the viewport, and records
+    // it as the current level.
+    inline uint8_t selectLod(Instance instance, float screenSize) noexcept;
+
+    // Returns whether the renderable is shaded with fewer lights at the given screen size, and
+    // records it for the hysteresis.
+    inline bool selectReducedShading(Instance instance, float screenSize) noexcept;
+
+    // Whether the renderable depends on its screen size, i.e. selectLod() or
+    // selectReducedShading() need to be called.
+    inline bool hasScreenSizeLod(Instance instance) const noexcept;
+
+    // Returns the level of detail for the given screen size, staying on the current level while
+    // the screen size is within LOD_HYSTERESIS of the thresholds.
+    static uint8_t selectLod(LevelsOfDetail const& lod, float screenSize) noexcept;
+    static bool selectReducedShading(LevelsOfDetail const& lod, float screenSize) noexcept;
 
 private:
     void destroyComponent(Instance ci) noexcept;
     static void destroyComponentPrimitives(FEngine& engine,
             utils::Slice<FRenderPrimitive>& primitives) noexcept;
 
+    // The bones of all the renderables live in mBonePalette. Renderables that only morph have an
+    // empty range, but still need the palette to be bound.
     struct Bones {
-        filament::backend::Handle<backend::HwUniformBuffer> handle;
-        UniformBuffer bones;
-        size_t count;
+        BonePalette::Range range;
+        bool enabled = false;
     };
 
     friend class ::FilamentTest_Bones_Test;
@@ -166,8 +222,10 @@ private:
         LAYERS,             // user data
         MORPH_WEIGHTS,      // user data
         VISIBILITY,         // user data
-        PRIMITIVES,         // user data
-        BONES,              // filament data, UBO storing a pointer to the bones information
+        PRIMITIVES,         // user data, the primitives of all levels of detail, level by level
+        INSTANCES,          // user data
+        LODS,               // user data
+        BONES,              // filament data, range of the bones in the bone palette
     };
 
     using Base = utils::SingleInstanceComponentManager<
@@ -176,7 +234,9 @@ private:
             filament::math::float4,          // MORPH_WEIGHTS
             Visibility,                      // VISIBILITY
             utils::Slice<FRenderPrimitive>,  // PRIMITIVES
-            std::unique_ptr<Bones>           // BONES
+            uint16_t,                        // INSTANCES
+            LevelsOfDetail,                  // LODS
+            Bones                            // BONES
     >;
 
     struct Sim : public Base {
@@ -196,6 +256,8 @@ private:
                 Field<MORPH_WEIGHTS> morphWeights;
                 Field<VISIBILITY>   visibility;
                 Field<PRIMITIVES>   primitives;
+                Field<INSTANCES>    instances;
+                Field<LODS>         lods;
                 Field<BONES>        bones;
             };
         };
@@ -209,6 +271,8 @@ private:
     };
 
     Sim mManager;
+    BonePalette mBonePalette;
+    uint32_t mGeneration = 0;
     FEngine& mEngine;
 };
 
@@ -217,6 +281,7 @@ FILAMENT_UPCAST(RenderableManager)
 void FRenderableManager::setAxisAlignedBoundingBox(Instance instance, const Box& aabb) noexcept {
     if (instance) {
         mManager[instance].aabb = aabb;
+        mGeneration++;
     }
 }
 
@@ -262,6 +327,13 @@ void FRenderableManager::setScreenSpaceContactShadows(Instance instance, bool en
     }
 }
 
+void FRenderableManager::setOrderIndependentBlending(Instance instance, bool enable) noexcept {
+    if (instance) {
+        Visibility& visibility = mManager[instance].visibility;
+        visibility.orderIndependentBlending = enable;
+    }
+}
+
 void FRenderableManager::setCulling(Instance instance, bool enable) noexcept {
     if (instance) {
         Visibility& visibility = mManager[instance].visibility;
@@ -290,6 +362,26 @@ void FRenderableManager::setPrimitives(Instance instance,
     }
 }
 
+void FRenderableManager::setLevelsOfDetail(Instance instance,
+        LevelsOfDetail const& lod) noexcept {
+    if (instance) {
+        mManager[instance].lods = lod;
+    }
+}
+
+void FRenderableManager::setShadingLodScreenSize(Instance instance, float screenSize) noexcept {
+    if (instance) {
+        LevelsOfDetail& lod = mManager[instance].lods;
+        lod.shadingScreenSize = std::max(screenSize, 0.0f);
+    }
+}
+
+void FRenderableManager::setInstanceCount(Instance instance, uint16_t instanceCount) noexcept {
+    if (instance) {
+        mManager[instance].instances = instanceCount;
+    }
+}
+
 FRenderableManager::Visibility
 FRenderableManager::getVisibility(Instance instance) const noexcept {
     return mManager[instance].visibility;
@@ -319,28 +411,52 @@ filament::math::float4 FRenderableManager::getMorphWeights(Instance instance) co
     return mManager[instance].morphWeights;
 }
 
+uint16_t FRenderableManager::getInstanceCount(Instance instance) const noexcept {
+    return mManager[instance].instances;
+}
+
 Box const& FRenderableManager::getAABB(Instance instance) const noexcept {
     return mManager[instance].aabb;
 }
 
 backend::Handle<backend::HwUniformBuffer> FRenderableManager::getBonesUbh(Instance instance) const noexcept {
-    std::unique_ptr<Bones> const& bones = mManager[instance].bones;
-    return bones ? bones->handle : backend::Handle<backend::HwUniformBuffer>{};
+    Bones const& bones = mManager[instance].bones;
+    return bones.enabled ? mBonePalette.getHandle() : backend::Handle<backend::HwUniformBuffer>{};
+}
+
+uint16_t FRenderableManager::getBonesOffset(Instance instance) const noexcept {
+    Bones const& bones = mManager[instance].bones;
+    return BonePalette::getBindingOffset(bones.range);
 }
 
 inline uint32_t FRenderableManager::getBoneCount(Instance instance) const noexcept {
-    std::unique_ptr<Bones> const& bones = mManager[instance].bones;
-    return bones ? bones->count : 0;
+    Bones const& bones = mManager[instance].bones;
+    return bones.range.count;
+}
+
+size_t FRenderableManager::getLevelCount(Instance instance) const noexcept {
+    LevelsOfDetail const& lod = mManager[instance].lods;
+    return lod.count;
+}
+
+uint8_t FRenderableManager::selectLod(Instance instance, float screenSize) noexcept {
+    LevelsOfDetail& lod = mManager[instance].lods;
+    if (UTILS_LIKELY(lod.count == 1)) {
+        return 0;
+    }
+    lod.current = selectLod(lod, screenSize);
+    return lod.current;
 }
 
-utils::Slice<FRenderPrimitive> const& FRenderableManager::getRenderPrimitives(
-        Instance instance, uint8_t level) const noexcept {
-    return mManager[instance].primitives;
+bool FRenderableManager::selectReducedShading(Instance instance, float screenSize) noexcept {
+    LevelsOfDetail& lod = mManager[instance].lods;
+    lod.reducedShading = selectReducedShading(lod, screenSize);
+    return lod.reducedShading;
 }
 
-utils::Slice<FRenderPrimitive>& FRenderableManager::getRenderPrimitives(
-        Instance instance, uint8_t level) noexcept {
-    return mManager[instance].primitives;
+bool FRenderableManager::hasScreenSizeLod(Instance instance) const noexcept {
+    LevelsOfDetail const& lod = mManager[instance].lods;
+    return lod.count > 1 || lod.shadingScreenSize > 0.0f;
 }
 
 size_t FRenderableManager::getPrimitiveCount(Instance instance, uint8_t level) const noexcept {
@@ -16,9 +16,13 @@
 
 #include "components/TransformManager.h"
 
+#include <math/batch.h>
 #include <math/mat4.h>
 
 #include <utils/debug.h>
+#include <utils/Systrace.h>
+
+#include <algorithm>
 
 using namespace utils;
 using namespace filament::math;
@@ -33,13 +37,16 @@ void FTransformManager::terminate() noexcept {
 }
 
 void FTransformManager::create(Entity entity) {
-    create(entity, 0, {});
+    create(entity, 0, mat4f{});
 }
 
 void FTransformManager::create(Entity entity, Instance parent, const mat4f& localTransform) {
     // this always adds at the end, so all existing instances stay valid
     auto& manager = mManager;
 
+    // however consumers of the changes list need to learn about the new instance
+    invalidateChanges();
+
     // TODO: try to keep entries sorted with their siblings/parents to improve cache access
     if (UTILS_UNLIKELY(manager.hasComponent(entity))) {
         destroy(entity);
@@ -58,6 +65,22 @@ void FTransformManager::create(Entity entity, Instance parent, const mat4f& loca
     }
 }
 
+void FTransformManager::create(Entity entity, Instance parent, const mat4& localTransform) {
+    create(entity, parent, mat4f{});
+    Instance const i = mManager.getInstance(entity);
+    if (i) {
+        setTransform(i, localTransform);
+    }
+}
+
+void FTransformManager::create(size_t count, Entity const* entities, Instance parent) {
+    // grow the arrays once for the whole batch
+    mManager.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        create(entities[i], parent, mat4f{});
+    }
+}
+
 void FTransformManager::setParent(Instance i, Instance parent) noexcept {
     validateNode(i);
     if (i) {
@@ -125,6 +148,7 @@ void FTransformManager::destroy(Entity e) noexcept {
 
         // 2) remove the component
         Instance moved = manager.removeComponent(e);
+        invalidateChanges();
 
         // 3) update the references to the entry now with Instance i
         if (moved != i) {
@@ -139,10 +163,77 @@ void FTransformManager::setTransform(Instance ci, const mat4f& model) noexcept {
         auto& manager = mManager;
         // store our local transform
         manager[ci].local = model;
+        manager[ci].localTranslationLo = {};
         updateNodeTransform(ci);
     }
 }
 
+void FTransformManager::setTransform(Instance ci, const mat4& model) noexcept {
+    validateNode(ci);
+    if (ci) {
+        auto& manager = mManager;
+        // the translation is split in a float and the float residual of the double
+        mat4f local{ model };
+        const double3 t = model[3].xyz;
+        local[3].xyz = float3{ t };
+        manager[ci].local = local;
+        manager[ci].localTranslationLo = float3{ t - double3{ local[3].xyz }};
+        updateNodeTransform(ci);
+    }
+}
+
+void FTransformManager::setTransforms(Instance const* instances, const mat4f* models,
+        size_t count) noexcept {
+    // Setting a transform outside of a transaction updates the world transforms of its whole
+    // subtree right away. Past a fraction of all the components, recomputing every world
+    // transform once in a commit is cheaper.
+    const bool transaction = !mLocalTransformTransactionOpen &&
+            count * 4 >= mManager.getComponentCount();
+    if (transaction) {
+        openLocalTransformTransaction();
+    }
+    for (size_t i = 0; i < count; i++) {
+        setTransform(instances[i], models[i]);
+    }
+    if (transaction) {
+        commitLocalTransformTransaction();
+    }
+}
+
+void FTransformManager::setAccurateTranslationsEnabled(bool enable) noexcept {
+    if (enable != mAccurateTranslations) {
+        mAccurateTranslations = enable;
+        // all world transforms must be recomputed with the new precision
+        if (!mLocalTransformTransactionOpen) {
+            openLocalTransformTransaction();
+            commitLocalTransformTransaction();
+        }
+    }
+}
+
+void FTransformManager::computeAccurateTranslation(mat4f& world, float3& worldLo,
+        mat4f const& pt, float3 const& ptLo, mat4f const& local, float3 const& localLo) noexcept {
+    // the rotation/scale part is computed in float, only the translation needs the precision
+    const double3 t = mat3{ pt.upperLeft() } * (double3{ local[3].xyz } + double3{ localLo }) +
+            (double3{ pt[3].xyz } + double3{ ptLo });
+    world[3].xyz = float3{ t };
+    worldLo = float3{ t - double3{ world[3].xyz }};
+}
+
+void FTransformManager::computeWorldTransform(Instance i) noexcept {
+    auto& manager = mManager;
+    // note: by using the raw_array() we don't need to check that parent is valid.
+    Instance parent = manager[i].parent;
+    mat4f const& pt = manager.raw_array<WORLD>()[parent];
+    mat4f const& local = manager[i].local;
+    manager[i].world = pt * local;
+    if (UTILS_UNLIKELY(mAccurateTranslations)) {
+        computeAccurateTranslation(manager[i].world, manager[i].worldTranslationLo,
+                pt, manager.raw_array<WORLD_LO>()[parent],
+                local, manager[i].localTranslationLo);
+    }
+}
+
 void FTransformManager::updateNodeTransform(Instance i) noexcept {
     if (UTILS_UNLIKELY(mLocalTransformTransactionOpen)) {
         return;
@@ -152,21 +243,44 @@ void FTransformManager::updateNodeTransform(Instance i) noexcept {
     auto& manager = mManager;
     assert_invariant(i);
 
-    // find our parent's world transform, if any
-    // note: by using the raw_array() we don't need to check that parent is valid.
-    Instance parent = manager[i].parent;
-    mat4f const& pt = manager.raw_array<WORLD>()[parent];
-
-    // compute our world transform
-    manager[i].world = pt * static_cast<mat4f const&>(manager[i].local);
+    // compute our world transform from our parent's, if any
+    computeWorldTransform(i);
+    recordChange(i);
 
     // update our children's world transforms
     Instance child = manager[i].firstChild;
     if (UTILS_UNLIKELY(child)) { // assume we don't have a hierarchy in the common case
-        transformChildren(manager, child);
+        transformChildren(manager, child, mChangedInstances, mAccurateTranslations);
     }
 }
 
+void FTransformManager::recordChange(Instance i) noexcept {
+    // past a certain point, it's cheaper for consumers to consider everything changed
+    if (UTILS_UNLIKELY(mChangedInstances.size() >=
+            std::max(size_t(1024), mManager.getComponentCount()))) {
+        invalidateChanges();
+    }
+    mChangedInstances.push_back(i);
+}
+
+void FTransformManager::invalidateChanges() noexcept {
+    mChangedInstances.clear();
+    mChangeEpoch++;
+}
+
+bool FTransformManager::getChangedInstances(ChangeCursor& cursor,
+        Slice<const Instance>& changes) const noexcept {
+    const uint32_t size = uint32_t(mChangedInstances.size());
+    const bool valid = cursor.epoch == mChangeEpoch;
+    if (valid) {
+        changes = { mChangedInstances.data() + cursor.offset, size - cursor.offset };
+    } else {
+        changes = {};
+    }
+    cursor = { mChangeEpoch, size };
+    return valid;
+}
+
 void FTransformManager::openLocalTransformTransaction() noexcept {
     mLocalTransformTransactionOpen = true;
 }
@@ -176,11 +290,20 @@ void FTransformManager::commitLocalTransformTransaction() noexcept {
         mLocalTransformTransactionOpen = false;
         auto& manager = mManager;
 
+        // all world transforms are recomputed and instances can be reordered
+        invalidateChanges();
+
         // swapNode() below needs some temporary storage which we provide here
         auto& soa = manager.getSoA();
         soa.ensureCapacity(soa.size() + 1);
 
+        if (mJobSystem && manager.getComponentCount() >= PARALLEL_COMMIT_MIN_COUNT) {
+            commitLocalTransformTransactionParallel(*mJobSystem);
+            return;
+        }
+
         mat4f const* const UTILS_RESTRICT world = manager.raw_array<WORLD>();
+        float3 const* const UTILS_RESTRICT worldLo = manager.raw_array<WORLD_LO>();
         for (Instance i = manager.begin(), e = manager.end(); i != e; ++i) {
             // Ensure that children are always sorted after their parent.
             while (UTILS_UNLIKELY(Instance(manager[i].parent) > i)) {
@@ -188,8 +311,81 @@ void FTransformManager::commitLocalTransformTransaction() noexcept {
             }
             Instance parent = manager[i].parent;
             assert_invariant(parent < i);
-            manager[i].world = world[parent] * static_cast<mat4f const&>(manager[i].local);
+            mat4f const& local = manager[i].local;
+            mulMat4(manager[i].world, world[parent], local);
+            if (UTILS_UNLIKELY(mAccurateTranslations)) {
+                computeAccurateTranslation(manager[i].world, manager[i].worldTranslationLo,
+                        world[parent], worldLo[parent], local, manager[i].localTranslationLo);
+            }
+        }
+    }
+}
+
+void FTransformManager::commitLocalTransformTransactionParallel(JobSystem& js) noexcept {
+    SYSTRACE_CALL();
+
+    auto& manager = mManager;
+    const size_t count = manager.getComponentCount();
+
+    // Sort children after their parent, as in the serial version, and compute the depth of
+    // each node along the way; the parent of a node is always processed before it.
+    // Instance 0 is the "null" root, which has a depth of 0.
+    std::vector<uint32_t>& depths = mDepths;
+    depths.resize(count + 1);
+    depths[0] = 0;
+    uint32_t maxDepth = 0;
+    for (Instance i = manager.begin(), e = manager.end(); i != e; ++i) {
+        while (UTILS_UNLIKELY(Instance(manager[i].parent) > i)) {
+            swapNode(i, manager[i].parent);
         }
+        Instance parent = manager[i].parent;
+        assert_invariant(parent < i);
+        const uint32_t depth = depths[parent] + 1;
+        depths[i] = depth;
+        maxDepth = std::max(maxDepth, depth);
+    }
+
+    // bucket the nodes by depth (breadth-first order), with a counting sort
+    std::vector<uint32_t>& levels = mLevelOffsets;
+    levels.assign(maxDepth + 2, 0);
+    for (Instance i = manager.begin(), e = manager.end(); i != e; ++i) {
+        levels[depths[i] + 1]++;
+    }
+    for (size_t l = 1, c = levels.size(); l < c; l++) {
+        levels[l] += levels[l - 1];
+    }
+    std::vector<Instance>& order = mLevelOrder;
+    order.resize(count);
+    std::vector<uint32_t>& cursors = mLevelCursors;
+    cursors.assign(levels.begin(), levels.end());
+    for (Instance i = manager.begin(), e = manager.end(); i != e; ++i) {
+        order[cursors[depths[i]]++] = i;
+    }
+
+    // Process each level in parallel, parents are always in an earlier level.
+    auto& soa = manager.getSoA();
+    mat4f* const UTILS_RESTRICT world = soa.data<WORLD>();
+    mat4f const* const UTILS_RESTRICT local = soa.data<LOCAL>();
+    Instance const* const UTILS_RESTRICT parents = soa.data<PARENT>();
+    float3* const UTILS_RESTRICT worldLo = soa.data<WORLD_LO>();
+    float3 const* const UTILS_RESTRICT localLo = soa.data<LOCAL_LO>();
+    Instance const* const UTILS_RESTRICT levelOrder = order.data();
+    const bool accurate = mAccurateTranslations;
+    for (size_t l = 1, c = levels.size() - 1; l < c; l++) {
+        auto work = [=](uint32_t start, uint32_t n) {
+            for (uint32_t k = start, e = start + n; k < e; k++) {
+                const Instance i = levelOrder[k];
+                const Instance p = parents[i];
+                mulMat4(world[i], world[p], local[i]);
+                if (UTILS_UNLIKELY(accurate)) {
+                    computeAccurateTranslation(world[i], worldLo[i],
+                            world[p], worldLo[p], local[i], localLo[i]);
+                }
+            }
+        };
+        auto* job = jobs::parallel_for(js, nullptr, levels[l], levels[l + 1] - levels[l],
+                std::cref(work), jobs::CountSplitter<PARALLEL_COMMIT_BATCH_SIZE, 8>());
+        js.runAndWait(job);
     }
 }
 
@@ -227,6 +423,8 @@ void FTransformManager::swapNode(Instance i, Instance j) noexcept {
     // swap the content of the nodes directly
     std::swap(manager.elementAt<LOCAL>(i), manager.elementAt<LOCAL>(j));
     std::swap(manager.elementAt<WORLD>(i), manager.elementAt<WORLD>(j));
+    std::swap(manager.elementAt<LOCAL_LO>(i), manager.elementAt<LOCAL_LO>(j));
+    std::swap(manager.elementAt<WORLD_LO>(i), manager.elementAt<WORLD_LO>(j));
     manager.swap(i, j); // this swaps the data relative to SingleInstanceComponentManager
 
     // now swap the linked-list references, to do that correctly we must use a temporary
@@ -313,18 +511,24 @@ void FTransformManager::updateNode(Instance i) noexcept {
     validateNode(next);
 }
 
-void FTransformManager::transformChildren(Sim& manager, Instance ci) noexcept {
+void FTransformManager::transformChildren(Sim& manager, Instance ci,
+        std::vector<Instance>& changes, bool accurate) noexcept {
     while (ci) {
         // update child's world transform
         Instance parent = manager[ci].parent;
         mat4f const& pt = manager[parent].world;
         mat4f const& local = manager[ci].local;
         manager[ci].world = pt * local;
+        if (UTILS_UNLIKELY(accurate)) {
+            computeAccurateTranslation(manager[ci].world, manager[ci].worldTranslationLo,
+                    pt, manager[parent].worldTranslationLo, local, manager[ci].localTranslationLo);
+        }
+        changes.push_back(ci);
 
         // assume we don't have a deep hierarchy
         Instance child = manager[ci].firstChild;
         if (UTILS_UNLIKELY(child)) {
-            transformChildren(manager, child);
+            transformChildren(manager, child, changes, accurate);
         }
 
         // process our next child
@@ -374,11 +578,12 @@ void FTransformManager::validateNode(Instance i) noexcept {
 #endif
 }
 
-void FTransformManager::gc(utils::EntityManager& em) noexcept {
+void FTransformManager::gc(utils::EntityManager& em,
+        std::chrono::steady_clock::time_point deadline) noexcept {
     auto& manager = mManager;
     manager.gc(em, 4, [this](Entity e) {
                 destroy(e);
-            });
+            }, deadline);
 }
 
 TransformManager::children_iterator& TransformManager::children_iterator::operator++() {
@@ -387,6 +592,12 @@ TransformManager::children_iterator& TransformManager::children_iterator::operat
     return *this;
 }
 
+void FTransformManager::destroy(size_t count, Entity const* entities) noexcept {
+    for (size_t i = 0; i < count; i++) {
+        destroy(entities[i]);
+    }
+}
+
 // ------------------------------------------------------------------------------------------------
 // Trampoline calling into private implementation
 // ------------------------------------------------------------------------------------------------
@@ -395,14 +606,26 @@ void TransformManager::create(Entity entity, Instance parent, const mat4f& world
     upcast(this)->create(entity, parent, worldTransform);
 }
 
+void TransformManager::create(Entity entity, Instance parent, const mat4& worldTransform) {
+    upcast(this)->create(entity, parent, worldTransform);
+}
+
 void TransformManager::create(Entity entity, Instance parent) {
-    upcast(this)->create(entity, parent, {});
+    upcast(this)->create(entity, parent, mat4f{});
+}
+
+void TransformManager::create(size_t count, Entity const* entities, Instance parent) {
+    upcast(this)->create(count, entities, parent);
 }
 
 void TransformManager::destroy(Entity e) noexcept {
     upcast(this)->destroy(e);
 }
 
+void TransformManager::destroy(size_t count, Entity const* entities) noexcept {
+    upcast(this)->destroy(count, entities);
+}
+
 bool TransformManager::hasComponent(Entity e) const noexcept {
     return upcast(this)->hasComponent(e);
 }
@@ -415,6 +638,31 @@ void TransformManager::setTransform(Instance ci, const mat4f& model) noexcept {
     upcast(this)->setTransform(ci, model);
 }
 
+void TransformManager::setTransform(Instance ci, const mat4& model) noexcept {
+    upcast(this)->setTransform(ci, model);
+}
+
+void TransformManager::setTransforms(Instance const* instances, const mat4f* models,
+        size_t count) noexcept {
+    upcast(this)->setTransforms(instances, models, count);
+}
+
+void TransformManager::setAccurateTranslationsEnabled(bool enable) noexcept {
+    upcast(this)->setAccurateTranslationsEnabled(enable);
+}
+
+bool TransformManager::isAccurateTranslationsEnabled() const noexcept {
+    return upcast(this)->isAccurateTranslationsEnabled();
+}
+
+mat4 TransformManager::getTransformAccurate(Instance ci) const noexcept {
+    return upcast(this)->getTransformAccurate(ci);
+}
+
+mat4 TransformManager::getWorldTransformAccurate(Instance ci) const noexcept {
+    return upcast(this)->getWorldTransformAccurate(ci);
+}
+
 const mat4f& TransformManager::getTransform(Instance ci) const noexcept {
     return upcast(this)->getTransform(ci);
 }
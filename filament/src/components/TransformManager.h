@@ -24,10 +24,14 @@
 #include <utils/compiler.h>
 #include <utils/SingleInstanceComponentManager.h>
 #include <utils/Entity.h>
+#include <utils/JobSystem.h>
 #include <utils/Slice.h>
 
 #include <math/mat4.h>
 
+#include <chrono>
+#include <vector>
+
 namespace filament {
 
 class UTILS_PRIVATE FTransformManager : public TransformManager {
@@ -57,8 +61,14 @@ public:
 
     void create(utils::Entity entity, Instance parent, const math::mat4f& localTransform);
 
+    void create(utils::Entity entity, Instance parent, const math::mat4& localTransform);
+
+    void create(size_t count, utils::Entity const* entities, Instance parent);
+
     void destroy(utils::Entity e) noexcept;
 
+    void destroy(size_t count, utils::Entity const* entities) noexcept;
+
     void setParent(Instance i, Instance newParent) noexcept;
 
     utils::Entity getParent(Instance i) const noexcept;
@@ -75,14 +85,29 @@ public:
 
     void commitLocalTransformTransaction() noexcept;
 
-    void gc(utils::EntityManager& em) noexcept;
+    // When set, large hierarchies are updated in parallel, one tree level at a time,
+    // when a local transform transaction is committed.
+    void setJobSystem(utils::JobSystem* js) noexcept { mJobSystem = js; }
+
+    void gc(utils::EntityManager& em, std::chrono::steady_clock::time_point deadline) noexcept;
 
     utils::Slice<const math::mat4f> getWorldTransforms() const noexcept {
         return mManager.slice<WORLD>();
     }
 
+    void setAccurateTranslationsEnabled(bool enable) noexcept;
+
+    bool isAccurateTranslationsEnabled() const noexcept {
+        return mAccurateTranslations;
+    }
+
     void setTransform(Instance ci, const math::mat4f& model) noexcept;
 
+    void setTransform(Instance ci, const math::mat4& model) noexcept;
+
+    void setTransforms(Instance const* instances, const math::mat4f* models,
+            size_t count) noexcept;
+
     const math::mat4f& getTransform(Instance ci) const noexcept {
         return mManager[ci].local;
     }
@@ -91,6 +116,39 @@ public:
         return mManager[ci].world;
     }
 
+    math::mat4 getTransformAccurate(Instance ci) const noexcept {
+        math::float3 const& lo = mManager[ci].localTranslationLo;
+        math::mat4 local{ getTransform(ci) };
+        local[3].xyz += lo;
+        return local;
+    }
+
+    math::mat4 getWorldTransformAccurate(Instance ci) const noexcept {
+        math::mat4 world{ getWorldTransform(ci) };
+        if (mAccurateTranslations) {
+            math::float3 const& lo = mManager[ci].worldTranslationLo;
+            world[3].xyz += lo;
+        }
+        return world;
+    }
+
+    utils::Entity getEntity(Instance ci) const noexcept {
+        return mManager.getEntity(ci);
+    }
+
+    // Position of a consumer in the list of changed world transforms
+    struct ChangeCursor {
+        uint32_t epoch = 0;
+        uint32_t offset = 0;
+    };
+
+    // Returns the instances whose world transform changed since the last call with this cursor
+    // and advances it. An instance can appear more than once. Returns false if this information
+    // isn't available, because instances were destroyed or reordered in the meantime (or too
+    // many changes accumulated), in which case all instances must be considered changed.
+    bool getChangedInstances(ChangeCursor& cursor,
+            utils::Slice<const Instance>& changes) const noexcept;
+
 private:
     struct Sim;
 
@@ -98,9 +156,17 @@ private:
     void removeNode(Instance i) noexcept;
     void updateNode(Instance i) noexcept;
     void updateNodeTransform(Instance i) noexcept;
+    void computeWorldTransform(Instance i) noexcept;
     void insertNode(Instance i, Instance p) noexcept;
     void swapNode(Instance i, Instance j) noexcept;
-    static void transformChildren(Sim& manager, Instance firstChild) noexcept;
+    static void transformChildren(Sim& manager, Instance firstChild,
+            std::vector<Instance>& changes, bool accurate) noexcept;
+    static void computeAccurateTranslation(math::mat4f& world, math::float3& worldLo,
+            math::mat4f const& pt, math::float3 const& ptLo,
+            math::mat4f const& local, math::float3 const& localLo) noexcept;
+    void commitLocalTransformTransactionParallel(utils::JobSystem& js) noexcept;
+    void recordChange(Instance i) noexcept;
+    void invalidateChanges() noexcept;
 
     friend class TransformManager::children_iterator;
 
@@ -111,6 +177,8 @@ private:
         FIRST_CHILD,    // instance to our first child
         NEXT,           // instance to our next sibling
         PREV,           // instance to our previous sibling
+        LOCAL_LO,       // accurate local translation residual
+        WORLD_LO,       // accurate world translation residual
     };
 
     using Base = utils::SingleInstanceComponentManager<
@@ -119,7 +187,9 @@ private:
             Instance,
             Instance,
             Instance,
-            Instance
+            Instance,
+            math::float3,
+            math::float3
     >;
 
     struct Sim : public Base {
@@ -142,6 +212,8 @@ private:
                 Field<FIRST_CHILD>  firstChild;
                 Field<NEXT>         next;
                 Field<PREV>         prev;
+                Field<LOCAL_LO>     localTranslationLo;
+                Field<WORLD_LO>     worldTranslationLo;
             };
         };
 
@@ -155,6 +227,26 @@ private:
 
     Sim mManager;
     bool mLocalTransformTransactionOpen = false;
+
+    // when set, world translations are computed in double precision and stored as the sum
+    // of the float translation of LOCAL/WORLD and the float residual of LOCAL_LO/WORLD_LO.
+    bool mAccurateTranslations = false;
+
+    // instances whose world transform changed during the current epoch. A new epoch starts
+    // whenever instances are invalidated, or when the list grows larger than the instance count.
+    std::vector<Instance> mChangedInstances;
+    uint32_t mChangeEpoch = 1;
+
+    // below this many instances, committing a transaction is done serially
+    static constexpr size_t PARALLEL_COMMIT_MIN_COUNT = 4096;
+    static constexpr size_t PARALLEL_COMMIT_BATCH_SIZE = 256;
+
+    // scratch storage for the parallel commit, kept around to avoid allocations
+    utils::JobSystem* mJobSystem = nullptr;
+    std::vector<uint32_t> mDepths;
+    std::vector<uint32_t> mLevelOffsets;
+    std::vector<uint32_t> mLevelCursors;
+    std::vector<Instance> mLevelOrder;
 };
 
 FILAMENT_UPCAST(TransformManager)
@@ -42,13 +42,39 @@ public:
 
     void setBuffer(FEngine& engine, BufferDescriptor&& buffer, uint32_t byteOffset = 0);
 
+    void* map(FEngine& engine);
+
+    void unmap(FEngine& engine, uint32_t byteOffset, uint32_t byteCount);
+
     BindingType getBindingType() const noexcept { return mBindingType; }
 
+    BufferUsage getUsage() const noexcept { return mUsage; }
+
 private:
     friend class BufferObject;
+
+    // one region per frame in flight
+    static constexpr size_t REGION_COUNT = 3;
+
+    // Storage of map(). It's released by the last upload callback if the BufferObject is
+    // destroyed while regions are still in flight.
+    struct Storage {
+        uint8_t* data = nullptr;
+        size_t regionSize = 0;
+        bool busy[REGION_COUNT] = {};
+        bool terminated = false;
+    };
+
+    static void onRegionUploaded(void* buffer, size_t size, void* user);
+    static void releaseIfDone(Storage* storage) noexcept;
+
     backend::Handle<backend::HwBufferObject> mHandle;
     uint32_t mByteCount;
     BindingType mBindingType;
+    BufferUsage mUsage;
+    Storage* mStorage = nullptr;
+    uint8_t mCurrentRegion = 0;
+    bool mMapped = false;
 };
 
 FILAMENT_UPCAST(BufferObject)
@@ -84,6 +84,7 @@ public:
 
     // sets the camera's view matrix (must be a rigid transform)
     void setModelMatrix(const math::mat4f& modelMatrix) noexcept;
+    void setModelMatrix(const math::mat4& modelMatrix) noexcept;
 
     // sets the camera's view matrix
     void lookAt(const math::float3& eye, const math::float3& center, const math::float3& up = { 0, 1, 0 })  noexcept;
@@ -91,6 +92,9 @@ public:
     // returns the view matrix
     math::mat4f const& getModelMatrix() const noexcept;
 
+    // returns the view matrix with a double precision translation, if available
+    math::mat4 getModelMatrixAccurate() const noexcept;
+
     // returns the inverse of the view matrix
     math::mat4f getViewMatrix() const noexcept;
 
@@ -201,7 +205,7 @@ struct CameraInfo {
     CameraInfo() noexcept = default;
     explicit CameraInfo(FCamera const& camera) noexcept;
     CameraInfo(FCamera const& camera,
-            const math::mat4f& worldOriginCamera, float focusDistance) noexcept;
+            const math::mat4& worldOriginCamera, float focusDistance) noexcept;
 
     math::mat4f projection;         // projection matrix for drawing (infinite zfar)
     math::mat4f cullingProjection;  // projection matrix for culling
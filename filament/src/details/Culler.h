@@ -22,6 +22,7 @@
 #include <utils/compiler.h>
 #include <utils/Slice.h>
 
+#include <math/mat4.h>
 #include <math/vec4.h>
 #include <math/vec2.h>
 
@@ -79,6 +80,14 @@ public:
             Frustum const& frustum,
             math::float4 const& sphere) noexcept;
 
+    /*
+     * returns 'frustum' with each plane moved outwards just enough to contain all the frusta
+     * given by their clip-from-world matrices. The result is exactly the union of these frusta
+     * when they only differ by a translation, like the eyes of a stereo camera.
+     */
+    static Frustum enclose(Frustum const& frustum,
+            math::mat4 const* clipFromWorld, size_t count) noexcept;
+
 
     struct UTILS_PUBLIC Test {
         static void intersects(result_type* results,
@@ -91,6 +100,18 @@ public:
                 Frustum const& frustum,
                 math::float4 const* b,
                 size_t count) noexcept;
+
+        // portable implementations, used as a reference for the SIMD ones
+        static void intersectsGeneric(result_type* results,
+                Frustum const& frustum,
+                math::float3 const* c,
+                math::float3 const* e,
+                size_t count) noexcept;
+
+        static void intersectsGeneric(result_type* results,
+                Frustum const& frustum,
+                math::float4 const* b,
+                size_t count) noexcept;
     };
 };
 
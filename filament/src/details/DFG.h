@@ -40,11 +40,11 @@ public:
         return DFG_LUT_SIZE;
     }
 
-    bool isValid() const noexcept {
-        return mLUT != nullptr;
-    }
-
+    // the LUT is only uploaded the first time it's needed, which is when the first View is created
     backend::Handle<backend::HwTexture> getTexture() const noexcept {
+        if (UTILS_UNLIKELY(!mLUT)) {
+            mLUT = createLut();
+        }
         return mLUT->getHwHandle();
     }
 
@@ -56,8 +56,10 @@ public:
     DFG& operator=(DFG&& rhs) = delete;
 
 private:
+    FTexture* createLut() const noexcept;
+
     FEngine& mEngine;
-    FTexture* mLUT = nullptr;
+    mutable FTexture* mLUT = nullptr;
 
     // make sure to use the right size here
     static constexpr size_t DFG_LUT_SIZE = FILAMENT_DFG_LUT_SIZE;
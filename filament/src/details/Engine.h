@@ -37,6 +37,9 @@
 #include "details/Skybox.h"
 
 #include "private/backend/CommandStream.h"
+#if FILAMENT_ENABLE_COMMAND_CAPTURE
+#include "private/backend/CommandStreamCapture.h"
+#endif
 #include "private/backend/CommandBufferQueue.h"
 #include "private/backend/DriverApi.h"
 
@@ -70,11 +73,16 @@ class DebugServer;
 #include <utils/Allocator.h>
 #include <utils/JobSystem.h>
 #include <utils/CountDownLatch.h>
+#include <utils/Mutex.h>
 
+#include <atomic>
 #include <chrono>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <random>
 #include <unordered_map>
+#include <vector>
 
 namespace filament {
 
@@ -91,6 +99,7 @@ class FMaterialInstance;
 class FRenderer;
 class FScene;
 class FSwapChain;
+class FTexture;
 class FView;
 
 class DFG;
@@ -155,6 +164,10 @@ public:
     // Material IDs...
     uint32_t getMaterialId() const noexcept { return mMaterialId++; }
 
+    // Material instances were created or destroyed, or their pipeline state changed; their
+    // sorting keys are recomputed by the next prepare().
+    void invalidateMaterialSortingKeys() noexcept { mMaterialSortingKeysDirty = true; }
+
     const FMaterial* getDefaultMaterial() const noexcept { return mDefaultMaterial; }
     const FMaterial* getSkyboxMaterial() const noexcept;
     const FIndirectLight* getDefaultIndirectLight() const noexcept { return mDefaultIbl; }
@@ -214,6 +227,11 @@ public:
         return *mResourceAllocator;
     }
 
+    // textures built with Texture::Builder::streaming(), by their handle
+    using StreamedTextures = std::unordered_map<backend::HandleBase::HandleId, FTexture*>;
+    StreamedTextures& getStreamedTextures() noexcept { return mStreamedTextures; }
+    StreamedTextures const& getStreamedTextures() const noexcept { return mStreamedTextures; }
+
     void* streamAlloc(size_t size, size_t alignment) noexcept;
 
     Epoch getEngineEpoch() const { return mEngineEpoch; }
@@ -271,11 +289,109 @@ public:
 
     void destroy(utils::Entity e);
 
+    /*
+     * Deferred destructions are processed in order at the beginning of the following frames, up
+     * to the destruction budget per frame.
+     */
+    template<typename T>
+    void destroyDeferred(const T* p) {
+        if (p) {
+            mPendingDestructions.push_back([this, p]() { destroy(p); });
+        }
+    }
+
+    void destroyDeferred(utils::Entity const* entities, size_t count);
+
+    // destroys queued objects until at least budget nanoseconds are spent
+    void processDestructions(uint64_t budget);
+
+    void setDestructionBudget(uint64_t budget) noexcept { mDestructionBudget = budget; }
+    uint64_t getDestructionBudget() const noexcept { return mDestructionBudget; }
+
     void flushAndWait();
 
     // flush the current buffer
     void flush();
 
+    // number of bytes that can be recorded in the command stream between two flush()
+    size_t getCommandBufferCapacity() const noexcept {
+        return mCommandBufferQueue.getCapacity();
+    }
+
+    /*
+     * Buffer and texture uploads can be issued from any thread. On the engine thread they're
+     * recorded immediately, on other threads they're queued and recorded by the engine thread
+     * at the beginning of the following frames, up to the upload budget per frame.
+     */
+    template<typename T>
+    void upload(size_t size, T&& command) {
+        if (std::this_thread::get_id() == mMainThreadId) {
+            command(getDriverApi());
+        } else {
+            // the command is usually move-only (it owns a buffer descriptor)
+            queueUpload(size, [p = std::make_shared<std::decay_t<T>>(std::forward<T>(command))](
+                    DriverApi& driver) { (*p)(driver); });
+        }
+    }
+
+    // records queued uploads into the command stream, until at least budget bytes are recorded
+    void processUploads(size_t budget);
+
+    void setUploadBudget(size_t budget) noexcept { mUploadBudget = budget; }
+    size_t getUploadBudget() const noexcept { return mUploadBudget; }
+
+    void setAsynchronousProgramCompilation(bool enabled) noexcept {
+        mAsynchronousProgramCompilation = enabled;
+    }
+    bool isAsynchronousProgramCompilationEnabled() const noexcept {
+        return mAsynchronousProgramCompilation;
+    }
+
+    void setShaderSourceRelease(bool enabled) noexcept { mShaderSourceRelease = enabled; }
+    bool isShaderSourceReleaseEnabled() const noexcept { return mShaderSourceRelease; }
+
+    Engine::MemoryStats getMemoryStats() const noexcept;
+
+    void setMemoryBudget(size_t bytes, Engine::MemoryBudgetCallback callback,
+            void* user) noexcept {
+        mMemoryBudget = bytes;
+        mMemoryBudgetCallback = callback;
+        mMemoryBudgetUser = user;
+        mMemoryBudgetExceeded = false;
+    }
+
+    // calls the memory budget callback if the budget is newly exceeded, once per frame
+    void checkMemoryBudget();
+
+    // parses the material's package on a worker thread, the material is created and handed
+    // to the callback by processMaterialBuilds()
+    void buildMaterialAsync(Material::Builder const& builder,
+            Material::Builder::BuildCallback callback, void* user);
+
+    // creates the materials whose package has been parsed since the last call
+    void processMaterialBuilds();
+
+    // the callback is called by processCompilations() once the material's programs are ready
+    void addCompilationCallback(FMaterial const* material,
+            Material::CompilationCallback callback, void* user);
+
+    // calls the callbacks of the materials that are ready, once per frame
+    void processCompilations();
+
+    // records how much of the command stream was used since the last call, once per frame
+    void updateCommandBufferStatistics() noexcept;
+
+    Engine::StartupTimings getStartupTimings() const noexcept { return mStartupTimings; }
+
+    Engine::CommandBufferStatistics getCommandBufferStatistics() const noexcept {
+        return {
+                .capacity = mCommandBufferQueue.getCapacity(),
+                .highWatermark = mCommandBufferQueue.getHighWatermark(),
+                .lastFrameSize = mCommandBufferLastFrameSize,
+                .peakFrameSize = mCommandBufferPeakFrameSize
+        };
+    }
+
     /**
      * Processes the platform's event queue when called from the platform's event-handling thread.
      * Returns false when called from any other thread.
@@ -287,6 +403,10 @@ public:
     void prepare();
     void gc();
 
+    // Assigns a dense rank to all live material instances, ordered by material and pipeline
+    // state, and derives their sorting keys from it. Called by prepare() when needed.
+    void updateMaterialSortingKeys() noexcept;
+
     filaflat::ShaderBuilder& getVertexShaderBuilder() const noexcept {
         return mVertexShaderBuilder;
     }
@@ -355,11 +475,13 @@ private:
     ResourceList<FIndirectLight> mIndirectLights{ "IndirectLight" };
     ResourceList<FMaterial> mMaterials{ "Material" };
     ResourceList<FTexture> mTextures{ "Texture" };
+    StreamedTextures mStreamedTextures;
     ResourceList<FSkybox> mSkyboxes{ "Skybox" };
     ResourceList<FColorGrading> mColorGradings{ "ColorGrading" };
     ResourceList<FRenderTarget> mRenderTargets{ "RenderTarget" };
 
     mutable uint32_t mMaterialId = 0;
+    bool mMaterialSortingKeysDirty = true;
 
     // FMaterialInstance are handled directly by FMaterial
     std::unordered_map<const FMaterial*, ResourceList<FMaterialInstance>> mMaterialInstances;
@@ -369,6 +491,14 @@ private:
     std::thread mDriverThread;
     backend::CommandBufferQueue mCommandBufferQueue;
     DriverApi mCommandStream;
+#if FILAMENT_ENABLE_COMMAND_CAPTURE
+    // writes the driver commands to a file, see FEngine::init()
+    std::unique_ptr<backend::CommandStreamWriter> mCommandStreamWriter;
+#endif
+    size_t mCommandBufferFlushedSize = 0;
+    size_t mCommandBufferLastFrameSize = 0;
+    size_t mCommandBufferPeakFrameSize = 0;
+    Engine::StartupTimings mStartupTimings{};
 
     LinearAllocatorArena mPerRenderPassAllocator;
     HeapAllocatorArena mHeapAllocator;
@@ -395,6 +525,47 @@ private:
 
     std::thread::id mMainThreadId{};
 
+    using UploadCommand = std::function<void(DriverApi&)>;
+    void queueUpload(size_t size, UploadCommand command);
+
+    struct PendingUpload {
+        size_t size;
+        UploadCommand command;
+    };
+    utils::Mutex mUploadLock;
+    std::deque<PendingUpload> mPendingUploads;
+    std::atomic<size_t> mPendingUploadCount = 0;
+    size_t mUploadBudget = std::numeric_limits<size_t>::max();
+
+    using DestroyCommand = std::function<void()>;
+    std::deque<DestroyCommand> mPendingDestructions;
+    uint64_t mDestructionBudget = std::numeric_limits<uint64_t>::max();
+
+    bool mAsynchronousProgramCompilation = false;
+    bool mShaderSourceRelease = false;
+
+    size_t mMemoryBudget = 0;
+    Engine::MemoryBudgetCallback mMemoryBudgetCallback = nullptr;
+    void* mMemoryBudgetUser = nullptr;
+    bool mMemoryBudgetExceeded = false;
+
+    struct PendingCompilation {
+        FMaterial const* material;
+        Material::CompilationCallback callback;
+        void* user;
+    };
+    std::vector<PendingCompilation> mPendingCompilations;
+
+    struct PendingMaterialBuild {
+        Material::Builder builder;
+        Material::Builder::BuildCallback callback;
+        void* user;
+        utils::JobSystem::Job* job = nullptr;
+        MaterialParser* parser = nullptr;   // written by the job
+        std::atomic<bool> parsed = false;
+    };
+    std::vector<std::unique_ptr<PendingMaterialBuild>> mPendingMaterialBuilds;
+
 public:
     // these are the debug properties used by FDebug. They're accessed directly by modules who need them.
     struct {
@@ -418,6 +589,8 @@ public:
             // When set to true, the backend will attempt to capture the next frame and write the
             // capture to file. At the moment, only supported by the Metal backend.
             bool doFrameCapture = false;
+            // samples the hardware counters of the CPU phases, see Renderer::FrameTimings
+            bool performance_counters = false;
         } renderer;
         matdbg::DebugServer* server = nullptr;
     } debug;
@@ -99,7 +99,13 @@ public:
     // gpu buffer containing froxels. valid after construction.
     GPUBuffer const& getFroxelBuffer() const noexcept { return mFroxelBuffer; }
 
-    void setOptions(float zLightNear, float zLightFar) noexcept;
+    // froxelSliceCount is clamped to [2, FROXEL_SLICE_COUNT_MAX]. Fewer slices leave more
+    // froxels for the x-y plane, and fewer froxels use fewer light records.
+    void setOptions(float zLightNear, float zLightFar,
+            size_t froxelSliceCount = FEngine::CONFIG_FROXEL_SLICE_COUNT) noexcept;
+
+    // allows froxels to be rectangular, which makes better use of the froxel buffer
+    void setNonSquareFroxels(bool enabled) noexcept;
 
     /*
      * Allocate per-frame data structures for froxelization.
@@ -122,6 +128,9 @@ public:
     size_t getFroxelCountZ() const noexcept { return mFroxelCountZ; }
     size_t getFroxelCount() const noexcept { return mFroxelCount; }
 
+    // average number of lights per froxel, as of the last froxelizeLights()
+    float getAverageLightCount() const noexcept { return mAverageLightCount; }
+
     // update Records and Froxels texture with lights data. this is thread-safe.
     void froxelizeLights(FEngine& engine, CameraInfo const& camera,
             const FScene::LightSoa& lightData) noexcept;
@@ -158,9 +167,12 @@ public:
     const utils::Slice<FroxelEntry>& getFroxelBufferUser() const { return mFroxelBufferUser; }
     const utils::Slice<RecordBufferType>& getRecordBufferUser() const { return mRecordBufferUser; }
 
-    // this is chosen so froxelizePointAndSpotLight() vectorizes 4 froxel tests / spotlight
-    // with 256 lights this implies 8 jobs (256 / 32) for froxelization.
-    using LightGroupType = uint32_t;
+    // A group matches a word of LightRecord::bitset, so converting the per-job data to light
+    // records is a plain copy. With 256 lights this implies 4 jobs (256 / 64) for froxelization.
+    using LightGroupType = uint64_t;
+
+    // maximum number of slices that can be set with setOptions()
+    static constexpr size_t FROXEL_SLICE_COUNT_MAX = 64;
 
 private:
     struct LightRecord {
@@ -199,7 +211,7 @@ private:
     void froxelizeLoop(FEngine& engine,
             const CameraInfo& camera, const FScene::LightSoa& lightData) noexcept;
 
-    void froxelizeAssignRecordsCompress() noexcept;
+    void froxelizeAssignRecordsCompress(utils::JobSystem& js) noexcept;
 
     void froxelizePointAndSpotLight(FroxelThreadData& froxelThread, size_t bit,
             math::mat4f const& projection, const LightParams& light) const noexcept;
@@ -218,7 +230,7 @@ private:
 
     static void computeFroxelLayout(
             math::uint2* dim, uint16_t* countX, uint16_t* countY, uint16_t* countZ,
-            Viewport const& viewport) noexcept;
+            Viewport const& viewport, size_t froxelSliceCount, bool nonSquareFroxels) noexcept;
 
     // internal state dependant on the viewport and needed for froxelizing
     LinearAllocatorArena mArena;                    // ~256 KiB
@@ -234,6 +246,12 @@ private:
     // max 32 KiB  (actual: resolution dependant)
     utils::Slice<RecordBufferType> mRecordBufferUser;   //  64 KiB
     utils::Slice<LightRecord> mLightRecords;            // 256 KiB w/ 256 lights
+    utils::Slice<uint32_t> mRowRecordOffsets;           //   2 KiB w/ 16 froxels per row
+
+    // what was last uploaded to mFroxelBuffer and mRecordsBuffer
+    std::vector<FroxelEntry> mCommittedFroxels;
+    std::vector<RecordBufferType> mCommittedRecords;
+    uint32_t mRecordCount = 0;                          // records used by the last froxelization
 
     uint16_t mFroxelCountX = 0;
     uint16_t mFroxelCountY = 0;
@@ -257,6 +275,11 @@ private:
     float mNear = 0.0f;        // camera near
     float mZLightFar = FEngine::CONFIG_Z_LIGHT_FAR;
     float mZLightNear = FEngine::CONFIG_Z_LIGHT_NEAR;  // light near (first slice)
+    uint16_t mFroxelSliceCount = FEngine::CONFIG_FROXEL_SLICE_COUNT;
+    float mAverageLightCount = 0.0f;
+
+    bool mNonSquareFroxels = false;
+    bool mOutOfRecordsReported = false;
 
     // track if we need to update our internal state before froxelizing
     uint8_t mDirtyFlags = 0;
@@ -48,6 +48,8 @@ public:
     float getIntensity() const noexcept { return mIntensity; }
     void setIntensity(float intensity) noexcept { mIntensity = intensity; }
     void setRotation(math::mat3f const& rotation) noexcept { mRotation = rotation; }
+    void setReflections(FTexture const* cubemap) noexcept;
+    void setIrradiance(uint8_t bands, math::float3 const* sh) noexcept;
     const math::mat3f& getRotation() const noexcept { return mRotation; }
     FTexture const* getReflectionsTexture() const noexcept { return mReflectionsTexture; }
     FTexture const* getIrradianceTexture() const noexcept { return mIrradianceTexture; }
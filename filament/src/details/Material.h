@@ -18,6 +18,7 @@
 #define TNT_FILAMENT_DETAILS_MATERIAL_H
 
 #include "upcast.h"
+#include "UniformBufferArena.h"
 
 #include "details/MaterialInstance.h"
 
@@ -30,9 +31,13 @@
 
 #include <filaflat/ShaderBuilder.h>
 
+#include <utils/bitset.h>
 #include <utils/compiler.h>
+#include <utils/Mutex.h>
 
 #include <atomic>
+#include <utility>
+#include <vector>
 
 namespace filament {
 
@@ -53,6 +58,15 @@ public:
 
     void terminate(FEngine& engine);
 
+    // parses the package given to the builder, can be called from any thread.
+    // returns nullptr on failure.
+    static MaterialParser* parse(backend::Backend backend, Material::Builder const& builder);
+
+    // creates a material from the parser returned by parse(), which it takes ownership of.
+    // returns nullptr on failure.
+    static FMaterial* create(FEngine& engine, Material::Builder& builder,
+            MaterialParser* materialParser);
+
     // return the uniform interface block for this material
     const UniformInterfaceBlock& getUniformInterfaceBlock() const noexcept {
         return mUniformInterfaceBlock;
@@ -77,9 +91,12 @@ public:
 
     FEngine& getEngine() const noexcept  { return mEngine; }
 
+    // the uniform buffers shared by all the instances of this material
+    UniformBufferArena& getInstanceUniformArena() const noexcept { return mInstanceUniforms; }
+
     backend::Handle<backend::HwProgram> getProgram(uint8_t variantKey) const noexcept {
 #if FILAMENT_ENABLE_MATDBG
-        if (UTILS_UNLIKELY(mPendingEdits.load())) {
+        if (UTILS_UNLIKELY(mPendingEdits.load() || !mEditedPrograms.empty())) {
             const_cast<FMaterial*>(this)->applyPendingEdits();
         }
 #endif
@@ -91,8 +108,28 @@ public:
     backend::Handle<backend::HwProgram> createAndCacheProgram(backend::Program&& p,
             uint8_t variantKey) const noexcept;
 
+    // true if the program of this variant, which must have been created by getProgram(), can be
+    // used without waiting for its compilation
+    bool isProgramReady(uint8_t variantKey) const noexcept {
+        return UTILS_LIKELY(mReadyPrograms[variantKey]) || isProgramReadySlow(variantKey);
+    }
+
+    // true if all the programs created so far can be used without waiting
+    bool isReady() const noexcept;
+
+    // creates the programs of the selected variants, see Material::compile()
+    void compile(UserVariantFilterMask variants,
+            Material::CompilationCallback callback, void* user) noexcept;
+
     bool isVariantLit() const noexcept { return mIsVariantLit; }
 
+    // variant bits this material always has set in its color variants
+    uint8_t getFoldedVariants() const noexcept { return mFoldedVariants; }
+
+    // whether the depth variants can write the object id for View::pick(), materials built
+    // before picking existed can't
+    bool hasPickingVariant() const noexcept { return mHasPickingVariant; }
+
     const utils::CString& getName() const noexcept { return mName; }
     backend::RasterState getRasterState() const noexcept  { return mRasterState; }
     uint32_t getId() const noexcept { return mMaterialId; }
@@ -146,9 +183,10 @@ public:
      * @{
      */
 
-    /** Replaces the material package. */
+    /** Replaces the material package, in which the given shader was edited. */
     static void onEditCallback(void* userdata, const utils::CString& name, const void* packageData,
-            size_t packageSize);
+            size_t packageSize, backend::ShaderModel shaderModel, uint8_t variant,
+            backend::ShaderType stage);
 
     /** Queries the program cache to check which variants are resident. */
     static void onQueryCallback(void* userdata, uint64_t* pVariants);
@@ -157,16 +195,29 @@ public:
 
 private:
     backend::Handle<backend::HwProgram> getProgramSlow(uint8_t variantKey) const noexcept;
-    backend::Handle<backend::HwProgram> getSurfaceProgramSlow(uint8_t variantKey) const noexcept;
-    backend::Handle<backend::HwProgram> getPostProcessProgramSlow(uint8_t variantKey) const noexcept;
+    void releaseShaderSources() const noexcept;
+    backend::Program getProgramBuilder(uint8_t variantKey) const noexcept;
+    backend::Program getSurfaceProgramBuilder(uint8_t variantKey) const noexcept;
+    backend::Program getPostProcessProgramBuilder(uint8_t variantKey) const noexcept;
+    bool isProgramReadySlow(uint8_t variantKey) const noexcept;
+
+    // true if the material package has the shaders of this variant for the current backend
+    bool hasVariant(uint8_t variantKey) const noexcept;
+
+    // false for the depth variants shared with the default material
+    bool ownsProgram(uint8_t variantKey) const noexcept;
 
     // try to order by frequency of use
     mutable std::array<backend::Handle<backend::HwProgram>, VARIANT_COUNT> mCachedPrograms;
 
+    // one bit per variant whose program is known to be compiled
+    mutable utils::bitset<uint64_t, VARIANT_COUNT / 64> mReadyPrograms;
+
     backend::RasterState mRasterState;
     BlendingMode mRenderBlendingMode = BlendingMode::OPAQUE;
     TransparencyMode mTransparencyMode = TransparencyMode::DEFAULT;
     bool mIsVariantLit = false;
+    uint8_t mFoldedVariants = 0;
     Shading mShading = Shading::UNLIT;
 
     BlendingMode mBlendingMode = BlendingMode::OPAQUE;
@@ -178,6 +229,7 @@ private:
     RefractionMode mRefractionMode = RefractionMode::NONE;
     RefractionType mRefractionType = RefractionType::SOLID;
     uint64_t mMaterialProperties = 0;
+    uint64_t mCacheId = 0;
 
     float mMaskThreshold = 0.4f;
     float mSpecularAntiAliasingVariance = 0.0f;
@@ -188,8 +240,11 @@ private:
     bool mHasShadowMultiplier = false;
     bool mHasCustomDepthShader = false;
     bool mIsDefaultMaterial = false;
+    bool mHasPickingVariant = false;
     bool mSpecularAntiAliasing = false;
 
+    // must be declared before mDefaultInstance, which allocates from it
+    mutable UniformBufferArena mInstanceUniforms;
     FMaterialInstance mDefaultInstance;
     SamplerInterfaceBlock mSamplerInterfaceBlock;
     UniformInterfaceBlock mUniformInterfaceBlock;
@@ -202,6 +257,14 @@ private:
     mutable uint32_t mMaterialInstanceId = 0;
     MaterialParser* mMaterialParser = nullptr;
     std::atomic<MaterialParser*> mPendingEdits = {};
+
+    // shaders edited in mPendingEdits, indexed by their filtered variant key
+    utils::Mutex mPendingEditsLock;
+    utils::bitset<uint64_t, VARIANT_COUNT / 64> mEditedVertexShaders;
+    utils::bitset<uint64_t, VARIANT_COUNT / 64> mEditedFragmentShaders;
+
+    // programs rebuilt after an edit, each replaces the cached program of its variant once ready
+    std::vector<std::pair<uint8_t, backend::Handle<backend::HwProgram>>> mEditedPrograms;
 };
 
 
@@ -19,6 +19,7 @@
 
 #include "upcast.h"
 #include "UniformBuffer.h"
+#include "UniformBufferArena.h"
 #include "details/Engine.h"
 
 #include "private/backend/DriverApi.h"
@@ -52,18 +53,36 @@ public:
     }
 
     void use(FEngine::DriverApi& driver) const {
-        if (mUbHandle) {
-            driver.bindUniformBuffer(BindingPoints::PER_MATERIAL_INSTANCE, mUbHandle);
+        if (mUbSlot.buffer) {
+            driver.bindUniformBufferRange(BindingPoints::PER_MATERIAL_INSTANCE,
+                    mUbSlot.buffer, mUbSlot.offset, mUniforms.getSize());
         }
         if (mSbHandle) {
             driver.bindSamplers(BindingPoints::PER_MATERIAL_INSTANCE, mSbHandle);
         }
     }
 
+    // whether use() binds a uniform buffer, and a sampler group
+    bool hasUniformBuffer() const noexcept { return bool(mUbSlot.buffer); }
+    bool hasSamplers() const noexcept { return bool(mSbHandle); }
+
     FMaterial const* getMaterial() const noexcept { return mMaterial; }
 
     uint64_t getSortingKey() const noexcept { return mMaterialSortingKey; }
 
+    // Sets the dense rank of this instance among all live instances, see
+    // FEngine::updateMaterialSortingKeys()
+    void setSortingRank(uint32_t rank) noexcept;
+
+    // unique among the instances of a material, in creation order
+    uint32_t getInstanceId() const noexcept { return mInstanceId; }
+
+    // the raster state this instance can override, used to group instances by pipeline state
+    uint32_t getPipelineStateKey() const noexcept {
+        return uint32_t(mCulling) << 5u | uint32_t(mColorWrite) << 4u |
+                uint32_t(mDepthWrite) << 3u | uint32_t(mDepthFunc);
+    }
+
     UniformBuffer const& getUniformBuffer() const noexcept { return mUniforms; }
     backend::SamplerGroup const& getSamplerGroup() const noexcept { return mSamplers; }
 
@@ -106,11 +125,11 @@ public:
 
     void setDoubleSided(bool doubleSided) noexcept;
 
-    void setCullingMode(CullingMode culling) noexcept { mCulling = culling; }
+    void setCullingMode(CullingMode culling) noexcept;
 
-    void setColorWrite(bool enable) noexcept { mColorWrite = enable; }
+    void setColorWrite(bool enable) noexcept;
 
-    void setDepthWrite(bool enable) noexcept { mDepthWrite = enable; }
+    void setDepthWrite(bool enable) noexcept;
 
     void setDepthCulling(bool enable) noexcept;
 
@@ -137,6 +156,14 @@ private:
     template<typename T>
     void setParameterImpl(const char* name, const T* value, size_t count) noexcept;
 
+    template<size_t Size>
+    static void setParameterBatchUntypedImpl(const char* name,
+            MaterialInstance* const* instances, const void* values, size_t count) noexcept;
+
+    template<typename T>
+    static void setParameterBatchImpl(const char* name,
+            MaterialInstance* const* instances, const T* values, size_t count) noexcept;
+
     void setParameterImpl(const char* name,
             Texture const* texture, TextureSampler const& sampler) noexcept;
 
@@ -148,7 +175,7 @@ private:
 
     // keep these grouped, they're accessed together in the render-loop
     FMaterial const* mMaterial = nullptr;
-    backend::Handle<backend::HwUniformBuffer> mUbHandle;
+    UniformBufferArena::Slot mUbSlot;
     backend::Handle<backend::HwSamplerGroup> mSbHandle;
 
     UniformBuffer mUniforms;
@@ -160,6 +187,7 @@ private:
     backend::RasterState::DepthFunc mDepthFunc;
 
     uint64_t mMaterialSortingKey = 0;
+    uint32_t mInstanceId = 0;
 
     // Scissor rectangle is specified as: Left Bottom Width Height.
     backend::Viewport mScissorRect = { 0, 0,
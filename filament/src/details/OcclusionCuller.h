@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DETAILS_OCCLUSIONCULLER_H
+#define TNT_FILAMENT_DETAILS_OCCLUSIONCULLER_H
+
+#include "details/Culler.h"
+
+#include <utils/compiler.h>
+
+#include <math/mat4.h>
+#include <math/vec2.h>
+#include <math/vec3.h>
+
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+
+/*
+ * OcclusionCuller tests AABBs against a hierarchical-z (Hi-Z) pyramid built from a depth buffer
+ * captured in a previous frame.
+ *
+ * The depth buffer's first row is at the bottom of the screen (i.e. as returned by readPixels),
+ * and its encoding is given by setDepth()'s 'ndcToDepth', so both standard and reversed-z depth
+ * buffers are supported. Each Hi-Z texel stores the farthest depth of the texels it covers, so
+ * that a box is occluded only if its nearest point is behind everything covering its
+ * screen-space footprint.
+ *
+ * Boxes are tested against the transform that was used to render the depth buffer, which means
+ * the result is always consistent with the captured frame; the only source of false negatives
+ * is the latency between that frame and the current one, which is bounded by MAX_LATENCY.
+ */
+class UTILS_PUBLIC OcclusionCuller {
+public:
+    // Maximum age, in frames, of a depth buffer before it's considered too old to be used.
+    // A depth buffer which hasn't arrived by then leaves everything visible.
+    static constexpr uint32_t MAX_LATENCY = 1;
+
+    /*
+     * Builds the Hi-Z pyramid from a 'width' x 'height' float depth buffer, rendered using the
+     * 'worldToClip' (i.e. projection * view) transform, during frame 'frame' (see getFrame()).
+     *
+     * 'worldToClip' produces GL convention clip-space coordinates (z in [-w, w]), which the
+     * depth buffer stores as (z / w) * ndcToDepth.x + ndcToDepth.y. A negative ndcToDepth.x
+     * means reversed-z.
+     */
+    void setDepth(float const* depth, uint32_t width, uint32_t height,
+            math::mat4f const& worldToClip, math::float2 ndcToDepth, uint32_t frame) noexcept;
+
+    // Drops the current Hi-Z pyramid, nothing is culled until setDepth() is called again.
+    void invalidate() noexcept;
+
+    // Returns whether a recent enough Hi-Z pyramid is available.
+    bool hasDepth() const noexcept {
+        return mLevelCount && (mFrame - mDepthFrame) <= MAX_LATENCY;
+    }
+
+    // Must be called once per frame, before culling.
+    void advance() noexcept { mFrame++; }
+
+    // Returns the current frame, i.e. the number of calls to advance().
+    uint32_t getFrame() const noexcept { return mFrame; }
+
+    /*
+     * Clears 'bit' in 'results' for each AABB fully occluded by the Hi-Z pyramid.
+     * Entries which don't have 'bit' set are skipped.
+     */
+    void cull(Culler::result_type* results,
+            math::float3 const* center,
+            math::float3 const* extent,
+            size_t count, size_t bit) const noexcept;
+
+    // Returns whether the given AABB is fully occluded.
+    bool isOccluded(math::float3 const& center, math::float3 const& extent) const noexcept;
+
+    // Returns false if a recent enough Hi-Z pyramid is available and none of its texels is at
+    // the far plane, i.e. nothing at infinity (such as the skybox) was visible.
+    bool isFarPlaneVisible() const noexcept {
+        // the last level holds the farthest depth of the whole buffer
+        return !hasDepth() || mDepth[mLevels[mLevelCount - 1].offset] <= mFarDepth;
+    }
+
+private:
+    struct Level {
+        uint32_t offset;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    static constexpr size_t MAX_LEVEL_COUNT = 16;
+
+    float fetch(Level const& level, uint32_t x, uint32_t y) const noexcept {
+        return mDepth[level.offset + y * level.width + x];
+    }
+
+    // the pyramid is always stored with increasing values towards the camera, see setDepth()
+    float toPyramid(float depth) const noexcept {
+        return mReversedZ ? depth : -depth;
+    }
+
+    std::vector<float> mDepth;
+    Level mLevels[MAX_LEVEL_COUNT] = {};
+    math::mat4f mWorldToClip;
+    math::float2 mNdcToDepth = { -0.5f, 0.5f };
+    float mFarDepth = 0.0f;
+    bool mReversedZ = true;
+    uint32_t mLevelCount = 0;
+    uint32_t mFrame = 0;
+    uint32_t mDepthFrame = 0;
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_DETAILS_OCCLUSIONCULLER_H
@@ -54,6 +54,9 @@ public:
     AttributeBitset getEnabledAttributes() const noexcept { return mEnabledAttributes; }
     uint16_t getBlendOrder() const noexcept { return mBlendOrder; }
 
+    // number of points, lines or triangles drawn by this primitive (per instance)
+    uint32_t getPrimitiveCount() const noexcept { return mPrimitiveCount; }
+
     void setMaterialInstance(FMaterialInstance const* mi) noexcept { mMaterialInstance = mi; }
     void setBlendOrder(uint16_t order) noexcept {
         mBlendOrder = static_cast<uint16_t>(order & 0x7FFF);
@@ -65,6 +68,9 @@ private:
     backend::PrimitiveType mPrimitiveType = backend::PrimitiveType::NONE;
     AttributeBitset mEnabledAttributes;
     uint16_t mBlendOrder = 0;
+    uint32_t mPrimitiveCount = 0;
+
+    static uint32_t getPrimitiveCount(backend::PrimitiveType type, size_t count) noexcept;
 };
 
 } // namespace filament
@@ -44,6 +44,8 @@
 
 #include <tsl/robin_set.h>
 
+#include <vector>
+
 namespace filament {
 
 namespace backend {
@@ -53,6 +55,7 @@ class Driver;
 class View;
 
 class FEngine;
+class FFence;
 class FRenderTarget;
 class FView;
 class ShadowMap;
@@ -84,6 +87,9 @@ public:
             backend::FrameScheduledCallback callback, void* user);
     void endFrame();
 
+    void renderBatch(FSwapChain* swapChain, BatchJob const* jobs, size_t count,
+            BatchOptions const& options);
+
     void resetUserTime();
 
     void readPixels(uint32_t xoffset, uint32_t yoffset, uint32_t width, uint32_t height,
@@ -122,9 +128,28 @@ public:
         mClearOptions = options;
     }
 
+    void setDamageRegions(Viewport const* regions, size_t count);
+
+    void setPassTimingsEnabled(bool enabled) noexcept {
+        mFrameInfoManager.setPassTimingsEnabled(enabled);
+    }
+
+    FrameTimings getFrameTimings() const noexcept {
+        return mFrameInfoManager.getFrameTimings();
+    }
+
+    void setRenderStatsEnabled(bool enabled) noexcept {
+        mRenderStatsEnabled = enabled;
+    }
+
+    RenderStats getRenderStats() const noexcept {
+        return mRenderStats;
+    }
+
 private:
     friend class Renderer;
     using Command = RenderPass::Command;
+    using PrimitiveInfo = RenderPass::PrimitiveInfo;
 
     void getRenderTarget(FView const& view,
             backend::TargetBufferFlags& outAttachementMask,
@@ -144,6 +169,7 @@ private:
         math::float4 clearColor = {};
         float refractionLodOffset;
         bool hasContactShadows;
+        backend::ShadingRate shadingRate = backend::ShadingRate::RATE_1X1;
     };
 
     FrameGraphId<FrameGraphTexture> colorPass(FrameGraph& fg, const char* name,
@@ -162,7 +188,7 @@ private:
     }
 
     size_t getCommandsHighWatermark() const noexcept {
-        return mCommandsHighWatermark * sizeof(RenderPass::Command);
+        return mCommandsHighWatermark * (sizeof(Command) + sizeof(PrimitiveInfo));
     }
 
     backend::TextureFormat getHdrFormat(const View& view, bool translucent) const noexcept;
@@ -182,11 +208,16 @@ private:
     // keep a reference to our engine
     FEngine& mEngine;
     FrameSkipper mFrameSkipper;
+    // fences of the renderBatch() jobs the GPU may still be working on, oldest first
+    std::vector<FFence*> mBatchFences;
     backend::Handle<backend::HwRenderTarget> mRenderTarget;
     FSwapChain* mSwapChain = nullptr;
     size_t mCommandsHighWatermark = 0;
     uint32_t mFrameId = 0;
     FrameInfoManager mFrameInfoManager;
+    RenderStats mRenderStats;           // counts of the last frame
+    RenderStats mCurrentRenderStats;    // counts of the frame being rendered
+    bool mRenderStatsEnabled = false;
     backend::TextureFormat mHdrTranslucent{};
     backend::TextureFormat mHdrQualityMedium{};
     backend::TextureFormat mHdrQualityHigh{};
@@ -195,14 +226,21 @@ private:
     math::float4 mShaderUserTime{};
     DisplayInfo mDisplayInfo;
     FrameRateOptions mFrameRateOptions;
+    clock::time_point mBeginFrameTime{};
+    duration mCpuFrameTime{};
+    uint32_t mPresentationLatency = 2;  // in frames, see beginFrame()
     ClearOptions mClearOptions;
     backend::TargetBufferFlags mDiscardedFlags{};
     backend::TargetBufferFlags mClearFlags{};
+    Viewport mDamageRegion{};   // bounding rectangle of the damage, empty for the whole frame
     tsl::robin_set<FRenderTarget*> mPreviousRenderTargets;
     std::function<void()> mBeginFrameInternal;
 
     // per-frame arena for this Renderer
     LinearAllocatorArena& mPerRenderPassArena;
+
+    // FrameGraph arena, rewound after each view is rendered so frames don't hit the heap
+    LinearAllocatorArena mFrameGraphArena;
 };
 
 FILAMENT_UPCAST(Renderer)
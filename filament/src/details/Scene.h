@@ -23,6 +23,7 @@
 #include "components/TransformManager.h"
 
 #include "details/Culler.h"
+#include "details/SceneBvh.h"
 
 #include "Allocators.h"
 
@@ -37,6 +38,8 @@
 #include <utils/debug.h>
 
 #include <cstddef>
+#include <vector>
+
 #include <tsl/robin_set.h>
 
 namespace filament {
@@ -71,6 +74,9 @@ public:
     size_t getLightCount() const noexcept;
     bool hasEntity(utils::Entity entity) const noexcept;
 
+    void setBoundingVolumeHierarchyEnabled(bool enabled) noexcept;
+    bool isBoundingVolumeHierarchyEnabled() const noexcept { return mBvhEnabled; }
+
 public:
     /*
      * Filaments-scope Public API
@@ -84,7 +90,14 @@ public:
     ~FScene() noexcept;
     void terminate(FEngine& engine);
 
-    void prepare(const math::mat4f& worldOriginTransform);
+    void prepare(const math::mat4& worldOriginTransform, uint32_t frameId);
+
+    // whether the renderables were already prepared during frame 'frameId', e.g. by another View,
+    // in which case preparing them again with the same world origin is almost free.
+    bool isPrepared(uint32_t frameId) const noexcept {
+        return mRenderableDataValid && mFrameId == frameId;
+    }
+    math::mat4 const& getWorldOriginTransform() const noexcept { return mWorldOriginTransform; }
     void prepareDynamicLights(const CameraInfo& camera, ArenaScope& arena, backend::Handle<backend::HwUniformBuffer> lightUbh) noexcept;
 
 
@@ -101,12 +114,16 @@ public:
     enum {
         RENDERABLE_INSTANCE,    //  4 | instance of the Renderable component
         WORLD_TRANSFORM,        // 16 | instance of the Transform component
+        PREVIOUS_WORLD_TRANSFORM, // 16 | WORLD_TRANSFORM of the previous frame, for motion vectors
+        NORMAL_TRANSFORM,       //  9 | normalized normal transform, for the UBO
         REVERSED_WINDING_ORDER, //  1 | det(WORLD_TRANSFORM)<0
         VISIBILITY_STATE,       //  1 | visibility data of the component
         BONES_UBH,              //  4 | bones uniform buffer handle
+        BONES_OFFSET,           //  2 | offset of the bones in BONES_UBH
         WORLD_AABB_CENTER,      // 12 | world-space bounding box center of the renderable
         VISIBLE_MASK,           //  1 | each bit represents a visibility in a pass
         MORPH_WEIGHTS,          //  4 | floats for morphing
+        INSTANCES,              //  2 | instance count
 
         // These are not needed anymore after culling
         LAYERS,                 //  1 | layers
@@ -120,12 +137,16 @@ public:
     using RenderableSoa = utils::StructureOfArrays<
             utils::EntityInstance<RenderableManager>,   // RENDERABLE_INSTANCE
             math::mat4f,                                // WORLD_TRANSFORM
+            math::mat4f,                                // PREVIOUS_WORLD_TRANSFORM
+            math::mat3f,                                // NORMAL_TRANSFORM
             bool,                                       // REVERSED_WINDING_ORDER
             FRenderableManager::Visibility,             // VISIBILITY_STATE
             backend::Handle<backend::HwUniformBuffer>,  // BONES_UBH
+            uint16_t,                                   // BONES_OFFSET
             math::float3,                               // WORLD_AABB_CENTER
             VisibleMaskType,                            // VISIBLE_MASK
             math::float4,                               // MORPH_WEIGHTS
+            uint16_t,                                   // INSTANCES
             uint8_t,                                    // LAYERS
             math::float3,                               // WORLD_AABB_EXTENT
             utils::Slice<FRenderPrimitive>,             // PRIMITIVES
@@ -182,7 +203,8 @@ public:
         LIGHT_INSTANCE,
         VISIBILITY,
         SCREEN_SPACE_Z_RANGE,
-        SHADOW_INFO
+        SHADOW_INFO,
+        INTENSITY_SCALE
     };
 
     using LightSoa = utils::StructureOfArrays<
@@ -191,7 +213,8 @@ public:
             FLightManager::Instance,
             Culler::result_type,
             math::float2,
-            ShadowInfo
+            ShadowInfo,
+            float
     >;
 
     LightSoa const& getLightData() const noexcept { return mLightData; }
@@ -199,9 +222,30 @@ public:
 
     void updateUBOs(utils::Range<uint32_t> visibleRenderables, backend::Handle<backend::HwUniformBuffer> renderableUbh) noexcept;
 
+    /*
+     * Hierarchy of the world AABBs of the renderables, nullptr when it's disabled. The rows of
+     * its items are given by getRenderableRows(), which is only valid until the RenderableSoa
+     * is reordered, i.e. between prepare() and the partitioning of the renderables by a View.
+     */
+    SceneBvh const* getBvh() const noexcept { return mBvhEnabled ? &mBvh : nullptr; }
+    uint32_t const* getRenderableRows() const noexcept { return mRenderableRows.data(); }
+
     bool hasContactShadows() const noexcept;
 
 private:
+    void rebuildRenderableData(const math::mat4& worldOriginTransform, bool newFrame);
+    void prepareBvh();
+    bool updateRenderableData(const math::mat4& worldOriginTransform,
+            utils::Slice<const FTransformManager::Instance> changes, bool newFrame) noexcept;
+    void prepareLights(const math::mat4& worldOriginTransform,
+            utils::Slice<const FTransformManager::Instance> transformChanges,
+            utils::Slice<const FLightManager::Instance> lightChanges);
+    void updateLightWorldData(size_t row, const math::mat4& worldOriginTransform) noexcept;
+    static math::mat4f getWorldTransform(FTransformManager const& tcm,
+            FTransformManager::Instance ti, math::mat4 const& worldOriginTransform) noexcept;
+    static math::mat3f getNormalTransform(math::mat4f const& model,
+            bool reversedWindingOrder) noexcept;
+
     static inline void computeLightRanges(math::float2* zrange,
             CameraInfo const& camera, const math::float4* spheres, size_t count) noexcept;
 
@@ -225,9 +269,30 @@ private:
      * views, the data below is updated for each view.
      * In essence, this data should be owned by View, but it's so scene-specific, that for now
      * we store it here.
+     *
+     * mRenderableData persists across frames and is only patched where transforms changed,
+     * until something invalidates it (e.g. entities or components added or removed).
      */
     RenderableSoa mRenderableData;
     LightSoa mLightData;
+    std::vector<utils::Entity> mLightEntities;      // entities with a light component
+    std::vector<FLightManager::Instance> mLightInstances;   // light instances by row
+    std::vector<math::float4> mLightSpheres;        // world position and radius of lights by row
+    std::vector<math::float3> mLightDirections;     // world direction of lights by row
+    std::vector<uint32_t> mLightRows;               // light instance to row, scratch
+    std::vector<uint32_t> mRenderableRows;          // renderable instance to row, scratch
+    std::vector<math::mat4f> mPreviousTransforms;   // previous transforms by row, scratch
+    FTransformManager::ChangeCursor mTransformChangeCursor;
+    FLightManager::ChangeCursor mLightChangeCursor;
+    SceneBvh mBvh;
+    math::mat4 mWorldOriginTransform;
+    uint32_t mRenderableGeneration = 0;
+    uint32_t mLightGeneration = 0;
+    uint32_t mFrameId = 0;
+    bool mRenderableDataValid = false;
+    bool mLightWorldDataValid = false;
+    bool mBvhEnabled = false;
+    bool mBvhValid = false;
     backend::Handle<backend::HwUniformBuffer> mRenderableViewUbh; // This is actually owned by the view.
     bool mHasContactShadows = false;
 };
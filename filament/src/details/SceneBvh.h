@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DETAILS_SCENEBVH_H
+#define TNT_FILAMENT_DETAILS_SCENEBVH_H
+
+#include "details/Culler.h"
+
+#include <utils/compiler.h>
+
+#include <math/vec3.h>
+
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace utils {
+class JobSystem;
+} // namespace utils
+
+namespace filament {
+
+/*
+ * SceneBvh is a bounding volume hierarchy of world space AABBs, used to cull the renderables of
+ * a scene hierarchically: a subtree entirely outside of a frustum is rejected with a single test,
+ * and a subtree entirely inside of it is accepted without testing any of its boxes.
+ *
+ * Items are identified by a key (the renderable instance) rather than by their row in the
+ * scene's RenderableSoa, because the rows are reordered by each View. The results are written
+ * through a table mapping keys to rows instead.
+ *
+ * Moving an item only refits the boxes of its ancestors, which degrades the hierarchy over time;
+ * needsRebuild() tells when it has seen as many updates as it has items.
+ */
+class UTILS_PUBLIC SceneBvh {
+public:
+    // Maximum number of items in a leaf, leaves are tested with the SIMD loop of the Culler.
+    static constexpr size_t LEAF_SIZE = Culler::MODULO;
+
+    // Maximum number of items of a subtree traversed by a single job.
+    static constexpr size_t JOB_SIZE = 4096;
+
+    static constexpr uint32_t INVALID = 0xFFFFFFFFu;
+
+    // Rebuilds the hierarchy from 'count' AABBs, identified by 'keys'.
+    void build(uint32_t const* keys,
+            math::float3 const* center,
+            math::float3 const* extent,
+            size_t count);
+
+    void clear() noexcept;
+
+    bool empty() const noexcept { return mNodes.empty(); }
+
+    // number of items in the hierarchy
+    size_t size() const noexcept { return mKeys.size(); }
+
+    // Updates the AABB of an item, ignored if the item isn't in the hierarchy.
+    // refit() must be called before the next cull().
+    void update(uint32_t key, math::float3 const& center, math::float3 const& extent) noexcept;
+
+    // Refits the ancestors of the items updated since the last call.
+    void refit() noexcept;
+
+    // Whether the hierarchy has degraded enough through updates that it should be rebuilt.
+    bool needsRebuild() const noexcept { return mUpdateCount > size(); }
+
+    /*
+     * Sets 'bit' in results[rows[key]] for each item intersecting the frustum. Entries of items
+     * outside of the frustum are left untouched. This runs on multiple threads.
+     */
+    void cull(utils::JobSystem& js, Culler::result_type* results, uint32_t const* rows,
+            Frustum const& frustum, size_t bit) const noexcept;
+
+private:
+    struct Node {
+        math::float3 center;
+        math::float3 extent;
+        uint32_t first;     // first item of the subtree, the items of a subtree are contiguous
+        uint32_t count;     // number of items in the subtree
+        uint32_t right;     // right child, the left child immediately follows; 0 for a leaf
+        uint32_t parent;    // INVALID for the root
+    };
+
+    uint32_t buildNode(uint32_t* order, uint32_t first, uint32_t last, uint32_t parent,
+            math::float3 const* center, math::float3 const* extent);
+
+    // recomputes the AABB of a node, returns whether it changed
+    bool refitNode(uint32_t index) noexcept;
+
+    void cullSubtree(uint32_t index, uint32_t planeMask, Culler::result_type* results,
+            uint32_t const* rows, Frustum const& frustum, Culler::result_type value) const noexcept;
+
+    void accept(Node const& node, Culler::result_type* results, uint32_t const* rows,
+            Culler::result_type value) const noexcept;
+
+    // nodes in depth-first order, children always come after their parent
+    std::vector<Node> mNodes;
+
+    // items in the order of the hierarchy, the AABBs are padded by LEAF_SIZE items
+    std::vector<uint32_t> mKeys;
+    std::vector<math::float3> mCenters;
+    std::vector<math::float3> mExtents;
+    std::vector<uint32_t> mLeaves;      // leaf of each item
+
+    std::vector<uint32_t> mSlots;       // key to item, INVALID for keys not in the hierarchy
+    std::vector<uint32_t> mDirtyLeaves; // leaves of the items updated since the last refit()
+    size_t mUpdateCount = 0;
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_DETAILS_SCENEBVH_H
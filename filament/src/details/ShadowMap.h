@@ -82,8 +82,14 @@ public:
             FView const& view, filament::CameraInfo const& camera, uint8_t visibleLayers,
             CascadeParameters& cascadeParams);
 
+    // Call once per frame, before update(), to initialize the shadowmap debug properties.
+    static void initDebugHints(FEngine& engine, FLightManager::ShadowParams const& params,
+            filament::CameraInfo const& camera) noexcept;
+
     // Call once per frame if the light, scene (or visible layers) or camera changes.
-    // This computes the light's camera.
+    // This computes the light's camera, but doesn't change its transform, see commitCamera().
+    // update() only modifies this ShadowMap, so different shadow maps can be updated from
+    // different threads.
     void update(const FScene::LightSoa& lightData, size_t index, FScene const* scene,
             filament::CameraInfo const& camera, uint8_t visibleLayers,
             ShadowMapLayout layout, const CascadeParameters& cascadeParams) noexcept;
@@ -105,7 +111,14 @@ public:
     // return the size of a texel in world space (pre-warping)
     float getTexelSizeWorldSpace() const noexcept { return mTexelSizeWs; }
 
-    // Returns the light's projection. Valid after calling update().
+    // Returns the frustum used to cull the shadow casters. Valid after calling update().
+    Frustum getCullingFrustum() const noexcept;
+
+    // Sets the transform of the light's camera computed by update(). This must be called from
+    // the engine's main thread, because it changes the TransformManager.
+    void commitCamera() noexcept;
+
+    // Returns the light's projection. Valid after calling commitCamera().
     FCamera const& getCamera() const noexcept { return *mCamera; }
 
     // use only for debugging
@@ -231,6 +244,7 @@ private:
 
     FCamera* mCamera = nullptr;
     FCamera* mDebugCamera = nullptr;
+    math::mat4f mCameraModel;
     math::mat4f mLightSpace;
     math::mat4f mLightSpaceVsm;
     float mTexelSizeWs = 0.0f;
@@ -30,9 +30,16 @@
 #include <backend/Handle.h>
 
 #include "fg2/FrameGraph.h"
+#include "fg2/FrameGraphTexture.h"
 
+#include "details/Scene.h"
+#include "details/ShadowMap.h"
+
+#include <math/mat4.h>
 #include <math/vec3.h>
 
+#include <utils/Range.h>
+
 #include <array>
 #include <memory>
 #include <vector>
@@ -41,7 +48,6 @@ namespace filament {
 
 class FView;
 
-class ShadowMap;
 class RenderPass;
 
 class ShadowMapManager {
@@ -57,6 +63,9 @@ public:
     explicit ShadowMapManager(FEngine& engine);
     ~ShadowMapManager();
 
+    // Releases the shadow maps retained across frames.
+    void terminate(FEngine& engine) noexcept;
+
     // Reset shadow map layout.
     void reset() noexcept;
 
@@ -80,7 +89,12 @@ public:
         return mCascadeShadowMapCache[c].get();
     }
 
+    // Number of shadow maps rendered by the last render(), the others were retained.
+    size_t getRenderedShadowMapCount() const noexcept { return mRenderedShadowMapCount; }
+
 private:
+    static constexpr size_t MAX_SHADOW_LAYERS =
+            CONFIG_MAX_SHADOW_CASCADES + CONFIG_MAX_SHADOW_CASTING_SPOTS;
 
     struct ShadowLayout {
         uint8_t layer = 0;
@@ -94,8 +108,20 @@ private:
         uint8_t levels = 0;
     } mTextureRequirements;
 
+    // scene-dependent values computed once per frame, shared by all the cascades
+    struct CascadeSetup {
+        ShadowMap::CascadeParameters params;
+        float csSplitPosition[CONFIG_MAX_SHADOW_CASCADES + 1] = {};
+    };
+
+    void prepareCascadeShadowMaps(FEngine& engine, FView& view, UniformBuffer& perViewUb,
+            FScene::RenderableSoa& renderableData, FScene::LightSoa& lightData,
+            CascadeSetup& setup) noexcept;
+    // computes the light cameras of all the shadow maps, one job per shadow map
+    void updateShadowMaps(FEngine& engine, FView& view, FScene::LightSoa const& lightData,
+            CascadeSetup const& setup) noexcept;
     ShadowTechnique updateCascadeShadowMaps(FEngine& engine, FView& view, UniformBuffer& perViewUb,
-            FScene::RenderableSoa& renderableData, FScene::LightSoa& lightData) noexcept;
+            FScene::LightSoa& lightData) noexcept;
     ShadowTechnique updateSpotShadowMaps(FEngine& engine, FView& view, UniformBuffer& shadowUb,
             FScene::RenderableSoa& renderableData, FScene::LightSoa& lightData) noexcept;
     static void fillWithDebugPattern(backend::DriverApi& driverApi,
@@ -103,6 +129,16 @@ private:
 
     void calculateTextureRequirements(FEngine& engine, FView& view, FScene::LightSoa& lightData) noexcept;
 
+    // Returns the power-of-two size, at most maxDimension, of the shadow map of a spot light
+    // that matches the size its range covers on screen. See View::setShadowMapBudget().
+    uint16_t getAdaptiveShadowMapSize(FView const& view, FScene::LightSoa const& lightData,
+            size_t lightIndex, uint16_t maxDimension) const noexcept;
+
+    // Halves the largest of the given sizes until the sum of their areas fits the budget.
+    static void fitShadowMapBudget(uint16_t* sizes, size_t count, uint32_t budget) noexcept;
+
+    FrameGraphTexture::Descriptor getShadowTextureDescriptor(FView const& view) const noexcept;
+
     class ShadowMapEntry {
     public:
         ShadowMapEntry() = default;
@@ -117,17 +153,44 @@ private:
         size_t getLightIndex() const { return mLightIndex; }
         const ShadowLayout& getLayout() const { return mLayout; }
         bool hasVisibleShadows() const { return mHasVisibleShadows; }
+        // whether the shadow map retained from a previous frame is used as is
+        bool isStale() const { return mIsStale; }
 
         void setHasVisibleShadows(bool hasVisibleShadows) { mHasVisibleShadows = hasVisibleShadows; }
         void setLayout(const ShadowLayout& layout) { mLayout = layout; }
+        void setStale(bool stale) { mIsStale = stale; }
 
     private:
         ShadowMap* mShadowMap = nullptr;
         size_t mLightIndex = 0;
         ShadowLayout mLayout = {};
         bool mHasVisibleShadows = false;
+        bool mIsStale = false;
+    };
+
+    // What a layer of the retained shadow texture was rendered with. The layer can be reused
+    // as long as none of this changes.
+    struct CachedShadowMap {
+        math::mat4f lightFromWorld;
+        backend::PolygonOffset polygonOffset;
+        uint64_t castersHash = 0;
+        FLightManager::Instance light;
+        ShadowLayout layout;
+        bool valid = false;
     };
 
+    // Returns true if the entry's layer of the retained shadow texture is up-to-date, otherwise
+    // records the entry's state in the cache, in which case the shadow map must be rendered.
+    bool updateCachedShadowMap(ShadowMapEntry const& entry, FScene::LightSoa const& lightData,
+            math::mat4f const& lightFromWorld, uint64_t castersHash) noexcept;
+
+    // Order-independent hash of everything that affects the rendering of the shadow casters in
+    // 'range' that have any of the bits of 'mask' set. Returns false if some casters can't
+    // be cached (e.g. skinned renderables).
+    static bool hashShadowCasters(FScene::RenderableSoa const& soa,
+            utils::Range<uint32_t> range, FScene::VisibleMaskType mask,
+            uint64_t* outHash) noexcept;
+
     class CascadeSplits {
     public:
         constexpr static size_t SPLIT_COUNT = CONFIG_MAX_SHADOW_CASCADES + 1;
@@ -179,6 +242,23 @@ private:
 
     std::array<std::unique_ptr<ShadowMap>, CONFIG_MAX_SHADOW_CASCADES> mCascadeShadowMapCache;
     std::array<std::unique_ptr<ShadowMap>, CONFIG_MAX_SHADOW_CASTING_SPOTS> mSpotShadowMapCache;
+
+    // shadow texture retained across frames, when shadow map caching is enabled
+    bool mShadowMapCaching = false;
+    FrameGraphTexture mShadowTexture;
+    FrameGraphTexture::Descriptor mShadowTextureDesc;
+    FrameGraphTexture::Usage mShadowTextureUsage{};
+    std::array<CachedShadowMap, MAX_SHADOW_LAYERS> mCachedShadowMaps;
+    uint32_t mCascadeRefreshCount = 0;
+    size_t mRenderedShadowMapCount = 0;
+
+    // size chosen for each spot light in the previous frame, when the shadow map budget is set
+    struct AdaptiveShadowMapSize {
+        FLightManager::Instance light;
+        uint16_t size = 0;
+    };
+    std::array<AdaptiveShadowMapSize, CONFIG_MAX_SHADOW_CASTING_SPOTS> mAdaptiveSizes;
+    static constexpr uint16_t MIN_ADAPTIVE_SHADOW_MAP_SIZE = 32;
 };
 
 } // namespace filament
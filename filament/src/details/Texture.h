@@ -89,6 +89,9 @@ public:
     // synchronous call to the backend. returns whether a backend supports texture swizzling.
     static bool isTextureSwizzleSupported(FEngine& engine) noexcept;
 
+    static math::uint3 getSparsePageSize(FEngine& engine, Sampler sampler,
+            InternalFormat format) noexcept;
+
     // storage needed on the CPU side for texture data uploads
     static size_t computeTextureDataSize(Texture::Format format, Texture::Type type,
             size_t stride, size_t height, size_t alignment) noexcept;
@@ -114,6 +117,25 @@ public:
     static bool validatePixelFormatAndType(backend::TextureFormat internalFormat,
             backend::PixelDataFormat format, backend::PixelDataType type) noexcept;
 
+    // finest level worth sampling when the texture covers "pixels" pixels on screen, assuming
+    // it's mapped once across that extent
+    static uint8_t requiredLevel(uint32_t maxDimension, float pixels, uint8_t levelCount) noexcept;
+
+    // streaming feedback, see Texture::getRequiredLevel()
+    bool isStreaming() const noexcept { return mStreaming; }
+    void updateRequiredLevel(float pixels) const noexcept {
+        uint8_t const level = requiredLevel(std::max(mWidth, mHeight), pixels, mLevelCount);
+        mRequiredLevel = std::min(mRequiredLevel, level);
+    }
+    size_t getRequiredLevel() const noexcept { return mRequiredLevel; }
+    void resetRequiredLevel() noexcept { mRequiredLevel = mLevelCount; }
+
+    void setMinMaxLevels(FEngine& engine, size_t minLevel, size_t maxLevel) const;
+
+    void commitPages(FEngine& engine, size_t level,
+            uint32_t xoffset, uint32_t yoffset, uint32_t zoffset,
+            uint32_t width, uint32_t height, uint32_t depth, bool commit) const;
+
 private:
     friend class Texture;
     FStream* mStream = nullptr;
@@ -126,6 +148,8 @@ private:
     uint8_t mLevelCount = 1;
     uint8_t mSampleCount = 1;
     Usage mUsage = Usage::DEFAULT;
+    bool mStreaming = false;
+    mutable uint8_t mRequiredLevel = 1;  // mLevelCount when no level is required
 };
 
 
@@ -23,17 +23,22 @@
 
 #include "FrameInfo.h"
 #include "FrameHistory.h"
+#include "HardwareCounters.h"
+#include "RenderPass.h"
 #include "UniformBuffer.h"
 
 #include "details/Allocators.h"
 #include "details/Camera.h"
 #include "details/ColorGrading.h"
 #include "details/Froxelizer.h"
+#include "details/OcclusionCuller.h"
 #include "details/RenderTarget.h"
 #include "details/ShadowMap.h"
 #include "details/ShadowMapManager.h"
 #include "details/Scene.h"
 
+#include "fg2/FrameGraph.h"
+
 #include <private/filament/EngineEnums.h>
 
 #include "private/backend/DriverApi.h"
@@ -48,6 +53,9 @@
 
 #include <math/scalar.h>
 
+#include <memory>
+#include <vector>
+
 namespace utils {
 class JobSystem;
 } // namespace utils;
@@ -114,7 +122,7 @@ public:
     void terminate(FEngine& engine);
 
     void prepare(FEngine& engine, backend::DriverApi& driver, ArenaScope& arena,
-            Viewport const& viewport, math::float4 const& userTime) noexcept;
+            Viewport const& viewport, math::float4 const& userTime, uint32_t frameId) noexcept;
 
     void setScene(FScene* scene) { mScene = scene; }
     FScene const* getScene() const noexcept { return mScene; }
@@ -125,6 +133,14 @@ public:
 
     CameraInfo const& getCameraInfo() const noexcept { return mViewingCameraInfo; }
 
+    void setEyeCameras(FCamera* const* eyes, size_t count) noexcept;
+    size_t getEyeCount() const noexcept { return mEyeCount; }
+    bool hasEyeCameras() const noexcept { return mEyeCount > 0; }
+    CameraInfo const& getEyeCameraInfo(size_t eye) const noexcept { return mEyeCameraInfos[eye]; }
+
+    // the slice of 'viewport' eye 'eye' is rendered into
+    Viewport getEyeViewport(Viewport const& viewport, size_t eye) const noexcept;
+
     void setViewport(Viewport const& viewport) noexcept;
     Viewport const& getViewport() const noexcept {
         return mViewport;
@@ -142,6 +158,48 @@ public:
     void setFrontFaceWindingInverted(bool inverted) noexcept { mFrontFaceWindingInverted = inverted; }
     bool isFrontFaceWindingInverted() const noexcept { return mFrontFaceWindingInverted; }
 
+    void setOcclusionCullingEnabled(bool enabled) noexcept;
+    bool isOcclusionCullingEnabled() const noexcept { return mOcclusionCulling; }
+
+    // Schedules an asynchronous readback of 'rt''s depth buffer, rendered with the 'worldToClip'
+    // transform, to be used for occlusion culling in the following frames.
+    void readOcclusionDepth(backend::DriverApi& driver,
+            backend::Handle<backend::HwRenderTarget> rt, uint32_t width, uint32_t height,
+            math::mat4f const& worldToClip) const noexcept;
+
+    void setCommandCachingEnabled(bool enabled) noexcept;
+    bool isCommandCachingEnabled() const noexcept { return mCommandCaching; }
+
+    void setShadowMapCachingEnabled(bool enabled) noexcept { mShadowMapCaching = enabled; }
+    bool isShadowMapCachingEnabled() const noexcept { return mShadowMapCaching; }
+
+    void setShadowMapBudget(uint32_t texels) noexcept { mShadowMapBudget = texels; }
+    uint32_t getShadowMapBudget() const noexcept { return mShadowMapBudget; }
+
+    void pick(uint32_t x, uint32_t y, PickingQueryResultCallback callback, void* user) noexcept {
+        mPickingQueries.push_back({ x, y, callback, user });
+    }
+    bool hasPickingQueries() const noexcept { return !mPickingQueries.empty(); }
+
+    // Schedules the readback of the pending picking queries from 'rt''s picking buffer, which
+    // covers the viewport at a resolution of 'width' x 'height'. The queries are answered
+    // asynchronously.
+    void readPickingQueries(backend::DriverApi& driver,
+            backend::Handle<backend::HwRenderTarget> rt, uint32_t width, uint32_t height) noexcept;
+
+    // results of the last compilation of this view's frame graph
+    FrameGraph::CompileCache& getFrameGraphCompileCache() noexcept {
+        return mFrameGraphCompileCache;
+    }
+
+    // caches retaining the commands of the color and structure passes (when enabled)
+    RenderPass::CommandCache* getColorCommandCache() noexcept {
+        return mCommandCaching ? &mColorCommandCache : nullptr;
+    }
+    RenderPass::CommandCache* getDepthCommandCache() noexcept {
+        return mCommandCaching ? &mDepthCommandCache : nullptr;
+    }
+
 
     void setVisibleLayers(uint8_t select, uint8_t values) noexcept;
     uint8_t getVisibleLayers() const noexcept {
@@ -158,6 +216,7 @@ public:
     }
 
     void prepareCamera(const CameraInfo& camera) const noexcept;
+    void preparePreviousCamera(const math::mat4f& clipFromWorld) const noexcept;
     void prepareViewport(const Viewport& viewport) const noexcept;
     void prepareShadowing(FEngine& engine, backend::DriverApi& driver,
             FScene::RenderableSoa& renderableData, FScene::LightSoa& lightData) noexcept;
@@ -186,6 +245,12 @@ public:
             FEngine& engine, const CameraInfo& camera,
             FScene::RenderableSoa& renderableData, Range visible) noexcept;
 
+    // updates the required level of the streamed textures used by the visible renderables.
+    // updatePrimitivesLod must be run first.
+    static void updateTextureStreaming(FEngine const& engine, const CameraInfo& camera,
+            FScene::RenderableSoa const& renderableData, Range visible,
+            float viewportHeight) noexcept;
+
     void setShadowingEnabled(bool enabled) noexcept { mShadowingEnabled = enabled; }
 
     bool isShadowingEnabled() const noexcept { return mShadowingEnabled; }
@@ -198,6 +263,8 @@ public:
         return &mShadowMapManager.getCascadeShadowMap(0)->getDebugCamera();
     }
 
+    ShadowMapManager const& getShadowMapManager() const noexcept { return mShadowMapManager; }
+
     void setRenderTarget(FRenderTarget* renderTarget) noexcept {
         mRenderTarget = renderTarget;
     }
@@ -232,6 +299,43 @@ public:
         return mTemporalAntiAliasingOptions;
     }
 
+    void setVariableRateShadingOptions(VariableRateShadingOptions options) noexcept {
+        options.motionThreshold = std::max(0.0f, options.motionThreshold);
+        mVariableRateShadingOptions = options;
+    }
+
+    const VariableRateShadingOptions& getVariableRateShadingOptions() const noexcept {
+        return mVariableRateShadingOptions;
+    }
+
+    void setDepthPrepassOptions(DepthPrepassOptions options) noexcept {
+        options.overdrawThreshold = std::max(0.0f, options.overdrawThreshold);
+        mDepthPrepassOptions = options;
+    }
+
+    const DepthPrepassOptions& getDepthPrepassOptions() const noexcept {
+        return mDepthPrepassOptions;
+    }
+
+    void setLightBudgetOptions(LightBudgetOptions options) noexcept {
+        options.maxLights = std::min(options.maxLights, uint16_t(CONFIG_MAX_LIGHT_COUNT));
+        options.maxShadowCastingSpots = std::min(options.maxShadowCastingSpots,
+                uint8_t(CONFIG_MAX_SHADOW_CASTING_SPOTS));
+        options.fadeRange = std::max(0.0f, options.fadeRange);
+        mLightBudgetOptions = options;
+    }
+
+    const LightBudgetOptions& getLightBudgetOptions() const noexcept {
+        return mLightBudgetOptions;
+    }
+
+    // whether the color pass of this frame uses a depth prepass, set by prepare()
+    bool hasDepthPrepass() const noexcept { return mDepthPrepass; }
+
+    // fraction of the viewport covered by the bounding sphere of a box, between 0 and 1
+    static float computeScreenCoverage(math::mat4f const& view, math::mat4f const& projection,
+            math::float3 center, math::float3 halfExtent) noexcept;
+
     void setToneMapping(ToneMapping type) noexcept {
         mToneMapping = type;
     }
@@ -262,6 +366,18 @@ public:
 
     math::float2 updateScale(FrameInfo const& info) noexcept;
 
+    math::float2 getScale() const noexcept { return mScale; }
+
+    float getGpuTime() const noexcept { return mGpuTime; }
+
+    // CPU time of the culling done by the last prepare()
+    FrameInfo::duration getCullingTime() const noexcept { return mCullingTime; }
+
+    // hardware counters of the culling done by the last prepare(), if enabled
+    HardwareCounters::Counters const& getCullingCounters() const noexcept {
+        return mCullingCounters;
+    }
+
     void setDynamicResolutionOptions(View::DynamicResolutionOptions const& options) noexcept;
 
     DynamicResolutionOptions getDynamicResolutionOptions() const noexcept {
@@ -276,7 +392,10 @@ public:
         return mRenderQuality;
     }
 
-    void setDynamicLightingOptions(float zLightNear, float zLightFar) noexcept;
+    void setDynamicLightingOptions(float zLightNear, float zLightFar,
+            size_t froxelSliceCount = FEngine::CONFIG_FROXEL_SLICE_COUNT) noexcept;
+
+    void setNonSquareFroxelsEnabled(bool enabled) noexcept;
 
     void setPostProcessingEnabled(bool enabled) noexcept {
         mHasPostProcessPass = enabled;
@@ -390,6 +509,11 @@ public:
         return mVisibleRenderables;
     }
 
+    // distance to the closest visible renderable, only computed when depth of field is enabled
+    float getVisibleNearDistance() const noexcept {
+        return mVisibleNearDistance;
+    }
+
     Range const& getVisibleDirectionalShadowCasters() const noexcept {
         return mVisibleDirectionalShadowCasters;
     }
@@ -415,7 +539,8 @@ public:
         }
     }
 
-    static void cullRenderables(utils::JobSystem& js, FScene::RenderableSoa& renderableData,
+    // uses the scene's bounding volume hierarchy if it's enabled
+    static void cullRenderables(utils::JobSystem& js, FScene& scene,
             Frustum const& frustum, size_t bit) noexcept;
 
     UniformBuffer& getViewUniforms() const { return mPerViewUb; }
@@ -436,10 +561,27 @@ private:
     void prepareVisibleRenderables(utils::JobSystem& js,
             Frustum const& frustum, FScene::RenderableSoa& renderableData) const noexcept;
 
+    void prepareOccludedRenderables(utils::JobSystem& js,
+            FScene::RenderableSoa& renderableData) const noexcept;
+
     static void prepareVisibleLights(
             FLightManager const& lcm, utils::JobSystem& js, Frustum const& frustum,
+            CameraInfo const& camera, LightBudgetOptions const& budget,
             FScene::LightSoa& lightData) noexcept;
 
+    // keeps the most important lights within the budget, and fades those close to the cutoff
+    static void applyLightBudget(FLightManager const& lcm, CameraInfo const& camera,
+            LightBudgetOptions const& budget, FScene::LightSoa& lightData) noexcept;
+
+    static float computeVisibleNearDistance(CameraInfo const& camera,
+            FScene::RenderableSoa const& renderableData, Range visible) noexcept;
+
+    // estimated overdraw of the opaque renderables that the depth prepass would draw, weighted
+    // by the cost of their materials
+    static float computeOpaqueOverdraw(CameraInfo const& camera,
+            FScene::RenderableSoa const& renderableData, Range visible,
+            float averageLightCount) noexcept;
+
     static void computeVisibilityMasks(
             uint8_t visibleLayers, uint8_t const* layers,
             FRenderableManager::Visibility const* visibility, uint8_t* visibleMask,
@@ -477,11 +619,31 @@ private:
     CameraInfo mViewingCameraInfo;
     Frustum mCullingFrustum{};
 
+    FCamera* mEyeCameras[MAX_EYE_COUNT] = {};
+    CameraInfo mEyeCameraInfos[MAX_EYE_COUNT];
+    uint8_t mEyeCount = 0;
+
     mutable Froxelizer mFroxelizer;
 
     Viewport mViewport;
     bool mCulling = true;
     bool mFrontFaceWindingInverted = false;
+    bool mOcclusionCulling = false;
+    bool mSkyboxOccluded = false;   // the skybox was fully covered in the occlusion depth buffer
+    std::shared_ptr<OcclusionCuller> mOcclusionCuller = std::make_shared<OcclusionCuller>();
+    bool mCommandCaching = false;
+    bool mShadowMapCaching = false;
+    uint32_t mShadowMapBudget = 0;
+    struct PickingQuery {
+        uint32_t x;
+        uint32_t y;
+        PickingQueryResultCallback callback;
+        void* user;
+    };
+    std::vector<PickingQuery> mPickingQueries;
+    FrameGraph::CompileCache mFrameGraphCompileCache;
+    RenderPass::CommandCache mColorCommandCache;
+    RenderPass::CommandCache mDepthCommandCache;
 
     FRenderTarget* mRenderTarget = nullptr;
 
@@ -501,6 +663,11 @@ private:
     DepthOfFieldOptions mDepthOfFieldOptions;
     VignetteOptions mVignetteOptions;
     TemporalAntiAliasingOptions mTemporalAntiAliasingOptions;
+    VariableRateShadingOptions mVariableRateShadingOptions;
+    DepthPrepassOptions mDepthPrepassOptions;
+    LightBudgetOptions mLightBudgetOptions;
+    float mOpaqueOverdraw = 0.0f;
+    bool mDepthPrepass = false;
     BlendMode mBlendMode = BlendMode::OPAQUE;
     const FColorGrading* mColorGrading = nullptr;
     const FColorGrading* mDefaultColorGrading = nullptr;
@@ -508,6 +675,9 @@ private:
 
     DynamicResolutionOptions mDynamicResolution;
     math::float2 mScale = 1.0f;
+    float mGpuTime = 0.0f;
+    FrameInfo::duration mCullingTime{};
+    HardwareCounters::Counters mCullingCounters{};
     bool mIsDynamicResolutionSupported = false;
 
     RenderQuality mRenderQuality;
@@ -524,6 +694,7 @@ private:
     Range mVisibleRenderables;
     Range mVisibleDirectionalShadowCasters;
     Range mSpotLightShadowCasters;
+    float mVisibleNearDistance = 0.0f;
     uint32_t mRenderableUBOSize = 0;
     mutable bool mHasDirectionalLight = false;
     mutable bool mHasDynamicLighting = false;
@@ -128,6 +128,39 @@ void DependencyGraph::cull() noexcept {
     }
 }
 
+void DependencyGraph::getStructureKey(std::vector<uint32_t>& key) const noexcept {
+    auto const& nodes = mNodes;
+    auto const& edges = mEdges;
+    key.reserve(key.size() + 2 + nodes.size() + edges.size() * 2);
+    key.push_back(nodes.size());
+    key.push_back(edges.size());
+    for (Node const* const pNode : nodes) {
+        // before culling, the reference count only records whether the node is a target
+        key.push_back(pNode->mRefCount);
+    }
+    for (Edge const* const pEdge : edges) {
+        key.push_back(pEdge->from);
+        key.push_back(pEdge->to);
+    }
+}
+
+std::vector<uint32_t> DependencyGraph::getRefCounts() const noexcept {
+    std::vector<uint32_t> refCounts;
+    refCounts.reserve(mNodes.size());
+    for (Node const* const pNode : mNodes) {
+        refCounts.push_back(pNode->mRefCount);
+    }
+    return refCounts;
+}
+
+void DependencyGraph::setRefCounts(std::vector<uint32_t> const& refCounts) noexcept {
+    auto& nodes = mNodes;
+    assert_invariant(refCounts.size() == nodes.size());
+    for (size_t i = 0, c = nodes.size(); i < c; i++) {
+        nodes[i]->mRefCount = refCounts[i];
+    }
+}
+
 void DependencyGraph::clear() noexcept {
     mEdges.clear();
     mNodes.clear();
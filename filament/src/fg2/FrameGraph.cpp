@@ -59,9 +59,14 @@ FrameGraphId<FrameGraphTexture> FrameGraph::Builder::declareRenderPass(
 
 // ------------------------------------------------------------------------------------------------
 
-FrameGraph::FrameGraph(ResourceAllocatorInterface& resourceAllocator)
+FrameGraph::FrameGraph(ResourceAllocatorInterface& resourceAllocator,
+        CompileCache* compileCache, LinearAllocatorArena* arena)
         : mResourceAllocator(resourceAllocator),
-          mArena("FrameGraph Arena", 131072),
+          mCompileCache(compileCache),
+          mOwnedArena(arena ? nullptr : std::make_unique<LinearAllocatorArena>(
+                  "FrameGraph Arena", CONFIG_FRAME_GRAPH_ARENA_SIZE)),
+          mArena(arena ? *arena : *mOwnedArena),
+          mArenaScope(mArena),
           mResourceSlots(mArena),
           mResources(mArena),
           mResourceNodes(mArena),
@@ -100,14 +105,56 @@ void FrameGraph::reset() noexcept {
     mResourceSlots.clear();
 }
 
+void FrameGraph::getStructureKey(std::vector<uint32_t>& key) const noexcept {
+    mGraph.getStructureKey(key);
+    key.push_back(mPassNodes.size());
+    for (PassNode const* const pPassNode : mPassNodes) {
+        key.push_back(pPassNode->getId());
+    }
+    key.push_back(mResourceNodes.size());
+    for (ResourceNode const* const pNode : mResourceNodes) {
+        key.push_back(pNode->getId());
+        key.push_back(pNode->resourceHandle.index);
+    }
+    key.push_back(mResourceSlots.size());
+    for (ResourceSlot const& slot : mResourceSlots) {
+        key.push_back(uint32_t(slot.rid));
+    }
+}
+
 FrameGraph& FrameGraph::compile() noexcept {
 
     SYSTRACE_CALL();
 
     DependencyGraph& dependencyGraph = mGraph;
+    CompileCache* const cache = mCompileCache;
+
+    // if this graph has the same structure as the one that was compiled last, its culling
+    // and the resources used by its passes are the same too.
+    bool cached = false;
+    if (cache) {
+        // the scratch key keeps its capacity, so this doesn't allocate in the steady state
+        std::vector<uint32_t>& key = cache->mScratchKey;
+        key.clear();
+        getStructureKey(key);
+        cached = key == cache->mKey;
+        if (!cached) {
+            std::swap(cache->mKey, key);
+        }
+    }
 
     // first we cull unreachable nodes
-    dependencyGraph.cull();
+    if (cached) {
+        dependencyGraph.setRefCounts(cache->mRefCounts);
+        cache->mHitCount++;
+    } else {
+        dependencyGraph.cull();
+        if (cache) {
+            cache->mRefCounts = dependencyGraph.getRefCounts();
+            cache->mResourceOffsets.clear();
+            cache->mResources.clear();
+        }
+    }
 
     /*
      * update the reference counter of the resource themselves and
@@ -121,11 +168,27 @@ FrameGraph& FrameGraph::compile() noexcept {
 
     auto first = mPassNodes.begin();
     const auto activePassNodesEnd = mActivePassNodesEnd;
+    size_t activePassIndex = 0;
     while (first != activePassNodesEnd) {
         PassNode* const passNode = *first;
         first++;
         assert_invariant(!passNode->isCulled());
 
+        if (cached) {
+            auto const& resources = cache->mResources;
+            const size_t begin = cache->mResourceOffsets[activePassIndex];
+            const size_t end = cache->mResourceOffsets[activePassIndex + 1];
+            for (size_t i = begin; i < end; i++) {
+                passNode->registerResource(FrameGraphHandle(resources[i]));
+            }
+            activePassIndex++;
+            passNode->resolve();
+            continue;
+        }
+
+        if (cache) {
+            cache->mResourceOffsets.push_back(cache->mResources.size());
+        }
 
         auto const& reads = dependencyGraph.getIncomingEdges(passNode);
         for (auto const& edge : reads) {
@@ -133,6 +196,9 @@ FrameGraph& FrameGraph::compile() noexcept {
             assert_invariant(dependencyGraph.isEdgeValid(edge));
             auto pNode = static_cast<ResourceNode*>(dependencyGraph.getNode(edge->from));
             passNode->registerResource(pNode->resourceHandle);
+            if (cache) {
+                cache->mResources.push_back(pNode->resourceHandle.index);
+            }
         }
 
         auto const& writes = dependencyGraph.getOutgoingEdges(passNode);
@@ -142,11 +208,28 @@ FrameGraph& FrameGraph::compile() noexcept {
             // the resource we are writing to.
             auto pNode = static_cast<ResourceNode*>(dependencyGraph.getNode(edge->to));
             passNode->registerResource(pNode->resourceHandle);
+            if (cache) {
+                cache->mResources.push_back(pNode->resourceHandle.index);
+            }
         }
 
         passNode->resolve();
     }
 
+    if (cache && !cached) {
+        cache->mResourceOffsets.push_back(cache->mResources.size());
+    }
+
+    // consecutive passes rendering into the same attachments share their render target
+    RenderPassNode* previous = nullptr;
+    for (auto it = mPassNodes.begin(); it != activePassNodesEnd; ++it) {
+        RenderPassNode* const renderPassNode = (*it)->asRenderPassNode();
+        if (renderPassNode && previous) {
+            renderPassNode->mergeRenderTarget(*previous);
+        }
+        previous = renderPassNode;
+    }
+
     // add resource to de-virtualize or destroy to the corresponding list for each active pass
     for (auto* pResource : mResources) {
         VirtualResource* resource = pResource;
@@ -177,7 +260,8 @@ FrameGraph& FrameGraph::compile() noexcept {
     return *this;
 }
 
-void FrameGraph::execute(backend::DriverApi& driver) noexcept {
+void FrameGraph::execute(backend::DriverApi& driver,
+        std::function<void(const char*)> const& beginPass) noexcept {
 
     SYSTRACE_CALL();
 
@@ -197,6 +281,10 @@ void FrameGraph::execute(backend::DriverApi& driver) noexcept {
 
         driver.pushGroupMarker(node->getName());
 
+        if (beginPass) {
+            beginPass(node->getName());
+        }
+
         // devirtualize resourcesList
         for (VirtualResource* resource : node->devirtualize) {
             assert_invariant(resource->first == node);
@@ -220,7 +308,7 @@ void FrameGraph::execute(backend::DriverApi& driver) noexcept {
     driver.popGroupMarker();
 }
 
-void FrameGraph::addPresentPass(std::function<void(FrameGraph::Builder&)> setup) noexcept {
+void FrameGraph::addPresentPass(PresentSetupFn setup) noexcept {
     PresentPassNode* node = mArena.make<PresentPassNode>(*this);
     mPassNodes.push_back(node);
     Builder builder(*this, node);
@@ -275,7 +363,7 @@ FrameGraphHandle FrameGraph::addSubResourceInternal(FrameGraphHandle parent,
 }
 
 FrameGraphHandle FrameGraph::readInternal(FrameGraphHandle handle, PassNode* passNode,
-        std::function<bool(ResourceNode*, VirtualResource*)> connect) {
+        ConnectFn connect) {
 
     if (!assertValid(handle)) {
         return {};
@@ -328,7 +416,7 @@ FrameGraphHandle FrameGraph::readInternal(FrameGraphHandle handle, PassNode* pas
 }
 
 FrameGraphHandle FrameGraph::writeInternal(FrameGraphHandle handle, PassNode* passNode,
-        std::function<bool(ResourceNode*, VirtualResource*)> connect) {
+        ConnectFn connect) {
     if (!assertValid(handle)) {
         return {};
     }
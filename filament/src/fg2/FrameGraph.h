@@ -34,7 +34,10 @@
 #include <backend/DriverEnums.h>
 #include <backend/Handle.h>
 
+#include <utils/InplaceFunction.h>
+
 #include <functional>
+#include <memory>
 #include <vector>
 
 namespace filament {
@@ -207,7 +210,36 @@ public:
 
     // --------------------------------------------------------------------------------------------
 
-    explicit FrameGraph(ResourceAllocatorInterface& resourceAllocator);
+    /**
+     * Retains the result of compile(), so that the next FrameGraph with the same structure can
+     * skip culling and computing the lifetime of its resources. Typically there is one cache
+     * per View, and it must outlive the FrameGraphs using it.
+     */
+    class CompileCache {
+    public:
+        //! returns how many times a compiled graph was reused
+        size_t getHitCount() const noexcept { return mHitCount; }
+
+    private:
+        friend class FrameGraph;
+        std::vector<uint32_t> mKey;             // structure of the compiled graph
+        std::vector<uint32_t> mScratchKey;      // structure of the graph being compiled
+        std::vector<uint32_t> mRefCounts;       // reference count of each node after culling
+        std::vector<uint32_t> mResourceOffsets; // first declared resource of each active pass
+        std::vector<FrameGraphHandle::Index> mResources; // resources declared by active passes
+        size_t mHitCount = 0;
+    };
+
+    /**
+     * @param resourceAllocator Allocator for the concrete resources of the graph.
+     * @param compileCache      Optional cache reused across graphs with the same structure.
+     * @param arena             Optional arena for the graph's nodes and containers. It is rewound
+     *                          to its current position when the FrameGraph is destroyed, so
+     *                          it can be persistent and reused for every frame. When null, the
+     *                          FrameGraph allocates its own arena.
+     */
+    explicit FrameGraph(ResourceAllocatorInterface& resourceAllocator,
+            CompileCache* compileCache = nullptr, LinearAllocatorArena* arena = nullptr);
     FrameGraph(FrameGraph const&) = delete;
     FrameGraph& operator=(FrameGraph const&) = delete;
     ~FrameGraph() noexcept;
@@ -275,8 +307,10 @@ public:
      * Execute all referenced passes
      *
      * @param driver a reference to the backend to execute the commands
+     * @param beginPass optional, called with the name of each pass before it's executed
      */
-    void execute(backend::DriverApi& driver) noexcept;
+    void execute(backend::DriverApi& driver,
+            std::function<void(const char*)> const& beginPass = {}) noexcept;
 
     /**
      * Forwards a resource to another one which gets replaced.
@@ -389,16 +423,18 @@ private:
         Version version = 0;
     };
     void reset() noexcept;
-    void addPresentPass(std::function<void(Builder&)> setup) noexcept;
+    using PresentSetupFn = utils::InplaceFunction<void(Builder&)>;
+    using ConnectFn = utils::InplaceFunction<bool(ResourceNode*, VirtualResource*)>;
+    void addPresentPass(PresentSetupFn setup) noexcept;
     Builder addPassInternal(const char* name, FrameGraphPassBase* base) noexcept;
     FrameGraphHandle createNewVersion(FrameGraphHandle handle, FrameGraphHandle parent = {}) noexcept;
     FrameGraphHandle createNewVersionForSubresourceIfNeeded(FrameGraphHandle handle) noexcept;
     FrameGraphHandle addResourceInternal(VirtualResource* resource) noexcept;
     FrameGraphHandle addSubResourceInternal(FrameGraphHandle parent, VirtualResource* resource) noexcept;
     FrameGraphHandle readInternal(FrameGraphHandle handle, PassNode* passNode,
-            std::function<bool(ResourceNode*, VirtualResource*)> connect);
+            ConnectFn connect);
     FrameGraphHandle writeInternal(FrameGraphHandle handle, PassNode* passNode,
-            std::function<bool(ResourceNode*, VirtualResource*)> connect);
+            ConnectFn connect);
     FrameGraphHandle forwardResourceInternal(FrameGraphHandle resourceHandle,
             FrameGraphHandle replaceResourceHandle);
 
@@ -453,10 +489,14 @@ private:
     }
 
     void destroyInternal() noexcept;
+    void getStructureKey(std::vector<uint32_t>& key) const noexcept;
 
     Blackboard mBlackboard;
     ResourceAllocatorInterface& mResourceAllocator;
-    LinearAllocatorArena mArena;
+    CompileCache* const mCompileCache;
+    std::unique_ptr<LinearAllocatorArena> mOwnedArena;  // only used when no arena is provided
+    LinearAllocatorArena& mArena;
+    ArenaScope mArenaScope;   // must outlive the containers below, which free into mArena
     DependencyGraph mGraph;
 
     Vector<ResourceSlot> mResourceSlots;
@@ -23,6 +23,7 @@
 
 #include <details/Texture.h>
 
+#include <algorithm>
 #include <string>
 
 using namespace filament::backend;
@@ -135,6 +136,27 @@ void RenderPassNode::resolve() noexcept {
             TargetBufferFlags::STENCIL
     };
 
+    // The framegraph doesn't know the order of the accesses within a pass, so an attachment
+    // whose texture is also sampled by this pass must be stored: it could be sampled by a later
+    // render pass of the same FrameGraphPass (e.g. the mip chains of bloom or of the blur).
+    DependencyGraph const& dependencyGraph = mFrameGraph.getGraph();
+    auto const& incomingEdges = dependencyGraph.getIncomingEdges(this);
+    auto isSampledByPass = [&](FrameGraphHandle handle) {
+        VirtualResource* const resource = mFrameGraph.getResource(handle)->getResource();
+        return std::any_of(incomingEdges.begin(), incomingEdges.end(),
+                [&](DependencyGraph::Edge const* edge) {
+                    ResourceNode const* node = static_cast<ResourceNode const*>(
+                            dependencyGraph.getNode(edge->from));
+                    if (mFrameGraph.getResource(node->resourceHandle)->getResource() != resource) {
+                        return false;
+                    }
+                    // same texture as the attachment, so this is a texture edge
+                    using TextureEdge = Resource<FrameGraphTexture>::ResourceEdge;
+                    return any(static_cast<TextureEdge const*>(edge)->usage &
+                            FrameGraphTexture::Usage::SAMPLEABLE);
+                });
+    };
+
     for (auto& rt : mRenderTargetData) {
 
         uint32_t minWidth = std::numeric_limits<uint32_t>::max();
@@ -157,7 +179,8 @@ void RenderPassNode::resolve() noexcept {
                 // (we could set to ALL, but this is cleaner)
                 rt.backend.params.flags.discardStart |= flags[i];
                 rt.backend.params.flags.discardEnd   |= flags[i];
-                if (rt.outgoing[i] && rt.outgoing[i]->hasActiveReaders()) {
+                if (rt.outgoing[i] && (rt.outgoing[i]->hasActiveReaders() ||
+                        isSampledByPass(rt.descriptor.attachments.array[i]))) {
                     rt.backend.params.flags.discardEnd &= ~flags[i];
                 }
                 if (rt.incoming[i] && rt.incoming[i]->hasActiveWriters()) {
@@ -234,9 +257,43 @@ void RenderPassNode::resolve() noexcept {
     }
 }
 
+void RenderPassNode::mergeRenderTarget(RenderPassNode& previous) noexcept {
+    // Only passes with a single render target qualify, we don't know in which order the
+    // render targets of a pass are used.
+    if (mRenderTargetData.size() != 1 || previous.mRenderTargetData.size() != 1) {
+        return;
+    }
+    RenderPassData& rt = mRenderTargetData.front();
+    RenderPassData& prev = previous.mRenderTargetData.front();
+    if (rt.imported || prev.imported ||
+            rt.targetBufferFlags != prev.targetBufferFlags ||
+            rt.descriptor.samples != prev.descriptor.samples ||
+            rt.backend.params.viewport.width != prev.backend.params.viewport.width ||
+            rt.backend.params.viewport.height != prev.backend.params.viewport.height) {
+        return;
+    }
+
+    // Each attachment must be the one the previous pass just rendered, in the same slot. Then
+    // this pass only continues the previous one, at the same pixels.
+    for (size_t i = 0; i < 6; i++) {
+        if (rt.attachmentInfo[i] && (!rt.incoming[i] || rt.incoming[i] != prev.outgoing[i])) {
+            return;
+        }
+    }
+
+    // Using the same render target keeps the attachments bound, which allows tile-based GPUs to
+    // keep them on-chip between the two passes.
+    rt.sharedTarget = &prev;
+    prev.keepTarget = true;
+}
+
 void RenderPassNode::RenderPassData::devirtualize(FrameGraph& fg,
         ResourceAllocatorInterface& resourceAllocator) noexcept {
     assert_invariant(any(targetBufferFlags));
+    if (sharedTarget) {
+        backend.target = sharedTarget->backend.target;
+        return;
+    }
     if (UTILS_LIKELY(!imported)) {
 
         TargetBufferInfo info[6] = {};
@@ -262,7 +319,7 @@ void RenderPassNode::RenderPassData::devirtualize(FrameGraph& fg,
 
 void RenderPassNode::RenderPassData::destroy(
         ResourceAllocatorInterface& resourceAllocator) noexcept {
-    if (UTILS_LIKELY(!imported)) {
+    if (UTILS_LIKELY(!imported && !keepTarget)) {
         resourceAllocator.destroyRenderTarget(backend.target);
     }
 }
@@ -162,6 +162,23 @@ public:
     //! cull unreferenced nodes. Links ARE NOT removed, only reference counts are updated.
     void cull() noexcept;
 
+    /**
+     * Appends a description of the structure of the graph, i.e. its nodes, targets and edges,
+     * to \p key. Graphs with the same key are culled identically.
+     * Must be called before culling.
+     */
+    void getStructureKey(std::vector<uint32_t>& key) const noexcept;
+
+    //! returns the reference counts of all nodes, valid only after cull() is called.
+    std::vector<uint32_t> getRefCounts() const noexcept;
+
+    /**
+     * Culls the graph by setting the reference counts of all nodes, instead of calling cull().
+     * \p refCounts must have been returned by getRefCounts() on a graph with the same
+     * structure key.
+     */
+    void setRefCounts(std::vector<uint32_t> const& refCounts) noexcept;
+
     /**
      * Return whether an edge is valid, that is if both ends are connected to nodes
      * that are not culled. Valid only after cull() is called.
@@ -34,6 +34,7 @@ namespace filament {
 class FrameGraph;
 class FrameGraphResources;
 class FrameGraphPassExecutor;
+class RenderPassNode;
 class ResourceNode;
 
 class PassNode : public DependencyGraph::Node {
@@ -53,6 +54,7 @@ public:
 
     virtual void execute(FrameGraphResources const& resources, backend::DriverApi& driver) noexcept = 0;
     virtual void resolve() noexcept = 0;
+    virtual RenderPassNode* asRenderPassNode() noexcept { return nullptr; }
     utils::CString graphvizifyEdgeColor() const noexcept override;
 
     Vector<VirtualResource*> devirtualize;         // resources we need to create before executing
@@ -70,6 +72,8 @@ public:
         FrameGraphId<FrameGraphTexture> attachmentInfo[6] = {};
         ResourceNode* incoming[6] = {};  // nodes of the incoming attachments
         ResourceNode* outgoing[6] = {};  // nodes of the outgoing attachments
+        RenderPassData const* sharedTarget = nullptr; // render target taken from the previous pass
+        bool keepTarget = false;                      // render target used by the next pass
         struct {
             backend::Handle<backend::HwRenderTarget> target;
             backend::RenderPassParams params;
@@ -88,6 +92,12 @@ public:
 
     RenderPassData const* getRenderPassData(uint32_t id) const noexcept;
 
+    // Uses the render target of 'previous' if this pass continues rendering into its attachments,
+    // called in execution order after resolve().
+    void mergeRenderTarget(RenderPassNode& previous) noexcept;
+
+    RenderPassNode* asRenderPassNode() noexcept override { return this; }
+
 private:
     // virtuals from DependencyGraph::Node
     char const* getName() const noexcept override { return mName; }
@@ -889,3 +889,240 @@ TEST_F(FrameGraphTest, SubResourcesWriteRead) {
 
     fg.execute(driverApi);
 }
+
+TEST_F(FrameGraphTest, SampledWithinPass) {
+    // a two-pass blur: the temporary buffer is rendered to, then sampled by the same pass
+    struct BlurPassData {
+        FrameGraphId<FrameGraphTexture> temp;
+        FrameGraphId<FrameGraphTexture> output;
+    };
+    auto& blurPass = fg.addPass<BlurPassData>("Blur pass",
+            [&](FrameGraph::Builder& builder, auto& data) {
+                data.temp = builder.create<FrameGraphTexture>("Temp", {.width=16, .height=32});
+                data.temp = builder.sample(data.temp);
+                data.temp = builder.declareRenderPass(data.temp);
+                data.output = builder.create<FrameGraphTexture>("Output", {.width=16, .height=32});
+                data.output = builder.declareRenderPass(data.output);
+            },
+            [=](FrameGraphResources const& resources, auto const& data, backend::DriverApi& driver) {
+                auto rp0 = resources.getRenderPassInfo(0);
+                auto rp1 = resources.getRenderPassInfo(1);
+
+                // neither attachment has content to load
+                EXPECT_EQ(rp0.params.flags.discardStart, TargetBufferFlags::COLOR0);
+                EXPECT_EQ(rp1.params.flags.discardStart, TargetBufferFlags::COLOR0);
+
+                // the temporary buffer is only read within the pass, but it must still be stored
+                EXPECT_EQ(rp0.params.flags.discardEnd, TargetBufferFlags::NONE);
+                EXPECT_EQ(rp1.params.flags.discardEnd, TargetBufferFlags::NONE);
+            });
+
+    fg.present(blurPass->output);
+
+    EXPECT_TRUE(fg.isAcyclic());
+
+    fg.compile();
+
+    EXPECT_FALSE(fg.isCulled(blurPass));
+
+    fg.execute(driverApi);
+}
+
+TEST_F(FrameGraphTest, SharedRenderTarget) {
+    RenderTargetHandle opaqueTarget;
+
+    struct PassData {
+        FrameGraphId<FrameGraphTexture> color;
+        FrameGraphId<FrameGraphTexture> depth;
+    };
+    auto& opaquePass = fg.addPass<PassData>("Opaque pass",
+            [&](FrameGraph::Builder& builder, auto& data) {
+                data.color = builder.create<FrameGraphTexture>("Color", {.width=16, .height=32});
+                data.depth = builder.create<FrameGraphTexture>("Depth", {.width=16, .height=32});
+                data.color = builder.write(data.color, FrameGraphTexture::Usage::COLOR_ATTACHMENT);
+                data.depth = builder.write(data.depth, FrameGraphTexture::Usage::DEPTH_ATTACHMENT);
+                builder.declareRenderPass("Opaque target",
+                        { .attachments = { .color = { data.color }, .depth = data.depth }});
+            },
+            [&](FrameGraphResources const& resources, auto const& data, backend::DriverApi& driver) {
+                opaqueTarget = resources.getRenderPassInfo().target;
+                EXPECT_TRUE((bool)opaqueTarget);
+            });
+
+    // continues rendering into the same attachments, at the same pixels
+    auto& translucentPass = fg.addPass<PassData>("Translucent pass",
+            [&](FrameGraph::Builder& builder, auto& data) {
+                data.color = builder.read(opaquePass->color, FrameGraphTexture::Usage::COLOR_ATTACHMENT);
+                data.depth = builder.read(opaquePass->depth, FrameGraphTexture::Usage::DEPTH_ATTACHMENT);
+                data.color = builder.write(data.color, FrameGraphTexture::Usage::COLOR_ATTACHMENT);
+                data.depth = builder.write(data.depth, FrameGraphTexture::Usage::DEPTH_ATTACHMENT);
+                builder.declareRenderPass("Translucent target",
+                        { .attachments = { .color = { data.color }, .depth = data.depth }});
+            },
+            [&](FrameGraphResources const& resources, auto const& data, backend::DriverApi& driver) {
+                auto rp = resources.getRenderPassInfo();
+                EXPECT_EQ(rp.target, opaqueTarget);
+                EXPECT_EQ(rp.params.flags.discardStart, TargetBufferFlags::NONE);
+            });
+
+    fg.present(translucentPass->color);
+
+    EXPECT_TRUE(fg.isAcyclic());
+
+    fg.compile();
+
+    EXPECT_FALSE(fg.isCulled(opaquePass));
+    EXPECT_FALSE(fg.isCulled(translucentPass));
+
+    fg.execute(driverApi);
+}
+
+TEST_F(FrameGraphTest, CompileCache) {
+    struct PassData {
+        FrameGraphId<FrameGraphTexture> output;
+    };
+
+    FrameGraph::CompileCache cache;
+
+    auto build = [&](FrameGraph& fg, bool presentUnused, bool& usedCulled, bool& unusedCulled) {
+        auto& usedPass = fg.addPass<PassData>("Used pass",
+                [&](FrameGraph::Builder& builder, auto& data) {
+                    data.output = builder.createTexture("Used buffer", {.width=16, .height=32});
+                    data.output = builder.declareRenderPass(data.output);
+                },
+                [=](FrameGraphResources const& resources, auto const& data,
+                        backend::DriverApi& driver) {
+                    EXPECT_TRUE(resources.get(data.output).handle);
+                    EXPECT_EQ(resources.getUsage(data.output), FrameGraphTexture::Usage::COLOR_ATTACHMENT);
+                });
+
+        auto& unusedPass = fg.addPass<PassData>("Unused pass",
+                [&](FrameGraph::Builder& builder, auto& data) {
+                    data.output = builder.createTexture("Unused buffer", {.width=16, .height=32});
+                    data.output = builder.declareRenderPass(data.output);
+                },
+                [=](FrameGraphResources const& resources, auto const& data,
+                        backend::DriverApi& driver) {
+                    EXPECT_TRUE(resources.get(data.output).handle);
+                });
+
+        fg.present(usedPass->output);
+        if (presentUnused) {
+            fg.present(unusedPass->output);
+        }
+
+        fg.compile();
+        usedCulled = fg.isCulled(usedPass);
+        unusedCulled = fg.isCulled(unusedPass);
+        fg.execute(driverApi);
+    };
+
+    bool usedCulled, unusedCulled;
+
+    FrameGraph fg0{ resourceAllocator, &cache };
+    build(fg0, false, usedCulled, unusedCulled);
+    EXPECT_EQ(cache.getHitCount(), 0);
+    EXPECT_FALSE(usedCulled);
+    EXPECT_TRUE(unusedCulled);
+
+    // same structure, the compiled graph is reused
+    FrameGraph fg1{ resourceAllocator, &cache };
+    build(fg1, false, usedCulled, unusedCulled);
+    EXPECT_EQ(cache.getHitCount(), 1);
+    EXPECT_FALSE(usedCulled);
+    EXPECT_TRUE(unusedCulled);
+
+    // different structure, the graph is compiled again
+    FrameGraph fg2{ resourceAllocator, &cache };
+    build(fg2, true, usedCulled, unusedCulled);
+    EXPECT_EQ(cache.getHitCount(), 1);
+    EXPECT_FALSE(usedCulled);
+    EXPECT_FALSE(unusedCulled);
+}
+
+TEST_F(FrameGraphTest, SharedArena) {
+
+    struct PassData {
+        FrameGraphId<FrameGraphTexture> output;
+    };
+
+    LinearAllocatorArena arena("Test Arena", CONFIG_FRAME_GRAPH_ARENA_SIZE);
+    void* const start = arena.getCurrent();
+
+    for (size_t i = 0; i < 3; i++) {
+        FrameGraph fg{ resourceAllocator, nullptr, &arena };
+        auto& pass = fg.addPass<PassData>("Pass",
+                [&](FrameGraph::Builder& builder, auto& data) {
+                    data.output = builder.createTexture("Buffer", {.width=16, .height=32});
+                    data.output = builder.declareRenderPass(data.output);
+                },
+                [=](FrameGraphResources const& resources, auto const& data,
+                        backend::DriverApi& driver) {
+                    EXPECT_TRUE(resources.get(data.output).handle);
+                });
+        fg.present(pass->output);
+        fg.compile();
+        fg.execute(driverApi);
+        EXPECT_NE(arena.getCurrent(), start);
+    }
+
+    // every graph gave its memory back, so the arena can be reused for the next frame
+    EXPECT_EQ(arena.getCurrent(), start);
+}
+
+TEST_F(FrameGraphTest, TransientTextureReuse) {
+    // with the real allocator, textures whose lifetimes don't overlap share a backend texture.
+    // The Noop backend gives the same handle to all textures, so this is checked with the
+    // allocator's statistics.
+    ResourceAllocator allocator(driverApi);
+
+    struct PassData {
+        FrameGraphId<FrameGraphTexture> input;
+        FrameGraphId<FrameGraphTexture> output;
+    };
+
+    {
+        FrameGraph fg{ allocator };
+
+        // "A" lives in the first two passes, "B" in the last one
+        auto& passA = fg.addPass<PassData>("Write A",
+                [&](FrameGraph::Builder& builder, auto& data) {
+                    data.output = builder.createTexture("A", {.width=16, .height=32});
+                    data.output = builder.declareRenderPass(data.output);
+                },
+                [=](FrameGraphResources const&, auto const&, backend::DriverApi&) {});
+
+        auto& passC = fg.addPass<PassData>("Read A, write C",
+                [&](FrameGraph::Builder& builder, auto& data) {
+                    data.input = builder.sample(passA->output);
+                    data.output = builder.createTexture("C", {.width=32, .height=32});
+                    data.output = builder.declareRenderPass(data.output);
+                },
+                [=](FrameGraphResources const&, auto const&, backend::DriverApi&) {});
+
+        // "B" has the same size and format as "A", but fewer usages
+        auto& passB = fg.addPass<PassData>("Read C, write B",
+                [&](FrameGraph::Builder& builder, auto& data) {
+                    data.input = builder.sample(passC->output);
+                    data.output = builder.createTexture("B", {.width=16, .height=32});
+                    data.output = builder.declareRenderPass(data.output);
+                },
+                [=](FrameGraphResources const& resources, auto const& data,
+                        backend::DriverApi&) {
+                    EXPECT_EQ(resources.getUsage(data.output),
+                            FrameGraphTexture::Usage::COLOR_ATTACHMENT);
+                });
+
+        fg.present(passB->output);
+        fg.compile();
+        fg.execute(driverApi);
+    }
+
+    // "A" and "C" were allocated, "B" reused the texture of "A"
+    ResourceAllocator::Statistics stats = allocator.getStatistics();
+    EXPECT_EQ(stats.missCount, 2);
+    EXPECT_EQ(stats.hitCount, 1);
+    EXPECT_EQ(stats.inUseSize, 0);
+
+    allocator.terminate();
+}
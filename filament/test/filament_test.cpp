@@ -26,25 +26,52 @@
 #include <math/scalar.h>
 
 #include <filament/Box.h>
+#include <filament/BufferObject.h>
 #include <filament/Camera.h>
 #include <filament/Color.h>
 #include <filament/Frustum.h>
+#include <filament/IndexBuffer.h>
 #include <filament/Material.h>
 #include <filament/Engine.h>
+#include <filament/Texture.h>
+#include <filament/VertexBuffer.h>
 
 #include <private/filament/UniformInterfaceBlock.h>
 #include <private/filament/UibGenerator.h>
+#include <private/filament/Variant.h>
 #include <private/backend/BackendUtils.h>
 
+#include "BonePalette.h"
+
 #include "details/Allocators.h"
 #include "details/Material.h"
+#include "details/IndexBuffer.h"
+#include "details/Renderer.h"
+#include "details/Scene.h"
+#include "details/SwapChain.h"
+#include "details/VertexBuffer.h"
 #include "details/Camera.h"
+#include "details/Culler.h"
 #include "details/Froxelizer.h"
+#include "details/OcclusionCuller.h"
+#include "details/SceneBvh.h"
+#include "details/Texture.h"
+#include "details/View.h"
 #include "details/Engine.h"
+#include "details/Fence.h"
+#include "components/LightManager.h"
 #include "components/RenderableManager.h"
 #include "components/TransformManager.h"
+#include "Intersections.h"
+#include "RenderPass.h"
 #include "UniformBuffer.h"
 
+#include <utils/EntityManager.h>
+#include <utils/JobSystem.h>
+
+#include <atomic>
+#include <thread>
+
 using namespace filament;
 using namespace filament::math;
 using namespace utils;
@@ -277,6 +304,243 @@ TEST(FilamentTest, TransformManager) {
     EXPECT_EQ(c, tcm.getChildCount(newParent));
 }
 
+TEST(FilamentTest, TransformManagerChanges) {
+    filament::FTransformManager tcm;
+    EntityManager& em = EntityManager::get();
+    std::array<Entity, 3> entities;
+    em.create(entities.size(), entities.data());
+
+    tcm.create(entities[0]);
+    TransformManager::Instance parent = tcm.getInstance(entities[0]);
+    tcm.create(entities[1], parent, mat4f{});
+    TransformManager::Instance child = tcm.getInstance(entities[1]);
+    tcm.create(entities[2]);
+    TransformManager::Instance other = tcm.getInstance(entities[2]);
+
+    // a new cursor never knows about the changes
+    FTransformManager::ChangeCursor cursor;
+    Slice<const TransformManager::Instance> changes;
+    EXPECT_FALSE(tcm.getChangedInstances(cursor, changes));
+    EXPECT_TRUE(changes.empty());
+
+    // nothing changed since
+    EXPECT_TRUE(tcm.getChangedInstances(cursor, changes));
+    EXPECT_TRUE(changes.empty());
+
+    // changing the parent changes the child's world transform
+    tcm.setTransform(parent, mat4f{ float4{ 2 }});
+    EXPECT_TRUE(tcm.getChangedInstances(cursor, changes));
+    ASSERT_EQ(changes.size(), 2u);
+    EXPECT_EQ(changes[0], parent);
+    EXPECT_EQ(changes[1], child);
+
+    tcm.setTransform(other, mat4f{ float4{ 2 }});
+    EXPECT_TRUE(tcm.getChangedInstances(cursor, changes));
+    ASSERT_EQ(changes.size(), 1u);
+    EXPECT_EQ(changes[0], other);
+
+    // destroying a component can renumber instances
+    tcm.destroy(entities[0]);
+    EXPECT_FALSE(tcm.getChangedInstances(cursor, changes));
+    EXPECT_TRUE(tcm.getChangedInstances(cursor, changes));
+    EXPECT_TRUE(changes.empty());
+
+    // and so does a local transform transaction
+    tcm.openLocalTransformTransaction();
+    tcm.setTransform(tcm.getInstance(entities[1]), mat4f{ float4{ 4 }});
+    tcm.commitLocalTransformTransaction();
+    EXPECT_FALSE(tcm.getChangedInstances(cursor, changes));
+}
+
+TEST(FilamentTest, TransformManagerAccurateTranslations) {
+    filament::FTransformManager tcm;
+    EntityManager& em = EntityManager::get();
+    std::array<Entity, 2> entities;
+    em.create(entities.size(), entities.data());
+
+    // a translation that a float can't represent
+    const double3 far{ 1e7 + 0.125, 0.0, -1e7 - 0.25 };
+
+    tcm.create(entities[0]);
+    TransformManager::Instance parent = tcm.getInstance(entities[0]);
+    tcm.setTransform(parent, mat4::translation(far));
+    tcm.create(entities[1], parent, mat4::translation(double3{ 0.5, 0.0, 0.0 }));
+    TransformManager::Instance child = tcm.getInstance(entities[1]);
+
+    // the local transform is always accurate, the world transform only when enabled
+    EXPECT_EQ(tcm.getTransformAccurate(parent)[3].xyz, far);
+    EXPECT_NE(tcm.getWorldTransformAccurate(child)[3].x, far.x + 0.5);
+
+    tcm.setAccurateTranslationsEnabled(true);
+    EXPECT_TRUE(tcm.isAccurateTranslationsEnabled());
+    const double3 world = far + double3{ 0.5, 0.0, 0.0 };
+    EXPECT_EQ(tcm.getWorldTransformAccurate(child)[3].xyz, world);
+    EXPECT_EQ(tcm.getWorldTransform(child)[3].xyz, float3{ world });
+
+    // updating the parent keeps the child accurate
+    tcm.setTransform(parent, mat4::translation(far + double3{ 0.0, 1.0, 0.0 }));
+    EXPECT_EQ(tcm.getWorldTransformAccurate(child)[3].xyz, (world + double3{ 0, 1, 0 }));
+
+    // and so does a local transform transaction
+    tcm.openLocalTransformTransaction();
+    tcm.setTransform(child, mat4::translation(double3{ 0.0, 0.0, 0.75 }));
+    tcm.commitLocalTransformTransaction();
+    EXPECT_EQ(tcm.getWorldTransformAccurate(child)[3].xyz, (far + double3{ 0, 1, 0.75 }));
+
+    // setting a float transform drops the residual
+    tcm.setTransform(parent, mat4f::translation(float3{ far }));
+    EXPECT_EQ(tcm.getTransformAccurate(parent)[3].xyz, double3{ float3{ far }});
+}
+
+TEST(FilamentTest, TransformManagerSetTransforms) {
+    filament::FTransformManager bulk;
+    filament::FTransformManager reference;
+    EntityManager& em = EntityManager::get();
+    std::array<Entity, 8> entities;
+    em.create(entities.size(), entities.data());
+
+    // a chain, so that each transform affects all the following ones
+    std::array<TransformManager::Instance, 8> instances;
+    std::array<mat4f, 8> transforms;
+    for (size_t i = 0; i < entities.size(); i++) {
+        for (auto* tcm : { &bulk, &reference }) {
+            tcm->create(entities[i], i ? tcm->getInstance(entities[i - 1]) :
+                    TransformManager::Instance{}, mat4f{});
+        }
+        instances[i] = bulk.getInstance(entities[i]);
+        transforms[i] = mat4f::translation(float3{ float(i), 1.0f, -float(i) }) *
+                mat4f::rotation(0.1f * float(i), float3{ 0, 1, 0 });
+    }
+
+    auto expectSameWorldTransforms = [&]() {
+        for (Entity e : entities) {
+            EXPECT_EQ(bulk.getWorldTransform(bulk.getInstance(e)),
+                    reference.getWorldTransform(reference.getInstance(e)));
+        }
+    };
+
+    // all of them, within a transaction
+    bulk.setTransforms(instances.data(), transforms.data(), instances.size());
+    for (size_t i = 0; i < entities.size(); i++) {
+        reference.setTransform(reference.getInstance(entities[i]), transforms[i]);
+    }
+    expectSameWorldTransforms();
+
+    // a single one, without a transaction
+    const mat4f scale = mat4f::scaling(float3{ 2 });
+    bulk.setTransforms(&instances[3], &scale, 1);
+    reference.setTransform(reference.getInstance(entities[3]), scale);
+    expectSameWorldTransforms();
+
+    // an open transaction stays open
+    const mat4f world = bulk.getWorldTransform(instances[3]);
+    bulk.openLocalTransformTransaction();
+    bulk.setTransforms(instances.data(), transforms.data(), instances.size());
+    EXPECT_EQ(bulk.getWorldTransform(instances[3]), world);
+    bulk.commitLocalTransformTransaction();
+    reference.setTransform(reference.getInstance(entities[3]), transforms[3]);
+    expectSameWorldTransforms();
+}
+
+TEST(FilamentTest, LightManagerChanges) {
+    FEngine* engine = FEngine::create();
+    FLightManager& lcm = engine->getLightManager();
+    std::array<Entity, 3> entities;
+    engine->getEntityManager().create(entities.size(), entities.data());
+    LightManager::Builder(LightManager::Type::POINT).build(*engine, entities[0]);
+    LightManager::Builder(LightManager::Type::POINT).build(*engine, entities[1]);
+    LightManager::Builder(LightManager::Type::SUN).build(*engine, entities[2]);
+    std::array<LightManager::Instance, 2> points = {
+            lcm.getInstance(entities[0]), lcm.getInstance(entities[1]) };
+    LightManager::Instance sun = lcm.getInstance(entities[2]);
+
+    // a new cursor never knows about the changes
+    FLightManager::ChangeCursor cursor;
+    Slice<const LightManager::Instance> changes;
+    EXPECT_FALSE(lcm.getChangedInstances(cursor, changes));
+    EXPECT_TRUE(lcm.getChangedInstances(cursor, changes));
+    EXPECT_TRUE(changes.empty());
+
+    // the color and the intensity of positional lights don't affect the scene's world data
+    lcm.setColor(points[0], { 1, 0, 0 });
+    lcm.setIntensity(points[0], 10.0f, FLightManager::IntensityUnit::LUMEN_LUX);
+    EXPECT_TRUE(lcm.getChangedInstances(cursor, changes));
+    EXPECT_TRUE(changes.empty());
+
+    // but the intensity of directional lights does
+    lcm.setIntensity(sun, 10.0f, FLightManager::IntensityUnit::LUMEN_LUX);
+    EXPECT_TRUE(lcm.getChangedInstances(cursor, changes));
+    ASSERT_EQ(changes.size(), 1u);
+    EXPECT_EQ(changes[0], sun);
+
+    // the bulk setters
+    LightManager& api = lcm;
+    std::array<float3, 2> positions = { float3{ 1, 2, 3 }, float3{ 4, 5, 6 } };
+    api.setPositions(points.data(), positions.data(), points.size());
+    EXPECT_EQ(lcm.getLocalPosition(points[0]), positions[0]);
+    EXPECT_EQ(lcm.getLocalPosition(points[1]), positions[1]);
+    EXPECT_TRUE(lcm.getChangedInstances(cursor, changes));
+    ASSERT_EQ(changes.size(), 2u);
+    EXPECT_EQ(changes[0], points[0]);
+    EXPECT_EQ(changes[1], points[1]);
+
+    std::array<float, 2> intensities = { 4.0f * f::PI, 8.0f * f::PI };
+    api.setIntensities(points.data(), intensities.data(), points.size());
+    EXPECT_FLOAT_EQ(lcm.getIntensity(points[0]), 1.0f);
+    EXPECT_FLOAT_EQ(lcm.getIntensity(points[1]), 2.0f);
+
+    // destroying a component can renumber instances
+    lcm.destroy(entities[0]);
+    EXPECT_FALSE(lcm.getChangedInstances(cursor, changes));
+    EXPECT_TRUE(lcm.getChangedInstances(cursor, changes));
+    EXPECT_TRUE(changes.empty());
+
+    engine->getEntityManager().destroy(entities.size(), entities.data());
+    Engine::destroy((Engine **)&engine);
+}
+
+TEST(FilamentTest, TransformManagerParallelCommit) {
+    utils::JobSystem js;
+    js.adopt();
+
+    filament::FTransformManager serial;
+    filament::FTransformManager parallel;
+    parallel.setJobSystem(&js);
+
+    // a hierarchy large enough to use the parallel path, with nodes created before their parent
+    constexpr size_t count = 10000;
+    EntityManager& em = EntityManager::get();
+    std::vector<Entity> entities(count);
+    em.create(entities.size(), entities.data());
+    for (size_t i = 0; i < count; i++) {
+        const mat4f local = mat4f::translation(float3{ float(i % 7), float(i % 5), 1 });
+        serial.create(entities[i], {}, local);
+        parallel.create(entities[i], {}, local);
+    }
+    for (size_t i = 1; i < count; i++) {
+        Entity p = entities[(i * 7919) % i];
+        serial.setParent(serial.getInstance(entities[i]), serial.getInstance(p));
+        parallel.setParent(parallel.getInstance(entities[i]), parallel.getInstance(p));
+    }
+
+    serial.openLocalTransformTransaction();
+    parallel.openLocalTransformTransaction();
+    for (size_t i = 0; i < count; i += 3) {
+        const mat4f local = mat4f::rotation(float(i), float3{ 0, 1, 0 });
+        serial.setTransform(serial.getInstance(entities[i]), local);
+        parallel.setTransform(parallel.getInstance(entities[i]), local);
+    }
+    serial.commitLocalTransformTransaction();
+    parallel.commitLocalTransformTransaction();
+
+    for (Entity e : entities) {
+        EXPECT_EQ(serial.getWorldTransform(serial.getInstance(e)),
+                parallel.getWorldTransform(parallel.getInstance(e)));
+    }
+
+    em.destroy(entities.size(), entities.data());
+}
+
 TEST(FilamentTest, UniformInterfaceBlock) {
 
     UniformInterfaceBlock::Builder b;
@@ -501,6 +765,44 @@ TEST(FilamentTest, UniformBufferSize2) {
     buffer.invalidate();
 }
 
+TEST(FilamentTest, UniformBufferDirtyRange) {
+    UniformInterfaceBlock::Builder b;
+    b.name("UniformBufferDirtyRange");
+    b.add("f4a", 1, UniformInterfaceBlock::Type::FLOAT4); // offset = 0
+    b.add("f4b", 1, UniformInterfaceBlock::Type::FLOAT4); // offset = 16
+    b.add("f1a", 1, UniformInterfaceBlock::Type::FLOAT);  // offset = 32
+    b.add("f1b", 1, UniformInterfaceBlock::Type::FLOAT);  // offset = 36
+    UniformInterfaceBlock uib(b.build());
+    UniformBuffer buffer(uib.getSize());
+
+    // a new buffer is entirely dirty
+    EXPECT_TRUE(buffer.isDirty());
+    EXPECT_EQ(buffer.getDirtyOffset(), 0);
+    EXPECT_EQ(buffer.getDirtySize(), buffer.getSize());
+
+    buffer.clean();
+    EXPECT_FALSE(buffer.isDirty());
+
+    buffer.setUniform(uib.getUniformOffset("f1a", 0), 1.0f);
+    EXPECT_TRUE(buffer.isDirty());
+    EXPECT_EQ(buffer.getDirtyOffset(), 32);
+    EXPECT_EQ(buffer.getDirtySize(), 4);
+
+    // the range grows to cover all the changes
+    buffer.setUniform(uib.getUniformOffset("f4b", 0), float4(1.0f));
+    EXPECT_EQ(buffer.getDirtyOffset(), 16);
+    EXPECT_EQ(buffer.getDirtySize(), 20);
+
+    buffer.setUniform(uib.getUniformOffset("f1b", 0), 1.0f);
+    EXPECT_EQ(buffer.getDirtyOffset(), 16);
+    EXPECT_EQ(buffer.getDirtySize(), 24);
+
+    buffer.clean();
+    buffer.invalidate();
+    EXPECT_EQ(buffer.getDirtyOffset(), 0);
+    EXPECT_EQ(buffer.getDirtySize(), buffer.getSize());
+}
+
 TEST(FilamentTest, BoxCulling) {
     Frustum frustum(mat4f::frustum(-1, 1, -1, 1, 1, 100));
 
@@ -544,6 +846,293 @@ TEST(FilamentTest, BoxCulling) {
     EXPECT_TRUE( frustum.intersects( { 0, 200 }) );
 }
 
+TEST(FilamentTest, EnclosingFrustum) {
+    const mat4 projection = mat4::frustum(-1, 1, -1, 1, 1, 100);
+    Frustum center(mat4f{ projection });
+
+    // two eyes, 1 unit apart, on each side of the center frustum
+    const mat4 eyes[2] = {
+            projection * mat4::translation(double3{  0.5, 0, 0 }),
+            projection * mat4::translation(double3{ -0.5, 0, 0 })
+    };
+    Frustum const frustum = Culler::enclose(center, eyes, 2);
+
+    // inside the center frustum
+    EXPECT_LT(frustum.contains({ 0, 0, -10 }), 0);
+    EXPECT_LT(frustum.contains({ -9.9, 9.9, -10 }), 0);
+
+    // only seen by the left or right eye
+    EXPECT_GT(center.contains({ -10.4, 0, -10 }), 0);
+    EXPECT_LT(frustum.contains({ -10.4, 0, -10 }), 0);
+    EXPECT_GT(center.contains({ 10.4, 0, -10 }), 0);
+    EXPECT_LT(frustum.contains({ 10.4, 0, -10 }), 0);
+
+    // seen by neither eye
+    EXPECT_GT(frustum.contains({ 10.6, 0, -10 }), 0);
+    EXPECT_GT(frustum.contains({ 0, 10.1, -10 }), 0);
+    EXPECT_GT(frustum.contains({ 0, 0, -100.5 }), 0);
+    EXPECT_GT(frustum.contains({ 0, 0, -0.5 }), 0);
+
+    // without eyes, the frustum is unchanged
+    Frustum const same = Culler::enclose(center, nullptr, 0);
+    for (size_t i = 0; i < 6; i++) {
+        EXPECT_EQ(same.getNormalizedPlanes()[i], center.getNormalizedPlanes()[i]);
+    }
+}
+
+TEST(FilamentTest, ScreenCoverage) {
+    // 90 degrees vertical and horizontal field of view, camera at the origin looking down -z
+    const mat4f projection{ mat4::frustum(-1, 1, -1, 1, 1, 100) };
+    const mat4f view;
+    const float3 halfExtent{ 1.0f / std::sqrt(3.0f) }; // unit radius
+
+    // a unit sphere at distance 10 covers pi / 400 of the viewport
+    EXPECT_NEAR(FView::computeScreenCoverage(view, projection, { 0, 0, -10 }, halfExtent),
+            float(F_PI) / 400.0f, 1e-5f);
+
+    // coverage falls off with the square of the distance
+    EXPECT_NEAR(FView::computeScreenCoverage(view, projection, { 0, 0, -20 }, halfExtent),
+            float(F_PI) / 1600.0f, 1e-5f);
+
+    // the camera is inside the sphere
+    EXPECT_EQ(FView::computeScreenCoverage(view, projection, { 0, 0, -0.5f }, halfExtent), 1.0f);
+
+    // orthographic projections don't depend on the distance
+    const mat4f ortho{ mat4::ortho(-10, 10, -10, 10, 1, 100) };
+    const float orthoCoverage = float(F_PI) / 400.0f;
+    EXPECT_NEAR(FView::computeScreenCoverage(view, ortho, { 0, 0, -10 }, halfExtent),
+            orthoCoverage, 1e-5f);
+    EXPECT_NEAR(FView::computeScreenCoverage(view, ortho, { 0, 0, -50 }, halfExtent),
+            orthoCoverage, 1e-5f);
+    EXPECT_EQ(FView::computeScreenCoverage(view, ortho, { 0, 0, 10 }, halfExtent), 0.0f);
+}
+
+TEST(FilamentTest, OcclusionCulling) {
+    const mat4f worldToClip = mat4f::frustum(-1, 1, -1, 1, 1, 100);
+
+    // a wall at z = -10 covering the whole screen, except a hole in the top right corner,
+    // stored as reversed-z
+    const float2 ndcToDepth{ -0.5f, 0.5f };
+    const float4 p = worldToClip * float4{ 0, 0, -10, 1 };
+    const float wallDepth = (p.z / p.w) * ndcToDepth.x + ndcToDepth.y;
+    constexpr uint32_t width = 63;
+    constexpr uint32_t height = 33;
+    std::vector<float> depth(width * height, wallDepth);
+    for (uint32_t y = height - 4; y < height; y++) {
+        for (uint32_t x = width - 4; x < width; x++) {
+            depth[y * width + x] = 0.0f;
+        }
+    }
+
+    OcclusionCuller culler;
+    EXPECT_FALSE(culler.hasDepth());
+    culler.setDepth(depth.data(), width, height, worldToClip, ndcToDepth, culler.getFrame());
+    EXPECT_TRUE(culler.hasDepth());
+
+    // behind the wall
+    EXPECT_TRUE( culler.isOccluded({ 0, 0, -20 }, 0.5f));
+    EXPECT_TRUE( culler.isOccluded({ -15, -15, -50 }, 1.0f));
+
+    // in front of, or intersecting the wall
+    EXPECT_FALSE(culler.isOccluded({ 0, 0, -5 }, 0.5f));
+    EXPECT_FALSE(culler.isOccluded({ 0, 0, -10 }, 0.5f));
+
+    // behind the hole
+    EXPECT_FALSE(culler.isOccluded({ 19.5f, 19.5f, -20 }, 0.5f));
+
+    // straddling the camera plane or outside of the screen
+    EXPECT_FALSE(culler.isOccluded({ 0, 0, 0 }, 2.0f));
+    EXPECT_FALSE(culler.isOccluded({ 0, 100, -20 }, 0.5f));
+
+    // only the requested bit is cleared
+    float3 centers[2] = {{ 0, 0, -20 }, { 0, 0, -5 }};
+    float3 extents[2] = { float3{ 0.5f }, float3{ 0.5f }};
+    Culler::result_type results[2] = { 0x3, 0x3 };
+    culler.cull(results, centers, extents, 2, 0);
+    EXPECT_EQ(results[0], 0x2);
+    EXPECT_EQ(results[1], 0x3);
+
+    // the far plane shows through the hole only
+    EXPECT_TRUE(culler.isFarPlaneVisible());
+    std::vector<float> wall(width * height, wallDepth);
+    culler.setDepth(wall.data(), width, height, worldToClip, ndcToDepth, culler.getFrame());
+    EXPECT_FALSE(culler.isFarPlaneVisible());
+
+    // an old depth buffer is not used
+    for (uint32_t i = 0; i <= OcclusionCuller::MAX_LATENCY; i++) {
+        culler.advance();
+    }
+    EXPECT_FALSE(culler.hasDepth());
+    EXPECT_TRUE(culler.isFarPlaneVisible());
+}
+
+TEST(FilamentTest, OcclusionCullingStandardDepth) {
+    const mat4f worldToClip = mat4f::frustum(-1, 1, -1, 1, 1, 100);
+
+    // a wall at z = -10 covering the whole screen, with a standard depth buffer
+    const float2 ndcToDepth{ 0.5f, 0.5f };
+    const float4 p = worldToClip * float4{ 0, 0, -10, 1 };
+    const float wallDepth = (p.z / p.w) * ndcToDepth.x + ndcToDepth.y;
+    constexpr uint32_t width = 32;
+    constexpr uint32_t height = 32;
+    std::vector<float> depth(width * height, wallDepth);
+
+    OcclusionCuller culler;
+    culler.advance();
+    culler.setDepth(depth.data(), width, height, worldToClip, ndcToDepth, culler.getFrame());
+    EXPECT_FALSE(culler.isFarPlaneVisible());
+
+    EXPECT_TRUE( culler.isOccluded({ 0, 0, -20 }, 0.5f));
+    EXPECT_FALSE(culler.isOccluded({ 0, 0, -5 }, 0.5f));
+    EXPECT_FALSE(culler.isOccluded({ 0, 0, -10 }, 0.5f));
+
+    // the depth buffer is only used in the frame following the one it was rendered in
+    culler.advance();
+    EXPECT_TRUE(culler.hasDepth());
+    culler.advance();
+    EXPECT_FALSE(culler.hasDepth());
+}
+
+TEST(FilamentTest, CullingSimd) {
+    // the SIMD implementations must match the portable ones exactly
+    std::default_random_engine gen; // NOLINT
+    std::uniform_real_distribution<float> rand(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.1f, 25.0f);
+    Frustum frustum(mat4f::perspective(45.0f, 1.0f, 0.1f, 100.0f));
+
+    constexpr size_t count = 1024;
+    std::vector<float3> centers(count);
+    std::vector<float3> extents(count);
+    std::vector<float4> spheres(count);
+    for (size_t i = 0; i < count; i++) {
+        centers[i] = { rand(gen), rand(gen), rand(gen) };
+        extents[i] = { size(gen), size(gen), size(gen) };
+        spheres[i] = { centers[i], size(gen) };
+    }
+
+    std::vector<Culler::result_type> expected(count);
+    std::vector<Culler::result_type> results(count);
+
+    Culler::Test::intersectsGeneric(expected.data(), frustum, centers.data(), extents.data(), count);
+    Culler::Test::intersects(results.data(), frustum, centers.data(), extents.data(), count);
+    for (size_t i = 0; i < count; i++) {
+        EXPECT_EQ(bool(expected[i]), bool(results[i])) << "box " << i;
+    }
+
+    // other bits are preserved
+    std::fill(results.begin(), results.end(), 0x80);
+    Culler::intersects(results.data(), frustum, centers.data(), extents.data(), count, 2);
+    for (size_t i = 0; i < count; i++) {
+        EXPECT_EQ(results[i], expected[i] ? 0x84 : 0x80) << "box " << i;
+    }
+
+    Culler::Test::intersectsGeneric(expected.data(), frustum, spheres.data(), count);
+    Culler::Test::intersects(results.data(), frustum, spheres.data(), count);
+    for (size_t i = 0; i < count; i++) {
+        EXPECT_EQ(bool(expected[i]), bool(results[i])) << "sphere " << i;
+    }
+}
+
+TEST(FilamentTest, SceneBvhCulling) {
+    // the hierarchy must cull exactly like the linear loop
+    utils::JobSystem js;
+    js.adopt();
+
+    std::default_random_engine gen; // NOLINT
+    std::uniform_real_distribution<float> rand(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> size(0.1f, 5.0f);
+    Frustum frustum(mat4f::perspective(45.0f, 1.0f, 0.1f, 300.0f));
+
+    constexpr size_t count = 3 * SceneBvh::JOB_SIZE + 5;
+    std::vector<uint32_t> keys(count);
+    std::vector<float3> centers(Culler::round(count));
+    std::vector<float3> extents(Culler::round(count));
+    for (size_t i = 0; i < count; i++) {
+        keys[i] = uint32_t(i * 3 + 1);
+        centers[i] = { rand(gen), rand(gen), rand(gen) };
+        extents[i] = { size(gen), size(gen), size(gen) };
+    }
+
+    // the rows are in the reverse order of the keys
+    std::vector<uint32_t> rows(count * 3 + 1);
+    for (size_t i = 0; i < count; i++) {
+        rows[keys[i]] = uint32_t(count - 1 - i);
+    }
+
+    SceneBvh bvh;
+    bvh.build(keys.data(), centers.data(), extents.data(), count);
+    EXPECT_EQ(bvh.size(), count);
+
+    auto check = [&]() {
+        std::vector<Culler::result_type> expected(Culler::round(count));
+        Culler::intersects(expected.data(), frustum, centers.data(), extents.data(), count, 0);
+        std::vector<Culler::result_type> results(count, 0x80);
+        bvh.cull(js, results.data(), rows.data(), frustum, 2);
+        size_t visible = 0;
+        for (size_t i = 0; i < count; i++) {
+            EXPECT_EQ(results[count - 1 - i], expected[i] ? 0x84 : 0x80) << "box " << i;
+            visible += expected[i] ? 1 : 0;
+        }
+        EXPECT_GT(visible, 0);
+        EXPECT_LT(visible, count);
+    };
+    check();
+
+    // move some of the boxes around, and refit
+    for (size_t i = 0; i < count; i += 7) {
+        centers[i] = { rand(gen), rand(gen), rand(gen) };
+        bvh.update(keys[i], centers[i], extents[i]);
+    }
+    bvh.refit();
+    check();
+
+    // keys that aren't in the hierarchy are ignored
+    bvh.update(0, float3(0), float3(1000));
+    bvh.update(uint32_t(count * 3 + 10), float3(0), float3(1000));
+    bvh.refit();
+    check();
+
+    js.emancipate();
+}
+
+TEST(FilamentTest, RadixSortCommands) {
+    using Command = RenderPass::Command;
+    std::default_random_engine gen; // NOLINT
+    std::uniform_int_distribution<uint64_t> rand;
+
+    utils::JobSystem js;
+    js.adopt();
+
+    for (uint32_t count : { 1u, 1000u, 5000u, 40000u }) {
+        std::vector<Command> commands(count);
+        for (uint32_t i = 0; i < count; i++) {
+            // leave some digits constant and add plenty of sentinels, like real passes do
+            uint64_t key = rand(gen) & 0x0C0003FF0000FFFFllu;
+            commands[i].key = (i % 3) ? key : uint64_t(RenderPass::Pass::SENTINEL);
+            commands[i].info = i;
+        }
+
+        std::vector<Command> expected(commands);
+        std::stable_sort(expected.begin(), expected.end());
+
+        std::vector<uint8_t> scratch(RenderPass::getRadixSortScratchSize(count));
+        EXPECT_FALSE(RenderPass::radixSortCommands(js, commands.data(), count,
+                scratch.data(), scratch.size() - 1));
+        EXPECT_TRUE(RenderPass::radixSortCommands(js, commands.data(), count,
+                scratch.data(), scratch.size()));
+
+        for (uint32_t i = 0; i < count; i++) {
+            EXPECT_EQ(expected[i].key, commands[i].key);
+            if (commands[i].key != uint64_t(RenderPass::Pass::SENTINEL)) {
+                // the sort must be stable
+                EXPECT_EQ(expected[i].info, commands[i].info);
+            }
+        }
+    }
+
+    js.emancipate();
+}
+
 TEST(FilamentTest, SphereCulling) {
     Frustum frustum(mat4f::frustum(-1, 1, -1, 1, 1, 100));
 
@@ -688,8 +1277,8 @@ TEST(FilamentTest, FroxelData) {
     LightManager::Instance instance = engine->getLightManager().getInstance(e);
 
     FScene::LightSoa lights;
-    lights.push_back({}, {}, {}, {}, {}, {});   // first one is always skipped
-    lights.push_back(float4{ 0, 0, -5, 1 }, {}, instance, 1, {}, {});
+    lights.push_back({}, {}, {}, {}, {}, {}, {});   // first one is always skipped
+    lights.push_back(float4{ 0, 0, -5, 1 }, {}, instance, 1, {}, {}, 1.0f);
 
     {
         froxelData.froxelizeLights(*engine, {}, lights);
@@ -702,6 +1291,13 @@ TEST(FilamentTest, FroxelData) {
             pointCount += entry.count;
         }
         EXPECT_GT(pointCount, 0);
+
+        size_t froxelPointCount = 0;
+        for (size_t i = 0, c = froxelData.getFroxelCount(); i < c; i++) {
+            froxelPointCount += froxelBuffer[i].count;
+        }
+        EXPECT_FLOAT_EQ(float(froxelPointCount) / float(froxelData.getFroxelCount()),
+                froxelData.getAverageLightCount());
     }
 
     {
@@ -727,6 +1323,80 @@ TEST(FilamentTest, FroxelData) {
     Engine::destroy((Engine **)&engine);
 }
 
+TEST(FilamentTest, FroxelSliceCount) {
+    using namespace filament;
+
+    FEngine* engine = FEngine::create();
+
+    LinearAllocatorArena arena("FRenderer: per-frame allocator", FEngine::CONFIG_PER_RENDER_PASS_ARENA_SIZE);
+
+    Viewport vp(0, 0, 1280, 640);
+    mat4f p = mat4f::perspective(90, 1.0f, 0.1, 100, mat4f::Fov::HORIZONTAL);
+
+    Froxelizer froxelData(*engine);
+    auto prepare = [&]() {
+        // the per-frame allocations are only needed for froxelizing
+        utils::ArenaScope<LinearAllocatorArena> scope(arena);
+        froxelData.prepare(engine->getDriverApi(), scope, vp, p, 0.1, 100);
+    };
+
+    froxelData.setOptions(5, 100);
+    prepare();
+    EXPECT_EQ(froxelData.getFroxelCountZ(), FEngine::CONFIG_FROXEL_SLICE_COUNT);
+    const size_t planeCount = froxelData.getFroxelCountX() * froxelData.getFroxelCountY();
+
+    // fewer slices leave more froxels to the x-y plane
+    froxelData.setOptions(5, 100, 4);
+    prepare();
+    EXPECT_EQ(froxelData.getFroxelCountZ(), 4);
+    EXPECT_GT(froxelData.getFroxelCountX() * froxelData.getFroxelCountY(), planeCount);
+
+    // the last slice always ends at zLightFar
+    Froxel l = froxelData.getFroxelAt(0, 0, froxelData.getFroxelCountZ() - 1);
+    EXPECT_FLOAT_EQ(100, -l.planes[Froxel::FAR].w);
+
+    // out of range slice counts are clamped
+    froxelData.setOptions(5, 100, 1000);
+    prepare();
+    EXPECT_EQ(froxelData.getFroxelCountZ(), Froxelizer::FROXEL_SLICE_COUNT_MAX);
+
+    froxelData.terminate(engine->getDriverApi());
+
+    Engine::destroy((Engine **)&engine);
+}
+
+TEST(FilamentTest, SpotLightBoundingSphere) {
+    using namespace filament;
+
+    const float3 position{ 1, 2, 3 };
+    const float3 axis{ 0, 0, -1 };
+    const float radius = 10.0f;
+
+    // the sphere must contain the apex, the rim and the tip of the cone
+    auto contains = [&](float4 const& sphere, float angle) {
+        const float c = std::cos(angle);
+        const float s = std::sin(angle);
+        const float r = sphere.w * 1.0001f;
+        return distance(sphere.xyz, position) <= r &&
+               distance(sphere.xyz, position + radius * axis) <= r &&
+               distance(sphere.xyz, position + radius * float3{ s, 0, -c }) <= r &&
+               distance(sphere.xyz, position + radius * float3{ 0, -s, -c }) <= r;
+    };
+
+    for (float degrees : { 5.0f, 20.0f, 45.0f, 60.0f, 89.0f }) {
+        const float angle = degrees * f::DEG_TO_RAD;
+        float4 sphere = spotLightBoundingSphere(position, axis,
+                std::cos(angle), std::sin(angle), radius);
+        EXPECT_PRED2(contains, sphere, angle);
+        EXPECT_LE(sphere.w, radius * 1.0001f);
+    }
+
+    // a narrow cone is bounded by a much smaller sphere than its range
+    float4 narrow = spotLightBoundingSphere(position, axis,
+            std::cos(10.0f * f::DEG_TO_RAD), std::sin(10.0f * f::DEG_TO_RAD), radius);
+    EXPECT_LT(narrow.w, 0.51f * radius);
+}
+
 TEST(FilamentTest, Bones) {
 
     struct Shader {
@@ -860,6 +1530,152 @@ TEST(FilamentTest, Bones) {
     }
 }
 
+TEST(FilamentTest, BonePaletteRanges) {
+    FEngine* engine = FEngine::create();
+    FEngine::DriverApi& driver = engine->getDriverApi();
+    constexpr uint32_t N = BonePalette::BONES_PER_UNIT;
+
+    BonePalette palette;
+
+    // empty ranges are bound at the start of the buffer, which exists from then on
+    BonePalette::Range empty = palette.allocate(driver, 0);
+    EXPECT_EQ(0, empty.offset);
+    EXPECT_EQ(0, empty.count);
+    EXPECT_TRUE(bool(palette.getHandle()));
+
+    // ranges are aligned
+    BonePalette::Range a = palette.allocate(driver, N + 1);
+    BonePalette::Range b = palette.allocate(driver, 1);
+    BonePalette::Range c = palette.allocate(driver, N);
+    EXPECT_EQ(0, a.offset);
+    EXPECT_EQ(2 * N, b.offset);
+    EXPECT_EQ(3 * N, c.offset);
+    EXPECT_EQ(2, BonePalette::getBindingOffset(b));
+
+    // freed ranges are merged and reused, first fit
+    palette.free(a);
+    palette.free(b);
+    BonePalette::Range d = palette.allocate(driver, 3 * N);
+    EXPECT_EQ(0, d.offset);
+
+    // freeing the last range shrinks the used part of the buffer
+    palette.free(c);
+    BonePalette::Range e = palette.allocate(driver, N);
+    EXPECT_EQ(3 * N, e.offset);
+
+    // growing the buffer keeps the ranges
+    BonePalette::Range f = palette.allocate(driver, 8 * CONFIG_MAX_BONE_COUNT);
+    EXPECT_EQ(4 * N, f.offset);
+    palette.invalidate(f, 0, f.count)[0] = PerRenderableUibBone{};
+
+    palette.free(d);
+    palette.free(e);
+    palette.free(f);
+    palette.terminate(driver);
+    Engine::destroy((Engine **)&engine);
+}
+
+TEST(FilamentTest, LevelOfDetailSelection) {
+    FRenderableManager::LevelsOfDetail lod;
+    lod.count = 3;
+    lod.screenSizes[0] = 0.5f;
+    lod.screenSizes[1] = 0.25f;
+
+    auto select = [&lod](float screenSize) {
+        lod.current = FRenderableManager::selectLod(lod, screenSize);
+        return lod.current;
+    };
+
+    EXPECT_EQ(0, select(1.0f));
+    EXPECT_EQ(0, select(0.47f));    // within the hysteresis margin
+    EXPECT_EQ(1, select(0.44f));
+    EXPECT_EQ(1, select(0.53f));    // within the hysteresis margin
+    EXPECT_EQ(0, select(0.56f));
+    EXPECT_EQ(2, select(0.01f));
+    EXPECT_EQ(2, select(0.26f));
+    EXPECT_EQ(0, select(10.0f));
+
+    // a single level is always selected
+    lod.count = 1;
+    lod.current = 0;
+    EXPECT_EQ(0, select(0.01f));
+}
+
+TEST(FilamentTest, ShadingLevelOfDetailSelection) {
+    FRenderableManager::LevelsOfDetail lod;
+
+    auto select = [&lod](float screenSize) {
+        lod.reducedShading = FRenderableManager::selectReducedShading(lod, screenSize);
+        return lod.reducedShading;
+    };
+
+    // disabled by default
+    EXPECT_FALSE(select(0.0f));
+
+    lod.shadingScreenSize = 0.1f;
+    EXPECT_FALSE(select(1.0f));
+    EXPECT_FALSE(select(0.095f));   // within the hysteresis margin
+    EXPECT_TRUE(select(0.085f));
+    EXPECT_TRUE(select(0.105f));    // within the hysteresis margin
+    EXPECT_FALSE(select(0.115f));
+}
+
+TEST(FilamentTest, TextureRequiredLevel) {
+    // a 1024x1024 texture has 11 levels
+    EXPECT_EQ(0, FTexture::requiredLevel(1024, 2048.0f, 11));
+    EXPECT_EQ(0, FTexture::requiredLevel(1024, 1024.0f, 11));
+    EXPECT_EQ(0, FTexture::requiredLevel(1024, 600.0f, 11));    // level 1 would be magnified
+    EXPECT_EQ(1, FTexture::requiredLevel(1024, 512.0f, 11));
+    EXPECT_EQ(1, FTexture::requiredLevel(1024, 300.0f, 11));
+    EXPECT_EQ(8, FTexture::requiredLevel(1024, 4.0f, 11));
+    EXPECT_EQ(10, FTexture::requiredLevel(1024, 0.01f, 11));
+
+    // clamped to the levels the texture has
+    EXPECT_EQ(3, FTexture::requiredLevel(1024, 1.0f, 4));
+    EXPECT_EQ(10, FTexture::requiredLevel(1024, std::numeric_limits<float>::quiet_NaN(), 11));
+}
+
+TEST(FilamentTest, VariantPickingAndFog) {
+    // PICKING and FOG share a bit, which means fog on color variants and picking on depth ones
+    Variant fog(Variant::FOG | Variant::DIRECTIONAL_LIGHTING);
+    EXPECT_TRUE(fog.hasFog());
+    EXPECT_FALSE(fog.hasPicking());
+    EXPECT_FALSE(Variant::isReserved(fog.key));
+
+    Variant picking(Variant::DEPTH);
+    EXPECT_FALSE(picking.hasPicking());
+    picking.setPicking(true);
+    EXPECT_TRUE(picking.hasPicking());
+    EXPECT_FALSE(picking.hasFog());
+    EXPECT_FALSE(Variant::isReserved(picking.key));
+
+    // skinned renderables can be picked
+    EXPECT_FALSE(Variant::isReserved(Variant::DEPTH | Variant::PICKING |
+            Variant::SKINNING_OR_MORPHING));
+
+    // a depth variant is either VSM or picking
+    EXPECT_FALSE(Variant::isReserved(Variant::DEPTH | Variant::VSM));
+    EXPECT_TRUE(Variant::isReserved(Variant::DEPTH | Variant::VSM | Variant::PICKING));
+
+    // but color variants can have both VSM and fog
+    EXPECT_FALSE(Variant::isReserved(Variant::VSM | Variant::FOG |
+            Variant::SHADOW_RECEIVER | Variant::DIRECTIONAL_LIGHTING));
+
+    // lighting bits still make depth variants invalid
+    EXPECT_TRUE(Variant::isReserved(Variant::DEPTH | Variant::PICKING |
+            Variant::DIRECTIONAL_LIGHTING));
+
+    for (uint8_t key = 0; key < VARIANT_COUNT; key++) {
+        if (Variant::isReserved(key)) {
+            continue;
+        }
+        Variant variant(key);
+        const bool depth = key & Variant::DEPTH;
+        EXPECT_EQ(variant.hasFog(), !depth && (key & Variant::FOG)) << int(key);
+        EXPECT_EQ(variant.hasPicking(), depth && (key & Variant::PICKING)) << int(key);
+    }
+}
+
 TEST(FilamentTest, GoogleLineDirective) {
     {
         char s[512] = "#line 10 \"foobar\"";
@@ -905,6 +1721,152 @@ TEST(FilamentTest, GoogleLineDirective) {
     }
 }
 
+TEST(FilamentTest, UploadsFromAnyThread) {
+    FEngine* engine = FEngine::create(backend::Backend::NOOP);
+
+    BufferObject* bufferObject = BufferObject::Builder().size(16).build(*engine);
+    Texture* texture = Texture::Builder()
+            .width(2).height(2).format(Texture::InternalFormat::RGBA8).build(*engine);
+
+    static uint8_t const data[16] = {};
+    std::atomic<int> released{ 0 };
+    auto callback = [](void*, size_t, void* user) {
+        static_cast<std::atomic<int>*>(user)->fetch_add(1);
+    };
+
+    // uploads issued by another thread are queued...
+    std::thread worker([&]() {
+        bufferObject->setBuffer(*engine, { data, sizeof(data), callback, &released });
+        texture->setImage(*engine, 0, { data, sizeof(data),
+                Texture::Format::RGBA, Texture::Type::UBYTE, callback, &released });
+    });
+    worker.join();
+
+    // ...so draining the command stream doesn't release their buffers...
+    FFence::waitAndDestroy(engine->createFence(FFence::Type::SOFT), FFence::Mode::FLUSH);
+    engine->getDriver().purge();
+    EXPECT_EQ(released.load(), 0);
+
+    // ...until the engine thread records them, here with flushAndWait()
+    engine->flushAndWait();
+    EXPECT_EQ(released.load(), 2);
+
+    // uploads issued by the engine thread are recorded immediately
+    bufferObject->setBuffer(*engine, { data, sizeof(data), callback, &released });
+    FFence::waitAndDestroy(engine->createFence(FFence::Type::SOFT), FFence::Mode::FLUSH);
+    engine->getDriver().purge();
+    EXPECT_EQ(released.load(), 3);
+
+    // a queued upload is recorded before the object it targets is destroyed
+    std::thread([&]() {
+        bufferObject->setBuffer(*engine, { data, sizeof(data), callback, &released });
+    }).join();
+    engine->destroy(bufferObject);
+    engine->flushAndWait();
+    EXPECT_EQ(released.load(), 4);
+
+    engine->destroy(texture);
+    Engine::destroy((Engine **)&engine);
+}
+
+TEST(FilamentTest, ShadowMapCaching) {
+    FEngine* engine = FEngine::create(backend::Backend::NOOP);
+    SwapChain* swapChain = engine->createSwapChain(64, 64, 0);
+    Renderer* renderer = engine->createRenderer();
+    FScene* scene = engine->createScene();
+    FView* view = engine->createView();
+
+    utils::EntityManager& em = utils::EntityManager::get();
+    Entity cameraEntity = em.create();
+    FCamera* camera = engine->createCamera(cameraEntity);
+    camera->setProjection(45.0, 1.0, 0.1, 100.0);
+    camera->lookAt({ 0, 2, 6 }, { 0, 0, 0 });
+    view->setCamera(camera);
+    view->setScene(scene);
+    view->setViewport({ 0, 0, 64, 64 });
+
+    // a unit cube, which casts a shadow onto itself
+    static float3 const vertices[] = {
+            { -1, -1, -1 }, { 1, -1, -1 }, { 1, 1, -1 }, { -1, 1, -1 },
+            { -1, -1,  1 }, { 1, -1,  1 }, { 1, 1,  1 }, { -1, 1,  1 } };
+    static uint16_t const indices[] = {
+            0, 2, 1, 0, 3, 2,   4, 5, 6, 4, 6, 7,   0, 1, 5, 0, 5, 4,
+            3, 6, 2, 3, 7, 6,   0, 4, 7, 0, 7, 3,   1, 2, 6, 1, 6, 5 };
+    FVertexBuffer* vb = upcast(VertexBuffer::Builder()
+            .vertexCount(8).bufferCount(1)
+            .attribute(VertexAttribute::POSITION, 0, VertexBuffer::AttributeType::FLOAT3)
+            .build(*engine));
+    vb->setBufferAt(*engine, 0, { vertices, sizeof(vertices) });
+    FIndexBuffer* ib = upcast(IndexBuffer::Builder()
+            .indexCount(36).bufferType(IndexBuffer::IndexType::USHORT)
+            .build(*engine));
+    ib->setBuffer(*engine, { indices, sizeof(indices) });
+
+    Entity cube = em.create();
+    RenderableManager::Builder(1)
+            .boundingBox({ { 0, 0, 0 }, { 1, 1, 1 } })
+            .geometry(0, RenderableManager::PrimitiveType::TRIANGLES, vb, ib)
+            .material(0, engine->getDefaultMaterial()->getDefaultInstance())
+            .castShadows(true)
+            .receiveShadows(true)
+            .build(*engine, cube);
+    scene->addEntity(cube);
+
+    Entity sun = em.create();
+    LightManager::Builder(LightManager::Type::SUN)
+            .direction({ 0.3f, -1.0f, -0.5f })
+            .castShadows(true)
+            .build(*engine, sun);
+    scene->addEntity(sun);
+
+    // returns the number of shadow maps rendered by the frame
+    auto renderFrame = [&]() -> size_t {
+        if (renderer->beginFrame(swapChain)) {
+            renderer->render(view);
+            renderer->endFrame();
+        }
+        engine->flushAndWait();
+        return view->getShadowMapManager().getRenderedShadowMapCount();
+    };
+
+    view->setShadowMapCachingEnabled(true);
+
+    // the shadow map is rendered once, then reused while nothing changes
+    EXPECT_EQ(renderFrame(), 1u);
+    EXPECT_EQ(renderFrame(), 0u);
+    EXPECT_EQ(renderFrame(), 0u);
+
+    // moving the caster invalidates it
+    FTransformManager& tcm = engine->getTransformManager();
+    tcm.setTransform(tcm.getInstance(cube), mat4f::translation(float3{ 0.5f, 0, 0 }));
+    EXPECT_EQ(renderFrame(), 1u);
+    EXPECT_EQ(renderFrame(), 0u);
+
+    // so does changing the light
+    FLightManager& lcm = engine->getLightManager();
+    lcm.setDirection(lcm.getInstance(sun), { -0.3f, -1.0f, -0.5f });
+    EXPECT_EQ(renderFrame(), 1u);
+
+    // without caching, the shadow map is rendered every frame
+    view->setShadowMapCachingEnabled(false);
+    EXPECT_EQ(renderFrame(), 1u);
+    EXPECT_EQ(renderFrame(), 1u);
+
+    engine->destroy(cube);
+    engine->destroy(sun);
+    engine->destroy(vb);
+    engine->destroy(ib);
+    engine->destroyCameraComponent(cameraEntity);
+    em.destroy(cube);
+    em.destroy(sun);
+    em.destroy(cameraEntity);
+    engine->destroy(view);
+    engine->destroy(scene);
+    engine->destroy(upcast(renderer));
+    engine->destroy(upcast(swapChain));
+    Engine::destroy((Engine **)&engine);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
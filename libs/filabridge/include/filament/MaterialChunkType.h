@@ -74,12 +74,14 @@ enum UTILS_PUBLIC ChunkType : uint64_t {
     MaterialCullingMode = charTo64bitNum("MAT_CUMO"),
 
     MaterialHasCustomDepthShader =charTo64bitNum("MAT_CSDP"),
+    MaterialFoldedVariants = charTo64bitNum("MAT_FVAR"),
 
     MaterialVertexDomain = charTo64bitNum("MAT_VEDO"),
     MaterialInterpolation = charTo64bitNum("MAT_INTR"),
 
     DictionaryText = charTo64bitNum("DIC_TEXT"),
     DictionarySpirv = charTo64bitNum("DIC_SPIR"),
+    DictionaryTextCompressed = charTo64bitNum("DIC_TXTZ"),
 };
 
 } // namespace filamat
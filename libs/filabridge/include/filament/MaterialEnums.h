@@ -176,6 +176,23 @@ enum class RefractionType : uint8_t {
     THIN            = 1, //!< refraction through thin objects (e.g. window)
 };
 
+/**
+ * Variants of a surface material, used to select the programs created by Material::compile().
+ * Variants combining several of these bits are selected when all their bits are.
+ */
+enum class UserVariantFilterBit : uint32_t {
+    DIRECTIONAL_LIGHTING    = 0x01, //!< directional light
+    DYNAMIC_LIGHTING        = 0x02, //!< point, spot or area lights
+    SHADOW_RECEIVER         = 0x04, //!< receives shadows
+    SKINNING                = 0x08, //!< skinning and morphing
+    FOG                     = 0x20, //!< fog
+    VSM                     = 0x40, //!< variance shadow maps
+    ALL                     = 0x6F, //!< all of the above
+};
+
+//! A combination of UserVariantFilterBit
+using UserVariantFilterMask = uint32_t;
+
 // can't really use std::underlying_type<AttributeIndex>::type because the driver takes a uint32_t
 using AttributeBitset = utils::bitset32;
 
@@ -62,6 +62,9 @@ constexpr size_t CONFIG_MAX_SHADOW_CASCADES = 4;
 // We store 64 bytes per bone.
 constexpr size_t CONFIG_MAX_BONE_COUNT = 256;
 
+// Maximum number of levels of detail of a renderable, including the most detailed one.
+constexpr size_t CONFIG_MAX_LOD_COUNT = 4;
+
 } // namespace filament
 
 #endif // TNT_FILAMENT_driver/EngineEnums.h
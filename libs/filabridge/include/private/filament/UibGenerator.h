@@ -128,8 +128,11 @@ struct PerViewUib { // NOLINT(cppcoreguidelines-pro-type-member-init)
     math::float2 clipControl;
     math::float2 padding1;
 
+    // unjittered clipFromWorldMatrix of the previous frame, for motion vectors
+    filament::math::mat4f previousClipFromWorldMatrix;
+
     // bring PerViewUib to 2 KiB
-    filament::math::float4 padding2[60];
+    filament::math::float4 padding2[56];
 };
 
 // 2 KiB == 128 float4s
@@ -145,7 +148,8 @@ struct alignas(256) PerRenderableUib {
     int32_t skinningEnabled; // 0=disabled, 1=enabled, ignored unless variant & SKINNING_OR_MORPHING
     int32_t morphingEnabled; // 0=disabled, 1=enabled, ignored unless variant & SKINNING_OR_MORPHING
     uint32_t screenSpaceContactShadows; // 0=disabled, 1=enabled, ignored unless variant & SKINNING_OR_MORPHING
-    float padding0;
+    uint32_t objectId; // the renderable's entity, written by the picking variant
+    filament::math::mat4f previousWorldFromModelMatrix; // for motion vectors
 };
 
 struct LightsUib {
@@ -36,6 +36,7 @@ namespace filament {
         // SKN: Skinning
         // DEP: Depth only
         // FOG: Fog
+        // PCK: Picking (depth variants only, shares the FOG bit)
         // VSM: Variance shadow maps
         //
         //   X: either 1 or 0
@@ -46,7 +47,9 @@ namespace filament {
         // Reserved variants:
         //       Vertex depth            X     0     1     X     0     0     0
         //     Fragment depth            X     0     1     0     0     0     0
+        //   Fragment picking            0     1     1     0     0     0     0
         //           Reserved            X     X     1     X     X     X     X
+        //           Reserved            1     1     1     X     X     X     X
         //           Reserved            X     X     0     X     1     0     0
         //           Reserved            1     X     0     X     0     X     X
         //
@@ -65,6 +68,7 @@ namespace filament {
         static constexpr uint8_t DEPTH                  = 0x10; // depth only variants
         static constexpr uint8_t FOG                    = 0x20; // fog
         static constexpr uint8_t VSM                    = 0x40; // variance shadow maps
+        static constexpr uint8_t PICKING                = FOG;  // object id output, depth only
 
         static constexpr uint8_t VERTEX_MASK = DIRECTIONAL_LIGHTING |
                                                DYNAMIC_LIGHTING |
@@ -82,8 +86,7 @@ namespace filament {
         static constexpr uint8_t DEPTH_MASK = DIRECTIONAL_LIGHTING |
                                               DYNAMIC_LIGHTING |
                                               SHADOW_RECEIVER |
-                                              DEPTH |
-                                              FOG;
+                                              DEPTH;
 
         // the depth variant deactivates all variants that make no sense when writing the depth
         // only -- essentially, all fragment-only variants.
@@ -92,12 +95,19 @@ namespace filament {
         // this mask filters out the lighting variants
         static constexpr uint8_t UNLIT_MASK    = SKINNING_OR_MORPHING | FOG;
 
+        // the variants a material can fold into their enabled version, which the engine turns
+        // into a no-op with uniforms when the feature is disabled (e.g. a fog density of 0)
+        static constexpr uint8_t FOLDABLE_MASK = FOG;
+
         inline bool hasSkinningOrMorphing() const noexcept { return key & SKINNING_OR_MORPHING; }
         inline bool hasDirectionalLighting() const noexcept { return key & DIRECTIONAL_LIGHTING; }
         inline bool hasDynamicLighting() const noexcept { return key & DYNAMIC_LIGHTING; }
         inline bool hasShadowReceiver() const noexcept { return key & SHADOW_RECEIVER; }
-        inline bool hasFog() const noexcept { return key & FOG; }
+        inline bool hasFog() const noexcept { return (key & (FOG | DEPTH)) == FOG; }
         inline bool hasVsm() const noexcept { return key & VSM; }
+        inline bool hasPicking() const noexcept {
+            return (key & (PICKING | DEPTH)) == (PICKING | DEPTH);
+        }
 
         inline void setSkinning(bool v) noexcept { set(v, SKINNING_OR_MORPHING); }
         inline void setDirectionalLighting(bool v) noexcept { set(v, DIRECTIONAL_LIGHTING); }
@@ -105,6 +115,7 @@ namespace filament {
         inline void setShadowReceiver(bool v) noexcept { set(v, SHADOW_RECEIVER); }
         inline void setFog(bool v) noexcept { set(v, FOG); }
         inline void setVsm(bool v) noexcept { set(v, VSM); }
+        inline void setPicking(bool v) noexcept { set(v, PICKING); }
 
         inline constexpr bool isDepthPass() const noexcept {
             return isValidDepthVariant(key);
@@ -123,10 +134,12 @@ namespace filament {
             // 2. If SRE is set, either DYN or DIR must also be set (it makes no sense to have
             // shadows without lights).
             // 3. If VSM is set, then SRE must be set.
+            // 4. A depth variant can't be both VSM and picking.
             return
                 ((variantKey & DEPTH) && !isValidDepthVariant(variantKey)) ||
                 (variantKey & 0b0010111u) == 0b0000100u ||
-                (variantKey & 0b1010100u) == 0b1000000u;
+                (variantKey & 0b1010100u) == 0b1000000u ||
+                (variantKey & 0b1110000u) == 0b1110000u;
         }
 
         static constexpr uint8_t filterVariantVertex(uint8_t variantKey) noexcept {
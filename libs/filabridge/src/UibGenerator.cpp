@@ -109,8 +109,11 @@ UniformInterfaceBlock const& UibGenerator::getPerViewUib() noexcept  {
             .add("clipControl",             1, UniformInterfaceBlock::Type::FLOAT2)
             .add("padding1",                1, UniformInterfaceBlock::Type::FLOAT2)
 
+            // motion vectors
+            .add("previousClipFromWorldMatrix", 1, UniformInterfaceBlock::Type::MAT4, Precision::HIGH)
+
             // bring PerViewUib to 2 KiB
-            .add("padding2", 60, UniformInterfaceBlock::Type::FLOAT4)
+            .add("padding2", 56, UniformInterfaceBlock::Type::FLOAT4)
             .build();
     return uib;
 }
@@ -124,7 +127,8 @@ UniformInterfaceBlock const& UibGenerator::getPerRenderableUib() noexcept {
             .add("skinningEnabled", 1, UniformInterfaceBlock::Type::INT)
             .add("morphingEnabled", 1, UniformInterfaceBlock::Type::INT)
             .add("screenSpaceContactShadows", 1, UniformInterfaceBlock::Type::UINT)
-            .add("padding0", 1, UniformInterfaceBlock::Type::FLOAT)
+            .add("objectId", 1, UniformInterfaceBlock::Type::UINT)
+            .add("previousWorldFromModelMatrix", 1, UniformInterfaceBlock::Type::MAT4, Precision::HIGH)
             .build();
     return uib;
 }
@@ -17,6 +17,8 @@
 #ifndef TNT_FILAFLAT_BLOBDICTIONARY_H
 #define TNT_FILAFLAT_BLOBDICTIONARY_H
 
+#include <utils/compiler.h>
+
 #include <cstdint>
 #include <vector>
 
@@ -24,45 +26,125 @@
 
 namespace filaflat {
 
-// Flat list of blobs that can be referenced by index.
+/*
+ * Flat list of blobs that can be referenced by index.
+ *
+ * Blobs are either owned by the dictionary, or reference the material package in place, in which
+ * case the package must outlive the dictionary. Blobs that are stored encoded in the package
+ * (compressed text blocks, smol-v SPIR-V) are decoded the first time they are requested.
+ * Because of this, the getters are not thread-safe.
+ */
 class BlobDictionary {
 public:
     BlobDictionary() = default;
     ~BlobDictionary() = default;
 
+    BlobDictionary(BlobDictionary const&) = delete;
+    BlobDictionary& operator=(BlobDictionary const&) = delete;
+
     using Blob = std::vector<uint8_t>;
 
+    // Decodes an encoded blob into dst, returns false if the data is invalid.
+    using Decoder = bool(*)(const char* data, size_t size, Blob& dst);
+
+    // copies the blob
     inline void addBlob(const char* blob, size_t len) noexcept {
-        mBlobs.emplace_back(blob, blob + len);
+        addBlob(Blob(blob, blob + len));
     }
 
     inline void addBlob(Blob&& blob) noexcept {
-        mBlobs.push_back(std::move(blob));
+        mStorage.push_back(std::move(blob));
+        Blob const& b = mStorage.back();
+        mEntries.push_back({ (const char*) b.data(), b.size(), false });
+    }
+
+    // references the blob in place
+    inline void addReference(const char* blob, size_t len) noexcept {
+        mEntries.push_back({ blob, len, false });
+    }
+
+    // references an encoded blob in place, it is decoded with the dictionary's decoder when used
+    inline void addEncoded(const char* blob, size_t len) noexcept {
+        mEntries.push_back({ blob, len, true });
+    }
+
+    inline void setDecoder(Decoder decoder) noexcept {
+        mDecoder = decoder;
     }
 
     inline bool isEmpty() const noexcept {
-        return mBlobs.empty();
+        return mEntries.empty();
     }
 
     inline void reserve(size_t size) {
-        mBlobs.reserve(size);
+        mEntries.reserve(size);
     }
 
+    /*
+     * Sets up the dictionary to hold stringCount null-terminated strings, stored in
+     * zlib-compressed blocks of linesPerBlock strings. The blocks are added with
+     * addCompressedBlock() and are inflated lazily, the first time one of their strings is used.
+     * The compressed data is not copied and must outlive the dictionary.
+     */
+    void reserveCompressed(size_t stringCount, size_t linesPerBlock, size_t blockCount);
+
+    void addCompressedBlock(const char* data, size_t size, size_t uncompressedSize) noexcept;
+
     inline const char* getBlob(size_t index, size_t* size) const noexcept {
-        *size = mBlobs[index].size();
-        return (const char*) mBlobs[index].data();
+        Entry const& entry = mEntries[index];
+        if (UTILS_UNLIKELY(entry.pending)) {
+            resolve(index);
+        }
+        *size = entry.size;
+        return entry.data;
     }
 
     inline const char* getString(size_t index) const noexcept {
-        return (const char*) mBlobs[index].data();
+        Entry const& entry = mEntries[index];
+        if (UTILS_UNLIKELY(entry.pending)) {
+            resolve(index);
+        }
+        return entry.data;
     }
 
     inline size_t size() const noexcept {
-        return mBlobs.size();
+        return mEntries.size();
     }
 
+    // Frees the decoded blobs, they are decoded again from the package when next requested.
+    void releaseDecoded() noexcept;
+
 private:
-    std::vector<Blob> mBlobs;
+    struct Entry {
+        const char* data;
+        size_t size;
+        bool pending;               // data is encoded, or part of a compressed block
+    };
+
+    struct CompressedBlock {
+        const char* data;
+        size_t size;
+        size_t uncompressedSize;
+        bool inflated;
+    };
+
+    struct Decoded {
+        size_t index;               // index of the entry, or of the block when inflating blocks
+        const char* data;           // encoded data of the entry
+        size_t size;
+        Blob blob;
+    };
+
+    void resolve(size_t index) const noexcept;
+    void inflateBlock(size_t block) const noexcept;
+
+    // entries and decoded blobs are updated by the const getters when a blob is decoded
+    mutable std::vector<Entry> mEntries;
+    mutable std::vector<Decoded> mDecoded;
+    mutable std::vector<CompressedBlock> mBlocks;
+    std::vector<Blob> mStorage;
+    size_t mLinesPerBlock = 0;
+    Decoder mDecoder = nullptr;
 };
 
 } // namespace filaflat
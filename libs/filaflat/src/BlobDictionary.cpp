@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filaflat/BlobDictionary.h>
+
+#include <utils/Log.h>
+
+#include <zlib.h>
+
+#include <algorithm>
+
+namespace filaflat {
+
+void BlobDictionary::reserveCompressed(size_t stringCount, size_t linesPerBlock,
+        size_t blockCount) {
+    mEntries.resize(stringCount, { nullptr, 0, true });
+    mBlocks.reserve(blockCount);
+    mLinesPerBlock = linesPerBlock;
+}
+
+void BlobDictionary::addCompressedBlock(const char* data, size_t size,
+        size_t uncompressedSize) noexcept {
+    mBlocks.push_back({ data, size, uncompressedSize, false });
+}
+
+UTILS_NOINLINE
+void BlobDictionary::resolve(size_t index) const noexcept {
+    Entry& entry = mEntries[index];
+
+    if (!mBlocks.empty()) {
+        size_t const block = index / mLinesPerBlock;
+        if (block < mBlocks.size() && !mBlocks[block].inflated) {
+            inflateBlock(block);
+        }
+        if (UTILS_UNLIKELY(entry.pending)) {
+            // this line is past the last block
+            entry = { "", 1, false };
+        }
+        return;
+    }
+
+    Blob decoded;
+    if (UTILS_UNLIKELY(!mDecoder || !mDecoder(entry.data, entry.size, decoded))) {
+        utils::slog.e << "Error decoding dictionary blob " << index << utils::io::endl;
+        decoded.clear();
+    }
+    mDecoded.push_back({ index, entry.data, entry.size, std::move(decoded) });
+    Blob const& b = mDecoded.back().blob;
+    entry = { (const char*) b.data(), b.size(), false };
+}
+
+void BlobDictionary::inflateBlock(size_t block) const noexcept {
+    CompressedBlock& compressed = mBlocks[block];
+    size_t const first = block * mLinesPerBlock;
+    size_t const last = std::min(first + mLinesPerBlock, mEntries.size());
+
+    Blob text(compressed.uncompressedSize);
+    uLongf size = text.size();
+    int const result = uncompress(text.data(), &size,
+            (const Bytef*) compressed.data, compressed.size);
+    compressed.inflated = true;
+
+    if (UTILS_UNLIKELY(result != Z_OK)) {
+        utils::slog.e << "Error inflating text dictionary block " << block << utils::io::endl;
+        size = 0;
+    }
+
+    // The block is its strings concatenated, each with its trailing null. The entries point
+    // directly into the inflated block.
+    mDecoded.push_back({ block, nullptr, 0, std::move(text) });
+    const uint8_t* p = mDecoded.back().blob.data();
+    const uint8_t* const end = p + size;
+    for (size_t i = first; i < last; i++) {
+        const uint8_t* const eol = std::find(p, end, 0);
+        if (UTILS_UNLIKELY(eol == end)) {
+            // corrupted or missing data, use empty strings so that getString() stays valid
+            mEntries[i] = { "", 1, false };
+            continue;
+        }
+        mEntries[i] = { (const char*) p, size_t(eol + 1 - p), false };
+        p = eol + 1;
+    }
+}
+
+void BlobDictionary::releaseDecoded() noexcept {
+    for (Decoded const& decoded : mDecoded) {
+        if (mBlocks.empty()) {
+            mEntries[decoded.index] = { decoded.data, decoded.size, true };
+            continue;
+        }
+        size_t const first = decoded.index * mLinesPerBlock;
+        size_t const last = std::min(first + mLinesPerBlock, mEntries.size());
+        std::fill(mEntries.begin() + first, mEntries.begin() + last, Entry{ nullptr, 0, true });
+        mBlocks[decoded.index].inflated = false;
+    }
+    mDecoded.clear();
+    mDecoded.shrink_to_fit();
+}
+
+} // namespace filaflat
@@ -30,6 +30,17 @@ using namespace filamat;
 
 namespace filaflat {
 
+#if defined (FILAMENT_DRIVER_SUPPORTS_VULKAN)
+static bool decodeSmolv(const char* data, size_t size, BlobDictionary::Blob& spirv) {
+    size_t const spirvSize = smolv::GetDecodedBufferSize(data, size);
+    if (spirvSize == 0) {
+        return false;
+    }
+    spirv.resize(spirvSize);
+    return smolv::Decode(data, size, spirv.data(), spirvSize);
+}
+#endif
+
 bool DictionaryReader::unflatten(ChunkContainer const& container,
         ChunkContainer::Type dictionaryTag,
         BlobDictionary& dictionary) {
@@ -52,6 +63,14 @@ bool DictionaryReader::unflatten(ChunkContainer const& container,
             return false;
         }
 
+        // The blobs are only decoded when a shader that uses them is requested.
+#if defined (FILAMENT_DRIVER_SUPPORTS_VULKAN)
+        dictionary.setDecoder(&decodeSmolv);
+#else
+        if (blobCount) {
+            return false;
+        }
+#endif
         dictionary.reserve(blobCount);
         for (uint32_t i = 0; i < blobCount; i++) {
             const char* compressed;
@@ -59,21 +78,7 @@ bool DictionaryReader::unflatten(ChunkContainer const& container,
             if (!unflattener.read(&compressed, &compressedSize)) {
                 return false;
             }
-
-#if defined (FILAMENT_DRIVER_SUPPORTS_VULKAN)
-            size_t spirvSize = smolv::GetDecodedBufferSize(compressed, compressedSize);
-            if (spirvSize == 0) {
-                return false;
-            }
-            BlobDictionary::Blob spirv(spirvSize);
-            if (!smolv::Decode(compressed, compressedSize, spirv.data(), spirvSize)) {
-                return false;
-            }
-            dictionary.addBlob(std::move(spirv));
-#else
-            return false;
-#endif
-
+            dictionary.addEncoded(compressed, compressedSize);
         }
         return true;
     } else if (dictionaryTag == ChunkType::DictionaryText) {
@@ -89,8 +94,31 @@ bool DictionaryReader::unflatten(ChunkContainer const& container,
                 return false;
             }
             // BlobDictionary hold binary chunks and does not care if the data holds text, it is
-            // therefore crucial to include the trailing null.
-            dictionary.addBlob(str, strlen(str) + 1);
+            // therefore crucial to include the trailing null. The strings are referenced in place.
+            dictionary.addReference(str, strlen(str) + 1);
+        }
+        return true;
+    } else if (dictionaryTag == ChunkType::DictionaryTextCompressed) {
+        uint32_t stringCount = 0;
+        uint32_t linesPerBlock = 0;
+        uint32_t blockCount = 0;
+        if (!unflattener.read(&stringCount) ||
+                !unflattener.read(&linesPerBlock) ||
+                !unflattener.read(&blockCount) || linesPerBlock == 0) {
+            return false;
+        }
+
+        // The blocks are only inflated when one of their lines is used by a shader.
+        dictionary.reserveCompressed(stringCount, linesPerBlock, blockCount);
+        for (uint32_t i = 0; i < blockCount; i++) {
+            uint32_t uncompressedSize;
+            const char* compressed;
+            size_t compressedSize;
+            if (!unflattener.read(&uncompressedSize) ||
+                    !unflattener.read(&compressed, &compressedSize)) {
+                return false;
+            }
+            dictionary.addCompressedBlock(compressed, compressedSize, uncompressedSize);
         }
         return true;
     }
@@ -126,8 +126,10 @@ bool MaterialChunk::getTextShader(Unflattener unflattener, BlobDictionary const&
         if (!unflattener.read(&lineIndex)) {
             return false;
         }
-        const char* string = dictionary.getString(lineIndex);
-        shaderBuilder.append(string, strlen(string));
+        // the dictionary's strings include their trailing null
+        size_t size;
+        const char* string = dictionary.getBlob(lineIndex, &size);
+        shaderBuilder.append(string, size ? size - 1 : 0);
         shaderBuilder.append("\n", 1);
     }
 
@@ -174,5 +176,17 @@ bool MaterialChunk::getShader(ShaderBuilder& shaderBuilder,
     }
 }
 
+bool MaterialChunk::hasShader(uint8_t shaderModel, uint8_t variant, uint8_t stage) const noexcept {
+    if (mBase == nullptr) {
+        return false;
+    }
+    auto pos = mOffsets.find(makeKey(shaderModel, variant, stage));
+    if (pos == mOffsets.end()) {
+        return false;
+    }
+    // text shaders use an offset of 0 for shaders that were not found
+    return mMaterialTag == filamat::ChunkType::MaterialSpirv || pos->second != 0;
+}
+
 } // namespace filaflat
 
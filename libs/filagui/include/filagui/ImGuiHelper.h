@@ -60,9 +60,9 @@ public:
     void render(float timeStepInSeconds, Callback imguiCommands);
 
     // Low-level alternative to render() that consumes an ImGui command list and translates it into
-    // various Filament calls. This includes updating the vertex buffer, setting up material
-    // instances, and rebuilding the Renderable component that encompasses the entire UI. Since this
-    // makes Filament calls, it must be called from the main thread.
+    // various Filament calls. This includes updating the vertex buffers, setting up material
+    // instances, and patching the primitives of the Renderable component that encompasses the
+    // entire UI. Since this makes Filament calls, it must be called from the main thread.
     void processImGuiCommands(ImDrawData* commands, const ImGuiIO& io);
 
     // Helper method called after resolving fontPath; public so fonts can be added by caller.
@@ -77,6 +77,7 @@ public:
                   size_t ibSizeInBytes, void* ibData);
       void createVertexBuffer(size_t bufferIndex, size_t capacity);
       void createIndexBuffer(size_t bufferIndex, size_t capacity);
+      void createRenderable(size_t primitiveCount);
       void syncThreads();
       filament::Engine* mEngine;
       filament::View* mView; // The view is owned by the client.
@@ -86,6 +87,9 @@ public:
       std::vector<filament::VertexBuffer*> mVertexBuffers;
       std::vector<filament::IndexBuffer*> mIndexBuffers;
       std::vector<filament::MaterialInstance*> mMaterialInstances;
+      std::vector<filament::Texture const*> mPrimitiveTextures; // bound to each material instance
+      size_t mPrimitiveCapacity = 0; // number of primitives of the renderable
+      size_t mUsedPrimitives = 0; // number of primitives drawn by the last frame
       utils::Entity mRenderable;
       utils::Entity mCameraEntity;
       filament::Texture* mTexture = nullptr;
@@ -16,8 +16,8 @@
 
 #include <filagui/ImGuiHelper.h>
 
+#include <algorithm>
 #include <vector>
-#include <unordered_map>
 
 #include <imgui.h>
 
@@ -180,29 +180,20 @@ void ImGuiHelper::processImGuiCommands(ImDrawData* commands, const ImGuiIO& io)
     // Ensure that we have enough vertex buffers and index buffers.
     createBuffers(commands->CmdListsCount);
 
-    // Count how many primitives we'll need, then create a Renderable builder.
+    // Count how many primitives we'll need, the Renderable is only rebuilt when it doesn't have
+    // enough of them. Otherwise its primitives are patched in place.
     size_t nPrims = 0;
-    std::unordered_map<uint64_t, filament::MaterialInstance*> scissorRects;
     for (int cmdListIndex = 0; cmdListIndex < commands->CmdListsCount; cmdListIndex++) {
         const ImDrawList* cmds = commands->CmdLists[cmdListIndex];
         nPrims += cmds->CmdBuffer.size();
     }
-    auto rbuilder = RenderableManager::Builder(nPrims);
-    rbuilder.boundingBox({{ 0, 0, 0 }, { 10000, 10000, 10000 }}).culling(false);
-
-    // Ensure that we have a material instance for each primitive.
-    size_t previousSize = mMaterialInstances.size();
-    if (nPrims > mMaterialInstances.size()) {
-        mMaterialInstances.resize(nPrims);
-        for (size_t i = previousSize; i < mMaterialInstances.size(); i++) {
-            mMaterialInstances[i] = mMaterial->createInstance();
-        }
+    if (nPrims > mPrimitiveCapacity) {
+        createRenderable(std::max(nPrims, mPrimitiveCapacity * 2));
     }
+    auto instance = rcm.getInstance(mRenderable);
 
-    // Recreate the Renderable component and point it to the vertex buffers.
-    rcm.destroy(mRenderable);
     int bufferIndex = 0;
-    int primIndex = 0;
+    size_t primIndex = 0;
     for (int cmdListIndex = 0; cmdListIndex < commands->CmdListsCount; cmdListIndex++) {
         const ImDrawList* cmds = commands->CmdLists[cmdListIndex];
         size_t indexOffset = 0;
@@ -217,25 +208,56 @@ void ImGuiHelper::processImGuiCommands(ImDrawData* commands, const ImGuiIO& io)
                 materialInstance->setScissor( pcmd.ClipRect.x, fbheight - pcmd.ClipRect.w,
                         (uint16_t) (pcmd.ClipRect.z - pcmd.ClipRect.x),
                         (uint16_t) (pcmd.ClipRect.w - pcmd.ClipRect.y));
-                if (pcmd.TextureId) {
+                Texture const* texture = (Texture const*) pcmd.TextureId;
+                if (texture && texture != mPrimitiveTextures[primIndex]) {
                     TextureSampler sampler(MinFilter::LINEAR, MagFilter::LINEAR);
-                    materialInstance->setParameter("albedo", (Texture const*)pcmd.TextureId, sampler);
+                    materialInstance->setParameter("albedo", texture, sampler);
+                    mPrimitiveTextures[primIndex] = texture;
                 }
-                rbuilder
-                        .geometry(primIndex, RenderableManager::PrimitiveType::TRIANGLES,
-                                mVertexBuffers[bufferIndex], mIndexBuffers[bufferIndex],
-                                indexOffset, pcmd.ElemCount)
-                        .blendOrder(primIndex, primIndex)
-                        .material(primIndex, materialInstance);
+                rcm.setGeometryAt(instance, primIndex, RenderableManager::PrimitiveType::TRIANGLES,
+                        mVertexBuffers[bufferIndex], mIndexBuffers[bufferIndex],
+                        indexOffset, pcmd.ElemCount);
                 primIndex++;
             }
             indexOffset += pcmd.ElemCount;
         }
         bufferIndex++;
     }
-    if (commands->CmdListsCount > 0) {
-        rbuilder.build(*mEngine, mRenderable);
+
+    // The primitives that the previous frame used but this one doesn't are skipped.
+    for (size_t i = primIndex; i < mUsedPrimitives; i++) {
+        rcm.setGeometryAt(instance, i, RenderableManager::PrimitiveType::NONE, 0, 0);
+    }
+    mUsedPrimitives = primIndex;
+}
+
+void ImGuiHelper::createRenderable(size_t primitiveCount) {
+    auto& rcm = mEngine->getRenderableManager();
+    rcm.destroy(mRenderable);
+
+    // Ensure that we have a material instance for each primitive.
+    size_t previousSize = mMaterialInstances.size();
+    if (primitiveCount > previousSize) {
+        mMaterialInstances.resize(primitiveCount);
+        mPrimitiveTextures.resize(primitiveCount, nullptr);
+        for (size_t i = previousSize; i < mMaterialInstances.size(); i++) {
+            mMaterialInstances[i] = mMaterial->createInstance();
+        }
+    }
+
+    // All the primitives start out skipped, processImGuiCommands() sets the ones it draws.
+    auto rbuilder = RenderableManager::Builder(primitiveCount);
+    rbuilder.boundingBox({{ 0, 0, 0 }, { 10000, 10000, 10000 }}).culling(false);
+    for (size_t i = 0; i < primitiveCount; i++) {
+        rbuilder
+                .geometry(i, RenderableManager::PrimitiveType::NONE,
+                        mVertexBuffers[0], mIndexBuffers[0], 0, 0)
+                .blendOrder(i, i)
+                .material(i, mMaterialInstances[i]);
     }
+    rbuilder.build(*mEngine, mRenderable);
+    mPrimitiveCapacity = primitiveCount;
+    mUsedPrimitives = 0;
 }
 
 void ImGuiHelper::createVertexBuffer(size_t bufferIndex, size_t capacity) {
@@ -287,10 +309,11 @@ void ImGuiHelper::populateVertexData(size_t bufferIndex, size_t vbSizeInBytes, v
 {
     // Create a new vertex buffer if the size isn't large enough, then copy the ImGui data into
     // a staging area since Filament's render thread might consume the data at any time.
+    // The buffers grow geometrically, so that a growing UI recreates them only a few times.
     size_t requiredVertCount = vbSizeInBytes / sizeof(ImDrawVert);
     size_t capacityVertCount = mVertexBuffers[bufferIndex]->getVertexCount();
     if (requiredVertCount > capacityVertCount) {
-        createVertexBuffer(bufferIndex, requiredVertCount);
+        createVertexBuffer(bufferIndex, std::max(requiredVertCount, capacityVertCount * 2));
     }
     size_t nVbBytes = requiredVertCount * sizeof(ImDrawVert);
     void* vbFilamentData = malloc(nVbBytes);
@@ -306,7 +329,7 @@ void ImGuiHelper::populateVertexData(size_t bufferIndex, size_t vbSizeInBytes, v
     size_t requiredIndexCount = ibSizeInBytes / 2;
     size_t capacityIndexCount = mIndexBuffers[bufferIndex]->getIndexCount();
     if (requiredIndexCount > capacityIndexCount) {
-        createIndexBuffer(bufferIndex, requiredIndexCount);
+        createIndexBuffer(bufferIndex, std::max(requiredIndexCount, capacityIndexCount * 2));
     }
     size_t nIbBytes = requiredIndexCount * 2;
     void* ibFilamentData = malloc(nIbBytes);
@@ -104,6 +104,8 @@ protected:
     Optimization mOptimization = Optimization::PERFORMANCE;
     bool mPrintShaders = false;
     bool mGenerateDebugInfo = false;
+    bool mReportPrecision = false;
+    bool mCompressShaders = false;
     utils::bitset32 mShaderModels;
     struct CodeGenParams {
         int shaderModel;
@@ -119,6 +121,9 @@ protected:
         .targetLanguage = TargetLanguage::SPIRV
     };
     uint8_t mVariantFilter = 0;
+    uint8_t mFoldedVariants = 0;
+    // custom optimizer passes of each target API, indexed by the position of the API's bit
+    std::vector<std::string> mOptimizationPasses[3];
 
     // Keeps track of how many times MaterialBuilder::init() has been called without a call to
     // MaterialBuilder::shutdown(). Internally, glslang does something similar. We keep track for
@@ -465,6 +470,18 @@ public:
      */
     MaterialBuilder& optimization(Optimization optimization) noexcept;
 
+    /**
+     * Replaces the SPIR-V optimizer passes of the SIZE and PERFORMANCE optimization levels by
+     * the given list, for the given target APIs. This allows each backend to be tuned for the
+     * GPUs it runs on. The passes are named after spirv-opt's command line flags, without the
+     * leading dashes, e.g. { "merge-return", "inline-entry-points-exhaustive", "ccp" }, and run
+     * in the given order. An empty list restores the default passes.
+     * Building the material fails if a pass is unknown.
+     * If linking against filamat_lite, this is ignored.
+     */
+    MaterialBuilder& optimizationPasses(TargetApi targetApi,
+            std::vector<std::string> passes) noexcept;
+
     // TODO: this is present here for matc's "--print" flag, but ideally does not belong inside
     // MaterialBuilder.
     //! If true, will output the generated GLSL shader code to stdout.
@@ -473,9 +490,36 @@ public:
     //! If true, will include debugging information in generated SPIRV.
     MaterialBuilder& generateDebugInfo(bool generateDebugInfo) noexcept;
 
+    /**
+     * If true, lists the highp variables of the material() function that could be declared
+     * mediump, as found by static analysis of the mobile fragment shader. Such a variable only
+     * ever holds values computed at mediump precision or lower, and its value only flows into
+     * mediump or lower destinations, so its highp arithmetic, which runs at half the rate of
+     * mediump on most mobile GPUs, doesn't buy any precision. The shaders are not modified.
+     * If linking against filamat_lite, this is ignored.
+     */
+    MaterialBuilder& reportPrecision(bool reportPrecision) noexcept;
+
+    /**
+     * If true, the text shaders (GLSL and MSL) are stored compressed in the package. This makes
+     * the package smaller, at the cost of inflating the shaders when the material is first used.
+     * SPIR-V shaders are always compressed.
+     */
+    MaterialBuilder& compressShaders(bool compressShaders) noexcept;
+
     //! Specifies a list of variants that should be filtered out during code generation.
     MaterialBuilder& variantFilter(uint8_t variantFilter) noexcept;
 
+    /**
+     * Specifies a list of variants that are only generated with their feature enabled. The
+     * engine uses that version of the shaders when the feature is disabled too, and neutralizes
+     * it with uniforms. This halves the number of shaders to compile and to store for each
+     * folded variant, at the cost of a uniform branch in the shaders when the feature is
+     * disabled. Only Variant::FOG can be folded, other bits are ignored. Filtered out variants
+     * are not folded.
+     */
+    MaterialBuilder& foldedVariants(uint8_t foldedVariants) noexcept;
+
     //! Adds a new preprocessor macro definition to the shader code. Can be called repeatedly.
     MaterialBuilder& shaderDefine(const char* name, const char* value) noexcept;
 
@@ -588,6 +632,11 @@ public:
 
     uint8_t getVariantFilter() const { return mVariantFilter; }
 
+    uint8_t getFoldedVariants() const { return mFoldedVariants; }
+
+    // returns the custom optimizer passes of a single target API, empty if it uses the defaults
+    const std::vector<std::string>& getOptimizationPasses(TargetApi targetApi) const noexcept;
+
     /// @endcond
 
 private:
@@ -603,8 +652,13 @@ private:
             MaterialBuilder::PropertyList& p) noexcept;
     bool runSemanticAnalysis() noexcept;
 
+    // Logs the highp variables of material() that could be mediump, see reportPrecision().
+    void runPrecisionAnalysis() noexcept;
+
     bool checkLiteRequirements() noexcept;
 
+    bool checkOptimizationPasses() const noexcept;
+
     void writeCommonChunks(ChunkContainer& container, MaterialInfo& info) const noexcept;
     void writeSurfaceChunks(ChunkContainer& container) const noexcept;
 
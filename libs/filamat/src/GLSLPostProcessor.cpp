@@ -305,7 +305,8 @@ void GLSLPostProcessor::preprocessOptimization(glslang::TShader& tShader,
     }
 
     if (internalConfig.glslOutput) {
-        *internalConfig.glslOutput = glsl;
+        // Unlike the SPIR-V path, the preprocessor leaves the whole shader library in the output.
+        *internalConfig.glslOutput = internalConfig.minifier.removeUnusedFunctions(glsl);
     }
 }
 
@@ -367,6 +368,15 @@ std::shared_ptr<spvtools::Optimizer> GLSLPostProcessor::createOptimizer(
                 << utils::io::endl;
     });
 
+    if (optimization == MaterialBuilder::Optimization::SIZE ||
+            optimization == MaterialBuilder::Optimization::PERFORMANCE) {
+        if (config.optimizationPasses && !config.optimizationPasses->empty()) {
+            // the passes have been validated when the material build started
+            registerCustomPasses(*optimizer, *config.optimizationPasses, &config);
+            return optimizer;
+        }
+    }
+
     if (optimization == MaterialBuilder::Optimization::SIZE) {
         registerSizePasses(*optimizer, config);
     } else if (optimization == MaterialBuilder::Optimization::PERFORMANCE) {
@@ -431,6 +441,32 @@ void GLSLPostProcessor::registerPerformancePasses(Optimizer& optimizer, Config c
             .RegisterPass(CreateSimplificationPass());
 }
 
+bool GLSLPostProcessor::checkOptimizationPasses(std::vector<std::string> const& passes) noexcept {
+    // unknown passes are reported through the message consumer
+    Optimizer optimizer(SPV_ENV_UNIVERSAL_1_0);
+    optimizer.SetMessageConsumer([](spv_message_level_t level,
+            const char* source, const spv_position_t& position, const char* message) {
+        utils::slog.e << stringifySpvOptimizerMessage(level, source, position, message)
+                << utils::io::endl;
+    });
+    return registerCustomPasses(optimizer, passes, nullptr);
+}
+
+bool GLSLPostProcessor::registerCustomPasses(Optimizer& optimizer,
+        std::vector<std::string> const& passes, Config const* config) {
+    std::vector<std::string> flags;
+    flags.reserve(passes.size());
+    for (std::string const& pass : passes) {
+        if (config && config->shaderModel == filament::backend::ShaderModel::GL_CORE_41 &&
+                pass == "merge-return") {
+            // this triggers a segfault with AMD drivers on MacOS
+            continue;
+        }
+        flags.push_back("--" + pass);
+    }
+    return optimizer.RegisterPassesFromFlags(flags);
+}
+
 void GLSLPostProcessor::registerSizePasses(Optimizer& optimizer, Config const& config) {
     optimizer
             .RegisterPass(CreateWrapOpKillPass())
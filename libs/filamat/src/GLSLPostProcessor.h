@@ -54,8 +54,13 @@ public:
         struct {
             std::vector<std::pair<uint32_t, uint32_t>> subpassInputToColorLocation;
         } glsl;
+        // when not empty, replaces the passes of the SIZE and PERFORMANCE optimization levels
+        std::vector<std::string> const* optimizationPasses = nullptr;
     };
 
+    // returns true if all the passes are known to the SPIR-V optimizer
+    static bool checkOptimizationPasses(std::vector<std::string> const& passes) noexcept;
+
     bool process(const std::string& inputShader, Config const& config,
             std::string* outputGlsl,
             SpirvBlob* outputSpirv,
@@ -86,6 +91,8 @@ private:
 
     static void registerSizePasses(spvtools::Optimizer& optimizer, Config const& config);
     static void registerPerformancePasses(spvtools::Optimizer& optimizer, Config const& config);
+    static bool registerCustomPasses(spvtools::Optimizer& optimizer,
+            std::vector<std::string> const& passes, Config const* config);
 
     void optimizeSpirv(OptimizerPtr optimizer, SpirvBlob& spirv) const;
     void spirvToToMsl(const SpirvBlob *spirv, std::string *outMsl, const Config &config,
@@ -19,6 +19,7 @@
 #include <atomic>
 #include <vector>
 
+#include <utils/algorithm.h>
 #include <utils/JobSystem.h>
 #include <utils/Log.h>
 #include <utils/Mutex.h>
@@ -65,6 +66,11 @@ inline void assertSingleTargetApi(MaterialBuilderBase::TargetApi api) {
     assert(bits && !(bits & bits - 1u));
 }
 
+inline size_t targetApiIndex(MaterialBuilderBase::TargetApi api) {
+    assertSingleTargetApi(api);
+    return size_t(utils::ctz(unsigned(api)));
+}
+
 void MaterialBuilderBase::prepare(bool vulkanSemantics) {
     mCodeGenPermutations.clear();
     mShaderModels.reset();
@@ -371,6 +377,21 @@ MaterialBuilder& MaterialBuilder::optimization(Optimization optimization) noexce
     return *this;
 }
 
+MaterialBuilder& MaterialBuilder::optimizationPasses(TargetApi targetApi,
+        std::vector<std::string> passes) noexcept {
+    for (TargetApi api : { TargetApi::OPENGL, TargetApi::VULKAN, TargetApi::METAL }) {
+        if (any(targetApi & api)) {
+            mOptimizationPasses[targetApiIndex(api)] = passes;
+        }
+    }
+    return *this;
+}
+
+const std::vector<std::string>& MaterialBuilder::getOptimizationPasses(
+        TargetApi targetApi) const noexcept {
+    return mOptimizationPasses[targetApiIndex(targetApi)];
+}
+
 MaterialBuilder& MaterialBuilder::printShaders(bool printShaders) noexcept {
     mPrintShaders = printShaders;
     return *this;
@@ -381,11 +402,26 @@ MaterialBuilder& MaterialBuilder::generateDebugInfo(bool generateDebugInfo) noex
     return *this;
 }
 
+MaterialBuilder& MaterialBuilder::reportPrecision(bool reportPrecision) noexcept {
+    mReportPrecision = reportPrecision;
+    return *this;
+}
+
+MaterialBuilder& MaterialBuilder::compressShaders(bool compressShaders) noexcept {
+    mCompressShaders = compressShaders;
+    return *this;
+}
+
 MaterialBuilder& MaterialBuilder::variantFilter(uint8_t variantFilter) noexcept {
     mVariantFilter = variantFilter;
     return *this;
 }
 
+MaterialBuilder& MaterialBuilder::foldedVariants(uint8_t foldedVariants) noexcept {
+    mFoldedVariants = foldedVariants & filament::Variant::FOLDABLE_MASK;
+    return *this;
+}
+
 MaterialBuilder& MaterialBuilder::shaderDefine(const char* name, const char* value) noexcept {
     mDefines.emplace_back(name, value);
     return *this;
@@ -534,6 +570,32 @@ bool MaterialBuilder::runSemanticAnalysis() noexcept {
 #endif
 }
 
+void MaterialBuilder::runPrecisionAnalysis() noexcept {
+#ifndef FILAMAT_LITE
+    using namespace filament::backend;
+    if (mMaterialDomain != MaterialDomain::SURFACE) {
+        return;
+    }
+
+    // precision qualifiers only matter in the mobile shaders
+    const CodeGenParams params{
+            int(ShaderModel::GL_ES_30), TargetApi::OPENGL, TargetLanguage::GLSL };
+    std::string shaderCode = peek(ShaderType::FRAGMENT, params, mProperties);
+
+    GLSLTools glslTools;
+    std::vector<GLSLTools::PrecisionCandidate> candidates;
+    if (!glslTools.findPrecisionCandidates(shaderCode, candidates)) {
+        return;
+    }
+
+    const char* name = mFileName.empty() ? mMaterialName.c_str() : mFileName.c_str();
+    for (auto const& candidate : candidates) {
+        utils::slog.i << name << ":" << candidate.line << ": '" << candidate.name
+                << "' could be declared mediump" << utils::io::endl;
+    }
+#endif
+}
+
 bool MaterialBuilder::checkLiteRequirements() noexcept {
 #ifdef FILAMAT_LITE
     if (mTargetApi != TargetApi::OPENGL) {
@@ -553,6 +615,19 @@ bool MaterialBuilder::checkLiteRequirements() noexcept {
     return true;
 }
 
+bool MaterialBuilder::checkOptimizationPasses() const noexcept {
+#ifndef FILAMAT_LITE
+    for (auto const& passes : mOptimizationPasses) {
+        if (!GLSLPostProcessor::checkOptimizationPasses(passes)) {
+            utils::slog.e << "Invalid optimization passes for material "
+                    << mMaterialName.c_str_safe() << utils::io::endl;
+            return false;
+        }
+    }
+#endif
+    return true;
+}
+
 bool MaterialBuilder::ShaderCode::resolveIncludes(IncludeCallback callback,
         const utils::CString& fileName) noexcept {
     if (!mCode.empty()) {
@@ -702,7 +777,8 @@ bool MaterialBuilder::generateShaders(JobSystem& jobSystem, const std::vector<Va
                 GLSLPostProcessor::Config config{
                         .shaderType = v.stage,
                         .shaderModel = shaderModel,
-                        .glsl = {}
+                        .glsl = {},
+                        .optimizationPasses = &mOptimizationPasses[targetApiIndex(targetApi)]
                 };
 
                 config.hasFramebufferFetch = mEnableFramebufferFetch;
@@ -802,7 +878,8 @@ bool MaterialBuilder::generateShaders(JobSystem& jobSystem, const std::vector<Va
 
     // Emit dictionary chunk (TextDictionaryReader and DictionaryTextChunk)
     const auto& dictionaryChunk = container.addChild<filamat::DictionaryTextChunk>(
-            std::move(textDictionary), ChunkType::DictionaryText);
+            std::move(textDictionary),
+            mCompressShaders ? ChunkType::DictionaryTextCompressed : ChunkType::DictionaryText);
 
     // Emit GLSL chunk (MaterialTextChunk).
     if (!glslEntries.empty()) {
@@ -902,12 +979,17 @@ Package MaterialBuilder::build(JobSystem& jobSystem) noexcept {
     // Run checks, in order.
     // The call to findProperties populates mProperties and must come before runSemanticAnalysis.
     if (!checkLiteRequirements() ||
+        !checkOptimizationPasses() ||
         !findAllProperties() ||
         !runSemanticAnalysis()) {
         // Return an empty package to signal a failure to build the material.
         return Package::invalidPackage();
     }
 
+    if (mReportPrecision) {
+        runPrecisionAnalysis();
+    }
+
     filament::SamplerBindingMap map;
     map.populate(&info.sib, mMaterialName.c_str());
     info.samplerBindings = std::move(map);
@@ -921,7 +1003,7 @@ Package MaterialBuilder::build(JobSystem& jobSystem) noexcept {
 
     // Generate all shaders and write the shader chunks.
     const auto variants = mMaterialDomain == MaterialDomain::SURFACE ?
-        determineSurfaceVariants(mVariantFilter, isLit(), mShadowMultiplier) :
+        determineSurfaceVariants(mVariantFilter, mFoldedVariants, isLit(), mShadowMultiplier) :
         determinePostProcessVariants();
     bool success = generateShaders(jobSystem, variants, container, info);
 
@@ -1017,6 +1099,11 @@ void MaterialBuilder::writeSurfaceChunks(ChunkContainer& container) const noexce
     container.addSimpleChild<float>(ChunkType::MaterialSpecularAntiAliasingThreshold, mSpecularAntiAliasingThreshold);
     container.addSimpleChild<uint8_t>(ChunkType::MaterialVertexDomain, static_cast<uint8_t>(mVertexDomain));
     container.addSimpleChild<uint8_t>(ChunkType::MaterialInterpolation, static_cast<uint8_t>(mInterpolation));
+
+    const uint8_t foldedVariants = mFoldedVariants & ~mVariantFilter;
+    if (foldedVariants) {
+        container.addSimpleChild<uint8_t>(ChunkType::MaterialFoldedVariants, foldedVariants);
+    }
 }
 
 } // namespace filamat
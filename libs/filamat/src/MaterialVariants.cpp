@@ -20,18 +20,26 @@
 
 namespace filamat {
 
-std::vector<Variant> determineSurfaceVariants(uint8_t variantFilter, bool isLit,
-        bool shadowMultiplier) {
+std::vector<Variant> determineSurfaceVariants(uint8_t variantFilter, uint8_t foldedVariants,
+        bool isLit, bool shadowMultiplier) {
     std::vector<Variant> variants;
     uint8_t variantMask = ~variantFilter;
+    foldedVariants &= variantMask;
     for (uint8_t k = 0; k < filament::VARIANT_COUNT; k++) {
         if (filament::Variant::isReserved(k)) {
             continue;
         }
 
-        // Remove variants for unlit materials
-        uint8_t v = filament::Variant::filterVariant(
-                k & variantMask, isLit || shadowMultiplier);
+        // Remove variants for unlit materials. The picking bit of the depth variants is the fog
+        // bit, it's not affected by the fog filter.
+        const uint8_t mask = filament::Variant::isValidDepthVariant(k) ?
+                uint8_t(variantMask | filament::Variant::PICKING) : variantMask;
+        uint8_t v = filament::Variant::filterVariant(k & mask, isLit || shadowMultiplier);
+
+        // Folded variants all use the version with the bit set, depth variants have none
+        if (!filament::Variant::isValidDepthVariant(v)) {
+            v |= foldedVariants;
+        }
 
         if (filament::Variant::filterVariantVertex(v) == k) {
             variants.emplace_back(k, filament::backend::ShaderType::VERTEX);
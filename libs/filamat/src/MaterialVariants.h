@@ -34,8 +34,10 @@ struct Variant {
     Stage stage;
 };
 
-std::vector<Variant> determineSurfaceVariants(uint8_t variantFilter, bool isLit,
-        bool shadowMultiplier);
+// Variants in foldedVariants are only generated with their bit set, see
+// MaterialBuilder::foldedVariants().
+std::vector<Variant> determineSurfaceVariants(uint8_t variantFilter, uint8_t foldedVariants,
+        bool isLit, bool shadowMultiplier);
 
 std::vector<Variant> determinePostProcessVariants();
 
@@ -19,6 +19,9 @@
 
 #include <utils/Log.h>
 
+#include <string_view>
+#include <unordered_set>
+
 namespace filamat {
 
 static bool isIdCharNondigit(char c) {
@@ -329,4 +332,206 @@ std::string ShaderMinifier::applyFieldMapping() const {
     return result;
 }
 
+namespace {
+    struct FunctionRange {
+        std::string_view name;
+        size_t begin;       // first character of the declaration, after the previous one
+        size_t end;         // one past the closing brace or the semicolon of a prototype
+        size_t body;        // first character of the body, equal to end for a prototype
+    };
+}
+
+// Returns the index of the first character after the comment or preprocessor line at the given
+// index, or the given index if there is none. Preprocessor lines only count at the start of a line.
+static size_t skipCommentOrDirective(std::string_view source, size_t index) {
+    if (source.compare(index, 2, "//") == 0) {
+        const size_t eol = source.find('\n', index);
+        return eol == std::string_view::npos ? source.size() : eol + 1;
+    }
+    if (source.compare(index, 2, "/*") == 0) {
+        const size_t end = source.find("*/", index + 2);
+        return end == std::string_view::npos ? source.size() : end + 2;
+    }
+    if (source[index] == '#') {
+        const size_t bol = source.find_last_not_of(" \t", index == 0 ? 0 : index - 1);
+        if (index == 0 || bol == std::string_view::npos || source[bol] == '\n') {
+            const size_t eol = source.find('\n', index);
+            return eol == std::string_view::npos ? source.size() : eol + 1;
+        }
+    }
+    return index;
+}
+
+// Returns the index of the character that balances the opening one at the given index, or the
+// size of the source if it is unbalanced.
+static size_t findClosing(std::string_view source, size_t index, char open, char close) {
+    int depth = 0;
+    while (index < source.size()) {
+        const size_t next = skipCommentOrDirective(source, index);
+        if (next != index) {
+            index = next;
+            continue;
+        }
+        if (source[index] == open) {
+            depth++;
+        } else if (source[index] == close && --depth == 0) {
+            return index;
+        }
+        index++;
+    }
+    return source.size();
+}
+
+// Adds to the given set every identifier of the given range that is not a number suffix.
+static void collectIds(std::string_view source, size_t begin, size_t end,
+        std::unordered_set<std::string_view>& ids) {
+    size_t index = begin;
+    while (index < end) {
+        std::string_view id;
+        if (getId(source.substr(0, end), &index, &id)) {
+            ids.insert(id);
+            continue;
+        }
+        // skip whole tokens so that e.g. the exponent of 1e5 is not taken for an identifier
+        while (index < end && isIdChar(source[index])) {
+            index++;
+        }
+        if (index < end && !isIdChar(source[index])) {
+            index++;
+        }
+    }
+}
+
+/**
+ * Removes the definitions and prototypes of the functions that cannot be reached from main(), as
+ * well as the comments between them. The shader is assumed to be valid GLSL, e.g. the output of
+ * the preprocessor, which still holds every function of the shader library and the material.
+ *
+ * Overloads are kept or removed together since they are only told apart by their names. Functions
+ * used by the global declarations are kept too, which is conservative but cheap.
+ */
+std::string ShaderMinifier::removeUnusedFunctions(const std::string& s) const {
+    const std::string_view source = s;
+
+    // Split the top-level declarations, looking for "name ( ... ) {" and "name ( ... ) ;".
+    std::vector<FunctionRange> functions;
+    size_t begin = 0;
+    size_t index = 0;
+    std::string_view lastId;
+    bool initializer = false;   // calls in the initializer of a global are not declarations
+    while (index < source.size()) {
+        const size_t next = skipCommentOrDirective(source, index);
+        if (next != index) {
+            if (source[index] == '#') {
+                begin = next;
+            }
+            index = next;
+            continue;
+        }
+        const char c = source[index];
+        std::string_view id;
+        if (getId(source, &index, &id)) {
+            lastId = id;
+            continue;
+        }
+        if (c == '(' && !lastId.empty() && !initializer) {
+            const size_t close = findClosing(source, index, '(', ')');
+            size_t after = source.find_first_not_of(" \t\r\n", close + 1);
+            if (after == std::string_view::npos) {
+                break;
+            }
+            if (source[after] == '{') {
+                const size_t end = findClosing(source, after, '{', '}') + 1;
+                functions.push_back({ lastId, begin, std::min(end, source.size()), after });
+                index = begin = std::min(end, source.size());
+                lastId = {};
+                continue;
+            }
+            if (source[after] == ';') {
+                functions.push_back({ lastId, begin, after + 1, after + 1 });
+                index = begin = after + 1;
+                lastId = {};
+                continue;
+            }
+            index = close + 1;
+            continue;
+        }
+        if (c == '{') {
+            // structs and interface blocks
+            index = findClosing(source, index, '{', '}') + 1;
+            lastId = {};
+            continue;
+        }
+        if (c == '=') {
+            initializer = true;
+        } else if (c == ';') {
+            initializer = false;
+            begin = index + 1;
+        }
+        if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+            lastId = {};
+        }
+        index++;
+    }
+
+    std::unordered_set<std::string_view> names;
+    for (const auto& function : functions) {
+        names.insert(function.name);
+    }
+    if (names.find("main") == names.end()) {
+        return s;
+    }
+
+    // The roots are main() and whatever the global declarations refer to.
+    std::unordered_set<std::string_view> used;
+    std::unordered_set<std::string_view> ids;
+    size_t cursor = 0;
+    for (const auto& function : functions) {
+        collectIds(source, cursor, function.begin, ids);
+        cursor = function.end;
+    }
+    collectIds(source, cursor, source.size(), ids);
+    ids.insert("main");
+
+    std::vector<std::string_view> pending;
+    for (std::string_view id : ids) {
+        if (names.find(id) != names.end()) {
+            used.insert(id);
+            pending.push_back(id);
+        }
+    }
+    while (!pending.empty()) {
+        const std::string_view name = pending.back();
+        pending.pop_back();
+        ids.clear();
+        for (const auto& function : functions) {
+            if (function.name == name) {
+                collectIds(source, function.body, function.end, ids);
+            }
+        }
+        for (std::string_view id : ids) {
+            if (names.find(id) != names.end() && used.insert(id).second) {
+                pending.push_back(id);
+            }
+        }
+    }
+
+    if (used.size() == names.size()) {
+        return s;
+    }
+
+    std::string result;
+    result.reserve(s.size());
+    cursor = 0;
+    for (const auto& function : functions) {
+        if (used.find(function.name) == used.end()) {
+            result.append(source.substr(cursor, function.begin - cursor));
+            result += '\n';
+            cursor = function.end;
+        }
+    }
+    result.append(source.substr(cursor));
+    return result;
+}
+
 } // namespace filamat
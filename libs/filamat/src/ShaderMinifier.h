@@ -32,6 +32,7 @@ class ShaderMinifier {
     public:
         std::string removeWhitespace(const std::string& source) const;
         std::string renameStructFields(const std::string& source);
+        std::string removeUnusedFunctions(const std::string& source) const;
 
     private:
         using RenameEntry = std::pair<std::string, std::string>;
@@ -16,13 +16,64 @@
 
 #include "DictionaryTextChunk.h"
 
+#include <utils/Log.h>
+
+#include <zlib.h>
+
+#include <algorithm>
+
 namespace filamat {
 
 DictionaryTextChunk::DictionaryTextChunk(LineDictionary&& dictionary, ChunkType chunkType) :
         Chunk(chunkType), mDictionary(dictionary) {
 }
 
+void DictionaryTextChunk::compress() {
+    const size_t lineCount = mDictionary.getLineCount();
+    std::vector<uint8_t> text;
+    for (size_t first = 0; first < lineCount; first += LINES_PER_BLOCK) {
+        // a block is its lines concatenated, each with its trailing null
+        text.clear();
+        const size_t last = std::min(first + LINES_PER_BLOCK, lineCount);
+        for (size_t i = first; i < last; i++) {
+            const std::string& line = mDictionary.getString(i);
+            text.insert(text.end(), line.c_str(), line.c_str() + line.size() + 1);
+        }
+
+        Block block{ uint32_t(text.size()) };
+        uLongf compressedSize = compressBound(text.size());
+        block.data.resize(compressedSize);
+        int const result = compress2(block.data.data(), &compressedSize,
+                text.data(), text.size(), Z_BEST_COMPRESSION);
+        if (result != Z_OK) {
+            utils::slog.e << "Error with text dictionary compression" << utils::io::endl;
+            compressedSize = 0;
+        }
+        block.data.resize(compressedSize);
+        mBlocks.push_back(std::move(block));
+    }
+    mCompressed = true;
+}
+
 void DictionaryTextChunk::flatten(Flattener& f) {
+    if (getType() == ChunkType::DictionaryTextCompressed) {
+        if (!mCompressed) {
+            compress();
+        }
+
+        // NumStrings, LinesPerBlock, NumBlocks
+        f.writeUint32(mDictionary.getLineCount());
+        f.writeUint32(LINES_PER_BLOCK);
+        f.writeUint32(mBlocks.size());
+
+        // Blocks
+        for (const Block& block : mBlocks) {
+            f.writeUint32(block.uncompressedSize);
+            f.writeBlob((const char*) block.data.data(), block.data.size());
+        }
+        return;
+    }
+
     // NumStrings
     f.writeUint32(mDictionary.getLineCount());
 
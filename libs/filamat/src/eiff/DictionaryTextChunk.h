@@ -28,15 +28,30 @@ namespace filamat {
 
 class DictionaryTextChunk final : public Chunk {
 public:
+    // When chunkType is ChunkType::DictionaryTextCompressed, lines are grouped in blocks of
+    // LINES_PER_BLOCK which are compressed independently with zlib, so that a reader only needs
+    // to inflate the blocks referenced by the shaders it actually uses.
     DictionaryTextChunk(LineDictionary&& dictionary, ChunkType chunkType);
     ~DictionaryTextChunk() = default;
 
     const LineDictionary& getDictionary() const noexcept { return mDictionary; }
 
+    static constexpr uint32_t LINES_PER_BLOCK = 1024;
+
 private:
     void flatten(Flattener& f) override;
+    void compress();
+
+    struct Block {
+        uint32_t uncompressedSize;
+        std::vector<uint8_t> data;
+    };
 
     const LineDictionary mDictionary;
+
+    // flatten() is called once for sizing and once for writing, compress only once.
+    std::vector<Block> mBlocks;
+    bool mCompressed = false;
 };
 
 } // namespace filamat
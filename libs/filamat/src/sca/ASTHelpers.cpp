@@ -23,6 +23,11 @@
 
 #include <utils/Log.h>
 
+#include <algorithm>
+#include <map>
+
+#include <math.h>
+
 using namespace glslang;
 
 namespace ASTUtils {
@@ -223,6 +228,157 @@ private:
     std::deque<Symbol>& mEvents;
 };
 
+// Traverse a function definition to find its highp floating point local variables that could be
+// mediump: all their writes store values computed at mediump precision or lower, and all their
+// reads flow into mediump or lower destinations.
+class PrecisionTracer : public TIntermTraverser {
+public:
+    explicit PrecisionTracer(std::vector<GLSLTools::PrecisionCandidate>& candidates)
+            : mCandidates(candidates) {
+    }
+
+    void visitSymbol(TIntermSymbol* node) override {
+        const TType& type = node->getType();
+        if (type.getQualifier().storage != EvqTemporary ||
+                type.getQualifier().precision != EpqHigh ||
+                !type.isFloatingDomain() || type.isArray() || type.isStruct()) {
+            return;
+        }
+        auto pos = mVariables.find(node->getId());
+        if (pos == mVariables.end()) {
+            Variable variable{ node->getName().c_str(), node->getLoc().line, true };
+            pos = mVariables.emplace(node->getId(), variable).first;
+        }
+        if (pos->second.candidate) {
+            pos->second.candidate = isUseSafe(node);
+        }
+    }
+
+    void collect() const {
+        for (auto const& entry : mVariables) {
+            Variable const& variable = entry.second;
+            if (variable.candidate) {
+                mCandidates.push_back({ variable.name, variable.line });
+            }
+        }
+        std::stable_sort(mCandidates.begin(), mCandidates.end(),
+                [](auto const& lhs, auto const& rhs) { return lhs.line < rhs.line; });
+    }
+
+private:
+    struct Variable {
+        std::string name;
+        int line;
+        bool candidate;
+    };
+
+    // Largest magnitude representable by a mediump float.
+    static constexpr double MEDIUMP_MAX = 65504.0;
+
+    static bool isHigh(const TIntermTyped* node) noexcept {
+        return node->getQualifier().precision == EpqHigh;
+    }
+
+    // Whether a value stored into a variable was computed at mediump precision or lower.
+    static bool holdsMediumValue(const TIntermTyped* node) noexcept {
+        if (const TIntermConstantUnion* constant = node->getAsConstantUnion()) {
+            const TConstUnionArray& values = constant->getConstArray();
+            for (int i = 0; i < values.size(); i++) {
+                const TBasicType type = values[i].getType();
+                if ((type == EbtFloat || type == EbtDouble) &&
+                        fabs(values[i].getDConst()) > MEDIUMP_MAX) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        return !isHigh(node);
+    }
+
+    // Follows a use of a variable up the AST, through the operations that compute a value from
+    // it, to where that value is stored. Returns false if lowering the precision of the variable
+    // could lower the precision of a highp destination.
+    bool isUseSafe(TIntermSymbol* symbol) const noexcept {
+        const TIntermTyped* child = symbol;
+        bool accessChain = true; // child is the variable itself, swizzled or indexed
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            TIntermNode* parent = *it;
+
+            if (TIntermBinary* binary = parent->getAsBinaryNode()) {
+                const TOperator op = binary->getOp();
+                if (accessChain && binary->getLeft() == child && (op == EOpIndexDirect ||
+                        op == EOpIndexIndirect || op == EOpVectorSwizzle ||
+                        op == EOpMatrixSwizzle)) {
+                    child = binary;
+                    continue;
+                }
+                if (binary->modifiesState()) {
+                    if (binary->getLeft() == child) {
+                        // A write of the variable, compound assignments read it too. Otherwise
+                        // the variable only indexes the destination.
+                        return !accessChain ||
+                                (op == EOpAssign && holdsMediumValue(binary->getRight()));
+                    }
+                    return !isHigh(binary->getLeft());
+                }
+                if (binary->getBasicType() == EbtBool) {
+                    return true;
+                }
+                accessChain = false;
+                child = binary;
+                continue;
+            }
+
+            if (TIntermUnary* unary = parent->getAsUnaryNode()) {
+                if (unary->modifiesState()) {
+                    return false;
+                }
+                if (unary->getBasicType() == EbtBool) {
+                    return true;
+                }
+                accessChain = false;
+                child = unary;
+                continue;
+            }
+
+            if (TIntermAggregate* aggregate = parent->getAsAggregate()) {
+                const TOperator op = aggregate->getOp();
+                // The parameters of functions are not followed, and these built-ins write their
+                // second argument.
+                if (op == EOpFunctionCall || op == EOpModf || op == EOpFrexp) {
+                    return false;
+                }
+                // statements discard the value, and booleans don't carry its precision
+                if (aggregate->getBasicType() == EbtVoid ||
+                        aggregate->getBasicType() == EbtBool) {
+                    return true;
+                }
+                accessChain = false;
+                child = aggregate;
+                continue;
+            }
+
+            if (TIntermSelection* selection = parent->getAsSelectionNode()) {
+                if (selection->getCondition() == child ||
+                        selection->getBasicType() == EbtVoid) {
+                    return true;
+                }
+                // the ?: operator
+                accessChain = false;
+                child = selection;
+                continue;
+            }
+
+            // the value is returned, or it controls a loop or a switch
+            return parent->getAsBranchNode() == nullptr;
+        }
+        return true;
+    }
+
+    std::vector<GLSLTools::PrecisionCandidate>& mCandidates;
+    std::map<long long, Variable> mVariables;
+};
+
 std::string getFunctionName(const std::string& functionSignature) noexcept {
   auto indexParenthesis = functionSignature.find("(");
   return functionSignature.substr(0, indexParenthesis);
@@ -325,6 +481,13 @@ void traceSymbols(TIntermNode& functionNode, std::deque<Symbol>& events) {
     functionNode.traverse(&variableTracer);
 }
 
+void findPrecisionCandidates(TIntermNode& functionNode,
+        std::vector<GLSLTools::PrecisionCandidate>& output) {
+    PrecisionTracer precisionTracer(output);
+    functionNode.traverse(&precisionTracer);
+    precisionTracer.collect();
+}
+
 static FunctionParameter::Qualifier glslangQualifier2FunctionParameter(TStorageQualifier q) {
     switch (q) {
         case EvqIn: return FunctionParameter::Qualifier::IN;
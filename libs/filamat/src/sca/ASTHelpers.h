@@ -71,5 +71,11 @@ struct FunctionParameter {
 void getFunctionParameters(glslang::TIntermAggregate* func, std::vector<FunctionParameter>& output)
         noexcept;
 
+// Traverse the function definition node provided, looking for its highp floating point local
+// variables that could be mediump, see GLSLTools::findPrecisionCandidates(). Does NOT recurse to
+// follow function calls, a variable passed to another function is never a candidate.
+void findPrecisionCandidates(TIntermNode& functionNode,
+        std::vector<GLSLTools::PrecisionCandidate>& output);
+
 } // namespace ASTutils
 #endif //TNT_SCAHELPERS_H_H
@@ -198,6 +198,32 @@ bool GLSLTools::findProperties(
     return findPropertyWritesOperations(materialFullyQualifiedName, 0, rootNode, properties);
 }
 
+bool GLSLTools::findPrecisionCandidates(const std::string& shaderCode,
+        std::vector<PrecisionCandidate>& candidates,
+        MaterialBuilder::TargetApi targetApi, ShaderModel model) const noexcept {
+    const char* shaderCString = shaderCode.c_str();
+
+    TShader tShader(EShLanguage::EShLangFragment);
+    tShader.setStrings(&shaderCString, 1);
+
+    GLSLangCleaner cleaner;
+    int version = glslangVersionFromShaderModel(model);
+    EShMessages msg = glslangFlagsFromTargetApi(targetApi);
+    bool ok = tShader.parse(&DefaultTBuiltInResource, version, false, msg);
+    if (!ok) {
+        utils::slog.e << tShader.getInfoLog() << utils::io::endl;
+        return false;
+    }
+
+    TIntermNode* rootNode = tShader.getIntermediate()->getTreeRoot();
+    TIntermAggregate* functionMaterialDef = ASTUtils::getFunctionByNameOnly("material", *rootNode);
+    if (functionMaterialDef == nullptr) {
+        return false;
+    }
+    ASTUtils::findPrecisionCandidates(*functionMaterialDef, candidates);
+    return true;
+}
+
 bool GLSLTools::findPropertyWritesOperations(const std::string& functionName, size_t parameterIdx,
         TIntermNode* rootNode, MaterialBuilder::PropertyList& properties) const noexcept {
 
@@ -21,6 +21,7 @@
 #include <list>
 #include <set>
 #include <string>
+#include <vector>
 
 #include <filamat/MaterialBuilder.h>
 
@@ -143,6 +144,21 @@ public:
             MaterialBuilder::TargetApi targetApi = MaterialBuilder::TargetApi::OPENGL,
             ShaderModel model = ShaderModel::GL_CORE_41) const noexcept;
 
+    // A highp variable of the material() function that could be declared mediump.
+    struct PrecisionCandidate {
+        std::string name;
+        int line;   // of its first occurrence, in the material's source
+    };
+
+    // Use static code analysis on the fragment shader AST to find the highp floating point
+    // variables local to material() that only ever hold values computed at mediump precision or
+    // lower (or constants in the mediump range), and whose values only flow into mediump or lower
+    // destinations. Candidates are sorted by line.
+    bool findPrecisionCandidates(const std::string& shaderCode,
+            std::vector<PrecisionCandidate>& candidates,
+            MaterialBuilder::TargetApi targetApi = MaterialBuilder::TargetApi::OPENGL,
+            ShaderModel model = ShaderModel::GL_ES_30) const noexcept;
+
     static int glslangVersionFromShaderModel(filament::backend::ShaderModel model);
 
     static EShMessages glslangFlagsFromTargetApi(MaterialBuilder::TargetApi targetApi);
@@ -250,6 +250,21 @@ io::sstream& CodeGenerator::generateDepthShaderMain(io::sstream& out, ShaderType
     return out;
 }
 
+io::sstream& CodeGenerator::generatePickingShaderMain(io::sstream& out) const {
+    // the depth shader's main() becomes a function called by the picking main()
+    out << "#define main depthMain\n";
+    out << SHADERS_DEPTH_MAIN_FS_DATA;
+    out << "#undef main\n";
+    out << "\n";
+    out << "layout(location = 0) out highp uvec2 outPicking;\n";
+    out << "\n";
+    out << "void main() {\n";
+    out << "    depthMain();\n";
+    out << "    outPicking = uvec2(objectUniforms.objectId, floatBitsToUint(gl_FragCoord.z));\n";
+    out << "}\n";
+    return out;
+}
+
 const char* CodeGenerator::getUniformPrecisionQualifier(UniformType type, Precision precision,
         Precision uniformPrecision, Precision defaultPrecision) const noexcept {
     if (!hasPrecision(type)) {
@@ -98,6 +98,10 @@ public:
     // generate no-op shader for depth prepass
     utils::io::sstream& generateDepthShaderMain(utils::io::sstream& out, ShaderType type) const;
 
+    // generate the fragment shader of the picking variant: the depth shader, which also writes the
+    // renderable's object id and the fragment's depth
+    utils::io::sstream& generatePickingShaderMain(utils::io::sstream& out) const;
+
     // generate uniforms
     utils::io::sstream& generateUniforms(utils::io::sstream& out, ShaderType type, uint8_t binding,
             const filament::UniformInterfaceBlock& uib) const;
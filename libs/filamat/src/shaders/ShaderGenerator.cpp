@@ -440,7 +440,11 @@ std::string ShaderGenerator::createFragmentProgram(filament::backend::ShaderMode
         }
         // these variants are special and are treated as DEPTH variants. Filament will never
         // request that variant for the color pass.
-        cg.generateDepthShaderMain(fs, ShaderType::FRAGMENT);
+        if (variant.hasPicking()) {
+            cg.generatePickingShaderMain(fs);
+        } else {
+            cg.generateDepthShaderMain(fs, ShaderType::FRAGMENT);
+        }
     } else {
         appendShader(fs, mMaterialCode, mMaterialLineOffset);
         if (material.isLit) {
@@ -18,6 +18,7 @@
 
 #include "sca/ASTHelpers.h"
 #include "shaders/ShaderGenerator.h"
+#include "ShaderMinifier.h"
 
 #include "MockIncluder.h"
 
@@ -82,6 +83,33 @@ TEST(StaticCodeAnalysisHelper, getFunctionNameNoParenthesis) {
     EXPECT_EQ(name, "main");
 }
 
+TEST(ShaderMinifier, removeUnusedFunctions) {
+    std::string shaderCode(R"(
+        layout(location = 0) out vec4 fragColor;
+        float unused(float x);
+        float helper(float x) { return x * 2.0; }
+        float helper(vec2 x) { return x.x; }
+        // only called by an unused function
+        float unused(float x) { return helper(x) + 1e5; }
+        vec3 chain2(vec3 v) { return v; }
+        vec3 chain1(vec3 v) { if (v.x > 0.0) { return chain2(v); } return v; }
+        void main() {
+            fragColor = vec4(chain1(vec3(helper(1.0))), 1.0);
+        }
+    )");
+    filamat::ShaderMinifier minifier;
+    std::string result = minifier.removeUnusedFunctions(shaderCode);
+    EXPECT_EQ(result.find("unused"), std::string::npos);
+    EXPECT_NE(result.find("float helper(float x)"), std::string::npos);
+    EXPECT_NE(result.find("float helper(vec2 x)"), std::string::npos);
+    EXPECT_NE(result.find("vec3 chain2(vec3 v)"), std::string::npos);
+    EXPECT_NE(result.find("layout(location = 0) out vec4 fragColor;"), std::string::npos);
+
+    // without main() nothing can be proven unused
+    std::string library("float helper(float x) { return x; }\n");
+    EXPECT_EQ(minifier.removeUnusedFunctions(library), library);
+}
+
 class MaterialCompiler : public ::testing::Test {
 protected:
     MaterialCompiler() {
@@ -696,6 +724,28 @@ TEST_F(MaterialCompiler, StaticCodeAnalyzerWithinInclude) {
     EXPECT_TRUE(PropertyListsMatch(expected, properties));
 }
 
+TEST_F(MaterialCompiler, StaticCodeAnalyzerPrecisionCandidates) {
+    std::string fragmentCode(R"(
+        void material(inout MaterialInputs material) {
+            prepareMaterial(material);
+            highp vec3 tint = vec3(0.5);
+            highp float far = 100000.0;
+            highp float scale = 0.5;
+            highp vec3 position = getWorldPosition() * scale;
+            material.baseColor.rgb = tint * far + position;
+        }
+    )");
+
+    std::string shaderCode = shaderWithAllProperties(*jobSystem, ShaderType::FRAGMENT, fragmentCode);
+
+    GLSLTools glslTools;
+    std::vector<GLSLTools::PrecisionCandidate> candidates;
+    EXPECT_TRUE(glslTools.findPrecisionCandidates(shaderCode, candidates));
+    // 'far' doesn't fit in mediump, 'scale' and 'position' contribute to a highp value
+    ASSERT_EQ(candidates.size(), 1u);
+    EXPECT_EQ(candidates[0].name, "tint");
+}
+
 TEST_F(MaterialCompiler, EmptyName) {
     std::string shaderCode(R"(
         void material(inout MaterialInputs material) {
@@ -28,6 +28,7 @@
 
 #include <stb_image.h>
 
+#include <utils/MappedFile.h>
 #include <utils/Path.h>
 
 #include <fstream>
@@ -63,23 +64,26 @@ bool IBL::loadFromKtx(const std::string& prefix) {
         return false;
     }
 
-    auto createKtx = [] (Path path) {
-        using namespace std;
-        ifstream file(path.getPath(), ios::binary);
-        vector<uint8_t> contents((istreambuf_iterator<char>(file)), {});
-        return new image::KtxBundle(contents.data(), contents.size());
-    };
-
-    KtxBundle* iblKtx = createKtx(iblPath);
-    KtxBundle* skyKtx = createKtx(skyPath);
-
-    mSkyboxTexture = ktx::createTexture(&mEngine, skyKtx, false);
-    mTexture = ktx::createTexture(&mEngine, iblKtx, false);
+    // The KTX files are memory-mapped, their blobs are uploaded straight from the mappings.
+    auto* iblFile = new MappedFile(iblPath.c_str());
+    auto* skyFile = new MappedFile(skyPath.c_str());
+    if (!iblFile->isValid() || !skyFile->isValid()) {
+        delete iblFile;
+        delete skyFile;
+        return false;
+    }
 
-    if (!iblKtx->getSphericalHarmonics(mBands)) {
+    KtxBundle const iblKtx(iblFile->data(), uint32_t(iblFile->size()),
+            KtxBundle::BlobStorage::VIEW);
+    if (!iblKtx.getSphericalHarmonics(mBands)) {
+        delete iblFile;
+        delete skyFile;
         return false;
     }
 
+    mSkyboxTexture = ktx::createTexture(&mEngine, skyFile, false);
+    mTexture = ktx::createTexture(&mEngine, iblFile, false);
+
     mIndirectLight = IndirectLight::Builder()
             .reflections(mTexture)
             .intensity(IBL_INTENSITY)
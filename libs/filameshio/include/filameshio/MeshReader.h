@@ -17,9 +17,13 @@
 #ifndef TNT_FILAMENT_FILAMESHIO_MESHREADER_H
 #define TNT_FILAMENT_FILAMESHIO_MESHREADER_H
 
+#include <filameshio/filamesh.h>
+
 #include <utils/Entity.h>
 #include <utils/CString.h>
 
+#include <vector>
+
 namespace filament {
     class Engine;
     class VertexBuffer;
@@ -80,6 +84,12 @@ public:
         utils::Entity renderable;
         filament::VertexBuffer* vertexBuffer = nullptr;
         filament::IndexBuffer* indexBuffer = nullptr;
+
+        // Only populated if the file was produced with meshlets, see filamesh.h. These are kept
+        // on the CPU so that the application can upload them for cluster culling.
+        std::vector<Meshlet> meshlets;
+        std::vector<uint32_t> meshletVertices;
+        std::vector<uint8_t> meshletTriangles;
     };
 
     /**
@@ -88,6 +98,8 @@ public:
      * file cannot be matched to a material in the registry, a default material is
      * used instead. The default material can be overridden by adding a material
      * named "DefaultMaterial" to the registry.
+     * The file is memory-mapped where supported, and uncompressed vertex and index data are
+     * uploaded from the mapping directly, which is released once the upload is complete.
      */
     static Mesh loadMeshFromFile(filament::Engine* engine,
             const utils::Path& path,
@@ -19,13 +19,16 @@
 
 #include <filament/Box.h>
 
+#include <math/vec3.h>
+
 namespace filamesh {
 
 using Box = filament::Box;
 
 static const char MAGICID[] { 'F', 'I', 'L', 'A', 'M', 'E', 'S', 'H' };
 
-static const uint32_t VERSION = 1;
+// Version 2 adds the ALIGNED flag, version 1 files are still supported.
+static const uint32_t VERSION = 2;
 
 enum IndexType : uint32_t {
     UI32 = 0,
@@ -36,8 +39,19 @@ enum Flags : uint32_t {
     INTERLEAVED         = 1 << 0,
     TEXCOORD_SNORM16    = 1 << 1,
     COMPRESSION         = 1 << 2,
+    MESHLETS            = 1 << 3,
+    ALIGNED             = 1 << 4,
 };
 
+// When the ALIGNED flag is set, the vertex data, each de-interleaved vertex stream and the index
+// data start at a multiple of STREAM_ALIGNMENT bytes from the start of the file, padded with
+// zeros. The streams can then be uploaded straight from a memory-mapped file.
+static const uint32_t STREAM_ALIGNMENT = 16;
+
+inline uint32_t alignStream(uint32_t offset) noexcept {
+    return (offset + STREAM_ALIGNMENT - 1) & ~(STREAM_ALIGNMENT - 1);
+}
+
 // Each of these fields specifies a number of bytes within the compressed data. This is ignored
 // when the INTERLEAVED flag is enabled.
 struct CompressionHeader {
@@ -79,6 +93,36 @@ struct Part {
     Box aabb;
 };
 
+// Meshlets are only present when the MESHLETS flag is set, they follow the material names:
+//   uint32_t  meshletCount
+//   Meshlet   meshlets[meshletCount]
+//   uint32_t  vertexCount
+//   uint32_t  vertices[vertexCount]        indices into the vertex buffer
+//   uint32_t  triangleCount
+//   uint8_t   triangles[triangleCount * 3] indices into the meshlet's vertices
+static const uint32_t MAX_MESHLET_VERTICES = 64;
+static const uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+struct Meshlet {
+    uint32_t part;                      // index of the part this meshlet belongs to
+    uint32_t vertexOffset;              // first vertex of this meshlet in vertices[]
+    uint32_t vertexCount;
+    uint32_t triangleOffset;            // first triangle of this meshlet in triangles[]
+    uint32_t triangleCount;
+    filament::math::float3 center;      // bounding sphere, for frustum and occlusion culling
+    float radius;
+    filament::math::float3 coneAxis;    // normal cone, for backface culling
+    float coneCutoff;                   // cosine of the cone's half-angle
+};
+
+// Returns true if all the triangles of the meshlet face away from a viewer at the given
+// position, expressed in the same space as the mesh. A compute or mesh shader culling clusters
+// uses the same test.
+inline bool isBackfacing(Meshlet const& meshlet, filament::math::float3 eye) noexcept {
+    filament::math::float3 const d = meshlet.center - eye;
+    return dot(d, meshlet.coneAxis) >= meshlet.coneCutoff * length(d) + meshlet.radius;
+}
+
 } // namespace filamesh
 
 #endif // TNT_FILAMENT_FILAMESHIO_FILAMESH_H
@@ -19,7 +19,6 @@
 
 #include <filament/Box.h>
 #include <filament/Engine.h>
-#include <filament/Fence.h>
 #include <filament/IndexBuffer.h>
 #include <filament/Material.h>
 #include <filament/MaterialInstance.h>
@@ -32,6 +31,7 @@
 #include <utils/Log.h>
 #include <utils/Path.h>
 
+#include <atomic>
 #include <string>
 #include <vector>
 #include <map>
@@ -39,6 +39,7 @@
 
 #include <fcntl.h>
 #if !defined(WIN32)
+#    include <sys/mman.h>
 #    include <unistd.h>
 #else
 #    include <io.h>
@@ -157,6 +158,57 @@ static size_t fileSize(int fd) {
     return filesize;
 }
 
+// The content of a file, memory-mapped when possible. It is shared by the vertex and index
+// buffers uploaded straight from it, and released with the last reference.
+struct FileData {
+    void* data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+    std::atomic<uint32_t> references{ 1 };
+};
+
+static void releaseFileData(FileData* file) {
+    if (file->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+#if !defined(WIN32)
+        if (file->mapped) {
+            munmap(file->data, file->size);
+        } else
+#endif
+        {
+            free(file->data);
+        }
+        delete file;
+    }
+}
+
+static FileData* readFileData(int fd) {
+    FileData* file = new FileData;
+    file->size = fileSize(fd);
+#if !defined(WIN32)
+    void* addr = mmap(nullptr, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+        file->data = addr;
+        file->mapped = true;
+        return file;
+    }
+#endif
+    file->data = malloc(file->size);
+    if (file->data && size_t(read(fd, file->data, file->size)) != file->size) {
+        free(file->data);
+        file->data = nullptr;
+    }
+    return file;
+}
+
+// with the ALIGNED flag, streams start at a multiple of STREAM_ALIGNMENT from the start of the file
+static uint8_t const* skipPadding(Header const* header, void const* data, uint8_t const* p) {
+    if (header->flags & ALIGNED) {
+        size_t const offset = p - (uint8_t const*) data;
+        return (uint8_t const*) data + alignStream(uint32_t(offset));
+    }
+    return p;
+}
+
 namespace filamesh {
 
 MeshReader::Mesh MeshReader::loadMeshFromFile(filament::Engine* engine, const utils::Path& path,
@@ -165,24 +217,30 @@ MeshReader::Mesh MeshReader::loadMeshFromFile(filament::Engine* engine, const ut
     Mesh mesh;
 
     int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return mesh;
+    }
 
-    size_t size = fileSize(fd);
-    char* data = (char*) malloc(size);
-    read(fd, data, size);
-
-    if (data) {
-        char *p = data;
-        char *magic = p;
-        p += sizeof(MAGICID);
+    FileData* file = readFileData(fd);
+    close(fd);
 
-        if (!strncmp(MAGICID, magic, 8)) {
+    char const* data = (char const*) file->data;
+    if (data && file->size >= sizeof(MAGICID) + sizeof(Header) &&
+            !strncmp(MAGICID, data, sizeof(MAGICID))) {
+        Header const* header = (Header const*) (data + sizeof(MAGICID));
+        if (header->flags & COMPRESSION) {
+            // compressed streams are decoded into new buffers before this returns
             mesh = loadMeshFromBuffer(engine, data, nullptr, nullptr, materials);
+        } else {
+            // the vertex and index buffers are uploaded from the file's memory, without copies,
+            // each of them releases a reference once the upload is done
+            file->references.fetch_add(2, std::memory_order_relaxed);
+            mesh = loadMeshFromBuffer(engine, data,
+                    [](void*, size_t, void* user) { releaseFileData((FileData*) user); },
+                    file, materials);
         }
-
-        Fence::waitAndDestroy(engine->createFence());
-        free(data);
     }
-    close(fd);
+    releaseFileData(file);
 
     return mesh;
 }
@@ -208,9 +266,11 @@ MeshReader::Mesh MeshReader::loadMeshFromBuffer(filament::Engine* engine,
     Header* header = (Header*) p;
     p += sizeof(Header);
 
+    p = skipPadding(header, data, p);
     uint8_t const* vertexData = p;
     p += header->vertexSize;
 
+    p = skipPadding(header, data, p);
     uint8_t const* indices = p;
     p += header->indexSize;
 
@@ -230,6 +290,24 @@ MeshReader::Mesh MeshReader::loadMeshFromBuffer(filament::Engine* engine,
 
     Mesh mesh;
 
+    // Meshlets are not aligned in the file, so they're copied out with memcpy.
+    if (header->flags & MESHLETS) {
+        auto readCount = [&p]() {
+            uint32_t count;
+            memcpy(&count, p, sizeof(count));
+            p += sizeof(count);
+            return count;
+        };
+        mesh.meshlets.resize(readCount());
+        memcpy(mesh.meshlets.data(), p, mesh.meshlets.size() * sizeof(Meshlet));
+        p += mesh.meshlets.size() * sizeof(Meshlet);
+        mesh.meshletVertices.resize(readCount());
+        memcpy(mesh.meshletVertices.data(), p, mesh.meshletVertices.size() * sizeof(uint32_t));
+        p += mesh.meshletVertices.size() * sizeof(uint32_t);
+        mesh.meshletTriangles.resize(readCount() * 3);
+        memcpy(mesh.meshletTriangles.data(), p, mesh.meshletTriangles.size());
+    }
+
     mesh.indexBuffer = IndexBuffer::Builder()
             .indexCount(header->indexCount)
             .bufferType(header->indexType == UI16 ? IndexBuffer::IndexType::USHORT
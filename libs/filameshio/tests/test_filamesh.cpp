@@ -17,6 +17,7 @@
 #include <filament/Engine.h>
 #include <filament/Material.h>
 #include <filament/RenderableManager.h>
+#include <filament/VertexBuffer.h>
 
 #include <filameshio/filamesh.h>
 #include <filameshio/MeshReader.h>
@@ -27,8 +28,11 @@
 #include <math/quat.h>
 #include <math/vec3.h>
 
+#include <utils/Path.h>
+
 #include <gtest/gtest.h>
 
+#include <fstream>
 #include <sstream>
 
 using namespace filament;
@@ -216,6 +220,154 @@ TEST_F(FilameshTest, Interleaved) {
     engine->destroy(mi);
 }
 
+TEST_F(FilameshTest, Meshlets) {
+    // Serialize a single-triangle mesh with a single meshlet
+    const Header header {
+        .version = VERSION,
+        .parts = 1,
+        .aabb = unitBox,
+        .flags = INTERLEAVED | TEXCOORD_SNORM16 | MESHLETS,
+        .offsetPosition = offsetof(InterleavedVertex, position),
+        .stridePosition = sizeof(InterleavedVertex),
+        .offsetTangents = offsetof(InterleavedVertex, tangent),
+        .strideTangents = sizeof(InterleavedVertex),
+        .offsetColor = offsetof(InterleavedVertex, color),
+        .strideColor = sizeof(InterleavedVertex),
+        .offsetUV0 = offsetof(InterleavedVertex, uv0),
+        .strideUV0 = sizeof(InterleavedVertex),
+        .offsetUV1 = maxint,
+        .strideUV1 = maxint,
+        .vertexCount = vertexCount,
+        .vertexSize = sizeof(interleavedVertices),
+        .indexType = IndexType::UI16,
+        .indexCount = 3,
+        .indexSize = sizeof(uint16_t) * 3
+    };
+    const uint32_t nmats = 1;
+    const string matname = "DefaultMaterial";
+    const uint32_t matnamelength = matname.size();
+
+    // A meshlet facing +z
+    const Meshlet meshlet {
+        .part = 0,
+        .vertexOffset = 0,
+        .vertexCount = 3,
+        .triangleOffset = 0,
+        .triangleCount = 1,
+        .center = float3(0, 0, 0),
+        .radius = 1.0f,
+        .coneAxis = float3(0, 0, 1),
+        .coneCutoff = 0.5f
+    };
+    const uint32_t nmeshlets = 1;
+    const uint32_t meshletVertices[] = { 0, 1, 2 };
+    const uint32_t nvertices = 3;
+    const uint8_t meshletTriangles[] = { 0, 1, 2 };
+    const uint32_t ntriangles = 1;
+
+    stringstream stream(ios_base::out);
+    write(stream, MAGICID, sizeof(MAGICID));
+    write(stream, &header, sizeof(header));
+    write(stream, interleavedVertices, sizeof(interleavedVertices));
+    write(stream, indices, sizeof(indices));
+    write(stream, parts, sizeof(parts));
+    write(stream, &nmats, sizeof(nmats));
+    write(stream, &matnamelength, sizeof(matnamelength));
+    write(stream, matname.c_str(), matnamelength + 1);
+    write(stream, &nmeshlets, sizeof(nmeshlets));
+    write(stream, &meshlet, sizeof(meshlet));
+    write(stream, &nvertices, sizeof(nvertices));
+    write(stream, meshletVertices, sizeof(meshletVertices));
+    write(stream, &ntriangles, sizeof(ntriangles));
+    write(stream, meshletTriangles, sizeof(meshletTriangles));
+
+    MaterialInstance* mi = engine->getDefaultMaterial()->createInstance();
+    auto mesh = MeshReader::loadMeshFromBuffer(engine, stream.str().data(), nullptr, nullptr, mi);
+    ASSERT_EQ(mesh.meshlets.size(), 1);
+    EXPECT_EQ(mesh.meshlets[0].triangleCount, 1);
+    EXPECT_EQ(mesh.meshletVertices.size(), 3);
+    EXPECT_EQ(mesh.meshletTriangles.size(), 3);
+    EXPECT_EQ(mesh.meshletTriangles[2], 2);
+
+    // Seen from the front the meshlet is kept, seen from behind it is culled.
+    EXPECT_FALSE(isBackfacing(mesh.meshlets[0], float3(0, 0, 10)));
+    EXPECT_TRUE(isBackfacing(mesh.meshlets[0], float3(0, 0, -10)));
+
+    // Cleanup.
+    engine->destroy(mesh.renderable);
+    engine->destroy(mi);
+}
+
+TEST_F(FilameshTest, AlignedFromFile) {
+    // Serialize a single-triangle mesh with 1 UV set, each stream aligned to STREAM_ALIGNMENT
+    const uint32_t headerEnd = sizeof(MAGICID) + sizeof(Header);
+    const uint32_t offsetTangents = alignStream(sizeof(positions));
+    const uint32_t offsetColor = alignStream(offsetTangents + sizeof(tangents));
+    const uint32_t offsetUV0 = alignStream(offsetColor + sizeof(colors));
+    const uint32_t vertexSize = offsetUV0 + sizeof(uv0);
+    const Header header {
+        .version = VERSION,
+        .parts = 1,
+        .aabb = unitBox,
+        .flags = ALIGNED,
+        .offsetTangents = offsetTangents,
+        .offsetColor = offsetColor,
+        .offsetUV0 = offsetUV0,
+        .strideUV1 = maxint,
+        .vertexCount = vertexCount,
+        .vertexSize = vertexSize,
+        .indexType = IndexType::UI16,
+        .indexCount = 3,
+        .indexSize = sizeof(uint16_t) * 3
+    };
+    const uint32_t nmats = 1;
+    const string matname = "DefaultMaterial";
+    const uint32_t matnamelength = matname.size();
+    const char zeros[STREAM_ALIGNMENT] = {};
+
+    stringstream stream(ios_base::out);
+    write(stream, MAGICID, sizeof(MAGICID));
+    write(stream, &header, sizeof(header));
+    write(stream, zeros, alignStream(headerEnd) - headerEnd);
+    write(stream, positions, sizeof(positions));
+    write(stream, zeros, offsetTangents - sizeof(positions));
+    write(stream, tangents, sizeof(tangents));
+    write(stream, zeros, offsetColor - (offsetTangents + sizeof(tangents)));
+    write(stream, colors, sizeof(colors));
+    write(stream, zeros, offsetUV0 - (offsetColor + sizeof(colors)));
+    write(stream, uv0, sizeof(uv0));
+    const uint32_t vertexEnd = alignStream(headerEnd) + vertexSize;
+    write(stream, zeros, alignStream(vertexEnd) - vertexEnd);
+    write(stream, indices, sizeof(indices));
+    write(stream, parts, sizeof(parts));
+    write(stream, &nmats, sizeof(nmats));
+    write(stream, &matnamelength, sizeof(matnamelength));
+    write(stream, matname.c_str(), matnamelength + 1);
+
+    utils::Path path = utils::Path::getTemporaryDirectory() + "aligned.filamesh";
+    const string data = stream.str();
+    std::ofstream(path.getPath(), ios::binary | ios::trunc).write(data.data(), data.size());
+
+    // The file is memory-mapped and released once the buffers are uploaded.
+    MaterialInstance* mi = engine->getDefaultMaterial()->createInstance();
+    MeshReader::MaterialRegistry registry;
+    registry.registerMaterialInstance(utils::CString("DefaultMaterial"), mi);
+    auto mesh = MeshReader::loadMeshFromFile(engine, path, registry);
+    auto& rm = engine->getRenderableManager();
+    auto inst = rm.getInstance(mesh.renderable);
+    EXPECT_EQ(rm.getPrimitiveCount(inst), 1);
+    ASSERT_NE(mesh.vertexBuffer, nullptr);
+    EXPECT_EQ(mesh.vertexBuffer->getVertexCount(), vertexCount);
+    engine->flushAndWait();
+
+    // Cleanup.
+    engine->destroy(mesh.renderable);
+    engine->destroy(mesh.vertexBuffer);
+    engine->destroy(mesh.indexBuffer);
+    engine->destroy(mi);
+    path.unlinkFile();
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
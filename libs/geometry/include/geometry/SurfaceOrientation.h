@@ -23,6 +23,10 @@
 
 #include <utils/compiler.h>
 
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace filament {
 
 /**
@@ -84,6 +88,13 @@ public:
         Builder& triangles(const filament::math::uint3*) noexcept;
         Builder& triangles(const filament::math::ushort3*) noexcept;
 
+        /**
+         * Optional job system used to split the work of large meshes across its threads.
+         * When set, build() must be called from a thread known to the job system (e.g. a job
+         * or a thread that called adopt()). The result is identical with or without it.
+         */
+        Builder& jobSystem(utils::JobSystem* js) noexcept;
+
         /**
          * Generates quats or returns null if the submitted data is an incomplete combination.
          */
@@ -16,11 +16,13 @@
 
 #include <geometry/SurfaceOrientation.h>
 
+#include <utils/JobSystem.h>
 #include <utils/Panic.h>
 
 #include <math/mat3.h>
 #include <math/norm.h>
 
+#include <algorithm>
 #include <vector>
 
 namespace filament {
@@ -43,10 +45,25 @@ struct OrientationBuilderImpl {
     size_t uvStride = 0;
     size_t positionStride = 0;
     size_t triangleCount = 0;
+    utils::JobSystem* jobSystem = nullptr;
+
+    // below this many items, the overhead of the job system isn't worth it
+    static constexpr size_t PARALLEL_BATCH = 4096;
+
+    // calls f(begin, end) on ranges covering [0, count), possibly concurrently
+    template<typename F>
+    void parallelFor(size_t count, F const& f) const;
+
     SurfaceOrientation* buildWithNormalsOnly();
     SurfaceOrientation* buildWithSuppliedTangents();
     SurfaceOrientation* buildWithUvs();
     SurfaceOrientation* buildWithFlatNormals();
+
+    uint3 getTriangle(size_t i) const noexcept {
+        return triangles16 ? uint3(triangles16[i]) : triangles32[i];
+    }
+    void computeTriangleTangents(uint3 tri, float3* outSdir, float3* outTdir) const noexcept;
+    void accumulateTangentsParallel(float3* tan1, float3* tan2) const;
 };
 
 struct OrientationImpl {
@@ -110,6 +127,11 @@ Builder& Builder::triangles(const ushort3* triangles) noexcept {
     return *this;
 }
 
+Builder& Builder::jobSystem(utils::JobSystem* js) noexcept {
+    mImpl->jobSystem = js;
+    return *this;
+}
+
 SurfaceOrientation* Builder::build() {
     if (!ASSERT_PRECONDITION_NON_FATAL(mImpl->vertexCount > 0, "Vertex count must be non-zero.")) {
         return nullptr;
@@ -151,19 +173,32 @@ static float3 randomPerp(const float3& n) {
     return perp / sqrlen;
 }
 
+template<typename F>
+void OrientationBuilderImpl::parallelFor(size_t count, F const& f) const {
+    if (jobSystem && count >= 2 * PARALLEL_BATCH) {
+        utils::JobSystem::Job* job = utils::jobs::parallel_for(*jobSystem, nullptr,
+                0, uint32_t(count), [&f](uint32_t start, uint32_t n) { f(start, start + n); },
+                utils::jobs::CountSplitter<PARALLEL_BATCH>());
+        jobSystem->runAndWait(job);
+    } else {
+        f(0, count);
+    }
+}
+
 SurfaceOrientation* OrientationBuilderImpl::buildWithNormalsOnly() {
     vector<quatf> quats(vertexCount);
 
-    const float3* normal = this->normals;
+    const uint8_t* normals = (const uint8_t*) this->normals;
     size_t nstride = this->normalStride ? this->normalStride : sizeof(float3);
 
-    for (size_t qindex = 0; qindex < vertexCount; ++qindex) {
-        float3 n = *normal;
-        float3 b = randomPerp(n);
-        float3 t = cross(n, b);
-        quats[qindex] = mat3f::packTangentFrame({t, b, n});
-        normal = (const float3*) (((const uint8_t*) normal) + nstride);
-    }
+    parallelFor(vertexCount, [&](size_t begin, size_t end) {
+        for (size_t qindex = begin; qindex < end; ++qindex) {
+            float3 n = *(const float3*) (normals + qindex * nstride);
+            float3 b = randomPerp(n);
+            float3 t = cross(n, b);
+            quats[qindex] = mat3f::packTangentFrame({t, b, n});
+        }
+    });
 
     return new SurfaceOrientation(new OrientationImpl( { std::move(quats) } ));
 }
@@ -171,29 +206,28 @@ SurfaceOrientation* OrientationBuilderImpl::buildWithNormalsOnly() {
 SurfaceOrientation* OrientationBuilderImpl::buildWithSuppliedTangents() {
     vector<quatf> quats(vertexCount);
 
-    const float3* normal = this->normals;
+    const uint8_t* normals = (const uint8_t*) this->normals;
     size_t nstride = this->normalStride ? this->normalStride : sizeof(float3);
 
-    const float3* tanvec = (const float3*) this->tangents;
-    const float* tandir = &this->tangents->w;
+    const uint8_t* tangents = (const uint8_t*) this->tangents;
     size_t tstride = this->tangentStride ? this->tangentStride : sizeof(float4);
 
-    for (size_t qindex = 0; qindex < vertexCount; ++qindex) {
-        float3 n = *normal;
-        float3 t = *tanvec;
-        float3 b = *tandir > 0 ? cross(t, n) : cross(n, t);
-
-        // Some assets do not provide perfectly orthogonal tangents and normals, so we adjust the
-        // tangent to enforce orthonormality. We would rather honor the exact normal vector than
-        // the exact tangent vector since the latter is only used for bump mapping and anisotropic
-        // lighting.
-        t = *tandir > 0 ? cross(n, b) : cross(b, n);
-
-        quats[qindex] = mat3f::packTangentFrame({t, b, n});
-        normal = (const float3*) (((const uint8_t*) normal) + nstride);
-        tanvec = (const float3*) (((const uint8_t*) tanvec) + tstride);
-        tandir = (const float*) (((const uint8_t*) tandir) + tstride);
-    }
+    parallelFor(vertexCount, [&](size_t begin, size_t end) {
+        for (size_t qindex = begin; qindex < end; ++qindex) {
+            float3 n = *(const float3*) (normals + qindex * nstride);
+            float4 tangent = *(const float4*) (tangents + qindex * tstride);
+            float3 t = tangent.xyz;
+            float3 b = tangent.w > 0 ? cross(t, n) : cross(n, t);
+
+            // Some assets do not provide perfectly orthogonal tangents and normals, so we adjust
+            // the tangent to enforce orthonormality. We would rather honor the exact normal vector
+            // than the exact tangent vector since the latter is only used for bump mapping and
+            // anisotropic lighting.
+            t = tangent.w > 0 ? cross(n, b) : cross(b, n);
+
+            quats[qindex] = mat3f::packTangentFrame({t, b, n});
+        }
+    });
 
     return new SurfaceOrientation(new OrientationImpl( { std::move(quats) } ));
 }
@@ -224,65 +258,124 @@ SurfaceOrientation* OrientationBuilderImpl::buildWithUvs() {
     vector<float3> tan2(vertexCount);
     memset(tan1.data(), 0, sizeof(float3) * vertexCount);
     memset(tan2.data(), 0, sizeof(float3) * vertexCount);
-    for (size_t a = 0; a < triangleCount; ++a) {
-        uint3 tri = triangles16 ? uint3(triangles16[a]) : triangles32[a];
-        const float3& v1 = positions[tri.x];
-        const float3& v2 = positions[tri.y];
-        const float3& v3 = positions[tri.z];
-        const float2& w1 = uvs[tri.x];
-        const float2& w2 = uvs[tri.y];
-        const float2& w3 = uvs[tri.z];
-        float x1 = v2.x - v1.x;
-        float x2 = v3.x - v1.x;
-        float y1 = v2.y - v1.y;
-        float y2 = v3.y - v1.y;
-        float z1 = v2.z - v1.z;
-        float z2 = v3.z - v1.z;
-        float s1 = w2.x - w1.x;
-        float s2 = w3.x - w1.x;
-        float t1 = w2.y - w1.y;
-        float t2 = w3.y - w1.y;
-        float d = s1 * t2 - s2 * t1;
-        float3 sdir, tdir;
-        // In general we can't guarantee smooth tangents when the UV's are non-smooth, but let's at
-        // least avoid divide-by-zero and fall back to normals-only method.
-        if (d == 0.0) {
-            const float3& n1 = normals[tri.x];
-            sdir = randomPerp(n1);
-            tdir = cross(n1, sdir);
-        } else {
-            sdir = {t2 * x1 - t1 * x2, t2 * y1 - t1 * y2, t2 * z1 - t1 * z2};
-            tdir = {s1 * x2 - s2 * x1, s1 * y2 - s2 * y1, s1 * z2 - s2 * z1};
-            float r = 1.0f / d;
-            sdir *= r;
-            tdir *= r;
+    if (jobSystem && std::max(vertexCount, triangleCount) >= 2 * PARALLEL_BATCH) {
+        accumulateTangentsParallel(tan1.data(), tan2.data());
+    } else {
+        for (size_t a = 0; a < triangleCount; ++a) {
+            uint3 tri = getTriangle(a);
+            float3 sdir, tdir;
+            computeTriangleTangents(tri, &sdir, &tdir);
+            tan1[tri.x] += sdir;
+            tan1[tri.y] += sdir;
+            tan1[tri.z] += sdir;
+            tan2[tri.x] += tdir;
+            tan2[tri.y] += tdir;
+            tan2[tri.z] += tdir;
         }
-        tan1[tri.x] += sdir;
-        tan1[tri.y] += sdir;
-        tan1[tri.z] += sdir;
-        tan2[tri.x] += tdir;
-        tan2[tri.y] += tdir;
-        tan2[tri.z] += tdir;
     }
 
     vector<quatf> quats(vertexCount);
-    for (size_t a = 0; a < vertexCount; a++) {
-        const float3& n = normals[a];
-        const float3& t1 = tan1[a];
-        const float3& t2 = tan2[a];
+    parallelFor(vertexCount, [&](size_t begin, size_t end) {
+        for (size_t a = begin; a < end; a++) {
+            const float3& n = normals[a];
+            const float3& t1 = tan1[a];
+            const float3& t2 = tan2[a];
 
-        // Gram-Schmidt orthogonalize
-        float3 t = normalize(t1 - n * dot(n, t1));
+            // Gram-Schmidt orthogonalize
+            float3 t = normalize(t1 - n * dot(n, t1));
 
-        // Calculate handedness
-        float w = (dot(cross(n, t1), t2) < 0.0f) ? -1.0f : 1.0f;
+            // Calculate handedness
+            float w = (dot(cross(n, t1), t2) < 0.0f) ? -1.0f : 1.0f;
 
-        float3 b = w < 0 ? cross(t, n) : cross(n, t);
-        quats[a] = mat3f::packTangentFrame({t, b, n});
-    }
+            float3 b = w < 0 ? cross(t, n) : cross(n, t);
+            quats[a] = mat3f::packTangentFrame({t, b, n});
+        }
+    });
     return new SurfaceOrientation(new OrientationImpl( { std::move(quats) } ));
 }
 
+void OrientationBuilderImpl::computeTriangleTangents(uint3 tri,
+        float3* outSdir, float3* outTdir) const noexcept {
+    const float3& v1 = positions[tri.x];
+    const float3& v2 = positions[tri.y];
+    const float3& v3 = positions[tri.z];
+    const float2& w1 = uvs[tri.x];
+    const float2& w2 = uvs[tri.y];
+    const float2& w3 = uvs[tri.z];
+    float x1 = v2.x - v1.x;
+    float x2 = v3.x - v1.x;
+    float y1 = v2.y - v1.y;
+    float y2 = v3.y - v1.y;
+    float z1 = v2.z - v1.z;
+    float z2 = v3.z - v1.z;
+    float s1 = w2.x - w1.x;
+    float s2 = w3.x - w1.x;
+    float t1 = w2.y - w1.y;
+    float t2 = w3.y - w1.y;
+    float d = s1 * t2 - s2 * t1;
+    float3 sdir, tdir;
+    // In general we can't guarantee smooth tangents when the UV's are non-smooth, but let's at
+    // least avoid divide-by-zero and fall back to normals-only method.
+    if (d == 0.0) {
+        const float3& n1 = normals[tri.x];
+        sdir = randomPerp(n1);
+        tdir = cross(n1, sdir);
+    } else {
+        sdir = {t2 * x1 - t1 * x2, t2 * y1 - t1 * y2, t2 * z1 - t1 * z2};
+        tdir = {s1 * x2 - s2 * x1, s1 * y2 - s2 * y1, s1 * z2 - s2 * z1};
+        float r = 1.0f / d;
+        sdir *= r;
+        tdir *= r;
+    }
+    *outSdir = sdir;
+    *outTdir = tdir;
+}
+
+// Same as the serial accumulation in buildWithUvs(), but with a pass over the triangles and a
+// pass over the vertices that can both run concurrently. Each vertex sums the contributions of its
+// triangles in index order, so the result is the same as the serial scatter.
+void OrientationBuilderImpl::accumulateTangentsParallel(float3* tan1, float3* tan2) const {
+    vector<float3> sdirs(triangleCount);
+    vector<float3> tdirs(triangleCount);
+    parallelFor(triangleCount, [&](size_t begin, size_t end) {
+        for (size_t a = begin; a < end; ++a) {
+            computeTriangleTangents(getTriangle(a), &sdirs[a], &tdirs[a]);
+        }
+    });
+
+    // vertex to triangles adjacency, in compressed rows
+    vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t a = 0; a < triangleCount; ++a) {
+        uint3 tri = getTriangle(a);
+        offsets[tri.x + 1]++;
+        offsets[tri.y + 1]++;
+        offsets[tri.z + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; ++v) {
+        offsets[v + 1] += offsets[v];
+    }
+    vector<uint32_t> adjacency(offsets[vertexCount]);
+    vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t a = 0; a < triangleCount; ++a) {
+        uint3 tri = getTriangle(a);
+        adjacency[cursor[tri.x]++] = uint32_t(a);
+        adjacency[cursor[tri.y]++] = uint32_t(a);
+        adjacency[cursor[tri.z]++] = uint32_t(a);
+    }
+
+    parallelFor(vertexCount, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            float3 t1{}, t2{};
+            for (uint32_t i = offsets[v], n = offsets[v + 1]; i < n; ++i) {
+                t1 += sdirs[adjacency[i]];
+                t2 += tdirs[adjacency[i]];
+            }
+            tan1[v] = t1;
+            tan2[v] = t2;
+        }
+    });
+}
+
 SurfaceOrientation::SurfaceOrientation(OrientationImpl* impl) noexcept : mImpl(impl) {}
 
 SurfaceOrientation::~SurfaceOrientation() noexcept { delete mImpl; }
@@ -47,6 +47,22 @@ public:
      */
     void applyAnimation(size_t animationIndex, float time) const;
 
+    /**
+     * Applies an animation to each of the given animators, typically one per FilamentInstance.
+     * This is equivalent to calling applyAnimation() on each of them, but the animations are
+     * evaluated in parallel using the JobSystem of the engine, and all local transforms are set
+     * within a single filament::TransformManager transaction.
+     *
+     * All animators must be distinct and belong to the same engine.
+     *
+     * @param animators Animators to update.
+     * @param animationIndices Zero-based index for the \c animation of interest, per animator.
+     * @param times Elapsed time of interest in seconds, per animator.
+     * @param count Number of animators.
+     */
+    static void applyAnimations(Animator* const* animators, const size_t* animationIndices,
+            const float* times, size_t count);
+
     /**
      * Computes root-to-node transforms for all bone nodes, then passes
      * the results into filament::RenderableManager::setBones.
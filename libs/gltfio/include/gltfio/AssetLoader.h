@@ -58,6 +58,36 @@ struct AssetConfiguration {
 
     //! Optional default node name for anonymous nodes
     char* defaultNodeName = nullptr;
+
+    //! Number of levels of detail of the renderables, between 1 (the default) and 4. ResourceLoader
+    //! generates the coarser levels by simplifying opaque and masked triangle primitives, each
+    //! level has about half the triangles of the previous one. See
+    //! filament::RenderableManager::Builder::levelsOfDetail().
+    uint8_t levelsOfDetail = 1;
+
+    //! Stores the geometry in smaller vertex and index formats when this can be done without
+    //! visible loss: 32-bit indices are narrowed to 16 bits when the primitive has at most 65536
+    //! vertices, and float texture coordinates whose accessor bounds lie within [0, 1] or [-1, 1]
+    //! are quantized to normalized shorts. Normals and tangents are always stored as quaternions of
+    //! normalized shorts. Content that uses KHR_mesh_quantization is supported regardless of this
+    //! setting. The conversion is done by ResourceLoader.
+    bool compactGeometry = false;
+
+    //! Stores animation keyframes in a compact form: keyframes of linear and step samplers that
+    //! interpolating their neighbors reproduces are removed, and the values are quantized to 16
+    //! bits relative to the range of each sampler. This typically reduces the memory used by long
+    //! motion capture clips by more than half, the error is within one quantization step of the
+    //! range of each component. See Animator.
+    bool compressAnimations = false;
+
+    //! Shares material instances between glTF materials that have the same parameter values and
+    //! textures, instead of creating one filament::MaterialInstance per glTF material. Within an
+    //! asset, identical materials share an instance. Across the assets created by this loader,
+    //! instances are shared only for materials without textures, since the textures belong to the
+    //! asset that binds them; a shared instance is destroyed with the last asset that uses it.
+    //! Fewer instances means fewer uniform buffers and more batching in the renderer, but changing
+    //! a parameter of a shared instance affects all the primitives that use it.
+    bool shareMaterialInstances = false;
 };
 
 /**
@@ -107,7 +107,7 @@ enum MaterialSource {
 
 /**
  * \class MaterialProvider MaterialProvider.h gltfio/MaterialProvider.h
- * \brief Interface to a provider of glTF materials (has two implementations).
+ * \brief Interface to a provider of glTF materials (has three implementations).
  *
  * - The \c MaterialGenerator implementation generates materials at run time (which can be slow) and
  *   requires the filamat library, but produces streamlined shaders. See createMaterialGenerator().
@@ -116,7 +116,11 @@ enum MaterialSource {
  *   fragment shaders, but does not require any run time work or usage of filamat. See
  *   createUbershaderLoader().
  *
- * Both implementations of MaterialProvider maintain a small cache of materials which must be
+ * - The \c SpecializingMaterialProvider implementation starts with the ubershaders and generates
+ *   streamlined materials in the background for the most common configurations. It requires the
+ *   filamat library. See createSpecializingMaterialProvider().
+ *
+ * All implementations of MaterialProvider maintain a small cache of materials which must be
  * explicitly freed using destroyMaterials(). These materials are not freed automatically when the
  * MaterialProvider is destroyed, which allows clients to take ownership if desired.
  *
@@ -188,6 +192,29 @@ MaterialProvider* createMaterialGenerator(filament::Engine* engine, bool optimiz
  */
 MaterialProvider* createUbershaderLoader(filament::Engine* engine);
 
+/**
+ * Creates a material provider that starts with the pre-built ubershaders, and builds specialized
+ * materials in the background for the most frequently requested configurations.
+ *
+ * A specialized material is used by the material instances created after it is ready; instances
+ * that were already created keep using their ubershader. It is never slower to create an instance
+ * than with createUbershaderLoader(), because the specialized materials are built one at a time
+ * on the engine's JobSystem, and picked up by the next call to createMaterialInstance().
+ *
+ * @param maxSpecializedMaterials Maximum number of configurations that get a specialized material.
+ * @param cachePath Optional directory where the specialized materials are saved, and loaded from
+ *                  on the first request of their configuration, e.g. at the next launch.
+ * @return New material provider that specializes its materials over time.
+ *
+ * Requires \c libfilamat and \c libgltfio_resources to be linked in. Not available in
+ * \c libgltfio_core.
+ *
+ * @see createUbershaderLoader
+ * @see createMaterialGenerator
+ */
+MaterialProvider* createSpecializingMaterialProvider(filament::Engine* engine,
+        size_t maxSpecializedMaterials = 8, const char* cachePath = nullptr);
+
 } // namespace gltfio
 
 #endif // GLTFIO_MATERIALPROVIDER_H
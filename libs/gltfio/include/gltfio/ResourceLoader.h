@@ -29,6 +29,7 @@ namespace gltfio {
 
 struct FFilamentAsset;
 class AssetPool;
+class TextureCache;
 
 /**
  * \struct ResourceConfiguration ResourceLoader.h gltfio/ResourceLoader.h
@@ -50,6 +51,20 @@ struct ResourceConfiguration {
     //! If true, computes the bounding boxes of all \c POSITION attibutes. Well formed glTF files
     //! do not need this, but it is useful for robustness.
     bool recomputeBoundingBoxes;
+
+    //! Optional path to an existing directory where decoded Draco meshes are stored, in files
+    //! named after a hash of their compressed data. Subsequent loads of the same compressed
+    //! meshes read these files instead of decompressing them. The string pointer is not retained.
+    const char* dracoCachePath = nullptr;
+
+    //! If true, reorders the triangles of opaque and masked primitives for the post-transform
+    //! vertex cache, then to reduce overdraw. The vertex cache statistics (ACMR and ATVR) before
+    //! and after are logged for each asset. Vertices are not reordered.
+    bool optimizeMeshes = false;
+
+    //! Optional cache of textures shared with other ResourceLoader instances, see TextureCache.
+    //! Textures found in the cache are neither decoded nor uploaded again.
+    TextureCache* textureCache = nullptr;
 };
 
 /**
@@ -62,14 +77,19 @@ struct ResourceConfiguration {
  * because it listens to filament::backend::BufferDescriptor callbacks in order to determine when to
  * free CPU-side data blobs.
  *
- * \todo If clients persist their ResourceLoader, Filament textures are currently re-created upon
- * subsequent re-loads of the same asset. To fix this, we would need to enable shared ownership
- * of Texture objects between ResourceLoader and FilamentAsset.
+ * Filament textures are re-created upon subsequent loads of the same images, unless a TextureCache
+ * is shared between the loads through ResourceConfiguration.
  */
 class ResourceLoader {
 public:
     using BufferDescriptor = filament::backend::BufferDescriptor;
 
+    /**
+     * Requests an external resource during a progressive load, see #asyncBeginLoad.
+     * The client must eventually pass the content of the resource to #addResourceData.
+     */
+    using FetchCallback = void(*)(const char* uri, void* user);
+
     ResourceLoader(const ResourceConfiguration& config);
     ~ResourceLoader();
 
@@ -80,8 +100,9 @@ public:
      * own (external resources might come from a filesystem, a database, or the internet) so this
      * method allows clients to download external resources and push them to the loader.
      *
-     * Every resource should be passed in before calling #loadResources or #asyncBeginLoad. See
-     * also FilamentAsset#getResourceUris.
+     * Every resource should be passed in before calling #loadResources or #asyncBeginLoad, except
+     * with a progressive load, which requests them as needed. See also
+     * FilamentAsset#getResourceUris.
      *
      * When loading GLB files (as opposed to JSON-based glTF files), clients typically do not
      * need to call this method.
@@ -123,6 +144,22 @@ public:
      */
     bool asyncBeginLoad(FilamentAsset* asset);
 
+    /**
+     * Starts a progressive, asynchronous resource load.
+     *
+     * Returns false if the loading process was unable to start.
+     *
+     * Unlike the above, external resources do not need to be added up-front. Each resource that is
+     * not in the URI cache is requested once with the fetch callback, and the client passes it to
+     * #addResourceData when it arrives, from the thread that calls #asyncUpdateLoad.
+     *
+     * #asyncUpdateLoad uploads the geometry of each primitive as soon as the buffers it uses have
+     * arrived, so FilamentAsset::popRenderables returns each renderable as soon as its own
+     * geometry and textures are ready. Textures start decoding once all buffers have arrived,
+     * because they can be stored in buffer views.
+     */
+    bool asyncBeginLoad(FilamentAsset* asset, FetchCallback fetch, void* user);
+
     /**
      * Gets the status of an asynchronous resource load as a percentage in [0,1].
      */
@@ -147,8 +184,7 @@ public:
 
 private:
     bool loadResources(FFilamentAsset* asset, bool async);
-    void applySparseData(FFilamentAsset* asset) const;
-    void normalizeSkinningWeights(FFilamentAsset* asset) const;
+    void updateProgressiveLoad();
     void updateBoundingBoxes(FFilamentAsset* asset) const;
     AssetPool* mPool;
     struct Impl;
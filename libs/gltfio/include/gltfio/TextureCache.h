@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLTFIO_TEXTURECACHE_H
+#define GLTFIO_TEXTURECACHE_H
+
+#include <stddef.h>
+
+namespace filament {
+    class Engine;
+}
+
+namespace gltfio {
+
+/**
+ * \class TextureCache TextureCache.h gltfio/TextureCache.h
+ * \brief Shares textures between assets, across ResourceLoader instances.
+ *
+ * When a cache is passed to ResourceLoader through ResourceConfiguration, textures are looked up
+ * in the cache before being decoded. Files are identified by their path, and embedded or
+ * user-supplied images by a hash of their content. Many assets that reference the same atlases
+ * or material maps thus decode and upload each of them only once.
+ *
+ * Textures in the cache are reference counted by the assets that use them, and destroyed along
+ * with the last of these assets. The cache must outlive the assets loaded with it. It is not
+ * thread safe, and must be used from the thread that loads and destroys assets.
+ *
+ * A texture shared with an asset that is still loading might be rendered before its content has
+ * been uploaded.
+ */
+class TextureCache {
+public:
+
+    /**
+     * Creates an empty cache. The engine is held weakly, used only to destroy the textures.
+     */
+    static TextureCache* create(filament::Engine* engine);
+
+    /**
+     * Frees the cache, and destroys the textures it still holds.
+     */
+    static void destroy(TextureCache** cache);
+
+    /**
+     * Gets the number of textures in the cache.
+     */
+    size_t getTextureCount() const noexcept;
+
+    /*! \cond PRIVATE */
+protected:
+    TextureCache() noexcept = default;
+    ~TextureCache() = default;
+
+public:
+    TextureCache(TextureCache const&) = delete;
+    TextureCache(TextureCache&&) = delete;
+    TextureCache& operator=(TextureCache const&) = delete;
+    TextureCache& operator=(TextureCache&&) = delete;
+    /*! \endcond */
+};
+
+} // namespace gltfio
+
+#endif // GLTFIO_TEXTURECACHE_H
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AnimationSampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace filament::math;
+using namespace std;
+
+namespace gltfio {
+
+// Removes the keyframes that interpolating their neighbors reproduces within the given tolerance,
+// per component. Linear samplers use the swinging door algorithm: the line from the first keyframe
+// of a segment to a candidate last keyframe must pass within the tolerance of all the keyframes in
+// between, which is tracked with a range of slopes per component. When no such line exists, the
+// previous keyframe ends the segment and starts the next one. The last keyframe is always kept.
+static void reduceKeyframes(Sampler& sampler, const float4& tolerance) {
+    const size_t count = sampler.times.size();
+    if (count < 3 || sampler.interpolation == Sampler::CUBIC) {
+        return;
+    }
+    for (size_t i = 1; i < count; ++i) {
+        if (!(sampler.times[i] > sampler.times[i - 1])) {
+            return;
+        }
+    }
+
+    const size_t stride = sampler.values.size() / count;
+    const float* values = sampler.values.data();
+    auto tol = [&](size_t c) { return tolerance[c % sampler.components]; };
+
+    vector<size_t> kept = { 0 };
+    if (sampler.interpolation == Sampler::STEP) {
+        for (size_t i = 1; i < count - 1; ++i) {
+            const float* prev = values + kept.back() * stride;
+            const float* curr = values + i * stride;
+            for (size_t c = 0; c < stride; ++c) {
+                if (std::abs(curr[c] - prev[c]) > tol(c)) {
+                    kept.push_back(i);
+                    break;
+                }
+            }
+        }
+    } else {
+        vector<float> lower(stride);
+        vector<float> upper(stride);
+        auto reset = [&]() {
+            std::fill(lower.begin(), lower.end(), -std::numeric_limits<float>::infinity());
+            std::fill(upper.begin(), upper.end(), std::numeric_limits<float>::infinity());
+        };
+        reset();
+        for (size_t i = 1; i < count; ++i) {
+            const float* curr = values + i * stride;
+            size_t anchor = kept.back();
+            for (size_t c = 0; c < stride; ++c) {
+                const float slope = (curr[c] - values[anchor * stride + c]) /
+                        (sampler.times[i] - sampler.times[anchor]);
+                if (slope < lower[c] || slope > upper[c]) {
+                    kept.push_back(anchor = i - 1);
+                    reset();
+                    break;
+                }
+            }
+            const float* first = values + anchor * stride;
+            const float dt = sampler.times[i] - sampler.times[anchor];
+            for (size_t c = 0; c < stride; ++c) {
+                lower[c] = std::max(lower[c], (curr[c] - tol(c) - first[c]) / dt);
+                upper[c] = std::min(upper[c], (curr[c] + tol(c) - first[c]) / dt);
+            }
+        }
+    }
+    kept.push_back(count - 1);
+
+    if (kept.size() == count) {
+        return;
+    }
+    TimeValues times(kept.size());
+    SourceValues reduced(kept.size() * stride);
+    for (size_t i = 0; i < kept.size(); ++i) {
+        times[i] = sampler.times[kept[i]];
+        std::copy_n(values + kept[i] * stride, stride, reduced.data() + i * stride);
+    }
+    sampler.times = std::move(times);
+    sampler.values = std::move(reduced);
+}
+
+void compressSampler(Sampler& sampler) {
+    if (sampler.values.empty()) {
+        return;
+    }
+    const size_t n = sampler.components;
+    float4 minValue(std::numeric_limits<float>::max());
+    float4 maxValue(-std::numeric_limits<float>::max());
+    for (size_t i = 0, count = sampler.values.size(); i < count; ++i) {
+        minValue[i % n] = std::min(minValue[i % n], sampler.values[i]);
+        maxValue[i % n] = std::max(maxValue[i % n], sampler.values[i]);
+    }
+    sampler.offset = float4(0.0f);
+    sampler.scale = float4(0.0f);
+    for (size_t c = 0; c < n; ++c) {
+        sampler.offset[c] = minValue[c];
+        sampler.scale[c] = (maxValue[c] - minValue[c]) / 65535.0f;
+    }
+
+    // Constant components still need some tolerance for the rounding of the slopes.
+    float4 tolerance = sampler.scale;
+    for (size_t c = 0; c < n; ++c) {
+        tolerance[c] = std::max(tolerance[c], 1e-6f * std::max(1.0f, std::abs(minValue[c])));
+    }
+    reduceKeyframes(sampler, tolerance);
+
+    sampler.quantized.resize(sampler.values.size());
+    for (size_t i = 0, count = sampler.values.size(); i < count; ++i) {
+        const size_t c = i % n;
+        const float q = sampler.scale[c] > 0.0f ?
+                std::round((sampler.values[i] - sampler.offset[c]) / sampler.scale[c]) : 0.0f;
+        sampler.quantized[i] = uint16_t(std::clamp(q, 0.0f, 65535.0f));
+    }
+    SourceValues().swap(sampler.values);
+}
+
+} // namespace gltfio
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLTFIO_ANIMATIONSAMPLER_H
+#define GLTFIO_ANIMATIONSAMPLER_H
+
+#include <math/quat.h>
+#include <math/vec3.h>
+#include <math/vec4.h>
+
+#include <vector>
+
+#include <stdint.h>
+
+namespace gltfio {
+
+using TimeValues = std::vector<float>;
+using SourceValues = std::vector<float>;
+using QuantizedValues = std::vector<uint16_t>;
+
+// Keyframe values are either stored as floats, or quantized by compressSampler(), in which case
+// each component is decoded as offset + scale * quantized.
+struct Sampler {
+    using float3 = filament::math::float3;
+    using float4 = filament::math::float4;
+    using quatf = filament::math::quatf;
+
+    TimeValues times;
+    SourceValues values;
+    QuantizedValues quantized;
+    float4 offset;
+    float4 scale;
+    uint8_t components; // 1 for morph weights, 3 for translation and scale, 4 for rotation
+    enum { LINEAR, STEP, CUBIC } interpolation;
+
+    size_t getValueCount() const {
+        return quantized.empty() ? values.size() : quantized.size();
+    }
+
+    float getFloat(size_t index) const {
+        return quantized.empty() ? values[index] : offset.x + scale.x * quantized[index];
+    }
+
+    float3 getFloat3(size_t index) const {
+        if (quantized.empty()) {
+            return ((const float3*) values.data())[index];
+        }
+        const uint16_t* q = quantized.data() + index * 3;
+        return offset.xyz + scale.xyz * float3(q[0], q[1], q[2]);
+    }
+
+    quatf getQuat(size_t index) const {
+        if (quantized.empty()) {
+            return ((const quatf*) values.data())[index];
+        }
+        const uint16_t* q = quantized.data() + index * 4;
+        const float4 v = offset + scale * float4(q[0], q[1], q[2], q[3]);
+        return quatf(v.xyz, v.w);
+    }
+};
+
+/**
+ * Reduces the keyframes within one quantization step, then quantizes the values to 16 bits
+ * relative to the range of each component. See AssetConfiguration::compressAnimations.
+ */
+void compressSampler(Sampler& sampler);
+
+} // namespace gltfio
+
+#endif // GLTFIO_ANIMATIONSAMPLER_H
@@ -16,25 +16,31 @@
 
 #include <gltfio/Animator.h>
 
+#include "AnimationSampler.h"
 #include "FFilamentAsset.h"
 #include "FFilamentInstance.h"
 #include "MorphHelper.h"
 #include "math.h"
 #include "upcast.h"
 
+#include <filament/Engine.h>
 #include <filament/MaterialEnums.h>
 #include <filament/RenderableManager.h>
 #include <filament/TransformManager.h>
 
+#include <utils/JobSystem.h>
 #include <utils/Log.h>
 
+#include <math/batch.h>
 #include <math/mat4.h>
 #include <math/quat.h>
 #include <math/scalar.h>
 #include <math/vec3.h>
 #include <math/vec4.h>
 
-#include <map>
+#include <tsl/robin_map.h>
+
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -45,20 +51,27 @@ using namespace utils;
 
 namespace gltfio {
 
-using TimeValues = map<float, size_t>;
-using SourceValues = vector<float>;
 using BoneVector = vector<filament::math::mat4f>;
 
-struct Sampler {
-    TimeValues times;
-    SourceValues values;
-    enum { LINEAR, STEP, CUBIC } interpolation;
-};
-
 struct Channel {
     const Sampler* sourceData;
     Entity targetEntity;
     enum { TRANSLATION, ROTATION, SCALE, WEIGHTS } transformType;
+    size_t nextKeyframe = 0; // cached result of the previous keyframe search
+};
+
+// Local transform of a node, while its channels are being evaluated.
+struct NodeTransform {
+    TransformManager::Instance node;
+    float3 translation;
+    quatf rotation;
+    float3 scale;
+};
+
+struct MorphWeights {
+    Entity targetEntity;
+    size_t offset;
+    size_t count;
 };
 
 struct Animation {
@@ -75,34 +88,60 @@ struct AnimatorImpl {
     FFilamentInstance* instance = nullptr;
     RenderableManager* renderableManager;
     TransformManager* transformManager;
-    vector<float> weights;
     MorphHelper* morpher;
+
+    // Results of evaluate(), which are applied by commit().
+    vector<NodeTransform> nodeTransforms;
+    vector<mat4f> localTransforms;
+    tsl::robin_map<Entity, size_t> nodeIndices;
+    vector<MorphWeights> morphWeights;
+    vector<float> weights;
+
     void addChannels(const NodeMap& nodeMap, const cgltf_animation& srcAnim, Animation& dst);
-    void applyAnimation(const Channel& channel, float t, size_t prevIndex, size_t nextIndex);
+    void evaluate(size_t animationIndex, float time);
+    void evaluate(const Channel& channel, float t, size_t prevIndex, size_t nextIndex);
+    void commit();
 };
 
+// Returns the index of the first keyframe whose time is greater than or equal to the given time,
+// or the number of keyframes. Playback is usually continuous, so the result of the previous
+// search is checked first, which makes the search O(1) on average.
+static size_t findNextKeyframe(const TimeValues& times, float time, size_t& cache) {
+    const size_t count = times.size();
+    auto isNext = [&times, count, time](size_t i) {
+        return (i == count || times[i] >= time) && (i == 0 || times[i - 1] < time);
+    };
+    for (size_t i = cache, n = std::min(cache + 2, count + 1); i < n; ++i) {
+        if (isNext(i)) {
+            return cache = i;
+        }
+    }
+    return cache = std::lower_bound(times.begin(), times.end(), time) - times.begin();
+}
+
 static void createSampler(const cgltf_animation_sampler& src, Sampler& dst) {
-    // Copy the time values into a red-black tree.
+    // Copy the time values, which glTF requires to be strictly increasing.
     const cgltf_accessor* timelineAccessor = src.input;
     const uint8_t* timelineBlob = (const uint8_t*) timelineAccessor->buffer_view->buffer->data;
     const float* timelineFloats = (const float*) (timelineBlob + timelineAccessor->offset +
             timelineAccessor->buffer_view->offset);
-    for (size_t i = 0, len = timelineAccessor->count; i < len; ++i) {
-        dst.times[timelineFloats[i]] = i;
-    }
+    dst.times.assign(timelineFloats, timelineFloats + timelineAccessor->count);
 
     // Convert source data to float.
     const cgltf_accessor* valuesAccessor = src.output;
     switch (valuesAccessor->type) {
         case cgltf_type_scalar:
+            dst.components = 1;
             dst.values.resize(valuesAccessor->count);
             cgltf_accessor_unpack_floats(src.output, &dst.values[0], valuesAccessor->count);
             break;
         case cgltf_type_vec3:
+            dst.components = 3;
             dst.values.resize(valuesAccessor->count * 3);
             cgltf_accessor_unpack_floats(src.output, &dst.values[0], valuesAccessor->count * 3);
             break;
         case cgltf_type_vec4:
+            dst.components = 4;
             dst.values.resize(valuesAccessor->count * 4);
             cgltf_accessor_unpack_floats(src.output, &dst.values[0], valuesAccessor->count * 4);
             break;
@@ -205,8 +244,11 @@ Animator::Animator(FFilamentAsset* asset, FFilamentInstance* instance) {
             const cgltf_animation_sampler& srcSampler = srcSamplers[j];
             Sampler& dstSampler = dstAnim.samplers[j];
             createSampler(srcSampler, dstSampler);
+            if (asset->mCompressAnimations) {
+                compressSampler(dstSampler);
+            }
             if (dstSampler.times.size() > 1) {
-                float maxtime = (--dstSampler.times.end())->first;
+                float maxtime = dstSampler.times.back();
                 dstAnim.duration = std::max(dstAnim.duration, maxtime);
             }
         }
@@ -244,50 +286,34 @@ size_t Animator::getAnimationCount() const {
 }
 
 void Animator::applyAnimation(size_t animationIndex, float time) const {
-    const Animation& anim = mImpl->animations[animationIndex];
-    TransformManager* transformManager = mImpl->transformManager;
-    RenderableManager* renderableManager = mImpl->renderableManager;
-    time = fmod(time, anim.duration);
-    for (const auto& channel : anim.channels) {
-        const Sampler* sampler = channel.sourceData;
-        if (sampler->times.size() < 2) {
-            continue;
-        }
-
-        const TimeValues& times = sampler->times;
-
-        // Find the first keyframe after the given time, or the keyframe that matches it exactly.
-        TimeValues::const_iterator iter = times.lower_bound(time);
-
-        // Compute the interpolant (between 0 and 1) and determine the keyframe pair.
-        float t = 0.0f;
-        size_t nextIndex;
-        size_t prevIndex;
-        if (iter == times.end()) {
-            nextIndex = times.size() - 1;
-            prevIndex = nextIndex;
-        } else if (iter == times.begin()) {
-            nextIndex = 0;
-            prevIndex = 0;
-        } else {
-            TimeValues::const_iterator prev = iter; --prev;
-            nextIndex = iter->second;
-            prevIndex = prev->second;
-            const float nextTime = iter->first;
-            const float prevTime = prev->first;
-            float deltaTime = nextTime - prevTime;
-            assert(deltaTime >= 0);
-            if (deltaTime > 0) {
-                t = (time - prevTime) / deltaTime;
-            }
-        }
-
-        if (sampler->interpolation == Sampler::STEP) {
-            t = 0.0f;
-        }
+    mImpl->evaluate(animationIndex, time);
+    mImpl->commit();
+}
 
-        mImpl->applyAnimation(channel, t, prevIndex, nextIndex);
+void Animator::applyAnimations(Animator* const* animators, const size_t* animationIndices,
+        const float* times, size_t count) {
+    if (count == 0) {
+        return;
     }
+    Engine* engine = animators[0]->mImpl->asset->mEngine;
+    JobSystem& js = engine->getJobSystem();
+
+    // Evaluate the channels of each animator in parallel, this only reads the TransformManager.
+    auto* job = jobs::parallel_for(js, nullptr, 0, uint32_t(count),
+            [animators, animationIndices, times](uint32_t start, uint32_t count) {
+                for (uint32_t i = start, n = start + count; i < n; ++i) {
+                    animators[i]->mImpl->evaluate(animationIndices[i], times[i]);
+                }
+            }, jobs::CountSplitter<8>());
+    js.runAndWait(job);
+
+    // Then set all local transforms at once, world transforms are computed only once at the end.
+    TransformManager& transformManager = engine->getTransformManager();
+    transformManager.openLocalTransformTransaction();
+    for (size_t i = 0; i < count; ++i) {
+        animators[i]->mImpl->commit();
+    }
+    transformManager.commitLocalTransformTransaction();
 }
 
 void Animator::updateBoneMatrices() {
@@ -311,12 +337,13 @@ void Animator::updateBoneMatrices() {
                 for (size_t boneIndex = 0; boneIndex < njoints; ++boneIndex) {
                     const auto& joint = skin.joints[boneIndex];
                     TransformManager::Instance jointInstance = transformManager->getInstance(joint);
-                    mat4f globalJointTransform = transformManager->getWorldTransform(jointInstance);
-                    boneVector[boneIndex] =
-                            inverseGlobalTransform *
-                            globalJointTransform *
-                            skin.inverseBindMatrices[boneIndex];
+                    boneVector[boneIndex] = transformManager->getWorldTransform(jointInstance);
                 }
+                // bone = inverseGlobalTransform * globalJointTransform * inverseBindMatrix
+                mulMat4Array(boneVector.data(), boneVector.data(),
+                        skin.inverseBindMatrices.data(), njoints);
+                mulMat4Array(boneVector.data(), inverseGlobalTransform,
+                        boneVector.data(), njoints);
                 renderableManager->setBones(renderable, boneVector.data(), boneVector.size());
             }
         }
@@ -373,101 +400,173 @@ void AnimatorImpl::addChannels(const NodeMap& nodeMap, const cgltf_animation& sr
     }
 }
 
-void AnimatorImpl::applyAnimation(const Channel& channel, float t, size_t prevIndex,
+void AnimatorImpl::evaluate(size_t animationIndex, float time) {
+    Animation& anim = animations[animationIndex];
+    nodeTransforms.clear();
+    nodeIndices.clear();
+    morphWeights.clear();
+    weights.clear();
+
+    time = fmod(time, anim.duration);
+    for (auto& channel : anim.channels) {
+        const Sampler* sampler = channel.sourceData;
+        if (sampler->times.size() < 2) {
+            continue;
+        }
+
+        const TimeValues& times = sampler->times;
+
+        // Find the first keyframe after the given time, or the keyframe that matches it exactly.
+        const size_t next = findNextKeyframe(times, time, channel.nextKeyframe);
+
+        // Compute the interpolant (between 0 and 1) and determine the keyframe pair.
+        float t = 0.0f;
+        size_t nextIndex;
+        size_t prevIndex;
+        if (next == times.size()) {
+            nextIndex = times.size() - 1;
+            prevIndex = nextIndex;
+        } else if (next == 0) {
+            nextIndex = 0;
+            prevIndex = 0;
+        } else {
+            nextIndex = next;
+            prevIndex = next - 1;
+            const float nextTime = times[nextIndex];
+            const float prevTime = times[prevIndex];
+            float deltaTime = nextTime - prevTime;
+            assert(deltaTime >= 0);
+            if (deltaTime > 0) {
+                t = (time - prevTime) / deltaTime;
+            }
+        }
+
+        if (sampler->interpolation == Sampler::STEP) {
+            t = 0.0f;
+        }
+
+        evaluate(channel, t, prevIndex, nextIndex);
+    }
+
+    // Perform the composition here, so that it is done in parallel by applyAnimations().
+    localTransforms.resize(nodeTransforms.size());
+    for (size_t i = 0, n = nodeTransforms.size(); i < n; ++i) {
+        const NodeTransform& trs = nodeTransforms[i];
+        localTransforms[i] = composeMatrix(trs.translation, trs.rotation, trs.scale);
+    }
+}
+
+void AnimatorImpl::commit() {
+    for (size_t i = 0, n = nodeTransforms.size(); i < n; ++i) {
+        transformManager->setTransform(nodeTransforms[i].node, localTransforms[i]);
+    }
+    for (const MorphWeights& morph : morphWeights) {
+        morpher->applyWeights(morph.targetEntity, weights.data() + morph.offset, morph.count);
+    }
+}
+
+void AnimatorImpl::evaluate(const Channel& channel, float t, size_t prevIndex,
         size_t nextIndex) {
     const Sampler* sampler = channel.sourceData;
     const TimeValues& times = sampler->times;
-    TransformManager::Instance node = transformManager->getInstance(channel.targetEntity);
 
-    // Perform the interpolation. This is a simple but inefficient implementation; Filament
-    // stores transforms as mat4's but glTF animation is based on TRS (translation rotation
-    // scale).
-    mat4f xform = transformManager->getTransform(node);
-    float3 scale;
-    quatf rotation;
-    float3 translation;
-    decomposeMatrix(xform, &translation, &rotation, &scale);
+    if (channel.transformType == Channel::WEIGHTS) {
+        assert(sampler->getValueCount() % times.size() == 0);
+        const size_t valuesPerKeyframe = sampler->getValueCount() / times.size();
+        const size_t offset = weights.size();
+
+        if (sampler->interpolation == Sampler::CUBIC) {
+            assert(valuesPerKeyframe % 3 == 0);
+            const size_t numMorphTargets = valuesPerKeyframe / 3;
+            const size_t inTangents = 0;
+            const size_t splineVerts = numMorphTargets;
+            const size_t outTangents = numMorphTargets * 2;
+
+            weights.resize(offset + numMorphTargets);
+            for (size_t comp = 0; comp < numMorphTargets; ++comp) {
+                float vert0 = sampler->getFloat(splineVerts + comp + prevIndex * valuesPerKeyframe);
+                float tang0 = sampler->getFloat(outTangents + comp + prevIndex * valuesPerKeyframe);
+                float tang1 = sampler->getFloat(inTangents + comp + nextIndex * valuesPerKeyframe);
+                float vert1 = sampler->getFloat(splineVerts + comp + nextIndex * valuesPerKeyframe);
+                weights[offset + comp] = cubicSpline(vert0, tang0, vert1, tang1, t);
+            }
+        } else {
+            weights.resize(offset + valuesPerKeyframe);
+            for (size_t comp = 0; comp < valuesPerKeyframe; ++comp) {
+                float previous = sampler->getFloat(comp + prevIndex * valuesPerKeyframe);
+                float current = sampler->getFloat(comp + nextIndex * valuesPerKeyframe);
+                weights[offset + comp] = (1 - t) * previous + t * current;
+            }
+        }
 
-    switch (channel.transformType) {
+        morphWeights.push_back({ channel.targetEntity, offset, weights.size() - offset });
+        return;
+    }
 
+    // Perform the interpolation. Filament stores transforms as mat4's but glTF animation is based
+    // on TRS (translation rotation scale), so the transform of each node is decomposed once, when
+    // its first channel is evaluated.
+    auto [iter, inserted] = nodeIndices.emplace(channel.targetEntity, nodeTransforms.size());
+    if (inserted) {
+        TransformManager::Instance node = transformManager->getInstance(channel.targetEntity);
+        NodeTransform trs{ node };
+        decomposeMatrix(transformManager->getTransform(node),
+                &trs.translation, &trs.rotation, &trs.scale);
+        nodeTransforms.push_back(trs);
+    }
+    NodeTransform& trs = nodeTransforms[iter->second];
+    float3& scale = trs.scale;
+    quatf& rotation = trs.rotation;
+    float3& translation = trs.translation;
+
+    switch (channel.transformType) {
         case Channel::SCALE: {
-            const float3* srcVec3 = (const float3*) sampler->values.data();
             if (sampler->interpolation == Sampler::CUBIC) {
-                float3 vert0 = srcVec3[prevIndex * 3 + 1];
-                float3 tang0 = srcVec3[prevIndex * 3 + 2];
-                float3 tang1 = srcVec3[nextIndex * 3];
-                float3 vert1 = srcVec3[nextIndex * 3 + 1];
+                float3 vert0 = sampler->getFloat3(prevIndex * 3 + 1);
+                float3 tang0 = sampler->getFloat3(prevIndex * 3 + 2);
+                float3 tang1 = sampler->getFloat3(nextIndex * 3);
+                float3 vert1 = sampler->getFloat3(nextIndex * 3 + 1);
                 scale = cubicSpline(vert0, tang0, vert1, tang1, t);
             } else {
-                scale = ((1 - t) * srcVec3[prevIndex]) + (t * srcVec3[nextIndex]);
+                scale = ((1 - t) * sampler->getFloat3(prevIndex)) +
+                        (t * sampler->getFloat3(nextIndex));
             }
             break;
         }
 
         case Channel::TRANSLATION: {
-            const float3* srcVec3 = (const float3*) sampler->values.data();
             if (sampler->interpolation == Sampler::CUBIC) {
-                float3 vert0 = srcVec3[prevIndex * 3 + 1];
-                float3 tang0 = srcVec3[prevIndex * 3 + 2];
-                float3 tang1 = srcVec3[nextIndex * 3];
-                float3 vert1 = srcVec3[nextIndex * 3 + 1];
+                float3 vert0 = sampler->getFloat3(prevIndex * 3 + 1);
+                float3 tang0 = sampler->getFloat3(prevIndex * 3 + 2);
+                float3 tang1 = sampler->getFloat3(nextIndex * 3);
+                float3 vert1 = sampler->getFloat3(nextIndex * 3 + 1);
                 translation = cubicSpline(vert0, tang0, vert1, tang1, t);
             } else {
-                translation = ((1 - t) * srcVec3[prevIndex]) + (t * srcVec3[nextIndex]);
+                translation = ((1 - t) * sampler->getFloat3(prevIndex)) +
+                        (t * sampler->getFloat3(nextIndex));
             }
             break;
         }
 
         case Channel::ROTATION: {
-            const quatf* srcQuat = (const quatf*) sampler->values.data();
             if (sampler->interpolation == Sampler::CUBIC) {
-                quatf vert0 = srcQuat[prevIndex * 3 + 1];
-                quatf tang0 = srcQuat[prevIndex * 3 + 2];
-                quatf tang1 = srcQuat[nextIndex * 3];
-                quatf vert1 = srcQuat[nextIndex * 3 + 1];
+                quatf vert0 = sampler->getQuat(prevIndex * 3 + 1);
+                quatf tang0 = sampler->getQuat(prevIndex * 3 + 2);
+                quatf tang1 = sampler->getQuat(nextIndex * 3);
+                quatf vert1 = sampler->getQuat(nextIndex * 3 + 1);
                 rotation = normalize(cubicSpline(vert0, tang0, vert1, tang1, t));
             } else {
-                rotation = slerp(srcQuat[prevIndex], srcQuat[nextIndex], t);
+                rotation = slerp(sampler->getQuat(prevIndex), sampler->getQuat(nextIndex), t);
+                if (!sampler->quantized.empty()) {
+                    rotation = normalize(rotation);
+                }
             }
             break;
         }
 
-        case Channel::WEIGHTS: {
-            const float* const samplerValues = sampler->values.data();
-            assert(sampler->values.size() % times.size() == 0);
-            const int valuesPerKeyframe = sampler->values.size() / times.size();
-
-            if (sampler->interpolation == Sampler::CUBIC) {
-                assert(valuesPerKeyframe % 3 == 0);
-                const int numMorphTargets = valuesPerKeyframe / 3;
-                const float* const inTangents = samplerValues;
-                const float* const splineVerts = samplerValues + numMorphTargets;
-                const float* const outTangents = samplerValues + numMorphTargets * 2;
-
-                weights.resize(numMorphTargets);
-                for (int comp = 0; comp < numMorphTargets; ++comp) {
-                    float vert0 = splineVerts[comp + prevIndex * valuesPerKeyframe];
-                    float tang0 = outTangents[comp + prevIndex * valuesPerKeyframe];
-                    float tang1 = inTangents[comp + nextIndex * valuesPerKeyframe];
-                    float vert1 = splineVerts[comp + nextIndex * valuesPerKeyframe];
-                    weights[comp] = cubicSpline(vert0, tang0, vert1, tang1, t);
-                }
-            } else {
-                weights.resize(valuesPerKeyframe);
-                for (int comp = 0; comp < valuesPerKeyframe; ++comp) {
-                    float previous = samplerValues[comp + prevIndex * valuesPerKeyframe];
-                    float current = samplerValues[comp + nextIndex * valuesPerKeyframe];
-                    weights[comp] = (1 - t) * previous + t * current;
-                }
-            }
-
-            morpher->applyWeights(channel.targetEntity, weights.data(), weights.size());
-            return;
-        }
+        case Channel::WEIGHTS:
+            break;
     }
-
-    xform = composeMatrix(translation, rotation, scale);
-    transformManager->setTransform(node, xform);
 }
 
 } // namespace gltfio
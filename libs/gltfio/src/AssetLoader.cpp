@@ -46,6 +46,8 @@
 
 #include <tsl/robin_map.h>
 
+#include <algorithm>
+#include <string>
 #include <vector>
 
 #define CGLTF_IMPLEMENTATION
@@ -61,6 +63,7 @@ using namespace utils;
 namespace gltfio {
 
 void importSkins(const cgltf_data* gltf, const NodeMap& nodeMap, SkinVector& dstSkins);
+void applyMeshInstances(TransformManager& tm, const MeshInstances& instances);
 
 static const auto FREE_CALLBACK = [](void* mem, size_t, void*) { free(mem); };
 
@@ -87,6 +90,63 @@ static const char* getNodeName(const cgltf_node* node, const char* defaultNodeNa
     return defaultNodeName;
 }
 
+// cgltf does not know EXT_mesh_gpu_instancing, so it keeps the extension as a JSON string. This
+// finds the accessor of an attribute in its dictionary, e.g. {"attributes":{"TRANSLATION":3}}.
+static const cgltf_accessor* getInstancingAccessor(const cgltf_data* gltf, const char* json,
+        const char* attribute) {
+    const char* p = strstr(json, attribute);
+    if (!p) {
+        return nullptr;
+    }
+    p += strlen(attribute);
+    while (*p == ':' || isspace(*p)) {
+        p++;
+    }
+    char* end;
+    const long index = strtol(p, &end, 10);
+    if (end == p || index < 0 || cgltf_size(index) >= gltf->accessors_count) {
+        return nullptr;
+    }
+    return &gltf->accessors[index];
+}
+
+// Returns the number of instances of a node with EXT_mesh_gpu_instancing, or 0 if the node doesn't
+// use the extension or if its data is unusable.
+static size_t getMeshInstances(const cgltf_data* gltf, const cgltf_node* node,
+        MeshInstances* instances) {
+    const char* json = nullptr;
+    for (cgltf_size i = 0; i < node->extensions_count; ++i) {
+        if (!strcmp(node->extensions[i].name, "EXT_mesh_gpu_instancing")) {
+            json = node->extensions[i].data;
+        }
+    }
+    if (!json) {
+        return 0;
+    }
+    instances->translation = getInstancingAccessor(gltf, json, "\"TRANSLATION\"");
+    instances->rotation = getInstancingAccessor(gltf, json, "\"ROTATION\"");
+    instances->scale = getInstancingAccessor(gltf, json, "\"SCALE\"");
+    const cgltf_accessor* t = instances->translation;
+    const cgltf_accessor* r = instances->rotation;
+    const cgltf_accessor* s = instances->scale;
+    if ((t && t->type != cgltf_type_vec3) || (r && r->type != cgltf_type_vec4) ||
+            (s && s->type != cgltf_type_vec3)) {
+        slog.w << "Unexpected EXT_mesh_gpu_instancing accessor types." << io::endl;
+        return 0;
+    }
+    size_t count = 0;
+    for (const cgltf_accessor* accessor : { t, r, s }) {
+        if (accessor) {
+            if (count && accessor->count != count) {
+                slog.w << "Mismatched EXT_mesh_gpu_instancing accessors." << io::endl;
+                return 0;
+            }
+            count = accessor->count;
+        }
+    }
+    return count;
+}
+
 struct FAssetLoader : public AssetLoader {
     FAssetLoader(const AssetConfiguration& config) :
             mEntityManager(config.entities ? *config.entities : EntityManager::get()),
@@ -95,7 +155,12 @@ struct FAssetLoader : public AssetLoader {
             mTransformManager(config.engine->getTransformManager()),
             mMaterials(config.materials),
             mEngine(config.engine),
-            mDefaultNodeName(config.defaultNodeName) {}
+            mDefaultNodeName(config.defaultNodeName),
+            mLevelsOfDetail(std::clamp(size_t(config.levelsOfDetail), size_t(1),
+                    MAX_LEVELS_OF_DETAIL)),
+            mCompactGeometry(config.compactGeometry),
+            mCompressAnimations(config.compressAnimations),
+            mShareMaterialInstances(config.shareMaterialInstances) {}
 
     FFilamentAsset* createAssetFromJson(const uint8_t* bytes, uint32_t nbytes);
     FFilamentAsset* createAssetFromBinary(const uint8_t* bytes, uint32_t nbytes);
@@ -111,7 +176,12 @@ struct FAssetLoader : public AssetLoader {
     }
 
     void destroyAsset(const FFilamentAsset* asset) {
+        // The shared material instances are released after the renderables that use them.
+        std::vector<MaterialInstance*> shared = asset->mSharedMaterialInstances;
         delete asset;
+        for (MaterialInstance* mi : shared) {
+            releaseSharedMaterialInstance(mi);
+        }
     }
 
     size_t getMaterialsCount() const noexcept {
@@ -137,9 +207,16 @@ struct FAssetLoader : public AssetLoader {
     void createCamera(const cgltf_camera* camera, Entity entity);
     MaterialInstance* createMaterialInstance(const cgltf_material* inputMat, UvMap* uvmap,
             bool vertexColor);
+    MaterialInstance* findSharedMaterialInstance(const std::string& signature, bool crossAsset,
+            UvMap* uvmap);
+    void addSharedMaterialInstance(const std::string& signature, bool crossAsset,
+            MaterialInstance* mi, const UvMap& uvmap);
+    void releaseSharedMaterialInstance(MaterialInstance* mi);
     void addTextureBinding(MaterialInstance* materialInstance, const char* parameterName,
             const cgltf_texture* srcTexture, bool srgb);
     bool primitiveHasVertexColor(const cgltf_primitive* inPrim) const;
+    bool isSharedAttribute(const cgltf_primitive* prim, const cgltf_attribute& attribute) const;
+    void createSharedBuffers(const cgltf_data* srcAsset);
 
     static LightManager::Type getLightType(const cgltf_light_type type);
 
@@ -153,8 +230,21 @@ struct FAssetLoader : public AssetLoader {
     // Transient state used only for the asset currently being loaded:
     FFilamentAsset* mResult;
     const char* mDefaultNodeName;
+    const size_t mLevelsOfDetail;
+    const bool mCompactGeometry;
+    const bool mCompressAnimations;
+    const bool mShareMaterialInstances;
     bool mError = false;
     bool mDiagnosticsEnabled = false;
+
+    // Material instances shared across assets, see AssetConfiguration::shareMaterialInstances.
+    struct SharedMaterialInstance {
+        MaterialInstance* instance;
+        UvMap uvmap;
+        uint32_t refCount;
+    };
+    tsl::robin_map<std::string, SharedMaterialInstance> mSharedMaterialInstances;
+    tsl::robin_map<const MaterialInstance*, std::string> mSharedMaterialSignatures;
 };
 
 FILAMENT_UPCAST(AssetLoader)
@@ -238,8 +328,17 @@ FilamentInstance* FAssetLoader::createInstance(FFilamentAsset* primary) {
         slog.e << "There is no scene in the asset." << io::endl;
         return nullptr;
     }
+    const size_t firstMeshInstances = primary->mMeshInstances.size();
     FFilamentInstance* instance = createInstance(primary, scene);
 
+    // Position the instances of EXT_mesh_gpu_instancing nodes, if ResourceLoader has already
+    // loaded their data.
+    if (primary->mResourcesLoaded) {
+        for (size_t i = firstMeshInstances; i < primary->mMeshInstances.size(); ++i) {
+            applyMeshInstances(mTransformManager, primary->mMeshInstances[i]);
+        }
+    }
+
     // Import the skin data. This is normally done by ResourceLoader but dynamically created
     // instances are a bit special.
     importSkins(primary->mSourceAsset->hierarchy, instance->nodeMap, instance->skins);
@@ -264,6 +363,9 @@ void FAssetLoader::createAsset(const cgltf_data* srcAsset, size_t numInstances)
     #endif
 
     mResult = new FFilamentAsset(mEngine, mNameManager, &mEntityManager, srcAsset);
+    mResult->mLevelsOfDetail = uint8_t(mLevelsOfDetail);
+    mResult->mCompressAnimations = mCompressAnimations;
+    createSharedBuffers(srcAsset);
 
     // If there is no default scene specified, then the default is the first one.
     // It is not an error for a glTF file to have zero scenes.
@@ -381,9 +483,36 @@ void FAssetLoader::createEntity(const cgltf_node* node, Entity parent, bool enab
     // If no name is provided in the glTF or AssetConfiguration, use "node" for error messages.
     name = name ? name : "node";
 
-    // If the node has a mesh, then create a renderable component.
+    // If the node has a mesh, then create a renderable component. Nodes that use
+    // EXT_mesh_gpu_instancing instead get a child renderable for each instance, which all share
+    // the same primitives and material instances.
     if (node->mesh) {
-        createRenderable(node, entity, name);
+        MeshInstances meshInstances = {};
+        size_t numInstances = getMeshInstances(mResult->mSourceAsset->hierarchy, node,
+                &meshInstances);
+        const bool morphing = node->mesh->primitives_count > 0 &&
+                node->mesh->primitives[0].targets_count > 0;
+        if (numInstances > 0 && (node->skin || morphing)) {
+            slog.w << "EXT_mesh_gpu_instancing is not supported with skinning or morphing ("
+                    << name << ")." << io::endl;
+            numInstances = 0;
+        }
+        if (numInstances == 0) {
+            createRenderable(node, entity, name);
+        } else {
+            meshInstances.node = entity;
+            meshInstances.entities.resize(numInstances);
+            for (Entity& child : meshInstances.entities) {
+                child = mEntityManager.create();
+                mTransformManager.create(child, mTransformManager.getInstance(entity));
+                mResult->mEntities.push_back(child);
+                if (instance) {
+                    instance->entities.push_back(child);
+                }
+                createRenderable(node, child, name);
+            }
+            mResult->mMeshInstances.push_back(std::move(meshInstances));
+        }
     }
 
     if (node->light && enableLight) {
@@ -465,6 +594,23 @@ void FAssetLoader::createRenderable(const cgltf_node* node, Entity entity, const
         // facilities for these parameters, which is not a huge loss since some of the buffer
         // view and accessor features already have this functionality.
         builder.geometry(index, primType, outputPrim->vertices, outputPrim->indices);
+        mResult->mDependencyGraph.addEdge(entity, outputPrim->vertices);
+
+        // Use the coarser levels of detail if ResourceLoader has already generated them, which
+        // is the case for instances created after loading the resources.
+        auto lod = mResult->mLodGeometry.find(outputPrim->indices);
+        if (lod != mResult->mLodGeometry.end()) {
+            const LodGeometry& geometry = lod->second;
+            for (size_t level = 1; level < mResult->mLevelsOfDetail; ++level) {
+                builder.geometryLod(index, level, geometry.indices,
+                        geometry.offsets[level - 1], geometry.counts[level - 1]);
+            }
+        }
+    }
+
+    // The coarser levels of detail start as copies of the first one, see ResourceLoader.
+    if (mResult->mLevelsOfDetail > 1) {
+        builder.levelsOfDetail(mResult->mLevelsOfDetail);
     }
 
     if (numMorphTargets > 0) {
@@ -513,6 +659,107 @@ void FAssetLoader::createRenderable(const cgltf_node* node, Entity entity, const
     }
 }
 
+// The bounds of an accessor are expressed in its component type, so the bounds of normalized
+// integer positions (as allowed by KHR_mesh_quantization) are mapped to the range of their data.
+static float3 getPositionBound(const cgltf_accessor* accessor, const cgltf_float* bound) {
+    float3 value(bound[0], bound[1], bound[2]);
+    if (!accessor->normalized) {
+        return value;
+    }
+    switch (accessor->component_type) {
+        case cgltf_component_type_r_8:
+            return max(value / 127.0f, float3(-1.0f));
+        case cgltf_component_type_r_8u:
+            return value / 255.0f;
+        case cgltf_component_type_r_16:
+            return max(value / 32767.0f, float3(-1.0f));
+        case cgltf_component_type_r_16u:
+            return value / 65535.0f;
+        default:
+            return value;
+    }
+}
+
+// Texture coordinates can be quantized to normalized shorts when their accessor bounds allow it.
+static SlotConversion getTexCoordConversion(const cgltf_accessor* accessor) {
+    if (accessor->type != cgltf_type_vec2 || accessor->component_type != cgltf_component_type_r_32f
+            || accessor->is_sparse || !accessor->has_min || !accessor->has_max) {
+        return SlotConversion::NONE;
+    }
+    const float lo = std::min(accessor->min[0], accessor->min[1]);
+    const float hi = std::max(accessor->max[0], accessor->max[1]);
+    if (lo >= 0.0f && hi <= 1.0f) {
+        return SlotConversion::QUANTIZE_UNSIGNED;
+    }
+    if (lo >= -1.0f && hi <= 1.0f) {
+        return SlotConversion::QUANTIZE_SIGNED;
+    }
+    return SlotConversion::NONE;
+}
+
+// Attributes are shared when their data is uploaded as it is: normals and tangents are replaced by
+// generated quaternions, while Draco, sparse and quantized attributes are converted beforehand.
+bool FAssetLoader::isSharedAttribute(const cgltf_primitive* prim,
+        const cgltf_attribute& attribute) const {
+    const cgltf_accessor* accessor = attribute.data;
+    if (prim->has_draco_mesh_compression || !accessor->buffer_view || accessor->is_sparse) {
+        return false;
+    }
+    switch (attribute.type) {
+        case cgltf_attribute_type_normal:
+        case cgltf_attribute_type_tangent:
+            return false;
+        case cgltf_attribute_type_texcoord:
+            return !mCompactGeometry || getTexCoordConversion(accessor) == SlotConversion::NONE;
+        default:
+            return true;
+    }
+}
+
+// Creates the BufferObject of each glTF buffer used by shared attributes, sized to the range they
+// span. Attributes of every mesh are considered, which may include a few unused ones.
+void FAssetLoader::createSharedBuffers(const cgltf_data* srcAsset) {
+    struct Range { uint32_t begin = std::numeric_limits<uint32_t>::max(); uint32_t end = 0; };
+    tsl::robin_map<const cgltf_buffer*, Range> ranges;
+    auto addRange = [&ranges](const cgltf_accessor* accessor) {
+        Range& range = ranges[accessor->buffer_view->buffer];
+        const uint32_t offset = computeBindingOffset(accessor);
+        range.begin = std::min(range.begin, offset);
+        range.end = std::max(range.end, offset + computeBindingSize(accessor));
+    };
+    for (cgltf_size i = 0; i < srcAsset->meshes_count; ++i) {
+        const cgltf_mesh& mesh = srcAsset->meshes[i];
+        for (cgltf_size j = 0; j < mesh.primitives_count; ++j) {
+            const cgltf_primitive& prim = mesh.primitives[j];
+            for (cgltf_size k = 0; k < prim.attributes_count; ++k) {
+                if (isSharedAttribute(&prim, prim.attributes[k])) {
+                    addRange(prim.attributes[k].data);
+                }
+            }
+            for (cgltf_size t = 0; t < std::min(MAX_MORPH_TARGETS, prim.targets_count); ++t) {
+                const cgltf_morph_target& target = prim.targets[t];
+                for (cgltf_size k = 0; k < target.attributes_count; ++k) {
+                    if (target.attributes[k].type == cgltf_attribute_type_position &&
+                            isSharedAttribute(&prim, target.attributes[k])) {
+                        addRange(target.attributes[k].data);
+                    }
+                }
+            }
+        }
+    }
+
+    // glTF aligns vertex attributes to 4 bytes within their buffer, so the range starts on a 4-byte
+    // boundary to preserve the alignment of the offsets into it.
+    for (const auto& pair : ranges) {
+        SharedBuffer shared;
+        shared.offset = pair.second.begin & ~3u;
+        shared.size = pair.second.end - shared.offset;
+        shared.bufferObject = BufferObject::Builder().size(shared.size).build(*mEngine);
+        mResult->mBufferObjects.push_back(shared.bufferObject);
+        mResult->mSharedBuffers[pair.first] = shared;
+    }
+}
+
 bool FAssetLoader::createPrimitive(const cgltf_primitive* inPrim, Primitive* outPrim,
         const UvMap& uvmap, const char* name) {
     outPrim->uvmap = uvmap;
@@ -523,6 +770,13 @@ bool FAssetLoader::createPrimitive(const cgltf_primitive* inPrim, Primitive* out
         slots->push_back(entry);
     };
 
+    // Shared attributes are bound at their offset into the BufferObject of their glTF buffer.
+    const SharedBufferMap& sharedBuffers = mResult->mSharedBuffers;
+    auto getSharedOffset = [&sharedBuffers](const cgltf_accessor* accessor) {
+        const SharedBuffer& shared = sharedBuffers.at(accessor->buffer_view->buffer);
+        return computeBindingOffset(accessor) - shared.offset;
+    };
+
     // In glTF, each primitive may or may not have an index buffer.
     IndexBuffer* indices = nullptr;
     const cgltf_accessor* accessor = inPrim->indices;
@@ -533,30 +787,53 @@ bool FAssetLoader::createPrimitive(const cgltf_primitive* inPrim, Primitive* out
             return false;
         }
 
+        // Every index is smaller than the vertex count, so 16 bits suffice for small primitives.
+        BufferSlot slot = { accessor };
+        if (mCompactGeometry && indexType == IndexBuffer::IndexType::UINT &&
+                inPrim->attributes_count > 0 && inPrim->attributes[0].data->count <= 65536 &&
+                !accessor->is_sparse) {
+            indexType = IndexBuffer::IndexType::USHORT;
+            slot.conversion = SlotConversion::NARROW_INDICES;
+        }
+
         indices = IndexBuffer::Builder()
             .indexCount(accessor->count)
             .bufferType(indexType)
             .build(*mEngine);
 
-        BufferSlot slot = { accessor };
         slot.indexBuffer = indices;
         addBufferSlot(slot);
     } else if (inPrim->attributes_count > 0) {
         // If a primitive does not have an index buffer, generate a trivial one now.
         const uint32_t vertexCount = inPrim->attributes[0].data->count;
 
-        indices = IndexBuffer::Builder()
-            .indexCount(vertexCount)
-            .bufferType(IndexBuffer::IndexType::UINT)
-            .build(*mEngine);
+        if (mCompactGeometry && vertexCount <= 65536) {
+            indices = IndexBuffer::Builder()
+                .indexCount(vertexCount)
+                .bufferType(IndexBuffer::IndexType::USHORT)
+                .build(*mEngine);
 
-        const size_t indexDataSize = vertexCount * sizeof(uint32_t);
-        uint32_t* indexData = (uint32_t*) malloc(indexDataSize);
-        for (size_t i = 0; i < vertexCount; ++i) {
-            indexData[i] = i;
+            const size_t indexDataSize = vertexCount * sizeof(uint16_t);
+            uint16_t* indexData = (uint16_t*) malloc(indexDataSize);
+            for (size_t i = 0; i < vertexCount; ++i) {
+                indexData[i] = uint16_t(i);
+            }
+            IndexBuffer::BufferDescriptor bd(indexData, indexDataSize, FREE_CALLBACK);
+            indices->setBuffer(*mEngine, std::move(bd));
+        } else {
+            indices = IndexBuffer::Builder()
+                .indexCount(vertexCount)
+                .bufferType(IndexBuffer::IndexType::UINT)
+                .build(*mEngine);
+
+            const size_t indexDataSize = vertexCount * sizeof(uint32_t);
+            uint32_t* indexData = (uint32_t*) malloc(indexDataSize);
+            for (size_t i = 0; i < vertexCount; ++i) {
+                indexData[i] = i;
+            }
+            IndexBuffer::BufferDescriptor bd(indexData, indexDataSize, FREE_CALLBACK);
+            indices->setBuffer(*mEngine, std::move(bd));
         }
-        IndexBuffer::BufferDescriptor bd(indexData, indexDataSize, FREE_CALLBACK);
-        indices->setBuffer(*mEngine, std::move(bd));
     }
     mResult->mIndexBuffers.push_back(indices);
 
@@ -637,14 +914,23 @@ bool FAssetLoader::createPrimitive(const cgltf_primitive* inPrim, Primitive* out
         // The positions accessor is required to have min/max properties, use them to expand
         // the bounding box for this primitive.
         if (atype == cgltf_attribute_type_position) {
-            const float* minp = &accessor->min[0];
-            const float* maxp = &accessor->max[0];
-            outPrim->aabb.min = min(outPrim->aabb.min, float3(minp[0], minp[1], minp[2]));
-            outPrim->aabb.max = max(outPrim->aabb.max, float3(maxp[0], maxp[1], maxp[2]));
+            outPrim->aabb.min = min(outPrim->aabb.min, getPositionBound(accessor, accessor->min));
+            outPrim->aabb.max = max(outPrim->aabb.max, getPositionBound(accessor, accessor->max));
+        }
+
+        if (mCompactGeometry && atype == cgltf_attribute_type_texcoord) {
+            const SlotConversion conversion = getTexCoordConversion(accessor);
+            if (conversion != SlotConversion::NONE) {
+                vbb.attribute(semantic, slot, conversion == SlotConversion::QUANTIZE_UNSIGNED ?
+                        VertexBuffer::AttributeType::USHORT2 : VertexBuffer::AttributeType::SHORT2);
+                vbb.normalized(semantic);
+                addBufferSlot({accessor, atype, slot++, 0, nullptr, nullptr, conversion});
+                continue;
+            }
         }
 
         VertexBuffer::AttributeType fatype;
-        if (!getElementType(accessor->type, accessor->component_type, &fatype)) {
+        if (!getAttributeType(accessor, &fatype)) {
             slog.e << "Unsupported accessor type in " << name << io::endl;
             return false;
         }
@@ -652,9 +938,12 @@ bool FAssetLoader::createPrimitive(const cgltf_primitive* inPrim, Primitive* out
         // The cgltf library provides a stride value for all accessors, even though they do not
         // exist in the glTF file. It is computed from the type and the stride of the buffer view.
         // As a convenience, cgltf also replaces zero (default) stride with the actual stride.
-        vbb.attribute(semantic, slot, fatype, 0, accessor->stride);
-        vbb.normalized(semantic, accessor->normalized);
-        addBufferSlot({accessor, atype, slot++});
+        // Sparse accessors are uploaded as tightly packed floats by ResourceLoader.
+        const bool shared = isSharedAttribute(inPrim, attribute);
+        vbb.attribute(semantic, slot, fatype, shared ? getSharedOffset(accessor) : 0,
+                accessor->is_sparse ? 0 : accessor->stride);
+        vbb.normalized(semantic, accessor->normalized && !accessor->is_sparse);
+        addBufferSlot({accessor, atype, slot++, 0, nullptr, nullptr, SlotConversion::NONE, shared});
     }
 
     // If the model is lit but does not have normals, we'll need to generate flat normals.
@@ -703,21 +992,22 @@ bool FAssetLoader::createPrimitive(const cgltf_primitive* inPrim, Primitive* out
                 return false;
             }
 
-            const float* minp = &accessor->min[0];
-            const float* maxp = &accessor->max[0];
-            outPrim->aabb.min = min(outPrim->aabb.min, float3(minp[0], minp[1], minp[2]));
-            outPrim->aabb.max = max(outPrim->aabb.max, float3(maxp[0], maxp[1], maxp[2]));
+            outPrim->aabb.min = min(outPrim->aabb.min, getPositionBound(accessor, accessor->min));
+            outPrim->aabb.max = max(outPrim->aabb.max, getPositionBound(accessor, accessor->max));
 
             VertexBuffer::AttributeType fatype;
-            if (!getElementType(accessor->type, accessor->component_type, &fatype)) {
+            if (!getAttributeType(accessor, &fatype)) {
                 slog.e << "Unsupported accessor type in " << name << io::endl;
                 return false;
             }
 
             VertexAttribute attr = (VertexAttribute) (basePositionAttr + targetIndex);
-            vbb.attribute(attr, slot, fatype, 0, accessor->stride);
-            vbb.normalized(attr, accessor->normalized);
-            addBufferSlot({accessor, atype, slot++, morphId});
+            const bool shared = isSharedAttribute(inPrim, attribute);
+            vbb.attribute(attr, slot, fatype, shared ? getSharedOffset(accessor) : 0,
+                    accessor->is_sparse ? 0 : accessor->stride);
+            vbb.normalized(attr, accessor->normalized && !accessor->is_sparse);
+            addBufferSlot({accessor, atype, slot++, morphId, nullptr, nullptr,
+                    SlotConversion::NONE, shared});
         }
     }
 
@@ -865,6 +1155,115 @@ void FAssetLoader::createCamera(const cgltf_camera* camera, Entity entity) {
     mResult->mCameraEntities.push_back(entity);
 }
 
+template<typename T>
+static void appendSignature(std::string* signature, const T& value) {
+    signature->append((const char*) &value, sizeof(T));
+}
+
+static void appendSignature(std::string* signature, const cgltf_texture_view& view) {
+    appendSignature(signature, view.texture);
+    appendSignature(signature, view.texcoord);
+    appendSignature(signature, view.scale);
+    appendSignature(signature, view.has_transform);
+    appendSignature(signature, view.transform.offset);
+    appendSignature(signature, view.transform.rotation);
+    appendSignature(signature, view.transform.scale);
+}
+
+// Computes a signature of everything createMaterialInstance reads from the glTF material, such that
+// two materials with the same signature produce identical material instances. Returns false if the
+// material has textures, in which case the signature is only meaningful within its asset.
+static bool getMaterialSignature(const cgltf_material* mat, bool vertexColor, bool diagnostics,
+        std::string* signature) {
+    const auto& mr = mat->pbr_metallic_roughness;
+    const auto& sg = mat->pbr_specular_glossiness;
+    const auto& cc = mat->clearcoat;
+    const auto& tr = mat->transmission;
+    const auto& sh = mat->sheen;
+    const cgltf_texture_view* views[] = {
+        &mr.base_color_texture, &mr.metallic_roughness_texture,
+        &sg.diffuse_texture, &sg.specular_glossiness_texture,
+        &mat->normal_texture, &mat->occlusion_texture, &mat->emissive_texture,
+        &cc.clearcoat_texture, &cc.clearcoat_roughness_texture, &cc.clearcoat_normal_texture,
+        &tr.transmission_texture, &sh.sheen_color_texture, &sh.sheen_roughness_texture,
+    };
+
+    signature->clear();
+    appendSignature(signature, vertexColor);
+    appendSignature(signature, diagnostics);
+    appendSignature(signature, mat->has_pbr_specular_glossiness);
+    appendSignature(signature, mat->has_clearcoat);
+    appendSignature(signature, mat->has_transmission);
+    appendSignature(signature, mat->has_sheen);
+    appendSignature(signature, mat->double_sided);
+    appendSignature(signature, mat->unlit);
+    appendSignature(signature, mat->alpha_mode);
+    appendSignature(signature, mat->alpha_cutoff);
+    appendSignature(signature, mat->emissive_factor);
+    appendSignature(signature, mr.base_color_factor);
+    appendSignature(signature, mr.metallic_factor);
+    appendSignature(signature, mr.roughness_factor);
+    appendSignature(signature, sg.diffuse_factor);
+    appendSignature(signature, sg.specular_factor);
+    appendSignature(signature, sg.glossiness_factor);
+    appendSignature(signature, cc.clearcoat_factor);
+    appendSignature(signature, cc.clearcoat_roughness_factor);
+    appendSignature(signature, tr.transmission_factor);
+    appendSignature(signature, sh.sheen_color_factor);
+    appendSignature(signature, sh.sheen_roughness_factor);
+
+    bool hasTextures = false;
+    for (const cgltf_texture_view* view : views) {
+        appendSignature(signature, *view);
+        hasTextures = hasTextures || view->texture;
+    }
+    return !hasTextures;
+}
+
+MaterialInstance* FAssetLoader::findSharedMaterialInstance(const std::string& signature,
+        bool crossAsset, UvMap* uvmap) {
+    auto local = mResult->mMatSignatureCache.find(signature);
+    if (local != mResult->mMatSignatureCache.end()) {
+        *uvmap = local->second.uvmap;
+        return local->second.instance;
+    }
+    if (!crossAsset) {
+        return nullptr;
+    }
+    auto shared = mSharedMaterialInstances.find(signature);
+    if (shared == mSharedMaterialInstances.end()) {
+        return nullptr;
+    }
+    shared.value().refCount++;
+    MaterialInstance* mi = shared->second.instance;
+    *uvmap = shared->second.uvmap;
+    mResult->mMaterialInstances.push_back(mi);
+    mResult->mSharedMaterialInstances.push_back(mi);
+    mResult->mMatSignatureCache[signature] = {mi, *uvmap};
+    return mi;
+}
+
+void FAssetLoader::addSharedMaterialInstance(const std::string& signature, bool crossAsset,
+        MaterialInstance* mi, const UvMap& uvmap) {
+    mResult->mMatSignatureCache[signature] = {mi, uvmap};
+    if (crossAsset) {
+        mSharedMaterialInstances[signature] = {mi, uvmap, 1};
+        mSharedMaterialSignatures[mi] = signature;
+        mResult->mSharedMaterialInstances.push_back(mi);
+    }
+}
+
+void FAssetLoader::releaseSharedMaterialInstance(MaterialInstance* mi) {
+    auto pos = mSharedMaterialSignatures.find(mi);
+    assert_invariant(pos != mSharedMaterialSignatures.end());
+    auto shared = mSharedMaterialInstances.find(pos->second);
+    if (--shared.value().refCount == 0) {
+        mSharedMaterialInstances.erase(shared);
+        mSharedMaterialSignatures.erase(pos);
+        mEngine->destroy(mi);
+    }
+}
+
 MaterialInstance* FAssetLoader::createMaterialInstance(const cgltf_material* inputMat,
         UvMap* uvmap, bool vertexColor) {
     intptr_t key = ((intptr_t) inputMat) ^ (vertexColor ? 1 : 0);
@@ -892,6 +1291,17 @@ MaterialInstance* FAssetLoader::createMaterialInstance(const cgltf_material* inp
     };
     inputMat = inputMat ? inputMat : &kDefaultMat;
 
+    std::string signature;
+    bool crossAsset = false;
+    if (mShareMaterialInstances) {
+        crossAsset = getMaterialSignature(inputMat, vertexColor, mDiagnosticsEnabled, &signature);
+        MaterialInstance* mi = findSharedMaterialInstance(signature, crossAsset, uvmap);
+        if (mi) {
+            mResult->mMatInstanceCache[key] = {mi, *uvmap};
+            return mi;
+        }
+    }
+
     auto mrConfig = inputMat->pbr_metallic_roughness;
     auto sgConfig = inputMat->pbr_specular_glossiness;
     auto ccConfig = inputMat->clearcoat;
@@ -1131,6 +1541,9 @@ MaterialInstance* FAssetLoader::createMaterialInstance(const cgltf_material* inp
     }
 
     mResult->mMatInstanceCache[key] = {mi, *uvmap};
+    if (mShareMaterialInstances) {
+        addSharedMaterialInstance(signature, crossAsset, mi, *uvmap);
+    }
     return mi;
 }
 
@@ -49,6 +49,27 @@ void DependencyGraph::addEdge(MaterialInstance* mi, const char* parameter) {
     mMaterialToTexture[mi].params[parameter] = nullptr;
 }
 
+// Like Entity-Material edges, this can be called on a finalized graph when adding instances.
+void DependencyGraph::addEdge(Entity entity, VertexBuffer* vertices) {
+    GeometryNode& geometry = mGeometryToEntity[vertices];
+    if (geometry.entities.insert(entity).second && !geometry.ready) {
+        mEntityToMaterial[entity].numPendingGeometries++;
+    }
+}
+
+void DependencyGraph::markAsPending(VertexBuffer* vertices) {
+    assert(!mFinalized);
+    auto iter = mGeometryToEntity.find(vertices);
+    if (iter == mGeometryToEntity.end() || !iter->second.ready) {
+        return;
+    }
+    GeometryNode& geometry = iter.value();
+    geometry.ready = false;
+    for (auto entity : geometry.entities) {
+        mEntityToMaterial[entity].numPendingGeometries++;
+    }
+}
+
 // During finalization, the structure of the glTF is known but we have not yet created texture
 // objects. Find all non-textured entities and immediately add mark them as ready.
 void DependencyGraph::finalize() {
@@ -110,6 +131,22 @@ void DependencyGraph::markAsReady(Texture* texture) {
     }
 }
 
+void DependencyGraph::markAsReady(VertexBuffer* vertices) {
+    assert(vertices && mFinalized);
+    auto iter = mGeometryToEntity.find(vertices);
+    if (iter == mGeometryToEntity.end() || iter->second.ready) {
+        return;
+    }
+    GeometryNode& geometry = iter.value();
+    geometry.ready = true;
+    for (auto entity : geometry.entities) {
+        auto& status = mEntityToMaterial.at(entity);
+        assert(status.numPendingGeometries > 0);
+        status.numPendingGeometries--;
+        checkReadiness(entity, status);
+    }
+}
+
 void DependencyGraph::markAsReady(MaterialInstance* material) {
     auto& entities = mMaterialToEntity.at(material);
     for (auto entity : entities) {
@@ -118,9 +155,16 @@ void DependencyGraph::markAsReady(MaterialInstance* material) {
         if (status.numReadyMaterials == status.materials.size()) {
             continue;
         }
-        if (++status.numReadyMaterials == status.materials.size()) {
-            mReadyRenderables.push(entity);
-        }
+        status.numReadyMaterials++;
+        checkReadiness(entity, status);
+    }
+}
+
+void DependencyGraph::checkReadiness(Entity entity, EntityNode& status) {
+    if (!status.queued && status.numReadyMaterials == status.materials.size() &&
+            status.numPendingGeometries == 0) {
+        status.queued = true;
+        mReadyRenderables.push(entity);
     }
 }
 
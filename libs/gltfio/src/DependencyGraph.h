@@ -28,6 +28,7 @@
 namespace filament {
     class MaterialInstance;
     class Texture;
+    class VertexBuffer;
 }
 
 namespace gltfio {
@@ -56,6 +57,11 @@ namespace gltfio {
  *
  * Note that the left-most entity in the above graph has no textures, so it becomes ready as soon as
  * finalize is called.
+ *
+ * Entities also connect to the vertex buffers of their primitives. These are considered ready
+ * unless they have been explicitly marked as pending, which is done by progressive loading while
+ * their buffers are still being fetched. An entity becomes ready when all of its materials and
+ * all of its vertex buffers are ready.
  */
 class DependencyGraph {
 public:
@@ -70,6 +76,10 @@ public:
     // These are called during the initial asset loader phase.
     void addEdge(Entity entity, Material* material);
     void addEdge(Material* material, const char* parameter);
+    void addEdge(Entity entity, filament::VertexBuffer* vertices);
+
+    // This is called before finalization for the vertex buffers whose data is not yet available.
+    void markAsPending(filament::VertexBuffer* vertices);
 
     // This is called at the end of the initial asset loading phase.
     // Makes a guarantee that no new material nodes or parameter nodes will be added to the graph.
@@ -83,6 +93,9 @@ public:
     void addEdge(filament::Texture* texture, Material* material, const char* parameter);
     void markAsReady(filament::Texture* texture);
 
+    // This is called after the data of a pending vertex buffer has been uploaded.
+    void markAsReady(filament::VertexBuffer* vertices);
+
 private:
     struct TextureNode {
         filament::Texture* texture;
@@ -96,8 +109,16 @@ private:
     struct EntityNode {
         tsl::robin_set<Material*> materials;
         size_t numReadyMaterials = 0;
+        size_t numPendingGeometries = 0;
+        bool queued = false;
+    };
+
+    struct GeometryNode {
+        tsl::robin_set<Entity> entities;
+        bool ready = true;
     };
 
+    void checkReadiness(Entity entity, EntityNode& status);
     void checkReadiness(Material* material);
     void markAsReady(Material* material);
     TextureNode* getStatus(filament::Texture* texture);
@@ -107,6 +128,7 @@ private:
     tsl::robin_map<Material*, tsl::robin_set<Entity>> mMaterialToEntity;
     tsl::robin_map<Material*, MaterialNode> mMaterialToTexture;
     tsl::robin_map<filament::Texture*, tsl::robin_set<Material*>> mTextureToMaterial;
+    tsl::robin_map<filament::VertexBuffer*, GeometryNode> mGeometryToEntity;
 
     // Each texture (and its readiness flag) can be referenced from multiple nodes, so we own
     // a collection of wrapper objects in the following map. This uses std::unique_ptr to allow
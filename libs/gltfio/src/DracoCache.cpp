@@ -23,8 +23,11 @@
 #include <utils/Log.h>
 
 #include <memory>
+#include <mutex>
 #include <vector>
 
+#include <stdio.h>
+
 using std::unique_ptr;
 using std::vector;
 
@@ -32,14 +35,49 @@ using namespace utils;
 
 namespace gltfio {
 
+// FNV-1a, the cache files are named after the hash and the size of the compressed data.
+static uint64_t hashBytes(const uint8_t* data, size_t size) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i) {
+        h = (h ^ data[i]) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+void DracoCache::setPersistentCachePath(const char* directory) {
+    std::lock_guard<utils::Mutex> guard(mLock);
+    mPersistentCachePath = directory ? directory : "";
+}
+
 DracoMesh* DracoCache::findOrCreateMesh(const cgltf_buffer_view* key) {
-    auto iter = mCache.find(key);
-    if (iter != mCache.end()) {
-        return iter->second.get();
+    std::string cachePath;
+    {
+        std::lock_guard<utils::Mutex> guard(mLock);
+        auto iter = mCache.find(key);
+        if (iter != mCache.end()) {
+            return iter->second.get();
+        }
+        cachePath = mPersistentCachePath;
     }
+    // Decode outside of the lock, so that different meshes can be decoded in parallel.
     assert(key->buffer && key->buffer->data);
     const uint8_t* compressedData = key->offset + (uint8_t*) key->buffer->data;
-    DracoMesh* mesh = DracoMesh::decode(compressedData, key->size);
+    DracoMesh* mesh = nullptr;
+    if (!cachePath.empty()) {
+        char name[40];
+        snprintf(name, sizeof(name), "/%016llx-%llx.draco",
+                (unsigned long long) hashBytes(compressedData, key->size),
+                (unsigned long long) key->size);
+        cachePath += name;
+        mesh = DracoMesh::load(cachePath.c_str(), key->size);
+    }
+    if (!mesh) {
+        mesh = DracoMesh::decode(compressedData, key->size);
+        if (mesh && !cachePath.empty() && !mesh->save(cachePath.c_str(), key->size)) {
+            slog.w << "Unable to write Draco cache file " << cachePath.c_str() << io::endl;
+        }
+    }
+    std::lock_guard<utils::Mutex> guard(mLock);
     mCache.emplace(key, mesh);
     return mesh;
 }
@@ -117,6 +155,153 @@ DracoMesh* DracoMesh::decode(const uint8_t* data, size_t dataSize) {
     return new DracoMesh(new DracoMeshDetails { std::move(meshStatus).value() });
 }
 
+namespace {
+
+// Layout of a persistent cache file: the header, the faces as triplets of uint32_t point indices,
+// then each attribute, followed by its values for each point.
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t compressedSize;
+    uint32_t numFaces;
+    uint32_t numPoints;
+    uint32_t numAttributes;
+    uint32_t reserved;
+};
+
+struct CacheAttribute {
+    uint32_t uniqueId;
+    int32_t attributeType;
+    int32_t dataType;
+    int32_t numComponents;
+    int32_t normalized;
+    uint32_t byteStride;
+};
+
+constexpr uint32_t CACHE_MAGIC = 0x43435244; // 'DRCC'
+constexpr uint32_t CACHE_VERSION = 1;
+
+struct FileCloser {
+    void operator()(FILE* file) const { fclose(file); }
+};
+
+using FilePtr = unique_ptr<FILE, FileCloser>;
+
+} // anonymous namespace
+
+DracoMesh* DracoMesh::load(const char* path, size_t compressedSize) {
+    FilePtr file(fopen(path, "rb"));
+    if (!file) {
+        return nullptr;
+    }
+    auto read = [&file](void* data, size_t size) {
+        return fread(data, 1, size, file.get()) == size;
+    };
+
+    CacheHeader header;
+    if (!read(&header, sizeof(header)) || header.magic != CACHE_MAGIC ||
+            header.version != CACHE_VERSION || header.compressedSize != compressedSize) {
+        return nullptr;
+    }
+
+    unique_ptr<draco::Mesh> mesh(new draco::Mesh());
+    vector<uint32_t> faces(header.numFaces * 3);
+    if (!read(faces.data(), faces.size() * sizeof(uint32_t))) {
+        return nullptr;
+    }
+    mesh->SetNumFaces(header.numFaces);
+    for (uint32_t id = 0; id < header.numFaces; ++id) {
+        const uint32_t* f = faces.data() + id * 3;
+        mesh->SetFace(draco::FaceIndex(id), {
+                draco::PointIndex(f[0]), draco::PointIndex(f[1]), draco::PointIndex(f[2]) });
+    }
+    mesh->set_num_points(header.numPoints);
+
+    for (uint32_t i = 0; i < header.numAttributes; ++i) {
+        CacheAttribute attrib;
+        if (!read(&attrib, sizeof(attrib))) {
+            return nullptr;
+        }
+        const auto dataType = (draco::DataType) attrib.dataType;
+        if (attrib.byteStride != draco::DataTypeLength(dataType) * attrib.numComponents) {
+            return nullptr;
+        }
+        draco::GeometryAttribute ga;
+        ga.Init((draco::GeometryAttribute::Type) attrib.attributeType, nullptr,
+                (int8_t) attrib.numComponents, dataType, attrib.normalized != 0,
+                attrib.byteStride, 0);
+        const int id = mesh->AddAttribute(ga, true, header.numPoints);
+        if (id < 0) {
+            return nullptr;
+        }
+        draco::PointAttribute* attr = mesh->attribute(id);
+        attr->set_unique_id(attrib.uniqueId);
+        const size_t size = size_t(attrib.byteStride) * header.numPoints;
+        vector<uint8_t> values(size);
+        if (!read(values.data(), size)) {
+            return nullptr;
+        }
+        attr->buffer()->Write(0, values.data(), size);
+    }
+    return new DracoMesh(new DracoMeshDetails { std::move(mesh) });
+}
+
+bool DracoMesh::save(const char* path, size_t compressedSize) const {
+    const draco::Mesh* mesh = mDetails->mesh.get();
+
+    // Write to a temporary file first, so that a concurrent load never sees a partial file.
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%p.tmp", (const void*) this);
+    const std::string tmpPath = std::string(path) + suffix;
+    FilePtr file(fopen(tmpPath.c_str(), "wb"));
+    if (!file) {
+        return false;
+    }
+    bool success = true;
+    auto write = [&file, &success](const void* data, size_t size) {
+        success = success && fwrite(data, 1, size, file.get()) == size;
+    };
+
+    const CacheHeader header = {
+        CACHE_MAGIC, CACHE_VERSION, compressedSize,
+        mesh->num_faces(), mesh->num_points(), uint32_t(mesh->num_attributes()), 0
+    };
+    write(&header, sizeof(header));
+
+    vector<uint32_t> faces;
+    faces.reserve(mesh->num_faces() * 3);
+    for (uint32_t id = 0, n = mesh->num_faces(); id < n; ++id) {
+        draco::Mesh::Face face = mesh->face(draco::FaceIndex(id));
+        faces.push_back(face[0].value());
+        faces.push_back(face[1].value());
+        faces.push_back(face[2].value());
+    }
+    write(faces.data(), faces.size() * sizeof(uint32_t));
+
+    // The values are expanded to one per point, which allows the mapping to be the identity.
+    for (int32_t i = 0, n = mesh->num_attributes(); i < n; ++i) {
+        const draco::PointAttribute* attr = mesh->attribute(i);
+        const CacheAttribute attrib = {
+            attr->unique_id(), int32_t(attr->attribute_type()), int32_t(attr->data_type()),
+            attr->num_components(), attr->normalized(), uint32_t(attr->byte_stride())
+        };
+        write(&attrib, sizeof(attrib));
+        vector<uint8_t> values(attrib.byteStride * mesh->num_points());
+        uint8_t* dest = values.data();
+        for (draco::PointIndex p(0); p < mesh->num_points(); ++p, dest += attrib.byteStride) {
+            attr->GetValue(attr->mapped_index(p), dest);
+        }
+        write(values.data(), values.size());
+    }
+
+    success = fclose(file.release()) == 0 && success;
+    if (!success || rename(tmpPath.c_str(), path) != 0) {
+        remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
 void DracoMesh::getFaceIndices(cgltf_accessor* target) const {
     // Return early if we've already decompressed this data.
     if (target->buffer_view) {
@@ -209,6 +394,8 @@ bool DracoMesh::getVertexAttributes(uint32_t attributeId, cgltf_accessor* target
 DracoMesh::~DracoMesh() {}
 struct DracoMeshDetails {};
 DracoMesh* DracoMesh::decode(const uint8_t* data, size_t dataSize) { return nullptr; }
+DracoMesh* DracoMesh::load(const char* path, size_t compressedSize) { return nullptr; }
+bool DracoMesh::save(const char* path, size_t compressedSize) const { return false; }
 void DracoMesh::getFaceIndices(cgltf_accessor* target) const {}
 
 bool DracoMesh::getVertexAttributes(uint32_t attributeId, cgltf_accessor* target) const {
@@ -19,9 +19,12 @@
 
 #include <cgltf.h>
 
+#include <utils/Mutex.h>
+
 #include <tsl/robin_map.h>
 
 #include <memory>
+#include <string>
 
 #ifndef GLTFIO_DRACO_SUPPORTED
 #define GLTFIO_DRACO_SUPPORTED 0
@@ -35,10 +38,22 @@ class DracoMesh;
 //
 // The cache key is the buffer view that holds the compressed data. This allows the loader to
 // avoid duplicated work when a single Draco mesh is referenced from multiple primitives.
+//
+// findOrCreateMesh() can be called from several threads, as long as they use different keys.
+//
+// Optionally, the decoded meshes are also stored in a directory, in files named after a hash of
+// their compressed data. Subsequent loads of the same compressed data, even from another asset or
+// another process, read these files instead of decompressing the mesh.
 class DracoCache {
 public:
     DracoMesh* findOrCreateMesh(const cgltf_buffer_view* key);
+
+    // Enables the persistent cache, or disables it if the path is null or empty.
+    void setPersistentCachePath(const char* directory);
+
 private:
+    utils::Mutex mLock;
+    std::string mPersistentCachePath;
     tsl::robin_map<const cgltf_buffer_view*, std::unique_ptr<DracoMesh>> mCache;
 };
 
@@ -54,6 +69,12 @@ private:
 class DracoMesh {
 public:
     static DracoMesh* decode(const uint8_t* compressedData, size_t compressedSize);
+
+    // Reads or writes the decoded mesh from or to a persistent cache file. The compressed size is
+    // stored in the file to detect hash collisions.
+    static DracoMesh* load(const char* path, size_t compressedSize);
+    bool save(const char* path, size_t compressedSize) const;
+
     void getFaceIndices(cgltf_accessor* destination) const;
     bool getVertexAttributes(uint32_t attributeId, cgltf_accessor* destination) const;
     ~DracoMesh();
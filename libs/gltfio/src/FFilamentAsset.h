@@ -33,6 +33,7 @@
 #include <math/mat4.h>
 
 #include <utils/Entity.h>
+#include <utils/debug.h>
 
 #include <cgltf.h>
 
@@ -40,10 +41,12 @@
 #include "DependencyGraph.h"
 #include "DracoCache.h"
 #include "FFilamentInstance.h"
+#include "FTextureCache.h"
 
 #include <tsl/robin_map.h>
 #include <tsl/htrie_map.h>
 
+#include <string>
 #include <vector>
 
 #ifdef NDEBUG
@@ -64,6 +67,15 @@ namespace gltfio {
 class Animator;
 class Wireframe;
 
+// Conversion of the accessor data into the format of its buffer, see
+// AssetConfiguration::compactGeometry.
+enum class SlotConversion : uint8_t {
+    NONE,
+    NARROW_INDICES,     // 32-bit indices to 16 bits
+    QUANTIZE_UNSIGNED,  // floats in [0, 1] to normalized unsigned shorts
+    QUANTIZE_SIGNED,    // floats in [-1, 1] to normalized signed shorts
+};
+
 // Encapsulates VertexBuffer::setBufferAt() or IndexBuffer::setBuffer().
 struct BufferSlot {
     const cgltf_accessor* accessor;
@@ -72,6 +84,8 @@ struct BufferSlot {
     int morphTarget; // 0 if no morphing, otherwise 1-based index
     filament::VertexBuffer* vertexBuffer;
     filament::IndexBuffer* indexBuffer;
+    SlotConversion conversion;
+    bool shared; // the data is bound from the SharedBufferMap entry of its glTF buffer
 };
 
 // Encapsulates a connection between Texture and MaterialInstance.
@@ -98,6 +112,33 @@ struct Primitive {
 };
 using MeshCache = tsl::robin_map<const cgltf_mesh*, std::vector<Primitive>>;
 
+// SharedBufferMap
+// ---------------
+// Vertex attributes that are uploaded as they are do not get a BufferObject each. Instead, they
+// are bound at their offset into a single BufferObject per glTF buffer, which holds the range of
+// the glTF buffer spanned by these attributes. This saves thousands of driver buffers in complex
+// assets, and lets ResourceLoader upload the vertex data of a glTF buffer in a single transfer.
+struct SharedBuffer {
+    filament::BufferObject* bufferObject = nullptr;
+    uint32_t offset = 0; // offset of the range in the glTF buffer
+    uint32_t size = 0;
+    bool uploaded = false; // the whole range has been uploaded at once
+};
+using SharedBufferMap = tsl::robin_map<const cgltf_buffer*, SharedBuffer>;
+
+// LodGeometryCache
+// ----------------
+// The coarser levels of detail of a primitive, keyed by the index buffer of its most detailed
+// level. They are generated by ResourceLoader, in a single index buffer where level i > 0 is the
+// range of counts[i - 1] indices at offsets[i - 1].
+static constexpr size_t MAX_LEVELS_OF_DETAIL = 4;
+struct LodGeometry {
+    filament::IndexBuffer* indices = nullptr;
+    uint32_t offsets[MAX_LEVELS_OF_DETAIL - 1] = {};
+    uint32_t counts[MAX_LEVELS_OF_DETAIL - 1] = {};
+};
+using LodGeometryCache = tsl::robin_map<const filament::IndexBuffer*, LodGeometry>;
+
 // MatInstanceCache
 // ----------------
 // Each glTF material definition corresponds to a single filament::MaterialInstance, which are
@@ -111,6 +152,24 @@ struct MaterialEntry {
 };
 using MatInstanceCache = tsl::robin_map<intptr_t, MaterialEntry>;
 
+// When AssetConfiguration::shareMaterialInstances is set, the instances are also cached by a
+// signature of the parameter values and textures of the glTF material, so that identical glTF
+// materials share the same MaterialInstance.
+using MatSignatureCache = tsl::robin_map<std::string, MaterialEntry>;
+
+// MeshInstances
+// -------------
+// A node with the EXT_mesh_gpu_instancing extension gets a child entity with a renderable for each
+// of its instances, all sharing the node's primitives and material instances. The transforms of
+// the children are read from the TRS accessors once ResourceLoader has loaded the buffers.
+struct MeshInstances {
+    const cgltf_accessor* translation;
+    const cgltf_accessor* rotation;
+    const cgltf_accessor* scale;
+    utils::Entity node;
+    std::vector<utils::Entity> entities;
+};
+
 struct FFilamentAsset : public FilamentAsset {
     FFilamentAsset(filament::Engine* engine, utils::NameComponentManager* names,
             utils::EntityManager* entityManager, const cgltf_data* srcAsset) :
@@ -212,6 +271,13 @@ struct FFilamentAsset : public FilamentAsset {
         mTextures.push_back(texture);
     }
 
+    // Holds a reference to a texture of the given cache, released on destruction.
+    void shareTexture(FTextureCache* cache, filament::Texture* texture) {
+        assert_invariant(!mTextureCache || mTextureCache == cache);
+        mTextureCache = cache;
+        mSharedTextures.push_back(texture);
+    }
+
     void bindTexture(const TextureSlot& tb, filament::Texture* texture) {
         tb.materialInstance->setParameter(tb.materialParameter, texture, tb.sampler);
         mDependencyGraph.addEdge(texture, tb.materialInstance, tb.materialParameter);
@@ -228,10 +294,13 @@ struct FFilamentAsset : public FilamentAsset {
     std::vector<utils::Entity> mLightEntities;
     std::vector<utils::Entity> mCameraEntities;
     std::vector<filament::MaterialInstance*> mMaterialInstances;
+    std::vector<filament::MaterialInstance*> mSharedMaterialInstances; // owned by AssetLoader
     std::vector<filament::VertexBuffer*> mVertexBuffers;
     std::vector<filament::BufferObject*> mBufferObjects;
     std::vector<filament::IndexBuffer*> mIndexBuffers;
     std::vector<filament::Texture*> mTextures;
+    std::vector<filament::Texture*> mSharedTextures;
+    FTextureCache* mTextureCache = nullptr;
     filament::Aabb mBoundingBox;
     utils::Entity mRoot;
     std::vector<FFilamentInstance*> mInstances;
@@ -239,6 +308,8 @@ struct FFilamentAsset : public FilamentAsset {
     Animator* mAnimator = nullptr;
     Wireframe* mWireframe = nullptr;
     bool mResourcesLoaded = false;
+    uint8_t mLevelsOfDetail = 1;
+    bool mCompressAnimations = false;
     DependencyGraph mDependencyGraph;
     tsl::htrie_map<char, std::vector<utils::Entity>> mNameToEntity;
 
@@ -268,7 +339,11 @@ struct FFilamentAsset : public FilamentAsset {
     NodeMap mNodeMap; // unused for instanced assets
     std::vector<std::pair<const cgltf_primitive*, filament::VertexBuffer*> > mPrimitives;
     MatInstanceCache mMatInstanceCache;
+    MatSignatureCache mMatSignatureCache;
     MeshCache mMeshCache;
+    std::vector<MeshInstances> mMeshInstances;
+    LodGeometryCache mLodGeometry;
+    SharedBufferMap mSharedBuffers;
 };
 
 FILAMENT_UPCAST(FilamentAsset)
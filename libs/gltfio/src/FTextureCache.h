@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLTFIO_FTEXTURECACHE_H
+#define GLTFIO_FTEXTURECACHE_H
+
+#include <gltfio/TextureCache.h>
+
+#include "upcast.h"
+
+#include <tsl/robin_map.h>
+
+#include <string>
+
+#include <stdint.h>
+
+namespace filament {
+    class Texture;
+}
+
+namespace gltfio {
+
+struct FTextureCache : public TextureCache {
+    explicit FTextureCache(filament::Engine* engine) noexcept : mEngine(engine) {}
+    ~FTextureCache();
+
+    // Returns the texture cached under the given key and adds a reference to it, or null.
+    filament::Texture* acquire(std::string const& key);
+
+    // Adds a texture to the cache, with a single reference.
+    void insert(std::string key, filament::Texture* texture);
+
+    // Removes a reference to a texture of the cache, and destroys it along with the last one.
+    void release(filament::Texture* texture);
+
+    size_t getTextureCount() const noexcept { return mEntries.size(); }
+
+    struct Entry {
+        filament::Texture* texture;
+        uint32_t references;
+    };
+
+    filament::Engine* const mEngine;
+    tsl::robin_map<std::string, Entry> mEntries;
+    tsl::robin_map<const filament::Texture*, std::string> mKeys;
+};
+
+FILAMENT_UPCAST(TextureCache)
+
+} // namespace gltfio
+
+#endif // GLTFIO_FTEXTURECACHE_H
@@ -24,6 +24,8 @@
 
 #include "Wireframe.h"
 
+#include <tsl/robin_set.h>
+
 using namespace filament;
 using namespace utils;
 
@@ -55,8 +57,13 @@ FFilamentAsset::~FFilamentAsset() {
         // Destroy the actual entity.
         mEntityManager->destroy(entity);
     }
+    // Instances shared with other assets are released by AssetLoader.
+    tsl::robin_set<MaterialInstance*> shared(mSharedMaterialInstances.begin(),
+            mSharedMaterialInstances.end());
     for (auto mi : mMaterialInstances) {
-        mEngine->destroy(mi);
+        if (shared.find(mi) == shared.end()) {
+            mEngine->destroy(mi);
+        }
     }
     for (auto vb : mVertexBuffers) {
         mEngine->destroy(vb);
@@ -70,6 +77,9 @@ FFilamentAsset::~FFilamentAsset() {
     for (auto tx : mTextures) {
         mEngine->destroy(tx);
     }
+    for (auto tx : mSharedTextures) {
+        mTextureCache->release(tx);
+    }
 }
 
 Animator* FFilamentAsset::getAnimator() noexcept {
@@ -99,7 +109,11 @@ void FFilamentAsset::releaseSourceData() noexcept {
     // calling clear(). With many container types (such as robin_map), clearing is a fast
     // operation that merely frees the storage for the items.
     mMatInstanceCache = {};
+    mMatSignatureCache = {};
     mMeshCache = {};
+    mMeshInstances = {};
+    mLodGeometry = {};
+    mSharedBuffers = {};
     mResourceUris = {};
     mNodeMap = {};
     mPrimitives = {};
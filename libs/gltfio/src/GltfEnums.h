@@ -230,4 +230,11 @@ inline bool getElementType(cgltf_type type, cgltf_component_type ctype,
     return false;
 }
 
+// Sparse accessors are unpacked into floats by ResourceLoader, whatever their component type.
+inline bool getAttributeType(const cgltf_accessor* accessor,
+        filament::VertexBuffer::AttributeType* atype) {
+    return getElementType(accessor->type,
+            accessor->is_sparse ? cgltf_component_type_r_32f : accessor->component_type, atype);
+}
+
 #endif // GLTFIO_GLTFENUMS_H
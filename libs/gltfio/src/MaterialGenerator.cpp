@@ -18,11 +18,21 @@
 
 #include <filamat/MaterialBuilder.h>
 
+#include <filament/MaterialEnums.h>
+
 #include <utils/Hash.h>
+#include <utils/JobSystem.h>
+#include <utils/Log.h>
+#include <utils/Mutex.h>
 
 #include <tsl/robin_map.h>
 
+#include <mutex>
 #include <string>
+#include <vector>
+
+#include <stdio.h>
+#include <string.h>
 
 using namespace filamat;
 using namespace filament;
@@ -286,8 +296,8 @@ std::string shaderFromKey(const MaterialKey& config) {
     return shader;
 }
 
-static Material* createMaterial(Engine* engine, const MaterialKey& config, const UvMap& uvmap,
-        const char* name, bool optimizeShaders) {
+static Package createMaterialPackage(Engine* engine, const MaterialKey& config,
+        const UvMap& uvmap, const char* name, bool optimizeShaders) {
     std::string shader = shaderFromKey(config);
     processShaderString(&shader, uvmap, config);
     MaterialBuilder builder = MaterialBuilder()
@@ -468,7 +478,12 @@ static Material* createMaterial(Engine* engine, const MaterialKey& config, const
         builder.shading(Shading::LIT);
     }
 
-    Package pkg = builder.build(engine->getJobSystem());
+    return builder.build(engine->getJobSystem());
+}
+
+static Material* createMaterial(Engine* engine, const MaterialKey& config, const UvMap& uvmap,
+        const char* name, bool optimizeShaders) {
+    Package pkg = createMaterialPackage(engine, config, uvmap, name, optimizeShaders);
     return Material::Builder().package(pkg.getData(), pkg.getSize()).build(*engine);
 }
 
@@ -491,6 +506,270 @@ MaterialInstance* MaterialGenerator::createMaterialInstance(MaterialKey* config,
     return iter->second->createInstance(label);
 }
 
+// SpecializingMaterialProvider hands out ubershader instances, and meanwhile builds specialized
+// materials for the most requested keys, one at a time, on the engine's JobSystem. Built packages
+// are turned into Materials on the next call to createMaterialInstance(), which is always made from
+// the engine thread. Instances that were already handed out keep using the ubershader.
+class SpecializingMaterialProvider : public MaterialProvider {
+public:
+    SpecializingMaterialProvider(filament::Engine* engine, size_t maxSpecializedMaterials,
+            const char* cachePath);
+    ~SpecializingMaterialProvider() override;
+
+    // The vertex buffers must satisfy the ubershaders, the specialized materials require a subset
+    // of their attributes.
+    MaterialSource getSource() const noexcept override { return LOAD_UBERSHADERS; }
+
+    filament::MaterialInstance* createMaterialInstance(MaterialKey* config, UvMap* uvmap,
+            const char* label) override;
+
+    size_t getMaterialsCount() const noexcept override;
+    const filament::Material* const* getMaterials() const noexcept override;
+    void destroyMaterials() override;
+
+private:
+    struct Entry {
+        uint32_t requests = 0;
+        filament::Material* material = nullptr;
+        bool pending = false;       // being built in the background
+        bool failed = false;        // the build failed, don't try again
+        bool cacheChecked = false;
+    };
+
+    struct Result {
+        MaterialKey key;
+        Package package;
+    };
+
+    void materializeResults();
+    void scheduleSpecialization();
+    void waitForJob();
+    void updateMaterialList();
+    filament::Material* loadCachedMaterial(const MaterialKey& key) const;
+    void saveCachedMaterial(const MaterialKey& key, const Package& package) const;
+    std::string getCacheFilePath(const MaterialKey& key) const;
+
+    using HashFn = utils::hash::MurmurHashFn<MaterialKey>;
+    tsl::robin_map<MaterialKey, Entry, HashFn> mEntries;
+    std::vector<const filament::Material*> mMaterials;
+    MaterialProvider* const mUbershaders;
+
+    utils::Mutex mResultsLock;
+    std::vector<Result> mResults;   // guarded by mResultsLock
+    JobSystem::Job* mJob = nullptr;
+    size_t mSpecializedCount = 0;
+
+    filament::Engine* const mEngine;
+    const size_t mMaxSpecializedMaterials;
+    const std::string mCachePath;
+};
+
+SpecializingMaterialProvider::SpecializingMaterialProvider(Engine* engine,
+        size_t maxSpecializedMaterials, const char* cachePath)
+        : mUbershaders(createUbershaderLoader(engine)), mEngine(engine),
+          mMaxSpecializedMaterials(maxSpecializedMaterials), mCachePath(cachePath ? cachePath : "") {
+    MaterialBuilder::init();
+}
+
+SpecializingMaterialProvider::~SpecializingMaterialProvider() {
+    waitForJob();
+    delete mUbershaders;
+    MaterialBuilder::shutdown();
+}
+
+size_t SpecializingMaterialProvider::getMaterialsCount() const noexcept {
+    return mMaterials.size();
+}
+
+const Material* const* SpecializingMaterialProvider::getMaterials() const noexcept {
+    return mMaterials.data();
+}
+
+void SpecializingMaterialProvider::destroyMaterials() {
+    waitForJob();
+    mResults.clear();
+    for (auto& iter : mEntries) {
+        mEngine->destroy(iter.second.material);
+    }
+    mEntries.clear();
+    mSpecializedCount = 0;
+    mUbershaders->destroyMaterials();
+    mMaterials.clear();
+}
+
+void SpecializingMaterialProvider::waitForJob() {
+    if (mJob) {
+        mEngine->getJobSystem().waitAndRelease(mJob);
+    }
+}
+
+void SpecializingMaterialProvider::updateMaterialList() {
+    const Material* const* ubershaders = mUbershaders->getMaterials();
+    mMaterials.assign(ubershaders, ubershaders + mUbershaders->getMaterialsCount());
+    for (auto const& iter : mEntries) {
+        if (iter.second.material) {
+            mMaterials.push_back(iter.second.material);
+        }
+    }
+}
+
+MaterialInstance* SpecializingMaterialProvider::createMaterialInstance(MaterialKey* config,
+        UvMap* uvmap, const char* label) {
+    materializeResults();
+
+    // Entries are keyed by the requested configuration, i.e. before any constraint is applied.
+    const MaterialKey key = *config;
+    Entry& entry = mEntries[key];
+    entry.requests++;
+
+    if (!entry.material && !entry.pending && !entry.cacheChecked && !mCachePath.empty() &&
+            mSpecializedCount < mMaxSpecializedMaterials) {
+        entry.cacheChecked = true;
+        entry.material = loadCachedMaterial(key);
+        if (entry.material) {
+            mSpecializedCount++;
+        }
+    }
+
+    MaterialInstance* mi;
+    if (entry.material) {
+        constrainMaterial(config, uvmap);
+        mi = entry.material->createInstance(label);
+    } else {
+        mi = mUbershaders->createMaterialInstance(config, uvmap, label);
+        scheduleSpecialization();
+    }
+    updateMaterialList();
+    return mi;
+}
+
+void SpecializingMaterialProvider::materializeResults() {
+    std::vector<Result> results;
+    {
+        std::lock_guard<utils::Mutex> guard(mResultsLock);
+        std::swap(results, mResults);
+    }
+    if (results.empty()) {
+        return;
+    }
+
+    // the job publishes its result as its very last step, so this doesn't block
+    waitForJob();
+
+    for (Result const& result : results) {
+        Entry& entry = mEntries[result.key];
+        entry.pending = false;
+        if (result.package.isValid()) {
+            entry.material = Material::Builder()
+                    .package(result.package.getData(), result.package.getSize())
+                    .build(*mEngine);
+        }
+        if (entry.material) {
+            mSpecializedCount++;
+        } else {
+            entry.failed = true;
+        }
+    }
+}
+
+void SpecializingMaterialProvider::scheduleSpecialization() {
+    if (mJob || mSpecializedCount >= mMaxSpecializedMaterials) {
+        return;
+    }
+
+    // pick the most requested configuration that doesn't have a specialized material yet
+    const MaterialKey* candidate = nullptr;
+    uint32_t requests = 0;
+    for (auto const& iter : mEntries) {
+        Entry const& entry = iter.second;
+        if (!entry.material && !entry.failed && !iter.first.enableDiagnostics &&
+                entry.requests > requests) {
+            candidate = &iter.first;
+            requests = entry.requests;
+        }
+    }
+    if (!candidate) {
+        return;
+    }
+
+    MaterialKey const key = *candidate;
+    mEntries[key].pending = true;
+
+    bool optimizeShaders = true;
+#ifndef NDEBUG
+    optimizeShaders = false;
+#endif
+
+    JobSystem& js = mEngine->getJobSystem();
+    mJob = js.runAndRetain(jobs::createJob(js, nullptr, [this, key, optimizeShaders]() {
+        MaterialKey config = key;
+        UvMap uvmap{};
+        constrainMaterial(&config, &uvmap);
+        Package package = createMaterialPackage(mEngine, config, uvmap, "specialized",
+                optimizeShaders);
+        if (package.isValid() && !mCachePath.empty()) {
+            saveCachedMaterial(key, package);
+        }
+        std::lock_guard<utils::Mutex> guard(mResultsLock);
+        mResults.push_back({ key, std::move(package) });
+    }));
+}
+
+std::string SpecializingMaterialProvider::getCacheFilePath(const MaterialKey& key) const {
+    // the file name changes with the material format and the backend, so that stale packages
+    // are never loaded
+    char name[64];
+    snprintf(name, sizeof(name), "/gltfio-%08x-%u-%u.filamat", HashFn()(key),
+            unsigned(mEngine->getBackend()), unsigned(MATERIAL_VERSION));
+    return mCachePath + name;
+}
+
+Material* SpecializingMaterialProvider::loadCachedMaterial(const MaterialKey& key) const {
+    std::string const path = getCacheFilePath(key);
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return nullptr;
+    }
+
+    // the file starts with the key it was built for, which resolves hash collisions
+    std::vector<uint8_t> data;
+    MaterialKey cachedKey;
+    bool valid = fread(&cachedKey, sizeof(cachedKey), 1, file) == 1 &&
+            memcmp(&cachedKey, &key, sizeof(key)) == 0;
+    if (valid) {
+        uint8_t buffer[4096];
+        size_t size;
+        while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            data.insert(data.end(), buffer, buffer + size);
+        }
+        valid = !ferror(file) && !data.empty();
+    }
+    fclose(file);
+    if (!valid) {
+        return nullptr;
+    }
+    return Material::Builder().package(data.data(), data.size()).build(*mEngine);
+}
+
+void SpecializingMaterialProvider::saveCachedMaterial(const MaterialKey& key,
+        const Package& package) const {
+    std::string const path = getCacheFilePath(key);
+    std::string const tmpPath = path + ".tmp";
+    FILE* file = fopen(tmpPath.c_str(), "wb");
+    if (!file) {
+        slog.w << "Unable to write the material cache file " << tmpPath.c_str() << io::endl;
+        return;
+    }
+    bool success = fwrite(&key, sizeof(key), 1, file) == 1 &&
+            fwrite(package.getData(), 1, package.getSize(), file) == package.getSize();
+    success = fclose(file) == 0 && success;
+
+    // rename() is atomic, so a concurrent reader sees either no file or all of it
+    if (!success || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        remove(tmpPath.c_str());
+    }
+}
+
 } // anonymous namespace
 
 namespace gltfio {
@@ -499,4 +778,9 @@ MaterialProvider* createMaterialGenerator(filament::Engine* engine, bool optimiz
     return new MaterialGenerator(engine, optimizeShaders);
 }
 
+MaterialProvider* createSpecializingMaterialProvider(filament::Engine* engine,
+        size_t maxSpecializedMaterials, const char* cachePath) {
+    return new SpecializingMaterialProvider(engine, maxSpecializedMaterials, cachePath);
+}
+
 } // namespace gltfio
@@ -23,6 +23,8 @@
 #include "GltfEnums.h"
 #include "TangentsJob.h"
 
+#include <algorithm>
+
 using namespace filament;
 using namespace filament::math;
 using namespace utils;
@@ -75,6 +77,7 @@ MorphHelper::~MorphHelper() {
             for (auto& target : prim.targets) {
                 engine->destroy(target.bufferObject);
             }
+            engine->destroy(prim.accumulated);
         }
     }
 }
@@ -117,25 +120,61 @@ void MorphHelper::applyWeights(Entity entity, float const* weights, size_t count
         }
     }
 
+    // Set the 4-tuple uniform for the weight values by derefing the primary indices. Note that we
+    // first create a "safe set" by replacing the unused sentinel with zero.
+    float4 highest;
+    for (int i = 0; i < 4; i++) {
+        highest[i] = (primaryIndices[i] == kUnused) ? 0 : weights[primaryIndices[i]];
+    }
+
+    // If more than 4 targets are active, the positions of the last slot are replaced by the sum of
+    // all the non-primary deltas, scaled such that the weight of that slot is unchanged.
+    const bool accumulate = primaryIndices[3] != kUnused &&
+            std::count_if(weights, weights + count, [](float w) { return w > 0; }) > 4;
+
     // Swap out the buffer objects for the primary indices.
     for (const auto& prim : mMorphTable[entity].primitives) {
+        VertexBuffer* vb = prim.vertexBuffer;
+        const bool accumulated = accumulate && prim.accumulated;
         for (const auto& target : prim.targets) {
             const int index = indexOf(target.morphTargetIndex, primaryIndices);
             if (index > -1) {
-                VertexBuffer* vb = prim.vertexBuffer;
+                if (accumulated && index == 3 && target.type == cgltf_attribute_type_position) {
+                    continue;
+                }
                 vb->setBufferObjectAt(engine, prim.baseSlot + index, target.bufferObject);
                 // Do not break out early because there could be more than one target entry for this
                 // particular target index (e.g. positions + tangents).
             }
         }
-    }
+        if (!accumulated) {
+            continue;
+        }
 
-    // Finally, set the 4-tuple uniform for the weight values by derefing the primary indices.
-    // Note that we first create a "safe set" by replacing the unused sentinel with zero.
-    float4 highest;
-    for (int i = 0; i < 4; i++) {
-        highest[i] = (primaryIndices[i] == kUnused) ? 0 : weights[primaryIndices[i]];
+        // Only the active targets are evaluated.
+        const size_t size = prim.vertexCount * sizeof(float3);
+        float3* sum = (float3*) calloc(prim.vertexCount, sizeof(float3));
+        const float scale = 1.0f / highest[3];
+        for (const auto& target : prim.targets) {
+            const int index = target.morphTargetIndex;
+            if (target.deltas.empty() || size_t(index) >= count || weights[index] <= 0) {
+                continue;
+            }
+            const int primary = indexOf(index, primaryIndices);
+            if (primary > -1 && primary < 3) {
+                continue;
+            }
+            const float w = weights[index] * scale;
+            const float3* deltas = target.deltas.data();
+            for (size_t i = 0, n = std::min(prim.vertexCount, target.deltas.size()); i < n; ++i) {
+                sum[i] += w * deltas[i];
+            }
+        }
+        prim.accumulated->setBuffer(engine, VertexBuffer::BufferDescriptor(sum, size,
+                FREE_CALLBACK));
+        vb->setBufferObjectAt(engine, prim.baseSlot + 3, prim.accumulated);
     }
+
     renderableManager->setMorphWeights(renderable, highest);
 }
 
@@ -147,6 +186,10 @@ void MorphHelper::addPrimitive(cgltf_mesh const* mesh, int primitiveIndex, Table
     entry->primitives.push_back({ vertexBuffer, determineBaseSlot(prim) });
     std::vector<GltfTarget>& targets = entry->primitives.back().targets;
 
+    // Positions of non-primary targets can be accumulated on the CPU if they are plain floats,
+    // which is the format of the attribute slots.
+    const bool accumulate = prim.targets_count > 4;
+
     const cgltf_accessor* previous = nullptr;
     for (int targetIndex = 0; targetIndex < prim.targets_count; targetIndex++) {
         const cgltf_morph_target& morphTarget = prim.targets[targetIndex];
@@ -197,10 +240,25 @@ void MorphHelper::addPrimitive(cgltf_mesh const* mesh, int primitiveIndex, Table
                     VertexBuffer::BufferDescriptor bd(clone, size, FREE_CALLBACK);
                     bufferObject->setBuffer(engine, std::move(bd));
                     targets.push_back({bufferObject, targetIndex, atype});
+
+                    if (accumulate && accessor->count && accessor->type == cgltf_type_vec3 &&
+                            !accessor->normalized &&
+                            accessor->component_type == cgltf_component_type_r_32f) {
+                        std::vector<float3>& deltas = targets.back().deltas;
+                        deltas.resize(accessor->count);
+                        cgltf_accessor_unpack_floats(accessor, &deltas[0].x, accessor->count * 3);
+                        entry->primitives.back().vertexCount = accessor->count;
+                    }
                 }
             }
         }
     }
+
+    GltfPrimitive& primitive = entry->primitives.back();
+    if (primitive.vertexCount) {
+        primitive.accumulated = BufferObject::Builder()
+                .size(primitive.vertexCount * sizeof(float3)).build(engine);
+    }
 }
 
 // This mimics some of the logic in AssetLoader in order to determine which VertexBuffer slots
@@ -17,6 +17,7 @@
 #include "FFilamentAsset.h"
 #include "FFilamentInstance.h"
 
+#include <math/vec3.h>
 #include <math/vec4.h>
 
 #include <tsl/robin_map.h>
@@ -36,6 +37,10 @@ namespace gltfio {
  * Each partition is associated with an unordered set of 4 (or fewer) morph target indices, which
  * we call the "primary indices" for that time slice.
  *
+ * When more than 4 targets are active, the positions of the fourth slot are replaced by the sum of
+ * the deltas of all the non-primary active targets, computed on the CPU. This keeps positions exact
+ * regardless of the number of targets, only the normals are limited to the primary indices.
+ *
  * Animator has ownership over a single instance of MorphHelper, thus it is 1:1 with FilamentAsset.
  */
 class MorphHelper {
@@ -54,12 +59,15 @@ private:
         filament::BufferObject* bufferObject;
         int morphTargetIndex;
         cgltf_attribute_type type;
+        std::vector<filament::math::float3> deltas; // CPU copy of the positions, if accumulated
     };
 
     struct GltfPrimitive {
         filament::VertexBuffer* vertexBuffer;
         int baseSlot;
         std::vector<GltfTarget> targets; // TODO: flatten this?
+        filament::BufferObject* accumulated = nullptr; // sum of the non-primary position deltas
+        size_t vertexCount = 0;
     };
 
     struct TableEntry {
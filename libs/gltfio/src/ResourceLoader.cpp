@@ -18,7 +18,9 @@
 #include <gltfio/Image.h>
 
 #include "FFilamentAsset.h"
+#include "FTextureCache.h"
 #include "TangentsJob.h"
+#include "math.h"
 #include "upcast.h"
 
 #include <filament/BufferObject.h>
@@ -28,6 +30,9 @@
 #include <filament/Texture.h>
 #include <filament/VertexBuffer.h>
 
+#include <image/KtxBundle.h>
+#include <image/KtxUtility.h>
+
 #include <utils/JobSystem.h>
 #include <utils/Log.h>
 #include <utils/Systrace.h>
@@ -40,7 +45,14 @@
 
 #include <tsl/robin_map.h>
 
+#include <meshoptimizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #if defined(__EMSCRIPTEN__) || defined(ANDROID)
 #define USE_FILESYSTEM 0
@@ -59,12 +71,17 @@ namespace {
     struct TextureCacheEntry {
         Texture* texture;
         std::atomic<stbi_uc*> texels;
+        std::atomic<image::KtxBundle*> ktx;   // decoded instead of texels for KTX images
         uint32_t bufferSize;
         int width;
         int height;
         int numComponents;
+        Texture::InternalFormat ktxFormat;
+        uint8_t ktxLevels;
+        bool isKtx;
         bool srgb;
         bool completed;
+        std::string sharedKey;  // key in the shared TextureCache, if any
     };
 
     using BufferTextureCache = tsl::robin_map<const void*, std::unique_ptr<TextureCacheEntry>>;
@@ -74,18 +91,40 @@ namespace {
 
 namespace gltfio {
 
+// Vertex cache statistics of the import-time mesh optimization, reported once per asset.
+struct MeshStatistics {
+    size_t primitives = 0;
+    size_t triangles = 0;
+    size_t vertices = 0;
+    size_t transformedBefore = 0;
+    size_t transformedAfter = 0;
+};
+
+// Output of simplifyIndices(), the concatenated indices of the coarser levels of detail of a
+// primitive, from the most detailed to the least detailed.
+struct LodIndices {
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> counts;
+};
+
 struct ResourceLoader::Impl {
     Impl(const ResourceConfiguration& config) {
         mGltfPath = std::string(config.gltfPath ? config.gltfPath : "");
         mEngine = config.engine;
         mNormalizeSkinningWeights = config.normalizeSkinningWeights;
         mRecomputeBoundingBoxes = config.recomputeBoundingBoxes;
+        mOptimizeMeshes = config.optimizeMeshes;
+        mDracoCachePath = std::string(config.dracoCachePath ? config.dracoCachePath : "");
+        mTextureCache = config.textureCache ? upcast(config.textureCache) : nullptr;
     }
 
     Engine* mEngine;
     bool mNormalizeSkinningWeights;
     bool mRecomputeBoundingBoxes;
+    bool mOptimizeMeshes;
     std::string mGltfPath;
+    std::string mDracoCachePath;
+    FTextureCache* mTextureCache;
 
     // User-provided resource data with URI string keys, populated with addResourceData().
     // This is used on platforms without traditional file systems, such as Android and WebGL.
@@ -102,7 +141,37 @@ struct ResourceLoader::Impl {
     JobSystem::Job* mDecoderRootJob = nullptr;
     FFilamentAsset* mCurrentAsset = nullptr;
 
-    void computeTangents(FFilamentAsset* asset);
+    // State of a progressive load, the geometry of each primitive is uploaded as soon as its
+    // buffers have been added to mUriDataCache.
+    FFilamentAsset* mProgressiveAsset = nullptr;
+    std::vector<std::string> mPendingUris;
+    size_t mNumRequestedUris = 0;
+    std::vector<bool> mUploadedSlots;
+    std::vector<bool> mUploadedPrimitives;
+
+    // Outputs of preparePrimitives(). The first two are indexed like the buffer slots of the
+    // asset, and are consumed by the uploads on the main thread.
+    std::vector<uint16_t*> mConvertedData;
+    std::vector<float*> mSparseData;
+    std::vector<LodIndices> mLodIndices;
+    tsl::robin_map<const cgltf_primitive*, Aabb> mPrimitiveBounds;
+
+    // Accumulated by the mesh optimization of the asset being loaded.
+    MeshStatistics mMeshStatistics;
+
+    void preparePrimitives(FFilamentAsset* asset, std::vector<TangentsJob::Params>& tangents);
+    void collectTangentJobs(FFilamentAsset* asset, const VertexBuffer* only,
+            std::vector<TangentsJob::Params>& jobParams);
+    void uploadTangents(FFilamentAsset* asset, std::vector<TangentsJob::Params>& jobParams);
+    void computeTangents(FFilamentAsset* asset, const VertexBuffer* only = nullptr);
+    void uploadBufferSlot(FFilamentAsset* asset, const BufferSlot& slot,
+            uint16_t* converted = nullptr);
+    void uploadSharedBuffers(FFilamentAsset* asset);
+    void applySparseData(FFilamentAsset* asset, const BufferSlot& slot,
+            float* generated = nullptr);
+    void uploadPrimitive(FFilamentAsset* asset, size_t index);
+    void createLevelsOfDetail(FFilamentAsset* asset);
+    void resolvePendingUris(FFilamentAsset* asset);
     bool createTextures(bool async);
     void cancelTextureDecoding();
     void addTextureCacheEntry(const TextureSlot& tb);
@@ -179,13 +248,39 @@ void importSkins(const cgltf_data* gltf, const NodeMap& nodeMap, SkinVector& dst
     }
 }
 
+// Sets the local transforms of the children that AssetLoader created for the instances of an
+// EXT_mesh_gpu_instancing node. Missing attributes default to the identity.
+void applyMeshInstances(TransformManager& tm, const MeshInstances& instances) {
+    for (size_t i = 0, n = instances.entities.size(); i < n; ++i) {
+        float3 translation(0);
+        float rotation[4] = { 0, 0, 0, 1 };
+        float3 scale(1);
+        if (instances.translation) {
+            cgltf_accessor_read_float(instances.translation, i, &translation.x, 3);
+        }
+        if (instances.rotation) {
+            cgltf_accessor_read_float(instances.rotation, i, rotation, 4);
+        }
+        if (instances.scale) {
+            cgltf_accessor_read_float(instances.scale, i, &scale.x, 3);
+        }
+        const quatf q(rotation[3], rotation[0], rotation[1], rotation[2]);
+        tm.setTransform(tm.getInstance(instances.entities[i]),
+                composeMatrix(translation, q, scale));
+    }
+}
+
 static void convertBytesToShorts(uint16_t* dst, const uint8_t* src, size_t count) {
     for (size_t i = 0; i < count; ++i) {
         dst[i] = src[i];
     }
 }
 
-static void decodeDracoMeshes(FFilamentAsset* asset) {
+static void decodeDracoMesh(FFilamentAsset* asset, const cgltf_primitive* prim) {
+    if (!prim->has_draco_mesh_compression) {
+        return;
+    }
+
     DracoCache* dracoCache = &asset->mSourceAsset->dracoCache;
 
     // For a given primitive and attribute, find the corresponding accessor.
@@ -199,47 +294,401 @@ static void decodeDracoMeshes(FFilamentAsset* asset) {
         return (cgltf_accessor*) nullptr;
     };
 
-    // Go through every primitive and check if it has a Draco mesh.
-    for (auto pair : asset->mPrimitives) {
-        const cgltf_primitive* prim = pair.first;
-        VertexBuffer* vb = pair.second;
-        if (!prim->has_draco_mesh_compression) {
-            continue;
-        }
+    const cgltf_draco_mesh_compression& draco = prim->draco_mesh_compression;
+
+    // Check if we have already decoded this mesh.
+    DracoMesh* mesh = dracoCache->findOrCreateMesh(draco.buffer_view);
+    if (!mesh) {
+        slog.w << "Cannot decompress mesh, Draco decoding error." << io::endl;
+        return;
+    }
+
+    // Copy over the decompressed data, converting the data type if necessary.
+    if (prim->indices) {
+        mesh->getFaceIndices(prim->indices);
+    }
+
+    // Go through each attribute in the decompressed mesh.
+    for (cgltf_size i = 0; i < draco.attributes_count; i++) {
 
-        const cgltf_draco_mesh_compression& draco = prim->draco_mesh_compression;
+        // In cgltf, each Draco attribute's data pointer is an attribute id, not an accessor.
+        const uint32_t id = draco.attributes[i].data - asset->mSourceAsset->hierarchy->accessors;
 
-        // Check if we have already decoded this mesh.
-        DracoMesh* mesh = dracoCache->findOrCreateMesh(draco.buffer_view);
-        if (!mesh) {
-            slog.w << "Cannot decompress mesh, Draco decoding error." << io::endl;
+        // Find the destination accessor; this contains the desired component type, etc.
+        const cgltf_attribute_type type = draco.attributes[i].type;
+        const cgltf_int index = draco.attributes[i].index;
+        cgltf_accessor* accessor = findAccessor(prim, type, index);
+        if (!accessor) {
+            slog.w << "Cannot find matching accessor for Draco id " << id << io::endl;
             continue;
         }
 
         // Copy over the decompressed data, converting the data type if necessary.
-        if (prim->indices) {
-            mesh->getFaceIndices(prim->indices);
+        mesh->getVertexAttributes(id, accessor);
+    }
+}
+
+static void normalizeWeights(cgltf_accessor* data) {
+    if (data->type != cgltf_type_vec4 || data->component_type != cgltf_component_type_r_32f) {
+        slog.w << "Cannot normalize weights, unsupported attribute type." << io::endl;
+        return;
+    }
+    uint8_t* bytes = (uint8_t*) data->buffer_view->buffer->data;
+    bytes += data->offset + data->buffer_view->offset;
+    for (cgltf_size i = 0, n = data->count; i < n; ++i, bytes += data->stride) {
+        float4* weights = (float4*) bytes;
+        const float sum = weights->x + weights->y + weights->z + weights->w;
+        *weights /= sum;
+    }
+}
+
+static void normalizePrimitiveWeights(const cgltf_primitive& prim) {
+    for (cgltf_size aindex = 0, acount = prim.attributes_count; aindex < acount; ++aindex) {
+        const auto& attr = prim.attributes[aindex];
+        if (attr.type == cgltf_attribute_type_weights) {
+            normalizeWeights(attr.data);
+        }
+    }
+}
+
+// Filament does not support 8-bit indices, so they are widened to 16 bits in a malloc'd buffer.
+// 32-bit indices are narrowed when they all fit, see AssetConfiguration::compactGeometry.
+static uint16_t* convertIndices(const cgltf_accessor* accessor) {
+    if (accessor->component_type == cgltf_component_type_r_32u) {
+        uint16_t* data16 = (uint16_t*) malloc(accessor->count * sizeof(uint16_t));
+        for (cgltf_size i = 0, n = accessor->count; i < n; ++i) {
+            data16[i] = uint16_t(cgltf_accessor_read_index(accessor, i));
         }
+        return data16;
+    }
+    auto bufferData = (const uint8_t*) accessor->buffer_view->buffer->data;
+    const uint8_t* data = computeBindingOffset(accessor) + bufferData;
+    const uint32_t size = computeBindingSize(accessor);
+    uint16_t* data16 = (uint16_t*) malloc(size * 2);
+    convertBytesToShorts(data16, data, size);
+    return data16;
+}
 
-        // Go through each attribute in the decompressed mesh.
-        for (cgltf_size i = 0; i < draco.attributes_count; i++) {
+// Quantizes texture coordinates to normalized shorts in a malloc'd buffer. The accessor bounds
+// guarantee the range, clamping only guards against bounds that are slightly off.
+static uint16_t* quantizeTexCoords(const cgltf_accessor* accessor, bool isSigned) {
+    const cgltf_size count = accessor->count * 2;
+    std::vector<float> unpacked(count);
+    cgltf_accessor_unpack_floats(accessor, unpacked.data(), count);
+    uint16_t* data16 = (uint16_t*) malloc(count * sizeof(uint16_t));
+    for (cgltf_size i = 0; i < count; ++i) {
+        data16[i] = isSigned ?
+                uint16_t(int16_t(std::round(std::clamp(unpacked[i], -1.0f, 1.0f) * 32767.0f))) :
+                uint16_t(std::round(std::clamp(unpacked[i], 0.0f, 1.0f) * 65535.0f));
+    }
+    return data16;
+}
 
-            // In cgltf, each Draco attribute's data pointer is an attribute id, not an accessor.
-            const uint32_t id = draco.attributes[i].data - asset->mSourceAsset->hierarchy->accessors;
+// Converts the data of a buffer slot into the format of its buffer, in a malloc'd buffer. Returns
+// null if the data can be uploaded as it is.
+static uint16_t* convertSlotData(const BufferSlot& slot) {
+    const cgltf_accessor* accessor = slot.accessor;
+    if (!accessor->buffer_view) {
+        return nullptr;
+    }
+    switch (slot.conversion) {
+        case SlotConversion::NARROW_INDICES:
+            return convertIndices(accessor);
+        case SlotConversion::QUANTIZE_UNSIGNED:
+        case SlotConversion::QUANTIZE_SIGNED:
+            return quantizeTexCoords(accessor, slot.conversion == SlotConversion::QUANTIZE_SIGNED);
+        case SlotConversion::NONE:
+            break;
+    }
+    if (slot.indexBuffer && accessor->component_type == cgltf_component_type_r_8u) {
+        return convertIndices(accessor);
+    }
+    return nullptr;
+}
 
-            // Find the destination accessor; this contains the desired component type, etc.
-            const cgltf_attribute_type type = draco.attributes[i].type;
-            const cgltf_int index = draco.attributes[i].index;
-            cgltf_accessor* accessor = findAccessor(prim, type, index);
-            if (!accessor) {
-                slog.w << "Cannot find matching accessor for Draco id " << id << io::endl;
-                continue;
+// Applies the sparse data of the given accessor to its base array, in a malloc'd buffer.
+static float* unpackSparseData(const cgltf_accessor* accessor, cgltf_size* numBytes) {
+    cgltf_size numFloats = accessor->count * cgltf_num_components(accessor->type);
+    *numBytes = sizeof(float) * numFloats;
+    float* generated = (float*) malloc(*numBytes);
+    cgltf_accessor_unpack_floats(accessor, generated, numFloats);
+    return generated;
+}
+
+// Blended primitives are drawn in the order of their triangles, so only opaque and masked
+// triangle lists are reordered.
+static bool isOptimizable(const cgltf_primitive* prim) {
+    const cgltf_accessor* indices = prim->indices;
+    return prim->type == cgltf_primitive_type_triangles && indices && indices->buffer_view &&
+            !indices->is_sparse && indices->count % 3 == 0 &&
+            !(prim->material && prim->material->alpha_mode == cgltf_alpha_mode_blend);
+}
+
+template<typename T>
+static void optimizeTriangles(T* indices, size_t indexCount, const cgltf_accessor* positions,
+        MeshStatistics* stats) {
+    const size_t vertexCount = positions->count;
+    std::vector<float> xyz(vertexCount * 3);
+    cgltf_accessor_unpack_floats(positions, xyz.data(), xyz.size());
+
+    const meshopt_VertexCacheStatistics before = meshopt_analyzeVertexCache(indices, indexCount,
+            vertexCount, 16, 0, 0);
+
+    // Overdraw is reduced as long as it doesn't transform more than 5% more vertices.
+    meshopt_optimizeVertexCache(indices, indices, indexCount, vertexCount);
+    meshopt_optimizeOverdraw(indices, indices, indexCount, xyz.data(), vertexCount,
+            3 * sizeof(float), 1.05f);
+
+    const meshopt_VertexCacheStatistics after = meshopt_analyzeVertexCache(indices, indexCount,
+            vertexCount, 16, 0, 0);
+
+    stats->primitives++;
+    stats->triangles += indexCount / 3;
+    stats->vertices += vertexCount;
+    stats->transformedBefore += before.vertices_transformed;
+    stats->transformedAfter += after.vertices_transformed;
+}
+
+static const cgltf_accessor* getPositions(const cgltf_primitive* prim) {
+    const cgltf_accessor* positions = nullptr;
+    for (cgltf_size i = 0; i < prim->attributes_count; i++) {
+        if (prim->attributes[i].type == cgltf_attribute_type_position) {
+            positions = prim->attributes[i].data;
+        }
+    }
+    return positions;
+}
+
+// Reorders the triangles of a primitive for the post-transform vertex cache, then for overdraw.
+// This is done in place, in the glTF buffer or in the widened 8-bit indices. The vertices are left
+// in place because they can be shared with other primitives and with morph targets.
+static void optimizeIndices(const cgltf_primitive* prim, uint16_t* indices16,
+        MeshStatistics* stats) {
+    const cgltf_accessor* positions = getPositions(prim);
+    if (!positions) {
+        return;
+    }
+    const cgltf_accessor* accessor = prim->indices;
+    uint8_t* data = (uint8_t*) accessor->buffer_view->buffer->data + computeBindingOffset(accessor);
+    if (indices16) {
+        optimizeTriangles(indices16, accessor->count, positions, stats);
+    } else if (accessor->component_type == cgltf_component_type_r_16u) {
+        optimizeTriangles((uint16_t*) data, accessor->count, positions, stats);
+    } else if (accessor->component_type == cgltf_component_type_r_32u) {
+        optimizeTriangles((uint32_t*) data, accessor->count, positions, stats);
+    }
+}
+
+// Generates the coarser levels of detail of a primitive, each level is simplified from the previous
+// one down to about half of its triangles. This stops early when the simplification can't make
+// progress without exceeding the error bound, which is relative to the extent of the mesh and
+// grows with each level since coarser levels are seen from further away.
+static void simplifyIndices(const cgltf_primitive* prim, const uint16_t* indices16,
+        size_t levels, bool optimize, LodIndices* lods) {
+    const cgltf_accessor* positions = getPositions(prim);
+    if (!positions) {
+        return;
+    }
+    const cgltf_accessor* accessor = prim->indices;
+    std::vector<uint32_t> source(accessor->count);
+    for (size_t i = 0; i < source.size(); i++) {
+        source[i] = indices16 ? indices16[i] : uint32_t(cgltf_accessor_read_index(accessor, i));
+    }
+
+    const size_t vertexCount = positions->count;
+    std::vector<float> xyz(vertexCount * 3);
+    cgltf_accessor_unpack_floats(positions, xyz.data(), xyz.size());
+
+    std::vector<uint32_t> simplified(source.size());
+    float error = 0.01f;
+    for (size_t level = 1; level < levels; level++, error *= 2.0f) {
+        const size_t target = source.size() / 6 * 3;
+        size_t count = meshopt_simplify(simplified.data(), source.data(), source.size(),
+                xyz.data(), vertexCount, 3 * sizeof(float), target, error);
+        if (count == 0 || count >= source.size() * 3 / 4) {
+            break;
+        }
+        if (optimize) {
+            meshopt_optimizeVertexCache(simplified.data(), simplified.data(), count, vertexCount);
+        }
+        lods->indices.insert(lods->indices.end(), simplified.begin(), simplified.begin() + count);
+        lods->counts.push_back(uint32_t(count));
+        source.assign(simplified.begin(), simplified.begin() + count);
+    }
+}
+
+static void reportMeshStatistics(const MeshStatistics& stats) {
+    if (stats.primitives == 0) {
+        return;
+    }
+    const float triangles = stats.triangles;
+    const float vertices = stats.vertices;
+    slog.i << "Optimized " << stats.primitives << " primitives, ACMR "
+            << stats.transformedBefore / triangles << " -> " << stats.transformedAfter / triangles
+            << ", ATVR " << stats.transformedBefore / vertices << " -> "
+            << stats.transformedAfter / vertices << io::endl;
+}
+
+static Aabb computePrimitiveBounds(const cgltf_primitive* prim) {
+    Aabb aabb;
+    for (cgltf_size slot = 0; slot < prim->attributes_count; slot++) {
+        const cgltf_attribute& attr = prim->attributes[slot];
+        const cgltf_accessor* accessor = attr.data;
+        const size_t dim = cgltf_num_components(accessor->type);
+        if (attr.type == cgltf_attribute_type_position && dim >= 3) {
+            std::vector<float> unpacked(accessor->count * dim);
+            cgltf_accessor_unpack_floats(accessor, unpacked.data(), unpacked.size());
+            for (cgltf_size i = 0, j = 0, n = accessor->count; i < n; ++i, j += dim) {
+                float3 pt(unpacked[j + 0], unpacked[j + 1], unpacked[j + 2]);
+                aabb.min = min(aabb.min, pt);
+                aabb.max = max(aabb.max, pt);
             }
+            break;
+        }
+    }
+    return aabb;
+}
+
+// Besides PNG and JPEG, textures can reference KTX images holding block-compressed mips (ASTC,
+// ETC2 or BC). These are uploaded as they are, without being decoded nor mipmapped at runtime.
+static const uint8_t KTX_MAGIC[] = {
+        0xab, 0x4b, 0x54, 0x58, 0x20, 0x31, 0x31, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a };
+static constexpr size_t KTX_HEADER_SIZE = 64;
+
+static bool isKtx(const uint8_t* data, size_t size) {
+    return size >= KTX_HEADER_SIZE && memcmp(data, KTX_MAGIC, sizeof(KTX_MAGIC)) == 0;
+}
+
+// Determines the dimensions of an image, and for a KTX image its format, which must be supported
+// by the engine. Only the header of a KTX image is needed.
+static bool getTextureInfo(Engine& engine, const uint8_t* data, size_t size,
+        TextureCacheEntry* entry) {
+    if (!isKtx(data, size)) {
+        return stbi_info_from_memory(data, size, &entry->width, &entry->height,
+                &entry->numComponents);
+    }
+    uint32_t fields[13];
+    memcpy(fields, data + sizeof(KTX_MAGIC), sizeof(fields));
+    const image::KtxInfo info = { fields[0], fields[1], fields[2], fields[3], fields[4],
+            fields[5], fields[6], fields[7], fields[8] };
+    const uint32_t numArrayElements = fields[9];
+    const uint32_t numFaces = fields[10];
+    const uint32_t numMipLevels = fields[11];
+    if (info.endianness != image::KtxBundle::ENDIAN_DEFAULT || !image::ktx::isCompressed(info) ||
+            info.pixelDepth > 1 || numArrayElements > 1 || numFaces > 1) {
+        return false;
+    }
+    entry->isKtx = true;
+    entry->ktxFormat = image::ktx::toTextureFormat(info);
+    entry->ktxLevels = uint8_t(std::max(numMipLevels, 1u));
+    entry->width = int(info.pixelWidth);
+    entry->height = int(info.pixelHeight);
+    return uint32_t(entry->ktxFormat) != 0xffff &&
+            Texture::isTextureFormatSupported(engine, entry->ktxFormat);
+}
+
+// Textures in a TextureCache are identified by their content, or by their path for files.
+static std::string getSharedKey(const uint8_t* data, size_t size, bool srgb) {
+    const size_t hash = std::hash<std::string_view>{}(std::string_view((const char*) data, size));
+    return std::to_string(hash) + ":" + std::to_string(size) + (srgb ? ":srgb" : "");
+}
+
+static std::string getSharedKey(const char* path, bool srgb) {
+    return std::string("file:") + path + (srgb ? ":srgb" : "");
+}
+
+static const char* getTextureFailureReason(const TextureCacheEntry* entry) {
+    return entry->isKtx ? "unsupported KTX format" : stbi_failure_reason();
+}
+
+// Decodes an image on the calling thread. KTX images only need to be parsed.
+static void decodeTexture(TextureCacheEntry* entry, const uint8_t* data, size_t size) {
+    if (entry->isKtx) {
+        entry->ktx = new image::KtxBundle(data, uint32_t(size));
+        return;
+    }
+    int width, height, comp;
+    entry->texels = stbi_load_from_memory(data, size, &width, &height, &comp, 4);
+}
 
-            // Copy over the decompressed data, converting the data type if necessary.
-            mesh->getVertexAttributes(id, accessor);
+#if USE_FILESYSTEM
+static void decodeTextureFile(TextureCacheEntry* entry, const Path& path) {
+    if (entry->isKtx) {
+        std::ifstream in(path.c_str(), std::ifstream::binary | std::ifstream::ate);
+        std::vector<uint8_t> contents(std::max<std::streamoff>(in.tellg(), 0));
+        in.seekg(0);
+        if (in.read((char*) contents.data(), contents.size()) &&
+                isKtx(contents.data(), contents.size())) {
+            entry->ktx = new image::KtxBundle(contents.data(), uint32_t(contents.size()));
         }
+        return;
     }
+    int width, height, comp;
+    entry->texels = stbi_load(path.c_str(), &width, &height, &comp, 4);
+}
+#endif
+
+// Uploads the mips of a KTX image as they are, the bundle is destroyed once all of them have
+// been consumed.
+static void uploadCompressedMips(Engine& engine, Texture* texture, image::KtxBundle* ktx) {
+    struct Userdata {
+        uint32_t remainingBuffers;
+        image::KtxBundle* ktx;
+    };
+    const uint32_t nmips = std::min<uint32_t>(ktx->getNumMipLevels(), texture->getLevels());
+    Userdata* user = new Userdata { nmips, ktx };
+    auto callback = [](void*, size_t, void* userptr) {
+        Userdata* user = (Userdata*) userptr;
+        if (--user->remainingBuffers == 0) {
+            delete user->ktx;
+            delete user;
+        }
+    };
+    const auto type = image::ktx::toCompressedPixelDataType(ktx->getInfo());
+    for (uint32_t level = 0; level < nmips; ++level) {
+        uint8_t* data;
+        uint32_t size;
+        ktx->getBlob({ level, 0, 0 }, &data, &size);
+        Texture::PixelBufferDescriptor pbd(data, size, type, size, callback, user);
+        texture->setImage(engine, level, std::move(pbd));
+    }
+}
+
+// Checks if all the buffers used by the given primitive have been loaded.
+static bool isPrimitiveAvailable(const cgltf_primitive* prim) {
+    auto isLoaded = [](const cgltf_buffer_view* view) {
+        return !view || view->buffer->data;
+    };
+    auto isAccessorLoaded = [isLoaded](const cgltf_accessor* accessor) {
+        if (!accessor) {
+            return true;
+        }
+        if (accessor->is_sparse && (!isLoaded(accessor->sparse.indices_buffer_view) ||
+                !isLoaded(accessor->sparse.values_buffer_view))) {
+            return false;
+        }
+        return isLoaded(accessor->buffer_view);
+    };
+    if (prim->has_draco_mesh_compression && !isLoaded(prim->draco_mesh_compression.buffer_view)) {
+        return false;
+    }
+    if (!isAccessorLoaded(prim->indices)) {
+        return false;
+    }
+    for (cgltf_size i = 0; i < prim->attributes_count; i++) {
+        if (!isAccessorLoaded(prim->attributes[i].data)) {
+            return false;
+        }
+    }
+    for (cgltf_size t = 0; t < prim->targets_count; t++) {
+        const cgltf_morph_target& target = prim->targets[t];
+        for (cgltf_size i = 0; i < target.attributes_count; i++) {
+            if (!isAccessorLoaded(target.attributes[i].data)) {
+                return false;
+            }
+        }
+    }
+    return true;
 }
 
 // Parses a data URI and returns a blob that gets malloc'd in cgltf, which the caller must free.
@@ -311,9 +760,11 @@ bool ResourceLoader::loadResources(FFilamentAsset* asset, bool async) {
     SYSTRACE_CONTEXT();
     SYSTRACE_ASYNC_END("addResourceData", 1);
 
-    if (asset->mResourcesLoaded) {
+    if (asset->mResourcesLoaded || pImpl->mProgressiveAsset) {
         return false;
     }
+    pImpl->mNumRequestedUris = 0;
+    asset->mSourceAsset->dracoCache.setPersistentCachePath(pImpl->mDracoCachePath.c_str());
     const cgltf_data* gltf = asset->mSourceAsset->hierarchy;
     cgltf_options options {};
 
@@ -395,16 +846,19 @@ bool ResourceLoader::loadResources(FFilamentAsset* asset, bool async) {
     }
     #endif
 
-    // Decompress Draco meshes early on, which allows us to exploit subsequent processing such as
-    // tangent generation.
-    decodeDracoMeshes(asset);
+    // Prepare the CPU-side data of every primitive in parallel: Draco decompression, weights
+    // normalization, index and attribute conversion, sparse data, tangents and bounds.
+    std::vector<TangentsJob::Params> tangents;
+    pImpl->preparePrimitives(asset, tangents);
 
-    // Normalize skinning weights, then "import" each skin into the asset by building a mapping of
-    // skins to their affected entities.
+    // Position the instances of EXT_mesh_gpu_instancing nodes, now that their data is available.
+    TransformManager& tm = pImpl->mEngine->getTransformManager();
+    for (const MeshInstances& instances : asset->mMeshInstances) {
+        applyMeshInstances(tm, instances);
+    }
+
+    // "Import" each skin into the asset by building a mapping of skins to their affected entities.
     if (gltf->skins_count > 0) {
-        if (pImpl->mNormalizeSkinningWeights) {
-            normalizeSkinningWeights(asset);
-        }
         if (!asset->isInstanced()) {
             importSkins(gltf, asset->mNodeMap, asset->mSkins);
         } else {
@@ -420,88 +874,553 @@ bool ResourceLoader::loadResources(FFilamentAsset* asset, bool async) {
         updateBoundingBoxes(asset);
     }
 
-    Engine& engine = *pImpl->mEngine;
+    // Upload VertexBuffer and IndexBuffer data to the GPU. This must be done from the main thread,
+    // so all buffers are uploaded in one batch once the jobs above are done.
+    pImpl->uploadSharedBuffers(asset);
+    for (size_t i = 0, n = asset->mBufferSlots.size(); i < n; ++i) {
+        const BufferSlot& slot = asset->mBufferSlots[i];
+        pImpl->uploadBufferSlot(asset, slot, pImpl->mConvertedData[i]);
+        pImpl->applySparseData(asset, slot, pImpl->mSparseData[i]);
+    }
+    pImpl->mConvertedData.clear();
+    pImpl->mSparseData.clear();
+    pImpl->uploadTangents(asset, tangents);
+    pImpl->createLevelsOfDetail(asset);
 
-    // Upload VertexBuffer and IndexBuffer data to the GPU.
-    for (auto slot : asset->mBufferSlots) {
-        const cgltf_accessor* accessor = slot.accessor;
-        if (!accessor->buffer_view) {
+    // Non-textured renderables are now considered ready, so notify the dependency graph.
+    asset->mDependencyGraph.finalize();
+    pImpl->mCurrentAsset = asset;
+
+    // Finally, create Filament Textures and begin loading image files.
+    asset->mResourcesLoaded = pImpl->createTextures(async);
+    return asset->mResourcesLoaded;
+}
+
+bool ResourceLoader::asyncBeginLoad(FilamentAsset* asset) {
+    return loadResources(upcast(asset), true);
+}
+
+bool ResourceLoader::asyncBeginLoad(FilamentAsset* asset, FetchCallback fetch, void* user) {
+    SYSTRACE_CALL();
+    FFilamentAsset* fasset = upcast(asset);
+    if (!fetch) {
+        return loadResources(fasset, true);
+    }
+    if (fasset->mResourcesLoaded || pImpl->mProgressiveAsset) {
+        return false;
+    }
+    fasset->mSourceAsset->dracoCache.setPersistentCachePath(pImpl->mDracoCachePath.c_str());
+    cgltf_data* gltf = (cgltf_data*) fasset->mSourceAsset->hierarchy;
+    cgltf_options options {};
+
+    if (gltf->buffers_count && !gltf->buffers[0].data && !gltf->buffers[0].uri && gltf->bin) {
+        if (gltf->bin_size < gltf->buffers[0].size) {
+            slog.e << "Bad size." << io::endl;
+            return false;
+        }
+        gltf->buffers[0].data = (void*) gltf->bin;
+    }
+
+    // Decode the data URIs right away, and collect the external resources that are not yet in
+    // the URI cache.
+    std::vector<std::string>& pendingUris = pImpl->mPendingUris;
+    pendingUris.clear();
+    auto request = [this, &pendingUris](const char* uri) {
+        if (!hasResourceData(uri) &&
+                std::find(pendingUris.begin(), pendingUris.end(), uri) == pendingUris.end()) {
+            pendingUris.emplace_back(uri);
+        }
+    };
+    for (cgltf_size i = 0; i < gltf->buffers_count; ++i) {
+        cgltf_buffer& buffer = gltf->buffers[i];
+        if (buffer.data || !buffer.uri) {
             continue;
         }
-        auto bufferData = (const uint8_t*) accessor->buffer_view->buffer->data;
-        const uint8_t* data = computeBindingOffset(accessor) + bufferData;
-        const uint32_t size = computeBindingSize(accessor);
-        if (slot.vertexBuffer) {
-            BufferObject* bo = BufferObject::Builder().size(size).build(engine);
-            asset->mBufferObjects.push_back(bo);
-            bo->setBuffer(engine, BufferDescriptor(data, size,
-                    uploadCallback, uploadUserdata(asset)));
-            slot.vertexBuffer->setBufferObjectAt(engine, slot.bufferIndex, bo);
+        if (strncmp(buffer.uri, "data:", 5) == 0) {
+            const char* comma = strchr(buffer.uri, ',');
+            if (!comma || comma - buffer.uri < 7 || strncmp(comma - 7, ";base64", 7) != 0 ||
+                    cgltf_load_buffer_base64(&options, buffer.size, comma + 1, &buffer.data)
+                            != cgltf_result_success) {
+                slog.e << "Unable to load " << buffer.uri << io::endl;
+                return false;
+            }
             continue;
         }
-        assert(slot.indexBuffer);
-        if (accessor->component_type == cgltf_component_type_r_8u) {
-            const size_t size16 = size * 2;
-            uint16_t* data16 = (uint16_t*) malloc(size16);
-            convertBytesToShorts(data16, data, size);
-            IndexBuffer::BufferDescriptor bd(data16, size16, FREE_CALLBACK);
-            slot.indexBuffer->setBuffer(engine, std::move(bd));
+        request(buffer.uri);
+    }
+    for (cgltf_size i = 0; i < gltf->images_count; ++i) {
+        const cgltf_image& image = gltf->images[i];
+        if (image.uri && !image.buffer_view && strncmp(image.uri, "data:", 5) != 0) {
+            request(image.uri);
+        }
+    }
+
+    // All geometry is pending until its buffers arrive, then it's uploaded by asyncUpdateLoad.
+    for (auto pair : fasset->mPrimitives) {
+        fasset->mDependencyGraph.markAsPending(pair.second);
+    }
+    fasset->mDependencyGraph.finalize();
+
+    pImpl->mProgressiveAsset = fasset;
+    pImpl->mCurrentAsset = fasset;
+    pImpl->mNumDecoderTasks = 0;
+    pImpl->mNumDecoderTasksFinished = 0;
+    pImpl->mNumRequestedUris = pendingUris.size();
+    pImpl->mUploadedSlots.assign(fasset->mBufferSlots.size(), false);
+    pImpl->mUploadedPrimitives.assign(fasset->mPrimitives.size(), false);
+
+    // The callback could add the resource immediately, which doesn't modify the pending list.
+    for (size_t i = 0, n = pendingUris.size(); i < n; ++i) {
+        fetch(pendingUris[i].c_str(), user);
+    }
+
+    updateProgressiveLoad();
+    return true;
+}
+
+void ResourceLoader::updateProgressiveLoad() {
+    FFilamentAsset* asset = pImpl->mProgressiveAsset;
+    if (!asset) {
+        return;
+    }
+
+    pImpl->resolvePendingUris(asset);
+
+    // Upload the geometry of the primitives whose buffers have all arrived.
+    for (size_t i = 0, n = asset->mPrimitives.size(); i < n; ++i) {
+        if (!pImpl->mUploadedPrimitives[i] && isPrimitiveAvailable(asset->mPrimitives[i].first)) {
+            pImpl->uploadPrimitive(asset, i);
+        }
+    }
+
+    if (!pImpl->mPendingUris.empty()) {
+        return;
+    }
+
+    // Everything has arrived, finish the load the same way as loadResources().
+    pImpl->mProgressiveAsset = nullptr;
+    reportMeshStatistics(pImpl->mMeshStatistics);
+    pImpl->mMeshStatistics = {};
+    const cgltf_data* gltf = asset->mSourceAsset->hierarchy;
+
+    #ifndef NDEBUG
+    if (cgltf_validate((cgltf_data*) gltf) != cgltf_result_success) {
+        slog.e << "Failed cgltf validation." << io::endl;
+    }
+    #endif
+
+    TransformManager& tm = pImpl->mEngine->getTransformManager();
+    for (const MeshInstances& instances : asset->mMeshInstances) {
+        applyMeshInstances(tm, instances);
+    }
+
+    if (gltf->skins_count > 0) {
+        if (!asset->isInstanced()) {
+            importSkins(gltf, asset->mNodeMap, asset->mSkins);
+        } else {
+            for (FFilamentInstance* instance : asset->mInstances) {
+                importSkins(gltf, instance->nodeMap, instance->skins);
+            }
+        }
+    }
+
+    if (pImpl->mRecomputeBoundingBoxes) {
+        updateBoundingBoxes(asset);
+    }
+
+    asset->mResourcesLoaded = pImpl->createTextures(true);
+}
+
+void ResourceLoader::Impl::resolvePendingUris(FFilamentAsset* asset) {
+    cgltf_data* gltf = (cgltf_data*) asset->mSourceAsset->hierarchy;
+    for (size_t i = 0; i < mPendingUris.size();) {
+        auto iter = mUriDataCache.find(mPendingUris[i]);
+        if (iter == mUriDataCache.end()) {
+            i++;
             continue;
         }
-        IndexBuffer::BufferDescriptor bd(data, size, uploadCallback, uploadUserdata(asset));
-        slot.indexBuffer->setBuffer(engine, std::move(bd));
+        for (cgltf_size b = 0; b < gltf->buffers_count; ++b) {
+            cgltf_buffer& buffer = gltf->buffers[b];
+            if (buffer.data || !buffer.uri || mPendingUris[i] != buffer.uri) {
+                continue;
+            }
+            // The primitives using a buffer that is too small are never uploaded.
+            if (iter->second.size < buffer.size) {
+                slog.e << "Bad size for external resource: " << buffer.uri << io::endl;
+                continue;
+            }
+            // Make a copy to allow cgltf_free() to work as expected, like loadResources() does.
+            buffer.data = malloc(iter->second.size);
+            memcpy(buffer.data, iter->second.buffer, iter->second.size);
+        }
+        mPendingUris[i] = std::move(mPendingUris.back());
+        mPendingUris.pop_back();
     }
+}
 
-    // Apply sparse data modifications to base arrays, then upload the result.
-    applySparseData(asset);
+void ResourceLoader::Impl::uploadPrimitive(FFilamentAsset* asset, size_t index) {
+    SYSTRACE_CALL();
+    const cgltf_primitive* prim = asset->mPrimitives[index].first;
+    VertexBuffer* vb = asset->mPrimitives[index].second;
 
-    // Compute surface orientation quaternions if necessary. This is similar to sparse data in that
-    // we need to generate the contents of a GPU buffer by processing one or more CPU buffer(s).
-    pImpl->computeTangents(asset);
+    decodeDracoMesh(asset, prim);
+    if (mNormalizeSkinningWeights) {
+        normalizePrimitiveWeights(*prim);
+    }
 
-    // Non-textured renderables are now considered ready, so notify the dependency graph.
-    asset->mDependencyGraph.finalize();
-    pImpl->mCurrentAsset = asset;
+    // Index buffer slots don't refer to their primitive, but to the same accessor.
+    for (size_t i = 0, n = asset->mBufferSlots.size(); i < n; ++i) {
+        const BufferSlot& slot = asset->mBufferSlots[i];
+        const bool owned = slot.vertexBuffer ? slot.vertexBuffer == vb :
+                slot.accessor == prim->indices;
+        if (owned && !mUploadedSlots[i]) {
+            mUploadedSlots[i] = true;
+            uint16_t* converted = nullptr;
+            if (slot.indexBuffer && mOptimizeMeshes && isOptimizable(prim)) {
+                converted = convertSlotData(slot);
+                optimizeIndices(prim, converted, &mMeshStatistics);
+            }
+            uploadBufferSlot(asset, slot, converted);
+            applySparseData(asset, slot);
+        }
+    }
 
-    // Finally, create Filament Textures and begin loading image files.
-    asset->mResourcesLoaded = pImpl->createTextures(async);
-    return asset->mResourcesLoaded;
+    computeTangents(asset, vb);
+
+    mUploadedPrimitives[index] = true;
+    asset->mDependencyGraph.markAsReady(vb);
 }
 
-bool ResourceLoader::asyncBeginLoad(FilamentAsset* asset) {
-    return loadResources(upcast(asset), true);
+void ResourceLoader::Impl::createLevelsOfDetail(FFilamentAsset* asset) {
+    SYSTRACE_CALL();
+    const size_t levels = asset->mLevelsOfDetail;
+    for (size_t i = 0, n = mLodIndices.size(); i < n; ++i) {
+        const LodIndices& lods = mLodIndices[i];
+        if (lods.counts.empty()) {
+            continue;
+        }
+        IndexBuffer* indices = IndexBuffer::Builder()
+            .indexCount(lods.indices.size())
+            .bufferType(IndexBuffer::IndexType::UINT)
+            .build(*mEngine);
+        const size_t size = lods.indices.size() * sizeof(uint32_t);
+        uint32_t* data = (uint32_t*) malloc(size);
+        memcpy(data, lods.indices.data(), size);
+        indices->setBuffer(*mEngine, IndexBuffer::BufferDescriptor(data, size, FREE_CALLBACK));
+        asset->mIndexBuffers.push_back(indices);
+
+        // Levels that couldn't be simplified further reuse the last simplified level.
+        LodGeometry geometry;
+        geometry.indices = indices;
+        for (size_t level = 1, offset = 0; level < levels; ++level) {
+            if (level <= lods.counts.size()) {
+                geometry.offsets[level - 1] = offset;
+                geometry.counts[level - 1] = lods.counts[level - 1];
+                offset += lods.counts[level - 1];
+            } else {
+                geometry.offsets[level - 1] = geometry.offsets[level - 2];
+                geometry.counts[level - 1] = geometry.counts[level - 2];
+            }
+        }
+        asset->mLodGeometry[asset->mBufferSlots[i].indexBuffer] = geometry;
+    }
+    mLodIndices.clear();
+
+    if (asset->mLodGeometry.empty()) {
+        return;
+    }
+
+    // The renderables have already been created, with coarser levels that are copies of the
+    // first one. Nodes that use EXT_mesh_gpu_instancing have a renderable for each instance.
+    RenderableManager& rm = mEngine->getRenderableManager();
+    tsl::robin_map<Entity, const std::vector<Entity>*> meshInstances;
+    for (const MeshInstances& instances : asset->mMeshInstances) {
+        meshInstances[instances.node] = &instances.entities;
+    }
+    auto setLodGeometry = [&](const cgltf_mesh* mesh, Entity entity) {
+        auto prims = asset->mMeshCache.find(mesh);
+        auto instances = meshInstances.find(entity);
+        const Entity* entities = &entity;
+        size_t count = 1;
+        if (instances != meshInstances.end()) {
+            entities = instances->second->data();
+            count = instances->second->size();
+        }
+        for (size_t e = 0; e < count && prims != asset->mMeshCache.end(); ++e) {
+            RenderableManager::Instance ri = rm.getInstance(entities[e]);
+            for (size_t p = 0; ri && p < prims->second.size(); ++p) {
+                const Primitive& prim = prims->second[p];
+                auto lod = asset->mLodGeometry.find(prim.indices);
+                if (lod == asset->mLodGeometry.end()) {
+                    continue;
+                }
+                for (size_t level = 1; level < levels; ++level) {
+                    rm.setLodGeometryAt(ri, p, level, RenderableManager::PrimitiveType::TRIANGLES,
+                            prim.vertices, lod->second.indices, lod->second.offsets[level - 1],
+                            lod->second.counts[level - 1]);
+                }
+            }
+        }
+    };
+    auto setNodeMapLodGeometry = [&](const NodeMap& nodeMap) {
+        for (const auto& pair : nodeMap) {
+            if (pair.first->mesh) {
+                setLodGeometry(pair.first->mesh, pair.second);
+            }
+        }
+    };
+    if (!asset->isInstanced()) {
+        setNodeMapLodGeometry(asset->mNodeMap);
+    } else {
+        for (FFilamentInstance* instance : asset->mInstances) {
+            setNodeMapLodGeometry(instance->nodeMap);
+        }
+    }
+}
+
+void ResourceLoader::Impl::preparePrimitives(FFilamentAsset* asset,
+        std::vector<TangentsJob::Params>& tangents) {
+    SYSTRACE_CALL();
+    const auto& prims = asset->mPrimitives;
+    const auto& slots = asset->mBufferSlots;
+    const cgltf_data* gltf = asset->mSourceAsset->hierarchy;
+
+    // The work of a single job. Decoding a Draco mesh writes into the cache and into the accessors
+    // of every primitive that uses it, so these primitives are prepared by the same job. Likewise,
+    // each buffer slot and each weights accessor is handled by exactly one job.
+    struct Work {
+        std::vector<size_t> prims;
+        std::vector<size_t> slots;
+        std::vector<cgltf_accessor*> weights;
+        std::vector<TangentsJob::Params*> tangents;
+        std::vector<Aabb> bounds;
+        MeshStatistics statistics;
+    };
+    std::vector<Work> works;
+    tsl::robin_map<const cgltf_buffer_view*, size_t> dracoWorks;
+    tsl::robin_map<const VertexBuffer*, size_t> vertexBufferWorks;
+    tsl::robin_map<const cgltf_accessor*, size_t> indicesWorks;
+    tsl::robin_map<const cgltf_accessor*, const cgltf_primitive*> indicesPrims;
+    tsl::robin_map<const cgltf_accessor*, size_t> weightsWorks;
+    const bool normalize = mNormalizeSkinningWeights && gltf->skins_count > 0;
+    for (size_t i = 0; i < prims.size(); ++i) {
+        const cgltf_primitive* prim = prims[i].first;
+        size_t w = works.size();
+        if (prim->has_draco_mesh_compression) {
+            w = dracoWorks.emplace(prim->draco_mesh_compression.buffer_view, w).first->second;
+        }
+        if (w == works.size()) {
+            works.emplace_back();
+        }
+        works[w].prims.push_back(i);
+        vertexBufferWorks.emplace(prims[i].second, w);
+        if (prim->indices) {
+            indicesWorks.emplace(prim->indices, w);
+            indicesPrims.emplace(prim->indices, prim);
+        }
+        for (cgltf_size a = 0; normalize && a < prim->attributes_count; ++a) {
+            const cgltf_attribute& attr = prim->attributes[a];
+            if (attr.type == cgltf_attribute_type_weights &&
+                    weightsWorks.emplace(attr.data, w).second) {
+                works[w].weights.push_back(attr.data);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < slots.size(); ++i) {
+        const BufferSlot& slot = slots[i];
+        // Index buffer slots don't refer to their primitive, but to the same accessor.
+        if (slot.vertexBuffer) {
+            auto iter = vertexBufferWorks.find(slot.vertexBuffer);
+            if (iter != vertexBufferWorks.end()) {
+                works[iter->second].slots.push_back(i);
+            }
+        } else {
+            auto iter = indicesWorks.find(slot.accessor);
+            if (iter != indicesWorks.end()) {
+                works[iter->second].slots.push_back(i);
+            }
+        }
+    }
+
+    collectTangentJobs(asset, nullptr, tangents);
+    for (TangentsJob::Params& params : tangents) {
+        works[vertexBufferWorks[params.context.vb]].tangents.push_back(&params);
+    }
+
+    mConvertedData.assign(slots.size(), nullptr);
+    mSparseData.assign(slots.size(), nullptr);
+    mLodIndices.assign(slots.size(), {});
+
+    auto prepare = [this, asset, &indicesPrims](Work& work) {
+        const auto& prims = asset->mPrimitives;
+        const auto& slots = asset->mBufferSlots;
+
+        // Decompress Draco meshes first, which allows us to exploit subsequent processing such
+        // as tangent generation.
+        for (size_t i : work.prims) {
+            decodeDracoMesh(asset, prims[i].first);
+        }
+        for (cgltf_accessor* accessor : work.weights) {
+            normalizeWeights(accessor);
+        }
+        for (size_t i : work.slots) {
+            const cgltf_accessor* accessor = slots[i].accessor;
+            mConvertedData[i] = convertSlotData(slots[i]);
+            if (slots[i].indexBuffer && isOptimizable(indicesPrims[accessor])) {
+                const cgltf_primitive* prim = indicesPrims[accessor];
+                if (mOptimizeMeshes) {
+                    optimizeIndices(prim, mConvertedData[i], &work.statistics);
+                }
+                if (asset->mLevelsOfDetail > 1) {
+                    simplifyIndices(prim, mConvertedData[i], asset->mLevelsOfDetail,
+                            mOptimizeMeshes, &mLodIndices[i]);
+                }
+            }
+            if (accessor->is_sparse) {
+                cgltf_size numBytes;
+                mSparseData[i] = unpackSparseData(accessor, &numBytes);
+            }
+        }
+        for (TangentsJob::Params* params : work.tangents) {
+            TangentsJob::run(params, &mEngine->getJobSystem());
+        }
+        if (mRecomputeBoundingBoxes) {
+            for (size_t i : work.prims) {
+                work.bounds.push_back(computePrimitiveBounds(prims[i].first));
+            }
+        }
+    };
+
+    // Kick off a job for each group of primitives.
+    JobSystem* js = &mEngine->getJobSystem();
+    JobSystem::Job* parent = js->createJob();
+    for (Work& work : works) {
+        Work* wptr = &work;
+        js->run(jobs::createJob(*js, parent, [prepare, wptr] { prepare(*wptr); }),
+                JobSystem::BACKGROUND);
+    }
+    js->runAndWait(parent, JobSystem::BACKGROUND);
+
+    mPrimitiveBounds.clear();
+    MeshStatistics statistics;
+    for (const Work& work : works) {
+        for (size_t i = 0; i < work.bounds.size(); ++i) {
+            mPrimitiveBounds[prims[work.prims[i]].first] = work.bounds[i];
+        }
+        statistics.primitives += work.statistics.primitives;
+        statistics.triangles += work.statistics.triangles;
+        statistics.vertices += work.statistics.vertices;
+        statistics.transformedBefore += work.statistics.transformedBefore;
+        statistics.transformedAfter += work.statistics.transformedAfter;
+    }
+    reportMeshStatistics(statistics);
+}
+
+void ResourceLoader::Impl::uploadBufferSlot(FFilamentAsset* asset, const BufferSlot& slot,
+        uint16_t* converted) {
+    Engine& engine = *mEngine;
+    const cgltf_accessor* accessor = slot.accessor;
+    if (!accessor->buffer_view) {
+        return;
+    }
+    if (!converted) {
+        converted = convertSlotData(slot);
+    }
+    if (converted) {
+        // Converted vertex data are pairs of normalized shorts, converted indices are 16-bit.
+        const uint32_t size = accessor->count * sizeof(uint16_t) * (slot.vertexBuffer ? 2 : 1);
+        if (slot.vertexBuffer) {
+            BufferObject* bo = BufferObject::Builder().size(size).build(engine);
+            asset->mBufferObjects.push_back(bo);
+            bo->setBuffer(engine, BufferDescriptor(converted, size, FREE_CALLBACK));
+            slot.vertexBuffer->setBufferObjectAt(engine, slot.bufferIndex, bo);
+            return;
+        }
+        slot.indexBuffer->setBuffer(engine, IndexBuffer::BufferDescriptor(converted, size,
+                FREE_CALLBACK));
+        return;
+    }
+    auto bufferData = (const uint8_t*) accessor->buffer_view->buffer->data;
+    const uint8_t* data = computeBindingOffset(accessor) + bufferData;
+    const uint32_t size = computeBindingSize(accessor);
+    if (slot.shared) {
+        // Unless the whole range has been uploaded at once, the data of each slot is uploaded as its
+        // primitive becomes ready, which is the case when loading progressively.
+        const SharedBuffer& shared = asset->mSharedBuffers.at(accessor->buffer_view->buffer);
+        if (!shared.uploaded) {
+            shared.bufferObject->setBuffer(engine, BufferDescriptor(data, size,
+                    uploadCallback, uploadUserdata(asset)),
+                    computeBindingOffset(accessor) - shared.offset);
+        }
+        slot.vertexBuffer->setBufferObjectAt(engine, slot.bufferIndex, shared.bufferObject);
+        return;
+    }
+    if (slot.vertexBuffer) {
+        BufferObject* bo = BufferObject::Builder().size(size).build(engine);
+        asset->mBufferObjects.push_back(bo);
+        bo->setBuffer(engine, BufferDescriptor(data, size,
+                uploadCallback, uploadUserdata(asset)));
+        slot.vertexBuffer->setBufferObjectAt(engine, slot.bufferIndex, bo);
+        return;
+    }
+    assert(slot.indexBuffer);
+    IndexBuffer::BufferDescriptor bd(data, size, uploadCallback, uploadUserdata(asset));
+    slot.indexBuffer->setBuffer(engine, std::move(bd));
+}
+
+void ResourceLoader::Impl::uploadSharedBuffers(FFilamentAsset* asset) {
+    for (auto iter = asset->mSharedBuffers.begin(); iter != asset->mSharedBuffers.end(); ++iter) {
+        const cgltf_buffer* buffer = iter->first;
+        SharedBuffer& shared = iter.value();
+        if (!buffer->data || shared.uploaded) {
+            continue;
+        }
+        auto bufferData = (const uint8_t*) buffer->data;
+        shared.bufferObject->setBuffer(*mEngine, BufferDescriptor(bufferData + shared.offset,
+                shared.size, uploadCallback, uploadUserdata(asset)));
+        shared.uploaded = true;
+    }
 }
 
 void ResourceLoader::asyncCancelLoad() {
     pImpl->cancelTextureDecoding();
+    pImpl->mProgressiveAsset = nullptr;
+    pImpl->mPendingUris.clear();
     pImpl->mEngine->flushAndWait();
 }
 
 float ResourceLoader::asyncGetLoadProgress() const {
     const float finished = pImpl->mNumDecoderTasksFinished;
     const float total = pImpl->mNumDecoderTasks;
-    return total == 0 ? 0 : finished / total;
+    const float progress = total == 0 ? 0 : finished / total;
+    if (pImpl->mNumRequestedUris == 0) {
+        return progress;
+    }
+    // With a progressive load, fetching resources accounts for the first half.
+    const float fetched = 1.0f - float(pImpl->mPendingUris.size()) / pImpl->mNumRequestedUris;
+    return 0.5f * fetched + 0.5f * progress;
 }
 
 void ResourceLoader::asyncUpdateLoad() {
-    if (!UTILS_HAS_THREADING) {
+    updateProgressiveLoad();
+    if (!UTILS_HAS_WORKER_THREADS) {
         pImpl->decodeSingleTexture();
     }
     pImpl->uploadPendingTextures();
 }
 
 void ResourceLoader::Impl::decodeSingleTexture() {
-    assert(!UTILS_HAS_THREADING);
-    int w, h, c;
+    assert(!UTILS_HAS_WORKER_THREADS);
 
     // Check if any buffer-based textures haven't been decoded yet.
     for (auto& pair : mBufferTextureCache) {
         const uint8_t* sourceData = (const uint8_t*) pair.first;
         TextureCacheEntry* entry = pair.second.get();
-        if (entry->texels) {
+        if (entry->texels || entry->ktx || entry->completed) {
             continue;
         }
-        entry->texels = stbi_load_from_memory(sourceData, entry->bufferSize, &w, &h, &c, 4);
+        decodeTexture(entry, sourceData, entry->bufferSize);
         return;
     }
 
@@ -509,7 +1428,7 @@ void ResourceLoader::Impl::decodeSingleTexture() {
     for (auto& pair : mUriTextureCache) {
         auto uri = pair.first;
         TextureCacheEntry* entry = pair.second.get();
-        if (entry->texels) {
+        if (entry->texels || entry->ktx || entry->completed) {
             continue;
         }
 
@@ -517,7 +1436,7 @@ void ResourceLoader::Impl::decodeSingleTexture() {
         auto iter = mUriDataCache.find(uri);
         if (iter != mUriDataCache.end()) {
             const uint8_t* sourceData = (const uint8_t*) iter->second.buffer;
-            entry->texels = stbi_load_from_memory(sourceData, iter->second.size, &w, &h, &c, 4);
+            decodeTexture(entry, sourceData, iter->second.size);
             return;
         }
 
@@ -529,7 +1448,7 @@ void ResourceLoader::Impl::decodeSingleTexture() {
             return;
         #else
             Path fullpath = Path(mGltfPath).getParent() + uri;
-            entry->texels = stbi_load(fullpath.c_str(), &w, &h, &c, 4);
+            decodeTextureFile(entry, fullpath);
             return;
         #endif
     }
@@ -539,12 +1458,17 @@ void ResourceLoader::Impl::uploadPendingTextures() {
     auto upload = [this](TextureCacheEntry* entry, Engine& engine) {
         Texture* texture = entry->texture;
         uint8_t* texels = entry->texels;
-        if (texture && texels && !entry->completed) {
-            Texture::PixelBufferDescriptor pbd(texels,
-                    texture->getWidth() * texture->getHeight() * 4,
-                    Texture::Format::RGBA, Texture::Type::UBYTE, FREE_CALLBACK);
-            texture->setImage(engine, 0, std::move(pbd));
-            texture->generateMipmaps(engine);
+        image::KtxBundle* ktx = entry->ktx;
+        if (texture && (texels || ktx) && !entry->completed) {
+            if (ktx) {
+                uploadCompressedMips(engine, texture, ktx);
+            } else {
+                Texture::PixelBufferDescriptor pbd(texels,
+                        texture->getWidth() * texture->getHeight() * 4,
+                        Texture::Format::RGBA, Texture::Type::UBYTE, FREE_CALLBACK);
+                texture->setImage(engine, 0, std::move(pbd));
+                texture->generateMipmaps(engine);
+            }
             entry->completed = true;
             mNumDecoderTasksFinished++;
             mCurrentAsset->mDependencyGraph.markAsReady(texture);
@@ -558,10 +1482,11 @@ void ResourceLoader::Impl::releasePendingTextures() {
     auto release = [this](TextureCacheEntry* entry, Engine& engine) {
         Texture* texture = entry->texture;
         uint8_t* texels = entry->texels;
-        if (texture && texels && !entry->completed) {
+        if (texture && !entry->completed) {
             // Normally the ownership of these texels is transferred to PixelBufferDescriptor, but
             // if uploads have been cancelled then we need to free them explicitly.
             free(texels);
+            delete entry->ktx.load();
         }
     };
     for (auto& pair : mBufferTextureCache) release(pair.second.get(), *mEngine);
@@ -587,13 +1512,16 @@ void ResourceLoader::Impl::addTextureCacheEntry(const TextureSlot& tb) {
         }
         entry = (mBufferTextureCache[sourceData] = std::make_unique<TextureCacheEntry>()).get();
         entry->srgb = tb.srgb;
-        if (!stbi_info_from_memory(sourceData, totalSize, &entry->width, &entry->height,
-                &entry->numComponents)) {
-            slog.e << "Unable to decode BufferView texture: " << stbi_failure_reason() << io::endl;
+        if (!getTextureInfo(*mEngine, sourceData, totalSize, entry)) {
+            slog.e << "Unable to decode BufferView texture: " << getTextureFailureReason(entry)
+                    << io::endl;
             mBufferTextureCache.erase(sourceData);
             return;
         }
         entry->bufferSize = totalSize;
+        if (mTextureCache) {
+            entry->sharedKey = getSharedKey(sourceData, totalSize, entry->srgb);
+        }
         return;
     }
 
@@ -619,10 +1547,12 @@ void ResourceLoader::Impl::addTextureCacheEntry(const TextureSlot& tb) {
     auto iter = mUriDataCache.find(uri);
     if (iter != mUriDataCache.end()) {
         const uint8_t* sourceData = (const uint8_t*) iter->second.buffer;
-        if (!stbi_info_from_memory(sourceData, iter->second.size, &entry->width,
-                &entry->height, &entry->numComponents)) {
-            slog.e << "Unable to decode " << uri << " : " << stbi_failure_reason() << io::endl;
+        if (!getTextureInfo(*mEngine, sourceData, iter->second.size, entry)) {
+            slog.e << "Unable to decode " << uri << " : " << getTextureFailureReason(entry)
+                    << io::endl;
             mUriTextureCache.erase(uri);
+        } else if (mTextureCache) {
+            entry->sharedKey = getSharedKey(sourceData, iter->second.size, entry->srgb);
         }
         return;
     }
@@ -630,10 +1560,18 @@ void ResourceLoader::Impl::addTextureCacheEntry(const TextureSlot& tb) {
         slog.e << "Unable to load texture: " << uri << io::endl;
     #else
         Path fullpath = Path(mGltfPath).getParent() + uri;
-        if (!stbi_info(fullpath.c_str(), &entry->width, &entry->height, &entry->numComponents)) {
-            slog.e << "Unable to decode " << fullpath.c_str() << " : " << stbi_failure_reason()
-                    << io::endl;
+        uint8_t header[KTX_HEADER_SIZE];
+        std::ifstream in(fullpath.c_str(), std::ifstream::binary);
+        in.read((char*) header, sizeof(header));
+        const bool success = isKtx(header, in.gcount()) ?
+                getTextureInfo(*mEngine, header, KTX_HEADER_SIZE, entry) :
+                stbi_info(fullpath.c_str(), &entry->width, &entry->height, &entry->numComponents);
+        if (!success) {
+            slog.e << "Unable to decode " << fullpath.c_str() << " : "
+                    << getTextureFailureReason(entry) << io::endl;
             mUriTextureCache.erase(uri);
+        } else if (mTextureCache) {
+            entry->sharedKey = getSharedKey(fullpath.c_str(), entry->srgb);
         }
     #endif
 }
@@ -710,15 +1648,32 @@ bool ResourceLoader::Impl::createTextures(bool async) {
         mNumDecoderTasksFinished = 0;
     }
 
-    // Next create blank Filament textures.
+    // Next create blank Filament textures, unless they can be shared with previously loaded assets.
     auto createTexture = [=](TextureCacheEntry* entry) {
+        const bool shared = !entry->sharedKey.empty();
+        if (shared) {
+            entry->texture = mTextureCache->acquire(entry->sharedKey);
+            if (entry->texture) {
+                entry->completed = true;
+                mNumDecoderTasksFinished++;
+                asset->shareTexture(mTextureCache, entry->texture);
+                return;
+            }
+        }
+        const auto format = entry->srgb ?
+                Texture::InternalFormat::SRGB8_A8 : Texture::InternalFormat::RGBA8;
         entry->texture = Texture::Builder()
             .width(entry->width)
             .height(entry->height)
-            .levels(0xff)
-            .format(entry->srgb ? Texture::InternalFormat::SRGB8_A8 : Texture::InternalFormat::RGBA8)
+            .levels(entry->isKtx ? entry->ktxLevels : 0xff)
+            .format(entry->isKtx ? entry->ktxFormat : format)
             .build(*mEngine);
-        asset->takeOwnership(entry->texture);
+        if (shared) {
+            mTextureCache->insert(entry->sharedKey, entry->texture);
+            asset->shareTexture(mTextureCache, entry->texture);
+        } else {
+            asset->takeOwnership(entry->texture);
+        }
     };
     for (auto& pair : mBufferTextureCache) createTexture(pair.second.get());
     for (auto& pair : mUriTextureCache) createTexture(pair.second.get());
@@ -728,11 +1683,20 @@ bool ResourceLoader::Impl::createTextures(bool async) {
         bindTextureToMaterial(slot);
     }
 
+    // Shared textures have been uploaded by the loads that created them.
+    auto markShared = [asset](TextureCacheEntry* entry) {
+        if (entry->completed) {
+            asset->mDependencyGraph.markAsReady(entry->texture);
+        }
+    };
+    for (auto& pair : mBufferTextureCache) markShared(pair.second.get());
+    for (auto& pair : mUriTextureCache) markShared(pair.second.get());
+
     // Before creating jobs for PNG / JPEG decoding, we might need to return early. On single
     // threaded systems, it is usually fine to create jobs because the job system will simply
     // execute serially. However if the client requests async behavior, then we need to wait
     // until subsequent calls to asyncUpdateLoad().
-    if (!UTILS_HAS_THREADING && async) {
+    if (!UTILS_HAS_WORKER_THREADS && async) {
         return true;
     }
 
@@ -746,29 +1710,31 @@ bool ResourceLoader::Impl::createTextures(bool async) {
     for (auto& pair : mBufferTextureCache) {
         const uint8_t* sourceData = (const uint8_t*) pair.first;
         TextureCacheEntry* entry = pair.second.get();
+        if (entry->completed) {
+            continue;
+        }
         JobSystem::Job* decode = jobs::createJob(*js, parent, [retainSourceAsset, entry, sourceData] {
-            int width, height, comp;
-            entry->texels = stbi_load_from_memory(sourceData, entry->bufferSize,
-                    &width, &height, &comp, 4);
+            decodeTexture(entry, sourceData, entry->bufferSize);
         });
-        js->run(decode);
+        js->run(decode, JobSystem::BACKGROUND);
     }
 
     // Kick off jobs that decode texels from URI strings.
     for (auto& pair : mUriTextureCache) {
         auto uri = pair.first;
         TextureCacheEntry* entry = pair.second.get();
+        if (entry->completed) {
+            continue;
+        }
 
         // First, check the user-supplied resource cache for this URI.
         auto iter = mUriDataCache.find(uri);
         if (iter != mUriDataCache.end()) {
             const uint8_t* sourceData = (const uint8_t*) iter->second.buffer;
             JobSystem::Job* decode = jobs::createJob(*js, parent, [retainSourceAsset, entry, sourceData, iter] {
-                int width, height, comp;
-                entry->texels = stbi_load_from_memory(sourceData, iter->second.size, &width,
-                        &height, &comp, 4);
+                decodeTexture(entry, sourceData, iter->second.size);
             });
-            js->run(decode);
+            js->run(decode, JobSystem::BACKGROUND);
             continue;
         }
 
@@ -779,20 +1745,20 @@ bool ResourceLoader::Impl::createTextures(bool async) {
         #else
             Path fullpath = Path(mGltfPath).getParent() + uri;
             JobSystem::Job* decode = jobs::createJob(*js, parent, [retainSourceAsset, entry, fullpath] {
-                int width, height, comp;
-                entry->texels = stbi_load(fullpath.c_str(), &width, &height, &comp, 4);
+                decodeTextureFile(entry, fullpath);
             });
-            js->run(decode);
+            js->run(decode, JobSystem::BACKGROUND);
         #endif
     }
 
+    // Decoding runs in the background so that it never delays the jobs of the current frame.
     if (async) {
-        mDecoderRootJob = js->runAndRetain(parent);
+        mDecoderRootJob = js->runAndRetain(parent, JobSystem::BACKGROUND);
         return true;
     }
 
     // Wait for decoding to finish.
-    js->runAndWait(parent);
+    js->runAndWait(parent, JobSystem::BACKGROUND);
 
     // Finally, upload texels to the GPU and generate mipmaps.
     mCurrentAsset = asset;
@@ -801,9 +1767,8 @@ bool ResourceLoader::Impl::createTextures(bool async) {
     return true;
 }
 
-void ResourceLoader::Impl::computeTangents(FFilamentAsset* asset) {
-    SYSTRACE_CALL();
-
+void ResourceLoader::Impl::collectTangentJobs(FFilamentAsset* asset, const VertexBuffer* only,
+        std::vector<TangentsJob::Params>& jobParams) {
     const cgltf_accessor* kGenerateTangents = &asset->mGenerateTangents;
     const cgltf_accessor* kGenerateNormals = &asset->mGenerateNormals;
 
@@ -823,9 +1788,11 @@ void ResourceLoader::Impl::computeTangents(FFilamentAsset* asset) {
 
     // Create a job description for each primitive.
     using Params = TangentsJob::Params;
-    std::vector<Params> jobParams;
     for (auto pair : asset->mPrimitives) {
         VertexBuffer* vb = pair.second;
+        if (only && vb != only) {
+            continue;
+        }
         auto iter = baseTangents.find(vb);
         if (iter != baseTangents.end()) {
             jobParams.emplace_back(Params {{ pair.first }, {vb, iter->second }});
@@ -838,18 +1805,31 @@ void ResourceLoader::Impl::computeTangents(FFilamentAsset* asset) {
             }
         }
     }
+}
+
+void ResourceLoader::Impl::computeTangents(FFilamentAsset* asset, const VertexBuffer* only) {
+    SYSTRACE_CALL();
+    using Params = TangentsJob::Params;
+    std::vector<Params> jobParams;
+    collectTangentJobs(asset, only, jobParams);
 
     // Kick off jobs for computing tangent frames.
     JobSystem* js = &mEngine->getJobSystem();
     JobSystem::Job* parent = js->createJob();
     for (Params& params : jobParams) {
         Params* pptr = &params;
-        js->run(jobs::createJob(*js, parent, [pptr] { TangentsJob::run(pptr); }));
+        js->run(jobs::createJob(*js, parent, [pptr] { TangentsJob::run(pptr); }),
+                JobSystem::BACKGROUND);
     }
-    js->runAndWait(parent);
+    js->runAndWait(parent, JobSystem::BACKGROUND);
 
-    // Finally, upload quaternions to the GPU from the main thread.
-    for (Params& params : jobParams) {
+    uploadTangents(asset, jobParams);
+}
+
+void ResourceLoader::Impl::uploadTangents(FFilamentAsset* asset,
+        std::vector<TangentsJob::Params>& jobParams) {
+    // Upload quaternions to the GPU from the main thread.
+    for (TangentsJob::Params& params : jobParams) {
         BufferObject* bo = BufferObject::Builder()
                 .size(params.out.vertexCount * sizeof(short4)).build(*mEngine);
         asset->mBufferObjects.push_back(bo);
@@ -865,53 +1845,20 @@ ResourceLoader::Impl::~Impl() {
     }
 }
 
-void ResourceLoader::applySparseData(FFilamentAsset* asset) const {
-    for (auto slot : asset->mBufferSlots) {
-        const cgltf_accessor* accessor = slot.accessor;
-        if (!accessor->is_sparse) {
-            continue;
-        }
-        cgltf_size numFloats = accessor->count * cgltf_num_components(accessor->type);
-        cgltf_size numBytes = sizeof(float) * numFloats;
-        float* generated = (float*) malloc(numBytes);
-        cgltf_accessor_unpack_floats(accessor, generated, numFloats);
-        BufferObject* bo = BufferObject::Builder().size(numBytes).build(*asset->mEngine);
-        asset->mBufferObjects.push_back(bo);
-        bo->setBuffer(*pImpl->mEngine, BufferDescriptor(generated, numBytes, FREE_CALLBACK));
-        slot.vertexBuffer->setBufferObjectAt(*pImpl->mEngine, slot.bufferIndex, bo);
+void ResourceLoader::Impl::applySparseData(FFilamentAsset* asset, const BufferSlot& slot,
+        float* generated) {
+    const cgltf_accessor* accessor = slot.accessor;
+    if (!accessor->is_sparse) {
+        return;
     }
-}
-
-void ResourceLoader::normalizeSkinningWeights(FFilamentAsset* asset) const {
-    auto normalize = [](cgltf_accessor* data) {
-        if (data->type != cgltf_type_vec4 || data->component_type != cgltf_component_type_r_32f) {
-            slog.w << "Cannot normalize weights, unsupported attribute type." << io::endl;
-            return;
-        }
-        uint8_t* bytes = (uint8_t*) data->buffer_view->buffer->data;
-        bytes += data->offset + data->buffer_view->offset;
-        for (cgltf_size i = 0, n = data->count; i < n; ++i, bytes += data->stride) {
-            float4* weights = (float4*) bytes;
-            const float sum = weights->x + weights->y + weights->z + weights->w;
-            *weights /= sum;
-        }
-    };
-    const cgltf_data* gltf = asset->mSourceAsset->hierarchy;
-    cgltf_size mcount = gltf->meshes_count;
-    for (cgltf_size mindex = 0; mindex < mcount; ++mindex) {
-        const cgltf_mesh& mesh = gltf->meshes[mindex];
-        cgltf_size pcount = mesh.primitives_count;
-        for (cgltf_size pindex = 0; pindex < pcount; ++pindex) {
-            const cgltf_primitive& prim = mesh.primitives[pindex];
-            cgltf_size acount = prim.attributes_count;
-            for (cgltf_size aindex = 0; aindex < acount; ++aindex) {
-                const auto& attr = prim.attributes[aindex];
-                if (attr.type == cgltf_attribute_type_weights) {
-                    normalize(attr.data);
-                }
-            }
-        }
+    cgltf_size numBytes = sizeof(float) * accessor->count * cgltf_num_components(accessor->type);
+    if (!generated) {
+        generated = unpackSparseData(accessor, &numBytes);
     }
+    BufferObject* bo = BufferObject::Builder().size(numBytes).build(*asset->mEngine);
+    asset->mBufferObjects.push_back(bo);
+    bo->setBuffer(*mEngine, BufferDescriptor(generated, numBytes, FREE_CALLBACK));
+    slot.vertexBuffer->setBufferObjectAt(*mEngine, slot.bufferIndex, bo);
 }
 
 void ResourceLoader::updateBoundingBoxes(FFilamentAsset* asset) const {
@@ -930,26 +1877,6 @@ void ResourceLoader::updateBoundingBoxes(FFilamentAsset* asset) const {
         tm.setParent(tm.getInstance(e), 0);
     }
 
-    auto computeBoundingBox = [](const cgltf_primitive* prim, Aabb* result) {
-        Aabb aabb;
-        for (cgltf_size slot = 0; slot < prim->attributes_count; slot++) {
-            const cgltf_attribute& attr = prim->attributes[slot];
-            const cgltf_accessor* accessor = attr.data;
-            const size_t dim = cgltf_num_components(accessor->type);
-            if (attr.type == cgltf_attribute_type_position && dim >= 3) {
-                std::vector<float> unpacked(accessor->count * dim);
-                cgltf_accessor_unpack_floats(accessor, unpacked.data(), unpacked.size());
-                for (cgltf_size i = 0, j = 0, n = accessor->count; i < n; ++i, j += dim) {
-                    float3 pt(unpacked[j + 0], unpacked[j + 1], unpacked[j + 2]);
-                    aabb.min = min(aabb.min, pt);
-                    aabb.max = max(aabb.max, pt);
-                }
-                break;
-            }
-        }
-        *result = aabb;
-    };
-
     // Collect all mesh primitives that we wish to find bounds for.
     std::vector<cgltf_primitive const*> prims;
     for (auto iter : nodeMap) {
@@ -961,18 +1888,30 @@ void ResourceLoader::updateBoundingBoxes(FFilamentAsset* asset) const {
         }
     }
 
-    // Kick off a bounding box job for every primitive.
+    // Kick off a bounding box job for every primitive, unless its bounds were already computed
+    // by preparePrimitives().
     std::vector<Aabb> bounds(prims.size());
     JobSystem* js = &pImpl->mEngine->getJobSystem();
     JobSystem::Job* parent = js->createJob();
     for (size_t i = 0; i < prims.size(); ++i) {
         cgltf_primitive const* prim = prims[i];
+        auto iter = pImpl->mPrimitiveBounds.find(prim);
+        if (iter != pImpl->mPrimitiveBounds.end()) {
+            bounds[i] = iter->second;
+            continue;
+        }
         Aabb* result = &bounds[i];
-        js->run(jobs::createJob(*js, parent, [prim, result, computeBoundingBox] {
-            computeBoundingBox(prim, result);
+        js->run(jobs::createJob(*js, parent, [prim, result] {
+            *result = computePrimitiveBounds(prim);
         }));
     }
     js->runAndWait(parent);
+    pImpl->mPrimitiveBounds.clear();
+
+    tsl::robin_map<Entity, const MeshInstances*> meshInstances;
+    for (const MeshInstances& instances : asset->mMeshInstances) {
+        meshInstances[instances.node] = &instances;
+    }
 
     // Compute the asset-level bounding box.
     size_t primIndex = 0;
@@ -987,15 +1926,26 @@ void ResourceLoader::updateBoundingBoxes(FFilamentAsset* asset) const {
                 aabb.min = min(aabb.min, primBounds.min);
                 aabb.max = max(aabb.max, primBounds.max);
             }
-            auto renderable = rm.getInstance(iter.second);
-            rm.setAxisAlignedBoundingBox(renderable, Box().set(aabb.min, aabb.max));
-
-            // Transform this bounding box, then update the asset-level bounding box.
-            auto transformable = tm.getInstance(iter.second);
-            const mat4f worldTransform = tm.getWorldTransform(transformable);
-            const Aabb transformed = aabb.transform(worldTransform);
-            assetBounds.min = min(assetBounds.min, transformed.min);
-            assetBounds.max = max(assetBounds.max, transformed.max);
+            // The renderables of an EXT_mesh_gpu_instancing node are its children.
+            const Entity* entities = &iter.second;
+            size_t entityCount = 1;
+            auto instances = meshInstances.find(iter.second);
+            if (instances != meshInstances.end()) {
+                entities = instances->second->entities.data();
+                entityCount = instances->second->entities.size();
+            }
+
+            for (size_t i = 0; i < entityCount; ++i) {
+                auto renderable = rm.getInstance(entities[i]);
+                rm.setAxisAlignedBoundingBox(renderable, Box().set(aabb.min, aabb.max));
+
+                // Transform this bounding box, then update the asset-level bounding box.
+                auto transformable = tm.getInstance(entities[i]);
+                const mat4f worldTransform = tm.getWorldTransform(transformable);
+                const Aabb transformed = aabb.transform(worldTransform);
+                assetBounds.min = min(assetBounds.min, transformed.min);
+                assetBounds.max = max(assetBounds.max, transformed.max);
+            }
         }
     }
 
@@ -25,7 +25,7 @@ using namespace filament;
 using namespace filament::math;
 
 // This procedure is designed to run in an isolated job.
-void TangentsJob::run(Params* params) {
+void TangentsJob::run(Params* params, utils::JobSystem* js) {
     const cgltf_primitive& prim = *params->in.prim;
     const int morphTargetIndex = params->in.morphTargetIndex;
     const bool isMorphTarget = morphTargetIndex != kMorphTargetUnused;
@@ -155,6 +155,7 @@ void TangentsJob::run(Params* params) {
 
     // Compute surface orientation quaternions.
     params->out.results = (short4*) malloc(sizeof(short4) * vertexCount);
+    sob.jobSystem(js);
     geometry::SurfaceOrientation* helper = sob.build();
     helper->getQuats(params->out.results, vertexCount);
     delete helper;
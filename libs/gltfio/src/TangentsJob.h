@@ -19,6 +19,7 @@
 #include <math/vec4.h>
 
 namespace filament { class VertexBuffer; }
+namespace utils { class JobSystem; }
 
 namespace gltfio {
 
@@ -59,8 +60,9 @@ struct TangentsJob {
     };
 
     // Performs tangents generation synchronously. This can be invoked from inside a job if desired.
-    // The parameters structure is owned by the client.
-    static void run(Params* params);
+    // The parameters structure is owned by the client. If a job system is given, the work of large
+    // meshes is split across its threads, in which case run() must be called from one of them.
+    static void run(Params* params, utils::JobSystem* js = nullptr);
 };
 
 } // namespace gltfio
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FTextureCache.h"
+
+#include <filament/Engine.h>
+#include <filament/Texture.h>
+
+#include <utils/debug.h>
+
+using namespace filament;
+
+namespace gltfio {
+
+FTextureCache::~FTextureCache() {
+    for (auto& pair : mEntries) {
+        mEngine->destroy(pair.second.texture);
+    }
+}
+
+Texture* FTextureCache::acquire(std::string const& key) {
+    auto iter = mEntries.find(key);
+    if (iter == mEntries.end()) {
+        return nullptr;
+    }
+    iter.value().references++;
+    return iter->second.texture;
+}
+
+void FTextureCache::insert(std::string key, Texture* texture) {
+    assert_invariant(mEntries.find(key) == mEntries.end());
+    mKeys[texture] = key;
+    mEntries[std::move(key)] = { texture, 1 };
+}
+
+void FTextureCache::release(Texture* texture) {
+    auto key = mKeys.find(texture);
+    assert_invariant(key != mKeys.end());
+    auto iter = mEntries.find(key->second);
+    if (--iter.value().references == 0) {
+        mEngine->destroy(texture);
+        mEntries.erase(iter);
+        mKeys.erase(key);
+    }
+}
+
+TextureCache* TextureCache::create(Engine* engine) {
+    return new FTextureCache(engine);
+}
+
+void TextureCache::destroy(TextureCache** cache) {
+    delete upcast(*cache);
+    *cache = nullptr;
+}
+
+size_t TextureCache::getTextureCount() const noexcept {
+    return upcast(this)->getTextureCount();
+}
+
+} // namespace gltfio
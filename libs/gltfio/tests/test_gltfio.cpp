@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+// src/ can't be an include directory, its math.h would shadow the system one
+#include "../src/AnimationSampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace gltfio;
+
+class AnimatorTest : public testing::Test {};
+
+static Sampler createSampler(std::vector<float> times, std::vector<float> values,
+        uint8_t components, decltype(Sampler::interpolation) interpolation) {
+    Sampler sampler;
+    sampler.times = std::move(times);
+    sampler.values = std::move(values);
+    sampler.components = components;
+    sampler.interpolation = interpolation;
+    return sampler;
+}
+
+// Decodes one component of a keyframe, the way Animator does for each type of channel.
+static float getComponent(const Sampler& sampler, size_t keyframe, size_t component) {
+    switch (sampler.components) {
+        case 3:
+            return sampler.getFloat3(keyframe)[component];
+        case 4: {
+            const Sampler::quatf q = sampler.getQuat(keyframe);
+            const float values[4] = { q.x, q.y, q.z, q.w };
+            return values[component];
+        }
+        default:
+            return sampler.getFloat(keyframe);
+    }
+}
+
+// Linearly interpolates the given component of a (possibly compressed) linear sampler.
+static float interpolate(const Sampler& sampler, float time, size_t component) {
+    const std::vector<float>& times = sampler.times;
+    const size_t next = std::min(size_t(std::upper_bound(times.begin(), times.end(), time) -
+            times.begin()), times.size() - 1);
+    const size_t prev = next > 0 ? next - 1 : 0;
+    if (prev == next || time >= times[next]) {
+        return getComponent(sampler, next, component);
+    }
+    const float t = (time - times[prev]) / (times[next] - times[prev]);
+    return (1 - t) * getComponent(sampler, prev, component) +
+            t * getComponent(sampler, next, component);
+}
+
+TEST_F(AnimatorTest, LinearTrackDropsRedundantKeys) {
+    // a ramp up and down, only its ends and its peak are needed
+    Sampler sampler = createSampler(
+            { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 },
+            { 0, 2, 4, 6, 8, 10, 8, 6, 4, 2, 0 },
+            1, Sampler::LINEAR);
+    compressSampler(sampler);
+
+    EXPECT_EQ(sampler.times, std::vector<float>({ 0, 5, 10 }));
+    EXPECT_TRUE(sampler.values.empty());
+    ASSERT_EQ(sampler.getValueCount(), 3u);
+    EXPECT_NEAR(sampler.getFloat(0), 0.0f, 1e-6f);
+    EXPECT_NEAR(sampler.getFloat(1), 10.0f, 1e-6f);
+    EXPECT_NEAR(sampler.getFloat(2), 0.0f, 1e-6f);
+
+    // a straight line in 3D, including a constant component
+    Sampler translation = createSampler(
+            { 0, 0.5f, 1, 1.5f },
+            { 0, 1, 7,   1, 0, 7,   2, -1, 7,   3, -2, 7 },
+            3, Sampler::LINEAR);
+    compressSampler(translation);
+
+    EXPECT_EQ(translation.times, std::vector<float>({ 0, 1.5f }));
+    ASSERT_EQ(translation.getValueCount(), 6u);
+    EXPECT_NEAR(translation.getFloat3(1).x, 3.0f, 1e-6f);
+    EXPECT_NEAR(translation.getFloat3(1).y, -2.0f, 1e-6f);
+    EXPECT_NEAR(translation.getFloat3(1).z, 7.0f, 1e-6f);
+}
+
+TEST_F(AnimatorTest, StepTrackDropsRepeatedKeys) {
+    Sampler sampler = createSampler(
+            { 0, 1, 2, 3, 4, 5 },
+            { 1, 1, 1, 2, 2, 3 },
+            1, Sampler::STEP);
+    compressSampler(sampler);
+
+    // the last keyframe is always kept
+    EXPECT_EQ(sampler.times, std::vector<float>({ 0, 3, 5 }));
+    ASSERT_EQ(sampler.getValueCount(), 3u);
+    EXPECT_NEAR(sampler.getFloat(1), 2.0f, 2.0f / 65535.0f);
+}
+
+TEST_F(AnimatorTest, QuantizedValuesStayWithinTolerance) {
+    // a track sampled at 60Hz, linear during the first second and curved during the next one
+    const size_t count = 120;
+    std::vector<float> times(count);
+    std::vector<float> values(count * 4);
+    for (size_t i = 0; i < count; ++i) {
+        const float t = float(i) / 60.0f;
+        const float u = std::max(0.0f, t - 1.0f);
+        times[i] = t;
+        values[i * 4 + 0] = std::min(t, 1.0f) * 0.5f + 0.25f * std::sin(4.0f * u);
+        values[i * 4 + 1] = -std::min(t, 1.0f) + u * u;
+        values[i * 4 + 2] = 0.2f * std::min(t, 1.0f) + 0.3f * std::sin(u) * u;
+        values[i * 4 + 3] = 0.5f;
+    }
+    Sampler sampler = createSampler(times, values, 4, Sampler::LINEAR);
+    compressSampler(sampler);
+
+    EXPECT_LT(sampler.times.size(), count / 2 + 2);
+    EXPECT_EQ(sampler.getValueCount(), sampler.times.size() * 4);
+
+    // every original keyframe is reproduced within one quantization step of the keyframe
+    // reduction, plus half a step of rounding
+    for (size_t c = 0; c < 4; ++c) {
+        float minValue = values[c];
+        float maxValue = values[c];
+        for (size_t i = 0; i < count; ++i) {
+            minValue = std::min(minValue, values[i * 4 + c]);
+            maxValue = std::max(maxValue, values[i * 4 + c]);
+        }
+        const float step = (maxValue - minValue) / 65535.0f;
+        const float tolerance = 1.5f * step + 1e-5f;
+        for (size_t i = 0; i < count; ++i) {
+            EXPECT_NEAR(interpolate(sampler, times[i], c), values[i * 4 + c], tolerance)
+                    << "component " << c << " at keyframe " << i;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
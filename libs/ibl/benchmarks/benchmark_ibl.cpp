@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <ibl/Cubemap.h>
+#include <ibl/CubemapIBL.h>
+#include <ibl/CubemapUtils.h>
+#include <ibl/Image.h>
+
+#include <utils/JobSystem.h>
+
+#include <vector>
+
+using namespace filament::ibl;
+using namespace filament::math;
+
+namespace {
+
+// A mip chain of a synthetic environment, as cmgen would prepare it.
+struct Environment {
+    explicit Environment(size_t dim) {
+        js.adopt();
+        Image image;
+        Cubemap cm = CubemapUtils::create(image, dim);
+        for (size_t f = 0; f < 6; f++) {
+            Image& face = cm.getImageForFace((Cubemap::Face)f);
+            for (size_t y = 0; y < dim; y++) {
+                for (size_t x = 0; x < dim; x++) {
+                    float3 const d = cm.getDirectionFor((Cubemap::Face)f, x, y);
+                    Cubemap::writeAt(face.getPixelRef(x, y),
+                            Cubemap::Texel{ d.x * d.x, 0.5f + 0.5f * d.y, float((x ^ y) & 1) });
+                }
+            }
+        }
+        cm.makeSeamless();
+        images.push_back(std::move(image));
+        levels.push_back(std::move(cm));
+
+        while (dim > 1) {
+            dim >>= 1u;
+            Image temp;
+            Cubemap dst = CubemapUtils::create(temp, dim);
+            CubemapUtils::downsampleCubemapLevelBoxFilter(js, dst, levels.back());
+            dst.makeSeamless();
+            images.push_back(std::move(temp));
+            levels.push_back(std::move(dst));
+        }
+    }
+
+    ~Environment() {
+        js.emancipate();
+    }
+
+    utils::JobSystem js;
+    std::vector<Image> images;
+    std::vector<Cubemap> levels;
+};
+
+} // anonymous namespace
+
+static void BM_roughnessFilter(benchmark::State& state) {
+    Environment env(256);
+    size_t const dim = size_t(state.range(0));
+    size_t const numSamples = 1024;
+    Image image;
+    Cubemap dst = CubemapUtils::create(image, dim);
+    for (auto _ : state) {
+        CubemapIBL::roughnessFilter(env.js, dst, env.levels, 0.5f, numSamples,
+                float3{ -1, 1, 1 }, true);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * 6 * dim * dim * numSamples));
+}
+
+static void BM_diffuseIrradiance(benchmark::State& state) {
+    Environment env(256);
+    size_t const dim = size_t(state.range(0));
+    size_t const numSamples = 1024;
+    Image image;
+    Cubemap dst = CubemapUtils::create(image, dim);
+    for (auto _ : state) {
+        CubemapIBL::diffuseIrradiance(env.js, dst, env.levels, numSamples);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * 6 * dim * dim * numSamples));
+}
+
+BENCHMARK(BM_roughnessFilter)->Arg(32)->Arg(128)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_diffuseIrradiance)->Arg(32)->Unit(benchmark::kMillisecond);
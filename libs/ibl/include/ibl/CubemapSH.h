@@ -43,9 +43,14 @@ public:
     /**
      * Spherical Harmonics decomposition of the given cubemap
      * Optionally calculates irradiance by convolving with truncated cos.
+     *
+     * Only the faces in faceMask (bit i for Cubemap::Face i) are decomposed. The decomposition
+     * is linear, so the coefficients of disjoint sets of faces can be summed, which allows to
+     * spread the work over several calls.
      */
     static std::unique_ptr<math::float3[]> computeSH(
-            utils::JobSystem& js, const Cubemap& cm, size_t numBands, bool irradiance);
+            utils::JobSystem& js, const Cubemap& cm, size_t numBands, bool irradiance,
+            uint8_t faceMask = 0x3F);
 
     /**
      * Render given spherical harmonics into a cubemap
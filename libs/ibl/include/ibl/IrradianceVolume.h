@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef IBL_IRRADIANCEVOLUME_H
+#define IBL_IRRADIANCEVOLUME_H
+
+#include <math/vec3.h>
+#include <math/vec4.h>
+
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace filament {
+namespace ibl {
+
+/**
+ * A regular 3D grid of irradiance probes, each holding spherical harmonics coefficients.
+ *
+ * The probes are typically baked offline, by rendering a cubemap at each probe position and
+ * decomposing it with CubemapSH::computeSH() with irradiance enabled, or updated one at a time at
+ * runtime. The irradiance at any point of the volume is the trilinear interpolation of the eight
+ * surrounding probes, either computed on the CPU with interpolate(), e.g. once per object, or by
+ * a shader sampling the 3D textures filled by getTextureData().
+ */
+class IrradianceVolume {
+public:
+    /**
+     * Creates a volume whose probes are all zero.
+     *
+     * @param min           the corner of the volume with the smallest coordinates
+     * @param max           the corner of the volume with the largest coordinates
+     * @param resolution    number of probes along each axis, the probes are on the corners of the
+     *                      volume and evenly spaced in between, or centered if there's only one
+     * @param numBands      number of SH bands of each probe, 3 for 9 coefficients
+     */
+    IrradianceVolume(math::float3 min, math::float3 max, math::uint3 resolution,
+            size_t numBands = 3);
+
+    math::uint3 getResolution() const noexcept { return mResolution; }
+
+    size_t getBandCount() const noexcept { return mNumBands; }
+
+    size_t getProbeCount() const noexcept {
+        return size_t(mResolution.x) * mResolution.y * mResolution.z;
+    }
+
+    //! Returns the world position of the given probe
+    math::float3 getProbePosition(math::uint3 probe) const noexcept;
+
+    //! Sets the numBands * numBands SH coefficients of the given probe
+    void setProbe(math::uint3 probe, math::float3 const* sh) noexcept;
+
+    //! Returns the numBands * numBands SH coefficients of the given probe
+    math::float3 const* getProbe(math::uint3 probe) const noexcept;
+
+    /**
+     * Interpolates the probes at the given position, clamped to the volume.
+     *
+     * @param position  world position
+     * @param sh        receives numBands * numBands SH coefficients
+     */
+    void interpolate(math::float3 position, math::float3* sh) const noexcept;
+
+    /**
+     * Writes one SH coefficient of all the probes as the texels of a 3D texture, e.g. RGBA16F,
+     * with the coefficient in RGB and 1 in alpha. Texel (x, y, z) is written at index
+     * (z * resolution.y + y) * resolution.x + x. The probes are at the centers of the texels, so
+     * linear filtering at (p * (resolution - 1) + 0.5) / resolution, where p is the position
+     * normalized to the volume, matches interpolate().
+     *
+     * @param coefficient   index of the coefficient, less than numBands * numBands
+     * @param texels        receives getProbeCount() texels
+     */
+    void getTextureData(size_t coefficient, math::float4* texels) const noexcept;
+
+private:
+    size_t getProbeIndex(math::uint3 probe) const noexcept;
+
+    math::float3 mMin;
+    math::float3 mMax;
+    math::uint3 mResolution;
+    size_t mNumBands;
+    size_t mNumCoefs;
+    std::vector<math::float3> mCoefficients;   // numCoefs coefficients per probe, x first
+};
+
+} // namespace ibl
+} // namespace filament
+
+#endif /* IBL_IRRADIANCEVOLUME_H */
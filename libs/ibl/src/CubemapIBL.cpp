@@ -28,7 +28,9 @@
 #include <math/mat3.h>
 #include <math/scalar.h>
 
-#include <random>
+#include <algorithm>
+#include <atomic>
+#include <numeric>
 #include <vector>
 
 using namespace filament::math;
@@ -181,6 +183,160 @@ static float UTILS_UNUSED VisibilityAshikhmin(float NoV, float NoL, float /*a*/)
     return 1 / (4 * (NoL + NoV - NoL * NoV));
 }
 
+// Samples shared by all the texels of a mip level, stored as a structure of arrays so that
+// rotating them around the normal of a texel is a loop the compiler vectorizes.
+struct SampleTable {
+    std::vector<float> x, y, z;
+    std::vector<float> weight;
+    std::vector<float> lerp;
+    std::vector<uint8_t> l0, l1;
+
+    void reserve(size_t count) {
+        x.reserve(count); y.reserve(count); z.reserve(count);
+        weight.reserve(count); lerp.reserve(count);
+        l0.reserve(count); l1.reserve(count);
+    }
+
+    void push_back(float3 const& L, float w, float t, uint8_t level0, uint8_t level1) {
+        x.push_back(L.x); y.push_back(L.y); z.push_back(L.z);
+        weight.push_back(w); lerp.push_back(t);
+        l0.push_back(level0); l1.push_back(level1);
+    }
+
+    size_t size() const noexcept { return x.size(); }
+
+    // reorders the samples with the given permutation
+    void permute(std::vector<uint32_t> const& order) {
+        auto apply = [&order](auto& v) {
+            std::remove_reference_t<decltype(v)> t(v.size());
+            for (size_t i = 0, c = order.size(); i < c; i++) {
+                t[i] = v[order[i]];
+            }
+            v.swap(t);
+        };
+        apply(x); apply(y); apply(z); apply(weight); apply(lerp); apply(l0); apply(l1);
+    }
+
+    // computes the world-space direction of samples [first, first + count) for the basis R
+    void rotate(mat3f const& R, size_t first, size_t count, float* UTILS_RESTRICT dx,
+            float* UTILS_RESTRICT dy, float* UTILS_RESTRICT dz) const noexcept {
+        float const* UTILS_RESTRICT sx = x.data() + first;
+        float const* UTILS_RESTRICT sy = y.data() + first;
+        float const* UTILS_RESTRICT sz = z.data() + first;
+        for (size_t i = 0; i < count; i++) {
+            dx[i] = R[0].x * sx[i] + R[1].x * sy[i] + R[2].x * sz[i];
+            dy[i] = R[0].y * sx[i] + R[1].y * sy[i] + R[2].y * sz[i];
+            dz[i] = R[0].z * sx[i] + R[1].z * sy[i] + R[2].z * sz[i];
+        }
+    }
+};
+
+// returns an orthonormal basis whose z axis is N
+static mat3f tangentFrame(float3 const& N) noexcept {
+    // center the cone around the normal (handle case of normal close to up)
+    const float3 up = std::abs(N.z) < 0.999f ? float3(0, 0, 1) : float3(1, 0, 0);
+    mat3f R;
+    R[0] = normalize(cross(up, N));
+    R[1] = cross(N, R[0]);
+    R[2] = N;
+    return R;
+}
+
+// A random angle in [-pi, pi] that only depends on the texel, so that texels can be filtered
+// in any order and on any thread.
+static float texelAngle(size_t face, size_t x, size_t y) noexcept {
+    uint32_t h = uint32_t(x) * 0x8da6b343u ^ uint32_t(y) * 0xd8163841u ^ uint32_t(face) * 0xcb1ab31fu;
+    h ^= h >> 16; h *= 0x7feb352du;
+    h ^= h >> 15; h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return float(h) * (2.0f * float(F_PI) / 4294967296.0f) - float(F_PI);
+}
+
+// Calls proc(face, x, y, texel) for every texel of dst, in square tiles so that neighbouring
+// texels -- which read neighbouring texels of the source -- are processed together. The tiles
+// of all faces are distributed over the JobSystem unless singleThreaded is set.
+template<typename PROC>
+static void processTiles(JobSystem& js, Cubemap& dst, bool singleThreaded,
+        CubemapIBL::Progress updater, void* userdata, PROC proc) {
+    constexpr size_t TILE_SIZE = 16;
+    const size_t dim = dst.getDimensions();
+    const size_t tilesPerRow = (dim + TILE_SIZE - 1) / TILE_SIZE;
+    const size_t tilesPerFace = tilesPerRow * tilesPerRow;
+    const uint32_t tileCount = uint32_t(6 * tilesPerFace);
+    std::atomic_uint progress = { 0 };
+
+    auto processTile = [&](uint32_t tile) {
+        const size_t f = tile / tilesPerFace;
+        const size_t t = tile % tilesPerFace;
+        const size_t x0 = (t % tilesPerRow) * TILE_SIZE;
+        const size_t y0 = (t / tilesPerRow) * TILE_SIZE;
+        const size_t x1 = std::min(dim, x0 + TILE_SIZE);
+        const size_t y1 = std::min(dim, y0 + TILE_SIZE);
+        Image& image(dst.getImageForFace((Cubemap::Face)f));
+        for (size_t y = y0; y < y1; y++) {
+            Cubemap::Texel* data = static_cast<Cubemap::Texel*>(image.getPixelRef(x0, y));
+            for (size_t x = x0; x < x1; x++, data++) {
+                proc((Cubemap::Face)f, x, y, data);
+            }
+        }
+        if (UTILS_UNLIKELY(updater)) {
+            size_t p = progress.fetch_add(1, std::memory_order_relaxed) + 1;
+            updater(0, (float)p / (float)tileCount, userdata);
+        }
+    };
+
+    if (singleThreaded) {
+        for (uint32_t tile = 0; tile < tileCount; tile++) {
+            processTile(tile);
+        }
+    } else {
+        auto job = jobs::parallel_for(js, nullptr, 0, tileCount,
+                [&processTile](uint32_t first, uint32_t count) {
+                    for (uint32_t tile = first; tile < first + count; tile++) {
+                        processTile(tile);
+                    }
+                }, jobs::CountSplitter<1, 8>());
+        js.runAndWait(job);
+    }
+}
+
+// returns the weighted sum of the samples rotated by R
+static float3 filterSamples(const std::vector<Cubemap>& levels, SampleTable const& samples,
+        mat3f const& R) noexcept {
+    // directions are computed in blocks, small enough to stay on the stack
+    constexpr size_t BLOCK_SIZE = 64;
+    float dx[BLOCK_SIZE], dy[BLOCK_SIZE], dz[BLOCK_SIZE];
+    const size_t numSamples = samples.size();
+    float3 Li = 0;
+    for (size_t first = 0; first < numSamples; first += BLOCK_SIZE) {
+        const size_t count = std::min(BLOCK_SIZE, numSamples - first);
+        samples.rotate(R, first, count, dx, dy, dz);
+        for (size_t i = 0; i < count; i++) {
+            const size_t s = first + i;
+            const Cubemap& cmBase = levels[samples.l0[s]];
+            const Cubemap& next = levels[samples.l1[s]];
+            const float3 c0 = Cubemap::trilinearFilterAt(cmBase, next, samples.lerp[s],
+                    float3{ dx[i], dy[i], dz[i] });
+            Li += c0 * samples.weight[s];
+        }
+    }
+    return Li;
+}
+
+// sorts the samples by mip level so that consecutive lookups read the same levels, and by weight
+// within a level, it could improve fp precision
+static void sortSamples(SampleTable& samples) {
+    std::vector<uint32_t> order(samples.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&samples](uint32_t lhs, uint32_t rhs) {
+        if (samples.l0[lhs] != samples.l0[rhs]) {
+            return samples.l0[lhs] < samples.l0[rhs];
+        }
+        return samples.weight[lhs] < samples.weight[rhs];
+    });
+    samples.permute(order);
+}
+
 /*
  *
  * Importance sampling GGX - Trowbridge-Reitz
@@ -332,16 +488,7 @@ void CubemapIBL::roughnessFilter(
         return;
     }
 
-    // be careful w/ the size of this structure, the smaller the better
-    struct CacheEntry {
-        float3 L;
-        float brdf_NoL;
-        float lerp;
-        uint8_t l0;
-        uint8_t l1;
-    };
-
-    std::vector<CacheEntry> cache;
+    SampleTable cache;
     cache.reserve(maxNumSamples);
 
     // precompute everything that only depends on the sample #
@@ -393,66 +540,29 @@ void CubemapIBL::roughnessFilter(
             uint8_t l1 = uint8_t(std::min(maxLevel, size_t(l0 + 1)));
             float lerp = mipLevel - (float) l0;
 
-            cache.push_back({ L, brdf_NoL, lerp, l0, l1 });
+            cache.push_back(L, brdf_NoL, lerp, l0, l1);
         }
     }
 
-    for (auto& entry : cache) {
-        entry.brdf_NoL *= 1.0f / weight;
+    for (float& w : cache.weight) {
+        w *= 1.0f / weight;
     }
 
-    // we can sample the cubemap in any order, sort by the weight, it could improve fp precision
-    std::sort(cache.begin(), cache.end(), [](CacheEntry const& lhs, CacheEntry const& rhs) {
-        return lhs.brdf_NoL < rhs.brdf_NoL;
-    });
+    sortSamples(cache);
 
-
-    struct State {
-        // maybe blue-noise instead would look even better
-        std::default_random_engine gen;
-        std::uniform_real_distribution<float> distribution{ -F_PI, F_PI };
-    };
-
-    auto scanline = [&](State& state, size_t y,
-            Cubemap::Face f, Cubemap::Texel* data, size_t dim) {
-        if (UTILS_UNLIKELY(updater)) {
-            size_t p = progress.fetch_add(1, std::memory_order_relaxed) + 1;
-            updater(0, (float) p / ((float) dim * 6.0f), userdata);
-        }
-        mat3 R;
-        const size_t numSamples = cache.size();
-        for (size_t x = 0; x < dim; ++x, ++data) {
-            const float2 p(Cubemap::center(x, y));
-            const float3 N(dst.getDirectionFor(f, p.x, p.y) * mirror);
-
-            // center the cone around the normal (handle case of normal close to up)
-            const float3 up = std::abs(N.z) < 0.999 ? float3(0, 0, 1) : float3(1, 0, 0);
-            R[0] = normalize(cross(up, N));
-            R[1] = cross(N, R[0]);
-            R[2] = N;
-
-            R *= mat3f::rotation(state.distribution(state.gen), float3{0,0,1});
-
-            float3 Li = 0;
-            for (size_t sample = 0; sample < numSamples; sample++) {
-                const CacheEntry& e = cache[sample];
-                const float3 L(R * e.L);
-                const Cubemap& cmBase = levels[e.l0];
-                const Cubemap& next = levels[e.l1];
-                const float3 c0 = Cubemap::trilinearFilterAt(cmBase, next, e.lerp, L);
-                Li += c0 * e.brdf_NoL;
-            }
-            Cubemap::writeAt(data, Cubemap::Texel(Li));
-        }
+    auto texel = [&](Cubemap::Face f, size_t x, size_t y, Cubemap::Texel* data) {
+        const float2 p(Cubemap::center(x, y));
+        const float3 N(dst.getDirectionFor(f, p.x, p.y) * mirror);
+        // rotate the samples randomly around the normal, maybe blue-noise would look even better
+        const mat3f R = tangentFrame(N) *
+                mat3f::rotation(texelAngle(size_t(f), x, y), float3{ 0, 0, 1 });
+        Cubemap::writeAt(data, Cubemap::Texel(filterSamples(levels, cache, R)));
     };
 
-    // don't use the jobsystem unless we have enough work per scanline -- or the overhead of
+    // don't use the jobsystem unless we have enough work per tile -- or the overhead of
     // launching jobs will prevail.
-    if (dst.getDimensions() * maxNumSamples <= 256) {
-        CubemapUtils::processSingleThreaded<State>(dst, js, std::ref(scanline));
-    } else {
-        CubemapUtils::process<State>(dst, js, std::ref(scanline));
-    }
+    const bool singleThreaded = dst.getDimensions() * maxNumSamples <= 256;
+    processTiles(js, dst, singleThreaded, updater, userdata, texel);
 }
 
 /*
@@ -553,16 +663,7 @@ void CubemapIBL::diffuseIrradiance(JobSystem& js, Cubemap& dst, const std::vecto
     const size_t dim0 = base.getDimensions();
     const float omegaP = (4.0f * (float) F_PI) / float(6 * dim0 * dim0);
 
-    std::atomic_uint progress = {0};
-
-    struct CacheEntry {
-        float3 L;
-        float lerp;
-        uint8_t l0;
-        uint8_t l1;
-    };
-
-    std::vector<CacheEntry> cache;
+    SampleTable cache;
     cache.reserve(maxNumSamples);
 
     // precompute everything that only depends on the sample #
@@ -585,43 +686,19 @@ void CubemapIBL::diffuseIrradiance(JobSystem& js, Cubemap& dst, const std::vecto
             uint8_t l1 = uint8_t(std::min(maxLevel, size_t(l0 + 1)));
             float lerp = mipLevel - (float) l0;
 
-            cache.push_back({ L, lerp, l0, l1 });
+            cache.push_back(L, inumSamples, lerp, l0, l1);
         }
     }
 
-    CubemapUtils::process<CubemapUtils::EmptyState>(dst, js,
-            [&](CubemapUtils::EmptyState&, size_t y,
-                    Cubemap::Face f, Cubemap::Texel* data, size_t dim) {
+    sortSamples(cache);
 
-        if (updater) {
-            size_t p = progress.fetch_add(1, std::memory_order_relaxed) + 1;
-            updater(0, (float)p / ((float) dim * 6.0f), userdata);
-        }
+    auto texel = [&](Cubemap::Face f, size_t x, size_t y, Cubemap::Texel* data) {
+        const float2 p(Cubemap::center(x, y));
+        const float3 N(dst.getDirectionFor(f, p.x, p.y));
+        Cubemap::writeAt(data, Cubemap::Texel(filterSamples(levels, cache, tangentFrame(N))));
+    };
 
-        mat3 R;
-        const size_t numSamples = cache.size();
-        for (size_t x = 0; x < dim; ++x, ++data) {
-            const float2 p(Cubemap::center(x, y));
-            const float3 N(dst.getDirectionFor(f, p.x, p.y));
-
-            // center the cone around the normal (handle case of normal close to up)
-            const float3 up = std::abs(N.z) < 0.999 ? float3(0, 0, 1) : float3(1, 0, 0);
-            R[0] = normalize(cross(up, N));
-            R[1] = cross(N, R[0]);
-            R[2] = N;
-
-            float3 Li = 0;
-            for (size_t sample = 0; sample < numSamples; sample++) {
-                const CacheEntry& e = cache[sample];
-                const float3 L(R * e.L);
-                const Cubemap& cmBase = levels[e.l0];
-                const Cubemap& next = levels[e.l1];
-                const float3 c0 = Cubemap::trilinearFilterAt(cmBase, next, e.lerp, L);
-                Li += c0;
-            }
-            Cubemap::writeAt(data, Cubemap::Texel(Li * inumSamples));
-        }
-    });
+    processTiles(js, dst, false, updater, userdata, texel);
 }
 
 // Not importance-sampled
@@ -507,7 +507,8 @@ void CubemapSH::windowSH(std::unique_ptr<float3[]>& sh, size_t numBands, float c
     }
 }
 
-std::unique_ptr<float3[]> CubemapSH::computeSH(JobSystem& js, const Cubemap& cm, size_t numBands, bool irradiance) {
+std::unique_ptr<float3[]> CubemapSH::computeSH(JobSystem& js, const Cubemap& cm, size_t numBands, bool irradiance,
+        uint8_t faceMask) {
 
     const size_t numCoefs = numBands * numBands;
     std::unique_ptr<float3[]> SH(new float3[numCoefs]{});
@@ -528,6 +529,9 @@ std::unique_ptr<float3[]> CubemapSH::computeSH(JobSystem& js, const Cubemap& cm,
 
     CubemapUtils::process<State>(const_cast<Cubemap&>(cm), js,
             [&](State& state, size_t y, Cubemap::Face f, Cubemap::Texel const* data, size_t dim) {
+        if (!(faceMask & (1u << size_t(f)))) {
+            return;
+        }
         for (size_t x=0 ; x<dim ; ++x, ++data) {
 
             float3 s(cm.getDirectionFor(f, x, y));
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ibl/IrradianceVolume.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace filament::math;
+
+namespace filament {
+namespace ibl {
+
+IrradianceVolume::IrradianceVolume(float3 min, float3 max, uint3 resolution, size_t numBands)
+        : mMin(min), mMax(max),
+          mResolution(std::max(resolution.x, 1u), std::max(resolution.y, 1u),
+                  std::max(resolution.z, 1u)),
+          mNumBands(numBands),
+          mNumCoefs(numBands * numBands) {
+    mCoefficients.resize(getProbeCount() * mNumCoefs);
+}
+
+size_t IrradianceVolume::getProbeIndex(uint3 probe) const noexcept {
+    probe = min(probe, mResolution - 1u);
+    return (size_t(probe.z) * mResolution.y + probe.y) * mResolution.x + probe.x;
+}
+
+float3 IrradianceVolume::getProbePosition(uint3 probe) const noexcept {
+    float3 t;
+    for (size_t i = 0; i < 3; i++) {
+        t[i] = mResolution[i] > 1 ? float(probe[i]) / float(mResolution[i] - 1) : 0.5f;
+    }
+    return mMin + (mMax - mMin) * t;
+}
+
+void IrradianceVolume::setProbe(uint3 probe, float3 const* sh) noexcept {
+    std::copy_n(sh, mNumCoefs, mCoefficients.data() + getProbeIndex(probe) * mNumCoefs);
+}
+
+float3 const* IrradianceVolume::getProbe(uint3 probe) const noexcept {
+    return mCoefficients.data() + getProbeIndex(probe) * mNumCoefs;
+}
+
+void IrradianceVolume::interpolate(float3 position, float3* sh) const noexcept {
+    // position in probe units, and the probes around it with their weights
+    uint3 p0;
+    uint3 p1;
+    float3 t;
+    for (size_t i = 0; i < 3; i++) {
+        const float extent = mMax[i] - mMin[i];
+        const float last = float(mResolution[i] - 1);
+        const float p = extent > 0.0f ?
+                std::clamp((position[i] - mMin[i]) / extent * last, 0.0f, last) : 0.0f;
+        p0[i] = uint32_t(p);
+        p1[i] = std::min(p0[i] + 1, mResolution[i] - 1);
+        t[i] = p - float(p0[i]);
+    }
+
+    std::fill_n(sh, mNumCoefs, float3{});
+    for (uint32_t corner = 0; corner < 8; corner++) {
+        const uint3 probe{
+                corner & 1u ? p1.x : p0.x,
+                corner & 2u ? p1.y : p0.y,
+                corner & 4u ? p1.z : p0.z };
+        const float weight =
+                (corner & 1u ? t.x : 1.0f - t.x) *
+                (corner & 2u ? t.y : 1.0f - t.y) *
+                (corner & 4u ? t.z : 1.0f - t.z);
+        if (weight > 0.0f) {
+            float3 const* coefs = getProbe(probe);
+            for (size_t i = 0; i < mNumCoefs; i++) {
+                sh[i] += coefs[i] * weight;
+            }
+        }
+    }
+}
+
+void IrradianceVolume::getTextureData(size_t coefficient, float4* texels) const noexcept {
+    for (size_t i = 0, c = getProbeCount(); i < c; i++) {
+        texels[i] = float4{ mCoefficients[i * mNumCoefs + coefficient], 1.0f };
+    }
+}
+
+} // namespace ibl
+} // namespace filament
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <ibl/IrradianceVolume.h>
+
+#include <math/vec3.h>
+#include <math/vec4.h>
+
+#include <vector>
+
+using namespace filament::math;
+using namespace filament::ibl;
+
+class IrradianceVolumeTest : public testing::Test {
+protected:
+    static constexpr size_t BANDS = 2;
+    static constexpr size_t COEFS = BANDS * BANDS;
+
+    // A 3x2x4 grid of probes over [-1, 1] x [0, 2] x [0, 6] whose coefficient i is its position
+    // times i + 1. The coefficients are linear in the position, so trilinear interpolation
+    // recovers them exactly anywhere in the volume.
+    IrradianceVolumeTest()
+            : mVolume({ -1.0f, 0.0f, 0.0f }, { 1.0f, 2.0f, 6.0f }, { 3, 2, 4 }, BANDS) {
+        uint3 const r = mVolume.getResolution();
+        for (uint32_t z = 0; z < r.z; z++) {
+            for (uint32_t y = 0; y < r.y; y++) {
+                for (uint32_t x = 0; x < r.x; x++) {
+                    float3 sh[COEFS];
+                    expected(mVolume.getProbePosition({ x, y, z }), sh);
+                    mVolume.setProbe({ x, y, z }, sh);
+                }
+            }
+        }
+    }
+
+    static void expected(float3 position, float3* sh) {
+        for (size_t i = 0; i < COEFS; i++) {
+            sh[i] = position * float(i + 1);
+        }
+    }
+
+    void expectInterpolated(float3 position, float3 clamped) const {
+        float3 sh[COEFS];
+        float3 e[COEFS];
+        mVolume.interpolate(position, sh);
+        expected(clamped, e);
+        for (size_t i = 0; i < COEFS; i++) {
+            EXPECT_NEAR(sh[i].x, e[i].x, 1e-5f) << "coefficient " << i;
+            EXPECT_NEAR(sh[i].y, e[i].y, 1e-5f) << "coefficient " << i;
+            EXPECT_NEAR(sh[i].z, e[i].z, 1e-5f) << "coefficient " << i;
+        }
+    }
+
+    IrradianceVolume mVolume;
+};
+
+TEST_F(IrradianceVolumeTest, Layout) {
+    EXPECT_EQ(mVolume.getResolution(), uint3(3, 2, 4));
+    EXPECT_EQ(mVolume.getBandCount(), BANDS);
+    EXPECT_EQ(mVolume.getProbeCount(), 3u * 2u * 4u);
+
+    // the probes are on the corners of the volume and evenly spaced in between
+    EXPECT_EQ(mVolume.getProbePosition({ 0, 0, 0 }), float3(-1.0f, 0.0f, 0.0f));
+    EXPECT_EQ(mVolume.getProbePosition({ 2, 1, 3 }), float3(1.0f, 2.0f, 6.0f));
+    EXPECT_EQ(mVolume.getProbePosition({ 1, 0, 2 }), float3(0.0f, 0.0f, 4.0f));
+
+    // a single probe along an axis is centered
+    IrradianceVolume flat({ 0.0f, 0.0f, 0.0f }, { 4.0f, 4.0f, 4.0f }, { 2, 1, 2 });
+    EXPECT_EQ(flat.getProbePosition({ 1, 0, 1 }), float3(4.0f, 2.0f, 4.0f));
+}
+
+TEST_F(IrradianceVolumeTest, Probes) {
+    float3 const* sh = mVolume.getProbe({ 2, 1, 3 });
+    EXPECT_EQ(sh[0], float3(1.0f, 2.0f, 6.0f));
+    EXPECT_EQ(sh[COEFS - 1], float3(1.0f, 2.0f, 6.0f) * float(COEFS));
+}
+
+TEST_F(IrradianceVolumeTest, TrilinearInterpolation) {
+    // on the probes
+    expectInterpolated({ -1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f });
+    expectInterpolated({ 0.0f, 2.0f, 4.0f }, { 0.0f, 2.0f, 4.0f });
+
+    // between the probes, along one axis and along all of them
+    expectInterpolated({ 0.5f, 0.0f, 0.0f }, { 0.5f, 0.0f, 0.0f });
+    expectInterpolated({ -0.25f, 1.5f, 3.0f }, { -0.25f, 1.5f, 3.0f });
+    expectInterpolated({ 0.9f, 0.1f, 5.9f }, { 0.9f, 0.1f, 5.9f });
+}
+
+TEST_F(IrradianceVolumeTest, ClampToBounds) {
+    // outside of the volume, the position is clamped to it on each axis independently
+    expectInterpolated({ -5.0f, 1.0f, 3.0f }, { -1.0f, 1.0f, 3.0f });
+    expectInterpolated({ 0.5f, 10.0f, -2.0f }, { 0.5f, 2.0f, 0.0f });
+    expectInterpolated({ 3.0f, -1.0f, 7.0f }, { 1.0f, 0.0f, 6.0f });
+}
+
+TEST_F(IrradianceVolumeTest, TextureData) {
+    std::vector<float4> texels(mVolume.getProbeCount());
+    mVolume.getTextureData(1, texels.data());
+
+    // texel (x, y, z) is at index (z * resolution.y + y) * resolution.x + x
+    uint3 const r = mVolume.getResolution();
+    for (uint32_t z = 0; z < r.z; z++) {
+        for (uint32_t y = 0; y < r.y; y++) {
+            for (uint32_t x = 0; x < r.x; x++) {
+                float4 const& texel = texels[(z * r.y + y) * r.x + x];
+                EXPECT_EQ(texel.xyz, mVolume.getProbe({ x, y, z })[1]);
+                EXPECT_EQ(texel.w, 1.0f);
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -24,6 +24,10 @@
 
 namespace image {
 
+// The variants that take a result image write to it instead of allocating a new one, its
+// dimensions must be those of the image that would be returned. Unless stated otherwise, it must
+// not share the pixels of the source.
+
 // Concatenates images horizontally to create a filmstrip atlas, similar to numpy's hstack.
 LinearImage horizontalStack(std::initializer_list<LinearImage> images);
 LinearImage horizontalStack(LinearImage const* img, size_t count);
@@ -36,23 +40,38 @@ LinearImage verticalStack(LinearImage const* img, size_t count);
 LinearImage horizontalFlip(const LinearImage& image);
 LinearImage verticalFlip(const LinearImage& image);
 
+// The result may share the pixels of the source, to flip it in place.
+void horizontalFlip(const LinearImage& image, LinearImage* result);
+void verticalFlip(const LinearImage& image, LinearImage* result);
+
 // Transforms normals (components live in [-1,+1]) into colors (components live in [0,+1]).
 LinearImage vectorsToColors(const LinearImage& image);
 LinearImage colorsToVectors(const LinearImage& image);
 
+// The result may share the pixels of the source.
+void vectorsToColors(const LinearImage& image, LinearImage* result);
+void colorsToVectors(const LinearImage& image, LinearImage* result);
+
 // Creates a single-channel image by extracting the selected channel.
 LinearImage extractChannel(const LinearImage& image, uint32_t channel);
+void extractChannel(const LinearImage& image, uint32_t channel, LinearImage* result);
 
 // Constructs a multi-channel image by copying data from a sequence of single-channel images.
 LinearImage combineChannels(std::initializer_list<LinearImage> images);
 LinearImage combineChannels(LinearImage const* img, size_t count);
+void combineChannels(LinearImage const* img, size_t count, LinearImage* result);
 
 // Generates a new image with rows & columns swapped.
 LinearImage transpose(const LinearImage& image);
 
+// The result may share the pixels of a square source, to transpose it in place.
+void transpose(const LinearImage& image, LinearImage* result);
+
 // Extracts pixels by specifying a crop window where (0,0) is the top-left corner of the image.
 // The boundary is specified as Left Top Right Bottom.
 LinearImage cropRegion(const LinearImage& image, uint32_t l, uint32_t t, uint32_t r, uint32_t b);
+void cropRegion(const LinearImage& image, uint32_t l, uint32_t t, uint32_t r, uint32_t b,
+        LinearImage* result);
 
 // Lexicographically compares two images, similar to memcmp.
 int compare(const LinearImage& a, const LinearImage& b, float epsilon = 0.0f);
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef IMAGE_IMAGEPOOL_H
+#define IMAGE_IMAGEPOOL_H
+
+#include <image/LinearImage.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace image {
+
+/**
+ * ImagePool recycles the pixel storage of transient images, e.g. the intermediate images of a
+ * chain of resampling operations or the levels of successive mipmap pyramids.
+ *
+ * The pixels of an acquired image return to the pool when the last LinearImage referencing them
+ * is destroyed, and are handed out again for any image that fits in them. Images may outlive the
+ * pool, their pixels are then simply freed. ImagePool is thread safe.
+ */
+class ImagePool {
+public:
+    ImagePool();
+    ~ImagePool();
+
+    ImagePool(ImagePool const&) = delete;
+    ImagePool& operator=(ImagePool const&) = delete;
+
+    /**
+     * Returns a zeroed-out image, like the LinearImage constructor, reusing the smallest released
+     * storage that is large enough.
+     */
+    LinearImage acquire(uint32_t width, uint32_t height, uint32_t channels);
+
+    /**
+     * Frees all the released storage.
+     */
+    void clear();
+
+    /**
+     * Returns the size in bytes of the released storage waiting to be reused.
+     */
+    size_t getFreeSize() const;
+
+private:
+    struct State;
+    std::shared_ptr<State> mState;
+};
+
+} // namespace image
+
+#endif /* IMAGE_IMAGEPOOL_H */
@@ -19,8 +19,14 @@
 
 #include <image/LinearImage.h>
 
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace image {
 
+class ImagePool;
+
 /**
  * Value of a single point sample, allocated according to the number of image channels.
  */
@@ -100,15 +106,27 @@ struct ImageSampler {
 
 /**
  * Resizes or blurs the given linear image, producing a new linear image with the given dimensions.
+ *
+ * The filter weights are computed once per pass. When a JobSystem is given, the rows of each pass
+ * are filtered concurrently as jobs of it, in which case the calling thread must be adopted. The
+ * result doesn't depend on whether a JobSystem is used.
  */
 LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t height,
-        const ImageSampler& sampler);
+        const ImageSampler& sampler, utils::JobSystem* js = nullptr);
+
+/**
+ * Same as above, but writes to an existing image, whose dimensions give the target size and whose
+ * channel count must be that of the source. The intermediate image of the two passes is taken from
+ * the given pool, if any, so that a sequence of resamplings allocates nothing once the pool is warm.
+ */
+void resampleImage(const LinearImage& source, LinearImage* result, const ImageSampler& sampler,
+        utils::JobSystem* js = nullptr, ImagePool* pool = nullptr);
 
 /**
  * Resizes the given linear image using a simplified API that takes target dimensions and filter.
  */
 LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t height,
-        Filter filter = Filter::DEFAULT);
+        Filter filter = Filter::DEFAULT, utils::JobSystem* js = nullptr);
 
 /**
  * Computes a single sample for the given texture coordinate and writes the resulting color
@@ -135,9 +153,12 @@ void computeSingleSample(const LinearImage& source, float x, float y, SingleSamp
  *
  * Source image need not be power-of-two. In the result vector, the half-size image is returned at
  * index 0, the quarter-size image is at index 1, etc. Please note that the original-sized image is
- * not included.
+ * not included. The optional JobSystem is used as with resampleImage. When a pool is given, the
+ * levels and the intermediate images are taken from it, which lets a tool that processes several
+ * images recycle the storage of the previous pyramids.
  */
-void generateMipmaps(const LinearImage& source, Filter, LinearImage* result, uint32_t mipCount);
+void generateMipmaps(const LinearImage& source, Filter, LinearImage* result, uint32_t mipCount,
+        utils::JobSystem* js = nullptr, ImagePool* pool = nullptr);
 
 /**
  * Returns the number of miplevels it would take to downsample the given image down to 1x1. This
@@ -22,6 +22,10 @@
 #include <cstdint>
 #include <memory>
 
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace image {
 
 struct KtxInfo {
@@ -71,12 +75,30 @@ public:
      */
     KtxBundle(uint32_t numMipLevels, uint32_t arrayLength, bool isCubemap);
 
+    /**
+     * Controls whether a deserialized bundle owns a copy of its blobs.
+     */
+    enum class BlobStorage {
+        COPY,   // The blobs are copied into the bundle.
+        VIEW    // The blobs point into the serialized data, e.g. a memory-mapped KTX file.
+    };
+
     /**
      * Creates a new bundle by deserializing the given data.
      *
-     * Typically, this constructor is used to consume the contents of a KTX file.
+     * Typically, this constructor is used to consume the contents of a KTX file. Both KTX 1.1 and
+     * KTX 2.0 containers are accepted, see serializeKtx2() for the supported KTX 2.0 features.
+     *
+     * With BlobStorage::VIEW, nothing is copied: the serialized data must outlive the bundle and
+     * every use of its blobs, and the bundle is read-only, i.e. setBlob() and allocateBlob()
+     * return false. This halves the peak memory when loading large textures.
+     *
+     * Supercompressed KTX 2.0 levels are always decompressed into the bundle, even with VIEW,
+     * in which case isView() returns false. If a JobSystem is given, the levels are decompressed
+     * in parallel.
      */
-    KtxBundle(uint8_t const* bytes, uint32_t nbytes);
+    KtxBundle(uint8_t const* bytes, uint32_t nbytes, BlobStorage storage = BlobStorage::COPY,
+            utils::JobSystem* js = nullptr);
 
     /**
      * Serializes the bundle into the given target memory. Returns false if there's not enough
@@ -91,6 +113,30 @@ public:
      */
     uint32_t getSerializedLength() const;
 
+    /**
+     * Supercompression schemes of KTX 2.0 containers, applied to each miplevel as a whole.
+     * The values are the ones defined by the KTX 2.0 specification.
+     */
+    enum class Supercompression : uint32_t {
+        NONE = 0,
+        ZLIB = 3
+    };
+
+    /**
+     * Serializes the bundle into a KTX 2.0 container, allocated into "result", and returns its
+     * size in bytes.
+     *
+     * KTX 2.0 identifies formats with a Vulkan format rather than the OpenGL enums of KtxInfo, so
+     * only the 8-bit unorm, half and float formats, R11F_G11F_B10F and the S3TC, ETC2/EAC and ASTC
+     * formats can be written. Returns 0 if glInternalFormat is not one of them.
+     *
+     * Supercompression reduces the download size, but the levels must be decompressed before
+     * they can be uploaded. If a JobSystem is given, the levels are compressed in parallel.
+     */
+    uint32_t serializeKtx2(std::unique_ptr<uint8_t[]>* result,
+            Supercompression supercompression = Supercompression::NONE,
+            utils::JobSystem* js = nullptr) const;
+
     /**
      * Gets or sets information about the texture object, such as format and type.
      */
@@ -109,7 +155,7 @@ public:
      * Assumes 3 bands for a total of 9 RGB coefficients.
      * Returns true if successful.
      */
-    bool getSphericalHarmonics(filament::math::float3* result);
+    bool getSphericalHarmonics(filament::math::float3* result) const;
 
     /**
      * Gets the number of miplevels (this is never zero).
@@ -126,15 +172,22 @@ public:
      */
     bool isCubemap() const { return mNumCubeFaces > 1; }
 
+    /**
+     * Returns whether the blobs point into external serialized data, see BlobStorage::VIEW.
+     */
+    bool isView() const;
+
     /**
      * Retrieves a weak reference to a given data blob. Returns false if the given blob index is out
      * of bounds, or if the blob at the given index is empty.
+     *
+     * The blobs of a given miplevel are contiguous. The blobs of a view must not be written to.
      */
     bool getBlob(KtxBlobIndex index, uint8_t** data, uint32_t* size) const;
 
     /**
      * Copies the given data into the blob at the given index, replacing whatever is already there.
-     * Returns false if the given blob index is out of bounds.
+     * Returns false if the given blob index is out of bounds, or if the bundle is a view.
      */
     bool setBlob(KtxBlobIndex index, uint8_t const* data, uint32_t size);
 
@@ -264,6 +317,9 @@ public:
     static constexpr uint32_t SRGB8_ALPHA8_ETC2_EAC = 0x9279;
 
 private:
+    void deserializeKtx2(uint8_t const* bytes, uint32_t nbytes, BlobStorage storage,
+            utils::JobSystem* js);
+
     image::KtxInfo mInfo = {};
     uint32_t mNumMipLevels;
     uint32_t mArrayLength;
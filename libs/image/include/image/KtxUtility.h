@@ -22,6 +22,8 @@
 
 #include <image/KtxBundle.h>
 
+#include <utils/MappedFile.h>
+
 namespace image {
 
 /**
@@ -156,6 +158,34 @@ namespace ktx {
         return createTexture(engine, *ktx, srgb, freeKtx, ktx);
     }
 
+    /**
+     * Creates a Texture object from a memory-mapped KTX file without copying its contents: each
+     * miplevel is handed to the texture as a span of the mapping, and the file is unmapped and
+     * destroyed after all the texture data has been uploaded. Supercompressed KTX2 files can't be
+     * used in place, their miplevels are decompressed first.
+     *
+     * @param engine Used to create the Filament Texture
+     * @param file Mapped KTX file, allocated with new, which this function takes ownership of
+     * @param srgb Forces the KTX-specified format into an SRGB format if possible
+     */
+    inline Texture* createTexture(Engine* engine, utils::MappedFile* file, bool srgb) {
+        auto unmap = [] (void* userdata) {
+            utils::MappedFile* file = (utils::MappedFile*) userdata;
+            delete file;
+        };
+        KtxBundle* ktx = new KtxBundle(file->data(), uint32_t(file->size()),
+                KtxBundle::BlobStorage::VIEW);
+        if (!ktx->isView()) {
+            // A supercompressed KTX2 file was decompressed into the bundle, the mapping can go.
+            delete file;
+            return createTexture(engine, ktx, srgb);
+        }
+        // The view only describes the blobs, it isn't needed after createTexture() returns.
+        Texture* texture = createTexture(engine, *ktx, srgb, unmap, file);
+        delete ktx;
+        return texture;
+    }
+
     template<typename T>
     T toCompressedFilamentEnum(uint32_t format) {
         switch (format) {
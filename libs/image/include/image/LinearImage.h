@@ -18,6 +18,7 @@
 #define IMAGE_LINEARIMAGE_H
 
 #include <cstdint>
+#include <memory>
 
 /**
  * Types and free functions for the Filament core imaging library, primarily used for offline tools,
@@ -49,6 +50,12 @@ public:
      */
     LinearImage(uint32_t width, uint32_t height, uint32_t channels);
 
+    /**
+     * Wraps existing pixel data, which must hold at least width * height * channels floats. The
+     * pixels are not cleared, and are released with the last image referencing them.
+     */
+    LinearImage(uint32_t width, uint32_t height, uint32_t channels, std::shared_ptr<float> pixels);
+
     /**
      * Makes a shallow copy with shared pixel data.
      */
@@ -89,76 +89,122 @@ LinearImage verticalStack(const LinearImage* first, size_t count) {
     return transpose(result);
 }
 
+static void checkDimensions(const LinearImage* result, uint32_t width, uint32_t height,
+        uint32_t channels) {
+    ASSERT_PRECONDITION(result->getWidth() == width && result->getHeight() == height &&
+            result->getChannels() == channels, "Result has the wrong dimensions.");
+}
+
 LinearImage horizontalFlip(const LinearImage& image) {
+    LinearImage result(image.getWidth(), image.getHeight(), image.getChannels());
+    horizontalFlip(image, &result);
+    return result;
+}
+
+// Both flips read the two mirrored values before writing them, so they also work in place.
+void horizontalFlip(const LinearImage& image, LinearImage* result) {
     const uint32_t width = image.getWidth();
     const uint32_t height = image.getHeight();
     const uint32_t channels = image.getChannels();
-    LinearImage result(width, height, channels);
+    checkDimensions(result, width, height, channels);
     for (uint32_t row = 0; row < height; ++row) {
-        for (uint32_t col = 0; col < width; ++col) {
-            float* dst = result.getPixelRef(width - 1 - col, row);
-            float const* src = image.getPixelRef(col, row);
+        for (uint32_t col = 0; col < (width + 1) / 2; ++col) {
+            float const* left = image.getPixelRef(col, row);
+            float const* right = image.getPixelRef(width - 1 - col, row);
+            float* dstLeft = result->getPixelRef(col, row);
+            float* dstRight = result->getPixelRef(width - 1 - col, row);
             for (uint32_t c = 0; c < channels; ++c) {
-                dst[c] = src[c];
+                const float l = left[c];
+                const float r = right[c];
+                dstLeft[c] = r;
+                dstRight[c] = l;
             }
         }
     }
-    return result;
 }
 
 LinearImage verticalFlip(const LinearImage& image) {
+    LinearImage result(image.getWidth(), image.getHeight(), image.getChannels());
+    verticalFlip(image, &result);
+    return result;
+}
+
+void verticalFlip(const LinearImage& image, LinearImage* result) {
     const uint32_t width = image.getWidth();
     const uint32_t height = image.getHeight();
     const uint32_t channels = image.getChannels();
-    LinearImage result(width, height, channels);
-    for (uint32_t row = 0; row < height; ++row) {
-        float const* src = image.getPixelRef(0, row);
-        float* dst = result.getPixelRef(0, height - 1 - row);
-        memcpy(dst, src, width * channels * sizeof(float));
+    checkDimensions(result, width, height, channels);
+    const size_t rowSize = size_t(width) * channels;
+    for (uint32_t row = 0; row < (height + 1) / 2; ++row) {
+        float const* top = image.getPixelRef(0, row);
+        float const* bottom = image.getPixelRef(0, height - 1 - row);
+        float* dstTop = result->getPixelRef(0, row);
+        float* dstBottom = result->getPixelRef(0, height - 1 - row);
+        for (size_t i = 0; i < rowSize; ++i) {
+            const float t = top[i];
+            const float b = bottom[i];
+            dstTop[i] = b;
+            dstBottom[i] = t;
+        }
     }
-    return result;
 }
 
 template<class VecT>
-LinearImage applyScaleOffset(const LinearImage& image,
+void applyScaleOffset(const LinearImage& image, LinearImage* result,
         typename VecT::value_type scale, typename VecT::value_type offset) {
     const uint32_t width = image.getWidth(), height = image.getHeight();
-    LinearImage result(width, height, image.getChannels());
+    checkDimensions(result, width, height, image.getChannels());
     auto src = (VecT const*) image.getPixelRef();
-    auto dst = (VecT*) result.getPixelRef();
+    auto dst = (VecT*) result->getPixelRef();
     for (uint32_t n = 0, end = width * height; n < end; ++n) {
         dst[n] = scale * src[n] + VecT{offset};
     }
-    return result;
 }
 
 LinearImage vectorsToColors(const LinearImage& image) {
+    LinearImage result(image.getWidth(), image.getHeight(), image.getChannels());
+    vectorsToColors(image, &result);
+    return result;
+}
+
+void vectorsToColors(const LinearImage& image, LinearImage* result) {
     ASSERT_PRECONDITION(image.getChannels() == 3 || image.getChannels() == 4,
                         "Must be a 3 or 4 channel image");
-    return image.getChannels() == 3
-        ? applyScaleOffset<float3>(image, 0.5f, 0.5f)
-        : applyScaleOffset<float4>(image, 0.5f, 0.5f);
+    image.getChannels() == 3
+        ? applyScaleOffset<float3>(image, result, 0.5f, 0.5f)
+        : applyScaleOffset<float4>(image, result, 0.5f, 0.5f);
 }
 
 LinearImage colorsToVectors(const LinearImage& image) {
+    LinearImage result(image.getWidth(), image.getHeight(), image.getChannels());
+    colorsToVectors(image, &result);
+    return result;
+}
+
+void colorsToVectors(const LinearImage& image, LinearImage* result) {
     ASSERT_PRECONDITION(image.getChannels() == 3 || image.getChannels() == 4,
                         "Must be a 3 or 4 channel image");
-    return image.getChannels() == 3
-        ? applyScaleOffset<float3>(image, 2.0f, -1.0f)
-        : applyScaleOffset<float4>(image, 2.0f, -1.0f);
+    image.getChannels() == 3
+        ? applyScaleOffset<float3>(image, result, 2.0f, -1.0f)
+        : applyScaleOffset<float4>(image, result, 2.0f, -1.0f);
 }
 
 LinearImage extractChannel(const LinearImage& source, uint32_t channel) {
+    LinearImage result(source.getWidth(), source.getHeight(), 1);
+    extractChannel(source, channel, &result);
+    return result;
+}
+
+void extractChannel(const LinearImage& source, uint32_t channel, LinearImage* result) {
     const uint32_t width = source.getWidth(), height = source.getHeight();
     const uint32_t nchan = source.getChannels();
     ASSERT_PRECONDITION(channel < nchan, "Channel is out of range.");
-    LinearImage result(width, height, 1);
+    checkDimensions(result, width, height, 1);
     auto src = source.getPixelRef();
-    auto dst = result.getPixelRef();
+    auto dst = result->getPixelRef();
     for (uint32_t n = 0, npixels = width * height; n < npixels; ++n, ++dst, src += nchan) {
         dst[0] = src[channel];
     }
-    return result;
 }
 
 LinearImage combineChannels(std::initializer_list<LinearImage> images) {
@@ -167,6 +213,13 @@ LinearImage combineChannels(std::initializer_list<LinearImage> images) {
 }
 
 LinearImage combineChannels(LinearImage const* img, size_t count) {
+    ASSERT_PRECONDITION(count > 0, "Must supply one or more image planes for combining.");
+    LinearImage result(img[0].getWidth(), img[0].getHeight(), (uint32_t) count);
+    combineChannels(img, count, &result);
+    return result;
+}
+
+void combineChannels(LinearImage const* img, size_t count, LinearImage* result) {
     ASSERT_PRECONDITION(count > 0, "Must supply one or more image planes for combining.");
     const uint32_t width = img[0].getWidth();
     const uint32_t height = img[0].getHeight();
@@ -176,8 +229,8 @@ LinearImage combineChannels(LinearImage const* img, size_t count) {
         ASSERT_PRECONDITION(plane.getHeight() == height, "Planes must all have same height.");
         ASSERT_PRECONDITION(plane.getChannels() == 1, "Planes must be single channel.");
     }
-    LinearImage result(width, height, (uint32_t) count);
-    float* dst = result.getPixelRef();
+    checkDimensions(result, width, height, (uint32_t) count);
+    float* dst = result->getPixelRef();
     uint32_t sindex = 0, dindex = 0;
     while (dindex < width * height * count) {
         for (size_t c = 0; c < count; ++c, ++dindex) {
@@ -187,21 +240,37 @@ LinearImage combineChannels(LinearImage const* img, size_t count) {
         }
         ++sindex;
     }
-    return result;
 }
 
 // The transpose operation does not simply set a flag, it performs actual movement of data. This is
 // very handy for separable filters because it (a) improves cache coherency in the second pass, and
 // (b) allows the client to consume columns in the same way that it consumes rows. Our
-// implementation does not support in-place transposition but it is simple and robust for non-square
-// images.
+// implementation only supports in-place transposition of square images, but it is simple and robust
+// for non-square images.
 LinearImage transpose(const LinearImage& image) {
+    LinearImage result(image.getHeight(), image.getWidth(), image.getChannels());
+    transpose(image, &result);
+    return result;
+}
+
+void transpose(const LinearImage& image, LinearImage* result) {
     const uint32_t width = image.getWidth();
     const uint32_t height = image.getHeight();
     const uint32_t channels = image.getChannels();
-    LinearImage result(height, width, channels);
+    checkDimensions(result, height, width, channels);
     float const* source = image.getPixelRef();
-    float* target = result.getPixelRef();
+    float* target = result->getPixelRef();
+    if (source == target) {
+        ASSERT_PRECONDITION(width == height, "Only square images can be transposed in place.");
+        for (uint32_t i = 0; i < height; ++i) {
+            for (uint32_t j = i + 1; j < width; ++j) {
+                float* a = target + channels * (i * width + j);
+                float* b = target + channels * (j * width + i);
+                std::swap_ranges(a, a + channels, b);
+            }
+        }
+        return;
+    }
     for (uint32_t n = 0; n < width * height; ++n) {
         const uint32_t i = n / width;
         const uint32_t j = n % width;
@@ -211,23 +280,28 @@ LinearImage transpose(const LinearImage& image) {
             dst[c] = src[c];
         }
     }
-    return result;
 }
 
 LinearImage cropRegion(const LinearImage& image, uint32_t left, uint32_t top, uint32_t right,
         uint32_t bottom) {
+    LinearImage result(right - left, bottom - top, image.getChannels());
+    cropRegion(image, left, top, right, bottom, &result);
+    return result;
+}
+
+void cropRegion(const LinearImage& image, uint32_t left, uint32_t top, uint32_t right,
+        uint32_t bottom, LinearImage* result) {
     uint32_t width = right - left;
     uint32_t height = bottom - top;
     uint32_t channels = image.getChannels();
-    LinearImage result(width, height, channels);
+    checkDimensions(result, width, height, channels);
     float const* source = image.getPixelRef(left, top);
-    float* target = result.getPixelRef();
+    float* target = result->getPixelRef();
     for (int32_t row = 0; row < height; ++row) {
         memcpy(target, source, width * channels * sizeof(float));
         target += width * channels;
         source += image.getWidth() * channels;
     }
-    return result;
 }
 
 int compare(const LinearImage& a, const LinearImage& b, float epsilon) {
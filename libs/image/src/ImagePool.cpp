@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <image/ImagePool.h>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+namespace image {
+
+struct ImagePool::State {
+    mutable std::mutex lock;
+    std::multimap<size_t, std::unique_ptr<float[]>> freeStorage; // keyed by capacity in floats
+    size_t freeSize = 0;
+};
+
+ImagePool::ImagePool() : mState(std::make_shared<State>()) {
+}
+
+ImagePool::~ImagePool() = default;
+
+LinearImage ImagePool::acquire(uint32_t width, uint32_t height, uint32_t channels) {
+    const size_t size = size_t(width) * height * channels;
+    std::unique_ptr<float[]> storage;
+    size_t capacity = size;
+    {
+        std::lock_guard<std::mutex> guard(mState->lock);
+        auto pos = mState->freeStorage.lower_bound(size);
+        if (pos != mState->freeStorage.end()) {
+            capacity = pos->first;
+            storage = std::move(pos->second);
+            mState->freeStorage.erase(pos);
+            mState->freeSize -= capacity * sizeof(float);
+        }
+    }
+    if (!storage) {
+        storage.reset(new float[capacity]);
+    }
+    memset(storage.get(), 0, size * sizeof(float));
+
+    // The deleter only holds a weak reference, so that the images don't keep the pool alive.
+    std::weak_ptr<State> weakState = mState;
+    std::shared_ptr<float> pixels(storage.release(), [weakState, capacity](float* p) {
+        std::unique_ptr<float[]> released(p);
+        if (std::shared_ptr<State> state = weakState.lock()) {
+            std::lock_guard<std::mutex> guard(state->lock);
+            state->freeStorage.emplace(capacity, std::move(released));
+            state->freeSize += capacity * sizeof(float);
+        }
+    });
+    return LinearImage(width, height, channels, std::move(pixels));
+}
+
+void ImagePool::clear() {
+    std::lock_guard<std::mutex> guard(mState->lock);
+    mState->freeStorage.clear();
+    mState->freeSize = 0;
+}
+
+size_t ImagePool::getFreeSize() const {
+    std::lock_guard<std::mutex> guard(mState->lock);
+    return mState->freeSize;
+}
+
+} // namespace image
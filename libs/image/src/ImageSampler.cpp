@@ -16,14 +16,20 @@
 
 #include <image/ImageSampler.h>
 #include <image/ImageOps.h>
+#include <image/ImagePool.h>
 
 #include <math/scalar.h>
 #include <math/vec3.h>
 #include <math/vec4.h>
 
-#include <utils/Panic.h>
+#include <utils/compiler.h>
 #include <utils/CString.h>
+#include <utils/debug.h>
+#include <utils/JobSystem.h>
+#include <utils/Panic.h>
 
+#include <functional>
+#include <limits>
 #include <memory>
 #include <vector>
 #include <unordered_map>
@@ -97,21 +103,22 @@ const FilterFunction Lanczos {
     .boundingRadius = 1
 };
 
-// Describes a Multiply-Add operation: target[targetIndex] += source[sourceIndex] * weight.
-// This allows us to cache the weights computed by evaluation of the filter function, as well as
-// the indices that are generated from careful alignment of sample and target samples.
-// We allow signed source indices to accommodate external source samples whose values depend
+// The weights of a 1D filter pass, which are computed once per pass. Each target sample is the
+// weighted sum of a contiguous span of source samples, the weights of all spans are stored back to
+// back. We allow signed source indices to accommodate external source samples whose values depend
 // on the wrap-mode configuration in the sampler.
-struct MadInstruction {
-    uint32_t targetIndex;
-    int32_t sourceIndex;
-    float weight;
+struct FilterKernel {
+    struct Span {
+        int32_t first;      // index of the first source sample
+        uint32_t count;     // number of source samples, some of them may have a weight of zero
+        uint32_t offset;    // index of the first weight in the weights array
+    };
+    std::vector<Span> spans;
+    std::vector<float> weights;
 };
 
-using MadProgram = std::vector<MadInstruction>;
-
-// Generates a list of MAD instructions that transforms a row of samples of length "nsource"
-// into a sequence of length "ntarget" using the given filter function.
+// Generates the kernel that transforms a row of samples of length "nsource" into a sequence of
+// length "ntarget" using the given filter function.
 //
 // The given left / right floats define a source range within [0,1] such that 0 is at the left edge
 // of the the left-most pixel and 1 is at the right edge of the right-most pixel.
@@ -121,8 +128,8 @@ using MadProgram = std::vector<MadInstruction>;
 //    d....delta (i.e. the normalized width of a single pixel square)
 //    x....normalized coord in [0..1] where 0/1 are the outer edges of the range.
 //    i....integer index where 0 is the left-most pixel and n-1 is the right-most pixel.
-void generateMadProgram(uint32_t ntarget, uint32_t nsource, float left, float right,
-        FilterFunction filter, float radiusMultiplier, MadProgram* result) {
+void generateFilterKernel(uint32_t ntarget, uint32_t nsource, float left, float right,
+        FilterFunction filter, float radiusMultiplier, FilterKernel* result) {
     const float dtarget = 1.0f / ntarget;
     const float fnsource = float(nsource) * (right - left);
     const bool minifying = float(ntarget) < fnsource;
@@ -131,16 +138,20 @@ void generateMadProgram(uint32_t ntarget, uint32_t nsource, float left, float ri
     // As an optimization, compute the "filterBound", which is the half-width of the filter within
     // the [0,1] domain. If this were a huge number, the filtered results would look the same, but
     // the filter would perform very poorly because it would be iterating over a lot more samples
-    // than necessary.
-    const float filterBounds = domainScale * std::abs(filter.boundingRadius);
+    // than necessary. The filter is evaluated at domainScale * distance, hence the division.
+    const float filterBounds = std::abs(filter.boundingRadius) / domainScale;
+
+    result->spans.resize(ntarget);
+    result->weights.clear();
 
     // Iterate through target samples. "xtarget" points to the center of each target pixel.
     float xtarget = dtarget / 2.0f;
     for (uint32_t itarget = 0; itarget < ntarget; ++itarget, xtarget += dtarget) {
+        FilterKernel::Span& span = result->spans[itarget];
+        span = { 0, 0, uint32_t(result->weights.size()) };
 
-        // For this particular target pixel, we'll be accumulating a count and sum so that we can
-        // adjust the weights afterwards. This allows us to reject some of the source samples.
-        uint32_t count = 0;
+        // For this particular target pixel, we'll be accumulating a sum so that we can adjust the
+        // weights afterwards. This allows us to reject some of the source samples.
         float sum = 0;
 
         // Iterate through source samples that lie within the bounded region.
@@ -156,40 +167,28 @@ void generateMadProgram(uint32_t ntarget, uint32_t nsource, float left, float ri
             const float t = domainScale * std::abs(xsource - xtarget);
             const float weight = filter.fn(t);
             if (weight != 0) {
-                result->push_back({itarget, isource, weight});
+                if (span.count == 0) {
+                    span.first = isource;
+                }
+                // Rejected or zero-weighted samples in the middle of the span become zero weights.
+                const uint32_t index = uint32_t(isource - span.first);
+                result->weights.resize(span.offset + index, 0.0f);
+                result->weights.push_back(weight);
+                span.count = index + 1;
                 sum += weight;
-                ++count;
             }
         }
 
-        // Normalize the set of weights that were recently appended to the MAD program.
+        // Normalize the weights of the span that was just generated.
         if (sum != 0) {
-            MadInstruction* mad = result->data() + result->size() - count;
-            for (uint32_t i = 0; i < count; ++i, ++mad) {
-                mad->weight /= sum;
+            float* weights = result->weights.data() + span.offset;
+            for (uint32_t i = 0; i < span.count; ++i) {
+                weights[i] /= sum;
             }
         }
     }
 }
 
-// Transforms a MAD program intended for single-channel data into a program intended for
-// multi-channel data.
-void expandMadProgram(uint32_t nchannels, MadProgram* program) {
-    if (nchannels == 1) {
-        return;
-    }
-    MadProgram result;
-    result.reserve(program->size() * nchannels);
-    for (auto mad : *program) {
-        mad.sourceIndex *= nchannels;
-        mad.targetIndex *= nchannels;
-        for (uint32_t j = 0; j < nchannels; ++j, ++mad.sourceIndex, ++mad.targetIndex) {
-            result.push_back(mad);
-        }
-    }
-    program->swap(result);
-}
-
 FilterFunction createFilterFunction(Filter ftype) {
     FilterFunction fn;
     switch (ftype) {
@@ -226,56 +225,185 @@ void normalize(LinearImage& image) {
     }
 }
 
-LinearImage resampleImage1D(const LinearImage& source, MadProgram* program,
-        uint32_t twidth, Filter filter, float left, float right, float filterRadiusMultiplier) {
+// Calls fn(first, count) over the given number of rows, concurrently if a JobSystem is given.
+template<typename FN>
+void forEachRow(utils::JobSystem* js, uint32_t rows, FN const& fn) {
+    constexpr uint32_t ROWS_PER_JOB = 16;
+    if (!js || rows < 2 * ROWS_PER_JOB) {
+        fn(0, rows);
+        return;
+    }
+    auto job = utils::jobs::parallel_for(*js, nullptr, 0, rows, std::cref(fn),
+            utils::jobs::CountSplitter<ROWS_PER_JOB, 8>());
+    js->runAndWait(job);
+}
+
+// Weighted sum of one span of pixels having N channels, the channel loop is unrolled so that
+// the accumulators stay in registers.
+template<uint32_t N>
+void filterPixel(float* UTILS_RESTRICT out, float const* UTILS_RESTRICT in,
+        float const* UTILS_RESTRICT weights, uint32_t count) {
+    float sum[N] = {};
+    for (uint32_t i = 0; i < count; ++i, in += N) {
+        for (uint32_t c = 0; c < N; ++c) {
+            sum[c] += in[c] * weights[i];
+        }
+    }
+    for (uint32_t c = 0; c < N; ++c) {
+        out[c] = sum[c];
+    }
+}
+
+template<uint32_t N>
+void filterRows(float* target, float const* source, uint32_t swidth, uint32_t twidth,
+        FilterKernel const& kernel, uint32_t first, uint32_t count) {
+    for (uint32_t row = first; row < first + count; ++row) {
+        float const* sourceRow = source + size_t(row) * swidth * N;
+        float* targetPixel = target + size_t(row) * twidth * N;
+        for (auto const& span : kernel.spans) {
+            filterPixel<N>(targetPixel, sourceRow + span.first * int32_t(N),
+                    kernel.weights.data() + span.offset, span.count);
+            targetPixel += N;
+        }
+    }
+}
+
+// Same as above for any number of channels.
+void filterRows(float* target, float const* source, uint32_t swidth, uint32_t twidth,
+        uint32_t nchan, FilterKernel const& kernel, uint32_t first, uint32_t count) {
+    for (uint32_t row = first; row < first + count; ++row) {
+        float const* sourceRow = source + size_t(row) * swidth * nchan;
+        float* targetPixel = target + size_t(row) * twidth * nchan;
+        for (auto const& span : kernel.spans) {
+            float const* in = sourceRow + span.first * int32_t(nchan);
+            float const* weights = kernel.weights.data() + span.offset;
+            std::fill_n(targetPixel, nchan, 0.0f);
+            for (uint32_t i = 0; i < span.count; ++i, in += nchan) {
+                for (uint32_t c = 0; c < nchan; ++c) {
+                    targetPixel[c] += in[c] * weights[i];
+                }
+            }
+            targetPixel += nchan;
+        }
+    }
+}
+
+// The MIN filter is special because it starts with non-zero values and ignores filter weights.
+void minimumRows(float* target, float const* source, uint32_t swidth, uint32_t twidth,
+        uint32_t nchan, FilterKernel const& kernel, uint32_t first, uint32_t count) {
+    for (uint32_t row = first; row < first + count; ++row) {
+        float const* sourceRow = source + size_t(row) * swidth * nchan;
+        float* targetPixel = target + size_t(row) * twidth * nchan;
+        for (auto const& span : kernel.spans) {
+            float const* in = sourceRow + span.first * int32_t(nchan);
+            float const* weights = kernel.weights.data() + span.offset;
+            for (uint32_t c = 0; c < nchan; ++c) {
+                targetPixel[c] = std::numeric_limits<float>::max();
+            }
+            for (uint32_t i = 0; i < span.count; ++i, in += nchan) {
+                if (weights[i] != 0) {
+                    for (uint32_t c = 0; c < nchan; ++c) {
+                        targetPixel[c] = std::min(in[c], targetPixel[c]);
+                    }
+                }
+            }
+            targetPixel += nchan;
+        }
+    }
+}
+
+Filter resolveFilter(Filter filter, uint32_t ntarget, uint32_t nsource) {
+    if (filter == Filter::DEFAULT) {
+        return ntarget > nsource ? Filter::MITCHELL : Filter::LANCZOS;
+    }
+    return filter;
+}
+
+// Resizes the image horizontally to the width of the result, each target pixel is computed from a
+// span of its source row. Every pixel of the result is written.
+void resampleHorizontal(const LinearImage& source, LinearImage* result, FilterKernel* kernel,
+        Filter filter, float left, float right, float filterRadiusMultiplier,
+        utils::JobSystem* js) {
     const uint32_t swidth = source.getWidth();
     const uint32_t sheight = source.getHeight();
     const uint32_t nchan = source.getChannels();
-    const bool mag = twidth > swidth;
-    if (filter == Filter::DEFAULT) filter = mag ? Filter::MITCHELL : Filter::LANCZOS;
-    const FilterFunction hfn = createFilterFunction(filter);
-
-    // Generate a flat list of multiply-add (MAD) instructions.
-    program->clear();
-    generateMadProgram(twidth, swidth, left, right, hfn, filterRadiusMultiplier, program);
-    expandMadProgram(nchan, program);
-
-    // Allocate the target image.
-    LinearImage result(twidth, sheight, nchan);
-    float const* sourceRow = source.getPixelRef();
-    float* targetRow = result.getPixelRef();
-
-    // The MIN filter is special because it starts with non-zero values and ignores filter weights.
-    if (filter == Filter::MINIMUM) {
-        for (uint32_t n = 0; n < twidth * sheight * nchan; ++n) {
-            targetRow[n] = std::numeric_limits<float>::max();
+    const uint32_t twidth = result->getWidth();
+    assert_invariant(result->getHeight() == sheight && result->getChannels() == nchan);
+    filter = resolveFilter(filter, twidth, swidth);
+    generateFilterKernel(twidth, swidth, left, right, createFilterFunction(filter),
+            filterRadiusMultiplier, kernel);
+
+    float const* src = source.getPixelRef();
+    float* dst = result->getPixelRef();
+    forEachRow(js, sheight, [&](uint32_t first, uint32_t count) {
+        if (filter == Filter::MINIMUM) {
+            minimumRows(dst, src, swidth, twidth, nchan, *kernel, first, count);
+            return;
         }
-        for (uint32_t row = 0; row < sheight; ++row) {
-            for (auto mad : *program) {
-                const float a = sourceRow[mad.sourceIndex];
-                const float b = targetRow[mad.targetIndex];
-                targetRow[mad.targetIndex] = std::min(a, b);
-            }
-            targetRow += twidth * nchan;
-            sourceRow += swidth * nchan;
+        switch (nchan) {
+            case 1: filterRows<1>(dst, src, swidth, twidth, *kernel, first, count); break;
+            case 2: filterRows<2>(dst, src, swidth, twidth, *kernel, first, count); break;
+            case 3: filterRows<3>(dst, src, swidth, twidth, *kernel, first, count); break;
+            case 4: filterRows<4>(dst, src, swidth, twidth, *kernel, first, count); break;
+            default:
+                filterRows(dst, src, swidth, twidth, nchan, *kernel, first, count);
+                break;
         }
-        return result;
+    });
+
+    // Perform post processing for the current pass.
+    if (filter == Filter::GAUSSIAN_NORMALS) {
+        normalize(*result);
     }
+}
 
-    // Resize the image horizontally by executing the MAD instructions over each row.
-    for (uint32_t row = 0; row < sheight; ++row) {
-        for (auto mad : *program) {
-            targetRow[mad.targetIndex] += sourceRow[mad.sourceIndex] * mad.weight;
+// Resizes the image vertically to the height of the result, each target row is a weighted sum of
+// whole source rows, which needs no transposition and vectorizes across the row. Every pixel of
+// the result is written.
+void resampleVertical(const LinearImage& source, LinearImage* result, FilterKernel* kernel,
+        Filter filter, float top, float bottom, float filterRadiusMultiplier,
+        utils::JobSystem* js) {
+    const uint32_t width = source.getWidth();
+    const uint32_t sheight = source.getHeight();
+    const uint32_t nchan = source.getChannels();
+    const uint32_t theight = result->getHeight();
+    const size_t rowSize = size_t(width) * nchan;
+    assert_invariant(result->getWidth() == width && result->getChannels() == nchan);
+    filter = resolveFilter(filter, theight, sheight);
+    generateFilterKernel(theight, sheight, top, bottom, createFilterFunction(filter),
+            filterRadiusMultiplier, kernel);
+
+    float const* src = source.getPixelRef();
+    float* dst = result->getPixelRef();
+    const bool minimum = filter == Filter::MINIMUM;
+    forEachRow(js, theight, [&](uint32_t first, uint32_t count) {
+        for (uint32_t row = first; row < first + count; ++row) {
+            auto const& span = kernel->spans[row];
+            float const* weights = kernel->weights.data() + span.offset;
+            float* UTILS_RESTRICT out = dst + row * rowSize;
+            std::fill_n(out, rowSize, minimum ? std::numeric_limits<float>::max() : 0.0f);
+            for (uint32_t i = 0; i < span.count; ++i) {
+                float const* UTILS_RESTRICT in = src + (span.first + int32_t(i)) * rowSize;
+                const float weight = weights[i];
+                if (minimum) {
+                    if (weight != 0) {
+                        for (size_t j = 0; j < rowSize; ++j) {
+                            out[j] = std::min(in[j], out[j]);
+                        }
+                    }
+                    continue;
+                }
+                for (size_t j = 0; j < rowSize; ++j) {
+                    out[j] += in[j] * weight;
+                }
+            }
         }
-        targetRow += twidth * nchan;
-        sourceRow += swidth * nchan;
-    }
+    });
 
     // Perform post processing for the current pass.
     if (filter == Filter::GAUSSIAN_NORMALS) {
-        normalize(result);
+        normalize(*result);
     }
-    return result;
 }
 
 } // anonymous namespace
@@ -287,7 +415,16 @@ SingleSample::~SingleSample() {
 }
 
 LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t height,
-        const ImageSampler& sampler) {
+        const ImageSampler& sampler, utils::JobSystem* js) {
+    LinearImage result(width, height, source.getChannels());
+    resampleImage(source, &result, sampler, js, nullptr);
+    return result;
+}
+
+void resampleImage(const LinearImage& source, LinearImage* result, const ImageSampler& sampler,
+        utils::JobSystem* js, ImagePool* pool) {
+    ASSERT_PRECONDITION(result->getChannels() == source.getChannels(),
+            "Result must have the channel count of the source.");
     ASSERT_PRECONDITION(
         sampler.east.mode == Boundary::EXCLUDE &&
         sampler.north.mode == Boundary::EXCLUDE &&
@@ -300,19 +437,22 @@ LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t he
     const float top = sampler.sourceRegion.top;
     const float right = sampler.sourceRegion.right;
     const float bottom = sampler.sourceRegion.bottom;
-    MadProgram program;
-    LinearImage result;
-    result = transpose(resampleImage1D(source, &program, width, hfilter, left, right, radius));
-    result = transpose(resampleImage1D(result, &program, height, vfilter, top, bottom, radius));
-    return result;
+    const uint32_t width = result->getWidth();
+    const uint32_t height = source.getHeight();
+    const uint32_t channels = source.getChannels();
+    FilterKernel kernel;
+    LinearImage intermediate = pool ? pool->acquire(width, height, channels) :
+            LinearImage(width, height, channels);
+    resampleHorizontal(source, &intermediate, &kernel, hfilter, left, right, radius, js);
+    resampleVertical(intermediate, result, &kernel, vfilter, top, bottom, radius, js);
 }
 
 LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t height,
-        Filter filter) {
+        Filter filter, utils::JobSystem* js) {
     return resampleImage(source, width, height, ImageSampler {
         .horizontalFilter = filter,
         .verticalFilter = filter
-    });
+    }, js);
 }
 
 void computeSingleSample(const LinearImage& source, float x, float y, SingleSample* result,
@@ -322,9 +462,11 @@ void computeSingleSample(const LinearImage& source, float x, float y, SingleSamp
     const float top = y - radius / source.getHeight();
     const float right = x + radius / source.getWidth();
     const float bottom = y + radius / source.getHeight();
-    MadProgram program;
-    LinearImage row = transpose(resampleImage1D(source, &program, 1, filter, left, right, radius));
-    row = resampleImage1D(row, &program, 1, filter, top, bottom, radius);
+    FilterKernel kernel;
+    LinearImage column(1, source.getHeight(), source.getChannels());
+    LinearImage row(1, 1, source.getChannels());
+    resampleHorizontal(source, &column, &kernel, filter, left, right, radius, nullptr);
+    resampleVertical(column, &row, &kernel, filter, top, bottom, radius, nullptr);
     if (!result->data) {
         result->data = new float[source.getChannels()];
     }
@@ -337,14 +479,19 @@ void computeSingleSample(const LinearImage& source, float x, float y, SingleSamp
 
 // Unlike traditional mipmap generation, our implementation generates all levels from the original
 // image, under the premise that this produces a higher quality result.
-void generateMipmaps(const LinearImage& source, Filter filter, LinearImage* result, uint32_t mips) {
+void generateMipmaps(const LinearImage& source, Filter filter, LinearImage* result, uint32_t mips,
+        utils::JobSystem* js, ImagePool* pool) {
     mips = std::min(mips, getMipmapCount(source));
     uint32_t width = source.getWidth();
     uint32_t height = source.getHeight();
+    const uint32_t channels = source.getChannels();
+    const ImageSampler sampler { .horizontalFilter = filter, .verticalFilter = filter };
     for (uint32_t n = 0; n < mips; ++n) {
         width = std::max(width >> 1u, 1u);
         height = std::max(height >> 1u, 1u);
-        result[n] = resampleImage(source, width, height, filter);
+        result[n] = pool ? pool->acquire(width, height, channels) :
+                LinearImage(width, height, channels);
+        resampleImage(source, &result[n], sampler, js, pool);
     }
 }
 
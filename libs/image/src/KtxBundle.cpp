@@ -16,12 +16,17 @@
 
 #include <image/KtxBundle.h>
 
+#include <utils/JobSystem.h>
 #include <utils/Panic.h>
 
+#include <algorithm>
+#include <map>
 #include <string>
 #include <vector>
 #include <unordered_map>
 
+#include <zlib.h>
+
 namespace {
 
 struct SerializationHeader {
@@ -44,8 +49,240 @@ inline size_t flatten(const image::KtxBundle* bundle, image::KtxBlobIndex index)
 
 const uint8_t MAGIC[] = {0xab, 0x4b, 0x54, 0x58, 0x20, 0x31, 0x31, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a};
 
+// KTX 2.0 ---------------------------------------------------------------------------------------
+
+const uint8_t MAGIC2[] = {0xab, 0x4b, 0x54, 0x58, 0x20, 0x32, 0x30, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a};
+
+struct Ktx2Header {
+    uint8_t magic[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+
+struct Ktx2Level {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+static_assert(sizeof(Ktx2Header) == 80, "Unexpected KTX2 header size.");
+static_assert(sizeof(Ktx2Level) == 24, "Unexpected KTX2 level index size.");
+
+// Color models of the Khronos Data Format descriptor.
+enum : uint8_t {
+    MODEL_RGBSDA = 1,
+    MODEL_BC1A = 128,
+    MODEL_BC2 = 129,
+    MODEL_BC3 = 130,
+    MODEL_ETC2 = 161,
+    MODEL_ASTC = 162,
+};
+
+// Maps a KtxInfo glInternalFormat to its Vulkan format, along with what's needed to rebuild the
+// rest of KtxInfo and to describe the format in the data format descriptor.
+struct Ktx2Format {
+    uint32_t glInternalFormat;
+    uint32_t vkFormat;
+    uint32_t glBaseFormat;
+    uint32_t glType;        // 0 for compressed formats
+    uint8_t model;
+    bool srgb;
+    bool snorm;
+    uint8_t blockWidth;
+    uint8_t blockHeight;
+    uint8_t blockBytes;     // size of a texel block, i.e. of a texel for uncompressed formats
+};
+
+using K = image::KtxBundle;
+
+const Ktx2Format KTX2_FORMATS[] = {
+    { K::R8,                  9, K::RED,  K::UNSIGNED_BYTE, MODEL_RGBSDA, false, false, 1, 1, 1 },
+    { K::RG8,                16, K::RG,   K::UNSIGNED_BYTE, MODEL_RGBSDA, false, false, 1, 1, 2 },
+    { K::RGB8,               23, K::RGB,  K::UNSIGNED_BYTE, MODEL_RGBSDA, false, false, 1, 1, 3 },
+    { K::SRGB8,              29, K::RGB,  K::UNSIGNED_BYTE, MODEL_RGBSDA, true,  false, 1, 1, 3 },
+    { K::RGBA8,              37, K::RGBA, K::UNSIGNED_BYTE, MODEL_RGBSDA, false, false, 1, 1, 4 },
+    { K::SRGB8_ALPHA8,       43, K::RGBA, K::UNSIGNED_BYTE, MODEL_RGBSDA, true,  false, 1, 1, 4 },
+    { K::R16F,               76, K::RED,  K::HALF_FLOAT,    MODEL_RGBSDA, false, false, 1, 1, 2 },
+    { K::RG16F,              83, K::RG,   K::HALF_FLOAT,    MODEL_RGBSDA, false, false, 1, 1, 4 },
+    { K::RGB16F,             90, K::RGB,  K::HALF_FLOAT,    MODEL_RGBSDA, false, false, 1, 1, 6 },
+    { K::RGBA16F,            97, K::RGBA, K::HALF_FLOAT,    MODEL_RGBSDA, false, false, 1, 1, 8 },
+    { K::R32F,              100, K::RED,  K::FLOAT,         MODEL_RGBSDA, false, false, 1, 1, 4 },
+    { K::RG32F,             103, K::RG,   K::FLOAT,         MODEL_RGBSDA, false, false, 1, 1, 8 },
+    { K::RGB32F,            106, K::RGB,  K::FLOAT,         MODEL_RGBSDA, false, false, 1, 1, 12 },
+    { K::RGBA32F,           109, K::RGBA, K::FLOAT,         MODEL_RGBSDA, false, false, 1, 1, 16 },
+    // glType follows cmgen and KtxUtility, which use the internal format as a packed type.
+    { K::R11F_G11F_B10F,    122, K::RGB, K::R11F_G11F_B10F, MODEL_RGBSDA, false, false, 1, 1, 4 },
+
+    { K::RGB_S3TC_DXT1,     131, K::RGB,  0, MODEL_BC1A, false, false, 4, 4, 8 },
+    { K::RGBA_S3TC_DXT1,    133, K::RGBA, 0, MODEL_BC1A, false, false, 4, 4, 8 },
+    { K::RGBA_S3TC_DXT3,    135, K::RGBA, 0, MODEL_BC2,  false, false, 4, 4, 16 },
+    { K::RGBA_S3TC_DXT5,    137, K::RGBA, 0, MODEL_BC3,  false, false, 4, 4, 16 },
+
+    { K::RGB8_ETC2,             147, K::RGB,  0, MODEL_ETC2, false, false, 4, 4, 8 },
+    { K::SRGB8_ETC2,            148, K::RGB,  0, MODEL_ETC2, true,  false, 4, 4, 8 },
+    { K::RGB8_ALPHA1_ETC2,      149, K::RGBA, 0, MODEL_ETC2, false, false, 4, 4, 8 },
+    { K::SRGB8_ALPHA1_ETC,      150, K::RGBA, 0, MODEL_ETC2, true,  false, 4, 4, 8 },
+    { K::RGBA8_ETC2_EAC,        151, K::RGBA, 0, MODEL_ETC2, false, false, 4, 4, 16 },
+    { K::SRGB8_ALPHA8_ETC2_EAC, 152, K::RGBA, 0, MODEL_ETC2, true,  false, 4, 4, 16 },
+    { K::R11_EAC,               153, K::RED,  0, MODEL_ETC2, false, false, 4, 4, 8 },
+    { K::SIGNED_R11_EAC,        154, K::RED,  0, MODEL_ETC2, false, true,  4, 4, 8 },
+    { K::RG11_EAC,              155, K::RG,   0, MODEL_ETC2, false, false, 4, 4, 16 },
+    { K::SIGNED_RG11_EAC,       156, K::RG,   0, MODEL_ETC2, false, true,  4, 4, 16 },
+
+    { K::RGBA_ASTC_4x4,             157, K::RGBA, 0, MODEL_ASTC, false, false, 4,  4,  16 },
+    { K::SRGB8_ALPHA8_ASTC_4x4,     158, K::RGBA, 0, MODEL_ASTC, true,  false, 4,  4,  16 },
+    { K::RGBA_ASTC_5x4,             159, K::RGBA, 0, MODEL_ASTC, false, false, 5,  4,  16 },
+    { K::SRGB8_ALPHA8_ASTC_5x4,     160, K::RGBA, 0, MODEL_ASTC, true,  false, 5,  4,  16 },
+    { K::RGBA_ASTC_5x5,             161, K::RGBA, 0, MODEL_ASTC, false, false, 5,  5,  16 },
+    { K::SRGB8_ALPHA8_ASTC_5x5,     162, K::RGBA, 0, MODEL_ASTC, true,  false, 5,  5,  16 },
+    { K::RGBA_ASTC_6x5,             163, K::RGBA, 0, MODEL_ASTC, false, false, 6,  5,  16 },
+    { K::SRGB8_ALPHA8_ASTC_6x5,     164, K::RGBA, 0, MODEL_ASTC, true,  false, 6,  5,  16 },
+    { K::RGBA_ASTC_6x6,             165, K::RGBA, 0, MODEL_ASTC, false, false, 6,  6,  16 },
+    { K::SRGB8_ALPHA8_ASTC_6x6,     166, K::RGBA, 0, MODEL_ASTC, true,  false, 6,  6,  16 },
+    { K::RGBA_ASTC_8x5,             167, K::RGBA, 0, MODEL_ASTC, false, false, 8,  5,  16 },
+    { K::SRGB8_ALPHA8_ASTC_8x5,     168, K::RGBA, 0, MODEL_ASTC, true,  false, 8,  5,  16 },
+    { K::RGBA_ASTC_8x6,             169, K::RGBA, 0, MODEL_ASTC, false, false, 8,  6,  16 },
+    { K::SRGB8_ALPHA8_ASTC_8x6,     170, K::RGBA, 0, MODEL_ASTC, true,  false, 8,  6,  16 },
+    { K::RGBA_ASTC_8x8,             171, K::RGBA, 0, MODEL_ASTC, false, false, 8,  8,  16 },
+    { K::SRGB8_ALPHA8_ASTC_8x8,     172, K::RGBA, 0, MODEL_ASTC, true,  false, 8,  8,  16 },
+    { K::RGBA_ASTC_10x5,            173, K::RGBA, 0, MODEL_ASTC, false, false, 10, 5,  16 },
+    { K::SRGB8_ALPHA8_ASTC_10x5,    174, K::RGBA, 0, MODEL_ASTC, true,  false, 10, 5,  16 },
+    { K::RGBA_ASTC_10x6,            175, K::RGBA, 0, MODEL_ASTC, false, false, 10, 6,  16 },
+    { K::SRGB8_ALPHA8_ASTC_10x6,    176, K::RGBA, 0, MODEL_ASTC, true,  false, 10, 6,  16 },
+    { K::RGBA_ASTC_10x8,            177, K::RGBA, 0, MODEL_ASTC, false, false, 10, 8,  16 },
+    { K::SRGB8_ALPHA8_ASTC_10x8,    178, K::RGBA, 0, MODEL_ASTC, true,  false, 10, 8,  16 },
+    { K::RGBA_ASTC_10x10,           179, K::RGBA, 0, MODEL_ASTC, false, false, 10, 10, 16 },
+    { K::SRGB8_ALPHA8_ASTC_10x10,   180, K::RGBA, 0, MODEL_ASTC, true,  false, 10, 10, 16 },
+    { K::RGBA_ASTC_12x10,           181, K::RGBA, 0, MODEL_ASTC, false, false, 12, 10, 16 },
+    { K::SRGB8_ALPHA8_ASTC_12x10,   182, K::RGBA, 0, MODEL_ASTC, true,  false, 12, 10, 16 },
+    { K::RGBA_ASTC_12x12,           183, K::RGBA, 0, MODEL_ASTC, false, false, 12, 12, 16 },
+    { K::SRGB8_ALPHA8_ASTC_12x12,   184, K::RGBA, 0, MODEL_ASTC, true,  false, 12, 12, 16 },
+};
+
+Ktx2Format const* findKtx2Format(uint32_t Ktx2Format::*field, uint32_t value) {
+    for (Ktx2Format const& format : KTX2_FORMATS) {
+        if (format.*field == value) {
+            return &format;
+        }
+    }
+    return nullptr;
 }
 
+uint32_t getChannelCount(uint32_t glBaseFormat) {
+    switch (glBaseFormat) {
+        case K::RED: return 1;
+        case K::RG: return 2;
+        case K::RGB: return 3;
+        default: return 4;
+    }
+}
+
+// Builds a basic data format descriptor, as required by KTX 2.0 for every format. Readers
+// identify the format with vkFormat, so this only describes what the specification requires.
+std::vector<uint32_t> createDescriptor(Ktx2Format const& format) {
+    struct Sample {
+        uint32_t bitOffset;
+        uint32_t bitLength;
+        uint32_t channel;
+        uint32_t lower;
+        uint32_t upper;
+    };
+
+    constexpr uint32_t QUALIFIER_LINEAR = 0x10;
+    constexpr uint32_t QUALIFIER_SIGNED = 0x40;
+    constexpr uint32_t QUALIFIER_FLOAT = 0x80;
+    constexpr uint32_t CHANNEL_ALPHA = 15;
+
+    std::vector<Sample> samples;
+    uint32_t qualifiers = format.snorm ? QUALIFIER_SIGNED : 0;
+    const uint32_t channels = getChannelCount(format.glBaseFormat);
+    switch (format.model) {
+        case MODEL_RGBSDA:
+            if (format.glType == K::R11F_G11F_B10F) {
+                qualifiers = QUALIFIER_FLOAT;
+                samples.push_back({ 0, 11, 0, 0, 0x3F800000 });
+                samples.push_back({ 11, 11, 1, 0, 0x3F800000 });
+                samples.push_back({ 22, 10, 2, 0, 0x3F800000 });
+            } else {
+                const uint32_t bits = format.blockBytes * 8 / channels;
+                const bool isFloat = format.glType != K::UNSIGNED_BYTE;
+                if (isFloat) {
+                    qualifiers = QUALIFIER_FLOAT | QUALIFIER_SIGNED;
+                }
+                const uint32_t lower = isFloat ? 0xBF800000 : 0;
+                const uint32_t upper = isFloat ? 0x3F800000 : (1u << bits) - 1;
+                const uint32_t ids[] = { 0, 1, 2, CHANNEL_ALPHA };
+                for (uint32_t c = 0; c < channels; c++) {
+                    samples.push_back({ c * bits, bits, ids[c], lower, upper });
+                }
+            }
+            break;
+        case MODEL_BC1A:
+            // channel 0 is the color, channel 1 the color with punch-through alpha
+            samples.push_back({ 0, 64, channels == 4 ? 1u : 0u, 0, UINT32_MAX });
+            break;
+        case MODEL_BC2:
+        case MODEL_BC3:
+            samples.push_back({ 0, 64, CHANNEL_ALPHA, 0, UINT32_MAX });
+            samples.push_back({ 64, 64, 0, 0, UINT32_MAX });
+            break;
+        case MODEL_ETC2:
+            // channels are 0 for red, 1 for green and 2 for the color
+            if (format.glBaseFormat == K::RED) {
+                samples.push_back({ 0, 64, 0, 0, UINT32_MAX });
+            } else if (format.glBaseFormat == K::RG) {
+                samples.push_back({ 0, 64, 0, 0, UINT32_MAX });
+                samples.push_back({ 64, 64, 1, 0, UINT32_MAX });
+            } else if (format.blockBytes == 16) {
+                samples.push_back({ 0, 64, CHANNEL_ALPHA, 0, UINT32_MAX });
+                samples.push_back({ 64, 64, 2, 0, UINT32_MAX });
+            } else {
+                samples.push_back({ 0, 64, 2, 0, UINT32_MAX });
+            }
+            break;
+        case MODEL_ASTC:
+            samples.push_back({ 0, 128, 0, 0, UINT32_MAX });
+            break;
+    }
+
+    const uint32_t blockSize = 24 + 16 * uint32_t(samples.size());
+    std::vector<uint32_t> dfd;
+    dfd.push_back(4 + blockSize);                                   // dfdTotalSize
+    dfd.push_back(0);                                               // Khronos, basic descriptor
+    dfd.push_back(2 | (blockSize << 16));                           // version 1.3
+    dfd.push_back(format.model | (1 << 8) | ((format.srgb ? 2 : 1) << 16)); // BT.709
+    dfd.push_back((format.blockWidth - 1u) | ((format.blockHeight - 1u) << 8));
+    dfd.push_back(format.blockBytes);                               // bytesPlane0
+    dfd.push_back(0);                                               // bytesPlane4
+    for (Sample const& sample : samples) {
+        uint32_t sampleQualifiers = qualifiers;
+        if (format.srgb && sample.channel == CHANNEL_ALPHA) {
+            sampleQualifiers |= QUALIFIER_LINEAR;
+        }
+        dfd.push_back(sample.bitOffset | ((sample.bitLength - 1) << 16) |
+                ((sample.channel | sampleQualifiers) << 24));
+        dfd.push_back(0);                                           // sample position
+        dfd.push_back(sample.lower);
+        dfd.push_back(sample.upper);
+    }
+    return dfd;
+}
+
+} // anonymous namespace
+
 namespace image  {
 
 // This little wrapper lets us avoid having an STL container in the header file.
@@ -56,12 +293,19 @@ struct KtxMetadata {
 // Extremely simple contiguous storage for an array of blobs. Assumes that the total number of blobs
 // is relatively small compared to the size of each blob, and that resizing individual blobs does
 // not occur frequently.
+//
+// A view doesn't own its blobs, they live in the serialized data, in which case "views" holds a
+// pointer to each blob and "blobs" is empty.
 struct KtxBlobList {
     std::vector<uint8_t> blobs;
     std::vector<uint32_t> sizes;
+    std::vector<uint8_t const*> views;
 
     // Obtains a pointer to the given blob.
     uint8_t* get(uint32_t blobIndex) {
+        if (!views.empty()) {
+            return const_cast<uint8_t*>(views[blobIndex]);
+        }
         uint8_t* result = blobs.data();
         for (uint32_t i = 0; i < blobIndex; ++i) {
             result += sizes[i];
@@ -96,6 +340,23 @@ struct KtxBlobList {
     }
 };
 
+// We use std::string to store both the key and the value. Note that the spec says the value can be
+// a binary blob that contains null characters. KTX 1.1 and 2.0 share this layout.
+static void readMetadata(KtxMetadata* metadata, uint8_t const* pdata, uint32_t size) {
+    uint8_t const* end = pdata + size;
+    while (pdata < end) {
+        const uint32_t keyAndValueByteSize = *((uint32_t const*) pdata);
+        pdata += sizeof(uint32_t);
+        std::string key((const char*) pdata);
+        uint8_t const* pval = pdata + key.size() + 1;
+        pdata += keyAndValueByteSize;
+        std::string val((const char*) pval, (const char*) pdata);
+        metadata->keyvals.insert({key, val});
+        const uint32_t paddingSize = 3 - ((keyAndValueByteSize + 3) % 4);
+        pdata += paddingSize;
+    }
+}
+
 KtxBundle::~KtxBundle() = default;
 
 KtxBundle::KtxBundle(uint32_t numMipLevels, uint32_t arrayLength, bool isCubemap) :
@@ -106,8 +367,13 @@ KtxBundle::KtxBundle(uint32_t numMipLevels, uint32_t arrayLength, bool isCubemap
     mBlobs->sizes.resize(numMipLevels * arrayLength * mNumCubeFaces);
 }
 
-KtxBundle::KtxBundle(uint8_t const* bytes, uint32_t nbytes) :
-        mBlobs(new KtxBlobList), mMetadata(new KtxMetadata) {
+KtxBundle::KtxBundle(uint8_t const* bytes, uint32_t nbytes, BlobStorage storage,
+        utils::JobSystem* js) : mBlobs(new KtxBlobList), mMetadata(new KtxMetadata) {
+    if (sizeof(Ktx2Header) <= nbytes && memcmp(bytes, MAGIC2, sizeof(MAGIC2)) == 0) {
+        deserializeKtx2(bytes, nbytes, storage, js);
+        return;
+    }
+
     ASSERT_PRECONDITION(sizeof(SerializationHeader) <= nbytes, "KTX buffer is too small");
 
     // First, "parse" the header by casting it to a struct.
@@ -124,21 +390,11 @@ KtxBundle::KtxBundle(uint8_t const* bytes, uint32_t nbytes) :
     mNumCubeFaces = header->numberOfFaces ? header->numberOfFaces : 1;
     mBlobs->sizes.resize(mNumMipLevels * mArrayLength * mNumCubeFaces);
 
-    // We use std::string to store both the key and the value. Note that the spec says the value can
-    // be a binary blob that contains null characters.
     uint8_t const* pdata = bytes + sizeof(SerializationHeader);
-    uint8_t const* end = pdata + header->bytesOfKeyValueData;
-    while (pdata < end) {
-        const uint32_t keyAndValueByteSize = *((uint32_t const*) pdata);
-        pdata += sizeof(uint32_t);
-        std::string key((const char*) pdata);
-        uint8_t const* pval = pdata + key.size() + 1;
-        pdata += keyAndValueByteSize;
-        std::string val((const char*) pval, (const char*) pdata);
-        mMetadata->keyvals.insert({key, val});
-        const uint32_t paddingSize = 3 - ((keyAndValueByteSize + 3) % 4);
-        pdata += paddingSize;
-    }
+    ASSERT_PRECONDITION(header->bytesOfKeyValueData <= nbytes - sizeof(SerializationHeader),
+            "KTX buffer is truncated");
+    readMetadata(mMetadata.get(), pdata, header->bytesOfKeyValueData);
+    pdata += header->bytesOfKeyValueData;
 
     // There is no compressed format that has a block size that is not a multiple of 4, so these
     // two padding constants can be safely hardcoded to 0. They are here for spec consistency.
@@ -149,18 +405,32 @@ KtxBundle::KtxBundle(uint8_t const* bytes, uint32_t nbytes) :
     const bool isNonArrayCube = mNumCubeFaces > 1 && mArrayLength == 1;
     const uint32_t facesPerMip = mArrayLength * mNumCubeFaces;
 
-    // Extract blobs from the serialized byte stream.
-    const uint32_t totalSize = nbytes - (pdata - bytes);
-    mBlobs->blobs.resize(totalSize);
+    // Extract blobs from the serialized byte stream, or only point to them for a view.
+    const bool isView = storage == BlobStorage::VIEW;
+    uint8_t const* const bytesEnd = bytes + nbytes;
+    if (isView) {
+        mBlobs->views.resize(mBlobs->sizes.size());
+    } else {
+        const uint32_t totalSize = nbytes - (pdata - bytes);
+        mBlobs->blobs.resize(totalSize);
+    }
     for (uint32_t mipmap = 0; mipmap < mNumMipLevels; ++mipmap) {
+        ASSERT_PRECONDITION(pdata + sizeof(uint32_t) <= bytesEnd, "KTX buffer is truncated");
         const uint32_t imageSize = *((uint32_t const*) pdata);
         const uint32_t faceSize = isNonArrayCube ? imageSize : (imageSize / facesPerMip);
         const uint32_t levelSize = faceSize * mNumCubeFaces * mArrayLength;
         pdata += sizeof(uint32_t);
-        memcpy(mBlobs->get(flatten(this, {mipmap, 0, 0})), pdata, levelSize);
+        ASSERT_PRECONDITION(levelSize <= size_t(bytesEnd - pdata), "KTX buffer is truncated");
+        if (!isView) {
+            memcpy(mBlobs->get(flatten(this, {mipmap, 0, 0})), pdata, levelSize);
+        }
         for (uint32_t layer = 0; layer < mArrayLength; ++layer) {
             for (uint32_t face = 0; face < mNumCubeFaces; ++face) {
-                mBlobs->sizes[flatten(this, {mipmap, layer, face})] = faceSize;
+                const size_t flatIndex = flatten(this, {mipmap, layer, face});
+                mBlobs->sizes[flatIndex] = faceSize;
+                if (isView) {
+                    mBlobs->views[flatIndex] = pdata;
+                }
                 pdata += faceSize;
                 pdata += cubePadding;
             }
@@ -270,6 +540,238 @@ uint32_t KtxBundle::getSerializedLength() const {
     return total;
 }
 
+void KtxBundle::deserializeKtx2(uint8_t const* bytes, uint32_t nbytes, BlobStorage storage,
+        utils::JobSystem* js) {
+    Ktx2Header const* header = (Ktx2Header const*) bytes;
+    Ktx2Format const* format = findKtx2Format(&Ktx2Format::vkFormat, header->vkFormat);
+    ASSERT_PRECONDITION(format, "Unsupported KTX2 format");
+    const auto supercompression = Supercompression(header->supercompressionScheme);
+    ASSERT_PRECONDITION(supercompression == Supercompression::NONE ||
+            supercompression == Supercompression::ZLIB, "Unsupported KTX2 supercompression scheme");
+
+    // Rebuild the OpenGL description of the format, as it would appear in a KTX 1.1 file.
+    mInfo.endianness = ENDIAN_DEFAULT;
+    mInfo.glType = format->glType;
+    mInfo.glTypeSize = header->typeSize;
+    mInfo.glFormat = format->glType ? format->glBaseFormat : 0;
+    mInfo.glInternalFormat = format->glInternalFormat;
+    mInfo.glBaseInternalFormat = format->glBaseFormat;
+    mInfo.pixelWidth = header->pixelWidth;
+    mInfo.pixelHeight = header->pixelHeight;
+    mInfo.pixelDepth = header->pixelDepth;
+
+    // Like KTX 1.1, 0 levels and layers are replaced with 1.
+    mNumMipLevels = header->levelCount ? header->levelCount : 1;
+    mArrayLength = header->layerCount ? header->layerCount : 1;
+    mNumCubeFaces = header->faceCount ? header->faceCount : 1;
+    mBlobs->sizes.resize(mNumMipLevels * mArrayLength * mNumCubeFaces);
+
+    ASSERT_PRECONDITION(sizeof(Ktx2Header) + mNumMipLevels * sizeof(Ktx2Level) <= nbytes,
+            "KTX buffer is truncated");
+    Ktx2Level const* levels = (Ktx2Level const*) (bytes + sizeof(Ktx2Header));
+
+    if (header->kvdByteLength) {
+        ASSERT_PRECONDITION(uint64_t(header->kvdByteOffset) + header->kvdByteLength <= nbytes,
+                "KTX buffer is truncated");
+        readMetadata(mMetadata.get(), bytes + header->kvdByteOffset, header->kvdByteLength);
+    }
+
+    // Every layer and face of a level has the same size, and they're stored in the same order as
+    // our blobs.
+    const uint32_t facesPerMip = mArrayLength * mNumCubeFaces;
+    std::vector<uint32_t> offsets(mNumMipLevels);
+    uint32_t totalSize = 0;
+    for (uint32_t mipmap = 0; mipmap < mNumMipLevels; ++mipmap) {
+        Ktx2Level const& level = levels[mipmap];
+        ASSERT_PRECONDITION(level.byteOffset <= nbytes &&
+                level.byteLength <= nbytes - level.byteOffset, "KTX buffer is truncated");
+        ASSERT_PRECONDITION(level.uncompressedByteLength <= UINT32_MAX - totalSize,
+                "KTX2 level is too large");
+        if (supercompression == Supercompression::NONE) {
+            ASSERT_PRECONDITION(level.byteLength == level.uncompressedByteLength,
+                    "KTX2 level has inconsistent sizes");
+        }
+        const uint32_t faceSize = uint32_t(level.uncompressedByteLength / facesPerMip);
+        for (uint32_t layer = 0; layer < mArrayLength; ++layer) {
+            for (uint32_t face = 0; face < mNumCubeFaces; ++face) {
+                const uint32_t flatIndex = flatten(this, {mipmap, layer, face});
+                mBlobs->sizes[flatIndex] = faceSize;
+            }
+        }
+        offsets[mipmap] = totalSize;
+        totalSize += faceSize * facesPerMip;
+    }
+
+    // Without supercompression, a view simply points into the serialized data.
+    if (supercompression == Supercompression::NONE && storage == BlobStorage::VIEW) {
+        mBlobs->views.resize(mBlobs->sizes.size());
+        for (uint32_t mipmap = 0; mipmap < mNumMipLevels; ++mipmap) {
+            uint8_t const* pdata = bytes + levels[mipmap].byteOffset;
+            for (uint32_t layer = 0; layer < mArrayLength; ++layer) {
+                for (uint32_t face = 0; face < mNumCubeFaces; ++face) {
+                    const uint32_t flatIndex = flatten(this, {mipmap, layer, face});
+                    mBlobs->views[flatIndex] = pdata;
+                    pdata += mBlobs->sizes[flatIndex];
+                }
+            }
+        }
+        return;
+    }
+
+    // Levels are independent, so they're copied or decompressed in parallel. Failures are
+    // collected and reported from the calling thread.
+    mBlobs->blobs.resize(totalSize);
+    std::vector<uint8_t> failed(mNumMipLevels);
+    auto decode = [&](uint32_t first, uint32_t count) {
+        for (uint32_t mipmap = first; mipmap < first + count; ++mipmap) {
+            Ktx2Level const& level = levels[mipmap];
+            const uint32_t levelSize = mBlobs->sizes[flatten(this, {mipmap, 0, 0})] * facesPerMip;
+            uint8_t* dst = mBlobs->blobs.data() + offsets[mipmap];
+            uint8_t const* src = bytes + level.byteOffset;
+            if (supercompression == Supercompression::NONE) {
+                memcpy(dst, src, levelSize);
+                continue;
+            }
+            uLongf size = levelSize;
+            const int err = uncompress(dst, &size, src, uLong(level.byteLength));
+            failed[mipmap] = err != Z_OK || size != levelSize;
+        }
+    };
+    if (js && mNumMipLevels > 1) {
+        auto* job = utils::jobs::parallel_for(*js, nullptr, 0, mNumMipLevels, std::cref(decode),
+                utils::jobs::CountSplitter<1, 8>());
+        js->runAndWait(job);
+    } else {
+        decode(0, mNumMipLevels);
+    }
+    ASSERT_PRECONDITION(std::find(failed.begin(), failed.end(), 1) == failed.end(),
+            "KTX2 level could not be decompressed");
+}
+
+uint32_t KtxBundle::serializeKtx2(std::unique_ptr<uint8_t[]>* result,
+        Supercompression supercompression, utils::JobSystem* js) const {
+    Ktx2Format const* format = findKtx2Format(&Ktx2Format::glInternalFormat,
+            mInfo.glInternalFormat);
+    if (!format) {
+        return 0;
+    }
+
+    const std::vector<uint32_t> dfd = createDescriptor(*format);
+
+    // KTX 2.0 requires the keys to be sorted.
+    std::vector<uint8_t> kvd;
+    const std::map<std::string, std::string> keyvals(
+            mMetadata->keyvals.begin(), mMetadata->keyvals.end());
+    for (const auto& iter : keyvals) {
+        const uint32_t kvsize = iter.first.size() + 1 + iter.second.size();
+        const uint32_t kvpadding = 3 - ((kvsize + 3) % 4);
+        uint8_t const* psize = (uint8_t const*) &kvsize;
+        kvd.insert(kvd.end(), psize, psize + sizeof(uint32_t));
+        kvd.insert(kvd.end(), iter.first.c_str(), iter.first.c_str() + iter.first.size() + 1);
+        kvd.insert(kvd.end(), iter.second.begin(), iter.second.end());
+        kvd.resize(kvd.size() + kvpadding);
+    }
+
+    // Gather the levels, checking that every blob of a level has the same size. The blobs of a
+    // level are contiguous, so a level is written or compressed as a whole.
+    const uint32_t facesPerMip = mArrayLength * mNumCubeFaces;
+    std::vector<uint8_t const*> levelData(mNumMipLevels);
+    std::vector<uint32_t> levelSizes(mNumMipLevels);
+    for (uint32_t mipmap = 0; mipmap < mNumMipLevels; ++mipmap) {
+        const uint32_t firstIndex = flatten(this, {mipmap, 0, 0});
+        const uint32_t faceSize = mBlobs->sizes[firstIndex];
+        for (uint32_t i = 0; i < facesPerMip; ++i) {
+            ASSERT_PRECONDITION(mBlobs->sizes[firstIndex + i] == faceSize,
+                    "Inconsistent blob sizes within LOD");
+        }
+        levelData[mipmap] = mBlobs->get(firstIndex);
+        levelSizes[mipmap] = faceSize * facesPerMip;
+    }
+
+    std::vector<std::vector<uint8_t>> compressed;
+    std::vector<uint32_t> byteLengths(levelSizes);
+    if (supercompression == Supercompression::ZLIB) {
+        compressed.resize(mNumMipLevels);
+        auto encode = [&](uint32_t first, uint32_t count) {
+            for (uint32_t mipmap = first; mipmap < first + count; ++mipmap) {
+                uLongf size = compressBound(levelSizes[mipmap]);
+                compressed[mipmap].resize(size);
+                compress2(compressed[mipmap].data(), &size, levelData[mipmap],
+                        levelSizes[mipmap], Z_BEST_COMPRESSION);
+                byteLengths[mipmap] = uint32_t(size);
+            }
+        };
+        if (js && mNumMipLevels > 1) {
+            auto* job = utils::jobs::parallel_for(*js, nullptr, 0, mNumMipLevels, std::cref(encode),
+                    utils::jobs::CountSplitter<1, 8>());
+            js->runAndWait(job);
+        } else {
+            encode(0, mNumMipLevels);
+        }
+        for (uint32_t mipmap = 0; mipmap < mNumMipLevels; ++mipmap) {
+            levelData[mipmap] = compressed[mipmap].data();
+        }
+    }
+
+    // Lay out the file: header, level index, descriptor, key/value data, then the levels from the
+    // smallest to the largest. Uncompressed levels are aligned to both the texel block and 4 bytes.
+    Ktx2Header header = {};
+    memcpy(header.magic, MAGIC2, sizeof(MAGIC2));
+    header.vkFormat = format->vkFormat;
+    switch (format->glType) {
+        case HALF_FLOAT:        header.typeSize = 2; break;
+        case FLOAT:             header.typeSize = 4; break;
+        case R11F_G11F_B10F:    header.typeSize = 4; break;
+        default:                header.typeSize = 1; break;
+    }
+    header.pixelWidth = mInfo.pixelWidth;
+    header.pixelHeight = mInfo.pixelHeight;
+    header.pixelDepth = mInfo.pixelDepth;
+    header.layerCount = mArrayLength > 1 ? mArrayLength : 0;
+    header.faceCount = mNumCubeFaces;
+    header.levelCount = mNumMipLevels;
+    header.supercompressionScheme = uint32_t(supercompression);
+
+    uint64_t offset = sizeof(Ktx2Header) + mNumMipLevels * sizeof(Ktx2Level);
+    header.dfdByteOffset = uint32_t(offset);
+    header.dfdByteLength = uint32_t(dfd.size() * sizeof(uint32_t));
+    offset += header.dfdByteLength;
+    if (!kvd.empty()) {
+        header.kvdByteOffset = uint32_t(offset);
+        header.kvdByteLength = uint32_t(kvd.size());
+        offset += kvd.size();
+    }
+
+    uint32_t alignment = 1;
+    if (supercompression == Supercompression::NONE) {
+        alignment = format->blockBytes;
+        while (alignment % 4) {
+            alignment += format->blockBytes;
+        }
+    }
+    std::vector<Ktx2Level> levels(mNumMipLevels);
+    for (uint32_t mipmap = mNumMipLevels; mipmap-- > 0;) {
+        offset = (offset + alignment - 1) / alignment * alignment;
+        levels[mipmap] = { offset, byteLengths[mipmap], levelSizes[mipmap] };
+        offset += byteLengths[mipmap];
+    }
+    ASSERT_PRECONDITION(offset <= UINT32_MAX, "KTX2 container is too large");
+
+    const uint32_t total = uint32_t(offset);
+    result->reset(new uint8_t[total]());
+    uint8_t* destination = result->get();
+    memcpy(destination, &header, sizeof(header));
+    memcpy(destination + sizeof(header), levels.data(), levels.size() * sizeof(Ktx2Level));
+    memcpy(destination + header.dfdByteOffset, dfd.data(), header.dfdByteLength);
+    if (!kvd.empty()) {
+        memcpy(destination + header.kvdByteOffset, kvd.data(), kvd.size());
+    }
+    for (uint32_t mipmap = 0; mipmap < mNumMipLevels; ++mipmap) {
+        memcpy(destination + levels[mipmap].byteOffset, levelData[mipmap], byteLengths[mipmap]);
+    }
+    return total;
+}
+
 const char* KtxBundle::getMetadata(const char* key, size_t* valueSize) const {
     auto iter = mMetadata->keyvals.find(key);
     if (iter == mMetadata->keyvals.end()) {
@@ -286,7 +788,7 @@ void KtxBundle::setMetadata(const char* key, const char* value) {
     mMetadata->keyvals.insert({key, value});
 }
 
-bool KtxBundle::getSphericalHarmonics(filament::math::float3* result) {
+bool KtxBundle::getSphericalHarmonics(filament::math::float3* result) const {
     char const* src = getMetadata("sh");
     if (!src) {
         return false;
@@ -304,6 +806,10 @@ bool KtxBundle::getSphericalHarmonics(filament::math::float3* result) {
     return true;
 }
 
+bool KtxBundle::isView() const {
+    return !mBlobs->views.empty();
+}
+
 bool KtxBundle::getBlob(KtxBlobIndex index, uint8_t** data, uint32_t* size) const {
     if (index.mipLevel >= mNumMipLevels || index.arrayIndex >= mArrayLength ||
             index.cubeFace >= mNumCubeFaces) {
@@ -320,7 +826,7 @@ bool KtxBundle::getBlob(KtxBlobIndex index, uint8_t** data, uint32_t* size) cons
 }
 
 bool KtxBundle::setBlob(KtxBlobIndex index, uint8_t const* data, uint32_t size) {
-    if (index.mipLevel >= mNumMipLevels || index.arrayIndex >= mArrayLength ||
+    if (isView() || index.mipLevel >= mNumMipLevels || index.arrayIndex >= mArrayLength ||
             index.cubeFace >= mNumCubeFaces) {
         return false;
     }
@@ -334,7 +840,7 @@ bool KtxBundle::setBlob(KtxBlobIndex index, uint8_t const* data, uint32_t size)
 }
 
 bool KtxBundle::allocateBlob(KtxBlobIndex index, uint32_t size) {
-    if (index.mipLevel >= mNumMipLevels || index.arrayIndex >= mArrayLength ||
+    if (isView() || index.mipLevel >= mNumMipLevels || index.arrayIndex >= mArrayLength ||
             index.cubeFace >= mNumCubeFaces) {
         return false;
     }
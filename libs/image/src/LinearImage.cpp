@@ -28,6 +28,7 @@ struct LinearImage::SharedReference {
         memset(floats, 0, sizeof(float) * nfloats);
         pixels = std::shared_ptr<float>(floats, std::default_delete<float[]>());
     }
+    explicit SharedReference(std::shared_ptr<float> pixels) : pixels(std::move(pixels)) {}
     std::shared_ptr<float> pixels;
 };
 
@@ -40,6 +41,12 @@ LinearImage::LinearImage(uint32_t width, uint32_t height, uint32_t channels) :
     mData(mDataRef->pixels.get()),
     mWidth(width), mHeight(height), mChannels(channels) {}
 
+LinearImage::LinearImage(uint32_t width, uint32_t height, uint32_t channels,
+        std::shared_ptr<float> pixels) :
+    mDataRef(new SharedReference(std::move(pixels))),
+    mData(mDataRef->pixels.get()),
+    mWidth(width), mHeight(height), mChannels(channels) {}
+
 LinearImage::LinearImage(const LinearImage& that) {
     *this = that;
 }
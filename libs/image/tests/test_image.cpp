@@ -17,6 +17,7 @@
 #include <image/ColorTransform.h>
 #include <image/KtxBundle.h>
 #include <image/ImageOps.h>
+#include <image/ImagePool.h>
 #include <image/ImageSampler.h>
 #include <image/LinearImage.h>
 
@@ -26,6 +27,7 @@
 
 #include <gtest/gtest.h>
 
+#include <utils/JobSystem.h>
 #include <utils/Panic.h>
 #include <utils/Path.h>
 
@@ -33,6 +35,7 @@
 #include <math/vec4.h>
 
 #include <fstream>
+#include <limits>
 #include <string>
 #include <sstream>
 #include <vector>
@@ -239,7 +242,7 @@ TEST_F(ImageTest, ColorFilters) { // NOLINT
 }
 
 TEST_F(ImageTest, VectorFilters) { // NOLINT
-    auto toColors = vectorsToColors;
+    auto toColors = static_cast<LinearImage(*)(const LinearImage&)>(vectorsToColors);
     auto normals = createNormalMap(1024);
     auto wrong = resampleImage(toColors(normals), 16, 16, Filter::GAUSSIAN_SCALARS);
     auto right = toColors(resampleImage(normals, 16, 16, Filter::GAUSSIAN_NORMALS));
@@ -362,6 +365,144 @@ TEST_F(ImageTest, Mipmaps) { // NOLINT
     }
 }
 
+TEST_F(ImageTest, ParallelResample) { // NOLINT
+    utils::JobSystem js;
+    js.adopt();
+
+    // Large enough for the rows to be split into several jobs.
+    LinearImage src = resampleImage(createColorFromAscii("12 34"), 300, 200, Filter::NEAREST);
+    const Filter filters[] = { Filter::DEFAULT, Filter::BOX, Filter::MITCHELL, Filter::LANCZOS,
+            Filter::GAUSSIAN_NORMALS, Filter::MINIMUM };
+    for (Filter filter : filters) {
+        const uint32_t sizes[][2] = { { 150, 100 }, { 37, 301 }, { 640, 70 } };
+        for (auto size : sizes) {
+            LinearImage serial = resampleImage(src, size[0], size[1], filter);
+            LinearImage parallel = resampleImage(src, size[0], size[1], filter, &js);
+            ASSERT_EQ(parallel.getWidth(), size[0]);
+            ASSERT_EQ(parallel.getHeight(), size[1]);
+            const uint32_t count = size[0] * size[1] * src.getChannels();
+            for (uint32_t i = 0; i < count; i++) {
+                ASSERT_EQ(serial.getPixelRef()[i], parallel.getPixelRef()[i]);
+            }
+        }
+    }
+
+    js.emancipate();
+}
+
+TEST_F(ImageTest, InPlaceOps) { // NOLINT
+    auto create = []() { return createColorFromAscii("123 456 789"); };
+    const LinearImage src = create();
+    auto expectEqual = [](const LinearImage& a, const LinearImage& b) {
+        ASSERT_EQ(a.getWidth(), b.getWidth());
+        ASSERT_EQ(a.getHeight(), b.getHeight());
+        ASSERT_EQ(a.getChannels(), b.getChannels());
+        const uint32_t count = a.getWidth() * a.getHeight() * a.getChannels();
+        for (uint32_t i = 0; i < count; i++) {
+            ASSERT_EQ(a.getPixelRef()[i], b.getPixelRef()[i]);
+        }
+    };
+
+    LinearImage image = create();
+    horizontalFlip(image, &image);
+    expectEqual(image, horizontalFlip(src));
+
+    image = create();
+    verticalFlip(image, &image);
+    expectEqual(image, verticalFlip(src));
+
+    image = create();
+    transpose(image, &image);
+    expectEqual(image, transpose(src));
+
+    image = create();
+    vectorsToColors(image, &image);
+    expectEqual(image, vectorsToColors(src));
+
+    LinearImage channel(3, 3, 1);
+    extractChannel(src, 2, &channel);
+    expectEqual(channel, extractChannel(src, 2));
+}
+
+TEST_F(ImageTest, ImagePool) { // NOLINT
+    ImagePool pool;
+    float const* pixels;
+    {
+        LinearImage image = pool.acquire(16, 16, 3);
+        pixels = image.getPixelRef();
+        clearToValue(image, 1.0f);
+        EXPECT_EQ(pool.getFreeSize(), 0);
+    }
+    EXPECT_EQ(pool.getFreeSize(), 16 * 16 * 3 * sizeof(float));
+
+    // A smaller image reuses the storage, cleared.
+    LinearImage smaller = pool.acquire(8, 8, 4);
+    EXPECT_EQ(smaller.getPixelRef(), pixels);
+    EXPECT_EQ(smaller.getPixelRef()[0], 0.0f);
+    EXPECT_EQ(pool.getFreeSize(), 0);
+
+    // The intermediate image of each level comes back to the pool.
+    LinearImage src = resampleImage(createColorFromAscii("12 34"), 64, 32, Filter::NEAREST);
+    LinearImage levels[6];
+    LinearImage reference[6];
+    generateMipmaps(src, Filter::DEFAULT, levels, 6, nullptr, &pool);
+    generateMipmaps(src, Filter::DEFAULT, reference, 6);
+    EXPECT_GT(pool.getFreeSize(), 0);
+    for (int i = 0; i < 6; i++) {
+        const uint32_t count = levels[i].getWidth() * levels[i].getHeight() * 3;
+        for (uint32_t j = 0; j < count; j++) {
+            ASSERT_EQ(levels[i].getPixelRef()[j], reference[i].getPixelRef()[j]);
+        }
+    }
+
+    // Images may outlive the pool.
+    ImagePool* transient = new ImagePool();
+    LinearImage survivor = transient->acquire(4, 4, 1);
+    delete transient;
+    survivor.reset();
+}
+
+TEST_F(ImageTest, Diff) { // NOLINT
+    // Large enough for the rows to be split into several bands.
+    auto create = []() {
+        return resampleImage(createColorFromAscii("12 34"), 300, 200, Filter::NEAREST);
+    };
+    LinearImage golden = create();
+    LinearImage result = create();
+    result.getPixelRef(10, 20)[1] += 0.25f;
+    result.getPixelRef(299, 199)[2] -= 0.5f;
+
+    DiffResult same = diff(golden, golden, {});
+    EXPECT_TRUE(same.match);
+    EXPECT_EQ(same.mismatchingPixels, 0);
+    EXPECT_EQ(same.maxDifference, 0.0f);
+
+    DiffConfig config;
+    config.maxMismatchingPixels = 2;
+    config.heatmapScale = 16;
+    DiffResult two = diff(result, golden, config);
+    EXPECT_TRUE(two.match);
+    EXPECT_EQ(two.mismatchingPixels, 2);
+    EXPECT_FLOAT_EQ(two.maxDifference, 0.5f);
+    ASSERT_EQ(two.heatmap.getWidth(), 19);
+    ASSERT_EQ(two.heatmap.getHeight(), 13);
+    EXPECT_FLOAT_EQ(two.heatmap.getPixelRef(0, 1)[0], 0.25f);
+    EXPECT_FLOAT_EQ(two.heatmap.getPixelRef(18, 12)[0], 0.5f);
+    EXPECT_EQ(two.heatmap.getPixelRef(1, 1)[0], 0.0f);
+
+    // Stops early once a single mismatch is found.
+    EXPECT_FALSE(diff(result, golden, {}).match);
+
+    config = {};
+    config.epsilon = 0.5f;
+    EXPECT_TRUE(diff(result, golden, config).match);
+
+    result.getPixelRef(0, 0)[0] = std::numeric_limits<float>::quiet_NaN();
+    EXPECT_FALSE(diff(result, golden, config).match);
+
+    EXPECT_FALSE(diff(result, LinearImage(300, 100, 3), config).match);
+}
+
 TEST_F(ImageTest, Ktx) { // NOLINT
     uint8_t foo[] = {1, 2, 3};
     uint8_t* data;
@@ -427,6 +568,122 @@ TEST_F(ImageTest, Ktx) { // NOLINT
     }
 }
 
+TEST_F(ImageTest, KtxView) { // NOLINT
+    // A cubemap with two miplevels, each face filled with a distinct byte.
+    KtxBundle original(2, 1, true);
+    original.setMetadata("sh", "1 2 3");
+    for (uint32_t level = 0; level < 2; ++level) {
+        for (uint32_t face = 0; face < 6; ++face) {
+            vector<uint8_t> blob(16 >> level, uint8_t(level * 6 + face));
+            ASSERT_TRUE(original.setBlob({level, 0, face}, blob.data(), blob.size()));
+        }
+    }
+    vector<uint8_t> serialized(original.getSerializedLength());
+    ASSERT_TRUE(original.serialize(serialized.data(), serialized.size()));
+
+    KtxBundle view(serialized.data(), serialized.size(), KtxBundle::BlobStorage::VIEW);
+    ASSERT_TRUE(view.isView());
+    ASSERT_FALSE(original.isView());
+    ASSERT_EQ(view.getNumMipLevels(), 2);
+    ASSERT_TRUE(view.isCubemap());
+    ASSERT_EQ(string(view.getMetadata("sh")), "1 2 3");
+
+    // The blobs point into the serialized data, and the faces of a level are contiguous.
+    uint8_t* data;
+    uint32_t size;
+    for (uint32_t level = 0; level < 2; ++level) {
+        uint8_t* first;
+        ASSERT_TRUE(view.getBlob({level, 0, 0}, &first, &size));
+        for (uint32_t face = 0; face < 6; ++face) {
+            ASSERT_TRUE(view.getBlob({level, 0, face}, &data, &size));
+            ASSERT_EQ(size, 16u >> level);
+            ASSERT_EQ(data, first + face * size);
+            ASSERT_GE(data, serialized.data());
+            ASSERT_LT(data, serialized.data() + serialized.size());
+            ASSERT_EQ(data[0], level * 6 + face);
+        }
+    }
+
+    // A view is read-only, but can be serialized again.
+    uint8_t foo[] = {1, 2, 3};
+    ASSERT_FALSE(view.setBlob({0, 0, 0}, foo, sizeof(foo)));
+    ASSERT_FALSE(view.allocateBlob({0, 0, 0}, sizeof(foo)));
+    vector<uint8_t> reserialized(view.getSerializedLength());
+    ASSERT_TRUE(view.serialize(reserialized.data(), reserialized.size()));
+    ASSERT_EQ(reserialized, serialized);
+}
+
+TEST_F(ImageTest, Ktx2) { // NOLINT
+    // A cubemap with three miplevels of RGBA8, each face filled with a distinct byte.
+    KtxBundle original(3, 1, true);
+    original.info() = { KtxBundle::ENDIAN_DEFAULT, KtxBundle::UNSIGNED_BYTE, 1, KtxBundle::RGBA,
+            KtxBundle::RGBA8, KtxBundle::RGBA, 4, 4, 0 };
+    original.setMetadata("sh", "1 2 3");
+    for (uint32_t level = 0; level < 3; ++level) {
+        for (uint32_t face = 0; face < 6; ++face) {
+            vector<uint8_t> blob(64 >> (level * 2), uint8_t(level * 6 + face));
+            ASSERT_TRUE(original.setBlob({level, 0, face}, blob.data(), blob.size()));
+        }
+    }
+
+    utils::JobSystem js;
+    js.adopt();
+
+    auto check = [&](KtxBundle const& copy) {
+        KtxInfo const& a = original.getInfo();
+        KtxInfo const& b = copy.getInfo();
+        ASSERT_EQ(a.glType, b.glType);
+        ASSERT_EQ(a.glTypeSize, b.glTypeSize);
+        ASSERT_EQ(a.glFormat, b.glFormat);
+        ASSERT_EQ(a.glInternalFormat, b.glInternalFormat);
+        ASSERT_EQ(a.glBaseInternalFormat, b.glBaseInternalFormat);
+        ASSERT_EQ(a.pixelWidth, b.pixelWidth);
+        ASSERT_EQ(a.pixelHeight, b.pixelHeight);
+        ASSERT_EQ(copy.getNumMipLevels(), 3);
+        ASSERT_EQ(copy.getArrayLength(), 1);
+        ASSERT_TRUE(copy.isCubemap());
+        ASSERT_EQ(string(copy.getMetadata("sh")), "1 2 3");
+        for (uint32_t level = 0; level < 3; ++level) {
+            for (uint32_t face = 0; face < 6; ++face) {
+                uint8_t* expected;
+                uint8_t* data;
+                uint32_t expectedSize;
+                uint32_t size;
+                ASSERT_TRUE(original.getBlob({level, 0, face}, &expected, &expectedSize));
+                ASSERT_TRUE(copy.getBlob({level, 0, face}, &data, &size));
+                ASSERT_EQ(size, expectedSize);
+                ASSERT_EQ(memcmp(data, expected, size), 0);
+            }
+        }
+    };
+
+    std::unique_ptr<uint8_t[]> plain;
+    const uint32_t plainSize = original.serializeKtx2(&plain);
+    ASSERT_GT(plainSize, 0u);
+    check(KtxBundle(plain.get(), plainSize));
+
+    // Without supercompression, a view points into the serialized data.
+    KtxBundle view(plain.get(), plainSize, KtxBundle::BlobStorage::VIEW);
+    ASSERT_TRUE(view.isView());
+    check(view);
+
+    std::unique_ptr<uint8_t[]> zlib;
+    const uint32_t zlibSize = original.serializeKtx2(&zlib, KtxBundle::Supercompression::ZLIB, &js);
+    ASSERT_GT(zlibSize, 0u);
+    ASSERT_LT(zlibSize, plainSize);
+    check(KtxBundle(zlib.get(), zlibSize));
+    check(KtxBundle(zlib.get(), zlibSize, KtxBundle::BlobStorage::COPY, &js));
+
+    // Supercompressed levels can't be viewed, they're decompressed instead.
+    KtxBundle decompressed(zlib.get(), zlibSize, KtxBundle::BlobStorage::VIEW, &js);
+    ASSERT_FALSE(decompressed.isView());
+    check(decompressed);
+
+    // A format without a Vulkan equivalent can't be written.
+    original.info().glInternalFormat = KtxBundle::RGB9_E5;
+    ASSERT_EQ(original.serializeKtx2(&plain), 0u);
+}
+
 TEST_F(ImageTest, getSphericalHarmonics) {
     KtxBundle ktx(2, 1, true);
 
@@ -28,8 +28,16 @@
 
 #include <stdint.h>
 
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace image {
 
+// All encoders split the image into bands of block rows, which are compressed concurrently as
+// jobs of the given JobSystem. The calling thread must be adopted by the JobSystem. When no
+// JobSystem is given, the bands are compressed by a pool of threads local to the call.
+
 enum class CompressedFormat {
     INVALID = 0,
 
@@ -120,7 +128,8 @@ struct AstcConfig {
 
 // Uses the CPU to compress a linear image (1 to 4 channels) into an ASTC texture. The 16-byte
 // header block that ARM uses in their file format is not included.
-CompressedTexture astcCompress(const LinearImage& source, AstcConfig config);
+CompressedTexture astcCompress(const LinearImage& source, AstcConfig config,
+        utils::JobSystem* js = nullptr);
 
 // Parses a simple underscore-delimited string to produce an ASTC compression configuration. This
 // makes it easy to incorporate the compression API into command-line tools. If the string is
@@ -147,7 +156,9 @@ struct EtcConfig {
 };
 
 // Uses the CPU to compress a linear image (1 to 4 channels) into an ETC texture.
-CompressedTexture etcCompress(const LinearImage& source, EtcConfig config);
+// The effort applies to each band independently.
+CompressedTexture etcCompress(const LinearImage& source, EtcConfig config,
+        utils::JobSystem* js = nullptr);
 
 // Converts a string into an ETC compression configuration where the string has the form
 // FORMAT_METRIC_EFFORT where:
@@ -166,7 +177,8 @@ struct S3tcConfig {
 };
 
 // Uses the CPU to compress a linear image (1 to 4 channels) into an S3TC texture.
-CompressedTexture s3tcCompress(const LinearImage& source, S3tcConfig config);
+CompressedTexture s3tcCompress(const LinearImage& source, S3tcConfig config,
+        utils::JobSystem* js = nullptr);
 
 // Parses an underscore-delimited string to produce an S3TC compression configuration. Currently
 // this only accepts "rgb_dxt1" and "rgba_dxt5". If the string is malformed, this returns a config
@@ -180,11 +192,16 @@ struct CompressionConfig {
     AstcConfig astc;
     S3tcConfig s3tc;
     EtcConfig etc;
+
+    // Trades quality for speed, e.g. for iteration builds: ASTC uses the VERYFAST preset and ETC
+    // an effort of 0. S3TC always uses the fastest mode of its encoder.
+    bool fast = false;
 };
 
 bool parseOptionString(const std::string& options, CompressionConfig* config);
 
-CompressedTexture compressTexture(const CompressionConfig& config, const LinearImage& image);
+CompressedTexture compressTexture(const CompressionConfig& config, const LinearImage& image,
+        utils::JobSystem* js = nullptr);
 
 } // namespace image
 
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef IMAGE_FRAMESINK_H_
+#define IMAGE_FRAMESINK_H_
+
+#include <imageio/ImageEncoder.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace image {
+
+// Encodes and writes rendered frames to disk on a pool of worker threads, typically from the
+// callbacks of Renderer::readPixels(). Frames are encoded in parallel but written in the order
+// they are submitted. The pixel buffers are recycled once their frame is written, so that a long
+// sequence of frames of the same size doesn't allocate any.
+//
+//  uint8_t* pixels = sink.acquireBuffer(width * height * 3);
+//  PixelBufferDescriptor buffer(pixels, width * height * 3, RGB, UBYTE,
+//          [](void* pixels, size_t, void* user) { ... sink.submit(pixels, ...); }, user);
+//  renderer->readPixels(0, 0, width, height, std::move(buffer));
+class FrameSink {
+public:
+    struct Config {
+        ImageEncoder::Format format = ImageEncoder::Format::PNG;
+
+        // Passed to ImageEncoder::encode(), e.g. the deflate level from "0" to "9" for PNG.
+        std::string compression;
+
+        // Number of worker threads, 0 to use all hardware threads but one.
+        size_t threadCount = 0;
+
+        // Number of frames that can wait to be encoded or written before acquireBuffer() blocks,
+        // 0 for twice the number of threads. This bounds the memory used by the buffers.
+        size_t maxPendingFrames = 0;
+    };
+
+    explicit FrameSink(Config const& config);
+
+    // Waits for all the submitted frames to be written.
+    ~FrameSink();
+
+    FrameSink(FrameSink const&) = delete;
+    FrameSink& operator=(FrameSink const&) = delete;
+
+    // Returns a buffer of at least the given size, to be passed back to submit(). Blocks while
+    // the maximum number of submitted frames wait to be written. Thread-safe.
+    uint8_t* acquireBuffer(size_t size);
+
+    // Queues a frame for encoding, the pixels are 8-bit sRGB with 3 or 4 channels, tightly packed.
+    // The buffer must come from acquireBuffer() and is owned by the sink from now on.
+    // Thread-safe.
+    void submit(uint8_t* buffer, uint32_t width, uint32_t height, uint32_t channels,
+            std::string path);
+
+    // Waits for all the submitted frames to be written.
+    void flush();
+
+    // Returns the number of frames written so far. Thread-safe.
+    size_t getWrittenFrameCount() const;
+
+    // Returns the number of frames that could not be encoded or written. Thread-safe.
+    size_t getFailedFrameCount() const;
+
+private:
+    struct Buffer {
+        std::unique_ptr<uint8_t[]> data;
+        size_t capacity;
+    };
+
+    struct Frame {
+        uint64_t sequence;
+        Buffer buffer;
+        uint32_t width;
+        uint32_t height;
+        uint32_t channels;
+        std::string path;
+        std::string encoded; // filled by the worker
+        bool succeeded = false;
+    };
+
+    void run();
+    void encode(Frame& frame) const;
+    void write(Frame& frame);
+
+    const ImageEncoder::Format mFormat;
+    const std::string mCompression;
+    size_t mMaxPendingFrames;
+
+    mutable std::mutex mLock;
+    std::condition_variable mCondition;
+    std::vector<std::thread> mThreads;
+    std::vector<Buffer> mFreeBuffers;
+    std::vector<Buffer> mAcquiredBuffers;
+    std::deque<std::unique_ptr<Frame>> mQueue;      // waiting to be encoded
+    std::vector<std::unique_ptr<Frame>> mEncoded;   // encoded, waiting for the previous frames
+    size_t mPendingFrames = 0;                      // queued or encoded
+    uint64_t mNextSequence = 0;
+    uint64_t mNextToWrite = 0;
+    size_t mWrittenFrames = 0;
+    size_t mFailedFrames = 0;
+    bool mWriting = false;
+    bool mExit = false;
+};
+
+} // namespace image
+
+#endif /* IMAGE_FRAMESINK_H_ */
@@ -17,9 +17,12 @@
 #ifndef IMAGE_IMAGEDECODER_H_
 #define IMAGE_IMAGEDECODER_H_
 
+#include <functional>
 #include <iosfwd>
 #include <string>
 
+#include <stdint.h>
+
 #include <image/LinearImage.h>
 
 namespace image {
@@ -31,15 +34,36 @@ public:
         SRGB
     };
 
-    // Returns linear floating-point data, or a non-valid image if an error occured.
+    // Called once with the dimensions of the image before any scanline is decoded. Returning
+    // false stops the decoding.
+    using HeaderCallback = std::function<bool(uint32_t width, uint32_t height, uint32_t channels)>;
+
+    // Called for each decoded scanline with width * channels linear floats. The scanlines are
+    // visited exactly once each, but not necessarily from top to bottom.
+    using ScanlineCallback = std::function<void(uint32_t y, float const* row)>;
+
+    // Returns linear floating-point data, or a non-valid image if an error occured. The scanlines
+    // are decoded and converted on all the hardware threads where the format allows it.
     static LinearImage decode(std::istream& stream, const std::string& sourceName,
             ColorSpace sourceSpace = ColorSpace::SRGB);
 
+    // Same as decode(), but hands out the image one scanline at a time, so the caller can
+    // convert it to its own storage without a full-size copy. Radiance (.hdr) files are
+    // streamed and never held in memory entirely, other formats are decoded first.
+    // Returns false if an error occured.
+    static bool decodeScanlines(std::istream& stream, const std::string& sourceName,
+            HeaderCallback const& header, ScanlineCallback const& scanline,
+            ColorSpace sourceSpace = ColorSpace::SRGB);
+
     class Decoder {
     public:
         virtual LinearImage decode() = 0;
         virtual ~Decoder() = default;
 
+        // the default implementation decodes the whole image and then visits its rows
+        virtual bool decodeScanlines(HeaderCallback const& header,
+                ScanlineCallback const& scanline);
+
         ColorSpace getColorSpace() const noexcept {
             return mColorSpace;
         }
@@ -51,15 +75,6 @@ public:
     private:
         ColorSpace mColorSpace = ColorSpace::SRGB;
     };
-
-private:
-    enum class Format {
-        NONE,
-        PNG,
-        HDR,
-        PSD,
-        EXR
-    };
 };
 
 } // namespace image
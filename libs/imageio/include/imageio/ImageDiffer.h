@@ -18,6 +18,9 @@
 
 #include <utils/Path.h>
 
+#include <stddef.h>
+#include <stdint.h>
+
 namespace image {
 
 enum class ComparisonMode {
@@ -26,6 +29,38 @@ enum class ComparisonMode {
     UPDATE,
 };
 
+// Per-pixel comparison of a result image against a golden image, see diff().
+struct DiffConfig {
+    // Largest absolute difference allowed in any channel for two pixels to match.
+    float epsilon = 0.0f;
+
+    // The images match when at most this many pixels don't. The comparison stops as soon as the
+    // count is exceeded, unless a heatmap is requested.
+    size_t maxMismatchingPixels = 0;
+
+    // When non-zero, diff() also produces a single-channel heatmap downsampled by this factor in
+    // both dimensions, where each texel holds the largest difference of its block of pixels.
+    uint32_t heatmapScale = 0;
+};
+
+struct DiffResult {
+    // False if the dimensions differ or too many pixels don't match.
+    bool match = false;
+
+    // Pixels with a channel that differs by more than epsilon, or is NaN. This is only a lower
+    // bound when the comparison stopped early.
+    size_t mismatchingPixels = 0;
+
+    // Largest absolute difference in any channel of the pixels compared.
+    float maxDifference = 0.0f;
+
+    LinearImage heatmap;
+};
+
+// Compares two images of the same dimensions, in parallel bands of rows on all the hardware
+// threads.
+DiffResult diff(const LinearImage& result, const LinearImage& golden, const DiffConfig& config);
+
 // Saves an image to disk or does a load-and-compare, depending on comparison mode.
 // This makes it easy for unit tests to have compare / update commands.
 // The passed-in image is the "result image" and the expected image is the "golden image".
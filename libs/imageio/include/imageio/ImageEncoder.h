@@ -29,6 +29,7 @@ public:
     enum class Format {
         PNG,        // 8-bit sRGB, 1 or 3 channels
         PNG_LINEAR, // 8-bit linear RGB, 1 or 3 channels
+                    // Default: libpng deflate level, "0" to "9" to override
         HDR,        // 8-bit linear RGBE, 3 channels only
         RGBM,       // 8-bit RGBM, as PNG, 3 channels only
         PSD,        // 16-bit sRGB or 32-bit linear RGB, 3 channels only
@@ -18,9 +18,14 @@
 
 #include <image/ImageOps.h>
 
+#include <utils/JobSystem.h>
+
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstring>
 #include <thread>
+#include <vector>
 
 #include <astcenc.h>
 #include <Etc.h>
@@ -32,7 +37,50 @@ namespace image {
 
 static LinearImage extendToFourChannels(LinearImage source);
 
-CompressedTexture astcCompress(const LinearImage& original, AstcConfig config) {
+// Calls encode(firstRow, rowCount) for bands of block rows, concurrently. The bands are the same
+// with or without a JobSystem, so the output doesn't depend on it. The first band is always
+// encoded first on the calling thread, so that the encoders can lazily initialize their global
+// tables safely.
+template<typename ENCODE>
+static void encodeBlockRows(utils::JobSystem* js, uint32_t blockRows, ENCODE encode) {
+    constexpr uint32_t BAND_SIZE = 4;
+    const uint32_t bandCount = (blockRows + BAND_SIZE - 1) / BAND_SIZE;
+    auto encodeBands = [&](uint32_t first, uint32_t count) {
+        for (uint32_t band = first; band < first + count; band++) {
+            const uint32_t row = band * BAND_SIZE;
+            encode(row, std::min(BAND_SIZE, blockRows - row));
+        }
+    };
+    encodeBands(0, std::min(1u, bandCount));
+    if (bandCount <= 1) {
+        return;
+    }
+    if (js) {
+        auto job = utils::jobs::parallel_for(*js, nullptr, 1, bandCount - 1,
+                std::cref(encodeBands), utils::jobs::CountSplitter<1, 8>());
+        js->runAndWait(job);
+        return;
+    }
+    std::atomic_uint next = { 1 };
+    auto worker = [&]() {
+        for (uint32_t band = next++; band < bandCount; band = next++) {
+            encodeBands(band, 1);
+        }
+    };
+    const uint32_t threadCount = std::min(bandCount - 1,
+            std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < threadCount; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+CompressedTexture astcCompress(const LinearImage& original, AstcConfig config,
+        utils::JobSystem* js) {
 
     // If this is the first time, initialize the ARM encoder tables.
 
@@ -289,8 +337,6 @@ CompressedTexture astcCompress(const LinearImage& original, AstcConfig config) {
             break;
     }
 
-    const int threadcount = std::thread::hardware_concurrency();
-
     const int xsize = input_image->xsize;
     const int ysize = input_image->ysize;
     const int zsize = input_image->zsize;
@@ -301,8 +347,15 @@ CompressedTexture astcCompress(const LinearImage& original, AstcConfig config) {
     uint32_t size = xblocks * yblocks * zblocks * 16;
     uint8_t* buffer = new uint8_t[size];
 
-    encode_astc_image(input_image, nullptr, xdim, ydim, zdim, &ewp, decode_mode,
-            swz_encode, swz_decode, buffer, 0, threadcount);
+    // Each band is a view on the rows of the input image, its blocks are contiguous in the output.
+    encodeBlockRows(js, yblocks, [&](uint32_t firstRow, uint32_t rowCount) {
+        uint16_t** rows = input_image->imagedata16[0] + firstRow * ydim;
+        astc_codec_image band = *input_image;
+        band.imagedata16 = &rows;
+        band.ysize = std::min(int(rowCount) * ydim, ysize - int(firstRow) * ydim);
+        encode_astc_image(&band, nullptr, xdim, ydim, zdim, &ewp, decode_mode,
+                swz_encode, swz_decode, buffer + firstRow * xblocks * 16, 0, 1);
+    });
 
     destroy_image(input_image);
 
@@ -382,22 +435,26 @@ static void extract4x4RGBA(uint8_t* dst, const LinearImage& source, uint32_t x0,
 //  - DXT5 with alpha (16 input pixels into 128 bits of output, 4:1)
 //
 // TODO: investigate using something more capable than STB (eg AMD Compressenator, bimg, libsquish)
-CompressedTexture s3tcCompress(const LinearImage& original, S3tcConfig config) {
+CompressedTexture s3tcCompress(const LinearImage& original, S3tcConfig config,
+        utils::JobSystem* js) {
     const bool dxt5 = config.format == CompressedFormat::RGBA_S3TC_DXT5;
+    const uint32_t blockSize = dxt5 ? 16 : 8;
     LinearImage source = extendToFourChannels(original);
-    uint8_t block[64];
     uint32_t xblocks = (source.getWidth() + 3) / 4;
     uint32_t yblocks = (source.getHeight() + 3) / 4;
-    uint32_t size = xblocks * yblocks * (dxt5 ? 16 : 8);
+    uint32_t size = xblocks * yblocks * blockSize;
     uint8_t* buffer = new uint8_t[size];
-    uint8_t* dst = buffer;
-    for (int y = 0, h = source.getHeight(); y < h; y += 4) {
-        for (int x = 0, w = source.getWidth(); x < w; x += 4) {
-            extract4x4RGBA(block, source, x, y);
-            stb_compress_dxt_block(dst, block, dxt5, 8);
-            dst += dxt5 ? 16 : 8;
+    encodeBlockRows(js, yblocks, [&](uint32_t firstRow, uint32_t rowCount) {
+        uint8_t block[64];
+        uint8_t* dst = buffer + firstRow * xblocks * blockSize;
+        for (uint32_t by = firstRow; by < firstRow + rowCount; by++) {
+            for (uint32_t bx = 0; bx < xblocks; bx++) {
+                extract4x4RGBA(block, source, bx * 4, by * 4);
+                stb_compress_dxt_block(dst, block, dxt5, STB_DXT_NORMAL);
+                dst += blockSize;
+            }
         }
-    }
+    });
     return {
         .format = config.format,
         .size = size,
@@ -415,9 +472,9 @@ S3tcConfig s3tcParseOptionString(const std::string& options) {
     return {};
 }
 
-CompressedTexture etcCompress(const LinearImage& original, EtcConfig config) {
+CompressedTexture etcCompress(const LinearImage& original, EtcConfig config,
+        utils::JobSystem* js) {
     LinearImage source = extendToFourChannels(original);
-    const int threadcount = std::thread::hardware_concurrency();
     Etc::Image::Format etcformat;
     switch (config.format) {
         case CompressedFormat::R11_EAC: etcformat = Etc::Image::Format::R11; break;
@@ -441,31 +498,47 @@ CompressedTexture etcCompress(const LinearImage& original, EtcConfig config) {
         case EtcErrorMetric::NORMALXYZ: etcmetric = Etc::NORMALXYZ; break;
         default: return {};
     }
-    unsigned char *paucEncodingBits;
-    unsigned int uiEncodingBitsBytes;
-    unsigned int uiExtendedWidth;
-    unsigned int uiExtendedHeight;
-    int iEncodingTime_ms;
-
-    // The etc2comp API doesn't tell you that you need to free paucEncodingBits, but they have a
-    // commented-out "delete[] m_paucEncodingBits" in their Image destructor, which is essentially
-    // what our unique_ptr wrapper does (CompressedTexture::data).
-
-    Etc::Encode(source.getPixelRef(0, 0),
-        source.getWidth(), source.getHeight(),
-        etcformat,
-        etcmetric,
-        config.effort,
-        threadcount,
-        1024,
-        &paucEncodingBits, &uiEncodingBitsBytes,
-        &uiExtendedWidth, &uiExtendedHeight,
-        &iEncodingTime_ms);
+    const uint32_t width = source.getWidth();
+    const uint32_t height = source.getHeight();
+    const uint32_t xblocks = (width + 3) / 4;
+    const uint32_t yblocks = (height + 3) / 4;
+
+    // The size of a block depends on the format, we learn it from the first band.
+    uint8_t* buffer = nullptr;
+    uint32_t blockSize = 0;
+
+    encodeBlockRows(js, yblocks, [&](uint32_t firstRow, uint32_t rowCount) {
+        unsigned char *paucEncodingBits;
+        unsigned int uiEncodingBitsBytes;
+        unsigned int uiExtendedWidth;
+        unsigned int uiExtendedHeight;
+        int iEncodingTime_ms;
+
+        Etc::Encode(source.getPixelRef(0, firstRow * 4),
+            width, std::min(rowCount * 4, height - firstRow * 4),
+            etcformat,
+            etcmetric,
+            config.effort,
+            1,
+            1,
+            &paucEncodingBits, &uiEncodingBitsBytes,
+            &uiExtendedWidth, &uiExtendedHeight,
+            &iEncodingTime_ms);
+
+        // The etc2comp API doesn't tell you that you need to free paucEncodingBits, but they have
+        // a commented-out "delete[] m_paucEncodingBits" in their Image destructor.
+        if (!buffer) {
+            blockSize = uiEncodingBitsBytes / (xblocks * rowCount);
+            buffer = new uint8_t[xblocks * yblocks * blockSize];
+        }
+        memcpy(buffer + firstRow * xblocks * blockSize, paucEncodingBits, uiEncodingBitsBytes);
+        delete[] paucEncodingBits;
+    });
 
     return {
         .format = config.format,
-        .size = uiEncodingBitsBytes,
-        .data = decltype(CompressedTexture::data)(paucEncodingBits)
+        .size = xblocks * yblocks * blockSize,
+        .data = decltype(CompressedTexture::data)(buffer)
     };
 }
 
@@ -533,15 +606,24 @@ bool parseOptionString(const std::string& options, CompressionConfig* config) {
     return config->type != CompressionConfig::INVALID;
 }
 
-CompressedTexture compressTexture(const CompressionConfig& config, const LinearImage& image) {
+CompressedTexture compressTexture(const CompressionConfig& config, const LinearImage& image,
+        utils::JobSystem* js) {
     if (config.type == CompressionConfig::ASTC) {
-        return astcCompress(image, config.astc);
+        AstcConfig astc = config.astc;
+        if (config.fast) {
+            astc.quality = AstcPreset::VERYFAST;
+        }
+        return astcCompress(image, astc, js);
     }
     if (config.type == CompressionConfig::S3TC) {
-        return s3tcCompress(image, config.s3tc);
+        return s3tcCompress(image, config.s3tc, js);
     }
     if (config.type == CompressionConfig::ETC) {
-        return etcCompress(image, config.etc);
+        EtcConfig etc = config.etc;
+        if (config.fast) {
+            etc.effort = 0;
+        }
+        return etcCompress(image, etc, js);
     }
     return {};
 }
@@ -562,11 +644,13 @@ static LinearImage extendToFourChannels(LinearImage original) {
             auto l = image::extractChannel(source, 0);
             auto a = createEmptyImage(1.0f);
             source = image::combineChannels({l, l, l, a});
+            break;
         }
         case 2: {
             auto l = image::extractChannel(source, 0);
             auto a = image::extractChannel(source, 1);
             source = image::combineChannels({l, l, l, a});
+            break;
         }
         case 3: {
             auto r = image::extractChannel(source, 0);
@@ -574,6 +658,7 @@ static LinearImage extendToFourChannels(LinearImage original) {
             auto b = image::extractChannel(source, 2);
             auto a = createEmptyImage(1.0f);
             source = image::combineChannels({r, g, b, a});
+            break;
         }
         default: {
             auto r = image::extractChannel(source, 0);
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <imageio/FrameSink.h>
+
+#include <image/ColorTransform.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace image {
+
+FrameSink::FrameSink(Config const& config)
+        : mFormat(config.format), mCompression(config.compression) {
+    size_t threadCount = config.threadCount;
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+        threadCount = std::max(size_t(1), threadCount);
+    }
+    mMaxPendingFrames = config.maxPendingFrames ? config.maxPendingFrames : threadCount * 2;
+    for (size_t i = 0; i < threadCount; i++) {
+        mThreads.emplace_back(&FrameSink::run, this);
+    }
+}
+
+FrameSink::~FrameSink() {
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+    mCondition.notify_all();
+    for (std::thread& thread : mThreads) {
+        thread.join();
+    }
+}
+
+uint8_t* FrameSink::acquireBuffer(size_t size) {
+    std::unique_lock<std::mutex> lock(mLock);
+    // Only the submitted frames count, the readback callbacks that submit the acquired buffers
+    // may have to run on this very thread.
+    mCondition.wait(lock, [this]() { return mPendingFrames < mMaxPendingFrames; });
+
+    // frames usually all have the same size, so the first large enough buffer is as good as any
+    auto pos = std::find_if(mFreeBuffers.begin(), mFreeBuffers.end(),
+            [size](Buffer const& buffer) { return buffer.capacity >= size; });
+    if (pos != mFreeBuffers.end()) {
+        mAcquiredBuffers.push_back(std::move(*pos));
+        mFreeBuffers.erase(pos);
+    } else {
+        mAcquiredBuffers.push_back({ std::unique_ptr<uint8_t[]>(new uint8_t[size]), size });
+    }
+    return mAcquiredBuffers.back().data.get();
+}
+
+void FrameSink::submit(uint8_t* buffer, uint32_t width, uint32_t height, uint32_t channels,
+        std::string path) {
+    std::unique_ptr<Frame> frame(new Frame{ 0, {}, width, height, channels, std::move(path) });
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto pos = std::find_if(mAcquiredBuffers.begin(), mAcquiredBuffers.end(),
+                [buffer](Buffer const& b) { return b.data.get() == buffer; });
+        if (pos == mAcquiredBuffers.end()) {
+            std::cerr << "FrameSink: buffer not acquired from this sink." << std::endl;
+            return;
+        }
+        frame->buffer = std::move(*pos);
+        mAcquiredBuffers.erase(pos);
+        frame->sequence = mNextSequence++;
+        mPendingFrames++;
+        mQueue.push_back(std::move(frame));
+    }
+    mCondition.notify_all();
+}
+
+void FrameSink::flush() {
+    std::unique_lock<std::mutex> lock(mLock);
+    mCondition.wait(lock, [this]() { return mNextToWrite == mNextSequence; });
+}
+
+size_t FrameSink::getWrittenFrameCount() const {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mWrittenFrames;
+}
+
+size_t FrameSink::getFailedFrameCount() const {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mFailedFrames;
+}
+
+void FrameSink::run() {
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mCondition.wait(lock, [this]() { return mExit || !mQueue.empty(); });
+        if (mQueue.empty()) {
+            return;
+        }
+        std::unique_ptr<Frame> frame = std::move(mQueue.front());
+        mQueue.pop_front();
+
+        lock.unlock();
+        encode(*frame);
+        lock.lock();
+
+        // A single thread writes at a time, so that the files are written in submission order.
+        mEncoded.push_back(std::move(frame));
+        if (mWriting) {
+            continue;
+        }
+        mWriting = true;
+        while (true) {
+            auto pos = std::find_if(mEncoded.begin(), mEncoded.end(),
+                    [this](std::unique_ptr<Frame> const& f) { return f->sequence == mNextToWrite; });
+            if (pos == mEncoded.end()) {
+                break;
+            }
+            std::unique_ptr<Frame> next = std::move(*pos);
+            mEncoded.erase(pos);
+
+            lock.unlock();
+            write(*next);
+            lock.lock();
+
+            mFreeBuffers.push_back(std::move(next->buffer));
+            mWrittenFrames += next->succeeded ? 1 : 0;
+            mFailedFrames += next->succeeded ? 0 : 1;
+            mPendingFrames--;
+            mNextToWrite++;
+            mCondition.notify_all();
+        }
+        mWriting = false;
+    }
+}
+
+void FrameSink::encode(Frame& frame) const {
+    const uint8_t* pixels = frame.buffer.data.get();
+    const size_t bpr = size_t(frame.width) * frame.channels;
+    LinearImage image = frame.channels == 4 ?
+            toLinearWithAlpha<uint8_t>(frame.width, frame.height, bpr, pixels) :
+            toLinear<uint8_t>(frame.width, frame.height, bpr, pixels);
+    std::ostringstream stream(std::ios::binary);
+    frame.succeeded = ImageEncoder::encode(stream, mFormat, image, mCompression, frame.path);
+    frame.encoded = stream.str();
+}
+
+void FrameSink::write(Frame& frame) {
+    if (!frame.succeeded) {
+        std::cerr << "FrameSink: could not encode " << frame.path << std::endl;
+        return;
+    }
+    std::ofstream out(frame.path, std::ios::binary | std::ios::trunc);
+    out.write(frame.encoded.data(), std::streamsize(frame.encoded.size()));
+    frame.succeeded = bool(out);
+    if (!frame.succeeded) {
+        std::cerr << "FrameSink: could not write " << frame.path << std::endl;
+    }
+    std::string().swap(frame.encoded);
+}
+
+} // namespace image
@@ -18,6 +18,10 @@
 
 #include <imageio/ImageDecoder.h>
 
+#include "ProcessRows.h"
+
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <cstring> // for memcmp
 #include <iostream> // for cerr
@@ -91,6 +95,18 @@ private:
 
     // ImageDecoder::Decoder interface
     LinearImage decode() override;
+    bool decodeScanlines(ImageDecoder::HeaderCallback const& header,
+            ImageDecoder::ScanlineCallback const& scanline) override;
+
+    // '+Y' images are stored bottom to top, '-X' images right to left
+    struct Header {
+        uint32_t width;
+        uint32_t height;
+        bool flipX;
+        bool flipY;
+    };
+
+    Header readHeader();
 
     static const char sigRadiance[];
     static const char sigRGBE[];
@@ -145,9 +161,11 @@ private:
 
 // -----------------------------------------------------------------------------------------------
 
-LinearImage ImageDecoder::decode(std::istream& stream, const std::string& sourceName,
-        ColorSpace sourceSpace) {
+static std::unique_ptr<ImageDecoder::Decoder> createDecoder(std::istream& stream,
+        const std::string& sourceName, ImageDecoder::ColorSpace sourceSpace) {
+    using ColorSpace = ImageDecoder::ColorSpace;
 
+    enum class Format { NONE, PNG, HDR, PSD, EXR };
     Format format = Format::NONE;
 
     std::streampos pos = stream.tellg();
@@ -166,10 +184,10 @@ LinearImage ImageDecoder::decode(std::istream& stream, const std::string& source
 
     stream.seekg(pos);
 
-    std::unique_ptr<Decoder> decoder;
+    std::unique_ptr<ImageDecoder::Decoder> decoder;
     switch (format) {
         case Format::NONE:
-            return LinearImage();
+            break;
         case Format::PNG:
             decoder.reset(PNGDecoder::create(stream));
             decoder->setColorSpace(sourceSpace);
@@ -188,9 +206,46 @@ LinearImage ImageDecoder::decode(std::istream& stream, const std::string& source
             break;
     }
 
+    return decoder;
+}
+
+LinearImage ImageDecoder::decode(std::istream& stream, const std::string& sourceName,
+        ColorSpace sourceSpace) {
+    std::unique_ptr<Decoder> decoder = createDecoder(stream, sourceName, sourceSpace);
+    if (!decoder) {
+        return LinearImage();
+    }
     return decoder->decode();
 }
 
+bool ImageDecoder::decodeScanlines(std::istream& stream, const std::string& sourceName,
+        HeaderCallback const& header, ScanlineCallback const& scanline,
+        ColorSpace sourceSpace) {
+    std::unique_ptr<Decoder> decoder = createDecoder(stream, sourceName, sourceSpace);
+    if (!decoder) {
+        return false;
+    }
+    return decoder->decodeScanlines(header, scanline);
+}
+
+bool ImageDecoder::Decoder::decodeScanlines(HeaderCallback const& header,
+        ScanlineCallback const& scanline) {
+    LinearImage const image = decode();
+    if (!image.isValid()) {
+        return false;
+    }
+    uint32_t const width = image.getWidth();
+    uint32_t const height = image.getHeight();
+    uint32_t const channels = image.getChannels();
+    if (!header(width, height, channels)) {
+        return false;
+    }
+    for (uint32_t y = 0; y < height; y++) {
+        scanline(y, image.getPixelRef(0, y));
+    }
+    return true;
+}
+
 // -----------------------------------------------------------------------------------------------
 
 static inline float read32(std::istream& istream) {
@@ -206,6 +261,45 @@ static inline float read16(std::istream& istream) {
     return static_cast<float>(ntohs(data)) / std::numeric_limits<uint16_t>::max();
 }
 
+// Reads the remainder of the stream in memory.
+static std::vector<uint8_t> readRemaining(std::istream& stream) {
+    std::vector<uint8_t> data;
+    const std::streampos pos = stream.tellg();
+    stream.seekg(0, std::ios::end);
+    const std::streampos end = stream.tellg();
+    stream.seekg(pos);
+    if (pos != std::streampos(-1) && end != std::streampos(-1) && end >= pos) {
+        data.resize(size_t(end - pos));
+        stream.read(reinterpret_cast<char*>(data.data()), std::streamsize(data.size()));
+        data.resize(size_t(stream.gcount()));
+        return data;
+    }
+    // not seekable
+    stream.clear();
+    char buffer[4096];
+    while (stream.read(buffer, sizeof(buffer)) || stream.gcount()) {
+        data.insert(data.end(), &buffer[0], &buffer[stream.gcount()]);
+    }
+    return data;
+}
+
+// (rgb + 0.5) / 256 * 2^(e - 128), with the scales of all the exponents tabulated. A zero
+// exponent has a zero scale, which keeps the loops free of branches.
+static void convertRGBE(filament::math::float3* dst, uint8_t const* r, uint8_t const* g,
+        uint8_t const* b, uint8_t const* e, size_t stride, size_t width) {
+    static const std::array<float, 256> scales = []() {
+        std::array<float, 256> scales{};
+        for (int i = 1; i < 256; i++) {
+            scales[i] = std::ldexp(1.0f, i - (128 + 8));
+        }
+        return scales;
+    }();
+    for (size_t x = 0, i = 0; x < width; x++, i += stride) {
+        const float scale = scales[e[i]];
+        dst[x] = (filament::math::float3{ r[i], g[i], b[i] } + 0.5f) * scale;
+    }
+}
+
 // -----------------------------------------------------------------------------------------------
 
 PNGDecoder* PNGDecoder::create(std::istream& stream) {
@@ -232,6 +326,37 @@ PNGDecoder::~PNGDecoder() {
     png_destroy_read_struct(&mPNG, &mInfo, nullptr);
 }
 
+// Converts the 16-bit samples decoded by libpng, which are stored in network order (big endian),
+// to linear floats. The sRGB transfer function is tabulated for all the 16-bit values, alpha is
+// always linear.
+static LinearImage toLinear16(uint32_t width, uint32_t height, uint32_t channels,
+        size_t rowBytes, uint8_t const* src, bool sRGB) {
+    constexpr float max = std::numeric_limits<uint16_t>::max();
+    static const std::vector<float> sRGBToLinearTable = []() {
+        std::vector<float> table(std::numeric_limits<uint16_t>::max() + 1);
+        for (size_t v = 0; v < table.size(); v++) {
+            table[v] = sRGBToLinear(filament::math::float3{ float(v) / max }).x;
+        }
+        return table;
+    }();
+    const uint32_t colorChannels = sRGB ? 3 : 0;
+
+    LinearImage image(width, height, channels);
+    processRows(height, 16, [&](uint32_t first, uint32_t count) {
+        for (uint32_t y = first; y < first + count; y++) {
+            uint8_t const* p = src + y * rowBytes;
+            float* dst = image.getPixelRef(0, y);
+            for (uint32_t x = 0; x < width; x++) {
+                for (uint32_t c = 0; c < channels; c++, p += 2, dst++) {
+                    const uint16_t v = uint16_t((p[0] << 8) | p[1]);
+                    *dst = c < colorChannels ? sRGBToLinearTable[v] : float(v) / max;
+                }
+            }
+        }
+    });
+    return image;
+}
+
 LinearImage PNGDecoder::decode() {
     std::unique_ptr<uint8_t[]> imageData;
     try {
@@ -279,28 +404,9 @@ LinearImage PNGDecoder::decode() {
         png_read_image(mPNG, rowPointers.get());
         png_read_end(mPNG, mInfo);
 
-        if (colorType == PNG_COLOR_TYPE_RGBA) {
-            if (getColorSpace() == ImageDecoder::ColorSpace::SRGB) {
-                return toLinearWithAlpha<uint16_t>(width, height, rowBytes, imageData,
-                        [](uint16_t v) -> uint16_t { return ntohs(v); },
-                        sRGBToLinear<filament::math::float4>);
-            } else {
-                return toLinearWithAlpha<uint16_t>(width, height, rowBytes, imageData,
-                        [](uint16_t v) -> uint16_t { return ntohs(v); },
-                        [](const filament::math::float4& color) ->  filament::math::float4 { return color; });
-            }
-        } else {
-            // Convert to linear float (PNG 16 stores data in network order (big endian).
-            if (getColorSpace() == ImageDecoder::ColorSpace::SRGB) {
-                return toLinear<uint16_t>(width, height, rowBytes, imageData,
-                        [](uint16_t v) -> uint16_t { return ntohs(v); },
-                        sRGBToLinear< filament::math::float3>);
-            } else {
-                return toLinear<uint16_t>(width, height, rowBytes, imageData,
-                        [](uint16_t v) -> uint16_t { return ntohs(v); },
-                        [](const filament::math::float3& color) ->  filament::math::float3 { return color; });
-            }
-        }
+        const uint32_t channels = colorType == PNG_COLOR_TYPE_RGBA ? 4 : 3;
+        return toLinear16(width, height, channels, rowBytes, imageData.get(),
+                getColorSpace() == ImageDecoder::ColorSpace::SRGB);
     } catch(std::runtime_error& e) {
         // reset the stream, like we found it
         std::cerr << "Runtime error while decoding PNG: " << e.what() << std::endl;
@@ -352,36 +458,154 @@ HDRDecoder::HDRDecoder(std::istream& stream)
 
 HDRDecoder::~HDRDecoder() = default;
 
+HDRDecoder::Header HDRDecoder::readHeader() {
+    float gamma;
+    float exposure;
+    char sy, sx;
+    unsigned int height, width;
+
+    char buf[1024];
+    do {
+        char format[128];
+        mStream.getline(buf, sizeof(buf), 0xa);
+        if (!mStream) {
+            throw std::runtime_error("missing resolution");
+        }
+        if (buf[0] == '#') continue;
+        sscanf(buf, "FORMAT=%127s", format); // NOLINT
+        sscanf(buf, "GAMMA=%f", &gamma); // NOLINT
+        sscanf(buf, "EXPOSURE=%f", &exposure); // NOLINT
+        if ((sscanf(buf, "%cY %u %cX %u", &sy, &height, &sx, &width) == 4)||   // NOLINT
+            (sscanf(buf, "%cX %u %cY %u", &sx, &width, &sy, &height) == 4)) {  // NOLINT
+            break;
+        }
+    } while (true);
+
+    return { width, height, sx == '-', sy == '+' };
+}
+
 LinearImage HDRDecoder::decode() {
     try {
-        float gamma;
-        float exposure;
-        char sy, sx;
-        unsigned int height, width;
-
-        {
-            char buf[1024];
-            do {
-                char format[128];
-                mStream.getline(buf, sizeof(buf), 0xa);
-                if (buf[0] == '#') continue;
-                sscanf(buf, "FORMAT=%127s", format); // NOLINT
-                sscanf(buf, "GAMMA=%f", &gamma); // NOLINT
-                sscanf(buf, "EXPOSURE=%f", &exposure); // NOLINT
-                if ((sscanf(buf, "%cY %u %cX %u", &sy, &height, &sx, &width) == 4)||   // NOLINT
-                    (sscanf(buf, "%cX %u %cY %u", &sx, &width, &sy, &height) == 4)) {  // NOLINT
-                    break;
+        const Header h = readHeader();
+        const uint32_t width = h.width;
+        const uint32_t height = h.height;
+
+        // The whole file is read at once, so that the scanlines can be decoded concurrently.
+        const std::vector<uint8_t> data = readRemaining(mStream);
+        uint8_t const* const end = data.data() + data.size();
+
+        const bool rle = data.size() >= 4 && data[0] == 0x2 && data[1] == 0x2 &&
+                !(data[2] & 0x80) && width >= 8 && width <= 32767;
+
+        // Finds where each scanline starts, only the RLE packet headers need to be visited.
+        std::vector<uint8_t const*> scanlines(height);
+        if (!rle) {
+            if (data.size() < size_t(width) * height * 4) {
+                throw std::runtime_error("truncated image");
+            }
+            for (uint32_t y = 0; y < height; y++) {
+                scanlines[y] = data.data() + size_t(y) * width * 4;
+            }
+        } else {
+            uint8_t const* p = data.data();
+            for (uint32_t y = 0; y < height; y++) {
+                if (end - p < 4 || p[0] != 0x2 || p[1] != 0x2) {
+                    throw std::runtime_error("invalid scanline (magic)");
+                }
+                if (((uint32_t(p[2]) << 8) | p[3]) != width) {
+                    throw std::runtime_error("invalid scanline (width)");
                 }
-            } while (true);
+                scanlines[y] = p;
+                p += 4;
+                for (size_t c = 0; c < 4; c++) {
+                    size_t num_bytes = 0;
+                    while (num_bytes < width) {
+                        if (p == end) {
+                            throw std::runtime_error("truncated scanline");
+                        }
+                        const uint8_t rle_count = *p++;
+                        const size_t count = rle_count > 128 ? rle_count - 128 : rle_count;
+                        const size_t size = rle_count > 128 ? 1 : rle_count;
+                        if (count == 0) {
+                            throw std::runtime_error("run length is zero");
+                        }
+                        if (num_bytes + count > width) {
+                            throw std::runtime_error("invalid run length");
+                        }
+                        if (size_t(end - p) < size) {
+                            throw std::runtime_error("truncated scanline");
+                        }
+                        p += size;
+                        num_bytes += count;
+                    }
+                }
+            }
         }
 
         LinearImage image(width, height, 3);
+        processRows(height, 16, [&](uint32_t first, uint32_t count) {
+            std::unique_ptr<uint8_t[]> rgbe(new uint8_t[width * 4]);
+            for (uint32_t y = first; y < first + count; y++) {
+                auto* dst = reinterpret_cast<filament::math::float3*>(
+                        image.getPixelRef(0, h.flipY ? height - 1 - y : y));
+                uint8_t const* p = scanlines[y];
+                if (!rle) {
+                    convertRGBE(dst, p, p + 1, p + 2, p + 3, 4, width);
+                } else {
+                    // the scanline was validated above
+                    p += 4;
+                    uint8_t* d = rgbe.get();
+                    for (uint8_t* const e = d + width * 4; d != e;) {
+                        const uint8_t rle_count = *p++;
+                        if (rle_count > 128) {
+                            memset(d, *p++, size_t(rle_count - 128));
+                            d += rle_count - 128;
+                        } else {
+                            memcpy(d, p, rle_count);
+                            p += rle_count;
+                            d += rle_count;
+                        }
+                    }
+                    uint8_t const* r = rgbe.get();
+                    convertRGBE(dst, r, r + width, r + 2 * width, r + 3 * width, 1, width);
+                }
+                if (h.flipX) {
+                    std::reverse(dst, dst + width);
+                }
+            }
+        });
+        return image;
 
-        if (sx == '-') image = horizontalFlip(image);
-        if (sy == '+') image = verticalFlip(image);
+    } catch(std::runtime_error& e) {
+        // reset the stream, like we found it
+        std::cerr << "Runtime error while decoding HDR: " << e.what() << std::endl;
+        mStream.clear();
+        mStream.seekg(mStreamStartPos);
+    }
+    return LinearImage();
+}
+
+bool HDRDecoder::decodeScanlines(ImageDecoder::HeaderCallback const& header,
+        ImageDecoder::ScanlineCallback const& scanline) {
+    try {
+        const Header h = readHeader();
+        const uint32_t width = h.width;
+        const uint32_t height = h.height;
 
-        // Allocate memory to hold one row of decoded pixel data.
+        if (!header(width, height, 3)) {
+            return false;
+        }
+
+        auto emit = [&](uint32_t y, filament::math::float3* row) {
+            if (h.flipX) {
+                std::reverse(row, row + width);
+            }
+            scanline(h.flipY ? height - 1 - y : y, &row[0].x);
+        };
+
+        // Allocate memory to hold one row of encoded and one row of decoded pixel data.
         std::unique_ptr<uint8_t[]> rgbe(new uint8_t[width * 4]);
+        std::unique_ptr<filament::math::float3[]> dst(new filament::math::float3[width]);
 
         // First, test for non-RLE images.
         const auto pos = mStream.tellg();
@@ -390,18 +614,10 @@ LinearImage HDRDecoder::decode() {
 
         if (rgbe[0] != 0x2 || rgbe[1] != 0x2 || (rgbe[2] & 0x80) || width < 8 || width > 32767) {
             for (uint32_t y = 0; y < height; y++) {
-                filament::math::float3* dst = reinterpret_cast<filament::math::float3*>(image.getPixelRef(0, y));
                 mStream.read((char*) rgbe.get(), width * 4);
-                // (rgb/256) * 2^(e-128)
-                size_t pixel = 0;
-                for (size_t x = 0; x < width; x++, pixel += 4) {
-                    if (rgbe[pixel + 3] == 0.0f) {
-                        dst[x] = filament::math::float3{0.0f};
-                    } else {
-                        filament::math::float3 v(rgbe[pixel], rgbe[pixel + 1], rgbe[pixel + 2]);
-                        dst[x] = (v + 0.5f) * std::ldexp(1.0f, rgbe[pixel + 3] - (128 + 8));
-                    }
-                }
+                uint8_t const* p = rgbe.get();
+                convertRGBE(dst.get(), p, p + 1, p + 2, p + 3, 4, width);
+                emit(y, dst.get());
             }
         } else {
             for (uint32_t y = 0; y < height; y++) {
@@ -424,6 +640,9 @@ LinearImage HDRDecoder::decode() {
                         uint8_t rle_count;
                         mStream.read((char*) &rle_count, 1);
                         if (rle_count > 128) {
+                            if (num_bytes + rle_count - 128 > width) {
+                                throw std::runtime_error("invalid run length");
+                            }
                             char v;
                             mStream.read(&v, 1);
                             memset(d, v, size_t(rle_count - 128));
@@ -433,6 +652,9 @@ LinearImage HDRDecoder::decode() {
                             if (rle_count == 0) {
                                 throw std::runtime_error("run length is zero");
                             }
+                            if (num_bytes + rle_count > width) {
+                                throw std::runtime_error("invalid run length");
+                            }
                             mStream.read(d, rle_count);
                             d += rle_count;
                             num_bytes += rle_count;
@@ -440,31 +662,20 @@ LinearImage HDRDecoder::decode() {
                     }
                 }
 
-                uint8_t const* r = &rgbe[0];
-                uint8_t const* g = &rgbe[width];
-                uint8_t const* b = &rgbe[2 * width];
-                uint8_t const* e = &rgbe[3 * width];
-                filament::math::float3* dst = reinterpret_cast<filament::math::float3*>(image.getPixelRef(0, y));
-                // (rgb/256) * 2^(e-128)
-                for (size_t x = 0; x < width; x++, r++, g++, b++, e++) {
-                    if (e[0] == 0.0f) {
-                        dst[x] = filament::math::float3{0.0f};
-                    } else {
-                        filament::math::float3 v(r[0], g[0], b[0]);
-                        dst[x] = (v + 0.5f) * std::ldexp(1.0f, e[0] - (128 + 8));
-                    }
-                }
+                uint8_t const* r = rgbe.get();
+                convertRGBE(dst.get(), r, r + width, r + 2 * width, r + 3 * width, 1, width);
+                emit(y, dst.get());
             }
         }
 
-        return image;
+        return true;
 
     } catch(std::runtime_error& e) {
         // reset the stream, like we found it
         std::cerr << "Runtime error while decoding HDR: " << e.what() << std::endl;
         mStream.seekg(mStreamStartPos);
     }
-    return LinearImage();
+    return false;
 }
 
 // -----------------------------------------------------------------------------------------------
@@ -16,16 +16,108 @@
 
 #include <imageio/ImageDiffer.h>
 
+#include "ProcessRows.h"
+
 #include <image/ColorTransform.h>
 #include <image/ImageOps.h>
 #include <imageio/ImageDecoder.h>
 #include <imageio/ImageEncoder.h>
 #include <utils/Panic.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <fstream>
+#include <mutex>
 
 namespace image {
 
+// Compares a row of pixels. The common channel counts are known at compile time, so that the
+// inner loop is unrolled and vectorized, 0 uses the given count. Returns the number of
+// mismatching pixels.
+template<uint32_t CHANNELS>
+static size_t diffRow(float const* a, float const* b, uint32_t width, uint32_t channels,
+        float epsilon, float* maxDifference, float* heatmap, uint32_t heatmapScale) {
+    const uint32_t n = CHANNELS ? CHANNELS : channels;
+    size_t mismatching = 0;
+    float rowMax = 0.0f;
+    for (uint32_t x = 0; x < width; x++, a += n, b += n) {
+        float d = 0.0f;
+        bool mismatch = false;
+        for (uint32_t c = 0; c < n; c++) {
+            const float e = std::abs(a[c] - b[c]);
+            d = std::max(d, e);
+            mismatch |= !(e <= epsilon); // NaNs never match
+        }
+        mismatching += mismatch;
+        rowMax = std::max(rowMax, d);
+        if (heatmap) {
+            float& texel = heatmap[x / heatmapScale];
+            texel = std::max(texel, d);
+        }
+    }
+    *maxDifference = std::max(*maxDifference, rowMax);
+    return mismatching;
+}
+
+using DiffRowFn = size_t(*)(float const*, float const*, uint32_t, uint32_t, float, float*,
+        float*, uint32_t);
+
+static DiffRowFn getDiffRow(uint32_t channels) {
+    switch (channels) {
+        case 1: return diffRow<1>;
+        case 2: return diffRow<2>;
+        case 3: return diffRow<3>;
+        case 4: return diffRow<4>;
+        default: return diffRow<0>;
+    }
+}
+
+DiffResult diff(const LinearImage& result, const LinearImage& golden, const DiffConfig& config) {
+    DiffResult diffResult;
+    const uint32_t width = result.getWidth();
+    const uint32_t height = result.getHeight();
+    const uint32_t channels = result.getChannels();
+    if (golden.getWidth() != width || golden.getHeight() != height ||
+            golden.getChannels() != channels) {
+        return diffResult;
+    }
+
+    const DiffRowFn diffRowFn = getDiffRow(channels);
+
+    // The bands are aligned to rows of the heatmap, so that no two bands write the same texel.
+    const bool hasHeatmap = config.heatmapScale > 0;
+    uint32_t bandSize = 16;
+    if (hasHeatmap) {
+        const uint32_t scale = config.heatmapScale;
+        diffResult.heatmap = LinearImage((width + scale - 1) / scale,
+                (height + scale - 1) / scale, 1);
+        bandSize = scale * std::max(1u, bandSize / scale);
+    }
+
+    std::atomic<size_t> mismatching = { 0 };
+    std::mutex lock;
+    processRows(height, bandSize, [&](uint32_t first, uint32_t count) {
+        float bandMax = 0.0f;
+        for (uint32_t y = first; y < first + count; y++) {
+            if (!hasHeatmap &&
+                    mismatching.load(std::memory_order_relaxed) > config.maxMismatchingPixels) {
+                break;
+            }
+            float* heatmap = hasHeatmap ?
+                    diffResult.heatmap.getPixelRef(0, y / config.heatmapScale) : nullptr;
+            mismatching += diffRowFn(result.getPixelRef(0, y), golden.getPixelRef(0, y),
+                    width, channels, config.epsilon, &bandMax, heatmap, config.heatmapScale);
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        diffResult.maxDifference = std::max(diffResult.maxDifference, bandMax);
+    });
+
+    diffResult.mismatchingPixels = mismatching;
+    diffResult.match = diffResult.mismatchingPixels <= config.maxMismatchingPixels;
+    return diffResult;
+}
+
 // TODO: Remove special treatment of 1-channel data.
 void updateOrCompare(LinearImage limgResult, const utils::Path& fnameGolden,
         ComparisonMode mode, float epsilon) {
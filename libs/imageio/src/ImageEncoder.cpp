@@ -22,6 +22,7 @@
 #include <functional>
 #include <limits>
 #include <memory>
+#include <vector>
 #include <iostream> // for cerr
 
 #if defined(WIN32)
@@ -56,13 +57,14 @@ public:
         RGB_10_11_11_REV,
     };
 
-    static PNGEncoder* create(std::ostream& stream, PixelFormat format = PixelFormat::sRGB);
+    static PNGEncoder* create(std::ostream& stream, PixelFormat format = PixelFormat::sRGB,
+            const std::string& compression = "");
 
     PNGEncoder(const PNGEncoder&) = delete;
     PNGEncoder& operator=(const PNGEncoder&) = delete;
 
 private:
-    PNGEncoder(std::ostream& stream, PixelFormat format);
+    PNGEncoder(std::ostream& stream, PixelFormat format, const std::string& compression);
     ~PNGEncoder() override;
 
     void init();
@@ -85,6 +87,7 @@ private:
     std::streampos mStreamStartPos;
 
     PixelFormat mFormat;
+    int mCompressionLevel = -1; // zlib level, -1 for libpng's default
 };
 
 // ------------------------------------------------------------------------------------------------
@@ -193,19 +196,21 @@ bool ImageEncoder::encode(std::ostream& stream, Format format, const LinearImage
     std::unique_ptr<Encoder> encoder;
     switch(format) {
         case Format::PNG:
-            encoder.reset(PNGEncoder::create(stream));
+            encoder.reset(PNGEncoder::create(stream, PNGEncoder::PixelFormat::sRGB, compression));
             break;
         case Format::PNG_LINEAR:
-            encoder.reset(PNGEncoder::create(stream, PNGEncoder::PixelFormat::LINEAR_RGB));
+            encoder.reset(PNGEncoder::create(stream, PNGEncoder::PixelFormat::LINEAR_RGB,
+                    compression));
             break;
         case Format::RGB_10_11_11_REV:
-            encoder.reset(PNGEncoder::create(stream, PNGEncoder::PixelFormat::RGB_10_11_11_REV));
+            encoder.reset(PNGEncoder::create(stream, PNGEncoder::PixelFormat::RGB_10_11_11_REV,
+                    compression));
             break;
         case Format::HDR:
             encoder.reset(HDREncoder::create(stream));
             break;
         case Format::RGBM:
-            encoder.reset(PNGEncoder::create(stream, PNGEncoder::PixelFormat::RGBM));
+            encoder.reset(PNGEncoder::create(stream, PNGEncoder::PixelFormat::RGBM, compression));
             break;
         case Format::PSD:
             encoder.reset(PSDEncoder::create(stream, compression));
@@ -273,15 +278,20 @@ std::string ImageEncoder::chooseExtension(ImageEncoder::Format format) {
 
 //-------------------------------------------------------------------------------------------------
 
-PNGEncoder* PNGEncoder::create(std::ostream& stream, PixelFormat format) {
-    PNGEncoder* encoder = new PNGEncoder(stream, format);
+PNGEncoder* PNGEncoder::create(std::ostream& stream, PixelFormat format,
+        const std::string& compression) {
+    PNGEncoder* encoder = new PNGEncoder(stream, format, compression);
     encoder->init();
     return encoder;
 }
 
-PNGEncoder::PNGEncoder(std::ostream& stream, PixelFormat format)
+PNGEncoder::PNGEncoder(std::ostream& stream, PixelFormat format, const std::string& compression)
     : mPNG(png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr)),
       mStream(stream), mStreamStartPos(stream.tellp()), mFormat(format) {
+    // The compression string is the deflate level, anything else keeps the default.
+    if (compression.size() == 1 && compression[0] >= '0' && compression[0] <= '9') {
+        mCompressionLevel = compression[0] - '0';
+    }
 }
 
 PNGEncoder::~PNGEncoder() {
@@ -360,6 +370,10 @@ bool PNGEncoder::encode(const LinearImage& image) {
                      8, colorType, PNG_INTERLACE_NONE,
                      PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
 
+        if (mCompressionLevel >= 0) {
+            png_set_compression_level(mPNG, mCompressionLevel);
+        }
+
         if (mFormat == PixelFormat::LINEAR_RGB || mFormat == PixelFormat::RGB_10_11_11_REV) {
             png_set_gAMA(mPNG, mInfo, 1.0);
         } else {
@@ -1029,13 +1043,11 @@ bool DDSEncoder::encode(const LinearImage& image) {
                 break;
             }
             case DXGI_FORMAT_R16_FLOAT: {
+                std::vector<half> row(width);
                 for (uint32_t y = 0; y < height; y++) {
                     const float* data = image.getPixelRef(0, y);
-                    for (size_t x = 0; x < width; x++) {
-                        half p = half(*data);
-                        mStream.write((const char*) &p, 2);
-                        data++;
-                    }
+                    convertToHalf(row.data(), data, width);
+                    mStream.write((const char*) row.data(), width * sizeof(half));
                 }
                 break;
             }
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef IMAGE_PROCESSROWS_H_
+#define IMAGE_PROCESSROWS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <stdint.h>
+
+namespace image {
+
+// Calls process(firstRow, rowCount) for bands of rows on a pool of threads local to the call.
+// The bands never overlap, so process() can write its rows without synchronization.
+template<typename PROCESS>
+void processRows(uint32_t rowCount, uint32_t bandSize, PROCESS process) {
+    const uint32_t bandCount = (rowCount + bandSize - 1) / bandSize;
+    const uint32_t threadCount = std::min(bandCount,
+            std::max(1u, std::thread::hardware_concurrency()));
+    std::atomic_uint next = { 0 };
+    auto worker = [&]() {
+        for (uint32_t band = next++; band < bandCount; band = next++) {
+            const uint32_t row = band * bandSize;
+            process(row, std::min(bandSize, rowCount - row));
+        }
+    };
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < threadCount; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+} // namespace image
+
+#endif /* IMAGE_PROCESSROWS_H_ */
@@ -46,12 +46,18 @@ public:
     void addMaterial(const utils::CString& name, const void* data, size_t size,
             void* userdata = nullptr);
 
-    using EditCallback = void(*)(void* userdata, const utils::CString& name, const void*, size_t);
+    /**
+     * The edited package and the shader that changed in it, so that the engine only needs to
+     * rebuild the programs that use this shader.
+     */
+    using EditCallback = void(*)(void* userdata, const utils::CString& name, const void*, size_t,
+            backend::ShaderModel shaderModel, uint8_t variant, backend::ShaderType stage);
     using QueryCallback = void(*)(void* userdata, uint64_t* variants);
 
     /**
      * Sets up a callback that allows the Filament engine to listen for shader edits. The callback
-     * might be triggered from a secondary thread.
+     * might be triggered from a secondary thread. It is only triggered by the edits of the
+     * shaders of the backend given to the constructor.
      */
     void setEditCallback(EditCallback callback) { mEditCallback = callback; }
 
@@ -41,7 +41,8 @@ std::string formatVariantString(uint8_t variant, MaterialDomain domain) noexcept
         if (variant & Variant::SHADOW_RECEIVER)       variantString += "SRE|";
         if (variant & Variant::SKINNING_OR_MORPHING)  variantString += "SKN|";
         if (variant & Variant::DEPTH)                 variantString += "DEP|";
-        if (variant & Variant::FOG)                   variantString += "FOG|";
+        if (Variant(variant).hasFog())                variantString += "FOG|";
+        if (Variant(variant).hasPicking())            variantString += "PCK|";
         if (variant & Variant::VSM)                   variantString += "VSM|";
         variantString = variantString.substr(0, variantString.length() - 1);
     }
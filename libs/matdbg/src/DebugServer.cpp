@@ -577,8 +577,11 @@ bool DebugServer::handleEditCommand(const MaterialKey& key, backend::Backend api
     material.package = editor.getEditedPackage();
     material.packageSize = editor.getEditedSize();
 
-    if (mEditCallback) {
-        mEditCallback(material.userdata, material.name, material.package, material.packageSize);
+    // The engine only reads the shaders of its own backend, edits to the others can't change
+    // its programs.
+    if (mEditCallback && api == mBackend) {
+        mEditCallback(material.userdata, material.name, material.package, material.packageSize,
+                info.shaderModel, info.variant, info.pipelineStage);
     }
 
     return true;
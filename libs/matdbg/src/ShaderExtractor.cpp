@@ -63,6 +63,11 @@ ShaderExtractor::ShaderExtractor(Backend backend, const void* data, size_t size)
 
 bool ShaderExtractor::parse() noexcept {
     if (mChunkContainer.parse()) {
+        // text shaders may be stored in a compressed dictionary instead
+        if (mDictionaryTag == ChunkType::DictionaryText &&
+                mChunkContainer.hasChunk(ChunkType::DictionaryTextCompressed)) {
+            mDictionaryTag = ChunkType::DictionaryTextCompressed;
+        }
         return mMaterialChunk.readIndex(mMaterialTag);
     }
     return false;
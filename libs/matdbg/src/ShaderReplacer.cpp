@@ -70,8 +70,8 @@ private:
         uint32_t stringLength;
     };
 
-    void decodeShadersFromIndices();
-    void encodeShadersToIndices();
+    void encodeShaderToIndices(ShaderRecord& record);
+    void updateOffsets();
 
     vector<ShaderRecord> mShaderRecords;
     vector<string> mStringLines;
@@ -108,6 +108,11 @@ bool ShaderReplacer::replaceShaderSource(backend::ShaderModel shaderModel, uint8
     }
 
     ChunkContainer const& cc = mOriginalPackage;
+    if (cc.hasChunk(ChunkType::DictionaryTextCompressed)) {
+        slog.e << "Editing compressed shaders is not yet supported." << io::endl;
+        return false;
+    }
+
     if (!cc.hasChunk(mMaterialTag) || !cc.hasChunk(mDictionaryTag)) {
         return false;
     }
@@ -255,36 +260,59 @@ void ShaderIndex::writeShadersChunk(ChunkType tag, ostream& stream) const {
 
 void ShaderIndex::replaceShader(backend::ShaderModel shaderModel, uint8_t variant,
             backend::ShaderType stage, const char* source, size_t sourceLength) {
-    decodeShadersFromIndices();
+    // The string list only ever grows, so the line indices of the other shaders stay valid and
+    // only the edited shader needs to be encoded again.
     const uint8_t model = (uint8_t) shaderModel;
     for (auto& record : mShaderRecords) {
         if (record.model == model && record.variant == variant && record.stage == stage) {
             record.decodedShaderText = std::string(source, sourceLength);
+            encodeShaderToIndices(record);
             break;
         }
     }
-    encodeShadersToIndices();
+    updateOffsets();
 }
 
-void ShaderIndex::decodeShadersFromIndices() {
-    for (auto& record : mShaderRecords) {
-        record.decodedShaderText.clear();
-        for (uint16_t index : record.lineIndices) {
-            if (index >= mStringLines.size()) {
-                slog.e << "Internal chunk decoding error." << io::endl;
+void ShaderIndex::encodeShaderToIndices(ShaderRecord& record) {
+    robin_map<string, uint16_t> table;
+    for (size_t i = 0; i < mStringLines.size(); i++) {
+        table[mStringLines[i]] = uint16_t(i);
+    }
+
+    record.stringLength = record.decodedShaderText.length() + 1;
+    record.lineIndices.clear();
+
+    const char* const start = record.decodedShaderText.c_str();
+    const size_t length = record.decodedShaderText.length();
+    for (size_t cur = 0; cur < length; cur++) {
+        size_t pos = cur;
+        size_t len = 0;
+        while (start[cur] != '\n' && cur < length) {
+            cur++;
+            len++;
+        }
+        if (pos + len > length) {
+            slog.e << "Internal chunk encoding error." << io::endl;
+            return;
+        }
+        string newLine(start, pos, len);
+        auto iter = table.find(newLine);
+        if (iter == table.end()) {
+            size_t index = mStringLines.size();
+            if (index > UINT16_MAX) {
+                slog.e << "Chunk encoding error: too many unique codelines." << io::endl;
                 return;
             }
-            record.decodedShaderText += mStringLines[index] + "\n";
+            record.lineIndices.push_back(index);
+            table[newLine] = index;
+            mStringLines.push_back(newLine);
+            continue;
         }
+        record.lineIndices.push_back(iter->second);
     }
 }
 
-void ShaderIndex::encodeShadersToIndices() {
-    robin_map<string, uint16_t> table;
-    for (size_t i = 0; i < mStringLines.size(); i++) {
-        table[mStringLines[i]] = uint16_t(i);
-    }
-
+void ShaderIndex::updateOffsets() {
     uint32_t offset = sizeof(uint64_t);
     for (const auto& record : mShaderRecords) {
         offset += sizeof(ShaderRecord::model);
@@ -294,41 +322,9 @@ void ShaderIndex::encodeShadersToIndices() {
     }
 
     for (auto& record : mShaderRecords) {
-        record.stringLength = record.decodedShaderText.length() + 1;
-        record.lineIndices.clear();
         record.offset = offset;
-
         offset += sizeof(ShaderRecord::stringLength);
         offset += sizeof(uint32_t);
-
-        const char* const start = record.decodedShaderText.c_str();
-        const size_t length = record.decodedShaderText.length();
-        for (size_t cur = 0; cur < length; cur++) {
-            size_t pos = cur;
-            size_t len = 0;
-            while (start[cur] != '\n' && cur < length) {
-                cur++;
-                len++;
-            }
-            if (pos + len > length) {
-                slog.e << "Internal chunk encoding error." << io::endl;
-                return;
-            }
-            string newLine(start, pos, len);
-            auto iter = table.find(newLine);
-            if (iter == table.end()) {
-                size_t index = mStringLines.size();
-                if (index > UINT16_MAX) {
-                    slog.e << "Chunk encoding error: too many unique codelines." << io::endl;
-                    return;
-                }
-                record.lineIndices.push_back(index);
-                table[newLine] = index;
-                mStringLines.push_back(newLine);
-                continue;
-            }
-            record.lineIndices.push_back(iter->second);
-        }
         offset += sizeof(uint16_t) * record.lineIndices.size();
     }
 }
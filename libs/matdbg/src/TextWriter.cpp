@@ -109,6 +109,11 @@ static bool printMaterial(ostream& text, const ChunkContainer& container) {
     printChunk<VertexDomain, uint8_t>(text, container, MaterialVertexDomain, "Vertex domain: ");
     printChunk<Interpolation, uint8_t>(text, container, MaterialInterpolation, "Interpolation: ");
     printChunk<bool, bool>(text, container, MaterialShadowMultiplier, "Shadow multiply: ");
+    uint8_t foldedVariants;
+    if (read(container, MaterialFoldedVariants, &foldedVariants)) {
+        text << "    " << setw(alignment) << left << "Folded variants: ";
+        text << formatVariantString(foldedVariants, MaterialDomain::SURFACE) << endl;
+    }
     printChunk<bool, bool>(text, container, MaterialSpecularAntiAliasing, "Specular anti-aliasing: ");
     printFloatChunk(text, container, MaterialSpecularAntiAliasingVariance, "    Variance: ");
     printFloatChunk(text, container, MaterialSpecularAntiAliasingThreshold, "    Threshold: ");
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "PerformanceCounters.h"
+
+#include <benchmark/benchmark.h>
+
+#include <math/batch.h>
+#include <math/mat3.h>
+#include <math/mat4.h>
+#include <math/quat.h>
+
+#include <vector>
+
+using namespace filament::math;
+
+static constexpr size_t COUNT = 1024;
+
+static std::vector<mat4f> makeMatrices(float seed) noexcept {
+    std::vector<mat4f> m(COUNT);
+    for (size_t i = 0; i < COUNT; i++) {
+        m[i] = mat4f::rotation(seed + float(i), float3{ 0, 1, 0 }) *
+                mat4f::translation(float3{ float(i), seed, 1.0f });
+    }
+    return m;
+}
+
+static void BM_mulMat4Scalar(benchmark::State& state) noexcept {
+    std::vector<mat4f> a = makeMatrices(1.0f), b = makeMatrices(2.0f), out(COUNT);
+    PerformanceCounters pc(state);
+    for (auto _ : state) {
+        for (size_t i = 0; i < COUNT; i++) {
+            out[i] = a[i] * b[i];
+        }
+        benchmark::ClobberMemory();
+    }
+    pc.stop();
+    state.SetItemsProcessed(state.iterations() * COUNT);
+}
+
+static void BM_mulMat4Array(benchmark::State& state) noexcept {
+    std::vector<mat4f> a = makeMatrices(1.0f), b = makeMatrices(2.0f), out(COUNT);
+    PerformanceCounters pc(state);
+    for (auto _ : state) {
+        mulMat4Array(out.data(), a.data(), b.data(), COUNT);
+        benchmark::ClobberMemory();
+    }
+    pc.stop();
+    state.SetItemsProcessed(state.iterations() * COUNT);
+}
+
+static void BM_transformBoxesScalar(benchmark::State& state) noexcept {
+    std::vector<mat4f> m = makeMatrices(1.0f);
+    std::vector<float3> c(COUNT, float3{ 1, 2, 3 }), e(COUNT, float3{ 0.5f });
+    std::vector<float3> oc(COUNT), oe(COUNT);
+    PerformanceCounters pc(state);
+    for (auto _ : state) {
+        for (size_t i = 0; i < COUNT; i++) {
+            const mat3f u(m[i].upperLeft());
+            oc[i] = u * c[i] + m[i][3].xyz;
+            oe[i] = abs(u) * e[i];
+        }
+        benchmark::ClobberMemory();
+    }
+    pc.stop();
+    state.SetItemsProcessed(state.iterations() * COUNT);
+}
+
+static void BM_transformBoxes(benchmark::State& state) noexcept {
+    std::vector<mat4f> m = makeMatrices(1.0f);
+    std::vector<float3> c(COUNT, float3{ 1, 2, 3 }), e(COUNT, float3{ 0.5f });
+    std::vector<float3> oc(COUNT), oe(COUNT);
+    PerformanceCounters pc(state);
+    for (auto _ : state) {
+        transformBoxes(oc.data(), oe.data(), c.data(), e.data(), m.data(), COUNT);
+        benchmark::ClobberMemory();
+    }
+    pc.stop();
+    state.SetItemsProcessed(state.iterations() * COUNT);
+}
+
+static void BM_quatSlerpArray(benchmark::State& state) noexcept {
+    std::vector<quatf> a(COUNT), b(COUNT), out(COUNT);
+    std::vector<float> t(COUNT);
+    for (size_t i = 0; i < COUNT; i++) {
+        a[i] = quatf::fromAxisAngle(float3{ 0, 1, 0 }, float(i) * 0.01f);
+        b[i] = quatf::fromAxisAngle(float3{ 1, 0, 0 }, float(i) * 0.02f);
+        t[i] = float(i) / COUNT;
+    }
+    PerformanceCounters pc(state);
+    for (auto _ : state) {
+        quatSlerpArray(out.data(), a.data(), b.data(), t.data(), COUNT);
+        benchmark::ClobberMemory();
+    }
+    pc.stop();
+    state.SetItemsProcessed(state.iterations() * COUNT);
+}
+
+BENCHMARK(BM_mulMat4Scalar);
+BENCHMARK(BM_mulMat4Array);
+BENCHMARK(BM_transformBoxesScalar);
+BENCHMARK(BM_transformBoxes);
+BENCHMARK(BM_quatSlerpArray);
@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MATH_BATCH_H_
+#define MATH_BATCH_H_
+
+#include <math/mat4.h>
+#include <math/quat.h>
+#include <math/vec3.h>
+#include <math/vec4.h>
+
+#include <stddef.h>
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#   include <arm_neon.h>
+#   define MATH_BATCH_USE_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#   if defined(__AVX__)
+#       include <immintrin.h>
+#       define MATH_BATCH_USE_AVX 1
+#   else
+#       include <emmintrin.h>
+#   endif
+#   define MATH_BATCH_USE_SSE 1
+#endif
+
+/*
+ * Kernels operating on arrays of matrices, boxes and quaternions.
+ *
+ * These compute the same results as the equivalent loops written with mat4f and quatf, but
+ * use NEON (ARMv8), AVX or SSE explicitly where available. Unless noted otherwise, the output
+ * array may be the same as one of the input arrays, but must not partially overlap them.
+ */
+
+namespace filament {
+namespace math {
+
+namespace details {
+
+#if defined(MATH_BATCH_USE_NEON)
+
+inline void mul(float* out, float const* a, float const* b) noexcept {
+    float32x4_t const a0 = vld1q_f32(a + 0);
+    float32x4_t const a1 = vld1q_f32(a + 4);
+    float32x4_t const a2 = vld1q_f32(a + 8);
+    float32x4_t const a3 = vld1q_f32(a + 12);
+    float32x4_t const b0 = vld1q_f32(b + 0);
+    float32x4_t const b1 = vld1q_f32(b + 4);
+    float32x4_t const b2 = vld1q_f32(b + 8);
+    float32x4_t const b3 = vld1q_f32(b + 12);
+    float32x4_t r[4];
+    float32x4_t const cols[4] = { b0, b1, b2, b3 };
+    for (size_t j = 0; j < 4; j++) {
+        float32x4_t c = vmulq_laneq_f32(a0, cols[j], 0);
+        c = vfmaq_laneq_f32(c, a1, cols[j], 1);
+        c = vfmaq_laneq_f32(c, a2, cols[j], 2);
+        c = vfmaq_laneq_f32(c, a3, cols[j], 3);
+        r[j] = c;
+    }
+    vst1q_f32(out + 0, r[0]);
+    vst1q_f32(out + 4, r[1]);
+    vst1q_f32(out + 8, r[2]);
+    vst1q_f32(out + 12, r[3]);
+}
+
+// returns { m * center, abs(m) * halfExtent } for the upper 3x4 of m
+inline void transformBox(float3& outCenter, float3& outHalfExtent,
+        float const* m, float3 const& c, float3 const& e) noexcept {
+    float32x4_t const m0 = vld1q_f32(m + 0);
+    float32x4_t const m1 = vld1q_f32(m + 4);
+    float32x4_t const m2 = vld1q_f32(m + 8);
+    float32x4_t const m3 = vld1q_f32(m + 12);
+    float32x4_t center = vfmaq_n_f32(m3, m0, c.x);
+    center = vfmaq_n_f32(center, m1, c.y);
+    center = vfmaq_n_f32(center, m2, c.z);
+    float32x4_t extent = vmulq_n_f32(vabsq_f32(m0), e.x);
+    extent = vfmaq_n_f32(extent, vabsq_f32(m1), e.y);
+    extent = vfmaq_n_f32(extent, vabsq_f32(m2), e.z);
+    outCenter = { vgetq_lane_f32(center, 0), vgetq_lane_f32(center, 1),
+                  vgetq_lane_f32(center, 2) };
+    outHalfExtent = { vgetq_lane_f32(extent, 0), vgetq_lane_f32(extent, 1),
+                      vgetq_lane_f32(extent, 2) };
+}
+
+#elif defined(MATH_BATCH_USE_SSE)
+
+inline __m128 mulColumn(__m128 a0, __m128 a1, __m128 a2, __m128 a3, __m128 b) noexcept {
+    __m128 c = _mm_mul_ps(a0, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
+    c = _mm_add_ps(c, _mm_mul_ps(a1, _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1))));
+    c = _mm_add_ps(c, _mm_mul_ps(a2, _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2))));
+    c = _mm_add_ps(c, _mm_mul_ps(a3, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3))));
+    return c;
+}
+
+inline void mul(float* out, float const* a, float const* b) noexcept {
+#if defined(MATH_BATCH_USE_AVX)
+    // two columns at a time: each 128-bits lane holds one column of b
+    __m256 const a0 = _mm256_broadcast_ps((__m128 const*)(a + 0));
+    __m256 const a1 = _mm256_broadcast_ps((__m128 const*)(a + 4));
+    __m256 const a2 = _mm256_broadcast_ps((__m128 const*)(a + 8));
+    __m256 const a3 = _mm256_broadcast_ps((__m128 const*)(a + 12));
+    __m256 const b01 = _mm256_loadu_ps(b + 0);
+    __m256 const b23 = _mm256_loadu_ps(b + 8);
+    auto column = [&](__m256 b) {
+        __m256 c = _mm256_mul_ps(a0, _mm256_permute_ps(b, _MM_SHUFFLE(0, 0, 0, 0)));
+        c = _mm256_add_ps(c, _mm256_mul_ps(a1, _mm256_permute_ps(b, _MM_SHUFFLE(1, 1, 1, 1))));
+        c = _mm256_add_ps(c, _mm256_mul_ps(a2, _mm256_permute_ps(b, _MM_SHUFFLE(2, 2, 2, 2))));
+        c = _mm256_add_ps(c, _mm256_mul_ps(a3, _mm256_permute_ps(b, _MM_SHUFFLE(3, 3, 3, 3))));
+        return c;
+    };
+    __m256 const r01 = column(b01);
+    __m256 const r23 = column(b23);
+    _mm256_storeu_ps(out + 0, r01);
+    _mm256_storeu_ps(out + 8, r23);
+#else
+    __m128 const a0 = _mm_loadu_ps(a + 0);
+    __m128 const a1 = _mm_loadu_ps(a + 4);
+    __m128 const a2 = _mm_loadu_ps(a + 8);
+    __m128 const a3 = _mm_loadu_ps(a + 12);
+    __m128 const r0 = mulColumn(a0, a1, a2, a3, _mm_loadu_ps(b + 0));
+    __m128 const r1 = mulColumn(a0, a1, a2, a3, _mm_loadu_ps(b + 4));
+    __m128 const r2 = mulColumn(a0, a1, a2, a3, _mm_loadu_ps(b + 8));
+    __m128 const r3 = mulColumn(a0, a1, a2, a3, _mm_loadu_ps(b + 12));
+    _mm_storeu_ps(out + 0, r0);
+    _mm_storeu_ps(out + 4, r1);
+    _mm_storeu_ps(out + 8, r2);
+    _mm_storeu_ps(out + 12, r3);
+#endif
+}
+
+// returns { m * center, abs(m) * halfExtent } for the upper 3x4 of m
+inline void transformBox(float3& outCenter, float3& outHalfExtent,
+        float const* m, float3 const& c, float3 const& e) noexcept {
+    __m128 const signMask = _mm_set1_ps(-0.0f);
+    __m128 const m0 = _mm_loadu_ps(m + 0);
+    __m128 const m1 = _mm_loadu_ps(m + 4);
+    __m128 const m2 = _mm_loadu_ps(m + 8);
+    __m128 const m3 = _mm_loadu_ps(m + 12);
+    __m128 center = _mm_add_ps(m3, _mm_mul_ps(m0, _mm_set1_ps(c.x)));
+    center = _mm_add_ps(center, _mm_mul_ps(m1, _mm_set1_ps(c.y)));
+    center = _mm_add_ps(center, _mm_mul_ps(m2, _mm_set1_ps(c.z)));
+    __m128 extent = _mm_mul_ps(_mm_andnot_ps(signMask, m0), _mm_set1_ps(e.x));
+    extent = _mm_add_ps(extent, _mm_mul_ps(_mm_andnot_ps(signMask, m1), _mm_set1_ps(e.y)));
+    extent = _mm_add_ps(extent, _mm_mul_ps(_mm_andnot_ps(signMask, m2), _mm_set1_ps(e.z)));
+    float4 tc, te;
+    _mm_storeu_ps(&tc.x, center);
+    _mm_storeu_ps(&te.x, extent);
+    outCenter = tc.xyz;
+    outHalfExtent = te.xyz;
+}
+
+#else
+
+inline void mul(float* out, float const* a, float const* b) noexcept {
+    mat4f const& lhs = *reinterpret_cast<mat4f const*>(a);
+    mat4f const& rhs = *reinterpret_cast<mat4f const*>(b);
+    *reinterpret_cast<mat4f*>(out) = lhs * rhs;
+}
+
+inline void transformBox(float3& outCenter, float3& outHalfExtent,
+        float const* m, float3 const& c, float3 const& e) noexcept {
+    mat4f const& t = *reinterpret_cast<mat4f const*>(m);
+    mat3f const u(t.upperLeft());
+    float3 const center = u * c + t[3].xyz;
+    float3 const extent = abs(u) * e;
+    outCenter = center;
+    outHalfExtent = extent;
+}
+
+#endif
+
+} // namespace details
+
+/**
+ * Multiplies a single matrix by another one, out = lhs * rhs.
+ * out may be the same as lhs or rhs.
+ */
+inline void mulMat4(mat4f& out, mat4f const& lhs, mat4f const& rhs) noexcept {
+    details::mul(&out[0].x, &lhs[0].x, &rhs[0].x);
+}
+
+/**
+ * Multiplies two arrays of matrices element-wise, out[i] = lhs[i] * rhs[i].
+ */
+inline void mulMat4Array(mat4f* out, mat4f const* lhs, mat4f const* rhs, size_t count) noexcept {
+    for (size_t i = 0; i < count; i++) {
+        details::mul(&out[i][0].x, &lhs[i][0].x, &rhs[i][0].x);
+    }
+}
+
+/**
+ * Pre-multiplies an array of matrices by a single one, out[i] = lhs * rhs[i].
+ */
+inline void mulMat4Array(mat4f* out, mat4f const& lhs, mat4f const* rhs, size_t count) noexcept {
+    // lhs might alias out
+    mat4f const m(lhs);
+    for (size_t i = 0; i < count; i++) {
+        details::mul(&out[i][0].x, &m[0].x, &rhs[i][0].x);
+    }
+}
+
+/**
+ * Transforms an array of boxes, given by their center and half-extent, by the rigid transform
+ * of the same index. This is the same as filament's rigidTransform(Box, mat4f):
+ *  outCenter[i] = upperLeft(transforms[i]) * center[i] + transforms[i][3].xyz
+ *  outHalfExtent[i] = abs(upperLeft(transforms[i])) * halfExtent[i]
+ */
+inline void transformBoxes(float3* outCenter, float3* outHalfExtent,
+        float3 const* center, float3 const* halfExtent,
+        mat4f const* transforms, size_t count) noexcept {
+    for (size_t i = 0; i < count; i++) {
+        details::transformBox(outCenter[i], outHalfExtent[i],
+                &transforms[i][0].x, center[i], halfExtent[i]);
+    }
+}
+
+/**
+ * Spherical interpolation of two arrays of quaternions, out[i] = slerp(a[i], b[i], t[i]).
+ * There is no explicit SIMD version of this kernel, the transcendental functions dominate
+ * its cost.
+ */
+inline void quatSlerpArray(quatf* out, quatf const* a, quatf const* b, float const* t,
+        size_t count) noexcept {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = slerp(a[i], b[i], t[i]);
+    }
+}
+
+} // namespace math
+} // namespace filament
+
+#endif // MATH_BATCH_H_
@@ -25,6 +25,17 @@
 
 #include <math/compiler.h>
 
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#   include <arm_neon.h>
+#   define MATH_HALF_USE_NEON 1
+#elif defined(__F16C__)
+#   include <immintrin.h>
+#   define MATH_HALF_USE_F16C 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#   include <emmintrin.h>
+#   define MATH_HALF_USE_SSE2 1
+#endif
+
 namespace filament {
 namespace math {
 
@@ -166,6 +177,107 @@ inline constexpr half operator "" _h(long double v) {
 
 template<> struct is_arithmetic<filament::math::half> : public std::true_type {};
 
+/*
+ * Bulk conversions between float and half.
+ *
+ * These use the hardware conversion instructions on ARMv8 and on x86 with F16C, and a SSE2
+ * version of the fp<> bit manipulations otherwise, which gives the same results as half(float)
+ * and float(half). out and in must not overlap.
+ */
+
+inline void convertToHalf(half* out, float const* in, size_t count) noexcept {
+    size_t i = 0;
+#if defined(MATH_HALF_USE_NEON)
+    for (; i + 4 <= count; i += 4) {
+        vst1_f16(out + i, vcvt_f16_f32(vld1q_f32(in + i)));
+    }
+#elif defined(MATH_HALF_USE_F16C)
+    for (; i + 8 <= count; i += 8) {
+        __m256 const f = _mm256_loadu_ps(in + i);
+        _mm_storeu_si128((__m128i*)(out + i), _mm256_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT));
+    }
+#elif defined(MATH_HALF_USE_SSE2)
+    // this is fp<1, 5, 10>::fromf() on 4 floats at a time
+    __m128i const signMask = _mm_set1_epi32(int(0x80000000u));
+    __m128i const expMask = _mm_set1_epi32(0x7F800000);
+    __m128i const mantissaMask = _mm_set1_epi32(0x007FFFFF);
+    __m128i const infinity = _mm_set1_epi32(31 << 23);
+    __m128 const magic = _mm_castsi128_ps(_mm_set1_epi32(15 << 23));
+    for (; i + 8 <= count; i += 8) {
+        __m128i h[2];
+        for (size_t k = 0; k < 2; k++) {
+            __m128i bits = _mm_castps_si128(_mm_loadu_ps(in + i + k * 4));
+            __m128i const sign = _mm_and_si128(bits, signMask);
+            bits = _mm_xor_si128(bits, sign);
+
+            // inf or nan
+            __m128i const isInfNan = _mm_cmpeq_epi32(_mm_and_si128(bits, expMask), expMask);
+            __m128i const isNan = _mm_andnot_si128(
+                    _mm_cmpeq_epi32(_mm_and_si128(bits, mantissaMask), _mm_setzero_si128()),
+                    isInfNan);
+            __m128i const infNan = _mm_or_si128(_mm_set1_epi32(0x7C00),
+                    _mm_and_si128(isNan, _mm_set1_epi32(0x200)));
+
+            // finite values
+            __m128i f = _mm_and_si128(bits, _mm_set1_epi32(~((1 << 12) - 1)));
+            f = _mm_add_epi32(f, _mm_set1_epi32(1 << 12));
+            f = _mm_castps_si128(_mm_mul_ps(_mm_castsi128_ps(f), magic));
+            __m128i const overflow = _mm_cmpgt_epi32(f, infinity);
+            f = _mm_or_si128(_mm_and_si128(overflow, infinity), _mm_andnot_si128(overflow, f));
+            f = _mm_srli_epi32(f, 13);
+
+            __m128i r = _mm_or_si128(_mm_and_si128(isInfNan, infNan),
+                    _mm_andnot_si128(isInfNan, f));
+            r = _mm_or_si128(r, _mm_srli_epi32(sign, 16));
+            // sign-extend so the signed saturating pack below doesn't clamp
+            h[k] = _mm_srai_epi32(_mm_slli_epi32(r, 16), 16);
+        }
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(h[0], h[1]));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = half(in[i]);
+    }
+}
+
+inline void convertToFloat(float* out, half const* in, size_t count) noexcept {
+    size_t i = 0;
+#if defined(MATH_HALF_USE_NEON)
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(out + i, vcvt_f32_f16(vld1_f16(in + i)));
+    }
+#elif defined(MATH_HALF_USE_F16C)
+    for (; i + 8 <= count; i += 8) {
+        __m128i const h = _mm_loadu_si128((__m128i const*)(in + i));
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+    }
+#elif defined(MATH_HALF_USE_SSE2)
+    // this is fp<1, 5, 10>::tof() on 4 halfs at a time
+    __m128 const magic = _mm_castsi128_ps(_mm_set1_epi32((0xFE - 15) << 23));
+    __m128 const infNan = _mm_castsi128_ps(_mm_set1_epi32((0x80 + 15) << 23));
+    for (; i + 8 <= count; i += 8) {
+        __m128i const h = _mm_loadu_si128((__m128i const*)(in + i));
+        __m128i const halves[2] = {
+                _mm_unpacklo_epi16(h, _mm_setzero_si128()),
+                _mm_unpackhi_epi16(h, _mm_setzero_si128()) };
+        for (size_t k = 0; k < 2; k++) {
+            __m128i const bits = halves[k];
+            __m128 f = _mm_castsi128_ps(
+                    _mm_slli_epi32(_mm_and_si128(bits, _mm_set1_epi32(0x7FFF)), 13));
+            f = _mm_mul_ps(f, magic);
+            __m128 const isInfNan = _mm_cmpge_ps(f, infNan);
+            f = _mm_or_ps(f, _mm_and_ps(isInfNan, _mm_castsi128_ps(_mm_set1_epi32(0xFF << 23))));
+            f = _mm_or_ps(f, _mm_castsi128_ps(
+                    _mm_slli_epi32(_mm_and_si128(bits, _mm_set1_epi32(0x8000)), 16)));
+            _mm_storeu_ps(out + i + k * 4, f);
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = float(in[i]);
+    }
+}
+
 } // namespace math
 } // namespace filament
 
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <math/batch.h>
+#include <math/mat3.h>
+#include <math/mat4.h>
+#include <math/quat.h>
+
+using namespace filament::math;
+
+class BatchTest : public testing::Test {
+protected:
+    void SetUp() override {
+        std::uniform_real_distribution<float> dist(-2.0f, 2.0f);
+        for (size_t i = 0; i < COUNT; i++) {
+            mat4f a, b;
+            for (size_t c = 0; c < 4; c++) {
+                for (size_t r = 0; r < 4; r++) {
+                    a[c][r] = dist(mRng);
+                    b[c][r] = dist(mRng);
+                }
+            }
+            lhs.push_back(a);
+            rhs.push_back(b);
+        }
+    }
+
+    static void expectNear(mat4f const& a, mat4f const& b) {
+        for (size_t c = 0; c < 4; c++) {
+            for (size_t r = 0; r < 4; r++) {
+                EXPECT_NEAR(a[c][r], b[c][r], 1e-4f);
+            }
+        }
+    }
+
+    static constexpr size_t COUNT = 37;
+    std::default_random_engine mRng;
+    std::vector<mat4f> lhs;
+    std::vector<mat4f> rhs;
+};
+
+TEST_F(BatchTest, MulMat4Array) {
+    std::vector<mat4f> out(COUNT);
+    mulMat4Array(out.data(), lhs.data(), rhs.data(), COUNT);
+    for (size_t i = 0; i < COUNT; i++) {
+        expectNear(out[i], lhs[i] * rhs[i]);
+    }
+
+    mulMat4Array(out.data(), lhs[0], rhs.data(), COUNT);
+    for (size_t i = 0; i < COUNT; i++) {
+        expectNear(out[i], lhs[0] * rhs[i]);
+    }
+
+    // in place
+    std::vector<mat4f> inPlace(lhs);
+    mulMat4Array(inPlace.data(), inPlace.data(), rhs.data(), COUNT);
+    for (size_t i = 0; i < COUNT; i++) {
+        expectNear(inPlace[i], lhs[i] * rhs[i]);
+    }
+
+    mat4f m = lhs[1];
+    mulMat4(m, m, rhs[1]);
+    expectNear(m, lhs[1] * rhs[1]);
+}
+
+TEST_F(BatchTest, TransformBoxes) {
+    std::vector<float3> center(COUNT), extent(COUNT);
+    for (size_t i = 0; i < COUNT; i++) {
+        center[i] = lhs[i][0].xyz;
+        extent[i] = abs(lhs[i][1].xyz);
+    }
+
+    std::vector<float3> outCenter(COUNT), outExtent(COUNT);
+    transformBoxes(outCenter.data(), outExtent.data(),
+            center.data(), extent.data(), rhs.data(), COUNT);
+
+    for (size_t i = 0; i < COUNT; i++) {
+        mat3f const u(rhs[i].upperLeft());
+        float3 const c = u * center[i] + rhs[i][3].xyz;
+        float3 const e = abs(u) * extent[i];
+        for (size_t k = 0; k < 3; k++) {
+            EXPECT_NEAR(outCenter[i][k], c[k], 1e-4f);
+            EXPECT_NEAR(outExtent[i][k], e[k], 1e-4f);
+        }
+    }
+
+    // in place
+    transformBoxes(center.data(), extent.data(), center.data(), extent.data(), rhs.data(), COUNT);
+    for (size_t i = 0; i < COUNT; i++) {
+        for (size_t k = 0; k < 3; k++) {
+            EXPECT_EQ(center[i][k], outCenter[i][k]);
+            EXPECT_EQ(extent[i][k], outExtent[i][k]);
+        }
+    }
+}
+
+TEST_F(BatchTest, QuatSlerpArray) {
+    std::vector<quatf> a(COUNT), b(COUNT), out(COUNT);
+    std::vector<float> t(COUNT);
+    for (size_t i = 0; i < COUNT; i++) {
+        a[i] = normalize(quatf(lhs[i][0].x, lhs[i][0].y, lhs[i][0].z, lhs[i][0].w));
+        b[i] = normalize(quatf(rhs[i][0].x, rhs[i][0].y, rhs[i][0].z, rhs[i][0].w));
+        t[i] = float(i) / COUNT;
+    }
+    quatSlerpArray(out.data(), a.data(), b.data(), t.data(), COUNT);
+    for (size_t i = 0; i < COUNT; i++) {
+        quatf const expected = slerp(a[i], b[i], t[i]);
+        EXPECT_EQ(out[i].xyzw, expected.xyzw);
+    }
+}
@@ -16,6 +16,10 @@
 
 #include <math.h>
 
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include <math/half.h>
@@ -111,4 +115,59 @@ TEST_F(HalfTest, fp11) {
         fp11 h = fp11::fromf(float(i));
         EXPECT_EQ(i, fp11::tof(h));
     }
-}
\ No newline at end of file
+}
+TEST_F(HalfTest, BulkToFloat) {
+    // every half, plus a tail that isn't a multiple of the SIMD width
+    std::vector<half> in(65536 + 3);
+    for (size_t i = 0; i < in.size(); i++) {
+        in[i] = makeHalf(uint16_t(i));
+    }
+    std::vector<float> out(in.size());
+    convertToFloat(out.data(), in.data(), in.size());
+    for (size_t i = 0; i < in.size(); i++) {
+        float const expected = float(in[i]);
+#if defined(MATH_HALF_USE_NEON) || defined(MATH_HALF_USE_F16C)
+        // the hardware doesn't flush denormals to zero
+        if ((i & 0x7C00u) == 0 && (i & 0x3FFu) != 0) {
+            EXPECT_LT(std::abs(out[i]), 6.10352e-5f);
+            continue;
+        }
+#endif
+        if (std::isnan(expected)) {
+            EXPECT_TRUE(std::isnan(out[i]));
+        } else {
+            EXPECT_EQ(expected, out[i]) << "half bits 0x" << std::hex << i;
+        }
+    }
+}
+
+TEST_F(HalfTest, BulkToHalf) {
+    std::vector<float> in;
+    for (float f = 1e-8f; f < 1e6f; f *= 1.001f) {
+        in.push_back(f);
+        in.push_back(-f);
+    }
+    in.push_back(0.0f);
+    in.push_back(-0.0f);
+    in.push_back(std::numeric_limits<float>::infinity());
+    in.push_back(-std::numeric_limits<float>::infinity());
+    in.push_back(NAN);
+
+    std::vector<half> out(in.size());
+    convertToHalf(out.data(), in.data(), in.size());
+    for (size_t i = 0; i < in.size(); i++) {
+        int const expected = getBits(half(in[i]));
+        int const actual = getBits(out[i]);
+#if defined(MATH_HALF_USE_NEON) || defined(MATH_HALF_USE_F16C)
+        // the hardware handles denormals exactly
+        if (std::abs(in[i]) < 6.10352e-5f) {
+            EXPECT_LE(actual & 0x7FFF, 0x400) << in[i];
+            continue;
+        }
+        // and rounds ties to even
+        EXPECT_LE(std::abs(expected - actual), 1) << in[i];
+#else
+        EXPECT_EQ(expected, actual) << in[i];
+#endif
+    }
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_TERRAIN_TERRAINQUADTREE_H
+#define TNT_TERRAIN_TERRAINQUADTREE_H
+
+#include <math/mat4.h>
+#include <math/vec2.h>
+#include <math/vec3.h>
+
+#include <utils/compiler.h>
+
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace utils {
+class JobSystem;
+} // namespace utils
+
+namespace filament {
+
+/**
+ * Terrain rendering utilities.
+ */
+namespace terrain {
+
+struct TerrainBuilderImpl;
+struct TerrainImpl;
+
+/**
+ * Selects the tiles of a height map terrain with continuous distance-dependent level of detail
+ * (CDLOD, after Filip Strugar's "Continuous Distance-Dependent Level of Detail for Rendering
+ * Heightmaps").
+ *
+ * The terrain is a grid of square root tiles, each the root of a quadtree whose leaves are the
+ * tiles of the finest level. Every frame, select() walks the quadtrees from the camera and returns
+ * the tiles to draw, so that the number of tiles depends on the number of levels and on the view,
+ * not on the size of the height map.
+ *
+ * All the tiles are drawn with the same grid mesh, see generateGrid(), for instance as instances
+ * of a single renderable. The vertex shader scales and offsets the grid, samples the height
+ * texture, and morphs the vertices towards the coarser level as the distance to the camera
+ * approaches the end of the tile's range, so that there are no cracks between tiles of different
+ * levels and no popping when a tile changes level:
+ *
+ *     // p is the grid position in [0, 1]^2 and N the grid resolution
+ *     vec2 xz = tile.origin + p * tile.size;
+ *     float d = distance(cameraPosition, vec3(xz.x, height(xz), xz.y));
+ *     float k = clamp((d - tile.morphStart) / (tile.morphEnd - tile.morphStart), 0.0, 1.0);
+ *     p -= fract(p * N * 0.5) * 2.0 / N * k;
+ *     xz = tile.origin + p * tile.size;
+ *     vec3 position = vec3(xz.x, height(xz), xz.y);
+ */
+class UTILS_PUBLIC TerrainQuadTree {
+public:
+
+    /**
+     * A tile to draw, i.e. some quadrants of a node of a quadtree.
+     */
+    struct Tile {
+        math::float2 origin;    // world x and z of the corner with the smallest coordinates
+        float size;             // world size of the side of the tile
+        float morphStart;       // distance to the camera where the morph to the next level starts
+        float morphEnd;         // distance to the camera where the morph is complete
+        uint8_t level;          // level of detail, 0 is the finest
+        uint8_t quadrants;      // bit i set if quadrant i is drawn, see generateGrid()
+    };
+
+    /**
+     * The Builder is used to construct an immutable quadtree.
+     *
+     * Clients must supply the extent of the terrain and the size of the tiles of the finest level.
+     * The range of heights bounds the tiles for culling and for the choice of their level, the
+     * optional per-tile height bounds make these tighter.
+     */
+    class Builder {
+    public:
+        Builder() noexcept;
+        ~Builder() noexcept;
+        Builder(Builder&& that) noexcept;
+        Builder& operator=(Builder&& that) noexcept;
+
+        /**
+         * World x and z of the corner of the terrain with the smallest coordinates, and the size
+         * of the terrain along x and z. This attribute is required.
+         */
+        Builder& extent(math::float2 origin, math::float2 size) noexcept;
+
+        /**
+         * World size of the side of the tiles of the finest level. The tiles of each coarser
+         * level are twice as large. This attribute is required.
+         */
+        Builder& tileSize(float size) noexcept;
+
+        /**
+         * Number of levels of detail, between 1 and 16. Defaults to 8.
+         */
+        Builder& levels(size_t count) noexcept;
+
+        /**
+         * Distance to the camera up to which the finest level is used, each coarser level is used
+         * up to twice the distance of the previous one. The coarsest level is used beyond that.
+         * Defaults to 4 times the tile size. Values below twice the diagonal of a tile can make
+         * adjacent tiles differ by more than one level, which the morph can't hide.
+         */
+        Builder& lodDistance(float distance) noexcept;
+
+        /**
+         * Fraction of the range of each level over which its tiles morph to the next level,
+         * between 0 and 1. Defaults to 0.3.
+         */
+        Builder& morphRange(float fraction) noexcept;
+
+        /**
+         * Minimum and maximum heights of the terrain. Defaults to [0, 0].
+         */
+        Builder& heightRange(float minHeight, float maxHeight) noexcept;
+
+        /**
+         * Minimum and maximum heights of each tile of the finest level, row by row along x,
+         * starting at the origin of the terrain. Tiles not covered by the given array use the
+         * height range. The data is consumed synchronously during build().
+         */
+        Builder& heightBounds(math::float2 const* minMax, size_t width, size_t height) noexcept;
+
+        /**
+         * Optional job system used to process the root tiles concurrently in select(). When set,
+         * select() must be called from a thread known to the job system (e.g. a job or a thread
+         * that called adopt()). The result is identical with or without it.
+         */
+        Builder& jobSystem(utils::JobSystem* js) noexcept;
+
+        /**
+         * Builds the quadtree or returns null if the extent or the tile size are missing.
+         */
+        TerrainQuadTree* build();
+
+    private:
+        TerrainBuilderImpl* mImpl;
+        Builder(const Builder&) = delete;
+        Builder& operator=(const Builder&) = delete;
+    };
+
+    ~TerrainQuadTree() noexcept;
+    TerrainQuadTree(TerrainQuadTree&& that) noexcept;
+    TerrainQuadTree& operator=(TerrainQuadTree&& that) noexcept;
+
+    /**
+     * Returns the number of levels of detail.
+     */
+    size_t getLevelCount() const noexcept;
+
+    /**
+     * Replaces the content of the given vector with the tiles to draw for a camera at the given
+     * position, culled against the frustum of the given view-projection matrix. The tiles are
+     * grouped by root tile.
+     */
+    void select(math::float3 const& eye, math::mat4f const& viewProjection,
+            std::vector<Tile>& tiles) const;
+
+    /**
+     * Generates the grid mesh shared by all the tiles, with (resolution + 1)^2 vertices in
+     * [0, 1]^2 and 2 * resolution^2 triangles. The triangles are sorted by quadrant, quadrant i
+     * covering a quarter of the indices starting at i * indices.size() / 4, with quadrants 0 to 3
+     * at (0, 0), (0.5, 0), (0, 0.5) and (0.5, 0.5). The resolution is rounded up to an even
+     * number and clamped to 254 so that the indices fit 16 bits.
+     */
+    static void generateGrid(size_t resolution, std::vector<math::float2>& positions,
+            std::vector<uint16_t>& indices);
+
+private:
+    TerrainQuadTree(TerrainImpl*) noexcept;
+    TerrainQuadTree(const TerrainQuadTree&) = delete;
+    TerrainQuadTree& operator=(const TerrainQuadTree&) = delete;
+    TerrainImpl* mImpl;
+    friend struct TerrainBuilderImpl;
+};
+
+} // namespace terrain
+} // namespace filament
+
+#endif // TNT_TERRAIN_TERRAINQUADTREE_H
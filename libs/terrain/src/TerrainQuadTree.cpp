@@ -0,0 +1,381 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <terrain/TerrainQuadTree.h>
+
+#include <utils/JobSystem.h>
+
+#include <math/vec4.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace filament {
+namespace terrain {
+
+using namespace filament::math;
+using std::vector;
+using Builder = TerrainQuadTree::Builder;
+using Tile = TerrainQuadTree::Tile;
+
+static constexpr size_t MAX_LEVEL_COUNT = 16;
+
+struct TerrainBuilderImpl {
+    float2 origin = {};
+    float2 size = {};
+    float tileSize = 0.0f;
+    size_t levels = 8;
+    float lodDistance = 0.0f;
+    float morphRange = 0.3f;
+    float2 heightRange = {};
+    float2 const* heightBounds = nullptr;
+    size_t heightBoundsWidth = 0;
+    size_t heightBoundsHeight = 0;
+    utils::JobSystem* jobSystem = nullptr;
+};
+
+struct TerrainImpl {
+    // the min and max heights of the nodes of each level, row by row, level 0 being the finest
+    struct Level {
+        vector<float2> heights;
+        uint32_t width;
+        uint32_t height;
+        float nodeSize;
+        float range;        // distance up to which this level is used
+        float morphStart;
+    };
+
+    // the frustum planes and the camera position of a selection
+    struct View {
+        float4 planes[6];
+        float3 eye;
+    };
+
+    float2 origin;
+    float2 size;
+    vector<Level> levels;
+    utils::JobSystem* jobSystem;
+
+    // below this many root tiles, the overhead of the job system isn't worth it
+    static constexpr size_t PARALLEL_BATCH = 4;
+
+    void selectRoot(View const& view, uint32_t x, uint32_t z, vector<Tile>& tiles) const;
+    bool selectNode(View const& view, uint32_t x, uint32_t z, size_t level,
+            vector<Tile>& tiles) const;
+    void addTile(uint32_t x, uint32_t z, size_t level, uint8_t quadrants,
+            vector<Tile>& tiles) const;
+
+    bool isInside(uint32_t x, uint32_t z, size_t level) const noexcept;
+    void getBounds(uint32_t x, uint32_t z, size_t level, float3* min, float3* max) const noexcept;
+    static bool intersectsSphere(float3 center, float radius, float3 min, float3 max) noexcept;
+    static bool intersectsFrustum(float4 const* planes, float3 min, float3 max) noexcept;
+};
+
+Builder::Builder() noexcept : mImpl(new TerrainBuilderImpl) {}
+
+Builder::~Builder() noexcept { delete mImpl; }
+
+Builder::Builder(Builder&& that) noexcept {
+    std::swap(mImpl, that.mImpl);
+}
+
+Builder& Builder::operator=(Builder&& that) noexcept {
+    std::swap(mImpl, that.mImpl);
+    return *this;
+}
+
+Builder& Builder::extent(float2 origin, float2 size) noexcept {
+    mImpl->origin = origin;
+    mImpl->size = size;
+    return *this;
+}
+
+Builder& Builder::tileSize(float size) noexcept {
+    mImpl->tileSize = size;
+    return *this;
+}
+
+Builder& Builder::levels(size_t count) noexcept {
+    mImpl->levels = std::clamp(count, size_t(1), MAX_LEVEL_COUNT);
+    return *this;
+}
+
+Builder& Builder::lodDistance(float distance) noexcept {
+    mImpl->lodDistance = distance;
+    return *this;
+}
+
+Builder& Builder::morphRange(float fraction) noexcept {
+    mImpl->morphRange = std::clamp(fraction, 0.0f, 1.0f);
+    return *this;
+}
+
+Builder& Builder::heightRange(float minHeight, float maxHeight) noexcept {
+    mImpl->heightRange = { minHeight, maxHeight };
+    return *this;
+}
+
+Builder& Builder::heightBounds(float2 const* minMax, size_t width, size_t height) noexcept {
+    mImpl->heightBounds = minMax;
+    mImpl->heightBoundsWidth = width;
+    mImpl->heightBoundsHeight = height;
+    return *this;
+}
+
+Builder& Builder::jobSystem(utils::JobSystem* js) noexcept {
+    mImpl->jobSystem = js;
+    return *this;
+}
+
+TerrainQuadTree* Builder::build() {
+    TerrainBuilderImpl const& builder = *mImpl;
+    if (!(builder.tileSize > 0.0f) || !(builder.size.x > 0.0f) || !(builder.size.y > 0.0f)) {
+        return nullptr;
+    }
+
+    TerrainImpl* impl = new TerrainImpl;
+    impl->origin = builder.origin;
+    impl->size = builder.size;
+    impl->jobSystem = builder.jobSystem;
+    impl->levels.resize(builder.levels);
+
+    // The finest level is initialized from the given height bounds, each coarser level bounds
+    // the four nodes below it.
+    const float lodDistance = builder.lodDistance > 0.0f ?
+            builder.lodDistance : 4.0f * builder.tileSize;
+    float previousRange = 0.0f;
+    for (size_t i = 0; i < builder.levels; i++) {
+        TerrainImpl::Level& level = impl->levels[i];
+        level.nodeSize = builder.tileSize * float(1u << i);
+        level.width = uint32_t(std::ceil(builder.size.x / level.nodeSize));
+        level.height = uint32_t(std::ceil(builder.size.y / level.nodeSize));
+        level.range = lodDistance * float(1u << i);
+        level.morphStart = level.range - (level.range - previousRange) * builder.morphRange;
+        previousRange = level.range;
+
+        level.heights.resize(size_t(level.width) * level.height);
+        for (uint32_t z = 0; z < level.height; z++) {
+            for (uint32_t x = 0; x < level.width; x++) {
+                float2& bounds = level.heights[z * level.width + x];
+                if (i == 0) {
+                    const bool covered = builder.heightBounds &&
+                            x < builder.heightBoundsWidth && z < builder.heightBoundsHeight;
+                    bounds = covered ?
+                            builder.heightBounds[z * builder.heightBoundsWidth + x] :
+                            builder.heightRange;
+                    continue;
+                }
+                TerrainImpl::Level const& finer = impl->levels[i - 1];
+                bounds = { INFINITY, -INFINITY };
+                for (uint32_t child = 0; child < 4; child++) {
+                    const uint32_t cx = 2 * x + (child & 1u);
+                    const uint32_t cz = 2 * z + (child >> 1u);
+                    if (cx < finer.width && cz < finer.height) {
+                        float2 const& b = finer.heights[cz * finer.width + cx];
+                        bounds = { std::min(bounds.x, b.x), std::max(bounds.y, b.y) };
+                    }
+                }
+            }
+        }
+    }
+
+    return new TerrainQuadTree(impl);
+}
+
+TerrainQuadTree::TerrainQuadTree(TerrainImpl* impl) noexcept : mImpl(impl) {}
+
+TerrainQuadTree::~TerrainQuadTree() noexcept { delete mImpl; }
+
+TerrainQuadTree::TerrainQuadTree(TerrainQuadTree&& that) noexcept {
+    std::swap(mImpl, that.mImpl);
+}
+
+TerrainQuadTree& TerrainQuadTree::operator=(TerrainQuadTree&& that) noexcept {
+    std::swap(mImpl, that.mImpl);
+    return *this;
+}
+
+size_t TerrainQuadTree::getLevelCount() const noexcept {
+    return mImpl->levels.size();
+}
+
+void TerrainQuadTree::select(float3 const& eye, mat4f const& viewProjection,
+        vector<Tile>& tiles) const {
+    TerrainImpl const& impl = *mImpl;
+
+    // the planes are such that dot(plane, p) >= 0 for the points p inside the frustum
+    TerrainImpl::View view;
+    view.eye = eye;
+    const mat4f m = transpose(viewProjection);
+    view.planes[0] = m[3] + m[0];   // left
+    view.planes[1] = m[3] - m[0];   // right
+    view.planes[2] = m[3] + m[1];   // bottom
+    view.planes[3] = m[3] - m[1];   // top
+    view.planes[4] = m[3] + m[2];   // near
+    view.planes[5] = m[3] - m[2];   // far
+
+    TerrainImpl::Level const& roots = impl.levels.back();
+    const size_t rootCount = size_t(roots.width) * roots.height;
+
+    tiles.clear();
+    if (impl.jobSystem && rootCount >= 2 * TerrainImpl::PARALLEL_BATCH) {
+        // each root tile is selected in its own vector, which are concatenated in order
+        vector<vector<Tile>> rootTiles(rootCount);
+        auto* job = utils::jobs::parallel_for(*impl.jobSystem, nullptr, 0, uint32_t(rootCount),
+                [&](uint32_t start, uint32_t count) {
+                    for (uint32_t i = start; i < start + count; i++) {
+                        impl.selectRoot(view, i % roots.width, i / roots.width, rootTiles[i]);
+                    }
+                }, utils::jobs::CountSplitter<TerrainImpl::PARALLEL_BATCH>());
+        impl.jobSystem->runAndWait(job);
+        for (auto const& r : rootTiles) {
+            tiles.insert(tiles.end(), r.begin(), r.end());
+        }
+    } else {
+        for (uint32_t i = 0; i < rootCount; i++) {
+            impl.selectRoot(view, i % roots.width, i / roots.width, tiles);
+        }
+    }
+}
+
+void TerrainImpl::selectRoot(View const& view, uint32_t x, uint32_t z,
+        vector<Tile>& tiles) const {
+    const size_t level = levels.size() - 1;
+    if (!selectNode(view, x, z, level, tiles)) {
+        // beyond the range of the coarsest level, which is used nonetheless
+        float3 min, max;
+        getBounds(x, z, level, &min, &max);
+        if (intersectsFrustum(view.planes, min, max)) {
+            addTile(x, z, level, 0xF, tiles);
+        }
+    }
+}
+
+// Returns false if the node is beyond the range of its level, in which case its parent draws the
+// area it covers. Otherwise the node is handled, whether it's drawn, culled or subdivided.
+bool TerrainImpl::selectNode(View const& view, uint32_t x, uint32_t z, size_t level,
+        vector<Tile>& tiles) const {
+    if (!isInside(x, z, level)) {
+        return true;
+    }
+
+    float3 min, max;
+    getBounds(x, z, level, &min, &max);
+    if (!intersectsSphere(view.eye, levels[level].range, min, max)) {
+        return false;
+    }
+    if (!intersectsFrustum(view.planes, min, max)) {
+        return true;
+    }
+
+    if (level == 0 || !intersectsSphere(view.eye, levels[level - 1].range, min, max)) {
+        addTile(x, z, level, 0xF, tiles);
+        return true;
+    }
+
+    // the quadrants whose node is too far for the finer level are drawn at this level
+    uint8_t quadrants = 0;
+    for (uint32_t child = 0; child < 4; child++) {
+        const uint32_t cx = 2 * x + (child & 1u);
+        const uint32_t cz = 2 * z + (child >> 1u);
+        if (!selectNode(view, cx, cz, level - 1, tiles)) {
+            quadrants |= uint8_t(1u << child);
+        }
+    }
+    if (quadrants) {
+        addTile(x, z, level, quadrants, tiles);
+    }
+    return true;
+}
+
+void TerrainImpl::addTile(uint32_t x, uint32_t z, size_t level, uint8_t quadrants,
+        vector<Tile>& tiles) const {
+    Level const& l = levels[level];
+    tiles.push_back({
+            .origin = origin + float2(float(x), float(z)) * l.nodeSize,
+            .size = l.nodeSize,
+            .morphStart = l.morphStart,
+            .morphEnd = l.range,
+            .level = uint8_t(level),
+            .quadrants = quadrants });
+}
+
+bool TerrainImpl::isInside(uint32_t x, uint32_t z, size_t level) const noexcept {
+    return x < levels[level].width && z < levels[level].height;
+}
+
+void TerrainImpl::getBounds(uint32_t x, uint32_t z, size_t level,
+        float3* min, float3* max) const noexcept {
+    Level const& l = levels[level];
+    const float2 heights = l.heights[z * l.width + x];
+    const float2 corner = origin + float2(float(x), float(z)) * l.nodeSize;
+    *min = { corner.x, heights.x, corner.y };
+    *max = { corner.x + l.nodeSize, heights.y, corner.y + l.nodeSize };
+}
+
+bool TerrainImpl::intersectsSphere(float3 center, float radius,
+        float3 min, float3 max) noexcept {
+    const float3 d = center - clamp(center, min, max);
+    return dot(d, d) <= radius * radius;
+}
+
+bool TerrainImpl::intersectsFrustum(float4 const* planes, float3 min, float3 max) noexcept {
+    for (size_t i = 0; i < 6; i++) {
+        // the corner of the box the furthest along the plane's normal
+        const float4 p = planes[i];
+        const float3 corner = {
+                p.x >= 0.0f ? max.x : min.x,
+                p.y >= 0.0f ? max.y : min.y,
+                p.z >= 0.0f ? max.z : min.z };
+        if (dot(p.xyz, corner) + p.w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TerrainQuadTree::generateGrid(size_t resolution, vector<float2>& positions,
+        vector<uint16_t>& indices) {
+    const uint32_t n = uint32_t(std::clamp((resolution + 1u) & ~size_t(1), size_t(2), size_t(254)));
+    const uint32_t half = n / 2;
+
+    positions.resize(size_t(n + 1) * (n + 1));
+    for (uint32_t z = 0; z <= n; z++) {
+        for (uint32_t x = 0; x <= n; x++) {
+            positions[z * (n + 1) + x] = float2(float(x), float(z)) / float(n);
+        }
+    }
+
+    indices.clear();
+    indices.reserve(size_t(n) * n * 6);
+    for (uint32_t quadrant = 0; quadrant < 4; quadrant++) {
+        const uint32_t x0 = (quadrant & 1u) * half;
+        const uint32_t z0 = (quadrant >> 1u) * half;
+        for (uint32_t z = z0; z < z0 + half; z++) {
+            for (uint32_t x = x0; x < x0 + half; x++) {
+                const uint16_t i0 = uint16_t(z * (n + 1) + x);
+                const uint16_t i1 = uint16_t(i0 + 1);
+                const uint16_t i2 = uint16_t(i0 + n + 1);
+                const uint16_t i3 = uint16_t(i2 + 1);
+                indices.insert(indices.end(), { i0, i2, i1, i1, i2, i3 });
+            }
+        }
+    }
+}
+
+} // namespace terrain
+} // namespace filament
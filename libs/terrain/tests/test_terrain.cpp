@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <terrain/TerrainQuadTree.h>
+
+#include <math/mat4.h>
+#include <math/vec3.h>
+
+#include <memory>
+#include <vector>
+
+using namespace filament::math;
+using namespace filament::terrain;
+
+using Tile = TerrainQuadTree::Tile;
+
+class TerrainTest : public testing::Test {
+protected:
+    static constexpr float SIZE = 1024.0f;
+    static constexpr float TILE_SIZE = 16.0f;
+    static constexpr float LOD_DISTANCE = 64.0f;
+    static constexpr float MORPH_RANGE = 0.3f;
+    static constexpr float MIN_HEIGHT = 0.0f;
+    static constexpr float MAX_HEIGHT = 20.0f;
+    static constexpr size_t LEVELS = 5;
+
+    void SetUp() override {
+        mTerrain.reset(TerrainQuadTree::Builder()
+                .extent({ 0.0f, 0.0f }, { SIZE, SIZE })
+                .tileSize(TILE_SIZE)
+                .levels(LEVELS)
+                .lodDistance(LOD_DISTANCE)
+                .morphRange(MORPH_RANGE)
+                .heightRange(MIN_HEIGHT, MAX_HEIGHT)
+                .build());
+    }
+
+    static float range(size_t level) {
+        return LOD_DISTANCE * float(1u << level);
+    }
+
+    // distance from the eye to the bounds of a square of the terrain
+    static float distance(float3 eye, float2 origin, float size) {
+        const float3 min = { origin.x, MIN_HEIGHT, origin.y };
+        const float3 max = { origin.x + size, MAX_HEIGHT, origin.y + size };
+        return length(eye - clamp(eye, min, max));
+    }
+
+    std::unique_ptr<TerrainQuadTree> mTerrain;
+    const float3 mEye = { 100.0f, 50.0f, 100.0f };
+};
+
+TEST_F(TerrainTest, Build) {
+    ASSERT_NE(mTerrain, nullptr);
+    EXPECT_EQ(mTerrain->getLevelCount(), LEVELS);
+
+    std::unique_ptr<TerrainQuadTree> noTileSize(TerrainQuadTree::Builder()
+            .extent({ 0.0f, 0.0f }, { SIZE, SIZE })
+            .build());
+    EXPECT_EQ(noTileSize, nullptr);
+
+    std::unique_ptr<TerrainQuadTree> noExtent(TerrainQuadTree::Builder()
+            .tileSize(TILE_SIZE)
+            .build());
+    EXPECT_EQ(noExtent, nullptr);
+}
+
+TEST_F(TerrainTest, LodRanges) {
+    const mat4f everything = mat4f::ortho(-2000, 2000, -2000, 2000, -2000, 2000);
+    std::vector<Tile> tiles;
+    mTerrain->select(mEye, everything, tiles);
+    ASSERT_FALSE(tiles.empty());
+
+    bool levelUsed[LEVELS] = {};
+    float area = 0.0f;
+    for (Tile const& tile : tiles) {
+        ASSERT_LT(tile.level, LEVELS);
+        ASSERT_NE(tile.quadrants, 0);
+        levelUsed[tile.level] = true;
+        EXPECT_FLOAT_EQ(tile.size, TILE_SIZE * float(1u << tile.level));
+
+        // a tile is only used within the range of its level, except for the coarsest level
+        if (tile.level < LEVELS - 1) {
+            EXPECT_LE(distance(mEye, tile.origin, tile.size), range(tile.level));
+        }
+
+        // and its quadrants are only drawn beyond the range of the finer level
+        const float half = tile.size * 0.5f;
+        for (uint32_t i = 0; i < 4; i++) {
+            if (tile.quadrants & (1u << i)) {
+                area += half * half;
+                if (tile.level > 0) {
+                    const float2 origin = tile.origin + float2(i & 1u, i >> 1u) * half;
+                    EXPECT_GT(distance(mEye, origin, half), range(tile.level - 1));
+                }
+            }
+        }
+    }
+
+    // the tiles cover the terrain exactly once
+    EXPECT_FLOAT_EQ(area, SIZE * SIZE);
+    for (size_t i = 0; i < LEVELS; i++) {
+        EXPECT_TRUE(levelUsed[i]) << "level " << i;
+    }
+}
+
+TEST_F(TerrainTest, MorphContinuity) {
+    const mat4f everything = mat4f::ortho(-2000, 2000, -2000, 2000, -2000, 2000);
+    std::vector<Tile> tiles;
+    mTerrain->select(mEye, everything, tiles);
+
+    Tile const* byLevel[LEVELS] = {};
+    for (Tile const& tile : tiles) {
+        EXPECT_FLOAT_EQ(tile.morphEnd, range(tile.level));
+        EXPECT_LT(tile.morphStart, tile.morphEnd);
+        byLevel[tile.level] = &tile;
+    }
+
+    // a tile completes its morph to the next level before the tiles of that level start theirs,
+    // so that the vertices of adjacent tiles of different levels match
+    for (size_t i = 1; i < LEVELS; i++) {
+        ASSERT_NE(byLevel[i - 1], nullptr);
+        ASSERT_NE(byLevel[i], nullptr);
+        EXPECT_LE(byLevel[i - 1]->morphEnd, byLevel[i]->morphStart);
+        EXPECT_FLOAT_EQ(byLevel[i]->morphStart,
+                range(i) - (range(i) - range(i - 1)) * MORPH_RANGE);
+    }
+    EXPECT_FLOAT_EQ(byLevel[0]->morphStart, range(0) * (1.0f - MORPH_RANGE));
+}
+
+TEST_F(TerrainTest, FrustumRejection) {
+    const mat4f everything = mat4f::ortho(-2000, 2000, -2000, 2000, -2000, 2000);
+    std::vector<Tile> all;
+    mTerrain->select(mEye, everything, all);
+
+    // only the tiles that overlap 0 <= x <= 256 are selected
+    const mat4f slice = mat4f::ortho(0, 256, -2000, 2000, -2000, 2000);
+    std::vector<Tile> tiles;
+    mTerrain->select(mEye, slice, tiles);
+    ASSERT_FALSE(tiles.empty());
+    EXPECT_LT(tiles.size(), all.size());
+    for (Tile const& tile : tiles) {
+        EXPECT_LE(tile.origin.x, 256.0f);
+        EXPECT_GE(tile.origin.x + tile.size, 0.0f);
+    }
+
+    // nothing is selected outside of the terrain
+    const mat4f outside = mat4f::ortho(5000, 6000, -2000, 2000, -2000, 2000);
+    mTerrain->select(mEye, outside, tiles);
+    EXPECT_TRUE(tiles.empty());
+}
+
+TEST_F(TerrainTest, Grid) {
+    std::vector<float2> positions;
+    std::vector<uint16_t> indices;
+    TerrainQuadTree::generateGrid(16, positions, indices);
+    EXPECT_EQ(positions.size(), 17u * 17u);
+    EXPECT_EQ(indices.size(), 16u * 16u * 6u);
+
+    // each quadrant covers its own quarter of the grid
+    const size_t count = indices.size() / 4;
+    for (uint32_t quadrant = 0; quadrant < 4; quadrant++) {
+        const float2 min = float2(quadrant & 1u, quadrant >> 1u) * 0.5f;
+        for (size_t i = quadrant * count; i < (quadrant + 1) * count; i++) {
+            const float2 p = positions[indices[i]];
+            EXPECT_GE(p.x, min.x);
+            EXPECT_GE(p.y, min.y);
+            EXPECT_LE(p.x, min.x + 0.5f);
+            EXPECT_LE(p.y, min.y + 0.5f);
+        }
+    }
+
+    // odd resolutions are rounded up
+    TerrainQuadTree::generateGrid(15, positions, indices);
+    EXPECT_EQ(positions.size(), 17u * 17u);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
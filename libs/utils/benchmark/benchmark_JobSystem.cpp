@@ -21,6 +21,9 @@
 
 #include <benchmark/benchmark.h>
 
+#include <cmath>
+#include <vector>
+
 using namespace utils;
 
 
@@ -78,7 +81,59 @@ static void BM_JobSystemParallelFor(benchmark::State& state) {
     js.emancipate();
 }
 
+// Reports how the work was distributed, using the JobSystem's own statistics.
+static void reportStatistics(benchmark::State& state, JobSystem const& js) {
+    std::vector<JobSystem::ThreadStatistics> stats(js.getStatistics(nullptr, 0));
+    js.getStatistics(stats.data(), stats.size());
+    double busy = 0, idle = 0, attempts = 0, steals = 0;
+    for (auto const& s : stats) {
+        busy += double(s.busyTime);
+        idle += double(s.idleTime);
+        attempts += s.stealAttempts;
+        steals += s.stealCount;
+    }
+    state.counters.insert({
+            { "busy", busy / (busy + idle) },
+            { "steals", { steals, benchmark::Counter::kAvgIterations }},
+            { "steal_ratio", attempts ? steals / attempts : 0.0 }
+    });
+}
+
+// parallel_for on a fixed amount of work, with a varying number of threads. The split count is
+// derived from the thread count (see getParallelSplitCount()).
+template<size_t COUNT>
+static void BM_JobSystemParallelForScaling(benchmark::State& state) {
+    JobSystem js(size_t(state.range(0)));
+    js.adopt();
+    js.setStatisticsEnabled(true);
+
+    std::vector<float> data(1024 * 256, 1.0f);
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            auto job = jobs::parallel_for(js, nullptr, data.data(), uint32_t(data.size()),
+                    [](float* p, uint32_t count) {
+                        for (uint32_t i = 0; i < count; i++) {
+                            p[i] = std::sqrt(p[i] * p[i] + 1.0f) - 1.0f;
+                        }
+                    }, jobs::CountSplitter<COUNT>());
+            js.runAndWait(job);
+        }
+    }
+    state.SetItemsProcessed((int64_t)state.iterations() * data.size());
+    state.counters["splits"] = double(js.getParallelSplitCount());
+    reportStatistics(state, js);
+
+    js.emancipate();
+}
+
 
 BENCHMARK(BM_JobSystem);
 BENCHMARK(BM_JobSystemAsChildren4k);
 BENCHMARK(BM_JobSystemParallelFor);
+BENCHMARK_TEMPLATE(BM_JobSystemParallelForScaling, 64)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Arg(12)
+        ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_JobSystemParallelForScaling, 1024)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Arg(12)
+        ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_JobSystemParallelForScaling, 8192)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Arg(12)
+        ->UseRealTime();
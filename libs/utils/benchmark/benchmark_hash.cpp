@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PerformanceCounters.h"
+
+#include <utils/Hash.h>
+
+#include <benchmark/benchmark.h>
+
+#include <tsl/robin_map.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <string.h>
+
+using namespace utils;
+
+// Keys of the sizes of the backend caches: a descriptor set key, a framebuffer key and a
+// pipeline key.
+template<size_t SIZE>
+struct Key {
+    uint32_t words[SIZE / 4];
+    bool operator==(Key const& rhs) const noexcept {
+        return !memcmp(words, rhs.words, SIZE);
+    }
+};
+
+template<size_t SIZE>
+static std::vector<Key<SIZE>> generateKeys(size_t count) {
+    std::default_random_engine gen{123};
+    std::vector<Key<SIZE>> keys(count);
+    for (auto& key : keys) {
+        std::generate(std::begin(key.words), std::end(key.words), gen);
+    }
+    return keys;
+}
+
+template<typename Hasher, size_t SIZE>
+static void BM_hash(benchmark::State& state) {
+    std::vector<Key<SIZE>> keys = generateKeys<SIZE>(256);
+    Hasher hasher;
+    size_t i = 0;
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            size_t h = hasher(keys[i++ % keys.size()]);
+            benchmark::DoNotOptimize(h);
+        }
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(SIZE));
+}
+
+template<typename Hasher, size_t SIZE>
+static void BM_lookup(benchmark::State& state) {
+    std::vector<Key<SIZE>> keys = generateKeys<SIZE>(size_t(state.range(0)));
+    tsl::robin_map<Key<SIZE>, uint32_t, Hasher> map;
+    for (size_t i = 0; i < keys.size(); i++) {
+        map[keys[i]] = uint32_t(i);
+    }
+    std::vector<Key<SIZE>> lookups = keys;
+    std::shuffle(lookups.begin(), lookups.end(), std::default_random_engine{456});
+    size_t i = 0;
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            auto pos = map.find(lookups[i++ % lookups.size()]);
+            benchmark::DoNotOptimize(pos);
+        }
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_hash, hash::MurmurHashFn<Key<16>>, 16);
+BENCHMARK_TEMPLATE(BM_hash, hash::WyHashFn<Key<16>>, 16);
+BENCHMARK_TEMPLATE(BM_hash, hash::MurmurHashFn<Key<64>>, 64);
+BENCHMARK_TEMPLATE(BM_hash, hash::WyHashFn<Key<64>>, 64);
+BENCHMARK_TEMPLATE(BM_hash, hash::MurmurHashFn<Key<296>>, 296);
+BENCHMARK_TEMPLATE(BM_hash, hash::WyHashFn<Key<296>>, 296);
+
+BENCHMARK_TEMPLATE(BM_lookup, hash::MurmurHashFn<Key<64>>, 64)->Range(16, 4096);
+BENCHMARK_TEMPLATE(BM_lookup, hash::WyHashFn<Key<64>>, 64)->Range(16, 4096);
+BENCHMARK_TEMPLATE(BM_lookup, hash::MurmurHashFn<Key<296>>, 296)->Range(16, 4096);
+BENCHMARK_TEMPLATE(BM_lookup, hash::WyHashFn<Key<296>>, 296)->Range(16, 4096);
@@ -18,9 +18,15 @@
 #define TNT_UTILS_HASH_H
 
 #include <functional>   // for std::hash
+#include <type_traits>
 
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#   include <intrin.h>
+#endif
 
 namespace utils {
 namespace hash {
@@ -54,6 +60,62 @@ struct MurmurHashFn {
     }
 };
 
+// 64 x 64 -> 128 bits multiplication, folded to 64 bits by xor'ing both halves
+inline uint64_t mum(uint64_t a, uint64_t b) noexcept {
+#if defined(__SIZEOF_INT128__)
+    const __uint128_t r = __uint128_t(a) * b;
+    return uint64_t(r) ^ uint64_t(r >> 64u);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    uint64_t hi;
+    const uint64_t lo = _umul128(a, b, &hi);
+    return lo ^ hi;
+#else
+    const uint64_t ha = a >> 32u, la = uint32_t(a);
+    const uint64_t hb = b >> 32u, lb = uint32_t(b);
+    const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    const uint64_t t = rl + (rm0 << 32u);
+    const uint64_t lo = t + (rm1 << 32u);
+    const uint64_t hi = rh + (rm0 >> 32u) + (rm1 >> 32u) + (t < rl) + (lo < t);
+    return lo ^ hi;
+#endif
+}
+
+// Fast non-cryptographic hash of a key of SIZE bytes, after wyhash. It consumes 16 bytes per
+// multiplication, and the size is known at compile time so that the loop is fully unrolled.
+// This is several times faster than murmur3 on the keys of the backend caches.
+template<size_t SIZE>
+inline uint64_t wyhash(const void* key, uint64_t seed = 0) noexcept {
+    static_assert(0 == (SIZE & 3u), "Hashing requires a size that is a multiple of 4.");
+    constexpr uint64_t p0 = 0xa0761d6478bd642full;
+    constexpr uint64_t p1 = 0xe7037ed1a0b428dbull;
+    constexpr uint64_t p2 = 0x8ebc6af09c88c6e3ull;
+    const uint8_t* p = (const uint8_t*) key;
+    auto read64 = [](const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; };
+    auto read32 = [](const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return uint64_t(v); };
+    uint64_t h = seed ^ p0;
+    size_t i = 0;
+    for (; i + 16 <= SIZE; i += 16) {
+        h = mum(read64(p + i) ^ p1, read64(p + i + 8) ^ h);
+    }
+    if (SIZE - i >= 8) {
+        h = mum(read64(p + i) ^ p1, h ^ p2);
+        i += 8;
+    }
+    if (SIZE - i >= 4) {
+        h = mum(read32(p + i) ^ p1, h ^ p0);
+    }
+    return mum(h ^ p1, SIZE ^ p2);
+}
+
+// Hashes the bytes of a key with wyhash(), the key must not have uninitialized padding.
+template<typename T>
+struct WyHashFn {
+    size_t operator()(const T& key) const noexcept {
+        static_assert(std::is_trivially_copyable<T>::value, "Hashing requires a trivial type.");
+        return size_t(wyhash<sizeof(T)>(&key));
+    }
+};
+
 // combines two hashes together
 template<class T>
 inline void combine(size_t& seed, const T& v) noexcept {
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_UTILS_INPLACEFUNCTION_H
+#define TNT_UTILS_INPLACEFUNCTION_H
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <assert.h>
+#include <stddef.h>
+
+namespace utils {
+
+template<typename Signature, size_t CAPACITY = 4 * sizeof(void*)>
+class InplaceFunction;
+
+/*
+ * InplaceFunction is a replacement for std::function<> that never allocates.
+ *
+ * The callable is always stored inline, in CAPACITY bytes, and a callable that doesn't fit
+ * is a compile-time error rather than a silent heap allocation. This makes it suitable for
+ * containers living in an arena, such as the per-frame containers of the renderer.
+ * Like std::function<>, the callable must be copy-constructible.
+ */
+template<typename R, typename ... ARGS, size_t CAPACITY>
+class InplaceFunction<R(ARGS...), CAPACITY> {
+public:
+    InplaceFunction() noexcept = default;
+
+    InplaceFunction(std::nullptr_t) noexcept { } // NOLINT(google-explicit-constructor)
+
+    template<typename T, typename F = typename std::decay<T>::type,
+            typename = typename std::enable_if<!std::is_same<F, InplaceFunction>::value>::type>
+    InplaceFunction(T&& callable) noexcept { // NOLINT(google-explicit-constructor)
+        static_assert(sizeof(F) <= CAPACITY, "callable too large for this InplaceFunction");
+        static_assert(alignof(F) <= alignof(Storage), "callable alignment not supported");
+        static_assert(std::is_nothrow_move_constructible<F>::value,
+                "callable must be nothrow move constructible");
+        new(&mStorage) F(std::forward<T>(callable));
+        mInvoke = [](void* p, ARGS... args) -> R {
+            return (*static_cast<F*>(p))(std::forward<ARGS>(args)...);
+        };
+        mManage = [](Operation op, void* dst, void* src) noexcept {
+            F* const f = static_cast<F*>(src);
+            switch (op) {
+                case Operation::COPY:       new(dst) F(*f);             break;
+                case Operation::MOVE:       new(dst) F(std::move(*f));  f->~F(); break;
+                case Operation::DESTROY:    f->~F();                    break;
+            }
+        };
+    }
+
+    InplaceFunction(InplaceFunction const& rhs) noexcept {
+        copyFrom(rhs);
+    }
+
+    InplaceFunction(InplaceFunction&& rhs) noexcept {
+        moveFrom(rhs);
+    }
+
+    InplaceFunction& operator=(InplaceFunction const& rhs) noexcept {
+        if (this != &rhs) {
+            destroy();
+            copyFrom(rhs);
+        }
+        return *this;
+    }
+
+    InplaceFunction& operator=(InplaceFunction&& rhs) noexcept {
+        if (this != &rhs) {
+            destroy();
+            moveFrom(rhs);
+        }
+        return *this;
+    }
+
+    ~InplaceFunction() noexcept {
+        destroy();
+    }
+
+    explicit operator bool() const noexcept { return mInvoke != nullptr; }
+
+    R operator()(ARGS... args) const {
+        assert(mInvoke);
+        return mInvoke(const_cast<Storage*>(&mStorage), std::forward<ARGS>(args)...);
+    }
+
+private:
+    using Storage = typename std::aligned_storage<CAPACITY, alignof(std::max_align_t)>::type;
+
+    enum class Operation { COPY, MOVE, DESTROY };
+
+    void copyFrom(InplaceFunction const& rhs) noexcept {
+        if (rhs.mManage) {
+            rhs.mManage(Operation::COPY, &mStorage, const_cast<Storage*>(&rhs.mStorage));
+        }
+        mInvoke = rhs.mInvoke;
+        mManage = rhs.mManage;
+    }
+
+    void moveFrom(InplaceFunction& rhs) noexcept {
+        if (rhs.mManage) {
+            rhs.mManage(Operation::MOVE, &mStorage, &rhs.mStorage);
+        }
+        mInvoke = rhs.mInvoke;
+        mManage = rhs.mManage;
+        rhs.mInvoke = nullptr;
+        rhs.mManage = nullptr;
+    }
+
+    void destroy() noexcept {
+        if (mManage) {
+            mManage(Operation::DESTROY, nullptr, &mStorage);
+        }
+        mInvoke = nullptr;
+        mManage = nullptr;
+    }
+
+    Storage mStorage;
+    R (*mInvoke)(void*, ARGS...) = nullptr;
+    void (*mManage)(Operation op, void* dst, void* src) noexcept = nullptr;
+};
+
+} // namespace utils
+
+#endif // TNT_UTILS_INPLACEFUNCTION_H
@@ -72,7 +72,8 @@ public:
         uint16_t parent;                                        //  2 |  2
         std::atomic<uint16_t> runningJobCount = { 1 };          //  2 |  2
         mutable std::atomic<uint16_t> refCount = { 1 };         //  2 |  2
-                                                                //  6 |  2 (padding)
+        std::atomic<uint8_t> flags = { 0 }; // runFlags, etc.   //  1 |  1
+                                                                //  5 |  1 (padding)
                                                                 // 64 | 64
     };
 
@@ -218,6 +219,22 @@ public:
     }
 
 
+    /*
+     * Turns a job that was just created into a continuation: once run(), it waits for all its
+     * children to complete and only then executes, on the thread that completed the last one.
+     * Its children must be created after this call. This expresses a dependency without
+     * blocking a thread in runAndWait() in between, e.g.:
+     *
+     *   Job* sort = js.makeContinuation(js.createJob(parent, sortCommands));
+     *   for (...) {
+     *       js.run(js.createJob(sort, generateCommands));
+     *   }
+     *   js.run(sort);  // sorts after all the commands are generated
+     *
+     * Continuations can be chained, a continuation can be a child of another one.
+     */
+    Job* makeContinuation(Job* job) noexcept;
+
     /*
      * Jobs are normally finished automatically, this can be used to cancel a job before it is run.
      *
@@ -250,9 +267,14 @@ public:
      * Add job to this thread's execution queue. It's reference will drop automatically.
      * Current thread must be owned by JobSystem's thread pool. See adopt().
      *
+     * Jobs run with BACKGROUND go to a separate, lower priority queue: a thread only picks a
+     * background job when it couldn't find a normal one, and a thread waiting on a normal job
+     * never runs background jobs while it waits. Use it for long jobs that are not needed by
+     * the current frame (e.g. texture decoding), so they never delay frame-critical work.
+     *
      * The job can't be used after this call.
      */
-    enum runFlags { DONT_SIGNAL = 0x1 };
+    enum runFlags { DONT_SIGNAL = 0x1, BACKGROUND = 0x2 };
     void run(Job*& job, uint32_t flags = 0) noexcept;
     void run(Job*&& job, uint32_t flags = 0) noexcept { // allows run(createJob(...));
         Job* p = job;
@@ -285,10 +307,10 @@ public:
      *
      * The job can't be used after this call.
      */
-    void runAndWait(Job*& job) noexcept;
-    void runAndWait(Job*&& job) noexcept { // allows runAndWait(createJob(...));
+    void runAndWait(Job*& job, uint32_t flags = 0) noexcept;
+    void runAndWait(Job*&& job, uint32_t flags = 0) noexcept { // allows runAndWait(createJob(...));
         Job* p = job;
-        runAndWait(p);
+        runAndWait(p, flags);
     }
 
     // for debugging
@@ -313,7 +335,36 @@ public:
         return mParallelSplitCount;
     }
 
+    /*
+     * Statistics of one thread of the pool, intended to evaluate how well work is distributed.
+     * These are only gathered while enabled with setStatisticsEnabled(), which costs two clock
+     * reads per job executed.
+     */
+    struct ThreadStatistics {
+        static constexpr size_t HISTOGRAM_BUCKET_COUNT = 16;
+        uint64_t busyTime;          // time spent executing jobs, in nanoseconds
+        uint64_t idleTime;          // time spent waiting for jobs, in nanoseconds
+        uint32_t jobCount;          // number of jobs executed
+        uint32_t stealAttempts;     // number of queues this thread tried to steal from
+        uint32_t stealCount;        // number of jobs this thread stole
+        // jobDurations[i] counts the jobs that took less than 2^i microseconds
+        // (the last bucket counts all the longer ones).
+        uint32_t jobDurations[HISTOGRAM_BUCKET_COUNT];
+    };
+
+    void setStatisticsEnabled(bool enabled) noexcept;
+
+    // Fills at most `count` entries, one per thread of the pool followed by adopted threads, and
+    // returns the number of entries available. Can be called from any thread.
+    size_t getStatistics(ThreadStatistics* out, size_t count) const noexcept;
+
+    // Resets the statistics of all threads, counts updated concurrently may be lost.
+    void resetStatistics() noexcept;
+
 private:
+    // internal Job::flags bit, set on continuations until they're scheduled
+    static constexpr uint8_t CONTINUATION = 0x80;
+
     // this is just to avoid using std::default_random_engine, since we're in a public header.
     class default_random_engine {
         static constexpr uint32_t m = 0x7fffffffu;
@@ -331,6 +382,21 @@ private:
         // make sure storage is cache-line aligned
         WorkQueue workQueue;
 
+        // jobs run with BACKGROUND, on their own cache-line(s)
+        alignas(CACHELINE_SIZE)
+        WorkQueue backgroundQueue;
+
+        // only written by the thread owning this state, when statistics are enabled
+        alignas(CACHELINE_SIZE)
+        struct {
+            std::atomic<uint64_t> busyTime = { 0 };
+            std::atomic<uint64_t> idleTime = { 0 };
+            std::atomic<uint32_t> jobCount = { 0 };
+            std::atomic<uint32_t> stealAttempts = { 0 };
+            std::atomic<uint32_t> stealCount = { 0 };
+            std::atomic<uint32_t> jobDurations[ThreadStatistics::HISTOGRAM_BUCKET_COUNT] = {};
+        } statistics;
+
         // these are not accessed by the worker threads
         alignas(CACHELINE_SIZE)     // this causes 56-bytes padding
         JobSystem* js;
@@ -354,11 +420,13 @@ private:
     void requestExit() noexcept;
     bool exitRequested() const noexcept;
     bool hasActiveJobs() const noexcept;
+    bool hasActiveBackgroundJobs() const noexcept;
 
     void loop(ThreadState* state) noexcept;
-    bool execute(JobSystem::ThreadState& state) noexcept;
-    Job* steal(JobSystem::ThreadState& state) noexcept;
+    bool execute(JobSystem::ThreadState& state, bool background) noexcept;
+    Job* steal(JobSystem::ThreadState& state, bool background) noexcept;
     void finish(Job* job) noexcept;
+    void schedule(Job* job) noexcept;
 
     void put(WorkQueue& workQueue, Job* job) noexcept {
         size_t index = job - mJobStorageBase;
@@ -386,6 +454,7 @@ private:
     utils::Condition mWaiterCondition;
 
     std::atomic<uint32_t> mActiveJobs = { 0 };
+    std::atomic<uint32_t> mActiveBackgroundJobs = { 0 };
     utils::Arena<utils::ThreadSafeObjectPoolAllocator<Job>, LockingPolicy::NoLock> mJobPool;
 
     template <typename T>
@@ -400,6 +469,7 @@ private:
     alignas(16) // at least we align to half (or quarter) cache-line
     aligned_vector<ThreadState> mThreadStates;          // actual data is stored offline
     std::atomic<bool> mExitRequested = { false };       // this one is almost never written
+    std::atomic<bool> mStatisticsEnabled = { false };   // this one is almost never written
     std::atomic<uint16_t> mAdoptedThreads = { 0 };      // this one is almost never written
     Job* const mJobStorageBase;                         // Base for conversion to indices
     uint16_t mThreadCount = 0;                          // total # of threads in the pool
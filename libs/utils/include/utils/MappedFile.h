@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_UTILS_MAPPEDFILE_H
+#define TNT_UTILS_MAPPEDFILE_H
+
+#include <utils/compiler.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace utils {
+
+/*
+ * MappedFile is a read-only view of the whole content of a file.
+ *
+ * The file is memory-mapped, so that only the pages that are accessed are read, and they don't
+ * count as private memory of the process. On platforms without memory mapping (e.g. WebGL), the
+ * file is read into memory instead.
+ *
+ *  MappedFile file("texture.ktx");
+ *  if (file.isValid()) {
+ *      process(file.data(), file.size());
+ *  }
+ */
+class UTILS_PUBLIC MappedFile {
+public:
+    MappedFile() noexcept = default;
+
+    // maps the file at the given path, check isValid() for errors. Empty files are never valid.
+    explicit MappedFile(const char* path) noexcept;
+
+    MappedFile(MappedFile const& rhs) = delete;
+    MappedFile& operator=(MappedFile const& rhs) = delete;
+
+    MappedFile(MappedFile&& rhs) noexcept;
+    MappedFile& operator=(MappedFile&& rhs) noexcept;
+
+    // unmaps the file, pointers obtained from data() become invalid.
+    ~MappedFile() noexcept;
+
+    bool isValid() const noexcept { return mData != nullptr; }
+
+    uint8_t const* data() const noexcept { return mData; }
+
+    size_t size() const noexcept { return mSize; }
+
+private:
+    void release() noexcept;
+
+    uint8_t const* mData = nullptr;
+    size_t mSize = 0;
+};
+
+} // namespace utils
+
+#endif // TNT_UTILS_MAPPEDFILE_H
@@ -24,6 +24,8 @@
 
 #include <tsl/robin_map.h>
 
+#include <chrono>
+
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -124,12 +126,23 @@ public:
     // This invalidates all pointers components.
     inline Instance removeComponent(Entity e);
 
+    // Makes room for count more components, so that adding them doesn't reallocate.
+    // This invalidates all pointers components.
+    void reserve(size_t count) {
+        mData.ensureCapacity(mData.size() + count);
+        mInstanceMap.reserve(mInstanceMap.size() + count);
+    }
+
+    using Deadline = std::chrono::steady_clock::time_point;
+
     // trigger one round of garbage collection. this is intended to be called on a regular
-    // basis. This gc gives up after it cannot randomly free 'ratio' component in a row.
-    void gc(const EntityManager& em, size_t ratio = 4) noexcept {
+    // basis. This gc gives up after it cannot randomly free 'ratio' component in a row, or
+    // once the deadline is passed.
+    void gc(const EntityManager& em, size_t ratio = 4,
+            Deadline deadline = Deadline::max()) noexcept {
         gc(em, ratio, [this](Entity e) {
                     removeComponent(e);
-                });
+                }, deadline);
     }
 
     // return the first instance
@@ -232,10 +245,11 @@ protected:
 
     template<typename REMOVE>
     void gc(const EntityManager& em, size_t ratio,
-            REMOVE removeComponent) noexcept {
+            REMOVE removeComponent, Deadline deadline = Deadline::max()) noexcept {
         Entity const* entities = getEntities();
         size_t count = getComponentCount();
         size_t aliveInARow = 0;
+        size_t removed = 0;
         default_random_engine& rng = mRng;
         #pragma nounroll
         while (count && aliveInARow < ratio) {
@@ -248,6 +262,11 @@ protected:
             aliveInARow = 0;
             count--;
             removeComponent(entities[i]);
+            // the clock is only read every few removals, which are much more expensive
+            if (deadline != Deadline::max() && (++removed % 16) == 0 &&
+                    std::chrono::steady_clock::now() >= deadline) {
+                break;
+            }
         }
     }
 
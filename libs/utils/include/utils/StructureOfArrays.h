@@ -20,6 +20,7 @@
 #include <array>        // note: this is safe, see how std::array is used below (inline / private)
 #include <cstddef>
 #include <functional>
+#include <type_traits>
 #include <utility>
 
 #include <stddef.h>
@@ -28,17 +29,44 @@
 #include <string.h>
 
 #include <utils/Allocator.h>
+#include <utils/architecture.h>
 #include <utils/compiler.h>
 #include <utils/EntityInstance.h>
 #include <utils/Slice.h>
 
 namespace utils {
 
+/*
+ * Allocator adapter that aligns the start of each array of a StructureOfArraysBase to ALIGNMENT
+ * bytes, e.g. CACHELINE_SIZE so that no two arrays share a cache line.
+ */
+template<size_t ALIGNMENT, typename Allocator = HeapArena<>>
+class AlignedArraysAllocator : public Allocator {
+public:
+    static constexpr size_t ARRAY_ALIGNMENT = ALIGNMENT;
+    void* alloc(size_t size) { return Allocator::alloc(size, ALIGNMENT); }
+};
+
+namespace details {
+template<typename Allocator, typename = void>
+struct ArrayAlignment {
+    // by default, we align each array to the same alignment guaranteed by malloc
+    static constexpr size_t value = alignof(std::max_align_t);
+};
+template<typename Allocator>
+struct ArrayAlignment<Allocator, std::void_t<decltype(Allocator::ARRAY_ALIGNMENT)>> {
+    static constexpr size_t value = Allocator::ARRAY_ALIGNMENT;
+};
+} // namespace details
+
 template <typename Allocator, typename ... Elements>
 class StructureOfArraysBase {
     // number of elements
     static constexpr const size_t kArrayCount = sizeof...(Elements);
 
+    // alignment of the start of each array
+    static constexpr const size_t kArrayAlignment = details::ArrayAlignment<Allocator>::value;
+
 public:
     using SoA = StructureOfArraysBase<Allocator, Elements ...>;
 
@@ -358,6 +386,25 @@ public:
         return *this;
     }
 
+    // Appends count elements to each array, copied from one source array per array of the SoA.
+    // Arrays of trivially copyable types are copied with memcpy().
+    StructureOfArraysBase& append(size_t count, Elements const* ... arrays) {
+        ensureCapacity(mSize + count);
+        const size_t first = mSize;
+        size_t i = 0;
+        int UTILS_UNUSED dummy[] = {
+                (copy_construct(getArray<Elements>(i) + first, arrays, count), i++, 0)... };
+        mSize += count;
+        return *this;
+    }
+
+    // Hints the CPU to load the index'th element of the ElementIndex'th array in the cache.
+    // Useful when the elements are not accessed in order, e.g. through a list of indices.
+    template<size_t ElementIndex>
+    void prefetch(size_t index) const noexcept {
+        UTILS_PREFETCH(data<ElementIndex>() + index);
+    }
+
     template<typename F, typename ... ARGS>
     void forEach(F&& f, ARGS&& ... args) {
         size_t i = 0;
@@ -519,8 +566,7 @@ private:
         // compute the required size of each array
         const size_t sizes[] = { (sizeof(Elements) * capacity)... };
 
-        // we align each array to the same alignment guaranteed by malloc
-        const size_t align = alignof(std::max_align_t);
+        const size_t align = kArrayAlignment;
 
         // hopefully most of this gets unrolled and inlined
         std::array<size_t, kArrayCount> offsets;
@@ -544,6 +590,20 @@ private:
         });
     }
 
+    template<typename T>
+    static void copy_construct(T* UTILS_RESTRICT dst, T const* UTILS_RESTRICT src,
+            size_t count) {
+        if (std::is_trivially_copyable<T>::value) {
+            if (count) {
+                memcpy(dst, src, count * sizeof(T));
+            }
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                new(dst + i) T(src[i]);
+            }
+        }
+    }
+
     void destroy_each(size_t from, size_t to) noexcept {
         forEach([from, to](auto p) {
             using T = typename std::decay<decltype(*p)>::type;
@@ -640,6 +700,11 @@ StructureOfArraysBase<Allocator, Elements...>::StructureRef::assign(
 template <typename ... Elements>
 using StructureOfArrays = StructureOfArraysBase<HeapArena<>, Elements ...>;
 
+// a StructureOfArrays whose arrays each start on their own cache line
+template <typename ... Elements>
+using AlignedStructureOfArrays =
+        StructureOfArraysBase<AlignedArraysAllocator<CACHELINE_SIZE>, Elements ...>;
+
 } // namespace utils
 
 #endif // TNT_UTILS_STRUCTUREOFARRAYS_H
@@ -24,13 +24,9 @@
 #define SYSTRACE_TAG_JOBSYSTEM      (1<<2)
 
 
-#if defined(ANDROID)
-
 #include <atomic>
 
 #include <stdint.h>
-#include <stdio.h>
-#include <unistd.h>
 
 #include <utils/compiler.h>
 
@@ -104,6 +100,11 @@
 // No user serviceable code below...
 // ------------------------------------------------------------------------------------------------
 
+#if defined(ANDROID)
+
+#include <stdio.h>
+#include <unistd.h>
+
 namespace utils {
 namespace details {
 
@@ -195,7 +196,84 @@ private:
     static bool isTracingEnabled(uint32_t tag) noexcept;
 };
 
+} // namespace details
+} // namespace utils
+
 // ------------------------------------------------------------------------------------------------
+#else // !ANDROID
+// ------------------------------------------------------------------------------------------------
+
+#include <utils/TraceRecorder.h>
+
+namespace utils {
+namespace details {
+
+// Without atrace, events are recorded in-process by utils::TraceRecorder.
+class Systrace {
+public:
+
+    enum tags {
+        NEVER       = SYSTRACE_TAG_NEVER,
+        ALWAYS      = SYSTRACE_TAG_ALWAYS,
+        FILAMENT    = SYSTRACE_TAG_FILAMENT,
+        JOBSYSTEM   = SYSTRACE_TAG_JOBSYSTEM
+    };
+
+    Systrace(uint32_t tag) noexcept
+            : mIsTracingEnabled(tag && TraceRecorder::isRecording(tag)) {
+    }
+
+    static void enable(uint32_t tags) noexcept { TraceRecorder::enable(tags); }
+    static void disable(uint32_t tags) noexcept { TraceRecorder::disable(tags); }
+
+    inline void asyncBegin(uint32_t tag, const char* name, int32_t cookie) noexcept {
+        if (tag && UTILS_UNLIKELY(mIsTracingEnabled)) {
+            TraceRecorder::record(TraceRecorder::EventType::ASYNC_BEGIN, name, cookie);
+        }
+    }
+
+    inline void asyncEnd(uint32_t tag, const char* name, int32_t cookie) noexcept {
+        if (tag && UTILS_UNLIKELY(mIsTracingEnabled)) {
+            TraceRecorder::record(TraceRecorder::EventType::ASYNC_END, name, cookie);
+        }
+    }
+
+    inline void value(uint32_t tag, const char* name, int32_t value) noexcept {
+        if (tag && UTILS_UNLIKELY(mIsTracingEnabled)) {
+            TraceRecorder::record(TraceRecorder::EventType::COUNTER, name, value);
+        }
+    }
+
+    inline void value(uint32_t tag, const char* name, int64_t value) noexcept {
+        if (tag && UTILS_UNLIKELY(mIsTracingEnabled)) {
+            TraceRecorder::record(TraceRecorder::EventType::COUNTER, name, value);
+        }
+    }
+
+    inline void traceBegin(uint32_t tag, const char* name) noexcept {
+        if (tag && UTILS_UNLIKELY(mIsTracingEnabled)) {
+            TraceRecorder::record(TraceRecorder::EventType::BEGIN, name);
+        }
+    }
+
+    inline void traceEnd(uint32_t tag) noexcept {
+        if (tag && UTILS_UNLIKELY(mIsTracingEnabled)) {
+            TraceRecorder::record(TraceRecorder::EventType::END, nullptr);
+        }
+    }
+
+private:
+    // sampled once per context, so that a scope's begin and end are always both recorded
+    bool mIsTracingEnabled;
+};
+
+} // namespace details
+} // namespace utils
+
+#endif // ANDROID
+
+namespace utils {
+namespace details {
 
 class ScopedTrace {
 public:
@@ -224,22 +302,4 @@ private:
 } // namespace details
 } // namespace utils
 
-// ------------------------------------------------------------------------------------------------
-#else // !ANDROID
-// ------------------------------------------------------------------------------------------------
-
-#define SYSTRACE_ENABLE()
-#define SYSTRACE_DISABLE()
-#define SYSTRACE_CONTEXT()
-#define SYSTRACE_NAME(name)
-#define SYSTRACE_NAME_BEGIN(name)
-#define SYSTRACE_NAME_END()
-#define SYSTRACE_CALL()
-#define SYSTRACE_ASYNC_BEGIN(name, cookie)
-#define SYSTRACE_ASYNC_END(name, cookie)
-#define SYSTRACE_VALUE32(name, val)
-#define SYSTRACE_VALUE64(name, val)
-
-#endif // ANDROID
-
 #endif // TNT_UTILS_SYSTRACE_H
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_UTILS_TRACERECORDER_H
+#define TNT_UTILS_TRACERECORDER_H
+
+#include <utils/compiler.h>
+
+#include <atomic>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace utils {
+
+namespace io {
+class ostream;
+} // namespace io
+
+/*
+ * TraceRecorder is an in-process recorder for the SYSTRACE_ macros, used on platforms that
+ * don't have atrace (i.e. everything but Android).
+ *
+ * Each thread records its events in its own ring buffer, without locks, with a nanosecond
+ * timestamp. When the ring buffer is full, the oldest events are overwritten. The recorded
+ * events can be written as a Chrome JSON trace, which can be opened with chrome://tracing or
+ * ui.perfetto.dev.
+ *
+ * Only the tags enabled with SYSTRACE_ENABLE() are recorded, and only between start() and
+ * stop(). Otherwise, the cost of a SYSTRACE_ macro is a single relaxed atomic load.
+ *
+ *  TraceRecorder::start();
+ *  // ... render a few frames ...
+ *  TraceRecorder::stop();
+ *  TraceRecorder::dump("filament.json");
+ */
+class UTILS_PUBLIC TraceRecorder {
+public:
+    // number of events kept per thread, each event uses 64 bytes.
+    static constexpr size_t EVENTS_PER_THREAD = 16384;
+
+    // starts recording the enabled tags, the events already recorded are kept.
+    static void start() noexcept;
+
+    // stops recording. Must be called before dump() or clear().
+    static void stop() noexcept;
+
+    // discards all recorded events.
+    static void clear() noexcept;
+
+    // number of events currently held by all ring buffers
+    static size_t getEventCount() noexcept;
+
+    // writes all recorded events as a Chrome JSON trace
+    static void dump(io::ostream& out) noexcept;
+
+    // same as above, but to a file. Returns false if the file couldn't be written.
+    static bool dump(const char* path) noexcept;
+
+    // --------------------------------------------------------------------------------------------
+    // used by the SYSTRACE_ macros
+
+    enum class EventType : uint8_t {
+        BEGIN, END, ASYNC_BEGIN, ASYNC_END, COUNTER
+    };
+
+    static void enable(uint32_t tags) noexcept;
+    static void disable(uint32_t tags) noexcept;
+
+    static bool isRecording(uint32_t tag) noexcept {
+        return bool(sActiveTags.load(std::memory_order_relaxed) & tag);
+    }
+
+    // name is copied and truncated to the size of an event
+    static void record(EventType type, const char* name, int64_t value = 0) noexcept;
+
+private:
+    static void update() noexcept;
+
+    // enabled tags while recording, 0 otherwise
+    static std::atomic<uint32_t> sActiveTags;
+};
+
+} // namespace utils
+
+#endif // TNT_UTILS_TRACERECORDER_H
@@ -120,6 +120,16 @@
 #   define UTILS_HAS_THREADING 1
 #endif
 
+// Whether the JobSystem can run worker threads. WebAssembly builds with pthreads have them, but
+// the WebGL context belongs to the browser's main thread, so the engine still runs its driver on
+// the main thread there (UTILS_HAS_THREADING is 0).
+#if (defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)) || \
+        defined(FILAMENT_SINGLE_THREADED)
+#   define UTILS_HAS_WORKER_THREADS 0
+#else
+#   define UTILS_HAS_WORKER_THREADS 1
+#endif
+
 #if __has_attribute(noinline)
 #define UTILS_NOINLINE __attribute__((noinline))
 #else
@@ -30,6 +30,7 @@
 #include <tsl/robin_map.h>
 #endif
 
+#include <atomic>
 #include <deque>
 #include <mutex> // for std::lock_guard
 #include <vector>
@@ -48,18 +49,37 @@ public:
     using EntityManager::destroy;
 
     void create(size_t n, Entity* entities) {
+#if !FILAMENT_UTILS_TRACK_ENTITIES
+        // Fast path: as long as the free list is short, we only hand out fresh indices, which
+        // doesn't require the lock. A whole batch is reserved with a single CAS.
+        Entity::Type first;
+        if (mFreeListSize.load(std::memory_order_relaxed) < MIN_FREE_INDICES &&
+                takeFreshIndices(n, first)) {
+            // fresh indices have never been destroyed, so nobody else touches their generation
+            uint8_t const* const gens = mGens;
+            for (size_t i = 0; i < n; i++) {
+                Entity::Type const index = Entity::Type(first + i);
+                entities[i] = Entity{ makeIdentity(gens[index], index) };
+            }
+            return;
+        }
+#endif
+
         Entity::Type index{};
         auto& freeList = mFreeList;
         uint8_t* const gens = mGens;
 
         // this must be thread-safe, acquire the free-list mutex
         std::lock_guard<Mutex> lock(mFreeListLock);
-        Entity::Type currentIndex = mCurrentIndex;
         for (size_t i = 0; i < n; i++) {
             // If we have more than a certain number of freed indices, get one from the list.
             // this is a trade-off between how often we recycle indices and how large the free list
             // can grow.
-            if (UTILS_UNLIKELY(currentIndex >= RAW_INDEX_COUNT || freeList.size() >= MIN_FREE_INDICES)) {
+            // In the common case, we just grab the next index.
+            // This works only until all indices have been used once, at which point
+            // we're always in the slower case below. The idea is that we have enough indices
+            // that it doesn't happen in practice.
+            if (UTILS_UNLIKELY(freeList.size() >= MIN_FREE_INDICES || !takeFreshIndices(1, index))) {
 
                 // this could only happen if we had gone through all the indices at least once
                 if (UTILS_UNLIKELY(freeList.empty())) {
@@ -70,19 +90,13 @@ public:
 
                 index = freeList.front();
                 freeList.pop_front();
-            } else {
-                // In the common case, we just grab the next index.
-                // This works only until all indices have been used once, at which point
-                // we're always in the slower case above. The idea is that we have enough indices
-                // that it doesn't happen in practice.
-                index = currentIndex++;
             }
             entities[i] = Entity{ makeIdentity(gens[index], index) };
 #if FILAMENT_UTILS_TRACK_ENTITIES
             mDebugActiveEntities.emplace(entities[i], CallStack::unwind(5));
 #endif
         }
-        mCurrentIndex = currentIndex;
+        mFreeListSize.store(uint32_t(freeList.size()), std::memory_order_relaxed);
     }
 
     void destroy(size_t n, Entity* entities) noexcept {
@@ -117,6 +131,7 @@ public:
 #endif
             }
         }
+        mFreeListSize.store(uint32_t(freeList.size()), std::memory_order_relaxed);
         lock.unlock();
 
         // notify our listeners that some entities are being destroyed
@@ -167,11 +182,26 @@ public:
 #endif
 
 private:
-    uint32_t mCurrentIndex = 1;
+    // reserves n consecutive never-used indices, returns false if there aren't enough left
+    bool takeFreshIndices(size_t n, Entity::Type& first) noexcept {
+        uint32_t current = mCurrentIndex.load(std::memory_order_relaxed);
+        while (current + n <= RAW_INDEX_COUNT) {
+            if (mCurrentIndex.compare_exchange_weak(current, uint32_t(current + n),
+                    std::memory_order_relaxed)) {
+                first = current;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::atomic<uint32_t> mCurrentIndex{ 1 };
 
     // stores indices that got freed
     mutable Mutex mFreeListLock;
     std::deque<Entity::Type> mFreeList;
+    // size of mFreeList, readable without the lock
+    std::atomic<uint32_t> mFreeListSize{ 0 };
 
     mutable Mutex mListenerLock;
     tsl::robin_set<Listener*> mListeners;
@@ -26,9 +26,11 @@ static constexpr bool DEBUG_FINISH_HANGS = false;
 
 #include <utils/JobSystem.h>
 
+#include <chrono>
 #include <cmath>
 #include <random>
 
+#include <utils/algorithm.h>
 #include <utils/compiler.h>
 #include <utils/memalign.h>
 #include <utils/Panic.h>
@@ -69,6 +71,19 @@ static constexpr bool DEBUG_FINISH_HANGS = false;
 
 namespace utils {
 
+using StatisticsClock = std::chrono::steady_clock;
+
+// statistics are only written by the thread that owns them, so there is no need for an RMW
+template<typename T>
+static inline void increment(std::atomic<T>& counter, T value) noexcept {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+static inline uint64_t nanosecondsSince(StatisticsClock::time_point start) noexcept {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            StatisticsClock::now() - start).count());
+}
+
 void JobSystem::setThreadName(const char* name) noexcept {
 #if defined(__linux__)
     pthread_setname_np(pthread_self(), name);
@@ -127,7 +142,7 @@ JobSystem::JobSystem(const size_t userThreadCount, const size_t adoptableThreads
         // one of the thread will be the user thread
         threadPoolCount = hwThreads - 1;
     }
-    threadPoolCount = std::min(UTILS_HAS_THREADING ? 32 : 0, threadPoolCount);
+    threadPoolCount = std::min(UTILS_HAS_WORKER_THREADS ? 32 : 0, threadPoolCount);
 
     mThreadStates = aligned_vector<ThreadState>(threadPoolCount + adoptableThreadsCount);
     mThreadCount = uint16_t(threadPoolCount);
@@ -207,6 +222,10 @@ inline bool JobSystem::hasActiveJobs() const noexcept {
     return mActiveJobs.load(std::memory_order_relaxed) > 0;
 }
 
+inline bool JobSystem::hasActiveBackgroundJobs() const noexcept {
+    return mActiveBackgroundJobs.load(std::memory_order_relaxed) > 0;
+}
+
 inline bool JobSystem::hasJobCompleted(JobSystem::Job const* job) noexcept {
     return job->runningJobCount.load(std::memory_order_relaxed) <= 0;
 }
@@ -290,41 +309,72 @@ inline JobSystem::ThreadState* JobSystem::getStateToStealFrom(JobSystem::ThreadS
     return stateToStealFrom;
 }
 
-JobSystem::Job* JobSystem::steal(JobSystem::ThreadState& state) noexcept {
+JobSystem::Job* JobSystem::steal(JobSystem::ThreadState& state, bool background) noexcept {
     HEAVY_SYSTRACE_CALL();
     Job* job = nullptr;
+    uint32_t attempts = 0;
     do {
         ThreadState* const stateToStealFrom = getStateToStealFrom(state);
         if (UTILS_LIKELY(stateToStealFrom)) {
             job = steal(stateToStealFrom->workQueue);
+            attempts++;
+        }
+        // background jobs are only considered once we failed to find a normal one
+        if (!job && background) {
+            job = pop(state.backgroundQueue);
+            if (!job && stateToStealFrom) {
+                job = steal(stateToStealFrom->backgroundQueue);
+            }
         }
         // nullptr -> nothing to steal in that queue either, if there are active jobs,
         // continue to try stealing one.
-    } while (!job && hasActiveJobs());
+    } while (!job && (hasActiveJobs() || (background && hasActiveBackgroundJobs())));
+
+    if (UTILS_UNLIKELY(mStatisticsEnabled.load(std::memory_order_relaxed))) {
+        increment(state.statistics.stealAttempts, attempts);
+        increment(state.statistics.stealCount, uint32_t(job != nullptr));
+    }
     return job;
 }
 
-bool JobSystem::execute(JobSystem::ThreadState& state) noexcept {
+bool JobSystem::execute(JobSystem::ThreadState& state, bool background) noexcept {
     HEAVY_SYSTRACE_CALL();
 
     Job* job = pop(state.workQueue);
     if (UTILS_UNLIKELY(job == nullptr)) {
         // our queue is empty, try to steal a job
-        job = steal(state);
+        job = steal(state, background);
     }
 
     if (job) {
         assert(job->runningJobCount.load(std::memory_order_relaxed) >= 1);
 
+        auto& activeJobsCounter = (job->flags.load(std::memory_order_relaxed) & BACKGROUND) ?
+                mActiveBackgroundJobs : mActiveJobs;
         UTILS_UNUSED_IN_RELEASE
-        uint32_t activeJobs = mActiveJobs.fetch_sub(1, std::memory_order_relaxed);
+        uint32_t activeJobs = activeJobsCounter.fetch_sub(1, std::memory_order_relaxed);
         assert(activeJobs); // whoops, we were already at 0
         HEAVY_SYSTRACE_VALUE32("JobSystem::activeJobs", activeJobs - 1);
 
+        const bool statistics = mStatisticsEnabled.load(std::memory_order_relaxed);
+        const StatisticsClock::time_point start =
+                UTILS_UNLIKELY(statistics) ? StatisticsClock::now() : StatisticsClock::time_point{};
+
         if (UTILS_LIKELY(job->function)) {
             HEAVY_SYSTRACE_NAME("job->function");
             job->function(job->storage, *this, job);
         }
+
+        if (UTILS_UNLIKELY(statistics)) {
+            const uint64_t duration = nanosecondsSince(start);
+            const uint32_t us = uint32_t(std::min(duration / 1000u, uint64_t(0xFFFFFFFFu)));
+            const size_t bucket = std::min(us ? size_t(32u - clz(us)) : size_t(0),
+                    ThreadStatistics::HISTOGRAM_BUCKET_COUNT - 1);
+            increment(state.statistics.busyTime, duration);
+            increment(state.statistics.jobCount, 1u);
+            increment(state.statistics.jobDurations[bucket], 1u);
+        }
+
         finish(job);
     }
     return job != nullptr;
@@ -346,12 +396,18 @@ void JobSystem::loop(ThreadState* state) noexcept {
 
     // run our main loop...
     do {
-        if (!execute(*state)) {
+        if (!execute(*state, true)) {
+            const bool statistics = mStatisticsEnabled.load(std::memory_order_relaxed);
+            const StatisticsClock::time_point start =
+                    statistics ? StatisticsClock::now() : StatisticsClock::time_point{};
             std::unique_lock<Mutex> lock(mWaiterLock);
-            while (!exitRequested() && !hasActiveJobs()) {
+            while (!exitRequested() && !hasActiveJobs() && !hasActiveBackgroundJobs()) {
                 wait(lock);
                 setThreadAffinityById(state->id);
             }
+            if (statistics) {
+                increment(state->statistics.idleTime, nanosecondsSince(start));
+            }
         }
     } while (!exitRequested());
 }
@@ -375,6 +431,11 @@ void JobSystem::finish(Job* job) noexcept {
             Job* const parent = job->parent == 0x7FFF ? nullptr : &storage[job->parent];
             decRef(job);
             job = parent;
+        } else if (runningJobCount == 2 &&
+                (job->flags.load(std::memory_order_relaxed) & CONTINUATION)) {
+            // the only thing left to do for this continuation is to execute it
+            schedule(job);
+            break;
         } else {
             // there is still work (e.g.: children), we're done.
             break;
@@ -387,6 +448,20 @@ void JobSystem::finish(Job* job) noexcept {
     }
 }
 
+void JobSystem::schedule(Job* job) noexcept {
+    // This is only used for continuations, which are rare enough that we can afford looking-up
+    // the state of the current thread.
+    ThreadState& state(getState());
+
+    // Clear the flag so that children created by the continuation itself don't schedule it
+    // again. This happens before the job can be seen by another thread.
+    const bool background = job->flags.fetch_and(uint8_t(~CONTINUATION),
+            std::memory_order_relaxed) & BACKGROUND;
+    (background ? mActiveBackgroundJobs : mActiveJobs).fetch_add(1, std::memory_order_relaxed);
+    put(background ? state.backgroundQueue : state.workQueue, job);
+    wake();
+}
+
 // -----------------------------------------------------------------------------------------------
 // public API...
 
@@ -414,6 +489,16 @@ JobSystem::Job* JobSystem::create(JobSystem::Job* parent, JobFunc func) noexcept
     return job;
 }
 
+JobSystem::Job* JobSystem::makeContinuation(Job* job) noexcept {
+    assert(job->runningJobCount.load(std::memory_order_relaxed) == 1);
+    // The extra count is released by run(). Whoever brings the count from 2 to 1 (i.e. only
+    // the execution of the job itself is left) schedules it, be it run() or the last child to
+    // finish. Since the flag is set before any child exists, there is no race.
+    job->flags.fetch_or(CONTINUATION, std::memory_order_relaxed);
+    job->runningJobCount.fetch_add(1, std::memory_order_relaxed);
+    return job;
+}
+
 void JobSystem::cancel(Job*& job) noexcept {
     finish(job);
     job = nullptr;
@@ -437,14 +522,32 @@ void JobSystem::signal() noexcept {
 void JobSystem::run(JobSystem::Job*& job, uint32_t flags) noexcept {
     HEAVY_SYSTRACE_CALL();
 
+    const uint8_t jobFlags = job->flags.fetch_or(uint8_t(flags), std::memory_order_relaxed);
+
+    if (UTILS_UNLIKELY(jobFlags & CONTINUATION)) {
+        // release the count taken by makeContinuation(), the job is scheduled once its children
+        // have completed, possibly right now.
+        auto runningJobCount = job->runningJobCount.fetch_sub(1, std::memory_order_acq_rel);
+        assert(runningJobCount >= 2);
+        if (runningJobCount == 2) {
+            schedule(job);
+        } else if (!(flags & DONT_SIGNAL)) {
+            wake();
+        }
+        job = nullptr;
+        return;
+    }
+
     ThreadState& state(getState());
 
     // increase the active job count before we add the job to the queue, because otherwise
     // the job could run and finish before the counter is incremented, which would trigger
     // an assert() in execute(). Either way, it's not "wrong", but the assert() is useful.
-    uint32_t activeJobs = mActiveJobs.fetch_add(1, std::memory_order_relaxed);
+    const bool background = flags & BACKGROUND;
+    uint32_t activeJobs = (background ? mActiveBackgroundJobs : mActiveJobs).fetch_add(1,
+            std::memory_order_relaxed);
 
-    put(state.workQueue, job);
+    put(background ? state.backgroundQueue : state.workQueue, job);
 
     HEAVY_SYSTRACE_VALUE32("JobSystem::activeJobs", activeJobs + 1);
 
@@ -471,9 +574,14 @@ void JobSystem::waitAndRelease(Job*& job) noexcept {
     assert(job);
     assert(job->refCount.load(std::memory_order_relaxed) >= 1);
 
+    // Only help with background jobs when waiting on one, or when we're the only thread that
+    // can run them. Otherwise a frame-critical wait could be stuck behind a long background job.
+    const bool background = (job->flags.load(std::memory_order_relaxed) & BACKGROUND) ||
+            mThreadCount == 0;
+
     ThreadState& state(getState());
     do {
-        if (!execute(state)) {
+        if (!execute(state, background)) {
             // test if job has completed first, to possibly avoid taking the lock
             if (hasJobCompleted(job)) {
                 break;
@@ -489,8 +597,15 @@ void JobSystem::waitAndRelease(Job*& job) noexcept {
             // continue to handle more jobs, as they get added.
 
             std::unique_lock<Mutex> lock(mWaiterLock);
-            if (!hasJobCompleted(job) && !hasActiveJobs() && !exitRequested()) {
+            if (!hasJobCompleted(job) && !hasActiveJobs() && !exitRequested() &&
+                    !(background && hasActiveBackgroundJobs())) {
+                const bool statistics = mStatisticsEnabled.load(std::memory_order_relaxed);
+                const StatisticsClock::time_point start =
+                        statistics ? StatisticsClock::now() : StatisticsClock::time_point{};
                 wait(lock, job);
+                if (statistics) {
+                    increment(state.statistics.idleTime, nanosecondsSince(start));
+                }
             }
         }
     } while (!hasJobCompleted(job) && !exitRequested());
@@ -502,8 +617,8 @@ void JobSystem::waitAndRelease(Job*& job) noexcept {
     release(job);
 }
 
-void JobSystem::runAndWait(JobSystem::Job*& job) noexcept {
-    runAndRetain(job);
+void JobSystem::runAndWait(JobSystem::Job*& job, uint32_t flags) noexcept {
+    runAndRetain(job, flags);
     waitAndRelease(job);
 }
 
@@ -551,9 +666,45 @@ void JobSystem::emancipate() {
     mThreadMap.erase(iter);
 }
 
+void JobSystem::setStatisticsEnabled(bool enabled) noexcept {
+    mStatisticsEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+size_t JobSystem::getStatistics(ThreadStatistics* out, size_t count) const noexcept {
+    auto const& states = mThreadStates;
+    for (size_t i = 0, n = std::min(count, states.size()); i < n; i++) {
+        auto const& statistics = states[i].statistics;
+        auto& s = out[i];
+        s.busyTime = statistics.busyTime.load(std::memory_order_relaxed);
+        s.idleTime = statistics.idleTime.load(std::memory_order_relaxed);
+        s.jobCount = statistics.jobCount.load(std::memory_order_relaxed);
+        s.stealAttempts = statistics.stealAttempts.load(std::memory_order_relaxed);
+        s.stealCount = statistics.stealCount.load(std::memory_order_relaxed);
+        for (size_t j = 0; j < ThreadStatistics::HISTOGRAM_BUCKET_COUNT; j++) {
+            s.jobDurations[j] = statistics.jobDurations[j].load(std::memory_order_relaxed);
+        }
+    }
+    return states.size();
+}
+
+void JobSystem::resetStatistics() noexcept {
+    for (auto& state : mThreadStates) {
+        auto& statistics = state.statistics;
+        statistics.busyTime.store(0, std::memory_order_relaxed);
+        statistics.idleTime.store(0, std::memory_order_relaxed);
+        statistics.jobCount.store(0, std::memory_order_relaxed);
+        statistics.stealAttempts.store(0, std::memory_order_relaxed);
+        statistics.stealCount.store(0, std::memory_order_relaxed);
+        for (auto& bucket : statistics.jobDurations) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
 io::ostream& operator<<(io::ostream& out, JobSystem const& js) {
     for (auto const& item : js.mThreadStates) {
-        out << size_t(item.id) << ": " << item.workQueue.getCount() << io::endl;
+        out << size_t(item.id) << ": " << item.workQueue.getCount()
+            << " (" << item.backgroundQueue.getCount() << " background)" << io::endl;
     }
     return out;
 }
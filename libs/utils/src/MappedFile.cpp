@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <utils/MappedFile.h>
+
+#include <utility>
+
+#if defined(WIN32)
+#   include <Windows.h>
+#elif defined(__EMSCRIPTEN__)
+#   include <stdio.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+namespace utils {
+
+#if defined(WIN32)
+
+MappedFile::MappedFile(const char* path) noexcept {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            // the view keeps the mapping alive
+            mData = (uint8_t const*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            mSize = mData ? size_t(size.QuadPart) : 0;
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+}
+
+void MappedFile::release() noexcept {
+    if (mData) {
+        UnmapViewOfFile(mData);
+    }
+}
+
+#elif defined(__EMSCRIPTEN__)
+
+MappedFile::MappedFile(const char* path) noexcept {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return;
+    }
+    fseek(file, 0, SEEK_END);
+    long const size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size > 0) {
+        uint8_t* data = new uint8_t[size];
+        if (fread(data, 1, size_t(size), file) == size_t(size)) {
+            mData = data;
+            mSize = size_t(size);
+        } else {
+            delete[] data;
+        }
+    }
+    fclose(file);
+}
+
+void MappedFile::release() noexcept {
+    delete[] mData;
+}
+
+#else
+
+MappedFile::MappedFile(const char* path) noexcept {
+    int const fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        // the mapping stays valid after the file is closed
+        void* const data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            mData = (uint8_t const*)data;
+            mSize = size_t(st.st_size);
+        }
+    }
+    close(fd);
+}
+
+void MappedFile::release() noexcept {
+    if (mData) {
+        munmap(const_cast<uint8_t*>(mData), mSize);
+    }
+}
+
+#endif
+
+MappedFile::MappedFile(MappedFile&& rhs) noexcept
+        : mData(rhs.mData), mSize(rhs.mSize) {
+    rhs.mData = nullptr;
+    rhs.mSize = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& rhs) noexcept {
+    if (this != &rhs) {
+        release();
+        mData = std::exchange(rhs.mData, nullptr);
+        mSize = std::exchange(rhs.mSize, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() noexcept {
+    release();
+}
+
+} // namespace utils
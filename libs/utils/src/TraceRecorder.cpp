@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <utils/TraceRecorder.h>
+
+#include <utils/Mutex.h>
+#include <utils/Systrace.h>
+#include <utils/sstream.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <stdio.h>
+#include <string.h>
+
+namespace utils {
+
+namespace {
+
+struct Event {
+    uint64_t timestamp;     // in nanoseconds
+    int64_t value;          // cookie or counter value
+    TraceRecorder::EventType type;
+    char name[47];
+};
+
+static_assert(sizeof(Event) == 64, "Event should be exactly one cache line");
+
+// The ring buffer of a thread. Only this thread writes to it, a reader must make sure that
+// the writer is stopped.
+struct ThreadBuffer {
+    static constexpr size_t MASK = TraceRecorder::EVENTS_PER_THREAD - 1;
+    static_assert((TraceRecorder::EVENTS_PER_THREAD & MASK) == 0,
+            "EVENTS_PER_THREAD must be a power of two");
+
+    explicit ThreadBuffer(uint32_t tid) : tid(tid) { }
+
+    size_t count() const noexcept {
+        return std::min<size_t>(head.load(std::memory_order_acquire),
+                TraceRecorder::EVENTS_PER_THREAD);
+    }
+
+    std::unique_ptr<Event[]> events{ new Event[TraceRecorder::EVENTS_PER_THREAD] };
+    std::atomic<uint64_t> head{};
+    uint32_t const tid;
+};
+
+// Buffers are never freed, so that the events of threads that exited can still be dumped.
+struct Registry {
+    Mutex lock;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    uint32_t enabledTags = 0;
+    bool recording = false;
+};
+
+Registry& getRegistry() noexcept {
+    static Registry registry;
+    return registry;
+}
+
+thread_local ThreadBuffer* tThreadBuffer = nullptr;
+
+UTILS_NOINLINE
+ThreadBuffer* registerThread() noexcept {
+    Registry& registry = getRegistry();
+    std::lock_guard<Mutex> guard(registry.lock);
+    registry.buffers.emplace_back(new ThreadBuffer(uint32_t(registry.buffers.size() + 1)));
+    return registry.buffers.back().get();
+}
+
+void writeName(io::ostream& out, const char* name) noexcept {
+    char buffer[2 * sizeof(Event::name) + 1];
+    char* p = buffer;
+    for (const char* s = name; *s; s++) {
+        char const c = *s;
+        if (c == '"' || c == '\\') {
+            *p++ = '\\';
+            *p++ = c;
+        } else if ((unsigned char)c >= 0x20) {
+            *p++ = c;
+        }
+    }
+    *p = 0;
+    out << buffer;
+}
+
+void writeTimestamp(io::ostream& out, uint64_t ns) noexcept {
+    // Chrome traces are in microseconds, we keep the nanoseconds as decimals
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%llu.%03u",
+            (unsigned long long)(ns / 1000u), unsigned(ns % 1000u));
+    out << buffer;
+}
+
+} // anonymous namespace
+
+std::atomic<uint32_t> TraceRecorder::sActiveTags{ 0 };
+
+void TraceRecorder::update() noexcept {
+    Registry const& registry = getRegistry();
+    uint32_t const tags = registry.recording ? (registry.enabledTags | SYSTRACE_TAG_ALWAYS) : 0;
+    sActiveTags.store(tags, std::memory_order_relaxed);
+}
+
+void TraceRecorder::enable(uint32_t tags) noexcept {
+    Registry& registry = getRegistry();
+    std::lock_guard<Mutex> guard(registry.lock);
+    registry.enabledTags |= tags;
+    update();
+}
+
+void TraceRecorder::disable(uint32_t tags) noexcept {
+    Registry& registry = getRegistry();
+    std::lock_guard<Mutex> guard(registry.lock);
+    registry.enabledTags &= ~tags;
+    update();
+}
+
+void TraceRecorder::start() noexcept {
+    Registry& registry = getRegistry();
+    std::lock_guard<Mutex> guard(registry.lock);
+    registry.recording = true;
+    update();
+}
+
+void TraceRecorder::stop() noexcept {
+    Registry& registry = getRegistry();
+    std::lock_guard<Mutex> guard(registry.lock);
+    registry.recording = false;
+    update();
+}
+
+void TraceRecorder::clear() noexcept {
+    Registry& registry = getRegistry();
+    std::lock_guard<Mutex> guard(registry.lock);
+    for (auto const& buffer : registry.buffers) {
+        buffer->head.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t TraceRecorder::getEventCount() noexcept {
+    Registry& registry = getRegistry();
+    std::lock_guard<Mutex> guard(registry.lock);
+    size_t count = 0;
+    for (auto const& buffer : registry.buffers) {
+        count += buffer->count();
+    }
+    return count;
+}
+
+void TraceRecorder::record(EventType type, const char* name, int64_t value) noexcept {
+    ThreadBuffer* buffer = tThreadBuffer;
+    if (UTILS_UNLIKELY(!buffer)) {
+        buffer = tThreadBuffer = registerThread();
+    }
+    uint64_t const head = buffer->head.load(std::memory_order_relaxed);
+    Event& event = buffer->events[head & ThreadBuffer::MASK];
+    event.timestamp = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    event.value = value;
+    event.type = type;
+    if (name) {
+        strncpy(event.name, name, sizeof(event.name) - 1);
+        event.name[sizeof(event.name) - 1] = 0;
+    } else {
+        event.name[0] = 0;
+    }
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void TraceRecorder::dump(io::ostream& out) noexcept {
+    Registry& registry = getRegistry();
+    std::lock_guard<Mutex> guard(registry.lock);
+    const char* separator = "\n";
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (auto const& buffer : registry.buffers) {
+        uint64_t const head = buffer->head.load(std::memory_order_acquire);
+        uint64_t const first = head - buffer->count();
+        for (uint64_t i = first; i < head; i++) {
+            Event const& event = buffer->events[i & ThreadBuffer::MASK];
+            out << separator << "{\"ph\":\"";
+            switch (event.type) {
+                case EventType::BEGIN:          out << "B";    break;
+                case EventType::END:            out << "E";    break;
+                case EventType::ASYNC_BEGIN:    out << "b";    break;
+                case EventType::ASYNC_END:      out << "e";    break;
+                case EventType::COUNTER:        out << "C";    break;
+            }
+            out << "\",\"pid\":1,\"tid\":" << buffer->tid << ",\"ts\":";
+            writeTimestamp(out, event.timestamp);
+            if (event.type != EventType::END) {
+                out << ",\"name\":\"";
+                writeName(out, event.name);
+                out << "\"";
+            }
+            if (event.type == EventType::ASYNC_BEGIN || event.type == EventType::ASYNC_END) {
+                out << ",\"cat\":\"filament\",\"id\":" << (long long)event.value;
+            } else if (event.type == EventType::COUNTER) {
+                out << ",\"args\":{\"value\":" << (long long)event.value << "}";
+            }
+            out << "}";
+            separator = ",\n";
+        }
+    }
+    out << "\n]}\n";
+}
+
+bool TraceRecorder::dump(const char* path) noexcept {
+    io::sstream json;
+    dump(json);
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    size_t const size = strlen(json.c_str());
+    bool const success = fwrite(json.c_str(), 1, size, file) == size;
+    return fclose(file) == 0 && success;
+}
+
+} // namespace utils
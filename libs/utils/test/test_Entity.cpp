@@ -16,7 +16,10 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "../src/EntityManagerImpl.h"
 #include <utils/NameComponentManager.h>
@@ -128,6 +131,44 @@ TEST(EntityTest, Lots) {
     // at this point, we should be getting indices from the free-list exclusively
 }
 
+TEST(EntityTest, ConcurrentBatches) {
+    EntityManagerImpl em;
+    constexpr size_t THREAD_COUNT = 4;
+    constexpr size_t BATCH_SIZE = 64;
+    constexpr size_t BATCH_COUNT = 64;
+
+    // batches are created concurrently, without the free list being involved
+    std::vector<Entity> entities(THREAD_COUNT * BATCH_SIZE * BATCH_COUNT);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < THREAD_COUNT; t++) {
+        threads.emplace_back([&em, &entities, t]() {
+            Entity* const p = entities.data() + t * BATCH_SIZE * BATCH_COUNT;
+            for (size_t i = 0; i < BATCH_COUNT; i++) {
+                em.create(BATCH_SIZE, p + i * BATCH_SIZE);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<uint32_t> ids;
+    for (Entity e : entities) {
+        EXPECT_TRUE(em.isAlive(e));
+        ids.push_back(e.getId());
+    }
+    std::sort(ids.begin(), ids.end());
+    EXPECT_EQ(std::unique(ids.begin(), ids.end()), ids.end());
+
+    // once the free list is long enough, batches recycle destroyed entities
+    em.destroy(entities.size(), entities.data());
+    Entity recycled[BATCH_SIZE];
+    em.create(BATCH_SIZE, recycled);
+    for (Entity e : recycled) {
+        EXPECT_TRUE(em.isAlive(e));
+        EXPECT_EQ(EntityManagerImpl::getGeneration(e), 1u);
+    }
+}
 
 TEST(EntityTest, NameComponent) {
 
@@ -176,3 +217,23 @@ TEST(EntityTest, NameComponent) {
 
     cm.gc(em);
 }
+
+TEST(EntityTest, GcDeadline) {
+    EntityManagerImpl em;
+    SingleInstanceComponentManager<int> cm;
+    std::vector<Entity> entities(256);
+    em.create(entities.size(), entities.data());
+    for (Entity e : entities) {
+        cm.addComponent(e);
+    }
+    em.destroy(entities.size(), entities.data());
+
+    // a passed deadline stops the collection after the first few removals
+    using Deadline = SingleInstanceComponentManager<int>::Deadline;
+    cm.gc(em, 4, std::chrono::steady_clock::now());
+    EXPECT_EQ(entities.size() - 16, cm.getComponentCount());
+
+    // the following rounds collect the remaining components
+    cm.gc(em, 4, Deadline::max());
+    EXPECT_EQ(0, cm.getComponentCount());
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <utils/InplaceFunction.h>
+
+#include <memory>
+#include <vector>
+
+using namespace utils;
+
+TEST(InplaceFunctionTest, Call) {
+    InplaceFunction<int(int, int)> f;
+    EXPECT_FALSE(f);
+
+    int offset = 10;
+    f = [offset](int a, int b) { return a + b + offset; };
+    EXPECT_TRUE(f);
+    EXPECT_EQ(f(1, 2), 13);
+}
+
+TEST(InplaceFunctionTest, CopyAndMove) {
+    auto p = std::make_shared<int>(42);
+    std::weak_ptr<int> weak = p;
+    {
+        InplaceFunction<int()> f([q = std::move(p)]() { return *q; });
+        InplaceFunction<int()> g(f);
+        EXPECT_EQ(weak.use_count(), 2);
+        InplaceFunction<int()> h(std::move(f));
+        EXPECT_FALSE(f);
+        EXPECT_EQ(weak.use_count(), 2);
+        EXPECT_EQ(g(), 42);
+        EXPECT_EQ(h(), 42);
+    }
+    // every copy of the captured state is destroyed exactly once
+    EXPECT_TRUE(weak.expired());
+}
+
+TEST(InplaceFunctionTest, Vector) {
+    std::vector<InplaceFunction<void()>> functions;
+    int count = 0;
+    for (int i = 0; i < 100; i++) {
+        functions.emplace_back([&count, i]() { count += i; });
+    }
+    for (auto const& f : functions) {
+        f();
+    }
+    EXPECT_EQ(count, 4950);
+}
@@ -24,6 +24,7 @@
 
 #include <array>
 #include <thread>
+#include <vector>
 #include <utils/Allocator.h>
 
 using namespace utils;
@@ -218,6 +219,120 @@ TEST(JobSystem, JobSystemParallelChildren) {
     js.emancipate();
 }
 
+TEST(JobSystem, JobSystemBackgroundChildren) {
+    JobSystem js;
+    js.adopt();
+
+    struct User {
+        std::atomic_int calls = {0};
+        void func(JobSystem&, JobSystem::Job*) {
+            calls++;
+        };
+    } j;
+
+    JobSystem::Job* root = js.createJob<User, &User::func>(nullptr, &j);
+    for (int i=0 ; i<256 ; i++) {
+        JobSystem::Job* job = js.createJob<User, &User::func>(root, &j);
+        js.run(job, JobSystem::BACKGROUND | JobSystem::DONT_SIGNAL);
+    }
+    js.runAndWait(root, JobSystem::BACKGROUND);
+
+    EXPECT_EQ(257, j.calls);
+
+    js.emancipate();
+}
+
+TEST(JobSystem, JobSystemBackgroundDoesntBlockWait) {
+    JobSystem js(1);
+    js.adopt();
+
+    // this background job can only finish once the normal jobs below are done, so waiting on
+    // them would deadlock if this thread picked it up.
+    std::atomic_bool done = { false };
+    JobSystem::Job* background = js.runAndRetain(jobs::createJob(js, nullptr, [&done] {
+        while (!done.load()) {
+            std::this_thread::yield();
+        }
+    }), JobSystem::BACKGROUND);
+
+    std::atomic_int calls = { 0 };
+    JobSystem::Job* root = js.createJob();
+    for (int i=0 ; i<16 ; i++) {
+        js.run(jobs::createJob(js, root, [&calls] { calls++; }));
+    }
+    js.runAndWait(root);
+    EXPECT_EQ(16, calls.load());
+
+    done = true;
+    js.waitAndRelease(background);
+
+    js.emancipate();
+}
+
+TEST(JobSystem, JobSystemContinuation) {
+    JobSystem js;
+    js.adopt();
+
+    std::atomic_int calls = { 0 };
+    int seen = -1;
+    int seenByLast = -1;
+
+    // last runs after then, which runs after all the children
+    JobSystem::Job* last = js.makeContinuation(jobs::createJob(js, nullptr,
+            [&calls, &seenByLast] { seenByLast = calls.load(); }));
+    JobSystem::Job* then = js.makeContinuation(jobs::createJob(js, last,
+            [&calls, &seen] { seen = calls.load(); calls++; }));
+    for (int i=0 ; i<256 ; i++) {
+        js.run(jobs::createJob(js, then, [&calls] { calls++; }), JobSystem::DONT_SIGNAL);
+    }
+    js.run(then);
+    js.runAndWait(last);
+
+    EXPECT_EQ(256, seen);
+    EXPECT_EQ(257, seenByLast);
+
+    // a continuation without children runs right away
+    bool ran = false;
+    js.runAndWait(js.makeContinuation(jobs::createJob(js, nullptr, [&ran] { ran = true; })));
+    EXPECT_TRUE(ran);
+
+    js.emancipate();
+}
+
+TEST(JobSystem, JobSystemStatistics) {
+    JobSystem js;
+    js.adopt();
+    js.setStatisticsEnabled(true);
+
+    JobSystem::Job* root = js.createJob();
+    for (int i=0 ; i<64 ; i++) {
+        js.run(js.createJob(root), JobSystem::DONT_SIGNAL);
+    }
+    js.runAndWait(root);
+
+    std::vector<JobSystem::ThreadStatistics> stats(js.getStatistics(nullptr, 0));
+    EXPECT_EQ(stats.size(), js.getStatistics(stats.data(), stats.size()));
+    uint32_t jobCount = 0;
+    uint32_t histogramCount = 0;
+    for (auto const& s : stats) {
+        EXPECT_LE(s.stealCount, s.stealAttempts);
+        jobCount += s.jobCount;
+        for (uint32_t c : s.jobDurations) {
+            histogramCount += c;
+        }
+    }
+    EXPECT_EQ(65, jobCount);
+    EXPECT_EQ(65, histogramCount);
+
+    js.resetStatistics();
+    js.getStatistics(stats.data(), stats.size());
+    for (auto const& s : stats) {
+        EXPECT_EQ(0, s.jobCount);
+    }
+
+    js.emancipate();
+}
+
 
 TEST(JobSystem, JobSystemSequentialChildren) {
     JobSystem js;
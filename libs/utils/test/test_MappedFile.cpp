@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <utils/MappedFile.h>
+#include <utils/Path.h>
+
+#include <fstream>
+#include <string>
+#include <utility>
+
+#include <string.h>
+
+using namespace utils;
+
+static std::string writeFile(const char* name, std::string const& content) {
+    Path const path = Path::concat(Path::getTemporaryDirectory(), name);
+    std::ofstream out(path.getPath(), std::ios::binary);
+    out.write(content.data(), content.size());
+    return path.getPath();
+}
+
+TEST(MappedFile, Content) {
+    std::string content(100000, 0);
+    for (size_t i = 0; i < content.size(); i++) {
+        content[i] = char(i * 7);
+    }
+    std::string const path = writeFile("test_MappedFile.bin", content);
+
+    MappedFile file(path.c_str());
+    ASSERT_TRUE(file.isValid());
+    ASSERT_EQ(content.size(), file.size());
+    EXPECT_EQ(0, memcmp(content.data(), file.data(), content.size()));
+
+    // the mapping is taken over by a move
+    uint8_t const* data = file.data();
+    MappedFile other(std::move(file));
+    EXPECT_FALSE(file.isValid());
+    EXPECT_EQ(data, other.data());
+    EXPECT_EQ(content.size(), other.size());
+
+    file = std::move(other);
+    EXPECT_TRUE(file.isValid());
+    EXPECT_FALSE(other.isValid());
+    EXPECT_EQ(uint8_t(99999 * 7), file.data()[99999]);
+
+    Path(path).unlinkFile();
+}
+
+TEST(MappedFile, Invalid) {
+    MappedFile missing("this/file/does/not/exist");
+    EXPECT_FALSE(missing.isValid());
+    EXPECT_EQ(0u, missing.size());
+
+    std::string const path = writeFile("test_MappedFile_empty.bin", "");
+    MappedFile empty(path.c_str());
+    EXPECT_FALSE(empty.isValid());
+    Path(path).unlinkFile();
+
+    MappedFile none;
+    EXPECT_FALSE(none.isValid());
+}
@@ -173,3 +173,37 @@ TEST(StructureOfArraysTest, Simple) {
     soa.push_back(0.0f, 1.0, std::move(destroyedFloat4));
 }
 
+
+TEST(StructureOfArraysTest, Append) {
+    StructureOfArrays<float, TestFloat4> soa;
+    soa.push_back(1.0f, TestFloat4{ 1 });
+
+    const float floats[] = { 2.0f, 3.0f, 4.0f };
+    const TestFloat4 float4s[] = { TestFloat4{ 2 }, TestFloat4{ 3 }, TestFloat4{ 4 } };
+    soa.append(3, floats, float4s);
+    EXPECT_EQ(4, soa.size());
+    for (size_t i = 0; i < 4; i++) {
+        EXPECT_EQ(float(i + 1), soa.elementAt<0>(i));
+        EXPECT_TRUE(soa.elementAt<1>(i) == TestFloat4{ float(i + 1) });
+    }
+
+    // appending nothing is allowed
+    soa.append(0, nullptr, nullptr);
+    EXPECT_EQ(4, soa.size());
+
+    // clearing keeps the capacity
+    const size_t capacity = soa.capacity();
+    soa.clear();
+    EXPECT_EQ(0, soa.size());
+    EXPECT_EQ(capacity, soa.capacity());
+}
+
+TEST(StructureOfArraysTest, AlignedArrays) {
+    AlignedStructureOfArrays<uint8_t, float, double> soa;
+    soa.resize(13);
+    EXPECT_EQ(0, uintptr_t(soa.data<0>()) % CACHELINE_SIZE);
+    EXPECT_EQ(0, uintptr_t(soa.data<1>()) % CACHELINE_SIZE);
+    EXPECT_EQ(0, uintptr_t(soa.data<2>()) % CACHELINE_SIZE);
+    EXPECT_TRUE((void*)soa.data<1>() >= (void*)(soa.data<0>() + soa.capacity()));
+    EXPECT_TRUE((void*)soa.data<2>() >= (void*)(soa.data<1>() + soa.capacity()));
+}
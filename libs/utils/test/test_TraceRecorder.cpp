@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#define SYSTRACE_TAG SYSTRACE_TAG_FILAMENT
+
+#include <utils/Systrace.h>
+#include <utils/TraceRecorder.h>
+#include <utils/sstream.h>
+
+#include <string>
+#include <thread>
+
+using namespace utils;
+
+#if !defined(ANDROID)
+
+static void tracedFunction() {
+    SYSTRACE_CALL();
+}
+
+TEST(TraceRecorder, NothingRecordedWhenStopped) {
+    TraceRecorder::clear();
+    SYSTRACE_ENABLE();
+    tracedFunction();
+    EXPECT_EQ(0u, TraceRecorder::getEventCount());
+    SYSTRACE_DISABLE();
+}
+
+TEST(TraceRecorder, NothingRecordedWhenDisabled) {
+    TraceRecorder::clear();
+    SYSTRACE_DISABLE();
+    TraceRecorder::start();
+    tracedFunction();
+    TraceRecorder::stop();
+    EXPECT_EQ(0u, TraceRecorder::getEventCount());
+}
+
+TEST(TraceRecorder, ChromeJson) {
+    TraceRecorder::clear();
+    SYSTRACE_ENABLE();
+    TraceRecorder::start();
+    {
+        SYSTRACE_NAME("outer \"scope\"");
+        SYSTRACE_VALUE32("counter", 42);
+        tracedFunction();
+    }
+    std::thread([]() {
+        SYSTRACE_CONTEXT();
+        SYSTRACE_ASYNC_BEGIN("async", 7);
+        SYSTRACE_ASYNC_END("async", 7);
+    }).join();
+    TraceRecorder::stop();
+    SYSTRACE_DISABLE();
+
+    EXPECT_EQ(7u, TraceRecorder::getEventCount());
+
+    io::sstream out;
+    TraceRecorder::dump(out);
+    std::string const json(out.c_str());
+    EXPECT_EQ(0u, json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+    EXPECT_NE(std::string::npos, json.find("\"name\":\"outer \\\"scope\\\"\""));
+    EXPECT_NE(std::string::npos, json.find("\"name\":\"tracedFunction\""));
+    EXPECT_NE(std::string::npos, json.find("\"args\":{\"value\":42}"));
+    EXPECT_NE(std::string::npos, json.find("\"ph\":\"b\""));
+    EXPECT_NE(std::string::npos, json.find("\"name\":\"async\",\"cat\":\"filament\",\"id\":7"));
+    EXPECT_EQ(json.size() - 4, json.rfind("\n]}\n"));
+
+    TraceRecorder::clear();
+    EXPECT_EQ(0u, TraceRecorder::getEventCount());
+}
+
+TEST(TraceRecorder, RingBufferWrapsAround) {
+    TraceRecorder::clear();
+    SYSTRACE_ENABLE();
+    TraceRecorder::start();
+    for (size_t i = 0; i < TraceRecorder::EVENTS_PER_THREAD; i++) {
+        tracedFunction();
+    }
+    TraceRecorder::stop();
+    SYSTRACE_DISABLE();
+    EXPECT_EQ(TraceRecorder::EVENTS_PER_THREAD, TraceRecorder::getEventCount());
+    TraceRecorder::clear();
+}
+
+#endif
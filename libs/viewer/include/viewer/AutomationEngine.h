@@ -19,6 +19,10 @@
 
 #include <viewer/AutomationSpec.h>
 
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace filament {
 
 class ColorGrading;
@@ -49,6 +53,11 @@ namespace viewer {
  * the first test case until the client unblocks it via signalBatchMode(). This is useful when
  * waiting for a large model file to become fully loaded. Batch mode also offers a query
  * (shouldClose) that is triggered after the last test has been invoked.
+ *
+ * Performance mode (exportPerformance) measures the cost of each settings permutation. Each test
+ * renders warmupFrameCount frames, then records the timings of the next measuredFrameCount frames
+ * reported by Renderer::getFrameTimings(). After the last test, the timings of all the tests are
+ * written to performance.csv and performance.json in the current folder.
  */
 class AutomationEngine {
 public:
@@ -82,6 +91,24 @@ public:
          * If true, the tick function writes out a settings JSON file before advancing.
          */
         bool exportSettings = false;
+
+        /**
+         * If true, the frame timings of each test are measured and written out as a cost table
+         * after the last test. This replaces sleepDuration and minFrameCount by the warm-up and
+         * measured frame counts, and enables the GPU timings of the passes while running.
+         */
+        bool exportPerformance = false;
+
+        /**
+         * Number of frames rendered after applying a settings object and before measuring its
+         * timings. This must cover the latency of the GPU timings, a few frames.
+         */
+        int warmupFrameCount = 10;
+
+        /**
+         * Number of frames whose timings are measured for each test in performance mode.
+         */
+        int measuredFrameCount = 60;
     };
 
     /**
@@ -210,6 +237,15 @@ public:
      */
     static void exportSettings(const Settings& settings, const char* filename);
 
+    /**
+     * Writes out the timings measured so far in performance mode, as a CSV file and a JSON file.
+     * This is called automatically after the last test, but can be used to save partial results.
+     *
+     * @param csvFilename  Desired CSV filename, or null to skip it.
+     * @param jsonFilename Desired JSON filename, or null to skip it.
+     */
+    void exportPerformance(const char* csvFilename, const char* jsonFilename) const;
+
     Options getOptions() const { return mOptions; }
     bool isRunning() const { return mIsRunning; }
     size_t currentTest() const { return mCurrentTest; }
@@ -219,6 +255,19 @@ public:
     ~AutomationEngine();
 
 private:
+    // Frame timings of one test in performance mode, all times are in seconds.
+    struct TestTimings {
+        std::string name;
+        std::vector<float> frameTimes;
+        std::vector<float> gpuFrameTimes;
+        double cullingTime = 0;
+        double froxelizationTime = 0;
+        double commandGenerationTime = 0;
+        std::vector<std::pair<std::string, double>> passTimes; // summed over the GPU frames
+    };
+
+    void recordTimings(Renderer* renderer, float deltaTime);
+
     AutomationSpec const * const mSpec;
     Settings * const mSettings;
     Options mOptions;
@@ -238,6 +287,9 @@ private:
     bool mTerminated = false;
     bool mOwnsSettings = false;
 
+    std::vector<TestTimings> mTimings;
+    uint32_t mLastFrameId = 0;
+
 public:
     // For internal use from a screenshot callback.
     void requestClose() { mShouldClose = true; }
@@ -20,15 +20,22 @@
 #include <viewer/Settings.h>
 
 #include <stddef.h>
+#include <stdint.h>
 #include <mutex>
 
 class CivetServer;
 
 namespace filament {
+
+class Engine;
+class MaterialInstance;
+class Renderer;
+
 namespace viewer {
 
 class MessageSender;
 class MessageReceiver;
+class TelemetryPageHandler;
 
 /**
  * Encapsulates a message sent from the web client.
@@ -49,6 +56,9 @@ struct ReceivedMessage {
  * Client apps can call peekReceivedMessage to check for new data, or acquireReceivedMessage
  * to pop it off the small internal queue. When they are done examining the message contents
  * they should call releaseReceivedMessage.
+ *
+ * The server also streams runtime metrics with sendTelemetry(). Opening http://<host>:<port>/
+ * in a browser shows a page that graphs them live.
  */
 class RemoteServer {
 public:
@@ -77,6 +87,22 @@ public:
     void sendMessage(const Settings& settings);
     void sendMessage(const char* label, const char* buffer, size_t bufsize);
 
+    /**
+     * Sends the metrics of the most recent frame to the connected clients, labeled
+     * "telemetry.json": the CPU and GPU timings of Renderer::getFrameTimings(), the command
+     * buffer and transient texture statistics of the Engine, the number of the given
+     * materials whose shader programs are still compiling, and the draw and state change
+     * counts of Renderer::getRenderStats() if enabled with Renderer::setRenderStatsEnabled().
+     *
+     * Call this once per frame, after Renderer::endFrame(). Nothing is sent if no client is
+     * connected or if no new frame timings are known. The GPU timings of the passes are only
+     * reported if enabled with Renderer::setPassTimingsEnabled().
+     *
+     * @param frameTime     The time between this frame and the previous one, in seconds.
+     */
+    void sendTelemetry(Engine* engine, Renderer* renderer, MaterialInstance* const* materials,
+            size_t materialCount, float frameTime);
+
     // For internal use (makes JNI simpler)
     ReceivedMessage const* peekReceivedMessage() const;
 
@@ -85,6 +111,8 @@ private:
     void setIncomingMessage(ReceivedMessage* message);
     MessageSender* mMessageSender = nullptr;
     MessageReceiver* mMessageReceiver = nullptr;
+    TelemetryPageHandler* mTelemetryPageHandler = nullptr;
+    uint32_t mLastTelemetryFrameId = 0;
     size_t mNextMessageUid = 0;
     static const size_t kMessageCapacity = 4;
     ReceivedMessage* mReceivedMessages[kMessageCapacity] = {};
@@ -26,6 +26,7 @@
 #include <utils/Log.h>
 #include <utils/Path.h>
 
+#include <algorithm>
 #include <iomanip>
 #include <fstream>
 #include <sstream>
@@ -80,6 +81,23 @@ static void exportScreenshot(View* view, Renderer* renderer, std::string filenam
             std::move(buffer));
 }
 
+static double mean(const std::vector<float>& samples) {
+    double sum = 0;
+    for (float sample : samples) {
+        sum += sample;
+    }
+    return samples.empty() ? 0.0 : sum / samples.size();
+}
+
+static double median(std::vector<float> samples) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    auto middle = samples.begin() + samples.size() / 2;
+    std::nth_element(samples.begin(), middle, samples.end());
+    return *middle;
+}
+
 AutomationEngine* AutomationEngine::createFromJSON(const char* jsonSpec, size_t size) {
     AutomationSpec* spec = AutomationSpec::generate(jsonSpec, size);
     if (!spec) {
@@ -137,6 +155,98 @@ void AutomationEngine::exportSettings(const Settings& settings, const char* file
     gStatus = "Exported to '" + std::string(filename) + "' in the current folder.";
 }
 
+void AutomationEngine::exportPerformance(const char* csvFilename,
+        const char* jsonFilename) const {
+    // All the times are exported in milliseconds.
+    auto ms = [](double seconds) { return seconds * 1000.0; };
+
+    if (csvFilename) {
+        std::ofstream out(csvFilename);
+        if (!out) {
+            gStatus = "Failed to export performance file.";
+            return;
+        }
+        out << "test,name,frames,frameTimeMean,frameTimeMedian,gpuFrames,gpuFrameTimeMean,"
+                "gpuFrameTimeMedian,cullingTime,froxelizationTime,commandGenerationTime\n";
+        for (size_t i = 0; i < mTimings.size(); i++) {
+            const TestTimings& test = mTimings[i];
+            const double gpuFrames = std::max(size_t(1), test.gpuFrameTimes.size());
+            out << i << ',' << test.name << ','
+                << test.frameTimes.size() << ','
+                << ms(mean(test.frameTimes)) << ','
+                << ms(median(test.frameTimes)) << ','
+                << test.gpuFrameTimes.size() << ','
+                << ms(mean(test.gpuFrameTimes)) << ','
+                << ms(median(test.gpuFrameTimes)) << ','
+                << ms(test.cullingTime / gpuFrames) << ','
+                << ms(test.froxelizationTime / gpuFrames) << ','
+                << ms(test.commandGenerationTime / gpuFrames) << '\n';
+        }
+    }
+
+    if (jsonFilename) {
+        std::ofstream out(jsonFilename);
+        if (!out) {
+            gStatus = "Failed to export performance file.";
+            return;
+        }
+        out << "[\n";
+        for (size_t i = 0; i < mTimings.size(); i++) {
+            const TestTimings& test = mTimings[i];
+            const double gpuFrames = std::max(size_t(1), test.gpuFrameTimes.size());
+            out << "  {\n"
+                << "    \"test\": " << i << ",\n"
+                << "    \"name\": \"" << test.name << "\",\n"
+                << "    \"frames\": " << test.frameTimes.size() << ",\n"
+                << "    \"frameTimeMean\": " << ms(mean(test.frameTimes)) << ",\n"
+                << "    \"frameTimeMedian\": " << ms(median(test.frameTimes)) << ",\n"
+                << "    \"gpuFrames\": " << test.gpuFrameTimes.size() << ",\n"
+                << "    \"gpuFrameTimeMean\": " << ms(mean(test.gpuFrameTimes)) << ",\n"
+                << "    \"gpuFrameTimeMedian\": " << ms(median(test.gpuFrameTimes)) << ",\n"
+                << "    \"cullingTime\": " << ms(test.cullingTime / gpuFrames) << ",\n"
+                << "    \"froxelizationTime\": " << ms(test.froxelizationTime / gpuFrames) << ",\n"
+                << "    \"commandGenerationTime\": "
+                        << ms(test.commandGenerationTime / gpuFrames) << ",\n"
+                << "    \"passes\": {";
+            for (size_t j = 0; j < test.passTimes.size(); j++) {
+                out << (j ? ",\n" : "\n") << "      \"" << test.passTimes[j].first << "\": "
+                    << ms(test.passTimes[j].second / gpuFrames);
+            }
+            out << (test.passTimes.empty() ? "}\n" : "\n    }\n")
+                << (i + 1 < mTimings.size() ? "  },\n" : "  }\n");
+        }
+        out << "]" << std::endl;
+    }
+
+    gStatus = "Exported performance to the current folder.";
+}
+
+void AutomationEngine::recordTimings(Renderer* renderer, float deltaTime) {
+    TestTimings& test = mTimings.back();
+    test.frameTimes.push_back(deltaTime);
+
+    // The GPU timings lag behind by a few frames, and are only recorded once per frame.
+    const Renderer::FrameTimings timings = renderer->getFrameTimings();
+    if (timings.frameId == 0 || timings.frameId == mLastFrameId) {
+        return;
+    }
+    mLastFrameId = timings.frameId;
+    test.gpuFrameTimes.push_back(timings.gpuFrameTime);
+    test.cullingTime += timings.cullingTime;
+    test.froxelizationTime += timings.froxelizationTime;
+    test.commandGenerationTime += timings.commandGenerationTime;
+    for (uint32_t i = 0; i < timings.passCount; i++) {
+        const char* name = timings.passes[i].name ? timings.passes[i].name : "unnamed";
+        auto pos = std::find_if(test.passTimes.begin(), test.passTimes.end(),
+                [name](auto const& pass) { return pass.first == name; });
+        if (pos == test.passTimes.end()) {
+            test.passTimes.emplace_back(name, timings.passes[i].gpuTime);
+        } else {
+            pos->second += timings.passes[i].gpuTime;
+        }
+    }
+}
+
 void AutomationEngine::applySettings(const char* json, size_t jsonLength, View* view,
         MaterialInstance* const* materials, size_t materialCount, IndirectLight* ibl,
         utils::Entity sunlight, LightManager* lm, Scene* scene, Renderer* renderer) {
@@ -190,6 +300,9 @@ void AutomationEngine::tick(View* view, MaterialInstance* const* materials, size
         for (size_t i = 0; i < materialCount; i++) {
             viewer::applySettings(mSettings->material, materials[i]);
         }
+        if (mOptions.exportPerformance) {
+            mTimings.push_back({ mSpec->getName(mCurrentTest) });
+        }
         if (mOptions.verbose) {
             utils::slog.i << "Running test " << mCurrentTest << utils::io::endl;
         }
@@ -201,6 +314,11 @@ void AutomationEngine::tick(View* view, MaterialInstance* const* materials, size
                 mIsRunning = true;
                 mRequestStart = false;
                 mCurrentTest = 0;
+                if (mOptions.exportPerformance) {
+                    mTimings.clear();
+                    mLastFrameId = 0;
+                    renderer->setPassTimingsEnabled(true);
+                }
                 activateTest();
             }
         }
@@ -210,7 +328,16 @@ void AutomationEngine::tick(View* view, MaterialInstance* const* materials, size
     mElapsedTime += deltaTime;
     mElapsedFrames++;
 
-    if (mElapsedTime < mOptions.sleepDuration || mElapsedFrames < mOptions.minFrameCount) {
+    if (mOptions.exportPerformance) {
+        if (mElapsedFrames <= mOptions.warmupFrameCount) {
+            return;
+        }
+        recordTimings(renderer, deltaTime);
+        if (mElapsedFrames < mOptions.warmupFrameCount + mOptions.measuredFrameCount) {
+            return;
+        }
+    } else if (mElapsedTime < mOptions.sleepDuration ||
+            mElapsedFrames < mOptions.minFrameCount) {
         return;
     }
 
@@ -233,6 +360,10 @@ void AutomationEngine::tick(View* view, MaterialInstance* const* materials, size
 
     if (isLastTest) {
         mIsRunning = false;
+        if (mOptions.exportPerformance) {
+            renderer->setPassTimingsEnabled(false);
+            exportPerformance("performance.csv", "performance.json");
+        }
         if (mBatchModeEnabled && !mOptions.exportScreenshots) {
             mShouldClose = true;
         }
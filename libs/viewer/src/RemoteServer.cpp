@@ -16,12 +16,23 @@
 
 #include <viewer/RemoteServer.h>
 
+#include <filament/Engine.h>
+#include <filament/Material.h>
+#include <filament/MaterialInstance.h>
+#include <filament/Renderer.h>
+
 #include <CivetServer.h>
 
 #include <utils/Log.h>
 
+#include <algorithm>
+#include <sstream>
 #include <vector>
 
+#include <string.h>
+
+#include "viewer_resources.h"
+
 using namespace utils;
 
 namespace filament {
@@ -31,6 +42,24 @@ class MessageSender : public CivetServer {
 public:
     MessageSender(const char** options) : CivetServer(options) {}
     void sendMessage(const char* label, const char* buffer, size_t bufsize);
+    void sendTextMessage(const char* label, const std::string& text);
+    bool hasConnections() const { return !connections.empty(); }
+};
+
+// Serves the page that graphs the telemetry sent by RemoteServer::sendTelemetry().
+class TelemetryPageHandler : public CivetHandler {
+public:
+    bool handleGet(CivetServer* server, struct mg_connection* conn) override {
+        const struct mg_request_info* request = mg_get_request_info(conn);
+        const std::string uri(request->request_uri);
+        if (uri != "/" && uri != "/telemetry.html") {
+            return false;
+        }
+        mg_printf(conn, "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\n"
+                "Connection: close\r\n\r\n");
+        mg_write(conn, VIEWER_RESOURCES_TELEMETRY_DATA, VIEWER_RESOURCES_TELEMETRY_SIZE - 1);
+        return true;
+    }
 };
 
 class MessageReceiver : public CivetWebSocketHandler {
@@ -63,12 +92,15 @@ RemoteServer::RemoteServer(int port) {
     }
     mMessageReceiver = new MessageReceiver(this);
     mMessageSender->addWebSocketHandler("", mMessageReceiver);
+    mTelemetryPageHandler = new TelemetryPageHandler();
+    mMessageSender->addHandler("", mTelemetryPageHandler);
     slog.i << "RemoteServer listening at ws://localhost:" << port << io::endl;
 }
 
 RemoteServer::~RemoteServer() {
     delete mMessageSender;
     delete mMessageReceiver;
+    delete mTelemetryPageHandler;
     for (auto msg : mReceivedMessages) {
         releaseReceivedMessage(msg);
     }
@@ -165,6 +197,82 @@ void RemoteServer::sendMessage(const char* label, const char* buffer, size_t buf
     mMessageSender->sendMessage(label, buffer, bufsize);
 }
 
+void RemoteServer::sendTelemetry(Engine* engine, Renderer* renderer,
+        MaterialInstance* const* materials, size_t materialCount, float frameTime) {
+    if (!mMessageSender->hasConnections()) {
+        return;
+    }
+
+    // The GPU timings lag behind by a few frames, only send each frame once.
+    const Renderer::FrameTimings timings = renderer->getFrameTimings();
+    if (timings.frameId == 0 || timings.frameId == mLastTelemetryFrameId) {
+        return;
+    }
+    mLastTelemetryFrameId = timings.frameId;
+
+    // Several instances usually share a material, count each material once.
+    std::vector<Material const*> compiling;
+    for (size_t i = 0; i < materialCount; i++) {
+        Material const* material = materials[i]->getMaterial();
+        if (!material->isReady() &&
+                std::find(compiling.begin(), compiling.end(), material) == compiling.end()) {
+            compiling.push_back(material);
+        }
+    }
+
+    const auto commands = engine->getCommandBufferStatistics();
+    const auto textures = engine->getTransientTextureCacheStatistics();
+    // only known if enabled with Renderer::setRenderStatsEnabled()
+    const Renderer::RenderStats stats = renderer->getRenderStats();
+    auto writeCounts = [](std::ostringstream& out, Renderer::RenderStats::Counts const& counts) {
+        out << "\"drawCalls\":" << counts.drawCalls
+            << ",\"primitives\":" << counts.primitives
+            << ",\"programChanges\":" << counts.programChanges
+            << ",\"pipelineChanges\":" << counts.pipelineChanges
+            << ",\"uniformBufferBinds\":" << counts.uniformBufferBinds
+            << ",\"samplerBinds\":" << counts.samplerBinds;
+    };
+
+    // All the times are sent in milliseconds.
+    std::ostringstream json;
+    json << "{\"frameId\":" << timings.frameId
+         << ",\"frameTime\":" << frameTime * 1000.0f
+         << ",\"gpuFrameTime\":" << timings.gpuFrameTime * 1000.0f
+         << ",\"cullingTime\":" << timings.cullingTime * 1000.0f
+         << ",\"froxelizationTime\":" << timings.froxelizationTime * 1000.0f
+         << ",\"commandGenerationTime\":" << timings.commandGenerationTime * 1000.0f
+         << ",\"passes\":[";
+    for (uint32_t i = 0; i < timings.passCount; i++) {
+        json << (i ? "," : "") << "{\"name\":\""
+             << (timings.passes[i].name ? timings.passes[i].name : "unnamed")
+             << "\",\"gpuTime\":" << timings.passes[i].gpuTime * 1000.0f << "}";
+    }
+    json << "],\"commandBuffer\":{\"capacity\":" << commands.capacity
+         << ",\"lastFrameSize\":" << commands.lastFrameSize
+         << ",\"peakFrameSize\":" << commands.peakFrameSize << "}"
+         << ",\"transientTextures\":{\"inUseSize\":" << textures.inUseSize
+         << ",\"cacheSize\":" << textures.cacheSize
+         << ",\"peakSize\":" << textures.peakSize
+         << ",\"hitCount\":" << textures.hitCount
+         << ",\"missCount\":" << textures.missCount << "}"
+         << ",\"compilingMaterials\":" << compiling.size();
+    if (stats.frameId) {
+        json << ",\"renderStats\":{";
+        writeCounts(json, stats.total);
+        json << ",\"passes\":[";
+        for (uint32_t i = 0; i < stats.passCount; i++) {
+            json << (i ? "," : "") << "{\"name\":\""
+                 << (stats.passes[i].name ? stats.passes[i].name : "unnamed") << "\",";
+            writeCounts(json, stats.passes[i].counts);
+            json << "}";
+        }
+        json << "]}";
+    }
+    json << "}";
+
+    mMessageSender->sendTextMessage("telemetry.json", json.str());
+}
+
 // NOTE: This is invoked off the main thread.
 bool MessageReceiver::handleData(CivetServer* server, struct mg_connection* conn, int bits,
                                   char* data, size_t size) {
@@ -212,5 +320,13 @@ void MessageSender::sendMessage(const char* label, const char* buffer, size_t bu
     }
 }
 
+// Text frames can be read by browsers, unlike the continuation frames of sendMessage().
+void MessageSender::sendTextMessage(const char* label, const std::string& text) {
+    for (auto iter : connections) {
+        mg_websocket_write(iter.first, MG_WEBSOCKET_OPCODE_TEXT, label, strlen(label));
+        mg_websocket_write(iter.first, MG_WEBSOCKET_OPCODE_TEXT, text.c_str(), text.size());
+    }
+}
+
 } // namespace viewer
 } // namespace filament
@@ -353,6 +353,29 @@ static int parse(jsmntok_t const* tokens, int i, const char* jsonChunk,
     return i;
 }
 
+static int parse(jsmntok_t const* tokens, int i, const char* jsonChunk,
+        AmbientOcclusionOptions::Temporal* out) {
+    CHECK_TOKTYPE(tokens[i], JSMN_OBJECT);
+    int size = tokens[i++].size;
+    for (int j = 0; j < size; ++j) {
+        const jsmntok_t tok = tokens[i];
+        CHECK_KEY(tok);
+        if (compare(tok, jsonChunk, "enabled") == 0) {
+            i = parse(tokens, i + 1, jsonChunk, &out->enabled);
+        } else if (compare(tok, jsonChunk, "feedback") == 0) {
+            i = parse(tokens, i + 1, jsonChunk, &out->feedback);
+        } else {
+            slog.w << "Invalid temporal AO key: '" << STR(tok, jsonChunk) << "'" << io::endl;
+            i = parse(tokens, i + 1);
+        }
+        if (i < 0) {
+            slog.e << "Invalid temporal AO value: '" << STR(tok, jsonChunk) << "'" << io::endl;
+            return i;
+        }
+    }
+    return i;
+}
+
 static int parse(jsmntok_t const* tokens, int i, const char* jsonChunk,
         AmbientOcclusionOptions* out) {
     CHECK_TOKTYPE(tokens[i], JSMN_OBJECT);
@@ -382,6 +405,8 @@ static int parse(jsmntok_t const* tokens, int i, const char* jsonChunk,
             i = parse(tokens, i + 1, jsonChunk, &out->minHorizonAngleRad);
         } else if (compare(tok, jsonChunk, "ssct") == 0) {
             i = parse(tokens, i + 1, jsonChunk, &out->ssct);
+        } else if (compare(tok, jsonChunk, "temporal") == 0) {
+            i = parse(tokens, i + 1, jsonChunk, &out->temporal);
         } else {
             slog.w << "Invalid AO key: '" << STR(tok, jsonChunk) << "'" << io::endl;
             i = parse(tokens, i + 1);
@@ -1079,6 +1104,13 @@ static std::ostream& operator<<(std::ostream& out, const AmbientOcclusionOptions
         << "}";
 }
 
+static std::ostream& operator<<(std::ostream& out, const AmbientOcclusionOptions::Temporal& in) {
+    return out << "{\n"
+        << "\"enabled\": " << to_string(in.enabled) << ",\n"
+        << "\"feedback\": " << (in.feedback) << "\n"
+        << "}";
+}
+
 static std::ostream& operator<<(std::ostream& out, const AmbientOcclusionOptions& in) {
     return out << "{\n"
         << "\"radius\": " << (in.radius) << ",\n"
@@ -1091,7 +1123,8 @@ static std::ostream& operator<<(std::ostream& out, const AmbientOcclusionOptions
         << "\"upsampling\": " << (in.upsampling) << ",\n"
         << "\"enabled\": " << to_string(in.enabled) << ",\n"
         << "\"minHorizonAngleRad\": " << (in.minHorizonAngleRad) << ",\n"
-        << "\"ssct\": " << (in.ssct) << "\n"
+        << "\"ssct\": " << (in.ssct) << ",\n"
+        << "\"temporal\": " << (in.temporal) << "\n"
         << "}";
 }
 
@@ -632,6 +632,8 @@ void SimpleViewer::updateUserInterface() {
             ImGui::SliderInt("Low Pass", &lowpass, 0, 2);
             ImGui::Checkbox("High quality upsampling", &upsampling);
             ImGui::SliderFloat("Min Horizon angle", &ssao.minHorizonAngleRad, 0.0f, (float)M_PI_4);
+            ImGui::Checkbox("Temporal accumulation", &ssao.temporal.enabled);
+            ImGui::SliderFloat("Temporal feedback", &ssao.temporal.feedback, 0.0f, 1.0f);
 
             ssao.upsampling = upsampling ? View::QualityLevel::HIGH : View::QualityLevel::LOW;
             ssao.lowPassFilter = (View::QualityLevel) lowpass;
@@ -43,8 +43,7 @@
 #include <filament/TransformManager.h>
 #include <filament/View.h>
 
-#include <image/ColorTransform.h>
-#include <imageio/ImageEncoder.h>
+#include <imageio/FrameSink.h>
 
 #include <math/mat3.h>
 #include <math/mat4.h>
@@ -83,6 +82,7 @@ static std::atomic_int g_savedFrames(0);
 static std::vector<Param> g_parameters;
 static std::string g_prefix;
 static uint32_t g_clearColor = 0x000000;
+static std::unique_ptr<FrameSink> g_frameSink;
 
 std::unique_ptr<MeshAssimp> g_meshSet;
 static std::map<std::string, MaterialInstance*> g_meshMaterialInstances;
@@ -241,6 +241,9 @@ static void cleanup(Engine* engine, View*, Scene*) {
     engine->destroy(g_light);
     EntityManager& em = EntityManager::get();
     em.destroy(g_light);
+
+    // waits for the last frames to be written
+    g_frameSink.reset();
 }
 
 static std::ifstream::pos_type getFileSize(const char* filename) {
@@ -282,6 +285,7 @@ static void readParameters() {
 }
 
 static void setup(Engine* engine, View* view, Scene* scene) {
+    g_frameSink = std::make_unique<FrameSink>(FrameSink::Config{});
     g_meshSet = std::make_unique<MeshAssimp>(*engine);
 
     readMaterial(engine);
@@ -362,7 +366,7 @@ static void postRender(Engine*, View* view, Scene*, Renderer* renderer) {
         frame -= 1;
 
         const Viewport& vp = view->getViewport();
-        uint8_t* pixels = new uint8_t[vp.width * vp.height * 3];
+        uint8_t* pixels = g_frameSink->acquireBuffer(vp.width * vp.height * 3);
 
         struct CaptureState {
             View* view = nullptr;
@@ -376,9 +380,6 @@ static void postRender(Engine*, View* view, Scene*, Renderer* renderer) {
                     CaptureState* state = static_cast<CaptureState*>(user);
                     const Viewport& v = state->view->getViewport();
 
-                    LinearImage image(toLinear<uint8_t>(v.width, v.height, v.width * 3,
-                            static_cast<uint8_t*>(buffer)));
-
                     int digits = (int) log10 ((double) g_materialVariantCount) + 1;
 
                     std::ostringstream stringStream;
@@ -387,13 +388,10 @@ static void postRender(Engine*, View* view, Scene*, Renderer* renderer) {
                     stringStream << std::to_string(state->currentFrame);
                     stringStream << ".png";
 
-                    std::string name = stringStream.str();
-                    Path out(name);
-
-                    std::ofstream outputStream(out, std::ios::binary | std::ios::trunc);
-                    ImageEncoder::encode(outputStream, ImageEncoder::Format::PNG, image, "", name);
+                    // encoded and written by the sink's threads
+                    g_frameSink->submit(static_cast<uint8_t*>(buffer), v.width, v.height, 3,
+                            stringStream.str());
 
-                    delete[] static_cast<uint8_t*>(buffer);
                     delete state;
 
                     g_savedFrames++;
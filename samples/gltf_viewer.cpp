@@ -98,6 +98,7 @@ struct App {
     std::string messageBoxText;
     std::string settingsFile;
     std::string batchFile;
+    bool batchPerformance = false;
 
     AutomationSpec* automationSpec = nullptr;
     AutomationEngine* automationEngine = nullptr;
@@ -120,6 +121,9 @@ static void printUsage(char* name) {
         "       Start automation using the given JSON spec, then quit the app\n\n"
         "   --headless, -e\n"
         "       Use a headless swapchain; ignored if --batch is not present\n\n"
+        "   --performance, -p\n"
+        "       Measure the frame timings of each test instead of taking screenshots, they are\n"
+        "       written to performance.csv and performance.json; requires --batch\n\n"
         "   --ibl=<path to cmgen IBL>, -i <path>\n"
         "       Override the built-in IBL\n\n"
         "   --actual-size, -s\n"
@@ -154,12 +158,13 @@ static std::ifstream::pos_type getFileSize(const char* filename) {
 }
 
 static int handleCommandLineArguments(int argc, char* argv[], App* app) {
-    static constexpr const char* OPTSTR = "ha:i:usc:rt:b:ev";
+    static constexpr const char* OPTSTR = "ha:i:usc:rt:b:evp";
     static const struct option OPTIONS[] = {
         { "help",         no_argument,       nullptr, 'h' },
         { "api",          required_argument, nullptr, 'a' },
         { "batch",        required_argument, nullptr, 'b' },
         { "headless",     no_argument,       nullptr, 'e' },
+        { "performance",  no_argument,       nullptr, 'p' },
         { "ibl",          required_argument, nullptr, 'i' },
         { "ubershader",   no_argument,       nullptr, 'u' },
         { "actual-size",  no_argument,       nullptr, 's' },
@@ -201,6 +206,9 @@ static int handleCommandLineArguments(int argc, char* argv[], App* app) {
             case 'e':
                 app->config.headless = true;
                 break;
+            case 'p':
+                app->batchPerformance = true;
+                break;
             case 'i':
                 app->config.iblDirectory = arg;
                 break;
@@ -466,8 +474,9 @@ int main(int argc, char** argv) {
             app.automationEngine->startBatchMode();
             auto options = app.automationEngine->getOptions();
             options.sleepDuration = 0.0;
-            options.exportScreenshots = true;
+            options.exportScreenshots = !app.batchPerformance;
             options.exportSettings = true;
+            options.exportPerformance = app.batchPerformance;
             app.automationEngine->setOptions(options);
             app.viewer->stopAnimation();
         }
@@ -536,6 +545,7 @@ int main(int argc, char** argv) {
 
                 ImGui::Checkbox("Export screenshot for each test", &options.exportScreenshots);
                 ImGui::Checkbox("Export settings JSON for each test", &options.exportSettings);
+                ImGui::Checkbox("Export performance of each test", &options.exportPerformance);
 
                 automation.setOptions(options);
 
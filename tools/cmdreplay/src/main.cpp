@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <backend/DriverEnums.h>
+#include <backend/Platform.h>
+
+#include "private/backend/CommandStreamCapture.h"
+#include "private/backend/Driver.h"
+
+#include <utils/Path.h>
+
+#include <getopt/getopt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace filament::backend;
+using namespace utils;
+
+static Backend g_backend = Backend::DEFAULT;
+static uint32_t g_width = 1920;
+static uint32_t g_height = 1080;
+static size_t g_repeat = 100;
+static bool g_finish = true;
+static bool g_json = false;
+
+static void printUsage(const char* name) {
+    std::string execName(Path(name).getName());
+    std::string usage(
+            "CMDREPLAY replays a capture of the driver commands, without the engine.\n"
+            "Captures are recorded by running a Filament application, built with\n"
+            "FILAMENT_ENABLE_COMMAND_CAPTURE, with the environment variable\n"
+            "FILAMENT_COMMAND_STREAM_CAPTURE set to the path of the capture file.\n"
+            "All the frames are replayed once, then the last frame is replayed again and timed.\n"
+            "Usage:\n"
+            "    CMDREPLAY [options] <capture file>\n"
+            "\n"
+            "Options:\n"
+            "   --help, -h\n"
+            "       Print this message\n\n"
+            "   --license\n"
+            "       Print copyright and license information\n\n"
+            "   --api=[opengl|vulkan|metal|noop], -a [opengl|vulkan|metal|noop]\n"
+            "       Backend to replay the capture with, the platform's default if omitted\n\n"
+            "   --size=WIDTHxHEIGHT, -s WIDTHxHEIGHT\n"
+            "       Size of the headless swap chains, 1920x1080 by default\n\n"
+            "   --repeat=N, -r N\n"
+            "       Number of times the last frame is replayed, 100 by default\n\n"
+            "   --no-finish, -n\n"
+            "       Don't wait for the GPU after each frame, only the CPU time of the driver\n"
+            "       is measured then\n\n"
+            "   --json, -j\n"
+            "       Print the timings in JSON\n\n"
+    );
+
+    const std::string from("CMDREPLAY");
+    for (size_t pos = usage.find(from); pos != std::string::npos; pos = usage.find(from, pos)) {
+        usage.replace(pos, from.length(), execName);
+    }
+    printf("%s", usage.c_str());
+}
+
+static void license() {
+    static const char *license[] = {
+        #include "licenses/licenses.inc"
+        nullptr
+    };
+
+    const char **p = &license[0];
+    while (*p)
+        std::cout << *p++ << std::endl;
+}
+
+static int handleArguments(int argc, char* argv[]) {
+    static constexpr const char* OPTSTR = "ha:s:r:nj";
+    static const struct option OPTIONS[] = {
+            { "help",                 no_argument, nullptr, 'h' },
+            { "license",              no_argument, nullptr, 'l' },
+            { "api",            required_argument, nullptr, 'a' },
+            { "size",           required_argument, nullptr, 's' },
+            { "repeat",         required_argument, nullptr, 'r' },
+            { "no-finish",            no_argument, nullptr, 'n' },
+            { "json",                 no_argument, nullptr, 'j' },
+            { nullptr, 0, nullptr, 0 }  // termination of the option list
+    };
+
+    int opt;
+    int optionIndex = 0;
+
+    while ((opt = getopt_long(argc, argv, OPTSTR, OPTIONS, &optionIndex)) >= 0) {
+        std::string arg(optarg ? optarg : "");
+        switch (opt) {
+            default:
+            case 'h':
+                printUsage(argv[0]);
+                exit(0);
+                // break;
+            case 'l':
+                license();
+                exit(0);
+                // break;
+            case 'a':
+                if (arg == "opengl") {
+                    g_backend = Backend::OPENGL;
+                } else if (arg == "vulkan") {
+                    g_backend = Backend::VULKAN;
+                } else if (arg == "metal") {
+                    g_backend = Backend::METAL;
+                } else if (arg == "noop") {
+                    g_backend = Backend::NOOP;
+                } else {
+                    std::cerr << "Unrecognized backend. Must be 'opengl'|'vulkan'|'metal'|'noop'."
+                              << std::endl;
+                    exit(1);
+                }
+                break;
+            case 's':
+                if (sscanf(arg.c_str(), "%ux%u", &g_width, &g_height) != 2) {
+                    std::cerr << "Size must be WIDTHxHEIGHT." << std::endl;
+                    exit(1);
+                }
+                break;
+            case 'r':
+                g_repeat = size_t(std::max(0, atoi(arg.c_str())));
+                break;
+            case 'n':
+                g_finish = false;
+                break;
+            case 'j':
+                g_json = true;
+                break;
+        }
+    }
+
+    return optind;
+}
+
+int main(int argc, char* argv[]) {
+    int optionIndex = handleArguments(argc, argv);
+    if (argc - optionIndex < 1) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    const char* const path = argv[optionIndex];
+
+    DefaultPlatform* platform = DefaultPlatform::create(&g_backend);
+    if (!platform) {
+        std::cerr << "Selected backend not supported in this build." << std::endl;
+        return 1;
+    }
+    Driver* const driver = platform->createDriver(nullptr);
+    if (!driver) {
+        DefaultPlatform::destroy(&platform);
+        return 1;
+    }
+
+    using clock = std::chrono::steady_clock;
+    using ms = std::chrono::duration<double, std::milli>;
+    std::vector<double> times;
+    size_t frameCount = 0;
+    bool loaded = false;
+    {
+        // the replayer must be destroyed before the driver is terminated
+        CommandStreamReplayer replayer(*driver, nullptr, g_width, g_height);
+        loaded = replayer.load(path);
+        if (loaded) {
+            frameCount = replayer.getFrameCount();
+            for (size_t i = 0; i < frameCount; i++) {
+                replayer.replay(i);
+            }
+            replayer.finish();
+
+            if (frameCount > 0) {
+                times.reserve(g_repeat);
+                for (size_t i = 0; i < g_repeat; i++) {
+                    const auto start = clock::now();
+                    replayer.replay(frameCount - 1);
+                    if (g_finish) {
+                        replayer.finish();
+                    }
+                    times.push_back(ms(clock::now() - start).count());
+                }
+            }
+        }
+    }
+
+    driver->terminate();
+    delete driver;
+    DefaultPlatform::destroy(&platform);
+
+    if (!loaded) {
+        return 1;
+    }
+
+    if (times.empty()) {
+        std::cerr << "The capture doesn't have a complete frame." << std::endl;
+        return 1;
+    }
+
+    std::vector<double> sorted(times);
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0;
+    for (double t : times) {
+        total += t;
+    }
+    const double mean = total / double(times.size());
+    const double median = sorted[sorted.size() / 2];
+    const double p90 = sorted[std::min(sorted.size() - 1, sorted.size() * 9 / 10)];
+
+    if (g_json) {
+        printf("{\n");
+        printf("  \"capture\": \"%s\",\n", path);
+        printf("  \"backend\": \"%s\",\n", backendToString(g_backend));
+        printf("  \"frames\": %zu,\n", frameCount);
+        printf("  \"repeat\": %zu,\n", times.size());
+        printf("  \"finish\": %s,\n", g_finish ? "true" : "false");
+        printf("  \"mean_ms\": %.4f,\n", mean);
+        printf("  \"median_ms\": %.4f,\n", median);
+        printf("  \"p90_ms\": %.4f,\n", p90);
+        printf("  \"min_ms\": %.4f,\n", sorted.front());
+        printf("  \"max_ms\": %.4f\n", sorted.back());
+        printf("}\n");
+    } else {
+        printf("%s: %zu frames, last frame replayed %zu times on %s\n",
+                path, frameCount, times.size(), backendToString(g_backend));
+        printf("mean %.3f ms, median %.3f ms, p90 %.3f ms, min %.3f ms, max %.3f ms\n",
+                mean, median, p90, sorted.front(), sorted.back());
+    }
+    return 0;
+}
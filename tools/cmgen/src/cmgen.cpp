@@ -42,9 +42,12 @@
 
 #include <cmath>
 #include <fstream>
+#include <future>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <string>
+#include <vector>
 
 #include <string.h>
 
@@ -72,6 +75,9 @@ enum class OutputType {
 static image::ImageEncoder::Format g_format = image::ImageEncoder::Format::PNG;
 static OutputType g_type = OutputType::FACES;
 static std::string g_compression;
+static bool g_fast_compression = false;
+static bool g_ktx2 = false;
+static bool g_supercompress = false;
 static bool g_extract_faces = false;
 static float g_extract_blur = 0.0;
 static utils::Path g_extract_dir;
@@ -114,6 +120,16 @@ static bool g_mirror = false;
 
 // -----------------------------------------------------------------------------------------------
 
+struct DecodedImage {
+    Image image;
+    std::string error;
+};
+
+static bool decodeImage(const utils::Path& iname, DecodedImage& decoded);
+static bool loadEnvironment(utils::JobSystem& js, const utils::Path& iname,
+        DecodedImage const& decoded, std::vector<Image>& images, std::vector<Cubemap>& levels);
+static void processEnvironment(utils::JobSystem& js, const utils::Path& iname,
+        std::vector<Image>& images, std::vector<Cubemap>& levels);
 static void generateMipmaps(utils::JobSystem& js, std::vector<Cubemap>& levels,
         std::vector<Image>& images);
 static void sphericalHarmonics(utils::JobSystem& js, const utils::Path& iname,
@@ -137,7 +153,9 @@ static void UTILS_UNUSED outputSpectrum(std::ostream& out,
 static void saveImage(const std::string& path, ImageEncoder::Format format, const Image& image,
         const std::string& compression);
 static LinearImage toLinearImage(const Image& image);
-static void exportKtxFaces(KtxBundle& container, uint32_t miplevel, const Cubemap& cm);
+static void exportKtxFaces(utils::JobSystem& js, KtxBundle& container, uint32_t miplevel,
+        const Cubemap& cm);
+static void saveKtx(utils::JobSystem& js, const std::string& path, const KtxBundle& container);
 
 // -----------------------------------------------------------------------------------------------
 
@@ -151,6 +169,10 @@ static void printUsage(char* name) {
             "Usages:\n"
             "    CMGEN [options] <input-file>\n"
             "    CMGEN [options] <uv[N]>\n"
+            "    CMGEN [options] <input-file> <input-file>...\n"
+            "\n"
+            "When several inputs are given, they are processed one after the other with the same\n"
+            "options, while the next input is decoded in the background.\n"
             "\n"
             "Supported input formats:\n"
             "    PNG, 8 and 16 bits\n"
@@ -167,9 +189,11 @@ static void printUsage(char* name) {
             "       Quiet mode. Suppress all non-error output\n\n"
             "   --type=[cubemap|equirect|octahedron|ktx], -t [cubemap|equirect|octahedron|ktx]\n"
             "       Specify output type (default: cubemap)\n\n"
-            "   --format=[exr|hdr|psd|rgbm|rgb32f|png|dds|ktx], -f [exr|hdr|psd|rgbm|rgb32f|png|dds|ktx]\n"
-            "       Specify output file format. ktx implies -type=ktx.\n"
+            "   --format=[exr|hdr|psd|rgbm|rgb32f|png|dds|ktx|ktx2], -f [exr|hdr|psd|rgbm|rgb32f|png|dds|ktx|ktx2]\n"
+            "       Specify output file format. ktx and ktx2 imply -type=ktx.\n"
             "       KTX files are always encoded with 3-channel RGB_10_11_11_REV data\n\n"
+            "   --supercompress\n"
+            "       Compress the KTX2 miplevels with zlib to reduce the download size\n\n"
             "   --compression=COMPRESSION, -c COMPRESSION\n"
             "       Format specific compression:\n"
 #ifdef IMAGEIO_SUPPORTS_BLOCK_COMPRESSION
@@ -180,6 +204,8 @@ static void printUsage(char* name) {
             "               FORMAT is rgb8_alpha, srgb8_alpha, rgba8, or srgb8_alpha8\n"
             "               METRIC is rgba, rgbx, rec709, numeric, or normalxyz\n"
             "               EFFORT is an integer between 0 and 100\n"
+            "   --fast-compression\n"
+            "       Trade quality for speed when compressing KTX faces, e.g. for iteration builds\n"
 #endif
             "           PNG: Ignored\n"
             "           PNG RGBM: Ignored\n"
@@ -260,6 +286,8 @@ static int handleCommandLineArgments(int argc, char* argv[]) {
             { "type",                 required_argument, nullptr, 't' },
             { "format",               required_argument, nullptr, 'f' },
             { "compression",          required_argument, nullptr, 'c' },
+            { "fast-compression",           no_argument, nullptr, 'F' },
+            { "supercompress",              no_argument, nullptr, 'Z' },
             { "size",                 required_argument, nullptr, 's' },
             { "extract",              required_argument, nullptr, 'e' },
             { "extract-blur",         required_argument, nullptr, 'r' },
@@ -355,10 +383,21 @@ static int handleCommandLineArgments(int argc, char* argv[]) {
                     ktx_format_requested = true;
                     format_specified = true;
                 }
+                if (arg == "ktx2") {
+                    ktx_format_requested = true;
+                    format_specified = true;
+                    g_ktx2 = true;
+                }
                 break;
             case 'c':
                 g_compression = arg;
                 break;
+            case 'F':
+                g_fast_compression = true;
+                break;
+            case 'Z':
+                g_supercompress = true;
+                break;
             case 's':
                 g_output_size = std::stoul(arg);
                 if (!isPOT(g_output_size)) {
@@ -500,65 +539,105 @@ int main(int argc, char* argv[]) {
         if (num_args < 1) return 0;
     }
 
-    std::string command(argv[option_index]);
-    utils::Path iname(command);
+    // we mirror by default -- the mirror option in fact un-mirrors.
+    g_mirror = !g_mirror;
 
-    if (g_deploy) {
-        utils::Path sh_dir = g_deploy_dir;
+    std::vector<utils::Path> inputs(argv + option_index, argv + argc);
+    const bool batch = inputs.size() > 1;
 
-        // KTX files are self-contained and do not need to live in a subfolder.
-        if (g_type != OutputType::KTX) {
-            sh_dir += iname.getNameWithoutExtension();
+    // The next input is decoded in the background while the current one is processed by the
+    // JobSystem, so at most two source images are held in memory at any time.
+    auto decodeAsync = [](utils::Path const& iname) {
+        return std::async(std::launch::async, [iname]() {
+            DecodedImage decoded;
+            if (iname.exists()) {
+                decodeImage(iname, decoded);
+            }
+            return decoded;
+        });
+    };
+
+    int result = 0;
+    std::future<DecodedImage> next = decodeAsync(inputs[0]);
+    for (size_t i = 0; i < inputs.size(); i++) {
+        utils::Path const& iname = inputs[i];
+        DecodedImage decoded = next.get();
+        if (i + 1 < inputs.size()) {
+            next = decodeAsync(inputs[i + 1]);
         }
 
-        // generate pre-scaled irradiance sh to text file
-        g_sh_compute = 3;
-        g_sh_shader = true;
-        g_sh_irradiance = true;
-        g_sh_filename = sh_dir + "sh.txt";
-        g_sh_file = ShFile::SH_TEXT;
-        g_sh_output = true;
+        if (!g_quiet && batch) {
+            std::cout << "[" << (i + 1) << "/" << inputs.size() << "] " << iname << std::endl;
+        }
 
-        // faces
-        g_extract_dir = g_deploy_dir;
-        g_extract_faces = true;
+        // Images store the actual data
+        std::vector<Image> images;
 
-        // prefilter
-        g_prefilter = true;
-        g_prefilter_dir = g_deploy_dir;
-    }
+        // Cubemaps are just views on Images
+        std::vector<Cubemap> levels;
 
-    // Images store the actual data
-    std::vector<Image> images;
+        if (!loadEnvironment(js, iname, decoded, images, levels)) {
+            // in batch mode, a bad input doesn't prevent processing the other ones
+            if (!batch) {
+                return 1;
+            }
+            result = 1;
+            continue;
+        }
 
-    // Cubemaps are just views on Images
-    std::vector<Cubemap> levels;
+        processEnvironment(js, iname, images, levels);
+    }
 
-    if (iname.exists()) {
-        if (!g_quiet) {
-            std::cout << "Decoding image..." << std::endl;
-        }
-        std::ifstream input_stream(iname.getPath(), std::ios::binary);
-        LinearImage linputImage = ImageDecoder::decode(input_stream, iname.getPath());
-        if (!linputImage.isValid()) {
-            std::cerr << "Unable to open image: " << iname.getPath() << std::endl;
-            exit(1);
-        }
-        if (linputImage.getChannels() != 3) {
-            std::cerr << "Input image must be RGB (3 channels)! This image has "
-                      << linputImage.getChannels() << " channels." << std::endl;
-            exit(1);
+    return result;
+}
+
+bool decodeImage(const utils::Path& iname, DecodedImage& decoded) {
+    std::ifstream input_stream(iname.getPath(), std::ios::binary);
+    std::ostringstream error;
+
+    // Convert the scanlines to the deprecated Image object which is used throughout cmgen as
+    // they are decoded, so the image isn't held twice in memory.
+    Image& image = decoded.image;
+    bool const success = ImageDecoder::decodeScanlines(input_stream, iname.getPath(),
+            [&](uint32_t width, uint32_t height, uint32_t channels) {
+                if (channels != 3) {
+                    error << "Input image must be RGB (3 channels)! This image has "
+                          << channels << " channels.";
+                    return false;
+                }
+                image = Image(width, height);
+                return true;
+            },
+            [&image](uint32_t y, float const* row) {
+                memcpy(image.getPixelRef(0, y), row, image.getWidth() * sizeof(float3));
+            });
+
+    if (!success) {
+        if (error.str().empty()) {
+            error << "Unable to open image: " << iname.getPath();
         }
+        decoded.error = error.str();
+        decoded.image.reset();
+        return false;
+    }
 
-        // Convert from LinearImage to the deprecated Image object which is used throughout cmgen.
-        const size_t width = linputImage.getWidth(), height = linputImage.getHeight();
-        Image inputImage(width, height);
-        memcpy(inputImage.getData(), linputImage.getPixelRef(), height * inputImage.getBytesPerRow());
+    if (!g_noclamp) {
+        CubemapUtils::clamp(image);
+    }
+    return true;
+}
 
-        if (!g_noclamp) {
-            CubemapUtils::clamp(inputImage);
+bool loadEnvironment(utils::JobSystem& js, const utils::Path& iname, DecodedImage const& decoded,
+        std::vector<Image>& images, std::vector<Cubemap>& levels) {
+    if (iname.exists()) {
+        if (!decoded.image.isValid()) {
+            std::cerr << decoded.error << std::endl;
+            return false;
         }
 
+        const Image& inputImage = decoded.image;
+        const size_t width = inputImage.getWidth(), height = inputImage.getHeight();
+
         if ((isPOT(width) && (width * 3 == height * 4)) ||
             (isPOT(height) && (height * 3 == width * 4))) {
             // This is cross cubemap
@@ -589,7 +668,7 @@ int main(int argc, char* argv[]) {
             std::cerr << "  2:1, lat/long or equirectangular" << std::endl;
             std::cerr << "  3:4, vertical cross (height must be power of two)" << std::endl;
             std::cerr << "  4:3, horizontal cross (width must be power of two)" << std::endl;
-            exit(0);
+            return false;
         }
     } else {
         if (!g_quiet) {
@@ -618,9 +697,36 @@ int main(int argc, char* argv[]) {
         images.push_back(std::move(temp));
         levels.push_back(std::move(cml));
     }
+    return true;
+}
+
+void processEnvironment(utils::JobSystem& js, const utils::Path& iname,
+        std::vector<Image>& images, std::vector<Cubemap>& levels) {
+    if (g_deploy) {
+        utils::Path sh_dir = g_deploy_dir;
+
+        // KTX files are self-contained and do not need to live in a subfolder.
+        if (g_type != OutputType::KTX) {
+            sh_dir += iname.getNameWithoutExtension();
+        }
+
+        // generate pre-scaled irradiance sh to text file
+        g_sh_compute = 3;
+        g_sh_shader = true;
+        g_sh_irradiance = true;
+        g_sh_filename = sh_dir + "sh.txt";
+        g_sh_file = ShFile::SH_TEXT;
+        g_sh_output = true;
+
+        // faces
+        g_extract_dir = g_deploy_dir;
+        g_extract_faces = true;
+
+        // prefilter
+        g_prefilter = true;
+        g_prefilter_dir = g_deploy_dir;
+    }
 
-    // we mirror by default -- the mirror option in fact un-mirrors.
-    g_mirror = !g_mirror;
     if (g_mirror) {
         if (!g_quiet) {
             std::cout << "Mirroring..." << std::endl;
@@ -702,8 +808,6 @@ int main(int argc, char* argv[]) {
             extractCubemapFaces(js, iname, cm, g_extract_dir);
         }
     }
-
-    return 0;
 }
 
 void generateMipmaps(utils::JobSystem& js, std::vector<Cubemap>& levels,
@@ -1002,7 +1106,7 @@ void iblRoughnessPrefilter(
         std::string ext = ImageEncoder::chooseExtension(g_format);
 
         if (g_type == OutputType::KTX) {
-            exportKtxFaces(container, (uint32_t) level, dst);
+            exportKtxFaces(js, container, (uint32_t) level, dst);
             continue;
         }
 
@@ -1041,13 +1145,8 @@ void iblRoughnessPrefilter(
             }
             container.setMetadata("sh", sstr.str().c_str());
         }
-        std::vector<uint8_t> fileContents(container.getSerializedLength());
-        container.serialize(fileContents.data(), (uint32_t) fileContents.size());
-        std::string filename = dir.getNameWithoutExtension() + "_ibl.ktx";
-        auto fullpath = outputDir + filename;
-        std::ofstream outputStream(fullpath.c_str(), std::ios::out | std::ios::binary);
-        outputStream.write((const char*) fileContents.data(), fileContents.size());
-        outputStream.close();
+        std::string filename = dir.getNameWithoutExtension() + (g_ktx2 ? "_ibl.ktx2" : "_ibl.ktx");
+        saveKtx(js, outputDir + filename, container);
     }
 }
 
@@ -1207,14 +1306,10 @@ void extractCubemapFaces(utils::JobSystem& js, const utils::Path& iname, const C
             .pixelHeight = dim,
             .pixelDepth = 0,
         };
-        exportKtxFaces(container, 0, cm);
-        std::string filename = dir.getNameWithoutExtension() + "_skybox.ktx";
-        auto fullpath = outputDir + filename;
-        std::vector<uint8_t> fileContents(container.getSerializedLength());
-        container.serialize(fileContents.data(), (uint32_t) fileContents.size());
-        std::ofstream outputStream(fullpath.c_str(), std::ios::out | std::ios::binary);
-        outputStream.write((const char*) fileContents.data(), fileContents.size());
-        outputStream.close();
+        exportKtxFaces(js, container, 0, cm);
+        std::string filename = dir.getNameWithoutExtension() +
+                (g_ktx2 ? "_skybox.ktx2" : "_skybox.ktx");
+        saveKtx(js, outputDir + filename, container);
         return;
     }
 
@@ -1268,7 +1363,29 @@ static void saveImage(const std::string& path, ImageEncoder::Format format, cons
     }
 }
 
-static void exportKtxFaces(KtxBundle& container, uint32_t miplevel, const Cubemap& cm) {
+static void saveKtx(utils::JobSystem& js, const std::string& path, const KtxBundle& container) {
+    std::unique_ptr<uint8_t[]> fileContents;
+    uint32_t fileSize;
+    if (g_ktx2) {
+        using Supercompression = KtxBundle::Supercompression;
+        fileSize = container.serializeKtx2(&fileContents,
+                g_supercompress ? Supercompression::ZLIB : Supercompression::NONE, &js);
+        if (!fileSize) {
+            std::cerr << "This format can't be stored in a KTX2 file" << std::endl;
+            exit(1);
+        }
+    } else {
+        fileSize = container.getSerializedLength();
+        fileContents.reset(new uint8_t[fileSize]);
+        container.serialize(fileContents.get(), fileSize);
+    }
+    std::ofstream outputStream(path.c_str(), std::ios::out | std::ios::binary);
+    outputStream.write((const char*) fileContents.get(), fileSize);
+    outputStream.close();
+}
+
+static void exportKtxFaces(utils::JobSystem& js, KtxBundle& container, uint32_t miplevel,
+        const Cubemap& cm) {
     auto& info = container.info();
 
 #ifdef IMAGEIO_SUPPORTS_BLOCK_COMPRESSION
@@ -1279,6 +1396,7 @@ static void exportKtxFaces(KtxBundle& container, uint32_t miplevel, const Cubema
             std::cerr << "Unrecognized compression: " << g_compression << std::endl;
             exit(1);
         }
+        compression.fast = g_fast_compression;
         // The KTX spec says the following for compressed textures: glTypeSize should 1,
         // glFormat should be 0, and glBaseInternalFormat should be RED, RG, RGB, or RGBA.
         // The glInternalFormat field is the only field that specifies the actual format.
@@ -1312,7 +1430,7 @@ static void exportKtxFaces(KtxBundle& container, uint32_t miplevel, const Cubema
 
 #ifdef IMAGEIO_SUPPORTS_BLOCK_COMPRESSION
         if (compression.type != CompressionConfig::INVALID) {
-            CompressedTexture tex = compressTexture(compression, image);
+            CompressedTexture tex = compressTexture(compression, image, &js);
             container.setBlob(blobIndex, tex.data.get(), tex.size);
             info.glInternalFormat = (uint32_t) tex.format;
             continue;
@@ -85,18 +85,8 @@ static void launchTool(string inputPath,
     ASSERT_EQ(std::system(cmdline.c_str()), 0);
 }
 
-// This spawns cmgen, telling it to process the environment map located at "inputPath". It creates
-// an output folder in the same location as the test executable, which lets us avoid polluting our
-// local source tree with output files. The given "resultPath" points the specific newly-generated
-// output image that we'd like to compare or update, and the "goldenPath" points to the golden image
-// (which lives in our source tree).
-static void processEnvMap(string inputPath, string resultPath, string goldenPath) {
-    const string executableFolder = Path::getCurrentExecutable().getParent();
-    resultPath = Path::getCurrentExecutable().getParent() + resultPath;
-    goldenPath = Path::getCurrentDirectory() + goldenPath;
-
-    launchTool(std::move(inputPath), "--quiet -f rgbm -x " + executableFolder);
-
+// Compares (or updates) the golden image at "goldenPath" with the RGBM image at "resultPath".
+static void compareResult(string resultPath, string goldenPath) {
     std::cout << "Reading result image from " << resultPath << std::endl;
     checkFileExistence(resultPath);
     std::ifstream resultStream(resultPath.c_str(), std::ios::binary);
@@ -111,6 +101,20 @@ static void processEnvMap(string inputPath, string resultPath, string goldenPath
     updateOrCompare(resultLImage, goldenPath, g_comparisonMode, 0.01f);
 }
 
+// This spawns cmgen, telling it to process the environment map located at "inputPath". It creates
+// an output folder in the same location as the test executable, which lets us avoid polluting our
+// local source tree with output files. The given "resultPath" points the specific newly-generated
+// output image that we'd like to compare or update, and the "goldenPath" points to the golden image
+// (which lives in our source tree).
+static void processEnvMap(string inputPath, string resultPath, string goldenPath) {
+    const string executableFolder = Path::getCurrentExecutable().getParent();
+    resultPath = Path::getCurrentExecutable().getParent() + resultPath;
+    goldenPath = Path::getCurrentDirectory() + goldenPath;
+
+    launchTool(std::move(inputPath), "--quiet -f rgbm -x " + executableFolder);
+    compareResult(std::move(resultPath), std::move(goldenPath));
+}
+
 static void compareSh(const string& content, const string& regex,
         const float3& match, float epsilon = 1e-5f) {
     std::smatch smatch;
@@ -153,6 +157,18 @@ TEST_F(CmgenTest, LdrCrossCube) { // NOLINT
     processEnvMap(inputPath, resultPath, goldenPath);
 }
 
+TEST_F(CmgenTest, Batch) { // NOLINT
+    const string outputFolder = Path::getCurrentExecutable().getParent() + "batch/";
+    const string secondInput =
+            Path::getCurrentDirectory() + "tools/cmgen/tests/Footballfield/Footballfield.png";
+    launchTool("assets/environments/white_furnace/white_furnace.exr",
+            "--quiet -f rgbm -x " + outputFolder, secondInput);
+    compareResult(outputFolder + "white_furnace/nx.rgbm",
+            Path::getCurrentDirectory() + "tools/cmgen/tests/white_furnace_nx.rgbm");
+    compareResult(outputFolder + "Footballfield/m3_nx.rgbm",
+            Path::getCurrentDirectory() + "tools/cmgen/tests/Footballfield/m3_nx.rgbm");
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     if (argc != 2) {
@@ -20,6 +20,8 @@
 
 #include <meshoptimizer.h>
 
+#include <algorithm>
+
 using namespace filamesh;
 using namespace filament::math;
 using namespace std;
@@ -40,12 +42,47 @@ size_t write(unsigned char* out, const vector<T>& data) {
     return data.size() * sizeof(T);
 }
 
+vector<float3> MeshWriter::getPositions(const Mesh& mesh) const {
+    vector<float3> positions(mesh.vertexCount);
+    for (size_t i = 0; i < mesh.vertexCount; i++) {
+        const half4 p = (mFlags & INTERLEAVED) ? mesh.vertices[i].position : mesh.positions[i];
+        positions[i] = float3(p.xyz);
+    }
+    return positions;
+}
+
+void MeshWriter::printStatistics(const Mesh& mesh, const vector<float3>& positions,
+        const char* label) const {
+    const size_t vertexSize = sizeof(Vertex) + (mesh.uv1.empty() ? 0 : sizeof(ushort2));
+    const meshopt_VertexCacheStatistics vcache = meshopt_analyzeVertexCache(mesh.indices.data(),
+            mesh.indices.size(), mesh.vertexCount, 16, 0, 0);
+    const meshopt_OverdrawStatistics overdraw = meshopt_analyzeOverdraw(mesh.indices.data(),
+            mesh.indices.size(), &positions.data()->x, mesh.vertexCount, sizeof(float3));
+    const meshopt_VertexFetchStatistics vfetch = meshopt_analyzeVertexFetch(mesh.indices.data(),
+            mesh.indices.size(), mesh.vertexCount, vertexSize);
+    cout << label << ": ACMR " << vcache.acmr << ", ATVR " << vcache.atvr
+         << ", overdraw " << overdraw.overdraw << ", overfetch " << vfetch.overfetch << endl;
+}
+
 void MeshWriter::optimize(Mesh& mesh) {
+    // meshoptimizer needs float positions to reduce overdraw
+    vector<float3> positions = getPositions(mesh);
+    if (mPrintStatistics) {
+        printStatistics(mesh, positions, "Before optimization");
+    }
+
     // First, re-order triangles to improve cache locality and reduce the number of VS invocations.
     // Note that assimp already has aiProcess_ImproveCacheLocality, but MeshWriter doesn't know
     // about assimp, and it doesn't hurt to do it again here since this generally runs offline.
-    meshopt_optimizeVertexCache(mesh.indices.data(), mesh.indices.data(), mesh.indices.size(),
-                mesh.vertexCount);
+    // Then, re-order them again to reduce overdraw, as long as it doesn't transform more than 5%
+    // more vertices. Triangles are re-ordered within their part, so that parts keep their
+    // material.
+    for (const Part& part : mesh.parts) {
+        uint32_t* indices = mesh.indices.data() + part.offset;
+        meshopt_optimizeVertexCache(indices, indices, part.indexCount, mesh.vertexCount);
+        meshopt_optimizeOverdraw(indices, indices, part.indexCount, &positions.data()->x,
+                mesh.vertexCount, sizeof(float3), 1.05f);
+    }
 
     // At this point, triangle order has been established but we still need to shuffle vertices to
     // optimize the fetch. This makes it so that lower-numbered indices generally come before
@@ -83,11 +120,59 @@ void MeshWriter::optimize(Mesh& mesh) {
         }
     }
 
+    // The vertices moved, so the index range of each part must be recomputed.
+    for (Part& part : mesh.parts) {
+        const uint32_t* first = mesh.indices.data() + part.offset;
+        const auto range = minmax_element(first, first + part.indexCount);
+        part.minIndex = part.indexCount ? *range.first : 0;
+        part.maxIndex = part.indexCount ? *range.second : 0;
+    }
+
+    if (mPrintStatistics) {
+        printStatistics(mesh, getPositions(mesh), "After optimization");
+    }
+
     // As a last step, the meshoptimizer README recommends applying individual meshopt_quantize*
     // functions as needed, but we actually already quantized the data according to our constraints
     // e.g. we already (potentially) use snorm16 for uvs, half-floats for tangents, etc.
 }
 
+void MeshWriter::buildMeshlets(Mesh& mesh) {
+    // meshoptimizer needs float positions to compute the bounds of the meshlets
+    vector<float3> positions = getPositions(mesh);
+
+    // Meshlets never straddle parts, so that each of them uses a single material.
+    vector<meshopt_Meshlet> meshlets;
+    for (uint32_t i = 0; i < mesh.parts.size(); i++) {
+        const Part& part = mesh.parts[i];
+        const uint32_t* indices = mesh.indices.data() + part.offset;
+        meshlets.resize(meshopt_buildMeshletsBound(part.indexCount,
+                MAX_MESHLET_VERTICES, MAX_MESHLET_TRIANGLES));
+        meshlets.resize(meshopt_buildMeshlets(meshlets.data(), indices, part.indexCount,
+                mesh.vertexCount, MAX_MESHLET_VERTICES, MAX_MESHLET_TRIANGLES));
+
+        for (const meshopt_Meshlet& m : meshlets) {
+            const meshopt_Bounds bounds = meshopt_computeMeshletBounds(m,
+                    &positions.data()->x, mesh.vertexCount, sizeof(float3));
+            mesh.meshlets.push_back(Meshlet {
+                .part = i,
+                .vertexOffset = uint32_t(mesh.meshletVertices.size()),
+                .vertexCount = m.vertex_count,
+                .triangleOffset = uint32_t(mesh.meshletTriangles.size() / 3),
+                .triangleCount = m.triangle_count,
+                .center = float3(bounds.center[0], bounds.center[1], bounds.center[2]),
+                .radius = bounds.radius,
+                .coneAxis = float3(bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2]),
+                .coneCutoff = bounds.cone_cutoff
+            });
+            mesh.meshletVertices.insert(mesh.meshletVertices.end(),
+                    m.vertices, m.vertices + m.vertex_count);
+            mesh.meshletTriangles.insert(mesh.meshletTriangles.end(),
+                    &m.indices[0][0], &m.indices[0][0] + m.triangle_count * 3);
+        }
+    }
+}
+
 bool MeshWriter::serialize(ostream& out, Mesh& mesh) {
     const bool hasIndex16 = mesh.vertexCount <= numeric_limits<uint16_t>::max();
     const bool hasUV1 = !mesh.uv1.empty();
@@ -106,6 +191,11 @@ bool MeshWriter::serialize(ostream& out, Mesh& mesh) {
     // It's safe to optimize the mesh regardless of the compression setting.
     optimize(mesh);
 
+    // Meshlets must be built after optimizing, since it reorders the triangles and vertices.
+    if (mFlags & MESHLETS) {
+        buildMeshlets(mesh);
+    }
+
     // Perform compression of vertex data if it has been requested.
     CompressionHeader cheader {};
     vector<unsigned char> compressedVertices;
@@ -167,11 +257,20 @@ bool MeshWriter::serialize(ostream& out, Mesh& mesh) {
 
     write(out, "FILAMESH", 8 * sizeof(char));
 
+    // compressed streams are decoded into new buffers, there is no point in aligning them
+    const bool aligned = (mFlags & ALIGNED) && !(mFlags & COMPRESSION);
+    auto streamOffset = [aligned](uint32_t offset) {
+        return aligned ? alignStream(offset) : offset;
+    };
+    // the vertex data starts right after the header, or at the next aligned offset
+    const uint32_t headerEnd = uint32_t(8 * sizeof(char) + sizeof(Header));
+    const uint32_t vertexStart = streamOffset(headerEnd);
+
     Header header;
     header.version = VERSION;
     header.parts = uint32_t(mesh.parts.size());
     header.aabb = aabb;
-    header.flags = mFlags;
+    header.flags = aligned ? mFlags : (mFlags & ~ALIGNED);
     if (mFlags & INTERLEAVED) {
         header.offsetPosition = offsetof(Vertex, position);
         header.offsetTangents = offsetof(Vertex, tangents);
@@ -184,10 +283,13 @@ bool MeshWriter::serialize(ostream& out, Mesh& mesh) {
         header.strideUV0      = sizeof(Vertex);
         header.strideUV1      = numeric_limits<uint32_t>::max();;
     } else {
+        // vertexStart is aligned, so the streams are too when their offset is
         header.offsetPosition = 0;
-        header.offsetTangents = mesh.vertexCount * sizeof(Vertex::position);
-        header.offsetColor    = header.offsetTangents + mesh.vertexCount * sizeof(Vertex::tangents);
-        header.offsetUV0      = header.offsetColor + mesh.vertexCount * sizeof(Vertex::color);
+        header.offsetTangents = streamOffset(mesh.vertexCount * sizeof(Vertex::position));
+        header.offsetColor    = streamOffset(
+                header.offsetTangents + mesh.vertexCount * sizeof(Vertex::tangents));
+        header.offsetUV0      = streamOffset(
+                header.offsetColor + mesh.vertexCount * sizeof(Vertex::color));
         header.offsetUV1      = numeric_limits<uint32_t>::max();;
         header.stridePosition = 0;
         header.strideTangents = 0;
@@ -195,7 +297,8 @@ bool MeshWriter::serialize(ostream& out, Mesh& mesh) {
         header.strideUV0      = 0;
         header.strideUV1      = numeric_limits<uint32_t>::max();;
         if (hasUV1) {
-            header.offsetUV1  = header.offsetUV0 + mesh.vertexCount * sizeof(Vertex::uv0);
+            header.offsetUV1  = streamOffset(
+                    header.offsetUV0 + mesh.vertexCount * sizeof(Vertex::uv0));
             header.strideUV1  = 0;
         }
     }
@@ -206,28 +309,48 @@ bool MeshWriter::serialize(ostream& out, Mesh& mesh) {
     if (mFlags & COMPRESSION) {
         header.vertexSize = sizeof(cheader) + compressedVertices.size();
         header.indexSize = compressedIndices.size();
-    } else {
+    } else if (mFlags & INTERLEAVED) {
         header.vertexSize = mesh.vertexCount * vertexSize;
         header.indexSize = mesh.indices.size() * (hasIndex16 ? sizeof(uint16_t) : sizeof(uint32_t));
+    } else {
+        header.vertexSize = hasUV1 ?
+                header.offsetUV1 + mesh.vertexCount * sizeof(Vertex::uv0) :
+                header.offsetUV0 + mesh.vertexCount * sizeof(Vertex::uv0);
+        header.indexSize = mesh.indices.size() * (hasIndex16 ? sizeof(uint16_t) : sizeof(uint32_t));
     }
 
     write(out, header);
 
+    auto pad = [&out](size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            write(out, char(0));
+        }
+    };
+    pad(vertexStart - headerEnd);
+
     if (mFlags & COMPRESSION) {
         write(out, &cheader, 1);
         write(out, compressedVertices.data(), compressedVertices.size());
     } else if (mFlags & INTERLEAVED) {
         write(out, mesh.vertices.data(), uint32_t(mesh.vertices.size()));
     } else {
+        const size_t count = mesh.vertexCount;
         write(out, mesh.positions.data(), uint32_t(mesh.positions.size()));
+        pad(header.offsetTangents - count * sizeof(Vertex::position));
         write(out, mesh.tangents.data(),  uint32_t(mesh.tangents.size()));
+        pad(header.offsetColor - (header.offsetTangents + count * sizeof(Vertex::tangents)));
         write(out, mesh.colors.data(), uint32_t(mesh.colors.size()));
+        pad(header.offsetUV0 - (header.offsetColor + count * sizeof(Vertex::color)));
         write(out, mesh.uv0.data(), uint32_t(mesh.uv0.size()));
         if (hasUV1) {
+            pad(header.offsetUV1 - (header.offsetUV0 + count * sizeof(Vertex::uv0)));
             write(out, mesh.uv1.data(), uint32_t(mesh.uv1.size()));
         }
     }
 
+    const uint32_t vertexEnd = vertexStart + header.vertexSize;
+    pad(streamOffset(vertexEnd) - vertexEnd);
+
     if (mFlags & COMPRESSION) {
         write(out, compressedIndices.data(), compressedIndices.size());
     } else if (!hasIndex16) {
@@ -250,5 +373,14 @@ bool MeshWriter::serialize(ostream& out, Mesh& mesh) {
         write(out, char(0));
     }
 
+    if (mFlags & MESHLETS) {
+        write(out, uint32_t(mesh.meshlets.size()));
+        write(out, mesh.meshlets.data(), uint32_t(mesh.meshlets.size()));
+        write(out, uint32_t(mesh.meshletVertices.size()));
+        write(out, mesh.meshletVertices.data(), uint32_t(mesh.meshletVertices.size()));
+        write(out, uint32_t(mesh.meshletTriangles.size() / 3));
+        write(out, mesh.meshletTriangles.data(), uint32_t(mesh.meshletTriangles.size()));
+    }
+
     return true;
 }
@@ -53,13 +53,25 @@ struct Mesh {
     std::vector<decltype(Vertex::color)>     colors;
     std::vector<decltype(Vertex::uv0)>       uv0;
     std::vector<decltype(Vertex::uv0)>       uv1;
+    // meshlets, built by MeshWriter when the MESHLETS flag is set:
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> meshletVertices;
+    std::vector<uint8_t> meshletTriangles;
 };
 
 class MeshWriter {
     uint32_t mFlags;
+    bool mPrintStatistics;
     void optimize(Mesh& mesh);
+    void buildMeshlets(Mesh& mesh);
+    std::vector<filament::math::float3> getPositions(const Mesh& mesh) const;
+    void printStatistics(const Mesh& mesh, const std::vector<filament::math::float3>& positions,
+            const char* label) const;
 public:
-    MeshWriter(uint32_t flags) : mFlags(flags) {}
+    // printStatistics prints the vertex cache, overdraw and vertex fetch statistics of the mesh
+    // before and after optimizing it.
+    MeshWriter(uint32_t flags, bool printStatistics = false) : mFlags(flags),
+            mPrintStatistics(printStatistics) {}
     bool serialize(std::ostream&, Mesh& mesh);
 };
 
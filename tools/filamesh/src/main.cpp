@@ -47,6 +47,9 @@ using Assimp::Importer;
 bool g_interleaved = false;
 bool g_snormUVs = false;
 bool g_compression = false;
+bool g_meshlets = false;
+bool g_aligned = false;
+bool g_statistics = false;
 
 Mesh g_mesh;
 float2 g_minUV = float2(std::numeric_limits<float>::max());
@@ -241,6 +244,16 @@ static void printUsage(const char* name) {
                     "       interleaves mesh attributes\n\n"
                     "   --compress, -c\n"
                     "       enable compression\n\n"
+                    "   --aligned, -a\n"
+                    "       align the vertex streams and the indices to 16 bytes, so they can\n"
+                    "       be uploaded straight from the memory-mapped file. Ignored with\n"
+                    "       --compress\n\n"
+                    "   --meshlets, -m\n"
+                    "       split the mesh into meshlets with bounds and normal cones, for\n"
+                    "       per-cluster frustum and backface culling\n\n"
+                    "   --stats, -s\n"
+                    "       print the vertex cache (ACMR, ATVR), overdraw and vertex fetch\n"
+                    "       statistics before and after optimizing the mesh\n\n"
     );
 
     const std::string from("FILAMESH");
@@ -262,12 +275,15 @@ static void license() {
 }
 
 static int handleArguments(int argc, char* argv[]) {
-    static constexpr const char* OPTSTR = "hilc";
+    static constexpr const char* OPTSTR = "hilcams";
     static const struct option OPTIONS[] = {
             { "help",        no_argument, 0, 'h' },
             { "license",     no_argument, 0, 'l' },
             { "interleaved", no_argument, 0, 'i' },
             { "compress",    no_argument, 0, 'c' },
+            { "aligned",     no_argument, 0, 'a' },
+            { "meshlets",    no_argument, 0, 'm' },
+            { "stats",       no_argument, 0, 's' },
             { 0, 0, 0, 0 }  // termination of the option list
     };
 
@@ -292,6 +308,15 @@ static int handleArguments(int argc, char* argv[]) {
             case 'c':
                 g_compression = true;
                 break;
+            case 'a':
+                g_aligned = true;
+                break;
+            case 'm':
+                g_meshlets = true;
+                break;
+            case 's':
+                g_statistics = true;
+                break;
         }
     }
 
@@ -399,7 +424,13 @@ int main(int argc, char* argv[]) {
     if (g_compression) {
         flags |= filamesh::COMPRESSION;
     }
-    MeshWriter(flags).serialize(out, g_mesh);
+    if (g_meshlets) {
+        flags |= filamesh::MESHLETS;
+    }
+    if (g_aligned) {
+        flags |= filamesh::ALIGNED;
+    }
+    MeshWriter(flags, g_statistics).serialize(out, g_mesh);
 
     out.flush();
     out.close();
@@ -36,6 +36,7 @@ static void usage(char* name) {
             "MATC is a command-line tool to compile material definition.\n"
             "Usages:\n"
             "    MATC [options] <input-file>\n"
+            "    MATC [options] --batch <output-dir> <input-file>...\n"
             "\n"
             "Supported input formats:\n"
             "    Filament material definition (.mat)\n"
@@ -47,10 +48,24 @@ static void usage(char* name) {
             "       Print copyright and license information\n\n"
             "   --output, -o\n"
             "       Specify path to output file\n\n"
+            "   --batch, -b <output-dir>\n"
+            "       Compile all the input files in parallel. Each one is written to <output-dir>,\n"
+            "       named after the input with a .filamat (blob) or .inc (header) extension\n\n"
+            "   --cache, -c <cache-dir>\n"
+            "       Reuse the packages of materials compiled before with the same source,\n"
+            "       includes and options, from <cache-dir>. New packages are added to it\n\n"
             "   --platform, -p\n"
             "       Shader family to generate: desktop, mobile or all (default)\n\n"
+            "   --compress, -z\n"
+            "       Compress the text shaders (GLSL and MSL) in the package. SPIR-V shaders are\n"
+            "       always compressed\n\n"
             "   --optimize-size, -S\n"
             "       Optimize generated shader code for size instead of just performance\n\n"
+            "   --optimization-passes, -P <api>=<pass>,<pass>...\n"
+            "       Replace the SPIR-V optimizer passes used for the given API (opengl, vulkan,\n"
+            "       metal or all), named after spirv-opt's flags without the leading dashes.\n"
+            "       Passes set by the material itself take precedence:\n"
+            "           MATC -P vulkan=merge-return,inline-entry-points-exhaustive,ccp ...\n\n"
             "   --api, -a\n"
             "       Specify the target API: opengl (default), vulkan, metal, or all\n"
             "       This flag can be repeated to individually select APIs for inclusion:\n"
@@ -80,6 +95,8 @@ static void usage(char* name) {
             "       Generate extra data for debugging\n\n"
             "   --print, -t\n"
             "       Print generated shaders for debugging\n\n"
+            "   --report-precision, -R\n"
+            "       List the highp variables of material() that could be mediump\n\n"
     );
     const std::string from("MATC");
     for (size_t pos = usage.find(from); pos != std::string::npos; pos = usage.find(from, pos)) {
@@ -121,6 +138,38 @@ static uint8_t parseVariantFilter(const std::string& arg) {
     return variantFilter;
 }
 
+static bool parseOptimizationPasses(const std::string& arg,
+        Config::OptimizationPasses& optimizationPasses) {
+    using TargetApi = Config::TargetApi;
+    size_t const equal = arg.find('=');
+    if (equal == std::string::npos) {
+        return false;
+    }
+    std::string const api = arg.substr(0, equal);
+    TargetApi targetApi;
+    if (api == "opengl") {
+        targetApi = TargetApi::OPENGL;
+    } else if (api == "vulkan") {
+        targetApi = TargetApi::VULKAN;
+    } else if (api == "metal") {
+        targetApi = TargetApi::METAL;
+    } else if (api == "all") {
+        targetApi = TargetApi::ALL;
+    } else {
+        return false;
+    }
+    std::stringstream ss(arg.substr(equal + 1));
+    std::string item;
+    std::vector<std::string> passes;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            passes.push_back(item);
+        }
+    }
+    optimizationPasses.emplace_back(targetApi, std::move(passes));
+    return true;
+}
+
 CommandlineConfig::CommandlineConfig(int argc, char** argv) : Config(), mArgc(argc), mArgv(argv) {
     mIsValid = parse();
 }
@@ -153,7 +202,7 @@ static void parseDefine(std::string defineString,
 }
 
 bool CommandlineConfig::parse() {
-    static constexpr const char* OPTSTR = "hlxo:f:dm:a:p:D:OSEr:vV:gtw";
+    static constexpr const char* OPTSTR = "hlxo:f:dm:a:p:P:D:OSEr:RvV:gtwb:c:z";
     static const struct option OPTIONS[] = {
             { "help",                    no_argument, nullptr, 'h' },
             { "license",                 no_argument, nullptr, 'l' },
@@ -168,16 +217,22 @@ bool CommandlineConfig::parse() {
             { "optimize-none",           no_argument, nullptr, 'g' },
             { "preprocessor-only",       no_argument, nullptr, 'E' },
             { "api",               required_argument, nullptr, 'a' },
+            { "optimization-passes", required_argument, nullptr, 'P' },
             { "define",            required_argument, nullptr, 'D' },
             { "reflect",           required_argument, nullptr, 'r' },
             { "print",                   no_argument, nullptr, 't' },
+            { "report-precision",        no_argument, nullptr, 'R' },
             { "version",                 no_argument, nullptr, 'v' },
             { "raw",                     no_argument, nullptr, 'w' },
+            { "batch",             required_argument, nullptr, 'b' },
+            { "cache",             required_argument, nullptr, 'c' },
+            { "compress",                no_argument, nullptr, 'z' },
             { nullptr, 0, nullptr, 0 }  // termination of the option list
     };
 
     int opt;
     int option_index = 0;
+    std::string batchDirectory;
 
     while ((opt = getopt_long(mArgc, mArgv, OPTSTR, OPTIONS, &option_index)) >= 0) {
         std::string arg(optarg ? optarg : "");
@@ -208,6 +263,9 @@ bool CommandlineConfig::parse() {
             case 'd':
                 mDebug = true;
                 break;
+            case 'z':
+                mCompressShaders = true;
+                break;
             case 'p':
                 if (arg == "desktop") {
                    mPlatform = Platform::DESKTOP;
@@ -236,6 +294,13 @@ bool CommandlineConfig::parse() {
                     return false;
                 }
                 break;
+            case 'P':
+                if (!parseOptimizationPasses(arg, mOptimizationPasses)) {
+                    std::cerr << "Unrecognized optimization passes. Must be "
+                            "'opengl|vulkan|metal|all=<pass>,<pass>...'." << std::endl;
+                    return false;
+                }
+                break;
             case 'D':
                 parseDefine(arg, mDefines);
                 break;
@@ -268,10 +333,43 @@ bool CommandlineConfig::parse() {
             case 't':
                 mPrintShaders = true;
                 break;
+            case 'R':
+                mReportPrecision = true;
+                break;
             case 'w':
                 mRawShaderMode = true;
                 break;
+            case 'b':
+                batchDirectory = arg;
+                break;
+            case 'c':
+                mCacheDirectory = arg;
+                break;
+        }
+    }
+
+    if (!mCacheDirectory.empty() && !Path(mCacheDirectory).isDirectory() &&
+            !Path(mCacheDirectory).mkdirRecursive()) {
+        std::cerr << "Unable to create the cache directory '" << mCacheDirectory << "'."
+                << std::endl;
+        return false;
+    }
+
+    if (!batchDirectory.empty()) {
+        const Path directory(batchDirectory);
+        if (!directory.isDirectory() && !directory.mkdirRecursive()) {
+            std::cerr << "Unable to create the output directory '" << batchDirectory << "'."
+                    << std::endl;
+            return false;
+        }
+        const char* extension = mOutputFormat == OutputFormat::C_HEADER ? ".inc" : ".filamat";
+        for (int i = optind; i < mArgc; i++) {
+            const Path output = directory.concat(
+                    Path(mArgv[i]).getNameWithoutExtension() + extension);
+            mBatchInputs.push_back(std::make_unique<FilesystemInput>(mArgv[i]));
+            mBatchOutputs.push_back(std::make_unique<FilesystemOutput>(output.c_str()));
         }
+        return true;
     }
 
     if (mArgc - optind > 1) {
@@ -19,7 +19,9 @@
 
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "Config.h"
 
@@ -114,6 +116,18 @@ public:
         return mInput;
     }
 
+    size_t getBatchSize() const noexcept override {
+        return mBatchInputs.size();
+    }
+
+    Input* getBatchInput(size_t index) const noexcept override {
+        return mBatchInputs[index].get();
+    }
+
+    Output* getBatchOutput(size_t index) const noexcept override {
+        return mBatchOutputs[index].get();
+    }
+
     std::string toString() const noexcept override {
         std::string parameters;
         for (size_t i = 0 ; i < mArgc; i++) {
@@ -131,6 +145,9 @@ private:
 
     FilesystemInput* mInput = nullptr;
     FilesystemOutput* mOutput = nullptr;
+
+    std::vector<std::unique_ptr<FilesystemInput>> mBatchInputs;
+    std::vector<std::unique_ptr<FilesystemOutput>> mBatchOutputs;
 };
 
 } // namespace matc
@@ -25,6 +25,9 @@
 #include <memory>
 #include <unordered_map>
 #include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <utils/compiler.h>
 
@@ -68,12 +71,21 @@ public:
     };
     virtual Input* getInput() const noexcept = 0;
 
+    // In batch mode, several inputs are compiled in parallel, each to the output of same index.
+    virtual size_t getBatchSize() const noexcept { return 0; }
+    virtual Input* getBatchInput(size_t index) const noexcept { return nullptr; }
+    virtual Output* getBatchOutput(size_t index) const noexcept { return nullptr; }
+
     virtual std::string toString() const noexcept = 0;
 
     bool isDebug() const noexcept {
         return mDebug;
     }
 
+    bool compressShaders() const noexcept {
+        return mCompressShaders;
+    }
+
     Platform getPlatform() const noexcept {
         return mPlatform;
     }
@@ -106,6 +118,10 @@ public:
         return mPrintShaders;
     }
 
+    bool reportPrecision() const noexcept {
+        return mReportPrecision;
+    }
+
     bool rawShaderMode() const noexcept {
         return mRawShaderMode;
     }
@@ -118,10 +134,23 @@ public:
         return mDefines;
     }
 
+    // custom optimizer passes, in the order they were given, for the target APIs they apply to
+    using OptimizationPasses = std::vector<std::pair<TargetApi, std::vector<std::string>>>;
+    const OptimizationPasses& getOptimizationPasses() const noexcept {
+        return mOptimizationPasses;
+    }
+
+    // directory of the compilation cache, caching is disabled when empty
+    const std::string& getCacheDirectory() const noexcept {
+        return mCacheDirectory;
+    }
+
 protected:
     bool mDebug = false;
+    bool mCompressShaders = false;
     bool mIsValid = true;
     bool mPrintShaders = false;
+    bool mReportPrecision = false;
     bool mRawShaderMode = false;
     Optimization mOptimizationLevel = Optimization::PERFORMANCE;
     Metadata mReflectionTarget = Metadata::NONE;
@@ -129,7 +158,9 @@ protected:
     OutputFormat mOutputFormat = OutputFormat::BLOB;
     TargetApi mTargetApi = (TargetApi) 0;
     std::unordered_map<std::string, std::string> mDefines;
+    OptimizationPasses mOptimizationPasses;
     uint8_t mVariantFilter = 0;
+    std::string mCacheDirectory;
 };
 
 }
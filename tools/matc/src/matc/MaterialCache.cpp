@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MaterialCache.h"
+
+#include <filament/MaterialEnums.h>
+
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace filamat;
+using namespace utils;
+
+namespace matc {
+
+static std::string readFile(const Path& path, bool* ok) {
+    std::ifstream stream(path.getPath(), std::ios::binary);
+    if (!stream) {
+        *ok = false;
+        return {};
+    }
+    *ok = true;
+    return std::string((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+}
+
+MaterialCache::MaterialCache(Path directory) noexcept : mDirectory(std::move(directory)) {
+}
+
+uint64_t MaterialCache::hash(const void* data, size_t size, uint64_t seed) noexcept {
+    // FNV-1a, good enough to detect changes and cheap compared to compiling shaders
+    uint64_t h = 0xcbf29ce484222325ull ^ seed;
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ p[i]) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+uint64_t MaterialCache::computeKey(const Config& config, const char* fileName,
+        const char* source, size_t size) noexcept {
+    // Everything that changes the generated package must be part of the key. The output format
+    // isn't, because the cache stores packages, not their C header form.
+    std::ostringstream options;
+    options << filament::MATERIAL_VERSION
+            << ' ' << fileName
+            << ' ' << int(config.getPlatform())
+            << ' ' << int(config.getTargetApi())
+            << ' ' << int(config.getOptimizationLevel())
+            << ' ' << config.isDebug()
+            << ' ' << config.compressShaders()
+            << ' ' << int(config.getVariantFilter());
+    // defines are stored in an unordered_map, sort them so the key is stable
+    std::map<std::string, std::string> const defines(
+            config.getDefines().begin(), config.getDefines().end());
+    for (auto const& define : defines) {
+        options << ' ' << define.first << '=' << define.second;
+    }
+    for (auto const& passes : config.getOptimizationPasses()) {
+        options << ' ' << int(passes.first) << ':';
+        for (auto const& pass : passes.second) {
+            options << pass << ',';
+        }
+    }
+    std::string const str = options.str();
+    return hash(source, size, hash(str.data(), str.size()));
+}
+
+Path MaterialCache::getEntryPath(uint64_t key, const char* extension) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.%s", (unsigned long long)key, extension);
+    return mDirectory.concat(name);
+}
+
+Package MaterialCache::lookup(uint64_t key) const {
+    // the manifest lists the includes, with the hash of their content when the entry was added
+    bool ok;
+    std::istringstream manifest(readFile(getEntryPath(key, "deps"), &ok));
+    if (!ok) {
+        return Package::invalidPackage();
+    }
+    std::string line;
+    while (std::getline(manifest, line)) {
+        size_t const space = line.find(' ');
+        if (space == std::string::npos) {
+            return Package::invalidPackage();
+        }
+        uint64_t const expected = strtoull(line.substr(0, space).c_str(), nullptr, 16);
+        std::string const contents = readFile(Path(line.substr(space + 1)), &ok);
+        if (!ok || hash(contents.data(), contents.size()) != expected) {
+            return Package::invalidPackage();
+        }
+    }
+
+    std::string const blob = readFile(getEntryPath(key, "filamat"), &ok);
+    if (!ok || blob.empty()) {
+        return Package::invalidPackage();
+    }
+    return Package(blob.data(), blob.size());
+}
+
+void MaterialCache::insert(uint64_t key, const Package& package,
+        const std::vector<Include>& includes) const {
+    std::ostringstream manifest;
+    for (auto const& include : includes) {
+        char h[32];
+        snprintf(h, sizeof(h), "%016llx", (unsigned long long)include.hash);
+        manifest << h << ' ' << include.path << '\n';
+    }
+    // the package first, so a manifest is never visible without its package
+    if (writeFileAtomically(getEntryPath(key, "filamat"),
+            std::string((const char*)package.getData(), package.getSize()))) {
+        writeFileAtomically(getEntryPath(key, "deps"), manifest.str());
+    }
+}
+
+bool MaterialCache::writeFileAtomically(const Path& path, const std::string& contents) {
+    // write to a file private to this thread and process, then rename it over the entry
+    std::ostringstream tmp;
+    tmp << path.getPath() << '.' << std::this_thread::get_id() << '.'
+        << std::random_device{}() << ".tmp";
+    std::string const tmpPath = tmp.str();
+    {
+        std::ofstream stream(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!stream) {
+            return false;
+        }
+        stream.write(contents.data(), std::streamsize(contents.size()));
+        if (!stream) {
+            remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+        remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace matc
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_MATERIALCACHE_H
+#define TNT_MATERIALCACHE_H
+
+#include "Config.h"
+
+#include <filamat/Package.h>
+
+#include <utils/Path.h>
+
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace matc {
+
+/*
+ * A content-addressed cache of compiled material packages, stored in a directory.
+ *
+ * A material is keyed by the hash of its source, of its file name and of every option that
+ * affects the generated package. The files it includes are only known once it has been compiled,
+ * so they're recorded next to the package along with the hash of their content, and a cached
+ * package is only used if all of them are unchanged.
+ *
+ * The cache can be shared by several matc processes, entries are written atomically.
+ */
+class MaterialCache {
+public:
+    struct Include {
+        std::string path;
+        uint64_t hash;
+    };
+
+    explicit MaterialCache(utils::Path directory) noexcept;
+
+    static uint64_t hash(const void* data, size_t size, uint64_t seed = 0) noexcept;
+
+    // the key of a material, given its source and the configuration it's compiled with
+    static uint64_t computeKey(const Config& config, const char* fileName,
+            const char* source, size_t size) noexcept;
+
+    // returns an invalid package if there is no up-to-date entry for this key
+    filamat::Package lookup(uint64_t key) const;
+
+    void insert(uint64_t key, const filamat::Package& package,
+            const std::vector<Include>& includes) const;
+
+private:
+    utils::Path getEntryPath(uint64_t key, const char* extension) const;
+    static bool writeFileAtomically(const utils::Path& path, const std::string& contents);
+
+    utils::Path mDirectory;
+};
+
+} // namespace matc
+
+#endif //TNT_MATERIALCACHE_H
@@ -16,8 +16,10 @@
 
 #include "MaterialCompiler.h"
 
+#include <atomic>
 #include <memory>
 #include <iostream>
+#include <vector>
 
 #include <filamat/MaterialBuilder.h>
 
@@ -26,6 +28,7 @@
 #include <utils/JobSystem.h>
 
 #include "DirIncluder.h"
+#include "MaterialCache.h"
 #include "MaterialLexeme.h"
 #include "MaterialLexer.h"
 #include "JsonishLexer.h"
@@ -256,17 +259,19 @@ bool MaterialCompiler::isValidJsonStart(const char* buffer, size_t size) const n
 }
 
 bool MaterialCompiler::run(const Config& config) {
-    Config::Input* input = config.getInput();
-    ssize_t size = input->open();
-    if (size <= 0) {
-        return false;
+    if (config.getBatchSize()) {
+        return runBatch(config);
     }
-    auto buffer = input->read();
 
-    utils::Path materialFilePath = utils::Path(input->getName()).getAbsolutePath();
-    assert(materialFilePath.isFile());
+    Config::Input* input = config.getInput();
 
     if (config.rawShaderMode()) {
+        ssize_t size = input->open();
+        if (size <= 0) {
+            return false;
+        }
+        auto buffer = input->read();
+        utils::Path materialFilePath = utils::Path(input->getName()).getAbsolutePath();
         const std::string extension = materialFilePath.getExtension();
         glslang::InitializeProcess();
         bool success = compileRawShader(buffer.get(), size, config.getOutput(), extension.c_str());
@@ -275,10 +280,74 @@ bool MaterialCompiler::run(const Config& config) {
     }
 
     MaterialBuilder::init();
+    JobSystem js;
+    js.adopt();
+
+    bool success = compileMaterial(config, input, config.getOutput(), js);
+
+    js.emancipate();
+    MaterialBuilder::shutdown();
+    return success;
+}
+
+bool MaterialCompiler::runBatch(const Config& config) {
+    MaterialBuilder::init();
+    JobSystem js;
+    js.adopt();
+
+    // Each material is compiled by its own job, and the variants of each material by their own
+    // jobs too, so all the cores are busy even when there are few variants per material.
+    std::atomic_bool success(true);
+    JobSystem::Job* parent = js.createJob();
+    for (size_t i = 0, n = config.getBatchSize(); i < n; i++) {
+        js.run(jobs::createJob(js, parent, [this, &config, &js, &success, i]() {
+            if (!compileMaterial(config, config.getBatchInput(i), config.getBatchOutput(i), js)) {
+                success = false;
+            }
+        }));
+    }
+    js.runAndWait(parent);
+
+    js.emancipate();
+    MaterialBuilder::shutdown();
+    return success;
+}
+
+bool MaterialCompiler::compileMaterial(const Config& config, Config::Input* input,
+        Config::Output* output, JobSystem& js) const {
+    ssize_t size = input->open();
+    if (size <= 0) {
+        return false;
+    }
+    auto buffer = input->read();
+    input->close();
+    if (!buffer) {
+        return false;
+    }
+
+    utils::Path materialFilePath = utils::Path(input->getName()).getAbsolutePath();
+    assert(materialFilePath.isFile());
+
+    // Reflection doesn't produce a package, so it doesn't use the cache. The precision report is
+    // only produced by building the material.
+    std::unique_ptr<MaterialCache> cache;
+    uint64_t cacheKey = 0;
+    if (!config.getCacheDirectory().empty() &&
+            config.getReflectionTarget() == Config::Metadata::NONE &&
+            !config.reportPrecision()) {
+        cache = std::make_unique<MaterialCache>(utils::Path(config.getCacheDirectory()));
+        cacheKey = MaterialCache::computeKey(config, materialFilePath.c_str(),
+                buffer.get(), size_t(size));
+        Package package = cache->lookup(cacheKey);
+        if (package.isValid()) {
+            return writePackage(package, config, output);
+        }
+    }
+
     MaterialBuilder builder;
     // Before attempting an expensive lex, let's find out if we were sent pure JSON.
     bool parsed;
-    if (isValidJsonStart(buffer.get(), size_t(size))) {
+    if (isValidJsonStart(buffer.get(), size)) {
         parsed = parseMaterialAsJSON(buffer.get(), size_t(size), builder);
     } else {
         parsed = parseMaterial(buffer.get(), size_t(size), builder);
@@ -299,37 +368,67 @@ bool MaterialCompiler::run(const Config& config) {
     DirIncluder includer;
     includer.setIncludeDirectory(materialFilePath.getParent());
 
+    // the included files are part of the cache entry, we record them as they're resolved
+    std::vector<MaterialCache::Include> includes;
+    auto recordingIncluder = [&includer, &includes](const utils::CString& includedBy,
+            IncludeResult& result) {
+        if (!includer(includedBy, result)) {
+            return false;
+        }
+        includes.push_back({ result.name.c_str(),
+                MaterialCache::hash(result.text.c_str(), result.text.size()) });
+        return true;
+    };
+
     builder
-        .includeCallback(includer)
+        .includeCallback(recordingIncluder)
         .fileName(materialFilePath.getName().c_str())
         .platform(config.getPlatform())
         .targetApi(config.getTargetApi())
         .optimization(config.getOptimizationLevel())
         .printShaders(config.printShaders())
+        .reportPrecision(config.reportPrecision())
         .generateDebugInfo(config.isDebug())
+        .compressShaders(config.compressShaders())
         .variantFilter(config.getVariantFilter() | builder.getVariantFilter());
 
     for (const auto& define : config.getDefines()) {
         builder.shaderDefine(define.first.c_str(), define.second.c_str());
     }
 
-    JobSystem js;
-    js.adopt();
+    // the passes set by the material itself take precedence over the command line
+    using TargetApi = MaterialBuilder::TargetApi;
+    for (const auto& passes : config.getOptimizationPasses()) {
+        for (TargetApi api : { TargetApi::OPENGL, TargetApi::VULKAN, TargetApi::METAL }) {
+            if (any(passes.first & api) && builder.getOptimizationPasses(api).empty()) {
+                builder.optimizationPasses(api, passes.second);
+            }
+        }
+    }
 
     // Write builder.build() to output.
     Package package = builder.build(js);
 
-    js.emancipate();
-    MaterialBuilder::shutdown();
-
     if (!package.isValid()) {
         std::cerr << "Could not compile material " << input->getName() << std::endl;
         return false;
     }
-    return writePackage(package, config);
+
+    if (cache) {
+        cache->insert(cacheKey, package, includes);
+    }
+    return writePackage(package, config, output);
 }
 
 bool MaterialCompiler::checkParameters(const Config& config) {
+    if (config.getBatchSize()) {
+        if (config.rawShaderMode() || config.getReflectionTarget() != Config::Metadata::NONE) {
+            std::cerr << "Batch mode can't be used with --raw or --reflect." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
     // Check for input file.
     if (config.getInput() == nullptr) {
         std::cerr << "Missing input filename." << std::endl;
@@ -26,6 +26,9 @@
 namespace filamat {
 class MaterialBuilder;
 }
+namespace utils {
+class JobSystem;
+}
 class TestMaterialCompiler;
 
 namespace matc {
@@ -42,6 +45,12 @@ public:
 private:
     friend class ::TestMaterialCompiler;
 
+    bool runBatch(const Config& config);
+
+    // compiles one material, or reflects its parameters, and writes the result to output
+    bool compileMaterial(const Config& config, Config::Input* input, Config::Output* output,
+            utils::JobSystem& js) const;
+
     bool parseMaterial(const char* buffer, size_t size,
             filamat::MaterialBuilder& builder) const noexcept;
     bool processMaterial(const MaterialLexeme&,
@@ -681,6 +681,75 @@ static bool processVariantFilter(MaterialBuilder& builder, const JsonishValue& v
     return true;
 }
 
+static bool processFoldedVariants(MaterialBuilder& builder, const JsonishValue& value) {
+    static const std::unordered_map<std::string, uint8_t> strToEnum  = [] {
+        std::unordered_map<std::string, uint8_t> strToEnum;
+        strToEnum["fog"] = filament::Variant::FOG;
+        return strToEnum;
+    }();
+    uint8_t foldedVariants = 0;
+    const JsonishArray* jsonArray = value.toJsonArray();
+    const auto& elements = jsonArray->getElements();
+
+    for (size_t i = 0; i < elements.size(); i++) {
+        auto elementValue = elements[i];
+        if (elementValue->getType() != JsonishValue::Type::STRING) {
+            std::cerr << "folded_variants: array index " << i <<
+                      " is not a STRING. found:" <<
+                      JsonishValue::typeToString(elementValue->getType()) << std::endl;
+            return false;
+        }
+
+        const std::string& s = elementValue->toJsonString()->getString();
+        if (!isStringValidEnum(strToEnum, s)) {
+            std::cerr << "folded_variants: variant " << s <<
+                      " can't be folded" << std::endl;
+            return false;
+        }
+
+        foldedVariants |= strToEnum.at(s);
+    }
+
+    builder.foldedVariants(foldedVariants);
+    return true;
+}
+
+static bool processOptimizationPasses(MaterialBuilder& builder, const JsonishValue& value) {
+    using TargetApi = MaterialBuilder::TargetApi;
+    static const std::unordered_map<std::string, TargetApi> strToEnum  = [] {
+        std::unordered_map<std::string, TargetApi> strToEnum;
+        strToEnum["opengl"] = TargetApi::OPENGL;
+        strToEnum["vulkan"] = TargetApi::VULKAN;
+        strToEnum["metal"] = TargetApi::METAL;
+        strToEnum["all"] = TargetApi::ALL;
+        return strToEnum;
+    }();
+    for (const auto& entry : value.toJsonObject()->getEntries()) {
+        if (!isStringValidEnum(strToEnum, entry.first)) {
+            std::cerr << "optimizationPasses: " << entry.first
+                      << " is not a valid target API" << std::endl;
+            return false;
+        }
+        if (entry.second->getType() != JsonishValue::Type::ARRAY) {
+            std::cerr << "optimizationPasses: value of " << entry.first << " is not an ARRAY"
+                      << std::endl;
+            return false;
+        }
+        std::vector<std::string> passes;
+        const auto& elements = entry.second->toJsonArray()->getElements();
+        for (size_t i = 0; i < elements.size(); i++) {
+            if (elements[i]->getType() != JsonishValue::Type::STRING) {
+                std::cerr << "optimizationPasses: array index " << i << " is not a STRING. found:"
+                          << JsonishValue::typeToString(elements[i]->getType()) << std::endl;
+                return false;
+            }
+            passes.push_back(elements[i]->toJsonString()->getString());
+        }
+        builder.optimizationPasses(strToEnum.at(entry.first), std::move(passes));
+    }
+    return true;
+}
+
 ParametersProcessor::ParametersProcessor() {
     using Type = JsonishValue::Type;
     mParameters["name"]                          = { &processName, Type::STRING };
@@ -713,6 +782,8 @@ ParametersProcessor::ParametersProcessor() {
     mParameters["refractionType"]                = { &processRefractionType, Type::STRING };
     mParameters["framebufferFetch"]              = { &processFramebufferFetch, Type::BOOL };
     mParameters["outputs"]                       = { &processOutputs, Type::ARRAY };
+    mParameters["foldedVariants"]                = { &processFoldedVariants, Type::ARRAY };
+    mParameters["optimizationPasses"]            = { &processOptimizationPasses, Type::OBJECT };
 }
 
 bool ParametersProcessor::process(MaterialBuilder& builder, const JsonishObject& jsonObject) {
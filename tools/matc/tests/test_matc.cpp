@@ -18,11 +18,18 @@
 
 #include "MockConfig.h"
 
+#include <fstream>
+
+#include <string.h>
+
+#include <matc/MaterialCache.h>
 #include <matc/MaterialCompiler.h>
 #include <matc/MaterialLexer.h>
 #include <matc/JsonishLexer.h>
 #include <matc/JsonishParser.h>
 
+#include <private/filament/Variant.h>
+
 class MaterialLexer: public ::testing::Test {
 protected:
     MaterialLexer() = default;
@@ -301,6 +308,103 @@ TEST_F(MaterialLexer, JsonMaterialCompiler) {
   EXPECT_EQ(result, true);
 }
 
+TEST_F(MaterialLexer, MaterialCompilerOptimizationPasses) {
+    using TargetApi = filamat::MaterialBuilder::TargetApi;
+    const std::string source(R"(
+        material {
+            name : "Tuned Material",
+            shadingModel : unlit,
+            optimizationPasses : {
+                vulkan : [ "merge-return", "ccp" ],
+                opengl : [ ]
+            }
+        }
+
+        fragment {
+            void material(inout MaterialInputs material) {
+                prepareMaterial(material);
+            }
+        }
+    )");
+    matc::MaterialCompiler rawCompiler;
+    TestMaterialCompiler compiler(rawCompiler);
+    filamat::MaterialBuilder builder;
+    ASSERT_TRUE(compiler.parseMaterial(source.c_str(), source.size(), builder));
+    const std::vector<std::string> expected = { "merge-return", "ccp" };
+    EXPECT_EQ(builder.getOptimizationPasses(TargetApi::VULKAN), expected);
+    EXPECT_TRUE(builder.getOptimizationPasses(TargetApi::OPENGL).empty());
+    EXPECT_TRUE(builder.getOptimizationPasses(TargetApi::METAL).empty());
+}
+
+TEST_F(MaterialLexer, MaterialCompilerFoldedVariants) {
+    const std::string source(R"(
+        material {
+            name : "Folded Material",
+            shadingModel : unlit,
+            foldedVariants : [ fog ]
+        }
+
+        fragment {
+            void material(inout MaterialInputs material) {
+                prepareMaterial(material);
+            }
+        }
+    )");
+    matc::MaterialCompiler rawCompiler;
+    TestMaterialCompiler compiler(rawCompiler);
+    filamat::MaterialBuilder builder;
+    ASSERT_TRUE(compiler.parseMaterial(source.c_str(), source.size(), builder));
+    EXPECT_EQ(builder.getFoldedVariants(), filament::Variant::FOG);
+
+    // only the fog variant can be folded
+    const std::string invalid(R"(
+        material {
+            name : "Folded Material",
+            foldedVariants : [ skinning ]
+        }
+    )");
+    filamat::MaterialBuilder other;
+    EXPECT_FALSE(compiler.parseMaterial(invalid.c_str(), invalid.size(), other));
+}
+
+TEST(MaterialCache, KeyDependsOnSource) {
+    MockConfig config;
+    const std::string a = "material { name : a }";
+    const std::string b = "material { name : b }";
+    uint64_t keyA = matc::MaterialCache::computeKey(config, "a.mat", a.c_str(), a.size());
+    uint64_t keyB = matc::MaterialCache::computeKey(config, "a.mat", b.c_str(), b.size());
+    uint64_t keyC = matc::MaterialCache::computeKey(config, "c.mat", a.c_str(), a.size());
+    EXPECT_EQ(keyA, matc::MaterialCache::computeKey(config, "a.mat", a.c_str(), a.size()));
+    EXPECT_NE(keyA, keyB);
+    EXPECT_NE(keyA, keyC);
+}
+
+TEST(MaterialCache, LookupChecksIncludes) {
+    const utils::Path directory = utils::Path::getTemporaryDirectory() + "matc_cache_test";
+    directory.mkdirRecursive();
+    const utils::Path include = directory + "include.h";
+    auto writeInclude = [&include](const std::string& text) {
+        std::ofstream(include.getPath(), std::ios::binary | std::ios::trunc) << text;
+        return matc::MaterialCache::hash(text.data(), text.size());
+    };
+
+    matc::MaterialCache cache(directory);
+    const uint8_t data[] = { 1, 2, 3, 4 };
+    const filamat::Package package(data, sizeof(data));
+
+    EXPECT_FALSE(cache.lookup(42).isValid());
+
+    cache.insert(42, package, { { include.getPath(), writeInclude("// v1") } });
+    filamat::Package cached = cache.lookup(42);
+    ASSERT_TRUE(cached.isValid());
+    ASSERT_EQ(cached.getSize(), sizeof(data));
+    EXPECT_EQ(memcmp(cached.getData(), data, sizeof(data)), 0);
+
+    // changing an include invalidates the entry
+    writeInclude("// v2");
+    EXPECT_FALSE(cache.lookup(42).isValid());
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -16,6 +16,7 @@
 
 #include <image/ColorTransform.h>
 #include <image/ImageOps.h>
+#include <image/ImagePool.h>
 #include <image/ImageSampler.h>
 #include <image/KtxBundle.h>
 #include <image/LinearImage.h>
@@ -27,6 +28,7 @@
 #include <imageio/ImageDecoder.h>
 #include <imageio/ImageEncoder.h>
 
+#include <utils/JobSystem.h>
 #include <utils/Path.h>
 
 #include <getopt/getopt.h>
@@ -48,8 +50,11 @@ static bool g_addAlpha = false;
 static bool g_stripAlpha = false;
 static bool g_grayscale = false;
 static bool g_ktxContainer = false;
+static bool g_ktx2Container = false;
+static bool g_supercompress = false;
 static bool g_linearized = false;
 static bool g_quietMode = false;
+static bool g_fastCompression = false;
 static uint32_t g_mipLevelCount = 0;
 
 static const char* USAGE = R"TXT(
@@ -59,7 +64,7 @@ The <output_pattern> argument is a printf-style pattern.
 For example, "mip%2d.png" generates mip01.png, mip02.png, etc.
 Miplevel 0 is not generated since it is the original image.
 
-If the output format is a container format like KTX, then
+If the output format is a container format like KTX or KTX2, then
 <output_pattern> is simply a filename.
 
 Usage:
@@ -78,8 +83,10 @@ Options:
        suppress console output from the mipgen tool
    --grayscale, -g
        create a single-channel image and do not perform gamma correction
-   --format=[exr|hdr|rgbm|psd|png|dds|ktx], -f [exr|hdr|rgbm|psd|png|dds|ktx]
+   --format=[exr|hdr|rgbm|psd|png|dds|ktx|ktx2], -f [exr|hdr|rgbm|psd|png|dds|ktx|ktx2]
        specify output file format, inferred from output pattern if omitted
+   --supercompress, -z
+       compress the KTX2 miplevels with zlib to reduce the download size
    --kernel=[box|nearest|hermite|gaussian|normals|mitchell|lanczos|min], -k [filter]
        specify filter kernel type (defaults to lanczos)
        the "normals" filter may automatically change the compression scheme
@@ -103,6 +110,8 @@ R"TXT(
                          srgb8_alpha, rgba8, or srgb8_alpha8
                METRIC is rgba, rgbx, rec709, numeric, or normalxyz
                EFFORT is an integer between 0 and 100
+   --fast-compression, -F
+       trade quality for speed when compressing, e.g. for iteration builds
 )TXT"
 #endif
 R"TXT(
@@ -116,6 +125,7 @@ Examples:
     MIPGEN -g --kernel=hermite grassland.png mip_%03d.png
     MIPGEN -f ktx --compression=astc_fast_ldr_4x4 grassland.png mips.ktx
     MIPGEN -f ktx --compression=etc_rgb_rgba_40 grassland.png mips.ktx
+    MIPGEN --supercompress --compression=s3tc_rgba_dxt5 grassland.png mips.ktx2
 )TXT";
 
 static const char* HTML_PREFIX = R"HTML(<!DOCTYPE html>
@@ -159,7 +169,7 @@ static void license() {
 }
 
 static int handleArguments(int argc, char* argv[]) {
-    static constexpr const char* OPTSTR = "hLlgpf:c:k:saqm:";
+    static constexpr const char* OPTSTR = "hLlgpf:c:Fzk:saqm:";
     static const struct option OPTIONS[] = {
             { "help",                 no_argument, 0, 'h' },
             { "license",              no_argument, 0, 'L' },
@@ -168,6 +178,8 @@ static int handleArguments(int argc, char* argv[]) {
             { "page",                 no_argument, 0, 'p' },
             { "format",         required_argument, 0, 'f' },
             { "compression",    required_argument, 0, 'c' },
+            { "fast-compression",     no_argument, 0, 'F' },
+            { "supercompress",        no_argument, 0, 'z' },
             { "kernel",         required_argument, 0, 'k' },
             { "strip-alpha",          no_argument, 0, 's' },
             { "add-alpha",            no_argument, 0, 'a' },
@@ -243,10 +255,20 @@ static int handleArguments(int argc, char* argv[]) {
                     g_ktxContainer = true;
                     g_formatSpecified = true;
                 }
+                if (arg == "ktx2") {
+                    g_ktxContainer = g_ktx2Container = true;
+                    g_formatSpecified = true;
+                }
                 break;
             case 'c':
                 g_compression = arg;
                 break;
+            case 'F':
+                g_fastCompression = true;
+                break;
+            case 'z':
+                g_supercompress = true;
+                break;
             case 'm':
                 try {
                     g_mipLevelCount = std::stoi(arg);
@@ -261,6 +283,9 @@ static int handleArguments(int argc, char* argv[]) {
 }
 
 int main(int argc, char* argv[]) {
+    utils::JobSystem js;
+    js.adopt();
+
     int optionIndex = handleArguments(argc, argv);
     int numArgs = argc - optionIndex;
     if (numArgs < 2) {
@@ -272,6 +297,9 @@ int main(int argc, char* argv[]) {
     if (Path(outputPattern).getExtension() == "ktx") {
         g_ktxContainer = true;
         g_formatSpecified = true;
+    } else if (Path(outputPattern).getExtension() == "ktx2") {
+        g_ktxContainer = g_ktx2Container = true;
+        g_formatSpecified = true;
     } else if (!g_formatSpecified) {
         g_format = ImageEncoder::chooseFormat(outputPattern, g_linearized);
     }
@@ -315,8 +343,10 @@ int main(int argc, char* argv[]) {
 
     uint32_t count = getMipmapCount(sourceImage);
     count = g_mipLevelCount == 0 ? count : min(g_mipLevelCount - 1, count);
+    // The pool lets every level reuse the intermediate image of the first one.
+    ImagePool pool;
     vector<LinearImage> miplevels(count);
-    generateMipmaps(sourceImage, g_filter, miplevels.data(), count);
+    generateMipmaps(sourceImage, g_filter, miplevels.data(), count, &js, &pool);
 
     if (g_ktxContainer) {
         if (!g_quietMode) {
@@ -355,6 +385,7 @@ int main(int argc, char* argv[]) {
                 cerr << "Unrecognized compression: " << g_compression << endl;
                 return 1;
             }
+            config.fast = g_fastCompression;
             // The KTX spec says the following for compressed textures: glTypeSize should 1,
             // glFormat should be 0, and glBaseInternalFormat should be RED, RG, RGB, or RGBA.
             // The glInternalFormat field is the only field that specifies the actual format.
@@ -381,7 +412,7 @@ int main(int argc, char* argv[]) {
                     printf("Starting compression for %s (%dx%d)\n", inputPath.getName().c_str(),
                             image.getWidth(), image.getHeight());
                 }
-                CompressedTexture tex = compressTexture(config, image);
+                CompressedTexture tex = compressTexture(config, image, &js);
                 container.setBlob({mip++}, tex.data.get(), tex.size);
                 info.glInternalFormat = (uint32_t) tex.format;
                 return;
@@ -411,11 +442,24 @@ int main(int argc, char* argv[]) {
         for (auto image : miplevels) {
             addLevel(image);
         }
-        vector<uint8_t> fileContents(container.getSerializedLength());
-        container.serialize(fileContents.data(), fileContents.size());
+        std::unique_ptr<uint8_t[]> fileContents;
+        uint32_t fileSize;
+        if (g_ktx2Container) {
+            using Supercompression = KtxBundle::Supercompression;
+            fileSize = container.serializeKtx2(&fileContents,
+                    g_supercompress ? Supercompression::ZLIB : Supercompression::NONE, &js);
+            if (!fileSize) {
+                cerr << "This format can't be stored in a KTX2 file." << endl;
+                return 1;
+            }
+        } else {
+            fileSize = container.getSerializedLength();
+            fileContents.reset(new uint8_t[fileSize]);
+            container.serialize(fileContents.get(), fileSize);
+        }
         Path(outputPattern).getParent().mkdirRecursive();
         ofstream outputStream(outputPattern, ios::out | ios::binary);
-        outputStream.write((const char*) fileContents.data(), fileContents.size());
+        outputStream.write((const char*) fileContents.get(), fileSize);
         outputStream.close();
         if (!g_quietMode) {
             puts("Done.");
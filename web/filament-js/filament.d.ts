@@ -267,6 +267,7 @@ export class RenderableManager$Builder {
     public skinningMatrices(transforms: mat4[]): RenderableManager$Builder;
     public morphing(enable: boolean): RenderableManager$Builder;
     public blendOrder(index: number, order: number): RenderableManager$Builder;
+    public instances(instanceCount: number): RenderableManager$Builder;
     public build(engine: Engine, entity: Entity): void;
 }
 
@@ -949,6 +950,7 @@ export const enum TextureUsage {
     UPLOADABLE = 8,
     SAMPLEABLE = 16,
     SUBPASS_INPUT = 32,
+    SPARSE = 64,
     DEFAULT = UPLOADABLE | SAMPLEABLE,
 }
 